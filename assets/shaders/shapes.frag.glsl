@@ -0,0 +1,7 @@
+// fragment shader for the colored lines and rectangles of a shape batch
+
+varying vec4 color;
+
+void main() {
+	gl_FragColor = color;
+}
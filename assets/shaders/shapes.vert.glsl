@@ -0,0 +1,14 @@
+// vertex shader for the colored lines and rectangles of a shape batch
+
+// the position of this vertex
+attribute vec4 vertex_position;
+
+// the color of this vertex
+attribute vec4 vertex_color;
+
+varying vec4 color;
+
+void main(void) {
+	gl_Position = gl_ModelViewProjectionMatrix * vertex_position;
+	color = vertex_color;
+}
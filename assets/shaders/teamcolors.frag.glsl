@@ -7,8 +7,14 @@
 //the unmodified texture itself
 uniform sampler2D texture;
 
-//the desired player number the final resulting colors
-uniform int player_number;
+#ifdef PALETTE_INDEXED
+//the colors of the texture, which stores their indices
+uniform sampler2D palette;
+#endif
+
+//the desired player number the final resulting colors,
+//passed from the vertex shader
+varying float player_number;
 
 //the alpha value which marks colors to be replaced
 uniform float alpha_marker;
@@ -31,16 +37,24 @@ vec4 get_color(int playernum, int subcolor) {
 
 void main() {
 	//get the texel from the uniform texture.
+#ifdef PALETTE_INDEXED
+	float index = texture2D(texture, tex_position).r * 255.0;
+	vec4 pixel = texture2D(palette, vec2((index + 0.5) / 256.0, 0.5));
+#else
 	vec4 pixel = texture2D(texture, tex_position);
+#endif
+
+	//the varying is interpolated, round it to the player number
+	int player = int(player_number + 0.5);
 
 	//check if this texel has an alpha marker, so we can replace it's rgb values.
-	if (player_number != 1 && equalsEpsilon(pixel[3], alpha_marker, EPSILON)) {
+	if (player != 1 && equalsEpsilon(pixel[3], alpha_marker, EPSILON)) {
 		//try to find the base color, there are 8 of them.
 		for(int i = 0; i <= 7; i++) {
 			if (equalsEpsilon(vec3(pixel), vec3(player_color[i]), EPSILON)) {
 				//base color found, now replace it with the same color
 				//but player_number tinted.
-				gl_FragColor = get_color(player_number, i);
+				gl_FragColor = get_color(player, i);
 				return;
 			}
 		}
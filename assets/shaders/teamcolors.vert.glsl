@@ -0,0 +1,31 @@
+//team color replacement vertex shader
+
+//modelview*projection matrix
+uniform mat4 mvp_matrix;
+
+//the position of this vertex
+attribute vec4 vertex_position;
+
+//the texture coordinates assigned to this vertex
+attribute vec2 tex_coordinates;
+
+//the player number of the sprite this vertex belongs to
+attribute float player_id;
+
+//interpolated texture coordinates sent to fragment shader
+varying vec2 tex_position;
+
+//player number sent to the fragment shader
+varying float player_number;
+
+void main(void) {
+	//transform the vertex coordinates
+	gl_Position = gl_ModelViewProjectionMatrix * vertex_position;
+
+	//pass the fix points for texture coordinates set at this vertex
+	tex_position = tex_coordinates;
+
+	//constant for all vertices of a sprite, so sprites of
+	//different players can be drawn with one call
+	player_number = player_id;
+}
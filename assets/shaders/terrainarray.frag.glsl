@@ -0,0 +1,12 @@
+// terrain tiles, drawn from the layer of their terrain in the texture array,
+// so tiles of all terrains are drawn without switching textures
+
+#extension GL_EXT_texture_array : enable
+
+uniform sampler2DArray texture;
+
+varying vec3 tex_position;
+
+void main(void) {
+	gl_FragColor = texture2DArray(texture, tex_position);
+}
@@ -0,0 +1,15 @@
+// vertex shader for terrain tiles drawn from the terrain texture array
+
+// the position of this vertex
+attribute vec4 vertex_position;
+
+// the texture coordinates in the layer, and the layer of the terrain
+attribute vec3 tex_coordinates;
+
+varying vec3 tex_position;
+
+void main(void) {
+	gl_Position = gl_ModelViewProjectionMatrix * vertex_position;
+
+	tex_position = tex_coordinates;
+}
@@ -0,0 +1,148 @@
+// terrain blending shader
+//
+// draws a terrain over a tile of lower priority, masked by the blendomatic
+// masks for the directions in which the terrain neighbors the tile.
+// see doc/media/blendomatic for the idea behind this.
+//
+// with TEXTURE_ARRAYS defined, the terrain and the masks are layers
+// of the texture arrays, chosen by the vertices.
+
+#ifdef TEXTURE_ARRAYS
+#extension GL_EXT_texture_array : enable
+
+// all terrains and all blending masks
+uniform sampler2DArray base_texture;
+uniform sampler2DArray mask_texture;
+#else
+// the blended terrain and the blending masks of the mode
+uniform sampler2D base_texture;
+uniform sampler2D mask_texture;
+#endif
+
+// terrain id + 1 of each tile of the chunk and its border, 0 if missing
+uniform sampler2D tile_ids;
+uniform float grid_size;
+
+// priority rank and blending mode of each terrain id
+uniform sampler2D terrain_priorities;
+uniform sampler2D terrain_blendmodes;
+uniform float terrain_count;
+
+// the blended terrain and the blending mode of the drawn batch
+uniform float terrain;
+uniform float blend_mode;
+
+// texture coordinates of the masks: left, top, right, bottom
+uniform vec4 mask_rects[31];
+
+// mask id for the adjacent neighbors 1, 3, 5, 7 as bits, -1 for none
+uniform float adjacent_masks[16];
+
+varying vec2 tex_position;
+varying vec2 mask_position;
+varying vec3 tile_position;
+
+#ifdef TEXTURE_ARRAYS
+// the layers of the terrain and of the masks
+varying vec2 layers;
+
+vec4 base_pixel(vec2 position) {
+	return texture2DArray(base_texture, vec3(position, layers.x));
+}
+
+float mask_pixel(vec2 position) {
+	return texture2DArray(mask_texture, vec3(position, layers.y)).x;
+}
+#else
+vec4 base_pixel(vec2 position) {
+	return texture2D(base_texture, position);
+}
+
+float mask_pixel(vec2 position) {
+	return texture2D(mask_texture, position).x;
+}
+#endif
+
+float lookup(sampler2D table, float id) {
+	return floor(texture2D(table, vec2((id + 0.5) / terrain_count, 0.5)).r * 255.0 + 0.5);
+}
+
+float tile_id(vec2 tile) {
+	return floor(texture2D(tile_ids, (tile + 0.5) / grid_size).r * 255.0 + 0.5) - 1.0;
+}
+
+// the alpha of the terrain under the mask
+float masked(float mask_id, float alpha) {
+	vec4 rect = mask_rects[int(mask_id)];
+	float mask = mask_pixel(mix(rect.xy, rect.zw, mask_position));
+	return clamp(alpha - (1.0 - mask), 0.0, 1.0);
+}
+
+void main() {
+	vec2 tile = floor(tile_position.xy + 0.5);
+
+	float base = tile_id(tile);
+	if (base < 0.0 || base == terrain) {
+		discard;
+	}
+
+	// the terrain draws over the base if its priority is greater
+	if (lookup(terrain_priorities, base) >= lookup(terrain_priorities, terrain)) {
+		discard;
+	}
+
+	// the mode of the higher blending mode
+	float mode = max(lookup(terrain_blendmodes, base), lookup(terrain_blendmodes, terrain));
+	if (mode != blend_mode) {
+		discard;
+	}
+
+	// the neighbors that have the terrain:
+	//     0
+	//   7   1
+	// 6   @   2
+	//   5   3
+	//     4
+	bool n0 = tile_id(tile + vec2( 1.0, -1.0)) == terrain;
+	bool n1 = tile_id(tile + vec2( 1.0,  0.0)) == terrain;
+	bool n2 = tile_id(tile + vec2( 1.0,  1.0)) == terrain;
+	bool n3 = tile_id(tile + vec2( 0.0,  1.0)) == terrain;
+	bool n4 = tile_id(tile + vec2(-1.0,  1.0)) == terrain;
+	bool n5 = tile_id(tile + vec2(-1.0,  0.0)) == terrain;
+	bool n6 = tile_id(tile + vec2(-1.0, -1.0)) == terrain;
+	bool n7 = tile_id(tile + vec2( 0.0, -1.0)) == terrain;
+
+	vec4 pixel = base_pixel(tex_position);
+
+	// the masks are combined as if they were drawn over each other
+	float transparency = 1.0;
+
+	float adjacent = adjacent_masks[int(n1) + 2 * int(n3) + 4 * int(n5) + 8 * int(n7)];
+	if (adjacent >= 0.0) {
+		// cycle the 4 straight masks, so long shorelines don't look the same
+		if (adjacent <= 12.0 && mod(adjacent, 4.0) == 0.0) {
+			adjacent += tile_position.z;
+		}
+		transparency *= 1.0 - masked(adjacent, pixel.a);
+	}
+
+	// diagonal neighbors only influence if their adjacent neighbors don't
+	if (n0 && !n7 && !n1) {
+		transparency *= 1.0 - masked(18.0, pixel.a);
+	}
+	if (n2 && !n1 && !n3) {
+		transparency *= 1.0 - masked(16.0, pixel.a);
+	}
+	if (n4 && !n3 && !n5) {
+		transparency *= 1.0 - masked(17.0, pixel.a);
+	}
+	if (n6 && !n5 && !n7) {
+		transparency *= 1.0 - masked(19.0, pixel.a);
+	}
+
+	if (transparency >= 1.0) {
+		discard;
+	}
+
+	gl_FragColor = vec4(pixel.rgb, 1.0 - transparency);
+}
@@ -0,0 +1,35 @@
+// vertex shader for blending a terrain over a tile
+
+// the position of this vertex
+attribute vec4 vertex_position;
+
+// the texture coordinates in the blended terrain
+attribute vec2 tex_coordinates;
+
+// the corner of the quad, 0..1, the mask is mapped onto it
+attribute vec2 mask_corner;
+
+// the tile position in the id grid, and the straight mask variant
+attribute vec3 tile_coordinates;
+
+#ifdef TEXTURE_ARRAYS
+// the layers of the terrain and of the masks in the texture arrays
+attribute vec2 texture_layers;
+varying vec2 layers;
+#endif
+
+varying vec2 tex_position;
+varying vec2 mask_position;
+varying vec3 tile_position;
+
+void main(void) {
+	gl_Position = gl_ModelViewProjectionMatrix * vertex_position;
+
+	tex_position = tex_coordinates;
+	mask_position = mask_corner;
+	tile_position = tile_coordinates;
+
+#ifdef TEXTURE_ARRAYS
+	layers = texture_layers;
+#endif
+}
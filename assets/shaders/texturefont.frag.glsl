@@ -1,13 +1,23 @@
 varying vec2 tex_position;
+varying vec4 tint;
 uniform sampler2D texture;
 uniform vec4 color;
+uniform bool distance_field;
 
 void main() {
 	// Glyph's image data is stored in the RED channel of the texture
 	float red = texture2D(texture, tex_position).r;
-	if (red < 0.01) {
+
+	float alpha = red;
+	if (distance_field) {
+		// 0.5 is the outline, smoothed over about a screen pixel
+		float width = fwidth(red);
+		alpha = smoothstep(0.5 - width, 0.5 + width, red);
+	}
+
+	if (alpha < 0.01) {
 		discard;
 	}
 
-	gl_FragColor = color * vec4(1.0f, 1.0f, 1.0f, red);
+	gl_FragColor = color * tint * vec4(1.0f, 1.0f, 1.0f, alpha);
 }
@@ -1,8 +1,11 @@
 attribute vec4 vertex_position;
 attribute vec2 tex_coordinates;
+attribute vec4 vertex_color;
 varying vec2 tex_position;
+varying vec4 tint;
 
 void main() {
 	gl_Position = gl_ModelViewProjectionMatrix * vertex_position;
 	tex_position = tex_coordinates;
+	tint = vertex_color;
 }
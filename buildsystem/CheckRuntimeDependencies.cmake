@@ -8,7 +8,7 @@
 set(REQUIRED_PYTHON_MODULES "PIL.Image" "PIL.ImageDraw" "numpy" "pygments")
 
 # command-line tools
-set(REQUIRED_UTILITIES "opusenc")
+set(REQUIRED_UTILITIES)
 
 # Checks if the specified python module exists
 #
@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "assetmanager.h"
 
@@ -8,19 +8,56 @@
 #include <limits.h> /* for NAME_MAX */
 #endif
 
+#include <cstdlib>
+
+#include "util/asset_pack.h"
 #include "util/compiler.h"
 #include "util/file.h"
+#include "engine.h"
+#include "render_command_list.h"
 #include "error/error.h"
+#include "job/job_manager.h"
 #include "log/log.h"
 
 #include "texture.h"
 
 namespace openage {
 
+namespace {
+
+/**
+ * gpu memory textures may use until they are evicted.
+ */
+constexpr size_t default_texture_budget = size_t{1024} * 1024 * 1024;
+
+/**
+ * written by the converter, see openage/convert/manifest.py.
+ */
+constexpr const char *manifest_dir = "converted";
+constexpr const char *manifest_filename = "converted/asset_manifest";
+constexpr const char *manifest_format_version = "1";
+
+/**
+ * pixels of a changed texture, read on a job.
+ */
+struct reloaded_pixels {
+	std::shared_ptr<gl_texture_buffer> pixels;
+	int w, h;
+};
+
+} // anonymous namespace
+
+
 AssetManager::AssetManager(qtsdl::GuiItemLink *gui_link)
 	:
+	engine{nullptr},
+	reload_jobs{nullptr},
+	job_manager{nullptr},
+	headless{false},
+	reloads{std::make_shared<reload_state>()},
 	root{std::string()},
 	missing_tex{nullptr},
+	residency{default_texture_budget},
 	gui_link{gui_link} {
 
 #if WITH_INOTIFY
@@ -32,6 +69,16 @@ AssetManager::AssetManager(qtsdl::GuiItemLink *gui_link)
 #endif
 }
 
+AssetManager::~AssetManager() {
+	if (this->engine != nullptr) {
+		this->engine->finish_rendering();
+	}
+
+	if (not this->pack_dir.empty()) {
+		util::unmount_asset_pack(this->pack_dir);
+	}
+}
+
 util::Dir *AssetManager::get_data_dir() {
 	return &this->root;
 }
@@ -44,12 +91,20 @@ void AssetManager::set_data_dir_string(const std::string& data_dir) {
 	if (this->root.basedir != data_dir) {
 		this->root.basedir = data_dir;
 		this->clear();
+		this->load_asset_pack();
+		this->load_manifest();
 	}
 }
 
 
 void AssetManager::set_engine(Engine *engine) {
 	this->engine = engine;
+
+	// evicted textures are reloaded in the background
+	this->residency.set_job_manager(engine ? engine->get_job_manager() : nullptr);
+
+	// changed files are read with the other file loading
+	this->reload_jobs = engine ? engine->get_job_manager(job_pool::io) : nullptr;
 }
 
 
@@ -58,10 +113,111 @@ Engine *AssetManager::get_engine() const {
 }
 
 
+void AssetManager::set_headless(bool headless) {
+	this->headless = headless;
+}
+
+
+bool AssetManager::is_headless() const {
+	return this->headless;
+}
+
+
+job::JobManager *AssetManager::get_job_manager() const {
+	if (this->engine != nullptr) {
+		return this->engine->get_job_manager();
+	}
+	return this->job_manager;
+}
+
+
+void AssetManager::set_job_manager(job::JobManager *job_manager) {
+	this->job_manager = job_manager;
+}
+
+
 bool AssetManager::can_load(const std::string &name) const {
+	auto it = this->manifest.find(name);
+	if (it != this->manifest.end()) {
+		return it->second > 0;
+	}
+
 	return util::file_size(this->root.join(name)) > 0;
 }
 
+
+void AssetManager::load_asset_pack() {
+	if (not this->pack_dir.empty()) {
+		util::unmount_asset_pack(this->pack_dir);
+		this->pack_dir.clear();
+	}
+
+	std::string pack_dir = this->root.join(manifest_dir);
+	std::string filename = util::Dir{pack_dir}.join(util::asset_pack_filename);
+	if (util::file_size(filename) <= 0) {
+		return;
+	}
+
+	try {
+		auto pack = std::make_shared<util::AssetPack>(filename);
+		log::log(MSG(info) << "Asset pack contains " << pack->get_file_count() << " converted files");
+
+		util::mount_asset_pack(pack_dir, std::move(pack));
+		this->pack_dir = pack_dir;
+	}
+	catch (Error &exc) {
+		log::log(MSG(warn) << exc.what() << ", reading the converted files from the disk instead");
+	}
+}
+
+
+void AssetManager::load_manifest() {
+	this->manifest.clear();
+
+	std::string filename = this->root.join(manifest_filename);
+	if (util::file_size(filename) <= 0) {
+		log::log(MSG(info) << "No asset manifest found, checking the converted files on the disk");
+		return;
+	}
+
+	std::unordered_map<std::string, size_t> outputs;
+	bool format_known = false;
+
+	for (auto &line : util::file_get_lines(filename)) {
+		size_t key_end = line.find('\t');
+		if (key_end == std::string::npos) {
+			log::log(MSG(warn) << "Ignoring the malformed asset manifest " << filename);
+			return;
+		}
+
+		std::string key = line.substr(0, key_end);
+		std::string value = line.substr(key_end + 1);
+
+		if (key == "openage-asset-manifest") {
+			format_known = (value == manifest_format_version);
+		}
+		else if (key == "output") {
+			// output <size> <path>
+			size_t size_end = value.find('\t');
+			if (size_end == std::string::npos) {
+				log::log(MSG(warn) << "Ignoring the malformed asset manifest " << filename);
+				return;
+			}
+
+			size_t size = std::strtoull(value.c_str(), nullptr, 10);
+			outputs[std::string{manifest_dir} + "/" + value.substr(size_end + 1)] = size;
+		}
+	}
+
+	if (not format_known) {
+		log::log(MSG(warn) << "Ignoring the asset manifest " << filename << " of an unknown format");
+		return;
+	}
+
+	this->manifest = std::move(outputs);
+	log::log(MSG(info) << "Asset manifest lists " << this->manifest.size() << " converted files");
+}
+
 std::shared_ptr<Texture> AssetManager::load_texture(const std::string &name, bool use_metafile) {
 	std::string filename = this->root.join(name);
 
@@ -76,46 +232,85 @@ std::shared_ptr<Texture> AssetManager::load_texture(const std::string &name, boo
 		// to display the tex as soon at it exists.
 
 		// return the big X texture instead
+		std::lock_guard<std::mutex> lock{this->textures_mutex};
 		tex = this->get_missing_tex();
-	} else {
-		// create the texture!
-		tex = std::make_shared<Texture>(filename, use_metafile);
+		return this->textures.emplace(filename, tex).first->second;
+	}
+
+	// create the texture!
+	// reading the pixels takes long, other threads may load textures meanwhile.
+	tex = std::make_shared<Texture>(filename, use_metafile, not this->headless);
+
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+
+	// another thread may have loaded the same file meanwhile
+	auto inserted = this->textures.emplace(filename, tex);
+	if (not inserted.second) {
+		return inserted.first->second;
+	}
+
+	// never drawn, nor reloaded
+	if (this->headless) {
+		return tex;
+	}
+
+	// small textures are drawn from a shared atlas page,
+	// the others are evicted when they exceed the budget.
+	if (not this->atlas.insert(tex.get())) {
+		this->residency.add(tex.get());
+	}
 
 #if WITH_INOTIFY
-		// create inotify update trigger for the requested file
-		int wd = inotify_add_watch(this->inotify_fd, filename.c_str(), IN_CLOSE_WRITE);
+	// one inotify update trigger for the directory of all requested files,
+	// files replaced by renaming them are seen as well.
+	std::string dir = filename.substr(0, filename.rfind('/'));
+	if (this->watched_dirs.count(dir) == 0) {
+		int wd = inotify_add_watch(this->inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
 		if (wd < 0) {
-			throw Error{MSG(warn) << "Failed to add inotify watch for " << filename};
+			throw Error{MSG(warn) << "Failed to add inotify watch for " << dir};
 		}
-		this->watch_fds[wd] = tex;
-#endif
+		this->watch_fds[wd] = dir;
+		this->watched_dirs[dir] = wd;
 	}
-
-	// insert the texture into the map and return the texture.
-	this->textures[filename] = tex;
+#endif
 
 	// pass back the shared_ptr<Texture>
 	return tex;
 }
 
 Texture *AssetManager::get_texture(const std::string &name, bool use_metafile) {
-	// check whether the requested texture was loaded already
-	auto tex_it = this->textures.find(this->root.join(name));
+	{
+		// check whether the requested texture was loaded already
+		std::lock_guard<std::mutex> lock{this->textures_mutex};
+		auto tex_it = this->textures.find(this->root.join(name));
 
-	// the texture was not loaded yet:
-	if (tex_it == this->textures.end()) {
-		return this->load_texture(name, use_metafile).get();
+		if (tex_it != this->textures.end()) {
+			return tex_it->second.get();
+		}
 	}
 
-	return tex_it->second.get();
+	// the texture was not loaded yet:
+	return this->load_texture(name, use_metafile).get();
 }
 
 void AssetManager::check_updates() {
+	this->poll_updates(true);
+}
+
+void AssetManager::next_frame() {
+	this->residency.next_frame();
+	this->poll_updates(false);
+}
+
+void AssetManager::poll_updates(bool force) {
 #if WITH_INOTIFY
 	// buffer for at least 4 inotify events
 	char buf[4 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
 	ssize_t len;
 
+	time_nsec_t now = timing::get_monotonic_time();
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+
 	while (true) {
 		// fetch all events, the kernel won't write "half" structs.
 		len = read(this->inotify_fd, buf, sizeof(buf));
@@ -134,29 +329,134 @@ void AssetManager::check_updates() {
 		while (ptr < buf + len) {
 			struct inotify_event *event = (struct inotify_event *)ptr;
 
-			if (event->mask & IN_CLOSE_WRITE) {
-				// TODO: this should invoke callback functions
-				this->watch_fds[event->wd]->reload();
+			auto dir = this->watch_fds.find(event->wd);
+			if (event->len > 0 and dir != this->watch_fds.end()) {
+				// only the files of loaded textures are reloaded,
+				// each write postpones their reload.
+				std::string filename = dir->second + "/" + event->name;
+				if (this->textures.count(filename) > 0) {
+					this->pending_reloads[filename] = now;
+				}
 			}
 
 			// move the buffer ptr to the next event.
 			ptr += sizeof(struct inotify_event) + event->len;
 		}
 	}
+
+	for (auto it = this->pending_reloads.begin(); it != this->pending_reloads.end();) {
+		if (not force and now - it->second < reload_delay) {
+			++it;
+			continue;
+		}
+
+		auto tex = this->textures.find(it->first);
+		if (tex != this->textures.end() and tex->second != this->missing_tex) {
+			this->start_reload(it->first, tex->second);
+		}
+		it = this->pending_reloads.erase(it);
+	}
+#else
+	(void) force;
 #endif
 }
 
+void AssetManager::start_reload(const std::string &filename, std::shared_ptr<Texture> texture) {
+	std::shared_ptr<reload_state> state = this->reloads;
+	uint64_t id;
+	{
+		std::lock_guard<std::mutex> lock{state->mutex};
+		id = state->next_id++;
+		state->latest[filename] = id;
+	}
+	bool palette = texture->is_palette_allowed();
+
+	// uploads the pixels, where the frame is drawn
+	auto upload = [state, filename, texture, id](reloaded_pixels result) {
+		{
+			// a later change of the file was read first, or the textures were cleared
+			std::lock_guard<std::mutex> lock{state->mutex};
+			auto latest = state->latest.find(filename);
+			if (latest == state->latest.end() or latest->second != id) {
+				return;
+			}
+			state->latest.erase(latest);
+		}
+
+		texture->reload(std::make_unique<gl_texture_buffer>(std::move(*result.pixels)), result.w, result.h);
+		log::log(MSG(info) << "Reloaded texture " << filename);
+	};
+
+	if (this->reload_jobs == nullptr) {
+		reloaded_pixels result;
+		result.pixels = Texture::read_pixels(filename, &result.w, &result.h, palette);
+		RenderCommandList::submit([upload, result] {
+			upload(result);
+		});
+		return;
+	}
+
+	this->reload_jobs->enqueue<reloaded_pixels>(
+		[filename, palette]() {
+			reloaded_pixels result;
+			result.pixels = Texture::read_pixels(filename, &result.w, &result.h, palette);
+			return result;
+		},
+		[upload, filename](job::result_function_t<reloaded_pixels> get_result) {
+			reloaded_pixels result;
+			try {
+				result = get_result();
+			}
+			catch (Error &exc) {
+				// the file may still be written, the next change reloads it
+				log::log(MSG(warn) << "Failed to reload texture " << filename << ": " << exc.what());
+				return;
+			}
+
+			RenderCommandList::submit([upload, result] {
+				upload(result);
+			});
+		}
+	);
+}
+
+void AssetManager::set_texture_budget(size_t bytes) {
+	this->residency.set_budget(bytes);
+}
+
+void AssetManager::set_texture_upload_budget(size_t bytes) {
+	this->residency.set_upload_budget(bytes);
+}
+
+const texture_residency_stats &AssetManager::get_texture_stats() const {
+	return this->residency.get_stats();
+}
+
+size_t AssetManager::get_atlas_page_count() {
+	return this->atlas.get_page_count();
+}
+
 std::shared_ptr<Texture> AssetManager::get_missing_tex() {
 
 	// if not loaded, fetch the "missing" texture (big red X).
 	if (unlikely(this->missing_tex.get() == nullptr)) {
-		this->missing_tex = std::make_shared<Texture>(root.join("missing.png"), false);
+		this->missing_tex = std::make_shared<Texture>(root.join("missing.png"), false, not this->headless);
+
+		// it's drawn in place of evicted textures until they are reloaded
+		this->residency.set_placeholder(this->missing_tex.get());
 	}
 
 	return this->missing_tex;
 }
 
 void AssetManager::clear() {
+	// the textures may be drawn by a submitted frame
+	if (this->engine != nullptr) {
+		this->engine->finish_rendering();
+	}
+
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+
 #if WITH_INOTIFY
 	for (auto& watch_fd : this->watch_fds) {
 		int result = inotify_rm_watch(this->inotify_fd, watch_fd.first);
@@ -165,9 +465,19 @@ void AssetManager::clear() {
 		}
 	}
 	this->watch_fds.clear();
+	this->watched_dirs.clear();
+	this->pending_reloads.clear();
 #endif
 
+	{
+		// reloads which are still running are dropped
+		std::lock_guard<std::mutex> lock{this->reloads->mutex};
+		this->reloads->latest.clear();
+	}
+
 	this->textures.clear();
+	this->residency.set_placeholder(nullptr);
+	this->missing_tex = nullptr;
 }
 
 }
@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -7,7 +7,12 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <mutex>
 
+#include "util/timing.h"
+
+#include "texture_atlas.h"
+#include "texture_residency.h"
 #include "util/dir.h"
 
 namespace qtsdl {
@@ -19,6 +24,10 @@ namespace openage {
 class Engine;
 class Texture;
 
+namespace job {
+class JobManager;
+} // job
+
 /**
  * Container class for all available assets.
  * Responsible for loading, providing and updating requested files.
@@ -27,6 +36,11 @@ class AssetManager final {
 public:
 	explicit AssetManager(qtsdl::GuiItemLink *gui_link);
 
+	/**
+	 * Waits until no submitted frame draws the textures anymore.
+	 */
+	~AssetManager();
+
 	util::Dir *get_data_dir();
 
 	std::string get_data_dir_string() const;
@@ -43,8 +57,30 @@ public:
 	 */
 	Engine *get_engine() const;
 
+	/**
+	 * Load no pixels and play no sounds, for simulating without
+	 * window. Textures only get their subtextures then.
+	 * Set before the first texture is loaded.
+	 */
+	void set_headless(bool headless);
+
+	bool is_headless() const;
+
+	/**
+	 * The job manager of the game simulation: the engine's,
+	 * or the one set for running without engine.
+	 */
+	job::JobManager *get_job_manager() const;
+
+	/**
+	 * Set the job manager used without engine.
+	 */
+	void set_job_manager(job::JobManager *job_manager);
+
 	/**
 	 * Test whether a requested asset filename can be loaded.
+	 * Converted files are looked up in the converter's manifest,
+	 * other files are checked on the disk.
 	 *
 	 * @param name: asset filename.
 	 * @returns this filename can be loaded.
@@ -53,6 +89,8 @@ public:
 
 	/**
 	 * Query the Texture for a given filename.
+	 * May be called from several threads at once,
+	 * the texture's pixels are read without holding the lock.
 	 *
 	 * @param name: the asset file name relative to the asset root.
 	 * @returns the queried texture handle.
@@ -60,39 +98,162 @@ public:
 	Texture *get_texture(const std::string &name, bool use_metafile=true);
 
 	/**
-	 * Ask the kernel whether there were updates to watched files.
+	 * Ask the kernel whether there were updates to watched files,
+	 * and reload the changed textures right away.
 	 */
 	void check_updates();
 
+	/**
+	 * Called after each drawn frame,
+	 * evicts textures if they exceed the memory budget and
+	 * reloads the textures whose files were changed.
+	 */
+	void next_frame();
+
+	/**
+	 * Time without further writes after which a changed
+	 * texture file is reloaded, so a file that is written
+	 * several times in a row is only read once.
+	 */
+	static constexpr time_nsec_t reload_delay = 200 * 1000 * 1000;
+
+	/**
+	 * Set the gpu memory budget for textures in bytes.
+	 */
+	void set_texture_budget(size_t bytes);
+
+	/**
+	 * Set the bytes of texture pixels uploaded per frame.
+	 */
+	void set_texture_upload_budget(size_t bytes);
+
+	/**
+	 * Counters of the texture memory usage.
+	 */
+	const texture_residency_stats &get_texture_stats() const;
+
+	/**
+	 * Number of atlas pages the small textures were packed into.
+	 */
+	size_t get_atlas_page_count();
+
 protected:
 	/**
 	 * Create an internal texture handle.
+	 * Call with the textures_mutex unlocked.
 	 */
 	std::shared_ptr<Texture> load_texture(const std::string &name, bool use_metafile=true);
 
 	/**
 	 * Retrieves the texture for missing textures.
+	 * Call with the textures_mutex locked.
 	 */
 	std::shared_ptr<Texture> get_missing_tex();
 
 private:
 	void clear();
 
+	/**
+	 * Map the asset pack of the converted files, if the converter
+	 * wrote one. Its files are read instead of the loose ones.
+	 */
+	void load_asset_pack();
+
+	/**
+	 * Read the manifest of the converted assets, which lists
+	 * the converted files and their sizes.
+	 * Without a valid one, can_load checks each file on the disk.
+	 */
+	void load_manifest();
+
+	/**
+	 * Read the inotify events and note the changed textures.
+	 * Those whose file wasn't written for the reload_delay,
+	 * or all of them with force, are reloaded.
+	 */
+	void poll_updates(bool force);
+
+	/**
+	 * Read the pixels of a changed texture on a job,
+	 * they are uploaded where the frame is drawn.
+	 * Call with the textures_mutex locked.
+	 */
+	void start_reload(const std::string &filename, std::shared_ptr<Texture> texture);
+
+	/**
+	 * The reload which is latest for each changed file,
+	 * older ones which finish later are dropped.
+	 * Shared with the reload jobs.
+	 */
+	struct reload_state {
+		std::mutex mutex;
+		std::unordered_map<std::string, uint64_t> latest;
+		uint64_t next_id = 0;
+	};
+
 	/**
 	 * The engine this asset manager is attached to.
 	 */
 	Engine *engine;
 
+	/**
+	 * Runs the reads of changed textures, nullptr reads them
+	 * where the frame is drawn.
+	 */
+	job::JobManager *reload_jobs;
+
+	/**
+	 * The job manager of the game when there's no engine.
+	 */
+	job::JobManager *job_manager;
+
+	/**
+	 * Textures are created without pixels.
+	 */
+	bool headless;
+
+	std::shared_ptr<reload_state> reloads;
+
 	/**
 	 * The root directory for the available assets.
 	 */
 	util::Dir root;
 
+	/**
+	 * The directory the asset pack is mounted at, empty without one.
+	 */
+	std::string pack_dir;
+
+	/**
+	 * The converted files listed in the manifest, relative to the
+	 * asset root, and their sizes.
+	 */
+	std::unordered_map<std::string, size_t> manifest;
+
 	/**
 	 * The replacement texture for missing textures.
 	 */
 	std::shared_ptr<Texture> missing_tex;
 
+	/**
+	 * Tracks the gpu memory used by the textures.
+	 * Declared before them, as they unregister when destroyed.
+	 */
+	TextureResidency residency;
+
+	/**
+	 * Shared pages of the small textures, like icons and cursors.
+	 * Declared before the textures, which are drawn from its pages.
+	 */
+	TextureAtlas atlas;
+
+	/**
+	 * Guards the texture map, the missing texture, the inotify watches
+	 * and the pending reloads,
+	 * as the game specification loads textures on several threads.
+	 */
+	std::mutex textures_mutex;
+
 	/**
 	 * Map from texture filename to texture instance ptr.
 	 */
@@ -105,10 +266,22 @@ private:
 	int inotify_fd;
 
 	/**
-	 * Map from inotify watch handle fd to texture instance ptr.
-	 * The kernel returns the handle fd when events are triggered.
+	 * Map from inotify watch handle fd to the watched directory.
+	 * The directories of the textures are watched, the kernel
+	 * returns the handle fd and the file name when events are triggered.
+	 */
+	std::unordered_map<int, std::string> watch_fds;
+
+	/**
+	 * Map from watched directory to its inotify watch handle fd.
+	 */
+	std::unordered_map<std::string, int> watched_dirs;
+
+	/**
+	 * Changed texture files which weren't reloaded yet,
+	 * and the time of their last change.
 	 */
-	std::unordered_map<int, std::shared_ptr<Texture>> watch_fds;
+	std::unordered_map<std::string, time_nsec_t> pending_reloads;
 #endif
 
 public:
@@ -1,16 +1,24 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "audio_manager.h"
 
+#include <algorithm>
 #include <cstring>
 #include <SDL2/SDL.h>
 #include <sstream>
 
+#include "../job/job_manager.h"
 #include "../log/log.h"
 #include "../util/dir.h"
+#include "../util/metrics.h"
+#include "../util/timing.h"
+#include "../util/trace.h"
 #include "../error/error.h"
 
 #include "hash_functions.h"
+#include "in_memory_resource.h"
+#include "mix.h"
+#include "resampler.h"
 #include "resource.h"
 
 namespace openage {
@@ -21,6 +29,24 @@ namespace audio {
  */
 void global_audio_callback(void *userdata, uint8_t *stream, int len);
 
+/**
+ * The same sound started within this time is merged into the voice
+ * which is already playing it.
+ */
+constexpr time_nsec_t coalesce_time = 30 * 1000 * 1000;
+
+/**
+ * A merged sound raises the volume of the voice at most to this
+ * multiple of its own volume.
+ */
+constexpr int32_t max_coalesced_volume = 2;
+
+/**
+ * Default size of the loaded in memory resources, in bytes.
+ * About 6 minutes of 48 kHz stereo pcm data.
+ */
+constexpr size_t default_pcm_budget = 64 * 1024 * 1024;
+
 AudioManager::AudioManager(job::JobManager *job_manager)
 	:
 	AudioManager{job_manager, ""} {}
@@ -28,7 +54,9 @@ AudioManager::AudioManager(job::JobManager *job_manager)
 AudioManager::AudioManager(job::JobManager *job_manager, const std::string &device_name)
 	:
 	job_manager{job_manager},
-	device_name{device_name} {
+	device_name{device_name},
+	loaded_pcm_size{0},
+	pcm_budget{default_pcm_budget} {
 
 	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
 		throw Error(MSG(err) << "SDL audio initialization failed: " << SDL_GetError());
@@ -39,7 +67,7 @@ AudioManager::AudioManager(job::JobManager *job_manager, const std::string &devi
 	//set desired audio output format
 	SDL_AudioSpec desired_spec;
 	SDL_zero(desired_spec);
-	desired_spec.freq = 48000;
+	desired_spec.freq = opus_sample_rate;
 	desired_spec.format = AUDIO_S16LSB;
 	desired_spec.channels = 2;
 	desired_spec.samples = 4096;
@@ -51,9 +79,21 @@ AudioManager::AudioManager(job::JobManager *job_manager, const std::string &devi
 	// default device should be used
 	const char *c_device_name = device_name.empty() ?
 			nullptr : device_name.c_str();
-	// open audio playback device
+	// open audio playback device at its own rate. the decoded sounds are
+	// resampled to it once, instead of SDL converting the mixed stream
+	// in each callback
 	device_id = SDL_OpenAudioDevice(c_device_name, 0, &desired_spec,
-			&device_spec, 0);
+			&device_spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+
+	// rates without a resampler are converted by SDL after all
+	if (device_id != 0 and
+	    not Resampler::is_supported(opus_sample_rate, device_spec.freq)) {
+		log::log(MSG(warn) << "Can't resample to " << device_spec.freq << " Hz, "
+		         "the audio device converts the samples");
+		SDL_CloseAudioDevice(device_id);
+		device_id = SDL_OpenAudioDevice(c_device_name, 0, &desired_spec,
+				&device_spec, 0);
+	}
 
 	// no device could be opened
 	if (device_id == 0) {
@@ -67,6 +107,17 @@ AudioManager::AudioManager(job::JobManager *job_manager, const std::string &devi
 	playing_sounds.insert({category_t::MUSIC, sound_vector{}});
 	playing_sounds.insert({category_t::TAUNT, sound_vector{}});
 
+	for (auto &entry : playing_sounds) {
+		category_gains.insert({entry.first, 256});
+	}
+
+	// the game may start many sounds in a battle,
+	// the music is never mixed with itself
+	max_voices.insert({category_t::GAME, 32});
+	max_voices.insert({category_t::INTERFACE, 8});
+	max_voices.insert({category_t::MUSIC, 1});
+	max_voices.insert({category_t::TAUNT, 4});
+
 	mix_buffer.reset(new int32_t[4 * device_spec.samples *
 			device_spec.channels]);
 
@@ -75,7 +126,8 @@ AudioManager::AudioManager(job::JobManager *job_manager, const std::string &devi
 		"freq=" << device_spec.freq << ", "
 		"format=" << device_spec.format << ", "
 		"channels=" << device_spec.channels << ", "
-		"samples=" << device_spec.samples <<
+		"samples=" << device_spec.samples << ", "
+		"resampler=" << resampler_kernel_name() <<
 		"]");
 
 	SDL_PauseAudioDevice(device_id, 0);
@@ -83,10 +135,25 @@ AudioManager::AudioManager(job::JobManager *job_manager, const std::string &devi
 
 AudioManager::~AudioManager() {
 	SDL_CloseAudioDevice(device_id);
+
+	auto decoded = decode_thread.get_stats();
+	if (decoded.decoded > 0) {
+		log::log(MSG(dbg) <<
+			"Audio decoding: " << decoded.decoded << " chunks, " <<
+			decoded.late << " late, " <<
+			"latency avg=" << decoded.total_latency / decoded.decoded / 1000 << "us " <<
+			"max=" << decoded.max_latency / 1000 << "us, " <<
+			"min slack=" << decoded.min_slack / 1000 << "us, " <<
+			chunk_buffer_pool.get_allocated() << " buffers allocated, " <<
+			chunk_buffer_pool.get_reused() << " reused");
+	}
 }
 
 void AudioManager::load_resources(const util::Dir &asset_dir,
                                   const std::vector<gamedata::sound_file> &sound_files) {
+	TRACE_SCOPE("load audio");
+	pcm_cache_dir = asset_dir.join("pcm_cache");
+
 	for (auto &sound_file : sound_files) {
 		auto category = from_category(sound_file.category);
 		auto id = sound_file.sound_id;
@@ -99,7 +166,13 @@ void AudioManager::load_resources(const util::Dir &asset_dir,
 		auto resource = Resource::create_resource(this, category, id, path, format, loader_policy);
 
 		// TODO check resource already existing
-		resources.insert({key, resource});
+		bool added = resources.insert({key, resource}).second;
+
+		if (added and loader_policy == loader_policy_t::IN_MEMORY) {
+			in_memory_resources[category].push_back(
+				std::static_pointer_cast<InMemoryResource>(resource)
+			);
+		}
 	}
 }
 
@@ -116,6 +189,96 @@ Sound AudioManager::get_sound(category_t category, int id) {
 	return Sound{this, sound_impl};
 }
 
+void AudioManager::prefetch(category_t category) {
+	auto found = in_memory_resources.find(category);
+	if (found == std::end(in_memory_resources)) {
+		return;
+	}
+
+	// the job keeps its resources alive
+	auto category_resources = found->second;
+
+	job_manager->enqueue<bool>([this, category, category_resources]() {
+		size_t loaded = 0;
+		for (auto &resource : category_resources) {
+			{
+				std::lock_guard<std::mutex> lock{pcm_mutex};
+				if (loaded_pcm_size >= pcm_budget) {
+					break;
+				}
+			}
+
+			try {
+				resource->load();
+				loaded += 1;
+			}
+			catch (Error &e) {
+				log::log(MSG(warn) << "Could not load sound: " << e);
+			}
+		}
+
+		log::log(MSG(dbg) << "Prefetched " << loaded << " of "
+		         << category_resources.size() << " sounds of category " << category);
+		return true;
+	});
+}
+
+void AudioManager::set_pcm_budget(size_t bytes) {
+	std::lock_guard<std::mutex> lock{pcm_mutex};
+	pcm_budget = bytes;
+	trim_pcm(nullptr);
+}
+
+size_t AudioManager::get_pcm_budget() const {
+	std::lock_guard<std::mutex> lock{pcm_mutex};
+	return pcm_budget;
+}
+
+size_t AudioManager::get_loaded_pcm_size() const {
+	std::lock_guard<std::mutex> lock{pcm_mutex};
+	return loaded_pcm_size;
+}
+
+void AudioManager::pcm_loaded(InMemoryResource *resource) {
+	std::lock_guard<std::mutex> lock{pcm_mutex};
+
+	loaded_pcm.push_front(resource);
+	loaded_pcm_entries[resource] = loaded_pcm.begin();
+	loaded_pcm_size += resource->get_pcm_size();
+
+	trim_pcm(resource);
+}
+
+void AudioManager::pcm_used(InMemoryResource *resource) {
+	std::lock_guard<std::mutex> lock{pcm_mutex};
+
+	auto entry = loaded_pcm_entries.find(resource);
+	if (entry != std::end(loaded_pcm_entries)) {
+		loaded_pcm.splice(loaded_pcm.begin(), loaded_pcm, entry->second);
+	}
+}
+
+void AudioManager::trim_pcm(const InMemoryResource *keep) {
+	// the resources played least recently are at the end
+	auto it = loaded_pcm.end();
+	while (loaded_pcm_size > pcm_budget and it != loaded_pcm.begin()) {
+		--it;
+		InMemoryResource *resource = *it;
+
+		if (resource == keep or resource->is_used()) {
+			continue;
+		}
+
+		// the size is gone after unloading
+		size_t size = resource->get_pcm_size();
+		if (resource->unload()) {
+			loaded_pcm_size -= size;
+			loaded_pcm_entries.erase(resource);
+			it = loaded_pcm.erase(it);
+		}
+	}
+}
+
 void remove_from_vector(std::vector<std::shared_ptr<SoundImpl>> &v, size_t i) {
 	// current sound is the last in the list, so just remove it
 	if (i == v.size()-1) {
@@ -129,15 +292,21 @@ void remove_from_vector(std::vector<std::shared_ptr<SoundImpl>> &v, size_t i) {
 }
 
 void AudioManager::audio_callback(int16_t *stream, int length) {
+	static util::MetricGauge &voices = util::metrics().gauge("audio.voices");
+	static util::MetricCounter &mixed_samples = util::metrics().counter("audio.mixed_samples");
+
 	std::memset(mix_buffer.get(), 0, length*4);
 
+	int64_t playing = 0;
+
 	// iterate over all categories
 	for (auto &entry : playing_sounds) {
 		auto &playing_list = entry.second;
+		auto gain = category_gains.find(entry.first)->second;
 		// iterate over all sounds in one category
 		for (size_t i = 0; i < playing_list.size(); i++) {
 			auto &sound = playing_list[i];
-			auto sound_finished = sound->mix_audio(mix_buffer.get(), length);
+			auto sound_finished = sound->mix_audio(mix_buffer.get(), length, gain);
 			// if the sound is finished, it should be removed from the playing
 			// list
 			if (sound_finished) {
@@ -145,29 +314,116 @@ void AudioManager::audio_callback(int16_t *stream, int length) {
 				i--;
 			}
 		}
+		playing += playing_list.size();
 	}
 
+	voices.set(playing);
+	mixed_samples.add(length);
+
 	// write the mix buffer to the output stream and adjust volume
-	for (int i = 0; i < length; i++) {
-		auto value = mix_buffer[i]/256;
-		if (value > 32767) {
-			value = 32767;
-		} else if (value < -32768) {
-			value = -32768;
+	saturate_samples(stream, mix_buffer.get(), length);
+}
+
+void AudioManager::set_category_gain(category_t category, int32_t gain) {
+	SDL_LockAudioDevice(device_id);
+	category_gains[category] = gain;
+	SDL_UnlockAudioDevice(device_id);
+}
+
+int32_t AudioManager::get_category_gain(category_t category) const {
+	auto it = category_gains.find(category);
+	if (it == category_gains.end()) {
+		throw Error{MSG(err) << "Unknown audio category: " << category};
+	}
+	return it->second;
+}
+
+void AudioManager::set_max_voices(category_t category, size_t voices) {
+	if (voices == 0) {
+		throw Error{MSG(err) << "Audio category " << category << " needs at least one voice"};
+	}
+
+	SDL_LockAudioDevice(device_id);
+	max_voices[category] = voices;
+
+	// stop the sounds started last, until the category fits
+	auto &playing_list = playing_sounds.find(category)->second;
+	while (playing_list.size() > voices) {
+		size_t newest = 0;
+		for (size_t i = 1; i < playing_list.size(); i++) {
+			if (playing_list[i]->start_time > playing_list[newest]->start_time) {
+				newest = i;
+			}
 		}
-		stream[i] = static_cast<int16_t>(value);
+		playing_list[newest]->playing = false;
+		remove_from_vector(playing_list, newest);
 	}
+
+	SDL_UnlockAudioDevice(device_id);
+}
+
+size_t AudioManager::get_max_voices(category_t category) const {
+	auto it = max_voices.find(category);
+	if (it == max_voices.end()) {
+		throw Error{MSG(err) << "Unknown audio category: " << category};
+	}
+	return it->second;
 }
 
-void AudioManager::add_sound(std::shared_ptr<SoundImpl> sound) {
+bool AudioManager::add_sound(std::shared_ptr<SoundImpl> sound) {
+	auto now = timing::get_monotonic_time();
+
 	SDL_LockAudioDevice(device_id);
 
 	auto category = sound->get_category();
 	auto &playing_list = playing_sounds.find(category)->second;
-	// TODO probably check if sound already exists in playing list
-	playing_list.push_back(sound);
+	bool added = true;
+
+	// merge it into the same sound if that just started playing
+	for (auto &playing : playing_list) {
+		if (playing != sound and
+		    not sound->looping and not playing->looping and
+		    playing->get_id() == sound->get_id() and
+		    now - playing->start_time < coalesce_time) {
+
+			playing->boost = std::min(playing->boost + sound->volume,
+			                          (max_coalesced_volume - 1) * playing->volume);
+			added = false;
+			break;
+		}
+	}
+
+	// steal the voice of the least important sound, the one which
+	// played longest of those
+	if (added and playing_list.size() >= max_voices.find(category)->second) {
+		size_t victim = 0;
+		for (size_t i = 1; i < playing_list.size(); i++) {
+			auto &candidate = playing_list[i];
+			auto &current = playing_list[victim];
+			if (candidate->priority < current->priority or
+			    (candidate->priority == current->priority and
+			     candidate->start_time < current->start_time)) {
+				victim = i;
+			}
+		}
+
+		if (playing_list[victim]->priority <= sound->priority) {
+			playing_list[victim]->playing = false;
+			remove_from_vector(playing_list, victim);
+		} else {
+			added = false;
+		}
+	}
+
+	if (added) {
+		sound->boost = 0;
+		sound->start_time = now;
+		// TODO probably check if sound already exists in playing list
+		playing_list.push_back(sound);
+	}
 
 	SDL_UnlockAudioDevice(device_id);
+	return added;
 }
 
 void AudioManager::remove_sound(std::shared_ptr<SoundImpl> sound) {
@@ -194,6 +450,18 @@ job::JobManager *AudioManager::get_job_manager() const {
 	return this->job_manager;
 }
 
+const std::string &AudioManager::get_pcm_cache_dir() const {
+	return this->pcm_cache_dir;
+}
+
+ChunkBufferPool *AudioManager::get_chunk_buffer_pool() {
+	return &this->chunk_buffer_pool;
+}
+
+DecodeThread *AudioManager::get_decode_thread() {
+	return &this->decode_thread;
+}
+
 std::vector<std::string> AudioManager::get_devices() {
 	std::vector<std::string> device_list;
 	auto num_devices = SDL_GetNumAudioDevices(0);
@@ -1,8 +1,10 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -10,6 +12,8 @@
 #include <SDL2/SDL.h>
 
 #include "category.h"
+#include "chunk_buffer_pool.h"
+#include "decode_thread.h"
 #include "hash_functions.h"
 #include "sound.h"
 #include "../util/dir.h"
@@ -27,6 +31,8 @@ class JobManager;
 
 namespace audio {
 
+class InMemoryResource;
+
 /**
  * This class provides audio functionality for openage.
  */
@@ -49,7 +55,11 @@ public:
 	AudioManager &operator=(AudioManager&&) = delete;
 
 	/**
-	 * Loads all audio resources, that are specified in the sound_files vector.
+	 * Registers all audio resources, that are specified in the sound_files
+	 * vector. Nothing is decoded yet, the in memory resources are loaded
+	 * when their sounds are first played, or when their category is
+	 * prefetched. The decoded in memory resources are cached in the
+	 * pcm_cache directory of the assets.
 	 * @param sound_files a list of all sound resources
 	 */
 	void load_resources(const util::Dir &asset_dir, const std::vector<gamedata::sound_file> &sound_files);
@@ -62,8 +72,61 @@ public:
 	 */
 	Sound get_sound(category_t category, int id);
 
+	/**
+	 * Loads the in memory resources of a category in the background,
+	 * e.g. the game sounds when a match starts. Loading stops when the
+	 * category would take the whole pcm budget.
+	 * @param category the category to load
+	 */
+	void prefetch(category_t category);
+
+	/**
+	 * Sets the size of the loaded in memory resources' pcm data, which
+	 * is kept at most. The least recently used resources which no sound
+	 * uses are unloaded when it is exceeded.
+	 * @param bytes the budget in bytes
+	 */
+	void set_pcm_budget(size_t bytes);
+
+	/**
+	 * Returns the budget of loaded pcm data in bytes.
+	 */
+	size_t get_pcm_budget() const;
+
+	/**
+	 * Returns the size of the currently loaded pcm data in bytes.
+	 */
+	size_t get_loaded_pcm_size() const;
+
 	void audio_callback(int16_t *stream, int length);
 
+	/**
+	 * Sets the volume of all sounds of a category. Like the sound volume,
+	 * 256 keeps the volume and 0 silences the category.
+	 * @param category the category to change
+	 * @param gain the new volume of the category
+	 */
+	void set_category_gain(category_t category, int32_t gain);
+
+	/**
+	 * Returns the volume of a category.
+	 */
+	int32_t get_category_gain(category_t category) const;
+
+	/**
+	 * Sets how many sounds of a category are mixed at most. Sounds started
+	 * when all voices are used replace the least important playing one,
+	 * or are dropped.
+	 * @param category the category to change
+	 * @param max_voices the number of voices, at least 1
+	 */
+	void set_max_voices(category_t category, size_t max_voices);
+
+	/**
+	 * Returns the number of voices of a category.
+	 */
+	size_t get_max_voices(category_t category) const;
+
 	/**
 	 * Returns the currently used audio output format.
 	 */
@@ -74,14 +137,54 @@ public:
 	 */
 	job::JobManager *get_job_manager() const;
 
+	/**
+	 * Returns the directory of the decoded in memory resources,
+	 * empty if they are not cached.
+	 */
+	const std::string &get_pcm_cache_dir() const;
+
+	/**
+	 * Returns the pool of the streamed resources' chunk buffers.
+	 */
+	ChunkBufferPool *get_chunk_buffer_pool();
+
+	/**
+	 * Returns the thread decoding the streamed resources.
+	 */
+	DecodeThread *get_decode_thread();
+
 private:
-	void add_sound(std::shared_ptr<SoundImpl> sound);
+	/**
+	 * Gives a voice to the sound.
+	 * @returns false if the sound was dropped or merged into another one
+	 */
+	bool add_sound(std::shared_ptr<SoundImpl> sound);
 	void remove_sound(std::shared_ptr<SoundImpl> sound);
 
+	/**
+	 * Adds a freshly loaded resource to the loaded ones and unloads
+	 * the least recently used others if the budget is exceeded.
+	 */
+	void pcm_loaded(InMemoryResource *resource);
+
+	/**
+	 * Marks a loaded resource as the most recently used one.
+	 */
+	void pcm_used(InMemoryResource *resource);
+
+	/**
+	 * Unloads the least recently used resources until the loaded
+	 * pcm data fits into the budget. pcm_mutex has to be held.
+	 */
+	void trim_pcm(const InMemoryResource *keep);
+
 	// Sound is the AudioManager's friend, so that only sounds can access the
 	// add and remove sound method's
 	friend class Sound;
 
+	// the in memory resources report when they are loaded and used
+	friend class InMemoryResource;
+
 	/**
 	 * The job manager used in this audio manager for job queuing.
 	 */
@@ -104,10 +207,67 @@ private:
 
 	std::unique_ptr<int32_t[]> mix_buffer;
 
+	/**
+	 * directory of the pcm cache files
+	 */
+	std::string pcm_cache_dir;
+
+	/**
+	 * buffers of the streamed resources, must outlive them
+	 */
+	ChunkBufferPool chunk_buffer_pool;
+
 	std::unordered_map<std::tuple<category_t,int>,std::shared_ptr<Resource>> resources;
 
+	/**
+	 * the in memory resources, which may be loaded on demand
+	 */
+	std::unordered_map<category_t,std::vector<std::shared_ptr<InMemoryResource>>> in_memory_resources;
+
+	/**
+	 * guards the loaded resources and their size,
+	 * resources are loaded by the io jobs
+	 */
+	mutable std::mutex pcm_mutex;
+
+	/**
+	 * the loaded in memory resources, the most recently used first
+	 */
+	std::list<InMemoryResource *> loaded_pcm;
+
+	/**
+	 * position of each loaded resource in loaded_pcm
+	 */
+	std::unordered_map<const InMemoryResource *,std::list<InMemoryResource *>::iterator> loaded_pcm_entries;
+
+	/**
+	 * size of the loaded resources' pcm data in bytes
+	 */
+	size_t loaded_pcm_size;
+
+	/**
+	 * loaded pcm data kept at most, in bytes
+	 */
+	size_t pcm_budget;
+
+	/**
+	 * decodes the streamed resources, its jobs use them
+	 * so it's stopped before they are destroyed
+	 */
+	DecodeThread decode_thread;
+
 	std::unordered_map<category_t,std::vector<std::shared_ptr<SoundImpl>>> playing_sounds;
 
+	/**
+	 * volume of each category, applied while mixing its sounds
+	 */
+	std::unordered_map<category_t,int32_t> category_gains;
+
+	/**
+	 * number of sounds mixed at most for each category
+	 */
+	std::unordered_map<category_t,size_t> max_voices;
+
 // static functions
 public:
 	/**
@@ -0,0 +1,54 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "chunk_buffer_pool.h"
+
+namespace openage {
+namespace audio {
+
+
+ChunkBufferPool::ChunkBufferPool()
+	:
+	allocated{0},
+	reused{0} {}
+
+
+std::unique_ptr<int16_t[]> ChunkBufferPool::acquire(size_t size) {
+	{
+		std::lock_guard<std::mutex> lock{this->mutex};
+		auto it = this->free_buffers.find(size);
+		if (it != std::end(this->free_buffers) and not it->second.empty()) {
+			auto buffer = std::move(it->second.back());
+			it->second.pop_back();
+			this->reused += 1;
+			return buffer;
+		}
+		this->allocated += 1;
+	}
+
+	return std::make_unique<int16_t[]>(size);
+}
+
+
+void ChunkBufferPool::release(std::unique_ptr<int16_t[]> buffer, size_t size) {
+	if (not buffer) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{this->mutex};
+	this->free_buffers[size].push_back(std::move(buffer));
+}
+
+
+size_t ChunkBufferPool::get_allocated() const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+	return this->allocated;
+}
+
+
+size_t ChunkBufferPool::get_reused() const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+	return this->reused;
+}
+
+
+}} // namespace openage::audio
@@ -0,0 +1,56 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace openage {
+namespace audio {
+
+/**
+ * Keeps the pcm buffers of streamed resources, so the chunks of a resource
+ * which is used again are not allocated again.
+ */
+class ChunkBufferPool {
+public:
+	ChunkBufferPool();
+	~ChunkBufferPool() = default;
+
+	ChunkBufferPool(const ChunkBufferPool&) = delete;
+	ChunkBufferPool &operator=(const ChunkBufferPool&) = delete;
+
+	/**
+	 * Returns a buffer of the given number of int16_t values, a released
+	 * one if there is one of that size.
+	 */
+	std::unique_ptr<int16_t[]> acquire(size_t size);
+
+	/**
+	 * Gives back a buffer returned by acquire.
+	 * @param buffer the buffer, may be empty
+	 * @param size the size the buffer was acquired with
+	 */
+	void release(std::unique_ptr<int16_t[]> buffer, size_t size);
+
+	/** Returns the number of buffers that were allocated. */
+	size_t get_allocated() const;
+
+	/** Returns the number of buffers that were reused. */
+	size_t get_reused() const;
+
+private:
+	mutable std::mutex mutex;
+
+	/** The released buffers, by their size. */
+	std::unordered_map<size_t,std::vector<std::unique_ptr<int16_t[]>>> free_buffers;
+
+	size_t allocated;
+	size_t reused;
+};
+
+}} // namespace openage::audio
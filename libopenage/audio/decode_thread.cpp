@@ -0,0 +1,102 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "decode_thread.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "../error/error.h"
+#include "../log/log.h"
+
+namespace openage {
+namespace audio {
+
+
+bool DecodeThread::decode_job::operator >(const decode_job &other) const {
+	if (this->deadline != other.deadline) {
+		return this->deadline > other.deadline;
+	}
+	return this->sequence > other.sequence;
+}
+
+
+DecodeThread::DecodeThread()
+	:
+	next_sequence{0},
+	running{true},
+	counters{0, 0, 0, 0, std::numeric_limits<int64_t>::max()} {
+
+	this->thread = std::thread{&DecodeThread::process, this};
+}
+
+
+DecodeThread::~DecodeThread() {
+	{
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->running = false;
+	}
+	this->job_available.notify_all();
+	this->thread.join();
+}
+
+
+void DecodeThread::enqueue(time_nsec_t deadline, std::function<void()> function) {
+	{
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->jobs.push({
+			deadline,
+			timing::get_monotonic_time(),
+			this->next_sequence++,
+			std::move(function)
+		});
+	}
+	this->job_available.notify_one();
+}
+
+
+DecodeThread::stats DecodeThread::get_stats() const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+	return this->counters;
+}
+
+
+void DecodeThread::process() {
+	std::unique_lock<std::mutex> lock{this->mutex};
+
+	while (true) {
+		this->job_available.wait(lock, [this] {
+			return not this->jobs.empty() or not this->running;
+		});
+
+		if (not this->running) {
+			break;
+		}
+
+		decode_job job = this->jobs.top();
+		this->jobs.pop();
+
+		lock.unlock();
+		try {
+			job.function();
+		}
+		catch (Error &exc) {
+			log::log(MSG(err) << "Audio decoding failed: " << exc);
+		}
+		time_nsec_t finished = timing::get_monotonic_time();
+		lock.lock();
+
+		time_nsec_t latency = finished - job.enqueued;
+		int64_t slack = static_cast<int64_t>(job.deadline) - static_cast<int64_t>(finished);
+
+		this->counters.decoded += 1;
+		this->counters.total_latency += latency;
+		this->counters.max_latency = std::max(this->counters.max_latency, latency);
+		this->counters.min_slack = std::min(this->counters.min_slack, slack);
+		if (slack < 0) {
+			this->counters.late += 1;
+		}
+	}
+}
+
+
+}} // namespace openage::audio
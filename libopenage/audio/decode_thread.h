@@ -0,0 +1,100 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "../util/timing.h"
+
+namespace openage {
+namespace audio {
+
+/**
+ * Decodes the chunks of streamed resources on its own thread.
+ *
+ * Streamed music must not wait for texture loads in the job manager,
+ * so the decode jobs are run here in the order of their deadlines:
+ * the chunk that is played first is decoded first.
+ */
+class DecodeThread {
+public:
+	/**
+	 * Decode latencies compared to the playback deadlines.
+	 */
+	struct stats {
+		/** The number of executed decode jobs. */
+		size_t decoded;
+
+		/** Jobs that finished after their deadline. */
+		size_t late;
+
+		/** The sum of the times from enqueueing to finishing the jobs. */
+		time_nsec_t total_latency;
+
+		/** The longest time from enqueueing to finishing a job. */
+		time_nsec_t max_latency;
+
+		/** The least time left before the deadline of a finished job. */
+		int64_t min_slack;
+	};
+
+	DecodeThread();
+
+	/**
+	 * Stops the thread, the jobs that were not started are dropped.
+	 */
+	~DecodeThread();
+
+	DecodeThread(const DecodeThread&) = delete;
+	DecodeThread &operator=(const DecodeThread&) = delete;
+
+	/**
+	 * Enqueues a decode job.
+	 * @param deadline the monotonic time when the decoded data is played
+	 * @param function the decoding function
+	 */
+	void enqueue(time_nsec_t deadline, std::function<void()> function);
+
+	/**
+	 * Returns the latency statistics of the executed jobs.
+	 */
+	stats get_stats() const;
+
+private:
+	struct decode_job {
+		time_nsec_t deadline;
+		time_nsec_t enqueued;
+
+		/** Keeps jobs with the same deadline in order. */
+		size_t sequence;
+
+		std::function<void()> function;
+
+		bool operator >(const decode_job &other) const;
+	};
+
+	/** Executes the jobs until the thread is stopped. */
+	void process();
+
+	mutable std::mutex mutex;
+	std::condition_variable job_available;
+
+	/** The pending jobs, the earliest deadline on top. */
+	std::priority_queue<decode_job,std::vector<decode_job>,std::greater<decode_job>> jobs;
+
+	size_t next_sequence;
+
+	bool running;
+
+	stats counters;
+
+	std::thread thread;
+};
+
+}} // namespace openage::audio
@@ -1,4 +1,4 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "dynamic_loader.h"
 
@@ -17,11 +17,12 @@ DynamicLoader::DynamicLoader(const std::string &path)
 
 
 std::unique_ptr<DynamicLoader> DynamicLoader::create(const std::string &path,
-                                                     format_t format) {
+                                                     format_t format,
+                                                     int sample_rate) {
 	std::unique_ptr<DynamicLoader> loader;
 	switch (format) {
 	case format_t::OPUS:
-		loader.reset(new OpusDynamicLoader{path});
+		loader.reset(new OpusDynamicLoader{path, sample_rate});
 		break;
 	default:
 		throw Error{MSG(err) <<
@@ -1,22 +1,29 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "dynamic_resource.h"
 
 
 #include "audio_manager.h"
-#include "../engine.h"
-#include "../job/job_manager.h"
+#include "decode_thread.h"
 #include "../log/log.h"
 
 namespace openage {
 namespace audio {
 
 chunk_info_t::chunk_info_t(chunk_info_t::state_t state,
-                           size_t buffer_size)
+                           size_t buffer_size,
+                           ChunkBufferPool *pool)
 	:
 	state{state},
 	actual_size{0},
-	buffer{std::make_unique<int16_t[]>(buffer_size)} {}
+	buffer{pool->acquire(buffer_size)},
+	buffer_size{buffer_size},
+	pool{pool} {}
+
+
+chunk_info_t::~chunk_info_t() {
+	this->pool->release(std::move(this->buffer), this->buffer_size);
+}
 
 
 DynamicResource::DynamicResource(AudioManager *manager,
@@ -34,7 +41,11 @@ DynamicResource::DynamicResource(AudioManager *manager,
 	preload_threshold{preload_threshold},
 	chunk_size{chunk_size},
 	max_chunks{max_chunks},
-	use_count{0} {}
+	use_count{0} {
+
+	auto spec = manager->get_device_spec();
+	this->values_per_second = static_cast<size_t>(spec.freq) * spec.channels;
+}
 
 void DynamicResource::use() {
 	log::log(DBG << "DYNRES: now in use");
@@ -43,18 +54,24 @@ void DynamicResource::use() {
 	// if the resource is new in use
 	if ((this->use_count++) == 0) {
 		// create loader
-		this->loader = DynamicLoader::create(this->path, this->format);
+		this->loader = DynamicLoader::create(this->path, this->format,
+		                                     this->manager->get_device_spec().freq);
 
 		// create chunk information
 		for (size_t i = 0; i < this->max_chunks; i++) {
 			this->chunk_infos.push(std::make_shared<chunk_info_t>(
 				chunk_info_t::state_t::UNUSED,
-				this->chunk_size)
+				this->chunk_size,
+				this->manager->get_chunk_buffer_pool())
 			);
 		}
 
-		// create loading job group
-		this->loading_job_group = this->manager->get_job_manager()->create_job_group();
+		// the sound will start at the beginning, so decode it right away
+		auto chunk_info = this->chunk_infos.front();
+		this->chunk_infos.pop();
+		this->chunk_mapping.insert({0, chunk_info});
+		this->start_loading(chunk_info, 0, 0);
+		this->start_preloading(0, 0);
 	}
 }
 
@@ -88,7 +105,7 @@ audio_chunk_t DynamicResource::get_data(size_t position, size_t data_length) {
 			// signal that resource is not ready yet
 			return {nullptr, 1};
 		case chunk_info_t::state_t::READY:
-			this->start_preloading(resource_chunk_index);
+			this->start_preloading(resource_chunk_index, position);
 			// calculate actual data length
 			if (chunk_info->actual_size - chunk_offset >= data_length) {
 				return {chunk, data_length};
@@ -108,14 +125,14 @@ audio_chunk_t DynamicResource::get_data(size_t position, size_t data_length) {
 	size_t resource_chunk_offset = resource_chunk_index * this->chunk_size;
 
 	// and start loading
-	this->start_loading(chunk_info, resource_chunk_offset);
-	this->start_preloading(resource_chunk_index);
+	this->start_loading(chunk_info, resource_chunk_offset, position);
+	this->start_preloading(resource_chunk_index, position);
 
 	return {nullptr, 1};
 }
 
 
-void DynamicResource::start_preloading(size_t resource_chunk_index) {
+void DynamicResource::start_preloading(size_t resource_chunk_index, size_t position) {
 	size_t resource_chunk_offset = resource_chunk_index * this->chunk_size;
 
 	for (int i = 1; i < this->preload_threshold; i++) {
@@ -137,17 +154,18 @@ void DynamicResource::start_preloading(size_t resource_chunk_index) {
 			this->chunk_infos.pop();
 
 			this->chunk_mapping.insert({resource_chunk_index, local_chunk_info});
-			this->start_loading(local_chunk_info, resource_chunk_offset);
+			this->start_loading(local_chunk_info, resource_chunk_offset, position);
 		}
 	}
 }
 
 
 void DynamicResource::start_loading(std::shared_ptr<chunk_info_t> chunk_info,
-                                    size_t resource_chunk_offset) {
+                                    size_t resource_chunk_offset,
+                                    size_t position) {
 	chunk_info->state.store(chunk_info_t::state_t::LOADING);
 
-	auto loading_function = [this,chunk_info,resource_chunk_offset]() -> int {
+	auto loading_function = [this,chunk_info,resource_chunk_offset]() {
 		int16_t *buffer = chunk_info->buffer.get();
 		size_t loaded = this->loader->load_chunk(buffer, resource_chunk_offset, this->chunk_size);
 		if (loaded == 0) {
@@ -158,11 +176,19 @@ void DynamicResource::start_loading(std::shared_ptr<chunk_info_t> chunk_info,
 			chunk_info->actual_size = loaded;
 			this->chunk_infos.push(chunk_info);
 		}
-		// as the job manager currently does not support executing void
-		// functions, we return zero
-		return 0;
 	};
-	this->loading_job_group.enqueue<int>(loading_function);
+
+	time_nsec_t deadline = this->get_deadline(resource_chunk_offset, position);
+	this->manager->get_decode_thread()->enqueue(deadline, loading_function);
+}
+
+
+time_nsec_t DynamicResource::get_deadline(size_t resource_offset, size_t position) const {
+	time_nsec_t now = timing::get_monotonic_time();
+	if (resource_offset <= position or this->values_per_second == 0) {
+		return now;
+	}
+	return now + (resource_offset - position) * 1000000000ull / this->values_per_second;
 }
 
 
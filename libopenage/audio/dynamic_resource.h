@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -9,13 +9,13 @@
 #include <vector>
 
 #include "category.h"
+#include "chunk_buffer_pool.h"
 #include "dynamic_loader.h"
 #include "format.h"
 #include "resource.h"
 #include "types.h"
 #include "../datastructure/concurrent_queue.h"
-#include "../job/job.h"
-#include "../job/job_group.h"
+#include "../util/timing.h"
 
 namespace openage {
 namespace audio {
@@ -44,8 +44,14 @@ struct chunk_info_t {
 	/** The chunk's buffer. */
 	std::unique_ptr<int16_t[]> buffer;
 
-	chunk_info_t(chunk_info_t::state_t state, size_t buffer_size);
-	~chunk_info_t() = default;
+	/** The number of int16_t values of the buffer. */
+	size_t buffer_size;
+
+	/** The pool the buffer is returned to. */
+	ChunkBufferPool *pool;
+
+	chunk_info_t(chunk_info_t::state_t state, size_t buffer_size, ChunkBufferPool *pool);
+	~chunk_info_t();
 };
 
 
@@ -84,15 +90,32 @@ public:
 	audio_chunk_t get_data(size_t position, size_t data_length) override;
 
 private:
-	void start_preloading(size_t resource_chunk_index);
+	/**
+	 * Starts loading the chunks following the given one, which are
+	 * not loaded yet.
+	 * @param resource_chunk_index the chunk that is played
+	 * @param position the current playing position
+	 */
+	void start_preloading(size_t resource_chunk_index, size_t position);
 
+	/**
+	 * Enqueues the decoding of a chunk at the decode thread.
+	 * @param position the current playing position, to see when the
+	 *        chunk is needed
+	 */
 	void start_loading(std::shared_ptr<chunk_info_t> chunk_info,
-	                   size_t resource_chunk_offset);
+	                   size_t resource_chunk_offset,
+	                   size_t position);
+
+	/**
+	 * Returns the time when the audio data at the offset is played.
+	 */
+	time_nsec_t get_deadline(size_t resource_offset, size_t position) const;
 
 public:
 	/**
-	 * The number of chunks that have to be loaded, before a sound actually
-	 * starts playing.
+	 * The number of chunks that are loaded ahead of the playing position.
+	 * They are requested as soon as the resource is used.
 	 */
 	static constexpr int DEFAULT_PRELOAD_THRESHOLD = 10;
 
@@ -112,6 +135,9 @@ private:
 	/** The number of chunks that should be preloaded. */
 	int preload_threshold;
 
+	/** The number of int16_t values played per second. */
+	size_t values_per_second;
+
 	/** The size of one audio chunk in bytes. */
 	size_t chunk_size;
 
@@ -129,9 +155,6 @@ private:
 
 	/** Resource chunk index to chunk mapping. */
 	std::unordered_map<size_t,std::shared_ptr<chunk_info_t>> chunk_mapping;
-
-	/** The background loading job group. */
-	job::JobGroup loading_job_group;
 };
 
 }
@@ -1,4 +1,4 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "in_memory_loader.h"
 
@@ -15,14 +15,15 @@ InMemoryLoader::InMemoryLoader(const std::string &path)
 
 
 std::unique_ptr<InMemoryLoader> InMemoryLoader::create(const std::string &path,
-                                                       format_t format) {
+                                                       format_t format,
+                                                       int sample_rate) {
 
 	std::unique_ptr<InMemoryLoader> loader;
 
 	// switch format and return an appropriate loader
 	switch (format) {
 	case format_t::OPUS:
-		loader.reset(new OpusInMemoryLoader{path});
+		loader.reset(new OpusInMemoryLoader{path, sample_rate});
 		break;
 	default:
 		throw Error{MSG(err) << "Not supported for format: " << format};
@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -40,9 +40,11 @@ public:
 	 * Create a InMemoryLoader instance that supports the given format.
 	 * @param path the resource's location in the filesystem
 	 * @param format the resource's audio format
+	 * @param sample_rate the sample rate of the returned pcm data
 	 */
 	static std::unique_ptr<InMemoryLoader> create(const std::string &path,
-	                                              format_t format);
+	                                              format_t format,
+	                                              int sample_rate);
 };
 
 }
@@ -1,8 +1,11 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "in_memory_resource.h"
 
+#include "audio_manager.h"
 #include "in_memory_loader.h"
+#include "../error/error.h"
+#include "../log/log.h"
 
 namespace openage {
 namespace audio {
@@ -13,28 +16,130 @@ InMemoryResource::InMemoryResource(AudioManager *manager,
                                    const std::string &path,
                                    format_t format)
 	:
-	Resource{manager, category, id} {
+	Resource{manager, category, id},
+	path{path},
+	format{format},
+	loaded{false},
+	use_count{0},
+	data{nullptr},
+	length{0} {}
 
-	auto loader = InMemoryLoader::create(path, format);
-	buffer = loader->get_resource();
+
+void InMemoryResource::load() {
+	if (this->loaded) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{this->load_mutex};
+
+		// another thread loaded it meanwhile
+		if (this->loaded) {
+			return;
+		}
+
+		const std::string &cache_dir = this->manager->get_pcm_cache_dir();
+		int sample_rate = this->manager->get_device_spec().freq;
+		uint64_t source_hash = 0;
+
+		if (not cache_dir.empty()) {
+			source_hash = PcmCacheFile::hash_source(this->path);
+			this->cache = PcmCacheFile::open(cache_dir, source_hash, sample_rate);
+		}
+
+		if (not this->cache) {
+			auto loader = InMemoryLoader::create(this->path, this->format, sample_rate);
+			this->buffer = loader->get_resource();
+
+			// the next start maps the cache file instead of decoding
+			if (not cache_dir.empty()) {
+				try {
+					this->cache = PcmCacheFile::write(cache_dir, source_hash, sample_rate, this->buffer);
+					this->buffer = pcm_data_t{};
+				}
+				catch (Error &e) {
+					log::log(MSG(warn) << "Sound is not cached: " << e);
+				}
+			}
+		}
+
+		if (this->cache) {
+			this->data = this->cache->get_data();
+			this->length = this->cache->get_length();
+		} else {
+			this->data = this->buffer.data();
+			this->length = this->buffer.size();
+		}
+
+		this->loaded = true;
+	}
+
+	// outside of the lock, the manager may unload other resources
+	this->manager->pcm_loaded(this);
+}
+
+
+bool InMemoryResource::unload() {
+	std::lock_guard<std::mutex> lock{this->load_mutex};
+
+	// use() counts the sound before it checks whether the data is
+	// loaded, so either it sees the data is gone or it's not freed
+	this->loaded = false;
+	if (this->use_count > 0) {
+		this->loaded = true;
+		return false;
+	}
+
+	this->data = nullptr;
+	this->length = 0;
+	this->cache = nullptr;
+	this->buffer = pcm_data_t{};
+	return true;
+}
+
+
+void InMemoryResource::use() {
+	this->use_count += 1;
+
+	try {
+		this->load();
+	}
+	catch (...) {
+		this->use_count -= 1;
+		throw;
+	}
+
+	this->manager->pcm_used(this);
+}
+
+
+void InMemoryResource::stop_using() {
+	this->use_count -= 1;
 }
 
 
-void InMemoryResource::use() {}
+bool InMemoryResource::is_used() const {
+	return this->use_count > 0;
+}
 
 
-void InMemoryResource::stop_using() {}
+size_t InMemoryResource::get_pcm_size() const {
+	return this->length * sizeof(int16_t);
+}
 
 
 audio_chunk_t InMemoryResource::get_data(size_t position,
                                          size_t data_length) {
+	if (not this->loaded) {
+		return {nullptr, data_length};
+	}
+
 	// if the resource's end has been reached
-	size_t length = buffer.size();
 	if (position >= length) {
 		return {nullptr, 0};
 	}
 
-	const int16_t *buf_pos = &buffer[position];
+	const int16_t *buf_pos = data + position;
 	if (data_length > length - position) {
 		return {buf_pos, length - position};
 	} else {
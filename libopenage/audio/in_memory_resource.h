@@ -1,10 +1,14 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "format.h"
+#include "pcm_cache.h"
 #include "resource.h"
 #include "types.h"
 
@@ -13,12 +17,41 @@ namespace audio {
 
 /**
  * An InMemoryResource loads the whole pcm data into memory and keeps it there.
+ * The decoded data is mapped from the pcm cache if the audio manager has one.
+ *
+ * The data is loaded when the resource is first used or prefetched, and
+ * may be unloaded by the audio manager while no sound uses it, to keep
+ * the loaded pcm data within its budget.
  */
 class InMemoryResource : public Resource {
 private:
-	/** The resource's internal buffer. */
+	/** The resource's location in the filesystem. */
+	std::string path;
+
+	/** The resource's audio format. */
+	format_t format;
+
+	/** Held while the data is loaded or unloaded. */
+	std::mutex load_mutex;
+
+	/** Whether the data below is valid. */
+	std::atomic<bool> loaded;
+
+	/** The number of sounds that currently use this resource. */
+	std::atomic_int use_count;
+
+	/** The resource's internal buffer, if it's not cached. */
 	pcm_data_t buffer;
 
+	/** The mapped cache file with the resource's pcm data. */
+	std::unique_ptr<PcmCacheFile> cache;
+
+	/** The pcm data, either of the buffer or the cache. */
+	const int16_t *data;
+
+	/** The number of int16_t values. */
+	size_t length;
+
 public:
 	InMemoryResource(AudioManager *manager,
 	                 category_t category, int id, const std::string &path,
@@ -28,7 +61,33 @@ public:
 	void use() override;
 	void stop_using() override;
 
+	/**
+	 * Returns no data while the resource isn't loaded,
+	 * which the sounds wait for.
+	 */
 	audio_chunk_t get_data(size_t position, size_t data_length) override;
+
+	/**
+	 * Decodes or maps the pcm data, if it's not loaded yet.
+	 * Throws an Error if the file can't be decoded.
+	 */
+	void load();
+
+	/**
+	 * Frees the pcm data, unless a sound uses it.
+	 * @returns whether the data was freed
+	 */
+	bool unload();
+
+	/**
+	 * Returns whether a sound uses this resource.
+	 */
+	bool is_used() const;
+
+	/**
+	 * Returns the size of the loaded pcm data in bytes.
+	 */
+	size_t get_pcm_size() const;
 };
 
 }
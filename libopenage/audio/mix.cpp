@@ -0,0 +1,195 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "mix.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OPENAGE_MIX_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPENAGE_MIX_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OPENAGE_MIX_NEON 1
+#endif
+
+namespace openage {
+namespace audio {
+
+void mix_samples_scalar(int32_t *dst, const int16_t *src, size_t count, int32_t volume) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i] += volume * src[i];
+	}
+}
+
+
+void saturate_samples_scalar(int16_t *dst, const int32_t *src, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		int32_t value = src[i] / 256;
+		if (value > 32767) {
+			value = 32767;
+		} else if (value < -32768) {
+			value = -32768;
+		}
+		dst[i] = static_cast<int16_t>(value);
+	}
+}
+
+
+#if OPENAGE_MIX_AVX2
+
+void mix_samples(int32_t *dst, const int16_t *src, size_t count, int32_t volume) {
+	const __m256i vol = _mm256_set1_epi32(volume);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+		__m256i mixed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+		mixed = _mm256_add_epi32(mixed, _mm256_mullo_epi32(samples, vol));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), mixed);
+	}
+
+	mix_samples_scalar(dst + i, src + i, count - i, volume);
+}
+
+
+void saturate_samples(int16_t *dst, const int32_t *src, size_t count) {
+	const __m256i round = _mm256_set1_epi32(255);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8));
+
+		// negative values are rounded towards zero, like the division
+		a = _mm256_srai_epi32(_mm256_add_epi32(a, _mm256_and_si256(_mm256_srai_epi32(a, 31), round)), 8);
+		b = _mm256_srai_epi32(_mm256_add_epi32(b, _mm256_and_si256(_mm256_srai_epi32(b, 31), round)), 8);
+
+		// the pack works per 128 bit lane, restore the order after it
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+	}
+
+	saturate_samples_scalar(dst + i, src + i, count - i);
+}
+
+
+const char *mix_kernel_name() {
+	return "avx2";
+}
+
+#elif OPENAGE_MIX_SSE2
+
+void mix_samples(int32_t *dst, const int16_t *src, size_t count, int32_t volume) {
+	// the 16 bit multiplications need a volume in the sample range
+	if (volume > 32767 or volume < -32768) {
+		mix_samples_scalar(dst, src, count, volume);
+		return;
+	}
+
+	const __m128i vol = _mm_set1_epi16(static_cast<int16_t>(volume));
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+
+		// combine the low and high halves of the 32 bit products
+		__m128i low = _mm_mullo_epi16(samples, vol);
+		__m128i high = _mm_mulhi_epi16(samples, vol);
+		__m128i products_a = _mm_unpacklo_epi16(low, high);
+		__m128i products_b = _mm_unpackhi_epi16(low, high);
+
+		__m128i *out = reinterpret_cast<__m128i *>(dst + i);
+		_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), products_a));
+		_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), products_b));
+	}
+
+	mix_samples_scalar(dst + i, src + i, count - i, volume);
+}
+
+
+void saturate_samples(int16_t *dst, const int32_t *src, size_t count) {
+	const __m128i round = _mm_set1_epi32(255);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4));
+
+		// negative values are rounded towards zero, like the division
+		a = _mm_srai_epi32(_mm_add_epi32(a, _mm_and_si128(_mm_srai_epi32(a, 31), round)), 8);
+		b = _mm_srai_epi32(_mm_add_epi32(b, _mm_and_si128(_mm_srai_epi32(b, 31), round)), 8);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+	}
+
+	saturate_samples_scalar(dst + i, src + i, count - i);
+}
+
+
+const char *mix_kernel_name() {
+	return "sse2";
+}
+
+#elif OPENAGE_MIX_NEON
+
+void mix_samples(int32_t *dst, const int16_t *src, size_t count, int32_t volume) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t samples = vld1q_s16(src + i);
+		int32x4_t a = vld1q_s32(dst + i);
+		int32x4_t b = vld1q_s32(dst + i + 4);
+
+		a = vmlaq_n_s32(a, vmovl_s16(vget_low_s16(samples)), volume);
+		b = vmlaq_n_s32(b, vmovl_s16(vget_high_s16(samples)), volume);
+
+		vst1q_s32(dst + i, a);
+		vst1q_s32(dst + i + 4, b);
+	}
+
+	mix_samples_scalar(dst + i, src + i, count - i, volume);
+}
+
+
+void saturate_samples(int16_t *dst, const int32_t *src, size_t count) {
+	const int32x4_t round = vdupq_n_s32(255);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		int32x4_t a = vld1q_s32(src + i);
+		int32x4_t b = vld1q_s32(src + i + 4);
+
+		// negative values are rounded towards zero, like the division
+		a = vshrq_n_s32(vaddq_s32(a, vandq_s32(vshrq_n_s32(a, 31), round)), 8);
+		b = vshrq_n_s32(vaddq_s32(b, vandq_s32(vshrq_n_s32(b, 31), round)), 8);
+
+		vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+	}
+
+	saturate_samples_scalar(dst + i, src + i, count - i);
+}
+
+
+const char *mix_kernel_name() {
+	return "neon";
+}
+
+#else
+
+void mix_samples(int32_t *dst, const int16_t *src, size_t count, int32_t volume) {
+	mix_samples_scalar(dst, src, count, volume);
+}
+
+
+void saturate_samples(int16_t *dst, const int32_t *src, size_t count) {
+	saturate_samples_scalar(dst, src, count);
+}
+
+
+const char *mix_kernel_name() {
+	return "scalar";
+}
+
+#endif
+
+}} // namespace openage::audio
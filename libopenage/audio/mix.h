@@ -0,0 +1,40 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace openage {
+namespace audio {
+
+/**
+ * The sample kernels of the audio callback. They use the widest vector
+ * instructions the library is compiled for (AVX2, SSE2 or NEON) and
+ * produce the same samples as the scalar versions.
+ */
+
+/**
+ * Add the pcm samples scaled by the volume to the mix buffer:
+ * dst[i] += volume * src[i]. A volume of 256 keeps the pcm volume.
+ */
+void mix_samples(int32_t *dst, const int16_t *src, size_t count, int32_t volume);
+
+/**
+ * Scale the mixed samples back to the pcm volume and clamp
+ * them to the output range: dst[i] = clamp(src[i] / 256).
+ */
+void saturate_samples(int16_t *dst, const int32_t *src, size_t count);
+
+/**
+ * Reference versions of the kernels, without vector instructions.
+ */
+void mix_samples_scalar(int32_t *dst, const int16_t *src, size_t count, int32_t volume);
+void saturate_samples_scalar(int16_t *dst, const int32_t *src, size_t count);
+
+/**
+ * Name of the instruction set used by the kernels.
+ */
+const char *mix_kernel_name();
+
+}} // namespace openage::audio
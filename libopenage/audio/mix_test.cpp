@@ -0,0 +1,99 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "mix.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../log/log.h"
+#include "../rng/rng.h"
+#include "../testing/benchmark.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace audio {
+namespace tests {
+
+namespace {
+
+/**
+ * pcm samples covering the whole 16 bit range.
+ */
+std::vector<int16_t> random_samples(rng::RNG &rng, size_t count) {
+	std::vector<int16_t> samples(count);
+	for (auto &sample : samples) {
+		sample = static_cast<int16_t>(static_cast<int32_t>(rng.random_range(0, 65536)) - 32768);
+	}
+	return samples;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void mix() {
+	rng::RNG rng{0};
+
+	// odd lengths exercise the scalar remainder of the kernels
+	for (size_t count : {0, 1, 7, 8, 17, 1023}) {
+		for (int32_t volume : {0, 1, 128, 256, -300, 40000}) {
+			std::vector<int16_t> samples = random_samples(rng, count);
+			std::vector<int32_t> expected(count, 1000);
+			std::vector<int32_t> mixed(count, 1000);
+
+			mix_samples_scalar(expected.data(), samples.data(), count, volume);
+			mix_samples(mixed.data(), samples.data(), count, volume);
+			(mixed == expected) or TESTFAIL;
+		}
+	}
+
+	// values outside the output range and negative ones
+	// which must be rounded towards zero
+	std::vector<int32_t> mixed{
+		0, 255, 256, -255, -256, -257, 511, -511,
+		32767 * 256, 32768 * 256, -32768 * 256, -32769 * 256,
+		INT32_MAX, INT32_MIN, 12345678, -12345678, 77,
+	};
+	std::vector<int16_t> expected(mixed.size());
+	std::vector<int16_t> output(mixed.size());
+
+	saturate_samples_scalar(expected.data(), mixed.data(), mixed.size());
+	saturate_samples(output.data(), mixed.data(), mixed.size());
+	(output == expected) or TESTFAIL;
+
+	(expected[3] == 0 and expected[5] == -1) or TESTFAIL;
+	(expected[9] == 32767 and expected[11] == -32768) or TESTFAIL;
+}
+
+
+// exported benchmark
+void mix_benchmark(testing::Benchmark &bench) {
+	// one callback of the audio manager, with a battle's worth of sounds
+	constexpr size_t count = 4096 * 2;
+	constexpr int sounds = 64;
+
+	rng::RNG rng{0};
+	std::vector<int16_t> samples = random_samples(rng, count);
+	std::vector<int32_t> mixed(count);
+	std::vector<int16_t> output(count);
+
+	auto run = [&](auto mix_func, auto saturate_func) {
+		std::fill(mixed.begin(), mixed.end(), 0);
+		for (int sound = 0; sound < sounds; sound++) {
+			mix_func(mixed.data(), samples.data(), count, 128);
+		}
+		saturate_func(output.data(), mixed.data(), count);
+		testing::use_result(output.data());
+	};
+
+	bench.measure("scalar", [&] { run(mix_samples_scalar, saturate_samples_scalar); });
+	bench.measure("kernel", [&] { run(mix_samples, saturate_samples); });
+
+	log::log(MSG(info) << sounds << " sounds, " << count << " samples per callback, "
+	         << "kernel: " << mix_kernel_name());
+}
+
+} // namespace tests
+} // namespace audio
+} // namespace openage
@@ -1,13 +1,15 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "opus_dynamic_loader.h"
 
+#include <algorithm>
 #include <thread>
 
 #include <opusfile.h>
 
 #include "../log/log.h"
 #include "../error/error.h"
+#include "../util/asset_pack.h"
 
 namespace openage {
 namespace audio {
@@ -19,7 +21,7 @@ static auto opus_deleter = [](OggOpusFile *op_file) {
 	}
 };
 
-OpusDynamicLoader::OpusDynamicLoader(const std::string &path)
+OpusDynamicLoader::OpusDynamicLoader(const std::string &path, int sample_rate)
 	:
 	DynamicLoader{path},
 	source{this->open_opus_file()} {
@@ -30,8 +32,17 @@ OpusDynamicLoader::OpusDynamicLoader(const std::string &path)
 	if (pcm_length < 0) {
 		throw Error{MSG(err) << "Could not seek in " << path << ": " << pcm_length};
 	}
+	source_frames = static_cast<size_t>(pcm_length);
+
+	// the chunks are resampled to the device's rate,
+	// instead of SDL converting the mixed stream
+	if (sample_rate != opus_sample_rate) {
+		resampler = std::make_unique<Resampler>(opus_sample_rate, sample_rate, 2);
+		length = resampler->output_frames(source_frames) * 2;
+	} else {
+		length = source_frames * 2;
+	}
 
-	length = static_cast<size_t>(pcm_length) * 2;
 	log::log(DBG << "Create dynamic opus loader: length=" << length << ", channels=" << channels);
 }
 
@@ -39,30 +50,57 @@ size_t OpusDynamicLoader::load_chunk(int16_t *chunk_buffer, size_t offset,
                                      size_t chunk_size) {
 	// if the requested offset is greater than the resource's length, there is
 	// no chunk left to load
-	if (offset > this->length) {
+	if (offset >= this->length) {
 		return 0;
 	}
 
-	// seek to the requested offset, the seek offset is given in samples
-	// while the requested offset is given in int16_t values, so the division
-	// by 2 is necessary
-	int64_t pcm_offset = static_cast<int64_t>(offset / 2);
+	// the offsets are given in int16_t values of stereo frames
+	size_t out_first = offset / 2;
+	size_t out_count = std::min(chunk_size / 2, this->length / 2 - out_first);
+
+	if (not this->resampler) {
+		size_t frames = this->read_frames(chunk_buffer, out_first, out_count);
+		log::log(MSG(spam) << "DYNLOAD: frames=" << frames);
+		return frames * 2;
+	}
+
+	// each chunk is resampled from the frames around it, so the chunks
+	// can be decoded independently and in any order
+	ssize_t in_first = this->resampler->first_input_frame(out_first);
+	ssize_t in_end = in_first + this->resampler->input_frames(out_first, out_count);
+
+	// the filter reaches beyond both ends of the file
+	size_t read_first = std::max<ssize_t>(in_first, 0);
+	size_t read_end = std::min<ssize_t>(in_end, this->source_frames);
+	size_t decoded = 0;
+
+	if (read_first < read_end) {
+		this->source_buffer.resize((read_end - read_first) * 2);
+		decoded = this->read_frames(this->source_buffer.data(), read_first, read_end - read_first);
+	}
+
+	this->resampler->process(this->source_buffer.data(), read_first, decoded,
+	                         out_first, out_count, chunk_buffer);
+
+	log::log(MSG(spam) << "DYNLOAD: frames=" << out_count << ", decoded=" << decoded);
+	return out_count * 2;
+}
 
-	int op_ret = op_pcm_seek(source.get(), pcm_offset);
+size_t OpusDynamicLoader::read_frames(int16_t *buffer, size_t first_frame,
+                                      size_t frame_count) {
+	int op_ret = op_pcm_seek(source.get(), static_cast<int64_t>(first_frame));
 	if (op_ret < 0) {
 		throw Error{MSG(err) << "Could not seek in " << path << ": " << op_ret};
 	}
 
-	// read a chunk from the requested offset
-	// if the opus file is a mono source, we read chunk_size / 2 values and
-	// convert it to stereo directly
-	// if the opus file is a stereo source, we read chunk_size directly
-	int read_num_values = chunk_size / 2 * channels;
-	int read_count = 0;
+	// if the opus file is a mono source, half of the buffer is read and
+	// converted to stereo afterwards
+	size_t read_num_values = frame_count * channels;
+	size_t read_count = 0;
 	// loop as long as there are samples left to read
-	while (read_count <= read_num_values) {
+	while (read_count < read_num_values) {
 		int samples_read = op_read(
-			source.get(), chunk_buffer + read_count,
+			source.get(), buffer + read_count,
 			read_num_values - read_count, nullptr
 		);
 
@@ -80,22 +118,31 @@ size_t OpusDynamicLoader::load_chunk(int16_t *chunk_buffer, size_t offset,
 		read_count += samples_read * channels;
 	}
 
+	size_t frames = read_count / channels;
+
 	// convert to stereo
 	if (channels == 1) {
-		for(int i = read_count-1; i >= 0; i--) {
-			auto value = chunk_buffer[i];
-			chunk_buffer[i*2+1] = value;
-			chunk_buffer[i*2] = value;
+		for (size_t i = frames; i-- > 0;) {
+			auto value = buffer[i];
+			buffer[i*2+1] = value;
+			buffer[i*2] = value;
 		}
 	}
 
-	log::log(MSG(spam) << "DYNLOAD: file=" << read_count << ", all=" << read_count * 2 / channels);
-	return (read_count * 2) / channels;
+	return frames;
 }
 
 opus_file_t OpusDynamicLoader::open_opus_file() {
 	int op_err;
-	opus_file_t op_file{op_open_file(path.c_str(), &op_err), opus_deleter};
+
+	// a packed file is streamed from the mapped asset pack
+	this->packed = util::find_packed_file(this->path);
+	opus_file_t op_file{
+		this->packed ?
+		op_open_memory(reinterpret_cast<const unsigned char *>(this->packed.data), this->packed.size, &op_err) :
+		op_open_file(path.c_str(), &op_err),
+		opus_deleter
+	};
 	if (op_err != 0) {
 		throw Error{MSG(err) << "Could not open: " << path.c_str()};
 	}
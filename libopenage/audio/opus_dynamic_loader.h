@@ -1,10 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <memory>
 #include <string>
 
+#include "../util/asset_pack.h"
 #include "dynamic_loader.h"
+#include "resampler.h"
 #include "types.h"
 
 namespace openage {
@@ -15,19 +18,32 @@ namespace audio {
  */
 class OpusDynamicLoader : public DynamicLoader {
 private:
+	/** The asset pack the source is read from, if it's packed. */
+	util::packed_file packed;
 	/** The source file. */
 	opus_file_t source;
-	/** The resource's length in int16_t values. */
+	/** The resource's length in int16_t values, at the output rate. */
 	size_t length;
+	/** The number of decoded stereo frames. */
+	size_t source_frames;
 	/** The resource's pcm channels. */
 	int channels;
 
+	/**
+	 * Resamples the decoded chunks to the output rate,
+	 * nullptr if that is the opus rate.
+	 */
+	std::unique_ptr<Resampler> resampler;
+	/** The decoded frames a resampled chunk is computed from. */
+	pcm_chunk_t source_buffer;
+
 public:
 	/**
 	 * Creates a new OpusDynamicLoader.
 	 * @param path the resource's location in the filesystem
+	 * @param sample_rate the sample rate of the loaded chunks
 	 */
-	OpusDynamicLoader(const std::string &path);
+	OpusDynamicLoader(const std::string &path, int sample_rate=opus_sample_rate);
 	virtual ~OpusDynamicLoader() = default;
 
 	size_t load_chunk(int16_t *chunk_buffer, size_t offset,
@@ -39,6 +55,12 @@ private:
 	 * DynamicLoader.
 	 */
 	opus_file_t open_opus_file();
+
+	/**
+	 * Decodes stereo frames starting at the given frame.
+	 * @returns the number of decoded frames, less at the end of the file
+	 */
+	size_t read_frames(int16_t *buffer, size_t first_frame, size_t frame_count);
 };
 
 }
@@ -8,13 +8,16 @@
 
 #include "../log/log.h"
 #include "../error/error.h"
+#include "../util/asset_pack.h"
+#include "resampler.h"
 
 namespace openage {
 namespace audio {
 
-OpusInMemoryLoader::OpusInMemoryLoader(const std::string &path)
+OpusInMemoryLoader::OpusInMemoryLoader(const std::string &path, int sample_rate)
 	:
-	InMemoryLoader{path} {
+	InMemoryLoader{path},
+	sample_rate{sample_rate} {
 }
 
 // custom deleter for OggOpusFile unique pointers
@@ -26,8 +29,14 @@ static auto opus_deleter = [](OggOpusFile *op_file) {
 
 pcm_data_t OpusInMemoryLoader::get_resource() {
 	int op_err;
-	// open the opus file
-	opus_file_t op_file{op_open_file(path.c_str(), &op_err), opus_deleter};
+	// open the opus file, decoded from the asset pack if it's there
+	util::packed_file packed = util::find_packed_file(path);
+	opus_file_t op_file{
+		packed ?
+		op_open_memory(reinterpret_cast<const unsigned char *>(packed.data), packed.size, &op_err) :
+		op_open_file(path.c_str(), &op_err),
+		opus_deleter
+	};
 
 	if (op_err != 0) {
 		throw Error{MSG(err) << "Could not open: " << path};
@@ -70,6 +79,15 @@ pcm_data_t OpusInMemoryLoader::get_resource() {
 		}
 	}
 
+	// resampled once here, the pcm cache stores the result
+	if (this->sample_rate != opus_sample_rate) {
+		Resampler resampler{opus_sample_rate, this->sample_rate, 2};
+		size_t frames = resampler.output_frames(pcm_length);
+		pcm_data_t resampled(frames * 2);
+		resampler.process(buffer.data(), 0, pcm_length, 0, frames, resampled.data());
+		return resampled;
+	}
+
 	return buffer;
 }
 
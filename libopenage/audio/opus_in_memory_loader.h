@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -19,11 +19,16 @@ public:
 	/**
 	 * Creates a new OpusInMemoryLoader.
 	 * @param path the resource's location in the filesystem
+	 * @param sample_rate the rate the decoded data is resampled to
 	 */
-	OpusInMemoryLoader(const std::string &path);
+	OpusInMemoryLoader(const std::string &path, int sample_rate=opus_sample_rate);
 	virtual ~OpusInMemoryLoader() = default;
 
 	pcm_data_t get_resource() override;
+
+private:
+	/** The sample rate of the returned pcm data. */
+	int sample_rate;
 };
 
 }
@@ -0,0 +1,180 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "pcm_cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../error/error.h"
+#include "../log/log.h"
+
+namespace openage {
+namespace audio {
+
+namespace {
+
+constexpr uint32_t pcm_cache_version = 1;
+
+/**
+ * the cache files are written in stereo.
+ */
+constexpr uint32_t pcm_cache_channels = 2;
+
+static_assert(sizeof(pcm_cache_header) == 64, "pcm cache header must keep the samples aligned");
+
+} // anonymous namespace
+
+
+PcmCacheFile::PcmCacheFile(const std::string &filename, void *mapping, size_t mapping_size)
+	:
+	filename{filename},
+	mapping{mapping},
+	mapping_size{mapping_size} {}
+
+
+PcmCacheFile::~PcmCacheFile() {
+	munmap(this->mapping, this->mapping_size);
+}
+
+
+std::unique_ptr<PcmCacheFile> PcmCacheFile::open(const std::string &cache_dir,
+                                                 uint64_t source_hash,
+                                                 int sample_rate) {
+	std::string filename = PcmCacheFile::path_for(cache_dir, source_hash, sample_rate);
+	return PcmCacheFile::map(filename, source_hash, sample_rate);
+}
+
+
+std::unique_ptr<PcmCacheFile> PcmCacheFile::write(const std::string &cache_dir,
+                                                  uint64_t source_hash,
+                                                  int sample_rate,
+                                                  const pcm_data_t &samples) {
+	if (mkdir(cache_dir.c_str(), 0755) < 0 and errno != EEXIST) {
+		throw Error(MSG(err) << "Could not create pcm cache directory " << cache_dir);
+	}
+
+	std::string filename = PcmCacheFile::path_for(cache_dir, source_hash, sample_rate);
+
+	pcm_cache_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "OPCM", 4);
+	header.version = pcm_cache_version;
+	header.source_hash = source_hash;
+	header.sample_rate = sample_rate;
+	header.channels = pcm_cache_channels;
+	header.value_count = samples.size();
+
+	// a partially written file is never seen under the final name
+	std::string tmp_filename = filename + ".tmp";
+	FILE *file = fopen(tmp_filename.c_str(), "wb");
+	if (file == nullptr) {
+		throw Error(MSG(err) << "Could not write pcm cache file " << tmp_filename);
+	}
+
+	bool written = (fwrite(&header, sizeof(header), 1, file) == 1 and
+	                fwrite(samples.data(), sizeof(int16_t), samples.size(), file) == samples.size());
+	written = (fclose(file) == 0) and written;
+
+	if (not written or rename(tmp_filename.c_str(), filename.c_str()) < 0) {
+		unlink(tmp_filename.c_str());
+		throw Error(MSG(err) << "Could not write pcm cache file " << filename);
+	}
+
+	auto cache = PcmCacheFile::map(filename, source_hash, sample_rate);
+	if (not cache) {
+		throw Error(MSG(err) << "Written pcm cache file is invalid: " << filename);
+	}
+	return cache;
+}
+
+
+const int16_t *PcmCacheFile::get_data() const {
+	return reinterpret_cast<const int16_t *>(static_cast<const char *>(this->mapping) + sizeof(pcm_cache_header));
+}
+
+
+size_t PcmCacheFile::get_length() const {
+	return (this->mapping_size - sizeof(pcm_cache_header)) / sizeof(int16_t);
+}
+
+
+uint64_t PcmCacheFile::hash_source(const std::string &source) {
+	FILE *file = fopen(source.c_str(), "rb");
+	if (file == nullptr) {
+		throw Error(MSG(err) << "Could not open: " << source);
+	}
+
+	// fnv-1a over the encoded file, which is much faster than decoding it
+	uint64_t hash = 0xcbf29ce484222325ull;
+	char buffer[65536];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		for (size_t i = 0; i < count; i++) {
+			hash ^= static_cast<unsigned char>(buffer[i]);
+			hash *= 0x100000001b3ull;
+		}
+	}
+	fclose(file);
+
+	return hash;
+}
+
+
+std::string PcmCacheFile::path_for(const std::string &cache_dir, uint64_t source_hash, int sample_rate) {
+	std::ostringstream path;
+	path << cache_dir << "/" << std::hex << source_hash << std::dec << "-" << sample_rate << ".pcm";
+	return path.str();
+}
+
+
+std::unique_ptr<PcmCacheFile> PcmCacheFile::map(const std::string &filename,
+                                                uint64_t source_hash,
+                                                int sample_rate) {
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 or st.st_size < static_cast<off_t>(sizeof(pcm_cache_header))) {
+		close(fd);
+		return nullptr;
+	}
+
+	size_t mapping_size = st.st_size;
+	void *mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	// the mapping stays valid without the descriptor
+	close(fd);
+
+	if (mapping == MAP_FAILED) {
+		log::log(MSG(warn) << "Could not map pcm cache file " << filename);
+		return nullptr;
+	}
+
+	pcm_cache_header header;
+	memcpy(&header, mapping, sizeof(header));
+
+	if (memcmp(header.magic, "OPCM", 4) != 0 or
+	    header.version != pcm_cache_version or
+	    header.source_hash != source_hash or
+	    header.sample_rate != static_cast<uint32_t>(sample_rate) or
+	    header.channels != pcm_cache_channels or
+	    sizeof(header) + header.value_count * sizeof(int16_t) != mapping_size) {
+
+		munmap(mapping, mapping_size);
+		log::log(MSG(info) << "Ignoring outdated pcm cache file " << filename);
+		return nullptr;
+	}
+
+	return std::unique_ptr<PcmCacheFile>{new PcmCacheFile{filename, mapping, mapping_size}};
+}
+
+}} // namespace openage::audio
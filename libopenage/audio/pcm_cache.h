@@ -0,0 +1,93 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "types.h"
+
+namespace openage {
+namespace audio {
+
+/**
+ * file header of a pcm cache file, followed by the samples.
+ */
+struct pcm_cache_header {
+	char magic[4];           //!< "OPCM"
+	uint32_t version;
+	uint64_t source_hash;    //!< hash of the encoded file's content
+	uint32_t sample_rate;    //!< rate of the device the samples were decoded for
+	uint32_t channels;
+	uint64_t value_count;    //!< number of int16_t values after the header
+	char padding[32];        //!< keeps the samples 64 byte aligned
+};
+
+
+/**
+ * Decoded pcm data of a sound, stored in a cache directory.
+ *
+ * In memory resources map their cache file instead of decoding the audio
+ * file at each start. The mapped samples are shared page cache.
+ *
+ * The files are named after the hash of the encoded file's content and
+ * the sample rate, so a changed sound gets a new cache file.
+ */
+class PcmCacheFile {
+public:
+	~PcmCacheFile();
+
+	PcmCacheFile(const PcmCacheFile &) = delete;
+	PcmCacheFile &operator =(const PcmCacheFile &) = delete;
+
+	/**
+	 * hash of the content of an encoded audio file,
+	 * the key of its cache file.
+	 */
+	static uint64_t hash_source(const std::string &source);
+
+	/**
+	 * map the cache file of the source file with the given hash.
+	 *
+	 * @returns nullptr if there is no valid cache file.
+	 */
+	static std::unique_ptr<PcmCacheFile> open(const std::string &cache_dir,
+	                                          uint64_t source_hash,
+	                                          int sample_rate);
+
+	/**
+	 * store the decoded samples of the source file and map the result.
+	 * throws an Error if the cache file can't be written.
+	 */
+	static std::unique_ptr<PcmCacheFile> write(const std::string &cache_dir,
+	                                           uint64_t source_hash,
+	                                           int sample_rate,
+	                                           const pcm_data_t &samples);
+
+	const int16_t *get_data() const;
+
+	/**
+	 * number of int16_t values.
+	 */
+	size_t get_length() const;
+
+private:
+	PcmCacheFile(const std::string &filename, void *mapping, size_t mapping_size);
+
+	static std::string path_for(const std::string &cache_dir, uint64_t source_hash, int sample_rate);
+
+	/**
+	 * map a cache file, nullptr if it doesn't match the source.
+	 */
+	static std::unique_ptr<PcmCacheFile> map(const std::string &filename,
+	                                         uint64_t source_hash,
+	                                         int sample_rate);
+
+	std::string filename;
+	void *mapping;
+	size_t mapping_size;
+};
+
+}} // namespace openage::audio
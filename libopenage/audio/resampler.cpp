@@ -0,0 +1,318 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OPENAGE_RESAMPLE_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPENAGE_RESAMPLE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OPENAGE_RESAMPLE_NEON 1
+#endif
+
+#include "../error/error.h"
+#include "../util/math_constants.h"
+
+namespace openage {
+namespace audio {
+
+namespace {
+
+/**
+ * more phases than this would need megabytes of coefficients,
+ * the rates in use have far less.
+ */
+constexpr size_t max_phase_count = 1 << 16;
+
+
+int gcd(int a, int b) {
+	while (b != 0) {
+		int rest = a % b;
+		a = b;
+		b = rest;
+	}
+	return a;
+}
+
+
+/**
+ * blackman window over [-1, 1].
+ */
+double window(double x) {
+	return 0.42 + 0.5 * std::cos(math::PI * x) + 0.08 * std::cos(2 * math::PI * x);
+}
+
+
+double sinc(double x) {
+	if (x == 0) {
+		return 1;
+	}
+	return std::sin(math::PI * x) / (math::PI * x);
+}
+
+
+float to_float(float sample) {
+	return sample;
+}
+
+
+float to_float(int16_t sample) {
+	return sample;
+}
+
+
+void from_float(float value, float *out) {
+	*out = value;
+}
+
+
+void from_float(float value, int16_t *out) {
+	value = std::round(value);
+	if (value > 32767.0f) {
+		value = 32767.0f;
+	} else if (value < -32768.0f) {
+		value = -32768.0f;
+	}
+	*out = static_cast<int16_t>(value);
+}
+
+} // anonymous namespace
+
+
+Resampler::Resampler(int in_rate, int out_rate, int channels, int taps)
+	:
+	in_rate{in_rate},
+	out_rate{out_rate},
+	channels{channels},
+	taps{taps} {
+
+	if (in_rate <= 0 or out_rate <= 0 or channels <= 0 or taps <= 0) {
+		throw Error(MSG(err) << "Invalid resampling from " << in_rate << " Hz to "
+		            << out_rate << " Hz with " << channels << " channels");
+	}
+
+	if (not Resampler::is_supported(in_rate, out_rate)) {
+		throw Error(MSG(err) << "Can't resample from " << in_rate << " Hz to "
+		            << out_rate << " Hz, their ratio needs too many filter phases");
+	}
+
+	int divisor = gcd(in_rate, out_rate);
+	this->phase_count = out_rate / divisor;
+	this->step = in_rate / divisor;
+
+	// when reducing the rate, the frequencies above the new nyquist are cut
+	double cutoff = std::min(1.0, static_cast<double>(out_rate) / in_rate);
+
+	this->coefficients.resize(this->phase_count * 2 * taps);
+	for (size_t phase = 0; phase < this->phase_count; phase++) {
+		double frac = static_cast<double>(phase) / this->phase_count;
+		float *h = &this->coefficients[phase * 2 * taps];
+
+		double sum = 0;
+		for (int k = 0; k < 2 * taps; k++) {
+			// distance of the input frame to the output position
+			double distance = (k - taps + 1) - frac;
+			double value = cutoff * sinc(cutoff * distance) * window(distance / taps);
+			h[k] = value;
+			sum += value;
+		}
+
+		// each phase passes constant signals unchanged
+		for (int k = 0; k < 2 * taps; k++) {
+			h[k] /= sum;
+		}
+	}
+}
+
+
+bool Resampler::is_supported(int in_rate, int out_rate) {
+	if (in_rate <= 0 or out_rate <= 0) {
+		return false;
+	}
+	return static_cast<size_t>(out_rate / gcd(in_rate, out_rate)) <= max_phase_count;
+}
+
+
+size_t Resampler::output_frames(size_t input_frames) const {
+	return (input_frames * this->phase_count + this->step - 1) / this->step;
+}
+
+
+ssize_t Resampler::first_input_frame(size_t output_frame) const {
+	uint64_t position = uint64_t{output_frame} * this->step;
+	return static_cast<ssize_t>(position / this->phase_count) - this->taps + 1;
+}
+
+
+size_t Resampler::input_frames(size_t out_first, size_t out_count) const {
+	if (out_count == 0) {
+		return 0;
+	}
+	return this->first_input_frame(out_first + out_count - 1)
+	       - this->first_input_frame(out_first) + 2 * this->taps;
+}
+
+
+void Resampler::process(const float *in, size_t frames, float *out) const {
+	this->resample(in, 0, frames, 0, this->output_frames(frames), out);
+}
+
+
+void Resampler::process(const float *in, ssize_t in_first, size_t in_frames,
+                        size_t out_first, size_t out_count, float *out) const {
+	this->resample(in, in_first, in_frames, out_first, out_count, out);
+}
+
+
+void Resampler::process(const int16_t *in, ssize_t in_first, size_t in_frames,
+                        size_t out_first, size_t out_count, int16_t *out) const {
+	this->resample(in, in_first, in_frames, out_first, out_count, out);
+}
+
+
+template<typename T>
+void Resampler::resample(const T *in, ssize_t in_first, size_t in_frames,
+                         size_t out_first, size_t out_count, T *out) const {
+	if (out_count == 0) {
+		return;
+	}
+
+	size_t width = 2 * this->taps;
+
+	// the input frames the output is computed from are copied into one
+	// contiguous buffer per channel, with silence where the input has
+	// no frames, so the kernel reads them without any checks
+	ssize_t first = this->first_input_frame(out_first);
+	size_t span = this->input_frames(out_first, out_count);
+	std::vector<float> planar(span * this->channels, 0.0f);
+
+	ssize_t copy_begin = std::max(first, in_first);
+	ssize_t copy_end = std::min<ssize_t>(first + span, in_first + in_frames);
+	for (ssize_t frame = copy_begin; frame < copy_end; frame++) {
+		const T *src = in + (frame - in_first) * this->channels;
+		for (int c = 0; c < this->channels; c++) {
+			planar[c * span + (frame - first)] = to_float(src[c]);
+		}
+	}
+
+	for (size_t j = 0; j < out_count; j++) {
+		size_t output_frame = out_first + j;
+		size_t phase = (uint64_t{output_frame} * this->step) % this->phase_count;
+		const float *h = &this->coefficients[phase * width];
+		size_t offset = this->first_input_frame(output_frame) - first;
+
+		for (int c = 0; c < this->channels; c++) {
+			float value = dot_product(&planar[c * span + offset], h, width);
+			from_float(value, &out[j * this->channels + c]);
+		}
+	}
+}
+
+
+int Resampler::get_in_rate() const {
+	return this->in_rate;
+}
+
+
+int Resampler::get_out_rate() const {
+	return this->out_rate;
+}
+
+
+float dot_product_scalar(const float *x, const float *h, size_t count) {
+	float sum = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum += x[i] * h[i];
+	}
+	return sum;
+}
+
+
+#if OPENAGE_RESAMPLE_AVX
+
+float dot_product(const float *x, const float *h, size_t count) {
+	__m256 sum = _mm256_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 product = _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(h + i));
+		sum = _mm256_add_ps(sum, product);
+	}
+
+	// add up the lanes
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+
+	return _mm_cvtss_f32(half) + dot_product_scalar(x + i, h + i, count - i);
+}
+
+
+const char *resampler_kernel_name() {
+	return "avx";
+}
+
+#elif OPENAGE_RESAMPLE_SSE2
+
+float dot_product(const float *x, const float *h, size_t count) {
+	__m128 sum = _mm_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+	}
+
+	// add up the lanes
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+	return _mm_cvtss_f32(sum) + dot_product_scalar(x + i, h + i, count - i);
+}
+
+
+const char *resampler_kernel_name() {
+	return "sse2";
+}
+
+#elif OPENAGE_RESAMPLE_NEON
+
+float dot_product(const float *x, const float *h, size_t count) {
+	float32x4_t sum = vdupq_n_f32(0.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		sum = vmlaq_f32(sum, vld1q_f32(x + i), vld1q_f32(h + i));
+	}
+
+	// add up the lanes
+	float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+	half = vpadd_f32(half, half);
+
+	return vget_lane_f32(half, 0) + dot_product_scalar(x + i, h + i, count - i);
+}
+
+
+const char *resampler_kernel_name() {
+	return "neon";
+}
+
+#else
+
+float dot_product(const float *x, const float *h, size_t count) {
+	return dot_product_scalar(x, h, count);
+}
+
+
+const char *resampler_kernel_name() {
+	return "scalar";
+}
+
+#endif
+
+}} // openage::audio
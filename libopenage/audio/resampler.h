@@ -0,0 +1,120 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+namespace openage {
+namespace audio {
+
+/**
+ * Converts interleaved samples from one sample rate to another with a
+ * polyphase windowed sinc filter.
+ *
+ * The rates are reduced by their greatest common divisor, each of the
+ * resulting output phases gets its own set of filter coefficients,
+ * which are computed once in the constructor.
+ *
+ * The filter is applied with the widest vector instructions the library
+ * is compiled for (AVX, SSE2 or NEON), see resampler_kernel_name().
+ */
+class Resampler {
+public:
+	/**
+	 * taps is the number of input frames used on each side of an output frame.
+	 * throws an Error for rates whose ratio needs too many phases.
+	 */
+	Resampler(int in_rate, int out_rate, int channels, int taps=16);
+
+	/**
+	 * whether a resampler between the rates can be created.
+	 */
+	static bool is_supported(int in_rate, int out_rate);
+
+	/**
+	 * number of output frames for the given number of input frames.
+	 */
+	size_t output_frames(size_t input_frames) const;
+
+	/**
+	 * the first input frame the output frame is computed from,
+	 * negative for the output frames at the start of the signal.
+	 */
+	ssize_t first_input_frame(size_t output_frame) const;
+
+	/**
+	 * number of input frames the given output frames are computed from,
+	 * starting at first_input_frame(out_first).
+	 */
+	size_t input_frames(size_t out_first, size_t out_count) const;
+
+	/**
+	 * resample a whole signal of frames interleaved frames,
+	 * the samples before and after it are taken as silence.
+	 * out has to hold output_frames(frames) frames.
+	 */
+	void process(const float *in, size_t frames, float *out) const;
+
+	/**
+	 * resample the output frames [out_first, out_first + out_count) of a
+	 * signal, of which in holds the frames [in_first, in_first + in_frames).
+	 * the samples outside of them are taken as silence.
+	 *
+	 * this resamples a stream in independent chunks, the output of
+	 * adjacent chunks is the same as if it was resampled at once.
+	 */
+	void process(const float *in, ssize_t in_first, size_t in_frames,
+	             size_t out_first, size_t out_count, float *out) const;
+
+	/**
+	 * the same for 16 bit pcm samples, the output is clamped.
+	 */
+	void process(const int16_t *in, ssize_t in_first, size_t in_frames,
+	             size_t out_first, size_t out_count, int16_t *out) const;
+
+	int get_in_rate() const;
+	int get_out_rate() const;
+
+private:
+	template<typename T>
+	void resample(const T *in, ssize_t in_first, size_t in_frames,
+	              size_t out_first, size_t out_count, T *out) const;
+
+	int in_rate;
+	int out_rate;
+	int channels;
+	int taps;
+
+	/**
+	 * the reduced ratio: phase_count output frames
+	 * for each step input frames.
+	 */
+	size_t phase_count;
+	size_t step;
+
+	/**
+	 * 2 * taps coefficients for each phase.
+	 */
+	std::vector<float> coefficients;
+};
+
+
+/**
+ * The filter kernel: the sum of x[i] * h[i].
+ */
+float dot_product(const float *x, const float *h, size_t count);
+
+/**
+ * Reference version of the kernel, without vector instructions.
+ */
+float dot_product_scalar(const float *x, const float *h, size_t count);
+
+/**
+ * Name of the instruction set used by the filter kernel.
+ */
+const char *resampler_kernel_name();
+
+}} // openage::audio
@@ -0,0 +1,105 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../rng/rng.h"
+#include "../testing/testing.h"
+#include "../util/math_constants.h"
+
+namespace openage {
+namespace audio {
+namespace tests {
+
+namespace {
+
+/**
+ * interleaved stereo frames of a sine wave.
+ */
+std::vector<int16_t> sine_frames(int rate, double frequency, size_t frames) {
+	std::vector<int16_t> samples(frames * 2);
+	for (size_t i = 0; i < frames; i++) {
+		double value = 10000 * std::sin(2 * math::PI * frequency * i / rate);
+		samples[i * 2] = static_cast<int16_t>(value);
+		samples[i * 2 + 1] = static_cast<int16_t>(-value);
+	}
+	return samples;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void resampler() {
+	rng::RNG rng{0};
+
+	// odd lengths exercise the scalar remainder of the kernel
+	for (size_t count : {0, 1, 7, 8, 17, 32, 1023}) {
+		std::vector<float> x(count);
+		std::vector<float> h(count);
+		for (size_t i = 0; i < count; i++) {
+			x[i] = rng.real_range(-1, 1);
+			h[i] = rng.real_range(-1, 1);
+		}
+		TESTEQUALS_FLOAT(dot_product(x.data(), h.data(), count),
+		                 dot_product_scalar(x.data(), h.data(), count), 1e-4);
+	}
+
+	// the device rates in use
+	for (int out_rate : {44100, 22050, 96000}) {
+		Resampler resampler{48000, out_rate, 2};
+		TESTEQUALS(resampler.output_frames(48000), static_cast<size_t>(out_rate));
+
+		size_t in_frames = 4800;
+		std::vector<int16_t> in = sine_frames(48000, 1000, in_frames);
+		size_t out_frames = resampler.output_frames(in_frames);
+
+		std::vector<int16_t> whole(out_frames * 2);
+		resampler.process(in.data(), 0, in_frames, 0, out_frames, whole.data());
+
+		// the sine keeps its frequency and amplitude
+		for (size_t i = 100; i < out_frames - 100; i += 37) {
+			double expected = 10000 * std::sin(2 * math::PI * 1000 * i / out_rate);
+			TESTEQUALS_FLOAT(whole[i * 2], expected, 100);
+			TESTEQUALS_FLOAT(whole[i * 2 + 1], -expected, 100);
+		}
+
+		// chunks resampled from the input frames around them
+		// match the signal resampled at once
+		std::vector<int16_t> chunked(out_frames * 2);
+		for (size_t first = 0; first < out_frames; first += 441) {
+			size_t count = std::min<size_t>(441, out_frames - first);
+			ssize_t in_first = std::max<ssize_t>(resampler.first_input_frame(first), 0);
+			ssize_t in_end = std::min<ssize_t>(
+				resampler.first_input_frame(first) + resampler.input_frames(first, count),
+				in_frames
+			);
+
+			resampler.process(&in[in_first * 2], in_first, in_end - in_first,
+			                  first, count, &chunked[first * 2]);
+		}
+		(chunked == whole) or TESTFAIL;
+	}
+
+	// silence stays silent, full scale samples are clamped
+	Resampler resampler{48000, 44100, 1};
+	std::vector<int16_t> loud(1000, 32767);
+	std::vector<int16_t> out(resampler.output_frames(loud.size()));
+	resampler.process(loud.data(), 0, loud.size(), 0, out.size(), out.data());
+	TESTEQUALS(out[out.size() / 2], 32767);
+
+	std::vector<float> silence(100, 0.0f);
+	std::vector<float> silent_out(resampler.output_frames(silence.size()), 1.0f);
+	resampler.process(silence.data(), silence.size(), silent_out.data());
+	TESTEQUALS(silent_out[10], 0.0f);
+
+	// a prime rate would need too many filter phases
+	(not Resampler::is_supported(48000, 96001)) or TESTFAIL;
+	TESTTHROWS((Resampler{48000, 96001, 2}));
+}
+
+}}} // openage::audio::tests
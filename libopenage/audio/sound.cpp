@@ -1,10 +1,11 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "sound.h"
 
 #include <tuple>
 
 #include "audio_manager.h"
+#include "mix.h"
 #include "resource.h"
 
 namespace openage {
@@ -38,6 +39,16 @@ int32_t Sound::get_volume() const {
 }
 
 
+void Sound::set_priority(int32_t priority) {
+	sound_impl->priority = priority;
+}
+
+
+int32_t Sound::get_priority() const {
+	return sound_impl->priority;
+}
+
+
 void Sound::set_looping(bool looping) {
 	sound_impl->looping = looping;
 }
@@ -55,8 +66,7 @@ void Sound::play() {
 	}
 	sound_impl->offset = 0;
 	if (!sound_impl->playing) {
-		audio_manager->add_sound(sound_impl);
-		sound_impl->playing = true;
+		sound_impl->playing = audio_manager->add_sound(sound_impl);
 	}
 }
 
@@ -75,8 +85,7 @@ void Sound::resume() {
 		sound_impl->in_use = true;
 	}
 	if (!sound_impl->playing) {
-		audio_manager->add_sound(sound_impl);
-		sound_impl->playing = true;
+		sound_impl->playing = audio_manager->add_sound(sound_impl);
 	}
 }
 
@@ -108,7 +117,10 @@ SoundImpl::SoundImpl(std::shared_ptr<Resource> resource, int32_t volume)
 	volume{volume},
 	offset{0},
 	playing{false},
-	looping{false} {
+	looping{false},
+	priority{0},
+	boost{0},
+	start_time{0} {
 }
 
 
@@ -129,7 +141,9 @@ int SoundImpl::get_id() const {
 }
 
 
-bool SoundImpl::mix_audio(int32_t *stream, int length) {
+bool SoundImpl::mix_audio(int32_t *stream, int length, int32_t gain) {
+	// the category gain is applied in the same pass as the volume
+	int32_t chunk_volume = (volume + boost) * gain / 256;
 	size_t stream_index = 0;
 	while (length > 0) {
 		auto chunk = resource->get_data(offset, length);
@@ -145,9 +159,7 @@ bool SoundImpl::mix_audio(int32_t *stream, int length) {
 			return false;
 		}
 
-		for (size_t i = 0; i < chunk.length; i++) {
-			stream[i+stream_index] += volume * chunk.data[i];
-		}
+		mix_samples(stream + stream_index, chunk.data, chunk.length, chunk_volume);
 
 		offset += chunk.length;
 		length -= chunk.length;
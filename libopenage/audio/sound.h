@@ -1,9 +1,10 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <memory>
 
+#include "../util/timing.h"
 #include "category.h"
 
 namespace openage {
@@ -50,6 +51,20 @@ public:
 	 */
 	bool looping;
 
+	/**
+	 * Importance of the sound when voices are stolen, higher values are
+	 * kept longer.
+	 */
+	int32_t priority;
+	/**
+	 * Volume added by the sounds which were merged into this one.
+	 */
+	int32_t boost;
+	/**
+	 * When the sound was given a voice.
+	 */
+	time_nsec_t start_time;
+
 	SoundImpl(std::shared_ptr<Resource> resource, int32_t volume=128);
 	~SoundImpl();
 
@@ -67,8 +82,10 @@ public:
 	 * finished or not.
 	 * @param stream the stream to mix with
 	 * @param length the number of values that should mixed
+	 * @param gain the volume of the sound's category, 256 keeps the
+	 *             sound's volume
 	 */
-	bool mix_audio(int32_t *stream, int length);
+	bool mix_audio(int32_t *stream, int length, int32_t gain=256);
 };
 
 
@@ -112,6 +129,18 @@ public:
 	 */
 	int32_t get_volume() const;
 
+	/**
+	 * Sets this sound's priority. If all voices of the category are used,
+	 * the sound with the lowest priority is stopped for a more important
+	 * one. Sounds further away from the camera should get a lower priority.
+	 * @param priority the new priority, 0 by default
+	 */
+	void set_priority(int32_t priority);
+	/**
+	 * Returns this sound's priority.
+	 */
+	int32_t get_priority() const;
+
 	/**
 	 * Sets whether this sound should be looping or not. A looping sound
 	 * restarts automatically after it has finishes.
@@ -125,6 +154,8 @@ public:
 
 	/**
 	 * Resets the sound to it's beginning and starts playing it.
+	 * The sound is dropped if its category has no voice to spare for it,
+	 * or merged into the same sound started just before.
 	 */
 	void play();
 	/**
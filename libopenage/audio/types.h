@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -11,6 +11,11 @@
 namespace openage {
 namespace audio {
 
+/**
+ * libopusfile always decodes at this sample rate.
+ */
+constexpr int opus_sample_rate = 48000;
+
 struct audio_chunk_t {
 	const int16_t *data;
 	size_t length;
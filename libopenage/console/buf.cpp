@@ -1,7 +1,11 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "buf.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 #include "../util/unicode.h"
 
 #include "stdio.h"
@@ -11,6 +15,41 @@ namespace console {
 
 using namespace coord;
 
+namespace {
+
+/**
+ * number of leading chars which are printable ascii, 0x20 to 0x7e.
+ * checks 8 chars at a time, only the word with the first
+ * other char is checked byte by byte.
+ */
+size_t printable_ascii_prefix(const char *c, size_t len) {
+	constexpr uint64_t ones = 0x0101010101010101ull;
+	constexpr uint64_t high = 0x8080808080808080ull;
+
+	size_t pos = 0;
+	for (; pos + sizeof(uint64_t) <= len; pos += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, c + pos, sizeof(word));
+
+		// high bit set in each byte < 0x20, and in each byte > 0x7e
+		uint64_t below = (word - ones * 0x20) & ~word & high;
+		uint64_t above = ((word + ones * (0x7f - 0x7e)) | word) & high;
+		if ((below | above) != 0) {
+			break;
+		}
+	}
+
+	for (; pos < len; pos++) {
+		unsigned char chr = c[pos];
+		if (chr < 0x20 or chr > 0x7e) {
+			break;
+		}
+	}
+	return pos;
+}
+
+} // anonymous namespace
+
 Buf::Buf(term dims, term_t scrollback_lines, term_t min_width, buf_char default_char_fmt)
 	:
 	default_char_fmt{default_char_fmt} {
@@ -25,7 +64,7 @@ Buf::Buf(term dims, term_t scrollback_lines, term_t min_width, buf_char default_
 	this->dims = dims;
 	this->scrollback_lines = scrollback_lines;
 
-	this->linedata_size = this->dims.y + this->scrollback_lines;
+	this->linedata_size = this->dims.y;
 	this->linedata = new buf_line[this->linedata_size];
 	this->linedata_end = this->linedata + this->linedata_size;
 
@@ -36,6 +75,13 @@ Buf::Buf(term dims, term_t scrollback_lines, term_t min_width, buf_char default_
 	this->screen_chrdata = this->chrdata;
 	this->screen_linedata = this->linedata;
 
+	this->scrollback_view.resize(this->chrdata_size);
+	this->scrollback_view_lines.assign(this->dims.y, -1);
+
+	this->lines_advanced = 0;
+	this->dirty_begin = 0;
+	this->dirty_end = 0;
+
 	this->reset();
 }
 
@@ -58,259 +104,108 @@ void Buf::reset() {
 	this->scrollback_possible = 0;
 	this->scrollback_pos = 0;
 
-	//fully clear data and linedata
-	this->clear({0, (term_t) -this->scrollback_lines}, {0, this->dims.y});
+	//fully clear the screen and scrollback buffers
+	this->scrollback.clear();
+	std::fill(this->scrollback_view_lines.begin(), this->scrollback_view_lines.end(), -1);
+	this->mark_dirty(-this->scrollback_lines, 0);
+	this->clear({0, 0}, {0, this->dims.y});
 }
 
-/*
- * this class merely exists as a helper for the next function,
- * Buf::resize(), and is thus defined and documented here in the implementation
- * cpp file.
- *
- * its purpose is to provide a new buffer, to where the old buffer may be
- * copied easily, avoiding code duplication.
- */
-class NewBuf {
-public:
-	term dims;
-	term_t scrollback_lines;
-
-	buf_line *linedata;
-	size_t linedata_size;
-	buf_line *linedata_end;
-	buf_line *linedata_ptr;
-
-	buf_char *chrdata;
-	size_t chrdata_size;
-	buf_char *chrdata_end;
-	buf_char *chrdata_ptr;
-
-	term_t screen_buf_start;
-	size_t screen_buf_size;
-	term_t scrollback_buf_start;
-	size_t scrollback_buf_size;
-
-	bool current_line_is_screen_buf;
-	term current_pos;
-
-	const buf_char default_char_fmt;
-
-	NewBuf(term dims, term_t scrollback_lines, buf_char default_char_fmt)
-		:
-		linedata_ptr{nullptr},
-		chrdata_ptr{nullptr},
-		default_char_fmt{default_char_fmt}
-	{
-		this->dims = dims;
-		this->scrollback_lines = scrollback_lines;
-
-		this->linedata_size = this->dims.y + this->scrollback_lines;
-		this->linedata = new buf_line[this->linedata_size];
-		this->linedata_end = this->linedata + this->linedata_size;
-
-		this->chrdata_size = this->linedata_size * this->dims.x;
-		this->chrdata = new buf_char[this->chrdata_size];
-		this->chrdata_end = this->chrdata + this->chrdata_size;
-
-		this->screen_buf_start = 0;
-		this->screen_buf_size = 0;
-		this->scrollback_buf_start = 0;
-		this->scrollback_buf_size = 0;
-
-		this->current_line_is_screen_buf = false;
-		this->current_pos = {0, 0};
-	}
-
-	~NewBuf() {
-		delete[] this->linedata;
-		delete[] this->chrdata;
-	}
-
-	void apply_to_buf(Buf *b) {
-		b->dims = this->dims;
-
-		delete b->linedata;
-		b->linedata = this->linedata;
-		this->linedata = nullptr;
-		b->linedata_size = this->linedata_size;
-		b->linedata_end = this->linedata_end;
-
-		delete b->chrdata;
-		b->chrdata = this->chrdata;
-		this->chrdata = nullptr;
-		b->chrdata_size = this->chrdata_size;
-		b->chrdata_end = this->chrdata_end;
-
-		// TODO set the following members of b:
-		// screen_chrdata, screen_linedata
-		// cursorpos, saved_cursorpos,
-		// scrollback_possible, scrollback_pos
-		// TODO call b->clear() with correct
-		// screen buffer part as arguments
-	}
-
-	void move_ptrs_to_next_line() {
-		//all three if clauses should have identical results...
-		this->current_pos.y++;
-		if (this->current_pos.y >= this->dims.y) {
-			this->current_pos.y = 0;
-		}
-		this->linedata_ptr++;
-		if (this->linedata_ptr >= this->linedata_end) {
-			this->linedata_ptr = this->linedata;
-		}
-		this->chrdata_ptr += this->dims.x;
-		if (this->chrdata_ptr >= this->chrdata_end) {
-			this->chrdata_ptr = this->chrdata;
-		}
-		*(this->linedata_ptr) = BUF_LINE_DEFAULT;
-		this->current_pos.x = 0;
-	}
-
-	/**
-	 * starts a new line (as by newline character)
-	 */
-	void new_line(bool part_of_screen_buf) {
-		//clear the remaining chars of current line
-		for (; this->current_pos.x < this->dims.x; this->current_pos.x++) {
-			this->chrdata_ptr[this->current_pos.x] = this->default_char_fmt;
-		}
-
-		move_ptrs_to_next_line();
-
-		this->current_line_is_screen_buf = part_of_screen_buf;
-	}
-
-	/**
-	 * writes a char
-	 */
-	void new_chr(buf_char c) {
-		this->chrdata_ptr[this->current_pos.x++] = c;
-
-		if (c != this->default_char_fmt) {
-			this->linedata_ptr->type = LINE_REGULAR;
-
-			if (this->current_line_is_screen_buf) {
-				//TODO write down somewhere the fact that this
-				//line constitutes a part of the screen buffer
-			} else {
-				//TODO write down somewhere the fact that this
-				//line constitutes a part of the scrollback buffer
-			}
-		}
-
-		if (this->current_pos.x == this->dims.x) {
-			this->linedata_ptr->type = LINE_WRAPPED;
-			move_ptrs_to_next_line();
-		}
-	}
-};
-
-//TODO unfinished implementation
 void Buf::resize(term new_dims) {
-	term old_dims = this->dims;
-
 	if (new_dims.x < this->min_width) {
 		new_dims.x = this->min_width;
 	}
 	if (new_dims.y < 1) {
 		new_dims.y = 1;
 	}
+	if (new_dims == this->dims) {
+		return;
+	}
+
+	// the cursor line has to stay on the screen,
+	// the lines above it which don't fit are scrolled out
+	if (this->cursorpos.y >= new_dims.y) {
+		term_t moved = this->cursorpos.y - new_dims.y + 1;
+		this->advance(moved);
+		this->cursorpos.y -= moved;
+		this->saved_cursorpos.y -= moved;
+	}
 
-	// allocate new buffers
-	size_t new_linedata_size = new_dims.y + this->scrollback_lines;
+	// copy the screen buffer to the top left of the new one,
+	// the scrollback lines are expanded to any width anyway
+	size_t new_linedata_size = new_dims.y;
 	buf_line *new_linedata = new buf_line[new_linedata_size];
-	buf_line *new_linedata_end = new_linedata + new_linedata_size;
 	size_t new_chrdata_size = new_dims.x * new_linedata_size;
 	buf_char *new_chrdata = new buf_char[new_chrdata_size];
-	buf_char *new_chrdata_end = new_chrdata + new_chrdata_size;
-
-	// working positions in new buffers: start at beginning of buffer
-	buf_line *new_linedata_pos = new_linedata;
-	buf_char *new_chrdata_pos = new_chrdata;
-	// working positions in old buffers: start with oldest line of
-	// scrollback buffer
-	buf_line *old_linedata_scrollbackstart = this->linedataptr(-scrollback_lines);
-	buf_char *old_chrdata_scrollbackstart = this->chrdataptr({0, (term_t) -scrollback_lines});
-	buf_line *old_linedata_pos = old_linedata_scrollbackstart;
-	buf_char *old_chrdata_pos = old_chrdata_scrollbackstart;
-
-	// copy line by line, considering the value stored in
-	// old_linedata_pos->auto_wrapped.
-	// start with the first line of the scrollback buffer, and stop with the
-	// last line of the screen buffer.
-	// do not copy empty characters, unless they are followed by filled
-	// characters in the same line, or a continued wrapped line.
-	// store in term_t variables the locations in the new buffer of
-	//   the first/last line of the old scrollback buffer
-	//   the first/last line of the old screen buffer
-	// these variables need to take into account events where upmost
-	// lines of a buffer are overwritten by new lines.
-	// commented out for now //TODO
-
-	// term_t scrollback_buf_start;
-	// term_t scrollback_buf_end;
-	// term_t screen_buf_start;
-	// term_t screen_buf_end;
-
-	// count the number of empty chars that we've found in this line,
-	// and we may or may not still have to copy.
-	size_t empty_chars = 0;
-	while(old_linedata_pos != old_linedata_scrollbackstart) {
-		// should never be >, always ==
-		// also, both checks should always yield identical results
-		// (TODO do an ASSERT to assure this?)
-		if (old_linedata_pos >= this->linedata_end) {
-			old_linedata_pos = this->linedata;
-		}
-		if (old_chrdata_pos >= this->chrdata_end) {
-			old_chrdata_pos = this->chrdata;
-		}
-		// should never be >, always ==
-		// also, both checks should always yield identical results
-		// (TODO do an ASSERT to assure this?)
-		if (new_linedata_pos >= new_linedata_end) {
-			new_linedata_pos = new_linedata;
-		}
-		if (new_chrdata_pos >= new_chrdata_end) {
-			new_chrdata_pos = new_chrdata;
-		}
 
-		for(term_t x = 0; x < old_dims.x; x++) {
-			if (*old_chrdata_pos == this->default_char_fmt) {
-				empty_chars++;
-			} else {
-				while (empty_chars > 0) {
-					// TODO write the empty chars
-				}
-				// TODO write the char
+	term_t copy_width = std::min(this->dims.x, new_dims.x);
+	for (term_t y = 0; y < new_dims.y; y++) {
+		buf_char *dst = new_chrdata + y * new_dims.x;
+		term_t x = 0;
+
+		if (y < this->dims.y) {
+			new_linedata[y] = *this->linedataptr(y);
+			const buf_char *src = this->chrdataptr({0, y});
+			for (; x < copy_width; x++) {
+				dst[x] = src[x];
 			}
+		} else {
+			new_linedata[y] = BUF_LINE_DEFAULT;
+		}
 
-			old_chrdata_pos++;
+		for (; x < new_dims.x; x++) {
+			dst[x] = this->default_char_fmt;
 		}
 	}
 
-	// TODO
-	// depending on the variables defined in the previous section,
-	// decide which line is the first line of the screen buffer
-	// int new_chrbuf, and which parts of new_chrbuf must be cleared.
+	delete[] this->linedata;
+	this->linedata = new_linedata;
+	this->linedata_size = new_linedata_size;
+	this->linedata_end = new_linedata + new_linedata_size;
+	this->screen_linedata = new_linedata;
 
-	// TODO
-	// copy
+	delete[] this->chrdata;
+	this->chrdata = new_chrdata;
+	this->chrdata_size = new_chrdata_size;
+	this->chrdata_end = new_chrdata + new_chrdata_size;
+	this->screen_chrdata = new_chrdata;
 
 	this->dims = new_dims;
+
+	this->scrollback_view.resize(this->chrdata_size);
+	this->scrollback_view_lines.assign(this->dims.y, -1);
+
+	// keep the cursors on the screen
+	for (term *pos : {&this->cursorpos, &this->saved_cursorpos}) {
+		pos->x = std::min(pos->x, (term_t) (this->dims.x - 1));
+		pos->y = std::max(std::min(pos->y, (term_t) (this->dims.y - 1)), 0);
+	}
+	if (this->cursorpos.x != this->dims.x - 1) {
+		this->cursor_special_lastcol = false;
+	}
+
+	this->mark_dirty(-this->scrollback_lines, this->dims.y);
 }
 
 void Buf::write(const char *c, ssize_t len) {
-	if (len >= 0) {
-		for(; len > 0; len--) {
-			this->write(*c);
-			c++;
-		}
-	} else {
-		for(; *c; c++) {
-			this->write(*c);
+	size_t remaining = (len >= 0) ? len : strlen(c);
+
+	while (remaining > 0) {
+		// ascii chars are their own codepoints, unless they
+		// are part of an escape sequence or of a multi-byte char.
+		if (not this->escaped and this->streamdecoder.remaining == 0) {
+			size_t count = printable_ascii_prefix(c, remaining);
+			if (count > 0) {
+				this->print_ascii(c, count);
+				c += count;
+				remaining -= count;
+				continue;
+			}
 		}
+
+		this->write(*c);
+		c++;
+		remaining--;
 	}
 }
 
@@ -342,12 +237,29 @@ void Buf::advance(unsigned linecount) {
 		linecount = this->dims.y + this->scrollback_lines;
 	}
 
-	// update scrollback_possible
-	this->scrollback_possible += linecount;
-	if (this->scrollback_possible > (term_t) this->scrollback_lines) {
-		this->scrollback_possible = this->scrollback_lines;
+	// the top lines of the screen buffer are compressed into the
+	// scrollback buffer, followed by cleared lines if more lines than
+	// the screen height advance.
+	// the lines which wouldn't fit into it are skipped right away.
+	term_t moved = std::min((term_t) linecount, this->dims.y);
+	term_t first = std::max((term_t) linecount - this->scrollback_lines, 0);
+
+	for (term_t y = first; y < (term_t) linecount; y++) {
+		if (y < moved) {
+			this->scrollback.push_back(this->compress_line(this->chrdataptr({0, y}), *this->linedataptr(y)));
+		} else {
+			std::vector<buf_char> cleared(this->dims.x, this->current_char_fmt);
+			this->scrollback.push_back(this->compress_line(cleared.data(), BUF_LINE_DEFAULT));
+		}
+	}
+
+	while (this->scrollback.size() > (size_t) this->scrollback_lines) {
+		this->scrollback.pop_front();
 	}
 
+	// update scrollback_possible
+	this->scrollback_possible = this->scrollback.size();
+
 	// update scrollback position, to remain at the currently scrolled-to
 	// position
 	if (this->scrollback_pos > 0) {
@@ -358,20 +270,32 @@ void Buf::advance(unsigned linecount) {
 		}
 	}
 
-	// clear the new lines. that's scrollback_buffer[0:linecount]
-	this->clear({0, (term_t) -this->scrollback_lines}, {0, (term_t) ((term_t) linecount - (term_t) this->scrollback_lines)});
+	// the changed lines move up with their content.
+	// the cleared lines are marked below, where they are on screen.
+	term_t dirty_begin = this->dirty_begin - (term_t) linecount;
+	term_t dirty_end = this->dirty_end - (term_t) linecount;
 
-	// move the screen buffer by updating the screen_chrdata pointer
-	this->screen_chrdata += linecount * this->dims.x;
+	// move the screen buffer by updating the screen_chrdata pointer,
+	// the top lines become the bottom lines
+	this->screen_chrdata += moved * this->dims.x;
 	if (this->screen_chrdata >= this->chrdata_end) {
 		this->screen_chrdata -= this->chrdata_size;
 	}
 
 	// also update the screen_linedata pointer
-	this->screen_linedata += linecount;
+	this->screen_linedata += moved;
 	if (this->screen_linedata >= this->linedata_end) {
 		this->screen_linedata -= this->linedata_size;
 	}
+
+	this->lines_advanced += linecount;
+
+	this->dirty_begin = 0;
+	this->dirty_end = 0;
+	this->mark_dirty(dirty_begin, dirty_end);
+
+	// clear the new lines
+	this->clear({0, (term_t) (this->dims.y - moved)}, {0, this->dims.y});
 }
 
 void Buf::write(char c) {
@@ -397,8 +321,9 @@ void Buf::pop_last_char() {
 		buf_char *ptr = this->chrdataptr(this->cursorpos);
 		*ptr = this->current_char_fmt;
 		ptr->cp = ' ';
+		this->mark_dirty(this->cursorpos.y, this->cursorpos.y + 1);
 
-		if (this->cursorpos.x == 0 && this->linedataptr(this->cursorpos.y - 1)->type == LINE_WRAPPED) {
+		if (this->cursorpos.x == 0 && this->cursorpos.y > 0 && this->linedataptr(this->cursorpos.y - 1)->type == LINE_WRAPPED) {
 			this->linedataptr(this->cursorpos.y)->type = LINE_EMPTY;
 			this->cursorpos.y--;
 			this->linedataptr(this->cursorpos.y)->type = LINE_REGULAR;
@@ -573,6 +498,7 @@ void Buf::print_codepoint(int cp) {
 		buf_char *ptr = this->chrdataptr(this->cursorpos);
 		*ptr = this->current_char_fmt;
 		ptr->cp = cp;
+		this->mark_dirty(this->cursorpos.y, this->cursorpos.y + 1);
 		buf_line *lineptr = this->linedataptr(this->cursorpos.y);
 
 		// store the fact that this line has been written to
@@ -591,6 +517,44 @@ void Buf::print_codepoint(int cp) {
 	}
 }
 
+void Buf::print_ascii(const char *c, size_t len) {
+	while (len > 0) {
+		// the wrap to the next line is done by print_codepoint
+		if (this->cursor_special_lastcol) {
+			this->print_codepoint(*c);
+			c++;
+			len--;
+			continue;
+		}
+
+		// the chars which fit into the current line
+		size_t count = std::min(len, static_cast<size_t>(this->dims.x - this->cursorpos.x));
+
+		buf_char *ptr = this->chrdataptr(this->cursorpos);
+		for (size_t i = 0; i < count; i++) {
+			ptr[i] = this->current_char_fmt;
+			ptr[i].cp = c[i];
+		}
+		this->mark_dirty(this->cursorpos.y, this->cursorpos.y + 1);
+
+		// store the fact that this line has been written to
+		buf_line *lineptr = this->linedataptr(this->cursorpos.y);
+		if (lineptr->type == LINE_EMPTY) {
+			lineptr->type = LINE_REGULAR;
+		}
+
+		// advance cursor to the right
+		this->cursorpos.x += count;
+		if (this->cursorpos.x == this->dims.x) {
+			this->cursorpos.x -= 1;
+			this->cursor_special_lastcol = true;
+		}
+
+		c += count;
+		len -= count;
+	}
+}
+
 void print_cps(FILE *f, std::vector<int> *v) {
 	for (int i: *v) {
 		if (i >= 0x20 and i < 0x7f) {
@@ -1083,6 +1047,38 @@ void Buf::clear(term start, term end, bool clear_end) {
 		return;
 	}
 
+	this->mark_dirty(start.y, end.x > 0 ? end.y + 1 : end.y);
+
+	// the scrollback lines are expanded, cleared and compressed again
+	if (start.y < 0) {
+		std::vector<buf_char> chars(this->dims.x);
+
+		for (term_t y = start.y; y < 0 and y <= end.y; y++) {
+			scrollback_line *line = this->scrollbackptr(y);
+			term_t begin_x = (y == start.y) ? start.x : 0;
+			term_t end_x = (y == end.y) ? end.x : this->dims.x;
+
+			// the lines above the stored ones are empty anyway
+			if (line == nullptr or begin_x >= end_x) {
+				continue;
+			}
+
+			this->expand_line(*line, chars.data());
+			std::fill(chars.begin() + begin_x, chars.begin() + end_x, this->current_char_fmt);
+
+			// a line is cleared iff all of its characters are cleared
+			buf_line type = (begin_x == 0 and end_x == this->dims.x) ? BUF_LINE_DEFAULT : line->line;
+			*line = this->compress_line(chars.data(), type);
+		}
+
+		std::fill(this->scrollback_view_lines.begin(), this->scrollback_view_lines.end(), -1);
+
+		start = {0, 0};
+		if (end.y < 0 or (end.y == 0 and end.x == 0)) {
+			return;
+		}
+	}
+
 	// clear char info
 	chrdata_clear(chrdataptr(start), chrdataptr(end));
 
@@ -1133,29 +1129,150 @@ void Buf::linedata_clear(buf_line *start, buf_line *end) {
 }
 
 buf_char *Buf::chrdataptr(term pos) {
+	if (pos.y < 0) {
+		// the line is expanded unless it still is from the last time
+		int64_t number = this->lines_advanced + pos.y;
+		size_t index = ((number % this->dims.y) + this->dims.y) % this->dims.y;
+		buf_char *view = &this->scrollback_view[index * this->dims.x];
+
+		if (this->scrollback_view_lines[index] != number) {
+			const scrollback_line *line = this->scrollbackptr(pos.y);
+			if (line != nullptr) {
+				this->expand_line(*line, view);
+				this->scrollback_view_lines[index] = number;
+			} else {
+				std::fill(view, view + this->dims.x, this->default_char_fmt);
+				this->scrollback_view_lines[index] = -1;
+			}
+		}
+
+		return view + pos.x;
+	}
+
 	buf_char *result = this->screen_chrdata + pos.x + pos.y * this->dims.x;
-	if (result < this->chrdata) {
-		result += this->chrdata_size;
-	} else if (result >= this->chrdata_end) {
+	if (result >= this->chrdata_end) {
 		result -= this->chrdata_size;
 	}
 	return result;
 }
 
 buf_line *Buf::linedataptr(term_t lineno) {
-	buf_line *result = this->screen_linedata + lineno;
-	if (result < this->linedata) {
-		result += this->linedata_size;
+	if (lineno < 0) {
+		scrollback_line *line = this->scrollbackptr(lineno);
+		if (line != nullptr) {
+			return &line->line;
+		}
+		this->empty_linedata = BUF_LINE_DEFAULT;
+		return &this->empty_linedata;
 	}
-	if (result > this->linedata_end) {
+
+	buf_line *result = this->screen_linedata + lineno;
+	if (result >= this->linedata_end) {
 		result -= this->linedata_size;
 	}
 	return result;
 }
 
+scrollback_line *Buf::scrollbackptr(term_t lineno) {
+	ssize_t index = (ssize_t) this->scrollback.size() + lineno;
+	if (index < 0) {
+		return nullptr;
+	}
+	return &this->scrollback[index];
+}
+
+scrollback_line Buf::compress_line(const buf_char *chars, buf_line line) const {
+	scrollback_line result;
+	result.line = line;
+
+	term_t length = this->dims.x;
+	while (length > 0 and chars[length - 1] == this->default_char_fmt) {
+		length--;
+	}
+
+	result.text.reserve(length);
+	char utf8[5];
+
+	for (term_t x = 0; x < length; x++) {
+		const buf_char &chr = chars[x];
+
+		if (chr.cp >= 0 and chr.cp < 0x80) {
+			result.text.push_back(chr.cp);
+		} else {
+			// each char has to stay one codepoint
+			size_t size = util::utf8_encode(chr.cp, utf8);
+			if (size == 0) {
+				size = util::utf8_encode(0xfffd, utf8);
+			}
+			result.text.append(utf8, size);
+		}
+
+		if (not result.runs.empty()) {
+			buf_run &run = result.runs.back();
+			if (run.fgcol == chr.fgcol and run.bgcol == chr.bgcol and run.flags == chr.flags) {
+				run.length++;
+				continue;
+			}
+		}
+		result.runs.push_back(buf_run{1, chr.fgcol, chr.bgcol, chr.flags});
+	}
+
+	result.text.shrink_to_fit();
+	result.runs.shrink_to_fit();
+	return result;
+}
+
+void Buf::expand_line(const scrollback_line &line, buf_char *out) const {
+	std::vector<util::codepoint_t> cps(line.text.size());
+	size_t count = util::utf8_decode(
+		reinterpret_cast<const unsigned char *>(line.text.data()),
+		line.text.size(),
+		cps.data()
+	);
+
+	term_t x = 0;
+	size_t cp = 0;
+	for (const buf_run &run : line.runs) {
+		for (term_t i = 0; i < run.length and x < this->dims.x and cp < count; i++) {
+			out[x++] = buf_char{cps[cp++], run.fgcol, run.bgcol, run.flags};
+		}
+	}
+
+	for (; x < this->dims.x; x++) {
+		out[x] = this->default_char_fmt;
+	}
+}
+
 const coord::term &Buf::get_dims() const {
 	return this->dims;
 }
 
+void Buf::mark_dirty(term_t begin, term_t end) {
+	if (begin < -this->scrollback_lines) {
+		begin = -this->scrollback_lines;
+	}
+	if (end > this->dims.y) {
+		end = this->dims.y;
+	}
+	if (begin >= end) {
+		return;
+	}
+
+	if (this->dirty_begin >= this->dirty_end) {
+		this->dirty_begin = begin;
+		this->dirty_end = end;
+	} else {
+		this->dirty_begin = std::min(this->dirty_begin, begin);
+		this->dirty_end = std::max(this->dirty_end, end);
+	}
+}
+
+std::pair<term_t, term_t> Buf::take_dirty_lines() {
+	std::pair<term_t, term_t> dirty{this->dirty_begin, this->dirty_end};
+	this->dirty_begin = 0;
+	this->dirty_end = 0;
+	return dirty;
+}
+
 
 }} // openage::console
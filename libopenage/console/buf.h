@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
+#include <deque>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "../coord/term.h"
@@ -14,8 +17,6 @@
 namespace openage {
 namespace console {
 
-class NewBuf;
-
 
 /**
  * the length of the escape sequence buffer, and thus the maximum length
@@ -117,9 +118,43 @@ struct buf_line {
 
 constexpr buf_line BUF_LINE_DEFAULT {LINE_EMPTY};
 
-class Buf {
-	friend class NewBuf;
+/**
+ * a run of characters with identical colors and flags
+ * in a line of the scrollback buffer
+ */
+struct buf_run {
+	/**
+	 * number of characters in the run
+	 */
+	coord::term_t length;
+	chrcol_t fgcol;
+	chrcol_t bgcol;
+	chrflags_t flags;
+};
+
+/**
+ * a line of the scrollback buffer.
+ *
+ * instead of one buf_char per column, the codepoints are stored as
+ * UTF-8 text, and their formatting as runs of identical attributes.
+ * the trailing default chars of the line are not stored at all,
+ * so a line costs about as much as the text in it.
+ */
+struct scrollback_line {
+	buf_line line;
+
+	/**
+	 * one codepoint per character
+	 */
+	std::string text;
+
+	/**
+	 * the formatting of the characters, from the left
+	 */
+	std::vector<buf_run> runs;
+};
 
+class Buf {
 public:
 	Buf(coord::term dims, coord::term_t scrollback_lines, coord::term_t min_width,
 	    buf_char default_char_fmt = {0x20, 254, 0, 0});
@@ -144,6 +179,9 @@ public:
 	 *
 	 * if len >= 0, it describes the length of the string.
 	 * otherwise, the string is assumed to be null-terminated.
+	 *
+	 * runs of printable ascii chars are printed in bulk,
+	 * without going through the decoder and escape state.
 	 */
 	void write(const char *c, ssize_t len = -1);
 
@@ -163,6 +201,10 @@ public:
 
 	/**
 	 * resizes the screen buffer
+	 *
+	 * the lines are cut or filled up to the new width, not re-wrapped.
+	 * if the screen gets too low for the cursor line, the top lines
+	 * are moved to the scrollback buffer.
 	 */
 	void resize(coord::term new_dims);
 
@@ -199,6 +241,13 @@ public:
 	 */
 	void print_codepoint(int cp);
 
+	/**
+	 * prints printable ascii chars (0x20 to 0x7e), like print_codepoint
+	 * for each of them, but line by line.
+	 * called by write(const char *, ssize_t) if not escaped.
+	 */
+	void print_ascii(const char *c, size_t len);
+
 	/**
 	 * aborts the current escape sequence
 	 * (e.g. because it contained an illegal
@@ -245,7 +294,7 @@ public:
 	/**
 	 * advances the buffer by the specified number of lines.
 	 *
-	 * the top lines are moved to the scrollback buffer.
+	 * the top lines are compressed into the scrollback buffer.
 	 * the top lines of the scrollback buffer are discarded.
 	 * the bottom lines of the buffer are empty after this.
 	 * the cursor position is not changed by this.
@@ -282,14 +331,14 @@ public:
 	void clear(coord::term start, coord::term end, bool clear_end = false);
 
 	/**
-	 * clears a range of the data buffer.
+	 * clears a range of the screen data buffer.
 	 * end is the first character that is not cleared.
 	 * end and start both must be valid pointers within data.
 	 */
 	void chrdata_clear(buf_char *start, buf_char *end);
 
 	/**
-	 * clears a range of the linedata buffer.
+	 * clears a range of the screen linedata buffer.
 	 * end is the first line that is not cleared.
 	 * end and start both must be valid pointers within data.
 	 */
@@ -299,12 +348,18 @@ public:
 	 * returns a valid pointer to the character info for the character
 	 * designated by pos
 	 *
+	 * the characters of a line are contiguous.
+	 *
 	 * pos
 	 *   screen buffer coordinates
 	 *   negative values of y indicate scrollback buffer
 	 *   -scrollback_lines <= pos.y <= dims.y
 	 *   0 <= pos.x < dims.x
 	 *   if y == dims.y, the return ptr is not guaranteed to be valid.
+	 *
+	 * scrollback lines are expanded into scrollback_view, their
+	 * characters must not be changed through the pointer, and it is
+	 * only valid until the next call.
 	 */
 	buf_char *chrdataptr(coord::term pos);
 
@@ -320,28 +375,61 @@ public:
 	 */
 	buf_line *linedataptr(coord::term_t lineno);
 
+	/**
+	 * returns the line of the scrollback buffer designated by lineno,
+	 * or nullptr if the line is older than the stored ones (and thus empty).
+	 *
+	 * lineno
+	 *   -scrollback_lines <= lineno < 0
+	 */
+	scrollback_line *scrollbackptr(coord::term_t lineno);
+
+	/**
+	 * stores a line of dims.x characters as scrollback line.
+	 */
+	scrollback_line compress_line(const buf_char *chars, buf_line line) const;
+
+	/**
+	 * writes the dims.x characters of a scrollback line to out.
+	 */
+	void expand_line(const scrollback_line &line, buf_char *out) const;
+
 	/**
 	 * Return the dimensions of the visible console area.
 	 */
 	const coord::term &get_dims() const;
 
+	/**
+	 * marks lines as changed.
+	 *
+	 * begin, end
+	 *   screen buffer coordinates of the first changed line and the
+	 *   first line after it. the range is capped to the buffer.
+	 */
+	void mark_dirty(coord::term_t begin, coord::term_t end);
+
+	/**
+	 * returns the range of lines that changed since the last call,
+	 * in screen buffer coordinates, and forgets it.
+	 * the range is empty if first >= second.
+	 */
+	std::pair<coord::term_t, coord::term_t> take_dirty_lines();
+
 public:
 	// following this line are all terminal buffer related variables
 
 	/**
-	 * the complete (2-dimensional) terminal output buffer content
-	 *
-	 * contains the screen buffer (where the cursor may move),
-	 * and the scrollback buffer (which is invisible while not scrolled back)
+	 * the (2-dimensional) character content of the screen buffer
+	 * (where the cursor may move); the scrollback buffer is stored
+	 * in scrollback.
 	 *
 	 * thus, its size is always
-	 *   screen buffer size + scrollback buffer size
-	 *   (dims.x * dims.y + dims.x * scrollback_lines)
+	 *   screen buffer size (dims.x * dims.y)
 	 *
 	 * on resize, this buffer is completely re-created.
 	 *
 	 * the first entry of data is not neccesarily the first character of the
-	 * screen or scrollback buffer; see screen_chrdata.
+	 * screen buffer; see screen_chrdata.
 	 */
 	buf_char *chrdata;
 
@@ -350,7 +438,7 @@ public:
 	 * reasons.
 	 *
 	 * always has the value
-	 *   dims.x * (dims.y + scrollback_lines)
+	 *   dims.x * dims.y
 	 */
 	size_t chrdata_size;
 
@@ -367,7 +455,8 @@ public:
 	/**
 	 * points to the first character that belongs to the screen buffer,
 	 * inside the data buffer.
-	 * this pointer is changed when the terminal buffer advances one line.
+	 * this pointer is changed when the terminal buffer advances one line,
+	 * the line which was the top line is re-used as the bottom line.
 	 *
 	 * note that screen_chrdata may NOT be directly indexed, as *screen_chrdata[k]
 	 * might be >= chrdata_end. in this case, the correct memory location will
@@ -375,16 +464,12 @@ public:
 	 *
 	 * *screen_chrdata[0] always is the correct memory location of the screen
 	 * buffer top left corner.
-	 *
-	 * *screen_chrdata[dims.x * dims.y] is the memory location of the scrollback
-	 * buffer top left corner, but it might be neccesary to subtract
-	 * chrdata_size to get an actually valid memory location.
 	 */
 	buf_char *screen_chrdata;
 
 	/**
 	 * similar to how data holds information about all characters,
-	 * linedata holds information about all lines.
+	 * linedata holds information about all lines of the screen buffer.
 	 * currently, the only held information is whether the line has been started
 	 * by wrapping an existing line (and thus is not a 'real' new line)
 	 */
@@ -406,6 +491,35 @@ public:
 	 */
 	buf_line *screen_linedata;
 
+	/**
+	 * the lines which were advanced out of the screen buffer,
+	 * the oldest first. its last entry is the line above the screen.
+	 *
+	 * holds at most scrollback_lines lines, the lines above them are empty.
+	 */
+	std::deque<scrollback_line> scrollback;
+
+	/**
+	 * the expanded characters of the scrollback lines chrdataptr
+	 * returned lately, dims.y lines of dims.x characters.
+	 *
+	 * a line is expanded to the entry (line number % dims.y),
+	 * so the lines shown while scrolled back stay expanded.
+	 */
+	std::vector<buf_char> scrollback_view;
+
+	/**
+	 * the number (see lines_advanced) of the line expanded
+	 * to each line of scrollback_view, or -1.
+	 */
+	std::vector<int64_t> scrollback_view_lines;
+
+	/**
+	 * returned by linedataptr for the empty lines
+	 * above the stored scrollback lines.
+	 */
+	buf_line empty_linedata;
+
 	//following this line are all terminal size related variables
 
 	/**
@@ -492,6 +606,7 @@ public:
 	/**
 	 * how far it's currently possible to scroll back.
 	 * this value steadily increases when the buffer advances.
+	 * it is the number of lines in scrollback.
 	 *
 	 * if this is 0, all lines outside the screen buffer are empty.
 	 *
@@ -515,6 +630,27 @@ public:
 	 * must be >= 0 and <= scrollback_possible.
 	 */
 	coord::term_t scrollback_pos;
+
+	//following this line are all change tracking related variables
+
+	/**
+	 * how many lines the buffer has advanced since it was created.
+	 *
+	 * identifies lines while they move through the buffer:
+	 * line y of the screen buffer is line number lines_advanced + y.
+	 * scrolling doesn't change it.
+	 */
+	int64_t lines_advanced;
+
+	/**
+	 * the lines whose characters changed since take_dirty_lines
+	 * was called, in screen buffer coordinates: dirty_begin <= y < dirty_end.
+	 * when the buffer advances, they move up with their content.
+	 *
+	 * changes of the cursor position aren't tracked.
+	 */
+	coord::term_t dirty_begin;
+	coord::term_t dirty_end;
 };
 
 }} // openage::console
@@ -1,11 +1,15 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "console.h"
 
+#include <sstream>
+
 #include "../log/log.h"
 #include "../error/error.h"
+#include "../util/metrics.h"
 #include "../util/strings.h"
 #include "../util/unicode.h"
+#include "../unit/action_cost.h"
 #include "../engine.h"
 
 #include "draw.h"
@@ -141,6 +145,35 @@ void Console::interpret(const std::string &command) {
 			this->engine->get_cvar_manager().set(name,value);
 		}
 	}
+	else if (command == "costs start") {
+		action_costs_start();
+	}
+	else if (command == "costs stop") {
+		action_costs_stop();
+	}
+	else if (command == "costs") {
+		// the simulation time of each action and ability type
+		std::stringstream costs;
+		write_action_costs(costs);
+		for (std::string line; std::getline(costs, line);) {
+			this->write(line.c_str());
+		}
+	}
+	else if (command.substr(0,7) == "metrics") {
+		// the current values of the metrics, optionally
+		// only those starting with a prefix, e.g. "metrics path."
+		std::size_t first_space = command.find(" ");
+		std::string prefix;
+		if (first_space != std::string::npos) {
+			prefix = command.substr(first_space+1, std::string::npos);
+		}
+
+		std::stringstream values;
+		util::metrics().write_text(values, prefix);
+		for (std::string line; std::getline(values, line);) {
+			this->write(line.c_str());
+		}
+	}
 	else if (command.substr(0,3) == "get") {
 		std::size_t first_space = command.find(" ");
 		if (first_space != std::string::npos) {
@@ -166,7 +199,7 @@ bool Console::on_drawhud() {
 		return true;
 	}
 
-	draw::to_opengl(this->engine, this);
+	draw::to_opengl(this);
 
 	return true;
 }
@@ -1,11 +1,13 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <SDL2/SDL.h>
 
 #include "buf.h"
+#include "line_renderer.h"
 #include "../handlers.h"
 #include "../coord/camhud.h"
 #include "../input/input_manager.h"
@@ -71,6 +73,11 @@ public:
 	Buf buf;
 	renderer::Font font;
 
+	/**
+	 * draws the buffer, created with the first drawing.
+	 */
+	std::unique_ptr<LineRenderer> line_renderer;
+
 	input::InputContext input_context;
 
 	// the command state
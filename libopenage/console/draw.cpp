@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "draw.h"
 
@@ -6,89 +6,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <epoxy/gl.h>
+#include <memory>
+
 #include "../util/fds.h"
-#include "../util/timing.h"
 
 #include <unistd.h>
 
 #include "buf.h"
 #include "console.h"
-#include "../engine.h"
-#include "../renderer/text.h"
+#include "line_renderer.h"
 
 namespace openage {
 namespace console {
 namespace draw {
 
-void to_opengl(Engine *engine, Console *console) {
+void to_opengl(Console *console) {
 	coord::camhud topleft = {
 		console->bottomleft.x,
 		// TODO This should probably just be console->topright.y
 		console->bottomleft.y + console->charsize.y * console->buf.dims.y
 	};
-	coord::camhud chartopleft;
-	coord::pixel_t ascender = static_cast<coord::pixel_t>(console->font.get_ascender());
-
-	renderer::TextRenderer *text_renderer = engine->get_text_renderer();
-	text_renderer->set_font(&console->font);
-
-	int64_t monotime = timing::get_monotonic_time();
-
-	bool fastblinking_visible = (monotime % 600000000 < 300000000);
-	bool slowblinking_visible = (monotime % 300000000 < 150000000);
-
-	for (coord::term_t x = 0; x < console->buf.dims.x; x++) {
-		chartopleft.x = topleft.x + console->charsize.x * x;
-
-		for (coord::term_t y = 0; y < console->buf.dims.y; y++) {
-			chartopleft.y = topleft.y - console->charsize.y * y;
-			buf_char p = *(console->buf.chrdataptr({x, y - console->buf.scrollback_pos}));
 
-			int fgcolid, bgcolid;
-
-			bool cursor_visible_at_current_pos = (
-				console->buf.cursorpos == coord::term{x, y - console->buf.scrollback_pos}
-			);
-
-			cursor_visible_at_current_pos &= console->buf.cursor_visible;
-
-			if ((p.flags & CHR_NEGATIVE) xor cursor_visible_at_current_pos) {
-				bgcolid = p.fgcol;
-				fgcolid = p.bgcol;
-			} else {
-				bgcolid = p.bgcol;
-				fgcolid = p.fgcol;
-			}
-
-			if ((p.flags & CHR_INVISIBLE)
-			    or (p.flags & CHR_BLINKING and not slowblinking_visible)
-			    or (p.flags & CHR_BLINKINGFAST and not fastblinking_visible)) {
-				fgcolid = bgcolid;
-			}
-
-			console->termcolors[bgcolid].use(0.8);
-
-			glBegin(GL_QUADS);
-			{
-				glVertex3f(chartopleft.x, chartopleft.y, 0);
-				glVertex3f(chartopleft.x, chartopleft.y - console->charsize.y, 0);
-				glVertex3f(chartopleft.x + console->charsize.x, chartopleft.y - console->charsize.y, 0);
-				glVertex3f(chartopleft.x + console->charsize.x, chartopleft.y, 0);
-			}
-			glEnd();
-
-			console->termcolors[fgcolid].use(1);
-
-			char utf8buf[5];
-			if (util::utf8_encode(p.cp, utf8buf) == 0) {
-				//unrepresentable character (question mark in black rhombus)
-				text_renderer->draw(chartopleft.x, chartopleft.y - ascender, "\uFFFD");
-			} else {
-				text_renderer->draw(chartopleft.x, chartopleft.y - ascender, utf8buf);
-			}
-		}
+	if (not console->line_renderer) {
+		console->line_renderer = std::make_unique<LineRenderer>(
+			&console->font, console->charsize, &console->termcolors
+		);
 	}
+
+	console->line_renderer->draw(&console->buf, topleft);
 }
 
 void to_terminal(Buf *buf, util::FD *fd, bool clear) {
@@ -1,11 +1,8 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 namespace openage {
-
-class Engine;
-
 namespace util {
 class FD;
 } // openage::util
@@ -18,9 +15,10 @@ class Console;
 namespace draw {
 
 /**
- * experimental and totally inefficient opengl draw of a terminal buffer.
+ * opengl draw of the console's terminal buffer.
+ * only the lines that changed are built again.
  */
-void to_opengl(Engine *engine, Console *console);
+void to_opengl(Console *console);
 
 /**
  * very early and inefficient printing of the console to a pty.
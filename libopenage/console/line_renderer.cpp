@@ -0,0 +1,299 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "line_renderer.h"
+
+#include <cstddef>
+#include <epoxy/gl.h>
+
+#include "../render_command_list.h"
+#include "../renderer/font/font.h"
+#include "../renderer/font/glyph_atlas.h"
+#include "../renderer/text.h"
+#include "../util/timing.h"
+#include "../util/unicode.h"
+
+namespace openage {
+namespace console {
+
+namespace {
+
+struct background_vertex {
+	float x, y;
+	float r, g, b, a;
+};
+
+struct glyph_vertex {
+	float x, y;
+	float u, v;
+};
+
+} // anonymous namespace
+
+
+LineRenderer::LineRenderer(renderer::Font *font, coord::camhud charsize,
+                           const std::vector<util::col> *colors)
+	:
+	font{font},
+	charsize{charsize},
+	colors{colors},
+	cursor_line{-1},
+	cursor_x{0},
+	blinking_visible{true},
+	fastblinking_visible{true} {}
+
+
+LineRenderer::~LineRenderer() {
+	for (auto &line : this->lines) {
+		glDeleteBuffers(1, &line.second.vbo);
+	}
+}
+
+
+void LineRenderer::draw(Buf *buf, coord::camhud topleft) {
+	int64_t monotime = timing::get_monotonic_time();
+	bool fastblinking_visible = (monotime % 600000000 < 300000000);
+	bool blinking_visible = (monotime % 300000000 < 150000000);
+
+	std::pair<coord::term_t, coord::term_t> dirty = buf->take_dirty_lines();
+	int64_t dirty_begin = buf->lines_advanced + dirty.first;
+	int64_t dirty_end = buf->lines_advanced + dirty.second;
+
+	int64_t cursor_line = buf->cursor_visible ? buf->lines_advanced + buf->cursorpos.y : -1;
+	coord::term_t cursor_x = buf->cursorpos.x;
+	bool cursor_moved = (cursor_line != this->cursor_line or cursor_x != this->cursor_x);
+	bool blinked = (blinking_visible != this->blinking_visible
+	                or fastblinking_visible != this->fastblinking_visible);
+
+	// the lines shown, from the top
+	int64_t first = buf->lines_advanced - buf->scrollback_pos;
+	coord::term_t count = buf->dims.y;
+
+	std::vector<line_content> changed;
+	std::unordered_map<int64_t, shown_line> shown;
+
+	for (coord::term_t y = 0; y < count; y++) {
+		int64_t number = first + y;
+		auto it = this->shown.find(number);
+
+		bool build = (
+			it == this->shown.end()
+			or (number >= dirty_begin and number < dirty_end)
+			or (cursor_moved and (number == cursor_line or number == this->cursor_line))
+			or (blinked and it->second.has_blinking)
+		);
+
+		if (not build) {
+			shown.emplace(number, it->second);
+			continue;
+		}
+
+		// the characters of a line are contiguous
+		const buf_char *chars = buf->chrdataptr({0, (coord::term_t) (y - buf->scrollback_pos)});
+
+		line_content content;
+		content.number = number;
+		content.chars.assign(chars, chars + buf->dims.x);
+		content.cursor_x = (number == cursor_line) ? cursor_x : -1;
+		content.blinking_visible = blinking_visible;
+		content.fastblinking_visible = fastblinking_visible;
+
+		bool has_blinking = false;
+		for (auto &chr : content.chars) {
+			has_blinking |= (chr.flags & (CHR_BLINKING | CHR_BLINKINGFAST)) != 0;
+		}
+
+		shown.emplace(number, shown_line{has_blinking});
+		changed.push_back(std::move(content));
+	}
+
+	this->shown = std::move(shown);
+	this->cursor_line = cursor_line;
+	this->cursor_x = cursor_x;
+	this->blinking_visible = blinking_visible;
+	this->fastblinking_visible = fastblinking_visible;
+
+	auto changed_lines = std::make_shared<std::vector<line_content>>(std::move(changed));
+	RenderCommandList::submit([this, changed_lines, first, count, topleft] {
+		this->render(*changed_lines, first, count, topleft);
+	});
+}
+
+
+void LineRenderer::render(const std::vector<line_content> &changed, int64_t first, coord::term_t count,
+                          coord::camhud topleft) {
+	if (not this->glyph_atlas) {
+		// a single page, glyphs of other lines are evicted when it's full
+		this->glyph_atlas = std::make_unique<renderer::GlyphAtlas>(1024, 1024, 1);
+	}
+	this->glyph_atlas->next_frame();
+
+	// forget the lines that are out of view
+	for (auto it = this->lines.begin(); it != this->lines.end();) {
+		if (it->first < first or it->first >= first + count) {
+			glDeleteBuffers(1, &it->second.vbo);
+			it = this->lines.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	unsigned int generation = this->glyph_atlas->get_generation();
+	for (auto &content : changed) {
+		line_vertices &line = this->lines[content.number];
+		line.content = content;
+		this->build(line.content, line);
+	}
+
+	// making room in the atlas moves glyphs,
+	// the lines that weren't built have to get theirs again
+	for (int attempt = 0; attempt < 2 and generation != this->glyph_atlas->get_generation(); attempt++) {
+		generation = this->glyph_atlas->get_generation();
+		for (auto &it : this->lines) {
+			this->build(it.second.content, it.second);
+		}
+	}
+
+	// the backgrounds first, the glyphs are drawn over them
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	for (auto &it : this->lines) {
+		const line_vertices &line = it.second;
+
+		glBindBuffer(GL_ARRAY_BUFFER, line.vbo);
+		glVertexPointer(2, GL_FLOAT, sizeof(background_vertex), (GLvoid *) offsetof(background_vertex, x));
+		glColorPointer(4, GL_FLOAT, sizeof(background_vertex), (GLvoid *) offsetof(background_vertex, r));
+
+		glPushMatrix();
+		glTranslatef(topleft.x, topleft.y - this->charsize.y * (it.first - first), 0);
+		glDrawArrays(GL_QUADS, 0, line.background_count);
+		glPopMatrix();
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glColor4f(1.0, 1.0, 1.0, 1.0);
+
+	texturefont_shader::program->use();
+	this->glyph_atlas->bind(0);
+	glUniform4f(texturefont_shader::color, 1.0, 1.0, 1.0, 1.0);
+	glVertexAttrib4f(texturefont_shader::vertex_color, 1.0, 1.0, 1.0, 1.0);
+
+	glEnableVertexAttribArray(texturefont_shader::program->pos_id);
+	glEnableVertexAttribArray(texturefont_shader::tex_coord);
+
+	for (auto &it : this->lines) {
+		const line_vertices &line = it.second;
+		if (line.glyph_count == 0) {
+			continue;
+		}
+
+		// the glyphs are stored behind the backgrounds
+		size_t offset = line.background_count * sizeof(background_vertex);
+
+		glBindBuffer(GL_ARRAY_BUFFER, line.vbo);
+		glVertexAttribPointer(texturefont_shader::program->pos_id, 2, GL_FLOAT, GL_FALSE,
+			sizeof(glyph_vertex), (GLvoid *) (offset + offsetof(glyph_vertex, x)));
+		glVertexAttribPointer(texturefont_shader::tex_coord, 2, GL_FLOAT, GL_FALSE,
+			sizeof(glyph_vertex), (GLvoid *) (offset + offsetof(glyph_vertex, u)));
+
+		glPushMatrix();
+		glTranslatef(topleft.x, topleft.y - this->charsize.y * (it.first - first), 0);
+		glDrawArrays(GL_QUADS, 0, line.glyph_count);
+		glPopMatrix();
+	}
+
+	glDisableVertexAttribArray(texturefont_shader::program->pos_id);
+	glDisableVertexAttribArray(texturefont_shader::tex_coord);
+
+	texturefont_shader::program->stopusing();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void LineRenderer::build(const line_content &content, line_vertices &line) {
+	std::vector<background_vertex> backgrounds;
+	std::vector<glyph_vertex> glyph_vertices;
+	backgrounds.reserve(content.chars.size() * 4);
+
+	// the line's top left corner is the origin
+	float ascender = this->font->get_ascender();
+	float height = this->charsize.y;
+
+	for (size_t x = 0; x < content.chars.size(); x++) {
+		const buf_char &p = content.chars[x];
+
+		bool cursor_visible_at_current_pos = (content.cursor_x == (coord::term_t) x);
+
+		// the glyphs are drawn in one color, only the background is inverted
+		int bgcolid = ((p.flags & CHR_NEGATIVE) xor cursor_visible_at_current_pos) ? p.fgcol : p.bgcol;
+
+		bool invisible = ((p.flags & CHR_INVISIBLE)
+		                  or (p.flags & CHR_BLINKING and not content.blinking_visible)
+		                  or (p.flags & CHR_BLINKINGFAST and not content.fastblinking_visible));
+
+		float x0 = this->charsize.x * x;
+		float x1 = x0 + this->charsize.x;
+		const util::col &bgcolor = (*this->colors)[bgcolid];
+		float r = bgcolor.r / 255.f, g = bgcolor.g / 255.f, b = bgcolor.b / 255.f, a = 0.8;
+
+		backgrounds.push_back({x0, 0, r, g, b, a});
+		backgrounds.push_back({x0, -height, r, g, b, a});
+		backgrounds.push_back({x1, -height, r, g, b, a});
+		backgrounds.push_back({x1, 0, r, g, b, a});
+
+		if (invisible or p.cp == ' ') {
+			continue;
+		}
+
+		auto glyphs = this->glyphs.find(p.cp);
+		if (glyphs == this->glyphs.end()) {
+			char utf8buf[5];
+			if (util::utf8_encode(p.cp, utf8buf) == 0) {
+				//unrepresentable character (question mark in black rhombus)
+				glyphs = this->glyphs.emplace(p.cp, this->font->get_glyphs("\uFFFD")).first;
+			} else {
+				glyphs = this->glyphs.emplace(p.cp, this->font->get_glyphs(utf8buf)).first;
+			}
+		}
+
+		float pen_x = x0;
+		float pen_y = -ascender;
+		for (auto glyph : glyphs->second) {
+			renderer::GlyphAtlas::Entry entry = this->glyph_atlas->get(this->font, glyph);
+
+			float gx0 = pen_x + entry.glyph.x_offset;
+			float gy0 = pen_y + entry.glyph.y_offset - entry.glyph.height;
+			float gx1 = gx0 + entry.glyph.width;
+			float gy1 = gy0 + entry.glyph.height;
+
+			glyph_vertices.push_back({gx0, gy0, entry.u0, entry.v0});
+			glyph_vertices.push_back({gx0, gy1, entry.u0, entry.v1});
+			glyph_vertices.push_back({gx1, gy1, entry.u1, entry.v1});
+			glyph_vertices.push_back({gx1, gy0, entry.u1, entry.v0});
+
+			pen_x += entry.glyph.x_advance;
+			pen_y += entry.glyph.y_advance;
+		}
+	}
+
+	size_t background_size = backgrounds.size() * sizeof(background_vertex);
+	size_t glyph_size = glyph_vertices.size() * sizeof(glyph_vertex);
+
+	if (line.vbo == 0) {
+		glGenBuffers(1, &line.vbo);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, line.vbo);
+	glBufferData(GL_ARRAY_BUFFER, background_size + glyph_size, nullptr, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, background_size, backgrounds.data());
+	if (glyph_size > 0) {
+		glBufferSubData(GL_ARRAY_BUFFER, background_size, glyph_size, glyph_vertices.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	line.background_count = backgrounds.size();
+	line.glyph_count = glyph_vertices.size();
+}
+
+}} // openage::console
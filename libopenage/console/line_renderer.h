@@ -0,0 +1,117 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/camhud.h"
+#include "../coord/term.h"
+#include "../util/color.h"
+#include "buf.h"
+
+namespace openage {
+
+namespace renderer {
+class Font;
+class GlyphAtlas;
+} // openage::renderer
+
+namespace console {
+
+/**
+ * Draws the lines of a console buffer with OpenGL, and keeps the
+ * vertices of each shown line in a buffer object until the line changes.
+ *
+ * Lines are identified by their number in the buffer (see Buf::lines_advanced),
+ * so lines that move because of scrolling or new output are just drawn
+ * at another offset. Only lines that changed, or came into view, are
+ * built again.
+ */
+class LineRenderer {
+public:
+	LineRenderer(renderer::Font *font, coord::camhud charsize,
+	             const std::vector<util::col> *colors);
+	~LineRenderer();
+
+	LineRenderer(const LineRenderer &) = delete;
+	LineRenderer &operator =(const LineRenderer &) = delete;
+
+	/**
+	 * submits the drawing of the shown lines of the buffer to the frame's
+	 * render commands, with the top left corner at the given position.
+	 * the changed lines of the buffer are taken.
+	 */
+	void draw(Buf *buf, coord::camhud topleft);
+
+private:
+	/**
+	 * the characters of a line, as copied for building its vertices.
+	 */
+	struct line_content {
+		int64_t number;
+		std::vector<buf_char> chars;
+
+		/** column of the visible cursor, -1 if it's not on the line */
+		coord::term_t cursor_x;
+
+		bool blinking_visible;
+		bool fastblinking_visible;
+	};
+
+	/**
+	 * the built vertices of a line, and what they were built from.
+	 */
+	struct line_vertices {
+		line_content content;
+		unsigned int vbo = 0;
+		int background_count = 0;
+		int glyph_count = 0;
+	};
+
+	/**
+	 * the line a main thread draw state refers to.
+	 */
+	struct shown_line {
+		bool has_blinking;
+	};
+
+	/**
+	 * builds the changed lines and draws all shown lines.
+	 * runs with the render commands.
+	 */
+	void render(const std::vector<line_content> &changed, int64_t first, coord::term_t count,
+	            coord::camhud topleft);
+
+	/**
+	 * fills the buffer object of a line with its
+	 * background quads and glyph quads.
+	 */
+	void build(const line_content &content, line_vertices &line);
+
+	renderer::Font *font;
+	coord::camhud charsize;
+	const std::vector<util::col> *colors;
+
+	// state of the main thread: what the render commands will show
+
+	std::unordered_map<int64_t, shown_line> shown;
+	int64_t cursor_line;
+	coord::term_t cursor_x;
+	bool blinking_visible;
+	bool fastblinking_visible;
+
+	// state of the render commands
+
+	std::unordered_map<int64_t, line_vertices> lines;
+	std::unique_ptr<renderer::GlyphAtlas> glyph_atlas;
+
+	/**
+	 * the shaped glyphs of each codepoint that was drawn.
+	 */
+	std::unordered_map<int, std::vector<unsigned int>> glyphs;
+};
+
+}} // openage::console
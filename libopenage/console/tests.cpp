@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include <vector>
 #include <string>
@@ -13,6 +13,7 @@
 
 #include "../log/log.h"
 #include "../error/error.h"
+#include "../testing/testing.h"
 
 #include "buf.h"
 #include "console.h"
@@ -29,7 +30,7 @@ int max(int a, int b) {
 }
 
 
-// TODO: test for console coordinates and resizing
+// TODO: test for console coordinates
 
 
 void render() {
@@ -48,6 +49,155 @@ void render() {
 }
 
 
+// exported test
+void dirty_lines() {
+	console::Buf buf{{20, 5}, 10, 20};
+
+	// creating the buffer cleared everything
+	auto dirty = buf.take_dirty_lines();
+	TESTEQUALS(dirty.first, -10);
+	TESTEQUALS(dirty.second, 5);
+
+	dirty = buf.take_dirty_lines();
+	dirty.first >= dirty.second or TESTFAIL;
+
+	// sgr codes and cursor movement change no characters
+	buf.write("\x1b[31m\x1b[3;1H");
+	dirty = buf.take_dirty_lines();
+	dirty.first >= dirty.second or TESTFAIL;
+
+	buf.write("a");
+	dirty = buf.take_dirty_lines();
+	TESTEQUALS(dirty.first, 2);
+	TESTEQUALS(dirty.second, 3);
+
+	// the written line moves up when the buffer advances,
+	// and the new bottom line is cleared
+	buf.write("\x1b[5;1Hb");
+	buf.write("\x1b[2;1Hc\x1b[5;1H\n");
+	TESTEQUALS(buf.lines_advanced, 1);
+	dirty = buf.take_dirty_lines();
+	TESTEQUALS(dirty.first, 0);
+	TESTEQUALS(dirty.second, 5);
+
+	// advancing alone changes the new line only
+	buf.write("\n");
+	TESTEQUALS(buf.lines_advanced, 2);
+	dirty = buf.take_dirty_lines();
+	TESTEQUALS(dirty.first, 4);
+	TESTEQUALS(dirty.second, 5);
+
+	// scrolling changes no lines
+	buf.scroll(2);
+	dirty = buf.take_dirty_lines();
+	dirty.first >= dirty.second or TESTFAIL;
+
+	// erasing the display changes the screen
+	buf.write("\x1b[2J");
+	dirty = buf.take_dirty_lines();
+	TESTEQUALS(dirty.first, 0);
+	TESTEQUALS(dirty.second, 5);
+}
+
+
+// exported test
+void bulk_write() {
+	// wrapped lines, escape sequences, a multi-byte char split
+	// between writes, and chars after the stale last column state
+	std::vector<std::string> input{
+		"a line which is longer than the width of the terminal\n",
+		"\x1b[1mbold\x1b[m\tafter tab\r\n\xe2\x82",
+		"\xac euro sign\n",
+		"exactly 20 chars....",
+		"\x08\x08" "ab and more\n\n\n\n\n\n",
+	};
+
+	console::Buf bytewise{{20, 5}, 10, 20};
+	console::Buf bulk{{20, 5}, 10, 20};
+
+	for (auto &text : input) {
+		for (char c : text) {
+			bytewise.write(c);
+		}
+		bulk.write(text.c_str(), text.size());
+	}
+
+	TESTEQUALS(bulk.cursorpos.x, bytewise.cursorpos.x);
+	TESTEQUALS(bulk.cursorpos.y, bytewise.cursorpos.y);
+	TESTEQUALS(bulk.cursor_special_lastcol, bytewise.cursor_special_lastcol);
+
+	for (coord::term_t y = -10; y < 5; y++) {
+		TESTEQUALS(bulk.linedataptr(y)->type, bytewise.linedataptr(y)->type);
+		for (coord::term_t x = 0; x < 20; x++) {
+			TESTEQUALS(bulk.chrdataptr({x, y})->cp, bytewise.chrdataptr({x, y})->cp);
+			TESTEQUALS(bulk.chrdataptr({x, y})->flags, bytewise.chrdataptr({x, y})->flags);
+		}
+	}
+}
+
+
+// exported test
+void scrollback() {
+	console::Buf buf{{20, 5}, 10, 20};
+
+	// formatted, wrapped and multi-byte chars leave the screen
+	buf.write("plain\n");
+	buf.write("\x1b[1;31mbold red\x1b[m and \xe2\x82\xac\n");
+	buf.write("a line which is longer than the width\n");
+	buf.write("\n\n\n\n\n");
+
+	TESTEQUALS(buf.scrollback_possible, 5);
+	TESTEQUALS(buf.scrollback.size(), 5u);
+
+	const buf_char *line = buf.chrdataptr({0, -5});
+	TESTEQUALS(line[0].cp, 'p');
+	TESTEQUALS(line[4].cp, 'n');
+	(line[5] == buf.default_char_fmt) or TESTFAIL;
+	TESTEQUALS(buf.linedataptr(-5)->type, LINE_REGULAR);
+
+	// only the text is stored, with one run per format
+	TESTEQUALS(buf.scrollback[0].text, "plain");
+	TESTEQUALS(buf.scrollback[0].runs.size(), 1u);
+	TESTEQUALS(buf.scrollback[1].runs.size(), 2u);
+	TESTEQUALS(buf.scrollback[4].text.size(), 0u);
+
+	line = buf.chrdataptr({0, -4});
+	TESTEQUALS(line[0].cp, 'b');
+	TESTEQUALS(line[0].fgcol, 1);
+	TESTEQUALS(line[0].flags, CHR_BOLD);
+	TESTEQUALS(line[8].flags, 0);
+	TESTEQUALS(line[13].cp, 0x20ac);
+
+	TESTEQUALS(buf.linedataptr(-3)->type, LINE_WRAPPED);
+	TESTEQUALS(buf.chrdataptr({0, -2})->cp, 'e');
+
+	// the oldest lines are dropped
+	buf.write("\n\n\n\n\n\n\n");
+	TESTEQUALS(buf.scrollback_possible, 10);
+	TESTEQUALS(buf.chrdataptr({0, -10})->cp, 'a');
+
+	// clearing parts of the scrollback buffer
+	buf.clear({1, -10}, {0, -9});
+	TESTEQUALS(buf.chrdataptr({0, -10})->cp, 'a');
+	TESTEQUALS(buf.chrdataptr({2, -10})->cp, ' ');
+	TESTEQUALS(buf.chrdataptr({0, -9})->cp, 'e');
+	TESTEQUALS(buf.linedataptr(-10)->type, LINE_WRAPPED);
+
+	// resizing keeps the cursor line on the screen,
+	// the lines above it are scrolled out
+	buf.write("\x1b[1;1Htop\x1b[5;1Hlast");
+	buf.resize({30, 2});
+	TESTEQUALS(buf.cursorpos.y, 1);
+	TESTEQUALS(buf.chrdataptr({0, 1})->cp, 'l');
+	TESTEQUALS(buf.chrdataptr({0, -3})->cp, 't');
+	(*buf.chrdataptr({25, -3}) == buf.default_char_fmt) or TESTFAIL;
+
+	buf.reset();
+	TESTEQUALS(buf.scrollback_possible, 0);
+	(*buf.chrdataptr({0, -1}) == buf.default_char_fmt) or TESTFAIL;
+}
+
+
 void interactive() {
 	#ifndef _WIN32
 
@@ -89,7 +239,8 @@ void interactive() {
 	// set amaster to auto-close
 	ptyout.close_on_destroy = true;
 
-	constexpr int rdbuf_size = 4096;
+	// large reads, the output is written to the buffer in bulk
+	constexpr int rdbuf_size = 65536;
 	char rdbuf[rdbuf_size];
 
 	int nfds = max(termin.fd, ptyin.fd) + 1;
@@ -155,9 +306,7 @@ void interactive() {
 					loop = false;
 					break;
 				default:
-					for(int i = 0; i < retval; i++) {
-						buf.write(rdbuf[i]);
-					}
+					buf.write(rdbuf, retval);
 				}
 			}
 			break;
@@ -0,0 +1,204 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "drs.h"
+
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace convert {
+
+namespace {
+
+// the archives of FILE_VERSION 57, as the python reader
+constexpr size_t copyright_size = 40;
+constexpr size_t header_size = copyright_size + 4 + 12 + 4 + 4;
+constexpr size_t table_info_size = 12;
+constexpr size_t file_info_size = 12;
+
+
+uint32_t get_u32(const uint8_t *data) {
+	return (uint32_t{data[0]} <<  0) | (uint32_t{data[1]} <<  8) |
+	       (uint32_t{data[2]} << 16) | (uint32_t{data[3]} << 24);
+}
+
+
+/**
+ * the header strings are padded with nul bytes.
+ */
+std::string get_string(const uint8_t *data, size_t size) {
+	const char *begin = reinterpret_cast<const char *>(data);
+	return std::string{begin, strnlen(begin, size)};
+}
+
+} // anonymous namespace
+
+
+DRSFile::DRSFile(const std::string &filename)
+	:
+	data{nullptr},
+	size{0},
+	mapping{nullptr} {
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw Error(MSG(err) << "Could not open DRS archive " << filename);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 or st.st_size < static_cast<off_t>(header_size)) {
+		close(fd);
+		throw Error(MSG(err) << "DRS archive is too small: " << filename);
+	}
+
+	this->size = st.st_size;
+	this->mapping = mmap(nullptr, this->size, PROT_READ, MAP_SHARED, fd, 0);
+
+	// the mapping stays valid without the descriptor
+	close(fd);
+
+	if (this->mapping == MAP_FAILED) {
+		this->mapping = nullptr;
+		throw Error(MSG(err) << "Could not map DRS archive " << filename);
+	}
+
+	this->data = static_cast<const uint8_t *>(this->mapping);
+
+	try {
+		this->read_tables(filename);
+	}
+	catch (...) {
+		this->unmap();
+		throw;
+	}
+}
+
+
+DRSFile::DRSFile(const uint8_t *data, size_t size)
+	:
+	data{data},
+	size{size},
+	mapping{nullptr} {
+
+	this->read_tables("in memory");
+}
+
+
+DRSFile::~DRSFile() {
+	this->unmap();
+}
+
+
+void DRSFile::unmap() {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->size);
+		this->mapping = nullptr;
+	}
+}
+
+
+void DRSFile::read_tables(const std::string &source) {
+	if (this->size < header_size) {
+		throw Error(MSG(err) << "Truncated header in DRS archive " << source);
+	}
+
+	const uint8_t *header = this->data;
+	this->copyright = get_string(header, copyright_size);
+	this->version = get_string(header + copyright_size, 4);
+	this->type = get_string(header + copyright_size + 4, 12);
+
+	// the copyright is padded with spaces as well
+	size_t copyright_end = this->copyright.find_last_not_of(' ');
+	this->copyright.erase(copyright_end == std::string::npos ? 0 : copyright_end + 1);
+
+	uint32_t table_count = get_u32(header + copyright_size + 16);
+	if (header_size + uint64_t{table_count} * table_info_size > this->size) {
+		throw Error(MSG(err) << "Truncated table list in DRS archive " << source);
+	}
+
+	for (uint32_t table = 0; table < table_count; table++) {
+		const uint8_t *info = this->data + header_size + table * table_info_size;
+
+		// the extension is stored reversed
+		std::string extension;
+		for (size_t i = 3; i-- > 0;) {
+			extension.push_back(std::tolower(info[1 + i]));
+		}
+
+		uint32_t info_offset = get_u32(info + 4);
+		uint32_t file_count = get_u32(info + 8);
+		if (info_offset + uint64_t{file_count} * file_info_size > this->size) {
+			throw Error(MSG(err) << "Truncated " << extension << " table in DRS archive " << source);
+		}
+
+		for (uint32_t file = 0; file < file_count; file++) {
+			const uint8_t *file_info = this->data + info_offset + file * file_info_size;
+
+			drs_member member;
+			member.id = get_u32(file_info);
+			member.offset = get_u32(file_info + 4);
+			member.size = get_u32(file_info + 8);
+			member.name = std::to_string(member.id) + "." + extension;
+
+			if (uint64_t{member.offset} + member.size > this->size) {
+				throw Error(MSG(err) << "Member " << member.name << " exceeds DRS archive " << source);
+			}
+
+			// a later table's entry replaces one of the same name
+			this->names[member.name] = this->members.size();
+			this->members.push_back(std::move(member));
+		}
+	}
+}
+
+
+const std::string &DRSFile::get_copyright() const {
+	return this->copyright;
+}
+
+
+const std::string &DRSFile::get_version() const {
+	return this->version;
+}
+
+
+const std::string &DRSFile::get_type() const {
+	return this->type;
+}
+
+
+size_t DRSFile::get_member_count() const {
+	return this->members.size();
+}
+
+
+const drs_member &DRSFile::get_member(size_t index) const {
+	if (index >= this->members.size()) {
+		throw Error(MSG(err) << "DRS member index " << index << " out of range");
+	}
+	return this->members[index];
+}
+
+
+const drs_member *DRSFile::find(const std::string &name) const {
+	auto it = this->names.find(name);
+	if (it == this->names.end()) {
+		return nullptr;
+	}
+	return &this->members[it->second];
+}
+
+
+const uint8_t *DRSFile::get_data(const drs_member &member) const {
+	return this->data + member.offset;
+}
+
+
+}} // openage::convert
@@ -0,0 +1,118 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libc.stdint cimport uint8_t, uint32_t
+// pxd: from libcpp.string cimport string
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace openage {
+namespace convert {
+
+
+/**
+ * One file stored in a DRS archive.
+ *
+ * pxd:
+ *
+ * cppclass drs_member:
+ *     string name
+ *     uint32_t id
+ *     uint32_t offset
+ *     uint32_t size
+ */
+struct drs_member {
+	std::string name;    //!< "<id>.<extension>", as the archives store no names
+	uint32_t id;
+	uint32_t offset;     //!< position of the data in the archive
+	uint32_t size;
+};
+
+
+/**
+ * A Genie DRS archive, see doc/media/drs-files.
+ *
+ * The archive is mapped into memory and its tables are parsed once.
+ * The members are handed out as pointers into the mapping, so they are
+ * not copied and may be read by several threads at once.
+ *
+ * pxd:
+ *
+ * cppclass DRSFile:
+ *     DRSFile(const string &filename) except +
+ *     DRSFile(const uint8_t *data, size_t size) except +
+ *
+ *     const string &get_copyright()
+ *     const string &get_version()
+ *     const string &get_type()
+ *
+ *     size_t get_member_count()
+ *     const drs_member &get_member(size_t index) except +
+ *     const drs_member *find(const string &name)
+ *
+ *     const uint8_t *get_data(const drs_member &member)
+ */
+class DRSFile {
+public:
+	/**
+	 * map the archive file.
+	 * throws an Error if it can't be read or the tables are invalid.
+	 */
+	DRSFile(const std::string &filename);
+
+	/**
+	 * use an archive in memory, which stays owned by the caller.
+	 */
+	DRSFile(const uint8_t *data, size_t size);
+
+	~DRSFile();
+
+	DRSFile(const DRSFile &) = delete;
+	DRSFile &operator =(const DRSFile &) = delete;
+
+	const std::string &get_copyright() const;
+	const std::string &get_version() const;
+	const std::string &get_type() const;
+
+	/**
+	 * members in the order of the archive's tables.
+	 */
+	size_t get_member_count() const;
+	const drs_member &get_member(size_t index) const;
+
+	/**
+	 * the member with the given "<id>.<extension>" name,
+	 * nullptr if the archive doesn't contain it.
+	 */
+	const drs_member *find(const std::string &name) const;
+
+	/**
+	 * the member's size bytes, valid as long as the archive.
+	 */
+	const uint8_t *get_data(const drs_member &member) const;
+
+private:
+	void read_tables(const std::string &source);
+	void unmap();
+
+	const uint8_t *data;
+	size_t size;
+
+	// set if the archive was mapped by us
+	void *mapping;
+
+	std::string copyright;
+	std::string version;
+	std::string type;
+
+	std::vector<drs_member> members;
+	std::unordered_map<std::string, size_t> names;
+};
+
+
+}} // openage::convert
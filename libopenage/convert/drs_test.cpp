@@ -0,0 +1,98 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "drs.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace convert {
+namespace tests {
+
+namespace {
+
+void put_u32(std::vector<uint8_t> &data, size_t pos, uint32_t value) {
+	for (size_t i = 0; i < 4; i++) {
+		data[pos + i] = (value >> (8 * i)) & 0xff;
+	}
+}
+
+
+/**
+ * a drs archive with a "slp" table of two files and a "wav" table of one.
+ */
+std::vector<uint8_t> make_drs() {
+	std::vector<uint8_t> data(64 + 2 * 12 + 3 * 12);
+	memcpy(&data[0], "Copyright (c) 1997 Ensemble Studios.", 36);
+	memset(&data[36], ' ', 4);
+	memcpy(&data[40], "1.00", 4);
+	memcpy(&data[44], "tribe", 5);
+	put_u32(data, 56, 2);
+	put_u32(data, 60, data.size());
+
+	memcpy(&data[64], "BPLS", 4);
+	data[64] = 'a';
+	put_u32(data, 68, 64 + 24);
+	put_u32(data, 72, 2);
+
+	memcpy(&data[77], "VAW", 3);
+	data[76] = 'x';
+	put_u32(data, 80, 64 + 24 + 24);
+	put_u32(data, 84, 1);
+
+	std::vector<std::pair<uint32_t, std::string>> files{
+		{50500, "first"}, {50501, "second"}, {7, "sound"},
+	};
+
+	for (size_t i = 0; i < files.size(); i++) {
+		size_t info = 64 + 24 + i * 12;
+		put_u32(data, info + 0, files[i].first);
+		put_u32(data, info + 4, data.size());
+		put_u32(data, info + 8, files[i].second.size());
+		data.insert(data.end(), files[i].second.begin(), files[i].second.end());
+	}
+
+	return data;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void drs() {
+	std::vector<uint8_t> data = make_drs();
+
+	DRSFile drs{data.data(), data.size()};
+	drs.get_copyright() == "Copyright (c) 1997 Ensemble Studios." or TESTFAIL;
+	drs.get_version() == "1.00" or TESTFAIL;
+	drs.get_type() == "tribe" or TESTFAIL;
+	drs.get_member_count() == 3 or TESTFAIL;
+
+	const drs_member &first = drs.get_member(0);
+	(first.name == "50500.slp" and first.id == 50500 and first.size == 5) or TESTFAIL;
+	drs.get_member(2).name == "7.wav" or TESTFAIL;
+	TESTTHROWS(drs.get_member(3));
+
+	const drs_member *second = drs.find("50501.slp");
+	second != nullptr or TESTFAIL;
+	(second->size == 6 and memcmp(drs.get_data(*second), "second", 6) == 0) or TESTFAIL;
+
+	// the members point into the archive
+	drs.get_data(*drs.find("7.wav")) == &data[data.size() - 5] or TESTFAIL;
+	drs.find("50502.slp") == nullptr or TESTFAIL;
+
+	// truncated tables and members
+	for (size_t size : std::vector<size_t>{40, 80, 100, data.size() - 1}) {
+		TESTTHROWS((DRSFile{data.data(), size}));
+	}
+
+	TESTTHROWS(DRSFile{"/nonexistant/archive.drs"});
+}
+
+
+}}} // openage::convert::tests
@@ -0,0 +1,319 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "opus_encode.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <opus.h>
+
+#include "../audio/resampler.h"
+#include "../error/error.h"
+
+namespace openage {
+namespace convert {
+
+namespace {
+
+/** opus always runs at 48 kHz */
+constexpr int opus_rate = 48000;
+
+/** 20 ms frames */
+constexpr int frame_size = 960;
+
+/** the largest packet libopus is asked to write */
+constexpr int max_packet_size = 4000;
+
+/** the packets are put into pages of about one second */
+constexpr size_t packets_per_page = 50;
+
+/** the serial number of the only logical stream in the files */
+constexpr uint32_t stream_serial = 0x6f706e67;
+
+
+uint32_t read_u32(const uint8_t *data) {
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (uint32_t{data[3]} << 24);
+}
+
+
+uint16_t read_u16(const uint8_t *data) {
+	return data[0] | (data[1] << 8);
+}
+
+
+template<typename T>
+void append_le(std::string &out, T value) {
+	for (size_t i = 0; i < sizeof(T); i++) {
+		out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+	}
+}
+
+
+/**
+ * the checksum of ogg pages: crc32 with the polynomial 0x04c11db7,
+ * without reflection or final xor.
+ */
+uint32_t ogg_crc(const std::string &data) {
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> result;
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i << 24;
+			for (int bit = 0; bit < 8; bit++) {
+				crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+			}
+			result[i] = crc;
+		}
+		return result;
+	}();
+
+	uint32_t crc = 0;
+	for (char c : data) {
+		crc = (crc << 8) ^ table[((crc >> 24) ^ static_cast<uint8_t>(c)) & 0xff];
+	}
+	return crc;
+}
+
+
+/**
+ * writes the packets of one opus stream into ogg pages.
+ * libogg is not needed for this one stream.
+ */
+class OggWriter {
+public:
+	explicit OggWriter(std::string &out)
+		:
+		out{out} {}
+
+	/**
+	 * the granule position is the sample count at the end of the packet,
+	 * a page stores the one of the last packet that ends on it.
+	 */
+	void add_packet(const uint8_t *data, size_t size, uint64_t granule) {
+		// 255 segments are the most one page can have
+		if (this->segments.size() + size / 255 + 1 > 255) {
+			this->flush_page(false);
+		}
+
+		for (size_t rest = size; ; rest -= 255) {
+			if (rest < 255) {
+				this->segments.push_back(rest);
+				break;
+			}
+			this->segments.push_back(255);
+		}
+		this->body.append(reinterpret_cast<const char *>(data), size);
+		this->packet_count += 1;
+		this->granule = granule;
+	}
+
+	void flush_page(bool last) {
+		std::string page = "OggS";
+		page.push_back(0);
+
+		uint8_t flags = 0;
+		if (this->sequence == 0) {
+			flags |= 0x02;
+		}
+		if (last) {
+			flags |= 0x04;
+		}
+		page.push_back(flags);
+
+		append_le<uint64_t>(page, this->granule);
+		append_le<uint32_t>(page, stream_serial);
+		append_le<uint32_t>(page, this->sequence);
+
+		size_t crc_position = page.size();
+		append_le<uint32_t>(page, 0);
+
+		page.push_back(static_cast<char>(this->segments.size()));
+		for (uint8_t segment : this->segments) {
+			page.push_back(static_cast<char>(segment));
+		}
+		page += this->body;
+
+		uint32_t crc = ogg_crc(page);
+		for (size_t i = 0; i < 4; i++) {
+			page[crc_position + i] = static_cast<char>((crc >> (8 * i)) & 0xff);
+		}
+
+		this->out += page;
+		this->sequence += 1;
+		this->segments.clear();
+		this->body.clear();
+		this->packet_count = 0;
+	}
+
+	size_t get_packet_count() const {
+		return this->packet_count;
+	}
+
+private:
+	std::string &out;
+	std::vector<uint8_t> segments;
+	std::string body;
+	size_t packet_count = 0;
+	uint32_t sequence = 0;
+	uint64_t granule = 0;
+};
+
+
+struct encoder_deleter {
+	void operator ()(OpusEncoder *encoder) const {
+		opus_encoder_destroy(encoder);
+	}
+};
+
+} // anonymous namespace
+
+
+wav_info read_wav(const uint8_t *data, size_t size) {
+	if (size < 12 or std::memcmp(data, "RIFF", 4) != 0 or std::memcmp(data + 8, "WAVE", 4) != 0) {
+		throw Error(MSG(err) << "Not a WAV file");
+	}
+
+	wav_info info{};
+	bool have_format = false;
+
+	// the chunks are padded to an even size
+	for (size_t pos = 12; pos + 8 <= size; ) {
+		const uint8_t *chunk = data + pos;
+		size_t chunk_size = read_u32(chunk + 4);
+		size_t available = std::min(chunk_size, size - pos - 8);
+
+		if (std::memcmp(chunk, "fmt ", 4) == 0) {
+			if (available < 16) {
+				throw Error(MSG(err) << "Truncated WAV format chunk");
+			}
+
+			uint16_t format = read_u16(chunk + 8);
+			info.channels = read_u16(chunk + 10);
+			info.sample_rate = read_u32(chunk + 12);
+			info.bits_per_sample = read_u16(chunk + 22);
+
+			// 1 is integer pcm
+			if (format != 1) {
+				throw Error(MSG(err) << "Unsupported WAV sample format " << format);
+			}
+			if (info.channels != 1 and info.channels != 2) {
+				throw Error(MSG(err) << "Unsupported WAV channel count " << info.channels);
+			}
+			if (info.bits_per_sample != 8 and info.bits_per_sample != 16) {
+				throw Error(MSG(err) << "Unsupported WAV sample size " << info.bits_per_sample);
+			}
+			if (info.sample_rate <= 0) {
+				throw Error(MSG(err) << "Invalid WAV sample rate " << info.sample_rate);
+			}
+			have_format = true;
+		}
+		else if (std::memcmp(chunk, "data", 4) == 0) {
+			if (not have_format) {
+				throw Error(MSG(err) << "WAV data chunk before its format");
+			}
+
+			// some files of the original game are truncated
+			size_t frame_bytes = info.channels * info.bits_per_sample / 8;
+			info.samples = chunk + 8;
+			info.frame_count = available / frame_bytes;
+			return info;
+		}
+
+		pos += 8 + chunk_size + (chunk_size & 1);
+	}
+
+	throw Error(MSG(err) << "WAV file without data chunk");
+}
+
+
+std::string encode_opus(const uint8_t *data, size_t size, int bitrate) {
+	wav_info wav = read_wav(data, size);
+	int channels = wav.channels;
+
+	std::vector<float> samples(wav.frame_count * channels);
+	for (size_t i = 0; i < samples.size(); i++) {
+		if (wav.bits_per_sample == 8) {
+			// 8 bit samples are unsigned
+			samples[i] = (wav.samples[i] - 128) / 128.0f;
+		}
+		else {
+			int16_t value = static_cast<int16_t>(read_u16(wav.samples + 2 * i));
+			samples[i] = value / 32768.0f;
+		}
+	}
+
+	if (wav.sample_rate != opus_rate) {
+		audio::Resampler resampler{wav.sample_rate, opus_rate, channels};
+		std::vector<float> resampled(resampler.output_frames(wav.frame_count) * channels);
+		resampler.process(samples.data(), wav.frame_count, resampled.data());
+		samples = std::move(resampled);
+	}
+	size_t total = samples.size() / channels;
+
+	int result;
+	std::unique_ptr<OpusEncoder, encoder_deleter> encoder{
+		opus_encoder_create(opus_rate, channels, OPUS_APPLICATION_AUDIO, &result)
+	};
+	if (result != OPUS_OK) {
+		throw Error(MSG(err) << "Could not create the opus encoder: " << opus_strerror(result));
+	}
+
+	if (bitrate > 0) {
+		opus_encoder_ctl(encoder.get(), OPUS_SET_BITRATE(bitrate));
+	}
+
+	opus_int32 pre_skip;
+	opus_encoder_ctl(encoder.get(), OPUS_GET_LOOKAHEAD(&pre_skip));
+
+	std::string out;
+	OggWriter writer{out};
+
+	std::string head = "OpusHead";
+	head.push_back(1);
+	head.push_back(static_cast<char>(channels));
+	append_le<uint16_t>(head, pre_skip);
+	append_le<uint32_t>(head, wav.sample_rate);
+	append_le<int16_t>(head, 0);
+	head.push_back(0);
+	writer.add_packet(reinterpret_cast<const uint8_t *>(head.data()), head.size(), 0);
+	writer.flush_page(false);
+
+	std::string tags = "OpusTags";
+	const char vendor[] = "openage";
+	append_le<uint32_t>(tags, sizeof(vendor) - 1);
+	tags += vendor;
+	append_le<uint32_t>(tags, 0);
+	writer.add_packet(reinterpret_cast<const uint8_t *>(tags.data()), tags.size(), 0);
+	writer.flush_page(false);
+
+	// the decoder drops the first pre_skip samples, so the end of the
+	// signal is pushed out by the encoder with silence
+	size_t padded = total + pre_skip;
+	size_t frame_count = (padded + frame_size - 1) / frame_size;
+	samples.resize(frame_count * frame_size * channels, 0.0f);
+
+	std::array<uint8_t, max_packet_size> packet;
+	for (size_t frame = 0; frame < frame_count; frame++) {
+		int length = opus_encode_float(encoder.get(), &samples[frame * frame_size * channels],
+		                               frame_size, packet.data(), packet.size());
+		if (length < 0) {
+			throw Error(MSG(err) << "Opus encoding failed: " << opus_strerror(length));
+		}
+
+		bool last = (frame + 1 == frame_count);
+
+		// the granule position of the last packet cuts off the padding
+		uint64_t granule = last ? pre_skip + total : uint64_t{frame + 1} * frame_size;
+		writer.add_packet(packet.data(), length, granule);
+
+		if (last or writer.get_packet_count() >= packets_per_page) {
+			writer.flush_page(last);
+		}
+	}
+
+	return out;
+}
+
+}} // openage::convert
@@ -0,0 +1,55 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libc.stdint cimport uint8_t
+// pxd: from libcpp.string cimport string
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace openage {
+namespace convert {
+
+
+/**
+ * The sample format of a WAV file of the original game.
+ */
+struct wav_info {
+	int channels;
+	int sample_rate;
+	int bits_per_sample;
+
+	/** the interleaved samples, which stay in the file */
+	const uint8_t *samples;
+	size_t frame_count;
+};
+
+
+/**
+ * Find the format and samples of a PCM WAV file with 8 or 16 bit
+ * samples and one or two channels.
+ * Throws an Error for other files.
+ */
+wav_info read_wav(const uint8_t *data, size_t size);
+
+
+/**
+ * Encode a WAV file of the original game to an Ogg Opus file, which
+ * the AudioManager decodes with opusfile.
+ *
+ * The samples are resampled to the 48 kHz of the opus codec first.
+ * A bitrate of 0 lets libopus choose one.
+ *
+ * Only uses its arguments, so the converter encodes several sounds at
+ * once on its threads. Throws an Error if the WAV file is unsupported.
+ *
+ * pxd:
+ *
+ * string encode_opus(const uint8_t *data, size_t size, int bitrate) except +
+ */
+std::string encode_opus(const uint8_t *data, size_t size, int bitrate=0);
+
+
+}} // openage::convert
@@ -0,0 +1,116 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "opus_encode.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <opusfile.h>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+#include "../util/math_constants.h"
+
+namespace openage {
+namespace convert {
+namespace tests {
+
+namespace {
+
+void append_u32(std::vector<uint8_t> &data, uint32_t value) {
+	for (size_t i = 0; i < 4; i++) {
+		data.push_back((value >> (8 * i)) & 0xff);
+	}
+}
+
+
+void append_u16(std::vector<uint8_t> &data, uint16_t value) {
+	data.push_back(value & 0xff);
+	data.push_back(value >> 8);
+}
+
+
+/**
+ * a 16 bit pcm wav file of a sine wave.
+ */
+std::vector<uint8_t> make_wav(int rate, int channels, size_t frames) {
+	std::vector<uint8_t> data;
+	const char *riff = "RIFF\0\0\0\0WAVEfmt ";
+	data.insert(data.end(), riff, riff + 16);
+	append_u32(data, 16);
+	append_u16(data, 1);
+	append_u16(data, channels);
+	append_u32(data, rate);
+	append_u32(data, rate * channels * 2);
+	append_u16(data, channels * 2);
+	append_u16(data, 16);
+
+	// an unknown chunk of odd size, which is skipped
+	const char *list = "LIST\3\0\0\0abc\0";
+	data.insert(data.end(), list, list + 12);
+
+	const char *chunk = "data";
+	data.insert(data.end(), chunk, chunk + 4);
+	append_u32(data, frames * channels * 2);
+	for (size_t i = 0; i < frames; i++) {
+		int16_t value = 8000 * std::sin(2 * math::PI * 440 * i / rate);
+		for (int c = 0; c < channels; c++) {
+			append_u16(data, value);
+		}
+	}
+
+	uint32_t riff_size = data.size() - 8;
+	std::memcpy(&data[4], &riff_size, 4);
+	return data;
+}
+
+} // anonymous namespace
+
+
+void opus_encode() {
+	std::vector<uint8_t> wav = make_wav(22050, 2, 11025);
+
+	wav_info info = read_wav(wav.data(), wav.size());
+	TESTEQUALS(info.channels, 2);
+	TESTEQUALS(info.sample_rate, 22050);
+	TESTEQUALS(info.bits_per_sample, 16);
+	TESTEQUALS(info.frame_count, 11025);
+
+	// opusfile decodes the whole resampled half second
+	std::string encoded = encode_opus(wav.data(), wav.size(), 64000);
+
+	int op_err;
+	OggOpusFile *file = op_open_memory(
+		reinterpret_cast<const unsigned char *>(encoded.data()), encoded.size(), &op_err
+	);
+	(file != nullptr) or TESTFAIL;
+	TESTEQUALS(op_channel_count(file, -1), 2);
+	TESTEQUALS(op_pcm_total(file, -1), 24000);
+	TESTEQUALS(op_head(file, -1)->input_sample_rate, 22050);
+
+	std::vector<opus_int16> pcm(24000 * 2);
+	size_t decoded = 0;
+	while (true) {
+		int count = op_read(file, &pcm[decoded * 2], (pcm.size() - decoded * 2), nullptr);
+		if (count <= 0) {
+			(count == 0) or TESTFAIL;
+			break;
+		}
+		decoded += count;
+	}
+	op_free(file);
+	TESTEQUALS(decoded, 24000);
+
+	// truncated and unsupported files are rejected
+	wav.resize(20);
+	TESTTHROWS(read_wav(wav.data(), wav.size()));
+
+	std::vector<uint8_t> float_wav = make_wav(48000, 1, 10);
+	float_wav[20] = 3;
+	TESTTHROWS(encode_opus(float_wav.data(), float_wav.size()));
+}
+
+}}} // openage::convert::tests
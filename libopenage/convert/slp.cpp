@@ -0,0 +1,430 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "slp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "../error/error.h"
+#include "../util/compiler.h"
+
+
+namespace openage {
+namespace convert {
+
+
+namespace {
+
+// struct slp_header {
+//   char version[4];
+//   int frame_count;
+//   char comment[24];
+// };
+constexpr size_t SLP_HEADER_SIZE = 32;
+constexpr size_t SLP_FRAME_INFO_SIZE = 32;
+
+// left or right boundary of a row without any pixels
+constexpr uint16_t SLP_ROW_TRANSPARENT = 0x8000;
+
+
+uint16_t read_u16(const uint8_t *data) {
+	return data[0] | (data[1] << 8);
+}
+
+
+uint32_t read_u32(const uint8_t *data) {
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+
+/**
+ * Reads the drawing commands of one row, and fills its pixels.
+ */
+class RowDecoder {
+public:
+	RowDecoder(const uint8_t *data, size_t size, size_t pos, size_t row,
+	           uint8_t *types, uint8_t *indices, size_t pixels)
+		:
+		data{data},
+		size{size},
+		pos{pos},
+		row{row},
+		types{types},
+		indices{indices},
+		pixels{pixels},
+		drawn{0} {}
+
+	void run() {
+		while (true) {
+			uint8_t cmd = this->next_byte();
+			uint8_t lower_nibble = cmd & 0x0f;
+			uint8_t higher_nibble = cmd & 0xf0;
+			uint8_t lower_bits = cmd & 0x03;
+
+			if (lower_nibble == 0x0f) {
+				// end of row
+				break;
+			}
+			else if (lower_bits == 0x00) {
+				// color list
+				this->colors(cmd >> 2);
+			}
+			else if (lower_bits == 0x01) {
+				// skip
+				this->fill(this->count(cmd, 2), slp_pixel::transparent, 0);
+			}
+			else if (lower_nibble == 0x02) {
+				// big color list
+				this->colors((higher_nibble << 4) + this->next_byte());
+			}
+			else if (lower_nibble == 0x03) {
+				// big skip
+				this->fill((higher_nibble << 4) + this->next_byte(), slp_pixel::transparent, 0);
+			}
+			else if (lower_nibble == 0x06) {
+				// player color list
+				size_t count = this->count(cmd, 4);
+				this->reserve(count);
+				for (size_t i = 0; i < count; i++) {
+					this->put(slp_pixel::player_color, this->next_byte());
+				}
+			}
+			else if (lower_nibble == 0x07) {
+				// fill
+				size_t count = this->count(cmd, 4);
+				this->fill(count, slp_pixel::color, this->next_byte());
+			}
+			else if (lower_nibble == 0x0a) {
+				// player color fill
+				size_t count = this->count(cmd, 4);
+				this->fill(count, slp_pixel::player_color, this->next_byte());
+			}
+			else if (lower_nibble == 0x0b) {
+				// shadow
+				this->fill(this->count(cmd, 4), slp_pixel::shadow, 0);
+			}
+			else {
+				// extended commands, the higher nibble selects them.
+				// the render hints and color table switches draw nothing.
+				switch (higher_nibble) {
+				case 0x40:
+					this->fill(1, slp_pixel::outline_player, 0);
+					break;
+				case 0x50:
+					this->fill(this->next_byte(), slp_pixel::outline_player, 0);
+					break;
+				case 0x60:
+					this->fill(1, slp_pixel::outline_black, 0);
+					break;
+				case 0x70:
+					this->fill(this->next_byte(), slp_pixel::outline_black, 0);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		if (this->drawn != this->pixels) {
+			throw Error(MSG(err) << "slp row " << this->row << " has " << this->drawn
+			            << " pixels instead of " << this->pixels);
+		}
+	}
+
+private:
+	uint8_t next_byte() {
+		if (unlikely(this->pos >= this->size)) {
+			throw Error(MSG(err) << "slp row " << this->row << " continues past the end of the file");
+		}
+		return this->data[this->pos++];
+	}
+
+	/**
+	 * the pixel count is stored in the upper bits of the command,
+	 * or in the next byte if they are zero.
+	 */
+	size_t count(uint8_t cmd, unsigned int shift) {
+		size_t count = cmd >> shift;
+		if (count == 0) {
+			count = this->next_byte();
+		}
+		return count;
+	}
+
+	void reserve(size_t count) {
+		if (unlikely(this->drawn + count > this->pixels)) {
+			throw Error(MSG(err) << "only " << this->pixels << " pixels should be drawn in slp row " << this->row);
+		}
+	}
+
+	void put(slp_pixel type, uint8_t index) {
+		this->types[this->drawn] = static_cast<uint8_t>(type);
+		this->indices[this->drawn] = index;
+		this->drawn += 1;
+	}
+
+	void colors(size_t count) {
+		this->reserve(count);
+		if (unlikely(this->pos + count > this->size)) {
+			throw Error(MSG(err) << "slp row " << this->row << " continues past the end of the file");
+		}
+
+		memset(&this->types[this->drawn], static_cast<uint8_t>(slp_pixel::color), count);
+		memcpy(&this->indices[this->drawn], &this->data[this->pos], count);
+		this->pos += count;
+		this->drawn += count;
+	}
+
+	void fill(size_t count, slp_pixel type, uint8_t index) {
+		this->reserve(count);
+		memset(&this->types[this->drawn], static_cast<uint8_t>(type), count);
+		memset(&this->indices[this->drawn], index, count);
+		this->drawn += count;
+	}
+
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+	size_t row;
+
+	// the pixels between the row's boundaries
+	uint8_t *types;
+	uint8_t *indices;
+	size_t pixels;
+	size_t drawn;
+};
+
+
+void check_table(size_t offset, size_t entry_size, size_t count, size_t size) {
+	if (offset > size or count > (size - offset) / entry_size) {
+		throw Error(MSG(err) << "slp table at " << offset << " exceeds the file size " << size);
+	}
+}
+
+
+/**
+ * Run the drawing commands of all rows of a frame.
+ */
+void decode_frame(const uint8_t *data, size_t size, const slp_frame_info &info,
+                  uint8_t *types, uint8_t *indices) {
+
+	size_t width = info.width;
+	size_t height = info.height;
+
+	check_table(info.outline_table_offset, 4, height, size);
+	check_table(info.qdl_table_offset, 4, height, size);
+
+	for (size_t row = 0; row < height; row++) {
+		const uint8_t *edge = &data[info.outline_table_offset + row * 4];
+		uint16_t left = read_u16(&edge[0]);
+		uint16_t right = read_u16(&edge[2]);
+
+		uint8_t *row_types = &types[row * width];
+		uint8_t *row_indices = &indices[row * width];
+
+		// the types are zero-initialized, which is slp_pixel::transparent
+		if (left == SLP_ROW_TRANSPARENT or right == SLP_ROW_TRANSPARENT) {
+			continue;
+		}
+
+		if (left + right > width) {
+			throw Error(MSG(err) << "slp row " << row << " boundaries "
+			            << left << " + " << right << " exceed the width " << width);
+		}
+
+		size_t cmd_offset = read_u32(&data[info.qdl_table_offset + row * 4]);
+
+		RowDecoder decoder{
+			data, size, cmd_offset, row,
+			&row_types[left], &row_indices[left], width - left - right
+		};
+		decoder.run();
+	}
+}
+
+} // anonymous namespace
+
+
+SLPFile::SLPFile(const uint8_t *data, size_t size, unsigned threads) {
+	if (size < SLP_HEADER_SIZE) {
+		throw Error(MSG(err) << "slp file of " << size << " bytes is too short for the header");
+	}
+
+	int32_t frame_count = static_cast<int32_t>(read_u32(&data[4]));
+	if (frame_count < 0) {
+		throw Error(MSG(err) << "invalid slp frame count " << frame_count);
+	}
+
+	check_table(SLP_HEADER_SIZE, SLP_FRAME_INFO_SIZE, frame_count, size);
+
+	this->frames.resize(frame_count);
+	for (size_t i = 0; i < this->frames.size(); i++) {
+		const uint8_t *entry = &data[SLP_HEADER_SIZE + i * SLP_FRAME_INFO_SIZE];
+		slp_frame_info &info = this->frames[i].info;
+
+		info.qdl_table_offset     = read_u32(&entry[0]);
+		info.outline_table_offset = read_u32(&entry[4]);
+		info.palette_offset       = read_u32(&entry[8]);
+		info.properties           = read_u32(&entry[12]);
+		info.width                = static_cast<int32_t>(read_u32(&entry[16]));
+		info.height               = static_cast<int32_t>(read_u32(&entry[20]));
+		info.hotspot_x            = static_cast<int32_t>(read_u32(&entry[24]));
+		info.hotspot_y            = static_cast<int32_t>(read_u32(&entry[28]));
+
+		if (info.width < 0 or info.height < 0) {
+			throw Error(MSG(err) << "slp frame " << i << " has invalid size "
+			            << info.width << "x" << info.height);
+		}
+	}
+
+	if (threads == 0) {
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	threads = static_cast<unsigned int>(std::min<size_t>(threads, std::max<size_t>(this->frames.size(), 1)));
+
+	std::atomic<size_t> next_frame{0};
+	std::atomic<bool> failed{false};
+	std::mutex error_mutex;
+	std::exception_ptr error;
+
+	auto worker = [&]() {
+		size_t idx;
+		while (not failed and (idx = next_frame++) < this->frames.size()) {
+			try {
+				frame &frame = this->frames[idx];
+				size_t pixels = static_cast<size_t>(frame.info.width) * frame.info.height;
+				frame.types.assign(pixels, static_cast<uint8_t>(slp_pixel::transparent));
+				frame.indices.assign(pixels, 0);
+
+				decode_frame(data, size, frame.info, frame.types.data(), frame.indices.data());
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock{error_mutex};
+				if (not error) {
+					error = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	// the calling thread decodes too
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : workers) {
+		thread.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+
+size_t SLPFile::get_frame_count() const {
+	return this->frames.size();
+}
+
+
+const SLPFile::frame &SLPFile::get_frame(size_t frame) const {
+	if (frame >= this->frames.size()) {
+		throw Error(MSG(err) << "slp frame " << frame << " does not exist, there are " << this->frames.size());
+	}
+	return this->frames[frame];
+}
+
+
+const slp_frame_info &SLPFile::get_frame_info(size_t frame) const {
+	return this->get_frame(frame).info;
+}
+
+
+const uint8_t *SLPFile::get_types(size_t frame) const {
+	return this->get_frame(frame).types.data();
+}
+
+
+const uint8_t *SLPFile::get_indices(size_t frame) const {
+	return this->get_frame(frame).indices.data();
+}
+
+
+void SLPFile::to_rgba(size_t frame, const uint8_t *palette, size_t palette_size,
+                      int player, uint8_t *rgba) const {
+
+	const SLPFile::frame &f = this->get_frame(frame);
+
+	// negative indices count from the end of the palette,
+	// the black outline of player 0 uses the last player color row.
+	auto color = [palette, palette_size](int index, uint8_t *out) {
+		if (index < 0) {
+			index += palette_size;
+		}
+		if (index < 0 or static_cast<size_t>(index) >= palette_size) {
+			throw Error(MSG(err) << "slp pixel uses palette index " << index
+			            << " of a palette with " << palette_size << " colors");
+		}
+		memcpy(out, &palette[index * 3], 3);
+	};
+
+	for (size_t i = 0; i < f.types.size(); i++) {
+		uint8_t *out = &rgba[i * 4];
+
+		switch (static_cast<slp_pixel>(f.types[i])) {
+		case slp_pixel::color:
+			color(f.indices[i], out);
+			out[3] = 255;
+			break;
+		case slp_pixel::player_color:
+			color(f.indices[i] + 16 * player, out);
+			out[3] = 254;
+			break;
+		case slp_pixel::outline_player:
+			// the lighter base color suits the outline better
+			color(2 + 16 * player, out);
+			out[3] = 253;
+			break;
+		case slp_pixel::outline_black:
+			color(-16 + 16 * player, out);
+			out[3] = 253;
+			break;
+		case slp_pixel::shadow:
+			out[0] = out[1] = out[2] = 0;
+			out[3] = 100;
+			break;
+		case slp_pixel::transparent:
+		default:
+			out[0] = out[1] = out[2] = out[3] = 0;
+			break;
+		}
+	}
+}
+
+
+void SLPFile::to_player_mask(size_t frame, uint8_t *mask) const {
+	const SLPFile::frame &f = this->get_frame(frame);
+
+	for (size_t i = 0; i < f.types.size(); i++) {
+		mask[i] = (f.types[i] == static_cast<uint8_t>(slp_pixel::player_color)) ? 255 : 0;
+	}
+}
+
+
+void SLPFile::to_outline_mask(size_t frame, uint8_t *mask) const {
+	const SLPFile::frame &f = this->get_frame(frame);
+
+	for (size_t i = 0; i < f.types.size(); i++) {
+		mask[i] = (f.types[i] == static_cast<uint8_t>(slp_pixel::outline_player) or
+		           f.types[i] == static_cast<uint8_t>(slp_pixel::outline_black)) ? 255 : 0;
+	}
+}
+
+
+}} // openage::convert
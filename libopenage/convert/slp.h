@@ -0,0 +1,138 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libc.stdint cimport uint8_t, int32_t, uint32_t
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace openage {
+namespace convert {
+
+
+/**
+ * Kind of a decoded SLP pixel.
+ * The value of each pixel is stored in the frame's type buffer.
+ */
+enum class slp_pixel : uint8_t {
+	transparent    = 0,  // not drawn
+	color          = 1,  // palette color
+	shadow         = 2,  // drawn as transparent shadow
+	player_color   = 3,  // index is the base color of the player palette
+	outline_player = 4,  // drawn in the player color when obstructed
+	outline_black  = 5,  // drawn in black when obstructed
+};
+
+
+/**
+ * Header of one frame of a SLP file.
+ *
+ * pxd:
+ *
+ * cppclass slp_frame_info:
+ *     uint32_t qdl_table_offset
+ *     uint32_t outline_table_offset
+ *     uint32_t palette_offset
+ *     uint32_t properties
+ *     int32_t width
+ *     int32_t height
+ *     int32_t hotspot_x
+ *     int32_t hotspot_y
+ */
+struct slp_frame_info {
+	uint32_t qdl_table_offset;
+	uint32_t outline_table_offset;
+	uint32_t palette_offset;
+	uint32_t properties;
+	int32_t width;
+	int32_t height;
+	int32_t hotspot_x;
+	int32_t hotspot_y;
+};
+
+
+/**
+ * Decodes the drawing commands of all frames of a SLP file,
+ * the graphics format of the original game.
+ *
+ * Each frame is decoded to two width * height buffers: the kind of each
+ * pixel (slp_pixel) and its palette index. The RGBA image for a palette
+ * and player is created from them.
+ *
+ * pxd:
+ *
+ * cppclass SLPFile:
+ *     SLPFile(const uint8_t *data, size_t size, unsigned threads) except +
+ *
+ *     size_t get_frame_count()
+ *     const slp_frame_info &get_frame_info(size_t frame) except +
+ *
+ *     const uint8_t *get_types(size_t frame) except +
+ *     const uint8_t *get_indices(size_t frame) except +
+ *
+ *     void to_rgba(size_t frame, const uint8_t *palette, size_t palette_size,
+ *                  int player, uint8_t *rgba) except +
+ *
+ *     void to_player_mask(size_t frame, uint8_t *mask) except +
+ *     void to_outline_mask(size_t frame, uint8_t *mask) except +
+ */
+class SLPFile {
+public:
+	/**
+	 * Decode the file, which stays owned by the caller.
+	 * The frames are decoded in parallel by up to threads threads,
+	 * 0 uses all cores.
+	 *
+	 * Throws if the file is truncated or the commands don't fit the frame.
+	 */
+	SLPFile(const uint8_t *data, size_t size, unsigned threads=0);
+
+	size_t get_frame_count() const;
+	const slp_frame_info &get_frame_info(size_t frame) const;
+
+	/**
+	 * slp_pixel of each pixel, row by row.
+	 */
+	const uint8_t *get_types(size_t frame) const;
+
+	/**
+	 * palette index of each color pixel, base color of player pixels.
+	 */
+	const uint8_t *get_indices(size_t frame) const;
+
+	/**
+	 * Create the RGBA image of a frame, with 4 bytes per pixel.
+	 *
+	 * The palette contains palette_size RGB triples, the player colors are
+	 * looked up at base color + 16 * player. As the texture converter expects,
+	 * player pixels have alpha 254, outlines 253 and shadows 100.
+	 */
+	void to_rgba(size_t frame, const uint8_t *palette, size_t palette_size,
+	             int player, uint8_t *rgba) const;
+
+	/**
+	 * 255 for each pixel to be drawn in the player color, 0 otherwise.
+	 */
+	void to_player_mask(size_t frame, uint8_t *mask) const;
+
+	/**
+	 * 255 for each outline pixel, 0 otherwise.
+	 */
+	void to_outline_mask(size_t frame, uint8_t *mask) const;
+
+private:
+	struct frame {
+		slp_frame_info info;
+		std::vector<uint8_t> types;
+		std::vector<uint8_t> indices;
+	};
+
+	const frame &get_frame(size_t frame) const;
+
+	std::vector<frame> frames;
+};
+
+
+}} // openage::convert
@@ -0,0 +1,159 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "slp.h"
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace convert {
+namespace tests {
+
+namespace {
+
+void put_u16(std::vector<uint8_t> &data, size_t pos, uint16_t value) {
+	data[pos + 0] = value & 0xff;
+	data[pos + 1] = value >> 8;
+}
+
+
+void put_u32(std::vector<uint8_t> &data, size_t pos, uint32_t value) {
+	for (size_t i = 0; i < 4; i++) {
+		data[pos + i] = (value >> (8 * i)) & 0xff;
+	}
+}
+
+
+/**
+ * a slp file with one frame of the given width, and the
+ * boundaries and drawing commands for each row.
+ */
+std::vector<uint8_t> make_slp(int32_t width,
+                              const std::vector<std::pair<uint16_t, uint16_t>> &edges,
+                              const std::vector<std::vector<uint8_t>> &rows) {
+
+	size_t height = rows.size();
+	size_t outline_table = 32 + 32;
+	size_t cmd_table = outline_table + 4 * height;
+	size_t cmds = cmd_table + 4 * height;
+
+	std::vector<uint8_t> data(cmds);
+	memcpy(&data[0], "2.0N", 4);
+	put_u32(data, 4, 1);
+
+	put_u32(data, 32 + 0, cmd_table);
+	put_u32(data, 32 + 4, outline_table);
+	put_u32(data, 32 + 16, width);
+	put_u32(data, 32 + 20, height);
+	put_u32(data, 32 + 24, 3);
+	put_u32(data, 32 + 28, 4);
+
+	for (size_t row = 0; row < height; row++) {
+		put_u16(data, outline_table + 4 * row + 0, edges[row].first);
+		put_u16(data, outline_table + 4 * row + 2, edges[row].second);
+		put_u32(data, cmd_table + 4 * row, data.size());
+		data.insert(data.end(), rows[row].begin(), rows[row].end());
+	}
+
+	return data;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void slp() {
+	std::vector<uint8_t> data = make_slp(8, {{0x8000, 0x8000}, {1, 1}, {0, 0}}, {
+		{0x0f},
+		// color list of 2, fill 2 with color 5, shadow, outline
+		{0x08, 10, 11, 0x27, 5, 0x1b, 0x4e, 0x0f},
+		// skip 2, player fill 3 with base 4, black outline span of 2, player color list of 1
+		{0x09, 0x3a, 4, 0x7e, 2, 0x16, 7, 0x0f},
+	});
+
+	SLPFile slp{data.data(), data.size(), 2};
+	slp.get_frame_count() == 1 or TESTFAIL;
+
+	const slp_frame_info &info = slp.get_frame_info(0);
+	(info.width == 8 and info.height == 3 and info.hotspot_x == 3 and info.hotspot_y == 4) or TESTFAIL;
+
+	using p = slp_pixel;
+	std::vector<p> types_expected{
+		p::transparent, p::transparent, p::transparent, p::transparent,
+		p::transparent, p::transparent, p::transparent, p::transparent,
+
+		p::transparent, p::color, p::color, p::color,
+		p::color, p::shadow, p::outline_player, p::transparent,
+
+		p::transparent, p::transparent, p::player_color, p::player_color,
+		p::player_color, p::outline_black, p::outline_black, p::player_color,
+	};
+	std::vector<uint8_t> indices_expected{
+		0, 0, 0, 0, 0, 0, 0, 0,
+		0, 10, 11, 5, 5, 0, 0, 0,
+		0, 0, 4, 4, 4, 0, 0, 7,
+	};
+
+	const uint8_t *types = slp.get_types(0);
+	const uint8_t *indices = slp.get_indices(0);
+	for (size_t i = 0; i < types_expected.size(); i++) {
+		types[i] == static_cast<uint8_t>(types_expected[i]) or TESTFAIL;
+		indices[i] == indices_expected[i] or TESTFAIL;
+	}
+
+	// gray palette: each color is its index
+	std::vector<uint8_t> palette(256 * 3);
+	for (size_t i = 0; i < palette.size(); i++) {
+		palette[i] = i / 3;
+	}
+
+	std::vector<uint8_t> rgba(8 * 3 * 4);
+	slp.to_rgba(0, palette.data(), 256, 1, rgba.data());
+
+	// pixel, expected gray value, expected alpha
+	std::vector<std::tuple<size_t, uint8_t, uint8_t>> pixels{
+		{0, 0, 0},
+		{9, 10, 255},
+		{11, 5, 255},
+		{13, 0, 100},
+		{14, 2 + 16, 253},
+		{18, 4 + 16, 254},
+		{21, 0, 253},
+		{23, 7 + 16, 254},
+	};
+	for (auto &pixel : pixels) {
+		const uint8_t *out = &rgba[std::get<0>(pixel) * 4];
+		(out[0] == std::get<1>(pixel) and out[2] == std::get<1>(pixel)) or TESTFAIL;
+		out[3] == std::get<2>(pixel) or TESTFAIL;
+	}
+
+	// player 0 has its black outline at the end of the palette
+	slp.to_rgba(0, palette.data(), 256, 0, rgba.data());
+	rgba[21 * 4] == 240 or TESTFAIL;
+
+	std::vector<uint8_t> mask(8 * 3);
+	slp.to_player_mask(0, mask.data());
+	(mask[18] == 255 and mask[23] == 255 and mask[14] == 0 and mask[9] == 0) or TESTFAIL;
+	slp.to_outline_mask(0, mask.data());
+	(mask[14] == 255 and mask[21] == 255 and mask[18] == 0) or TESTFAIL;
+
+	// rows that draw too many or too few pixels are rejected
+	std::vector<uint8_t> fitting = make_slp(2, {{0, 0}}, {{0x27, 1, 0x0f}});
+	TESTNOEXCEPT((SLPFile{fitting.data(), fitting.size(), 1}));
+
+	for (auto &row : std::vector<std::vector<uint8_t>>{{0x37, 1, 0x0f}, {0x17, 1, 0x0f}, {0x27, 1}}) {
+		std::vector<uint8_t> broken = make_slp(2, {{0, 0}}, {row});
+		TESTTHROWS((SLPFile{broken.data(), broken.size(), 1}));
+	}
+
+	// truncated header
+	TESTTHROWS((SLPFile{data.data(), 16, 1}));
+}
+
+
+}}} // openage::convert::tests
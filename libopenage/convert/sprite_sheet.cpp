@@ -0,0 +1,420 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "sprite_sheet.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include "../error/error.h"
+
+
+namespace openage {
+namespace convert {
+
+
+namespace {
+
+/**
+ * size of a frame, as the packers see it.
+ */
+struct block {
+	int32_t width;
+	int32_t height;
+};
+
+
+/**
+ * positions of the blocks, in their order.
+ */
+struct layout {
+	std::vector<std::pair<int32_t, int32_t>> positions;
+	int32_t width = 0;
+	int32_t height = 0;
+
+	/**
+	 * the size of the sheet, without the margin after the last blocks.
+	 */
+	void measure(const std::vector<block> &blocks) {
+		this->width = 0;
+		this->height = 0;
+		for (size_t i = 0; i < blocks.size(); i++) {
+			this->width = std::max(this->width, this->positions[i].first + blocks[i].width);
+			this->height = std::max(this->height, this->positions[i].second + blocks[i].height);
+		}
+	}
+
+	int64_t area() const {
+		return int64_t{this->width} * this->height;
+	}
+};
+
+
+/**
+ * two factors of n, the first one is the largest up to sqrt(n).
+ */
+std::pair<size_t, size_t> factor(size_t n) {
+	for (size_t a = static_cast<size_t>(std::sqrt(n)); a > 0; a--) {
+		if (n % a == 0) {
+			return {a, n / a};
+		}
+	}
+	return {1, n};
+}
+
+
+/**
+ * the RowPacker, or with columns, the ColumnPacker:
+ * the blocks are put into the line with the smallest total length.
+ */
+layout pack_lines(const std::vector<block> &blocks, int32_t margin, bool columns) {
+	auto length = [&](const block &b) { return columns ? b.height : b.width; };
+	auto thickness = [&](const block &b) { return columns ? b.width : b.height; };
+
+	size_t line_count = factor(blocks.size()).first;
+	std::vector<std::vector<size_t>> lines(line_count);
+	std::vector<int64_t> lengths(line_count);
+
+	for (size_t i = 0; i < blocks.size(); i++) {
+		size_t shortest = std::min_element(lengths.begin(), lengths.end()) - lengths.begin();
+		lines[shortest].push_back(i);
+		lengths[shortest] += length(blocks[i]);
+	}
+
+	layout result;
+	result.positions.resize(blocks.size());
+
+	int32_t line_pos = 0;
+	for (auto &line : lines) {
+		int32_t pos = 0;
+		int32_t line_thickness = 0;
+
+		for (size_t i : line) {
+			if (columns) {
+				result.positions[i] = {line_pos, pos};
+			}
+			else {
+				result.positions[i] = {pos, line_pos};
+			}
+			pos += length(blocks[i]) + margin;
+			line_thickness = std::max(line_thickness, thickness(blocks[i]));
+		}
+
+		line_pos += line_thickness + margin;
+	}
+
+	result.measure(blocks);
+	return result;
+}
+
+
+/**
+ * The BinaryTreePacker: each block is placed in the first free node
+ * that fits, the tree grows towards the aspect ratio if none does.
+ */
+class TreePacker {
+public:
+	TreePacker(int32_t margin, double aspect_ratio)
+		:
+		margin{margin},
+		aspect_ratio{aspect_ratio},
+		root{-1} {}
+
+	layout pack(const std::vector<block> &blocks) {
+		// largest side first, the order of equal blocks stays
+		std::vector<size_t> order(blocks.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+
+		auto key = [&](size_t i) {
+			const block &b = blocks[i];
+			return std::make_tuple(std::max(b.width, b.height), std::min(b.width, b.height),
+			                       b.height, b.width);
+		};
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return key(a) > key(b);
+		});
+
+		layout result;
+		result.positions.resize(blocks.size());
+
+		for (size_t i : order) {
+			const node &placed = this->nodes[this->fit(blocks[i])];
+			result.positions[i] = {placed.x, placed.y};
+		}
+
+		result.measure(blocks);
+		return result;
+	}
+
+private:
+	struct node {
+		int32_t x, y, width, height;
+		bool used;
+		int down, right;
+	};
+
+	int add_node(int32_t x, int32_t y, int32_t width, int32_t height) {
+		this->nodes.push_back({x, y, width, height, false, -1, -1});
+		return static_cast<int>(this->nodes.size()) - 1;
+	}
+
+	int fit(const block &b) {
+		int32_t width = b.width + this->margin;
+		int32_t height = b.height + this->margin;
+
+		if (this->root < 0) {
+			this->root = this->add_node(0, 0, width, height);
+		}
+
+		int found = this->find_node(this->root, width, height);
+		if (found >= 0) {
+			return this->split_node(found, width, height);
+		}
+		return this->grow_node(width, height);
+	}
+
+	int find_node(int idx, int32_t width, int32_t height) const {
+		const node &n = this->nodes[idx];
+		if (n.used) {
+			int found = this->find_node(n.right, width, height);
+			return found >= 0 ? found : this->find_node(n.down, width, height);
+		}
+		if (width <= n.width and height <= n.height) {
+			return idx;
+		}
+		return -1;
+	}
+
+	int split_node(int idx, int32_t width, int32_t height) {
+		node n = this->nodes[idx];
+		int down = this->add_node(n.x, n.y + height, n.width, n.height - height);
+		int right = this->add_node(n.x + width, n.y, n.width - width, height);
+
+		node &split = this->nodes[idx];
+		split.used = true;
+		split.down = down;
+		split.right = right;
+		return idx;
+	}
+
+	int grow_node(int32_t width, int32_t height) {
+		const node &r = this->nodes[this->root];
+		bool can_grow_down = width <= r.width;
+		bool can_grow_right = height <= r.height;
+		if (not can_grow_down and not can_grow_right) {
+			throw Error(MSG(err) << "Bad block ordering for the sprite sheet packer");
+		}
+
+		bool should_grow_right = r.height * this->aspect_ratio >= r.width + width;
+		bool should_grow_down = r.width / this->aspect_ratio >= r.height + height;
+
+		if (can_grow_right and should_grow_right) {
+			return this->grow(true, width, height);
+		}
+		else if (can_grow_down and should_grow_down) {
+			return this->grow(false, width, height);
+		}
+		return this->grow(can_grow_right, width, height);
+	}
+
+	int grow(bool right, int32_t width, int32_t height) {
+		node old_root = this->nodes[this->root];
+
+		int new_root;
+		int added;
+		if (right) {
+			new_root = this->add_node(0, 0, old_root.width + width, old_root.height);
+			added = this->add_node(old_root.width, 0, width, old_root.height);
+			this->nodes[new_root].down = this->root;
+			this->nodes[new_root].right = added;
+		}
+		else {
+			new_root = this->add_node(0, 0, old_root.width, old_root.height + height);
+			added = this->add_node(0, old_root.height, old_root.width, height);
+			this->nodes[new_root].down = added;
+			this->nodes[new_root].right = this->root;
+		}
+		this->nodes[new_root].used = true;
+		this->root = new_root;
+
+		return this->split_node(this->find_node(this->root, width, height), width, height);
+	}
+
+	int32_t margin;
+	double aspect_ratio;
+
+	std::vector<node> nodes;
+	int root;
+};
+
+
+/**
+ * run func(0) ... func(count - 1) on up to threads threads,
+ * the calling one included. Rethrows the first exception.
+ */
+template<typename F>
+void parallel_for(size_t count, unsigned threads, const F &func) {
+	threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(count, 1)));
+
+	std::atomic<size_t> next{0};
+	std::atomic<bool> failed{false};
+	std::mutex error_mutex;
+	std::exception_ptr error;
+
+	auto worker = [&]() {
+		size_t idx;
+		while (not failed and (idx = next++) < count) {
+			try {
+				func(idx);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock{error_mutex};
+				if (not error) {
+					error = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : workers) {
+		thread.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+} // anonymous namespace
+
+
+SpriteSheet::SpriteSheet(int32_t margin, double aspect_ratio, int32_t max_dimension)
+	:
+	margin{margin},
+	aspect_ratio{aspect_ratio},
+	max_dimension{max_dimension},
+	width{0},
+	height{0} {
+
+	if (margin < 0 or aspect_ratio <= 0) {
+		throw Error(MSG(err) << "Invalid sprite sheet margin " << margin
+		            << " or aspect ratio " << aspect_ratio);
+	}
+}
+
+
+void SpriteSheet::add_frame(const uint8_t *rgba, int32_t width, int32_t height,
+                            int32_t hotspot_x, int32_t hotspot_y) {
+	if (width < 0 or height < 0) {
+		throw Error(MSG(err) << "Invalid sprite sheet frame size " << width << "x" << height);
+	}
+	this->frames.push_back({rgba, width, height, hotspot_x, hotspot_y});
+}
+
+
+void SpriteSheet::pack(unsigned threads) {
+	if (this->frames.empty()) {
+		throw Error(MSG(err) << "Cannot create a sprite sheet without frames");
+	}
+
+	if (threads == 0) {
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	std::vector<block> blocks;
+	for (auto &frame : this->frames) {
+		blocks.push_back({frame.width, frame.height});
+	}
+
+	// in the order of the python packers, the first smallest one wins
+	std::vector<layout> layouts(4);
+	parallel_for(layouts.size(), threads, [&](size_t idx) {
+		switch (idx) {
+		case 0: layouts[idx] = TreePacker{this->margin, 1}.pack(blocks); break;
+		case 1: layouts[idx] = TreePacker{this->margin, this->aspect_ratio}.pack(blocks); break;
+		case 2: layouts[idx] = pack_lines(blocks, this->margin, false); break;
+		case 3: layouts[idx] = pack_lines(blocks, this->margin, true); break;
+		}
+	});
+
+	const layout *best = &layouts[0];
+	for (auto &candidate : layouts) {
+		if (candidate.area() < best->area()) {
+			best = &candidate;
+		}
+	}
+
+	if (best->width > this->max_dimension or best->height > this->max_dimension) {
+		throw Error(MSG(err) << "Sprite sheet of " << best->width << "x" << best->height
+		            << " exceeds the texture size limit " << this->max_dimension);
+	}
+
+	this->width = best->width;
+	this->height = best->height;
+	this->data.assign(size_t{4} * this->width * this->height, 0);
+
+	this->entries.resize(this->frames.size());
+
+	// the frames don't overlap, so they are drawn independently
+	parallel_for(this->frames.size(), threads, [&](size_t idx) {
+		const frame &frame = this->frames[idx];
+		int32_t x = best->positions[idx].first;
+		int32_t y = best->positions[idx].second;
+
+		size_t row_size = size_t{4} * frame.width;
+		for (int32_t row = 0; row < frame.height; row++) {
+			memcpy(&this->data[size_t{4} * ((size_t(y) + row) * this->width + x)],
+			       frame.rgba + row * row_size, row_size);
+		}
+
+		this->entries[idx] = {x, y, frame.width, frame.height, frame.hotspot_x, frame.hotspot_y};
+	});
+
+	// the frame data may be released now
+	this->frames.clear();
+}
+
+
+int32_t SpriteSheet::get_width() const {
+	return this->width;
+}
+
+
+int32_t SpriteSheet::get_height() const {
+	return this->height;
+}
+
+
+const uint8_t *SpriteSheet::get_data() const {
+	return this->data.data();
+}
+
+
+size_t SpriteSheet::get_entry_count() const {
+	return this->entries.size();
+}
+
+
+const sprite_sheet_entry &SpriteSheet::get_entry(size_t index) const {
+	if (index >= this->entries.size()) {
+		throw Error(MSG(err) << "Sprite sheet entry " << index << " out of range");
+	}
+	return this->entries[index];
+}
+
+
+}} // openage::convert
@@ -0,0 +1,125 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libc.stdint cimport uint8_t, int32_t
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace openage {
+namespace convert {
+
+
+/**
+ * Position of a frame in the sprite sheet,
+ * the members of the converter's subtexture struct.
+ *
+ * pxd:
+ *
+ * cppclass sprite_sheet_entry:
+ *     int32_t x
+ *     int32_t y
+ *     int32_t w
+ *     int32_t h
+ *     int32_t cx
+ *     int32_t cy
+ */
+struct sprite_sheet_entry {
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+	int32_t cx;    //!< hotspot
+	int32_t cy;
+};
+
+
+/**
+ * Packs RGBA frames into one sprite sheet texture, like the packers
+ * of openage/convert/binpack.py: two binary tree packers (square and
+ * terrain aspect ratio), a row and a column packer are run in parallel,
+ * and the layout with the smallest area is used. The frames are then
+ * drawn into the sheet in parallel.
+ *
+ * The layouts equal the python packers', so converted assets
+ * don't change.
+ *
+ * pxd:
+ *
+ * cppclass SpriteSheet:
+ *     SpriteSheet(int32_t margin, double aspect_ratio, int32_t max_dimension) except +
+ *
+ *     void add_frame(const uint8_t *rgba, int32_t width, int32_t height,
+ *                    int32_t hotspot_x, int32_t hotspot_y) except +
+ *
+ *     void pack(unsigned threads) except +
+ *
+ *     int32_t get_width()
+ *     int32_t get_height()
+ *     const uint8_t *get_data()
+ *
+ *     size_t get_entry_count()
+ *     const sprite_sheet_entry &get_entry(size_t index) except +
+ */
+class SpriteSheet {
+public:
+	/**
+	 * margin is the space between the frames, aspect_ratio the
+	 * width/height the second tree packer grows to.
+	 * Sheets larger than max_dimension are rejected.
+	 */
+	SpriteSheet(int32_t margin, double aspect_ratio, int32_t max_dimension);
+
+	/**
+	 * add a frame of width * height RGBA pixels.
+	 * The data stays owned by the caller and must be valid until pack().
+	 */
+	void add_frame(const uint8_t *rgba, int32_t width, int32_t height,
+	               int32_t hotspot_x, int32_t hotspot_y);
+
+	/**
+	 * lay out the frames and draw them, with up to threads
+	 * threads, 0 uses all cores.
+	 * Throws if there are no frames or the sheet is too large.
+	 */
+	void pack(unsigned threads=0);
+
+	int32_t get_width() const;
+	int32_t get_height() const;
+
+	/**
+	 * the RGBA pixels, row by row. Unused pixels are transparent black.
+	 */
+	const uint8_t *get_data() const;
+
+	/**
+	 * the frames' positions, in the order they were added.
+	 */
+	size_t get_entry_count() const;
+	const sprite_sheet_entry &get_entry(size_t index) const;
+
+private:
+	struct frame {
+		const uint8_t *rgba;
+		int32_t width;
+		int32_t height;
+		int32_t hotspot_x;
+		int32_t hotspot_y;
+	};
+
+	int32_t margin;
+	double aspect_ratio;
+	int32_t max_dimension;
+
+	std::vector<frame> frames;
+
+	int32_t width;
+	int32_t height;
+	std::vector<uint8_t> data;
+	std::vector<sprite_sheet_entry> entries;
+};
+
+
+}} // openage::convert
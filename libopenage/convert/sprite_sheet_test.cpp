@@ -0,0 +1,74 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "sprite_sheet.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace convert {
+namespace tests {
+
+
+// exported test
+void sprite_sheet() {
+	// frames of width, height, filled with their number
+	std::vector<std::pair<int32_t, int32_t>> sizes{{4, 2}, {2, 2}, {3, 1}};
+	std::vector<std::vector<uint8_t>> pixels;
+
+	SpriteSheet sheet{1, 97.0 / 94, 64};
+	for (size_t i = 0; i < sizes.size(); i++) {
+		pixels.emplace_back(4 * sizes[i].first * sizes[i].second, i + 1);
+		sheet.add_frame(pixels[i].data(), sizes[i].first, sizes[i].second, i, 2 * i);
+	}
+	sheet.pack(2);
+
+	// the single row has the smallest area,
+	// as openage/convert/binpack.py chooses it.
+	(sheet.get_width() == 11 and sheet.get_height() == 2) or TESTFAIL;
+	sheet.get_entry_count() == 3 or TESTFAIL;
+
+	std::vector<int32_t> x_expected{0, 5, 8};
+	for (size_t i = 0; i < sizes.size(); i++) {
+		const sprite_sheet_entry &entry = sheet.get_entry(i);
+		(entry.x == x_expected[i] and entry.y == 0) or TESTFAIL;
+		(entry.w == sizes[i].first and entry.h == sizes[i].second) or TESTFAIL;
+		(entry.cx == static_cast<int32_t>(i) and entry.cy == static_cast<int32_t>(2 * i)) or TESTFAIL;
+	}
+
+	// pixels of the frames, the margin and the space below the last one
+	const uint8_t *data = sheet.get_data();
+	std::vector<std::pair<size_t, uint8_t>> expected{
+		{0, 1}, {3 + 11, 1}, {4, 0}, {5, 2}, {6 + 11, 2}, {8, 3}, {10, 3}, {8 + 11, 0},
+	};
+	for (auto &pixel : expected) {
+		(data[4 * pixel.first] == pixel.second and data[4 * pixel.first + 3] == pixel.second) or TESTFAIL;
+	}
+
+	// equal frames are packed into a square by the tree packer
+	SpriteSheet square{1, 1, 64};
+	std::vector<uint8_t> tile(4 * 2 * 2, 7);
+	for (size_t i = 0; i < 4; i++) {
+		square.add_frame(tile.data(), 2, 2, 0, 0);
+	}
+	square.pack(1);
+	(square.get_width() == 5 and square.get_height() == 5) or TESTFAIL;
+	(square.get_entry(3).x == 3 and square.get_entry(3).y == 3) or TESTFAIL;
+
+	// too large, and empty sheets
+	SpriteSheet small{1, 1, 4};
+	small.add_frame(tile.data(), 2, 2, 0, 0);
+	small.add_frame(tile.data(), 2, 2, 0, 0);
+	small.add_frame(tile.data(), 2, 2, 0, 0);
+	TESTTHROWS(small.pack(1));
+
+	SpriteSheet empty{1, 1, 4};
+	TESTTHROWS(empty.pack(1));
+	TESTTHROWS(sheet.get_entry(3));
+}
+
+
+}}} // openage::convert::tests
@@ -1,6 +1,4 @@
-// Copyright 2013-2015 the openage authors. See copying.md for legal info.
-
-#include <cmath>
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #define GEN_IMPL_PHYS3_CPP
 #include "phys3.h"
@@ -51,6 +49,28 @@ camgame_delta phys3_delta::to_camgame() const {
 	return result;
 }
 
+void to_camgame(size_t count,
+                const phys_t *ne, const phys_t *se, const phys_t *up,
+                pixel_t *x, pixel_t *y) {
+	coord_data* engine_coord_data{ Engine::get_coord_data() };
+	const phys3 camera = engine_coord_data->camgame_phys;
+	const phys_t halfsize_x = engine_coord_data->tile_halfsize.x;
+	const phys_t halfsize_y = engine_coord_data->tile_halfsize.y;
+
+	static_assert(settings::phys_per_tile == (phys_t{1} << settings::phys_t_radix_pos),
+	              "the division by phys_per_tile is done by shifting");
+
+	// the transformation of phys3_delta::to_camgame, the division
+	// rounding to -inf is an arithmetic shift
+	for (size_t i = 0; i < count; i++) {
+		phys_t rel_ne = ne[i] - camera.ne;
+		phys_t rel_se = se[i] - camera.se;
+		phys_t rel_up = up[i] - camera.up;
+		x[i] = (pixel_t) (((rel_ne + rel_se) * halfsize_x) >> settings::phys_t_radix_pos);
+		y[i] = (pixel_t) (((rel_ne - rel_se + rel_up) * halfsize_y) >> settings::phys_t_radix_pos);
+	}
+}
+
 tile3 phys3::to_tile3() const {
 	tile3 result;
 	result.ne = (ne >> settings::phys_t_radix_pos);
@@ -72,13 +92,19 @@ phys3_delta phys3::get_fraction() {
 }
 
 phys_t distance(const phys3 &a, const phys3 &b) {
-	phys_t dx = a.ne - b.ne;
-	phys_t dy = a.se - b.se;
-	return std::hypot(dx, dy);
+	return length(a.ne - b.ne, a.se - b.se);
+}
+
+phys_t distance_squared(const phys3 &a, const phys3 &b) {
+	return length_squared(a.ne - b.ne, a.se - b.se);
+}
+
+bool in_range(const phys3 &a, const phys3 &b, phys_t range) {
+	return range > 0 and distance_squared(a, b) < range * range;
 }
 
 phys3_delta normalize(const phys3_delta &a, const phys_t &length) {
-	phys3_delta result = (a * length) / std::hypot(a.ne, a.se);
+	phys3_delta result = (a * length) / coord::length(a.ne, a.se);
 	return result;
 }
 
@@ -1,7 +1,8 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstddef>
 #include <functional>
 
 #include "decl.h"
@@ -35,16 +36,51 @@ struct phys3_delta {
 	camgame_delta to_camgame() const;
 };
 
+/**
+ * squared length of a vector on the ground.
+ * compare it with the squared range instead of taking the square root.
+ */
+constexpr phys_t length_squared(phys_t ne, phys_t se) {
+	return ne * ne + se * se;
+}
+
+/**
+ * length of a vector on the ground, rounded down.
+ * uses no floating point, so it is the same on all platforms.
+ */
+constexpr phys_t length(phys_t ne, phys_t se) {
+	return static_cast<phys_t>(util::isqrt(static_cast<uint64_t>(length_squared(ne, se))));
+}
+
 /**
  * distance between two points
  */
 coord::phys_t distance(const coord::phys3 &a, const coord::phys3 &b);
 
+/**
+ * squared distance between two points on the ground
+ */
+coord::phys_t distance_squared(const coord::phys3 &a, const coord::phys3 &b);
+
+/**
+ * whether the points are closer than range on the ground
+ */
+bool in_range(const coord::phys3 &a, const coord::phys3 &b, coord::phys_t range);
+
 /**
  * modify the length of a phys3_delta vector
  */
 coord::phys3_delta normalize(const coord::phys3_delta &a, const coord::phys_t &length);
 
+/**
+ * convert count positions to camgame, with the same results as
+ * phys3::to_camgame. the components are stored in separate arrays,
+ * so the conversion is a loop the compiler can vectorize.
+ */
+void to_camgame(size_t count,
+                const phys_t *ne, const phys_t *se, const phys_t *up,
+                pixel_t *x, pixel_t *y);
+
 #include "ops/free.h"
 
 #ifdef GEN_IMPL_PHYS3_CPP
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include <unistd.h>
 
@@ -322,6 +322,61 @@ void phys3_0() {
 	(results_p3d == expected_p3d) or TESTFAIL;
 }
 
+/**
+ * This function tests the batch conversion of phys3 to camgame.
+ */
+void phys3_batch_0() {
+	coord_data* engine_coord_data{ Engine::get_coord_data() };
+	phys3 camera = engine_coord_data->camgame_phys;
+	engine_coord_data->camgame_phys = {720896, 720896, 65536};
+
+	// includes positions before the camera and fractions of tiles,
+	// where the rounding to -inf matters
+	const phys_t ne[] = {0, 655360, 720896, 720895, -1, -98304, 123456789};
+	const phys_t se[] = {0, 655360, 720896, 720897, 1, 32767, -98765};
+	const phys_t up[] = {0, 0, 65536, -1, 3, -65537, 4242};
+	constexpr size_t count = sizeof(ne) / sizeof(ne[0]);
+
+	pixel_t x[count], y[count];
+	to_camgame(count, ne, se, up, x, y);
+
+	for (size_t i = 0; i < count; i++) {
+		camgame expected = phys3{ne[i], se[i], up[i]}.to_camgame();
+		(x[i] == expected.x and y[i] == expected.y) or TESTFAIL;
+	}
+
+	engine_coord_data->camgame_phys = camera;
+}
+
+/**
+ * This function tests the integer distances of phys3.
+ */
+void phys3_distance_0() {
+	static_assert(length(3, 4) == 5, "constexpr length");
+	static_assert(length_squared(-3, 4) == 25, "constexpr squared length");
+
+	// the integer square root is rounded down
+	for (uint64_t i = 0; i < 5000; i++) {
+		uint64_t root = util::isqrt(i);
+		(root * root <= i and (root + 1) * (root + 1) > i) or TESTFAIL;
+	}
+	util::isqrt(UINT64_MAX) == 4294967295 or TESTFAIL;
+
+	phys3 a{65536, 65536, 100};
+	phys3 b{65536 + 3 * 65536, 65536 - 4 * 65536, 0};
+	distance(a, b) == 5 * 65536 or TESTFAIL;
+	distance(b, a) == 5 * 65536 or TESTFAIL;
+	distance_squared(a, b) == phys_t{25} * 65536 * 65536 or TESTFAIL;
+	distance(a, phys3{65537, 65537, 0}) == 1 or TESTFAIL;
+
+	in_range(a, b, 5 * 65536 + 1) or TESTFAIL;
+	in_range(a, b, 5 * 65536) and TESTFAIL;
+	in_range(a, a, 0) and TESTFAIL;
+
+	phys3_delta n = normalize(b - a, 10 * 65536);
+	(n.ne == 6 * 65536 and n.se == -8 * 65536) or TESTFAIL;
+}
+
 /**
  * This function tests the methods of phys3_delta.
  */
@@ -581,6 +636,8 @@ void coord() {
 	tile_and_phys2_0();
 	chunk_0();
 	phys3_0();
+	phys3_batch_0();
+	phys3_distance_0();
 	phys3_delta_0();
 	tile3_0();
 	camgame_0();
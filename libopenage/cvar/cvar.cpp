@@ -1,8 +1,15 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "cvar.h"
 
+#include <fstream>
+#include <vector>
+
+#include "../error/error.h"
 #include "../log/log.h"
+#include "../util/compiler.h"
+#include "../util/dir.h"
+#include "../util/trace.h"
 
 
 namespace openage {
@@ -10,9 +17,11 @@ namespace cvar {
 
 bool CVarManager::create(const std::string &name,
                          const std::pair<get_func, set_func> &accessors) {
-	auto it = this->store.find(name);
+	util::StringId id = util::StringId::intern(name);
+
+	auto it = this->store.find(id);
 	if (it == this->store.end()) {
-		this->store[name] = accessors;
+		this->store[id].accessors = accessors;
 		return true;
 	}
 	return false;
@@ -20,19 +29,57 @@ bool CVarManager::create(const std::string &name,
 
 
 std::string CVarManager::get(const std::string &name) const {
-	auto it = this->store.find(name);
+	// names of unknown entries are not interned by the lookup
+	auto it = this->store.find(name.c_str());
 	if (it != this->store.end()) {
-		return it->second.first();
+		return it->second.accessors.first();
 	}
 	return "";
 }
 
 
 void CVarManager::set(const std::string &name, const std::string &value) const {
-	auto it = store.find(name);
+	auto it = store.find(name.c_str());
 	if (it != store.end()) {
-		it->second.second(value);
+		// typed entries are parsed without the text accessor
+		if (it->second.parse != nullptr) {
+			it->second.parse(value, it->second.variable);
+		}
+		else {
+			it->second.accessors.second(value);
+		}
+	}
+}
+
+
+bool CVarManager::set_from_config(const std::string &name, const std::string &value) const {
+	// like the python loader, unknown entries are ignored
+	auto it = store.find(name.c_str());
+	if (it == store.end()) {
+		return true;
+	}
+
+	if (it->second.parse != nullptr) {
+		return it->second.parse(value, it->second.variable);
+	}
+
+	it->second.accessors.second(value);
+	return true;
+}
+
+
+void *CVarManager::find_variable(const util::StringId &name, const std::type_info &type) const {
+	auto it = this->store.find(name);
+	if (it == this->store.end() or it->second.variable == nullptr) {
+		throw Error(MSG(err) << "there's no config variable " << name.c_str());
 	}
+
+	if (*it->second.type != type) {
+		throw Error(MSG(err) << "the config variable " << name.c_str()
+		            << " is no " << util::demangle(type.name()));
+	}
+
+	return it->second.variable;
 }
 
 
@@ -42,7 +89,65 @@ std::string CVarManager::find_main_config() const {
 
 
 void CVarManager::load_config(const std::string &path) {
-	load_config_file.call(path, this);
+	TRACE_SCOPE("load config");
+	std::unordered_set<std::string> loaded_files;
+	this->load_config(path, loaded_files);
+}
+
+
+void CVarManager::load_config(const std::string &path, std::unordered_set<std::string> &loaded_files) {
+	if (loaded_files.count(path) > 0) {
+		return;
+	}
+
+	std::ifstream config{path};
+	if (not config) {
+		return;
+	}
+
+	log::log(INFO << "loading config file " << path << "...");
+	loaded_files.insert(path);
+
+	std::string directory = util::dirname(path);
+
+	std::string line;
+	size_t line_number = 0;
+	std::vector<std::string> words;
+	while (std::getline(config, line)) {
+		line_number += 1;
+
+		words.clear();
+		std::istringstream in{line};
+		std::string word;
+		while (in >> word) {
+			words.push_back(word);
+		}
+
+		if (words.empty() or words[0][0] == '#') {
+			continue;
+		}
+
+		if (words[0] == "set" and words.size() >= 3) {
+			std::string value = words[2];
+			for (size_t i = 3; i < words.size(); i++) {
+				value += " " + words[i];
+			}
+
+			if (not this->set_from_config(words[1], value)) {
+				log::log(WARN << path << ":" << line_number << ": invalid value "
+				              << value << " for " << words[1]);
+			}
+		}
+		else if (words[0] == "load" and words.size() >= 2) {
+			for (size_t i = 1; i < words.size(); i++) {
+				std::string sub_path = directory.empty() ? words[i] : util::Dir{directory}.join(words[i]);
+				this->load_config(sub_path, loaded_files);
+			}
+		}
+		else {
+			log::log(WARN << path << ":" << line_number << ": unknown config line " << line);
+		}
+	}
 }
 
 
@@ -1,16 +1,21 @@
-// Copyright 2016-2016 the openage authors. See copying.md for legal info.
+// Copyright 2016-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
+#include <ios>
+#include <sstream>
 #include <stdlib.h>
 // pxd: from libcpp.string cimport string
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 // pxd: from libopenage.pyinterface.functional cimport PyIfFunc0, PyIfFunc2
 #include "../pyinterface/functional.h"
+#include "../util/string_id.h"
 
 namespace openage {
 namespace cvar {
@@ -22,6 +27,42 @@ using get_func = std::function<std::string()>;
 using set_func = std::function<void(std::string)>;
 
 
+/**
+ * the text of a config value, as returned by get.
+ */
+template<typename T>
+std::string value_to_string(const T &value) {
+	std::ostringstream out;
+	out << std::boolalpha << value;
+	return out.str();
+}
+
+inline std::string value_to_string(const std::string &value) {
+	return value;
+}
+
+
+/**
+ * parses the text of a config value, as given to set.
+ * returns false if the text is no T.
+ */
+template<typename T>
+bool value_from_string(const std::string &text, T *value) {
+	std::istringstream in{text};
+	T parsed;
+	if (not (in >> std::boolalpha >> parsed)) {
+		return false;
+	}
+	*value = parsed;
+	return true;
+}
+
+inline bool value_from_string(const std::string &text, std::string *value) {
+	*value = text;
+	return true;
+}
+
+
 /**
  * Configuration manager.
  *
@@ -48,6 +89,34 @@ public:
 	bool create(const std::string &name,
 	            const std::pair<get_func, set_func> &accessors);
 
+	/**
+	 * Creates a configuration entry that stores its value in the
+	 * variable, which has to outlive the manager.
+	 * Besides as text, the value can be accessed with get_value
+	 * and set_value.
+	 */
+	template<typename T>
+	bool create(const std::string &name, T *variable) {
+		auto get = [variable]() {
+			return value_to_string(*variable);
+		};
+		auto set = [variable](const std::string &text) {
+			value_from_string(text, variable);
+		};
+
+		if (not this->create(name, std::make_pair(get, set))) {
+			return false;
+		}
+
+		cvar_entry &entry = this->store.at(util::StringId{name.c_str()});
+		entry.type = &typeid(T);
+		entry.variable = variable;
+		entry.parse = [](const std::string &text, void *variable) {
+			return value_from_string(text, static_cast<T *>(variable));
+		};
+		return true;
+	}
+
 	/**
 	 * Gets the value of a config entry.
 	 * Internally calls the stored get function.
@@ -59,14 +128,37 @@ public:
 	 */
 	void set(const std::string &name, const std::string &value) const;
 
+	/**
+	 * Gets the value of an entry that was created from a variable,
+	 * without converting it to text.
+	 * Throws if there's no such entry, or if its variable is no T.
+	 */
+	template<typename T>
+	const T &get_value(const util::StringId &name) const {
+		return *static_cast<const T *>(this->find_variable(name, typeid(T)));
+	}
+
+	/**
+	 * Sets the value of an entry that was created from a variable.
+	 * Throws like get_value.
+	 */
+	template<typename T>
+	void set_value(const util::StringId &name, const T &value) const {
+		*static_cast<T *>(this->find_variable(name, typeid(T))) = value;
+	}
+
 	/**
 	 * Returns the path to the main config file.
 	 */
 	std::string find_main_config() const;
 
 	/**
-	 * Performs the loading of a configuration file
-	 * via the Python implementation.
+	 * Performs the loading of a configuration file.
+	 *
+	 * Each line is either empty, a comment starting with #,
+	 * "set NAME VALUE..." or "load FILE..." with files relative
+	 * to the loading one. Values of entries created from a variable
+	 * are parsed into it directly.
 	 */
 	void load_config(const std::string &path);
 
@@ -76,13 +168,47 @@ public:
 	void load_main_config();
 
 private:
+	/**
+	 * The accessors of a config option, and its variable if it has one.
+	 */
+	struct cvar_entry {
+		std::pair<get_func, set_func> accessors;
+		const std::type_info *type = nullptr;
+		void *variable = nullptr;
+
+		/**
+		 * parses text into the variable, false if it's no valid value.
+		 */
+		bool (*parse)(const std::string &text, void *variable) = nullptr;
+	};
+
+	/**
+	 * Loads a config file and the ones it loads,
+	 * each file is loaded once.
+	 */
+	void load_config(const std::string &path, std::unordered_set<std::string> &loaded_files);
+
+	/**
+	 * Sets an entry to a value read from a config file.
+	 * @returns false if the value is invalid for the entry.
+	 */
+	bool set_from_config(const std::string &name, const std::string &value) const;
+
+	/**
+	 * Returns the variable of an entry, throws if there's none
+	 * or if it has another type.
+	 */
+	void *find_variable(const util::StringId &name, const std::type_info &type) const;
+
 	/**
 	 * Store the key-value pair of config options.
 	 * The clue is to store the "what does the config do",
 	 * not the actual value.
 	 * That way the system is universal.
+	 *
+	 * The names are interned, so they're looked up by their id.
 	 */
-	std::unordered_map<std::string, std::pair<get_func, set_func>> store;
+	std::unordered_map<util::StringId, cvar_entry> store;
 };
 
 
@@ -98,6 +224,8 @@ extern pyinterface::PyIfFunc<std::string> find_main_config_file;
 /**
  * Python function to load a configuration file.
  * The config manager is passed into it.
+ * The config files are loaded by CVarManager::load_config itself,
+ * this is the implementation for the python side.
  *
  * pxd: PyIfFunc2[void, string, CVarManager*] load_config_file
  */
@@ -0,0 +1,116 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "cvar.h"
+
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace cvar {
+namespace tests {
+
+
+// exported test
+void typed_cvars() {
+	CVarManager manager;
+
+	int speed = 5;
+	bool fog = false;
+	std::string title = "openage";
+
+	manager.create("SPEED", &speed) or TESTFAIL;
+	manager.create("FOG", &fog) or TESTFAIL;
+	manager.create("TITLE", &title) or TESTFAIL;
+	not manager.create("SPEED", &speed) or TESTFAIL;
+
+	// the values are accessible as text
+	TESTEQUALS(manager.get("SPEED"), "5");
+	TESTEQUALS(manager.get("FOG"), "false");
+	manager.set("SPEED", "12");
+	manager.set("FOG", "true");
+	manager.set("TITLE", "open age");
+	TESTEQUALS(speed, 12);
+	TESTEQUALS(fog, true);
+	TESTEQUALS(title, "open age");
+
+	// invalid text doesn't change the value
+	manager.set("SPEED", "fast");
+	TESTEQUALS(speed, 12);
+
+	// and without conversion
+	TESTEQUALS(manager.get_value<int>("SPEED"), 12);
+	manager.set_value<int>("SPEED", 3);
+	TESTEQUALS(speed, 3);
+	TESTEQUALS(manager.get_value<std::string>("TITLE"), "open age");
+
+	TESTTHROWS(manager.get_value<float>("SPEED"));
+	TESTTHROWS(manager.get_value<int>("UNKNOWN"));
+
+	// entries with accessors have no variable
+	int calls = 0;
+	manager.create("CALLS", std::make_pair(
+		[&calls]() { return std::to_string(++calls); },
+		[](const std::string &) {}
+	)) or TESTFAIL;
+	TESTEQUALS(manager.get("CALLS"), "1");
+	TESTTHROWS(manager.get_value<int>("CALLS"));
+}
+
+
+
+// exported test
+void config_file() {
+	char dirname[] = "/tmp/openage-config-XXXXXX";
+	if (mkdtemp(dirname) == nullptr) {
+		TESTFAILMSG("could not create a temporary directory");
+	}
+	std::string dir{dirname};
+
+	{
+		std::ofstream main{dir + "/main.oac"};
+		main << "# comment\n"
+		     << "\n"
+		     << "   set SPEED 7\n"
+		     << "set TITLE open   age\n"
+		     << "set FOG maybe\n"
+		     << "set UNKNOWN 1\n"
+		     << "load sub.oac missing.oac\n";
+
+		// loading the main file again is ignored
+		std::ofstream sub{dir + "/sub.oac"};
+		sub << "set FOG true\n"
+		    << "set KEY a\n"
+		    << "load main.oac\n";
+	}
+
+	CVarManager manager;
+	int speed = 5;
+	bool fog = false;
+	std::string title;
+	std::string key;
+	manager.create("SPEED", &speed) or TESTFAIL;
+	manager.create("FOG", &fog) or TESTFAIL;
+	manager.create("TITLE", &title) or TESTFAIL;
+	manager.create("KEY", std::make_pair(
+		[&key]() { return key; },
+		[&key](const std::string &value) { key += value; }
+	)) or TESTFAIL;
+
+	manager.load_config(dir + "/main.oac");
+	TESTEQUALS(speed, 7);
+	TESTEQUALS(fog, true);
+	TESTEQUALS(title, "open age");
+	TESTEQUALS(key, "a");
+
+	// missing files are skipped
+	manager.load_config(dir + "/none.oac");
+
+	std::remove((dir + "/main.oac").c_str());
+	std::remove((dir + "/sub.oac").c_str());
+	rmdir(dirname);
+}
+
+}}} // openage::cvar::tests
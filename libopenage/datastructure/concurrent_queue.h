@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -6,6 +6,7 @@
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <utility>
 
 namespace openage {
 namespace datastructure {
@@ -38,12 +39,12 @@ public:
 	}
 
 	/** Removes the front item of the queue and returns it. */
-	T &pop() {
+	T pop() {
 		std::unique_lock<std::mutex> lock{this->mutex};
 		while (this->queue.empty()) {
 			this->elements_available.wait(lock);
 		}
-		auto &item = this->queue.front();
+		auto item = std::move(this->queue.front());
 		this->queue.pop();
 		return item;
 	}
@@ -0,0 +1,210 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+/** @file
+ * An implicit d-ary heap with decrease_key.
+ *
+ * The items are kept in one array, which makes it faster than the
+ * pairing heap for most searches: no pointers are followed and cleared
+ * heaps are refilled without allocating. Higher arities make the tree
+ * flatter, so pushes and decreases do fewer steps for slightly more
+ * expensive pops.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace datastructure {
+
+template<class T, class compare=std::less<T>, size_t arity=4>
+class DAryHeap {
+	static_assert(arity >= 2, "a heap needs at least two children per node");
+
+public:
+	/**
+	 * identifies a pushed item until it is popped or the heap is cleared.
+	 */
+	using handle_t = size_t;
+
+	DAryHeap() = default;
+
+	/**
+	 * reserves memory for the given number of items.
+	 */
+	void reserve(size_t count) {
+		this->items.reserve(count);
+		this->positions.reserve(count);
+	}
+
+	/**
+	 * adds the given item to the heap.
+	 * O(log n)
+	 */
+	handle_t push(const T &item) {
+		handle_t handle = this->positions.size();
+		this->positions.push_back(this->items.size());
+		this->items.push_back(entry{item, handle});
+		this->sift_up(this->items.size() - 1);
+		return handle;
+	}
+
+	/**
+	 * returns the smallest item on the heap and deletes it.
+	 * O(d log n)
+	 */
+	T pop() {
+		if (this->items.empty()) {
+			throw Error{MSG(err) << "Can't pop an empty heap!"};
+		}
+
+		T ret = std::move(this->items[0].data);
+		this->positions[this->items[0].handle] = popped;
+
+		if (this->items.size() > 1) {
+			this->items[0] = std::move(this->items.back());
+			this->items.pop_back();
+			this->positions[this->items[0].handle] = 0;
+			this->sift_down(0);
+		}
+		else {
+			this->items.pop_back();
+		}
+
+		return ret;
+	}
+
+	/**
+	 * Returns the smallest item on the heap.
+	 * O(1)
+	 */
+	const T &top() const {
+		return this->items[0].data;
+	}
+
+	/**
+	 * Returns the item of a handle that is still on the heap.
+	 */
+	const T &get(handle_t handle) const {
+		return this->items[this->positions[handle]].data;
+	}
+
+	/**
+	 * @returns whether the item of the handle is still on the heap.
+	 */
+	bool contains(handle_t handle) const {
+		return handle < this->positions.size() and this->positions[handle] != popped;
+	}
+
+	/**
+	 * Set the item of a handle to a smaller value and reorder it.
+	 * Also known as the decrease_key operation.
+	 * O(log n)
+	 */
+	void decrease(handle_t handle, const T &data) {
+		size_t idx = this->positions[handle];
+		this->items[idx].data = data;
+		this->sift_up(idx);
+	}
+
+	/**
+	 * erase all elements on the heap and invalidate all handles.
+	 * the memory is kept for the next items.
+	 */
+	void clear() {
+		this->items.clear();
+		this->positions.clear();
+	}
+
+	/**
+	 * @returns the number of items stored on the heap.
+	 */
+	size_t size() const {
+		return this->items.size();
+	}
+
+	/**
+	 * @returns whether there are no items stored on the heap.
+	 */
+	bool empty() const {
+		return this->items.empty();
+	}
+
+private:
+	struct entry {
+		T data;
+		handle_t handle;
+	};
+
+	/** position of handles whose item was popped */
+	static constexpr size_t popped = std::numeric_limits<size_t>::max();
+
+	void sift_up(size_t idx) {
+		entry moving = std::move(this->items[idx]);
+
+		while (idx > 0) {
+			size_t parent = (idx - 1) / arity;
+			if (not this->cmp(moving.data, this->items[parent].data)) {
+				break;
+			}
+
+			this->items[idx] = std::move(this->items[parent]);
+			this->positions[this->items[idx].handle] = idx;
+			idx = parent;
+		}
+
+		this->positions[moving.handle] = idx;
+		this->items[idx] = std::move(moving);
+	}
+
+	void sift_down(size_t idx) {
+		size_t count = this->items.size();
+		entry moving = std::move(this->items[idx]);
+
+		while (true) {
+			size_t first = idx * arity + 1;
+			if (first >= count) {
+				break;
+			}
+
+			// the smallest child
+			size_t last = std::min(first + arity, count);
+			size_t best = first;
+			for (size_t child = first + 1; child < last; child++) {
+				if (this->cmp(this->items[child].data, this->items[best].data)) {
+					best = child;
+				}
+			}
+
+			if (not this->cmp(this->items[best].data, moving.data)) {
+				break;
+			}
+
+			this->items[idx] = std::move(this->items[best]);
+			this->positions[this->items[idx].handle] = idx;
+			idx = best;
+		}
+
+		this->positions[moving.handle] = idx;
+		this->items[idx] = std::move(moving);
+	}
+
+	std::vector<entry> items;
+
+	/** index into items for each handle */
+	std::vector<size_t> positions;
+
+	compare cmp;
+};
+
+template<class T, class compare, size_t arity>
+constexpr size_t DAryHeap<T, compare, arity>::popped;
+
+}} // openage::datastructure
@@ -0,0 +1,644 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPENAGE_FLAT_HASH_SSE2 1
+#endif
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * Hash for coordinates, from their ne and se members.
+ *
+ * std::hash of the coordinates xors the hashes of the members, which
+ * are the values themselves, so neighbouring tiles collide in the low
+ * bits. The flat hash tables need all bits to be mixed, as they pick
+ * the group from the low bits and the tag from the high bits.
+ *
+ * The up member of phys3 is left out, positions only differing in it
+ * are rare and still compared as different keys.
+ */
+struct coord_hash {
+	template<class C>
+	size_t operator ()(const C &pos) const {
+		uint64_t x = static_cast<uint64_t>(pos.ne) * 0x9e3779b97f4a7c15ull;
+		x ^= static_cast<uint64_t>(pos.se);
+
+		// finalizer of splitmix64
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return static_cast<size_t>(x ^ (x >> 31));
+	}
+};
+
+
+/**
+ * Hash table with open addressing, the base of FlatHashMap and FlatHashSet.
+ *
+ * The items are stored in one array instead of a node per item. Next to
+ * it, one control byte per slot tells whether the slot is empty, deleted,
+ * or full, and for full slots holds 7 bits of the hash of the key.
+ * Keys are looked up by comparing a group of 16 control bytes at once,
+ * with SSE2 where available, so the keys are only compared for slots
+ * whose hash bits match. Groups are probed until one has an empty slot.
+ *
+ * Inserting may move all items, which invalidates references and
+ * iterators. Erasing only invalidates those of the erased item.
+ */
+template<class Key, class Policy, class Hash, class Equal>
+class FlatHashTable {
+protected:
+	using slot_type = typename Policy::slot_type;
+	using ctrl_t = int8_t;
+
+	static constexpr ctrl_t ctrl_empty = -128;
+	static constexpr ctrl_t ctrl_deleted = -2;
+
+	static constexpr size_t npos = SIZE_MAX;
+
+public:
+	/**
+	 * slots whose control bytes are compared at once.
+	 */
+	static constexpr size_t group_size = 16;
+
+	template<class S>
+	class basic_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename std::remove_const<S>::type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = S *;
+		using reference = S &;
+
+		basic_iterator()
+			:
+			ctrl{nullptr},
+			slot{nullptr},
+			end{nullptr} {}
+
+		/**
+		 * iterators convert to const iterators.
+		 */
+		template<class O, class = typename std::enable_if<std::is_same<const O, S>::value>::type>
+		basic_iterator(const basic_iterator<O> &other)
+			:
+			ctrl{other.ctrl},
+			slot{other.slot},
+			end{other.end} {}
+
+		S &operator *() const {
+			return *this->slot;
+		}
+
+		S *operator ->() const {
+			return this->slot;
+		}
+
+		basic_iterator &operator ++() {
+			++this->ctrl;
+			++this->slot;
+			this->skip();
+			return *this;
+		}
+
+		basic_iterator operator ++(int) {
+			basic_iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator ==(const basic_iterator &other) const {
+			return this->slot == other.slot;
+		}
+
+		bool operator !=(const basic_iterator &other) const {
+			return this->slot != other.slot;
+		}
+
+	private:
+		friend class FlatHashTable;
+		template<class> friend class basic_iterator;
+
+		basic_iterator(const ctrl_t *ctrl, S *slot, const ctrl_t *end)
+			:
+			ctrl{ctrl},
+			slot{slot},
+			end{end} {
+
+			this->skip();
+		}
+
+		/**
+		 * advance to the next full slot.
+		 */
+		void skip() {
+			while (this->ctrl != this->end and *this->ctrl < 0) {
+				++this->ctrl;
+				++this->slot;
+			}
+		}
+
+		const ctrl_t *ctrl;
+		S *slot;
+		const ctrl_t *end;
+	};
+
+	using iterator = basic_iterator<slot_type>;
+	using const_iterator = basic_iterator<const slot_type>;
+
+	FlatHashTable()
+		:
+		capacity{0},
+		count{0},
+		growth_left{0} {}
+
+	FlatHashTable(const FlatHashTable &other)
+		:
+		FlatHashTable{} {
+
+		this->reserve(other.count);
+		for (auto &item : other) {
+			this->emplace_slot(Policy::key(item), item);
+		}
+	}
+
+	FlatHashTable(FlatHashTable &&other)
+		:
+		FlatHashTable{} {
+
+		this->swap(other);
+	}
+
+	~FlatHashTable() {
+		this->destroy_all();
+	}
+
+	FlatHashTable &operator =(const FlatHashTable &other) {
+		if (this != &other) {
+			FlatHashTable copy{other};
+			this->swap(copy);
+		}
+		return *this;
+	}
+
+	FlatHashTable &operator =(FlatHashTable &&other) {
+		if (this != &other) {
+			this->clear();
+			this->swap(other);
+		}
+		return *this;
+	}
+
+	void swap(FlatHashTable &other) {
+		std::swap(this->ctrl, other.ctrl);
+		std::swap(this->slots, other.slots);
+		std::swap(this->capacity, other.capacity);
+		std::swap(this->count, other.count);
+		std::swap(this->growth_left, other.growth_left);
+		std::swap(this->hasher, other.hasher);
+		std::swap(this->equal, other.equal);
+	}
+
+	iterator begin() {
+		return this->iterator_at(0);
+	}
+
+	iterator end() {
+		return this->iterator_at(this->capacity);
+	}
+
+	const_iterator begin() const {
+		return this->iterator_at(0);
+	}
+
+	const_iterator end() const {
+		return this->iterator_at(this->capacity);
+	}
+
+	size_t size() const {
+		return this->count;
+	}
+
+	bool empty() const {
+		return this->count == 0;
+	}
+
+	iterator find(const Key &key) {
+		size_t index = this->find_index(key);
+		return this->iterator_at(index == npos ? this->capacity : index);
+	}
+
+	const_iterator find(const Key &key) const {
+		size_t index = this->find_index(key);
+		return this->iterator_at(index == npos ? this->capacity : index);
+	}
+
+	size_t count_of(const Key &key) const {
+		return this->find_index(key) == npos ? 0 : 1;
+	}
+
+	size_t erase(const Key &key) {
+		size_t index = this->find_index(key);
+		if (index == npos) {
+			return 0;
+		}
+		this->erase_index(index);
+		return 1;
+	}
+
+	/**
+	 * erase the item the iterator points to.
+	 * @returns the iterator of the next item.
+	 */
+	iterator erase(const_iterator pos) {
+		size_t index = pos.slot - this->slot_at(0);
+		this->erase_index(index);
+
+		iterator next = this->iterator_at(index);
+		return next;
+	}
+
+	/**
+	 * remove all items, the memory is kept for new ones.
+	 */
+	void clear() {
+		this->destroy_all();
+		if (this->capacity > 0) {
+			std::memset(this->ctrl.get(), ctrl_empty, this->capacity);
+		}
+		this->count = 0;
+		this->growth_left = max_load(this->capacity);
+	}
+
+	/**
+	 * make room for the given number of items without growing.
+	 */
+	void reserve(size_t items) {
+		size_t wanted = capacity_for(items);
+		if (wanted > this->capacity) {
+			this->rehash(wanted);
+		}
+	}
+
+protected:
+	/**
+	 * index of the slot holding the key, npos if it's not stored.
+	 */
+	size_t find_index(const Key &key) const {
+		if (this->count == 0) {
+			return npos;
+		}
+
+		size_t hash = this->hasher(key);
+		ctrl_t tag = hash_tag(hash);
+		size_t group_mask = this->capacity / group_size - 1;
+		size_t group = hash & group_mask;
+
+		for (size_t step = 1; ; step++) {
+			const ctrl_t *group_ctrl = &this->ctrl[group * group_size];
+
+			uint32_t matches = match_byte(group_ctrl, tag);
+			while (matches != 0) {
+				size_t index = group * group_size + count_trailing_zeros(matches);
+				if (this->equal(Policy::key(*this->slot_at(index)), key)) {
+					return index;
+				}
+				matches &= matches - 1;
+			}
+
+			// the key would have been stored in this empty slot
+			if (match_byte(group_ctrl, ctrl_empty) != 0) {
+				return npos;
+			}
+
+			// triangular probing visits all groups
+			group = (group + step) & group_mask;
+		}
+	}
+
+	/**
+	 * store a new item for the key if there is none yet.
+	 *
+	 * @returns the index of the item for the key,
+	 *          and whether it was inserted.
+	 */
+	template<class... Args>
+	std::pair<size_t, bool> emplace_slot(const Key &key, Args&&... args) {
+		size_t index = this->find_index(key);
+		if (index != npos) {
+			return {index, false};
+		}
+
+		if (this->growth_left == 0) {
+			size_t wanted = capacity_for(this->count + 1);
+
+			// only rehash at the same size to drop deleted slots
+			// if that frees a fair amount of them
+			if (wanted <= this->capacity and this->count + 1 > max_load(this->capacity) / 2) {
+				wanted = this->capacity * 2;
+			}
+			this->rehash(wanted);
+		}
+
+		size_t hash = this->hasher(key);
+		index = this->find_free(hash);
+		if (this->ctrl[index] == ctrl_empty) {
+			this->growth_left -= 1;
+		}
+
+		new (this->slot_at(index)) slot_type(std::forward<Args>(args)...);
+		this->ctrl[index] = hash_tag(hash);
+		this->count += 1;
+
+		return {index, true};
+	}
+
+	slot_type *slot_at(size_t index) const {
+		return reinterpret_cast<slot_type *>(this->slots.get()) + index;
+	}
+
+	iterator iterator_at(size_t index) {
+		return {this->ctrl.get() + index, this->slot_at(index), this->ctrl.get() + this->capacity};
+	}
+
+	const_iterator iterator_at(size_t index) const {
+		return {this->ctrl.get() + index, this->slot_at(index), this->ctrl.get() + this->capacity};
+	}
+
+private:
+	using storage_t = typename std::aligned_storage<sizeof(slot_type), alignof(slot_type)>::type;
+
+	/**
+	 * the 7 high bits of the hash, stored in the control byte.
+	 */
+	static ctrl_t hash_tag(size_t hash) {
+		return static_cast<ctrl_t>(hash >> (sizeof(size_t) * 8 - 7));
+	}
+
+	/**
+	 * at most 7/8 of the slots are used.
+	 */
+	static size_t max_load(size_t capacity) {
+		return capacity - capacity / 8;
+	}
+
+	static size_t capacity_for(size_t items) {
+		size_t capacity = group_size;
+		while (max_load(capacity) < items) {
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	static unsigned count_trailing_zeros(uint32_t mask) {
+		return __builtin_ctz(mask);
+	}
+
+	/**
+	 * one bit for each control byte of the group equal to value.
+	 */
+	static uint32_t match_byte(const ctrl_t *group, ctrl_t value) {
+#if OPENAGE_FLAT_HASH_SSE2
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value)));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < group_size; i++) {
+			if (group[i] == value) {
+				mask |= uint32_t{1} << i;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	/**
+	 * one bit for each empty or deleted slot of the group,
+	 * their control bytes are the negative ones.
+	 */
+	static uint32_t match_free(const ctrl_t *group) {
+#if OPENAGE_FLAT_HASH_SSE2
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+		return _mm_movemask_epi8(bytes);
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < group_size; i++) {
+			if (group[i] < 0) {
+				mask |= uint32_t{1} << i;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	/**
+	 * the first empty or deleted slot on the probe sequence of the hash.
+	 * there is always one, as the table is never full.
+	 */
+	size_t find_free(size_t hash) const {
+		size_t group_mask = this->capacity / group_size - 1;
+		size_t group = hash & group_mask;
+
+		for (size_t step = 1; ; step++) {
+			uint32_t free = match_free(&this->ctrl[group * group_size]);
+			if (free != 0) {
+				return group * group_size + count_trailing_zeros(free);
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	void erase_index(size_t index) {
+		this->slot_at(index)->~slot_type();
+		this->count -= 1;
+
+		// probing never went past a group with an empty slot,
+		// so the slot can become empty as well.
+		size_t group_start = index - index % group_size;
+		if (match_byte(&this->ctrl[group_start], ctrl_empty) != 0) {
+			this->ctrl[index] = ctrl_empty;
+			this->growth_left += 1;
+		}
+		else {
+			this->ctrl[index] = ctrl_deleted;
+		}
+	}
+
+	void rehash(size_t new_capacity) {
+		std::unique_ptr<ctrl_t[]> old_ctrl = std::move(this->ctrl);
+		std::unique_ptr<storage_t[]> old_slots = std::move(this->slots);
+		size_t old_capacity = this->capacity;
+
+		this->ctrl.reset(new ctrl_t[new_capacity]);
+		this->slots.reset(new storage_t[new_capacity]);
+		std::memset(this->ctrl.get(), ctrl_empty, new_capacity);
+		this->capacity = new_capacity;
+		this->growth_left = max_load(new_capacity) - this->count;
+
+		slot_type *old = reinterpret_cast<slot_type *>(old_slots.get());
+		for (size_t i = 0; i < old_capacity; i++) {
+			if (old_ctrl[i] < 0) {
+				continue;
+			}
+
+			size_t hash = this->hasher(Policy::key(old[i]));
+			size_t index = this->find_free(hash);
+			new (this->slot_at(index)) slot_type(std::move(old[i]));
+			this->ctrl[index] = hash_tag(hash);
+			old[i].~slot_type();
+		}
+	}
+
+	void destroy_all() {
+		if (std::is_trivially_destructible<slot_type>::value) {
+			return;
+		}
+		for (size_t i = 0; i < this->capacity; i++) {
+			if (this->ctrl[i] >= 0) {
+				this->slot_at(i)->~slot_type();
+			}
+		}
+	}
+
+	std::unique_ptr<ctrl_t[]> ctrl;
+	std::unique_ptr<storage_t[]> slots;
+
+	/**
+	 * number of slots, a power of two and at least one group.
+	 */
+	size_t capacity;
+	size_t count;
+
+	/**
+	 * empty slots that may still be used before the table grows.
+	 */
+	size_t growth_left;
+
+	Hash hasher;
+	Equal equal;
+};
+
+
+template<class K, class V>
+struct flat_map_policy {
+	using slot_type = std::pair<K, V>;
+
+	static const K &key(const slot_type &slot) {
+		return slot.first;
+	}
+};
+
+
+template<class K>
+struct flat_set_policy {
+	using slot_type = K;
+
+	static const K &key(const slot_type &slot) {
+		return slot;
+	}
+};
+
+
+/**
+ * Replacement for std::unordered_map with open addressing,
+ * see FlatHashTable. The keys of the items must not be modified.
+ */
+template<class K, class V, class Hash=std::hash<K>, class Equal=std::equal_to<K>>
+class FlatHashMap : public FlatHashTable<K, flat_map_policy<K, V>, Hash, Equal> {
+	using table_t = FlatHashTable<K, flat_map_policy<K, V>, Hash, Equal>;
+
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+	using typename table_t::iterator;
+	using typename table_t::const_iterator;
+
+	size_t count(const K &key) const {
+		return this->count_of(key);
+	}
+
+	V &operator [](const K &key) {
+		size_t index = this->emplace_slot(
+			key,
+			std::piecewise_construct,
+			std::forward_as_tuple(key),
+			std::forward_as_tuple()
+		).first;
+		return this->slot_at(index)->second;
+	}
+
+	std::pair<iterator, bool> insert(const value_type &item) {
+		auto result = this->emplace_slot(item.first, item);
+		return {this->iterator_at(result.first), result.second};
+	}
+
+	/**
+	 * insert an item constructed from the arguments,
+	 * if there is none for the key yet.
+	 */
+	template<class... Args>
+	std::pair<iterator, bool> emplace(const K &key, Args&&... args) {
+		auto result = this->emplace_slot(
+			key,
+			std::piecewise_construct,
+			std::forward_as_tuple(key),
+			std::forward_as_tuple(std::forward<Args>(args)...)
+		);
+		return {this->iterator_at(result.first), result.second};
+	}
+};
+
+
+/**
+ * Replacement for std::unordered_set with open addressing,
+ * see FlatHashTable.
+ */
+template<class K, class Hash=std::hash<K>, class Equal=std::equal_to<K>>
+class FlatHashSet : public FlatHashTable<K, flat_set_policy<K>, Hash, Equal> {
+	using table_t = FlatHashTable<K, flat_set_policy<K>, Hash, Equal>;
+
+public:
+	using key_type = K;
+	using value_type = K;
+	using iterator = typename table_t::const_iterator;
+	using const_iterator = typename table_t::const_iterator;
+
+	iterator begin() const {
+		return table_t::begin();
+	}
+
+	iterator end() const {
+		return table_t::end();
+	}
+
+	iterator find(const K &key) const {
+		return table_t::find(key);
+	}
+
+	size_t count(const K &key) const {
+		return this->count_of(key);
+	}
+
+	std::pair<iterator, bool> insert(const K &key) {
+		auto result = this->emplace_slot(key, key);
+		return {this->iterator_at(result.first), result.second};
+	}
+};
+
+}} // openage::datastructure
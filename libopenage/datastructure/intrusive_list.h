@@ -0,0 +1,236 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+namespace openage {
+namespace datastructure {
+
+template<class T, class tag>
+class IntrusiveList;
+
+
+/**
+ * Base class of the objects that can be linked into an IntrusiveList.
+ *
+ * The list doesn't allocate, the links are stored in the objects. An
+ * object can be in one list per tag, and leaves it when it is destroyed.
+ * Copies of an object are not linked.
+ */
+template<class tag=void>
+class IntrusiveListHook {
+public:
+	IntrusiveListHook()
+		:
+		previous{this},
+		next{this} {}
+
+	IntrusiveListHook(const IntrusiveListHook &)
+		:
+		IntrusiveListHook{} {}
+
+	IntrusiveListHook &operator =(const IntrusiveListHook &) {
+		return *this;
+	}
+
+	~IntrusiveListHook() {
+		this->unlink();
+	}
+
+	/**
+	 * whether this object is in a list.
+	 */
+	bool is_linked() const {
+		return this->next != this;
+	}
+
+	/**
+	 * removes this object from its list.
+	 * O(1)
+	 */
+	void unlink() {
+		this->previous->next = this->next;
+		this->next->previous = this->previous;
+		this->previous = this;
+		this->next = this;
+	}
+
+private:
+	/**
+	 * links this hook in front of the given one.
+	 */
+	void link_before(IntrusiveListHook *position) {
+		this->unlink();
+		this->next = position;
+		this->previous = position->previous;
+		position->previous->next = this;
+		position->previous = this;
+	}
+
+	IntrusiveListHook *previous;
+	IntrusiveListHook *next;
+
+	template<class T, class list_tag>
+	friend class IntrusiveList;
+};
+
+
+/**
+ * Doubly linked list of objects that derive from IntrusiveListHook<tag>.
+ *
+ * The list doesn't own the objects, they must outlive their membership.
+ * Adding an object that is in another list of the same tag moves it.
+ */
+template<class T, class tag=void>
+class IntrusiveList {
+public:
+	using hook_t = IntrusiveListHook<tag>;
+
+	template<class V, class hook_ptr>
+	class basic_iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = V;
+		using difference_type = std::ptrdiff_t;
+		using pointer = V *;
+		using reference = V &;
+
+		explicit basic_iterator(hook_ptr node)
+			:
+			node{node} {}
+
+		V &operator *() const {
+			return static_cast<V &>(*this->node);
+		}
+
+		V *operator ->() const {
+			return &**this;
+		}
+
+		basic_iterator &operator ++() {
+			this->node = this->node->next;
+			return *this;
+		}
+
+		basic_iterator &operator --() {
+			this->node = this->node->previous;
+			return *this;
+		}
+
+		bool operator ==(const basic_iterator &other) const {
+			return this->node == other.node;
+		}
+
+		bool operator !=(const basic_iterator &other) const {
+			return this->node != other.node;
+		}
+
+	private:
+		hook_ptr node;
+	};
+
+	using iterator = basic_iterator<T, hook_t *>;
+	using const_iterator = basic_iterator<const T, const hook_t *>;
+
+	IntrusiveList() = default;
+
+	/**
+	 * unlinks all objects.
+	 */
+	~IntrusiveList() {
+		this->clear();
+	}
+
+	IntrusiveList(const IntrusiveList &) = delete;
+	IntrusiveList &operator =(const IntrusiveList &) = delete;
+
+	/**
+	 * O(1)
+	 */
+	void push_back(T &item) {
+		static_cast<hook_t &>(item).link_before(&this->head);
+	}
+
+	/**
+	 * O(1)
+	 */
+	void push_front(T &item) {
+		static_cast<hook_t &>(item).link_before(this->head.next);
+	}
+
+	/**
+	 * removes the given object, which must be in this list.
+	 * O(1)
+	 */
+	void erase(T &item) {
+		static_cast<hook_t &>(item).unlink();
+	}
+
+	/**
+	 * removes and returns the first object.
+	 * O(1)
+	 */
+	T &pop_front() {
+		T &item = this->front();
+		this->erase(item);
+		return item;
+	}
+
+	T &front() {
+		return static_cast<T &>(*this->head.next);
+	}
+
+	T &back() {
+		return static_cast<T &>(*this->head.previous);
+	}
+
+	bool empty() const {
+		return not this->head.is_linked();
+	}
+
+	/**
+	 * counts the objects, as they may leave the list on their own.
+	 * O(n)
+	 */
+	size_t size() const {
+		size_t count = 0;
+		for (const hook_t *node = this->head.next; node != &this->head; node = node->next) {
+			count += 1;
+		}
+		return count;
+	}
+
+	/**
+	 * unlinks all objects.
+	 * O(n)
+	 */
+	void clear() {
+		while (not this->empty()) {
+			this->head.next->unlink();
+		}
+	}
+
+	iterator begin() {
+		return iterator{this->head.next};
+	}
+
+	iterator end() {
+		return iterator{&this->head};
+	}
+
+	const_iterator begin() const {
+		return const_iterator{this->head.next};
+	}
+
+	const_iterator end() const {
+		return const_iterator{&this->head};
+	}
+
+private:
+	/** sentinel, its next is the first and its previous the last object */
+	hook_t head;
+};
+
+}} // openage::datastructure
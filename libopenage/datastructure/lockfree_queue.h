@@ -0,0 +1,525 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * Size of a cache line, counters written by different
+ * threads are kept this far apart.
+ */
+constexpr size_t cache_line_size = 64;
+
+/**
+ * Rounds the capacity of a ring buffer up to a power of two.
+ */
+inline size_t ring_capacity(size_t capacity) {
+	size_t result = 1;
+	while (result < capacity) {
+		result <<= 1;
+	}
+	return result;
+}
+
+
+/**
+ * A bounded lock-free queue for exactly one producer and one consumer
+ * thread at a time.
+ *
+ * push and pop wait while the queue is full or empty,
+ * try_push and try_pop return immediately instead.
+ *
+ * @param T the item type, must be default constructible.
+ */
+template<typename T>
+class SPSCQueue {
+public:
+	/** Creates a queue for at least the given number of items. */
+	explicit SPSCQueue(size_t capacity)
+		:
+		mask{ring_capacity(capacity) - 1},
+		items{new T[mask + 1]},
+		head{0},
+		cached_tail{0},
+		tail{0},
+		cached_head{0} {}
+
+	SPSCQueue(const SPSCQueue &) = delete;
+	SPSCQueue &operator =(const SPSCQueue &) = delete;
+
+	/** Removes all elements from the queue. Must be called by the consumer. */
+	void clear() {
+		T item;
+		while (this->try_pop(item)) {}
+	}
+
+	/** Returns whether the queue is empty. The result may be outdated instantly. */
+	bool empty() const {
+		return this->head.load(std::memory_order_acquire) ==
+		       this->tail.load(std::memory_order_acquire);
+	}
+
+	/** Returns the maximum number of items in the queue. */
+	size_t capacity() const {
+		return this->mask + 1;
+	}
+
+	/** Removes the front item of the queue, waits if there is none. */
+	T pop() {
+		T item;
+		while (not this->try_pop(item)) {
+			std::this_thread::yield();
+		}
+		return item;
+	}
+
+	/**
+	 * Removes the front item of the queue if there is one.
+	 *
+	 * @returns false if the queue was empty.
+	 */
+	bool try_pop(T &item) {
+		size_t h = this->head.load(std::memory_order_relaxed);
+		if (h == this->cached_tail) {
+			this->cached_tail = this->tail.load(std::memory_order_acquire);
+			if (h == this->cached_tail) {
+				return false;
+			}
+		}
+
+		item = std::move(this->items[h & this->mask]);
+		this->head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Appends the given item to the queue, waits while it is full. */
+	void push(const T &item) {
+		while (not this->try_push(item)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Appends the given item if the queue is not full.
+	 *
+	 * @returns false if the queue was full.
+	 */
+	bool try_push(const T &item) {
+		size_t t = this->tail.load(std::memory_order_relaxed);
+		if (t - this->cached_head > this->mask) {
+			this->cached_head = this->head.load(std::memory_order_acquire);
+			if (t - this->cached_head > this->mask) {
+				return false;
+			}
+		}
+
+		this->items[t & this->mask] = item;
+		this->tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	const size_t mask;
+	std::unique_ptr<T[]> items;
+
+	/** Index of the next item to pop and the consumer's view of the tail. */
+	std::atomic<size_t> head;
+	size_t cached_tail;
+	char padding0[cache_line_size - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+	/** Index of the next item to push and the producer's view of the head. */
+	std::atomic<size_t> tail;
+	size_t cached_head;
+	char padding1[cache_line_size - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+
+/**
+ * A bounded lock-free queue for any number of producer and consumer
+ * threads, after Dmitry Vyukov's bounded MPMC queue.
+ *
+ * Each slot carries a sequence number, which tells producers
+ * and consumers whose turn it is to access the slot.
+ *
+ * push and pop wait while the queue is full or empty,
+ * try_push and try_pop return immediately instead.
+ *
+ * @param T the item type, must be default constructible.
+ */
+template<typename T>
+class MPMCQueue {
+public:
+	/** Creates a queue for at least the given number of items. */
+	explicit MPMCQueue(size_t capacity)
+		:
+		mask{ring_capacity(capacity) - 1},
+		cells{new slot[mask + 1]},
+		enqueue_pos{0},
+		dequeue_pos{0} {
+
+		for (size_t i = 0; i <= this->mask; i++) {
+			this->cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MPMCQueue(const MPMCQueue &) = delete;
+	MPMCQueue &operator =(const MPMCQueue &) = delete;
+
+	/** Removes all elements from the queue. */
+	void clear() {
+		T item;
+		while (this->try_pop(item)) {}
+	}
+
+	/** Returns whether the queue is empty. The result may be outdated instantly. */
+	bool empty() const {
+		return this->enqueue_pos.load(std::memory_order_acquire) <=
+		       this->dequeue_pos.load(std::memory_order_acquire);
+	}
+
+	/** Returns the maximum number of items in the queue. */
+	size_t capacity() const {
+		return this->mask + 1;
+	}
+
+	/** Removes the front item of the queue, waits if there is none. */
+	T pop() {
+		T item;
+		while (not this->try_pop(item)) {
+			std::this_thread::yield();
+		}
+		return item;
+	}
+
+	/**
+	 * Removes the front item of the queue if there is one.
+	 *
+	 * @returns false if the queue was empty.
+	 */
+	bool try_pop(T &item) {
+		size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+		slot *s;
+
+		while (true) {
+			s = &this->cells[pos & this->mask];
+			size_t seq = s->sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+			if (diff == 0) {
+				// the slot is filled, try to claim it
+				if (this->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				// the slot was not filled yet
+				return false;
+			}
+			else {
+				// another consumer was faster
+				pos = this->dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		item = std::move(s->item);
+
+		// the slot can be filled again in the next round
+		s->sequence.store(pos + this->mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** Appends the given item to the queue, waits while it is full. */
+	void push(const T &item) {
+		while (not this->try_push(item)) {
+			std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Appends the given item if the queue is not full.
+	 *
+	 * @returns false if the queue was full.
+	 */
+	bool try_push(const T &item) {
+		size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+		slot *s;
+
+		while (true) {
+			s = &this->cells[pos & this->mask];
+			size_t seq = s->sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+			if (diff == 0) {
+				// the slot is free, try to claim it
+				if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				// the slot was not emptied yet
+				return false;
+			}
+			else {
+				// another producer was faster
+				pos = this->enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		s->item = item;
+
+		// consumers may take the item now
+		s->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Moves the given item into the queue if it is not full,
+	 * it is left untouched otherwise.
+	 *
+	 * @returns false if the queue was full.
+	 */
+	bool try_push(T &&item) {
+		size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+		slot *s;
+
+		while (true) {
+			s = &this->cells[pos & this->mask];
+			size_t seq = s->sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+			if (diff == 0) {
+				// the slot is free, try to claim it
+				if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				// the slot was not emptied yet
+				return false;
+			}
+			else {
+				// another producer was faster
+				pos = this->enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		s->item = std::move(item);
+
+		// consumers may take the item now
+		s->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct slot {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	const size_t mask;
+	std::unique_ptr<slot[]> cells;
+
+	char padding0[cache_line_size];
+
+	/** Position of the next push. */
+	std::atomic<size_t> enqueue_pos;
+	char padding1[cache_line_size - sizeof(std::atomic<size_t>)];
+
+	/** Position of the next pop. */
+	std::atomic<size_t> dequeue_pos;
+	char padding2[cache_line_size - sizeof(std::atomic<size_t>)];
+};
+
+
+/**
+ * An unbounded queue for any number of producer threads and exactly
+ * one consumer thread, after Dmitry Vyukov's node based MPSC queue.
+ *
+ * push is wait-free, it is one atomic exchange. A push becomes
+ * visible to the consumer when it completed, a pop may miss an item
+ * that is pushed at the same time.
+ *
+ * The nodes are kept in a cache of the thread that popped them and
+ * taken from the cache of the pushing thread, so once the caches are
+ * warm, a queue that is pushed and popped by the same threads
+ * doesn't allocate.
+ *
+ * @param T the item type, must be move constructible,
+ *          try_pop also needs it to be move assignable.
+ */
+template<typename T>
+class MPSCQueue {
+public:
+	MPSCQueue()
+		:
+		head{new_node()},
+		tail{head.load(std::memory_order_relaxed)} {}
+
+	~MPSCQueue() {
+		this->drain([](T &&) {});
+		free_node(this->tail);
+	}
+
+	MPSCQueue(const MPSCQueue &) = delete;
+	MPSCQueue &operator =(const MPSCQueue &) = delete;
+
+	/**
+	 * Returns whether the queue is empty. Must be called by the consumer,
+	 * the result may be outdated instantly.
+	 */
+	bool empty() const {
+		return this->tail->next.load(std::memory_order_acquire) == nullptr;
+	}
+
+	/** Appends a copy of the item to the queue. */
+	void push(const T &item) {
+		node *n = new_node();
+		new (&n->storage) T(item);
+		this->link(n);
+	}
+
+	/** Moves the item to the end of the queue. */
+	void push(T &&item) {
+		node *n = new_node();
+		new (&n->storage) T(std::move(item));
+		this->link(n);
+	}
+
+	/**
+	 * Removes the front item of the queue if there is one.
+	 * Must be called by the consumer.
+	 *
+	 * @returns false if the queue was empty.
+	 */
+	bool try_pop(T &item) {
+		return this->pop_with([&item](T &&front) {
+			item = std::move(front);
+		});
+	}
+
+	/**
+	 * Removes the items of the queue and calls func(T &&) for them
+	 * in order, including items pushed by func itself.
+	 * Must be called by the consumer.
+	 *
+	 * @returns the number of items removed.
+	 */
+	template<typename F>
+	size_t drain(F &&func) {
+		size_t count = 0;
+		while (this->pop_with(func)) {
+			count += 1;
+		}
+		return count;
+	}
+
+private:
+	struct node {
+		std::atomic<node *> next;
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+		T &item() {
+			return *reinterpret_cast<T *>(&this->storage);
+		}
+	};
+
+	/**
+	 * The free nodes of a thread, for all queues of the item type.
+	 */
+	struct node_cache {
+		~node_cache() {
+			for (node *n : this->nodes) {
+				delete n;
+			}
+		}
+
+		std::vector<node *> nodes;
+	};
+
+	/**
+	 * The number of free nodes a thread keeps.
+	 */
+	static constexpr size_t max_cached_nodes = 1024;
+
+	static node_cache &get_cache() {
+		thread_local node_cache cache;
+		return cache;
+	}
+
+	static node *new_node() {
+		node_cache &cache = get_cache();
+		node *n;
+		if (cache.nodes.empty()) {
+			n = new node;
+		}
+		else {
+			n = cache.nodes.back();
+			cache.nodes.pop_back();
+		}
+		n->next.store(nullptr, std::memory_order_relaxed);
+		return n;
+	}
+
+	static void free_node(node *n) {
+		node_cache &cache = get_cache();
+		if (cache.nodes.size() < max_cached_nodes) {
+			cache.nodes.push_back(n);
+		}
+		else {
+			delete n;
+		}
+	}
+
+	/** Makes the filled node the last one of the queue. */
+	void link(node *n) {
+		node *prev = this->head.exchange(n, std::memory_order_acq_rel);
+
+		// until this store, the consumer sees the queue end at prev
+		prev->next.store(n, std::memory_order_release);
+	}
+
+	/**
+	 * The front item is in the node after the tail.
+	 * That node becomes the new tail, the old one is freed.
+	 */
+	template<typename F>
+	bool pop_with(F &&func) {
+		node *t = this->tail;
+		node *next = t->next.load(std::memory_order_acquire);
+		if (next == nullptr) {
+			return false;
+		}
+
+		// the node is the tail before func runs,
+		// so func may push to the queue
+		this->tail = next;
+		free_node(t);
+
+		T item{std::move(next->item())};
+		next->item().~T();
+		func(std::move(item));
+		return true;
+	}
+
+	/** The last node, producers append behind it. */
+	std::atomic<node *> head;
+	char padding0[cache_line_size - sizeof(std::atomic<node *>)];
+
+	/**
+	 * The node before the front item, only accessed by the consumer.
+	 * Its item was removed already.
+	 */
+	node *tail;
+};
+
+}} // namespace openage::datastructure
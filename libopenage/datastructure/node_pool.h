@@ -0,0 +1,148 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * Arena for the nodes of a node based container, e.g. a PairingHeap.
+ *
+ * Nodes are constructed in blocks of memory that are kept when the nodes
+ * are released, so after the first search, a container that is cleared
+ * and filled again doesn't allocate anymore. Released nodes are reused
+ * first, reset() rewinds to the start of the first block so the nodes
+ * of the next search lie next to each other again.
+ *
+ * Not thread safe, use one pool per thread.
+ */
+template<class node_t>
+class NodePool {
+public:
+	explicit NodePool(size_t block_size=1024)
+		:
+		block_size{block_size > 0 ? block_size : 1},
+		block{0},
+		used{0},
+		free_list{nullptr},
+		live{0} {}
+
+	/**
+	 * frees the blocks, the containers using the pool
+	 * must have been destroyed or cleared before.
+	 */
+	~NodePool() = default;
+
+	NodePool(const NodePool &) = delete;
+	NodePool &operator =(const NodePool &) = delete;
+
+	/**
+	 * constructs a node from the given arguments.
+	 */
+	template<class ... Args>
+	node_t *create(Args && ... args) {
+		slot *memory = this->take();
+		node_t *node;
+		try {
+			node = new (&memory->storage) node_t(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			this->give_back(memory);
+			throw;
+		}
+
+		this->live += 1;
+		return node;
+	}
+
+	/**
+	 * destroys a node that was created by this pool.
+	 */
+	void release(node_t *node) {
+		node->~node_t();
+		this->give_back(reinterpret_cast<slot *>(node));
+		this->live -= 1;
+	}
+
+	/**
+	 * makes all memory available again, in order.
+	 * all nodes must have been released.
+	 */
+	void reset() {
+		ENSURE(this->live == 0, "resetting a node pool that still has " << this->live << " nodes");
+		this->free_list = nullptr;
+		this->block = 0;
+		this->used = 0;
+	}
+
+	/**
+	 * @returns the number of nodes that exist.
+	 */
+	size_t size() const {
+		return this->live;
+	}
+
+	/**
+	 * @returns the number of nodes that fit into the allocated blocks.
+	 */
+	size_t capacity() const {
+		return this->blocks.size() * this->block_size;
+	}
+
+private:
+	/**
+	 * memory of one node, or the link to the next released one.
+	 */
+	union slot {
+		slot *next;
+		typename std::aligned_storage<sizeof(node_t), alignof(node_t)>::type storage;
+	};
+
+	slot *take() {
+		if (this->free_list != nullptr) {
+			slot *memory = this->free_list;
+			this->free_list = memory->next;
+			return memory;
+		}
+
+		if (this->block < this->blocks.size() and this->used == this->block_size) {
+			this->block += 1;
+			this->used = 0;
+		}
+
+		if (this->block == this->blocks.size()) {
+			this->blocks.emplace_back(new slot[this->block_size]);
+		}
+
+		return &this->blocks[this->block][this->used++];
+	}
+
+	void give_back(slot *memory) {
+		memory->next = this->free_list;
+		this->free_list = memory;
+	}
+
+	size_t block_size;
+
+	std::vector<std::unique_ptr<slot[]>> blocks;
+
+	/** block and slot of the next unused memory */
+	size_t block;
+	size_t used;
+
+	/** released slots, to be used first */
+	slot *free_list;
+
+	/** nodes that were created and not released */
+	size_t live;
+};
+
+}} // openage::datastructure
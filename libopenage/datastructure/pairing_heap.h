@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -9,6 +9,9 @@
  * The main advantage over the STL heap is the presence
  * of the decrease_key operation.
  *
+ * The nodes can be taken from a NodePool, so that a heap
+ * which is cleared and filled again doesn't allocate.
+ *
  * Literature:
  *
  * Fredman, Michael L., Robert Sedgewick, Daniel D. Sleator, and Robert
@@ -18,10 +21,10 @@
 
 #include <functional>
 #include <type_traits>
-#include <unordered_set>
 
 #include "../util/compiler.h"
 #include "../error/error.h"
+#include "node_pool.h"
 
 namespace openage {
 namespace datastructure {
@@ -156,16 +159,22 @@ class PairingHeap {
 public:
 	using node_t = heapnode_t;
 	using this_type = PairingHeap<T, compare, node_t>;
+	using pool_t = NodePool<node_t>;
 
 	/**
 	 * create a empty heap.
+	 * its nodes are taken from the pool, or allocated one by one without it.
 	 */
-	PairingHeap()
+	explicit PairingHeap(pool_t *pool=nullptr)
 		:
 		node_count(0),
-		root_node(nullptr) {
+		root_node(nullptr),
+		pool{pool} {
 	}
 
+	PairingHeap(const this_type &) = delete;
+	this_type &operator =(const this_type &) = delete;
+
 	~PairingHeap() {
 		this->clear();
 	}
@@ -175,7 +184,13 @@ public:
 	 * O(1)
 	 */
 	node_t *push(const T &item) {
-		node_t *new_node = new node_t{item};
+		node_t *new_node;
+		if (this->pool != nullptr) {
+			new_node = this->pool->create(item);
+		}
+		else {
+			new_node = new node_t{item};
+		}
 		this->push_node(new_node);
 		return new_node;
 	}
@@ -256,6 +271,7 @@ public:
 
 	/**
 	 * Delete a node from the heap.
+	 * The node must be one of this heap.
 	 *
 	 * If the item is the current root, just pop().
 	 * else, cut the node from its parent, pop() that subtree
@@ -309,18 +325,40 @@ public:
 		}
 	}
 
+	/**
+	 * Set the data of a node to a smaller value and reorder it.
+	 * O(1)
+	 */
+	void decrease(node_t *node, const T &data) {
+		node->data = data;
+		this->update(node);
+	}
+
 	/**
 	 * erase all elements on the heap.
+	 * O(n)
 	 */
 	void clear() {
-		for (auto it = this->nodes.begin(); it != this->nodes.end();) {
-			// srsly fak u c++ why you so broken pls
-			auto to_erase = it;
-			delete *to_erase;
-			++it;
-			this->nodes.erase(to_erase);
-			this->node_count -= 1;
+		// walk down the first children, a node is destroyed when it has
+		// none left and then is the first child of its parent
+		node_t *node = this->root_node;
+		while (node != nullptr) {
+			if (node->first_child != nullptr) {
+				node = node->first_child;
+				continue;
+			}
+
+			node_t *next = node->next_sibling;
+			node_t *parent = node->parent;
+			if (parent != nullptr) {
+				parent->first_child = next;
+			}
+
+			this->delete_node(node);
+			node = (next != nullptr) ? next : parent;
 		}
+
+		this->root_node = nullptr;
 	}
 
 	/**
@@ -349,7 +387,6 @@ protected:
 			this->root_node = this->root_node->link_with(node);
 		}
 
-		this->nodes.insert(node);
 		this->node_count += 1;
 	}
 
@@ -357,14 +394,13 @@ protected:
 	 * Erase a node from the heap freeing its memory.
 	 */
 	void delete_node(node_t *node) {
-		auto it = this->nodes.find(node);
-		if (likely(it != this->nodes.end())) {
-			this->nodes.erase(it);
+		if (this->pool != nullptr) {
+			this->pool->release(node);
+		}
+		else {
 			delete node;
-			this->node_count -= 1;
-		} else {
-			throw Error{MSG(err) << "Specified node not found for deletion!"};
 		}
+		this->node_count -= 1;
 	}
 
 
@@ -373,7 +409,8 @@ protected:
 	compare cmp;
 	node_t *root_node;
 
-	std::unordered_set<node_t *> nodes;
+	/** where the nodes come from, nullptr to allocate them */
+	pool_t *pool;
 };
 
 }} // openage::datastructure
@@ -0,0 +1,285 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * A vector that stores up to inline_capacity items in itself,
+ * and only allocates memory when it grows beyond that.
+ *
+ * Meant for the many short lists, like the objects on a tile,
+ * where a std::vector would allocate for the first item.
+ * Iterators are pointers, they are invalidated by growing and erasing.
+ */
+template<class T, size_t inline_capacity>
+class SmallVector {
+	static_assert(inline_capacity > 0, "use std::vector without inline storage");
+
+public:
+	using value_type = T;
+	using iterator = T *;
+	using const_iterator = const T *;
+
+	SmallVector()
+		:
+		items{this->inline_items()},
+		count{0},
+		allocated{inline_capacity} {}
+
+	SmallVector(std::initializer_list<T> init)
+		:
+		SmallVector{} {
+
+		this->reserve(init.size());
+		for (auto &item : init) {
+			this->push_back(item);
+		}
+	}
+
+	SmallVector(const SmallVector &other)
+		:
+		SmallVector{} {
+
+		this->reserve(other.count);
+		for (auto &item : other) {
+			this->push_back(item);
+		}
+	}
+
+	SmallVector(SmallVector &&other)
+		:
+		SmallVector{} {
+
+		this->take(std::move(other));
+	}
+
+	~SmallVector() {
+		this->clear();
+		this->release();
+	}
+
+	SmallVector &operator =(const SmallVector &other) {
+		if (this != &other) {
+			this->clear();
+			this->reserve(other.count);
+			for (auto &item : other) {
+				this->push_back(item);
+			}
+		}
+		return *this;
+	}
+
+	SmallVector &operator =(SmallVector &&other) {
+		if (this != &other) {
+			this->clear();
+			this->release();
+			this->take(std::move(other));
+		}
+		return *this;
+	}
+
+	void push_back(const T &item) {
+		this->emplace_back(item);
+	}
+
+	void push_back(T &&item) {
+		this->emplace_back(std::move(item));
+	}
+
+	template<class ... Args>
+	T &emplace_back(Args && ... args) {
+		if (this->count == this->allocated) {
+			// the arguments may be items of this vector
+			T item(std::forward<Args>(args)...);
+			this->grow(this->allocated * 2);
+			new (this->items + this->count) T(std::move(item));
+		}
+		else {
+			new (this->items + this->count) T(std::forward<Args>(args)...);
+		}
+		this->count += 1;
+		return this->back();
+	}
+
+	void pop_back() {
+		this->count -= 1;
+		this->items[this->count].~T();
+	}
+
+	/**
+	 * removes the item at pos, returns the iterator to the following one.
+	 * O(n)
+	 */
+	iterator erase(const_iterator pos) {
+		return this->erase(pos, pos + 1);
+	}
+
+	/**
+	 * removes the items of [first, last).
+	 * O(n)
+	 */
+	iterator erase(const_iterator first, const_iterator last) {
+		iterator begin = this->items + (first - this->items);
+		iterator end = this->items + (last - this->items);
+		iterator new_end = std::move(end, this->end(), begin);
+		while (this->end() != new_end) {
+			this->pop_back();
+		}
+		return begin;
+	}
+
+	void clear() {
+		while (this->count > 0) {
+			this->pop_back();
+		}
+	}
+
+	/**
+	 * makes room for count items without further allocation.
+	 */
+	void reserve(size_t count) {
+		if (count > this->allocated) {
+			this->grow(count);
+		}
+	}
+
+	size_t size() const {
+		return this->count;
+	}
+
+	size_t capacity() const {
+		return this->allocated;
+	}
+
+	bool empty() const {
+		return this->count == 0;
+	}
+
+	/**
+	 * whether the items are stored in the vector itself.
+	 */
+	bool is_inline() const {
+		return this->items == this->inline_items();
+	}
+
+	T &operator [](size_t idx) {
+		return this->items[idx];
+	}
+
+	const T &operator [](size_t idx) const {
+		return this->items[idx];
+	}
+
+	T &front() {
+		return this->items[0];
+	}
+
+	const T &front() const {
+		return this->items[0];
+	}
+
+	T &back() {
+		return this->items[this->count - 1];
+	}
+
+	const T &back() const {
+		return this->items[this->count - 1];
+	}
+
+	T *data() {
+		return this->items;
+	}
+
+	const T *data() const {
+		return this->items;
+	}
+
+	iterator begin() {
+		return this->items;
+	}
+
+	iterator end() {
+		return this->items + this->count;
+	}
+
+	const_iterator begin() const {
+		return this->items;
+	}
+
+	const_iterator end() const {
+		return this->items + this->count;
+	}
+
+private:
+	T *inline_items() {
+		return reinterpret_cast<T *>(&this->storage);
+	}
+
+	const T *inline_items() const {
+		return reinterpret_cast<const T *>(&this->storage);
+	}
+
+	/**
+	 * moves the items to a new allocation for new_capacity items.
+	 */
+	void grow(size_t new_capacity) {
+		T *new_items = static_cast<T *>(::operator new(new_capacity * sizeof(T)));
+		for (size_t i = 0; i < this->count; i++) {
+			new (new_items + i) T(std::move(this->items[i]));
+			this->items[i].~T();
+		}
+
+		this->release();
+		this->items = new_items;
+		this->allocated = new_capacity;
+	}
+
+	/**
+	 * frees the allocation, the items must have been destroyed or moved.
+	 */
+	void release() {
+		if (not this->is_inline()) {
+			::operator delete(this->items);
+			this->items = this->inline_items();
+			this->allocated = inline_capacity;
+		}
+	}
+
+	/**
+	 * takes the items of other, which is empty afterwards.
+	 * this vector must be empty and inline.
+	 */
+	void take(SmallVector &&other) {
+		if (other.is_inline()) {
+			for (auto &item : other) {
+				this->push_back(std::move(item));
+			}
+			other.clear();
+		}
+		else {
+			this->items = other.items;
+			this->count = other.count;
+			this->allocated = other.allocated;
+			other.items = other.inline_items();
+			other.count = 0;
+			other.allocated = inline_capacity;
+		}
+	}
+
+	T *items;
+	size_t count;
+	size_t allocated;
+
+	typename std::aligned_storage<sizeof(T) * inline_capacity, alignof(T)>::type storage;
+};
+
+}} // openage::datastructure
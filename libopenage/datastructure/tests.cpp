@@ -1,11 +1,32 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "tests.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "../coord/tile.h"
+#include "../log/log.h"
 #include "../testing/testing.h"
+#include "../util/timing.h"
 
+#include "concurrent_queue.h"
+#include "dary_heap.h"
 #include "doubly_linked_list.h"
+#include "flat_hash_map.h"
+#include "intrusive_list.h"
+#include "lockfree_queue.h"
+#include "node_pool.h"
 #include "pairing_heap.h"
+#include "small_vector.h"
+#include "timer_wheel.h"
 
 
 namespace openage {
@@ -109,12 +130,85 @@ void pairing_heap_3() {
 }
 
 
+void pairing_heap_4() {
+	NodePool<PairingHeap<heap_elem>::node_t> pool{4};
+	PairingHeap<heap_elem> heap{&pool};
+
+	for (int round = 0; round < 3; round++) {
+		for (int i = 9; i >= 0; i--) {
+			heap.push(heap_elem{i * 10});
+		}
+		auto node = heap.push(heap_elem{55});
+		heap.decrease(node, heap_elem{-1});
+
+		(pool.size() == 11) or TESTFAIL;
+		(-1 == heap.pop().data) or TESTFAIL;
+		(0 == heap.pop().data) or TESTFAIL;
+		(10 == heap.pop().data) or TESTFAIL;
+
+		// the remaining nodes go back to the pool
+		heap.clear();
+		heap.empty() or TESTFAIL;
+		(pool.size() == 0) or TESTFAIL;
+
+		// the memory of the first round is reused
+		pool.reset();
+		(pool.capacity() == 12) or TESTFAIL;
+	}
+}
+
+
 // exported test
 void pairing_heap() {
 	pairing_heap_0();
 	pairing_heap_1();
 	pairing_heap_2();
 	pairing_heap_3();
+	pairing_heap_4();
+}
+
+
+// exported test
+void dary_heap() {
+	DAryHeap<heap_elem, std::less<heap_elem>, 4> heap;
+	heap.empty() or TESTFAIL;
+
+	// pops in order, for more items than one level holds
+	std::vector<DAryHeap<heap_elem>::handle_t> handles;
+	for (int i = 0; i < 100; i++) {
+		handles.push_back(heap.push(heap_elem{(i * 37) % 100 + 100}));
+	}
+	(heap.size() == 100) or TESTFAIL;
+
+	// the item with handle 50 becomes the smallest
+	heap.decrease(handles[50], heap_elem{0});
+	(heap.get(handles[50]).data == 0) or TESTFAIL;
+	(heap.top().data == 0) or TESTFAIL;
+
+	(0 == heap.pop().data) or TESTFAIL;
+	heap.contains(handles[50]) and TESTFAIL;
+	heap.contains(handles[51]) or TESTFAIL;
+
+	int last = -1;
+	while (not heap.empty()) {
+		int value = heap.pop().data;
+		(value > last) or TESTFAIL;
+		last = value;
+	}
+	(last == 199) or TESTFAIL;
+
+	bool thrown = false;
+	try {
+		heap.pop();
+	}
+	catch (Error &) {
+		thrown = true;
+	}
+	thrown or TESTFAIL;
+
+	heap.push(heap_elem{1});
+	heap.clear();
+	heap.empty() or TESTFAIL;
 }
 
 
@@ -157,6 +251,569 @@ void doubly_linked_list() {
 	(list.size() == 0) or TESTFAIL;
 }
 
+
+namespace {
+
+/**
+ * pushes the numbers 1 to count from multiple producers
+ * and checks that the consumers receive all of them.
+ *
+ * @returns false if an item was lost or duplicated
+ */
+template<typename Q>
+bool queue_contention(Q &queue, int producers, int consumers, int count) {
+	int total = producers * count;
+	std::atomic<int> received{0};
+	std::atomic<long long> sum{0};
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&queue, count]() {
+			for (int i = 1; i <= count; i++) {
+				queue.push(i);
+			}
+		});
+	}
+
+	// the consumers share the items, the last
+	// ones may wait in pop for a moment
+	for (int c = 0; c < consumers; c++) {
+		int share = total / consumers + (c < total % consumers ? 1 : 0);
+		threads.emplace_back([&queue, &received, &sum, share]() {
+			long long local = 0;
+			for (int i = 0; i < share; i++) {
+				local += queue.pop();
+			}
+			sum += local;
+			received += share;
+		});
+	}
+
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	long long expected = static_cast<long long>(producers) * count * (count + 1) / 2;
+	return received.load() == total and sum.load() == expected and queue.empty();
+}
+
+
+/**
+ * measures the time queue_contention takes in milliseconds
+ */
+template<typename Q>
+double queue_benchmark_run(Q &queue, int producers, int consumers, int count) {
+	time_nsec_t start = timing::get_monotonic_time();
+	queue_contention(queue, producers, consumers, count) or TESTFAIL;
+	return (timing::get_monotonic_time() - start) / 1e6;
+}
+
+} // anonymous namespace
+
+
+namespace {
+
+struct list_item : IntrusiveListHook<> {
+	explicit list_item(int value) : value{value} {}
+	int value;
+};
+
+} // anonymous namespace
+
+
+// exported test
+void intrusive_list() {
+	IntrusiveList<list_item> list;
+	list.empty() or TESTFAIL;
+
+	list_item a{0}, b{1}, c{2};
+	list.push_back(b);
+	list.push_back(c);
+	list.push_front(a);
+	(list.size() == 3) or TESTFAIL;
+
+	std::vector<int> values;
+	for (auto &item : list) {
+		values.push_back(item.value);
+	}
+	(values == std::vector<int>{0, 1, 2}) or TESTFAIL;
+
+	list.erase(b);
+	b.is_linked() and TESTFAIL;
+	(list.front().value == 0 and list.back().value == 2) or TESTFAIL;
+
+	// destroyed items leave the list
+	{
+		list_item d{3};
+		list.push_back(d);
+		(list.size() == 3) or TESTFAIL;
+	}
+	(list.size() == 2) or TESTFAIL;
+
+	// adding a linked item moves it
+	IntrusiveList<list_item> other;
+	other.push_back(a);
+	(list.size() == 1 and other.size() == 1) or TESTFAIL;
+
+	(other.pop_front().value == 0) or TESTFAIL;
+	other.empty() or TESTFAIL;
+
+	list.clear();
+	c.is_linked() and TESTFAIL;
+}
+
+
+// exported test
+void small_vector() {
+	SmallVector<int, 4> numbers;
+	numbers.is_inline() or TESTFAIL;
+
+	for (int i = 0; i < 4; i++) {
+		numbers.push_back(i);
+	}
+	numbers.is_inline() or TESTFAIL;
+
+	// grows to the heap
+	numbers.push_back(numbers[0]);
+	numbers.is_inline() and TESTFAIL;
+	(numbers.size() == 5 and numbers.back() == 0) or TESTFAIL;
+
+	numbers.erase(std::remove(numbers.begin(), numbers.end(), 0), numbers.end());
+	(numbers.size() == 3 and numbers.front() == 1) or TESTFAIL;
+
+	SmallVector<int, 4> copy{numbers};
+	SmallVector<int, 4> moved{std::move(numbers)};
+	(copy.size() == 3 and moved.size() == 3 and numbers.empty()) or TESTFAIL;
+	numbers.is_inline() or TESTFAIL;
+
+	// items with destructors are moved between the storages
+	SmallVector<std::string, 2> strings{"a", "b"};
+	strings.push_back(std::string(100, 'c'));
+	strings.erase(strings.begin());
+	(strings.size() == 2 and strings[0] == "b" and strings[1].size() == 100) or TESTFAIL;
+
+	SmallVector<std::string, 2> inline_strings{"x"};
+	inline_strings = std::move(strings);
+	(inline_strings.size() == 2 and inline_strings[0] == "b") or TESTFAIL;
+	strings = inline_strings;
+	(strings.size() == 2 and strings[1].size() == 100) or TESTFAIL;
+
+	strings.clear();
+	strings.empty() or TESTFAIL;
+}
+
+
+// exported test
+void flat_hash_map() {
+	FlatHashMap<coord::tile, int, coord_hash> map;
+	(map.empty() and map.find({0, 0}) == std::end(map)) or TESTFAIL;
+
+	// enough items for several rehashes
+	for (int i = 0; i < 1000; i++) {
+		map[coord::tile{i % 40, i / 40}] = i;
+	}
+	(map.size() == 1000) or TESTFAIL;
+	(map[coord::tile{3, 2}] == 83) or TESTFAIL;
+	map.insert({coord::tile{3, 2}, 0}).second and TESTFAIL;
+
+	for (int i = 0; i < 1000; i += 2) {
+		(map.erase(coord::tile{i % 40, i / 40}) == 1) or TESTFAIL;
+	}
+	(map.size() == 500 and map.count({0, 0}) == 0 and map.count({1, 0}) == 1) or TESTFAIL;
+
+	int sum = 0;
+	for (auto &item : map) {
+		(item.second % 2 == 1 and item.first.ne == item.second % 40) or TESTFAIL;
+		sum += item.second;
+	}
+	(sum == 250000) or TESTFAIL;
+
+	// erasing while iterating
+	for (auto it = std::begin(map); it != std::end(map);) {
+		if (it->second < 500) {
+			it = map.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	(map.size() == 250) or TESTFAIL;
+
+	// deleted slots are reused
+	for (int round = 0; round < 100; round++) {
+		map.emplace(coord::tile{-1, round}, round).second or TESTFAIL;
+		(map.erase(coord::tile{-1, round}) == 1) or TESTFAIL;
+	}
+	(map.size() == 250) or TESTFAIL;
+
+	FlatHashMap<std::string, std::unique_ptr<int>> owning;
+	owning.emplace("a", std::make_unique<int>(1));
+	owning["b"] = std::make_unique<int>(2);
+	FlatHashMap<std::string, std::unique_ptr<int>> moved{std::move(owning)};
+	(owning.empty() and *moved["a"] == 1 and *moved["b"] == 2) or TESTFAIL;
+
+	FlatHashSet<coord::tile, coord_hash> set;
+	set.insert({1, 2}).second or TESTFAIL;
+	set.insert({1, 2}).second and TESTFAIL;
+	FlatHashSet<coord::tile, coord_hash> copy = set;
+	set.clear();
+	(set.empty() and copy.count({1, 2}) == 1) or TESTFAIL;
+}
+
+
+// exported test
+void lockfree_queue() {
+	MPMCQueue<int> mpmc{3};
+	(mpmc.capacity() == 4) or TESTFAIL;
+	mpmc.empty() or TESTFAIL;
+
+	int item;
+	mpmc.try_pop(item) and TESTFAIL;
+
+	// fill it, wrap around and keep the order
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < 4; i++) {
+			mpmc.try_push(round * 4 + i) or TESTFAIL;
+		}
+		mpmc.try_push(-1) and TESTFAIL;
+
+		for (int i = 0; i < 4; i++) {
+			(mpmc.try_pop(item) and item == round * 4 + i) or TESTFAIL;
+		}
+		mpmc.empty() or TESTFAIL;
+	}
+
+	SPSCQueue<int> spsc{4};
+	for (int i = 0; i < 4; i++) {
+		spsc.try_push(i) or TESTFAIL;
+	}
+	spsc.try_push(-1) and TESTFAIL;
+	(spsc.pop() == 0) or TESTFAIL;
+	spsc.try_push(4) or TESTFAIL;
+	for (int i = 1; i <= 4; i++) {
+		(spsc.try_pop(item) and item == i) or TESTFAIL;
+	}
+	spsc.try_pop(item) and TESTFAIL;
+
+	spsc.push(5);
+	spsc.clear();
+	spsc.empty() or TESTFAIL;
+
+	// no item may get lost while the threads compete
+	MPMCQueue<int> shared{64};
+	queue_contention(shared, 4, 4, 20000) or TESTFAIL;
+
+	SPSCQueue<int> pipe{64};
+	queue_contention(pipe, 1, 1, 100000) or TESTFAIL;
+
+	// a single consumer receives the items in order
+	std::thread producer{[&pipe]() {
+		for (int i = 0; i < 100000; i++) {
+			pipe.push(i);
+		}
+	}};
+	for (int i = 0; i < 100000; i++) {
+		(pipe.pop() == i) or TESTFAIL;
+	}
+	producer.join();
+
+	MPSCQueue<std::unique_ptr<int>> inbox;
+	inbox.empty() or TESTFAIL;
+	inbox.push(std::make_unique<int>(1));
+	inbox.push(std::make_unique<int>(2));
+
+	// items pushed while draining are drained as well
+	std::vector<int> drained;
+	(inbox.drain([&](std::unique_ptr<int> &&value) {
+		drained.push_back(*value);
+		if (*value == 1) {
+			inbox.push(std::make_unique<int>(3));
+		}
+	}) == 3) or TESTFAIL;
+	(drained == std::vector<int>{1, 2, 3}) or TESTFAIL;
+	inbox.empty() or TESTFAIL;
+
+	// items left in the queue are destroyed with it
+	{
+		MPSCQueue<std::shared_ptr<int>> owner;
+		auto value = std::make_shared<int>(4);
+		owner.push(value);
+		(value.use_count() == 2) or TESTFAIL;
+	}
+
+	// the consumer gets the items of each producer in order
+	constexpr int producers = 4;
+	constexpr int count = 20000;
+	MPSCQueue<int> shared_inbox;
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&shared_inbox, p]() {
+			for (int i = 0; i < count; i++) {
+				shared_inbox.push(p * count + i);
+			}
+		});
+	}
+
+	std::vector<int> next(producers, 0);
+	int received = 0;
+	while (received < producers * count) {
+		received += shared_inbox.drain([&next](int &&value) {
+			(value % count == next[value / count]++) or TESTFAIL;
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	shared_inbox.empty() or TESTFAIL;
+}
+
+
+// exported test
+void timer_wheel() {
+	TimerWheel<int> wheel{10};
+	wheel.empty() or TESTFAIL;
+
+	// deadlines in all levels and beyond them, out of order
+	std::vector<uint64_t> deadlines{
+		11, 12, 12, 73, 74, 500, 4106, 4107, 300000, 16777300, 40000000
+	};
+	for (size_t i = deadlines.size(); i-- > 0;) {
+		wheel.schedule(deadlines[i], static_cast<int>(i));
+	}
+	(wheel.size() == deadlines.size()) or TESTFAIL;
+
+	std::vector<uint64_t> fired;
+	auto record = [&fired](uint64_t deadline, int &&) {
+		fired.push_back(deadline);
+	};
+
+	// no timer fires early, each fires in the advance reaching it
+	uint64_t time = 10;
+	for (uint64_t to : {11, 50, 74, 4106, 4107, 1000000, 16777299, 16777300, 50000000}) {
+		size_t begin = fired.size();
+		wheel.advance(to, record);
+		(wheel.time() == to) or TESTFAIL;
+		for (size_t i = begin; i < fired.size(); i++) {
+			(fired[i] > time and fired[i] <= to) or TESTFAIL;
+			(i == 0 or fired[i - 1] <= fired[i]) or TESTFAIL;
+		}
+		for (auto deadline : deadlines) {
+			if (deadline > time and deadline <= to) {
+				(std::count(std::begin(fired), std::end(fired), deadline) ==
+				 std::count(std::begin(deadlines), std::end(deadlines), deadline)) or TESTFAIL;
+			}
+		}
+		time = to;
+	}
+	(fired == deadlines) or TESTFAIL;
+	wheel.empty() or TESTFAIL;
+
+	// timers scheduled for the past fire with the next advance
+	wheel.schedule(20, 0);
+	(wheel.advance(60000000, record) == 1) or TESTFAIL;
+
+	// timers can be scheduled while firing
+	int chain = 0;
+	wheel.schedule(60000100, 0);
+	wheel.advance(60001000, [&](uint64_t deadline, int &&) {
+		chain += 1;
+		if (chain < 5) {
+			wheel.schedule(deadline + 100, 0);
+		}
+	});
+	(chain == 5 and wheel.empty()) or TESTFAIL;
+
+	wheel.schedule(60001100, 0);
+	wheel.clear();
+	(wheel.advance(70000000, record) == 0) or TESTFAIL;
+}
+
+
+namespace {
+
+/** open list entry of the heap benchmark: cost, cell */
+using search_entry = std::pair<uint32_t, uint32_t>;
+
+/**
+ * A*-like workload: dijkstra on a grid with random cell costs, which
+ * pushes, pops and decreases about as often as a path search.
+ * Returns the sum of the distances to compare the heaps.
+ */
+template<class Heap, class Handle>
+uint64_t grid_search(Heap &heap, std::vector<Handle> &handles,
+                     const std::vector<uint32_t> &weights, int width) {
+	constexpr uint32_t unseen = UINT32_MAX;
+	std::vector<uint32_t> distance(weights.size(), unseen);
+	std::vector<bool> closed(weights.size(), false);
+
+	distance[0] = 0;
+	handles[0] = heap.push(search_entry{0, 0});
+
+	uint64_t sum = 0;
+	while (not heap.empty()) {
+		uint32_t cell = heap.pop().second;
+		closed[cell] = true;
+		sum += distance[cell];
+
+		int x = cell % width;
+		int y = cell / width;
+		const int offsets[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+		for (auto &offset : offsets) {
+			int nx = x + offset[0];
+			int ny = y + offset[1];
+			if (nx < 0 or ny < 0 or nx >= width or ny >= width) {
+				continue;
+			}
+
+			uint32_t next = ny * width + nx;
+			uint32_t cost = distance[cell] + weights[next];
+			if (closed[next] or cost >= distance[next]) {
+				continue;
+			}
+
+			if (distance[next] == unseen) {
+				handles[next] = heap.push(search_entry{cost, next});
+			}
+			else {
+				heap.decrease(handles[next], search_entry{cost, next});
+			}
+			distance[next] = cost;
+		}
+	}
+	return sum;
+}
+
+} // anonymous namespace
+
+
+// exported demo
+void heap_benchmark() {
+	constexpr int width = 256;
+	constexpr int searches = 20;
+
+	std::vector<uint32_t> weights(width * width);
+	uint32_t state = 1;
+	for (auto &weight : weights) {
+		state = state * 1664525 + 1013904223;
+		weight = 1 + (state >> 24) % 16;
+	}
+
+	using pairing_t = PairingHeap<search_entry>;
+	uint64_t expected = 0;
+
+	auto run = [&](const char *name, auto search) {
+		time_nsec_t start = timing::get_monotonic_time();
+		for (int i = 0; i < searches; i++) {
+			uint64_t sum = search();
+			if (expected == 0) {
+				expected = sum;
+			}
+			(sum == expected) or TESTFAIL;
+		}
+		double ms = (timing::get_monotonic_time() - start) / 1e6 / searches;
+		log::log(MSG(info) << name << ": " << ms << " ms per search");
+	};
+
+	std::vector<pairing_t::node_t *> nodes(weights.size());
+	run("pairing heap", [&]() {
+		pairing_t heap;
+		return grid_search(heap, nodes, weights, width);
+	});
+
+	NodePool<pairing_t::node_t> pool;
+	run("pairing heap, node pool", [&]() {
+		pairing_t heap{&pool};
+		uint64_t sum = grid_search(heap, nodes, weights, width);
+		pool.reset();
+		return sum;
+	});
+
+	std::vector<size_t> handles(weights.size());
+	DAryHeap<search_entry, std::less<search_entry>, 2> binary;
+	run("binary heap", [&]() {
+		binary.clear();
+		return grid_search(binary, handles, weights, width);
+	});
+
+	DAryHeap<search_entry, std::less<search_entry>, 4> quaternary;
+	run("4-ary heap", [&]() {
+		quaternary.clear();
+		return grid_search(quaternary, handles, weights, width);
+	});
+}
+
+
+// exported demo
+void hash_benchmark() {
+	constexpr int width = 256;
+	constexpr int rounds = 10;
+
+	// a flood fill over tiles like the terrain search
+	auto fill = [&](auto &visited) {
+		uint64_t found = 0;
+		for (int round = 0; round < rounds; round++) {
+			visited.clear();
+			for (coord::tile_t se = 0; se < width; se++) {
+				for (coord::tile_t ne = 0; ne < width; ne++) {
+					visited.insert(coord::tile{ne, se});
+				}
+			}
+			for (coord::tile_t se = 0; se < width; se++) {
+				for (coord::tile_t ne = 0; ne < width; ne += 2) {
+					found += visited.count(coord::tile{ne, se + width / 2});
+				}
+			}
+		}
+		return found;
+	};
+
+	auto run = [&](const char *name, auto &visited) {
+		time_nsec_t start = timing::get_monotonic_time();
+		uint64_t found = fill(visited);
+		double ms = (timing::get_monotonic_time() - start) / 1e6 / rounds;
+		(found == uint64_t{rounds} * width * width / 4) or TESTFAIL;
+		log::log(MSG(info) << name << ": " << ms << " ms per fill");
+	};
+
+	std::unordered_set<coord::tile> node_based;
+	run("std::unordered_set", node_based);
+
+	std::unordered_set<coord::tile, coord_hash> node_based_mixed;
+	run("std::unordered_set, coord_hash", node_based_mixed);
+
+	FlatHashSet<coord::tile, coord_hash> flat;
+	run("FlatHashSet", flat);
+}
+
+
+// exported demo
+void queue_benchmark() {
+	constexpr int count = 200000;
+	constexpr size_t capacity = 1024;
+
+	for (int threads : {1, 2, 4}) {
+		ConcurrentQueue<int> locked;
+		MPMCQueue<int> lockfree{capacity};
+
+		double locked_ms = queue_benchmark_run(locked, threads, threads, count);
+		double lockfree_ms = queue_benchmark_run(lockfree, threads, threads, count);
+
+		log::log(MSG(info) << threads << " producers, " << threads << " consumers: "
+		         << "mutex " << locked_ms << " ms, "
+		         << "mpmc " << lockfree_ms << " ms");
+	}
+
+	ConcurrentQueue<int> locked;
+	SPSCQueue<int> lockfree{capacity};
+
+	double locked_ms = queue_benchmark_run(locked, 1, 1, count);
+	double lockfree_ms = queue_benchmark_run(lockfree, 1, 1, count);
+
+	log::log(MSG(info) << "1 producer, 1 consumer: "
+	         << "mutex " << locked_ms << " ms, "
+	         << "spsc " << lockfree_ms << " ms");
+}
+
 } // namespace tests
 } // namespace datastructure
 } // namespace openage
@@ -0,0 +1,263 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+/** @file
+ * This file contains the implementation of a hierarchical timer wheel.
+ * It stores values with a deadline and returns them once the time has
+ * advanced beyond it.
+ *
+ * Scheduling a timer is constant time. Advancing skips the ranges without
+ * timers and touches only the timers that expire or move closer to the
+ * present, not all pending ones.
+ *
+ * Literature:
+ *
+ * Varghese, George, and Tony Lauck. "Hashed and hierarchical timing
+ * wheels: data structures for the efficient implementation of a timer
+ * facility." ACM SIGOPS Operating Systems Review 21, no. 5 (1987): 25-38.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace openage {
+namespace datastructure {
+
+/**
+ * Timers are kept in levels of 64 slots. A slot of level 0 holds the timers
+ * of one time unit, a slot of level n the timers of 64^n units. When the
+ * time reaches the range of a slot of a higher level, its timers are moved
+ * to the lower levels. Timers beyond the range of all levels wait in an
+ * overflow list, which is checked when the highest level wraps around.
+ *
+ * The unit of time is chosen by the user, e.g. milliseconds.
+ * Timers can't be cancelled, the user has to ignore outdated ones.
+ *
+ * @param T the type of the value stored with each timer.
+ */
+template<typename T>
+class TimerWheel {
+public:
+	/** log2 of the number of slots in each level */
+	static constexpr unsigned int slot_bits = 6;
+	static constexpr size_t slot_count = size_t{1} << slot_bits;
+	static constexpr unsigned int level_count = 4;
+
+	explicit TimerWheel(uint64_t now=0)
+		:
+		now{now},
+		count{0},
+		level_sizes{},
+		buckets(level_count * slot_count) {}
+
+	/**
+	 * the time the wheel was advanced to.
+	 */
+	uint64_t time() const {
+		return this->now;
+	}
+
+	/**
+	 * the number of timers that didn't fire yet.
+	 */
+	size_t size() const {
+		return this->count;
+	}
+
+	bool empty() const {
+		return this->count == 0;
+	}
+
+	/**
+	 * adds a timer which fires once the wheel is advanced to the deadline.
+	 * a deadline that is not after the current time fires with the next advance.
+	 */
+	void schedule(uint64_t deadline, T value) {
+		this->insert(timer{deadline, std::move(value)});
+		this->count += 1;
+	}
+
+	/**
+	 * advances the time and calls func(uint64_t deadline, T &&value) for each
+	 * timer whose deadline is reached, timers of earlier time units first.
+	 * timers scheduled by func for the past fire with the next advance.
+	 *
+	 * @returns the number of timers that fired.
+	 */
+	template<typename F>
+	size_t advance(uint64_t to, F &&func) {
+		size_t fired = this->fire(this->due, func);
+
+		while (this->now < to) {
+			if (this->count == 0) {
+				this->now = to;
+				break;
+			}
+
+			// skip to the next range of the lowest level with timers
+			uint64_t next = this->now + 1;
+			for (unsigned int level = 0; level < level_count; level++) {
+				if (this->level_sizes[level] != 0) {
+					break;
+				}
+				unsigned int shift = slot_bits * (level + 1);
+				next = ((this->now >> shift) + 1) << shift;
+			}
+			if (next > to) {
+				this->now = to;
+				break;
+			}
+			this->now = next;
+
+			// move the timers of the next slot of each higher level down,
+			// when the time enters its range
+			for (unsigned int level = 1; level < level_count; level++) {
+				if ((this->now & ((uint64_t{1} << (slot_bits * level)) - 1)) != 0) {
+					break;
+				}
+				this->cascade(this->slot(level, this->now), level);
+
+				if (level == level_count - 1) {
+					this->cascade(this->overflow, level_count);
+				}
+			}
+
+			std::vector<timer> &current = this->slot(0, this->now);
+			this->level_sizes[0] -= current.size();
+			fired += this->fire(current, func);
+		}
+
+		return fired;
+	}
+
+	/**
+	 * removes all timers without firing them.
+	 */
+	void clear() {
+		for (auto &slot : this->buckets) {
+			slot.clear();
+		}
+		this->due.clear();
+		this->overflow.clear();
+		this->count = 0;
+		this->level_sizes.fill(0);
+	}
+
+private:
+	struct timer {
+		uint64_t deadline;
+		T value;
+	};
+
+	/**
+	 * the slot of the level whose range contains the time.
+	 */
+	std::vector<timer> &slot(unsigned int level, uint64_t time) {
+		size_t index = (time >> (slot_bits * level)) & (slot_count - 1);
+		return this->buckets[level * slot_count + index];
+	}
+
+	/**
+	 * puts the timer into the lowest level whose range reaches its deadline.
+	 */
+	void insert(timer &&entry) {
+		if (entry.deadline <= this->now) {
+			this->due.push_back(std::move(entry));
+			return;
+		}
+
+		uint64_t delta = entry.deadline - this->now;
+		for (unsigned int level = 0; level < level_count; level++) {
+			if (delta < (uint64_t{1} << (slot_bits * (level + 1)))) {
+				this->slot(level, entry.deadline).push_back(std::move(entry));
+				this->level_sizes[level] += 1;
+				return;
+			}
+		}
+		this->overflow.push_back(std::move(entry));
+		this->level_sizes[level_count] += 1;
+	}
+
+	/**
+	 * inserts the timers of a list of the level again,
+	 * relative to the current time.
+	 */
+	void cascade(std::vector<timer> &list, unsigned int level) {
+		if (list.empty()) {
+			return;
+		}
+
+		this->level_sizes[level] -= list.size();
+		std::swap(list, this->moving);
+		for (auto &entry : this->moving) {
+			if (entry.deadline == this->now) {
+				// the slot of the current time fires next
+				this->slot(0, this->now).push_back(std::move(entry));
+				this->level_sizes[0] += 1;
+			}
+			else {
+				this->insert(std::move(entry));
+			}
+		}
+		this->moving.clear();
+	}
+
+	/**
+	 * fires the timers of the list, which may be refilled by func.
+	 */
+	template<typename F>
+	size_t fire(std::vector<timer> &list, F &func) {
+		if (list.empty()) {
+			return 0;
+		}
+
+		std::vector<timer> firing;
+		std::swap(list, firing);
+		size_t fired = firing.size();
+		this->count -= fired;
+		for (auto &entry : firing) {
+			func(entry.deadline, std::move(entry.value));
+		}
+
+		// keep the capacity of the list
+		if (list.empty()) {
+			firing.clear();
+			std::swap(list, firing);
+		}
+		return fired;
+	}
+
+	uint64_t now;
+	size_t count;
+
+	/**
+	 * the number of timers in the slots of each level, and in the overflow list
+	 */
+	std::array<size_t, level_count + 1> level_sizes;
+
+	/**
+	 * the slots of all levels, level after level
+	 */
+	std::vector<std::vector<timer>> buckets;
+
+	/**
+	 * timers whose deadline is not after the current time
+	 */
+	std::vector<timer> due;
+
+	/**
+	 * timers beyond the range of the highest level
+	 */
+	std::vector<timer> overflow;
+
+	/**
+	 * buffer for the timers moved by a cascade
+	 */
+	std::vector<timer> moving;
+};
+
+}} // openage::datastructure
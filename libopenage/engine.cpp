@@ -1,10 +1,15 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "engine.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <fstream>
+#include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
 #include <time.h>
 #include <epoxy/gl.h>
 #include <SDL2/SDL.h>
@@ -12,19 +17,32 @@
 
 #include "error/error.h"
 #include "error/gl_debug.h"
+#include "log/binary_logsink.h"
+#include "log/file_logsink.h"
 #include "log/log.h"
 #include "config.h"
 #include "gui_basic.h"
+#include "render_command_list.h"
 #include "texture.h"
+#include "unit/action_cost.h"
 
 #include "gamestate/game_main.h"
 #include "gamestate/generator.h"
+#include "pyinterface/functional.h"
+#include "shader/program.h"
 
+#include "util/alloc_tracking.h"
 #include "util/color.h"
 #include "util/fps.h"
+#include "util/frame_arena.h"
+#include "util/metrics.h"
 #include "util/opengl.h"
+#include "util/string_id.h"
 #include "util/strings.h"
+#include "util/thread_id.h"
 #include "util/timer.h"
+#include "util/timing.h"
+#include "util/trace.h"
 
 #include "renderer/text.h"
 #include "renderer/font/font.h"
@@ -46,21 +64,97 @@ namespace openage {
 coord_data coord_global_tmp_TODO;
 
 
+namespace {
+
+/**
+ * the stages of a frame, as measured by the profiler.
+ * their ids are computed at compile time.
+ */
+constexpr util::StringId stage_callbacks{"callbacks"};
+constexpr util::StringId stage_events{"events"};
+constexpr util::StringId stage_gui{"gui"};
+constexpr util::StringId stage_tick{"tick"};
+constexpr util::StringId stage_hud{"hud"};
+constexpr util::StringId stage_gl{"gl"};
+constexpr util::StringId stage_swap{"swap"};
+constexpr util::StringId stage_idle{"idle"};
+constexpr util::StringId gpu_gui{"gui gpu"};
+constexpr util::StringId gpu_text{"text gpu"};
+
+/**
+ * values shown by the profiler
+ */
+constexpr util::StringId counter_callback_backlog{"callback backlog"};
+constexpr util::StringId counter_merged_motions{"merged motions"};
+constexpr util::StringId counter_predicted_cost{"predicted frame us"};
+
+/**
+ * heap allocations per frame, in the order of util::alloc_tag
+ */
+constexpr util::StringId counter_allocations[util::alloc_tag_count] = {
+	"allocs other",
+	"allocs simulation",
+	"allocs rendering",
+	"allocs assets",
+	"allocs logging",
+	"allocs gui",
+};
+
+/**
+ * workers of the io and background pools.
+ */
+constexpr int io_workers = 2;
+constexpr int background_workers = 1;
+
+/**
+ * settings of a worker pool, whose cpus are read from
+ * the environment variable env if it is set.
+ */
+job::pool_options pool_options(const char *name, const char *env,
+                               util::alloc_tag allocation_tag=util::alloc_tag::other) {
+	job::pool_options options;
+	options.name = name;
+	options.allocation_tag = allocation_tag;
+
+	const char *cpus = getenv(env);
+	if (cpus != nullptr) {
+		options.cpus = util::parse_cpu_list(cpus);
+	}
+	return options;
+}
+
+} // anonymous namespace
+
+
 Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char *windowtitle)
 	:
 	OptionNode{"Engine"},
 	running{false},
 	drawing_debug_overlay{this, "drawing_debug_overlay", true},
 	drawing_huds{this, "drawing_huds", true},
+	threaded_rendering{this, "threaded_rendering", false},
+	frame_pacing{this, "frame_pacing", false},
+	job_callback_budget{this, "job_callback_budget", 4},
+	metrics_interval{this, "metrics_interval", 0},
+	metrics_filename{this, "metrics_filename", ""},
 	data_dir{data_dir},
-	job_manager{SDL_GetCPUCount()},
+	vsync{true},
+	has_pending_motion{false},
+	merged_motions{0},
+	job_manager{SDL_GetCPUCount(), pool_options("sim worker", "OPENAGE_CPUS_SIMULATION", util::alloc_tag::simulation)},
+	io_job_manager{io_workers, pool_options("io worker", "OPENAGE_CPUS_IO", util::alloc_tag::assets)},
+	background_job_manager{background_workers, pool_options("bg worker", "OPENAGE_CPUS_BACKGROUND")},
 	singletons_info{this, data_dir->basedir},
+	screenshot_manager{&this->background_job_manager},
 	cvar_manager{},
 	action_manager{&this->input_manager, &this->cvar_manager},
-	audio_manager{&this->job_manager},
+	audio_manager{&this->io_job_manager},
 	input_manager{&this->action_manager},
 	profiler{this},
 	coord{coord_global_tmp_TODO},
+	start_time{timing::get_monotonic_time()},
+	since_metrics_written{0},
+	last_allocations{},
 	gui_link{} {
 
 	using namespace std::string_literals;
@@ -72,97 +166,106 @@ Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char
 		this->ns_per_frame = 0;
 	}
 
-	this->font_manager = std::make_unique<renderer::FontManager>();
-	for (uint32_t size : {12, 20}) {
-		fonts[size] = this->font_manager->get_font("DejaVu Serif", "Book", size);
+	{
+		TRACE_SCOPE("font setup");
+
+		// the fonts found by fontconfig are remembered between runs
+		renderer::FontManager::set_resolution_cache_file(this->data_dir->join("font_cache"));
+		this->font_manager = std::make_unique<renderer::FontManager>();
+		for (uint32_t size : {12, 20}) {
+			fonts[size] = this->font_manager->get_font("DejaVu Serif", "Book", size);
+		}
 	}
 
 	// temporary log to the filesystem.
-	// some housekeeping should be implemented as this file is only ever appended to
-	this->logsink_file = std::make_unique<log::FileSink>("/tmp/openage-log", true);
+	// some housekeeping should be implemented as this file is only ever appended to.
+	// a compact binary log can be requested, read it with `openage decode-log`.
+	const char *binary_log = getenv("OPENAGE_BINARY_LOG");
+	if (binary_log != nullptr and binary_log[0] != '\0') {
+		this->logsink_file = std::make_unique<log::BinaryFileSink>(binary_log, true);
+	} else {
+		this->logsink_file = std::make_unique<log::FileSink>("/tmp/openage-log", true);
+	}
 
 	// enqueue the engine's own input handler to the
 	// execution list.
 	this->register_resize_action(this);
 
-	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-		throw Error(MSG(err) << "SDL video initialization: " << SDL_GetError());
-	} else {
-		log::log(MSG(info) << "Initialized SDL video subsystems.");
-	}
-
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
-	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-
-	int32_t window_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED;
-	this->window = SDL_CreateWindow(
-		windowtitle,
-		SDL_WINDOWPOS_CENTERED,
-		SDL_WINDOWPOS_CENTERED,
-		this->coord.window_size.x,
-		this->coord.window_size.y,
-		window_flags
-	);
-
-	if (this->window == nullptr) {
-		throw Error(MSG(err) << "Failed to create SDL window: " << SDL_GetError());
-	}
+	{
+		TRACE_SCOPE("sdl and gl init");
 
-	// load support for the PNG image formats, jpg bit: IMG_INIT_JPG
-	int wanted_image_formats = IMG_INIT_PNG;
-	int sdlimg_inited = IMG_Init(wanted_image_formats);
-	if ((sdlimg_inited & wanted_image_formats) != wanted_image_formats) {
-		throw Error(MSG(err) << "Failed to init PNG support: " << IMG_GetError());
-	}
+		if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+			throw Error(MSG(err) << "SDL video initialization: " << SDL_GetError());
+		} else {
+			log::log(MSG(info) << "Initialized SDL video subsystems.");
+		}
 
-	if (gl_debug)
-		this->glcontext = error::create_debug_context(this->window);
-	else
-		this->glcontext = SDL_GL_CreateContext(this->window);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+		SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+
+		int32_t window_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED;
+		this->window = SDL_CreateWindow(
+			windowtitle,
+			SDL_WINDOWPOS_CENTERED,
+			SDL_WINDOWPOS_CENTERED,
+			this->coord.window_size.x,
+			this->coord.window_size.y,
+			window_flags
+		);
+
+		if (this->window == nullptr) {
+			throw Error(MSG(err) << "Failed to create SDL window: " << SDL_GetError());
+		}
 
-	if (this->glcontext == nullptr) {
-		throw Error(MSG(err) << "Failed creating OpenGL context: " << SDL_GetError());
-	}
+		// load support for the PNG image formats, jpg bit: IMG_INIT_JPG
+		int wanted_image_formats = IMG_INIT_PNG;
+		int sdlimg_inited = IMG_Init(wanted_image_formats);
+		if ((sdlimg_inited & wanted_image_formats) != wanted_image_formats) {
+			throw Error(MSG(err) << "Failed to init PNG support: " << IMG_GetError());
+		}
 
-	// check the OpenGL version, for shaders n stuff
-	if (!epoxy_is_desktop_gl() || epoxy_gl_version() < 21) {
-		throw Error(MSG(err) << "OpenGL 2.1 not available");
-	}
+		if (gl_debug)
+			this->glcontext = error::create_debug_context(this->window);
+		else
+			this->glcontext = SDL_GL_CreateContext(this->window);
 
-	// to quote the standard doc:
-	// 'The value gives a rough estimate
-	// of the largest texture that the GL can handle'
-	// -> wat?
-	// anyways, we need at least 1024x1024.
-	int max_texture_size;
-	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
-	log::log(MSG(dbg) << "Maximum supported texture size: " << max_texture_size);
-	if (max_texture_size < 1024) {
-		throw Error(MSG(err) << "Maximum supported texture size too small: " << max_texture_size);
-	}
+		if (this->glcontext == nullptr) {
+			throw Error(MSG(err) << "Failed creating OpenGL context: " << SDL_GetError());
+		}
 
-	int max_texture_units;
-	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_texture_units);
-	log::log(MSG(dbg) << "Maximum supported texture units: " << max_texture_units);
-	if (max_texture_units < 2) {
-		throw Error(MSG(err) << "Your GPU has not enough texture units: " << max_texture_units);
-	}
+		// check the OpenGL version, for shaders n stuff
+		if (!epoxy_is_desktop_gl() || epoxy_gl_version() < 21) {
+			throw Error(MSG(err) << "OpenGL 2.1 not available");
+		}
 
-	// vsync on
-	SDL_GL_SetSwapInterval(1);
+		// to quote the standard doc:
+		// 'The value gives a rough estimate
+		// of the largest texture that the GL can handle'
+		// -> wat?
+		// anyways, we need at least 1024x1024.
+		int max_texture_size;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+		log::log(MSG(dbg) << "Maximum supported texture size: " << max_texture_size);
+		if (max_texture_size < 1024) {
+			throw Error(MSG(err) << "Maximum supported texture size too small: " << max_texture_size);
+		}
 
-	// enable alpha blending
-	glEnable(GL_BLEND);
+		int max_texture_units;
+		glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_texture_units);
+		log::log(MSG(dbg) << "Maximum supported texture units: " << max_texture_units);
+		if (max_texture_units < 2) {
+			throw Error(MSG(err) << "Your GPU has not enough texture units: " << max_texture_units);
+		}
 
-	// order of drawing relevant for depth
-	// what gets drawn last is displayed on top.
-	glDisable(GL_DEPTH_TEST);
+		this->setup_gl_state();
+	}
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// linked shader programs are kept to skip compiling on the next start
+	shader::Program::set_binary_cache_dir(this->data_dir->join("shader_cache"));
 
 	//// -- initialize the gui
 	// qml sources will be installed to the asset dir
@@ -172,12 +275,15 @@ Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char
 		"libopenage/gui"s
 	};
 
-	this->gui = std::make_unique<gui::GuiBasic>(
-		this->window,
-		"qml/main.qml",
-		&this->singletons_info,
-		qml_search_paths
-	);
+	{
+		TRACE_SCOPE("qt and qml load");
+		this->gui = std::make_unique<gui::GuiBasic>(
+			this->window,
+			"qml/main.qml",
+			&this->singletons_info,
+			qml_search_paths
+		);
+	}
 
 	this->register_resize_action(this->gui.get());
 	this->register_input_action(this->gui.get());
@@ -188,6 +294,7 @@ Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char
 	this->register_input_action(&this->input_manager);
 
 	// initialize audio
+	TRACE_SCOPE("audio devices");
 	auto devices = audio::AudioManager::get_devices();
 	if (devices.empty()) {
 		throw Error{MSG(err) << "No audio devices found"};
@@ -206,6 +313,9 @@ Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char
 	global_input_context.bind(action.get("SCREENSHOT"), [this](const input::action_arg_t &) {
 		this->get_screenshot_manager().save_screenshot();
 	});
+	global_input_context.bind(action.get("TOGGLE_RECORDING"), [this](const input::action_arg_t &) {
+		this->get_screenshot_manager().toggle_recording();
+	});
 	global_input_context.bind(action.get("TOGGLE_DEBUG_OVERLAY"), [this](const input::action_arg_t &) {
 		this->drawing_debug_overlay.value = !this->drawing_debug_overlay.value;
 	});
@@ -217,6 +327,17 @@ Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char
 			this->external_profiler.start();
 		}
 	});
+	global_input_context.bind(action.get("TOGGLE_TRACE"), [](const input::action_arg_t &) {
+		if (util::tracing_active) {
+			util::trace_stop();
+			const char *filename = "/tmp/openage-trace.json";
+			util::write_trace(filename);
+			log::log(MSG(info) << "Wrote the trace to " << filename);
+		} else {
+			util::trace_start();
+			log::log(MSG(info) << "Started tracing");
+		}
+	});
 	global_input_context.bind(input::event_class::MOUSE, [this](const input::action_arg_t &arg) {
 		if (arg.e.cc.has_class(input::event_class::MOUSE_MOTION) &&
 			this->get_input_manager().is_down(input::event_class::MOUSE_BUTTON, 2)) {
@@ -226,14 +347,23 @@ Engine::Engine(util::Dir *data_dir, int32_t fps_limit, bool gl_debug, const char
 		return false;
 	});
 
-	this->text_renderer = std::make_unique<renderer::TextRenderer>();
+	// the hud texts share the distance fields of their glyphs over all sizes
+	this->text_renderer = std::make_unique<renderer::TextRenderer>(this->font_manager.get());
 	this->unit_selection = std::make_unique<UnitSelection>(this);
 }
 
 
 Engine::~Engine() {
+	// draws the last submitted frame
+	this->render_thread = nullptr;
+
 	this->profiler.unregister_all();
 
+	for (auto &timing : pyinterface::func_timings()) {
+		log::log(MSG(dbg) << "python calls to " << timing.name << ": " << timing.calls
+		         << ", " << timing.nsec / 1000000 << " ms");
+	}
+
 	log::log(MSG(info) << "freeing GUI...");
 
 	// deallocate the gui system
@@ -267,25 +397,75 @@ bool Engine::on_resize(coord::window new_size) {
 	// update camhud window position
 	this->coord.camhud_window = {0, (coord::pixel_t) this->coord.window_size.y};
 
+	// the context drawing the frame is updated
+	RenderCommandList::submit([this, new_size] {
+		this->setup_gl_viewport(new_size);
+	});
+
+	return true;
+}
+
+void Engine::setup_gl_state() {
+	SDL_GL_SetSwapInterval(this->vsync ? 1 : 0);
+
+	// enable alpha blending
+	glEnable(GL_BLEND);
+
+	// order of drawing relevant for depth
+	// what gets drawn last is displayed on top.
+	glDisable(GL_DEPTH_TEST);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void Engine::setup_gl_viewport(coord::window size) {
 	// reset previous projection matrix
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 
 	// update OpenGL viewport: the renderin area
-	glViewport(0, 0, this->coord.window_size.x, this->coord.window_size.y);
+	glViewport(0, 0, size.x, size.y);
 
 	// set orthographic projection: left, right, bottom, top, near_val, far_val
-	glOrtho(0, this->coord.window_size.x, 0, this->coord.window_size.y, 9001, -1);
+	glOrtho(0, size.x, 0, size.y, 9001, -1);
 
 	// reset the modelview matrix
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
+}
 
-	return true;
+void Engine::update_render_thread() {
+	if (this->threaded_rendering.value == (this->render_thread != nullptr)) {
+		return;
+	}
+
+	if (this->threaded_rendering.value) {
+		coord::window size = this->coord.window_size;
+		this->render_thread = std::make_unique<RenderThread>(this->window, [this, size] {
+			this->setup_gl_state();
+			this->setup_gl_viewport(size);
+		});
+		log::log(MSG(info) << "Started the render thread.");
+	}
+	else {
+		this->render_thread = nullptr;
+
+		// the window may have been resized meanwhile
+		this->setup_gl_viewport(this->coord.window_size);
+		log::log(MSG(info) << "Stopped the render thread.");
+	}
+}
+
+void Engine::finish_rendering() {
+	if (this->render_thread) {
+		this->render_thread->finish();
+	}
 }
 
 bool Engine::draw_debug_overlay() {
-	util::col {255, 255, 255, 255}.use();
+	RenderCommandList::submit([] {
+		util::col {255, 255, 255, 255}.use();
+	});
 
 	// Draw FPS counter in the lower right corner
 	this->render_text(
@@ -303,6 +483,14 @@ bool Engine::draw_debug_overlay() {
 		"%s", config::config_option_string
 	);
 
+	// gui callbacks run by the game logic in this frame
+	qtsdl::GuiEventQueueStats gui_stats = this->gui->get_game_logic_stats();
+	this->render_text(
+		{this->coord.window_size.x - 220, 35}, 12,
+		"gui events: %zu delivered, %zu coalesced",
+		gui_stats.delivered, gui_stats.coalesced
+	);
+
 	this->profiler.show(true);
 
 	return true;
@@ -310,62 +498,111 @@ bool Engine::draw_debug_overlay() {
 
 void Engine::run() {
 	this->job_manager.start();
+	this->io_job_manager.start();
+	this->background_job_manager.start();
 	this->running = true;
 	this->loop();
 	this->running = false;
+
+	// the frame's objects may be destroyed after returning
+	this->finish_rendering();
+
+	// saves the screenshots whose readback is in flight
+	this->screenshot_manager.finish();
 }
 
 void Engine::stop() {
 	this->job_manager.stop();
+	this->io_job_manager.stop();
+	this->background_job_manager.stop();
 	this->running = false;
 }
 
 void Engine::loop() {
-	SDL_Event event;
 	util::Timer cap_timer;
+	util::set_trace_thread_name("main");
+
+	// the end of the last frame's work, when pacing the frames
+	time_nsec_t last_frame_done = timing::get_monotonic_time();
+	bool pacing = false;
+
+	// the first frame is shown once it was swapped. the render thread
+	// swaps it later, its submit of the second frame waits for that.
+	size_t frames_submitted = 0;
+	bool first_frame_shown = false;
 
 	while (this->running) {
+		util::trace_frame();
+		util::next_arena_frame();
 		this->profiler.start_frame_measure();
 		this->fps_counter.frame();
-		cap_timer.reset(false);
 
-		this->job_manager.execute_callbacks();
-
-		this->profiler.start_measure("events", {1.0, 0.0, 0.0});
-		// top level input handling
-		while (SDL_PollEvent(&event)) {
-			switch (event.type) {
+		time_nsec_t interval = this->get_frame_interval();
+		bool was_pacing = pacing;
+		pacing = this->frame_pacing.value and interval != 0;
+		if (pacing != was_pacing) {
+			this->frame_pacer.reset();
+		}
 
-			case SDL_QUIT:
-				this->stop();
-				break;
+		// sleep before the input is read, so it is read as late as
+		// the predicted cost of the frame allows
+		if (pacing) {
+			this->profiler.start_measure(stage_idle, {0.5, 0.5, 0.5});
+			time_nsec_t since_done = timing::get_monotonic_time() - last_frame_done;
+			time_nsec_t wait = this->frame_pacer.get_wait_time(since_done, interval);
+			if (wait > 0) {
+				std::this_thread::sleep_for(std::chrono::nanoseconds{wait});
+			}
+			this->profiler.end_measure(stage_idle);
+			this->profiler.set_counter(counter_predicted_cost, this->frame_pacer.get_predicted_cost() / 1000);
+		}
 
-			case SDL_WINDOWEVENT: {
-				if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-					coord::window new_size{event.window.data1, event.window.data2};
+		time_nsec_t frame_start = timing::get_monotonic_time();
+		cap_timer.reset(false);
 
-					// call additional handlers for the resize event
-					for (auto &handler : on_resize_handler) {
-						if (!handler->on_resize(new_size)) {
-							break;
-						}
-					}
-				}
-			}
+		// record the gl commands issued during this frame,
+		// beginning with the ones of the job callbacks and events.
+		this->update_render_thread();
+		RenderCommandList *commands;
+		if (this->render_thread) {
+			commands = this->render_thread->get_list();
+		}
+		else {
+			commands = &this->frame_commands;
+		}
+		commands->begin();
 
-			default:
-				for (auto &action : this->on_input_event) {
-					if (false == action->on_input(&event)) {
-						break;
-					}
-				}
-			} // switch event
+		this->profiler.start_measure(stage_callbacks, {0.0, 1.0, 1.0});
+		if (this->job_callback_budget.value > 0) {
+			size_t backlog = this->job_manager.execute_callbacks(
+				std::chrono::milliseconds{this->job_callback_budget.value});
+			this->profiler.set_counter(counter_callback_backlog, backlog);
+		}
+		else {
+			this->job_manager.execute_callbacks();
 		}
+		// few and short, like a finished load
+		this->io_job_manager.execute_callbacks();
+		this->background_job_manager.execute_callbacks();
+		this->profiler.end_measure(stage_callbacks);
+
+		this->profiler.start_measure(stage_events, {1.0, 0.0, 0.0});
+		// top level input handling
+		this->merged_motions = 0;
+		this->process_events();
+		this->profiler.end_measure(stage_events);
 
 		// here, call to Qt and process all the gui events.
+		this->profiler.start_measure(stage_gui, {1.0, 0.5, 0.0});
+		util::set_thread_alloc_tag(util::alloc_tag::gui);
 		this->gui->process_events();
+		this->profiler.end_measure(stage_gui);
 
+		this->profiler.start_measure(stage_tick, {1.0, 1.0, 0.0});
+		util::set_thread_alloc_tag(util::alloc_tag::simulation);
 		if (this->game) {
+			TRACE_SCOPE("game update");
+
 			// read camera movement input keys, and move camera
 			// accordingly.
 
@@ -394,9 +631,9 @@ void Engine::loop() {
 				static_cast<float>(this->lastframe_duration_nsec()) / 1e6);
 
 			// update the currently running game
+			this->game->set_view_focus(this->coord.camgame_phys);
 			this->game->update(this->lastframe_duration_nsec());
 		}
-		this->profiler.end_measure("events");
 
 		// call engine tick callback methods
 		for (auto &action : this->on_engine_tick) {
@@ -404,75 +641,271 @@ void Engine::loop() {
 				break;
 			}
 		}
+		this->profiler.end_measure(stage_tick);
 
-		this->profiler.start_measure("rendering", {0.0, 1.0, 0.0});
+		// the simulation time of each action type since measuring started
+		if (action_costs_active) {
+			for (auto &cost : action_costs()) {
+				this->profiler.set_counter(util::StringId::intern(cost.name + " us"),
+				                           cost.duration / 1000);
+			}
+		}
+
+		this->write_metrics();
+
+		// the cursor and the camera dragged by it are
+		// drawn where they are right now
+		if (pacing) {
+			this->latch_motion_events();
+		}
+		this->profiler.set_counter(counter_merged_motions, this->merged_motions);
+
+		util::set_thread_alloc_tag(util::alloc_tag::rendering);
 
 		// clear the framebuffer to black
 		// in the future, we might disable it for lazy drawing
-		glClearColor(0.0, 0.0, 0.0, 0.0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		coord::window camgame_window = coord.camgame_window;
+		RenderCommandList::submit([camgame_window] {
+			glClearColor(0.0, 0.0, 0.0, 0.0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-		glPushMatrix(); {
 			// set the framebuffer up for camgame rendering
-			glTranslatef(coord.camgame_window.x, coord.camgame_window.y, 0);
+			glPushMatrix();
+			glTranslatef(camgame_window.x, camgame_window.y, 0);
+		});
 
-			// invoke all game drawing handlers
-			for (auto &action : this->on_drawgame) {
-				if (false == action->on_draw()) {
-					break;
-				}
+		// invoke all game drawing handlers
+		for (auto &action : this->on_drawgame) {
+			if (false == action->on_draw()) {
+				break;
 			}
 		}
-		glPopMatrix();
 
-		util::gl_check_error();
+		RenderCommandList::submit([] {
+			glPopMatrix();
+
+			util::gl_check_error();
 
-		glPushMatrix(); {
 			// the hud coordinate system is automatically established
+			glPushMatrix();
+		});
 
-			// draw the fps overlay
+		this->profiler.start_measure(stage_hud, {1.0, 0.0, 1.0});
 
-			if (this->drawing_debug_overlay.value) {
-				this->draw_debug_overlay();
+		// draw the fps overlay
+		if (this->drawing_debug_overlay.value) {
+			this->draw_debug_overlay();
+		}
 
-			}
+		if (this->drawing_huds.value) {
+			// invoke all hud drawing callback methods
+			for (auto &action : this->on_drawhud) {
+				// the gui blends its texture onto the frame
+				bool is_gui = (action == this->gui.get());
+				if (is_gui) {
+					this->profiler.start_gpu_measure(gpu_gui, {0.5, 0.25, 0.0});
+				}
+
+				bool next = action->on_drawhud();
 
-			if (this->drawing_huds.value) {
-				// invoke all hud drawing callback methods
-				for (auto &action : this->on_drawhud) {
-					if (false == action->on_drawhud()) {
-						break;
-					}
+				if (is_gui) {
+					this->profiler.end_gpu_measure(gpu_gui);
+				}
+				if (false == next) {
+					break;
 				}
 			}
-
-			this->text_renderer->render();
 		}
-		glPopMatrix();
 
-		util::gl_check_error();
+		this->profiler.start_gpu_measure(gpu_text, {0.5, 0.5, 0.5});
+		this->text_renderer->render();
+		this->profiler.end_gpu_measure(gpu_text);
+
+		RenderCommandList::submit([] {
+			glPopMatrix();
 
-		this->profiler.end_measure("rendering");
+			util::gl_check_error();
+		});
 
-		this->profiler.start_measure("idle", {0.0, 0.0, 1.0});
+		// reads the finished frame, after everything was drawn
+		this->screenshot_manager.frame_done();
 
-		// the rendering is done
-		// swap the drawing buffers to actually show the frame
-		SDL_GL_SwapWindow(window);
+		commands->end();
+		this->profiler.end_measure(stage_hud);
 
-		if (this->ns_per_frame != 0) {
+		// without render thread, the frame is drawn right away
+		if (not this->render_thread) {
+			this->profiler.start_measure(stage_gl, {0.5, 0.5, 1.0});
+			commands->execute();
+			this->profiler.end_measure(stage_gl);
+		}
+
+		time_nsec_t swap_start = timing::get_monotonic_time();
+		this->profiler.start_measure(stage_swap, {0.0, 0.0, 1.0});
+		if (this->render_thread) {
+			// swapped by the render thread once the frame is drawn,
+			// waits until the previous one is shown.
+			this->render_thread->submit();
+		}
+		else {
+			// the rendering is done
+			// swap the drawing buffers to actually show the frame
+			SDL_GL_SwapWindow(window);
+		}
+		this->profiler.end_measure(stage_swap);
+
+		if (not first_frame_shown) {
+			frames_submitted++;
+			if (frames_submitted >= (this->render_thread ? 2 : 1)) {
+				first_frame_shown = true;
+				this->finish_startup_trace();
+			}
+		}
+
+		if (pacing) {
+			// the swap waits for the display, the frame's work is done before it
+			last_frame_done = timing::get_monotonic_time();
+			this->frame_pacer.add_frame_cost(swap_start - frame_start);
+		}
+		else if (this->ns_per_frame != 0) {
+			this->profiler.start_measure(stage_idle, {0.5, 0.5, 0.5});
 			uint64_t ns_for_current_frame = cap_timer.getval();
 			if (ns_for_current_frame < this->ns_per_frame) {
 				SDL_Delay((this->ns_per_frame - ns_for_current_frame) / 1e6);
 			}
+			this->profiler.end_measure(stage_idle);
 		}
 
-		this->profiler.end_measure("idle");
+		util::set_thread_alloc_tag(util::alloc_tag::other);
+		if (util::alloc_tracking_enabled) {
+			this->count_allocations();
+		}
 
 		this->profiler.end_frame_measure();
 	}
 }
 
+void Engine::process_events() {
+	SDL_Event event;
+	while (SDL_PollEvent(&event)) {
+		this->queue_event(event);
+	}
+	this->flush_motion_event();
+}
+
+void Engine::latch_motion_events() {
+	// the other events stay queued for the next frame, the motions
+	// are only taken when they would not overtake any of them
+	SDL_PumpEvents();
+	int pending = SDL_PeepEvents(nullptr, 0, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+	if (pending <= 0) {
+		return;
+	}
+
+	std::array<SDL_Event, 64> events;
+	int motions = SDL_PeepEvents(events.data(), static_cast<int>(events.size()), SDL_PEEKEVENT,
+	                             SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+	if (motions != pending) {
+		return;
+	}
+
+	motions = SDL_PeepEvents(events.data(), static_cast<int>(events.size()), SDL_GETEVENT,
+	                         SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+	for (int i = 0; i < motions; i++) {
+		this->queue_event(events[i]);
+	}
+	this->flush_motion_event();
+}
+
+void Engine::queue_event(const SDL_Event &event) {
+	if (event.type == SDL_MOUSEMOTION) {
+		// only the last position is of interest, the relative
+		// motions are summed up for the relative mouse mode
+		if (this->has_pending_motion) {
+			SDL_MouseMotionEvent &pending = this->pending_motion.motion;
+			const SDL_MouseMotionEvent &next = event.motion;
+
+			if (pending.windowID == next.windowID and
+			    pending.which == next.which and
+			    pending.state == next.state) {
+
+				pending.timestamp = next.timestamp;
+				pending.x = next.x;
+				pending.y = next.y;
+				pending.xrel += next.xrel;
+				pending.yrel += next.yrel;
+				this->merged_motions += 1;
+				return;
+			}
+
+			this->flush_motion_event();
+		}
+
+		this->pending_motion = event;
+		this->has_pending_motion = true;
+		return;
+	}
+
+	// the motion happened before this event
+	this->flush_motion_event();
+
+	SDL_Event copy = event;
+	this->handle_event(copy);
+}
+
+void Engine::flush_motion_event() {
+	if (this->has_pending_motion) {
+		this->has_pending_motion = false;
+		this->handle_event(this->pending_motion);
+	}
+}
+
+void Engine::handle_event(SDL_Event &event) {
+	TRACE_SCOPE("event");
+
+	switch (event.type) {
+
+	case SDL_QUIT:
+		this->stop();
+		break;
+
+	case SDL_WINDOWEVENT: {
+		if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
+			coord::window new_size{event.window.data1, event.window.data2};
+
+			// call additional handlers for the resize event
+			for (auto &handler : on_resize_handler) {
+				if (!handler->on_resize(new_size)) {
+					break;
+				}
+			}
+		}
+	}
+
+	default:
+		for (auto &action : this->on_input_event) {
+			if (false == action->on_input(&event)) {
+				break;
+			}
+		}
+	} // switch event
+}
+
+time_nsec_t Engine::get_frame_interval() const {
+	if (this->ns_per_frame != 0) {
+		return this->ns_per_frame;
+	}
+
+	if (this->vsync) {
+		SDL_DisplayMode mode;
+		if (SDL_GetWindowDisplayMode(this->window, &mode) == 0 and mode.refresh_rate > 0) {
+			return 1000000000ull / mode.refresh_rate;
+		}
+	}
+
+	return 0;
+}
+
 void Engine::register_input_action(InputHandler *handler) {
 	this->on_input_event.push_back(handler);
 }
@@ -501,8 +934,16 @@ GameMain *Engine::get_game() {
 	return this->game.get();
 }
 
-job::JobManager *Engine::get_job_manager() {
-	return &this->job_manager;
+job::JobManager *Engine::get_job_manager(job_pool pool) {
+	switch (pool) {
+	case job_pool::io:
+		return &this->io_job_manager;
+	case job_pool::background:
+		return &this->background_job_manager;
+	case job_pool::simulation:
+	default:
+		return &this->job_manager;
+	}
 }
 
 audio::AudioManager &Engine::get_audio_manager() {
@@ -529,6 +970,10 @@ UnitSelection *Engine::get_unit_selection() {
 	return this->unit_selection.get();
 }
 
+util::Profiler &Engine::get_profiler() {
+	return this->profiler;
+}
+
 void Engine::announce_global_binds() {
 	emit this->gui_signals.global_binds_changed(
 		this->get_input_manager().get_global_context().active_binds()
@@ -539,6 +984,75 @@ renderer::TextRenderer *Engine::get_text_renderer() {
 	return this->text_renderer.get();
 }
 
+void Engine::write_metrics() {
+	static util::MetricHistogram &frame_us = util::metrics().histogram("engine.frame_us");
+	frame_us.add(this->lastframe_duration_nsec() / 1000);
+
+	int interval = this->metrics_interval.value;
+	if (interval <= 0) {
+		this->since_metrics_written = 0;
+		return;
+	}
+
+	this->since_metrics_written += this->lastframe_duration_nsec();
+	if (this->since_metrics_written < static_cast<time_nsec_t>(interval) * 1000000000) {
+		return;
+	}
+	this->since_metrics_written = 0;
+
+	double time = (timing::get_monotonic_time() - this->start_time) / 1e9;
+	const std::string &filename = this->metrics_filename.value;
+	if (filename.empty()) {
+		util::metrics().write_json(std::cout, time);
+		return;
+	}
+
+	std::ofstream file{filename, std::ios::app};
+	if (not file) {
+		log::log(MSG(warn) << "could not open metrics file " << filename);
+		return;
+	}
+	util::metrics().write_json(file, time);
+}
+
+void Engine::finish_startup_trace() {
+	time_nsec_t startup = util::startup_trace_end();
+	if (startup == 0) {
+		return;
+	}
+
+	log::log(MSG(info).fmt("Time to first frame: %.1f ms", startup / 1e6));
+
+	// the phases on all threads, and the jobs they ran
+	std::vector<util::trace_zone_total> totals = util::trace_totals();
+	constexpr size_t shown_zones = 16;
+	for (size_t i = 0; i < std::min(totals.size(), shown_zones); i++) {
+		const util::trace_zone_total &zone = totals[i];
+		log::log(MSG(info).fmt("  %-24s %9.1f ms total %9.1f ms longest %6zu times",
+		                       zone.name, zone.total / 1e6, zone.longest / 1e6, zone.count));
+	}
+
+	const char *filename = getenv("OPENAGE_STARTUP_TRACE");
+	if (filename != nullptr and filename[0] != '\0') {
+		try {
+			util::write_trace(filename);
+			log::log(MSG(info) << "Wrote the startup trace to " << filename);
+		}
+		catch (Error &e) {
+			log::log(MSG(warn) << "The startup trace was not written: " << e);
+		}
+	}
+}
+
+
+void Engine::count_allocations() {
+	for (size_t i = 0; i < util::alloc_tag_count; i++) {
+		uint64_t allocations = util::get_alloc_stats(static_cast<util::alloc_tag>(i)).allocations;
+		this->profiler.set_counter(counter_allocations[i], allocations - this->last_allocations[i]);
+		this->last_allocations[i] = allocations;
+	}
+}
+
 time_nsec_t Engine::lastframe_duration_nsec() const {
 	return this->fps_counter.nsec_lastframe;
 }
@@ -577,20 +1091,39 @@ void Engine::move_phys_camera(float x, float y, float amount) {
 	this->coord.camgame_phys += cam_delta.to_phys3();
 }
 
+void Engine::set_vsync(bool enabled) {
+	this->vsync = enabled;
+
+	// for the context that shows the frames
+	RenderCommandList::submit([enabled] {
+		SDL_GL_SetSwapInterval(enabled ? 1 : 0);
+	});
+}
+
 void Engine::start_game(std::unique_ptr<GameMain> &&game) {
 	// TODO: maybe implement a proper 1-to-1 connection
 	ENSURE(game, "linking game to engine problem");
 
+	// the previous game may be drawn by a submitted frame
+	this->finish_rendering();
+
 	this->game = std::move(game);
 	this->game->set_parent(this);
+
+	// the sounds of the match are decoded before they are played
+	this->audio_manager.prefetch(audio::category_t::GAME);
 }
 
 void Engine::start_game(const Generator &generator) {
+	this->finish_rendering();
 	this->game = std::make_unique<GameMain>(generator);
 	this->game->set_parent(this);
+
+	this->audio_manager.prefetch(audio::category_t::GAME);
 }
 
 void Engine::end_game() {
+	this->finish_rendering();
 	this->game = nullptr;
 	this->unit_selection->clear();
 }
@@ -1,7 +1,8 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -13,7 +14,7 @@
 #include <QObject>
 
 #include "log/log.h"
-#include "log/file_logsink.h"
+#include "log/logsink.h"
 #include "audio/audio_manager.h"
 #include "coord/camgame.h"
 #include "coord/vec2f.h"
@@ -28,11 +29,15 @@
 // pxd: from libopenage.input.input_manager cimport InputManager
 #include "input/input_manager.h"
 #include "input/action.h"
+#include "util/alloc_tracking.h"
 #include "util/externalprofiler.h"
 #include "util/dir.h"
 #include "util/fps.h"
+#include "util/frame_pacer.h"
 #include "util/profiler.h"
 #include "unit/selection.h"
+#include "render_command_list.h"
+#include "render_thread.h"
 #include "screenshot.h"
 
 namespace openage {
@@ -77,6 +82,22 @@ struct coord_data {
 extern coord_data coord_global_tmp_TODO;
 
 
+/**
+ * The worker pools of the engine, so that long running jobs
+ * don't hold back the ones the game waits for.
+ */
+enum class job_pool {
+	/** jobs of the game simulation and the frame, one worker per cpu */
+	simulation,
+
+	/** loading of assets and sounds */
+	io,
+
+	/** jobs nobody waits for, like encoding screenshots */
+	background,
+};
+
+
 /**
  * Qt signals for the engine.
  */
@@ -175,6 +196,12 @@ public:
 	 */
 	void end_game();
 
+	/**
+	 * Wait until the submitted frame was drawn.
+	 * Call before destroying objects its render commands use.
+	 */
+	void finish_rendering();
+
 	/**
 	 * draw the current frames per second number on screen.
 	 * save the current framebuffer to a given png file.
@@ -224,9 +251,9 @@ public:
 	GameMain *get_game();
 
 	/**
-	 * return this engine's job manager.
+	 * return the job manager of one of this engine's worker pools.
 	 */
-	job::JobManager *get_job_manager();
+	job::JobManager *get_job_manager(job_pool pool=job_pool::simulation);
 
 	/**
 	 * return this engine's audio manager.
@@ -253,6 +280,11 @@ public:
 	 */
 	input::InputManager &get_input_manager();
 
+	/**
+	 * return this engine's profiler.
+	 */
+	util::Profiler &get_profiler();
+
 	/**
 	 * return this engine's unit selection.
 	 */
@@ -286,6 +318,11 @@ public:
 	 */
 	void move_phys_camera(float x, float y, float amount=1.0);
 
+	/**
+	 * wait for the display's refresh before showing a frame, on by default.
+	 */
+	void set_vsync(bool enabled);
+
 	/**
 	 * current engine state variable.
 	 * to be set to false to stop the engine loop.
@@ -302,6 +339,37 @@ public:
 	*/
 	options::Var<bool> drawing_huds;
 
+	/**
+	 * when true, the frames are drawn on a separate render thread
+	 * while the next one is simulated. applied at the next frame.
+	 */
+	options::Var<bool> threaded_rendering;
+
+	/**
+	 * when true, the main loop sleeps before it reads the input instead
+	 * of after drawing, so a frame finishes just at the end of its
+	 * interval, and the latest cursor motion is applied right before
+	 * drawing. needs an fps limit or vsync.
+	 */
+	options::Var<bool> frame_pacing;
+
+	/**
+	 * milliseconds per frame for the callbacks of finished jobs,
+	 * the remaining ones run in the next frames. 0 runs all of them.
+	 */
+	options::Var<int> job_callback_budget;
+
+	/**
+	 * seconds between writing the metrics, 0 disables it.
+	 */
+	options::Var<int> metrics_interval;
+
+	/**
+	 * file the metrics are appended to as one json line each,
+	 * stdout when empty. see util::Metrics.
+	 */
+	options::Var<std::string> metrics_filename;
+
 	/**
 	 * profiler used by the engine
 	 */
@@ -317,6 +385,76 @@ private:
 	 */
 	void loop();
 
+	/**
+	 * read all pending SDL events and hand them to the input handlers.
+	 * consecutive cursor motions are merged into one event.
+	 */
+	void process_events();
+
+	/**
+	 * handle the cursor motions which arrived since the events were
+	 * processed, if nothing else arrived. called right before drawing.
+	 */
+	void latch_motion_events();
+
+	/**
+	 * queue an event for the input handlers. a cursor motion is held
+	 * back until the next event shows it can't be merged with it.
+	 */
+	void queue_event(const SDL_Event &event);
+
+	/**
+	 * hand the held back cursor motion to the input handlers.
+	 */
+	void flush_motion_event();
+
+	/**
+	 * hand one event to the input handlers.
+	 */
+	void handle_event(SDL_Event &event);
+
+	/**
+	 * the time between two frames, from the fps limit or the
+	 * display's refresh rate with vsync. 0 if it's unlimited.
+	 */
+	time_nsec_t get_frame_interval() const;
+
+	/**
+	 * set up blending and depth testing of the current opengl context.
+	 */
+	void setup_gl_state();
+
+	/**
+	 * set the viewport and projection of the current opengl context
+	 * to the window size.
+	 */
+	void setup_gl_viewport(coord::window size);
+
+	/**
+	 * start or stop the render thread, as the threaded_rendering option says.
+	 * called between frames.
+	 */
+	void update_render_thread();
+
+	/**
+	 * record the frame time, and append the current metrics to the
+	 * metrics file when the metrics interval passed.
+	 */
+	void write_metrics();
+
+	/**
+	 * show the heap allocations of the frame in the profiler,
+	 * for each alloc tag. see util::AllocScope.
+	 */
+	void count_allocations();
+
+	/**
+	 * log where the startup went once the first frame is shown,
+	 * and write its trace to the file in OPENAGE_STARTUP_TRACE.
+	 * see util::startup_trace_begin.
+	 */
+	void finish_startup_trace();
+
 	/**
 	 * the current data directory for the engine.
 	 */
@@ -328,6 +466,27 @@ private:
 	 */
 	time_nsec_t ns_per_frame;
 
+	/**
+	 * whether the buffer swaps wait for the display's refresh.
+	 */
+	bool vsync;
+
+	/**
+	 * predicts the cost of the frames when frame_pacing is on.
+	 */
+	util::FramePacer frame_pacer;
+
+	/**
+	 * the cursor motion held back to be merged with the next ones.
+	 */
+	SDL_Event pending_motion;
+	bool has_pending_motion;
+
+	/**
+	 * the number of cursor motions merged into others this frame.
+	 */
+	size_t merged_motions;
+
 	/**
 	 * input event processor objects.
 	 * called for each captured sdl input event.
@@ -362,9 +521,14 @@ private:
 	std::unique_ptr<GameMain> game;
 
 	/**
-	 * the engine's job manager, for asynchronous background task queuing.
+	 * the engine's job managers, for asynchronous background task queuing.
+	 * the cpus of each pool can be set with the OPENAGE_CPUS_SIMULATION,
+	 * OPENAGE_CPUS_IO and OPENAGE_CPUS_BACKGROUND environment variables,
+	 * e.g. to "2-27".
 	 */
 	job::JobManager job_manager;
+	job::JobManager io_job_manager;
+	job::JobManager background_job_manager;
 
 	/**
 	 * This stores information to be accessible from the QML engine.
@@ -429,6 +593,17 @@ private:
 	 */
 	SDL_GLContext glcontext;
 
+	/**
+	 * the gl commands of the current frame,
+	 * executed on the engine thread when there's no render thread.
+	 */
+	RenderCommandList frame_commands;
+
+	/**
+	 * draws the frames when threaded rendering is enabled.
+	 */
+	std::unique_ptr<RenderThread> render_thread;
+
 	/**
 	 * the gui binding
 	 */
@@ -459,7 +634,23 @@ private:
 	/**
 	 * Logsink to store messages to the filesystem.
 	 */
-	std::unique_ptr<log::FileSink> logsink_file;
+	std::unique_ptr<log::LogSink> logsink_file;
+
+	/**
+	 * when the engine was created, the metrics are written with
+	 * the seconds since then.
+	 */
+	time_nsec_t start_time;
+
+	/**
+	 * time since the metrics were last written.
+	 */
+	time_nsec_t since_metrics_written;
+
+	/**
+	 * the allocations of each alloc tag until the last frame.
+	 */
+	std::array<uint64_t, util::alloc_tag_count> last_allocations;
 
 public:
 	/**
@@ -2,6 +2,10 @@
 
 #include "stackanalyzer.h"
 
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
 #include "../config.h"
 #include "../log/log.h"
 #include "../util/compiler.h"
@@ -137,6 +141,26 @@ void backtrace_pcinfo_error_callback(void *data, const char *msg, int errorno) {
 	}
 }
 
+
+// looks up the symbols of a program counter, maybe several for inlined calls.
+std::vector<backtrace_symbol> resolve_symbols(void *pc) {
+	info_cb_data_t info_cb_data;
+	info_cb_data.pc = reinterpret_cast<uintptr_t>(pc);
+
+	// note: a call to backtrace_pcinfo may, in semi-rare cases, push back
+	// multiple symbols to result. That's nothing to worry about, though.
+	// If you decide you don't like it, make pcinfo_callback return 1.
+	backtrace_pcinfo(
+		bt_state,
+		info_cb_data.pc,
+		backtrace_pcinfo_callback,
+		backtrace_pcinfo_error_callback,
+		reinterpret_cast<void *>(&info_cb_data)
+	);
+
+	return std::move(info_cb_data.symbols);
+}
+
 } // anonymous namespace
 
 
@@ -151,36 +175,6 @@ void StackAnalyzer::analyze() {
 }
 
 
-void StackAnalyzer::get_symbols(std::function<void (const backtrace_symbol *)> cb, bool reversed) const {
-	info_cb_data_t info_cb_data;
-
-	for(void *pc : this->stack_addrs) {
-		info_cb_data.pc = reinterpret_cast<uintptr_t>(pc);
-
-		// note: a call to backtrace_pcinfo may, in semi-rare cases, push back
-		// multiple symbols to result. That's nothing to worry about, though.
-		// If you decide you don't like it, make pcinfo_callback return 1.
-		backtrace_pcinfo(
-			bt_state,
-			info_cb_data.pc,
-			backtrace_pcinfo_callback,
-			backtrace_pcinfo_error_callback,
-			reinterpret_cast<void *>(&info_cb_data)
-		);
-	}
-
-	if (reversed) {
-		// this entire vector thing would only be needed for reversed=true...
-		for (size_t idx = info_cb_data.symbols.size(); idx-- > 0;) {
-			cb(&info_cb_data.symbols[idx]);
-		}
-	} else {
-		for (backtrace_symbol &symbol : info_cb_data.symbols) {
-			cb(&symbol);
-		}
-	}
-}
-
 }} // openage::error
 
 #else // WITHOUT_BACKTRACE
@@ -192,6 +186,22 @@ namespace openage {
 namespace error {
 
 
+namespace {
+
+
+// only the function name can be found for a program counter.
+std::vector<backtrace_symbol> resolve_symbols(void *pc) {
+	return {backtrace_symbol{
+		"",
+		0,
+		util::symbol_name(pc, false, true),
+		pc
+	}};
+}
+
+} // anonymous namespace
+
+
 void StackAnalyzer::analyze() {
 	// unfortunately, backtrace won't tell us how big our buffer
 	// needs to be, so we have no choice but to try until it
@@ -216,38 +226,66 @@ void StackAnalyzer::analyze() {
 }
 
 
-void StackAnalyzer::get_symbols(std::function<void (const backtrace_symbol *)> cb, bool reversed) const {
-	backtrace_symbol symbol;
-	symbol.filename = "";
-	symbol.lineno = 0;
+}} // openage::error
 
-	if (reversed) {
-		for (size_t idx = this->stack_addrs.size(); idx-- > 0;) {
-			void *pc = this->stack_addrs[idx];
+#endif // WITHOUT_BACKTRACE
 
-			symbol.functionname = util::symbol_name(pc, false, true);
-			symbol.pc = pc;
 
-			cb(&symbol);
-		}
-	} else {
-		for (void *pc : this->stack_addrs) {
-			symbol.functionname = util::symbol_name(pc, false, true);
-			symbol.pc = pc;
+namespace openage {
+namespace error {
+
+
+namespace {
 
-			cb(&symbol);
+
+/**
+ * the symbols of a program counter, resolved when it's first printed.
+ *
+ * errors only store the program counters, and many of them are thrown
+ * at the same places, so the symbols are kept for all later backtraces.
+ * the entries are never removed, the references stay valid.
+ */
+const std::vector<backtrace_symbol> &cached_symbols(void *pc) {
+	// constructed on first use, errors may be thrown during static init
+	static std::mutex cache_mutex;
+	static std::unordered_map<void *, std::vector<backtrace_symbol>> cache;
+
+	{
+		std::lock_guard<std::mutex> lock{cache_mutex};
+		auto it = cache.find(pc);
+		if (it != cache.end()) {
+			return it->second;
 		}
 	}
-}
 
+	// the lookup reads the debug info, others may print meanwhile
+	std::vector<backtrace_symbol> symbols = resolve_symbols(pc);
 
-}} // openage::error
+	std::lock_guard<std::mutex> lock{cache_mutex};
+	return cache.emplace(pc, std::move(symbols)).first->second;
+}
 
-#endif // WITHOUT_BACKTRACE
+} // anonymous namespace
 
 
-namespace openage {
-namespace error {
+void StackAnalyzer::get_symbols(std::function<void (const backtrace_symbol *)> cb, bool reversed) const {
+	std::vector<const backtrace_symbol *> symbols;
+	for (void *pc : this->stack_addrs) {
+		for (const backtrace_symbol &symbol : cached_symbols(pc)) {
+			symbols.push_back(&symbol);
+		}
+	}
+
+	if (reversed) {
+		for (size_t idx = symbols.size(); idx-- > 0;) {
+			cb(symbols[idx]);
+		}
+	} else {
+		for (const backtrace_symbol *symbol : symbols) {
+			cb(symbol);
+		}
+	}
+}
 
 
 void StackAnalyzer::trim_to_current_stack_frame() {
@@ -23,6 +23,10 @@ namespace error {
  * The implementation  of analyze() and get_symbols() may use all sorts of
  * analyzers, depending on what's available on the platform.
  * The quality of the resolved symbol names may vary accordingly.
+ *
+ * analyze() only stores the program counters, as most errors are caught
+ * without being printed. The symbols are looked up by get_symbols(),
+ * once per program counter for all backtraces.
  */
 class StackAnalyzer : public Backtrace {
 public:
@@ -42,7 +46,8 @@ public:
 	 */
 	std::vector<void *> stack_addrs;
 
-	// Looks up symbol names for the program counter values.
+	// Looks up symbol names for the program counter values,
+	// or takes them from the symbols found for earlier backtraces.
 	void get_symbols(std::function<void (const backtrace_symbol *)> cb, bool reversed) const override;
 
 	void trim_to_current_stack_frame() override;
@@ -6,12 +6,54 @@
 #include "error/error.h"
 #include "gamestate/game_spec.h"
 #include "log/log.h"
+#include "shape_batch.h"
 #include "terrain/terrain_chunk.h"
+#include "terrain/terrain_object.h"
+#include "util/metrics.h"
 #include "util/strings.h"
 
 
 namespace openage {
 
+namespace {
+
+/**
+ * the foundation starts up to this many tiles from the cursor
+ * show whether the building can be placed there.
+ */
+constexpr coord::tile_t placement_radius = 8;
+
+constexpr shape_color placement_blocked{1.0, 0.0, 0.0, 0.2};
+constexpr shape_color placement_invalid{1.0, 0.0, 0.0, 0.5};
+constexpr shape_color placement_valid{0.0, 1.0, 0.0, 0.5};
+
+/**
+ * add the ground of a rectangle of tiles as quad in hud coordinates.
+ */
+void tile_quad(ShapeBatch &shapes, coord::tile start, coord::tile_delta size, shape_color color) {
+	coord::phys3 corner = start.to_phys2(coord::phys2_delta{0, 0}).to_phys3();
+	coord::phys_t ne = size.ne * coord::settings::phys_per_tile;
+	coord::phys_t se = size.se * coord::settings::phys_per_tile;
+
+	coord::phys3 corners[] = {
+		corner,
+		corner + coord::phys3_delta{ne, 0, 0},
+		corner + coord::phys3_delta{ne, se, 0},
+		corner + coord::phys3_delta{0, se, 0},
+	};
+
+	GLfloat x[4], y[4];
+	for (int i = 0; i < 4; i++) {
+		coord::camhud pos = corners[i].to_camgame().to_window().to_camhud();
+		x[i] = pos.x;
+		y[i] = pos.y;
+	}
+	shapes.quad(x, y, color);
+}
+
+} // anonymous namespace
+
+
 OutputMode::OutputMode(qtsdl::GuiItemLink *gui_link)
 	:
 	game_control{nullptr},
@@ -60,7 +102,7 @@ ActionModeSignals::ActionModeSignals(ActionMode *action_mode)
 void ActionModeSignals::on_action(const std::string &action_name) {
 	Engine *engine = this->action_mode->game_control->get_engine();
 
-	input::action_t action = engine->get_action_manager().get(action_name);
+	input::action_t action = engine->get_action_manager().get(action_name.c_str());
 	input::InputContext *top_ctxt = &engine->get_input_manager().get_top_context();
 
 	if (top_ctxt == this->action_mode ||
@@ -85,9 +127,18 @@ ActionMode::ActionMode(qtsdl::GuiItemLink *gui_link)
 	use_set_ability{false},
 	type_focus{nullptr},
 	selecting{false},
+	placement_changes{0},
+	announced_player{nullptr},
+	announced_revision{0},
+	announced_amounts{},
+	buttons_type_touched{false},
+	ability_touched{false},
 	rng{rng::random_seed()},
 	gui_signals{this} {}
 
+ActionMode::~ActionMode() {
+	this->stop_placement();
+}
 
 
 void ActionMode::on_game_control_set() {
@@ -130,29 +181,21 @@ void ActionMode::on_game_control_set() {
 
 	this->bind(action.get("SET_ABILITY_MOVE"),
 	           [this](const input::action_arg_t &) {
-		this->use_set_ability = true;
-		this->ability = ability_type::move;
-		emit this->gui_signals.ability_changed(std::to_string(this->ability));
+		this->set_ability(ability_type::move);
 	});
 
 	this->bind(action.get("SET_ABILITY_GATHER"),
 	           [this](const input::action_arg_t &) {
-		this->use_set_ability = true;
-		this->ability = ability_type::gather;
-		emit this->gui_signals.ability_changed(std::to_string(this->ability));
+		this->set_ability(ability_type::gather);
 	});
 
 	this->bind(action.get("SET_ABILITY_GARRISON"),
 	           [this](const input::action_arg_t &) {
-		this->use_set_ability = true;
-		this->ability = ability_type::garrison;
-		emit this->gui_signals.ability_changed(std::to_string(this->ability));
+		this->set_ability(ability_type::garrison);
 	});
 
 	this->bind(action.get("SET_ABILITY_REPAIR"), [this](const input::action_arg_t &) {
-		this->use_set_ability = true;
-		this->ability = ability_type::repair;
-		emit this->gui_signals.ability_changed(std::to_string(this->ability));
+		this->set_ability(ability_type::repair);
 	});
 
 	this->bind(action.get("SPAWN_VILLAGER"),
@@ -320,7 +363,7 @@ void ActionMode::on_game_control_set() {
 		this->selecting = false;
 	});
 
-	this->bind(input::event_class::MOUSE, [this](const input::action_arg_t &arg) {
+	this->bind(input::event_class::MOUSE, [this, engine](const input::action_arg_t &arg) {
 		auto mousepos_camgame = arg.mouse.to_camgame();
 		this->mousepos_phys3 = mousepos_camgame.to_phys3();
 		this->mousepos_tile = this->mousepos_phys3.to_tile3().to_tile();
@@ -328,7 +371,8 @@ void ActionMode::on_game_control_set() {
 		// drag selection box
 		if (arg.e.cc == input::ClassCode(input::event_class::MOUSE_MOTION, 0) &&
 			this->selecting && !this->type_focus) {
-			this->selection->drag_update(mousepos_camgame);
+			GameMain *game = engine->get_game();
+			this->selection->drag_update(mousepos_camgame, game ? game->terrain.get() : nullptr);
 			return true;
 		}
 		return false;
@@ -366,6 +410,9 @@ void ActionMode::on_exit() {
 		}
 		input_manager->remove_context(top_ctxt);
 		this->announce_buttons_type();
+
+		// not rendered anymore
+		this->flush_announcements();
 	}
 	this->selecting = false;
 }
@@ -420,6 +467,8 @@ void ActionMode::render() {
 
 	ENSURE(engine != nullptr, "engine is needed to render ActionMode");
 
+	this->flush_announcements();
+
 	if (engine->get_game()) {
 		Player *player = this->game_control->get_current_player();
 
@@ -430,9 +479,16 @@ void ActionMode::render() {
 			auto txt = this->type_focus->default_texture();
 			auto size = this->type_focus->foundation_size;
 			tile_range center = building_center(this->mousepos_phys3, size);
+
+			this->update_placement(engine->get_game()->terrain, center.start);
+			this->draw_placement(center.start);
+
 			txt->sample(center.draw.to_camgame().to_window().to_camhud(),
 			            player->color);
 		}
+		else if (this->placement) {
+			this->stop_placement();
+		}
 	}
 	else {
 		engine->render_text({0, 140}, 12, "Action Mode requires a game");
@@ -443,6 +499,87 @@ void ActionMode::render() {
 	this->selection->on_drawhud();
 }
 
+void ActionMode::update_placement(const std::shared_ptr<Terrain> &terrain, coord::tile cursor) {
+	if (this->placement and this->placement_terrain.lock() != terrain) {
+		this->stop_placement();
+	}
+
+	if (not this->placement) {
+		// the grid is only used while the terrain is the one of the game
+		Terrain *terrain_ptr = terrain.get();
+		this->placement = std::make_unique<PlacementGrid>(
+			placement_radius,
+			[terrain_ptr](coord::tile position) {
+				return foundation_tile_free(*terrain_ptr, position);
+			}
+		);
+		this->placement_terrain = terrain;
+		this->placement_changes = terrain->get_changes().subscribe();
+	}
+
+	this->placement->set_foundation(this->type_focus->foundation_size);
+
+	// test only the tiles whose objects or terrain changed
+	for (auto &changes : terrain->get_changes().take(this->placement_changes)) {
+		for (auto &tile : changes->tiles) {
+			this->placement->refresh_tile(tile.position);
+		}
+
+		// loaded chunks don't list their tiles
+		for (auto &chunk : changes->chunks) {
+			if (not chunk.all_tiles) {
+				continue;
+			}
+			coord::chunk position = chunk.position;
+			for (coord::tile_t se = 0; se < coord::settings::tiles_per_chunk; se++) {
+				for (coord::tile_t ne = 0; ne < coord::settings::tiles_per_chunk; ne++) {
+					this->placement->refresh_tile(position.to_tile(coord::tile_delta{ne, se}));
+				}
+			}
+		}
+	}
+
+	this->placement->set_center(cursor);
+}
+
+void ActionMode::stop_placement() {
+	auto terrain = this->placement_terrain.lock();
+	if (terrain and this->placement) {
+		terrain->get_changes().unsubscribe(this->placement_changes);
+	}
+	this->placement = nullptr;
+	this->placement_terrain.reset();
+}
+
+void ActionMode::draw_placement(coord::tile cursor) {
+	ShapeBatch shapes;
+	PlacementGrid &grid = *this->placement;
+
+	// the starts where the foundation doesn't fit,
+	// consecutive ones of a row as one quad
+	coord::tile start = grid.region_start();
+	coord::tile_t side = grid.region_side();
+	for (coord::tile_t se = 0; se < side; se++) {
+		coord::tile_t run = 0;
+		for (coord::tile_t ne = 0; ne <= side; ne++) {
+			if (ne < side and not grid.fits(start + coord::tile_delta{ne, se})) {
+				run += 1;
+				continue;
+			}
+			if (run > 0) {
+				tile_quad(shapes, start + coord::tile_delta{ne - run, se},
+				          coord::tile_delta{run, 1}, placement_blocked);
+				run = 0;
+			}
+		}
+	}
+
+	tile_quad(shapes, cursor, grid.get_foundation(),
+	          grid.fits(cursor) ? placement_valid : placement_invalid);
+
+	shapes.submit();
+}
+
 std::string ActionMode::name() const {
 	return "Action Mode";
 }
@@ -450,27 +587,81 @@ std::string ActionMode::name() const {
 void ActionMode::announce() {
 	this->OutputMode::announce();
 
-	this->announce_resources();
-	emit this->gui_signals.ability_changed(
-		this->use_set_ability ? std::to_string(this->ability) : "");
+	this->announce_resources(true);
+	this->announce_ability(true);
+}
+
+void ActionMode::announce_ability(bool force) {
+	std::string ability = this->use_set_ability ? std::to_string(this->ability) : "";
+	if (not force and ability == this->announced_ability) {
+		static util::MetricCounter &suppressed = util::metrics().counter("gui.announcements_suppressed");
+		suppressed.add();
+		return;
+	}
+
+	this->announced_ability = ability;
+	emit this->gui_signals.ability_changed(ability);
+}
+
+void ActionMode::set_ability(ability_type ability) {
+	this->use_set_ability = true;
+	this->ability = ability;
+	this->ability_touched = true;
 }
 
-void ActionMode::announce_resources() {
+void ActionMode::flush_announcements() {
+	if (this->buttons_type_touched) {
+		this->buttons_type_touched = false;
+		this->update_buttons_type();
+	}
+
+	if (this->ability_touched) {
+		this->ability_touched = false;
+		this->announce_ability();
+	}
+}
+
+void ActionMode::announce_resources(bool force) {
 	if (this->game_control) {
 		if (Player *player = this->game_control->get_current_player()) {
+			// the resources change at most once per tick
+			uint64_t revision = player->get_resource_revision();
+			if (not force and player == this->announced_player and revision == this->announced_revision) {
+				return;
+			}
+			bool same_player = (player == this->announced_player);
+			this->announced_player = player;
+			this->announced_revision = revision;
+
+			// a new revision may leave most amounts as they were
+			static util::MetricCounter &suppressed = util::metrics().counter("gui.announcements_suppressed");
 			for (auto i = static_cast<std::underlying_type<game_resource>::type>(game_resource::RESOURCE_TYPE_COUNT); i != 0; --i) {
 				auto resource_type = static_cast<game_resource>(i - 1);
+				int amount = static_cast<int>(player->amount(resource_type));
 
-				emit this->gui_signals.resource_changed(
-					resource_type,
-					static_cast<int>(player->amount(resource_type))
-				);
+				int &announced = this->announced_amounts[i - 1];
+				if (not force and same_player and amount == announced) {
+					suppressed.add();
+					continue;
+				}
+				announced = amount;
+
+				emit this->gui_signals.resource_changed(resource_type, amount);
 			}
 		}
 	}
 }
 
 void ActionMode::announce_buttons_type() {
+	// the input handlers may touch it several times per frame
+	if (this->buttons_type_touched) {
+		static util::MetricCounter &suppressed = util::metrics().counter("gui.announcements_suppressed");
+		suppressed.add();
+	}
+	this->buttons_type_touched = true;
+}
+
+void ActionMode::update_buttons_type() {
 	ActionButtonsType buttons_type;
 	Engine *engine = this->game_control->get_engine();
 	InputContext *top_ctxt = &engine->get_input_manager().get_top_context();
@@ -491,8 +682,9 @@ void ActionMode::announce_buttons_type() {
 		this->buttons_type = buttons_type;
 		emit this->gui_signals.buttons_type_changed(buttons_type);
 
-		// announce the changed input context
-		this->announce();
+		// announce the changed input context,
+		// the resources and ability didn't change with it.
+		this->OutputMode::announce();
 	}
 }
 
@@ -590,8 +782,8 @@ void EditorMode::paint_terrain_at(const coord::window &point) {
 	auto mousepos_phys3 = mousepos_camgame.to_phys3();
 	auto mousepos_tile = mousepos_phys3.to_tile3().to_tile();
 
-	TerrainChunk *chunk = terrain->get_create_chunk(mousepos_tile);
-	chunk->get_data(mousepos_tile)->terrain_id = editor_current_terrain;
+	terrain->get_create_chunk(mousepos_tile);
+	terrain->set_terrain_id(mousepos_tile, editor_current_terrain);
 }
 
 void EditorMode::paint_entity_at(const coord::window &point, const bool del) {
@@ -603,6 +795,11 @@ void EditorMode::paint_entity_at(const coord::window &point, const bool del) {
 	auto mousepos_tile = mousepos_phys3.to_tile3().to_tile();
 
 	TerrainChunk *chunk = terrain->get_create_chunk(mousepos_tile);
+	if (chunk == nullptr) {
+		// outside of a finite terrain
+		return;
+	}
+
 	// TODO : better detection of presence of unit
 	if (!chunk->get_data(mousepos_tile)->obj.empty()) {
 		if (del) {
@@ -1,7 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <string>
 #include <tuple>
 
 #include <QObject>
@@ -10,6 +13,8 @@
 #include "input/input_context.h"
 #include "rng/rng.h"
 #include "gamestate/game_main.h"
+#include "terrain/placement_grid.h"
+#include "terrain/tile_changes.h"
 #include "unit/command.h"
 #include "unit/selection.h"
 #include "unit/unit_type.h"
@@ -163,6 +168,7 @@ private:
 class ActionMode : public OutputMode {
 public:
 	ActionMode(qtsdl::GuiItemLink *gui_link);
+	~ActionMode();
 
 	bool available() const override;
 	void on_enter() override;
@@ -179,15 +185,39 @@ private:
 	virtual void announce() override;
 
 	/**
-	 * sends to gui the amounts of resources
+	 * sends to gui the amounts of resources,
+	 * if they changed since they were sent or if forced.
 	 */
-	void announce_resources();
+	void announce_resources(bool force=false);
+
+	/**
+	 * sends to gui the ability used for commands,
+	 * if it changed since it was sent or if forced.
+	 */
+	void announce_ability(bool force=false);
+
+	/**
+	 * the buttons the gui should use for the action buttons may have
+	 * changed, they are sent with the next frame (if changed).
+	 */
+	void announce_buttons_type();
 
 	/**
 	 * sends to gui the buttons it should use for the action buttons
 	 * (if changed)
 	 */
-	void announce_buttons_type();
+	void update_buttons_type();
+
+	/**
+	 * sends to gui the buttons type and ability if they were touched,
+	 * once per frame, however often they were touched meanwhile.
+	 */
+	void flush_announcements();
+
+	/**
+	 * restrict the command abilities, sent to gui with the next frame.
+	 */
+	void set_ability(ability_type ability);
 
 	/**
 	 * decides which type of right mouse click command
@@ -223,6 +253,23 @@ private:
 	 */
 	bool place_selection(coord::phys3 point);
 
+	/**
+	 * caches where the focused building type fits around the cursor tile,
+	 * updated with the tile changes of the terrain.
+	 */
+	void update_placement(const std::shared_ptr<Terrain> &terrain, coord::tile cursor);
+
+	/**
+	 * drops the placement cache and its tile change subscription.
+	 */
+	void stop_placement();
+
+	/**
+	 * draws the tiles around the cursor where the focused building
+	 * can't be placed, and its foundation at the cursor.
+	 */
+	void draw_placement(coord::tile cursor);
+
 	// currently selected units
 	UnitSelection *selection;
 
@@ -236,8 +283,34 @@ private:
 	coord::tile mousepos_tile;
 	bool selecting;
 
+	/**
+	 * the valid foundation starts of type_focus, exists while
+	 * a building is placed.
+	 */
+	std::unique_ptr<PlacementGrid> placement;
+	std::weak_ptr<Terrain> placement_terrain;
+	TileChangeLog::subscription_t placement_changes;
+
 	ActionButtonsType buttons_type;
 
+	/**
+	 * the player and resource revision sent to the gui last
+	 */
+	const Player *announced_player;
+	uint64_t announced_revision;
+
+	/**
+	 * the properties sent to the gui last, equal ones aren't sent again.
+	 */
+	std::array<int, static_cast<size_t>(game_resource::RESOURCE_TYPE_COUNT)> announced_amounts;
+	std::string announced_ability;
+
+	/**
+	 * the properties were touched since the last frame.
+	 */
+	bool buttons_type_touched;
+	bool ability_touched;
+
 	// used for random type creation
 	rng::RNG rng;
 
@@ -1,12 +1,14 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include <epoxy/gl.h>
 #include <SDL2/SDL.h>
+#include <algorithm>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <sstream>
 
+#include "assetmanager.h"
 #include "coord/vec2f.h"
 #include "engine.h"
 #include "gamedata/color.gen.h"
@@ -14,7 +16,13 @@
 #include "gamestate/game_spec.h"
 #include "input/input_manager.h"
 #include "log/log.h"
+#include "minimap.h"
+#include "pathfinding/path_service.h"
+#include "render_command_list.h"
+#include "shape_batch.h"
 #include "terrain/terrain.h"
+#include "terrain/terrain_renderer.h"
+#include "texture_array.h"
 #include "unit/action.h"
 #include "unit/command.h"
 #include "unit/producer.h"
@@ -22,6 +30,7 @@
 #include "unit/unit_texture.h"
 #include "util/timer.h"
 #include "util/externalprofiler.h"
+#include "util/trace.h"
 #include "renderer/text.h"
 #include "game_renderer.h"
 
@@ -32,18 +41,25 @@ RenderOptions::RenderOptions()
 	OptionNode{"RendererOptions"},
 	draw_grid{this, "draw_grid", false},
 	draw_debug{this, "draw_debug", false},
-	terrain_blending{this, "terrain_blending", true} {
+	terrain_blending{this, "terrain_blending", true},
+	draw_minimap{this, "draw_minimap", true},
+	texture_memory_budget{this, "texture_memory_budget", 1024},
+	texture_upload_budget{this, "texture_upload_budget", 16},
+	terrain_chunk_textures{this, "terrain_chunk_textures", 16} {
 }
 
 GameRenderer::GameRenderer(Engine *e)
 	:
 	engine{e} {
 
+	TRACE_SCOPE("game renderer setup");
+
 	// set options structure
 	this->settings.set_parent(this->engine);
 
 	// engine callbacks
 	this->engine->register_draw_action(this);
+	this->engine->register_drawhud_action(this);
 
 	util::Dir *data_dir = engine->get_data_dir();
 	util::Dir asset_dir = data_dir->append("converted");
@@ -51,12 +67,11 @@ GameRenderer::GameRenderer(Engine *e)
 	// load textures and stuff
 	gaben = new Texture{data_dir->join("gaben.png")};
 
-	std::vector<gamedata::palette_color> player_color_lines;
-	util::read_csv_file(asset_dir.join("player_palette.docx"), player_color_lines);
+	util::read_csv_file(asset_dir.join("player_palette.docx"), this->player_colors);
 
-	GLfloat *playercolors = new GLfloat[player_color_lines.size() * 4];
-	for (size_t i = 0; i < player_color_lines.size(); i++) {
-		auto line = &player_color_lines[i];
+	GLfloat *playercolors = new GLfloat[this->player_colors.size() * 4];
+	for (size_t i = 0; i < this->player_colors.size(); i++) {
+		auto line = &this->player_colors[i];
 		playercolors[i*4]     = line->r / 255.0;
 		playercolors[i*4 + 1] = line->g / 255.0;
 		playercolors[i*4 + 2] = line->b / 255.0;
@@ -79,11 +94,17 @@ GameRenderer::GameRenderer(Engine *e)
 	auto plaintexture_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, texture_frag_code });
 	delete[] texture_frag_code;
 
+	char *teamcolor_vert_code;
+	util::read_whole_file(&teamcolor_vert_code, data_dir->join("shaders/teamcolors.vert.glsl"));
+	auto teamcolor_vert = new shader::Shader(GL_VERTEX_SHADER, { shader_header_code, teamcolor_vert_code });
+	delete[] teamcolor_vert_code;
+
 	char *teamcolor_frag_code;
 	util::read_whole_file(&teamcolor_frag_code, data_dir->join("shaders/teamcolors.frag.glsl"));
 	std::stringstream ss;
-	ss << player_color_lines.size();
+	ss << this->player_colors.size();
 	auto teamcolor_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, ("#define NUM_OF_PLAYER_COLORS " + ss.str() + "\n").c_str(), equalsEpsilon_code, teamcolor_frag_code });
+	auto palette_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, ("#define NUM_OF_PLAYER_COLORS " + ss.str() + "\n").c_str(), "#define PALETTE_INDEXED\n", equalsEpsilon_code, teamcolor_frag_code });
 	delete[] teamcolor_frag_code;
 
 	char *alphamask_vert_code;
@@ -96,6 +117,48 @@ GameRenderer::GameRenderer(Engine *e)
 	auto alphamask_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, alphamask_frag_code });
 	delete[] alphamask_frag_code;
 
+	char *terrainblend_vert_code;
+	util::read_whole_file(&terrainblend_vert_code, data_dir->join("shaders/terrainblend.vert.glsl"));
+	auto terrainblend_vert = new shader::Shader(GL_VERTEX_SHADER, { shader_header_code, terrainblend_vert_code });
+
+	char *terrainblend_frag_code;
+	util::read_whole_file(&terrainblend_frag_code, data_dir->join("shaders/terrainblend.frag.glsl"));
+	auto terrainblend_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, terrainblend_frag_code });
+
+	// the terrain is drawn from texture arrays if the driver supports them
+	shader::Shader *terrainarray_vert = nullptr;
+	shader::Shader *terrainarray_frag = nullptr;
+	shader::Shader *terrainblend_array_vert = nullptr;
+	shader::Shader *terrainblend_array_frag = nullptr;
+	if (TextureArray::is_supported()) {
+		const char *texture_arrays_code = "#define TEXTURE_ARRAYS\n";
+
+		char *terrainarray_vert_code;
+		util::read_whole_file(&terrainarray_vert_code, data_dir->join("shaders/terrainarray.vert.glsl"));
+		terrainarray_vert = new shader::Shader(GL_VERTEX_SHADER, { shader_header_code, terrainarray_vert_code });
+		delete[] terrainarray_vert_code;
+
+		char *terrainarray_frag_code;
+		util::read_whole_file(&terrainarray_frag_code, data_dir->join("shaders/terrainarray.frag.glsl"));
+		terrainarray_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, terrainarray_frag_code });
+		delete[] terrainarray_frag_code;
+
+		terrainblend_array_vert = new shader::Shader(GL_VERTEX_SHADER, { shader_header_code, texture_arrays_code, terrainblend_vert_code });
+		terrainblend_array_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, texture_arrays_code, terrainblend_frag_code });
+	}
+	delete[] terrainblend_vert_code;
+	delete[] terrainblend_frag_code;
+
+	char *shapes_vert_code;
+	util::read_whole_file(&shapes_vert_code, data_dir->join("shaders/shapes.vert.glsl"));
+	auto shapes_vert = new shader::Shader(GL_VERTEX_SHADER, { shader_header_code, shapes_vert_code });
+	delete[] shapes_vert_code;
+
+	char *shapes_frag_code;
+	util::read_whole_file(&shapes_frag_code, data_dir->join("shaders/shapes.frag.glsl"));
+	auto shapes_frag = new shader::Shader(GL_FRAGMENT_SHADER, { shader_header_code, shapes_frag_code });
+	delete[] shapes_frag_code;
+
 	char *texturefont_vert_code;
 	util::read_whole_file(&texturefont_vert_code, data_dir->join("shaders/texturefont.vert.glsl"));
 	auto texturefont_vert = new shader::Shader(GL_VERTEX_SHADER, { shader_header_code, texturefont_vert_code });
@@ -120,11 +183,11 @@ GameRenderer::GameRenderer(Engine *e)
 
 	// create program for tinting textures at alpha-marked pixels
 	// with team colors
-	teamcolor_shader::program = new shader::Program(plaintexture_vert, teamcolor_frag);
+	teamcolor_shader::program = new shader::Program(teamcolor_vert, teamcolor_frag);
 	teamcolor_shader::program->link();
 	teamcolor_shader::texture = teamcolor_shader::program->get_uniform_id("texture");
 	teamcolor_shader::tex_coord = teamcolor_shader::program->get_attribute_id("tex_coordinates");
-	teamcolor_shader::player_id_var = teamcolor_shader::program->get_uniform_id("player_number");
+	teamcolor_shader::player_id_var = teamcolor_shader::program->get_attribute_id("player_id");
 	teamcolor_shader::alpha_marker_var = teamcolor_shader::program->get_uniform_id("alpha_marker");
 	teamcolor_shader::player_color_var = teamcolor_shader::program->get_uniform_id("player_color");
 	teamcolor_shader::program->use();
@@ -133,6 +196,22 @@ GameRenderer::GameRenderer(Engine *e)
 	// fill the teamcolor shader's player color table:
 	glUniform4fv(teamcolor_shader::player_color_var, 64, playercolors);
 	teamcolor_shader::program->stopusing();
+
+	// the teamcolor shader for textures storing palette indices
+	palette_shader::program = new shader::Program(teamcolor_vert, palette_frag);
+	palette_shader::program->link();
+	palette_shader::texture = palette_shader::program->get_uniform_id("texture");
+	palette_shader::palette = palette_shader::program->get_uniform_id("palette");
+	palette_shader::tex_coord = palette_shader::program->get_attribute_id("tex_coordinates");
+	palette_shader::player_id_var = palette_shader::program->get_attribute_id("player_id");
+	palette_shader::alpha_marker_var = palette_shader::program->get_uniform_id("alpha_marker");
+	palette_shader::player_color_var = palette_shader::program->get_uniform_id("player_color");
+	palette_shader::program->use();
+	glUniform1i(palette_shader::texture, 0);
+	glUniform1i(palette_shader::palette, 1);
+	glUniform1f(palette_shader::alpha_marker_var, 254.0/255.0);
+	glUniform4fv(palette_shader::player_color_var, 64, playercolors);
+	palette_shader::program->stopusing();
 	delete[] playercolors;
 
 
@@ -149,23 +228,57 @@ GameRenderer::GameRenderer(Engine *e)
 	glUniform1i(alphamask_shader::mask_texture, 1);
 	alphamask_shader::program->stopusing();
 
+	// create programs for blending the terrain in the chunk renderer
+	terrainblend_shader::textures.setup(new shader::Program(terrainblend_vert, terrainblend_frag), false);
+
+	// and for drawing it from the texture arrays
+	if (terrainarray_vert != nullptr) {
+		terrainarray_shader::program = new shader::Program(terrainarray_vert, terrainarray_frag);
+		terrainarray_shader::program->link();
+		terrainarray_shader::texture = terrainarray_shader::program->get_uniform_id("texture");
+		terrainarray_shader::tex_coord = terrainarray_shader::program->get_attribute_id("tex_coordinates");
+		terrainarray_shader::program->use();
+		glUniform1i(terrainarray_shader::texture, 0);
+		terrainarray_shader::program->stopusing();
+
+		terrainblend_shader::arrays.setup(new shader::Program(terrainblend_array_vert, terrainblend_array_frag), true);
+	}
+
+	// create program for the lines and rectangles of shape batches
+	shape_shader::program = new shader::Program(shapes_vert, shapes_frag);
+	shape_shader::program->link();
+	shape_shader::color = shape_shader::program->get_attribute_id("vertex_color");
+
 	// Create program for texture based font rendering
 	texturefont_shader::program = new shader::Program(texturefont_vert, texturefont_frag);
 	texturefont_shader::program->link();
 	texturefont_shader::texture = texturefont_shader::program->get_uniform_id("texture");
 	texturefont_shader::color = texturefont_shader::program->get_uniform_id("color");
 	texturefont_shader::tex_coord = texturefont_shader::program->get_attribute_id("tex_coordinates");
+	texturefont_shader::vertex_color = texturefont_shader::program->get_attribute_id("vertex_color");
+	texturefont_shader::distance_field = texturefont_shader::program->get_uniform_id("distance_field");
 	texturefont_shader::program->use();
 	glUniform1i(texturefont_shader::texture, 0);
+	glUniform1i(texturefont_shader::distance_field, 0);
 	texturefont_shader::program->stopusing();
 
 
 	// after linking, the shaders are no longer necessary
 	delete plaintexture_vert;
 	delete plaintexture_frag;
+	delete teamcolor_vert;
 	delete teamcolor_frag;
+	delete palette_frag;
 	delete alphamask_vert;
 	delete alphamask_frag;
+	delete terrainblend_vert;
+	delete terrainblend_frag;
+	delete terrainarray_vert;
+	delete terrainarray_frag;
+	delete terrainblend_array_vert;
+	delete terrainblend_array_frag;
+	delete shapes_vert;
+	delete shapes_frag;
 	delete texturefont_vert;
 	delete texturefont_frag;
 
@@ -193,8 +306,17 @@ GameRenderer::~GameRenderer() {
 
 	delete texture_shader::program;
 	delete teamcolor_shader::program;
+	delete palette_shader::program;
 	delete alphamask_shader::program;
+	delete terrainblend_shader::textures.program;
+	delete terrainblend_shader::arrays.program;
+	delete terrainarray_shader::program;
+	terrainblend_shader::arrays.program = nullptr;
+	terrainarray_shader::program = nullptr;
+	delete shape_shader::program;
 	delete texturefont_shader::program;
+
+	ShapeBatch::release();
 }
 
 bool GameRenderer::on_draw() {
@@ -205,6 +327,10 @@ bool GameRenderer::on_draw() {
 		// draw gaben, our great and holy protector, bringer of the half-life 3.
 		gaben->draw(coord::camgame{0, 0});
 
+		// path searches may read the terrain while it is drawn
+		path::PathService *path_service = game->get_path_service();
+		path_service->allow_searches();
+
 		// TODO move render code out of terrain
 		if (game->terrain) {
 			game->terrain->draw(this->engine, &this->settings);
@@ -213,10 +339,43 @@ bool GameRenderer::on_draw() {
 		if (this->settings.draw_grid.value) {
 			this->draw_debug_grid();
 		}
+
+		path_service->block_searches();
+
+		// all textures of this frame were used once it's drawn.
+		AssetManager *assets = game->get_spec()->get_asset_manager();
+		size_t budget = size_t(std::max(this->settings.texture_memory_budget.value, 0)) * 1024 * 1024;
+		size_t upload_budget = size_t(std::max(this->settings.texture_upload_budget.value, 0)) * 1024 * 1024;
+		RenderCommandList::submit([assets, budget, upload_budget] {
+			assets->set_texture_budget(budget);
+			assets->set_texture_upload_budget(upload_budget);
+			assets->next_frame();
+		});
 	}
 	return true;
 }
 
+bool GameRenderer::on_drawhud() {
+	GameMain *game = this->engine->get_game();
+
+	if (not game or not game->terrain or not this->settings.draw_minimap.value) {
+		this->minimap = nullptr;
+		return true;
+	}
+
+	if (not this->minimap or this->minimap->get_terrain() != game->terrain.get()) {
+		this->minimap = std::make_unique<Minimap>(game->terrain, this->player_colors);
+	}
+	this->minimap->update();
+
+	// in the lower right corner, above the fps counter
+	coord::window size = this->engine->get_coord_data()->window_size;
+	coord::pixel_t width = std::min<coord::pixel_t>(256, size.x / 4);
+	this->minimap->draw(coord::camhud{size.x - width / 2 - 10, width / 4 + 50}, width);
+
+	return true;
+}
+
 void GameRenderer::draw_debug_grid() {
 	coord::camgame camera = coord::tile{0, 0}.to_tile3().to_phys3().to_camgame();
 
@@ -250,19 +409,13 @@ void GameRenderer::draw_debug_grid() {
 	int y0         = cam_offset_y - line_half_height;
 	int y1         = cam_offset_y + line_half_height;
 
-	glLineWidth(1);
-	glColor3f(0.0, 0.0, 0.0);
-	glBegin(GL_LINES); {
-
-		for (int i = -k; i < k; i++) {
-			glVertex3f(i * tilesize_x + x0, y1, 0);
-			glVertex3f(i * tilesize_x + x1, y0, 0);
-
-			glVertex3f(i * tilesize_x + x0, y0 - 1, 0);
-			glVertex3f(i * tilesize_x + x1, y1 - 1, 0);
-		}
-
-	} glEnd();
+	ShapeBatch grid;
+	shape_color black{0.0, 0.0, 0.0, 1.0};
+	for (int i = -k; i < k; i++) {
+		grid.line(i * tilesize_x + x0, y1, i * tilesize_x + x1, y0, black);
+		grid.line(i * tilesize_x + x0, y0 - 1, i * tilesize_x + x1, y1 - 1, black);
+	}
+	grid.submit();
 }
 
 GameMain *GameRenderer::game() const {
@@ -1,13 +1,15 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <SDL2/SDL.h>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "coord/tile.h"
+#include "gamedata/color.gen.h"
 #include "handlers.h"
 #include "options.h"
 
@@ -15,6 +17,7 @@ namespace openage {
 
 class Engine;
 class GameMain;
+class Minimap;
 
 /**
  * Options for the renderer.
@@ -31,18 +34,39 @@ public:
 	options::Var<bool> draw_grid;
 	options::Var<bool> draw_debug;
 	options::Var<bool> terrain_blending;
+	options::Var<bool> draw_minimap;
+
+	/**
+	 * gpu memory for textures in MiB,
+	 * least recently used textures are evicted beyond it.
+	 */
+	options::Var<int> texture_memory_budget;
+
+	/**
+	 * texture pixels uploaded per frame in MiB, textures
+	 * beyond it are shown in one of the next frames.
+	 */
+	options::Var<int> texture_upload_budget;
+
+	/**
+	 * number of terrain chunks which are drawn from a texture of their
+	 * blended tiles, rendered once until their terrain changes.
+	 * each takes about 6 MiB of gpu memory, 0 disables them.
+	 */
+	options::Var<int> terrain_chunk_textures;
 };
 
 /**
  * renders the editor and action views
  *
  */
-class GameRenderer : DrawHandler {
+class GameRenderer : DrawHandler, HudHandler {
 public:
 	GameRenderer(Engine *e);
 	~GameRenderer();
 
 	bool on_draw() override;
+	bool on_drawhud() override;
 
 	/**
 	 * debug function that draws a simple overlay grid
@@ -66,6 +90,17 @@ public:
 private:
 	Engine *engine;
 
+	/**
+	 * the player palette, 8 shades per player.
+	 */
+	std::vector<gamedata::palette_color> player_colors;
+
+	/**
+	 * overview of the terrain of the current game,
+	 * created again when the terrain is replaced.
+	 */
+	std::unique_ptr<Minimap> minimap;
+
 };
 
 } // openage
@@ -0,0 +1,140 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "autosave.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "../error/error.h"
+#include "../job/job_manager.h"
+#include "../log/log.h"
+#include "game_main.h"
+#include "game_save.h"
+
+namespace openage {
+namespace gameio {
+
+
+constexpr int Autosave::rebase_interval;
+constexpr const char *Autosave::delta_suffix;
+
+
+struct Autosave::state {
+	state()
+		:
+		writing{false},
+		count{0} {}
+
+	/**
+	 * whether an autosave is written, the other members
+	 * are only used by it while it's set.
+	 */
+	std::atomic<bool> writing;
+
+	/**
+	 * the last base file and its snapshot.
+	 */
+	std::string base_filename;
+	save_snapshot base;
+
+	int count;
+};
+
+
+namespace {
+
+/**
+ * writes the snapshot as base file or as delta to the previous one.
+ */
+void write_autosave(Autosave::state &state, save_snapshot &&snapshot,
+                    const std::string &filename, job::JobManager *job_manager) {
+	std::string delta_filename = filename + Autosave::delta_suffix;
+
+	bool rebase = (state.count % Autosave::rebase_interval == 0 or
+	               state.base_filename != filename);
+	state.count++;
+
+	if (rebase) {
+		write_snapshot(snapshot, filename, job_manager);
+
+		// the delta belongs to the previous base
+		std::remove(delta_filename.c_str());
+
+		state.base_filename = filename;
+		state.base = std::move(snapshot);
+		log::log(MSG(dbg) << "autosaved " << filename);
+	}
+	else {
+		write_delta(snapshot, state.base, filename, delta_filename, job_manager);
+		log::log(MSG(dbg) << "autosaved " << delta_filename);
+	}
+}
+
+} // anonymous namespace
+
+
+Autosave::Autosave()
+	:
+	shared{std::make_shared<state>()},
+	since_autosave{0} {}
+
+
+Autosave::~Autosave() = default;
+
+
+void Autosave::tick(GameMain *game, time_nsec_t tick_duration,
+                    int interval, const std::string &filename) {
+	if (interval <= 0) {
+		this->since_autosave = 0;
+		return;
+	}
+
+	this->since_autosave += tick_duration;
+	if (this->since_autosave < static_cast<time_nsec_t>(interval) * 1000000000 or this->shared->writing) {
+		return;
+	}
+	this->since_autosave = 0;
+
+	// the only part that happens during the tick
+	auto snapshot = std::make_shared<save_snapshot>(take_snapshot(game));
+
+	job::JobManager *job_manager = game->get_job_manager();
+	if (job_manager == nullptr) {
+		try {
+			write_autosave(*this->shared, std::move(*snapshot), filename, nullptr);
+		}
+		catch (Error &exc) {
+			log::log(MSG(err) << "autosave failed: " << exc.msg.text);
+		}
+		return;
+	}
+
+	std::shared_ptr<state> shared = this->shared;
+	shared->writing = true;
+
+	job_manager->enqueue<bool>(
+		[shared, snapshot, filename, job_manager] {
+			try {
+				write_autosave(*shared, std::move(*snapshot), filename, job_manager);
+			}
+			catch (...) {
+				shared->writing = false;
+				throw;
+			}
+			shared->writing = false;
+			return true;
+		},
+		[] (job::result_function_t<bool> result) {
+			try {
+				result();
+			}
+			catch (Error &exc) {
+				log::log(MSG(err) << "autosave failed: " << exc.msg.text);
+			}
+		},
+		job::job_priority::low
+	);
+}
+
+
+}} // openage::gameio
@@ -0,0 +1,59 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "../util/timing.h"
+
+namespace openage {
+
+class GameMain;
+
+namespace gameio {
+
+/**
+ * Saves the game periodically without holding up its ticks.
+ *
+ * At a tick boundary, the saved state is copied into a snapshot, which
+ * a job manager worker writes. The first autosave, and every
+ * rebase_interval-th after it, writes the full snapshot as base file.
+ * The ones between write a delta file with the chunks and units that
+ * changed since the base, which load() applies on top of it.
+ */
+class Autosave {
+public:
+	Autosave();
+	~Autosave();
+
+	/**
+	 * called after each tick, starts an autosave when the interval
+	 * passed and the previous autosave is written.
+	 *
+	 * @param interval: seconds between autosaves, 0 disables them
+	 * @param filename: the base file, the delta is written next to it
+	 *                  with the delta_suffix
+	 */
+	void tick(GameMain *game, time_nsec_t tick_duration,
+	          int interval, const std::string &filename);
+
+	/**
+	 * autosaves that write a delta, between the base files.
+	 */
+	static constexpr int rebase_interval = 10;
+
+	static constexpr const char *delta_suffix = ".delta";
+
+	/**
+	 * shared with the job that writes the autosave.
+	 */
+	struct state;
+
+private:
+	std::shared_ptr<state> shared;
+
+	time_nsec_t since_autosave;
+};
+
+}} // openage::gameio
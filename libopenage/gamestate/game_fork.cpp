@@ -0,0 +1,247 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "game_fork.h"
+
+#include <utility>
+
+#include "../log/log.h"
+#include "../terrain/chunk_streamer.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_chunk.h"
+#include "../terrain/terrain_object.h"
+#include "../unit/unit.h"
+#include "../unit/unit_type.h"
+#include "game_main.h"
+#include "game_spec.h"
+#include "player.h"
+
+namespace openage {
+
+
+GameSnapshot::GameSnapshot(GameMain &game)
+	:
+	spec{game.spec},
+	settings{game.initial_settings},
+	tick_rate{game.tick_rate.value},
+	tick_count{game.tick_count},
+	infinite_terrain{game.terrain->infinite},
+	limit_negative{game.terrain->limit_negative},
+	limit_positive{game.terrain->limit_positive},
+	rng{game.rng},
+	market{game.market},
+	arena{std::make_unique<util::FrameArena>()},
+	chunks{util::ArenaAllocator<coord::chunk>{*this->arena}},
+	terrain_ids{util::ArenaAllocator<int>{*this->arena}},
+	units{util::ArenaAllocator<unit_state>{*this->arena}},
+	stockpiles{util::ArenaAllocator<ResourceBundle>{*this->arena}} {
+
+	// the sizes are known, so the arena gets no unused copies
+	std::vector<coord::chunk> used_chunks = game.terrain->used_chunks();
+
+	// the fork has the stored chunks loaded as well
+	ChunkStreamer *streamer = game.terrain->get_streamer();
+	std::vector<coord::chunk> stored_chunks;
+	if (streamer != nullptr) {
+		stored_chunks = streamer->stored_chunks();
+	}
+
+	size_t chunk_count = used_chunks.size() + stored_chunks.size();
+	this->chunks.reserve(chunk_count);
+	this->terrain_ids.reserve(chunk_count * chunk_size * chunk_size);
+
+	for (coord::chunk &position : used_chunks) {
+		TerrainChunk *chunk = game.terrain->get_chunk(position);
+		this->chunks.push_back(position);
+		for (size_t p = 0; p < chunk->tile_count; ++p) {
+			this->terrain_ids.push_back(chunk->get_terrain_id(p));
+		}
+	}
+
+	for (coord::chunk &position : stored_chunks) {
+		std::vector<terrain_t> ids = streamer->get_stored_ids(position);
+		this->chunks.push_back(position);
+		this->terrain_ids.insert(std::end(this->terrain_ids), std::begin(ids), std::end(ids));
+	}
+
+	std::vector<Unit *> all_units = game.placed_units.all_units();
+	this->units.reserve(all_units.size());
+
+	for (Unit *unit : all_units) {
+		if (not unit->location or not unit->has_attribute(attr_type::owner)) {
+			continue;
+		}
+
+		unit_state state;
+		state.id = unit->id;
+		state.type_id = unit->unit_type->id();
+		state.owner = unit->get_attribute<attr_type::owner>().player.player_number;
+
+		// buildings are placed by their western tile
+		if (dynamic_cast<SquareObject *>(unit->location.get())) {
+			state.position = unit->location->pos.start.to_phys2().to_phys3();
+		}
+		else {
+			state.position = unit->location->pos.draw;
+		}
+
+		state.hitpoints = unit->has_attribute(attr_type::hitpoints) ?
+		                  unit->get_attribute<attr_type::hitpoints>().current : 0;
+
+		state.has_building = unit->has_attribute(attr_type::building);
+		state.completed = state.has_building ?
+		                  unit->get_attribute<attr_type::building>().completed : 0.0f;
+
+		state.has_resource = unit->has_attribute(attr_type::resource);
+		state.resource_amount = state.has_resource ?
+		                        unit->get_attribute<attr_type::resource>().amount : 0.0f;
+
+		state.has_gatherer = unit->has_attribute(attr_type::gatherer);
+		state.carried_type = game_resource::food;
+		state.carried_amount = 0.0f;
+		if (state.has_gatherer) {
+			auto &gatherer = unit->get_attribute<attr_type::gatherer>();
+			state.carried_type = gatherer.current_type;
+			state.carried_amount = gatherer.amount;
+		}
+
+		this->units.push_back(state);
+	}
+
+	this->stockpiles.reserve(game.players.size());
+	for (auto &player : game.players) {
+		this->player_names.push_back(player.name);
+		this->stockpiles.push_back(player.get_stockpile());
+	}
+}
+
+
+GameSnapshot::~GameSnapshot() = default;
+
+
+std::unique_ptr<GameFork> GameSnapshot::fork() const {
+	auto game = std::make_unique<GameMain>(*this);
+	std::unordered_map<id_t, id_t> ids = this->place_units(*game);
+	return std::unique_ptr<GameFork>{new GameFork{std::move(game), std::move(ids)}};
+}
+
+
+uint64_t GameSnapshot::get_tick_count() const {
+	return this->tick_count;
+}
+
+
+size_t GameSnapshot::unit_count() const {
+	return this->units.size();
+}
+
+
+size_t GameSnapshot::memory_used() const {
+	return this->arena->used();
+}
+
+
+std::shared_ptr<Terrain> GameSnapshot::create_terrain() const {
+	std::shared_ptr<Terrain> terrain;
+	if (this->infinite_terrain) {
+		terrain = std::make_shared<Terrain>(this->spec->get_terrain_meta(), true);
+	}
+	else {
+		terrain = std::make_shared<Terrain>(this->spec->get_terrain_meta(),
+		                                    this->limit_negative, this->limit_positive);
+	}
+
+	const int *ids = this->terrain_ids.data();
+	for (auto &position : this->chunks) {
+		TerrainChunk *chunk = terrain->get_create_chunk(position);
+		for (size_t p = 0; p < chunk->tile_count; ++p) {
+			chunk->get_data(p)->terrain_id = *ids++;
+		}
+		terrain->invalidate_chunk(position);
+	}
+	return terrain;
+}
+
+
+std::unordered_map<id_t, id_t> GameSnapshot::place_units(GameMain &game) const {
+	std::unordered_map<id_t, id_t> ids;
+	ids.reserve(this->units.size());
+
+	size_t lost = 0;
+	for (auto &state : this->units) {
+		Player *owner = game.get_player(state.owner);
+		UnitType *type = owner->get_type(state.type_id);
+		UnitReference ref = type ? game.placed_units.new_unit(*type, *owner, state.position)
+		                         : UnitReference{};
+		if (not ref.is_valid()) {
+			lost += 1;
+			continue;
+		}
+
+		Unit &unit = *ref.get();
+		ids.emplace(state.id, unit.id);
+
+		if (state.has_building and unit.has_attribute(attr_type::building)) {
+			if (state.completed >= 1.0f) {
+				complete_building(unit);
+			}
+			else {
+				unit.get_attribute<attr_type::building>().completed = state.completed;
+			}
+		}
+
+		if (unit.has_attribute(attr_type::hitpoints)) {
+			unit.set_hitpoints(state.hitpoints);
+		}
+
+		if (state.has_resource and unit.has_attribute(attr_type::resource)) {
+			unit.get_attribute<attr_type::resource>().amount = state.resource_amount;
+		}
+
+		if (state.has_gatherer and unit.has_attribute(attr_type::gatherer)) {
+			auto &gatherer = unit.get_attribute<attr_type::gatherer>();
+			gatherer.current_type = state.carried_type;
+			gatherer.amount = state.carried_amount;
+		}
+	}
+
+	if (lost > 0) {
+		log::log(MSG(dbg) << "Forked game lost " << lost << " units that could not be placed");
+	}
+
+	return ids;
+}
+
+
+GameFork::GameFork(std::unique_ptr<GameMain> game, std::unordered_map<id_t, id_t> units)
+	:
+	game{std::move(game)},
+	units{std::move(units)} {}
+
+
+GameFork::~GameFork() = default;
+
+
+GameMain &GameFork::get_game() {
+	return *this->game;
+}
+
+
+id_t GameFork::get_unit(id_t original) const {
+	auto it = this->units.find(original);
+	return it == std::end(this->units) ? 0 : it->second;
+}
+
+
+void GameFork::tick(int count) {
+	time_nsec_t tick_duration = this->game->get_tick_duration();
+	for (int i = 0; i < count; i++) {
+		this->game->update(tick_duration);
+	}
+}
+
+
+void GameFork::simulate(time_nsec_t duration) {
+	this->tick(static_cast<int>(duration / this->game->get_tick_duration()));
+}
+
+} // openage
@@ -0,0 +1,183 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../rng/rng.h"
+#include "../unit/unit_container.h"
+#include "../util/frame_arena.h"
+#include "../util/timing.h"
+#include "market.h"
+#include "replay.h"
+#include "resource.h"
+
+namespace openage {
+
+class GameFork;
+class GameMain;
+class GameSpec;
+class Terrain;
+
+
+/**
+ * The mutable state of a game at one point: the units, their placement,
+ * the stockpiles of the players, the market and the random numbers.
+ *
+ * The game data of the spec and the unit types is shared with the game,
+ * so the copy is as large as what changes during a game. Its contents
+ * are stored on an arena of the snapshot, in a few blocks.
+ *
+ * A snapshot is taken once, e.g. per decision of an AI, and can then be
+ * forked any number of times, by any thread at the same time, to try
+ * out what happens after different commands.
+ *
+ * The units are copied without their actions, so the units of a fork
+ * are idle until they get commands again. Garrisoned units are left out.
+ */
+class GameSnapshot {
+public:
+	/**
+	 * copies the state of the game.
+	 * must be called between ticks, on the thread that runs them.
+	 */
+	explicit GameSnapshot(GameMain &game);
+	~GameSnapshot();
+
+	GameSnapshot(const GameSnapshot &) = delete;
+	GameSnapshot &operator =(const GameSnapshot &) = delete;
+
+	/**
+	 * a new game in the state of the snapshot, thread safe.
+	 */
+	std::unique_ptr<GameFork> fork() const;
+
+	/**
+	 * the tick that was simulated next in the game.
+	 */
+	uint64_t get_tick_count() const;
+
+	size_t unit_count() const;
+
+	/**
+	 * bytes used for the copied state.
+	 */
+	size_t memory_used() const;
+
+private:
+	friend class GameMain;
+
+	/**
+	 * the copied state of a placed unit.
+	 */
+	struct unit_state {
+		id_t id;
+		int type_id;
+		unsigned int owner;
+		coord::phys3 position;
+		unsigned int hitpoints;
+
+		bool has_building;
+		bool has_resource;
+		bool has_gatherer;
+
+		float completed;        //!< of the building
+		float resource_amount;  //!< left in the resource
+		game_resource carried_type;
+		float carried_amount;   //!< by the gatherer
+	};
+
+	template<typename T>
+	using arena_vector = std::vector<T, util::ArenaAllocator<T>>;
+
+	/**
+	 * the terrain of the game, without objects.
+	 */
+	std::shared_ptr<Terrain> create_terrain() const;
+
+	/**
+	 * places the units in the forked game.
+	 * @returns the ids of the units in the fork by their original ids
+	 */
+	std::unordered_map<id_t, id_t> place_units(GameMain &game) const;
+
+	std::shared_ptr<GameSpec> spec;
+	replay_settings settings;
+	std::vector<std::string> player_names;
+	int tick_rate;
+	uint64_t tick_count;
+
+	bool infinite_terrain;
+	coord::tile limit_negative, limit_positive;
+
+	rng::RNG rng;
+	Market market;
+
+	/**
+	 * owns the memory of the vectors below, declared first so it's
+	 * destroyed last.
+	 */
+	std::unique_ptr<util::FrameArena> arena;
+
+	/**
+	 * the terrain ids of the chunks, chunk after chunk.
+	 */
+	arena_vector<coord::chunk> chunks;
+	arena_vector<int> terrain_ids;
+
+	arena_vector<unit_state> units;
+
+	/**
+	 * the stockpile of each player.
+	 */
+	arena_vector<ResourceBundle> stockpiles;
+};
+
+
+/**
+ * A game created from a snapshot, simulated without engine.
+ * The fork is only used by one thread, and runs its ticks as fast
+ * as possible. Its commands are not recorded.
+ */
+class GameFork {
+public:
+	~GameFork();
+
+	GameFork(const GameFork &) = delete;
+	GameFork &operator =(const GameFork &) = delete;
+
+	GameMain &get_game();
+
+	/**
+	 * the id of a unit of the original game in the fork,
+	 * 0 if it isn't there.
+	 */
+	id_t get_unit(id_t original) const;
+
+	/**
+	 * advances the fork by count ticks.
+	 */
+	void tick(int count=1);
+
+	/**
+	 * advances the fork by the ticks in the game time.
+	 */
+	void simulate(time_nsec_t duration);
+
+private:
+	friend class GameSnapshot;
+
+	GameFork(std::unique_ptr<GameMain> game, std::unordered_map<id_t, id_t> units);
+
+	std::unique_ptr<GameMain> game;
+	std::unordered_map<id_t, id_t> units;
+};
+
+} // openage
@@ -2,26 +2,116 @@
 
 #include "game_main.h"
 
+#include <algorithm>
+#include <tuple>
+
 #include "../engine.h"
+#include "../error/error.h"
 #include "../log/log.h"
+#include "../pathfinding/path_cache.h"
+#include "../pathfinding/path_service.h"
+#include "../terrain/chunk_streamer.h"
 #include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../unit/action.h"
+#include "../unit/action_pool.h"
+#include "../unit/unit.h"
 #include "../unit/unit_type.h"
+#include "game_fork.h"
 #include "game_spec.h"
 #include "generator.h"
+#include "lockstep.h"
 
 
 namespace openage {
 
+namespace {
+
+/**
+ * find the job manager to run background tasks of the game.
+ */
+job::JobManager *game_job_manager(GameSpec *spec) {
+	AssetManager *assets = spec ? spec->get_asset_manager() : nullptr;
+	return assets ? assets->get_job_manager() : nullptr;
+}
+
+/**
+ * at most this many ticks are simulated per frame. the time of slower
+ * frames is dropped, so catching up never takes longer than a frame.
+ */
+constexpr unsigned max_ticks_per_frame = 5;
+
+} // anonymous namespace
+
 GameMain::GameMain(const Generator &generator)
 	:
 	OptionNode{"GameMain"},
 	terrain{generator.terrain()},
 	placed_units{},
-	spec{generator.get_spec()} {
+	rng{static_cast<uint64_t>(generator.getv<int>("generation_seed"))},
+	tick_rate{this, "tick_rate", 20},
+	autosave_interval{this, "autosave_interval", 0},
+	autosave_filename{this, "autosave_filename", "/tmp/openage-autosave.oas"},
+	replay_filename{this, "replay_filename", "/tmp/openage-replay.oar"},
+	terrain_idle_ticks{this, "terrain_idle_ticks", 600},
+	terrain_stream_ticks{this, "terrain_stream_ticks", 20},
+	influence_ticks{this, "influence_ticks", 10},
+	tick_accumulator{0},
+	lockstep{nullptr},
+	tick_count{0},
+	replay_started{false},
+	initial_settings{replay_settings::from(generator)},
+	spec{generator.get_spec()},
+	path_service{std::make_unique<path::PathService>(game_job_manager(this->spec.get()),
+	                                                 &this->terrain->get_path_graph())} {
+
+	this->initialise(generator.player_names(), game_job_manager(this->spec.get()));
+
+	// initialise units
+	generator.add_units(*this);
+}
+
+GameMain::GameMain(const GameSnapshot &snapshot)
+	:
+	OptionNode{"GameMain"},
+	terrain{snapshot.create_terrain()},
+	market{snapshot.market},
+	placed_units{},
+	rng{snapshot.rng},
+	tick_rate{this, "tick_rate", snapshot.tick_rate},
+	autosave_interval{this, "autosave_interval", 0},
+	autosave_filename{this, "autosave_filename", ""},
+	replay_filename{this, "replay_filename", ""},
+	// forks are short-lived, compressing would only slow them down
+	terrain_idle_ticks{this, "terrain_idle_ticks", 0},
+	terrain_stream_ticks{this, "terrain_stream_ticks", 0},
+	influence_ticks{this, "influence_ticks", 0},
+	tick_accumulator{0},
+	lockstep{nullptr},
+	tick_count{snapshot.tick_count},
+	replay_started{true},
+	initial_settings{snapshot.settings},
+	spec{snapshot.spec},
+	// a fork runs on the thread that simulates it, its path searches too
+	path_service{std::make_unique<path::PathService>(nullptr, &this->terrain->get_path_graph())} {
+
+	this->initialise(snapshot.player_names, nullptr);
+
+	for (size_t i = 0; i < this->players.size() and i < snapshot.stockpiles.size(); i++) {
+		this->players[i].set_stockpile(snapshot.stockpiles[i]);
+	}
+}
+
+void GameMain::initialise(const std::vector<std::string> &player_names,
+                          job::JobManager *job_manager) {
+	this->terrain->set_path_service(this->path_service.get());
+	if (this->terrain->get_streamer()) {
+		this->terrain->get_streamer()->set_job_manager(job_manager);
+	}
 
 	// players
 	unsigned int i = 0;
-	for (auto &name : generator.player_names()) {
+	for (auto &name : player_names) {
 		this->players.emplace_back(this->add_civ(i), i, name);
 		i++;
 	}
@@ -29,15 +119,38 @@ GameMain::GameMain(const Generator &generator)
 	// initialise types only after all players are added
 	for (auto &p : this->players) {
 		p.initialise_unit_types();
+		p.set_state_hash(&this->placed_units.get_state_hash());
 	}
+	this->placed_units.get_state_hash().track_rng(&this->rng);
+
+	// commands go through dispatch_command, to be recorded
+	this->set_lockstep(nullptr);
 
-	// initialise units
 	this->placed_units.set_terrain(this->terrain);
-	generator.add_units(*this);
+	this->placed_units.set_job_manager(job_manager);
 }
 
 GameMain::~GameMain() {
 	log::log(MSG(info) << "Cleanup gamemain");
+
+	if (this->recorder) {
+		this->recorder->finish(this->tick_count);
+	}
+
+	ActionPool::stats actions = ActionPool::get_stats();
+	log::log(MSG(dbg) << "Unit actions: " << actions.allocations << " allocated, "
+	         << actions.reused << " reused, " << actions.heap_allocations << " heap allocations");
+
+	MoveAction::stats moves = MoveAction::get_stats();
+	log::log(MSG(dbg) << "Blocked moves: " << moves.blocked << ", " << moves.avoided << " avoided, "
+	         << moves.waited << " waited, " << moves.repairs - moves.failed_repairs << "/"
+	         << moves.repairs << " detours found, " << moves.repaths << " new paths");
+
+	path::PathCache &paths = this->terrain->get_path_cache();
+	log::log(MSG(dbg) << "Path cache: " << paths.get_hits() << " paths reused, "
+	         << paths.get_misses() << " searched");
+
+	this->terrain->set_path_service(nullptr);
 }
 
 unsigned int GameMain::player_count() const {
@@ -61,11 +174,218 @@ GameSpec *GameMain::get_spec() {
 }
 
 void GameMain::update(time_nsec_t lastframe_duration) {
-	this->placed_units.update_all(lastframe_duration);
+	time_nsec_t tick_duration = this->get_tick_duration();
+	this->tick_accumulator += lastframe_duration;
+
+	unsigned ticks = 0;
+	while (this->tick_accumulator >= tick_duration) {
+		if (this->lockstep and not this->lockstep->ready()) {
+			// waiting for the commands of other players,
+			// they are simulated in the next frames.
+			this->tick_accumulator = std::min(this->tick_accumulator,
+			                                  max_ticks_per_frame * tick_duration);
+			break;
+		}
+
+		if (ticks == max_ticks_per_frame) {
+			// the game falls behind instead of spending
+			// ever longer frames on catching up.
+			this->tick_accumulator %= tick_duration;
+			break;
+		}
+
+		this->tick(tick_duration);
+		this->tick_accumulator -= tick_duration;
+		ticks += 1;
+	}
+
+	// objects are drawn between their positions of the last two ticks
+	this->terrain->set_tick_fraction(static_cast<float>(this->tick_accumulator) / tick_duration);
+}
+
+time_nsec_t GameMain::get_tick_duration() const {
+	int rate = std::max(this->tick_rate.value, 1);
+	return 1000000000 / rate;
+}
+
+void GameMain::tick(time_nsec_t tick_duration) {
+	this->start_replay();
+
+	// the paths of the last tick are searched on the terrain it left
+	this->path_service->next_tick();
+
+	if (this->lockstep) {
+		this->lockstep->apply(*this);
+	}
+
+	this->terrain->next_tick();
+	this->placed_units.update_all(tick_duration);
+
+	// the resources received during the tick
+	for (auto &player : this->players) {
+		player.apply_income();
+	}
+
+	// chunks are checked as often as they may become idle
+	int idle_ticks = this->terrain_idle_ticks.value;
+	if (idle_ticks > 0 and this->tick_count % idle_ticks == 0) {
+		this->terrain->compress_idle_chunks(idle_ticks);
+	}
+
+	int stream_ticks = this->terrain_stream_ticks.value;
+	if (stream_ticks > 0 and this->terrain->get_streamer() and
+	    this->tick_count % stream_ticks == 0) {
+		this->stream_terrain();
+	}
+
+	int influence_ticks = this->influence_ticks.value;
+	if (influence_ticks > 0 and this->influence.is_used() and
+	    this->tick_count % influence_ticks == 0) {
+		this->influence.update(InfluenceMap::collect_sources(this->placed_units),
+		                       this->terrain->used_chunks(),
+		                       this->players.size(),
+		                       this->tick_count,
+		                       this->get_job_manager());
+	}
+
+	this->autosave.tick(this, tick_duration, this->autosave_interval.value,
+	                    this->autosave_filename.value);
+
+	if (this->recorder) {
+		this->recorder->end_tick(this->tick_count, this->get_state_hash());
+	}
+	this->tick_count += 1;
+
+	this->unit_view.refresh(this->placed_units, this->tick_count);
+}
+
+void GameMain::set_view_focus(coord::phys3 position) {
+	if (this->terrain->get_streamer()) {
+		this->terrain->get_streamer()->set_view(position.to_tile3().to_tile().to_chunk());
+	}
+}
+
+void GameMain::stream_terrain() {
+	std::vector<coord::chunk> focus;
+	for (Unit *unit : this->placed_units.all_units()) {
+		if (unit->location) {
+			focus.push_back(unit->location->pos.start.to_chunk());
+		}
+	}
+
+	// most units share their chunks with others
+	std::sort(std::begin(focus), std::end(focus), [](const coord::chunk &a, const coord::chunk &b) {
+		return std::tie(a.ne, a.se) < std::tie(b.ne, b.se);
+	});
+	focus.erase(std::unique(std::begin(focus), std::end(focus)), std::end(focus));
+
+	size_t stored = this->terrain->get_streamer()->update(focus);
+	if (stored > 0) {
+		log::log(MSG(dbg) << "Stored " << stored << " terrain chunks that are far away");
+	}
+}
+
+path::PathService *GameMain::get_path_service() {
+	return this->path_service.get();
+}
+
+job::JobManager *GameMain::get_job_manager() {
+	return game_job_manager(this->spec.get());
+}
+
+StateHash &GameMain::get_state_hash() {
+	return this->placed_units.get_state_hash();
+}
+
+void GameMain::set_lockstep(LockstepSession *session) {
+	this->lockstep = session;
+
+	if (session) {
+		session->set_state_hash(&this->get_state_hash());
+		this->placed_units.set_command_stream([session](const GroupCommand &group) {
+			session->submit(group);
+		});
+	}
+	else {
+		this->placed_units.set_command_stream([this](const GroupCommand &group) {
+			this->dispatch_command(record_command(group));
+		});
+	}
+}
+
+void GameMain::dispatch_command(const command_record &record) {
+	std::unique_ptr<GroupCommand> group = restore_command(record, *this);
+	if (not group or group->units.empty()) {
+		return;
+	}
+
+	// commands may be given before the first tick
+	this->start_replay();
+
+	if (this->recorder) {
+		this->recorder->record(this->tick_count, record);
+	}
+	this->placed_units.dispatch_group_command(*group);
+}
+
+uint64_t GameMain::get_tick_count() const {
+	return this->tick_count;
+}
+
+void GameMain::record_replay(const std::string &fname, unsigned int checkpoint_interval) {
+	if (this->recorder) {
+		this->recorder->finish(this->tick_count);
+		this->recorder.reset();
+	}
+	this->replay_started = true;
+
+	if (fname.empty()) {
+		return;
+	}
+
+	if (this->tick_count > 0) {
+		// the replay is played back from the settings
+		throw Error(MSG(err) << "a game can only be recorded from its first tick");
+	}
+
+	replay_settings settings = this->initial_settings;
+	settings.tick_rate = std::max(this->tick_rate.value, 1);
+	this->recorder = std::make_unique<ReplayRecorder>(fname, settings, checkpoint_interval);
+	log::log(MSG(info) << "Recording the game to " << fname);
+}
+
+const replay_settings &GameMain::get_replay_settings() const {
+	return this->initial_settings;
+}
+
+std::shared_ptr<unit_columns> GameMain::get_unit_columns() {
+	if (not this->unit_view.is_used()) {
+		// the ticks before were not published
+		this->unit_view.get();
+		this->unit_view.refresh(this->placed_units, this->tick_count);
+	}
+	return this->unit_view.get();
+}
+
+void GameMain::start_replay() {
+	if (this->replay_started) {
+		return;
+	}
+	this->replay_started = true;
+
+	if (this->tick_count == 0 and not this->replay_filename.value.empty()) {
+		try {
+			this->record_replay(this->replay_filename.value);
+		}
+		catch (Error &e) {
+			log::log(MSG(err) << "The game is not recorded: " << e);
+		}
+	}
 }
 
 Civilisation *GameMain::add_civ(int civ_id) {
-	auto new_civ = std::make_shared<Civilisation>(*this->spec, civ_id);
+	// the unit type metas of a civ are the same in each game
+	auto new_civ = this->spec->get_civilisation(civ_id);
 	this->civs.emplace_back(new_civ);
 	return new_civ.get();
 }
@@ -8,31 +8,52 @@
 
 #include <QObject>
 
+#include "autosave.h"
+#include "influence_map.h"
 #include "market.h"
 #include "player.h"
+#include "replay.h"
 #include "team.h"
+#include "../coord/phys3.h"
 #include "../options.h"
+#include "../rng/rng.h"
 #include "../unit/unit_container.h"
+#include "../unit/unit_view.h"
 #include "../util/timing.h"
 
 
 namespace openage {
 
 class Engine;
+class GameSnapshot;
 class Generator;
+class LockstepSession;
 class Terrain;
 
+namespace job {
+class JobManager;
+} // namespace job
+
+namespace path {
+class PathService;
+} // namespace path
+
 
 /**
  * Contains information for a single game
  * This information must be synced across network clients
  *
- * TODO: include a list of actions to be saved
- *       as the game replay file
+ * The commands of the players are recorded in a replay file,
+ * see replay_filename.
  */
 class GameMain : public options::OptionNode {
 public:
 	GameMain(const Generator &generator);
+
+	/**
+	 * a copy of the game the snapshot was taken of, see GameFork.
+	 */
+	explicit GameMain(const GameSnapshot &snapshot);
 	~GameMain();
 
 	/**
@@ -61,10 +82,79 @@ public:
 	GameSpec *get_spec();
 
 	/**
-	 * updates the game by one frame
+	 * advance the game by the duration of a frame.
+	 * the simulation runs in ticks of fixed length, the time of
+	 * frames shorter than a tick is accumulated for the next ones.
 	 */
 	void update(time_nsec_t lastframe_duration);
 
+	/**
+	 * length of one simulation tick, from the tick rate.
+	 */
+	time_nsec_t get_tick_duration() const;
+
+	/**
+	 * background path searches of this game
+	 */
+	path::PathService *get_path_service();
+
+	/**
+	 * the position the view is centered on. the chunks of infinite
+	 * terrains are kept loaded around it.
+	 */
+	void set_view_focus(coord::phys3 position);
+
+	/**
+	 * the job manager for background tasks of this game, nullptr
+	 * without an engine.
+	 */
+	job::JobManager *get_job_manager();
+
+	/**
+	 * simulates the game in lockstep with other peers: the player
+	 * commands are scheduled in the session, and ticks wait until
+	 * the commands of all players for them are there.
+	 * nullptr dispatches commands right away.
+	 */
+	void set_lockstep(LockstepSession *session);
+
+	/**
+	 * dispatches a player command to its units before the next tick,
+	 * and records it in the replay.
+	 */
+	void dispatch_command(const command_record &record);
+
+	/**
+	 * the number of ticks simulated so far.
+	 */
+	uint64_t get_tick_count() const;
+
+	/**
+	 * records the game in the file, replacing the current recording.
+	 * an empty name stops recording. throws an Error if the file can't
+	 * be created, or ticks were simulated already.
+	 */
+	void record_replay(const std::string &fname, unsigned int checkpoint_interval=100);
+
+	/**
+	 * the settings this game was created with.
+	 */
+	const replay_settings &get_replay_settings() const;
+
+	/**
+	 * the state of the units after the last tick, as arrays.
+	 * they are published after each tick once this was called.
+	 * the first call must be between ticks, on the thread that
+	 * runs them, later ones are thread safe.
+	 */
+	std::shared_ptr<unit_columns> get_unit_columns();
+
+	/**
+	 * checksum of the game state, the same on all peers
+	 * and independent of the number of threads.
+	 */
+	StateHash &get_state_hash();
+
 	/**
 	 * map information
 	 */
@@ -91,7 +181,113 @@ public:
 	 */
 	UnitContainer placed_units;
 
+	/**
+	 * random numbers of the simulation, seeded the same on all peers.
+	 */
+	rng::RNG rng;
+
+	/**
+	 * threat, territory and resources of the players for the AI,
+	 * updated every influence_ticks once read.
+	 */
+	InfluenceMap influence;
+
+	/**
+	 * simulation ticks per second.
+	 */
+	options::Var<int> tick_rate;
+
+	/**
+	 * seconds between autosaves, 0 disables them.
+	 */
+	options::Var<int> autosave_interval;
+
+	/**
+	 * file of the autosaves, see gameio::Autosave.
+	 */
+	options::Var<std::string> autosave_filename;
+
+	/**
+	 * file the game is recorded to from its first command or tick,
+	 * empty records nothing. see ReplayRecorder.
+	 */
+	options::Var<std::string> replay_filename;
+
+	/**
+	 * ticks after which terrain chunks without activity are compressed,
+	 * 0 keeps them. see Terrain::compress_idle_chunks.
+	 */
+	options::Var<int> terrain_idle_ticks;
+
+	/**
+	 * ticks between storing and loading the chunks of an infinite
+	 * terrain by their distance, 0 keeps all of them.
+	 * see ChunkStreamer.
+	 */
+	options::Var<int> terrain_stream_ticks;
+
+	/**
+	 * ticks between updates of the influence maps, 0 stops them.
+	 * the maps of an update are published at the next one.
+	 */
+	options::Var<int> influence_ticks;
+
 private:
+	friend class GameSnapshot;
+
+	/**
+	 * adds the players and connects the parts of the game.
+	 * @param job_manager: updates the units, may be nullptr
+	 */
+	void initialise(const std::vector<std::string> &player_names,
+	                job::JobManager *job_manager);
+
+	/**
+	 * simulate the game for one tick.
+	 */
+	void tick(time_nsec_t tick_duration);
+
+	/**
+	 * stores and loads the terrain chunks by their distance
+	 * to the view and the units.
+	 */
+	void stream_terrain();
+
+	/**
+	 * time passed since the last simulated tick.
+	 */
+	time_nsec_t tick_accumulator;
+
+	/**
+	 * the commands of the players, nullptr if not in lockstep.
+	 */
+	LockstepSession *lockstep;
+
+	uint64_t tick_count;
+
+	/**
+	 * starts recording to replay_filename, once.
+	 */
+	void start_replay();
+
+	/**
+	 * whether replay_filename was used to start recording.
+	 */
+	bool replay_started;
+
+	replay_settings initial_settings;
+
+	/**
+	 * the recording of the game, nullptr if none.
+	 */
+	std::unique_ptr<ReplayRecorder> recorder;
+
+	/**
+	 * publishes the unit state, see get_unit_columns.
+	 */
+	UnitView unit_view;
+
+	gameio::Autosave autosave;
 
 	/**
 	 * creates a random civ, owned and managed by this game
@@ -104,6 +300,12 @@ private:
 	std::vector<std::shared_ptr<Civilisation>> civs;
 
 	std::shared_ptr<GameSpec> spec;
+
+	/**
+	 * runs the path searches of units,
+	 * destroyed first since the searches use the terrain
+	 */
+	std::unique_ptr<path::PathService> path_service;
 };
 
 } // openage
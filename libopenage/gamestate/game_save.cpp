@@ -1,36 +1,412 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "game_save.h"
 
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <vector>
 
+#include <QByteArray>
+
+#include "../error/error.h"
+#include "../job/job_graph.h"
 #include "../log/log.h"
+#include "../terrain/chunk_streamer.h"
 #include "../terrain/terrain_chunk.h"
 #include "../unit/producer.h"
 #include "../unit/unit.h"
 #include "../unit/unit_type.h"
 #include "game_main.h"
-#include "game_save.h"
 #include "game_spec.h"
 
 namespace openage {
 namespace gameio {
 
-void save_unit(std::ofstream &file, Unit *unit) {
-	file << unit->unit_type->id() << std::endl;
-	file << unit->get_attribute<attr_type::owner>().player.player_number << std::endl;
-	coord::tile pos = unit->location->pos.start;
-	file << pos.ne << " " << pos.se << std::endl;
+namespace {
 
-	bool has_building_attr = unit->has_attribute(attr_type::building);
-	file << has_building_attr << std::endl;
-	if (has_building_attr) {
-		file << unit->get_attribute<attr_type::building>().completed << std::endl;
+/**
+ * the kinds of blocks in a binary save file.
+ */
+enum class block_kind : uint8_t {
+	terrain_chunk = 0,
+	units = 1,
+};
+
+
+/**
+ * one block of a binary savefile, compressed with qCompress
+ * unless it's being written.
+ */
+struct stored_block {
+	block_kind kind;
+	uint32_t raw_size;
+	std::string data;
+};
+
+
+/**
+ * the header and blocks of a binary savefile.
+ */
+struct stored_savefile {
+	bool delta;
+	std::string base;
+	std::vector<stored_block> blocks;
+};
+
+
+template<typename T>
+void append(std::string &out, T value) {
+	auto bits = static_cast<uint64_t>(value);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+	}
+}
+
+
+void append_float(std::string &out, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	append(out, bits);
+}
+
+
+/**
+ * reads the little endian values of a block,
+ * throws if the block ends before.
+ */
+class block_reader {
+public:
+	block_reader(const char *data, size_t size)
+		:
+		data{data},
+		size{size},
+		pos{0} {}
+
+	template<typename T>
+	T get() {
+		this->require(sizeof(T));
+
+		uint64_t bits = 0;
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bits |= uint64_t(static_cast<uint8_t>(this->data[this->pos + i])) << (8 * i);
+		}
+		this->pos += sizeof(T);
+		return static_cast<T>(bits);
+	}
+
+	float get_float() {
+		uint32_t bits = this->get<uint32_t>();
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	bool at_end() const {
+		return this->pos == this->size;
+	}
+
+private:
+	void require(size_t length) const {
+		if (this->size - this->pos < length) {
+			throw Error(MSG(err) << "savefile block is truncated");
+		}
+	}
+
+	const char *data;
+	size_t size;
+	size_t pos;
+};
+
+
+/**
+ * reads the given number of bytes, throws if the file ends before.
+ */
+std::string read_bytes(std::istream &file, size_t size, const char *what) {
+	std::string result(size, '\0');
+	file.read(&result[0], size);
+	if (not file) {
+		throw Error(MSG(err) << "savefile ends within " << what);
+	}
+	return result;
+}
+
+
+/**
+ * tile contents of a chunk: position, tile count, terrain id per tile.
+ */
+stored_block encode_terrain(const chunk_index &index, const std::vector<int> &terrain_ids) {
+	std::string out;
+	append<int32_t>(out, index.first);
+	append<int32_t>(out, index.second);
+	append<uint32_t>(out, terrain_ids.size());
+	for (int id : terrain_ids) {
+		append<int32_t>(out, id);
+	}
+	return {block_kind::terrain_chunk, 0, std::move(out)};
+}
+
+
+/**
+ * the units of one chunk: position, count, then type, owner,
+ * tile and building state of each unit.
+ */
+stored_block encode_units(const chunk_index &index, const std::vector<unit_record> &units) {
+	std::string out;
+	append<int32_t>(out, index.first);
+	append<int32_t>(out, index.second);
+	append<uint32_t>(out, units.size());
+	for (auto &unit : units) {
+		append<int32_t>(out, unit.type_id);
+		append<uint32_t>(out, unit.owner);
+		append<int64_t>(out, unit.position.ne);
+		append<int64_t>(out, unit.position.se);
+		append<uint8_t>(out, unit.has_building_attr);
+		if (unit.has_building_attr) {
+			append_float(out, unit.completed);
+		}
+	}
+	return {block_kind::units, 0, std::move(out)};
+}
+
+
+struct decoded_block {
+	block_kind kind;
+	chunk_index index;
+	std::vector<int> terrain_ids;
+	std::vector<unit_record> units;
+};
+
+
+/**
+ * decompresses and parses a block, its stored data is freed.
+ */
+decoded_block decode_block(stored_block &block) {
+	QByteArray raw = qUncompress(reinterpret_cast<const uchar *>(block.data.data()), block.data.size());
+	if (static_cast<size_t>(raw.size()) != block.raw_size) {
+		throw Error(MSG(err) << "savefile block could not be decompressed");
+	}
+	std::string().swap(block.data);
+
+	block_reader in{raw.constData(), static_cast<size_t>(raw.size())};
+
+	decoded_block result;
+	result.kind = block.kind;
+	result.index.first = in.get<int32_t>();
+	result.index.second = in.get<int32_t>();
+
+	uint32_t count = in.get<uint32_t>();
+	if (block.kind == block_kind::terrain_chunk) {
+		if (count != chunk_size * chunk_size) {
+			throw Error(MSG(err) << "savefile chunk has " << count << " tiles");
+		}
+
+		result.terrain_ids.resize(count);
+		for (auto &id : result.terrain_ids) {
+			id = in.get<int32_t>();
+		}
+	}
+	else {
+		result.units.resize(count);
+		for (auto &unit : result.units) {
+			unit.type_id = in.get<int32_t>();
+			unit.owner = in.get<uint32_t>();
+			unit.position.ne = in.get<int64_t>();
+			unit.position.se = in.get<int64_t>();
+			unit.has_building_attr = in.get<uint8_t>();
+			unit.completed = unit.has_building_attr ? in.get_float() : 0.0f;
+		}
+	}
+
+	if (not in.at_end()) {
+		throw Error(MSG(err) << "savefile block has trailing data");
+	}
+	return result;
+}
+
+
+void apply_terrain(openage::GameMain *game, const chunk_index &index, const std::vector<int> &terrain_ids) {
+	coord::chunk position{index.first, index.second};
+	TerrainChunk *target = game->terrain->get_create_chunk(position);
+	for (size_t p = 0; p < terrain_ids.size(); ++p) {
+		target->get_data(p)->terrain_id = terrain_ids[p];
 	}
+	game->terrain->invalidate_chunk(position);
 }
 
-void load_unit(std::ifstream &file, openage::GameMain *game) {
+
+void place_unit(openage::GameMain *game, const unit_record &unit) {
+	Player *owner = game->get_player(unit.owner);
+	UnitType *saved_type = owner ? owner->get_type(unit.type_id) : nullptr;
+	if (saved_type == nullptr) {
+		log::log(MSG(warn) << "savefile contains unknown unit type " << unit.type_id
+		         << " of player " << unit.owner);
+		return;
+	}
+
+	auto ref = game->placed_units.new_unit(*saved_type, *owner, unit.position.to_phys2().to_phys3());
+	if (unit.has_building_attr and unit.completed >= 1.0f and ref.is_valid()) {
+		complete_building(*ref.get());
+	}
+}
+
+
+/**
+ * reads the header and the compressed blocks, which are small,
+ * after the magic.
+ */
+stored_savefile read_blocks(std::istream &file) {
+	std::string header_data = read_bytes(file, 4 + 1, "the header");
+	block_reader header{header_data.data(), header_data.size()};
+	uint32_t version = header.get<uint32_t>();
+	if (version != save_format_version) {
+		throw Error(MSG(err) << "savefile has the unsupported format version " << version);
+	}
+
+	stored_savefile result;
+	result.delta = header.get<uint8_t>();
+	if (result.delta) {
+		std::string length = read_bytes(file, 4, "the header");
+		result.base = read_bytes(file, block_reader{length.data(), 4}.get<uint32_t>(), "the header");
+	}
+
+	std::string count = read_bytes(file, 4, "the header");
+	result.blocks.resize(block_reader{count.data(), 4}.get<uint32_t>());
+
+	for (auto &block : result.blocks) {
+		std::string block_header = read_bytes(file, 1 + 4 + 4, "a block");
+		block_reader in{block_header.data(), block_header.size()};
+
+		uint8_t kind = in.get<uint8_t>();
+		if (kind > static_cast<uint8_t>(block_kind::units)) {
+			throw Error(MSG(err) << "savefile block has the unknown kind " << int(kind));
+		}
+		block.kind = static_cast<block_kind>(kind);
+		block.raw_size = in.get<uint32_t>();
+		block.data = read_bytes(file, in.get<uint32_t>(), "a block");
+	}
+
+	return result;
+}
+
+
+/**
+ * a block of a delta replaces the chunk's terrain or units.
+ */
+void overlay(save_snapshot &snapshot, decoded_block &block) {
+	if (block.kind == block_kind::terrain_chunk) {
+		snapshot.terrain[block.index] = std::move(block.terrain_ids);
+	}
+	else if (block.units.empty()) {
+		snapshot.units.erase(block.index);
+	}
+	else {
+		snapshot.units[block.index] = std::move(block.units);
+	}
+}
+
+
+/**
+ * decodes all blocks of the savefile in parallel, applied to its base.
+ */
+save_snapshot read_snapshot(const std::string &fname, job::JobManager *job_manager, int depth=0) {
+	if (depth > 8) {
+		throw Error(MSG(err) << "savefile " << fname << " is based on too many deltas");
+	}
+
+	std::ifstream file(fname, std::ifstream::in | std::ifstream::binary);
+	if (not file) {
+		throw Error(MSG(err) << "could not open the base savefile " << fname);
+	}
+	std::string magic = read_bytes(file, 4, fname.c_str());
+	if (magic != save_magic) {
+		throw Error(MSG(err) << fname << " is not a binary savefile");
+	}
+	stored_savefile stored = read_blocks(file);
+
+	save_snapshot result;
+	if (stored.delta) {
+		result = read_snapshot(stored.base, job_manager, depth + 1);
+	}
+
+	std::vector<decoded_block> decoded(stored.blocks.size());
+	job::JobGraph graph{job_manager};
+	for (size_t i = 0; i < stored.blocks.size(); i++) {
+		graph.add([&, i] {
+			decoded[i] = decode_block(stored.blocks[i]);
+		});
+	}
+	graph.run();
+
+	for (auto &block : decoded) {
+		overlay(result, block);
+	}
+	return result;
+}
+
+
+void apply_snapshot(openage::GameMain *game, const save_snapshot &snapshot) {
+	for (auto &chunk : snapshot.terrain) {
+		apply_terrain(game, chunk.first, chunk.second);
+	}
+
+	game->placed_units.reset();
+	for (auto &chunk : snapshot.units) {
+		for (auto &unit : chunk.second) {
+			place_unit(game, unit);
+		}
+	}
+}
+
+
+/**
+ * compresses the blocks in parallel and writes them.
+ */
+void write_blocks(stored_savefile &stored, const std::string &fname, job::JobManager *job_manager) {
+	job::JobGraph graph{job_manager};
+	for (auto &block : stored.blocks) {
+		graph.add([&block] {
+			block.raw_size = block.data.size();
+			QByteArray compressed = qCompress(reinterpret_cast<const uchar *>(block.data.data()),
+			                                  block.data.size());
+			block.data.assign(compressed.constData(), compressed.size());
+		});
+	}
+	graph.run();
+
+	std::string header;
+	header.append(save_magic, 4);
+	append<uint32_t>(header, save_format_version);
+	append<uint8_t>(header, stored.delta);
+	if (stored.delta) {
+		append<uint32_t>(header, stored.base.size());
+		header.append(stored.base);
+	}
+	append<uint32_t>(header, stored.blocks.size());
+
+	std::ofstream file(fname, std::ofstream::out | std::ofstream::binary);
+	file.write(header.data(), header.size());
+
+	for (auto &block : stored.blocks) {
+		std::string block_header;
+		append<uint8_t>(block_header, static_cast<uint8_t>(block.kind));
+		append<uint32_t>(block_header, block.raw_size);
+		append<uint32_t>(block_header, block.data.size());
+
+		file.write(block_header.data(), block_header.size());
+		file.write(block.data.data(), block.data.size());
+	}
+
+	file.close();
+	if (not file) {
+		throw Error(MSG(err) << "could not write savefile " << fname);
+	}
+}
+
+
+// the text format of v0.1, only loaded
+
+void load_unit(std::istream &file, openage::GameMain *game) {
 	int pr_id;
 	int player_no;
 	coord::phys_t ne, se;
@@ -53,12 +429,7 @@ void load_unit(std::ifstream &file, openage::GameMain *game) {
 	}
 }
 
-void save_tile_content(std::ofstream &file, openage::TileContent *content) {
-	file << content->terrain_id << std::endl;
-	file << content->obj.size() << std::endl;
-}
-
-TileContent load_tile_content(std::ifstream &file) {
+TileContent load_tile_content(std::istream &file) {
 	openage::TileContent content;
 	file >> content.terrain_id;
 
@@ -67,53 +438,7 @@ TileContent load_tile_content(std::ifstream &file) {
 	return content;
 }
 
-void save(openage::GameMain *game, std::string fname) {
-	std::ofstream file(fname, std::ofstream::out);
-	log::log(MSG(dbg) << "saving " + fname);
-
-	// metadata
-	file << save_label << std::endl;
-	file << save_version << std::endl;
-	file << config::version << std::endl;
-
-	// how many chunks
-	std::vector<coord::chunk> used = game->terrain->used_chunks();
-	file << used.size() << std::endl;
-
-	// save each chunk
-	for (coord::chunk &position : used) {
-		file << position.ne << " " << position.se << std::endl;
-		openage::TerrainChunk *chunk = game->terrain->get_chunk(position);
-
-		file << chunk->tile_count << std::endl;
-		for (size_t p = 0; p < chunk->tile_count; ++p) {
-			save_tile_content( file, chunk->get_data(p) );
-		}
-	}
-
-	// save units
-	std::vector<openage::Unit *> units = game->placed_units.all_units();
-	file << units.size() << std::endl;
-	for (Unit *u : units) {
-		save_unit(file, u);
-	}
-}
-
-void load(openage::GameMain *game, std::string fname) {
-	std::ifstream file(fname, std::ifstream::in);
-	if (!file.good()) {
-		log::log(MSG(dbg) << "could not find " + fname);
-		return;
-	}
-	log::log(MSG(dbg) << "loading " + fname);
-
-	// load metadata
-	std::string file_label;
-	file >> file_label;
-	if (file_label != save_label) {
-		log::log(MSG(warn) << fname << " is not a savefile");
-		return;
-	}
+void load_text(openage::GameMain *game, std::istream &file) {
 	std::string version;
 	file >> version;
 	if (version != save_version) {
@@ -135,6 +460,7 @@ void load(openage::GameMain *game, std::string fname) {
 		for (size_t p = 0; p < tile_count; ++p) {
 			*chunk->get_data(p) = load_tile_content( file );
 		}
+		game->terrain->invalidate_chunk(coord::chunk{ne, se});
 	}
 
 	game->placed_units.reset();
@@ -145,4 +471,215 @@ void load(openage::GameMain *game, std::string fname) {
 	}
 }
 
+
+/**
+ * decompresses and decodes the blocks of a binary savefile in parallel
+ * and applies them in their order as soon as they are decoded.
+ * a delta is applied to the snapshot of its base file instead.
+ */
+void load_binary(openage::GameMain *game, std::istream &file) {
+	stored_savefile stored = read_blocks(file);
+	job::JobManager *job_manager = game->get_job_manager();
+
+	if (stored.delta) {
+		save_snapshot snapshot = read_snapshot(stored.base, job_manager);
+
+		std::vector<decoded_block> decoded(stored.blocks.size());
+		job::JobGraph graph{job_manager};
+		for (size_t i = 0; i < stored.blocks.size(); i++) {
+			graph.add([&, i] {
+				decoded[i] = decode_block(stored.blocks[i]);
+			});
+		}
+		graph.run();
+
+		for (auto &block : decoded) {
+			overlay(snapshot, block);
+		}
+		apply_snapshot(game, snapshot);
+		return;
+	}
+
+	game->placed_units.reset();
+
+	// the terrain and units are not thread safe, so the blocks are
+	// applied one after another, each after the previous one.
+	// all chunks come before the units, which are placed on them.
+	std::vector<decoded_block> decoded(stored.blocks.size());
+	job::JobGraph graph{job_manager};
+	std::vector<job::JobGraph::task_id> previous;
+
+	for (size_t i = 0; i < stored.blocks.size(); i++) {
+		auto decode = graph.add([&, i] {
+			decoded[i] = decode_block(stored.blocks[i]);
+		});
+
+		std::vector<job::JobGraph::task_id> dependencies = previous;
+		dependencies.push_back(decode);
+
+		auto apply = graph.add([&, i] {
+			decoded_block &block = decoded[i];
+			if (block.kind == block_kind::terrain_chunk) {
+				apply_terrain(game, block.index, block.terrain_ids);
+			}
+			else {
+				for (auto &unit : block.units) {
+					place_unit(game, unit);
+				}
+			}
+			block = {};
+		}, dependencies);
+
+		previous = {apply};
+	}
+
+	graph.run();
+}
+
+} // anonymous namespace
+
+
+bool unit_record::operator ==(const unit_record &other) const {
+	return (this->type_id == other.type_id and
+	        this->owner == other.owner and
+	        this->position == other.position and
+	        this->has_building_attr == other.has_building_attr and
+	        this->completed == other.completed);
+}
+
+
+save_snapshot take_snapshot(openage::GameMain *game) {
+	save_snapshot snapshot;
+
+	for (coord::chunk &position : game->terrain->used_chunks()) {
+		TerrainChunk *chunk = game->terrain->get_chunk(position);
+
+		std::vector<int> &terrain_ids = snapshot.terrain[{position.ne, position.se}];
+		terrain_ids.resize(chunk->tile_count);
+		for (size_t p = 0; p < chunk->tile_count; ++p) {
+			terrain_ids[p] = chunk->get_terrain_id(p);
+		}
+	}
+
+	// the chunks that are stored because they are far away
+	ChunkStreamer *streamer = game->terrain->get_streamer();
+	if (streamer != nullptr) {
+		for (coord::chunk &position : streamer->stored_chunks()) {
+			snapshot.terrain[{position.ne, position.se}] = streamer->get_stored_ids(position);
+		}
+	}
+
+	for (Unit *unit : game->placed_units.all_units()) {
+		if (not unit->location) {
+			continue;
+		}
+
+		unit_record record;
+		record.type_id = unit->unit_type->id();
+		record.owner = unit->get_attribute<attr_type::owner>().player.player_number;
+		record.position = unit->location->pos.start;
+		record.has_building_attr = unit->has_attribute(attr_type::building);
+		record.completed = record.has_building_attr ? unit->get_attribute<attr_type::building>().completed : 0.0f;
+
+		coord::chunk position = record.position.to_chunk();
+		snapshot.units[{position.ne, position.se}].push_back(record);
+	}
+
+	return snapshot;
+}
+
+
+void write_snapshot(const save_snapshot &snapshot, const std::string &fname,
+                    job::JobManager *job_manager) {
+	stored_savefile stored;
+	stored.delta = false;
+
+	for (auto &chunk : snapshot.terrain) {
+		stored.blocks.push_back(encode_terrain(chunk.first, chunk.second));
+	}
+	for (auto &chunk : snapshot.units) {
+		stored.blocks.push_back(encode_units(chunk.first, chunk.second));
+	}
+
+	write_blocks(stored, fname, job_manager);
+}
+
+
+void write_delta(const save_snapshot &snapshot, const save_snapshot &base,
+                 const std::string &base_fname, const std::string &fname,
+                 job::JobManager *job_manager) {
+	stored_savefile stored;
+	stored.delta = true;
+	stored.base = base_fname;
+
+	// chunks are never removed
+	for (auto &chunk : snapshot.terrain) {
+		auto it = base.terrain.find(chunk.first);
+		if (it == base.terrain.end() or it->second != chunk.second) {
+			stored.blocks.push_back(encode_terrain(chunk.first, chunk.second));
+		}
+	}
+
+	for (auto &chunk : snapshot.units) {
+		auto it = base.units.find(chunk.first);
+		if (it == base.units.end() or it->second != chunk.second) {
+			stored.blocks.push_back(encode_units(chunk.first, chunk.second));
+		}
+	}
+
+	// the units of these chunks are gone
+	for (auto &chunk : base.units) {
+		if (snapshot.units.find(chunk.first) == snapshot.units.end()) {
+			stored.blocks.push_back(encode_units(chunk.first, {}));
+		}
+	}
+
+	write_blocks(stored, fname, job_manager);
+}
+
+
+void save(openage::GameMain *game, std::string fname) {
+	log::log(MSG(dbg) << "saving " + fname);
+
+	try {
+		write_snapshot(take_snapshot(game), fname, game->get_job_manager());
+	}
+	catch (Error &exc) {
+		log::log(MSG(err) << exc.msg.text);
+	}
+}
+
+void load(openage::GameMain *game, std::string fname) {
+	std::ifstream file(fname, std::ifstream::in | std::ifstream::binary);
+	if (!file.good()) {
+		log::log(MSG(dbg) << "could not find " + fname);
+		return;
+	}
+	log::log(MSG(dbg) << "loading " + fname);
+
+	char magic[4] = {};
+	file.read(magic, sizeof(magic));
+	if (file and memcmp(magic, save_magic, sizeof(magic)) == 0) {
+		try {
+			load_binary(game, file);
+		}
+		catch (Error &exc) {
+			log::log(MSG(warn) << "could not load " << fname << ": " << exc.msg.text);
+		}
+		return;
+	}
+
+	// saves of the text format start with the label
+	file.clear();
+	file.seekg(0);
+	std::string file_label;
+	file >> file_label;
+	if (file_label != save_label) {
+		log::log(MSG(warn) << fname << " is not a savefile");
+		return;
+	}
+
+	load_text(game, file);
+}
+
 }} // openage::gameio
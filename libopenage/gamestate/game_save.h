@@ -1,26 +1,110 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/tile.h"
 
 namespace openage {
 
 class GameMain;
 class Terrain;
 
+namespace job {
+class JobManager;
+} // namespace job
+
 namespace gameio {
 
+/**
+ * label and version of the text savefiles, which can still be loaded.
+ */
 const std::string save_label = "openage-save-file";
 const std::string save_version = "v0.1";
 
 /**
- * a game save function that sometimes works
+ * binary savefiles start with the magic and the format version,
+ * whether the file is a delta and if so the name of its base file,
+ * followed by the number of blocks. each block has a kind, its
+ * uncompressed size and its compressed size, followed by the data
+ * compressed with qCompress. the terrain chunks are stored in a block
+ * each, followed by the units, in a block per terrain chunk.
+ * all values are little endian.
+ *
+ * a delta contains the blocks that differ from its base file,
+ * a units block without units removes the units of its chunk.
+ */
+constexpr const char *save_magic = "OASV";
+constexpr uint32_t save_format_version = 2;
+
+
+/**
+ * the saved state of a unit.
+ */
+struct unit_record {
+	int type_id;
+	unsigned int owner;
+	coord::tile position;
+	bool has_building_attr;
+	float completed;
+
+	bool operator ==(const unit_record &other) const;
+};
+
+
+/**
+ * identifies a chunk of the snapshot.
+ */
+using chunk_index = std::pair<coord::chunk_t, coord::chunk_t>;
+
+
+/**
+ * A copy of the saved state of a game, which can be written while
+ * the game goes on. Units are grouped by the chunk they stand on.
+ */
+struct save_snapshot {
+	std::map<chunk_index, std::vector<int>> terrain;
+	std::map<chunk_index, std::vector<unit_record>> units;
+};
+
+
+/**
+ * copies the saved state of the game.
+ * must be called between ticks, on the thread that runs them.
+ */
+save_snapshot take_snapshot(openage::GameMain *game);
+
+/**
+ * writes a snapshot as binary savefile, throws if that fails.
+ * the blocks are compressed in parallel by the job manager, if any.
+ */
+void write_snapshot(const save_snapshot &snapshot, const std::string &fname,
+                    job::JobManager *job_manager);
+
+/**
+ * writes the chunks and units of the snapshot that differ from the
+ * base snapshot, which was saved as base_fname.
+ */
+void write_delta(const save_snapshot &snapshot, const save_snapshot &base,
+                 const std::string &base_fname, const std::string &fname,
+                 job::JobManager *job_manager);
+
+/**
+ * writes the game as binary savefile.
  */
 void save(openage::GameMain *, std::string fname);
 
 /**
- * a game load function that sometimes works
+ * loads a binary or text savefile into the game.
+ * the blocks of a binary savefile are decompressed in parallel by the
+ * game's job manager, and applied in order as soon as they are decoded.
+ * a delta is applied to its base file.
  */
 void load(openage::GameMain *, std::string fname);
 
@@ -2,18 +2,23 @@
 
 #include "game_spec.h"
 
+#include <algorithm>
 #include <tuple>
+#include <utility>
 
 #include "../assetmanager.h"
 #include "../engine.h"
 #include "../gamedata/blending_mode.gen.h"
+#include "../gamedata/color.gen.h"
 #include "../gamedata/string_resource.gen.h"
 #include "../gamedata/terrain.gen.h"
+#include "../job/parallel.h"
 #include "../log/log.h"
 #include "../rng/global_rng.h"
 #include "../unit/producer.h"
 #include "../util/strings.h"
 #include "../util/timer.h"
+#include "../util/trace.h"
 #include "civilisation.h"
 
 
@@ -32,20 +37,103 @@ GameSpec::GameSpec(AssetManager *am)
 
 GameSpec::~GameSpec() {}
 
-bool GameSpec::initialize() {
+namespace {
+
+/**
+ * number of unit textures each prefetching job loads.
+ */
+constexpr size_t prefetch_grain = 8;
+
+/**
+ * store a value in a table indexed by id, which grows as needed.
+ * negative ids are ignored.
+ */
+template <typename T>
+void set_entry(std::vector<T> &table, index_t id, typename std::vector<T>::value_type value) {
+	if (id < 0) {
+		return;
+	}
+	if (table.size() <= static_cast<size_t>(id)) {
+		table.resize(id + 1);
+	}
+	table[id] = std::move(value);
+}
+
+/**
+ * the entry of an id in a table, nullptr if the id is outside of it.
+ */
+template <typename T>
+const T *find_entry(const std::vector<T> &table, index_t id) {
+	if (id < 0 or static_cast<size_t>(id) >= table.size()) {
+		return nullptr;
+	}
+	return &table[id];
+}
+
+} // anonymous namespace
+
+
+bool GameSpec::initialize(const job::JobGraph::progress_function_t &progress) {
 	util::Timer load_timer;
 	load_timer.start();
 
 	util::Dir gamedata_dir = this->assetmanager->get_data_dir()->append(this->data_path);
+	util::Dir sound_dir = this->assetmanager->get_data_dir()->append(this->sound_path);
 
-	util::csv_file_map_t *meta_file_map = load_multi_csv_file(gamedata_dir, "gamedata.docx");
+	job::JobManager *job_manager = this->assetmanager->get_job_manager();
 
-	this->load_terrain(*this->assetmanager, meta_file_map);
+	// state passed between the loading steps
+	std::unique_ptr<util::data_file_map> meta_file_map;
+	std::vector<gamedata::sound_file> sound_files;
 
-	log::log(MSG(info) << "Loading game specification files...");
-	this->gamedata = util::recurse_data_files<gamedata::empiresdat>(gamedata_dir, "gamedata-empiresdat.docx", meta_file_map);
+	// the steps run as soon as the steps they need are done
+	job::JobGraph graph{job_manager, job::job_priority::low};
+
+	// the converted binary data is copied into the structs,
+	// the csv files are parsed if there is none
+	auto data_files = graph.add([&] {
+		TRACE_SCOPE("spec data files");
+		meta_file_map = util::load_data_files(gamedata_dir, "gamedata");
+	});
+
+	graph.add([&] {
+		TRACE_SCOPE("spec terrain");
+		this->load_terrain(*this->assetmanager, meta_file_map.get());
+	}, {data_files});
+
+	auto parse = graph.add([&] {
+		TRACE_SCOPE("spec parse");
+		log::log(MSG(info) << "Loading game specification files...");
+		this->gamedata = util::recurse_data_files<gamedata::empiresdat>(gamedata_dir, "gamedata-empiresdat.docx", meta_file_map.get());
+	}, {data_files});
+
+	// the unit textures are only loaded when they are used
+	graph.add([&] {
+		TRACE_SCOPE("spec graphics");
+		this->index_graphics(this->gamedata);
+	}, {parse});
+
+	graph.add([&] {
+		TRACE_SCOPE("spec abilities");
+		this->create_abilities(this->gamedata);
+	}, {parse});
+
+	auto sounds = graph.add([&] {
+		TRACE_SCOPE("spec sounds");
+		this->register_sounds(this->gamedata, sound_files);
+	}, {parse});
+
+	// TODO: move out the loading of the sound.
+	//       this class only provides the names and locations
+	// without engine (headless), there is no audio
+	graph.add([&] {
+		if (engine != nullptr) {
+			audio::AudioManager &am = engine->get_audio_manager();
+			am.load_resources(sound_dir, sound_files);
+		}
+	}, {sounds});
 
-	this->on_gamedata_loaded(this->gamedata);
+	graph.run(progress);
 	this->gamedata_loaded = true;
 
 	log::log(MSG(info).fmt("Loading time  [data]: %5.3f s",
@@ -62,16 +150,18 @@ terrain_meta *GameSpec::get_terrain_meta() {
 }
 
 index_t GameSpec::get_slp_graphic(index_t slp) {
-	return this->slp_to_graphic[slp];
+	const index_t *graphic_id = find_entry(this->slp_to_graphic, slp);
+	return graphic_id ? *graphic_id : 0;
 }
 
 Texture *GameSpec::get_texture(index_t graphic_id) const {
-	if (graphic_id <= 0 || this->graphics.count(graphic_id) == 0) {
+	const gamedata::graphic *const *entry = find_entry(this->graphics, graphic_id);
+	const gamedata::graphic *g = entry ? *entry : nullptr;
+	if (graphic_id <= 0 || g == nullptr) {
 		log::log(MSG(dbg) << "  -> ignoring graphics_id: " << graphic_id);
 		return nullptr;
 	}
 
-	auto g = this->graphics.at(graphic_id);
 	int slp_id = g->slp_id;
 	if (slp_id <= 0) {
 		log::log(MSG(dbg) << "  -> ignoring slp_id: " << slp_id);
@@ -85,6 +175,9 @@ Texture *GameSpec::get_texture(index_t graphic_id) const {
 	Texture *tex = nullptr;
 	if (this->assetmanager->can_load(tex_fname)) {
 		tex = this->assetmanager->get_texture(tex_fname);
+
+		// unit sprites have few colors
+		tex->allow_palette();
 	}
 	return tex;
 }
@@ -98,43 +191,66 @@ Texture *GameSpec::get_texture(std::string file_name, bool use_metafile) const {
 }
 
 std::shared_ptr<UnitTexture> GameSpec::get_unit_texture(index_t unit_id) const {
-	if (this->unit_textures.count(unit_id) == 0) {
+	const gamedata::graphic *const *graphic = find_entry(this->graphics, unit_id);
+	if (graphic == nullptr or *graphic == nullptr) {
 		if (unit_id > 0) {
 			log::log(MSG(dbg) << "  -> ignoring unit_id: " << unit_id);
 		}
 		return nullptr;
 	}
-	return this->unit_textures.at(unit_id);
+
+	{
+		std::lock_guard<std::mutex> lock{this->texture_mutex};
+		const std::shared_ptr<UnitTexture> &unit_texture = this->unit_textures[unit_id];
+		if (unit_texture) {
+			return unit_texture;
+		}
+	}
+
+	// loading the textures takes long, other graphics
+	// can be looked up meanwhile
+	auto unit_texture = std::make_shared<UnitTexture>(*this, *graphic);
+
+	std::lock_guard<std::mutex> lock{this->texture_mutex};
+
+	// another thread may have loaded the same graphic meanwhile
+	std::shared_ptr<UnitTexture> &entry = this->unit_textures[unit_id];
+	if (not entry) {
+		entry = std::move(unit_texture);
+	}
+	return entry;
 }
 
 const Sound *GameSpec::get_sound(index_t sound_id) const {
-	if (this->available_sounds.count(sound_id) == 0) {
+	const std::unique_ptr<Sound> *sound = find_entry(this->available_sounds, sound_id);
+	if (sound == nullptr or not *sound) {
 		if (sound_id > 0) {
 			log::log(MSG(dbg) << "  -> ignoring sound_id: " << sound_id);
 		}
 		return nullptr;
 	}
-	return &this->available_sounds.at(sound_id);
+	return sound->get();
 }
 
 
 const gamedata::graphic *GameSpec::get_graphic_data(index_t grp_id) const {
-	if (this->graphics.count(grp_id) == 0) {
+	const gamedata::graphic *const *graphic = find_entry(this->graphics, grp_id);
+	if (graphic == nullptr or *graphic == nullptr) {
 		log::log(MSG(dbg) << "  -> ignoring grp_id: " << grp_id);
 		return nullptr;
 	}
-	return this->graphics.at(grp_id);
+	return *graphic;
 }
 
-std::vector<const gamedata::unit_command *> GameSpec::get_command_data(index_t unit_id) const {
-	if (this->commands.count(unit_id) == 0) {
-		return std::vector<const gamedata::unit_command *>(); // empty vector
-	}
-	return this->commands.at(unit_id);
+const std::vector<const gamedata::unit_command *> &GameSpec::get_command_data(index_t unit_id) const {
+	static const std::vector<const gamedata::unit_command *> no_commands;
+
+	const std::vector<const gamedata::unit_command *> *list = find_entry(this->commands, unit_id);
+	return list ? *list : no_commands;
 }
 
 std::string GameSpec::get_civ_name(int civ_id) const {
-	return gamedata[0].civs.data[civ_id].name;
+	return gamedata[0].civs.data[civ_id].name.to_string();
 }
 
 void GameSpec::create_unit_types(unit_meta_list &objects, int civ_id) const {
@@ -169,25 +285,105 @@ void GameSpec::create_unit_types(unit_meta_list &objects, int civ_id) const {
 }
 
 
+std::shared_ptr<Civilisation> GameSpec::get_civilisation(int civ_id) const {
+	// without the game data, the civilisation has no unit types yet
+	if (not this->load_complete()) {
+		return std::make_shared<Civilisation>(*this, civ_id);
+	}
+
+	std::shared_ptr<Civilisation> civ;
+	bool created = false;
+	{
+		std::lock_guard<std::mutex> lock{this->cache_mutex};
+
+		auto it = this->civilisations.find(civ_id);
+		if (it == this->civilisations.end()) {
+			it = this->civilisations.emplace(civ_id, std::make_shared<Civilisation>(*this, civ_id)).first;
+			created = true;
+		}
+		civ = it->second;
+	}
+
+	// the players create the types of all units of their civ,
+	// which then find their graphics loaded
+	if (created and not this->assetmanager->is_headless()) {
+		this->prefetch_unit_textures(civ_id);
+	}
+	return civ;
+}
+
+
 AssetManager *GameSpec::get_asset_manager() const {
 	return this->assetmanager;
 }
 
 
-void GameSpec::on_gamedata_loaded(std::vector<gamedata::empiresdat> &gamedata) {
-	util::Dir *data_dir = this->assetmanager->get_data_dir();
-	util::Dir sound_dir = data_dir->append(this->sound_path);
+void GameSpec::prefetch_unit_textures(int civ_id) const {
+	auto &units = gamedata[0].civs.data[civ_id].units;
+	std::vector<index_t> graphic_ids;
+
+	auto add_object = [&graphic_ids](const gamedata::unit_object &unit) {
+		graphic_ids.push_back(unit.graphic_standing0);
+		graphic_ids.push_back(unit.graphic_dying0);
+	};
+	auto add_living = [&graphic_ids, &add_object](const gamedata::unit_living &unit) {
+		add_object(unit);
+		graphic_ids.push_back(unit.walking_graphics0);
+		graphic_ids.push_back(unit.attack_graphic);
+	};
+
+	for (auto &obj : units.projectile.data) {
+		add_object(obj);
+	}
+	for (auto &obj : units.object.data) {
+		add_object(obj);
+	}
+	for (auto &unit : units.dead_or_fish.data) {
+		add_object(unit);
+	}
+	for (auto &unit : units.living.data) {
+		add_living(unit);
+	}
+	for (auto &building : units.building.data) {
+		add_living(building);
+		graphic_ids.push_back(building.construction_graphic_id);
+	}
+
+	// many units share their graphics
+	std::sort(graphic_ids.begin(), graphic_ids.end());
+	graphic_ids.erase(std::unique(graphic_ids.begin(), graphic_ids.end()), graphic_ids.end());
+	graphic_ids.erase(
+		std::remove_if(graphic_ids.begin(), graphic_ids.end(),
+			[this](index_t id) { return not this->valid_graphic_id(id); }),
+		graphic_ids.end());
+
+	Engine *engine = this->assetmanager->get_engine();
+	job::JobManager *io_jobs = engine ? engine->get_job_manager(job_pool::io) : nullptr;
+
+	job::parallel_for(io_jobs, 0, graphic_ids.size(), prefetch_grain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			this->get_unit_texture(graphic_ids[i]);
+		}
+	});
 
+	log::log(MSG(dbg) << "Loaded " << graphic_ids.size() << " graphics of civ " << civ_id);
+}
+
+void GameSpec::index_graphics(std::vector<gamedata::empiresdat> &gamedata) {
 	// create graphic id => graphic map
 	for (auto &graphic : gamedata[0].graphics.data) {
-		this->graphics[graphic.id] = &graphic;
-		this->slp_to_graphic[graphic.slp_id] = graphic.id;
+		set_entry(this->graphics, graphic.id, &graphic);
+		set_entry(this->slp_to_graphic, graphic.slp_id, graphic.id);
 	}
 
-	// create complete set of unit textures
-	for (auto &g : this->graphics) {
-		this->unit_textures.insert({g.first, std::make_shared<UnitTexture>(*this, g.second)});
-	}
+	// the unit textures are created when used
+	this->unit_textures.resize(this->graphics.size());
+}
+
+void GameSpec::register_sounds(std::vector<gamedata::empiresdat> &gamedata,
+                               std::vector<gamedata::sound_file> &sound_files) {
+	util::Dir *data_dir = this->assetmanager->get_data_dir();
+	util::Dir sound_dir = data_dir->append(this->sound_path);
 
 	auto get_sound_file_location = [sound_dir](int32_t resource_id) -> std::string {
 		std::string snd_filename = util::sformat("/%d.opus", resource_id);
@@ -199,13 +395,19 @@ void GameSpec::on_gamedata_loaded(std::vector<gamedata::empiresdat> &gamedata) {
 		return "";
 	};
 
-	// playable sound files for the audio manager
-	std::vector<gamedata::sound_file> sound_files;
+	// without audio, the sounds are known but stay silent
+	bool headless = this->assetmanager->is_headless();
 
 	// all sounds defined in the game specification
 	for (gamedata::sound &sound : gamedata[0].sounds.data) {
 		std::vector<int> sound_items;
 
+		if (headless) {
+			set_entry(this->available_sounds, sound.id,
+			          std::make_unique<Sound>(this, std::move(sound_items)));
+			continue;
+		}
+
 		// each sound may have multiple variation,
 		// processed in this loop
 		// these are the single sound files.
@@ -232,32 +434,17 @@ void GameSpec::on_gamedata_loaded(std::vector<gamedata::empiresdat> &gamedata) {
 
 
 		// create test sound objects that can be played later
-		this->available_sounds.insert({
-			sound.id,
-			Sound{
-				this,
-				std::move(sound_items)
-			}
-		});
+		set_entry(this->available_sounds, sound.id,
+		          std::make_unique<Sound>(this, std::move(sound_items)));
 	}
-
-	// TODO: move out the loading of the sound.
-	//       this class only provides the names and locations
-
-	// load the requested sounds.
-	audio::AudioManager &am = this->assetmanager->get_engine()->get_audio_manager();
-	am.load_resources(sound_dir, sound_files);
-
-	// this final step occurs after loading media
-	// as producers require both the graphics and sounds
-	this->create_abilities(gamedata);
 }
 
 bool GameSpec::valid_graphic_id(index_t graphic_id) const {
-	if (graphic_id <= 0 || this->graphics.count(graphic_id) == 0) {
+	const gamedata::graphic *const *graphic = find_entry(this->graphics, graphic_id);
+	if (graphic_id <= 0 || graphic == nullptr || *graphic == nullptr) {
 		return false;
 	}
-	if (this->graphics.at(graphic_id)->slp_id <= 0) {
+	if ((*graphic)->slp_id <= 0) {
 		return false;
 	}
 	return true;
@@ -309,7 +496,7 @@ void GameSpec::load_projectile(const gamedata::unit_projectile &proj, unit_meta_
 	}
 }
 
-void GameSpec::load_terrain(AssetManager &am, util::csv_file_map_t *file_map) {
+void GameSpec::load_terrain(AssetManager &am, util::data_file_map *file_map) {
 
 	// Terrain data files
 	util::Dir *data_dir = am.get_data_dir();
@@ -320,6 +507,8 @@ void GameSpec::load_terrain(AssetManager &am, util::csv_file_map_t *file_map) {
 	util::read_csv_file(asset_dir.join("gamedata/gamedata-empiresdat/0000-terrains.docx"), terrain_meta, file_map);
 	std::vector<gamedata::blending_mode> blending_meta;
 	util::read_csv_file(asset_dir.join("blending_modes.docx"), blending_meta);
+	std::vector<gamedata::palette_color> palette;
+	util::read_csv_file(asset_dir.join("palette.docx"), palette);
 
 	// remove any disabled textures
 	terrain_meta.erase(
@@ -331,10 +520,10 @@ void GameSpec::load_terrain(AssetManager &am, util::csv_file_map_t *file_map) {
 	terrain_data.terrain_id_count         = terrain_meta.size();
 	terrain_data.blendmode_count          = blending_meta.size();
 	terrain_data.textures.resize(terrain_data.terrain_id_count);
-	terrain_data.blending_masks.reserve(terrain_data.blendmode_count);
+	terrain_data.blending_masks.resize(terrain_data.blendmode_count);
 	terrain_data.terrain_id_priority_map  = std::make_unique<int[]>(terrain_data.terrain_id_count);
 	terrain_data.terrain_id_blendmode_map = std::make_unique<int[]>(terrain_data.terrain_id_count);
-	terrain_data.influences_buf           = std::make_unique<struct influence[]>(terrain_data.terrain_id_count);
+	terrain_data.map_colors.resize(terrain_data.terrain_id_count, 0xff000000);
 
 
 	log::log(MSG(dbg) << "Terrain prefs: " <<
@@ -352,6 +541,11 @@ void GameSpec::load_terrain(AssetManager &am, util::csv_file_map_t *file_map) {
 		terrain_data.terrain_id_priority_map[terrain_id]  = line->blend_priority;
 		terrain_data.terrain_id_blendmode_map[terrain_id] = line->blend_mode;
 
+		if (line->map_color_hi < palette.size()) {
+			const gamedata::palette_color &color = palette[line->map_color_hi];
+			terrain_data.map_colors[terrain_id] = (0xffu << 24) | (color.b << 16) | (color.g << 8) | color.r;
+		}
+
 		// TODO: remove hardcoding and rely on nyan data
 		auto terraintex_filename = util::sformat("%s/%d.slp.png", this->terrain_path.c_str(), line->slp_id);
 		auto new_texture = am.get_texture(terraintex_filename);
@@ -366,6 +560,28 @@ void GameSpec::load_terrain(AssetManager &am, util::csv_file_map_t *file_map) {
 		std::string mask_filename = util::sformat("%s/mode%02d.png", this->blend_path.c_str(), line->blend_mode);
 		terrain_data.blending_masks[i] = am.get_texture(mask_filename);
 	}
+
+	// the renderer draws all terrain types from these arrays.
+	// if one of the textures can't be packed, e.g. without pixels
+	// when headless, it binds the separate textures instead.
+	auto pack = [](const std::vector<Texture *> &textures) -> std::unique_ptr<TextureArray> {
+		if (textures.empty()) {
+			return nullptr;
+		}
+
+		auto array = std::make_unique<TextureArray>();
+		for (Texture *texture : textures) {
+			if (array->insert(texture) < 0) {
+				log::log(MSG(dbg) << "Texture " << texture->get_filename() <<
+				         " can't be packed into a terrain texture array");
+				return nullptr;
+			}
+		}
+		return array;
+	};
+
+	terrain_data.texture_array = pack(terrain_data.textures);
+	terrain_data.blending_mask_array = pack(terrain_data.blending_masks);
 }
 
 void GameSpec::create_abilities(const std::vector<gamedata::empiresdat> &gamedata) {
@@ -374,6 +590,7 @@ void GameSpec::create_abilities(const std::vector<gamedata::empiresdat> &gamedat
 	int total = 0;
 
 	// it seems the index of the header indicates the unit
+	this->commands.resize(headers);
 	for (int i = 0; i < headers; ++i) {
 
 		// init vector
@@ -389,24 +606,30 @@ void GameSpec::create_abilities(const std::vector<gamedata::empiresdat> &gamedat
 			list.push_back(&cmd);
 		}
 
-		//insert to map
-		this->commands[i] = list;
+		this->commands[i] = std::move(list);
 	}
 }
 
-void Sound::play() const {
+void Sound::play(int32_t priority) const {
 	if (this->sound_items.size() <= 0) {
 		return;
 	}
 
+	Engine *engine = this->game_spec->get_asset_manager()->get_engine();
+	if (engine == nullptr) {
+		return;
+	}
+
 	int rand = rng::random_range(0, this->sound_items.size());
 	int sndid = this->sound_items.at(rand);
 
 	try {
 		// TODO: buhuuuu gnargghh this has to be moved to the asset loading subsystem hnnnng
-		audio::AudioManager &am = this->game_spec->get_asset_manager()->get_engine()->get_audio_manager();
+		audio::AudioManager &am = engine->get_audio_manager();
 
-		audio::Sound{am.get_sound(audio::category_t::GAME, sndid)}.play();
+		audio::Sound sound = am.get_sound(audio::category_t::GAME, sndid);
+		sound.set_priority(priority);
+		sound.play();
 	}
 	catch(Error &e) {
 		log::log(MSG(warn) << "cannot play: " << e);
@@ -440,6 +663,8 @@ bool GameSpecHandle::is_ready() const {
 }
 
 void GameSpecHandle::invalidate() {
+	// the steps of the old spec that did not start yet are skipped
+	this->load_cancellation.cancel();
 	this->spec = nullptr;
 
 	if (this->asset_manager)
@@ -477,7 +702,13 @@ void GameSpecHandle::start_load_job() {
 
 	// lambda to be executed to actually load the data files.
 	auto perform_load = [spec_and_job_ptr] {
-		return std::get<std::shared_ptr<GameSpec>>(*spec_and_job_ptr)->initialize();
+		auto gui_signals = std::get<std::shared_ptr<GameSpecSignals>>(*spec_and_job_ptr);
+
+		return std::get<std::shared_ptr<GameSpec>>(*spec_and_job_ptr)->initialize(
+			[gui_signals] (size_t finished, size_t total) {
+				emit gui_signals->load_progress(finished, total);
+			}
+		);
 	};
 
 	auto load_finished = [gui_signals_ptr = this->gui_signals.get()] (job::result_function_t<bool> result) {
@@ -487,9 +718,11 @@ void GameSpecHandle::start_load_job() {
 		}
 	};
 
-	job::JobManager *job_mgr = this->asset_manager->get_engine()->get_job_manager();
+	// waits for the texture jobs, so it mustn't take a simulation worker
+	job::JobManager *job_mgr = this->asset_manager->get_engine()->get_job_manager(job_pool::io);
+	this->load_cancellation = job::CancellationToken::create();
 	std::get<job::Job<bool>>(*spec_and_job_ptr) = job_mgr->enqueue<bool>(
-		perform_load, load_finished
+		perform_load, load_finished, job::job_priority::low, this->load_cancellation
 	);
 }
 
@@ -2,21 +2,27 @@
 
 #pragma once
 
+#include "../job/cancellation_token.h"
 #include "../job/job.h"
+#include "../job/job_graph.h"
 #include "../gamedata/gamedata.gen.h"
 #include "../gamedata/graphic.gen.h"
+#include "../gamedata/sound_file.gen.h"
 #include "../terrain/terrain.h"
 #include "../unit/unit_texture.h"
 #include "../util/file.h"
 
-#include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 #include <QObject>
 
 
 namespace openage {
 
 class AssetManager;
+class Civilisation;
 class GameSpec;
 class UnitType;
 class UnitTypeMeta;
@@ -47,7 +53,11 @@ public:
 		sound_items{sound_items},
 		game_spec{spec} {}
 
-	void play() const;
+	/**
+	 * play one of the sounds, a higher priority keeps it
+	 * playing when many sounds are started.
+	 */
+	void play(int32_t priority=0) const;
 
 	std::vector<int> sound_items;
 
@@ -77,8 +87,11 @@ public:
 	/**
 	 * perform the main loading job.
 	 * this loads all the data into the storage.
+	 *
+	 * the loading steps run in parallel on the job manager workers,
+	 * progress is called with the number of finished and all steps.
 	 */
-	bool initialize();
+	bool initialize(const job::JobGraph::progress_function_t &progress={});
 
 	/**
 	 * Check if loading has been completed,
@@ -108,7 +121,10 @@ public:
 
 	/**
 	 * get unit texture by graphic id -- this is an directional texture
-	 * which also includes graphic deltas
+	 * which also includes graphic deltas.
+	 *
+	 * the unit texture and its textures are loaded on first use,
+	 * most graphics belong to civs and units which are never played.
 	 */
 	std::shared_ptr<UnitTexture> get_unit_texture(index_t graphic_id) const;
 
@@ -124,10 +140,10 @@ public:
 	const gamedata::graphic *get_graphic_data(index_t grp_id) const;
 
 	/**
-	 * get available commands for a unit id
+	 * get available commands for a unit id, empty if it has none.
 	 * nyan will have to replace this somehow
 	 */
-	std::vector<const gamedata::unit_command *> get_command_data(index_t unit_id) const;
+	const std::vector<const gamedata::unit_command *> &get_command_data(index_t unit_id) const;
 
 	/**
 	 * returns the name of a civ by index
@@ -139,6 +155,13 @@ public:
 	 */
 	void create_unit_types(unit_meta_list &objects, int civ_id) const;
 
+	/**
+	 * the civilisation of a civ id with its unit type metas,
+	 * created when first used and kept for the following games.
+	 * the main graphics of its units are loaded along with it.
+	 */
+	std::shared_ptr<Civilisation> get_civilisation(int civ_id) const;
+
 	/**
 	 * Return the asset manager used for loading resources
 	 * of this game specification.
@@ -167,31 +190,38 @@ private:
 	 */
 	terrain_meta terrain_data;
 
+	/*
+	 * the ids of the game data are small and mostly contiguous,
+	 * so the lookups below are vectors indexed by the id. missing
+	 * ids have an empty entry: 0, nullptr or an empty list.
+	 * the units look them up whenever they are created.
+	 */
+
 	/**
 	 * slp to graphic id reverse lookup
 	 */
-	std::unordered_map<index_t, index_t> slp_to_graphic;
+	std::vector<index_t> slp_to_graphic;
 
 	/**
-	 * map graphic id to gamedata graphic.
+	 * gamedata graphic by graphic id.
 	 */
-	std::unordered_map<index_t, const gamedata::graphic *> graphics;
+	std::vector<const gamedata::graphic *> graphics;
 
 	/**
 	 * commands available for each unit id
 	 */
-	std::unordered_map<index_t, std::vector<const gamedata::unit_command *>> commands;
-
+	std::vector<std::vector<const gamedata::unit_command *>> commands;
 
 	/**
-	 * graphic ids -> unit texture for that id
+	 * graphic ids -> unit texture for that id, empty until it's used.
+	 * sized for all graphics once they are indexed.
 	 */
-	std::unordered_map<index_t, std::shared_ptr<UnitTexture>> unit_textures;
+	mutable std::vector<std::shared_ptr<UnitTexture>> unit_textures;
 
 	/**
 	 * sound ids mapped to playable sounds for all available sounds.
 	 */
-	std::unordered_map<index_t, Sound> available_sounds;
+	std::vector<std::unique_ptr<Sound>> available_sounds;
 
 	/**
 	 * check graphic id is valid
@@ -215,13 +245,44 @@ private:
 	/**
 	 * fill in the terrain_data attribute of this
 	 */
-	void load_terrain(AssetManager &am, util::csv_file_map_t *file_map);
+	void load_terrain(AssetManager &am, util::data_file_map *file_map);
+
+	/**
+	 * load the unit textures of the standing, dying, walking,
+	 * attacking and construction graphics of a civ's units,
+	 * in parallel on the io workers.
+	 */
+	void prefetch_unit_textures(int civ_id) const;
+
+	/**
+	 * fill the graphic id and slp id lookups
+	 */
+	void index_graphics(std::vector<gamedata::empiresdat> &gamedata);
+
+	/**
+	 * create the sound objects, and collect the files
+	 * the audio manager has to load for them
+	 */
+	void register_sounds(std::vector<gamedata::empiresdat> &gamedata,
+	                     std::vector<gamedata::sound_file> &sound_files);
 
 	/**
 	 * has game data been load yet
 	 */
 	bool gamedata_loaded;
-	void on_gamedata_loaded(std::vector<gamedata::empiresdat> &gamedata);
+
+	/**
+	 * guards the civilisations, games may
+	 * be started on a job while the spec is used.
+	 */
+	mutable std::mutex cache_mutex;
+
+	/**
+	 * guards the unit textures loaded on first use.
+	 */
+	mutable std::mutex texture_mutex;
+
+	mutable std::unordered_map<int, std::shared_ptr<Civilisation>> civilisations;
 };
 
 } // openage
@@ -297,6 +358,11 @@ private:
 	 */
 	std::shared_ptr<GameSpec> spec;
 
+	/**
+	 * stops the load job of the spec when it is invalidated.
+	 */
+	job::CancellationToken load_cancellation;
+
 	/**
 	 * enables the loading of the game specification.
 	 */
@@ -321,6 +387,11 @@ signals:
 	 */
 	void load_job_finished();
 
+	/*
+	 * Some loading steps have finished, emitted from the loading thread.
+	 */
+	void load_progress(int finished_steps, int total_steps);
+
 	void game_spec_loaded(std::shared_ptr<GameSpec> loaded_game_spec);
 };
 
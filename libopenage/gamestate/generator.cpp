@@ -2,6 +2,10 @@
 
 #include "generator.h"
 
+#include <QCoreApplication>
+
+#include "../assetmanager.h"
+#include "../job/job_graph.h"
 #include "../log/log.h"
 #include "../rng/rng.h"
 #include "../terrain/terrain_chunk.h"
@@ -14,15 +18,38 @@
 
 namespace openage {
 
-coord::tile random_tile(rng::RNG &rng, tileset_t tiles) {
+namespace {
+
+/**
+ * a generator for one part of the map, its numbers only depend on the
+ * seed of the map and the number of the stream. the parts can therefore
+ * be generated in any order, with identical results.
+ */
+rng::RNG stream_rng(uint64_t seed, uint64_t stream) {
+	uint64_t data[2] = {seed, stream};
+	return rng::RNG{data, sizeof(data)};
+}
+
+} // anonymous namespace
+
+
+void ensure_qt_application() {
+	if (QCoreApplication::instance() == nullptr) {
+		static int argc = 1;
+		static char name[] = "openage-generator";
+		static char *argv[] = {name, nullptr};
+		static QCoreApplication app{argc, argv};
+	}
+}
+
+
+coord::tile random_tile(rng::RNG &rng, const tileset_t &tiles) {
 	if (tiles.empty()) {
 		log::log(MSG(err) << "random tile failed");
 		return coord::tile{0, 0};
 	}
 	uint64_t index = rng.random() % tiles.size();
-	auto it = std::begin(tiles);
-	std::advance(it, index);
-	return *it;
+	return tiles.nth(index);
 }
 
 
@@ -31,10 +58,11 @@ Region::Region(int size)
 	owner{0},
 	object_id{0},
 	terrain_id{0},
-	center{0, 0} {
+	center{0, 0},
+	tiles{coord::tile{-size, -size}, coord::tile_delta{2 * size, 2 * size}} {
 	for (int ne = -size; ne < size; ++ne) {
 		for (int se = -size; se < size; ++se) {
-			this->tiles.emplace(coord::tile{ne, se});
+			this->tiles.insert(coord::tile{ne, se});
 		}
 	}
 }
@@ -48,7 +76,7 @@ Region::Region(coord::tile center, tileset_t tiles)
 	tiles{tiles} {
 }
 
-tileset_t Region::get_tiles() const {
+const tileset_t &Region::get_tiles() const {
 	return this->tiles;
 }
 
@@ -62,32 +90,24 @@ coord::tile Region::get_tile(rng::RNG &rng) const {
 
 
 tileset_t Region::subset(rng::RNG &rng, coord::tile start_point, unsigned int number, double p) const {
+	// the set of included tiles
+	tileset_t subtiles = tileset_t::empty_like(this->tiles);
 	if (p == 0.0) {
-		return tileset_t();
+		return subtiles;
 	}
-
-	// the set of included tiles
-	std::unordered_set<coord::tile> subtiles;
-	subtiles.emplace(start_point);
+	subtiles.insert(start_point);
 
 	// outside layer of tiles
-	std::unordered_set<coord::tile> edge_set;
+	tileset_t edge_set = tileset_t::empty_like(this->tiles);
 
 	while (subtiles.size() < number) {
 		if (edge_set.empty()) {
 
-			// try fill the edge list
-			for (auto &t : subtiles) {
-
-				// check adjacent tiles
-				for (int i = 0; i < 4; ++i) {
-					coord::tile adj = t + neigh_tiles[i];
-					if (this->tiles.count(adj) &&
-						!subtiles.count(adj)) {
-						edge_set.emplace(adj);
-					}
-				}
-			}
+			// try fill the edge list with the adjacent tiles
+			// of the region which are not included yet
+			edge_set.add_neighbors(subtiles);
+			edge_set.intersect(this->tiles);
+			edge_set.subtract(subtiles);
 			if (edge_set.empty()) {
 
 				// unable to grow further
@@ -99,7 +119,7 @@ tileset_t Region::subset(rng::RNG &rng, coord::tile start_point, unsigned int nu
 		coord::tile next_tile = random_tile(rng, edge_set);
 		edge_set.erase(next_tile);
 		if (rng.probability(p)) {
-			subtiles.emplace(next_tile);
+			subtiles.insert(next_tile);
 		}
 	}
 	return subtiles;
@@ -110,9 +130,7 @@ Region Region::take_tiles(rng::RNG &rng, coord::tile start_point, unsigned int n
 	tileset_t new_set = this->subset(rng, start_point, number, p);
 
 	// erase from current set
-	for (auto &t: new_set) {
-		this->tiles.erase(t);
-	}
+	this->tiles.subtract(new_set);
 
 	Region new_region(start_point, new_set);
 	new_region.terrain_id = this->terrain_id;
@@ -150,7 +168,7 @@ std::vector<std::string> Generator::player_names() const {
 	return result;
 }
 
-void Generator::create_regions() {
+void Generator::create_regions(job::JobManager *job_manager) {
 
 	// get option settings
 	int seed = this->getv<int>("generation_seed");
@@ -165,12 +183,15 @@ void Generator::create_regions() {
 	p_area = std::max(50, p_area);
 	p_radius = std::max(2, p_radius);
 
-	rng::RNG rng(seed);
 	Region base(size * 16);
 	base.terrain_id = base_id;
-	std::vector<Region> player_regions;
 
 	int player_count = this->player_names().size() - 1;
+
+	// the areas of the players are taken from the base region one after
+	// another, as they may compete for the same tiles.
+	// each player has a stream for its area and one for its contents.
+	std::vector<Region> player_areas;
 	for (int i = 0; i < player_count; ++i) {
 		log::log(MSG(dbg) << "generate player " << i);
 
@@ -180,68 +201,110 @@ void Generator::create_regions() {
 		int se = size * p_radius * cos(2 * math::PI * angle);
 		coord::tile player_tile{ne, se};
 
+		rng::RNG rng = stream_rng(seed, 1 + 2 * i);
 		Region player = base.take_tiles(rng, player_tile, p_area, 0.5);
 		player.terrain_id = 10;
+		player_areas.push_back(std::move(player));
+	}
 
-		Region obj_space = player.take_tiles(rng, player.get_center(), p_area / 5, 0.5);
-		obj_space.owner = i + 1;
-		obj_space.terrain_id = 8;
-
-		Region trees1 = player.take_random(rng, p_area / 10, 0.3);
-		trees1.terrain_id = 9;
-		trees1.object_id = 349;
-
-		Region trees2 = player.take_random(rng, p_area / 10, 0.3);
-		trees2.terrain_id = 9;
-		trees2.object_id = 351;
-
-		Region stone = player.take_random(rng, 5, 0.3);
-		stone.object_id = 102;
-
-		Region gold = player.take_random(rng, 7, 0.3);
-		gold.object_id = 66;
-
-		Region forage = player.take_random(rng, 6, 0.3);
-		forage.object_id = 59;
-
-		Region sheep = player.take_random(rng, 4, 0.3);
-		sheep.owner = obj_space.owner;
-		sheep.object_id = 594;
+	// the contents of each player area and the extra trees of the base
+	// region don't share tiles, so they are grown in parallel
+	std::vector<std::vector<Region>> player_regions(player_count);
+	std::vector<Region> extra_trees;
 
-		player_regions.push_back(player);
-		player_regions.push_back(obj_space);
-		player_regions.push_back(trees1);
-		player_regions.push_back(trees2);
-		player_regions.push_back(stone);
-		player_regions.push_back(gold);
-		player_regions.push_back(forage);
-		player_regions.push_back(sheep);
+	job::JobGraph graph{job_manager};
+	for (int i = 0; i < player_count; ++i) {
+		graph.add([&, i] {
+			rng::RNG rng = stream_rng(seed, 2 + 2 * i);
+			Region &player = player_areas[i];
+
+			Region obj_space = player.take_tiles(rng, player.get_center(), p_area / 5, 0.5);
+			obj_space.owner = i + 1;
+			obj_space.terrain_id = 8;
+
+			Region trees1 = player.take_random(rng, p_area / 10, 0.3);
+			trees1.terrain_id = 9;
+			trees1.object_id = 349;
+
+			Region trees2 = player.take_random(rng, p_area / 10, 0.3);
+			trees2.terrain_id = 9;
+			trees2.object_id = 351;
+
+			Region stone = player.take_random(rng, 5, 0.3);
+			stone.object_id = 102;
+
+			Region gold = player.take_random(rng, 7, 0.3);
+			gold.object_id = 66;
+
+			Region forage = player.take_random(rng, 6, 0.3);
+			forage.object_id = 59;
+
+			Region sheep = player.take_random(rng, 4, 0.3);
+			sheep.owner = obj_space.owner;
+			sheep.object_id = 594;
+
+			std::vector<Region> &result = player_regions[i];
+			result.push_back(player);
+			result.push_back(obj_space);
+			result.push_back(trees1);
+			result.push_back(trees2);
+			result.push_back(stone);
+			result.push_back(gold);
+			result.push_back(forage);
+			result.push_back(sheep);
+		});
 	}
 
-	for (int i = 0; i < 6; ++i) {
-		Region extra_trees = base.take_random(rng, 160, 0.3);
-		extra_trees.terrain_id = 9;
-		extra_trees.object_id = 349;
-		player_regions.push_back(extra_trees);
-	}
+	graph.add([&] {
+		rng::RNG rng = stream_rng(seed, 0);
+		for (int i = 0; i < 6; ++i) {
+			Region trees = base.take_random(rng, 160, 0.3);
+			trees.terrain_id = 9;
+			trees.object_id = 349;
+			extra_trees.push_back(trees);
+		}
+	});
 
-	// set regions
+	graph.run();
+
+	// set regions, in the same order for every run
 	this->regions.clear();
 	this->regions.push_back(base);
-	for (auto &r : player_regions) {
+	for (auto &regions : player_regions) {
+		for (auto &r : regions) {
+			this->regions.push_back(r);
+		}
+	}
+	for (auto &r : extra_trees) {
 		this->regions.push_back(r);
 	}
 }
 
 
 std::shared_ptr<Terrain> Generator::terrain() const {
-	auto terrain = std::make_shared<Terrain>(this->spec->get_terrain_meta(), true);
+	if (this->regions.empty()) {
+		// a loaded game brings its own chunks
+		return std::make_shared<Terrain>(this->spec->get_terrain_meta(), true);
+	}
+
+	// all regions are parts of the rectangle of the base region,
+	// which is the extent of the map
+	const tileset_t &base = this->regions.front().get_tiles();
+	coord::tile start = base.get_start();
+	coord::tile_delta extent = base.get_extent();
+	auto terrain = std::make_shared<Terrain>(
+		this->spec->get_terrain_meta(),
+		start,
+		start + coord::tile_delta{extent.ne - 1, extent.se - 1}
+	);
+
+	std::vector<int> ids(std::max<coord::tile_t>(0, extent.ne * extent.se), 0);
 	for (auto &r : this->regions) {
 		for (auto &tile : r.get_tiles()) {
-			TerrainChunk *chunk = terrain->get_create_chunk(tile);
-			chunk->get_data(tile)->terrain_id = r.terrain_id;
+			ids[(tile.ne - start.ne) * extent.se + (tile.se - start.se)] = r.terrain_id;
 		}
 	}
+	terrain->fill(ids.data(), start, extent);
 	return terrain;
 }
 
@@ -292,6 +355,20 @@ void Generator::add_units(GameMain &m) const {
 	}
 }
 
+tileset_t Generator::object_tiles() {
+	this->create_regions(nullptr);
+
+	tileset_t result = tileset_t::empty_like(this->regions.front().get_tiles());
+	for (auto &r : this->regions) {
+		if (r.object_id) {
+			for (auto &tile : r.get_tiles()) {
+				result.insert(tile);
+			}
+		}
+	}
+	return result;
+}
+
 std::unique_ptr<GameMain> Generator::create(std::shared_ptr<GameSpec> spec) {
 	ENSURE(spec->load_complete(), "spec hasn't been checked or was invalidated");
 	this->spec = spec;
@@ -306,7 +383,8 @@ std::unique_ptr<GameMain> Generator::create(std::shared_ptr<GameSpec> spec) {
 		return game;
 	} else {
 		// generation
-		this->create_regions();
+		AssetManager *assetmanager = spec->get_asset_manager();
+		this->create_regions(assetmanager ? assetmanager->get_job_manager() : nullptr);
 		return std::make_unique<GameMain>(*this);
 	}
 }
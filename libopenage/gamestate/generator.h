@@ -1,11 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
-#include <unordered_set>
-
 #include "../coord/tile.h"
 #include "../gui/guisys/public/gui_property_map.h"
+#include "tile_set.h"
 
 namespace qtsdl {
 class GuiItemLink;
@@ -17,6 +16,10 @@ class GameSpec;
 class Terrain;
 class GameMain;
 
+namespace job {
+class JobManager;
+} // openage::job
+
 namespace rng {
 class RNG;
 } // openage::rng
@@ -24,12 +27,18 @@ class RNG;
 /**
  * the type to store a set of tiles
  */
-using tileset_t = std::unordered_set<coord::tile>;
+using tileset_t = TileSet;
 
 /**
  * picks a random tile from a set
  */
-coord::tile random_tile(rng::RNG &rng, tileset_t tiles);
+coord::tile random_tile(rng::RNG &rng, const tileset_t &tiles);
+
+/**
+ * creates a qt application if there is none yet, the property
+ * maps of the generator need one when it's used without gui.
+ */
+void ensure_qt_application();
 
 /**
  * the four directions available for 2d tiles
@@ -61,7 +70,7 @@ public:
 	/**
 	 * all tiles in this region
 	 */
-	tileset_t get_tiles() const;
+	const tileset_t &get_tiles() const;
 
 	/**
 	 * the center point of the region
@@ -154,13 +163,25 @@ public:
 	 */
 	void add_units(GameMain &m) const;
 
+	/**
+	 * generates the map without game data and returns the tiles
+	 * covered by objects like trees and mines, within the rectangle
+	 * of the map. used to test algorithms on generated maps.
+	 */
+	tileset_t object_tiles();
+
 	/**
 	 * Create a game from a specification.
 	 */
 	std::unique_ptr<GameMain> create(std::shared_ptr<GameSpec> spec);
 
 private:
-	void create_regions();
+	/**
+	 * generates the regions of the map, the contents of the player
+	 * areas are generated in parallel on the job manager, if given.
+	 * the result only depends on the settings.
+	 */
+	void create_regions(job::JobManager *job_manager);
 
 	/**
 	 * data version used to create a game
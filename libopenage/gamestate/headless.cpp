@@ -0,0 +1,250 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "headless.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../error/error.h"
+#include "../job/job_manager.h"
+#include "../log/log.h"
+#include "../unit/unit_container.h"
+#include "../util/timer.h"
+#include "game_main.h"
+#include "game_spec.h"
+#include "generator.h"
+#include "replay.h"
+
+namespace openage {
+
+
+HeadlessGame::HeadlessGame(const headless_settings &settings,
+                           const replay_settings *recorded)
+	:
+	assets{nullptr} {
+
+	ENSURE(settings.players >= 1, "a game needs at least one player");
+
+	// the game data signals its progress
+	ensure_qt_application();
+
+	if (settings.simulation_workers > 0) {
+		job::pool_options options;
+		options.name = "sim worker";
+		options.allocation_tag = util::alloc_tag::simulation;
+
+		this->job_manager = std::make_unique<job::JobManager>(settings.simulation_workers, options);
+		this->job_manager->start();
+	}
+
+	this->assets.set_headless(true);
+	this->assets.set_job_manager(this->job_manager.get());
+	this->assets.set_data_dir_string(settings.data_directory);
+
+	this->spec = std::make_shared<GameSpec>(&this->assets);
+	if (not this->spec->initialize()) {
+		throw Error(MSG(err) << "could not load the game data from " << settings.data_directory);
+	}
+
+	Generator generator{nullptr};
+	generator.setv("generation_seed", settings.seed);
+	generator.setv("terrain_size", std::max(1, settings.terrain_size));
+
+	std::vector<std::string> names;
+	for (int i = 0; i < settings.players; i++) {
+		names.push_back("player" + std::to_string(i + 1));
+	}
+	generator.set_csv("player_names", names);
+
+	if (not settings.save_file.empty()) {
+		generator.setv("from_file", true);
+		generator.setv("load_filename", settings.save_file);
+	}
+
+	if (recorded) {
+		recorded->apply(generator);
+	}
+
+	this->game = generator.create(this->spec);
+
+	// only recorded when asked to, a replay is not recorded again
+	this->game->replay_filename.value = recorded ? "" : settings.record_file;
+	if (recorded) {
+		this->game->tick_rate.value = recorded->tick_rate;
+	}
+}
+
+
+HeadlessGame::~HeadlessGame() {
+	// the units may still have jobs running
+	this->game.reset();
+
+	if (this->job_manager) {
+		this->job_manager->stop();
+	}
+}
+
+
+GameMain &HeadlessGame::get_game() {
+	return *this->game;
+}
+
+
+GameSpec &HeadlessGame::get_spec() {
+	return *this->spec;
+}
+
+
+void HeadlessGame::tick(int count) {
+	time_nsec_t tick_duration = this->game->get_tick_duration();
+
+	for (int i = 0; i < count; i++) {
+		this->game->update(tick_duration);
+
+		// where the engine would run them between the frames
+		if (this->job_manager) {
+			this->job_manager->execute_callbacks();
+		}
+	}
+}
+
+
+std::shared_ptr<unit_columns> HeadlessGame::get_units() {
+	return this->game->get_unit_columns();
+}
+
+
+ReplayPlayer::ReplayPlayer(const replay &recording, const headless_settings &settings)
+	:
+	recording{std::make_unique<replay>(recording)},
+	settings{settings},
+	desynced{false},
+	desync_tick{0} {
+
+	this->restart();
+}
+
+
+ReplayPlayer::~ReplayPlayer() = default;
+
+
+uint64_t ReplayPlayer::get_tick() {
+	return this->headless->get_game().get_tick_count();
+}
+
+
+uint64_t ReplayPlayer::get_end() const {
+	return this->recording->ticks;
+}
+
+
+void ReplayPlayer::seek(uint64_t tick) {
+	tick = std::min(tick, this->get_end());
+	if (tick < this->get_tick()) {
+		this->restart();
+	}
+
+	GameMain &game = this->headless->get_game();
+
+	while (game.get_tick_count() < tick) {
+		uint64_t current = game.get_tick_count();
+
+		auto commands = this->recording->commands.find(current);
+		if (commands != std::end(this->recording->commands)) {
+			for (auto &record : commands->second) {
+				game.dispatch_command(record);
+			}
+		}
+
+		this->headless->tick();
+
+		auto checkpoint = this->recording->checkpoints.find(current);
+		if (checkpoint != std::end(this->recording->checkpoints) and not this->desynced) {
+			state_parts_t parts = game.get_state_hash().get_parts();
+			if (parts != checkpoint->second) {
+				this->desynced = true;
+				this->desync_tick = current;
+				this->desync_parts = StateHash::diverged(parts, checkpoint->second);
+
+				std::string names;
+				for (state_part part : this->desync_parts) {
+					names += names.empty() ? "" : ", ";
+					names += state_part_name(part);
+				}
+				log::log(MSG(err) << "Replay diverged in tick " << current << ": " << names);
+			}
+		}
+	}
+}
+
+
+void ReplayPlayer::play() {
+	this->seek(this->get_end());
+}
+
+
+bool ReplayPlayer::in_sync() const {
+	return not this->desynced;
+}
+
+
+uint64_t ReplayPlayer::get_desync_tick() const {
+	return this->desync_tick;
+}
+
+
+const std::vector<state_part> &ReplayPlayer::get_desync_parts() const {
+	return this->desync_parts;
+}
+
+
+GameMain &ReplayPlayer::get_game() {
+	return this->headless->get_game();
+}
+
+
+void ReplayPlayer::restart() {
+	// the old game's units may still have jobs running
+	this->headless.reset();
+	this->headless = std::make_unique<HeadlessGame>(this->settings, &this->recording->settings);
+}
+
+
+headless_result run_headless_game(const headless_settings &settings) {
+	ENSURE(settings.ticks >= 0, "can't simulate a negative number of ticks");
+
+	headless_result result;
+	util::Timer timer{false};
+
+	if (not settings.replay_file.empty()) {
+		ReplayPlayer player{read_replay(settings.replay_file), settings};
+		result.load_seconds = timer.getandresetval() / 1e9;
+
+		player.play();
+		result.tick_seconds = timer.getval() / 1e9;
+
+		result.ticks = player.get_tick();
+		result.units = player.get_game().placed_units.all_units().size();
+		result.state_hash = player.get_game().get_state_hash().get();
+		result.in_sync = player.in_sync();
+		result.desync_tick = player.get_desync_tick();
+	}
+	else {
+		HeadlessGame headless{settings};
+		result.load_seconds = timer.getandresetval() / 1e9;
+
+		headless.tick(settings.ticks);
+		result.tick_seconds = timer.getval() / 1e9;
+
+		result.ticks = settings.ticks;
+		result.units = headless.get_game().placed_units.all_units().size();
+		result.state_hash = headless.get_game().get_state_hash().get();
+	}
+
+	log::log(MSG(info) << "Simulated " << result.ticks << " ticks of "
+	         << result.units << " units in " << result.tick_seconds << " s");
+
+	return result;
+}
+
+} // openage
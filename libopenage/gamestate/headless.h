@@ -0,0 +1,216 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libcpp cimport bool
+// pxd: from libc.stdint cimport uint64_t
+#include <cstdint>
+// pxd: from libcpp.string cimport string
+#include <string>
+// pxd: from libcpp.memory cimport shared_ptr
+#include <memory>
+#include <vector>
+
+#include "../assetmanager.h"
+// pxd: from libopenage.unit.unit_view cimport unit_columns
+#include "../unit/unit_view.h"
+#include "state_hash.h"
+
+namespace openage {
+
+class GameMain;
+class GameSpec;
+struct replay;
+struct replay_settings;
+
+namespace job {
+class JobManager;
+}
+
+
+/**
+ * Game to simulate without window.
+ *
+ * pxd:
+ *
+ * cppclass headless_settings:
+ *     string data_directory
+ *     string save_file
+ *     int players
+ *     int seed
+ *     int terrain_size
+ *     int simulation_workers
+ *     int ticks
+ *     string record_file
+ *     string replay_file
+ */
+struct headless_settings {
+	std::string data_directory;
+	std::string save_file;       //!< the game to load, a generated one if empty
+	int players = 2;
+	int seed = 4321;
+	int terrain_size = 2;
+	int simulation_workers = 0;  //!< threads updating the units, 0 updates them on the calling thread
+	int ticks = 600;             //!< only used by run_headless_game, without replay_file
+	std::string record_file;     //!< replay file the game is recorded to, if not empty
+	std::string replay_file;     //!< only used by run_headless_game, plays this replay instead
+};
+
+
+/**
+ * Result of run_headless_game.
+ *
+ * pxd:
+ *
+ * cppclass headless_result:
+ *     size_t units
+ *     int ticks
+ *     double load_seconds
+ *     double tick_seconds
+ *     uint64_t state_hash
+ *     bool in_sync
+ *     uint64_t desync_tick
+ */
+struct headless_result {
+	size_t units = 0;           //!< units in the game after the ticks
+	int ticks = 0;
+	double load_seconds = 0;    //!< game data loading and map generation
+	double tick_seconds = 0;    //!< all ticks together
+	uint64_t state_hash = 0;    //!< of the game after the ticks, equal for equal runs
+	bool in_sync = true;        //!< whether a replay matched its recorded state hashes
+	uint64_t desync_tick = 0;   //!< the first tick whose hash differed, if not in_sync
+};
+
+
+/**
+ * A game that is simulated without engine: no window, OpenGL, gui or
+ * audio is initialized. The game data is loaded from the data directory,
+ * but textures are only read for their subtexture layout and the sounds
+ * stay silent.
+ *
+ * Only Qt core is needed, for the signals of the game data.
+ *
+ * pxd:
+ *
+ * cppclass HeadlessGame:
+ *     HeadlessGame(headless_settings settings) except +
+ *     void tick(int count) except +
+ *     shared_ptr[unit_columns] get_units() except +
+ */
+class HeadlessGame {
+public:
+	/**
+	 * @param recorded: the settings of a replay, which replace the
+	 *                  ones of the map and players in settings
+	 */
+	explicit HeadlessGame(const headless_settings &settings,
+	                      const replay_settings *recorded=nullptr);
+	~HeadlessGame();
+
+	HeadlessGame(const HeadlessGame &) = delete;
+	HeadlessGame &operator =(const HeadlessGame &) = delete;
+
+	GameMain &get_game();
+	GameSpec &get_spec();
+
+	/**
+	 * Advances the game by count ticks of its tick duration.
+	 */
+	void tick(int count=1);
+
+	/**
+	 * The state of the units after the last tick, see UnitView.
+	 */
+	std::shared_ptr<unit_columns> get_units();
+
+private:
+	/**
+	 * The simulation workers, nullptr without.
+	 */
+	std::unique_ptr<job::JobManager> job_manager;
+
+	AssetManager assets;
+	std::shared_ptr<GameSpec> spec;
+	std::unique_ptr<GameMain> game;
+};
+
+
+/**
+ * Plays back a replay as fast as possible: the game is created from the
+ * recorded settings, and the recorded commands are dispatched before
+ * their ticks. The state hashes the replay has every few ticks are
+ * compared to the ones of the playback, so a playback that diverges
+ * from the recorded game, e.g. after a change of the simulation, is
+ * reported at the first checkpoint after.
+ *
+ * Seeking forward simulates the ticks in between, seeking backward
+ * starts the game anew: the savefiles don't store the unit ids and
+ * actions the commands depend on, so they can't be restored from.
+ */
+class ReplayPlayer {
+public:
+	/**
+	 * @param settings: the data directory and simulation workers to use
+	 */
+	ReplayPlayer(const replay &recording, const headless_settings &settings);
+	~ReplayPlayer();
+
+	ReplayPlayer(const ReplayPlayer &) = delete;
+	ReplayPlayer &operator =(const ReplayPlayer &) = delete;
+
+	/**
+	 * the tick that is simulated next.
+	 */
+	uint64_t get_tick();
+
+	/**
+	 * the ticks of the replay.
+	 */
+	uint64_t get_end() const;
+
+	/**
+	 * simulates until the tick is next, at most until the end.
+	 */
+	void seek(uint64_t tick);
+
+	/**
+	 * simulates all remaining ticks of the replay.
+	 */
+	void play();
+
+	/**
+	 * whether all state hashes so far matched the recorded ones.
+	 */
+	bool in_sync() const;
+
+	/**
+	 * the first tick whose state hash differed, and the parts
+	 * that differed then. only valid if not in_sync().
+	 */
+	uint64_t get_desync_tick() const;
+	const std::vector<state_part> &get_desync_parts() const;
+
+	GameMain &get_game();
+
+private:
+	void restart();
+
+	std::unique_ptr<replay> recording;
+	headless_settings settings;
+	std::unique_ptr<HeadlessGame> headless;
+
+	bool desynced;
+	uint64_t desync_tick;
+	std::vector<state_part> desync_parts;
+};
+
+
+/**
+ * Loads or generates a game and simulates the given number of ticks,
+ * as fast as possible. With a replay file, the whole replay is played.
+ *
+ * pxd: headless_result run_headless_game(headless_settings settings) except +
+ */
+headless_result run_headless_game(const headless_settings &settings);
+
+} // openage
@@ -0,0 +1,360 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "influence_map.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../job/job_manager.h"
+#include "../job/parallel.h"
+#include "../terrain/terrain_object.h"
+#include "../unit/unit.h"
+#include "../unit/unit_container.h"
+#include "player.h"
+
+namespace openage {
+
+namespace {
+
+constexpr size_t tiles_per_chunk = coord::settings::tiles_per_chunk * coord::settings::tiles_per_chunk;
+
+/**
+ * tiles around the range of an armed unit it threatens,
+ * as it may move towards its targets.
+ */
+constexpr int threat_margin = 2;
+
+constexpr int building_territory_radius = 6;
+constexpr float building_territory = 4;
+constexpr int unit_territory_radius = 3;
+constexpr float unit_territory = 1;
+
+constexpr int resource_radius = 3;
+
+
+/**
+ * index of the tile in the planes of its chunk.
+ */
+size_t tile_index(const coord::tile &tile) {
+	coord::tile_delta on_chunk = tile.get_pos_on_chunk();
+	return on_chunk.se * coord::settings::tiles_per_chunk + on_chunk.ne;
+}
+
+
+/**
+ * the plane of a snapshot the source adds to.
+ * sources of players that are not in the game are beyond the planes.
+ */
+size_t source_plane(const influence_source &source, size_t player_count) {
+	switch (source.layer) {
+	case influence_layer::threat:
+		return (source.index < player_count) ? source.index : SIZE_MAX;
+	case influence_layer::territory:
+		return (source.index < player_count) ? player_count + source.index : SIZE_MAX;
+	case influence_layer::resources:
+	default:
+		return 2 * player_count + source.index;
+	}
+}
+
+} // anonymous namespace
+
+
+InfluenceSnapshot::InfluenceSnapshot()
+	:
+	tick{0},
+	player_count{0},
+	plane_count{0} {}
+
+
+float InfluenceSnapshot::get_threat(unsigned player, const coord::tile &tile) const {
+	if (player >= this->player_count) {
+		return 0;
+	}
+	return this->get(player, tile);
+}
+
+
+float InfluenceSnapshot::get_territory(unsigned player, const coord::tile &tile) const {
+	if (player >= this->player_count) {
+		return 0;
+	}
+	return this->get(this->player_count + player, tile);
+}
+
+
+float InfluenceSnapshot::get_resources(game_resource resource, const coord::tile &tile) const {
+	if (resource == game_resource::RESOURCE_TYPE_COUNT) {
+		return 0;
+	}
+	return this->get(2 * this->player_count + static_cast<size_t>(resource), tile);
+}
+
+
+uint64_t InfluenceSnapshot::get_tick() const {
+	return this->tick;
+}
+
+
+size_t InfluenceSnapshot::chunk_hash::operator ()(const coord::chunk &chunk) const {
+	constexpr int half_size_t_bits = sizeof(size_t) * 4;
+	return (static_cast<size_t>(chunk.ne) << half_size_t_bits) ^ static_cast<size_t>(chunk.se);
+}
+
+
+float InfluenceSnapshot::get(size_t plane, const coord::tile &tile) const {
+	auto it = this->chunk_index.find(tile.to_chunk());
+	if (it == std::end(this->chunk_index)) {
+		return 0;
+	}
+	size_t offset = (it->second * this->plane_count + plane) * tiles_per_chunk;
+	return this->values[offset + tile_index(tile)];
+}
+
+
+float *InfluenceSnapshot::chunk_values(size_t chunk) {
+	return &this->values[chunk * this->plane_count * tiles_per_chunk];
+}
+
+
+InfluenceMap::InfluenceMap()
+	:
+	current{std::make_shared<InfluenceSnapshot>()},
+	used{false} {}
+
+
+// a running computation only holds its pending state,
+// so it may finish after the map is gone
+InfluenceMap::~InfluenceMap() = default;
+
+
+std::vector<influence_source> InfluenceMap::collect_sources(UnitContainer &units) {
+	std::vector<influence_source> sources;
+
+	for (Unit *unit : units.all_units()) {
+		if (not unit->location) {
+			continue;
+		}
+		coord::tile tile = unit->location->pos.start;
+
+		if (unit->has_attribute(attr_type::resource)) {
+			auto &resource = unit->get_attribute<attr_type::resource>();
+			if (resource.amount > 0 and resource.resource_type != game_resource::RESOURCE_TYPE_COUNT) {
+				sources.push_back(influence_source{
+					tile, influence_layer::resources,
+					static_cast<unsigned>(resource.resource_type),
+					resource.amount, resource_radius
+				});
+			}
+		}
+
+		if (not unit->has_attribute(attr_type::owner)) {
+			continue;
+		}
+		unsigned player = unit->get_attribute<attr_type::owner>().player.player_number;
+
+		if (unit->has_attribute(attr_type::building)) {
+			sources.push_back(influence_source{
+				tile, influence_layer::territory, player,
+				building_territory, building_territory_radius
+			});
+		}
+		else {
+			sources.push_back(influence_source{
+				tile, influence_layer::territory, player,
+				unit_territory, unit_territory_radius
+			});
+		}
+
+		if (unit->has_attribute(attr_type::attack)) {
+			auto &attack = unit->get_attribute<attr_type::attack>();
+
+			float damage = 0;
+			for (auto &amount : attack.damage) {
+				damage += amount.second;
+			}
+			if (damage > 0) {
+				int range = static_cast<int>(attack.range / coord::settings::phys_per_tile);
+				sources.push_back(influence_source{
+					tile, influence_layer::threat, player,
+					damage, range + threat_margin
+				});
+			}
+		}
+	}
+
+	return sources;
+}
+
+
+void InfluenceMap::update(std::vector<influence_source> sources,
+                          std::vector<coord::chunk> chunks,
+                          size_t player_count,
+                          uint64_t tick,
+                          job::JobManager *job_manager) {
+	this->publish();
+
+	std::shared_ptr<InfluenceSnapshot> target;
+	{
+		std::lock_guard<std::mutex> guard{this->lock};
+
+		// the map is the only owner if no reader has it
+		if (this->spare and this->spare.use_count() == 1) {
+			target = std::move(this->spare);
+		}
+	}
+
+	if (not target) {
+		target = std::make_shared<InfluenceSnapshot>();
+	}
+
+	// the values keep their capacity, so refills of the same chunks don't allocate
+	target->tick = tick;
+	target->player_count = player_count;
+	target->plane_count = 2 * player_count + static_cast<size_t>(game_resource::RESOURCE_TYPE_COUNT);
+	target->chunks = std::move(chunks);
+	target->chunk_index.clear();
+	for (size_t i = 0; i < target->chunks.size(); i++) {
+		target->chunk_index.emplace(target->chunks[i], i);
+	}
+	target->values.resize(target->chunks.size() * target->plane_count * tiles_per_chunk);
+
+	auto state = std::make_shared<pending_state>();
+	state->snapshot = target;
+	this->pending = state;
+
+	auto run = [state, sources = std::move(sources), job_manager]() {
+		try {
+			InfluenceMap::compute(*state->snapshot, sources, job_manager);
+		}
+		catch (...) {
+			state->error = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> guard{state->lock};
+		state->done = true;
+		state->finished.notify_all();
+	};
+
+	if (job_manager) {
+		job_manager->enqueue<bool>([run = std::move(run)]() {
+			run();
+			return true;
+		});
+	}
+	else {
+		run();
+	}
+}
+
+
+std::shared_ptr<const InfluenceSnapshot> InfluenceMap::get() {
+	std::lock_guard<std::mutex> guard{this->lock};
+	this->used = true;
+	return this->current;
+}
+
+
+bool InfluenceMap::is_used() const {
+	std::lock_guard<std::mutex> guard{this->lock};
+	return this->used;
+}
+
+
+void InfluenceMap::compute(InfluenceSnapshot &snapshot,
+                           const std::vector<influence_source> &sources,
+                           job::JobManager *job_manager) {
+	constexpr coord::tile_t chunk_tiles = coord::settings::tiles_per_chunk;
+
+	// the sources reaching each chunk, in their order, so the sums
+	// of a tile are the same no matter which worker computes it
+	std::vector<std::vector<size_t>> chunk_sources(snapshot.chunks.size());
+
+	for (size_t i = 0; i < sources.size(); i++) {
+		const influence_source &source = sources[i];
+		if (source.radius < 0 or source.strength == 0 or
+		    source_plane(source, snapshot.player_count) >= snapshot.plane_count) {
+			continue;
+		}
+
+		coord::tile_t radius = source.radius;
+		coord::chunk first = coord::tile{source.tile.ne - radius, source.tile.se - radius}.to_chunk();
+		coord::chunk last = coord::tile{source.tile.ne + radius, source.tile.se + radius}.to_chunk();
+
+		for (coord::chunk_t se = first.se; se <= last.se; se++) {
+			for (coord::chunk_t ne = first.ne; ne <= last.ne; ne++) {
+				auto it = snapshot.chunk_index.find(coord::chunk{ne, se});
+				if (it != std::end(snapshot.chunk_index)) {
+					chunk_sources[it->second].push_back(i);
+				}
+			}
+		}
+	}
+
+	job::parallel_for(job_manager, 0, snapshot.chunks.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			float *values = snapshot.chunk_values(c);
+			std::fill(values, values + snapshot.plane_count * tiles_per_chunk, 0.0f);
+
+			coord::tile origin{
+				snapshot.chunks[c].ne * chunk_tiles,
+				snapshot.chunks[c].se * chunk_tiles
+			};
+
+			for (size_t i : chunk_sources[c]) {
+				const influence_source &source = sources[i];
+
+				float *plane_values = values + source_plane(source, snapshot.player_count) * tiles_per_chunk;
+
+				// the tiles of the chunk within the square around the source
+				coord::tile_t radius = source.radius;
+				coord::tile_t se_begin = std::max(source.tile.se - radius, origin.se);
+				coord::tile_t se_end = std::min(source.tile.se + radius + 1, origin.se + chunk_tiles);
+				coord::tile_t ne_begin = std::max(source.tile.ne - radius, origin.ne);
+				coord::tile_t ne_end = std::min(source.tile.ne + radius + 1, origin.ne + chunk_tiles);
+
+				// the influence reaches zero one tile beyond the radius
+				float falloff = source.strength / (radius + 1);
+
+				for (coord::tile_t se = se_begin; se < se_end; se++) {
+					for (coord::tile_t ne = ne_begin; ne < ne_end; ne++) {
+						float d_ne = ne - source.tile.ne;
+						float d_se = se - source.tile.se;
+						float distance = std::sqrt(d_ne * d_ne + d_se * d_se);
+						if (distance > radius) {
+							continue;
+						}
+
+						size_t index = (se - origin.se) * chunk_tiles + (ne - origin.ne);
+						plane_values[index] += source.strength - falloff * distance;
+					}
+				}
+			}
+		}
+	});
+}
+
+
+void InfluenceMap::publish() {
+	std::shared_ptr<pending_state> state = std::move(this->pending);
+	if (not state) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> guard{state->lock};
+		state->finished.wait(guard, [&state]() {
+			return state->done;
+		});
+	}
+
+	if (state->error) {
+		std::rethrow_exception(state->error);
+	}
+
+	std::lock_guard<std::mutex> guard{this->lock};
+	this->spare = std::move(this->current);
+	this->current = std::move(state->snapshot);
+}
+
+} // openage
@@ -0,0 +1,208 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/tile.h"
+#include "resource.h"
+
+namespace openage {
+
+class UnitContainer;
+
+namespace job {
+class JobManager;
+} // namespace job
+
+
+/**
+ * the layers of an influence map.
+ */
+enum class influence_layer {
+	threat,     //!< damage of a player's armed units in and around their range
+	territory,  //!< presence of a player's buildings and units
+	resources,  //!< remaining amount of a resource type, the same for all players
+};
+
+
+/**
+ * something that influences the tiles around it, e.g. a unit.
+ * its strength falls off linearly until radius tiles away.
+ */
+struct influence_source {
+	coord::tile tile;
+	influence_layer layer;
+
+	/**
+	 * the player for threat and territory,
+	 * the game_resource for resources
+	 */
+	unsigned index;
+
+	float strength;
+	int radius;
+};
+
+
+/**
+ * the influence maps of all players at one tick. they are stored for
+ * each terrain chunk, so they cover the same tiles as the terrain.
+ *
+ * once published by an InfluenceMap, a snapshot is not changed anymore.
+ */
+class InfluenceSnapshot {
+public:
+	InfluenceSnapshot();
+
+	/**
+	 * how much the armed units of the player threaten the tile.
+	 */
+	float get_threat(unsigned player, const coord::tile &tile) const;
+
+	/**
+	 * how much the tile belongs to the player.
+	 */
+	float get_territory(unsigned player, const coord::tile &tile) const;
+
+	/**
+	 * how much of the resource is around the tile.
+	 */
+	float get_resources(game_resource resource, const coord::tile &tile) const;
+
+	/**
+	 * the tick of the units the snapshot was computed from.
+	 */
+	uint64_t get_tick() const;
+
+private:
+	friend class InfluenceMap;
+
+	struct chunk_hash {
+		size_t operator ()(const coord::chunk &chunk) const;
+	};
+
+	/**
+	 * the values of a plane at the tile, 0 outside of the chunks.
+	 */
+	float get(size_t plane, const coord::tile &tile) const;
+
+	/**
+	 * the values of the planes of the chunk, one after the other.
+	 */
+	float *chunk_values(size_t chunk);
+
+	uint64_t tick;
+	size_t player_count;
+
+	/**
+	 * threat and territory for each player, and each resource
+	 */
+	size_t plane_count;
+
+	std::vector<coord::chunk> chunks;
+	std::unordered_map<coord::chunk, size_t, chunk_hash> chunk_index;
+
+	/**
+	 * the planes of all chunks, in the order of chunks
+	 */
+	std::vector<float> values;
+};
+
+
+/**
+ * Computes the influence maps AI players base their decisions on.
+ *
+ * The sources are collected on the simulation thread every few ticks,
+ * and the maps are computed from them on the workers of a job manager,
+ * one terrain chunk per task. Meanwhile the snapshot of the update before
+ * is read, it is replaced by the new one at the next update. The map
+ * shown at a tick thus doesn't depend on the speed of the workers, and
+ * is the same on all peers of a game.
+ */
+class InfluenceMap {
+public:
+	InfluenceMap();
+	~InfluenceMap();
+
+	InfluenceMap(const InfluenceMap &) = delete;
+	InfluenceMap &operator =(const InfluenceMap &) = delete;
+
+	/**
+	 * the influence of the units: their threat if they are armed,
+	 * their territory if they are owned, and their resources.
+	 */
+	static std::vector<influence_source> collect_sources(UnitContainer &units);
+
+	/**
+	 * publishes the snapshot computed since the last update, waiting
+	 * for it if necessary, and starts computing the next one.
+	 *
+	 * @param chunks the chunks the maps cover
+	 * @param job_manager computes the maps, nullptr computes them right away
+	 */
+	void update(std::vector<influence_source> sources,
+	            std::vector<coord::chunk> chunks,
+	            size_t player_count,
+	            uint64_t tick,
+	            job::JobManager *job_manager);
+
+	/**
+	 * the last published snapshot, thread safe.
+	 * the map is updated from then on.
+	 */
+	std::shared_ptr<const InfluenceSnapshot> get();
+
+	/**
+	 * whether get() was called, so the updates are needed.
+	 */
+	bool is_used() const;
+
+private:
+	/**
+	 * a snapshot being computed, shared with its job.
+	 */
+	struct pending_state {
+		std::mutex lock;
+		std::condition_variable finished;
+		bool done = false;
+
+		std::shared_ptr<InfluenceSnapshot> snapshot;
+		std::exception_ptr error;
+	};
+
+	/**
+	 * fills the snapshot with the influence of the sources.
+	 */
+	static void compute(InfluenceSnapshot &snapshot,
+	                    const std::vector<influence_source> &sources,
+	                    job::JobManager *job_manager);
+
+	/**
+	 * waits for the pending snapshot and makes it the current one.
+	 */
+	void publish();
+
+	mutable std::mutex lock;
+
+	std::shared_ptr<InfluenceSnapshot> current;
+
+	/**
+	 * the snapshot before the current one, reused if no reader has it.
+	 */
+	std::shared_ptr<InfluenceSnapshot> spare;
+
+	std::shared_ptr<pending_state> pending;
+
+	bool used;
+};
+
+} // openage
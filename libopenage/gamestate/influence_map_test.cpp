@@ -0,0 +1,92 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "influence_map.h"
+
+#include <cmath>
+
+#include "../job/job_manager.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace gamestate {
+namespace tests {
+
+
+// exported test
+void influence_map() {
+	std::vector<coord::chunk> chunks;
+	for (coord::chunk_t se = -2; se < 2; se++) {
+		for (coord::chunk_t ne = -2; ne < 2; ne++) {
+			chunks.push_back(coord::chunk{ne, se});
+		}
+	}
+
+	std::vector<influence_source> sources{
+		{coord::tile{0, 0}, influence_layer::threat, 0, 6, 2},
+		{coord::tile{1, 0}, influence_layer::threat, 0, 3, 2},
+		{coord::tile{-20, 5}, influence_layer::territory, 1, 4, 6},
+		{coord::tile{10, 10}, influence_layer::resources,
+		 static_cast<unsigned>(game_resource::gold), 100, 3},
+		// players that are not in the game are ignored
+		{coord::tile{0, 0}, influence_layer::threat, 7, 1, 2},
+	};
+
+	InfluenceMap map;
+	map.get()->get_threat(0, coord::tile{0, 0}) == 0 or TESTFAIL;
+
+	// an update is published at the next one
+	map.update(sources, chunks, 2, 10, nullptr);
+	map.get()->get_tick() == 0 or TESTFAIL;
+	map.update({}, chunks, 2, 20, nullptr);
+
+	std::shared_ptr<const InfluenceSnapshot> serial = map.get();
+	serial->get_tick() == 10 or TESTFAIL;
+
+	// the influence falls off to zero one tile beyond the radius,
+	// the sources add up, also across the chunk borders
+	TESTEQUALS_FLOAT(serial->get_threat(0, coord::tile{0, 0}), 6 + 3 - 1, 1e-5);
+	TESTEQUALS_FLOAT(serial->get_threat(0, coord::tile{-2, 0}), 2, 1e-5);
+	TESTEQUALS_FLOAT(serial->get_threat(0, coord::tile{0, -1}), 4 + 3 - std::sqrt(2.0f), 1e-5);
+	serial->get_threat(0, coord::tile{-3, 0}) == 0 or TESTFAIL;
+	serial->get_threat(1, coord::tile{0, 0}) == 0 or TESTFAIL;
+	serial->get_threat(7, coord::tile{0, 0}) == 0 or TESTFAIL;
+
+	TESTEQUALS_FLOAT(serial->get_territory(1, coord::tile{-20, 5}), 4, 1e-5);
+	serial->get_territory(0, coord::tile{-20, 5}) == 0 or TESTFAIL;
+	TESTEQUALS_FLOAT(serial->get_resources(game_resource::gold, coord::tile{10, 12}), 50, 1e-5);
+	serial->get_resources(game_resource::wood, coord::tile{10, 12}) == 0 or TESTFAIL;
+
+	// outside of the chunks
+	serial->get_resources(game_resource::gold, coord::tile{40, 40}) == 0 or TESTFAIL;
+
+	// the snapshot of a reader is not reused by later updates
+	map.update({}, chunks, 2, 30, nullptr);
+	map.update({}, chunks, 2, 40, nullptr);
+	serial->get_tick() == 10 or TESTFAIL;
+
+	// the workers compute the same values
+	job::JobManager manager{4};
+	manager.start();
+
+	InfluenceMap parallel;
+	parallel.update(sources, chunks, 2, 10, &manager);
+	parallel.update({}, chunks, 2, 20, &manager);
+	std::shared_ptr<const InfluenceSnapshot> result = parallel.get();
+	manager.stop();
+
+	result->get_tick() == 10 or TESTFAIL;
+	for (coord::tile_t se = -32; se < 32; se++) {
+		for (coord::tile_t ne = -32; ne < 32; ne++) {
+			coord::tile tile{ne, se};
+			for (unsigned player = 0; player < 2; player++) {
+				TESTEQUALS(result->get_threat(player, tile), serial->get_threat(player, tile));
+				TESTEQUALS(result->get_territory(player, tile), serial->get_territory(player, tile));
+			}
+			TESTEQUALS(result->get_resources(game_resource::gold, tile),
+			           serial->get_resources(game_resource::gold, tile));
+		}
+	}
+}
+
+
+}}} // openage::gamestate::tests
@@ -0,0 +1,532 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "lockstep.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "../error/error.h"
+#include "../log/log.h"
+#include "../unit/unit.h"
+#include "game_main.h"
+#include "player.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * bits of the varint that starts a command:
+ * the targets, then the flags, then the abilities.
+ */
+constexpr unsigned has_unit_bit = 0;
+constexpr unsigned has_position_bit = 1;
+constexpr unsigned has_type_bit = 2;
+constexpr unsigned flags_shift = 3;
+constexpr unsigned abilities_shift = flags_shift + command_flag_count;
+
+static_assert(abilities_shift + ability_type_size <= 64, "the command bits don't fit into a varint");
+
+
+void write_varint(uint64_t value, std::string &out) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+
+/**
+ * small negative numbers are stored as small varints as well.
+ */
+void write_signed(int64_t value, std::string &out) {
+	uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	write_varint(zigzag, out);
+}
+
+
+void write_fixed(uint64_t value, std::string &out) {
+	for (int i = 0; i < 8; i++) {
+		out.push_back(static_cast<char>(value >> (8 * i)));
+	}
+}
+
+
+void write_unit(id_t id, uint32_t previous_slot, std::string &out) {
+	write_varint(static_cast<uint32_t>(id) - previous_slot, out);
+	write_varint(id >> 32, out);
+}
+
+
+class Reader {
+public:
+	Reader(const char *data, size_t size)
+		:
+		pos{reinterpret_cast<const uint8_t *>(data)},
+		end{reinterpret_cast<const uint8_t *>(data) + size} {}
+
+	uint64_t varint() {
+		uint64_t value = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7) {
+			if (this->pos == this->end) {
+				throw Error(MSG(err) << "command batch is truncated");
+			}
+			uint8_t byte = *this->pos++;
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+		throw Error(MSG(err) << "command batch has an overlong number");
+	}
+
+	uint64_t fixed() {
+		if (this->end - this->pos < 8) {
+			throw Error(MSG(err) << "command batch is truncated");
+		}
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++) {
+			value |= static_cast<uint64_t>(*this->pos++) << (8 * i);
+		}
+		return value;
+	}
+
+	int64_t signed_varint() {
+		uint64_t zigzag = this->varint();
+		return static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+	}
+
+	/**
+	 * a count of entries which take at least one byte each.
+	 */
+	size_t count() {
+		uint64_t value = this->varint();
+		if (value > static_cast<uint64_t>(this->end - this->pos)) {
+			throw Error(MSG(err) << "command batch has an invalid count");
+		}
+		return value;
+	}
+
+	id_t unit(uint32_t previous_slot) {
+		uint64_t slot = previous_slot + this->varint();
+		uint64_t generation = this->varint();
+		if (slot > UINT32_MAX or generation > UINT32_MAX) {
+			throw Error(MSG(err) << "command batch has an invalid unit id");
+		}
+		return (generation << 32) | slot;
+	}
+
+	bool done() const {
+		return this->pos == this->end;
+	}
+
+private:
+	const uint8_t *pos;
+	const uint8_t *end;
+};
+
+} // anonymous namespace
+
+
+void encode_command_batch(const command_batch &batch, std::string &out) {
+	write_varint(batch.tick, out);
+	write_varint(batch.player, out);
+
+	write_varint(batch.has_state_hash, out);
+	if (batch.has_state_hash) {
+		for (uint64_t part : batch.state_hash) {
+			write_fixed(part, out);
+		}
+	}
+
+	write_varint(batch.commands.size(), out);
+
+	std::vector<id_t> units;
+	for (auto &cmd : batch.commands) {
+		uint64_t bits = (static_cast<uint64_t>(cmd.has_unit) << has_unit_bit)
+		                | (static_cast<uint64_t>(cmd.has_position) << has_position_bit)
+		                | (static_cast<uint64_t>(cmd.has_type) << has_type_bit)
+		                | (static_cast<uint64_t>(cmd.flags.to_ulong()) << flags_shift)
+		                | (static_cast<uint64_t>(cmd.abilities.to_ulong()) << abilities_shift);
+		write_varint(bits, out);
+
+		if (cmd.has_unit) {
+			write_unit(cmd.target_unit, 0, out);
+		}
+		if (cmd.has_position) {
+			write_signed(cmd.position.ne, out);
+			write_signed(cmd.position.se, out);
+			write_signed(cmd.position.up, out);
+		}
+		if (cmd.has_type) {
+			write_signed(cmd.type_id, out);
+		}
+
+		// neighbouring slots differ by little
+		units = cmd.units;
+		std::sort(units.begin(), units.end(), [](id_t a, id_t b) {
+			return static_cast<uint32_t>(a) < static_cast<uint32_t>(b);
+		});
+
+		write_varint(units.size(), out);
+		uint32_t previous_slot = 0;
+		for (id_t id : units) {
+			write_unit(id, previous_slot, out);
+			previous_slot = static_cast<uint32_t>(id);
+		}
+	}
+}
+
+
+command_batch decode_command_batch(const char *data, size_t size) {
+	Reader in{data, size};
+	command_batch batch;
+
+	batch.tick = in.varint();
+	batch.player = in.varint();
+
+	uint64_t has_state_hash = in.varint();
+	if (has_state_hash > 1) {
+		throw Error(MSG(err) << "command batch has an invalid state hash flag");
+	}
+	batch.has_state_hash = has_state_hash;
+	if (batch.has_state_hash) {
+		for (auto &part : batch.state_hash) {
+			part = in.fixed();
+		}
+	}
+
+	size_t count = in.count();
+	batch.commands.resize(count);
+	for (auto &cmd : batch.commands) {
+		uint64_t bits = in.varint();
+		if (bits >> (abilities_shift + ability_type_size) != 0) {
+			throw Error(MSG(err) << "command batch has unknown command bits");
+		}
+
+		cmd.player = batch.player;
+		cmd.has_unit = (bits >> has_unit_bit) & 1;
+		cmd.has_position = (bits >> has_position_bit) & 1;
+		cmd.has_type = (bits >> has_type_bit) & 1;
+		cmd.flags = std::bitset<command_flag_count>((bits >> flags_shift) & ((1u << command_flag_count) - 1));
+		cmd.abilities = ability_set(bits >> abilities_shift);
+
+		if (cmd.has_unit) {
+			cmd.target_unit = in.unit(0);
+		}
+		if (cmd.has_position) {
+			cmd.position.ne = in.signed_varint();
+			cmd.position.se = in.signed_varint();
+			cmd.position.up = in.signed_varint();
+		}
+		if (cmd.has_type) {
+			cmd.type_id = static_cast<int>(in.signed_varint());
+		}
+
+		size_t units = in.count();
+		cmd.units.reserve(units);
+		uint32_t previous_slot = 0;
+		for (size_t i = 0; i < units; i++) {
+			cmd.units.push_back(in.unit(previous_slot));
+			previous_slot = static_cast<uint32_t>(cmd.units.back());
+		}
+	}
+
+	if (not in.done()) {
+		throw Error(MSG(err) << "command batch has trailing data");
+	}
+	return batch;
+}
+
+
+command_record record_command(const GroupCommand &group) {
+	const Command &cmd = group.command;
+	command_record record;
+
+	record.player = cmd.player.player_number;
+	record.has_unit = cmd.has_unit();
+	record.has_position = cmd.has_position();
+	record.has_type = cmd.has_type();
+
+	if (record.has_unit) {
+		record.target_unit = cmd.unit()->id;
+	}
+	if (record.has_position) {
+		record.position = cmd.position();
+	}
+	if (record.has_type) {
+		record.type_id = cmd.type()->id();
+	}
+
+	record.abilities = cmd.ability();
+	for (size_t i = 0; i < command_flag_count; i++) {
+		record.flags[i] = cmd.has_flag(static_cast<command_flag>(i));
+	}
+
+	record.units.reserve(group.units.size());
+	for (auto &ref : group.units) {
+		if (ref.is_valid()) {
+			record.units.push_back(ref.get()->id);
+		}
+	}
+	return record;
+}
+
+
+std::unique_ptr<GroupCommand> restore_command(const command_record &record, GameMain &game) {
+	if (record.player >= game.player_count()) {
+		return nullptr;
+	}
+	const Player &player = *game.get_player(record.player);
+
+	Unit *target = nullptr;
+	if (record.has_unit) {
+		UnitReference ref = game.placed_units.get_unit(record.target_unit);
+		if (not ref.is_valid()) {
+			return nullptr;
+		}
+		target = ref.get();
+	}
+
+	UnitType *type = nullptr;
+	if (record.has_type) {
+		type = player.get_type(record.type_id);
+		if (type == nullptr) {
+			return nullptr;
+		}
+	}
+
+	std::unique_ptr<GroupCommand> group;
+	if (target != nullptr and record.has_position) {
+		group = std::make_unique<GroupCommand>(Command{player, target, record.position});
+	}
+	else if (target != nullptr) {
+		group = std::make_unique<GroupCommand>(Command{player, target});
+	}
+	else if (type != nullptr and record.has_position) {
+		group = std::make_unique<GroupCommand>(Command{player, type, record.position});
+	}
+	else if (type != nullptr) {
+		group = std::make_unique<GroupCommand>(Command{player, type});
+	}
+	else if (record.has_position) {
+		group = std::make_unique<GroupCommand>(Command{player, record.position});
+	}
+	else {
+		return nullptr;
+	}
+
+	group->command.set_ability_set(record.abilities);
+	for (size_t i = 0; i < command_flag_count; i++) {
+		if (record.flags[i]) {
+			group->command.add_flag(static_cast<command_flag>(i));
+		}
+	}
+
+	// the units may have died since the command was given
+	for (id_t id : record.units) {
+		UnitReference ref = game.placed_units.get_unit(id);
+		if (ref.is_valid() and ref.get()->is_own_unit(player)) {
+			group->units.push_back(ref);
+		}
+	}
+	return group;
+}
+
+
+LockstepSession::LockstepSession(unsigned int local_player,
+                                 std::vector<unsigned int> players,
+                                 send_function_t send,
+                                 unsigned int input_delay)
+	:
+	local_player{local_player},
+	players{std::move(players)},
+	send{std::move(send)},
+	input_delay{input_delay},
+	tick{0},
+	state_hash{nullptr},
+	hash_interval{1},
+	desynced{false},
+	desync_tick{0} {
+
+	// commands are dispatched in the order of the players on all peers
+	std::sort(this->players.begin(), this->players.end());
+	this->players.erase(std::unique(this->players.begin(), this->players.end()), this->players.end());
+	this->player_index(local_player);
+
+	this->local.tick = input_delay;
+	this->local.player = local_player;
+}
+
+
+void LockstepSession::submit(const GroupCommand &group) {
+	this->submit(record_command(group));
+}
+
+
+void LockstepSession::submit(command_record record) {
+	ENSURE(record.player == this->local_player,
+	       "only the local player's commands can be submitted");
+
+	this->local.commands.push_back(std::move(record));
+}
+
+
+void LockstepSession::receive(const char *data, size_t size) {
+	auto batch = std::make_unique<command_batch>(decode_command_batch(data, size));
+
+	if (batch->player == this->local_player) {
+		throw Error(MSG(err) << "received a command batch of the local player " << batch->player);
+	}
+
+	if (batch->tick < std::max<uint64_t>(this->tick, this->input_delay)) {
+		log::log(MSG(warn) << "dropped the command batch of player " << batch->player
+		         << " for the past tick " << batch->tick);
+		return;
+	}
+
+	this->store(std::move(batch));
+}
+
+
+bool LockstepSession::ready() const {
+	// nobody could give commands for the first ticks
+	if (this->tick < this->input_delay) {
+		return true;
+	}
+
+	auto it = this->pending.find(this->tick);
+	return it != this->pending.end() and it->second.received == this->players.size();
+}
+
+
+void LockstepSession::advance(const std::function<void(const command_record &)> &dispatch) {
+	ENSURE(this->ready(), "the commands of the tick are not complete");
+
+	// all peers hash the state before the same tick
+	if (this->state_hash and this->tick % this->hash_interval == 0) {
+		this->local.has_state_hash = true;
+		this->local.state_hash = this->state_hash->get_parts();
+	}
+
+	// the local commands of this tick are sent, even none,
+	// so the peers know that they are complete.
+	std::string message;
+	encode_command_batch(this->local, message);
+	this->send(message);
+
+	uint64_t next_local = this->local.tick + 1;
+	this->store(std::make_unique<command_batch>(std::move(this->local)));
+	this->local = command_batch{};
+	this->local.tick = next_local;
+	this->local.player = this->local_player;
+
+	auto it = this->pending.find(this->tick);
+	if (it != this->pending.end()) {
+		this->check_state_hashes(it->second);
+
+		for (auto &batch : it->second.batches) {
+			for (auto &cmd : batch->commands) {
+				dispatch(cmd);
+			}
+		}
+		this->pending.erase(it);
+	}
+
+	this->tick += 1;
+}
+
+
+void LockstepSession::apply(GameMain &game) {
+	this->advance([&game](const command_record &record) {
+		game.dispatch_command(record);
+	});
+}
+
+
+uint64_t LockstepSession::get_tick() const {
+	return this->tick;
+}
+
+
+void LockstepSession::set_state_hash(const StateHash *state_hash, unsigned int interval) {
+	this->state_hash = state_hash;
+	this->hash_interval = std::max(interval, 1u);
+}
+
+
+bool LockstepSession::in_sync() const {
+	return not this->desynced;
+}
+
+
+uint64_t LockstepSession::get_desync_tick() const {
+	return this->desync_tick;
+}
+
+
+const std::vector<state_part> &LockstepSession::get_desync_parts() const {
+	return this->desync_parts;
+}
+
+
+void LockstepSession::check_state_hashes(const tick_batches &entry) {
+	const command_batch *first = nullptr;
+
+	for (auto &batch : entry.batches) {
+		if (not batch->has_state_hash) {
+			continue;
+		}
+		if (first == nullptr) {
+			first = batch.get();
+			continue;
+		}
+
+		std::vector<state_part> parts = StateHash::diverged(first->state_hash, batch->state_hash);
+		if (parts.empty()) {
+			continue;
+		}
+
+		std::string names;
+		for (state_part part : parts) {
+			names += std::string{" "} + state_part_name(part);
+		}
+		log::log(MSG(err) << "desync of players " << first->player << " and " << batch->player
+		         << " before tick " << batch->tick - this->input_delay << " in:" << names);
+
+		if (not this->desynced) {
+			this->desynced = true;
+			this->desync_tick = batch->tick - this->input_delay;
+			this->desync_parts = std::move(parts);
+		}
+	}
+}
+
+
+size_t LockstepSession::player_index(unsigned int player) const {
+	auto it = std::lower_bound(this->players.begin(), this->players.end(), player);
+	if (it == this->players.end() or *it != player) {
+		throw Error(MSG(err) << "player " << player << " is not part of the lockstep session");
+	}
+	return it - this->players.begin();
+}
+
+
+void LockstepSession::store(std::unique_ptr<command_batch> batch) {
+	size_t index = this->player_index(batch->player);
+
+	tick_batches &entry = this->pending[batch->tick];
+	entry.batches.resize(this->players.size());
+
+	if (entry.batches[index]) {
+		log::log(MSG(warn) << "dropped a second command batch of player " << batch->player
+		         << " for tick " << batch->tick);
+		return;
+	}
+
+	entry.batches[index] = std::move(batch);
+	entry.received += 1;
+}
+
+} // openage
@@ -0,0 +1,228 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "../unit/ability.h"
+#include "../unit/command.h"
+#include "../unit/unit_container.h"
+#include "state_hash.h"
+
+namespace openage {
+
+class GameMain;
+
+
+/**
+ * a command of a player to a group of units, in the form
+ * that is exchanged between the peers of a game.
+ */
+struct command_record {
+	unsigned int player = 0;
+
+	bool has_unit = false;
+	bool has_position = false;
+	bool has_type = false;
+
+	id_t target_unit = 0;
+	coord::phys3 position{0, 0, 0};
+	int type_id = 0;
+
+	ability_set abilities;
+	std::bitset<command_flag_count> flags;
+
+	/**
+	 * the commanded units.
+	 */
+	std::vector<id_t> units;
+};
+
+
+/**
+ * the commands of one player for one tick.
+ */
+struct command_batch {
+	uint64_t tick = 0;
+	unsigned int player = 0;
+	std::vector<command_record> commands;
+
+	/**
+	 * the state hash of the sender's game when the batch was sealed,
+	 * which is the same tick on all peers.
+	 */
+	bool has_state_hash = false;
+	state_parts_t state_hash{};
+};
+
+
+/**
+ * appends the batch to out.
+ *
+ * numbers are stored as varints, the units of a command are sorted by
+ * their slot and stored as the difference to the previous one, and the
+ * abilities, flags and targets of a command share one varint. a command
+ * to a hundred units thus takes a bit more than 200 bytes, an empty
+ * batch 4 bytes, and 32 more with a state hash.
+ */
+void encode_command_batch(const command_batch &batch, std::string &out);
+
+/**
+ * reads a batch written by encode_command_batch.
+ * throws an Error if the data is invalid.
+ */
+command_batch decode_command_batch(const char *data, size_t size);
+
+/**
+ * the record of a group command, to be sent to the peers.
+ */
+command_record record_command(const GroupCommand &group);
+
+/**
+ * recreates the group command of a record in the game. units that no
+ * longer exist or are not owned by the player are left out.
+ *
+ * @returns nullptr if the player, the target or the type is unknown
+ */
+std::unique_ptr<GroupCommand> restore_command(const command_record &record, GameMain &game);
+
+
+/**
+ * Deterministic lockstep of the player commands.
+ *
+ * All peers simulate the same ticks from the same commands: a command
+ * given by the local player is not dispatched right away, but scheduled
+ * for the tick that is input_delay ticks ahead. The commands of each
+ * tick are collected in a batch, which is sent to the other peers when
+ * the tick is sealed, even if it is empty. A tick is only simulated
+ * once the batches of all players for it are there, then the commands
+ * are dispatched in the order of the players.
+ *
+ * With a state hash, the batches carry the hash of the game in regular
+ * intervals. The peers seal a batch before the same tick, so the hashes
+ * are compared once all batches are there, and a mismatch is reported
+ * with the parts of the state that diverged.
+ *
+ * The transport is not part of the session: the sealed batches are
+ * passed to the send function, and the ones of the other peers are
+ * given to receive().
+ */
+class LockstepSession {
+public:
+	using send_function_t = std::function<void(const std::string &message)>;
+
+	/**
+	 * @param local_player: the player commanding on this peer
+	 * @param players: all players giving commands, including the local one
+	 * @param send: is called with each local batch for the other peers
+	 * @param input_delay: ticks between giving a command and its dispatch
+	 */
+	LockstepSession(unsigned int local_player,
+	                std::vector<unsigned int> players,
+	                send_function_t send,
+	                unsigned int input_delay=4);
+
+	/**
+	 * schedules a command of the local player.
+	 */
+	void submit(const GroupCommand &group);
+	void submit(command_record record);
+
+	/**
+	 * stores a batch that was sent by another peer.
+	 * throws an Error if it is invalid or from an unknown player.
+	 */
+	void receive(const char *data, size_t size);
+
+	/**
+	 * whether the batches of all players for the next tick are there.
+	 */
+	bool ready() const;
+
+	/**
+	 * seals the local batch that is due in input_delay ticks, then
+	 * calls dispatch for the commands of the next tick, which must be
+	 * ready, and moves on to the tick after.
+	 */
+	void advance(const std::function<void(const command_record &)> &dispatch);
+
+	/**
+	 * advance() that dispatches the commands in the game.
+	 */
+	void apply(GameMain &game);
+
+	/**
+	 * the tick whose commands are dispatched next.
+	 */
+	uint64_t get_tick() const;
+
+	/**
+	 * send the hash of the game every interval ticks, and compare
+	 * it with the ones of the other peers. nullptr sends none.
+	 */
+	void set_state_hash(const StateHash *state_hash, unsigned int interval=20);
+
+	/**
+	 * whether all state hashes of the peers matched so far.
+	 */
+	bool in_sync() const;
+
+	/**
+	 * the tick of the first batches whose hashes differed, and the
+	 * parts that differed then. only valid if not in_sync().
+	 */
+	uint64_t get_desync_tick() const;
+	const std::vector<state_part> &get_desync_parts() const;
+
+private:
+	/**
+	 * the received batches of one tick, indexed like players.
+	 */
+	struct tick_batches {
+		std::vector<std::unique_ptr<command_batch>> batches;
+		size_t received = 0;
+	};
+
+	/**
+	 * the index of a player in players, throws for unknown players.
+	 */
+	size_t player_index(unsigned int player) const;
+
+	void store(std::unique_ptr<command_batch> batch);
+
+	/**
+	 * compares the state hashes of the batches of a tick.
+	 */
+	void check_state_hashes(const tick_batches &entry);
+
+	unsigned int local_player;
+	std::vector<unsigned int> players;
+	send_function_t send;
+	unsigned int input_delay;
+
+	uint64_t tick;
+
+	/**
+	 * the commands of the local player, for tick + input_delay.
+	 */
+	command_batch local;
+
+	std::map<uint64_t, tick_batches> pending;
+
+	const StateHash *state_hash;
+	unsigned int hash_interval;
+
+	bool desynced;
+	uint64_t desync_tick;
+	std::vector<state_part> desync_parts;
+};
+
+} // openage
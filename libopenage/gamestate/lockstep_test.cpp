@@ -0,0 +1,164 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "lockstep.h"
+
+#include <string>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace gamestate {
+namespace tests {
+
+namespace {
+
+id_t unit_id(uint32_t slot, uint32_t generation) {
+	return (static_cast<id_t>(generation) << 32) | slot;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void lockstep() {
+	// a mass order: a hundred units to a position
+	command_record move;
+	move.player = 2;
+	move.has_position = true;
+	move.position = coord::phys3{-70000, 1 << 20, 0};
+	move.abilities[static_cast<int>(ability_type::move)] = true;
+	move.flags[static_cast<size_t>(command_flag::direct)] = true;
+	for (uint32_t i = 0; i < 100; i++) {
+		move.units.push_back(unit_id(500 - 3 * i, i % 2));
+	}
+
+	command_record train;
+	train.player = 2;
+	train.has_type = true;
+	train.type_id = 83;
+	train.abilities.set();
+	train.units.push_back(unit_id(7, 1));
+
+	command_batch batch;
+	batch.tick = 123456;
+	batch.player = 2;
+	batch.commands = {move, train};
+	batch.has_state_hash = true;
+	batch.state_hash = {1, UINT64_MAX, 3, 0};
+
+	std::string encoded;
+	encode_command_batch(batch, encoded);
+	encoded.size() < 280 or TESTFAIL;
+
+	command_batch decoded = decode_command_batch(encoded.data(), encoded.size());
+	decoded.tick == batch.tick or TESTFAIL;
+	decoded.player == 2 or TESTFAIL;
+	(decoded.has_state_hash and decoded.state_hash == batch.state_hash) or TESTFAIL;
+	decoded.commands.size() == 2 or TESTFAIL;
+
+	const command_record &got = decoded.commands[0];
+	(got.has_position and not got.has_unit and not got.has_type) or TESTFAIL;
+	got.position == move.position or TESTFAIL;
+	got.abilities == move.abilities or TESTFAIL;
+	got.flags == move.flags or TESTFAIL;
+	got.units.size() == 100 or TESTFAIL;
+
+	// the units are sent sorted by their slot
+	got.units.front() == unit_id(203, 1) or TESTFAIL;
+	got.units.back() == unit_id(500, 0) or TESTFAIL;
+
+	decoded.commands[1].type_id == 83 or TESTFAIL;
+	decoded.commands[1].abilities.all() or TESTFAIL;
+
+	// damaged batches are rejected
+	TESTTHROWS(decode_command_batch(encoded.data(), encoded.size() - 1));
+	TESTTHROWS(decode_command_batch((encoded + "x").data(), encoded.size() + 1));
+
+	// two peers, connected directly
+	std::vector<std::string> to_second, to_first;
+	LockstepSession first{1, {1, 2}, [&](const std::string &msg) { to_second.push_back(msg); }, 2};
+	LockstepSession second{2, {1, 2}, [&](const std::string &msg) { to_first.push_back(msg); }, 2};
+
+	std::vector<uint64_t> first_dispatched, second_dispatched;
+
+	// player 2 orders in tick 0, it is dispatched in tick 2 on both peers
+	second.submit(move);
+
+	auto deliver = [&]() {
+		for (auto &msg : to_first) {
+			first.receive(msg.data(), msg.size());
+		}
+		for (auto &msg : to_second) {
+			second.receive(msg.data(), msg.size());
+		}
+		to_first.clear();
+		to_second.clear();
+	};
+
+	for (int tick = 0; tick < 4; tick++) {
+		first.ready() or TESTFAIL;
+		second.ready() or TESTFAIL;
+
+		first.advance([&](const command_record &) { first_dispatched.push_back(first.get_tick()); });
+		second.advance([&](const command_record &) { second_dispatched.push_back(second.get_tick()); });
+		deliver();
+	}
+
+	first_dispatched == std::vector<uint64_t>{2} or TESTFAIL;
+	second_dispatched == first_dispatched or TESTFAIL;
+
+	// a peer running ahead waits for the batches of the other one
+	auto ignore = [](const command_record &) {};
+	first.advance(ignore);
+	first.advance(ignore);
+	first.ready() and TESTFAIL;
+
+	second.advance(ignore);
+	deliver();
+	first.ready() or TESTFAIL;
+
+	// the state hashes of the peers are compared
+	StateHash first_state, second_state;
+	LockstepSession hashed_first{1, {1, 2}, [&](const std::string &msg) { to_second.push_back(msg); }, 1};
+	LockstepSession hashed_second{2, {1, 2}, [&](const std::string &msg) { to_first.push_back(msg); }, 1};
+	hashed_first.set_state_hash(&first_state, 1);
+	hashed_second.set_state_hash(&second_state, 1);
+
+	for (int tick = 0; tick < 3; tick++) {
+		// the second peer moved a unit the first one didn't
+		if (tick == 1) {
+			second_state.add(state_part::positions, 5, 1);
+		}
+
+		hashed_first.advance(ignore);
+		hashed_second.advance(ignore);
+		for (auto &msg : to_first) {
+			hashed_first.receive(msg.data(), msg.size());
+		}
+		for (auto &msg : to_second) {
+			hashed_second.receive(msg.data(), msg.size());
+		}
+		to_first.clear();
+		to_second.clear();
+
+		// the hashes of a tick are compared when its batches are dispatched
+		(hashed_first.in_sync() == (tick < 2)) or TESTFAIL;
+	}
+
+	hashed_second.in_sync() and TESTFAIL;
+	hashed_first.get_desync_tick() == 1 or TESTFAIL;
+	hashed_first.get_desync_parts() == std::vector<state_part>{state_part::positions} or TESTFAIL;
+
+	// only the players of the session send batches
+	command_batch stranger;
+	stranger.tick = 10;
+	stranger.player = 3;
+	std::string stranger_msg;
+	encode_command_batch(stranger, stranger_msg);
+	TESTTHROWS(first.receive(stranger_msg.data(), stranger_msg.size()));
+}
+
+
+}}} // openage::gamestate::tests
@@ -3,6 +3,11 @@
 #include "player.h"
 #include "market.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include "../error/error.h"
+
 namespace openage {
 
 Market::Market() {
@@ -15,38 +20,80 @@ Market::Market() {
 // Price calculation is documented at doc/reverse_engineering/market.md#prices
 
 bool Market::sell(Player &player, const game_resource res) {
-	// deduct the standard MARKET_TRANSACTION_AMOUNT of the selling res
-	if (player.deduct(res, MARKET_TRANSACTION_AMOUNT)) {
-		// if deduct was successful
-		// calc the gold received from selling MARKET_TRANSACTION_AMOUNT of res
-		double amount = this->get_sell_prices(player).get(res);
-		player.receive(game_resource::gold, amount);
-
-		// decrease the price
-		this->base_prices[res] -= MARKET_PRICE_D;
-		if (this->base_prices.get(res) < MARKET_PRICE_MIN) {
-			this->base_prices[res] = MARKET_PRICE_MIN;
-		}
-		return true;
-	}
-	return false;
+	return this->sell(player, res, 1) == 1;
 }
 
 bool Market::buy(Player &player, const game_resource res) {
-	// calc the gold needed to buy MARKET_TRANSACTION_AMOUNT of res
-	double price = this->get_buy_prices(player).get(res);
-	if (player.deduct(game_resource::gold, price)) {
-		// if deduct was successful
-		player.receive(res, MARKET_TRANSACTION_AMOUNT);
-
-		// increase the price
-		this->base_prices[res] += MARKET_PRICE_D;
-		if (this->base_prices.get(res) > MARKET_PRICE_MAX) {
-			this->base_prices[res] = MARKET_PRICE_MAX;
+	return this->buy(player, res, 1) == 1;
+}
+
+unsigned int Market::sell(Player &player, const game_resource res, unsigned int count) {
+	// the transactions of MARKET_TRANSACTION_AMOUNT the stockpile allows
+	double sellable = std::floor(player.amount(res) / MARKET_TRANSACTION_AMOUNT);
+	if (sellable < count) {
+		count = static_cast<unsigned int>(sellable);
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	double mult = this->get_multiplier(player, false);
+	double base = this->base_prices.get(res);
+
+	// the price decreases with each transaction until the minimum,
+	// the transactions at the minimum all have the same price.
+	double gold = 0;
+	unsigned int done = 0;
+	for (; done < count and base - done * MARKET_PRICE_D > MARKET_PRICE_MIN; done++) {
+		gold += std::round((base - done * MARKET_PRICE_D) * mult);
+	}
+	gold += (count - done) * std::round(MARKET_PRICE_MIN * mult);
+
+	bool deducted = player.deduct(res, count * MARKET_TRANSACTION_AMOUNT);
+	ENSURE(deducted, "the stockpile didn't allow the checked sale");
+	player.receive(game_resource::gold, gold);
+
+	this->base_prices[res] = std::max(base - count * MARKET_PRICE_D, MARKET_PRICE_MIN);
+	return count;
+}
+
+unsigned int Market::buy(Player &player, const game_resource res, unsigned int count) {
+	double mult = this->get_multiplier(player, true);
+	double base = this->base_prices.get(res);
+	double available = player.amount(game_resource::gold);
+
+	// the price increases with each transaction until the maximum,
+	// the transactions at the maximum all have the same price.
+	double gold = 0;
+	unsigned int done = 0;
+	for (; done < count and base + done * MARKET_PRICE_D < MARKET_PRICE_MAX; done++) {
+		double price = std::round((base + done * MARKET_PRICE_D) * mult);
+		if (gold + price > available) {
+			count = done;
+			break;
 		}
-		return true;
+		gold += price;
 	}
-	return false;
+
+	if (done < count) {
+		double price = std::round(MARKET_PRICE_MAX * mult);
+		double affordable = std::floor((available - gold) / price);
+		if (affordable < count - done) {
+			count = done + static_cast<unsigned int>(affordable);
+		}
+		gold += (count - done) * price;
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	bool deducted = player.deduct(game_resource::gold, gold);
+	ENSURE(deducted, "the stockpile didn't allow the checked purchase");
+	player.receive(res, count * MARKET_TRANSACTION_AMOUNT);
+
+	this->base_prices[res] = std::min(base + count * MARKET_PRICE_D, MARKET_PRICE_MAX);
+	return count;
 }
 
 ResourceBundle Market::get_buy_prices(const Player &player) const {
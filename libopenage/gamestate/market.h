@@ -34,6 +34,22 @@ public:
 	 */
 	bool buy(Player &player, const game_resource res);
 
+	/**
+	 * The given player sells the given resource count times, or as often as
+	 * the stockpile allows. The prices change as after each single sale,
+	 * but the stockpile is changed once.
+	 * Returns the number of transactions made.
+	 */
+	unsigned int sell(Player &player, const game_resource res, unsigned int count);
+
+	/**
+	 * The given player buys the given resource count times, or as often as
+	 * the gold allows. The prices change as after each single purchase,
+	 * but the stockpile is changed once.
+	 * Returns the number of transactions made.
+	 */
+	unsigned int buy(Player &player, const game_resource res, unsigned int count);
+
 	/**
 	 * Get the selling prices for a given player.
 	 */
@@ -0,0 +1,242 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "pathfinding_benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "../error/error.h"
+#include "../pathfinding/a_star.h"
+#include "../pathfinding/flow_field.h"
+#include "../pathfinding/heuristics.h"
+#include "../pathfinding/path.h"
+#include "../pathfinding/search_context.h"
+#include "../rng/rng.h"
+#include "../util/duration_histogram.h"
+#include "../util/heap.h"
+#include "../util/timing.h"
+#include "generator.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * the densest map that still leaves room for queries.
+ */
+constexpr double max_obstacle_density = 0.9;
+
+
+coord::tile random_tile_in(rng::RNG &rng, coord::tile start, coord::tile_delta extent) {
+	return coord::tile{
+		start.ne + static_cast<coord::tile_t>(rng.random() % extent.ne),
+		start.se + static_cast<coord::tile_t>(rng.random() % extent.se)
+	};
+}
+
+
+/**
+ * adds random blocks of up to 8x8 tiles, like forests,
+ * until the given fraction of the map is blocked.
+ */
+void add_obstacles(rng::RNG &rng, tileset_t &obstacles, double density) {
+	coord::tile start = obstacles.get_start();
+	coord::tile_delta extent = obstacles.get_extent();
+	size_t target = static_cast<size_t>(density * extent.ne * extent.se);
+
+	while (obstacles.size() < target) {
+		coord::tile corner = random_tile_in(rng, start, extent);
+		coord::tile_t size_ne = 1 + rng.random() % 8;
+		coord::tile_t size_se = 1 + rng.random() % 8;
+		for (coord::tile_t ne = 0; ne < size_ne; ne++) {
+			for (coord::tile_t se = 0; se < size_se; se++) {
+				obstacles.insert(corner + coord::tile_delta{ne, se});
+			}
+		}
+	}
+}
+
+
+/**
+ * the free tiles of the map within the given
+ * distance from one of its corners.
+ */
+tileset_t corner_tiles(const tileset_t &free, int corner, coord::tile_t distance) {
+	coord::tile start = free.get_start();
+	coord::tile_delta extent = free.get_extent();
+	coord::tile origin{
+		(corner & 1) ? start.ne + extent.ne - distance : start.ne,
+		(corner & 2) ? start.se + extent.se - distance : start.se
+	};
+
+	tileset_t result = tileset_t::empty_like(free);
+	for (coord::tile_t ne = 0; ne < distance; ne++) {
+		for (coord::tile_t se = 0; se < distance; se++) {
+			coord::tile tile = origin + coord::tile_delta{ne, se};
+			if (free.count(tile)) {
+				result.insert(tile);
+			}
+		}
+	}
+	return result.empty() ? free : result;
+}
+
+
+double path_length(const coord::phys3 &start, const path::Path &path) {
+	double length = 0;
+	coord::phys3 from = start;
+	for (auto it = path.waypoints.rbegin(); it != path.waypoints.rend(); ++it) {
+		length += std::hypot(it->position.ne - from.ne, it->position.se - from.se);
+		from = it->position;
+	}
+	return length;
+}
+
+} // anonymous namespace
+
+
+pathfinding_benchmark_result run_pathfinding_benchmark(const pathfinding_benchmark_settings &settings) {
+	ENSURE(settings.terrain_size >= 1, "the benchmark needs a terrain size of at least 1");
+	ENSURE(settings.queries >= 1, "the benchmark needs at least one query");
+
+	ensure_qt_application();
+
+	Generator generator{nullptr};
+	generator.setv("generation_seed", settings.seed);
+	generator.setv("terrain_size", settings.terrain_size);
+
+	tileset_t obstacles = generator.object_tiles();
+	coord::tile map_start = obstacles.get_start();
+	coord::tile_delta extent = obstacles.get_extent();
+
+	rng::RNG rng{static_cast<uint64_t>(settings.seed)};
+	add_obstacles(rng, obstacles,
+	              std::min(max_obstacle_density, std::max(0.0, settings.obstacle_density)));
+
+	tileset_t free = tileset_t::empty_like(obstacles);
+	for (coord::tile_t ne = 0; ne < extent.ne; ne++) {
+		for (coord::tile_t se = 0; se < extent.se; se++) {
+			coord::tile tile = map_start + coord::tile_delta{ne, se};
+			if (not obstacles.count(tile)) {
+				free.insert(tile);
+			}
+		}
+	}
+	if (free.size() < 2) {
+		throw Error(MSG(err) << "the generated map has no room for queries");
+	}
+
+	pathfinding_benchmark_result result;
+	result.map_tiles = extent.ne * extent.se;
+	result.obstacle_density = static_cast<double>(obstacles.size()) / result.map_tiles;
+	result.queries = settings.queries;
+
+	// the queries between corners go across the whole map,
+	// and search their whole area if the target is unreachable
+	std::vector<tileset_t> corners;
+	if (settings.worst_case) {
+		coord::tile_t distance = std::max<coord::tile_t>(1, std::min(extent.ne, extent.se) / 8);
+		for (int corner = 0; corner < 4; corner++) {
+			corners.push_back(corner_tiles(free, corner, distance));
+		}
+	}
+
+	std::vector<std::pair<coord::tile, coord::tile>> queries;
+	for (int i = 0; i < settings.queries; i++) {
+		const tileset_t &from = settings.worst_case ? corners[i % 4] : free;
+		const tileset_t &to = settings.worst_case ? corners[3 - i % 4] : free;
+
+		coord::tile start = random_tile(rng, from);
+		coord::tile end = random_tile(rng, to);
+		while (start == end) {
+			end = random_tile(rng, free);
+		}
+		queries.emplace_back(start, end);
+	}
+
+	auto tile_passable = [&](const coord::tile &tile) {
+		return free.count(tile) != 0;
+	};
+	std::function<bool(const coord::phys3 &)> passable = [&](const coord::phys3 &pos) {
+		return free.count(pos.to_tile3().to_tile()) != 0;
+	};
+
+	// shortest paths over the tiles, before the measurement
+	int radius = static_cast<int>(std::max(extent.ne, extent.se));
+	std::vector<path::cost_t> shortest;
+	for (auto &query : queries) {
+		path::FlowField field{query.second, radius, tile_passable};
+		shortest.push_back(field.cost(query.first));
+	}
+
+	path::search_mode mode = settings.jump_points ? path::search_mode::jump_points : path::search_mode::neighbors;
+	path::SearchContext search;
+	util::DurationHistogram times{10000, 10000};
+	std::vector<double> ratios;
+	ratios.reserve(queries.size());
+	size_t expansions = 0;
+	size_t nodes = 0;
+
+	int64_t heap_before = util::heap_in_use();
+
+	for (size_t i = 0; i < queries.size(); i++) {
+		coord::phys3 start = queries[i].first.to_tile3().to_phys3();
+		coord::phys3 end = queries[i].second.to_tile3().to_phys3();
+
+		auto valid_end = [&](const coord::phys3 &pos) -> bool {
+			return pos == end;
+		};
+		auto heuristic = [&](const coord::phys3 &pos) -> path::cost_t {
+			return path::euclidean_cost(pos, end);
+		};
+
+		time_nsec_t begin = timing::get_monotonic_time();
+		path::Path found = path::a_star(search, start, valid_end, heuristic, passable, mode);
+		found.smooth(start, passable);
+		times.add(timing::get_monotonic_time() - begin);
+
+		size_t closed = 0;
+		for (path::node_id id = 0; id < search.size(); id++) {
+			closed += search.get(id).closed;
+		}
+		expansions += closed;
+		nodes += search.size();
+		result.expansions_max = std::max(result.expansions_max, closed);
+
+		bool reached = not found.waypoints.empty() and found.waypoints.front().position == end;
+		if (reached) {
+			result.reached += 1;
+			if (shortest[i] > 0 and std::isfinite(shortest[i])) {
+				ratios.push_back(path_length(start, found) / shortest[i]);
+			}
+		}
+		else if (std::isfinite(shortest[i])) {
+			result.missed += 1;
+		}
+	}
+
+	int64_t heap_after = util::heap_in_use();
+
+	result.query_p50_ms = times.percentile(0.5) / 1e6;
+	result.query_p99_ms = times.percentile(0.99) / 1e6;
+	result.query_max_ms = times.max() / 1e6;
+	result.expansions_mean = static_cast<double>(expansions) / queries.size();
+	result.nodes_mean = static_cast<double>(nodes) / queries.size();
+	if (not ratios.empty()) {
+		double sum = 0;
+		for (double ratio : ratios) {
+			sum += ratio;
+		}
+		result.length_ratio_mean = sum / ratios.size();
+		result.length_ratio_max = *std::max_element(ratios.begin(), ratios.end());
+	}
+	result.heap_measured = heap_before >= 0 and heap_after >= 0;
+	result.heap_growth = result.heap_measured ? heap_after - heap_before : 0;
+
+	return result;
+}
+
+} // openage
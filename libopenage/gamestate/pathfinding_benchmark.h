@@ -0,0 +1,91 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libcpp cimport bool
+// pxd: from libc.stdint cimport int64_t
+#include <cstdint>
+#include <cstddef>
+
+namespace openage {
+
+
+/**
+ * Map and queries of the pathfinding benchmark.
+ *
+ * pxd:
+ *
+ * cppclass pathfinding_benchmark_settings:
+ *     int terrain_size
+ *     double obstacle_density
+ *     int queries
+ *     int seed
+ *     bool worst_case
+ *     bool jump_points
+ */
+struct pathfinding_benchmark_settings {
+	int terrain_size = 2;           //!< the generator setting, the map has 32 tiles per unit
+	double obstacle_density = 0.2;  //!< fraction of blocked tiles, at least the generated objects
+	int queries = 100;
+	int seed = 4321;
+	bool worst_case = false;        //!< query between opposite corners instead of random tiles
+	bool jump_points = false;       //!< search with search_mode::jump_points
+};
+
+
+/**
+ * Measurements of the pathfinding benchmark.
+ *
+ * pxd:
+ *
+ * cppclass pathfinding_benchmark_result:
+ *     size_t map_tiles
+ *     double obstacle_density
+ *     int queries
+ *     int reached
+ *     int missed
+ *     double query_p50_ms
+ *     double query_p99_ms
+ *     double query_max_ms
+ *     double expansions_mean
+ *     size_t expansions_max
+ *     double nodes_mean
+ *     double length_ratio_mean
+ *     double length_ratio_max
+ *     bool heap_measured
+ *     int64_t heap_growth
+ */
+struct pathfinding_benchmark_result {
+	size_t map_tiles = 0;
+	double obstacle_density = 0;   //!< fraction of blocked tiles of the generated map
+	int queries = 0;
+	int reached = 0;               //!< queries which found their target
+	int missed = 0;                //!< targets that were reachable, but not found
+	double query_p50_ms = 0;
+	double query_p99_ms = 0;
+	double query_max_ms = 0;
+	double expansions_mean = 0;    //!< nodes taken from the open list per query
+	size_t expansions_max = 0;
+	double nodes_mean = 0;         //!< nodes created per query
+	double length_ratio_mean = 0;  //!< path length relative to the shortest tile path
+	double length_ratio_max = 0;
+	bool heap_measured = false;    //!< heap_growth is known (glibc only)
+	int64_t heap_growth = 0;       //!< bytes in use after minus before the queries
+};
+
+
+/**
+ * Searches paths on a map of the generator, without game data.
+ *
+ * Tiles covered by generated objects are blocked, more blocks of
+ * tiles are added until the obstacle density is reached. Each
+ * query searches with a_star and smooths the path like to_point.
+ * The length of found paths is compared to the shortest path over
+ * the tiles, and the targets that were not found are checked to
+ * be unreachable. Only the searches are measured.
+ *
+ * pxd: pathfinding_benchmark_result run_pathfinding_benchmark(pathfinding_benchmark_settings settings) except +
+ */
+pathfinding_benchmark_result run_pathfinding_benchmark(const pathfinding_benchmark_settings &settings);
+
+} // openage
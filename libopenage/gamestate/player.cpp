@@ -2,9 +2,12 @@
 
 #include "player.h"
 
+#include <cstring>
+
 #include "../log/log.h"
 #include "../unit/unit.h"
 #include "../unit/unit_type.h"
+#include "state_hash.h"
 #include "team.h"
 
 
@@ -16,7 +19,11 @@ Player::Player(Civilisation *civ, unsigned int number, std::string name)
 	color{number},
 	civ{civ},
 	name{name},
-	team{nullptr} {
+	team{nullptr},
+	dropsites{*this},
+	resource_revision{0},
+	state_hash{nullptr},
+	hashed_resources{0} {
 	// starting resources
 	this->resources[game_resource::food] = 1000;
 	this->resources[game_resource::wood] = 1000;
@@ -55,27 +62,90 @@ bool Player::owns(Unit &unit) const {
 }
 
 void Player::receive(const ResourceBundle& amount) {
-	this->resources += amount;
+	this->income += amount;
 }
 
 void Player::receive(const game_resource resource, double amount) {
-	this->resources[resource] += amount;
+	this->income[resource] += amount;
 }
 
 bool Player::deduct(const ResourceBundle& amount) {
-	return this->resources.deduct(amount);
+	if (not (this->resources + this->income).has(amount)) {
+		return false;
+	}
+
+	// the income is needed for the amount, so it's applied now
+	this->apply_income();
+	this->resources -= amount;
+	this->resource_revision += 1;
+	this->hash_resources();
+	return true;
 }
 
 bool Player::deduct(const game_resource resource, double amount) {
-	if (this->resources[resource] >= amount) {
-		this->resources[resource] -= amount;
-		return true;
-	}
-	return false;
+	ResourceBundle cost;
+	cost[resource] = amount;
+	return this->deduct(cost);
 }
 
 double Player::amount(const game_resource resource) const {
-	return this->resources.get(resource);
+	return this->resources.get(resource) + this->income.get(resource);
+}
+
+void Player::apply_income() {
+	if (this->income.empty()) {
+		return;
+	}
+
+	this->resources += this->income;
+	this->income.clear();
+	this->resource_revision += 1;
+	this->hash_resources();
+}
+
+uint64_t Player::get_resource_revision() const {
+	return this->resource_revision;
+}
+
+ResourceBundle Player::get_stockpile() const {
+	return this->resources + this->income;
+}
+
+void Player::set_stockpile(const ResourceBundle &amount) {
+	this->resources = amount;
+	this->income.clear();
+	this->resource_revision += 1;
+	this->hash_resources();
+}
+
+void Player::set_state_hash(StateHash *state_hash) {
+	if (this->state_hash) {
+		this->state_hash->remove(state_part::resources, this->player_number, this->hashed_resources);
+	}
+
+	this->state_hash = state_hash;
+	if (state_hash) {
+		state_hash->add(state_part::resources, this->player_number, this->hashed_resources);
+		this->hash_resources();
+	}
+}
+
+void Player::hash_resources() {
+	if (not this->state_hash) {
+		return;
+	}
+
+	// the amounts are the same on all peers, so are their bits
+	uint64_t value = 0;
+	for (int i = 0; i < ResourceBundle::count; i++) {
+		uint64_t bits;
+		double amount = this->resources.get(i);
+		std::memcpy(&bits, &amount, sizeof(bits));
+		value = (value ^ bits) * 0x100000001b3ull;
+	}
+
+	this->state_hash->change(state_part::resources, this->player_number, this->hashed_resources, value);
+	this->hashed_resources = value;
 }
 
 size_t Player::type_count() {
@@ -1,16 +1,21 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
+#include "../unit/damage_table.h"
+#include "../unit/dropsite_index.h"
 #include "civilisation.h"
 #include "resource.h"
+#include "visibility_grid.h"
 
 
 namespace openage {
 
+class StateHash;
 class Unit;
 class Team;
 
@@ -45,6 +50,21 @@ public:
 	 */
 	Team *team;
 
+	/**
+	 * damage of the attacks of this player's units
+	 */
+	DamageTable damage_table;
+
+	/**
+	 * completed dropsites of this player
+	 */
+	DropsiteIndex dropsites;
+
+	/**
+	 * tiles seen by this player's units
+	 */
+	VisibilityGrid visibility;
+
 	/**
 	 * checks if two players are the same
 	 */
@@ -66,22 +86,53 @@ public:
 	bool owns(Unit &) const;
 
 	/**
-	 * add to stockpile
+	 * add to stockpile.
+	 * collected as the income of the tick, which is added in bulk
+	 * by apply_income, so observers see one change per tick.
 	 */
 	void receive(const ResourceBundle& amount);
 	void receive(const game_resource resource, double amount);
 
 	/**
-	 * remove from stockpile if available
+	 * remove from stockpile if available,
+	 * including the income of this tick.
 	 */
 	bool deduct(const ResourceBundle& amount);
 	bool deduct(const game_resource resource, double amount);
 
 	/**
-	 * current stockpile amount
+	 * current stockpile amount, including the income of this tick
 	 */
 	double amount(const game_resource resource) const;
 
+	/**
+	 * add the income of this tick to the stockpile,
+	 * called at the end of each simulation tick.
+	 */
+	void apply_income();
+
+	/**
+	 * increased whenever the stockpile changes,
+	 * so observers only update when it's different.
+	 */
+	uint64_t get_resource_revision() const;
+
+	/**
+	 * the stockpile, including the income of this tick.
+	 */
+	ResourceBundle get_stockpile() const;
+
+	/**
+	 * replaces the stockpile, e.g. in a copy of the game.
+	 */
+	void set_stockpile(const ResourceBundle &amount);
+
+	/**
+	 * adds the stockpile to the state hash of the game,
+	 * which then gets each change of it.
+	 */
+	void set_state_hash(StateHash *state_hash);
+
 	/**
 	 * total number of unit types available
 	 */
@@ -110,6 +161,24 @@ private:
 	 */
 	ResourceBundle resources;
 
+	/**
+	 * resources received during this tick
+	 */
+	ResourceBundle income;
+
+	uint64_t resource_revision;
+
+	/**
+	 * the stockpile is hashed here, may be null
+	 */
+	StateHash *state_hash;
+	uint64_t hashed_resources;
+
+	/**
+	 * replaces the stockpile in the state hash by the current one.
+	 */
+	void hash_resources();
+
 	/**
 	 * unit types which can be produced by this player.
 	 */
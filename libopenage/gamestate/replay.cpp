@@ -0,0 +1,350 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "replay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "../error/error.h"
+#include "../log/log.h"
+#include "generator.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * the kinds of records in a replay file.
+ */
+enum class record_kind : uint8_t {
+	commands = 0,
+	checkpoint = 1,
+	end = 2,
+};
+
+
+/**
+ * the integer values of the generator, all of them
+ * are needed to generate the same map again.
+ */
+constexpr const char *generator_values[] = {
+	"generation_seed",
+	"terrain_size",
+	"terrain_base_id",
+	"player_area",
+	"player_radius",
+};
+
+
+template<typename T>
+void append(std::string &out, T value) {
+	auto bits = static_cast<uint64_t>(value);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+	}
+}
+
+
+void append_string(std::string &out, const std::string &value) {
+	append<uint32_t>(out, value.size());
+	out += value;
+}
+
+
+/**
+ * reads the little endian values of a replay,
+ * throws if the data ends before.
+ */
+class replay_reader {
+public:
+	replay_reader(const char *data, size_t size)
+		:
+		data{data},
+		size{size},
+		pos{0} {}
+
+	template<typename T>
+	T get() {
+		this->require(sizeof(T));
+
+		uint64_t bits = 0;
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bits |= uint64_t(static_cast<uint8_t>(this->data[this->pos + i])) << (8 * i);
+		}
+		this->pos += sizeof(T);
+		return static_cast<T>(bits);
+	}
+
+	std::string get_string() {
+		return this->get_bytes(this->get<uint32_t>());
+	}
+
+	std::string get_bytes(size_t length) {
+		this->require(length);
+		std::string result{this->data + this->pos, length};
+		this->pos += length;
+		return result;
+	}
+
+	size_t remaining() const {
+		return this->size - this->pos;
+	}
+
+private:
+	void require(size_t length) const {
+		if (this->remaining() < length) {
+			throw Error(MSG(err) << "replay is truncated");
+		}
+	}
+
+	const char *data;
+	size_t size;
+	size_t pos;
+};
+
+
+std::string encode_settings(const replay_settings &settings) {
+	std::string out;
+	append<uint32_t>(out, settings.values.size());
+	for (auto &value : settings.values) {
+		append_string(out, value.first);
+		append<int32_t>(out, value.second);
+	}
+
+	append_string(out, settings.load_filename);
+
+	append<uint32_t>(out, settings.player_names.size());
+	for (auto &name : settings.player_names) {
+		append_string(out, name);
+	}
+
+	append<int32_t>(out, settings.tick_rate);
+	return out;
+}
+
+
+replay_settings decode_settings(replay_reader &reader) {
+	replay_settings settings;
+
+	uint32_t value_count = reader.get<uint32_t>();
+	for (uint32_t i = 0; i < value_count; i++) {
+		std::string name = reader.get_string();
+		settings.values[name] = reader.get<int32_t>();
+	}
+
+	settings.load_filename = reader.get_string();
+
+	uint32_t player_count = reader.get<uint32_t>();
+	if (player_count > reader.remaining()) {
+		throw Error(MSG(err) << "replay has an invalid player count");
+	}
+	for (uint32_t i = 0; i < player_count; i++) {
+		settings.player_names.push_back(reader.get_string());
+	}
+
+	settings.tick_rate = reader.get<int32_t>();
+	return settings;
+}
+
+} // anonymous namespace
+
+
+replay_settings replay_settings::from(const Generator &generator) {
+	replay_settings settings;
+	for (const char *name : generator_values) {
+		settings.values[name] = generator.getv<int>(name);
+	}
+	if (generator.getv<bool>("from_file")) {
+		settings.load_filename = generator.getv<std::string>("load_filename");
+	}
+	settings.player_names = generator.get_csv("player_names");
+	return settings;
+}
+
+
+void replay_settings::apply(Generator &generator) const {
+	for (auto &value : this->values) {
+		generator.setv(value.first, value.second);
+	}
+	generator.setv("from_file", not this->load_filename.empty());
+	if (not this->load_filename.empty()) {
+		generator.setv("load_filename", this->load_filename);
+	}
+	generator.set_csv("player_names", this->player_names);
+}
+
+
+replay read_replay(const std::string &fname) {
+	std::ifstream file{fname, std::ifstream::in | std::ifstream::binary};
+	if (not file) {
+		throw Error(MSG(err) << "could not open replay " << fname);
+	}
+	std::string content{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+	replay_reader reader{content.data(), content.size()};
+	if (reader.get_bytes(strlen(replay_magic)) != replay_magic) {
+		throw Error(MSG(err) << fname << " is no replay");
+	}
+	uint32_t version = reader.get<uint32_t>();
+	if (version != replay_format_version) {
+		throw Error(MSG(err) << "replay " << fname << " has the unknown format version " << version);
+	}
+
+	replay result;
+	result.settings = decode_settings(reader);
+
+	while (reader.remaining() > 0) {
+		// a crashed game may have left a partial record
+		if (reader.remaining() < 5) {
+			break;
+		}
+		auto kind = static_cast<record_kind>(reader.get<uint8_t>());
+		uint32_t size = reader.get<uint32_t>();
+		if (reader.remaining() < size) {
+			break;
+		}
+		std::string data = reader.get_bytes(size);
+		replay_reader record{data.data(), data.size()};
+
+		switch (kind) {
+		case record_kind::commands: {
+			command_batch batch = decode_command_batch(data.data(), data.size());
+			auto &commands = result.commands[batch.tick];
+			for (auto &command : batch.commands) {
+				commands.push_back(std::move(command));
+			}
+			result.ticks = std::max(result.ticks, batch.tick + 1);
+			break;
+		}
+		case record_kind::checkpoint: {
+			uint64_t tick = record.get<uint64_t>();
+			state_parts_t &parts = result.checkpoints[tick];
+			for (auto &part : parts) {
+				part = record.get<uint64_t>();
+			}
+			result.ticks = std::max(result.ticks, tick + 1);
+			break;
+		}
+		case record_kind::end:
+			result.ticks = record.get<uint64_t>();
+			result.complete = true;
+			break;
+		default:
+			throw Error(MSG(err) << "replay " << fname << " has an unknown record kind "
+			            << static_cast<int>(kind));
+		}
+
+		if (result.complete) {
+			break;
+		}
+	}
+
+	if (not result.complete) {
+		log::log(MSG(warn) << "replay " << fname << " ends without its last tick, "
+		         << "the game was probably not ended normally");
+	}
+
+	return result;
+}
+
+
+ReplayRecorder::ReplayRecorder(const std::string &fname,
+                               const replay_settings &settings,
+                               unsigned int checkpoint_interval)
+	:
+	filename{fname},
+	file{fname, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc},
+	checkpoint_interval{std::max(checkpoint_interval, 1u)},
+	finished{false},
+	ticks{0} {
+
+	if (not this->file) {
+		throw Error(MSG(err) << "could not create replay " << fname);
+	}
+
+	std::string header = replay_magic;
+	append<uint32_t>(header, replay_format_version);
+	header += encode_settings(settings);
+	this->file.write(header.data(), header.size());
+	this->file.flush();
+}
+
+
+ReplayRecorder::~ReplayRecorder() {
+	if (not this->finished) {
+		this->finish(this->ticks);
+	}
+}
+
+
+void ReplayRecorder::record(uint64_t tick, const command_record &record) {
+	if (this->finished) {
+		return;
+	}
+
+	this->batch.tick = tick;
+	this->batch.commands.push_back(record);
+}
+
+
+void ReplayRecorder::end_tick(uint64_t tick, const StateHash &state_hash) {
+	if (this->finished) {
+		return;
+	}
+
+	if (not this->batch.commands.empty()) {
+		std::string data;
+		encode_command_batch(this->batch, data);
+		this->write(static_cast<uint8_t>(record_kind::commands), data);
+		this->batch.commands.clear();
+	}
+
+	if ((tick + 1) % this->checkpoint_interval == 0) {
+		std::string data;
+		append<uint64_t>(data, tick);
+		for (uint64_t part : state_hash.get_parts()) {
+			append<uint64_t>(data, part);
+		}
+		this->write(static_cast<uint8_t>(record_kind::checkpoint), data);
+
+		// a crash loses at most the ticks since the last checkpoint
+		this->file.flush();
+	}
+
+	this->ticks = tick + 1;
+}
+
+
+void ReplayRecorder::finish(uint64_t ticks) {
+	if (this->finished) {
+		return;
+	}
+
+	std::string data;
+	append<uint64_t>(data, ticks);
+	this->write(static_cast<uint8_t>(record_kind::end), data);
+	this->file.flush();
+	this->finished = true;
+
+	if (not this->file) {
+		log::log(MSG(err) << "could not write replay " << this->filename);
+	}
+}
+
+
+const std::string &ReplayRecorder::get_filename() const {
+	return this->filename;
+}
+
+
+void ReplayRecorder::write(uint8_t kind, const std::string &data) {
+	std::string header;
+	append<uint8_t>(header, kind);
+	append<uint32_t>(header, data.size());
+	this->file.write(header.data(), header.size());
+	this->file.write(data.data(), data.size());
+}
+
+} // openage
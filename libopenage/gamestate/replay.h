@@ -0,0 +1,163 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lockstep.h"
+#include "state_hash.h"
+
+namespace openage {
+
+class Generator;
+
+
+/**
+ * replay files start with the magic and the format version, followed
+ * by the settings of the game. then come the records, each with a kind,
+ * its size and its data: the commands of a tick as command batch, the
+ * state hash every few ticks, and at last the number of ticks played.
+ * all values are little endian.
+ *
+ * the records are written while the game goes on, so a game that
+ * crashed leaves a replay up to its last ticks.
+ */
+constexpr const char *replay_magic = "OARP";
+constexpr uint32_t replay_format_version = 1;
+
+
+/**
+ * the settings the game was generated from, which together with the
+ * commands determine the whole game.
+ */
+struct replay_settings {
+	/**
+	 * the generator values, like the seed and the terrain size.
+	 */
+	std::map<std::string, int> values;
+
+	/**
+	 * empty for generated games, the savefile otherwise.
+	 * the replay only matches if the savefile didn't change.
+	 */
+	std::string load_filename;
+
+	/**
+	 * the players of the generator, without gaia.
+	 */
+	std::vector<std::string> player_names;
+
+	int tick_rate = 20;
+
+	/**
+	 * the settings the generator has.
+	 */
+	static replay_settings from(const Generator &generator);
+
+	/**
+	 * sets the values of a generator, which then creates the game.
+	 */
+	void apply(Generator &generator) const;
+};
+
+
+/**
+ * the contents of a replay file.
+ */
+struct replay {
+	replay_settings settings;
+
+	/**
+	 * the commands by tick, in the order they were dispatched.
+	 */
+	std::map<uint64_t, std::vector<command_record>> commands;
+
+	/**
+	 * the state hash after the tick.
+	 */
+	std::map<uint64_t, state_parts_t> checkpoints;
+
+	/**
+	 * the ticks that were played.
+	 */
+	uint64_t ticks = 0;
+
+	/**
+	 * whether the game ended normally, otherwise the replay
+	 * ends after the last tick that was written.
+	 */
+	bool complete = false;
+};
+
+
+/**
+ * reads a replay file, throws an Error if it is invalid.
+ */
+replay read_replay(const std::string &fname);
+
+
+/**
+ * Writes the commands and the state hashes of a game to a replay file,
+ * while the game is played.
+ */
+class ReplayRecorder {
+public:
+	/**
+	 * creates the file and writes the settings, throws if it can't.
+	 * @param checkpoint_interval: ticks between the state hashes
+	 */
+	ReplayRecorder(const std::string &fname,
+	               const replay_settings &settings,
+	               unsigned int checkpoint_interval=100);
+
+	/**
+	 * writes the end record, unless finish() did already.
+	 */
+	~ReplayRecorder();
+
+	ReplayRecorder(const ReplayRecorder &) = delete;
+	ReplayRecorder &operator =(const ReplayRecorder &) = delete;
+
+	/**
+	 * a command that is dispatched before the simulation of the tick.
+	 */
+	void record(uint64_t tick, const command_record &record);
+
+	/**
+	 * the tick was simulated: writes its commands, and the state hash
+	 * if the tick is a checkpoint.
+	 */
+	void end_tick(uint64_t tick, const StateHash &state_hash);
+
+	/**
+	 * writes the number of ticks played, nothing is recorded after.
+	 */
+	void finish(uint64_t ticks);
+
+	const std::string &get_filename() const;
+
+private:
+	void write(uint8_t kind, const std::string &data);
+
+	std::string filename;
+	std::ofstream file;
+	unsigned int checkpoint_interval;
+
+	/**
+	 * the commands of the current tick.
+	 */
+	command_batch batch;
+
+	bool finished;
+
+	/**
+	 * ticks that were written, for the end record.
+	 */
+	uint64_t ticks;
+};
+
+} // openage
@@ -0,0 +1,115 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "replay.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace gamestate {
+namespace tests {
+
+namespace {
+
+std::string temp_filename() {
+	char filename[] = "/tmp/openage-replay-XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0) {
+		TESTFAILMSG("could not create a temporary file");
+	}
+	close(fd);
+	return filename;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void replay() {
+	std::string fname = temp_filename();
+
+	replay_settings settings;
+	settings.values["generation_seed"] = -5;
+	settings.values["terrain_size"] = 3;
+	settings.player_names = {"gaia", "player1"};
+	settings.tick_rate = 30;
+
+	command_record move;
+	move.player = 1;
+	move.has_position = true;
+	move.position = coord::phys3{1000, -2000, 0};
+	move.abilities[static_cast<int>(ability_type::move)] = true;
+	move.units = {5, 9};
+
+	StateHash state;
+	state_parts_t checkpoint;
+	{
+		ReplayRecorder recorder{fname, settings, 10};
+		for (uint64_t tick = 0; tick < 25; tick++) {
+			if (tick == 3 or tick == 12) {
+				recorder.record(tick, move);
+				recorder.record(tick, move);
+			}
+			state.add(state_part::positions, tick, tick * 7);
+			recorder.end_tick(tick, state);
+			if (tick == 19) {
+				checkpoint = state.get_parts();
+			}
+		}
+		recorder.finish(25);
+	}
+
+	openage::replay recording = read_replay(fname);
+	recording.complete or TESTFAIL;
+	recording.ticks == 25 or TESTFAIL;
+
+	recording.settings.values == settings.values or TESTFAIL;
+	recording.settings.load_filename.empty() or TESTFAIL;
+	recording.settings.player_names == settings.player_names or TESTFAIL;
+	recording.settings.tick_rate == 30 or TESTFAIL;
+
+	recording.commands.size() == 2 or TESTFAIL;
+	recording.commands.at(12).size() == 2 or TESTFAIL;
+	recording.commands.at(3)[1].position == move.position or TESTFAIL;
+	recording.commands.at(3)[1].units == move.units or TESTFAIL;
+
+	// a checkpoint after every 10 ticks, with the hash after the tick
+	recording.checkpoints.size() == 2 or TESTFAIL;
+	recording.checkpoints.count(9) == 1 or TESTFAIL;
+	recording.checkpoints.at(19) == checkpoint or TESTFAIL;
+
+	// the replay of a crashed game ends after the last whole record
+	std::string content;
+	{
+		std::ifstream file{fname, std::ifstream::binary};
+		content.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+	}
+	{
+		std::ofstream file{fname, std::ofstream::binary | std::ofstream::trunc};
+		file.write(content.data(), content.size() - 3);
+	}
+
+	openage::replay crashed = read_replay(fname);
+	crashed.complete and TESTFAIL;
+	crashed.ticks == 20 or TESTFAIL;
+	crashed.commands.size() == 2 or TESTFAIL;
+
+	// other files are no replays
+	{
+		std::ofstream file{fname, std::ofstream::binary | std::ofstream::trunc};
+		file << "OASV";
+	}
+	TESTTHROWS(read_replay(fname));
+
+	std::remove(fname.c_str());
+}
+
+
+}}} // openage::gamestate::tests
@@ -12,46 +12,64 @@ ResourceBundle::ResourceBundle()
 }
 
 bool ResourceBundle::operator> (const ResourceBundle& other) const {
-	for (int i=0; i<(int) game_resource::RESOURCE_TYPE_COUNT; i++) {
-		if (!(this->get(i) > other.get(i))) {
-			return false;
-		}
+	bool result = true;
+	for (int i=0; i<count; i++) {
+		result &= (this->get(i) > other.get(i));
 	}
-	return true;
+	return result;
 }
 
 bool ResourceBundle::operator>= (const ResourceBundle& other) const {
-	for (int i=0; i<(int) game_resource::RESOURCE_TYPE_COUNT; i++) {
-		if (!(this->get(i) >= other.get(i))) {
-			return false;
-		}
+	bool result = true;
+	for (int i=0; i<count; i++) {
+		result &= (this->get(i) >= other.get(i));
 	}
-	return true;
+	return result;
 }
 
 ResourceBundle& ResourceBundle::operator+= (const ResourceBundle& other) {
-	for (int i=0; i<(int) game_resource::RESOURCE_TYPE_COUNT; i++) {
+	for (int i=0; i<count; i++) {
 		(*this)[i] += other.get(i);
 	}
 	return *this;
 }
 
 ResourceBundle& ResourceBundle::operator-= (const ResourceBundle& other) {
-	for (int i=0; i<(int) game_resource::RESOURCE_TYPE_COUNT; i++) {
+	for (int i=0; i<count; i++) {
 		(*this)[i] -= other.get(i);
 	}
 	return *this;
 }
 
 ResourceBundle& ResourceBundle::operator*= (const double a) {
-	for (int i=0; i<(int) game_resource::RESOURCE_TYPE_COUNT; i++) {
+	for (int i=0; i<count; i++) {
 		(*this)[i] *= a;
 	}
 	return *this;
 }
 
+ResourceBundle ResourceBundle::operator+ (const ResourceBundle& other) const {
+	ResourceBundle result = *this;
+	result += other;
+	return result;
+}
+
+bool ResourceBundle::empty() const {
+	bool result = true;
+	for (int i=0; i<count; i++) {
+		result &= (this->get(i) == 0);
+	}
+	return result;
+}
+
+void ResourceBundle::clear() {
+	for (int i=0; i<count; i++) {
+		(*this)[i] = 0;
+	}
+}
+
 ResourceBundle& ResourceBundle::round() {
-	for (int i=0; i<(int) game_resource::RESOURCE_TYPE_COUNT; i++) {
+	for (int i=0; i<count; i++) {
 		(*this)[i] = std::round(this->get(i));
 	}
 	return *this;
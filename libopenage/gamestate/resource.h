@@ -22,6 +22,7 @@ enum class game_resource {
  */
 class ResourceBundle {
 public:
+	static constexpr int count = static_cast<int>(game_resource::RESOURCE_TYPE_COUNT);
 
 	ResourceBundle();
 
@@ -33,6 +34,18 @@ public:
 
 	ResourceBundle& operator*= (const double a);
 
+	ResourceBundle operator+ (const ResourceBundle& other) const;
+
+	/**
+	 * true if all amounts are zero.
+	 */
+	bool empty() const;
+
+	/**
+	 * Set all amounts to zero.
+	 */
+	void clear();
+
 	/**
 	 * Round each value to the nearest integer.
 	 * Returns itself.
@@ -52,7 +65,11 @@ public:
 	double get(int index) const { return value[index]; }
 
 private:
-	double value[(int) game_resource::RESOURCE_TYPE_COUNT];
+	/**
+	 * the operations work on all amounts at once, with loops
+	 * without branches the compiler can vectorize.
+	 */
+	double value[count];
 };
 
 } // namespace openage
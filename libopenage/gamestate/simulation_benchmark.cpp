@@ -0,0 +1,253 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "simulation_benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../error/error.h"
+#include "../terrain/terrain.h"
+#include "../log/log.h"
+#include "../terrain/terrain_object.h"
+#include "../unit/action.h"
+#include "../unit/action_pool.h"
+#include "../unit/command.h"
+#include "../unit/unit.h"
+#include "../unit/unit_type.h"
+#include "../util/heap.h"
+#include "../util/math_constants.h"
+#include "../util/timing.h"
+#include "game_fork.h"
+#include "game_main.h"
+#include "headless.h"
+#include "player.h"
+
+namespace openage {
+
+namespace {
+
+constexpr int town_center_id = 109;
+constexpr int villager_id = 83;
+constexpr int militia_id = 74;
+constexpr int tree_ids[] = {349, 351};
+
+
+int64_t distance_squared(const coord::tile &a, const coord::tile &b) {
+	int64_t ne = a.ne - b.ne;
+	int64_t se = a.se - b.se;
+	return ne * ne + se * se;
+}
+
+
+coord::tile unit_tile(Unit *unit) {
+	return unit->location->pos.start;
+}
+
+
+Unit *find_town_center(GameMain &game, const Player &player) {
+	for (Unit *unit : game.placed_units.all_units()) {
+		if (unit->unit_type->id() == town_center_id and unit->is_own_unit(player)) {
+			return unit;
+		}
+	}
+	return nullptr;
+}
+
+
+Unit *find_nearest_tree(GameMain &game, const coord::tile &to) {
+	Unit *nearest = nullptr;
+	int64_t nearest_distance = 0;
+
+	for (Unit *unit : game.placed_units.all_units()) {
+		int id = unit->unit_type->id();
+		if (std::find(std::begin(tree_ids), std::end(tree_ids), id) == std::end(tree_ids)
+		    or not unit->location) {
+			continue;
+		}
+
+		int64_t distance = distance_squared(unit_tile(unit), to);
+		if (nearest == nullptr or distance < nearest_distance) {
+			nearest = unit;
+			nearest_distance = distance;
+		}
+	}
+	return nearest;
+}
+
+
+/**
+ * places the units of a player in rings around its town center.
+ */
+void spawn_units(GameMain &game, Player &player, Unit *town_center, int count,
+                 std::vector<Unit *> &villagers, std::vector<Unit *> &militia) {
+
+	UnitType *villager_type = player.get_type(villager_id);
+	UnitType *militia_type = player.get_type(militia_id);
+	if (villager_type == nullptr or militia_type == nullptr) {
+		throw Error(MSG(err) << "the game data lacks villagers or militia");
+	}
+
+	coord::tile center = unit_tile(town_center);
+	int placed = 0;
+
+	// tiles that are occupied are skipped, so give up after a while.
+	// the rings up to a radius have about 4 * radius^2 tiles.
+	int max_radius = 64 + static_cast<int>(std::sqrt(count));
+	for (int radius = 3; placed < count and radius < max_radius; radius++) {
+		for (int i = 0; placed < count and i < 8 * radius; i++) {
+			double angle = 2 * math::PI * i / (8 * radius);
+			coord::tile tile{
+				center.ne + static_cast<coord::tile_t>(std::lround(radius * std::cos(angle))),
+				center.se + static_cast<coord::tile_t>(std::lround(radius * std::sin(angle)))
+			};
+
+			bool is_villager = placed % 2 == 0;
+			UnitType &type = is_villager ? *villager_type : *militia_type;
+			UnitReference ref = game.placed_units.new_unit(type, player, tile.to_tile3().to_phys3());
+			if (not ref.is_valid()) {
+				continue;
+			}
+
+			(is_villager ? villagers : militia).push_back(ref.get());
+			placed++;
+		}
+	}
+
+	if (placed < count) {
+		log::log(MSG(warn) << "placed only " << placed << " of " << count
+		         << " units for player " << player.player_number);
+	}
+}
+
+
+void command_group(const std::vector<Unit *> &units, const Command &cmd) {
+	if (units.empty()) {
+		return;
+	}
+
+	GroupCommand group{cmd};
+	for (Unit *unit : units) {
+		group.units.push_back(unit->get_ref());
+	}
+	units.front()->get_container()->dispatch_group_command(group);
+}
+
+
+double percentile_ms(const std::vector<time_nsec_t> &sorted, double fraction) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t index = std::min(sorted.size() - 1,
+	                        static_cast<size_t>(fraction * sorted.size()));
+	return sorted[index] / 1e6;
+}
+
+} // anonymous namespace
+
+
+simulation_benchmark_result run_simulation_benchmark(const simulation_benchmark_settings &settings) {
+	ENSURE(settings.players >= 1, "the benchmark needs at least one player");
+	ENSURE(settings.ticks >= 1, "the benchmark needs at least one tick");
+
+	headless_settings game_settings;
+	game_settings.data_directory = settings.data_directory;
+	game_settings.players = settings.players;
+	game_settings.seed = settings.seed;
+	game_settings.terrain_size = std::max(2, 1 + settings.players / 2);
+
+	// no engine: nothing is drawn or played
+	HeadlessGame headless{game_settings};
+	GameMain *game = &headless.get_game();
+
+	// gaia is player 0
+	std::vector<Unit *> town_centers;
+	std::vector<std::vector<Unit *>> militia(settings.players);
+
+	for (int i = 0; i < settings.players; i++) {
+		Player &player = game->players[i + 1];
+		Unit *town_center = find_town_center(*game, player);
+		if (town_center == nullptr) {
+			throw Error(MSG(err) << "no town center was generated for player " << i + 1);
+		}
+		town_centers.push_back(town_center);
+
+		std::vector<Unit *> villagers;
+		spawn_units(*game, player, town_center, settings.units_per_player, villagers, militia[i]);
+
+		Unit *tree = find_nearest_tree(*game, unit_tile(town_center));
+		if (tree != nullptr) {
+			command_group(villagers, Command{player, tree});
+		}
+
+		coord::tile map_center{0, 0};
+		command_group(militia[i], Command{player, map_center.to_tile3().to_phys3()});
+	}
+
+	simulation_benchmark_result result;
+	result.units = game->placed_units.all_units().size();
+	result.ticks = settings.ticks;
+
+	std::vector<time_nsec_t> tick_times;
+	tick_times.reserve(settings.ticks);
+
+	ActionPool::stats actions_before = ActionPool::get_stats();
+	MoveAction::stats moves_before = MoveAction::get_stats();
+	int64_t heap_before = util::heap_in_use();
+	time_nsec_t tick_duration = game->get_tick_duration();
+	time_nsec_t total = 0;
+
+	for (int tick = 0; tick < settings.ticks; tick++) {
+		if (tick == settings.ticks / 2 and settings.players > 1) {
+			for (int i = 0; i < settings.players; i++) {
+				Player &player = game->players[i + 1];
+				Unit *target = town_centers[(i + 1) % settings.players];
+				command_group(militia[i], Command{player, target});
+			}
+		}
+
+		time_nsec_t start = timing::get_monotonic_time();
+		game->update(tick_duration);
+		time_nsec_t duration = timing::get_monotonic_time() - start;
+
+		tick_times.push_back(duration);
+		total += duration;
+		result.collision_pair_tests += game->terrain->get_collision_stats().pair_tests;
+	}
+
+	int64_t heap_after = util::heap_in_use();
+	ActionPool::stats actions_after = ActionPool::get_stats();
+	MoveAction::stats moves_after = MoveAction::get_stats();
+
+	std::sort(tick_times.begin(), tick_times.end());
+	result.ticks_per_second = total > 0 ? settings.ticks * 1e9 / total : 0;
+	result.tick_p50_ms = percentile_ms(tick_times, 0.5);
+	result.tick_p99_ms = percentile_ms(tick_times, 0.99);
+	result.tick_max_ms = tick_times.back() / 1e6;
+	if (result.units > 0) {
+		result.unit_update_us = total / 1e3 / settings.ticks / result.units;
+	}
+	result.action_allocations = actions_after.allocations - actions_before.allocations;
+	result.action_heap_allocations = actions_after.heap_allocations - actions_before.heap_allocations;
+	result.moves_blocked = moves_after.blocked - moves_before.blocked;
+	result.move_repairs = moves_after.repairs - moves_before.repairs;
+	result.move_failed_repairs = moves_after.failed_repairs - moves_before.failed_repairs;
+	result.move_repaths = moves_after.repaths - moves_before.repaths;
+	result.heap_measured = heap_before >= 0 and heap_after >= 0;
+	result.heap_growth = result.heap_measured ? heap_after - heap_before : 0;
+
+	time_nsec_t snapshot_start = timing::get_monotonic_time();
+	GameSnapshot snapshot{*game};
+	time_nsec_t fork_start = timing::get_monotonic_time();
+	std::unique_ptr<GameFork> fork = snapshot.fork();
+	time_nsec_t fork_end = timing::get_monotonic_time();
+
+	result.snapshot_ms = (fork_start - snapshot_start) / 1e6;
+	result.fork_ms = (fork_end - fork_start) / 1e6;
+	result.snapshot_bytes = snapshot.memory_used();
+
+	return result;
+}
+
+} // openage
@@ -0,0 +1,99 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libcpp cimport bool
+// pxd: from libcpp.string cimport string
+#include <string>
+// pxd: from libc.stdint cimport int64_t
+#include <cstdint>
+#include <cstddef>
+
+namespace openage {
+
+
+/**
+ * Scenario of the simulation benchmark.
+ *
+ * pxd:
+ *
+ * cppclass simulation_benchmark_settings:
+ *     string data_directory
+ *     int players
+ *     int units_per_player
+ *     int ticks
+ *     int seed
+ */
+struct simulation_benchmark_settings {
+	std::string data_directory;
+	int players = 2;
+	int units_per_player = 50;
+	int ticks = 600;
+	int seed = 4321;
+};
+
+
+/**
+ * Measurements of the simulation benchmark.
+ *
+ * pxd:
+ *
+ * cppclass simulation_benchmark_result:
+ *     size_t units
+ *     int ticks
+ *     double ticks_per_second
+ *     double tick_p50_ms
+ *     double tick_p99_ms
+ *     double tick_max_ms
+ *     double unit_update_us
+ *     size_t action_allocations
+ *     size_t action_heap_allocations
+ *     size_t collision_pair_tests
+ *     size_t moves_blocked
+ *     size_t move_repairs
+ *     size_t move_failed_repairs
+ *     size_t move_repaths
+ *     bool heap_measured
+ *     int64_t heap_growth
+ *     double snapshot_ms
+ *     double fork_ms
+ *     size_t snapshot_bytes
+ */
+struct simulation_benchmark_result {
+	size_t units = 0;            //!< units in the game after the setup
+	int ticks = 0;
+	double ticks_per_second = 0;
+	double tick_p50_ms = 0;
+	double tick_p99_ms = 0;
+	double tick_max_ms = 0;
+	double unit_update_us = 0;           //!< mean tick time divided by the units
+	size_t action_allocations = 0;       //!< unit actions created during the ticks
+	size_t action_heap_allocations = 0;  //!< of those, requests to the heap
+	size_t collision_pair_tests = 0;     //!< objects tested for intersection, summed over the ticks
+	size_t moves_blocked = 0;            //!< unit moves that collided during the ticks
+	size_t move_repairs = 0;             //!< of those, the ones that searched a detour
+	size_t move_failed_repairs = 0;      //!< detours that were not found
+	size_t move_repaths = 0;             //!< blocked moves that searched a new path
+	bool heap_measured = false;          //!< heap_growth is known (glibc only)
+	int64_t heap_growth = 0;             //!< bytes in use after minus before the ticks
+	double snapshot_ms = 0;              //!< copying the game state after the ticks
+	double fork_ms = 0;                  //!< creating a game from that copy
+	size_t snapshot_bytes = 0;           //!< size of the copy
+};
+
+
+/**
+ * Simulates a generated game without engine and window.
+ *
+ * The converted assets are loaded from the data directory, but no
+ * textures are uploaded. Each player gets the given number of units,
+ * half villagers that gather wood, half militia that move to the map
+ * center as a group, and attack the next player's town center after
+ * half of the ticks. Only the ticks are measured, and a snapshot and
+ * fork of the game after them, as an AI lookahead would do.
+ *
+ * pxd: simulation_benchmark_result run_simulation_benchmark(simulation_benchmark_settings settings) except +
+ */
+simulation_benchmark_result run_simulation_benchmark(const simulation_benchmark_settings &settings);
+
+} // openage
@@ -0,0 +1,105 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "state_hash.h"
+
+#include "../rng/rng.h"
+
+namespace openage {
+
+
+const char *state_part_name(state_part part) {
+	switch (part) {
+	case state_part::positions:
+		return "positions";
+	case state_part::hitpoints:
+		return "hitpoints";
+	case state_part::resources:
+		return "resources";
+	case state_part::rng:
+		return "rng";
+	default:
+		return "unknown";
+	}
+}
+
+
+StateHash::StateHash()
+	:
+	rng{nullptr} {
+
+	for (auto &part : this->parts) {
+		part.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+void StateHash::add(state_part part, uint64_t key, uint64_t value) {
+	this->parts[static_cast<size_t>(part)].fetch_add(entry(key, value), std::memory_order_relaxed);
+}
+
+
+void StateHash::remove(state_part part, uint64_t key, uint64_t value) {
+	this->parts[static_cast<size_t>(part)].fetch_sub(entry(key, value), std::memory_order_relaxed);
+}
+
+
+void StateHash::change(state_part part, uint64_t key, uint64_t old_value, uint64_t new_value) {
+	if (old_value == new_value) {
+		return;
+	}
+	this->parts[static_cast<size_t>(part)].fetch_add(entry(key, new_value) - entry(key, old_value),
+	                                                 std::memory_order_relaxed);
+}
+
+
+void StateHash::track_rng(const rng::RNG *rng) {
+	this->rng = rng;
+}
+
+
+uint64_t StateHash::get(state_part part) const {
+	if (part == state_part::rng) {
+		return this->rng ? entry(0, this->rng->fingerprint()) : 0;
+	}
+	return this->parts[static_cast<size_t>(part)].load(std::memory_order_relaxed);
+}
+
+
+state_parts_t StateHash::get_parts() const {
+	state_parts_t result;
+	for (size_t i = 0; i < state_part_count; i++) {
+		result[i] = this->get(static_cast<state_part>(i));
+	}
+	return result;
+}
+
+
+uint64_t StateHash::get() const {
+	uint64_t result = 0;
+	for (uint64_t part : this->get_parts()) {
+		result = entry(result, part);
+	}
+	return result;
+}
+
+
+std::vector<state_part> StateHash::diverged(const state_parts_t &a, const state_parts_t &b) {
+	std::vector<state_part> result;
+	for (size_t i = 0; i < state_part_count; i++) {
+		if (a[i] != b[i]) {
+			result.push_back(static_cast<state_part>(i));
+		}
+	}
+	return result;
+}
+
+
+uint64_t StateHash::entry(uint64_t key, uint64_t value) {
+	// splitmix64 of both, so similar entries give unrelated sums
+	uint64_t x = value + key * 0x9e3779b97f4a7c15ull + 0x632be59bd9b4e019ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+} // openage
@@ -0,0 +1,108 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace openage {
+
+namespace rng {
+class RNG;
+} // rng
+
+
+/**
+ * the parts of the game state which are hashed separately,
+ * so a mismatch tells which of them diverged.
+ */
+enum class state_part {
+	positions,
+	hitpoints,
+	resources,
+	rng,
+	// update state_part_count when adding parts
+};
+
+constexpr size_t state_part_count = 4;
+
+using state_parts_t = std::array<uint64_t, state_part_count>;
+
+/**
+ * the name of a part, for messages.
+ */
+const char *state_part_name(state_part part);
+
+
+/**
+ * Checksum of the game state, to detect peers or runs that diverged.
+ *
+ * The hash of a part is the sum of the mixed (key, value) pairs of its
+ * entries, e.g. the position of each unit by unit id. The entries add
+ * their value when they are created, and replace it when it changes,
+ * so the hash is never computed by visiting all units. The sum doesn't
+ * depend on the order of the changes, so units updated by different
+ * threads give the same hash.
+ *
+ * The state of a random number generator is hashed when it's read.
+ */
+class StateHash {
+public:
+	StateHash();
+
+	StateHash(const StateHash &) = delete;
+	StateHash &operator =(const StateHash &) = delete;
+
+	/**
+	 * an entry with the value was added. thread safe.
+	 */
+	void add(state_part part, uint64_t key, uint64_t value);
+
+	/**
+	 * an entry with the value was removed. thread safe.
+	 */
+	void remove(state_part part, uint64_t key, uint64_t value);
+
+	/**
+	 * the value of an entry changed. thread safe.
+	 */
+	void change(state_part part, uint64_t key, uint64_t old_value, uint64_t new_value);
+
+	/**
+	 * hashes the state of the generator as the rng part,
+	 * nullptr if the game has no random numbers.
+	 */
+	void track_rng(const rng::RNG *rng);
+
+	/**
+	 * the hash of one part.
+	 */
+	uint64_t get(state_part part) const;
+
+	/**
+	 * the hash of each part.
+	 */
+	state_parts_t get_parts() const;
+
+	/**
+	 * one hash of all parts.
+	 */
+	uint64_t get() const;
+
+	/**
+	 * the parts whose hashes differ.
+	 */
+	static std::vector<state_part> diverged(const state_parts_t &a, const state_parts_t &b);
+
+private:
+	static uint64_t entry(uint64_t key, uint64_t value);
+
+	std::array<std::atomic<uint64_t>, state_part_count> parts;
+
+	const rng::RNG *rng;
+};
+
+} // openage
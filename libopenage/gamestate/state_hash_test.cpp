@@ -0,0 +1,60 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "state_hash.h"
+
+#include "../rng/rng.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace gamestate {
+namespace tests {
+
+
+// exported test
+void state_hash() {
+	StateHash a, b;
+	a.get() == b.get() or TESTFAIL;
+
+	// the order of the changes doesn't matter
+	a.add(state_part::positions, 1, 100);
+	a.add(state_part::positions, 2, 200);
+	a.change(state_part::positions, 1, 100, 150);
+
+	b.add(state_part::positions, 2, 200);
+	b.add(state_part::positions, 1, 150);
+
+	a.get(state_part::positions) == b.get(state_part::positions) or TESTFAIL;
+	a.get() == b.get() or TESTFAIL;
+
+	// the same values of other entries give another hash
+	b.change(state_part::positions, 1, 150, 200);
+	b.change(state_part::positions, 2, 200, 150);
+	a.get() != b.get() or TESTFAIL;
+
+	b.change(state_part::positions, 1, 200, 150);
+	b.change(state_part::positions, 2, 150, 200);
+	a.get() == b.get() or TESTFAIL;
+
+	// removing everything gives the empty hash
+	StateHash empty;
+	a.remove(state_part::positions, 1, 150);
+	a.remove(state_part::positions, 2, 200);
+	a.get() == empty.get() or TESTFAIL;
+
+	// a mismatch names the part
+	a.add(state_part::hitpoints, 7, 30);
+	StateHash::diverged(a.get_parts(), empty.get_parts()) == std::vector<state_part>{state_part::hitpoints} or TESTFAIL;
+
+	// the generators are compared by their state
+	rng::RNG first{42}, second{42};
+	a.track_rng(&first);
+	empty.track_rng(&second);
+	a.get(state_part::rng) == empty.get(state_part::rng) or TESTFAIL;
+	first.random();
+	a.get(state_part::rng) != empty.get(state_part::rng) or TESTFAIL;
+	second.random();
+	a.get(state_part::rng) == empty.get(state_part::rng) or TESTFAIL;
+}
+
+
+}}} // openage::gamestate::tests
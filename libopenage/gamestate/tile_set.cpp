@@ -0,0 +1,294 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "tile_set.h"
+
+#include <algorithm>
+
+#include "../error/error.h"
+
+
+namespace openage {
+
+namespace {
+
+constexpr size_t word_bits = 64;
+
+} // anonymous namespace
+
+
+TileSet::iterator::iterator(const TileSet *set, size_t bit)
+	:
+	set{set},
+	bit{bit},
+	current{0, 0} {
+	this->advance_to_set();
+}
+
+
+TileSet::iterator::reference TileSet::iterator::operator *() const {
+	return this->current;
+}
+
+
+TileSet::iterator::pointer TileSet::iterator::operator ->() const {
+	return &this->current;
+}
+
+
+TileSet::iterator &TileSet::iterator::operator ++() {
+	this->bit += 1;
+	this->advance_to_set();
+	return *this;
+}
+
+
+bool TileSet::iterator::operator ==(const iterator &other) const {
+	return this->bit == other.bit;
+}
+
+
+bool TileSet::iterator::operator !=(const iterator &other) const {
+	return this->bit != other.bit;
+}
+
+
+void TileSet::iterator::advance_to_set() {
+	size_t end = this->set->words.size() * word_bits;
+	while (this->bit < end) {
+		size_t word = this->bit / word_bits;
+		uint64_t rest = this->set->words[word] >> (this->bit % word_bits);
+		if (rest != 0) {
+			this->bit += __builtin_ctzll(rest);
+			this->current = this->set->tile_of(this->bit);
+			return;
+		}
+		this->bit = (word + 1) * word_bits;
+	}
+	this->bit = end;
+}
+
+
+TileSet::TileSet()
+	:
+	TileSet{coord::tile{0, 0}, coord::tile_delta{0, 0}} {}
+
+
+TileSet::TileSet(coord::tile start, coord::tile_delta size)
+	:
+	start(start),
+	extent(size),
+	// at least one spare bit, which takes the carries of the last column
+	row_words{static_cast<size_t>(std::max<coord::tile_t>(size.ne, 0)) / word_bits + 1},
+	words(this->row_words * static_cast<size_t>(std::max<coord::tile_t>(size.se, 0)), 0),
+	tile_count{0} {}
+
+
+TileSet TileSet::empty_like(const TileSet &other) {
+	return TileSet{other.start, other.extent};
+}
+
+
+bool TileSet::in_bounds(coord::tile tile) const {
+	return (tile.ne >= this->start.ne and tile.ne < this->start.ne + this->extent.ne and
+	        tile.se >= this->start.se and tile.se < this->start.se + this->extent.se);
+}
+
+
+size_t TileSet::count(coord::tile tile) const {
+	if (not this->in_bounds(tile)) {
+		return 0;
+	}
+	size_t bit = this->bit_of(tile);
+	return (this->words[bit / word_bits] >> (bit % word_bits)) & 1;
+}
+
+
+void TileSet::insert(coord::tile tile) {
+	if (not this->in_bounds(tile)) {
+		return;
+	}
+	size_t bit = this->bit_of(tile);
+	uint64_t &word = this->words[bit / word_bits];
+	uint64_t mask = uint64_t{1} << (bit % word_bits);
+	if ((word & mask) == 0) {
+		word |= mask;
+		this->tile_count += 1;
+	}
+}
+
+
+void TileSet::erase(coord::tile tile) {
+	if (not this->in_bounds(tile)) {
+		return;
+	}
+	size_t bit = this->bit_of(tile);
+	uint64_t &word = this->words[bit / word_bits];
+	uint64_t mask = uint64_t{1} << (bit % word_bits);
+	if ((word & mask) != 0) {
+		word &= ~mask;
+		this->tile_count -= 1;
+	}
+}
+
+
+void TileSet::clear() {
+	std::fill(std::begin(this->words), std::end(this->words), 0);
+	this->tile_count = 0;
+}
+
+
+size_t TileSet::size() const {
+	return this->tile_count;
+}
+
+
+bool TileSet::empty() const {
+	return this->tile_count == 0;
+}
+
+
+coord::tile TileSet::get_start() const {
+	return this->start;
+}
+
+
+coord::tile_delta TileSet::get_extent() const {
+	return this->extent;
+}
+
+
+coord::tile TileSet::nth(size_t index) const {
+	ENSURE(index < this->tile_count, "tile index out of range");
+
+	// skip whole words by their number of tiles
+	size_t word = 0;
+	while (true) {
+		size_t tiles = __builtin_popcountll(this->words[word]);
+		if (index < tiles) {
+			break;
+		}
+		index -= tiles;
+		word += 1;
+	}
+
+	// then clear the lowest bits of the word
+	uint64_t bits = this->words[word];
+	for (size_t i = 0; i < index; i++) {
+		bits &= bits - 1;
+	}
+	return this->tile_of(word * word_bits + __builtin_ctzll(bits));
+}
+
+
+void TileSet::subtract(const TileSet &other) {
+	this->check_same_bounds(other);
+
+	// plain loops over the words, which the compiler vectorizes
+	const uint64_t *src = other.words.data();
+	uint64_t *dst = this->words.data();
+	for (size_t i = 0; i < this->words.size(); i++) {
+		dst[i] &= ~src[i];
+	}
+	this->recount();
+}
+
+
+void TileSet::intersect(const TileSet &other) {
+	this->check_same_bounds(other);
+
+	const uint64_t *src = other.words.data();
+	uint64_t *dst = this->words.data();
+	for (size_t i = 0; i < this->words.size(); i++) {
+		dst[i] &= src[i];
+	}
+	this->recount();
+}
+
+
+void TileSet::add_neighbors(const TileSet &other) {
+	this->check_same_bounds(other);
+
+	const uint64_t *src = other.words.data();
+	uint64_t *dst = this->words.data();
+	size_t rows = static_cast<size_t>(std::max<coord::tile_t>(this->extent.se, 0));
+	size_t columns = static_cast<size_t>(std::max<coord::tile_t>(this->extent.ne, 0));
+
+	// bits of the last word of a row that are tiles
+	uint64_t last_mask = (uint64_t{1} << (columns % word_bits)) - 1;
+
+	for (size_t row = 0; row < rows; row++) {
+		const uint64_t *above = row > 0 ? src + (row - 1) * this->row_words : nullptr;
+		const uint64_t *line = src + row * this->row_words;
+		const uint64_t *below = row + 1 < rows ? src + (row + 1) * this->row_words : nullptr;
+		uint64_t *out = dst + row * this->row_words;
+
+		for (size_t w = 0; w < this->row_words; w++) {
+			// along ne, with the carries of the neighbor words
+			uint64_t grown = (line[w] << 1) | (line[w] >> 1);
+			if (w > 0) {
+				grown |= line[w - 1] >> (word_bits - 1);
+			}
+			if (w + 1 < this->row_words) {
+				grown |= line[w + 1] << (word_bits - 1);
+			}
+
+			// along se
+			if (above) {
+				grown |= above[w];
+			}
+			if (below) {
+				grown |= below[w];
+			}
+			out[w] |= grown;
+		}
+
+		// the spare bits got the carries of the last column
+		out[this->row_words - 1] &= last_mask;
+	}
+	this->recount();
+}
+
+
+TileSet::iterator TileSet::begin() const {
+	return iterator{this, 0};
+}
+
+
+TileSet::iterator TileSet::end() const {
+	return iterator{this, this->words.size() * word_bits};
+}
+
+
+void TileSet::check_same_bounds(const TileSet &other) const {
+	ENSURE(this->start == other.start and
+	       this->extent.ne == other.extent.ne and
+	       this->extent.se == other.extent.se,
+	       "tile sets of different rectangles can't be combined");
+}
+
+
+size_t TileSet::bit_of(coord::tile tile) const {
+	size_t row = static_cast<size_t>(tile.se - this->start.se);
+	size_t column = static_cast<size_t>(tile.ne - this->start.ne);
+	return row * this->row_words * word_bits + column;
+}
+
+
+coord::tile TileSet::tile_of(size_t bit) const {
+	size_t row_bits = this->row_words * word_bits;
+	return coord::tile{
+		this->start.ne + static_cast<coord::tile_t>(bit % row_bits),
+		this->start.se + static_cast<coord::tile_t>(bit / row_bits)
+	};
+}
+
+
+void TileSet::recount() {
+	size_t total = 0;
+	for (uint64_t word : this->words) {
+		total += __builtin_popcountll(word);
+	}
+	this->tile_count = total;
+}
+
+} // namespace openage
@@ -0,0 +1,159 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "../coord/tile.h"
+
+namespace openage {
+
+/**
+ * A set of tiles within a fixed rectangle of the map, stored as one bit
+ * per tile.
+ *
+ * Sets of the same rectangle are combined word by word, and the tiles
+ * next to a set are found by shifting its rows. The bits of a row are
+ * padded to full words, with at least one spare bit, so shifting along
+ * a row never carries into the next one.
+ */
+class TileSet {
+public:
+	/**
+	 * iterates the tiles of a set, row by row.
+	 */
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = coord::tile;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const coord::tile *;
+		using reference = const coord::tile &;
+
+		iterator(const TileSet *set, size_t bit);
+
+		reference operator *() const;
+		pointer operator ->() const;
+		iterator &operator ++();
+
+		bool operator ==(const iterator &other) const;
+		bool operator !=(const iterator &other) const;
+
+	private:
+		/**
+		 * moves to the first set bit from the current one on
+		 */
+		void advance_to_set();
+
+		const TileSet *set;
+		size_t bit;
+		coord::tile current;
+	};
+
+	/**
+	 * an empty set without tiles, nothing can be inserted.
+	 */
+	TileSet();
+
+	/**
+	 * an empty set for the tiles from start to start + size.
+	 */
+	TileSet(coord::tile start, coord::tile_delta size);
+
+	/**
+	 * an empty set with the rectangle of the other one.
+	 */
+	static TileSet empty_like(const TileSet &other);
+
+	/**
+	 * whether the tile is in the rectangle of the set.
+	 */
+	bool in_bounds(coord::tile tile) const;
+
+	/**
+	 * 1 if the set contains the tile, else 0.
+	 */
+	size_t count(coord::tile tile) const;
+
+	/**
+	 * adds a tile within the rectangle, others are ignored.
+	 */
+	void insert(coord::tile tile);
+
+	void erase(coord::tile tile);
+
+	void clear();
+
+	size_t size() const;
+	bool empty() const;
+
+	/**
+	 * the first tile of the rectangle of the set.
+	 */
+	coord::tile get_start() const;
+
+	/**
+	 * the size of the rectangle of the set.
+	 */
+	coord::tile_delta get_extent() const;
+
+	/**
+	 * the index-th tile in iteration order, index must be below size().
+	 */
+	coord::tile nth(size_t index) const;
+
+	/**
+	 * removes the tiles of the other set,
+	 * which must have the same rectangle.
+	 */
+	void subtract(const TileSet &other);
+
+	/**
+	 * keeps only the tiles that are in the other set,
+	 * which must have the same rectangle.
+	 */
+	void intersect(const TileSet &other);
+
+	/**
+	 * adds the tiles next to the tiles of the other set, in the four
+	 * directions of neigh_tiles. the other set must have the same rectangle.
+	 */
+	void add_neighbors(const TileSet &other);
+
+	iterator begin() const;
+	iterator end() const;
+
+private:
+	/**
+	 * checks that the other set has the same rectangle.
+	 */
+	void check_same_bounds(const TileSet &other) const;
+
+	size_t bit_of(coord::tile tile) const;
+	coord::tile tile_of(size_t bit) const;
+
+	/**
+	 * counts the tiles again after the words were changed.
+	 */
+	void recount();
+
+	coord::tile start;
+	coord::tile_delta extent;
+
+	/**
+	 * number of words of each row, along se
+	 */
+	size_t row_words;
+
+	std::vector<uint64_t> words;
+
+	/**
+	 * number of tiles in the set
+	 */
+	size_t tile_count;
+};
+
+} // namespace openage
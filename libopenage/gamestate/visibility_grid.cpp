@@ -0,0 +1,148 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "visibility_grid.h"
+
+#include <cmath>
+
+namespace openage {
+
+namespace {
+
+/**
+ * index of the tile in the arrays of its chunk.
+ */
+size_t tile_index(const coord::tile &tile) {
+	coord::tile_delta on_chunk = tile.get_pos_on_chunk();
+	return on_chunk.se * coord::settings::tiles_per_chunk + on_chunk.ne;
+}
+
+} // anonymous namespace
+
+
+VisibilityGrid::VisibilityGrid()
+	:
+	revision{0} {}
+
+
+void VisibilityGrid::add_sight(const coord::tile &center, int radius) {
+	this->apply(center, radius, 1);
+}
+
+
+void VisibilityGrid::remove_sight(const coord::tile &center, int radius) {
+	this->apply(center, radius, -1);
+}
+
+
+void VisibilityGrid::move_sight(const coord::tile &from, const coord::tile &to, int radius) {
+	// adding first keeps the tiles of both stamps visible throughout,
+	// so only the tiles at the edges change their state
+	this->apply(to, radius, 1);
+	this->apply(from, radius, -1);
+}
+
+
+bool VisibilityGrid::is_visible(const coord::tile &tile) const {
+	const chunk_sight *sight = this->find(tile);
+	if (sight == nullptr) {
+		return false;
+	}
+	size_t index = tile_index(tile);
+	return (sight->visible[index / 64] >> (index % 64)) & 1;
+}
+
+
+bool VisibilityGrid::is_explored(const coord::tile &tile) const {
+	const chunk_sight *sight = this->find(tile);
+	if (sight == nullptr) {
+		return false;
+	}
+	size_t index = tile_index(tile);
+	return (sight->explored[index / 64] >> (index % 64)) & 1;
+}
+
+
+uint64_t VisibilityGrid::get_revision() const {
+	return this->revision;
+}
+
+
+size_t VisibilityGrid::chunk_hash::operator ()(const coord::chunk &chunk) const {
+	constexpr int half_size_t_bits = sizeof(size_t) * 4;
+	return (static_cast<size_t>(chunk.ne) << half_size_t_bits) ^ static_cast<size_t>(chunk.se);
+}
+
+
+const std::vector<coord::tile_t> &VisibilityGrid::stamp(int radius) {
+	if (this->stamps.size() <= static_cast<size_t>(radius)) {
+		this->stamps.resize(radius + 1);
+	}
+
+	std::vector<coord::tile_t> &rows = this->stamps[radius];
+	if (rows.empty()) {
+		// the half tile makes the edge rounder than the exact circle
+		double edge = radius + 0.5;
+		for (int se = -radius; se <= radius; se++) {
+			rows.push_back(static_cast<coord::tile_t>(std::sqrt(edge * edge - se * se)));
+		}
+	}
+	return rows;
+}
+
+
+void VisibilityGrid::apply(const coord::tile &center, int radius, int delta) {
+	if (radius < 0) {
+		return;
+	}
+
+	const std::vector<coord::tile_t> &rows = this->stamp(radius);
+	bool changed = false;
+
+	// consecutive tiles are mostly on the same chunk
+	chunk_sight *sight = nullptr;
+	coord::chunk sight_chunk{0, 0};
+
+	for (size_t row = 0; row < rows.size(); row++) {
+		coord::tile_t se = center.se - radius + static_cast<coord::tile_t>(row);
+
+		for (coord::tile_t ne = center.ne - rows[row]; ne <= center.ne + rows[row]; ne++) {
+			coord::tile tile{ne, se};
+			coord::chunk chunk = tile.to_chunk();
+			if (sight == nullptr or not (chunk == sight_chunk)) {
+				sight = &this->chunks[chunk];
+				sight_chunk = chunk;
+			}
+
+			size_t index = tile_index(tile);
+			uint16_t &count = sight->count[index];
+			uint64_t bit = uint64_t{1} << (index % 64);
+
+			if (delta > 0) {
+				if (count++ == 0) {
+					sight->visible[index / 64] |= bit;
+					sight->explored[index / 64] |= bit;
+					changed = true;
+				}
+			}
+			else if (count > 0 and --count == 0) {
+				sight->visible[index / 64] &= ~bit;
+				changed = true;
+			}
+		}
+	}
+
+	if (changed) {
+		this->revision += 1;
+	}
+}
+
+
+const VisibilityGrid::chunk_sight *VisibilityGrid::find(const coord::tile &tile) const {
+	auto it = this->chunks.find(tile.to_chunk());
+	if (it == this->chunks.end()) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+} // openage
@@ -0,0 +1,108 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/tile.h"
+
+namespace openage {
+
+/**
+ * the tiles one player sees, and the ones it has seen before.
+ *
+ * units add a circular stamp of their line of sight, which is counted
+ * per tile, so overlapping stamps are removed independently. the stamps
+ * only change when a unit moves to another tile, the cost is therefore
+ * proportional to the movement and not to the number of units.
+ *
+ * the state is kept as bits for each chunk, so queries are a bit test.
+ * chunks are created when they are first seen, the grid has no bounds.
+ */
+class VisibilityGrid {
+public:
+	VisibilityGrid();
+
+	/**
+	 * adds the line of sight of a unit standing on the center tile.
+	 * the tiles become visible and explored.
+	 */
+	void add_sight(const coord::tile &center, int radius);
+
+	/**
+	 * removes a line of sight which was added before.
+	 * tiles without other sight become invisible, but stay explored.
+	 */
+	void remove_sight(const coord::tile &center, int radius);
+
+	/**
+	 * moves a line of sight to another center tile.
+	 */
+	void move_sight(const coord::tile &from, const coord::tile &to, int radius);
+
+	/**
+	 * is the tile in the line of sight of a unit?
+	 */
+	bool is_visible(const coord::tile &tile) const;
+
+	/**
+	 * was the tile visible at any time?
+	 */
+	bool is_explored(const coord::tile &tile) const;
+
+	/**
+	 * increased whenever tiles become visible or invisible,
+	 * so observers only update when it's different.
+	 */
+	uint64_t get_revision() const;
+
+private:
+	static constexpr size_t chunk_tiles = coord::settings::tiles_per_chunk * coord::settings::tiles_per_chunk;
+	static constexpr size_t chunk_words = (chunk_tiles + 63) / 64;
+
+	struct chunk_sight {
+		/**
+		 * number of stamps covering each tile
+		 */
+		std::array<uint16_t, chunk_tiles> count;
+
+		std::array<uint64_t, chunk_words> visible;
+		std::array<uint64_t, chunk_words> explored;
+	};
+
+	struct chunk_hash {
+		size_t operator ()(const coord::chunk &chunk) const;
+	};
+
+	/**
+	 * the half widths of the rows of a stamp, from se = -radius
+	 * to se = radius. computed once for each radius.
+	 */
+	const std::vector<coord::tile_t> &stamp(int radius);
+
+	/**
+	 * adds delta to the counts of the tiles in the stamp.
+	 */
+	void apply(const coord::tile &center, int radius, int delta);
+
+	/**
+	 * the chunk containing the tile, nullptr if it was never seen.
+	 */
+	const chunk_sight *find(const coord::tile &tile) const;
+
+	std::unordered_map<coord::chunk, chunk_sight, chunk_hash> chunks;
+
+	/**
+	 * stamps by radius
+	 */
+	std::vector<std::vector<coord::tile_t>> stamps;
+
+	uint64_t revision;
+};
+
+} // openage
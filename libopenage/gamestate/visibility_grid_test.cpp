@@ -0,0 +1,53 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "visibility_grid.h"
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace gamestate {
+namespace tests {
+
+
+// exported test
+void visibility_grid() {
+	VisibilityGrid grid;
+	coord::tile origin{0, 0};
+
+	grid.is_visible(origin) and TESTFAIL;
+	grid.is_explored(origin) and TESTFAIL;
+
+	// the stamp crosses the chunk borders at 0
+	grid.add_sight(origin, 3);
+	grid.is_visible(coord::tile{3, 0}) or TESTFAIL;
+	grid.is_visible(coord::tile{-3, 0}) or TESTFAIL;
+	grid.is_visible(coord::tile{0, -3}) or TESTFAIL;
+	grid.is_visible(coord::tile{2, 2}) or TESTFAIL;
+	grid.is_visible(coord::tile{3, 3}) and TESTFAIL;
+	grid.is_visible(coord::tile{4, 0}) and TESTFAIL;
+
+	// overlapping stamps are counted
+	uint64_t revision = grid.get_revision();
+	grid.add_sight(coord::tile{1, 0}, 3);
+	grid.remove_sight(origin, 3);
+	grid.is_visible(coord::tile{4, 0}) or TESTFAIL;
+	grid.is_visible(coord::tile{-1, 0}) or TESTFAIL;
+	grid.is_visible(coord::tile{-3, 0}) and TESTFAIL;
+	grid.is_explored(coord::tile{-3, 0}) or TESTFAIL;
+	grid.get_revision() != revision or TESTFAIL;
+
+	// moving only changes the edges
+	grid.move_sight(coord::tile{1, 0}, coord::tile{20, 20}, 3);
+	grid.is_visible(coord::tile{1, 0}) and TESTFAIL;
+	grid.is_visible(coord::tile{20, 17}) or TESTFAIL;
+	grid.is_explored(coord::tile{4, 0}) or TESTFAIL;
+
+	revision = grid.get_revision();
+	grid.remove_sight(coord::tile{20, 20}, 3);
+	grid.is_visible(coord::tile{20, 20}) and TESTFAIL;
+	grid.is_explored(coord::tile{20, 20}) or TESTFAIL;
+	grid.get_revision() != revision or TESTFAIL;
+}
+
+
+}}} // openage::gamestate::tests
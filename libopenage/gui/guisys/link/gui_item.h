@@ -1,10 +1,11 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <memory>
 #include <cassert>
 #include <functional>
+#include <string>
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
@@ -121,6 +122,24 @@ protected:
 	std::function<void()> on_core_adopted_func;
 };
 
+/**
+ * Identifies the assignment of a property of an object through the setter f,
+ * so that a pending assignment can be superseded by a newer one.
+ *
+ * Only setters that are function pointers are identified, other callables
+ * get an empty key.
+ */
+template<typename F>
+std::string property_assignment_key(const void *object, const F &f) {
+	if (!std::is_member_function_pointer<F>::value && !std::is_pointer<F>::value)
+		return std::string{};
+
+	std::string key{reinterpret_cast<const char*>(&object), sizeof(object)};
+	key.append(typeid(F).name());
+	key.append(reinterpret_cast<const char*>(&f), sizeof(f));
+	return key;
+}
+
 template<typename T>
 class GuiItemOrigin {
 	template<typename>
@@ -180,7 +199,7 @@ public:
 	void i(F f, Args&& ... args) {
 		GuiItemBase *base = checked_static_cast<GuiItemBase*>(checked_static_cast<T*>(this));
 
-		emit base->game_logic_caller.in_game_logic_thread([=] {
+		base->game_logic_caller.in_game_logic_thread([=] {
 			static_assert_about_unwrapping<F, decltype(unwrap(checked_static_cast<T*>(this))), decltype(unwrap_if_can(args))...>();
 			f(unwrap(checked_static_cast<T*>(this)), unwrap_if_can(args)...);
 		});
@@ -217,11 +236,14 @@ private:
 
 		static_assert_about_unwrapping<F, decltype(unwrap(checked_static_cast<T*>(this))), decltype(unwrap_if_can(arg))>();
 
+		// repeated assignments of a property before the game logic runs only deliver the last one
+		const std::string key = property_assignment_key(this, f);
+
 		if (base->init_over)
-			emit base->game_logic_caller.in_game_logic_thread([=] {f(unwrap(checked_static_cast<T*>(this)), unwrap_if_can(arg));});
+			base->game_logic_caller.in_game_logic_thread([=] {f(unwrap(checked_static_cast<T*>(this)), unwrap_if_can(arg));}, key);
 		else
 			base->static_properties_assignments.push_back([=] {
-				emit base->game_logic_caller.in_game_logic_thread([=] {f(unwrap(checked_static_cast<T*>(this)), unwrap_if_can(arg));});
+				base->game_logic_caller.in_game_logic_thread([=] {f(unwrap(checked_static_cast<T*>(this)), unwrap_if_can(arg));}, key);
 			});
 	}
 };
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "game_logic_caller.h"
 
@@ -8,14 +8,19 @@ namespace qtsdl {
 
 GameLogicCaller::GameLogicCaller()
 	:
-	QObject{} {
+	QObject{},
+	game_logic_callback{} {
 }
 
 void GameLogicCaller::set_game_logic_callback(GuiCallback *game_logic_callback) {
-	QObject::disconnect(this, &GameLogicCaller::in_game_logic_thread, 0, 0);
 	QObject::disconnect(this, &GameLogicCaller::in_game_logic_thread_blocking, 0, 0);
-	QObject::connect(this, &GameLogicCaller::in_game_logic_thread, game_logic_callback, &GuiCallback::process);
 	QObject::connect(this, &GameLogicCaller::in_game_logic_thread_blocking, game_logic_callback, &GuiCallback::process_blocking, Qt::DirectConnection);
+	this->game_logic_callback = game_logic_callback;
+}
+
+void GameLogicCaller::in_game_logic_thread(const std::function<void()>& f, const std::string &key) const {
+	if (this->game_logic_callback)
+		this->game_logic_callback->enqueue(f, key);
 }
 
 } // namespace qtsdl
@@ -1,8 +1,9 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
+#include <string>
 
 #include <QObject>
 
@@ -24,9 +25,18 @@ public:
 	 */
 	void set_game_logic_callback(GuiCallback *game_logic_callback);
 
+	/**
+	 * Queues the function into the batch that the game logic thread runs next.
+	 *
+	 * @param key replaces the pending function with the same key, see GuiCallback::enqueue()
+	 */
+	void in_game_logic_thread(const std::function<void()>& f, const std::string &key=std::string{}) const;
+
 signals:
-	void in_game_logic_thread(const std::function<void()>& f) const;
 	void in_game_logic_thread_blocking(const std::function<void()>& f) const;
+
+private:
+	GuiCallback *game_logic_callback;
 };
 
 } // namespace qtsdl
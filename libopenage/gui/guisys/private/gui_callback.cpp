@@ -1,9 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "gui_callback.h"
 
 #include <cassert>
 
+#include <QThread>
+
+#include "gui_event_queue_impl.h"
+
 namespace qtsdl {
 
 namespace {
@@ -12,7 +16,9 @@ const int registration = qRegisterMetaType<std::function<void()>>("function");
 
 GuiCallback::GuiCallback()
 	:
-	QObject{} {
+	QObject{},
+	pending_coalesced{},
+	event_queue{} {
 	Q_UNUSED(registration);
 }
 
@@ -23,4 +29,60 @@ void GuiCallback::process(const std::function<void()> &f) {
 	f();
 }
 
+void GuiCallback::enqueue(const std::function<void()> &f, const std::string &key) {
+	if (QThread::currentThread() == this->thread()) {
+		f();
+		return;
+	}
+
+	bool first = false;
+
+	{
+		std::lock_guard<std::mutex> lck{this->pending_guard};
+
+		if (!key.empty()) {
+			auto it = this->pending_keys.find(key);
+
+			if (it != std::end(this->pending_keys)) {
+				this->pending[it->second] = f;
+				++this->pending_coalesced;
+				return;
+			}
+
+			this->pending_keys.emplace(key, this->pending.size());
+		}
+
+		first = this->pending.empty();
+		this->pending.push_back(f);
+	}
+
+	// one event for the whole batch
+	if (first)
+		QMetaObject::invokeMethod(this, "process_pending", Qt::QueuedConnection);
+}
+
+void GuiCallback::set_event_queue(GuiEventQueueImpl *event_queue) {
+	this->event_queue = event_queue;
+}
+
+void GuiCallback::process_pending() {
+	std::vector<std::function<void()>> batch;
+	size_t coalesced;
+
+	{
+		std::lock_guard<std::mutex> lck{this->pending_guard};
+
+		std::swap(batch, this->pending);
+		this->pending_keys.clear();
+		coalesced = this->pending_coalesced;
+		this->pending_coalesced = 0;
+	}
+
+	for (auto &f : batch)
+		f();
+
+	if (this->event_queue)
+		this->event_queue->count_batch(batch.size(), coalesced);
+}
+
 } // namespace qtsdl
@@ -1,14 +1,27 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <QObject>
 #include <QMetaType>
 
 namespace qtsdl {
 
+class GuiEventQueueImpl;
+
+/**
+ * Runs functions in the thread of this object.
+ *
+ * Functions that are queued from other threads are collected and run as
+ * one batch when the thread processes its events, so a thread handoff is
+ * made once per batch instead of once per function.
+ */
 class GuiCallback : public QObject {
 	Q_OBJECT
 
@@ -16,11 +29,42 @@ public:
 	GuiCallback();
 	virtual ~GuiCallback();
 
+	/**
+	 * Queues a function to run in the thread of this object, or runs it
+	 * right away when called from that thread.
+	 *
+	 * A function with the same key as a pending one takes its place, e.g.
+	 * when the same property is assigned repeatedly before the batch runs.
+	 *
+	 * @param key identifies what the function does, empty if it's never superseded
+	 */
+	void enqueue(const std::function<void()> &f, const std::string &key=std::string{});
+
+	/**
+	 * Reports the delivered batches to the queue, which must belong to the thread of this object.
+	 */
+	void set_event_queue(GuiEventQueueImpl *event_queue);
+
 signals:
 	void process_blocking(const std::function<void()> &f);
 
 public slots:
 	void process(const std::function<void()> &f);
+
+private slots:
+	void process_pending();
+
+private:
+	std::mutex pending_guard;
+	std::vector<std::function<void()>> pending;
+
+	/**
+	 * Index into the pending functions, by key.
+	 */
+	std::unordered_map<std::string, size_t> pending_keys;
+	size_t pending_coalesced;
+
+	GuiEventQueueImpl *event_queue;
 };
 
 } // namespace qtsdl
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "gui_event_queue_impl.h"
 
@@ -6,13 +6,13 @@
 
 #include <QThread>
 
-#include "../public/gui_event_queue.h"
-
 namespace qtsdl {
 
 GuiEventQueueImpl::GuiEventQueueImpl()
 	:
-	thread{QThread::currentThread()} {
+	thread{QThread::currentThread()},
+	current_stats{},
+	last_stats{} {
 }
 
 GuiEventQueueImpl::~GuiEventQueueImpl() {
@@ -24,7 +24,21 @@ GuiEventQueueImpl* GuiEventQueueImpl::impl(GuiEventQueue *event_queue) {
 
 void GuiEventQueueImpl::process_callbacks() {
 	assert(QThread::currentThread() == this->thread);
+
+	this->current_stats = GuiEventQueueStats{};
 	this->callback_processor.processEvents();
+	this->last_stats = this->current_stats;
+}
+
+void GuiEventQueueImpl::count_batch(size_t delivered, size_t coalesced) {
+	assert(QThread::currentThread() == this->thread);
+
+	this->current_stats.delivered += delivered;
+	this->current_stats.coalesced += coalesced;
+}
+
+GuiEventQueueStats GuiEventQueueImpl::get_stats() const {
+	return this->last_stats;
 }
 
 QThread* GuiEventQueueImpl::get_thread() {
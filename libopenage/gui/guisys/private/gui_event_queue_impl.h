@@ -1,16 +1,16 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <QtGlobal>
 #include <QEventLoop>
 
+#include "../public/gui_event_queue.h"
+
 QT_FORWARD_DECLARE_CLASS(QThread)
 
 namespace qtsdl {
 
-class GuiEventQueue;
-
 /**
  * Provides synchronization with some game thread.
  */
@@ -23,11 +23,22 @@ public:
 
 	void process_callbacks();
 
+	/**
+	 * Adds a delivered batch to the numbers of the current processing.
+	 * Called from the thread of the queue.
+	 */
+	void count_batch(size_t delivered, size_t coalesced);
+
+	GuiEventQueueStats get_stats() const;
+
 	QThread* get_thread();
 
 private:
 	QThread * const thread;
 	QEventLoop callback_processor;
+
+	GuiEventQueueStats current_stats;
+	GuiEventQueueStats last_stats;
 };
 
 } // namespace qtsdl
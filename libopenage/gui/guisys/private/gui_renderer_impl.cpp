@@ -1,7 +1,8 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "gui_renderer_impl.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <QOpenGLContext>
@@ -19,6 +20,21 @@ namespace qtsdl {
 
 namespace {
 const int registration = qRegisterMetaType<std::atomic<bool>*>("atomic_bool_ptr");
+
+/**
+ * Adds the scene bounds of the item and its children that draw something.
+ * Items without contents, like layouts, don't count, but their children do.
+ */
+void unite_content_rects(QQuickItem *item, QRectF &rect) {
+	if (!item->isVisible() || item->opacity() <= 0)
+		return;
+
+	if (item->flags() & QQuickItem::ItemHasContents)
+		rect |= item->mapRectToScene(item->boundingRect());
+
+	for (auto child : item->childItems())
+		unite_content_rects(child, rect);
+}
 }
 
 EventHandlingQuickWindow::EventHandlingQuickWindow(QQuickRenderControl *render_control)
@@ -80,6 +96,7 @@ GuiRendererImpl::GuiRendererImpl(SDL_Window *window)
 	need_fbo_resize{true},
 	need_sync{},
 	need_render{},
+	content_rect_known{},
 	gui_locked{},
 	renderer_waiting_on_cond{} {
 
@@ -136,16 +153,45 @@ void GuiRendererImpl::on_scene_changed() {
 	this->render_control.polishItems();
 }
 
-void GuiRendererImpl::reinit_fbo_if_needed() {
+bool GuiRendererImpl::reinit_fbo_if_needed() {
 	assert(QThread::currentThread() == this->ctx->thread());
 
+	bool created = false;
+
 	if (this->need_fbo_resize) {
 		this->fbo = std::make_unique<QOpenGLFramebufferObject>(QSize(this->new_fbo_width, this->new_fbo_height), QOpenGLFramebufferObject::CombinedDepthStencil);
 		this->window->setRenderTarget(&*this->fbo);
 		this->need_fbo_resize = false;
+		created = true;
 	}
 
 	assert(this->fbo);
+	return created;
+}
+
+void GuiRendererImpl::update_content_rect() {
+	QRectF rect;
+	unite_content_rects(this->window->contentItem(), rect);
+
+	this->content_rect = rect;
+	this->content_rect_known = true;
+}
+
+GuiRect GuiRendererImpl::get_content_rect() const {
+	if (!this->content_rect_known || !this->fbo)
+		return GuiRect{0, 0, 1, 1};
+
+	// whole pixels, the edges of items are smoothed
+	QRect pixels = this->content_rect.toAlignedRect().adjusted(-1, -1, 1, 1);
+	float width = this->fbo->width();
+	float height = this->fbo->height();
+
+	return GuiRect{
+		std::max(0.f, pixels.left() / width),
+		std::max(0.f, pixels.top() / height),
+		std::min(1.f, (pixels.right() + 1) / width),
+		std::min(1.f, (pixels.bottom() + 1) / height),
+	};
 }
 
 GuiRendererImpl::~GuiRendererImpl() {
@@ -162,8 +208,10 @@ GuiRendererImpl* GuiRendererImpl::impl(GuiRenderer *renderer) {
 	return renderer->impl.get();
 }
 
-GLuint GuiRendererImpl::render() {
-	this->reinit_fbo_if_needed();
+GLuint GuiRendererImpl::render(bool *updated) {
+	// a new FBO is empty
+	if (this->reinit_fbo_if_needed())
+		this->need_render = true;
 
 	// QQuickRenderControl::sync() must be called from the render thread while the gui thread is stopped.
 	if (this->need_sync) {
@@ -178,6 +226,7 @@ GLuint GuiRendererImpl::render() {
 				this->renderer_waiting_on_cond = false;
 
 				this->render_control.sync();
+				this->update_content_rect();
 
 				this->need_sync = false;
 				this->gui_locked = false;
@@ -187,12 +236,21 @@ GLuint GuiRendererImpl::render() {
 			}
 		} else {
 			this->render_control.sync();
+			this->update_content_rect();
+			this->need_sync = false;
 		}
 	}
 
-	this->render_control.render();
+	// the texture keeps the last frame until something changes
+	const bool render_now = this->need_render.exchange(false);
+
+	if (render_now) {
+		this->render_control.render();
+		this->window->resetOpenGLState();
+	}
 
-	this->window->resetOpenGLState();
+	if (updated)
+		*updated = render_now;
 
 	return this->fbo->texture();
 }
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -13,6 +13,9 @@
 #include <QQuickWindow>
 #include <QQuickRenderControl>
 #include <QOffscreenSurface>
+#include <QRectF>
+
+#include "../public/gui_renderer.h"
 
 struct SDL_Window;
 
@@ -21,8 +24,6 @@ QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
 
 namespace qtsdl {
 
-class GuiRenderer;
-
 class EventHandlingQuickWindow : public QQuickWindow {
 	Q_OBJECT
 
@@ -52,9 +53,18 @@ public:
 	static GuiRendererImpl* impl(GuiRenderer *renderer);
 
 	/**
+	 * Renders the gui when the scene changed or Qt requested it,
+	 * otherwise the texture keeps the previous frame.
+	 *
+	 * @param updated set to whether the texture was rendered again
 	 * @return texture ID where GUI was rendered
 	 */
-	GLuint render();
+	GLuint render(bool *updated);
+
+	/**
+	 * @return area of the texture that has gui items
+	 */
+	GuiRect get_content_rect() const;
 
 	void resize(const QSize &size);
 
@@ -107,8 +117,16 @@ private slots:
 private:
 	/**
 	 * If size changes, then create a new FBO for GUI rendering
+	 *
+	 * @return true if the FBO was created
 	 */
-	void reinit_fbo_if_needed();
+	bool reinit_fbo_if_needed();
+
+	/**
+	 * Collects the bounds of the visible items that draw something.
+	 * Reads the item tree, so the gui thread must be stopped.
+	 */
+	void update_content_rect();
 
 	/**
 	 * GL context of the game
@@ -137,6 +155,13 @@ private:
 	std::atomic<bool> need_sync;
 	std::atomic<bool> need_render;
 
+	/**
+	 * Bounds of the items in scene coordinates, as of the last sync.
+	 * Only used by the render thread.
+	 */
+	QRectF content_rect;
+	bool content_rect_known;
+
 	bool gui_locked;
 	std::mutex gui_guard;
 	std::condition_variable gui_locked_cond;
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "gui_subtree_impl.h"
 
@@ -54,24 +54,29 @@ GuiSubtreeImpl::GuiSubtreeImpl(GuiRenderer *renderer, GuiEventQueue *game_logic_
 
 	assert(this->root_component);
 	// Need to queue the loading because some underlying game logic elements require the loop to be running (maybe some things that are created after the gui).
-	QMetaObject::invokeMethod(this->root_component.get(), "loadUrl", Qt::QueuedConnection, Q_ARG(QUrl, resolved_source));
+	QMetaObject::invokeMethod(this, "load_root", Qt::QueuedConnection);
 }
 
 GuiSubtreeImpl::~GuiSubtreeImpl() {
 }
 
 void GuiSubtreeImpl::onEngineReloaded() {
-	const QUrl source = this->root_component->url();
-
-	destroy_root();
-
+	// the old items stay until the new ones are compiled
 	this->root_component = std::make_unique<QQmlComponent>(this->engine.get_qml_engine());
 	QObject::connect(&*this->root_component, &QQmlComponent::statusChanged, this, &GuiSubtreeImpl::component_status_changed);
-	this->root_component->loadUrl(source);
+	this->load_root();
+}
+
+void GuiSubtreeImpl::load_root() {
+	// the qml files are parsed and compiled by the loader thread of the engine,
+	// so the frames are drawn meanwhile. since qt 5.8, the compiled files
+	// are kept in its disk cache, so later starts only load them.
+	this->root_component->loadUrl(this->source, QQmlComponent::Asynchronous);
 }
 
 void GuiSubtreeImpl::attach_to(GuiEventQueueImpl *game_logic_updater) {
 	this->game_logic_callback.moveToThread(game_logic_updater->get_thread());
+	this->game_logic_callback.set_event_queue(game_logic_updater);
 }
 
 void GuiSubtreeImpl::attach_to(GuiRendererImpl *renderer) {
@@ -95,6 +100,7 @@ void GuiSubtreeImpl::attach_to(GuiEngineImpl *engine, const QString &source) {
 	this->root_component = std::make_unique<QQmlComponent>(engine->get_qml_engine());
 	QObject::connect(&*this->root_component, &QQmlComponent::statusChanged, this, &GuiSubtreeImpl::component_status_changed);
 	this->engine = GuiEngineImplConnection(this, engine, source);
+	this->source = QUrl{source};
 
 	this->root_component->moveToThread(QCoreApplication::instance()->thread());
 }
@@ -106,7 +112,7 @@ void GuiSubtreeImpl::component_status_changed(QQmlComponent::Status status) {
 	}
 
 	if (QQmlComponent::Ready == status) {
-		assert(!this->root);
+		destroy_root();
 
 		this->root = qobject_cast<QQuickItem*>(this->root_component->beginCreate(this->engine.rootContext()));
 		assert(this->root);
@@ -8,6 +8,7 @@
 
 #include <QObject>
 #include <QQmlComponent>
+#include <QUrl>
 
 #include "gui_callback.h"
 #include "livereload/gui_live_reloader.h"
@@ -64,6 +65,11 @@ public slots:
 	void attach_to(GuiEngineImpl *engine, const QString &source);
 
 private slots:
+	/**
+	 * Start compiling the root component, in the background.
+	 */
+	void load_root();
+
 	void component_status_changed(QQmlComponent::Status status);
 	void on_resized(const QSize &size);
 	void on_process_game_logic_callback_blocking(const std::function<void()> &f);
@@ -85,6 +91,11 @@ private:
 
 	std::unique_ptr<QQmlComponent> root_component;
 	QQuickItem *root;
+
+	/**
+	 * The file of the root component.
+	 */
+	QUrl source;
 };
 
 } // namespace qtsdl
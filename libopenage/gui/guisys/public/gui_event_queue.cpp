@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "../public/gui_event_queue.h"
 
@@ -18,4 +18,8 @@ void GuiEventQueue::process_callbacks() {
 	this->impl->process_callbacks();
 }
 
+GuiEventQueueStats GuiEventQueue::get_stats() const {
+	return this->impl->get_stats();
+}
+
 } // namespace qtsdl
@@ -1,13 +1,22 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
 
 namespace qtsdl {
 
 class GuiEventQueueImpl;
 
+/**
+ * Numbers of the callbacks that one processing of a queue delivered.
+ */
+struct GuiEventQueueStats {
+	size_t delivered; //!< callbacks that ran
+	size_t coalesced; //!< callbacks that were superseded by later ones before they ran
+};
+
 /**
  * Provides synchronization with some game thread.
  */
@@ -16,8 +25,17 @@ public:
 	explicit GuiEventQueue();
 	~GuiEventQueue();
 
+	/**
+	 * Runs the callbacks that were queued for this thread, batched
+	 * by the gui objects they come from.
+	 */
 	void process_callbacks();
 
+	/**
+	 * @return numbers of the last processing
+	 */
+	GuiEventQueueStats get_stats() const;
+
 private:
 	friend class GuiEventQueueImpl;
 	std::unique_ptr<GuiEventQueueImpl> impl;
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "../public/gui_renderer.h"
 
@@ -16,8 +16,12 @@ GuiRenderer::GuiRenderer(SDL_Window *window)
 GuiRenderer::~GuiRenderer() {
 }
 
-GLuint GuiRenderer::render() {
-	return this->impl->render();
+GLuint GuiRenderer::render(bool *updated) {
+	return this->impl->render(updated);
+}
+
+GuiRect GuiRenderer::get_content_rect() const {
+	return this->impl->get_content_rect();
 }
 
 void GuiRenderer::resize(int w, int h) {
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -16,6 +16,25 @@ namespace qtsdl {
 
 class GuiRendererImpl;
 
+/**
+ * Part of the gui frame, as fractions of its size from the top left.
+ */
+struct GuiRect {
+	float left;
+	float top;
+	float right;
+	float bottom;
+
+	bool empty() const {
+		return this->left >= this->right || this->top >= this->bottom;
+	}
+
+	bool operator ==(const GuiRect &other) const {
+		return this->left == other.left && this->top == other.top
+			&& this->right == other.right && this->bottom == other.bottom;
+	}
+};
+
 /**
  * Passes the native graphic context to Qt.
  */
@@ -25,7 +44,21 @@ public:
 	explicit GuiRenderer(SDL_Window *window);
 	~GuiRenderer();
 
-	GLuint render();
+	/**
+	 * Renders the gui if its scene changed since the last call.
+	 * The texture is created in the game's context, so it can be drawn directly.
+	 *
+	 * @param updated set to whether the texture was rendered again
+	 * @return texture ID where GUI was rendered
+	 */
+	GLuint render(bool *updated=nullptr);
+
+	/**
+	 * The area of the texture that gui items draw to, everything else
+	 * is transparent. Updated with the scene, the whole frame until then.
+	 */
+	GuiRect get_content_rect() const;
+
 	void resize(int w, int h);
 
 private:
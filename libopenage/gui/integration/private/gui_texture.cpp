@@ -1,10 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "gui_texture.h"
 
 #include <array>
 
-#include <QTransform>
+#include <QRectF>
 
 #include "../../../texture.h"
 
@@ -102,9 +102,10 @@ QSGTexture* GuiTexture::removedFromAtlas() const {
 
 QRectF GuiTexture::normalizedTextureSubRect() const {
 	if (this->isAtlasTexture()) {
-		auto tex = this->texture_handle.texture;
-		auto sub = tex->get_subtexture(this->texture_handle.subid);
-		return QTransform::fromScale(tex->w, tex->h).inverted().mapRect(QRectF(sub->x, sub->y, sub->w, sub->h));
+		// the texture may be packed into an atlas page
+		float txl, txr, txt, txb;
+		this->texture_handle.texture->get_subtexture_coordinates(this->texture_handle.subid, &txl, &txr, &txt, &txb);
+		return QRectF(QPointF(txl, txt), QPointF(txr, txb));
 	} else {
 		return QSGTexture::normalizedTextureSubRect();
 	}
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "gui_texture_factory.h"
 
@@ -25,8 +25,14 @@ QSGTexture* GuiTextureFactory::createTexture(QQuickWindow *window) const {
 }
 
 int GuiTextureFactory::textureByteCount() const {
-	// assume 32bit textures
-	return this->texture_handle.texture->w * this->texture_handle.texture->h * 4;
+	// the scene graph draws from the engine's own texture, so that's what it costs.
+	// until it's uploaded, assume 32bit textures
+	const Texture *texture = this->texture_handle.texture;
+	size_t bytes = texture->get_gpu_size();
+	if (bytes == 0) {
+		bytes = texture->w * texture->h * 4;
+	}
+	return bytes;
 }
 
 QSize GuiTextureFactory::textureSize() const {
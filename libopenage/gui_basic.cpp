@@ -1,10 +1,11 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "shader/shader.h"
 #include "shader/program.h"
 
 #include "gui_basic.h"
 #include "game_singletons_info.h"
+#include "render_command_list.h"
 
 #include "util/file.h"
 
@@ -13,6 +14,7 @@ namespace gui {
 
 GuiBasic::GuiBasic(SDL_Window *window, const std::string &source, qtsdl::GuiSingletonItemsInfo *singleton_items_info, const std::vector<std::string> &search_paths)
 	:
+	screen_quad_rect{0, 0, 1, 1},
 	application{},
 	render_updater{},
 	renderer{window},
@@ -66,6 +68,10 @@ void GuiBasic::process_events() {
 	this->application.processEvents();
 }
 
+qtsdl::GuiEventQueueStats GuiBasic::get_game_logic_stats() const {
+	return this->game_logic_updater.get_stats();
+}
+
 bool GuiBasic::on_resize(coord::window new_size) {
 	this->renderer.resize(new_size.x, new_size.y);
 	return true;
@@ -115,31 +121,64 @@ private:
 bool GuiBasic::on_drawhud() {
 	this->render_updater.process_callbacks();
 
-	BlendPreserver preserve_blend;
+	// the gui is rendered with the context of this thread, only when
+	// its scene changed. its texture is drawn onto the frame by a command.
+	bool updated = false;
+	auto tex = this->renderer.render(&updated);
 
-	auto tex = this->renderer.render();
+	// only the part with gui items is blended onto the frame
+	qtsdl::GuiRect area = this->renderer.get_content_rect();
+	if (area.empty()) {
+		return true;
+	}
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	RenderCommandList *commands = RenderCommandList::get_recording();
+	if (updated and commands != nullptr and commands->is_deferred()) {
+		// the render thread's context samples the texture
+		glFinish();
+	}
 
-	this->textured_screen_quad_shader->use();
+	RenderCommandList::submit([this, tex, area] {
+		BlendPreserver preserve_blend;
+
+		if (not (area == this->screen_quad_rect)) {
+			// the texture coordinates follow from the positions
+			float left = area.left * 2 - 1, right = area.right * 2 - 1;
+			float top = 1 - area.top * 2, bottom = 1 - area.bottom * 2;
+			const float screen_quad[] = {
+				left, bottom,
+				right, bottom,
+				right, top,
+				left, top,
+			};
+
+			glBindBuffer(GL_ARRAY_BUFFER, this->screen_quad_vbo);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(screen_quad), screen_quad);
+			this->screen_quad_rect = area;
+		}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-	glEnableVertexAttribArray(this->textured_screen_quad_shader->pos_id);
+		this->textured_screen_quad_shader->use();
 
-	glBindBuffer(GL_ARRAY_BUFFER, this->screen_quad_vbo);
-	glVertexAttribPointer(this->textured_screen_quad_shader->pos_id, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, tex);
 
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+		glEnableVertexAttribArray(this->textured_screen_quad_shader->pos_id);
 
-	glDisableVertexAttribArray(this->textured_screen_quad_shader->pos_id);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ARRAY_BUFFER, this->screen_quad_vbo);
+		glVertexAttribPointer(this->textured_screen_quad_shader->pos_id, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
-	this->textured_screen_quad_shader->stopusing();
+		glDisableVertexAttribArray(this->textured_screen_quad_shader->pos_id);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		this->textured_screen_quad_shader->stopusing();
+	});
 
 	return true;
 }
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -39,6 +39,11 @@ public:
 
 	void process_events();
 
+	/**
+	 * @return numbers of the gui callbacks the game logic ran in the last process_events()
+	 */
+	qtsdl::GuiEventQueueStats get_game_logic_stats() const;
+
 private:
 	virtual bool on_resize(coord::window new_size) override;
 	virtual bool on_input(SDL_Event *event) override;
@@ -47,6 +52,11 @@ private:
 	GLint tex_loc;
 	GLuint screen_quad_vbo;
 
+	/**
+	 * The part of the screen the quad covers, only used by the render commands.
+	 */
+	qtsdl::GuiRect screen_quad_rect;
+
 	GuiApplicationWithLogger application;
 	qtsdl::GuiEventQueue render_updater;
 	qtsdl::GuiRenderer renderer;
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include <functional>
 
@@ -22,15 +22,19 @@ ActionManager::ActionManager(InputManager *input_manager,
 }
 
 bool ActionManager::create(const std::string type) {
-	if (this->actions.find(type) == this->actions.end()) {
-		this->actions.insert(std::make_pair(type, this->actions.size()));
+	util::StringId id = util::StringId::intern(type);
+
+	if (this->actions.find(id) == this->actions.end()) {
+		action_t action = this->names.size();
+		this->actions.insert(std::make_pair(id, action));
+		this->names.push_back(id);
 
 		// create the accessor of the action binding
-		auto get = [type, this]() {
-			return this->input_manager->get_bind(type);
+		auto get = [action, this]() {
+			return this->input_manager->get_bind(action);
 		};
-		auto set = [type, this](const std::string &value) {
-			this->input_manager->set_bind(value.c_str(), type);
+		auto set = [action, this](const std::string &value) {
+			this->input_manager->set_bind(value, action);
 		};
 
 		// and the corresponding cvar:
@@ -42,7 +46,7 @@ bool ActionManager::create(const std::string type) {
 	return false;
 }
 
-action_t ActionManager::get(const std::string &type) {
+action_t ActionManager::get(const util::StringId &type) {
 	auto it = this->actions.find(type);
 	if (it != this->actions.end()) {
 		return it->second;
@@ -50,15 +54,13 @@ action_t ActionManager::get(const std::string &type) {
 	return this->actions.at("UNDEFINED");
 }
 
-bool ActionManager::is(const std::string &type, const action_t action) {
+bool ActionManager::is(const util::StringId &type, const action_t action) {
 	return get(type) == action;
 }
 
 std::string ActionManager::get_name(const action_t action) {
-	for (auto &it : this->actions) {
-		if (it.second == action) {
-			return it.first;
-		}
+	if (action < this->names.size()) {
+		return this->names[action].to_string();
 	}
 	return "UNDEFINED";
 }
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "../coord/window.h"
+#include "../util/string_id.h"
 #include "event.h"
 
 namespace openage {
@@ -29,21 +30,24 @@ using action_t = unsigned int;
 /**
  * Mapping type from action name to action id.
  */
-using action_map_t = std::unordered_map<std::string, action_t>;
+using action_map_t = std::unordered_map<util::StringId, action_t>;
 
 
 /**
  * The action manager manages all the actions allow creation, access
  * information and equality.
+ *
+ * Actions are looked up by the id of their name, which is computed
+ * at compile time for literals.
  */
 class ActionManager {
 public:
 	ActionManager(InputManager *input_manager,
 	              cvar::CVarManager *cvar_manager);
 	bool create(const std::string type);
-	action_t get(const std::string &type);
+	action_t get(const util::StringId &type);
 	std::string get_name(const action_t action);
-	bool is(const std::string &type, const action_t action);
+	bool is(const util::StringId &type, const action_t action);
 
 private :
 	const std::vector<std::string> default_action = {
@@ -52,6 +56,7 @@ private :
 		"STOP_GAME",
 		"TOGGLE_HUD",
 		"SCREENSHOT",
+		"TOGGLE_RECORDING",
 		"TOGGLE_DEBUG_OVERLAY",
 		"TOGGLE_DEBUG_GRID",
 		"QUICK_SAVE",
@@ -61,6 +66,7 @@ private :
 		"TOGGLE_ITEM",
 		"TOGGLE_BLENDING",
 		"TOGGLE_PROFILER",
+		"TOGGLE_TRACE",
 		"TOGGLE_CONSTRUCT_MODE",
 		"TOGGLE_UNIT_DEBUG",
 		"TRAIN_OBJECT",
@@ -130,6 +136,11 @@ private :
 
 	action_map_t actions;
 
+	/**
+	 * the names of the actions, indexed by action id.
+	 */
+	std::vector<util::StringId> names;
+
 	InputManager *input_manager;
 	cvar::CVarManager *cvar_manager;
 };
@@ -1,7 +1,9 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "event.h"
 
+#include <array>
+#include <cstdint>
 #include <functional>
 
 namespace openage {
@@ -14,27 +16,51 @@ ClassCode::ClassCode(event_class cl, code_t code)
 }
 
 
-std::vector<event_class> ClassCode::get_classes() const {
-	std::vector<event_class> result;
-
-	// use event_base to traverse up the class tree
-	event_class ec = this->eclass;
-	result.push_back(ec);
-	while (event_base.count(ec) > 0) {
-		ec = event_base.at(ec);
-		result.push_back(ec);
+namespace {
+
+/**
+ * the classes of each event class, used by each event
+ * several times, so the class tree is only traversed once.
+ */
+struct class_table {
+	class_table() {
+		for (size_t i = 0; i < event_class_count; i++) {
+			// use event_base to traverse up the class tree
+			event_class ec = static_cast<event_class>(i);
+			this->classes[i].push_back(ec);
+			this->mask[i] = 1 << i;
+			while (event_base.count(ec) > 0) {
+				ec = event_base.at(ec);
+				this->classes[i].push_back(ec);
+				this->mask[i] |= 1 << static_cast<int>(ec);
+			}
+		}
 	}
-	return result;
+
+	std::array<std::vector<event_class>, event_class_count> classes;
+
+	/**
+	 * bit of each class in classes
+	 */
+	std::array<uint32_t, event_class_count> mask;
+};
+
+const class_table &get_class_table() {
+	static const class_table table;
+	return table;
+}
+
+} // anonymous namespace
+
+
+const std::vector<event_class> &ClassCode::get_classes() const {
+	return get_class_table().classes[static_cast<size_t>(this->eclass)];
 }
 
 
 bool ClassCode::has_class(const event_class &ec) const {
-	for (auto c : this->get_classes()) {
-		if (c == ec) {
-			return true;
-		}
-	}
-	return false;
+	uint32_t mask = get_class_table().mask[static_cast<size_t>(this->eclass)];
+	return (mask & (1 << static_cast<int>(ec))) != 0;
 }
 
 
@@ -1,7 +1,8 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstddef>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -34,6 +35,12 @@ enum class event_class {
 };
 
 
+/**
+ * number of event classes, for tables indexed by them
+ */
+constexpr size_t event_class_count = static_cast<size_t>(event_class::MOUSE_MOTION) + 1;
+
+
 struct event_class_hash {
 	int operator()(const event_class &s) const;
 };
@@ -87,9 +94,10 @@ public:
 	ClassCode(event_class cl, code_t code);
 
 	/**
-	 * classes ordered with most specific first
+	 * classes ordered with most specific first,
+	 * precomputed for each class from event_base.
 	 */
-	std::vector<event_class> get_classes() const;
+	const std::vector<event_class> &get_classes() const;
 	bool has_class(const event_class &c) const;
 
 	const event_class eclass;
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include <algorithm>
 #include <array>
@@ -64,7 +64,11 @@ std::string event_as_string(const Event& event) {
 
 
 std::string InputManager::get_bind(const std::string &action_str) {
-	action_t action = this->action_manager->get(action_str);
+	// the id only lives for the lookup, so the name needn't be interned
+	return this->get_bind(this->action_manager->get(action_str.c_str()));
+}
+
+std::string InputManager::get_bind(action_t action) {
 	if (this->action_manager->is("UNDEFINED", action)) {
 		return "";
 	}
@@ -86,8 +90,11 @@ std::string InputManager::get_bind(const std::string &action_str) {
 }
 
 bool InputManager::set_bind(const std::string &bind_str, const std::string action_str) {
+	return this->set_bind(bind_str, this->action_manager->get(action_str.c_str()));
+}
+
+bool InputManager::set_bind(const std::string &bind_str, action_t action) {
 	try {
-		action_t action = this->action_manager->get(action_str);
 		if (this->action_manager->is("UNDEFINED", action)) {
 			return false;
 		}
@@ -99,6 +106,7 @@ bool InputManager::set_bind(const std::string &bind_str, const std::string actio
 			this->keys.erase(it);
 		}
 		this->keys.emplace(std::make_pair(action, ev));
+		this->rebuild_bound_actions();
 
 		return true;
 	}
@@ -107,6 +115,13 @@ bool InputManager::set_bind(const std::string &bind_str, const std::string actio
 	}
 }
 
+void InputManager::rebuild_bound_actions() {
+	this->bound_actions.clear();
+	for (auto &it : this->keys) {
+		this->bound_actions[it.second].push_back(it.first);
+	}
+}
+
 std::string InputManager::key_bind_to_string(const Event &ev) {
 	std::string key_str = std::string(SDL_GetKeyName(ev.cc.code));
 
@@ -193,10 +208,9 @@ bool InputManager::trigger(const Event &e) {
 	// arg passed to receivers
 	action_arg_t arg{e, this->mouse_position, this->mouse_motion, {}};
 
-	for (auto &it : this->keys) {
-		if (e == it.second) {
-			arg.hints.emplace_back(it.first);
-		}
+	auto bound = this->bound_actions.find(e);
+	if (bound != this->bound_actions.end()) {
+		arg.hints = bound->second;
 	}
 
 	// Check context list on top of the stack (most recent bound first)
@@ -218,8 +232,16 @@ void InputManager::set_state(const Event &ev, bool is_down) {
 
 	// update key states
 	this->keymod = ev.mod;
-	bool was_down = this->states[ev.cc];
-	this->states[ev.cc] = is_down;
+	bool was_down;
+	size_t index = state_index(ev.cc);
+	if (index < key_state_count) {
+		was_down = this->key_states[index];
+		this->key_states[index] = is_down;
+	}
+	else {
+		was_down = this->other_states[ev.cc];
+		this->other_states[ev.cc] = is_down;
+	}
 
 	// a key going from pressed to unpressed
 	// will automatically trigger event handling
@@ -258,9 +280,50 @@ void InputManager::set_relative(bool mode) {
 }
 
 
+size_t InputManager::state_index(const ClassCode &cc) {
+	size_t code = static_cast<size_t>(cc.code);
+
+	switch (cc.eclass) {
+	case event_class::ALPHA:
+	case event_class::DIGIT:
+	case event_class::PRINT:
+	case event_class::NONPRINT:
+		if (code < char_key_count) {
+			return code;
+		}
+		break;
+
+	case event_class::OTHER: {
+		// see sdl_key, these are scancodes with SDLK_SCANCODE_MASK
+		size_t scancode = code & ~size_t{SDLK_SCANCODE_MASK};
+		if (scancode < other_key_count) {
+			return char_key_count + scancode;
+		}
+		break;
+	}
+
+	case event_class::MOUSE_BUTTON:
+		if (code < mouse_button_count) {
+			return char_key_count + other_key_count + code;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return key_state_count;
+}
+
+
 bool InputManager::is_down(const ClassCode &cc) const {
-	auto it = this->states.find(cc);
-	if (it != this->states.end()) {
+	size_t index = state_index(cc);
+	if (index < key_state_count) {
+		return this->key_states[index];
+	}
+
+	auto it = this->other_states.find(cc);
+	if (it != this->other_states.end()) {
 		return it->second;
 	}
 	return false;
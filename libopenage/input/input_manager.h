@@ -1,8 +1,9 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 // pxd: from libcpp cimport bool
+#include <bitset>
 #include <functional>
 // pxd: from libcpp.string cimport string
 #include <string>
@@ -49,6 +50,11 @@ public:
 	 */
 	std::string get_bind(const std::string &action);
 
+	/**
+	 * Return the string representation of the bind of an action id.
+	 */
+	std::string get_bind(action_t action);
+
 	/**
 	 * Set the given action to be triggered by the given bind (key/mouse
 	 * /wheel). Remove previous assignation. Do nothing if either they
@@ -56,6 +62,11 @@ public:
 	 */
 	bool set_bind(const std::string &bind_str, const std::string action);
 
+	/**
+	 * Set the bind of an action id.
+	 */
+	bool set_bind(const std::string &bind_str, action_t action);
+
 	/**
 	 * Return the string representation of the key event.
 	 */
@@ -140,8 +151,7 @@ public:
 	/**
 	 * Query stored pressing stat for a key.
 	 *
-	 * note that the function stores a unknown/new keycode
-	 * as 'not pressed' if requested
+	 * unknown/new keycodes are 'not pressed'.
 	 * @return true when the key is pressed, false else.
 	 */
 	bool is_down(const ClassCode &cc) const;
@@ -177,9 +187,31 @@ public:
 	 */
 	ActionManager *get_action_manager() const;
 
+	/**
+	 * keys and mouse buttons whose state is kept in the dense
+	 * key_states: sdl keycodes of characters, of the keys without
+	 * characters (by their scancode) and the mouse buttons.
+	 */
+	static constexpr size_t char_key_count = 256;
+	static constexpr size_t other_key_count = SDL_NUM_SCANCODES;
+	static constexpr size_t mouse_button_count = 32;
+	static constexpr size_t key_state_count = char_key_count + other_key_count + mouse_button_count;
+
 private:
 	modset_t get_mod() const;
 
+	/**
+	 * the index of a key or button in key_states,
+	 * or key_state_count if its state is kept in other_states.
+	 */
+	static size_t state_index(const ClassCode &cc);
+
+	/**
+	 * fill bound_actions from the keys.
+	 * called when a binding changes.
+	 */
+	void rebuild_bound_actions();
+
 	/**
 	 * The action manager to used for keybind action lookups.
 	 */
@@ -195,6 +227,12 @@ private:
 	 */
 	binding_map_t keys;
 
+	/**
+	 * The actions bound to each event in keys,
+	 * passed as hints to the contexts.
+	 */
+	std::unordered_map<Event, std::vector<action_t>, event_hash> bound_actions;
+
 	/**
 	 * Stack of active input contexts.
 	 * The most recent entry is pushed on top of the stack.
@@ -202,12 +240,16 @@ private:
 	std::vector<InputContext *> contexts;
 
 	/**
-	 * key to is_down map.
-	 * stores a mapping between keycodes and its pressing state.
-	 * a true value means the key is currently pressed,
-	 * false indicates the key is untouched.
+	 * pressing state of the keys and mouse buttons, see state_index.
+	 * a set bit means the key is currently pressed,
+	 * unset indicates the key is untouched.
+	 */
+	std::bitset<key_state_count> key_states;
+
+	/**
+	 * key to is_down map for the codes not in key_states.
 	 */
-	std::unordered_map<ClassCode, bool, class_code_hash> states;
+	std::unordered_map<ClassCode, bool, class_code_hash> other_states;
 
 	/**
 	 * Current key modifiers.
@@ -0,0 +1,71 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "cancellation_token.h"
+
+#include "../config.h"
+#include "job_aborted_exception.h"
+
+namespace openage {
+namespace job {
+
+namespace {
+
+/** The token of threads that don't run a job. */
+const CancellationToken no_cancellation;
+
+#if HAVE_THREAD_LOCAL_STORAGE
+/** The token of the job running on the current thread. */
+thread_local const CancellationToken *current_token = &no_cancellation;
+#endif
+
+} // anonymous namespace
+
+
+CancellationToken CancellationToken::create() {
+	CancellationToken token;
+	token.cancelled = std::make_shared<std::atomic<bool>>(false);
+	return token;
+}
+
+
+const CancellationToken &CancellationToken::current() {
+	#if HAVE_THREAD_LOCAL_STORAGE
+	return *current_token;
+	#else
+	return no_cancellation;
+	#endif
+}
+
+
+void CancellationToken::cancel() {
+	if (this->cancelled) {
+		this->cancelled->store(true, std::memory_order_relaxed);
+	}
+}
+
+
+void CancellationToken::check() const {
+	if (this->is_cancelled()) {
+		throw JobAbortedException{};
+	}
+}
+
+
+CancellationScope::CancellationScope(const CancellationToken &token) {
+	#if HAVE_THREAD_LOCAL_STORAGE
+	this->previous = current_token;
+	current_token = &token;
+	#else
+	(void) token;
+	this->previous = nullptr;
+	#endif
+}
+
+
+CancellationScope::~CancellationScope() {
+	#if HAVE_THREAD_LOCAL_STORAGE
+	current_token = this->previous;
+	#endif
+}
+
+}} // openage::job
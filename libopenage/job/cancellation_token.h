@@ -0,0 +1,89 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace openage {
+namespace job {
+
+/**
+ * Cancels jobs whose results are not needed anymore, like the path of a
+ * unit that got a new order. Copies of a token share its state, so the
+ * requester keeps one and passes the others to the jobs.
+ *
+ * A cancelled job that did not start yet is skipped by the workers. Long
+ * running jobs poll current() in their loops and stop with check(). Like
+ * aborted jobs, cancelled ones never finish and don't run their callback.
+ *
+ * Jobs started from a job with a token, like the helpers of parallel_for
+ * and the tasks of a JobGraph, are cancelled along with it.
+ */
+class CancellationToken {
+public:
+	/**
+	 * A token that is never cancelled, the one of jobs without a token.
+	 */
+	CancellationToken() = default;
+
+	/**
+	 * A new token that can be cancelled.
+	 */
+	static CancellationToken create();
+
+	/**
+	 * The token of the job running on this thread, one that is
+	 * never cancelled outside of jobs.
+	 */
+	static const CancellationToken &current();
+
+	/**
+	 * Cancels the jobs of the token. Does nothing for tokens that
+	 * can't be cancelled.
+	 */
+	void cancel();
+
+	/**
+	 * Whether the token can be cancelled, i.e. was created by create().
+	 */
+	bool is_valid() const {
+		return this->cancelled != nullptr;
+	}
+
+	/**
+	 * Whether the jobs of the token were cancelled. Cheap enough
+	 * to be polled in the inner loops of jobs.
+	 */
+	bool is_cancelled() const {
+		return this->cancelled and this->cancelled->load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Stops the job running on this thread with a JobAbortedException
+	 * if the token was cancelled.
+	 */
+	void check() const;
+
+private:
+	std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+
+/**
+ * Makes the token the current() one of this thread while it exists.
+ * Used by the job states around the execution of their function.
+ */
+class CancellationScope {
+public:
+	explicit CancellationScope(const CancellationToken &token);
+	~CancellationScope();
+
+	CancellationScope(const CancellationScope &) = delete;
+	CancellationScope &operator =(const CancellationScope &) = delete;
+
+private:
+	const CancellationToken *previous;
+};
+
+}} // openage::job
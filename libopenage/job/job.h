@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -31,6 +31,9 @@ private:
 	std::shared_ptr<TypedJobStateBase<T>> state;
 
 public:
+	/** Type of the callback of the job. */
+	using callback_t = callback_function_t<T>;
+
 	/**
 	 * Creates an empty job object that is not bound to any state. Should only
 	 * be used as dummy object.
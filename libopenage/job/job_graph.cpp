@@ -0,0 +1,222 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "job_graph.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "../error/error.h"
+#include "job_aborted_exception.h"
+#include "job_manager.h"
+
+namespace openage {
+namespace job {
+
+struct JobGraph::graph_state {
+	struct task {
+		std::function<void()> function;
+
+		/** Number of dependencies that have not finished yet. */
+		size_t pending;
+
+		/** Tasks that depend on this one. */
+		std::vector<task_id> dependents;
+	};
+
+	std::vector<task> tasks;
+
+	/** Guards all members below. */
+	std::mutex mutex;
+
+	/** Signaled whenever a task finished. */
+	std::condition_variable task_finished;
+
+	/** Tasks whose dependencies have all finished. */
+	std::deque<task_id> ready;
+
+	size_t finished = 0;
+
+	bool started = false;
+
+	/** Set to the first exception thrown by a task. */
+	std::exception_ptr error;
+
+	/** Used to enqueue a job for each task that became ready. */
+	JobManager *manager = nullptr;
+	job_priority priority = job_priority::normal;
+
+	/** The token of the thread running the graph, the tasks stop with it. */
+	CancellationToken cancellation;
+};
+
+
+JobGraph::JobGraph(JobManager *manager, job_priority priority)
+	:
+	manager{manager},
+	priority{priority},
+	state{std::make_shared<graph_state>()} {}
+
+
+JobGraph::~JobGraph() = default;
+
+
+JobGraph::task_id JobGraph::add(std::function<void()> task, const std::vector<task_id> &dependencies) {
+	task_id id = this->state->tasks.size();
+
+	for (task_id dependency : dependencies) {
+		ENSURE(dependency < id, "a task can only depend on previously added tasks");
+		this->state->tasks[dependency].dependents.push_back(id);
+	}
+
+	this->state->tasks.push_back({std::move(task), dependencies.size(), {}});
+	return id;
+}
+
+
+size_t JobGraph::size() const {
+	return this->state->tasks.size();
+}
+
+
+bool JobGraph::run_one(const std::shared_ptr<graph_state> &shared) {
+	graph_state &state = *shared;
+
+	task_id id;
+	bool skip;
+	{
+		std::unique_lock<std::mutex> lock{state.mutex};
+		if (state.ready.empty()) {
+			return false;
+		}
+		id = state.ready.front();
+		state.ready.pop_front();
+		skip = static_cast<bool>(state.error);
+	}
+
+	std::exception_ptr error;
+	if (not skip and state.cancellation.is_cancelled()) {
+		// the remaining tasks are skipped like after a failure
+		error = std::make_exception_ptr(JobAbortedException{});
+		skip = true;
+	}
+
+	if (not skip) {
+		try {
+			state.tasks[id].function();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+	}
+
+	size_t newly_ready = 0;
+	{
+		std::unique_lock<std::mutex> lock{state.mutex};
+		if (error and not state.error) {
+			state.error = error;
+		}
+
+		// after a failure, the dependents are released as well,
+		// they are skipped so the run can finish
+		for (task_id dependent : state.tasks[id].dependents) {
+			state.tasks[dependent].pending -= 1;
+			if (state.tasks[dependent].pending == 0) {
+				state.ready.push_back(dependent);
+				newly_ready += 1;
+			}
+		}
+
+		state.finished += 1;
+	}
+	state.task_finished.notify_all();
+
+	for (size_t i = 0; i < newly_ready; i++) {
+		enqueue_token(shared);
+	}
+
+	return true;
+}
+
+
+void JobGraph::enqueue_token(const std::shared_ptr<graph_state> &shared) {
+	if (shared->manager == nullptr) {
+		return;
+	}
+
+	// the job runs any ready task, or none if other threads took them
+	shared->manager->enqueue<int>(
+		[shared]() -> int {
+			run_one(shared);
+			return 0;
+		},
+		{},
+		shared->priority,
+		shared->cancellation
+	);
+}
+
+
+void JobGraph::run(const progress_function_t &progress) {
+	graph_state &state = *this->state;
+	size_t total = state.tasks.size();
+
+	ENSURE(not state.started, "a job graph can only be run once");
+	state.started = true;
+
+	if (total == 0) {
+		return;
+	}
+
+	state.manager = this->manager;
+	state.priority = this->priority;
+	state.cancellation = CancellationToken::current();
+
+	for (task_id id = 0; id < total; id++) {
+		if (state.tasks[id].pending == 0) {
+			state.ready.push_back(id);
+		}
+	}
+
+	// the first ready task is run here,
+	// the workers may take the others meanwhile
+	size_t initially_ready = state.ready.size();
+	for (size_t i = 1; i < initially_ready; i++) {
+		enqueue_token(this->state);
+	}
+
+	size_t reported = 0;
+	while (true) {
+		// this thread runs tasks as well, so the graph never waits
+		// for workers which are busy with other jobs
+		bool ran = run_one(this->state);
+
+		std::unique_lock<std::mutex> lock{state.mutex};
+		if (not ran and state.ready.empty() and state.finished < total) {
+			state.task_finished.wait(lock, [&state, reported] {
+				return not state.ready.empty() or state.finished != reported;
+			});
+		}
+
+		size_t finished = state.finished;
+		lock.unlock();
+
+		if (finished != reported) {
+			reported = finished;
+			if (progress) {
+				progress(finished, total);
+			}
+		}
+
+		if (finished == total) {
+			break;
+		}
+	}
+
+	if (state.error) {
+		std::rethrow_exception(state.error);
+	}
+}
+
+}} // namespace openage::job
@@ -0,0 +1,87 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "types.h"
+
+namespace openage {
+namespace job {
+
+class JobManager;
+
+/**
+ * A set of tasks with dependencies between them, which are executed in
+ * parallel on the job manager's workers. A task is started as soon as
+ * all tasks it depends on have finished.
+ *
+ * The thread that runs the graph executes tasks as well, so it may be
+ * a worker of the same job manager itself.
+ */
+class JobGraph {
+public:
+	/** Identifies a task of the graph. */
+	using task_id = size_t;
+
+	/**
+	 * Type of the function that is called after each finished task, with
+	 * the number of finished tasks and the number of all tasks.
+	 */
+	using progress_function_t = std::function<void(size_t, size_t)>;
+
+	/**
+	 * Creates an empty graph. Without a job manager, all tasks run on the
+	 * thread that runs the graph.
+	 */
+	JobGraph(JobManager *manager, job_priority priority=job_priority::normal);
+	~JobGraph();
+
+	JobGraph(const JobGraph &) = delete;
+	JobGraph &operator =(const JobGraph &) = delete;
+
+	/**
+	 * Adds a task, which is executed after the given tasks finished.
+	 * Tasks can only depend on previously added tasks, so the graph
+	 * never contains cycles.
+	 */
+	task_id add(std::function<void()> task, const std::vector<task_id> &dependencies={});
+
+	/**
+	 * Executes all tasks and returns when they finished. If a task throws
+	 * an exception, the tasks that were not started yet are skipped and
+	 * the exception is rethrown here. A graph can only be run once.
+	 *
+	 * If the job running the graph is cancelled, see CancellationToken,
+	 * the remaining tasks are skipped and a JobAbortedException is thrown.
+	 *
+	 * @param progress called on this thread whenever tasks finished
+	 */
+	void run(const progress_function_t &progress={});
+
+	/** Returns the number of tasks in the graph. */
+	size_t size() const;
+
+private:
+	struct graph_state;
+
+	/**
+	 * Executes one ready task, if there is one.
+	 * Enqueues a job for each task that became ready by that.
+	 */
+	static bool run_one(const std::shared_ptr<graph_state> &state);
+
+	/** Enqueues a job that executes one ready task. */
+	static void enqueue_token(const std::shared_ptr<graph_state> &state);
+
+	JobManager *manager;
+	job_priority priority;
+
+	/** Shared with the jobs, which may outlive a run that failed. */
+	std::shared_ptr<graph_state> state;
+};
+
+}} // namespace openage::job
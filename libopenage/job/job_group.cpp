@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "job_group.h"
 
@@ -15,5 +15,9 @@ JobGroup::JobGroup(Worker *parent_worker)
 	parent_worker{parent_worker} {
 }
 
+void JobGroup::set_cancellation(const CancellationToken &cancellation) {
+	this->cancellation = cancellation;
+}
+
 }
 }
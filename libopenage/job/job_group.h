@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -6,6 +6,7 @@
 
 #include "../error/error.h"
 #include "abortable_job_state.h"
+#include "cancellation_token.h"
 #include "job.h"
 #include "job_state.h"
 #include "types.h"
@@ -47,6 +48,7 @@ public:
 	               callback_function_t<T> callback={}) {
 		ENSURE(this->parent_worker, "job group has no worker thread associated");
 		auto state = std::make_shared<JobState<T>>(function, callback);
+		state->cancellation = this->cancellation;
 		this->parent_worker->enqueue(state);
 		return Job<T>{state};
 	}
@@ -68,11 +70,21 @@ public:
 	               callback_function_t<T> callback={}) {
 		ENSURE(this->parent_worker, "job group has no worker thread associated");
 		auto state = std::make_shared<AbortableJobState<T>>(function, callback);
+		state->cancellation = this->cancellation;
 		this->parent_worker->enqueue(state);
 		return Job<T>{state};
 	}
 
+	/**
+	 * Attaches the token to the jobs enqueued from now on, so all
+	 * pending work of the group is cancelled at once.
+	 */
+	void set_cancellation(const CancellationToken &cancellation);
+
 private:
+	/** Cancels the jobs of this group, see set_cancellation. */
+	CancellationToken cancellation;
+
 	/** Creates a new job group with the given parent worker. */
 	JobGroup(Worker *parent_worker);
 
@@ -2,23 +2,39 @@
 
 #include "job_manager.h"
 
+#include <algorithm>
+
 #include "../log/log.h"
+#include "../util/metrics.h"
 #include "../util/thread_id.h"
+#include "../util/trace.h"
 #include "worker.h"
 
 
 namespace openage {
 namespace job {
 
+namespace {
+
+/**
+ * The maximum number of injected jobs a worker takes at once.
+ */
+constexpr size_t max_injected_share = 16;
+
+} // anonymous namespace
+
 
-JobManager::JobManager(int number_of_workers)
+JobManager::JobManager(int number_of_workers, pool_options options)
 	:
 	number_of_workers{number_of_workers},
+	options{std::move(options)},
 	group_index{0},
+	queued_jobs{0},
+	idle_workers{0},
 	is_running{false} {
 
 	for (int i = 0; i < number_of_workers; i++) {
-		this->workers.emplace_back(new Worker{this});
+		this->workers.emplace_back(new Worker{this, static_cast<size_t>(i)});
 	}
 }
 
@@ -35,7 +51,8 @@ void JobManager::start() {
 		for (auto &worker : this->workers) {
 			worker->start();
 		}
-		log::log(DBG << "Started JobManager with " << this->number_of_workers << " worker threads");
+		log::log(DBG << "Started JobManager '" << this->options.name << "' with "
+		         << this->number_of_workers << " worker threads");
 	}
 }
 
@@ -47,29 +64,103 @@ void JobManager::stop() {
 		for (auto &worker : this->workers) {
 			worker->stop();
 		}
+		this->wake_workers(true);
 		for (auto &worker : this->workers) {
 			worker->join();
 		}
 
-		log::log(DBG << "Stopped JobManager with " << this->number_of_workers << " worker threads");
+		log::log(DBG << "Stopped JobManager '" << this->options.name << "' with "
+		         << this->number_of_workers << " worker threads");
 	}
 }
 
 
 void JobManager::execute_callbacks() {
+	TRACE_SCOPE("job callbacks");
 	size_t id = util::get_current_thread_id();
 
 	std::unique_lock<std::mutex> lock{this->finished_jobs_mutex};
 	auto it = this->finished_jobs.find(id);
 	if (it != std::end(this->finished_jobs)) {
-		std::vector<std::shared_ptr<JobStateBase>> jobs;
+		finished_list_t jobs;
 		std::swap(jobs, it->second);
-		it->second.clear();
 		lock.unlock();
-		for (auto &job : jobs) {
-			job->execute_callback();
+		for (auto &list : jobs) {
+			for (auto &job : list) {
+				job->execute_callback();
+			}
+		}
+	}
+}
+
+
+size_t JobManager::execute_callbacks(std::chrono::steady_clock::duration budget) {
+	TRACE_SCOPE("job callbacks");
+	size_t id = util::get_current_thread_id();
+	auto deadline = std::chrono::steady_clock::now() + budget;
+
+	// the lock is released for each callback, as they may enqueue jobs
+	// that finish meanwhile
+	std::unique_lock<std::mutex> lock{this->finished_jobs_mutex};
+	auto it = this->finished_jobs.find(id);
+	if (it == std::end(this->finished_jobs)) {
+		return 0;
+	}
+
+	// unlike the iterator, stays valid when entries are added meanwhile
+	finished_list_t &lists = it->second;
+
+	while (true) {
+		std::shared_ptr<JobStateBase> job;
+		size_t remaining = 0;
+		for (auto &list : lists) {
+			if (not job and not list.empty()) {
+				job = std::move(list.front());
+				list.pop_front();
+			}
+			remaining += list.size();
+		}
+
+		if (not job) {
+			return 0;
+		}
+
+		lock.unlock();
+		job->execute_callback();
+		job = nullptr;
+
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return remaining;
 		}
+		lock.lock();
+	}
+}
+
+
+size_t JobManager::pending_callbacks() {
+	size_t id = util::get_current_thread_id();
+
+	std::lock_guard<std::mutex> lock{this->finished_jobs_mutex};
+	auto it = this->finished_jobs.find(id);
+	if (it == std::end(this->finished_jobs)) {
+		return 0;
 	}
+
+	size_t count = 0;
+	for (auto &list : it->second) {
+		count += list.size();
+	}
+	return count;
+}
+
+
+int JobManager::get_number_of_workers() const {
+	return this->number_of_workers;
+}
+
+
+const pool_options &JobManager::get_options() const {
+	return this->options;
 }
 
 
@@ -80,44 +171,97 @@ JobGroup JobManager::create_job_group() {
 }
 
 
-void JobManager::enqueue_state(std::shared_ptr<JobStateBase> state) {
-	std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
-	this->pending_jobs.push(state);
-	for (auto &worker : this->workers) {
-		worker->notify();
+void JobManager::enqueue_state(std::shared_ptr<JobStateBase> state, job_priority priority) {
+	state->priority = priority;
+
+	static util::MetricCounter &enqueued = util::metrics().counter("jobs.enqueued");
+	enqueued.add();
+
+	// count the job first, so that it is never taken before it was counted
+	this->queued_jobs++;
+
+	Worker *worker = Worker::current();
+	if (worker != nullptr and worker->manager == this) {
+		worker->push_local(state, priority);
+	} else {
+		this->injected_jobs[static_cast<size_t>(priority)].push(state);
+	}
+
+	this->wake_workers(false);
+}
+
+
+bool JobManager::take_injected(Worker *worker, job_priority priority, std::shared_ptr<JobStateBase> &job) {
+	// take an even share of the queued jobs, the other workers
+	// can still steal them if this worker is busy for too long.
+	size_t share = this->queued_jobs.load() / this->workers.size() + 1;
+	share = std::min(share, max_injected_share);
+
+	bool found = false;
+	this->injected_jobs[static_cast<size_t>(priority)].consume(
+		share,
+		[&](std::shared_ptr<JobStateBase> &&injected) {
+			if (not found) {
+				job = std::move(injected);
+				found = true;
+			} else {
+				worker->push_local(std::move(injected), priority);
+			}
+		}
+	);
+
+	if (found) {
+		this->queued_jobs--;
 	}
+	return found;
 }
 
 
-std::shared_ptr<JobStateBase> JobManager::fetch_job() {
-	std::lock_guard<std::mutex> lock{this->pending_jobs_mutex};
-	if (this->pending_jobs.empty()) {
-		return std::shared_ptr<JobStateBase>{};
+void JobManager::wait_for_jobs(Worker *worker) {
+	std::unique_lock<std::mutex> lock{this->idle_mutex};
+	this->idle_workers++;
+
+	while (worker->is_running and
+	       this->queued_jobs.load() == 0 and
+	       worker->group_job_count.load() == 0) {
+		this->jobs_available.wait(lock);
 	}
 
-	auto job = this->pending_jobs.front();
-	this->pending_jobs.pop();
-	return job;
+	this->idle_workers--;
 }
 
 
-bool JobManager::has_job() {
-	std::lock_guard<std::mutex> lock(this->pending_jobs_mutex);
-	return not this->pending_jobs.empty();
+void JobManager::wake_workers(bool all) {
+	// a worker that is about to wait counts itself as idle first,
+	// so it either sees the new job or is woken up here.
+	if (this->idle_workers.load() == 0) {
+		return;
+	}
+
+	{
+		// the waiting worker holds the mutex until it sleeps
+		std::lock_guard<std::mutex> lock{this->idle_mutex};
+	}
+
+	if (all) {
+		this->jobs_available.notify_all();
+	} else {
+		this->jobs_available.notify_one();
+	}
 }
 
 
 void JobManager::finish_job(std::shared_ptr<JobStateBase> job) {
-	std::lock_guard<std::mutex> lock{this->finished_jobs_mutex};
-	auto it = this->finished_jobs.find(job->get_thread_id());
-	// if there hasn't been a finished job for the thread_id, create a new
-	// entry
-	if (it == std::end(this->finished_jobs)) {
-		this->finished_jobs.insert({job->get_thread_id(), {job}});
-	// otherwise, we append the job to the existing entry
-	} else {
-		it->second.push_back(job);
+	// there is nothing to do on the creating thread, which may be one
+	// that never executes callbacks
+	if (not job->has_callback()) {
+		return;
 	}
+
+	std::lock_guard<std::mutex> lock{this->finished_jobs_mutex};
+	// creates the entry for the thread_id on its first finished job
+	finished_list_t &lists = this->finished_jobs[job->get_thread_id()];
+	lists[static_cast<size_t>(job->priority)].push_back(std::move(job));
 }
 
 
@@ -1,18 +1,24 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include "abortable_job_state.h"
+#include "cancellation_token.h"
 #include "job.h"
 #include "job_group.h"
+#include "job_queue.h"
 #include "job_state.h"
 #include "job_state_base.h"
 #include "types.h"
@@ -25,12 +31,21 @@ class Worker;
 /**
  * A job manager can be used to execute functions within separate worker
  * threads.
+ *
+ * Enqueued jobs are collected in a lock-free queue per priority. Idle
+ * workers take a share of them into their own deques, from which other
+ * idle workers steal. Thus a worker busy with a long job doesn't hold back
+ * the jobs it took. Jobs enqueued by a worker thread are added to its
+ * own deque directly.
  */
 class JobManager {
 private:
 	/** The number of internal worker threads. */
 	int number_of_workers;
 
+	/** The names, cpus and memory of the workers. */
+	pool_options options;
+
 	/**
 	 * The index of the worker thread, that is used for the next returned job
 	 * group.
@@ -40,27 +55,42 @@ private:
 	/** A vector of all worker threads. */
 	std::vector<std::unique_ptr<Worker>> workers;
 
-	/** A mutex to synchronize accesses to the internal job queue. */
-	std::mutex pending_jobs_mutex;
+	/** Jobs that no worker has taken yet, for each priority. */
+	std::array<JobQueue, job_priority_count> injected_jobs;
+
+	/**
+	 * The number of jobs waiting in the injected queues and the worker's
+	 * deques. Incremented before a job becomes visible to the workers.
+	 */
+	std::atomic<size_t> queued_jobs;
+
+	/** A mutex to synchronize idle workers going to sleep. */
+	std::mutex idle_mutex;
 
-	/** A queue of jobs that are to be executed. */
-	std::queue<std::shared_ptr<JobStateBase>> pending_jobs;
+	/** A condition variable to wait for new jobs. */
+	std::condition_variable jobs_available;
+
+	/** The number of workers waiting for new jobs. */
+	std::atomic<int> idle_workers;
 
 	/** A mutex to synchronize the finished job map. */
 	std::mutex finished_jobs_mutex;
 
+	/** Finished jobs with callbacks, one list for each job priority. */
+	using finished_list_t = std::array<std::deque<std::shared_ptr<JobStateBase>>, job_priority_count>;
+
 	/**
 	 * Mapping from thread id's to a list of jobs, that have been created by the
 	 * corresponding thread and have finished.
 	 */
-	std::unordered_map<size_t, std::vector<std::shared_ptr<JobStateBase>>> finished_jobs;
+	std::unordered_map<size_t, finished_list_t> finished_jobs;
 
 	/** Whether the job manager is currently running. */
 	std::atomic_bool is_running;
 
 public:
 	/** Create a new job manager with a specified number of worker threads. */
-	JobManager(int number_of_workers);
+	JobManager(int number_of_workers, pool_options options={});
 
 	/** Destructor that stops the job manager if it is still running. */
 	~JobManager();
@@ -88,12 +118,17 @@ public:
 	 * @param function the function that is executed as background job
 	 * @param callback the callback function that is executed, when the background
 	 *        job has finished
+	 * @param priority jobs of higher priority are executed first
+	 * @param cancellation skips the job once it is cancelled
 	 */
 	template<class T>
 	Job<T> enqueue(job_function_t<T> function,
-	               callback_function_t<T> callback={}) {
+	               callback_function_t<T> callback={},
+	               job_priority priority=job_priority::normal,
+	               const CancellationToken &cancellation={}) {
 		auto state = std::make_shared<JobState<T>>(function, callback);
-		this->enqueue_state(state);
+		state->cancellation = cancellation;
+		this->enqueue_state(state, priority);
 		return Job<T>{state};
 	}
 
@@ -108,15 +143,118 @@ public:
 	 * @param function the function that is executed as background job
 	 * @param callback the callback function that is executed, when the background
 	 *        job has finished
+	 * @param priority jobs of higher priority are executed first
+	 * @param cancellation skips the job once it is cancelled
 	 */
 	template<class T>
 	Job<T> enqueue(abortable_function_t<T> function,
-	               callback_function_t<T> callback={}) {
+	               callback_function_t<T> callback={},
+	               job_priority priority=job_priority::normal,
+	               const CancellationToken &cancellation={}) {
 		auto state = std::make_shared<AbortableJobState<T>>(function, callback);
-		this->enqueue_state(state);
+		state->cancellation = cancellation;
+		this->enqueue_state(state, priority);
 		return Job<T>{state};
 	}
 
+	/**
+	 * Enqueues function(result of job) once the given job has finished,
+	 * from the worker that finished it. Stages of a pipeline are chained
+	 * this way without waiting for callbacks on the creating thread.
+	 *
+	 * If the job threw an exception, the function isn't called and the
+	 * returned job throws it instead. If the job was aborted, so is the
+	 * returned one.
+	 *
+	 * @param function is called with a reference to the job's result
+	 * @param callback is executed on this thread, when the returned job
+	 *        has finished
+	 */
+	template<class T, class F>
+	Job<typename std::result_of<F(T &)>::type>
+	then(const Job<T> &job,
+	     F function,
+	     callback_function_t<typename std::result_of<F(T &)>::type> callback={},
+	     job_priority priority=job_priority::normal) {
+		using U = typename std::result_of<F(T &)>::type;
+		ENSURE(job.state, "continuing a destroyed or uninitialised job");
+
+		std::shared_ptr<TypedJobStateBase<T>> previous = job.state;
+		auto state = std::make_shared<JobState<U>>(
+			[previous, function]() -> U {
+				if (not previous->finished.load()) {
+					throw JobAbortedException{};
+				}
+				if (previous->exception != nullptr) {
+					std::rethrow_exception(previous->exception);
+				}
+				return function(previous->result);
+			},
+			callback
+		);
+
+		previous->add_continuation([this, state, priority]() {
+			this->enqueue_state(state, priority);
+		});
+		return Job<U>{state};
+	}
+
+	/**
+	 * Returns a job that collects the results of all given jobs, in order,
+	 * once they have finished. The first exception of the jobs is
+	 * thrown by it instead.
+	 */
+	template<class T>
+	Job<std::vector<T>> when_all(const std::vector<Job<T>> &jobs,
+	                             typename Job<std::vector<T>>::callback_t callback={},
+	                             job_priority priority=job_priority::normal) {
+		std::vector<std::shared_ptr<TypedJobStateBase<T>>> previous;
+		for (auto &job : jobs) {
+			ENSURE(job.state, "waiting for a destroyed or uninitialised job");
+			previous.push_back(job.state);
+		}
+
+		auto state = std::make_shared<JobState<std::vector<T>>>(
+			[previous]() -> std::vector<T> {
+				std::vector<T> results;
+				results.reserve(previous.size());
+				for (auto &job : previous) {
+					if (not job->finished.load()) {
+						throw JobAbortedException{};
+					}
+					if (job->exception != nullptr) {
+						std::rethrow_exception(job->exception);
+					}
+					results.push_back(job->result);
+				}
+				return results;
+			},
+			callback
+		);
+
+		if (previous.empty()) {
+			this->enqueue_state(state, priority);
+			return Job<std::vector<T>>{state};
+		}
+
+		// the last finished job enqueues the collecting one
+		auto remaining = std::make_shared<std::atomic<size_t>>(previous.size());
+		for (auto &job : previous) {
+			job->add_continuation([this, state, remaining, priority]() {
+				if (remaining->fetch_sub(1) == 1) {
+					this->enqueue_state(state, priority);
+				}
+			});
+		}
+		return Job<std::vector<T>>{state};
+	}
+
+	/** Returns the number of worker threads. */
+	int get_number_of_workers() const;
+
+	/** Returns the settings of the worker threads. */
+	const pool_options &get_options() const;
+
 	/**
 	 * Creates a job group, in order to be able to execute multiple jobs on the
 	 * same worker thread.
@@ -129,25 +267,48 @@ public:
 	 */
 	void execute_callbacks();
 
+	/**
+	 * Executes the callbacks of finished jobs of the current thread until the
+	 * budget is used up, those of higher priority jobs first. At least one
+	 * callback is executed, the remaining ones are kept for the next call.
+	 *
+	 * @return the number of callbacks that are left
+	 */
+	size_t execute_callbacks(std::chrono::steady_clock::duration budget);
+
+	/**
+	 * Returns the number of callbacks that wait for
+	 * execute_callbacks on the current thread.
+	 */
+	size_t pending_callbacks();
+
 private:
-	/** Enqueues the given job into the internal job queue. */
-	void enqueue_state(std::shared_ptr<JobStateBase> state);
+	/** Enqueues the given job with the given priority. */
+	void enqueue_state(std::shared_ptr<JobStateBase> state, job_priority priority);
+
+	/**
+	 * Takes the worker's share of the injected jobs of the given priority.
+	 * The first one is returned, the others are added to the worker's deque.
+	 *
+	 * @returns false if there was no job to take.
+	 */
+	bool take_injected(Worker *worker, job_priority priority, std::shared_ptr<JobStateBase> &job);
 
 	/**
-	 * Returns a job from the internal job queue. If the queue is empty, a
-	 * nullptr is returned.
+	 * Blocks the worker until there are queued jobs, jobs of its job groups
+	 * or it was stopped.
 	 */
-	std::shared_ptr<JobStateBase> fetch_job();
+	void wait_for_jobs(Worker *worker);
 
-	/** Returns whether there are jobs to be executed. */
-	bool has_job();
+	/** Wakes up one or all waiting workers. */
+	void wake_workers(bool all);
 
 	/** Adds a finished job to the internal finished job map. */
 	void finish_job(std::shared_ptr<JobStateBase> job);
 
 	/**
-	 * A worker has to be a friend of the job manager in order to call the
-	 * private finish_job method.
+	 * A worker has to be a friend of the job manager in order to fetch jobs
+	 * and call the private finish_job method.
 	 */
 	friend class Worker;
 };
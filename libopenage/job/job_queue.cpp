@@ -0,0 +1,52 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "job_queue.h"
+
+
+namespace openage {
+namespace job {
+
+
+JobQueue::JobQueue() {
+	node *stub = new node{};
+	stub->next.store(nullptr, std::memory_order_relaxed);
+	this->head.store(stub, std::memory_order_relaxed);
+	this->tail = stub;
+}
+
+
+JobQueue::~JobQueue() {
+	node *current = this->tail;
+	while (current != nullptr) {
+		node *next = current->next.load(std::memory_order_relaxed);
+		delete current;
+		current = next;
+	}
+}
+
+
+void JobQueue::push(std::shared_ptr<JobStateBase> job) {
+	node *n = new node{std::move(job), {}};
+	n->next.store(nullptr, std::memory_order_relaxed);
+
+	// the queue is consistent again as soon as the previous head is linked,
+	// until then the consumer considers the new job not yet added.
+	node *prev = this->head.exchange(n, std::memory_order_acq_rel);
+	prev->next.store(n, std::memory_order_release);
+}
+
+
+bool JobQueue::pop(std::shared_ptr<JobStateBase> &job) {
+	node *next = this->tail->next.load(std::memory_order_acquire);
+	if (next == nullptr) {
+		return false;
+	}
+
+	job = std::move(next->job);
+	delete this->tail;
+	this->tail = next;
+	return true;
+}
+
+
+}} // namespace openage::job
@@ -0,0 +1,81 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "job_state_base.h"
+
+namespace openage {
+namespace job {
+
+/**
+ * An unbounded lock-free FIFO queue of jobs, which any thread may add jobs
+ * to. Only one thread at a time can take jobs out of it: consumers that
+ * find the queue occupied by another consumer don't wait, but look for
+ * work elsewhere.
+ *
+ * Jobs are linked as in Dmitry Vyukov's intrusive multi-producer queue.
+ */
+class JobQueue {
+public:
+	JobQueue();
+	~JobQueue();
+
+	JobQueue(const JobQueue &) = delete;
+	JobQueue &operator =(const JobQueue &) = delete;
+
+	/** Adds the job at the end of the queue. */
+	void push(std::shared_ptr<JobStateBase> job);
+
+	/**
+	 * Takes up to max_count jobs from the front of the queue and passes each
+	 * of them to the consumer function.
+	 *
+	 * @returns the number of taken jobs. It is zero if the queue was empty
+	 *          or another thread is taking jobs right now.
+	 */
+	template<class F>
+	size_t consume(size_t max_count, F &&consumer) {
+		if (this->consuming.test_and_set(std::memory_order_acquire)) {
+			return 0;
+		}
+
+		size_t count = 0;
+		std::shared_ptr<JobStateBase> job;
+		while (count < max_count and this->pop(job)) {
+			consumer(std::move(job));
+			count++;
+		}
+
+		this->consuming.clear(std::memory_order_release);
+		return count;
+	}
+
+private:
+	struct node {
+		std::shared_ptr<JobStateBase> job;
+		std::atomic<node *> next;
+	};
+
+	/**
+	 * Takes the first job.
+	 * Must only be called while holding the consuming flag.
+	 */
+	bool pop(std::shared_ptr<JobStateBase> &job);
+
+	/** The most recently added node, exchanged by the producers. */
+	std::atomic<node *> head;
+
+	/**
+	 * The node before the first job, its own job has already been taken.
+	 * Only accessed by the consumer.
+	 */
+	node *tail;
+
+	/** Set while a thread takes jobs out of the queue. */
+	std::atomic_flag consuming = ATOMIC_FLAG_INIT;
+};
+
+}} // namespace openage::job
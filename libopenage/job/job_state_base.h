@@ -1,9 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
 
+#include "cancellation_token.h"
 #include "types.h"
 
 namespace openage {
@@ -21,6 +22,17 @@ public:
 	/** Default constructor. */
 	virtual ~JobStateBase() = default;
 
+	/**
+	 * Priority the job was enqueued with. Its callback is executed
+	 * before the ones of less important jobs.
+	 */
+	job_priority priority = job_priority::normal;
+
+	/**
+	 * Cancels the job, it is skipped if it did not start yet.
+	 */
+	CancellationToken cancellation;
+
 	/**
 	 * This function executes the job. It returns whether the job has been
 	 * aborted.
@@ -34,6 +46,9 @@ public:
 	 */
 	virtual void execute_callback() = 0;
 
+	/** Returns whether the job has a callback to execute. */
+	virtual bool has_callback() const = 0;
+
 	/** Returns the id of the thread that has created this job. */
 	virtual size_t get_thread_id() = 0;
 };
@@ -0,0 +1,139 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "ordered_jobs.h"
+
+#include "job_manager.h"
+
+namespace openage {
+namespace job {
+
+OrderedJobs::OrderedJobs(JobManager *manager, job_priority priority)
+	:
+	manager{manager},
+	priority{priority},
+	shared{std::make_shared<shared_state>()} {}
+
+
+OrderedJobs::~OrderedJobs() {
+	for (auto &job : this->jobs) {
+		// take the job from the worker, or let it finish
+		auto expected = entry_state::queued;
+		if (not job->state.compare_exchange_strong(expected, entry_state::done)) {
+			this->wait_idle(*job);
+		}
+	}
+}
+
+
+void OrderedJobs::add(std::shared_ptr<entry_base> job) {
+	if (this->manager == nullptr) {
+		job->state.store(entry_state::running);
+		run_here(*job);
+		job->state.store(entry_state::done);
+		this->jobs.push_back(std::move(job));
+		return;
+	}
+
+	this->manager->enqueue<int>(
+		abortable_function_t<int>{
+			[shared = this->shared, job](should_abort_t should_abort, abort_t) {
+				run_on_worker(shared, job, should_abort);
+				return 0;
+			}
+		},
+		{},
+		this->priority,
+		job->cancellation
+	);
+
+	this->jobs.push_back(std::move(job));
+}
+
+
+void OrderedJobs::run_on_worker(const std::shared_ptr<shared_state> &shared,
+                                const std::shared_ptr<entry_base> &job,
+                                const should_abort_t &should_abort) {
+	auto expected = entry_state::queued;
+	if (not job->state.compare_exchange_strong(expected, entry_state::running)) {
+		// commit() runs it already
+		return;
+	}
+
+	auto next = entry_state::done;
+	try {
+		job->run(should_abort);
+	}
+	catch (JobAbortedException &) {
+		// leave it to commit(), which skips it if it was cancelled
+		next = entry_state::queued;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock{shared->lock};
+		job->state.store(next);
+	}
+	shared->changed.notify_all();
+
+	if (next == entry_state::queued) {
+		throw JobAbortedException{};
+	}
+}
+
+
+void OrderedJobs::run_here(entry_base &job) {
+	if (job.cancellation.is_cancelled()) {
+		return;
+	}
+
+	CancellationScope scope{job.cancellation};
+	try {
+		job.run([]() { return false; });
+	}
+	catch (JobAbortedException &) {
+		// the function aborted itself if it wasn't cancelled
+		job.exception = std::current_exception();
+	}
+}
+
+
+OrderedJobs::entry_state OrderedJobs::wait_idle(entry_base &job) {
+	std::unique_lock<std::mutex> lock{this->shared->lock};
+	this->shared->changed.wait(lock, [&job]() {
+		return job.state.load() != entry_state::running;
+	});
+	return job.state.load();
+}
+
+
+void OrderedJobs::commit() {
+	// callbacks may submit new jobs for the next commit
+	std::vector<std::shared_ptr<entry_base>> pending;
+	std::swap(pending, this->jobs);
+
+	for (auto &job : pending) {
+		while (true) {
+			auto expected = entry_state::queued;
+			if (job->state.compare_exchange_strong(expected, entry_state::running)) {
+				run_here(*job);
+				job->state.store(entry_state::done);
+				break;
+			}
+
+			if (this->wait_idle(*job) == entry_state::done) {
+				break;
+			}
+			// the worker aborted it, run it here
+		}
+
+		if (not job->cancellation.is_cancelled()) {
+			job->commit();
+		}
+	}
+}
+
+
+size_t OrderedJobs::size() const {
+	return this->jobs.size();
+}
+
+}} // openage::job
@@ -0,0 +1,206 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cancellation_token.h"
+#include "job_aborted_exception.h"
+#include "types.h"
+
+namespace openage {
+namespace job {
+
+class JobManager;
+
+/**
+ * Runs jobs of the simulation in parallel on the workers of a job manager,
+ * and commits their results in the order the jobs were submitted.
+ *
+ * The callbacks of normal jobs run in the order the jobs finish, which
+ * depends on the number of threads and their timing. A simulation that
+ * applies results that way differs between the peers of a lockstep game
+ * and between a game and its replay. Here, the results are only applied
+ * by commit(), e.g. once per tick, always in submission order. Without a
+ * job manager, the jobs run right away, the results are committed the same.
+ *
+ * The thread calling commit() runs the jobs that did not start yet itself,
+ * so it never waits for workers that are busy or stopped.
+ */
+class OrderedJobs {
+public:
+	/**
+	 * @param manager runs the jobs, nullptr runs them when submitted
+	 * @param priority of the jobs in the manager
+	 */
+	explicit OrderedJobs(JobManager *manager, job_priority priority=job_priority::high);
+
+	/**
+	 * Jobs that did not start yet are skipped, the running ones are
+	 * waited for. No results are committed.
+	 */
+	~OrderedJobs();
+
+	OrderedJobs(const OrderedJobs &) = delete;
+	OrderedJobs &operator =(const OrderedJobs &) = delete;
+
+	/**
+	 * Submits a job, whose result is passed to commit_result by the next
+	 * commit(). As for job callbacks, calling the result function rethrows
+	 * the exception of the job.
+	 *
+	 * @param cancellation skips the job and its commit_result once cancelled
+	 */
+	template<class T>
+	void submit(abortable_function_t<T> function,
+	            callback_function_t<T> commit_result,
+	            const CancellationToken &cancellation={}) {
+		auto job = std::make_shared<entry<T>>();
+		job->function = std::move(function);
+		job->commit_result = std::move(commit_result);
+		job->cancellation = cancellation;
+		this->add(std::move(job));
+	}
+
+	/**
+	 * Submits a job that can't be aborted, see above.
+	 */
+	template<class T>
+	void submit(job_function_t<T> function,
+	            callback_function_t<T> commit_result,
+	            const CancellationToken &cancellation={}) {
+		this->submit<T>(
+			abortable_function_t<T>{[function](should_abort_t, abort_t) {
+				return function();
+			}},
+			std::move(commit_result),
+			cancellation
+		);
+	}
+
+	/**
+	 * Waits for the submitted jobs, running the ones that did not start
+	 * yet on this thread, and calls their commit_result functions in the
+	 * order they were submitted.
+	 */
+	void commit();
+
+	/**
+	 * The number of jobs submitted since the last commit.
+	 */
+	size_t size() const;
+
+private:
+	enum class entry_state {
+		queued,
+		running,
+		done,
+	};
+
+	/**
+	 * A submitted job, shared with the job that runs it.
+	 */
+	struct entry_base {
+		virtual ~entry_base() = default;
+
+		/**
+		 * Runs the function and stores its result or exception.
+		 * Throws a JobAbortedException if the job was aborted or
+		 * cancelled.
+		 */
+		virtual void run(const should_abort_t &should_abort) = 0;
+
+		/**
+		 * Passes the stored result to the commit_result function.
+		 */
+		virtual void commit() = 0;
+
+		std::atomic<entry_state> state{entry_state::queued};
+		CancellationToken cancellation;
+		std::exception_ptr exception;
+	};
+
+	template<class T>
+	struct entry : entry_base {
+		void run(const should_abort_t &should_abort) override {
+			abort_t abort = []() {
+				throw JobAbortedException{};
+			};
+
+			try {
+				this->result = this->function(should_abort, abort);
+			}
+			catch (JobAbortedException &) {
+				throw;
+			}
+			catch (...) {
+				this->exception = std::current_exception();
+			}
+		}
+
+		void commit() override {
+			if (not this->commit_result) {
+				return;
+			}
+
+			this->commit_result([this]() -> T {
+				if (this->exception != nullptr) {
+					std::rethrow_exception(this->exception);
+				}
+				return std::move(this->result);
+			});
+		}
+
+		abortable_function_t<T> function;
+		callback_function_t<T> commit_result;
+		T result;
+	};
+
+	/**
+	 * Signals the thread waiting in commit() for a job.
+	 */
+	struct shared_state {
+		std::mutex lock;
+		std::condition_variable changed;
+	};
+
+	/**
+	 * Enqueues the job, or runs it without a job manager.
+	 */
+	void add(std::shared_ptr<entry_base> job);
+
+	/**
+	 * Runs the job on the worker if commit() didn't take it.
+	 */
+	static void run_on_worker(const std::shared_ptr<shared_state> &shared,
+	                          const std::shared_ptr<entry_base> &job,
+	                          const should_abort_t &should_abort);
+
+	/**
+	 * Runs the job on this thread, unless it was cancelled.
+	 */
+	static void run_here(entry_base &job);
+
+	/**
+	 * Waits until no worker runs the job.
+	 * Returns the state it was left in.
+	 */
+	entry_state wait_idle(entry_base &job);
+
+	JobManager *manager;
+	job_priority priority;
+
+	std::shared_ptr<shared_state> shared;
+
+	/**
+	 * The jobs submitted since the last commit, in order.
+	 */
+	std::vector<std::shared_ptr<entry_base>> jobs;
+};
+
+}} // openage::job
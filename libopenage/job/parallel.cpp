@@ -0,0 +1,148 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#include "job_manager.h"
+
+namespace openage {
+namespace job {
+
+namespace {
+
+/**
+ * A parallel loop, split into parts which are taken by the threads
+ * one after the other: chunks for dynamic schedules, equal shares of the
+ * chunks for fixed ones. Shared with the helper jobs, which may start
+ * after the loop has finished.
+ */
+struct loop_state {
+	const range_function_t *function;
+	size_t begin;
+	size_t end;
+	size_t grain;
+	size_t chunks;
+	size_t parts;
+
+	/** The next part to take. */
+	std::atomic<size_t> next{0};
+
+	/** Set when a chunk threw, the remaining ones are skipped. */
+	std::atomic<bool> failed{false};
+
+	/** Guards the members below. */
+	std::mutex mutex;
+	std::condition_variable all_done;
+	size_t done = 0;
+	std::exception_ptr error;
+};
+
+
+/**
+ * Takes and runs parts until none are left.
+ */
+void run_parts(loop_state &state) {
+	while (true) {
+		size_t part = state.next.fetch_add(1);
+		if (part >= state.parts) {
+			return;
+		}
+
+		size_t first = part * state.chunks / state.parts;
+		size_t last = (part + 1) * state.chunks / state.parts;
+
+		std::exception_ptr error;
+		for (size_t chunk = first; chunk < last and not state.failed.load(); chunk++) {
+			size_t chunk_begin = state.begin + chunk * state.grain;
+			size_t chunk_end = std::min(chunk_begin + state.grain, state.end);
+			try {
+				CancellationToken::current().check();
+				(*state.function)(chunk_begin, chunk_end);
+			}
+			catch (...) {
+				error = std::current_exception();
+				state.failed = true;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock{state.mutex};
+		if (error and not state.error) {
+			state.error = error;
+		}
+		state.done += 1;
+		if (state.done == state.parts) {
+			state.all_done.notify_all();
+		}
+	}
+}
+
+} // anonymous namespace
+
+
+void parallel_for(JobManager *manager,
+                  size_t begin, size_t end, size_t grain,
+                  const range_function_t &function,
+                  schedule mode,
+                  job_priority priority) {
+	if (end <= begin) {
+		return;
+	}
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	size_t chunks = (end - begin + grain - 1) / grain;
+	size_t threads = (manager == nullptr) ? 1 : manager->get_number_of_workers() + 1;
+
+	if (chunks == 1 or threads == 1) {
+		for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain) {
+			CancellationToken::current().check();
+			function(chunk_begin, std::min(chunk_begin + grain, end));
+		}
+		return;
+	}
+
+	auto state = std::make_shared<loop_state>();
+	state->function = &function;
+	state->begin = begin;
+	state->end = end;
+	state->grain = grain;
+	state->chunks = chunks;
+	state->parts = (mode == schedule::fixed) ? std::min(chunks, threads) : chunks;
+
+	// the calling thread works as well, the helpers
+	// are cancelled along with the job of this thread
+	size_t helpers = std::min(threads, state->parts) - 1;
+	for (size_t i = 0; i < helpers; i++) {
+		manager->enqueue<int>(
+			[state]() -> int {
+				run_parts(*state);
+				return 0;
+			},
+			{},
+			priority,
+			CancellationToken::current()
+		);
+	}
+
+	// the parts that are still running were taken by
+	// helpers that are executing, so this never waits for a queued job
+	run_parts(*state);
+
+	std::unique_lock<std::mutex> lock{state->mutex};
+	state->all_done.wait(lock, [&state] {
+		return state->done == state->parts;
+	});
+
+	if (state->error) {
+		std::rethrow_exception(state->error);
+	}
+}
+
+}} // namespace openage::job
@@ -0,0 +1,98 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "types.h"
+
+namespace openage {
+namespace job {
+
+class JobManager;
+
+/**
+ * How the chunks of a parallel loop are distributed.
+ */
+enum class schedule {
+	/**
+	 * Each thread gets an equal share of consecutive chunks up front.
+	 * Cheapest for chunks that all take the same time.
+	 */
+	fixed,
+
+	/**
+	 * The threads take the next chunk whenever they are done with one.
+	 * Balances chunks that take different times.
+	 */
+	dynamic,
+};
+
+
+/**
+ * Type of the function of a parallel loop, called with the first and
+ * one past the last index of a chunk.
+ */
+using range_function_t = std::function<void(size_t, size_t)>;
+
+
+/**
+ * Calls function(chunk_begin, chunk_end) for the chunks of grain indices
+ * of [begin, end), in parallel on the job manager's workers.
+ *
+ * The calling thread runs chunks as well, so the loop never waits for
+ * workers that are busy with other jobs, and may be used from within
+ * a job. Without a job manager or with a single chunk, everything runs
+ * on the calling thread.
+ *
+ * Returns when all chunks are done. If a chunk throws, the chunks that
+ * were not started yet are skipped and the exception is rethrown here.
+ * The same happens with a JobAbortedException when the job running the
+ * loop is cancelled, see CancellationToken.
+ */
+void parallel_for(JobManager *manager,
+                  size_t begin, size_t end, size_t grain,
+                  const range_function_t &function,
+                  schedule mode=schedule::dynamic,
+                  job_priority priority=job_priority::high);
+
+
+/**
+ * Computes map(chunk_begin, chunk_end) for each chunk of [begin, end)
+ * with parallel_for, and combines the results with reduce, starting at
+ * identity.
+ *
+ * The results are combined in the order of the chunks, so the result is
+ * the same for any number of threads as long as the grain stays the same.
+ */
+template<class T, class Map, class Reduce>
+T parallel_reduce(JobManager *manager,
+                  size_t begin, size_t end, size_t grain,
+                  T identity, Map map, Reduce reduce,
+                  schedule mode=schedule::dynamic,
+                  job_priority priority=job_priority::high) {
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	size_t count = (end > begin) ? end - begin : 0;
+	std::vector<T> partial((count + grain - 1) / grain, identity);
+
+	parallel_for(
+		manager, begin, end, grain,
+		[&](size_t chunk_begin, size_t chunk_end) {
+			partial[(chunk_begin - begin) / grain] = map(chunk_begin, chunk_end);
+		},
+		mode, priority
+	);
+
+	T result = identity;
+	for (auto &value : partial) {
+		result = reduce(result, value);
+	}
+	return result;
+}
+
+}} // namespace openage::job
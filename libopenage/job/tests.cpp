@@ -1,11 +1,25 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
+#include "../error/error.h"
 #include "../log/log.h"
 #include "../testing/testing.h"
+#include "../util/thread_id.h"
 
+#include "cancellation_token.h"
+#include "job_graph.h"
 #include "job_manager.h"
+#include "ordered_jobs.h"
+#include "parallel.h"
+#include "work_deque.h"
+#include "worker.h"
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace openage {
 namespace job {
@@ -90,9 +104,725 @@ void test_simple_job_with_exception() {
 }
 
 
+void test_work_deque() {
+	// the owner takes the newest items, thieves the oldest ones
+	WorkDeque<int> deque{4};
+	for (int i = 0; i < 100; i++) {
+		deque.push(i);
+	}
+
+	int item;
+	(deque.steal(item) and item == 0) or TESTFAIL;
+	(deque.pop(item) and item == 99) or TESTFAIL;
+
+	for (int i = 1; i < 99; i++) {
+		deque.pop(item) or TESTFAIL;
+	}
+	item == 1 or TESTFAIL;
+	deque.empty() or TESTFAIL;
+	deque.pop(item) and TESTFAIL;
+	deque.steal(item) and TESTFAIL;
+
+	// every item is taken exactly once while thieves compete with the owner
+	constexpr int item_count = 100000;
+	std::vector<std::atomic<int>> taken(item_count);
+	for (auto &count : taken) {
+		count = 0;
+	}
+
+	std::atomic<bool> done{false};
+	auto thief = [&]() {
+		int stolen;
+		while (not done.load() or not deque.empty()) {
+			if (deque.steal(stolen)) {
+				taken[stolen]++;
+			}
+		}
+	};
+
+	std::thread thief0{thief};
+	std::thread thief1{thief};
+
+	for (int i = 0; i < item_count; i++) {
+		deque.push(i);
+		if (i % 3 == 0 and deque.pop(item)) {
+			taken[item]++;
+		}
+	}
+	done = true;
+
+	thief0.join();
+	thief1.join();
+
+	while (deque.pop(item)) {
+		taken[item]++;
+	}
+
+	for (auto &count : taken) {
+		count.load() == 1 or TESTFAIL;
+	}
+}
+
+
+void test_work_stealing() {
+	JobManager manager{2};
+	manager.start();
+
+	std::atomic<bool> release{false};
+	std::atomic<int> finished{0};
+	int job_count = 20;
+
+	manager.enqueue<int>([&]() -> int {
+		while (not release.load()) {
+			std::this_thread::yield();
+		}
+		return 0;
+	});
+
+	for (int i = 0; i < job_count; i++) {
+		manager.enqueue<int>([&]() -> int {
+			finished++;
+			return 0;
+		});
+	}
+
+	// the short jobs finish on the other worker, even if
+	// the blocked one took some of them.
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+	while (finished.load() < job_count and std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+
+	release = true;
+	manager.stop();
+
+	finished.load() == job_count or TESTFAIL;
+}
+
+
+void test_job_priority() {
+	JobManager manager{1};
+	manager.start();
+
+	std::atomic<bool> started{false};
+	std::atomic<bool> release{false};
+	std::atomic<int> finished{0};
+
+	std::mutex order_mutex;
+	std::vector<job_priority> order;
+
+	// keep the only worker busy while the other jobs are enqueued
+	manager.enqueue<int>([&]() -> int {
+		started = true;
+		while (not release.load()) {
+			std::this_thread::yield();
+		}
+		return 0;
+	});
+
+	while (not started.load()) {
+		std::this_thread::yield();
+	}
+
+	int job_count = 10;
+	for (auto priority : {job_priority::low, job_priority::normal, job_priority::high}) {
+		for (int i = 0; i < job_count; i++) {
+			manager.enqueue<int>([&, priority]() -> int {
+				std::lock_guard<std::mutex> lock{order_mutex};
+				order.push_back(priority);
+				finished++;
+				return 0;
+			}, {}, priority);
+		}
+	}
+
+	release = true;
+	while (finished.load() < 3 * job_count) {
+		std::this_thread::yield();
+	}
+
+	manager.stop();
+
+	for (int i = 0; i < 3 * job_count; i++) {
+		auto expected = (i < job_count) ? job_priority::high :
+		                (i < 2 * job_count) ? job_priority::normal : job_priority::low;
+		order[i] == expected or TESTFAIL;
+	}
+}
+
+
+void test_job_graph() {
+	JobManager manager{4};
+	manager.start();
+
+	// layers of tasks, each depending on all tasks of the previous layer
+	int layers = 8;
+	int width = 16;
+	std::atomic<int> finished{0};
+	std::atomic<bool> order_ok{true};
+
+	JobGraph graph{&manager};
+	std::vector<JobGraph::task_id> previous;
+	for (int layer = 0; layer < layers; layer++) {
+		std::vector<JobGraph::task_id> current;
+		for (int i = 0; i < width; i++) {
+			current.push_back(graph.add([&, layer]() {
+				// all tasks of the earlier layers have finished
+				if (finished.load() < layer * width) {
+					order_ok = false;
+				}
+				finished++;
+			}, previous));
+		}
+		previous = current;
+	}
+
+	size_t progress_calls = 0;
+	size_t last_done = 0;
+	bool progress_ok = true;
+	graph.run([&](size_t done, size_t total) {
+		if (done <= last_done or total != graph.size()) {
+			progress_ok = false;
+		}
+		last_done = done;
+		progress_calls++;
+	});
+
+	finished.load() == layers * width or TESTFAIL;
+	order_ok.load() or TESTFAIL;
+	progress_ok or TESTFAIL;
+	(progress_calls > 0 and last_done == graph.size()) or TESTFAIL;
+
+	// a failing task skips its dependents, the error reaches the caller
+	JobGraph failing{&manager};
+	std::atomic<bool> dependent_ran{false};
+	auto bad = failing.add([]() {
+		throw Error{MSG(err) << "task failed"};
+	});
+	failing.add([&]() {
+		dependent_ran = true;
+	}, {bad});
+
+	bool thrown = false;
+	try {
+		failing.run();
+	}
+	catch (Error &) {
+		thrown = true;
+	}
+
+	thrown or TESTFAIL;
+	dependent_ran.load() and TESTFAIL;
+
+	// without a job manager, the tasks run serially
+	JobGraph serial{nullptr};
+	std::vector<int> order;
+	auto first = serial.add([&]() { order.push_back(0); });
+	serial.add([&]() { order.push_back(1); }, {first});
+	serial.run();
+	(order == std::vector<int>{0, 1}) or TESTFAIL;
+
+	manager.stop();
+}
+
+
+void test_job_continuation() {
+	JobManager manager{4};
+	manager.start();
+
+	// a chain of stages, none of them goes through this thread
+	std::atomic<bool> finished{false};
+	int result = 0;
+	Job<int> load = manager.enqueue<int>([]() {
+		return 20;
+	});
+	Job<int> decode = manager.then(load, [](int &value) {
+		return value + 1;
+	});
+	manager.then(decode, [&finished](int &value) {
+		finished = true;
+		return value * 2;
+	}, [&result](result_function_t<int> get_result) {
+		result = get_result();
+	});
+
+	// the callback runs here
+	while (result == 0) {
+		manager.execute_callbacks();
+	}
+	finished.load() or TESTFAIL;
+	result == 42 or TESTFAIL;
+
+	// continuing a finished job starts the next stage right away
+	Job<int> again = manager.then(load, [](int &value) {
+		return value;
+	});
+	while (not again.is_finished()) {
+		std::this_thread::yield();
+	}
+	again.get_result() == 20 or TESTFAIL;
+
+	// the results of all jobs, in order
+	std::vector<Job<int>> parts;
+	for (int i = 0; i < 16; i++) {
+		parts.push_back(manager.enqueue<int>([i]() {
+			return i;
+		}));
+	}
+	Job<std::vector<int>> all = manager.when_all(parts);
+	Job<int> sum = manager.then(all, [](std::vector<int> &values) {
+		int total = 0;
+		for (int value : values) {
+			total += value;
+		}
+		return total;
+	});
+	while (not sum.is_finished()) {
+		std::this_thread::yield();
+	}
+	sum.get_result() == 120 or TESTFAIL;
+
+	// an exception skips the following stages and reaches the last one
+	std::atomic<bool> skipped_ran{false};
+	Job<int> bad = manager.enqueue<int>([]() -> int {
+		throw Error{MSG(err) << "stage failed"};
+	});
+	Job<int> skipped = manager.then(bad, [&skipped_ran](int &value) {
+		skipped_ran = true;
+		return value;
+	});
+	Job<std::vector<int>> bad_all = manager.when_all(std::vector<Job<int>>{load, skipped});
+	while (not bad_all.is_finished()) {
+		std::this_thread::yield();
+	}
+
+	bool thrown = false;
+	try {
+		bad_all.get_result();
+	}
+	catch (Error &) {
+		thrown = true;
+	}
+	thrown or TESTFAIL;
+	skipped_ran.load() and TESTFAIL;
+
+	manager.stop();
+}
+
+
+void test_callback_budget() {
+	JobManager manager{2};
+	manager.start();
+
+	int job_count = 12;
+	std::atomic<int> done{0};
+	std::vector<job_priority> order;
+
+	for (int i = 0; i < job_count; i++) {
+		auto priority = (i % 2 == 0) ? job_priority::low : job_priority::high;
+		manager.enqueue<int>([&done]() {
+			done++;
+			return 0;
+		}, [&order, priority](result_function_t<int>) {
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+			order.push_back(priority);
+		}, priority);
+	}
+
+	// jobs without callback don't wait for this thread
+	manager.enqueue<int>([]() {
+		return 0;
+	});
+
+	while (done.load() < job_count or manager.pending_callbacks() < static_cast<size_t>(job_count)) {
+		std::this_thread::yield();
+	}
+	manager.pending_callbacks() == static_cast<size_t>(job_count) or TESTFAIL;
+
+	// even without budget there is progress
+	size_t left = manager.execute_callbacks(std::chrono::steady_clock::duration::zero());
+	left == static_cast<size_t>(job_count - 1) or TESTFAIL;
+	order.size() == 1 or TESTFAIL;
+
+	// the rest is carried over to the next calls
+	int calls = 1;
+	while (left > 0) {
+		left = manager.execute_callbacks(std::chrono::milliseconds{3});
+		calls++;
+	}
+	order.size() == static_cast<size_t>(job_count) or TESTFAIL;
+	calls > 2 or TESTFAIL;
+
+	// callbacks of the high priority jobs ran first
+	for (int i = 0; i < job_count; i++) {
+		auto expected = (i < job_count / 2) ? job_priority::high : job_priority::low;
+		order[i] == expected or TESTFAIL;
+	}
+
+	manager.stop();
+}
+
+
+void test_parallel_for() {
+	JobManager manager{4};
+	manager.start();
+
+	constexpr size_t count = 10007;
+
+	for (auto mode : {schedule::fixed, schedule::dynamic}) {
+		for (size_t grain : {0, 1, 64, 5000, 20000}) {
+			// every index is visited exactly once, in chunks of grain
+			std::vector<std::atomic<int>> visits(count);
+			std::atomic<bool> chunks_ok{true};
+			parallel_for(&manager, 0, count, grain, [&](size_t begin, size_t end) {
+				if (begin >= end or end - begin > std::max<size_t>(grain, 1)) {
+					chunks_ok = false;
+				}
+				for (size_t i = begin; i < end; i++) {
+					visits[i]++;
+				}
+			}, mode);
+
+			chunks_ok.load() or TESTFAIL;
+			for (auto &visit : visits) {
+				visit.load() == 1 or TESTFAIL;
+			}
+		}
+
+		uint64_t sum = parallel_reduce(
+			&manager, 1, count + 1, 100, uint64_t{0},
+			[](size_t begin, size_t end) {
+				uint64_t partial = 0;
+				for (size_t i = begin; i < end; i++) {
+					partial += i;
+				}
+				return partial;
+			},
+			[](uint64_t a, uint64_t b) { return a + b; },
+			mode
+		);
+		sum == uint64_t{count} * (count + 1) / 2 or TESTFAIL;
+	}
+
+	// empty ranges don't call the function
+	bool called = false;
+	parallel_for(&manager, 5, 5, 1, [&](size_t, size_t) { called = true; });
+	called and TESTFAIL;
+
+	// the first exception reaches the caller, later chunks are skipped
+	std::atomic<int> ran{0};
+	bool thrown = false;
+	try {
+		parallel_for(&manager, 0, 1000, 1, [&](size_t begin, size_t) {
+			ran++;
+			if (begin == 0) {
+				throw Error{MSG(err) << "chunk failed"};
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		});
+	}
+	catch (Error &) {
+		thrown = true;
+	}
+	thrown or TESTFAIL;
+	ran.load() < 1000 or TESTFAIL;
+
+	// nested loops run on the calling job as well
+	std::atomic<size_t> nested{0};
+	parallel_for(&manager, 0, 8, 1, [&](size_t, size_t) {
+		parallel_for(&manager, 0, 100, 10, [&](size_t begin, size_t end) {
+			nested += end - begin;
+		});
+	});
+	nested.load() == 800 or TESTFAIL;
+
+	manager.stop();
+
+	// without a job manager, the chunks run in order on this thread
+	std::vector<size_t> order;
+	parallel_for(nullptr, 0, 10, 3, [&](size_t begin, size_t end) {
+		order.push_back(begin);
+		order.push_back(end);
+	});
+	(order == std::vector<size_t>{0, 3, 3, 6, 6, 9, 9, 10}) or TESTFAIL;
+}
+
+
+void test_pool_options() {
+	(util::parse_cpu_list("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}) or TESTFAIL;
+	util::parse_cpu_list("").empty() or TESTFAIL;
+	for (auto list : {"1-", "3-1", "a", "1,,2", "-2"}) {
+		bool thrown = false;
+		try {
+			util::parse_cpu_list(list);
+		}
+		catch (Error &) {
+			thrown = true;
+		}
+		thrown or TESTFAIL;
+	}
+
+	pool_options options;
+	options.name = "test worker";
+	options.cpus = {0};
+	options.pin = true;
+	options.scratch_size = 1 << 16;
+
+	JobManager manager{2, options};
+	manager.get_options().name == "test worker" or TESTFAIL;
+	manager.start();
+
+	// each job sees the zeroed scratch memory of its worker
+	std::atomic<int> finished{0};
+	std::atomic<bool> scratch_ok{true};
+	for (int i = 0; i < 64; i++) {
+		manager.enqueue<int>([&]() {
+			Worker *worker = Worker::current();
+			if (worker == nullptr or worker->get_scratch().size() != (1 << 16)) {
+				scratch_ok = false;
+			}
+			finished++;
+			return 0;
+		});
+	}
+
+	while (finished.load() < 64) {
+		std::this_thread::yield();
+	}
+	scratch_ok.load() or TESTFAIL;
+
+	manager.stop();
+}
+
+
+void test_cancellation() {
+	JobManager manager{1};
+	manager.start();
+
+	// a cancelled job is skipped if it did not start yet
+	std::atomic<bool> release{false};
+	manager.enqueue<int>([&]() -> int {
+		while (not release.load()) {
+			std::this_thread::yield();
+		}
+		return 0;
+	});
+
+	CancellationToken token = CancellationToken::create();
+	std::atomic<bool> skipped_ran{false};
+	Job<int> skipped = manager.enqueue<int>([&]() -> int {
+		skipped_ran = true;
+		return 0;
+	}, {}, job_priority::normal, token);
+
+	JobGroup group = manager.create_job_group();
+	group.set_cancellation(token);
+	std::atomic<bool> group_ran{false};
+	group.enqueue<int>([&]() -> int {
+		group_ran = true;
+		return 0;
+	});
+
+	Job<int> after = manager.enqueue<int>([]() {
+		return 1;
+	});
+
+	token.cancel();
+	release = true;
+	while (not after.is_finished()) {
+		std::this_thread::yield();
+	}
+
+	skipped_ran.load() and TESTFAIL;
+	group_ran.load() and TESTFAIL;
+	skipped.is_finished() and TESTFAIL;
+
+	// running jobs stop where they check their token
+	CancellationToken running_token = CancellationToken::create();
+	std::atomic<bool> started{false};
+	std::atomic<bool> stopped{false};
+	Job<int> running = manager.enqueue<int>([&]() -> int {
+		CancellationToken::current().is_valid() or TESTFAIL;
+
+		struct set_on_exit {
+			std::atomic<bool> &flag;
+			~set_on_exit() { flag = true; }
+		} guard{stopped};
+
+		started = true;
+		while (true) {
+			CancellationToken::current().check();
+			std::this_thread::yield();
+		}
+	}, {}, job_priority::normal, running_token);
+
+	while (not started.load()) {
+		std::this_thread::yield();
+	}
+	running_token.cancel();
+	while (not stopped.load()) {
+		std::this_thread::yield();
+	}
+	running.is_finished() and TESTFAIL;
+
+	// the tasks of a graph stop with the job running it
+	CancellationToken graph_token = CancellationToken::create();
+	std::atomic<bool> second_ran{false};
+	std::atomic<bool> aborted{false};
+	manager.enqueue<int>([&]() -> int {
+		JobGraph graph{&manager};
+		auto first = graph.add([&] {
+			graph_token.cancel();
+		});
+		graph.add([&] {
+			second_ran = true;
+		}, {first});
+
+		try {
+			graph.run();
+		}
+		catch (JobAbortedException &) {
+			aborted = true;
+			throw;
+		}
+		return 0;
+	}, {}, job_priority::normal, graph_token);
+
+	while (not aborted.load()) {
+		std::this_thread::yield();
+	}
+	second_ran.load() and TESTFAIL;
+
+	// outside of jobs, nothing is cancelled
+	CancellationToken::current().is_valid() and TESTFAIL;
+	CancellationToken::current().check();
+
+	manager.stop();
+}
+
+
+void test_ordered_jobs() {
+	JobManager manager{4};
+	manager.start();
+
+	// a manager without workers: commit() runs the jobs
+	JobManager stopped{2};
+
+	for (JobManager *jobs_manager : {&manager, &stopped, static_cast<JobManager *>(nullptr)}) {
+		OrderedJobs jobs{jobs_manager};
+		std::vector<int> committed;
+
+		// the later jobs finish first
+		for (int i = 0; i < 32; i++) {
+			jobs.submit<int>(job_function_t<int>{[i]() {
+				std::this_thread::sleep_for(std::chrono::microseconds(32 - i));
+				return i;
+			}}, [&](result_function_t<int> result) {
+				committed.push_back(result());
+			});
+		}
+
+		jobs.submit<int>(job_function_t<int>{[]() -> int {
+			throw Error{MSG(err) << "ordered job failed"};
+		}}, [&](result_function_t<int> result) {
+			try {
+				result();
+				TESTFAIL;
+			}
+			catch (Error &) {
+				committed.push_back(-1);
+			}
+		});
+
+		CancellationToken token = CancellationToken::create();
+		jobs.submit<int>(job_function_t<int>{[]() {
+			return 100;
+		}}, [&](result_function_t<int> result) {
+			committed.push_back(result());
+		}, token);
+		token.cancel();
+
+		jobs.size() == 34 or TESTFAIL;
+		jobs.commit();
+		jobs.size() == 0 or TESTFAIL;
+
+		committed.size() == 33 or TESTFAIL;
+		for (int i = 0; i < 32; i++) {
+			committed[i] == i or TESTFAIL;
+		}
+		committed[32] == -1 or TESTFAIL;
+
+		// nothing is committed twice
+		jobs.commit();
+		committed.size() == 33 or TESTFAIL;
+	}
+
+	manager.stop();
+}
+
+
 void test_job_manager() {
 	test_simple_job();
 	test_simple_job_with_exception();
+	test_work_deque();
+	test_work_stealing();
+	test_job_priority();
+	test_job_graph();
+	test_job_continuation();
+	test_callback_budget();
+	test_parallel_for();
+	test_pool_options();
+	test_cancellation();
+	test_ordered_jobs();
+}
+
+
+// exported demo
+void parallel_benchmark() {
+	constexpr size_t count = 1 << 22;
+	constexpr size_t grain = 1 << 14;
+
+	// a few cycles of work per index, so the chunks dominate the scheduling
+	auto map = [](size_t begin, size_t end) {
+		uint64_t partial = 0;
+		for (size_t i = begin; i < end; i++) {
+			uint64_t x = i;
+			for (int round = 0; round < 16; round++) {
+				x = x * 6364136223846793005ull + 1442695040888963407ull;
+			}
+			partial += x >> 32;
+		}
+		return partial;
+	};
+	auto reduce = [](uint64_t a, uint64_t b) { return a + b; };
+
+	uint64_t expected = parallel_reduce(nullptr, 0, count, grain, uint64_t{0}, map, reduce);
+
+	double serial_ms = 0;
+	for (int threads : {1, 2, 4, 8, 16}) {
+		JobManager manager{threads - 1};
+		manager.start();
+
+		for (auto mode : {schedule::fixed, schedule::dynamic}) {
+			auto start = std::chrono::steady_clock::now();
+			uint64_t result = parallel_reduce(&manager, 0, count, grain, uint64_t{0}, map, reduce, mode);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+			if (result != expected) {
+				throw Error{MSG(err) << "parallel_reduce gave a wrong result"};
+			}
+			if (threads == 1 and mode == schedule::fixed) {
+				serial_ms = elapsed.count();
+			}
+
+			log::log(MSG(info) << threads << " threads, "
+			         << ((mode == schedule::fixed) ? "fixed" : "dynamic") << ": "
+			         << elapsed.count() << " ms, speedup "
+			         << serial_ms / elapsed.count());
+		}
+
+		manager.stop();
+	}
 }
 
 
@@ -1,10 +1,12 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <atomic>
 #include <exception>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 #include "../util/thread_id.h"
 #include "../error/error.h"
@@ -52,7 +54,8 @@ public:
 		:
 		thread_id{openage::util::get_current_thread_id()},
 		callback{callback},
-		finished{false} {
+		finished{false},
+		continued{false} {
 	}
 
 	/** Default destructor. */
@@ -64,17 +67,50 @@ public:
 	 * aborted.
 	 */
 	bool execute(should_abort_t should_abort) override {
+		// the result of a cancelled job would be discarded
+		if (this->cancellation.is_cancelled()) {
+			this->run_continuations();
+			return true;
+		}
+
+		// the jobs this one starts are cancelled along with it
+		CancellationScope scope{this->cancellation};
+		if (this->cancellation.is_valid()) {
+			should_abort = [should_abort, token = this->cancellation]() {
+				return token.is_cancelled() or should_abort();
+			};
+		}
+
 		try {
 			this->result = this->execute_and_get(should_abort);
 		} catch (JobAbortedException &e) {
+			// the continuations see that the job hasn't finished
+			this->run_continuations();
 			return true;
 		} catch (...) {
 			this->exception = std::current_exception();
 		}
 		this->finished.store(true);
+		this->run_continuations();
 		return false;
 	}
 
+	/**
+	 * Calls the function when the job has finished or was aborted, on the
+	 * thread that executed it. Calls it right away if that already happened.
+	 * Used by the job manager to start the jobs that continue this one.
+	 */
+	void add_continuation(std::function<void()> continuation) {
+		{
+			std::unique_lock<std::mutex> lock{this->continuation_lock};
+			if (not this->continued) {
+				this->continuations.push_back(std::move(continuation));
+				return;
+			}
+		}
+		continuation();
+	}
+
 	void execute_callback() override {
 		ENSURE(this->finished.load(), "trying to report a result of an unfinished job");
 		if (this->callback) {
@@ -89,6 +125,10 @@ public:
 		}
 	}
 
+	bool has_callback() const override {
+		return static_cast<bool>(this->callback);
+	}
+
 	size_t get_thread_id() override {
 		return this->thread_id;
 	}
@@ -99,6 +139,27 @@ protected:
 	 * must be passed to the calling function.
 	 */
 	virtual T execute_and_get(should_abort_t should_abort) = 0;
+
+private:
+	void run_continuations() {
+		std::vector<std::function<void()>> pending;
+		{
+			std::unique_lock<std::mutex> lock{this->continuation_lock};
+			this->continued = true;
+			std::swap(pending, this->continuations);
+		}
+		for (auto &continuation : pending) {
+			continuation();
+		}
+	}
+
+	std::mutex continuation_lock;
+
+	/** Whether the continuations have been run. */
+	bool continued;
+
+	/** Functions to run once the job has finished. */
+	std::vector<std::function<void()>> continuations;
 };
 
 }
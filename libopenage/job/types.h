@@ -1,8 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstddef>
 #include <functional>
+#include <string>
+#include <vector>
+
+#include "../util/alloc_tracking.h"
 
 namespace openage {
 namespace job {
@@ -48,5 +53,48 @@ using should_abort_t = std::function<bool()>;
 /** Type of a function that aborts a job. */
 using abort_t = std::function<void()>;
 
+/**
+ * Priority of a job. Idle workers always pick the jobs with the highest
+ * priority first, a running job is never interrupted though.
+ */
+enum class job_priority {
+	/** Jobs the game simulation waits for, like path searches. */
+	high,
+	/** Jobs without special requirements. */
+	normal,
+	/** Long running jobs like asset loading. */
+	low,
+};
+
+/** Number of different job priorities. */
+constexpr size_t job_priority_count = 3;
+
+/**
+ * Settings for the worker threads of a job manager.
+ */
+struct pool_options {
+	/** The workers are named "<name> <index>". */
+	std::string name = "job worker";
+
+	/** The cpus the workers run on, all of them if empty. */
+	std::vector<int> cpus;
+
+	/**
+	 * Pins each worker to a single one of the cpus, round robin,
+	 * instead of letting it move between all of them.
+	 */
+	bool pin = false;
+
+	/**
+	 * Bytes of scratch memory of each worker. It is allocated and
+	 * cleared by the worker's thread after it was placed on its cpus,
+	 * so the pages are local to the worker's numa node.
+	 */
+	size_t scratch_size = 0;
+
+	/** The heap allocations of the workers are counted for this tag. */
+	util::alloc_tag allocation_tag = util::alloc_tag::other;
+};
+
 }
 }
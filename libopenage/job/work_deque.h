@@ -0,0 +1,182 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace openage {
+namespace job {
+
+/**
+ * A lock-free work stealing deque after Chase and Lev.
+ *
+ * The owning thread pushes and pops items at the bottom end, any other
+ * thread may steal items from the top end concurrently. Thus the owner
+ * works on its most recent items, while thieves take the oldest ones.
+ *
+ * The buffer grows when it is full. Replaced buffers are kept until the
+ * deque is destroyed, as thieves may still read from them.
+ *
+ * @param T the item type, must be trivially copyable, e.g. a pointer.
+ */
+template<class T>
+class WorkDeque {
+	static_assert(std::is_trivially_copyable<T>::value,
+	              "work deque items must be trivially copyable");
+
+public:
+	WorkDeque(size_t initial_size=64)
+		:
+		top{0},
+		bottom{0} {
+
+		size_t size = 1;
+		while (size < initial_size) {
+			size <<= 1;
+		}
+
+		this->buffers.emplace_back(new buffer{size});
+		this->items.store(this->buffers.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkDeque(const WorkDeque &) = delete;
+	WorkDeque &operator =(const WorkDeque &) = delete;
+
+	/**
+	 * Adds an item at the bottom. May only be called by the owner.
+	 */
+	void push(T item) {
+		int64_t b = this->bottom.load(std::memory_order_relaxed);
+		int64_t t = this->top.load(std::memory_order_acquire);
+		buffer *a = this->items.load(std::memory_order_relaxed);
+
+		if (b - t >= static_cast<int64_t>(a->size)) {
+			a = this->grow(a, t, b);
+		}
+
+		a->put(b, item);
+		// publishes the item to thieves, which acquire the bottom index
+		this->bottom.store(b + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Removes the most recently pushed item. May only be called by the owner.
+	 *
+	 * @returns false if the deque was empty.
+	 */
+	bool pop(T &item) {
+		int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+		buffer *a = this->items.load(std::memory_order_relaxed);
+		this->bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = this->top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			// the deque was empty
+			this->bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = a->get(b);
+		if (t == b) {
+			// the last item, race against the thieves for it
+			bool won = this->top.compare_exchange_strong(
+				t, t + 1,
+				std::memory_order_seq_cst,
+				std::memory_order_relaxed
+			);
+			this->bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	/**
+	 * Removes the oldest item. May be called by any thread.
+	 *
+	 * @returns false if the deque was empty or another thread
+	 *          took the item first.
+	 */
+	bool steal(T &item) {
+		int64_t t = this->top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = this->bottom.load(std::memory_order_acquire);
+
+		if (t >= b) {
+			return false;
+		}
+
+		buffer *a = this->items.load(std::memory_order_acquire);
+		item = a->get(t);
+		return this->top.compare_exchange_strong(
+			t, t + 1,
+			std::memory_order_seq_cst,
+			std::memory_order_relaxed
+		);
+	}
+
+	/**
+	 * Whether the deque seems to be empty.
+	 * The result may already be outdated when it is returned.
+	 */
+	bool empty() const {
+		int64_t b = this->bottom.load(std::memory_order_relaxed);
+		int64_t t = this->top.load(std::memory_order_relaxed);
+		return t >= b;
+	}
+
+private:
+	/**
+	 * Circular item buffer with a size of a power of two.
+	 */
+	struct buffer {
+		buffer(size_t size)
+			:
+			size{size},
+			data{new std::atomic<T>[size]} {}
+
+		T get(int64_t index) const {
+			return this->data[index & (this->size - 1)].load(std::memory_order_relaxed);
+		}
+
+		void put(int64_t index, T item) {
+			this->data[index & (this->size - 1)].store(item, std::memory_order_relaxed);
+		}
+
+		const size_t size;
+		std::unique_ptr<std::atomic<T>[]> data;
+	};
+
+	/**
+	 * Replaces the buffer by one of twice the size.
+	 */
+	buffer *grow(buffer *old, int64_t t, int64_t b) {
+		std::unique_ptr<buffer> grown{new buffer{old->size * 2}};
+		for (int64_t i = t; i < b; i++) {
+			grown->put(i, old->get(i));
+		}
+
+		buffer *result = grown.get();
+		this->buffers.push_back(std::move(grown));
+		this->items.store(result, std::memory_order_release);
+		return result;
+	}
+
+	/** Index of the oldest item, advanced by thieves and the owner. */
+	std::atomic<int64_t> top;
+
+	/** Index after the newest item, only modified by the owner. */
+	std::atomic<int64_t> bottom;
+
+	/** The buffer currently in use. */
+	std::atomic<buffer *> items;
+
+	/** All buffers ever used, only accessed by the owner. */
+	std::vector<std::unique_ptr<buffer>> buffers;
+};
+
+}} // namespace openage::job
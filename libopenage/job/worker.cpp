@@ -1,5 +1,12 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
-
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
+
+#include "../config.h"
+#include "../log/log.h"
+#include "../util/metrics.h"
+#include "../util/strings.h"
+#include "../util/thread_id.h"
+#include "../util/timing.h"
+#include "../util/trace.h"
 #include "job_aborted_exception.h"
 #include "job_manager.h"
 #include "worker.h"
@@ -8,11 +15,34 @@
 namespace openage {
 namespace job {
 
+#if HAVE_THREAD_LOCAL_STORAGE
+namespace {
+
+/** The worker running on the current thread. */
+thread_local Worker *current_worker = nullptr;
+
+} // anonymous namespace
+#endif
+
 
-Worker::Worker(JobManager *manager)
+Worker::Worker(JobManager *manager, size_t index)
 	:
 	manager{manager},
-	is_running{false} {
+	index{index},
+	is_running{false},
+	group_job_count{0},
+	steal_index{index + 1} {
+}
+
+
+Worker::~Worker() {
+	// destroy the jobs that were never executed
+	for (auto &deque : this->local_jobs) {
+		job_box *box;
+		while (deque.pop(box)) {
+			delete box;
+		}
+	}
 }
 
 
@@ -23,23 +53,32 @@ void Worker::start() {
 
 
 void Worker::stop() {
-	std::unique_lock<std::mutex> lock{this->pending_jobs_mutex};
+	// the job manager wakes up the waiting workers afterwards
 	this->is_running = false;
-	lock.unlock();
-	this->notify();
 }
 
 
 void Worker::enqueue(std::shared_ptr<JobStateBase> job) {
-	std::unique_lock<std::mutex> lock{this->pending_jobs_mutex};
-	this->pending_jobs.push(job);
-	lock.unlock();
-	this->notify();
+	this->group_job_count++;
+	this->group_jobs.push(job);
+
+	// the job manager doesn't know which of the
+	// waiting workers is this one, so we wake them all.
+	this->manager->wake_workers(true);
 }
 
 
-void Worker::notify() {
-	this->jobs_available.notify_all();
+Worker *Worker::current() {
+	#if HAVE_THREAD_LOCAL_STORAGE
+	return current_worker;
+	#else
+	return nullptr;
+	#endif
+}
+
+
+std::vector<char> &Worker::get_scratch() {
+	return this->scratch;
 }
 
 
@@ -48,69 +87,148 @@ void Worker::join() {
 }
 
 
+void Worker::push_local(std::shared_ptr<JobStateBase> job, job_priority priority) {
+	this->local_jobs[static_cast<size_t>(priority)].push(new job_box{std::move(job)});
+}
+
+
+bool Worker::steal(job_priority priority, std::shared_ptr<JobStateBase> &job) {
+	job_box *box;
+	if (not this->local_jobs[static_cast<size_t>(priority)].steal(box)) {
+		return false;
+	}
+
+	job = std::move(*box);
+	delete box;
+	return true;
+}
+
+
+bool Worker::find_job(std::shared_ptr<JobStateBase> &job) {
+	if (this->find_job(job_priority::high, job)) {
+		return true;
+	}
+
+	if (this->group_job_count.load() > 0) {
+		size_t count = this->group_jobs.consume(1, [&job](std::shared_ptr<JobStateBase> &&group_job) {
+			job = std::move(group_job);
+		});
+
+		if (count > 0) {
+			this->group_job_count--;
+			return true;
+		}
+	}
+
+	return (this->find_job(job_priority::normal, job) or
+	        this->find_job(job_priority::low, job));
+}
+
+
+bool Worker::find_job(job_priority priority, std::shared_ptr<JobStateBase> &job) {
+	// no need to search if nothing is queued at all
+	if (this->manager->queued_jobs.load() == 0) {
+		return false;
+	}
+
+	// first our own jobs, the most recently added one is still hot in the cache
+	job_box *box;
+	if (this->local_jobs[static_cast<size_t>(priority)].pop(box)) {
+		job = std::move(*box);
+		delete box;
+		this->manager->queued_jobs--;
+		return true;
+	}
+
+	// then the newly enqueued ones
+	if (this->manager->take_injected(this, priority, job)) {
+		return true;
+	}
+
+	// finally steal the oldest job of another worker
+	size_t count = this->manager->workers.size();
+	for (size_t i = 0; i < count; i++) {
+		size_t victim = (this->steal_index + i) % count;
+		if (victim == this->index) {
+			continue;
+		}
+
+		if (this->manager->workers[victim]->steal(priority, job)) {
+			this->steal_index = victim;
+			this->manager->queued_jobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 void Worker::execute_job(std::shared_ptr<JobStateBase> &job) {
+	TRACE_SCOPE("job");
+
+	static util::MetricCounter &executed = util::metrics().counter("jobs.executed");
+	static util::MetricHistogram &run_us = util::metrics().histogram("jobs.run_us");
+	static util::MetricCounter &cancelled = util::metrics().counter("jobs.cancelled");
+
 	auto should_abort = [this]() {
 		return not this->is_running;
 	};
 
+	time_nsec_t start = timing::get_monotonic_time();
 	bool aborted = job->execute(should_abort);
+	run_us.add((timing::get_monotonic_time() - start) / 1000);
+	executed.add();
+
 	// if the job was not aborted, tell the job manager, that the job has
 	// finished
 	if (not aborted) {
 		this->manager->finish_job(job);
 	}
+	else if (job->cancellation.is_cancelled()) {
+		cancelled.add();
+	}
 }
 
 
 void Worker::process() {
-	// as long as this worker thread is running repeat all steps
-	while (true) {
-		// lock the local thread queue
-		std::unique_lock<std::mutex> lock{this->pending_jobs_mutex};
-
-		// if this thread shall not run any longer, exit the loop
-		if (not this->is_running) {
-			return;
+	#if HAVE_THREAD_LOCAL_STORAGE
+	current_worker = this;
+	#endif
+
+	const pool_options &options = this->manager->options;
+	std::string name = util::sformat("%s %zu", options.name.c_str(), this->index);
+	util::set_current_thread_name(name);
+	util::set_trace_thread_name(name);
+	util::set_thread_alloc_tag(options.allocation_tag);
+
+	if (not options.cpus.empty()) {
+		std::vector<int> cpus = options.cpus;
+		if (options.pin) {
+			cpus = {options.cpus[this->index % options.cpus.size()]};
 		}
-
-		// as long as there are no jobs from the local queue or the job manager
-		while (this->pending_jobs.empty() and not this->manager->has_job()) {
-			// the thread should wait
-			this->jobs_available.wait(lock);
-
-			// when the thread is notified, first check if the thread should be
-			// stopped
-			if (not this->is_running) {
-				return;
-			}
+		if (not util::set_current_thread_affinity(cpus)) {
+			log::log(WARN << "Could not set the cpus of " << name);
 		}
+	}
+
+	// first touched by this thread, after it has moved to its cpus
+	this->scratch.assign(options.scratch_size, 0);
 
-		// check if there are jobs in the local queue
-		if (not this->pending_jobs.empty()) {
-			// fetch the job
-			auto job = this->pending_jobs.front();
-			this->pending_jobs.pop();
-			// release the local queue lock
-			lock.unlock();
-			// and execute the job
+	// as long as this worker thread is running repeat all steps
+	while (this->is_running) {
+		std::shared_ptr<JobStateBase> job;
+		if (this->find_job(job)) {
 			this->execute_job(job);
-		} else {
-			// otherwise just unlock the local queue
-			lock.unlock();
+			continue;
 		}
 
-		// after possibly executing a job from the local queue, check again if
-		// the thread should still continue running
-		if (not this->is_running) {
-			return;
-		}
+		// queued jobs may be invisible for a moment while other threads
+		// add or take them, give these threads the chance to finish.
+		std::this_thread::yield();
 
-		// now try to fetch a job from the job manager
-		auto manager_job = this->manager->fetch_job();
-		if (manager_job.get() != nullptr) {
-			// and execute it
-			this->execute_job(manager_job);
-		}
+		// sleep until new jobs arrive
+		this->manager->wait_for_jobs(this);
 	}
 }
 
@@ -1,14 +1,17 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <condition_variable>
 #include <memory>
-#include <queue>
 #include <thread>
+#include <vector>
 
+#include "job_queue.h"
 #include "job_state_base.h"
+#include "types.h"
+#include "work_deque.h"
 
 namespace openage {
 namespace job {
@@ -18,33 +21,55 @@ class JobManager;
 /**
  * A worker encapsulates the execution of multiple jobs in a single background
  * thread.
+ *
+ * Each worker keeps a deque of jobs per priority. It works on its own jobs
+ * first and steals jobs from the other workers when it runs out of them.
+ * Jobs of a job group are kept in a separate queue and are never stolen.
  */
 class Worker {
 private:
+	/**
+	 * Jobs are owned by the deques through heap allocated pointers,
+	 * as deque items have to be trivially copyable.
+	 */
+	using job_box = std::shared_ptr<JobStateBase>;
+
 	/** The parent job manager, this worker is fetching jobs from. */
 	JobManager *manager;
 
+	/** The index of this worker in the job manager. */
+	size_t index;
+
 	/** Whether this worker thread is still running. */
-	bool is_running;
+	std::atomic_bool is_running;
 
 	/** The executing thread. */
 	std::unique_ptr<std::thread> executor;
 
-	/** A mutex to synchronize the internal pending jobs queue. */
-	std::mutex pending_jobs_mutex;
+	/**
+	 * Jobs this worker took from the job manager, for each priority.
+	 * Other workers may steal them.
+	 */
+	std::array<WorkDeque<job_box *>, job_priority_count> local_jobs;
+
+	/** Jobs of the job groups bound to this worker. */
+	JobQueue group_jobs;
 
-	/** A queue of jobs that are to be executed. */
-	std::queue<std::shared_ptr<JobStateBase>> pending_jobs;
+	/** The number of jobs in the group job queue. */
+	std::atomic<size_t> group_job_count;
 
-	/** A condition variable to wait for new jobs. */
-	std::condition_variable jobs_available;
+	/** The index of the worker to steal from next. */
+	size_t steal_index;
+
+	/** Memory for the jobs run by this worker, see pool_options::scratch_size. */
+	std::vector<char> scratch;
 
 public:
 	/** Constructs a new worker with the parent job manager. */
-	Worker(JobManager *manager);
+	Worker(JobManager *manager, size_t index);
 
-	/** Default destructor. */
-	~Worker() = default;
+	/** Destroys all jobs that have not been executed. */
+	~Worker();
 
 	/** Starts this worker. */
 	void start();
@@ -55,16 +80,47 @@ public:
 	/** Joins the internal executing thread. */
 	void join();
 
-	/** Adds the given job to the internal pending job queue. */
+	/**
+	 * Adds the given job to the job group queue. It will only be executed
+	 * by this worker.
+	 */
 	void enqueue(std::shared_ptr<JobStateBase> job);
 
 	/**
-	 * Notifies this worker, that new jobs are available. This method is
-	 * although called from the parent job manager.
+	 * The worker executing the current thread,
+	 * nullptr if called from another thread.
+	 */
+	static Worker *current();
+
+	/**
+	 * Scratch memory of this worker, may only be used by the jobs it runs.
+	 * Empty unless the job manager was given a scratch size.
 	 */
-	void notify();
+	std::vector<char> &get_scratch();
 
 private:
+	/**
+	 * Adds the given job to the local deque of its priority. May only be
+	 * called from this worker's thread.
+	 */
+	void push_local(std::shared_ptr<JobStateBase> job, job_priority priority);
+
+	/**
+	 * Tries to steal a job of the given priority from this worker.
+	 * May be called from any thread.
+	 */
+	bool steal(job_priority priority, std::shared_ptr<JobStateBase> &job);
+
+	/**
+	 * Looks for the next job to execute: for each priority, in this worker's
+	 * deque, at the job manager and at the other workers. Group jobs are
+	 * searched after the high priority jobs.
+	 */
+	bool find_job(std::shared_ptr<JobStateBase> &job);
+
+	/** Finds a job of the given priority. */
+	bool find_job(job_priority priority, std::shared_ptr<JobStateBase> &job);
+
 	/**
 	 * Executes the given job and tells the parent job manager, when it has
 	 * finished.
@@ -72,11 +128,16 @@ private:
 	void execute_job(std::shared_ptr<JobStateBase> &job);
 
 	/**
-	 * Fetches pending jobs from the parent job manager and from the internal
-	 * pending job queue and executes them. If no jobs are available the
-	 * internal execution thread is wait using a condition variable.
+	 * Fetches pending jobs and executes them. If no jobs are available the
+	 * internal execution thread waits at the job manager.
 	 */
 	void process();
+
+	/**
+	 * The job manager distributes jobs and wakes up the workers, and thus
+	 * must access the private members.
+	 */
+	friend class JobManager;
 };
 
 }
@@ -0,0 +1,110 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "binary_logsink.h"
+
+#include "message.h"
+
+namespace openage {
+namespace log {
+
+
+namespace {
+
+template<typename T>
+void append(std::string &out, T value) {
+	auto bits = static_cast<uint64_t>(value);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+	}
+}
+
+
+void append_bytes(std::string &out, const char *data, size_t size) {
+	append(out, static_cast<uint32_t>(size));
+	out.append(data, size);
+}
+
+} // anonymous namespace
+
+
+constexpr uint32_t BinaryFileSink::format_version;
+
+
+BinaryFileSink::BinaryFileSink(const char *filename, bool append)
+	:
+	outfile{filename, std::ios_base::out | std::ios_base::binary | (append ? std::ios_base::app : std::ios_base::trunc)} {
+
+	// appended logs get their own header, the string ids start again
+	this->buffer.append("OALB");
+	log::append(this->buffer, format_version);
+	this->outfile.write(this->buffer.data(), this->buffer.size());
+	this->buffer.clear();
+}
+
+
+BinaryFileSink::~BinaryFileSink() {
+	this->unregister();
+}
+
+
+void BinaryFileSink::output_log_message(const log_record &record) {
+	const message &msg = record.msg;
+
+	uint32_t level_name = this->constant_id(msg.lvl->name);
+	uint32_t source_name = this->string_id(record.source_name);
+	uint32_t filename = this->constant_id(msg.filename);
+	uint32_t functionname = this->constant_id(msg.functionname);
+
+	// strings are written by the id lookups before
+	std::string &out = this->buffer;
+	append(out, binlog_kind::message);
+	append(out, static_cast<int32_t>(msg.lvl->priority));
+	append(out, level_name);
+	append(out, source_name);
+	append(out, filename);
+	append(out, static_cast<uint32_t>(msg.lineno));
+	append(out, functionname);
+	append(out, static_cast<uint64_t>(msg.thread_id));
+	append(out, static_cast<int64_t>(msg.timestamp));
+	append_bytes(out, msg.text.data(), msg.text.size());
+
+	this->outfile.write(out.data(), out.size());
+	out.clear();
+}
+
+
+void BinaryFileSink::flush() {
+	this->outfile.flush();
+}
+
+
+uint32_t BinaryFileSink::string_id(const std::string &str) {
+	auto it = this->strings.find(str);
+	if (it != this->strings.end()) {
+		return it->second;
+	}
+
+	auto id = static_cast<uint32_t>(this->strings.size());
+	this->strings.emplace(str, id);
+
+	append(this->buffer, binlog_kind::string);
+	append(this->buffer, id);
+	append_bytes(this->buffer, str.data(), str.size());
+
+	return id;
+}
+
+
+uint32_t BinaryFileSink::constant_id(const char *str) {
+	auto it = this->constants.find(str);
+	if (it != this->constants.end()) {
+		return it->second;
+	}
+
+	uint32_t id = this->string_id(str == nullptr ? "" : str);
+	this->constants.emplace(str, id);
+	return id;
+}
+
+
+}} // namespace openage::log
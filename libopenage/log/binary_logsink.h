@@ -0,0 +1,76 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "logsink.h"
+
+namespace openage {
+namespace log {
+
+
+/**
+ * kinds of the records in a binary log file.
+ */
+enum class binlog_kind : uint8_t {
+	string = 0,
+	message = 1,
+};
+
+
+/**
+ * Writes the messages in a compact binary format,
+ * read by openage/log/binlog.py.
+ *
+ * The file starts with the magic "OALB" and the uint32 format version,
+ * followed by records that start with their uint8 kind.
+ * All values are little endian.
+ *
+ * binlog_kind::string: uint32 id, uint32 size, the bytes.
+ *     Defines a string the messages refer to by id.
+ *     File and function names, level and source names are written once.
+ *
+ * binlog_kind::message: int32 level priority, uint32 level name,
+ *     uint32 source name, uint32 filename, uint32 lineno,
+ *     uint32 function name, uint64 thread id, int64 timestamp,
+ *     uint32 text size, the text.
+ */
+class BinaryFileSink : public LogSink {
+public:
+	BinaryFileSink(const char *filename, bool append);
+	~BinaryFileSink();
+
+	static constexpr uint32_t format_version = 1;
+
+private:
+	void output_log_message(const log_record &record) override;
+	void flush() override;
+
+	/**
+	 * id of the string, which is written when it is first seen.
+	 */
+	uint32_t string_id(const std::string &str);
+
+	/**
+	 * same for strings that exist as long as the program,
+	 * like message file and function names.
+	 */
+	uint32_t constant_id(const char *str);
+
+	std::ofstream outfile;
+
+	/**
+	 * the next record is assembled here.
+	 */
+	std::string buffer;
+
+	std::unordered_map<std::string, uint32_t> strings;
+	std::unordered_map<const char *, uint32_t> constants;
+};
+
+
+}} // namespace openage::log
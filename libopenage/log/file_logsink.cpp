@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "file_logsink.h"
 
@@ -6,7 +6,6 @@
 #include <iomanip>
 
 #include "message.h"
-#include "logsource.h"
 
 namespace openage {
 namespace log {
@@ -17,14 +16,26 @@ FileSink::FileSink(const char *filename, bool append)
 	outfile{filename, std::ios_base::out | append ? std::ios_base::app : std::ios_base::trunc} {}
 
 
-void FileSink::output_log_message(const message &msg, LogSource *source) {
+FileSink::~FileSink() {
+	this->unregister();
+}
+
+
+void FileSink::output_log_message(const log_record &record) {
+	const message &msg = record.msg;
+
 	this->outfile << msg.lvl->name << "|";
-	this->outfile << source->logsource_name() << "|";
+	this->outfile << record.source_name << "|";
 	this->outfile << msg.filename << ":" << msg.lineno << "|";
 	this->outfile << msg.functionname << "|";
 	this->outfile << msg.thread_id << "|";
 	this->outfile << std::setprecision(7) << std::fixed << msg.timestamp / 1e9 << "|";
-	this->outfile << msg.text << std::endl;
+	this->outfile << msg.text << "\n";
+}
+
+
+void FileSink::flush() {
+	this->outfile.flush();
 }
 
 }} // namespace openage::log
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -13,9 +13,11 @@ namespace log {
 class FileSink : public LogSink {
 public:
 	FileSink(const char *filename, bool append);
+	~FileSink();
 
 private:
-	virtual void output_log_message(const message &msg, LogSource *source) override;
+	virtual void output_log_message(const log_record &record) override;
+	virtual void flush() override;
 
 	std::ofstream outfile;
 };
@@ -18,6 +18,11 @@ class message;
  */
 void log(const message &msg);
 
+/**
+ * Messages of compiled-out levels are not logged.
+ */
+inline void log(const DisabledMessageBuilder &) {}
+
 
 /**
  * Sets the log level of the global stdout sink.
@@ -0,0 +1,350 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "logqueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+#include "../util/alloc_tracking.h"
+#include "../util/compiler.h"
+#include "../util/metrics.h"
+#include "named_logsource.h"
+
+namespace openage {
+namespace log {
+
+
+LogQueue::LogQueue(size_t capacity)
+	:
+	records{capacity},
+	dropped{0} {}
+
+
+void LogQueue::push(log_record &&record) {
+	while (not this->records.try_push(std::move(record))) {
+		log_record oldest;
+		if (this->records.try_pop(oldest)) {
+			this->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		else {
+			// the writer is still moving out the oldest record
+			std::this_thread::yield();
+		}
+	}
+}
+
+
+bool LogQueue::pop(log_record &record) {
+	return this->records.try_pop(record);
+}
+
+
+size_t LogQueue::take_dropped() {
+	return this->dropped.exchange(0, std::memory_order_relaxed);
+}
+
+
+namespace {
+
+/**
+ * records a thread may queue until the oldest are dropped.
+ */
+constexpr size_t queue_capacity = 1024;
+
+/**
+ * the writer wakes up this often to output the queued records.
+ */
+constexpr std::chrono::milliseconds write_interval{10};
+
+
+/**
+ * A thread's queue, kept by the writer until it is empty
+ * after the thread has exited.
+ */
+struct thread_queue {
+	thread_queue()
+		:
+		queue{queue_capacity},
+		orphaned{false},
+		pushed{0} {}
+
+	LogQueue queue;
+	std::atomic<bool> orphaned;
+
+	// only used by the thread
+	size_t pushed;
+};
+
+
+/**
+ * Owns the queues, and the thread that writes them to the sinks.
+ *
+ * It is never deleted, as threads may log while static objects are
+ * destroyed. At exit, the thread is stopped and later records are
+ * written by the logging thread.
+ */
+class LogWriter {
+public:
+	static LogWriter &get() {
+		static LogWriter *writer = new LogWriter;
+		return *writer;
+	}
+
+	/**
+	 * the queue of the calling thread,
+	 * nullptr if the thread's queue is already destroyed.
+	 */
+	thread_queue *own_queue() {
+		// thread-local objects destroyed before this may still log
+		thread_local bool exited = false;
+
+		struct holder {
+			~holder() {
+				if (this->queue) {
+					this->queue->orphaned = true;
+				}
+				exited = true;
+			}
+			std::shared_ptr<thread_queue> queue;
+		};
+		thread_local holder own;
+
+		if (unlikely(exited)) {
+			return nullptr;
+		}
+
+		if (unlikely(not own.queue)) {
+			own.queue = std::make_shared<thread_queue>();
+
+			std::lock_guard<std::mutex> lock{this->queues_mutex};
+			this->queues.push_back(own.queue);
+		}
+
+		return own.queue.get();
+	}
+
+	void enqueue(log_record &&record) {
+		thread_queue *queue = nullptr;
+		if (not this->stopped.load(std::memory_order_acquire)) {
+			queue = this->own_queue();
+		}
+
+		// without writer thread or queue, the caller writes
+		if (queue == nullptr) {
+			std::vector<log_record> records;
+			records.push_back(std::move(record));
+			dispatch(records);
+			return;
+		}
+
+		queue->queue.push(std::move(record));
+
+		if (unlikely(not this->running.load(std::memory_order_acquire))) {
+			this->start();
+		}
+
+		// a busy thread wakes the writer before its queue is full
+		if (unlikely(++queue->pushed % (queue_capacity / 2) == 0)) {
+			this->wakeup.notify_one();
+		}
+	}
+
+	/**
+	 * output all queued records, by the calling thread.
+	 */
+	void write() {
+		std::lock_guard<std::mutex> lock{this->write_mutex};
+
+		size_t dropped = 0;
+		{
+			std::lock_guard<std::mutex> queues_lock{this->queues_mutex};
+
+			for (auto it = this->queues.begin(); it != this->queues.end();) {
+				thread_queue &queue = **it;
+
+				// checked before popping, the thread may log until it's flagged
+				bool orphaned = queue.orphaned;
+
+				log_record record;
+				while (queue.queue.pop(record)) {
+					this->batch.push_back(std::move(record));
+				}
+				dropped += queue.queue.take_dropped();
+
+				if (orphaned) {
+					it = this->queues.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+		}
+
+		if (dropped > 0) {
+			static util::MetricCounter &dropped_metric = util::metrics().counter("log.dropped");
+			dropped_metric.add(dropped);
+
+			log_record record;
+			record.msg = MSG(warn) << "Log queues overflowed, dropped " << dropped << " messages";
+			record.source_name = general_source().logsource_name();
+			record.source = &general_source();
+			this->batch.push_back(std::move(record));
+		}
+
+		if (this->batch.empty()) {
+			return;
+		}
+
+		// the threads' records are interleaved as they were logged
+		std::stable_sort(this->batch.begin(), this->batch.end(), [](const log_record &a, const log_record &b) {
+			return a.msg.timestamp < b.msg.timestamp;
+		});
+
+		dispatch(this->batch);
+		this->batch.clear();
+	}
+
+private:
+	LogWriter()
+		:
+		running{false},
+		stopped{false},
+		stop_requested{false},
+		thread{nullptr} {
+
+		std::atexit([] { LogWriter::get().stop(); });
+
+		// a forked child has no writer thread
+		pthread_atfork(
+			[] { LogWriter::get().fork_prepare(); },
+			[] { LogWriter::get().fork_parent(); },
+			[] { LogWriter::get().fork_child(); }
+		);
+	}
+
+	void start() {
+		std::lock_guard<std::mutex> lock{this->thread_mutex};
+		if (this->running or this->stopped) {
+			return;
+		}
+
+		this->stop_requested = false;
+		this->thread = new std::thread{[this] { this->run(); }};
+		this->running = true;
+	}
+
+	void run() {
+		util::set_thread_alloc_tag(util::alloc_tag::logging);
+
+		std::unique_lock<std::mutex> lock{this->thread_mutex};
+		while (not this->stop_requested) {
+			this->wakeup.wait_for(lock, write_interval);
+
+			lock.unlock();
+			this->write();
+			lock.lock();
+		}
+	}
+
+	/**
+	 * join the thread and write the remaining records.
+	 */
+	void stop() {
+		std::thread *thread;
+		{
+			std::lock_guard<std::mutex> lock{this->thread_mutex};
+			this->stop_requested = true;
+			this->stopped = true;
+			thread = this->thread;
+			this->thread = nullptr;
+		}
+		this->wakeup.notify_all();
+
+		if (thread != nullptr) {
+			thread->join();
+			delete thread;
+		}
+		this->running = false;
+
+		this->write();
+	}
+
+	void fork_prepare() {
+		this->thread_mutex.lock();
+		this->write_mutex.lock();
+		this->queues_mutex.lock();
+	}
+
+	void fork_parent() {
+		this->queues_mutex.unlock();
+		this->write_mutex.unlock();
+		this->thread_mutex.unlock();
+	}
+
+	void fork_child() {
+		// the thread doesn't exist in the child, it's started again
+		this->thread = nullptr;
+		this->running = false;
+
+		this->queues_mutex.unlock();
+		this->write_mutex.unlock();
+		this->thread_mutex.unlock();
+	}
+
+	std::atomic<bool> running;
+	std::atomic<bool> stopped;
+
+	// protected by thread_mutex
+	bool stop_requested;
+	std::thread *thread;
+	std::mutex thread_mutex;
+	std::condition_variable wakeup;
+
+	// one thread at a time writes
+	std::mutex write_mutex;
+	std::vector<log_record> batch;
+
+	std::mutex queues_mutex;
+	std::vector<std::shared_ptr<thread_queue>> queues;
+};
+
+} // anonymous namespace
+
+
+void enqueue(log_record &&record) {
+	LogWriter::get().enqueue(std::move(record));
+}
+
+
+void flush() {
+	LogWriter::get().write();
+}
+
+
+void dispatch(const std::vector<log_record> &records) {
+	std::lock_guard<std::mutex> lock(sink_list_mutex);
+
+	for (LogSink *sink : sink_list()) {
+		bool written = false;
+
+		for (auto &record : records) {
+			// TODO: more sophisticated filtering (iptables-chains-like)
+			if (record.msg.lvl->priority >= sink->get_loglevel()->priority) {
+				sink->output_log_message(record);
+				written = true;
+			}
+		}
+
+		if (written) {
+			sink->flush();
+		}
+	}
+}
+
+
+}} // namespace openage::log
@@ -0,0 +1,73 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "../datastructure/lockfree_queue.h"
+#include "logsink.h"
+
+namespace openage {
+namespace log {
+
+
+/**
+ * Bounded queue of the log records of one thread.
+ *
+ * The thread pushes its records without taking a lock, the log writer
+ * thread pops them. When the queue is full, the pushing thread drops
+ * the oldest record and counts it: it pops the record like the writer,
+ * so the queue has two consumers.
+ */
+class LogQueue {
+public:
+	explicit LogQueue(size_t capacity);
+
+	/**
+	 * store the record, drop the oldest one if the queue is full.
+	 * Only called by one thread at a time.
+	 */
+	void push(log_record &&record);
+
+	/**
+	 * take the oldest record, false if the queue is empty.
+	 */
+	bool pop(log_record &record);
+
+	/**
+	 * number of dropped records since the last call.
+	 */
+	size_t take_dropped();
+
+private:
+	datastructure::MPMCQueue<log_record> records;
+	std::atomic<size_t> dropped;
+};
+
+
+/**
+ * Queue the record in the calling thread's LogQueue.
+ * The log writer thread hands it to the sinks.
+ */
+void enqueue(log_record &&record);
+
+
+/**
+ * Output all queued records now, from the calling thread.
+ *
+ * Used for error messages, which must be shown before a crash,
+ * and by sinks that are about to be removed.
+ */
+void flush();
+
+
+/**
+ * Hand the records to all sinks that accept them, and flush the sinks.
+ * Invoked by the log writer.
+ */
+void dispatch(const std::vector<log_record> &records);
+
+
+}} // namespace openage::log
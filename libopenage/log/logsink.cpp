@@ -1,21 +1,92 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "logsink.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+#include "logqueue.h"
+
 
 namespace openage {
 namespace log {
 
 
-LogSink::LogSink() {
+namespace {
+
+/**
+ * constant-initialized, as messages may be logged during static initialization.
+ */
+constexpr int accept_all = std::numeric_limits<int>::min();
+
+std::atomic<int> lowest_priority{accept_all};
+
+
+/**
+ * recompute the lowest accepted priority, sink_list_mutex must be held.
+ */
+void update_lowest_priority() {
+	int lowest = lvl::MAX->priority;
+	for (LogSink *sink : sink_list()) {
+		lowest = std::min(lowest, sink->get_loglevel()->priority);
+	}
+
+	// without sinks, the first message will create the stdout sink
+	if (sink_list().empty()) {
+		lowest = accept_all;
+	}
+
+	lowest_priority.store(lowest, std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+
+LogSink::LogSink()
+	:
+	registered{true},
+	loglevel{lvl::dbg} {
+
 	std::lock_guard<std::mutex> lock(sink_list_mutex);
 	sink_list().push_back(this);
-
-	this->loglevel = lvl::dbg;
+	update_lowest_priority();
 }
 
 
 LogSink::~LogSink() {
+	if (this->registered) {
+		this->remove_from_sink_list();
+	}
+}
+
+
+void LogSink::set_loglevel(level lvl) {
+	std::lock_guard<std::mutex> lock(sink_list_mutex);
+	this->loglevel = lvl;
+	update_lowest_priority();
+}
+
+
+level LogSink::get_loglevel() const {
+	return this->loglevel;
+}
+
+
+void LogSink::unregister() {
+	if (not this->registered) {
+		return;
+	}
+
+	// the queued messages may still be for this sink
+	log::flush();
+
+	this->remove_from_sink_list();
+	this->registered = false;
+}
+
+
+void LogSink::remove_from_sink_list() {
 	// TODO: de-constructing log_sink_list takes O(n^2) time...
 	// while this is utterly insignificant, building a map upon
 	// start-of-deinitialization might be prettier.
@@ -30,6 +101,7 @@ LogSink::~LogSink() {
 			// Delete the last element on the vector.
 			sinks.pop_back();
 
+			update_lowest_priority();
 			return;
 		}
 	}
@@ -48,4 +120,9 @@ std::vector<LogSink *> &sink_list() {
 }
 
 
+int lowest_accepted_priority() {
+	return lowest_priority.load(std::memory_order_relaxed);
+}
+
+
 }} // namespace openage::log
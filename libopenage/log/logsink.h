@@ -1,15 +1,36 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <vector>
 #include <mutex>
+#include <string>
 
 #include "level.h"
+#include "message.h"
 
 namespace openage {
 namespace log {
 
+class LogSource;
+
+
+/**
+ * A message as it is passed to the sinks.
+ *
+ * The sinks are invoked by the log writer thread, when the source may
+ * have been deleted already, so its name is stored with the message.
+ */
+struct log_record {
+	message msg;
+	std::string source_name;
+
+	/**
+	 * the source the message was logged by, for comparison only.
+	 */
+	const LogSource *source;
+};
+
 
 /**
  * Abstract base for classes that - in one way or an other - print log messages.
@@ -22,23 +43,49 @@ public:
 	LogSink();
 	virtual ~LogSink();
 
+	/**
+	 * Messages below this level are not passed to the sink.
+	 */
+	void set_loglevel(level lvl);
+	level get_loglevel() const;
+
+protected:
+	/**
+	 * Writes the queued messages, and removes the sink from the sink list.
+	 *
+	 * Derived sinks call it first in their destructor, as the log writer
+	 * thread may invoke them until then.
+	 */
+	void unregister();
+
+private:
+	void remove_from_sink_list();
+
+	bool registered;
 
 	/**
 	 * TODO: Add iptables-like chains that decide whether a message will be
 	 *       logged, depending on msg.info, logger id, thread id, etc.
 	 *       This member variable is only a make-shift solution with
 	 *       obvious limitations.
+	 *
+	 * Protected by sink_list_mutex.
 	 */
 	level loglevel;
 
-private:
+
+	/**
+	 * Called by the log writer thread for each accepted message.
+	 */
+	virtual void output_log_message(const log_record &record) = 0;
+
 	/**
-	 * Called internally by put_log_message if a message is accepted
+	 * Called after a batch of messages was output.
 	 */
-	virtual void output_log_message(const struct message &msg, class LogSource *source) = 0;
+	virtual void flush() {}
 
 
-	friend class LogSource;
+	friend void dispatch(const std::vector<log_record> &records);
 };
 
 
@@ -57,4 +104,13 @@ extern std::mutex sink_list_mutex;
 std::vector<LogSink *> &sink_list();
 
 
+/**
+ * Priority of the lowest level that any sink accepts.
+ * Messages below it are discarded before they are formatted.
+ *
+ * Until the first sink is created, all messages are accepted.
+ */
+int lowest_accepted_priority();
+
+
 }} // namespace openage::log
@@ -1,9 +1,11 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "logsource.h"
 
+#include "../util/alloc_tracking.h"
 #include "../util/compiler.h"
 
+#include "logqueue.h"
 #include "logsink.h"
 #include "stdout_logsink.h"
 
@@ -21,13 +23,19 @@ void LogSource::log(const message &msg) {
 	// (and thus at least one sink exists).
 	global_stdoutsink();
 
-	std::lock_guard<std::mutex> lock(sink_list_mutex);
+	// no sink would accept it
+	if (msg.lvl->priority < lowest_accepted_priority()) {
+		return;
+	}
+
+	util::AllocScope alloc_scope{util::alloc_tag::logging};
+
+	// the sinks are invoked by the log writer thread
+	enqueue(log_record{msg, this->logsource_name(), this});
 
-	for (LogSink *sink : sink_list()) {
-		// TODO: more sophisticated filtering (iptables-chains-like)
-		if (msg.lvl->priority >= sink->loglevel->priority) {
-			sink->output_log_message(msg, this);
-		}
+	// errors are shown before a possible crash
+	if (unlikely(msg.lvl->priority >= lvl::err->priority)) {
+		flush();
 	}
 }
 
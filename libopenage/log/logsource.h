@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -33,9 +33,17 @@ public:
 
 	/**
 	 * Logs a message (get one via MSG(level)).
+	 *
+	 * The message is queued, and written by the log writer thread.
+	 * Messages of level err and above are written immediately.
 	 */
 	void log(const message &msg);
 
+	/**
+	 * Messages of compiled-out levels are not logged.
+	 */
+	void log(const DisabledMessageBuilder &) {}
+
 	/**
 	 * Initialized during the LogSource constructor,
 	 * guaranteed to be unique.
@@ -1,7 +1,9 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "message.h"
 
+#include <algorithm>
+#include <cstdarg>
 #include <mutex>
 #include <unordered_set>
 
@@ -9,6 +11,7 @@
 #include "../util/compiler.h"
 #include "../util/thread_id.h"
 #include "../util/strings.h"
+#include "logsink.h"
 
 namespace openage {
 namespace log {
@@ -44,8 +47,44 @@ MessageBuilder::MessageBuilder(const char *filename,
 		this->msg.functionname = functionname;
 		this->msg.lvl = lvl;
 
-		this->msg.init();
+		int lowest = std::min(lowest_accepted_priority(), lvl::warn->priority);
+		this->muted = (lvl->priority < lowest);
+
+		if (not this->muted) {
+			this->msg.init();
+		}
+		else {
+			this->msg.thread_id = 0;
+			this->msg.timestamp = 0;
+		}
+	}
+
+
+MessageBuilder &MessageBuilder::operator <<(std::ios &(*x)(std::ios &)) {
+	if (not this->muted) {
+		this->StringFormatter<MessageBuilder>::operator <<(x);
 	}
+	return *this;
+}
+
+
+MessageBuilder &MessageBuilder::operator <<(std::ostream &(*x)(std::ostream &)) {
+	if (not this->muted) {
+		this->StringFormatter<MessageBuilder>::operator <<(x);
+	}
+	return *this;
+}
+
+
+MessageBuilder &MessageBuilder::fmt(const char *fmt, ...) {
+	if (not this->muted) {
+		va_list ap;
+		va_start(ap, fmt);
+		util::vsformat(fmt, ap, this->msg.text);
+		va_end(ap);
+	}
+	return *this;
+}
 
 
 std::ostream &operator <<(std::ostream &os, const message &msg) {
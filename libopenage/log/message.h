@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -120,6 +120,20 @@ public:
 	MessageBuilder(const char *filename, unsigned lineno, const char *functionname,
 	               level lvl=lvl::info);
 
+	// the input of muted messages is not formatted
+	template<typename T>
+	MessageBuilder &operator <<(const T &t) {
+		if (not this->muted) {
+			this->StringFormatter<MessageBuilder>::operator <<(t);
+		}
+		return *this;
+	}
+
+	MessageBuilder &operator <<(std::ios &(*x)(std::ios &));
+	MessageBuilder &operator <<(std::ostream &(*x)(std::ostream &));
+
+	MessageBuilder &fmt(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
 	// auto-convert to message
 	inline operator const message &() const {
 		return this->msg;
@@ -132,20 +146,99 @@ public:
 private:
 	message msg;
 
+	/**
+	 * No sink accepts the level, so the message is discarded.
+	 * Messages of exceptions have level warn or above, which is never muted.
+	 */
+	bool muted;
+
 	friend error::Error;
 	friend class LogSource;
 };
 
 
+/**
+ * Stands in for the MessageBuilder of levels that are compiled out
+ * (see WITH_DEBUG_LOG). Its input is discarded, and logging it does nothing.
+ */
+class DisabledMessageBuilder {
+public:
+	DisabledMessageBuilder(const char *filename, unsigned lineno, const char *functionname,
+	                       level lvl) {
+		this->msg.filename = filename;
+		this->msg.lineno = lineno;
+		this->msg.functionname = functionname;
+		this->msg.lvl = lvl;
+		this->msg.thread_id = 0;
+		this->msg.timestamp = 0;
+	}
+
+	template<typename T>
+	DisabledMessageBuilder &operator <<(const T &) {
+		return *this;
+	}
+
+	DisabledMessageBuilder &operator <<(std::ios &(*)(std::ios &)) {
+		return *this;
+	}
+
+	DisabledMessageBuilder &operator <<(std::ostream &(*)(std::ostream &)) {
+		return *this;
+	}
+
+	DisabledMessageBuilder &fmt(const char *, ...) __attribute__((format(printf, 2, 3))) {
+		return *this;
+	}
+
+	// auto-convert to (an empty) message
+	inline operator const message &() const {
+		return this->msg;
+	}
+
+	inline operator message &() {
+		return this->msg;
+	}
+
+private:
+	message msg;
+};
+
+
+/**
+ * Whether MSG(level) messages are compiled in.
+ */
+namespace compiled_in {
+constexpr bool MIN = WITH_DEBUG_LOG;
+constexpr bool spam = WITH_DEBUG_LOG;
+constexpr bool dbg = WITH_DEBUG_LOG;
+constexpr bool info = true;
+constexpr bool warn = true;
+constexpr bool err = true;
+constexpr bool crit = true;
+constexpr bool MAX = true;
+} // compiled_in
+
+
+template<bool enabled>
+struct builder_for {
+	using type = MessageBuilder;
+};
+
+template<>
+struct builder_for<false> {
+	using type = DisabledMessageBuilder;
+};
+
+
 // MSG is resolved to a MessageBuilder constructor invocation;
 // it fills in information such as __FILE__, __LINE__ and __PRETTY_FUNCTION_.
 //
 // Unfortunately, macros are the only way to achieve that.
 
 
-// for use with existing log::level objects
-#define MSG_LVLOBJ(LVLOBJ) \
-	::openage::log::MessageBuilder( \
+// constructs a BUILDER for the message
+#define MSG_BUILDER(BUILDER, LVLOBJ) \
+	BUILDER( \
 	::openage::util::constexpr_::strip_prefix( \
 		__FILE__, \
 		::openage::config::buildsystem_sourcefile_dir), \
@@ -154,8 +247,15 @@ private:
 	LVLOBJ)
 
 
-// for use with log::level iterals (auto-prefixes full qualification)
-#define MSG(LVL) MSG_LVLOBJ(::openage::log::lvl:: LVL)
+// for use with existing log::level objects
+#define MSG_LVLOBJ(LVLOBJ) MSG_BUILDER(::openage::log::MessageBuilder, LVLOBJ)
+
+
+// for use with log::level iterals (auto-prefixes full qualification).
+// levels that are compiled out get a DisabledMessageBuilder.
+#define MSG(LVL) MSG_BUILDER( \
+	::openage::log::builder_for<::openage::log::compiled_in:: LVL>::type, \
+	::openage::log::lvl:: LVL)
 
 
 // some convenience shorteners for MSG(...).
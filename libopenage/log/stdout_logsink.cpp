@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "stdout_logsink.h"
 
@@ -11,7 +11,14 @@ namespace openage {
 namespace log {
 
 
-void StdOutSink::output_log_message(const message &msg, LogSource *source) {
+StdOutSink::~StdOutSink() {
+	this->unregister();
+}
+
+
+void StdOutSink::output_log_message(const log_record &record) {
+	const message &msg = record.msg;
+
 	// print log level (width 4)
 	std::cout << "\x1b[" << msg.lvl->colorcode << "m" << std::setw(4) << msg.lvl->name << "\x1b[m" " ";
 
@@ -19,11 +26,16 @@ void StdOutSink::output_log_message(const message &msg, LogSource *source) {
 		std::cout << "\x1b[32m" "[T" << msg.thread_id << "]\x1b[m ";
 	}
 
-	if (source != &general_source()) {
-		std::cout << "\x1b[36m" "[" << source->logsource_name() << "]\x1b[m ";
+	if (record.source != &general_source()) {
+		std::cout << "\x1b[36m" "[" << record.source_name << "]\x1b[m ";
 	}
 
-	std::cout << msg.text << std::endl;
+	std::cout << msg.text << "\n";
+}
+
+
+void StdOutSink::flush() {
+	std::cout.flush();
 }
 
 
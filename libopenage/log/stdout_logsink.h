@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -12,7 +12,12 @@ namespace log {
  * Simple logsink that prints messages to stdout (via std::cout).
  */
 class StdOutSink : public LogSink {
-	void output_log_message(const message &msg, LogSource *source) override;
+public:
+	~StdOutSink();
+
+private:
+	void output_log_message(const log_record &record) override;
+	void flush() override;
 };
 
 
@@ -1,14 +1,24 @@
 // Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
+#include "binary_logsink.h"
 #include "log.h"
+#include "logqueue.h"
 #include "logsource.h"
 #include "logsink.h"
+#include "stdout_logsink.h"
 
+#include "../testing/testing.h"
 #include "../util/strings.h"
 
 namespace openage {
@@ -29,11 +39,16 @@ public:
 	TestLogSink(std::ostream &os)
 		:
 		os{os} {}
+
+	~TestLogSink() {
+		this->unregister();
+	}
+
 private:
 	std::ostream &os;
 
-	void output_log_message(const message &msg, LogSource * /*source*/) override {
-		this->os << msg << std::endl;
+	void output_log_message(const log_record &record) override {
+		this->os << record.msg << std::endl;
 	}
 };
 
@@ -64,4 +79,190 @@ void demo() {
 	t1.join();
 }
 
+
+// exported test
+void queue() {
+	LogQueue queue{4};
+
+	log_record record;
+	queue.pop(record) and TESTFAIL;
+
+	for (int i = 0; i < 6; i++) {
+		record.msg.text = std::to_string(i);
+		queue.push(std::move(record));
+	}
+
+	// the oldest records were dropped
+	queue.take_dropped() == 2 or TESTFAIL;
+	queue.take_dropped() == 0 or TESTFAIL;
+
+	for (int i = 2; i < 6; i++) {
+		queue.pop(record) or TESTFAIL;
+		record.msg.text == std::to_string(i) or TESTFAIL;
+	}
+	queue.pop(record) and TESTFAIL;
+
+	// the queue is reused after a full round
+	record.msg.text = "again";
+	queue.push(std::move(record));
+	(queue.pop(record) and record.msg.text == "again") or TESTFAIL;
+}
+
+
+
+namespace {
+
+/**
+ * counts how often it is formatted.
+ */
+struct counted {
+	int *count;
+};
+
+std::ostream &operator <<(std::ostream &os, const counted &c) {
+	*c.count += 1;
+	return os << "counted";
+}
+
+} // anonymous namespace
+
+
+// exported test
+void level_filter() {
+	StdOutSink &stdout_sink = global_stdoutsink();
+	level stdout_level = stdout_sink.get_loglevel();
+	stdout_sink.set_loglevel(lvl::err);
+
+	TestLogSource logger;
+	std::ostringstream out;
+	int count = 0;
+
+	{
+		TestLogSink sink{out};
+		sink.set_loglevel(lvl::warn);
+		lowest_accepted_priority() == lvl::warn->priority or TESTFAIL;
+
+		// no sink accepts it, so it's not formatted
+		message muted = MSG(info) << counted{&count} << std::endl;
+		(count == 0 and muted.text.empty()) or TESTFAIL;
+		logger.log(MSG(info).fmt("%d", 1) << counted{&count});
+		count == 0 or TESTFAIL;
+
+		// exception messages are always formatted
+		message kept = MSG_LVLOBJ(lvl::warn) << counted{&count};
+		(count == 1 and kept.text == "counted") or TESTFAIL;
+
+		sink.set_loglevel(lvl::info);
+		lowest_accepted_priority() == lvl::info->priority or TESTFAIL;
+		logger.log(MSG(info) << counted{&count});
+		count == 2 or TESTFAIL;
+	}
+
+	stdout_sink.set_loglevel(stdout_level);
+
+	// only the last message reached the sink
+	std::string output = out.str();
+	size_t pos = output.find("counted");
+	(pos != std::string::npos and output.find("counted", pos + 1) == std::string::npos) or TESTFAIL;
+}
+
+
+
+namespace {
+
+/**
+ * reads little endian values from a binary log.
+ */
+struct binlog_reader {
+	const std::string &data;
+	size_t pos;
+
+	uint64_t read(size_t size) {
+		if (this->pos + size > this->data.size()) {
+			TESTFAILMSG("binary log ended within a record");
+		}
+		uint64_t value = 0;
+		for (size_t i = 0; i < size; i++) {
+			value |= uint64_t{static_cast<uint8_t>(this->data[this->pos++])} << (8 * i);
+		}
+		return value;
+	}
+
+	std::string read_string() {
+		size_t size = this->read(4);
+		if (this->pos + size > this->data.size()) {
+			TESTFAILMSG("binary log ended within a string");
+		}
+		this->pos += size;
+		return this->data.substr(this->pos - size, size);
+	}
+};
+
+} // anonymous namespace
+
+
+// exported test
+void binary_sink() {
+	char filename[] = "/tmp/openage-binary-log-XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0) {
+		TESTFAILMSG("could not create a temporary file");
+	}
+	close(fd);
+
+	TestLogSource logger;
+	{
+		BinaryFileSink sink{filename, false};
+		sink.set_loglevel(lvl::info);
+
+		for (int i = 0; i < 3; i++) {
+			logger.log(MSG(info) << "message " << i);
+		}
+		logger.log(MSG(warn) << "last");
+	}
+
+	std::ifstream file{filename, std::ios_base::binary};
+	std::string data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+	unlink(filename);
+
+	binlog_reader reader{data, 0};
+	(data.compare(0, 4, "OALB") == 0) or TESTFAIL;
+	reader.pos = 4;
+	reader.read(4) == BinaryFileSink::format_version or TESTFAIL;
+
+	std::map<uint32_t, std::string> strings;
+	std::vector<std::string> texts;
+	while (reader.pos < data.size()) {
+		auto kind = static_cast<binlog_kind>(reader.read(1));
+		if (kind == binlog_kind::string) {
+			uint32_t id = reader.read(4);
+			// each string is defined once
+			strings.count(id) == 0 or TESTFAIL;
+			strings[id] = reader.read_string();
+			continue;
+		}
+		kind == binlog_kind::message or TESTFAIL;
+
+		auto priority = static_cast<int32_t>(reader.read(4));
+		std::string level_name = strings.at(reader.read(4));
+		std::string source_name = strings.at(reader.read(4));
+		std::string file_name = strings.at(reader.read(4));
+		reader.read(4);
+		std::string function_name = strings.at(reader.read(4));
+		reader.read(8);
+		reader.read(8);
+
+		(level_name == (priority == lvl::warn->priority ? "WARN" : "INFO")) or TESTFAIL;
+		source_name == "TestLogSource" or TESTFAIL;
+		file_name.find("test.cpp") != std::string::npos or TESTFAIL;
+		function_name.find("binary_sink") != std::string::npos or TESTFAIL;
+		texts.push_back(reader.read_string());
+	}
+
+	(texts == std::vector<std::string>{"message 0", "message 1", "message 2", "last"}) or TESTFAIL;
+
+	// two level names, the source, file and function name
+	strings.size() == 5 or TESTFAIL;
+}
+
 }}} // openage::log::tests
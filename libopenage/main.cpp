@@ -9,15 +9,21 @@
 #include "gamedata/color.gen.h"
 #include "gamestate/generator.h"
 #include "log/log.h"
+#include "render_benchmark.h"
 #include "shader/program.h"
 #include "shader/shader.h"
 #include "util/file.h"
+#include "util/trace.h"
 
 
 namespace openage {
 
 
 int run_game(const main_arguments &args) {
+	// the engine ends it once the first frame is shown
+	util::startup_trace_begin();
+	util::set_trace_thread_name("main");
+
 	log::log(MSG(info) << "launching engine with data directory '"
 	                   << args.data_directory
 	                   << "' and fps limit "
@@ -28,7 +34,11 @@ int run_game(const main_arguments &args) {
 
 	util::Dir data_dir{args.data_directory.c_str()};
 
-	Engine engine{&data_dir, args.fps_limit, args.gl_debug, "openage"};
+	// the benchmark draws the frames as fast as possible
+	bool benchmark = not args.benchmark_save.empty();
+	int32_t fps_limit = benchmark ? 0 : args.fps_limit;
+
+	Engine engine{&data_dir, fps_limit, args.gl_debug, "openage"};
 
 	// read and apply the configuration files
 	auto &cvar_manager = engine.get_cvar_manager();
@@ -41,8 +51,11 @@ int run_game(const main_arguments &args) {
 	// TODO: move inside the engine
 	// TODO: support multiple consoles
 	console::Console console{&engine};
-	console.load_colors(termcolors);
-	console.register_to_engine();
+	{
+		TRACE_SCOPE("console setup");
+		console.load_colors(termcolors);
+		console.register_to_engine();
+	}
 
 	log::log(MSG(info).fmt("Loading time [engine]: %5.3f s", timer.getval() / 1.0e9));
 
@@ -54,8 +67,18 @@ int run_game(const main_arguments &args) {
 
 		log::log(MSG(info).fmt("Loading time   [game]: %5.3f s", timer.getval() / 1.0e9));
 
+		std::unique_ptr<RenderBenchmark> render_benchmark;
+		if (benchmark) {
+			render_benchmark = std::make_unique<RenderBenchmark>(
+				&engine, args.benchmark_save, args.benchmark_frames);
+		}
+
 		// run main loop
 		engine.run();
+
+		if (render_benchmark) {
+			render_benchmark->report(args.benchmark_output);
+		}
 	}
 
 	return 0;
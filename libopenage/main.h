@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -22,11 +22,25 @@ namespace openage {
  *     string data_directory
  *     int32_t fps_limit
  *     bool gl_debug
+ *     string benchmark_save
+ *     int32_t benchmark_frames
+ *     string benchmark_output
  */
 struct main_arguments {
 	std::string data_directory;
 	std::int32_t fps_limit;
 	bool gl_debug;
+
+	/**
+	 * if set, the render benchmark flies over this saved game.
+	 */
+	std::string benchmark_save;
+	std::int32_t benchmark_frames;
+
+	/**
+	 * file for the benchmark's histograms, may be empty.
+	 */
+	std::string benchmark_output;
 };
 
 
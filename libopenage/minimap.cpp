@@ -0,0 +1,276 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "minimap.h"
+
+#include <algorithm>
+
+#include "coord/chunk.h"
+#include "gamestate/player.h"
+#include "render_command_list.h"
+#include "terrain/terrain.h"
+#include "terrain/terrain_chunk.h"
+#include "terrain/terrain_object.h"
+#include "texture.h"
+#include "unit/unit.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * shade of the player palette used for the units.
+ */
+constexpr size_t player_subcolor = 0;
+
+uint32_t pack_color(const gamedata::palette_color &color) {
+	return (0xffu << 24) | (color.b << 16) | (color.g << 8) | color.r;
+}
+
+uint32_t darken(uint32_t color) {
+	return (color & 0xff000000) | ((color >> 1) & 0x007f7f7f);
+}
+
+} // anonymous namespace
+
+
+Minimap::Minimap(std::shared_ptr<Terrain> terrain,
+                 const std::vector<gamedata::palette_color> &player_colors)
+	:
+	terrain{terrain},
+	start{0, 0},
+	texture{std::make_shared<texture_data>()} {
+
+	for (size_t i = player_subcolor; i < player_colors.size(); i += 8) {
+		this->player_colors.push_back(pack_color(player_colors[i]));
+	}
+
+	// the tiles of a finite terrain, or the chunks created so far
+	coord::tile end{0, 0};
+	if (not terrain->infinite) {
+		this->start = terrain->limit_negative;
+		end = terrain->limit_positive;
+	}
+	else {
+		std::vector<coord::chunk> chunks = terrain->used_chunks();
+		if (not chunks.empty()) {
+			coord::chunk first = chunks[0], last = chunks[0];
+			for (auto &chunk : chunks) {
+				first.ne = std::min(first.ne, chunk.ne);
+				first.se = std::min(first.se, chunk.se);
+				last.ne = std::max(last.ne, chunk.ne);
+				last.se = std::max(last.se, chunk.se);
+			}
+			coord::tile_t last_tile = coord::settings::tiles_per_chunk - 1;
+			this->start = first.to_tile(coord::tile_delta{0, 0});
+			end = last.to_tile(coord::tile_delta{last_tile, last_tile});
+		}
+	}
+
+	texture_data &data = *this->texture;
+	data.width = end.ne - this->start.ne + 1;
+	data.height = end.se - this->start.se + 1;
+	data.pixels.resize(data.width * data.height);
+
+	for (int y = 0; y < data.height; y++) {
+		for (int x = 0; x < data.width; x++) {
+			coord::tile position = this->start + coord::tile_delta{x, y};
+			data.pixels[y * data.width + x] = this->tile_color(*terrain, position);
+		}
+	}
+	data.dirty_top = 0;
+	data.dirty_bottom = data.height;
+
+	this->changes = terrain->get_changes().subscribe();
+}
+
+
+Minimap::~Minimap() {
+	auto terrain = this->terrain.lock();
+	if (terrain) {
+		terrain->get_changes().unsubscribe(this->changes);
+	}
+
+	std::shared_ptr<texture_data> data = this->texture;
+	RenderCommandList::submit([data] {
+		if (data->texture_id != 0) {
+			glDeleteTextures(1, &data->texture_id);
+		}
+		if (data->vertbuf != 0) {
+			glDeleteBuffers(1, &data->vertbuf);
+		}
+	});
+}
+
+
+Terrain *Minimap::get_terrain() const {
+	return this->terrain.lock().get();
+}
+
+
+void Minimap::update() {
+	auto terrain = this->terrain.lock();
+	if (not terrain) {
+		return;
+	}
+
+	auto changed = terrain->get_changes().take(this->changes);
+	if (changed.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{this->texture->mutex};
+
+	for (auto &changes : changed) {
+		for (auto &tile : changes->tiles) {
+			this->update_tile(*terrain, tile.position);
+		}
+
+		// loaded chunks don't list their tiles
+		for (auto &chunk : changes->chunks) {
+			if (not chunk.all_tiles) {
+				continue;
+			}
+			coord::chunk position = chunk.position;
+			for (coord::tile_t se = 0; se < coord::settings::tiles_per_chunk; se++) {
+				for (coord::tile_t ne = 0; ne < coord::settings::tiles_per_chunk; ne++) {
+					this->update_tile(*terrain, position.to_tile(coord::tile_delta{ne, se}));
+				}
+			}
+		}
+	}
+}
+
+
+void Minimap::update_tile(Terrain &terrain, coord::tile position) {
+	texture_data &data = *this->texture;
+	coord::tile_delta pixel = position - this->start;
+	if (pixel.ne < 0 or pixel.ne >= data.width or
+	    pixel.se < 0 or pixel.se >= data.height) {
+		return;
+	}
+
+	data.pixels[pixel.se * data.width + pixel.ne] = this->tile_color(terrain, position);
+	data.dirty_top = std::min<int>(data.dirty_top, pixel.se);
+	data.dirty_bottom = std::max<int>(data.dirty_bottom, pixel.se + 1);
+}
+
+
+void Minimap::draw(coord::camhud center, coord::pixel_t width) {
+	// the first tile is the left corner, the rows along se go downwards
+	float left = center.x - width / 2, right = center.x + width / 2;
+	float top = center.y + width / 4, bottom = center.y - width / 4;
+	float cx = center.x, cy = center.y;
+
+	float vdata[] {
+		left,  cy,
+		cx,    top,
+		right, cy,
+		cx,    bottom,
+		0.0f,  0.0f,
+		1.0f,  0.0f,
+		1.0f,  1.0f,
+		0.0f,  1.0f,
+	};
+
+	std::shared_ptr<texture_data> data = this->texture;
+	std::vector<float> vertices{std::begin(vdata), std::end(vdata)};
+
+	RenderCommandList::submit([data, vertices] {
+		GLuint texture_id = data->upload();
+
+		texture_shader::program->use();
+		glActiveTexture(GL_TEXTURE0);
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+
+		if (data->vertbuf == 0) {
+			glGenBuffers(1, &data->vertbuf);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, data->vertbuf);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+
+		GLint pos_id = texture_shader::program->pos_id;
+		glEnableVertexAttribArray(pos_id);
+		glEnableVertexAttribArray(texture_shader::tex_coord);
+		glVertexAttribPointer(pos_id, 2, GL_FLOAT, GL_FALSE, 0, (void *)(0));
+		glVertexAttribPointer(texture_shader::tex_coord, 2, GL_FLOAT, GL_FALSE, 0, (void *)(sizeof(float) * 8));
+
+		glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDisableVertexAttribArray(pos_id);
+		glDisableVertexAttribArray(texture_shader::tex_coord);
+		texture_shader::program->stopusing();
+		glDisable(GL_TEXTURE_2D);
+	});
+}
+
+
+uint32_t Minimap::tile_color(Terrain &terrain, coord::tile position) {
+	TerrainChunk *chunk = terrain.get_chunk(position);
+	if (chunk == nullptr) {
+		return 0;
+	}
+
+	// free tiles don't expand compressed chunks
+	size_t index = TerrainChunk::tile_index(position);
+	if (not test_tile(chunk->occupied, index)) {
+		return terrain.map_color(chunk->get_terrain_id(index));
+	}
+
+	TileContent *content = chunk->get_data(index);
+
+	bool covered = false;
+	for (TerrainObject *obj : content->obj) {
+		if (not obj->is_placed()) {
+			continue;
+		}
+		covered = true;
+
+		if (obj->unit.has_attribute(attr_type::owner)) {
+			unsigned int color = obj->unit.get_attribute<attr_type::owner>().player.color;
+			if (color > 0 and color <= this->player_colors.size()) {
+				return this->player_colors[color - 1];
+			}
+		}
+	}
+
+	uint32_t color = terrain.map_color(content->terrain_id);
+	return covered ? darken(color) : color;
+}
+
+
+GLuint Minimap::texture_data::upload() {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	if (this->texture_id == 0) {
+		glGenTextures(1, &this->texture_id);
+		glBindTexture(GL_TEXTURE_2D, this->texture_id);
+
+		// one pixel per tile, stretched without blurring
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glTexImage2D(
+			GL_TEXTURE_2D, 0,
+			GL_RGBA8, this->width, this->height, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, this->pixels.data()
+		);
+	}
+	else if (this->dirty_top < this->dirty_bottom) {
+		// only the changed rows are uploaded, over the full width
+		glBindTexture(GL_TEXTURE_2D, this->texture_id);
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0,
+			0, this->dirty_top, this->width, this->dirty_bottom - this->dirty_top,
+			GL_RGBA, GL_UNSIGNED_BYTE, this->pixels.data() + this->dirty_top * this->width
+		);
+	}
+
+	this->dirty_top = this->height;
+	this->dirty_bottom = 0;
+
+	return this->texture_id;
+}
+
+} // openage
@@ -0,0 +1,116 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "coord/camhud.h"
+#include "coord/tile.h"
+#include "gamedata/color.gen.h"
+#include "terrain/tile_changes.h"
+
+namespace openage {
+
+class Terrain;
+
+/**
+ * overview of the whole terrain, drawn on the hud.
+ *
+ * the texture has one pixel per tile. the terrain colors are written
+ * once when the minimap is created, afterwards only the tiles which the
+ * terrain reports as changed are recolored: tiles whose terrain changed,
+ * and the tiles objects were placed on, removed from or moved between.
+ * only the rows containing these tiles are uploaded again.
+ *
+ * the minimap subscribes to the tile changes of the terrain.
+ */
+class Minimap {
+public:
+	/**
+	 * @param player_colors: the player palette, 8 shades per player.
+	 */
+	Minimap(std::shared_ptr<Terrain> terrain,
+	        const std::vector<gamedata::palette_color> &player_colors);
+	~Minimap();
+
+	Minimap(const Minimap &) = delete;
+	Minimap &operator =(const Minimap &) = delete;
+
+	/**
+	 * the terrain shown by this minimap, nullptr if it was deleted.
+	 */
+	Terrain *get_terrain() const;
+
+	/**
+	 * recolor the tiles changed since the last update.
+	 */
+	void update();
+
+	/**
+	 * draw the map as a diamond around the given center,
+	 * which is twice as wide as it's high.
+	 */
+	void draw(coord::camhud center, coord::pixel_t width);
+
+private:
+	/**
+	 * the color of a tile: the owner of an object on it,
+	 * or its terrain, darker if gaia objects are on it.
+	 */
+	uint32_t tile_color(Terrain &terrain, coord::tile position);
+
+	/**
+	 * recolor the pixel of a tile, if the map shows it.
+	 */
+	void update_tile(Terrain &terrain, coord::tile position);
+
+	std::weak_ptr<Terrain> terrain;
+
+	TileChangeLog::subscription_t changes;
+
+	/**
+	 * one color per player number, starting with player 1.
+	 */
+	std::vector<uint32_t> player_colors;
+
+	/**
+	 * the tile shown by the first pixel, rows go along se.
+	 */
+	coord::tile start;
+
+	/**
+	 * the pixels and gl objects, shared with the drawing commands
+	 * which may run on the render thread after the minimap is gone.
+	 */
+	struct texture_data {
+		std::mutex mutex;
+
+		int width, height;
+
+		/**
+		 * rgba8 pixels, row by row.
+		 */
+		std::vector<uint32_t> pixels;
+
+		/**
+		 * the rows changed since the last upload.
+		 */
+		int dirty_top, dirty_bottom;
+
+		GLuint texture_id = 0;
+		GLuint vertbuf = 0;
+
+		/**
+		 * create or update the texture and return its id.
+		 */
+		GLuint upload();
+	};
+
+	std::shared_ptr<texture_data> texture;
+};
+
+} // openage
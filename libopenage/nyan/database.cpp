@@ -0,0 +1,349 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "database.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace nyan {
+
+namespace {
+
+const char *value_type_name(value_type type) {
+	switch (type) {
+	case value_type::boolean:
+		return "bool";
+	case value_type::integer:
+		return "int";
+	case value_type::floating:
+		return "float";
+	case value_type::text:
+		return "string";
+	case value_type::object:
+		return "object";
+	case value_type::set:
+		return "set";
+	}
+	return "unknown";
+}
+
+} // anonymous namespace
+
+
+value value::from_bool(bool boolean) {
+	value result;
+	result.type = value_type::boolean;
+	result.boolean = boolean;
+	return result;
+}
+
+
+value value::from_int(int64_t integer) {
+	value result;
+	result.type = value_type::integer;
+	result.integer = integer;
+	return result;
+}
+
+
+value value::from_float(double floating) {
+	value result;
+	result.type = value_type::floating;
+	result.floating = floating;
+	return result;
+}
+
+
+value value::from_text(const std::string &text) {
+	value result;
+	result.type = value_type::text;
+	result.text = text;
+	return result;
+}
+
+
+value value::from_object(const std::string &object) {
+	value result;
+	result.type = value_type::object;
+	result.text = object;
+	return result;
+}
+
+
+value value::from_set(const std::vector<std::string> &objects) {
+	value result;
+	result.type = value_type::set;
+	result.objects = objects;
+	return result;
+}
+
+
+Database Database::compile(const std::vector<type_definition> &types,
+                           const std::vector<object_definition> &objects) {
+	Database db;
+
+	for (auto &definition : types) {
+		type_id id = static_cast<type_id>(db.types.size());
+		if (not db.type_ids.emplace(definition.name, id).second) {
+			throw Error(MSG(err) << "nyan type " << definition.name << " is defined twice");
+		}
+		db.types.emplace_back();
+		db.types.back().name = definition.name;
+	}
+
+	// the ancestors of each type, starting with the type itself.
+	// they are flattened depth first, a type is listed once.
+	enum class visit { none, active, done };
+	std::vector<visit> visited(types.size(), visit::none);
+
+	std::function<void(type_id)> flatten = [&](type_id id) {
+		if (visited[id] == visit::done) {
+			return;
+		}
+		if (visited[id] == visit::active) {
+			throw Error(MSG(err) << "nyan type " << types[id].name << " inherits from itself");
+		}
+		visited[id] = visit::active;
+
+		std::vector<type_id> ancestors{id};
+		for (auto &parent : types[id].parents) {
+			type_id parent_id = db.get_type(parent);
+			flatten(parent_id);
+			for (type_id ancestor : db.types[parent_id].ancestors) {
+				if (std::find(std::begin(ancestors), std::end(ancestors), ancestor) == std::end(ancestors)) {
+					ancestors.push_back(ancestor);
+				}
+			}
+		}
+
+		db.types[id].ancestors = std::move(ancestors);
+		visited[id] = visit::done;
+	};
+
+	for (type_id id = 0; id < types.size(); id++) {
+		flatten(id);
+	}
+
+	// the layout of each type: the members of the most basic
+	// ancestors first, its own ones last.
+	for (type_id id = 0; id < types.size(); id++) {
+		compiled_type &type = db.types[id];
+
+		for (auto it = type.ancestors.rbegin(); it != type.ancestors.rend(); ++it) {
+			for (auto &declared : types[*it].members) {
+				uint32_t offset = static_cast<uint32_t>(type.members.size() + 1);
+				if (not type.member_offsets.emplace(declared.name, offset).second) {
+					throw Error(MSG(err) << "nyan type " << type.name << " inherits the member "
+					            << declared.name << " twice");
+				}
+
+				type_id target = 0;
+				if (declared.type == value_type::object or declared.type == value_type::set) {
+					target = db.get_type(declared.target);
+				}
+				type.members.push_back({declared.name, declared.type, target});
+			}
+		}
+
+		for (auto &changed : types[id].defaults) {
+			if (type.member_offsets.count(changed.first) == 0) {
+				throw Error(MSG(err) << "nyan type " << type.name
+				            << " sets the default of the unknown member " << changed.first);
+			}
+		}
+	}
+
+	// the default of each member is the one of the most derived
+	// ancestor which declares the member or changes its default.
+	std::vector<std::vector<const value *>> defaults(types.size());
+
+	for (type_id id = 0; id < types.size(); id++) {
+		const compiled_type &type = db.types[id];
+
+		for (auto &member : type.members) {
+			const value *found = nullptr;
+			for (type_id ancestor : type.ancestors) {
+				auto changed = types[ancestor].defaults.find(member.name);
+				if (changed != std::end(types[ancestor].defaults)) {
+					found = &changed->second;
+					break;
+				}
+
+				auto declared = std::find_if(
+					std::begin(types[ancestor].members),
+					std::end(types[ancestor].members),
+					[&](const member_definition &definition) {
+						return definition.name == member.name;
+					}
+				);
+				if (declared != std::end(types[ancestor].members)) {
+					if (declared->has_default) {
+						found = &declared->default_value;
+					}
+					break;
+				}
+			}
+			defaults[id].push_back(found);
+		}
+	}
+
+	// place the objects, so they can refer to each other
+	for (auto &definition : objects) {
+		type_id type = db.get_type(definition.type);
+		object_id id = static_cast<object_id>(db.values.size());
+		if (not db.object_ids.emplace(definition.name, id).second) {
+			throw Error(MSG(err) << "nyan object " << definition.name << " is defined twice");
+		}
+		db.object_names.emplace(id, definition.name);
+		db.objects.push_back(id);
+
+		slot header;
+		header.index = type;
+		db.values.push_back(header);
+		db.values.resize(db.values.size() + db.types[type].members.size());
+	}
+
+	auto resolve = [&](const std::string &object_name, const compiled_member &member,
+	                   const std::string &owner) {
+		object_id target = db.get_object(object_name);
+		if (not db.is_a(db.type_of(target), member.target)) {
+			throw Error(MSG(err) << "nyan object " << owner << ": " << object_name
+			            << " is no " << db.types[member.target].name << " for " << member.name);
+		}
+		return target;
+	};
+
+	for (size_t i = 0; i < objects.size(); i++) {
+		const object_definition &definition = objects[i];
+		object_id id = db.objects[i];
+		const compiled_type &type = db.types[db.type_of(id)];
+
+		for (auto &assigned : definition.values) {
+			if (type.member_offsets.count(assigned.first) == 0) {
+				throw Error(MSG(err) << "nyan object " << definition.name
+				            << " sets the unknown member " << assigned.first);
+			}
+		}
+
+		for (uint32_t offset = 1; offset <= type.members.size(); offset++) {
+			const compiled_member &member = type.members[offset - 1];
+
+			const value *source = defaults[db.type_of(id)][offset - 1];
+			auto assigned = definition.values.find(member.name);
+			if (assigned != std::end(definition.values)) {
+				source = &assigned->second;
+			}
+
+			if (source == nullptr) {
+				throw Error(MSG(err) << "nyan object " << definition.name
+				            << " has no value for " << member.name);
+			}
+
+			// ints are valid floats, as in the specs
+			bool int_as_float = (member.type == value_type::floating and
+			                     source->type == value_type::integer);
+			if (source->type != member.type and not int_as_float) {
+				throw Error(MSG(err) << "nyan object " << definition.name << ": "
+				            << value_type_name(source->type) << " value for the "
+				            << value_type_name(member.type) << " member " << member.name);
+			}
+
+			slot &target = db.values[id + offset];
+			switch (member.type) {
+			case value_type::boolean:
+				target.boolean = source->boolean;
+				break;
+			case value_type::integer:
+				target.integer = source->integer;
+				break;
+			case value_type::floating:
+				target.floating = int_as_float ? static_cast<double>(source->integer) : source->floating;
+				break;
+			case value_type::text:
+				target.index = static_cast<uint32_t>(db.strings.size());
+				db.strings.push_back(source->text);
+				break;
+			case value_type::object:
+				target.index = resolve(source->text, member, definition.name);
+				break;
+			case value_type::set: {
+				object_set set;
+				for (auto &name : source->objects) {
+					set.push_back(resolve(name, member, definition.name));
+				}
+				target.index = static_cast<uint32_t>(db.sets.size());
+				db.sets.push_back(std::move(set));
+				break;
+			}
+			}
+		}
+	}
+
+	return db;
+}
+
+
+type_id Database::get_type(const std::string &name) const {
+	auto it = this->type_ids.find(name);
+	if (it == std::end(this->type_ids)) {
+		throw Error(MSG(err) << "unknown nyan type " << name);
+	}
+	return it->second;
+}
+
+
+object_id Database::get_object(const std::string &name) const {
+	auto it = this->object_ids.find(name);
+	if (it == std::end(this->object_ids)) {
+		throw Error(MSG(err) << "unknown nyan object " << name);
+	}
+	return it->second;
+}
+
+
+bool Database::is_a(type_id type, type_id other) const {
+	const auto &ancestors = this->types[type].ancestors;
+	return std::find(std::begin(ancestors), std::end(ancestors), other) != std::end(ancestors);
+}
+
+
+const std::string &Database::type_name(type_id type) const {
+	return this->types[type].name;
+}
+
+
+const std::string &Database::object_name(object_id object) const {
+	return this->object_names.at(object);
+}
+
+
+const std::vector<object_id> &Database::get_objects() const {
+	return this->objects;
+}
+
+
+bool Database::has_member(type_id type, const std::string &name) const {
+	return this->types[type].member_offsets.count(name) > 0;
+}
+
+
+uint32_t Database::find_member(type_id type, const std::string &name, value_type expected) const {
+	const compiled_type &compiled = this->types[type];
+
+	auto it = compiled.member_offsets.find(name);
+	if (it == std::end(compiled.member_offsets)) {
+		throw Error(MSG(err) << "nyan type " << compiled.name << " has no member " << name);
+	}
+
+	const compiled_member &member = compiled.members[it->second - 1];
+	if (member.type != expected) {
+		throw Error(MSG(err) << "nyan member " << compiled.name << "." << name << " is a "
+		            << value_type_name(member.type) << ", not a " << value_type_name(expected));
+	}
+	return it->second;
+}
+
+}} // openage::nyan
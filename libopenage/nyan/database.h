@@ -0,0 +1,283 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace openage {
+namespace nyan {
+
+/**
+ * Types of the members of nyan types, as in the nyan specs:
+ * bool, int, float, string, a nyan type or set(nyan type).
+ */
+enum class value_type {
+	boolean,
+	integer,
+	floating,
+	text,
+	object,
+	set,
+};
+
+/** Index of a type in a database. */
+using type_id = uint32_t;
+
+/**
+ * Identifies an object of a database. It is the position of the object's
+ * values in the database, so reading a member needs no further lookup.
+ */
+using object_id = uint32_t;
+
+/** The value of a set member. */
+using object_set = std::vector<object_id>;
+
+
+/**
+ * A value in the definitions. Objects are referred to by name.
+ */
+struct value {
+	static value from_bool(bool boolean);
+	static value from_int(int64_t integer);
+	static value from_float(double floating);
+	static value from_text(const std::string &text);
+	static value from_object(const std::string &object);
+	static value from_set(const std::vector<std::string> &objects);
+
+	value_type type = value_type::integer;
+	bool boolean = false;
+	int64_t integer = 0;
+	double floating = 0;
+
+	/** the string, or the name of the object */
+	std::string text;
+
+	/** the names of the objects of a set */
+	std::vector<std::string> objects;
+};
+
+
+/**
+ * A member declared by a type.
+ */
+struct member_definition {
+	std::string name;
+	value_type type;
+
+	/** the type of the objects of object and set members */
+	std::string target;
+
+	/** the value of objects which don't set it */
+	bool has_default = false;
+	value default_value;
+};
+
+
+/**
+ * A nyan type. It has the members of its parents and its own ones,
+ * and may change the defaults of the inherited members.
+ */
+struct type_definition {
+	std::string name;
+	std::vector<std::string> parents;
+	std::vector<member_definition> members;
+	std::unordered_map<std::string, value> defaults;
+};
+
+
+/**
+ * An object of a type, with the values of its members.
+ */
+struct object_definition {
+	std::string name;
+	std::string type;
+	std::unordered_map<std::string, value> values;
+};
+
+
+/**
+ * The position of a member of type T in the objects of one type,
+ * resolved once with Database::member().
+ *
+ * T is bool, int64_t, double, std::string, object_id or object_set.
+ */
+template<class T>
+struct Member {
+	/** the objects of this type have the member at the offset */
+	type_id type;
+	uint32_t offset;
+};
+
+
+/**
+ * The nyan types and objects of a game, compiled when they are loaded.
+ *
+ * The inheritance of the types is flattened: each type lists all of its
+ * members, the inherited ones first, and each member has a fixed offset
+ * in the objects of the type. The values of all objects are stored in
+ * one array, a member of an object is read from the object's position
+ * plus the member's offset. Game logic resolves the members it uses
+ * once and reads them without looking up names.
+ *
+ * The database can't be changed after it was compiled, it may be read
+ * by several threads at once.
+ */
+class Database {
+public:
+	/**
+	 * Compiles the definitions. Throws if a type or object is unknown,
+	 * the inheritance is cyclic, a member is declared twice or has no
+	 * value, or a value doesn't fit its member.
+	 */
+	static Database compile(const std::vector<type_definition> &types,
+	                        const std::vector<object_definition> &objects);
+
+	/**
+	 * The type of the name. Throws if there is none.
+	 */
+	type_id get_type(const std::string &name) const;
+
+	/**
+	 * The object of the name. Throws if there is none.
+	 */
+	object_id get_object(const std::string &name) const;
+
+	/**
+	 * The type of the object.
+	 */
+	type_id type_of(object_id object) const {
+		return this->values[object].index;
+	}
+
+	/**
+	 * Is the type the other one, or derived from it?
+	 */
+	bool is_a(type_id type, type_id other) const;
+
+	const std::string &type_name(type_id type) const;
+	const std::string &object_name(object_id object) const;
+
+	/**
+	 * All objects, in the order of their definitions.
+	 */
+	const std::vector<object_id> &get_objects() const;
+
+	/**
+	 * Whether the type has a member of that name, declared or inherited.
+	 */
+	bool has_member(type_id type, const std::string &name) const;
+
+	/**
+	 * The member of the objects of the type. Throws if the type has
+	 * no such member or its values are not of type T.
+	 */
+	template<class T>
+	Member<T> member(type_id type, const std::string &name) const {
+		return {type, this->find_member(type, name, member_value_type<T>())};
+	}
+
+	/**
+	 * Reads the member of an object of the member's type.
+	 */
+	bool get(object_id object, const Member<bool> &member) const {
+		return this->values[object + member.offset].boolean;
+	}
+
+	int64_t get(object_id object, const Member<int64_t> &member) const {
+		return this->values[object + member.offset].integer;
+	}
+
+	double get(object_id object, const Member<double> &member) const {
+		return this->values[object + member.offset].floating;
+	}
+
+	const std::string &get(object_id object, const Member<std::string> &member) const {
+		return this->strings[this->values[object + member.offset].index];
+	}
+
+	object_id get(object_id object, const Member<object_id> &member) const {
+		return this->values[object + member.offset].index;
+	}
+
+	const object_set &get(object_id object, const Member<object_set> &member) const {
+		return this->sets[this->values[object + member.offset].index];
+	}
+
+	/**
+	 * Reads the member by name, for scripts and the console.
+	 * Game logic should resolve its members once with member().
+	 */
+	template<class T>
+	auto get(object_id object, const std::string &name) const
+		-> decltype(this->get(object, Member<T>{})) {
+		return this->get(object, this->member<T>(this->type_of(object), name));
+	}
+
+private:
+	/**
+	 * One value of an object. Strings and sets are stored
+	 * separately, the slot holds their index.
+	 */
+	union slot {
+		bool boolean;
+		int64_t integer;
+		double floating;
+		uint32_t index;
+	};
+
+	struct compiled_member {
+		std::string name;
+		value_type type;
+
+		/** the target type of object and set members */
+		type_id target;
+	};
+
+	struct compiled_type {
+		std::string name;
+
+		/** the type and all of its ancestors */
+		std::vector<type_id> ancestors;
+
+		/** all members, the offset of each is its index + 1 */
+		std::vector<compiled_member> members;
+		std::unordered_map<std::string, uint32_t> member_offsets;
+	};
+
+	template<class T>
+	static constexpr value_type member_value_type();
+
+	/**
+	 * The offset of a member, which must have the value type.
+	 */
+	uint32_t find_member(type_id type, const std::string &name, value_type expected) const;
+
+	std::vector<compiled_type> types;
+	std::unordered_map<std::string, type_id> type_ids;
+
+	/**
+	 * The objects one after the other: a slot with the type of
+	 * the object, followed by the values of its members.
+	 */
+	std::vector<slot> values;
+
+	std::vector<object_id> objects;
+	std::unordered_map<std::string, object_id> object_ids;
+	std::unordered_map<object_id, std::string> object_names;
+
+	std::vector<std::string> strings;
+	std::vector<object_set> sets;
+};
+
+
+template<> constexpr value_type Database::member_value_type<bool>() { return value_type::boolean; }
+template<> constexpr value_type Database::member_value_type<int64_t>() { return value_type::integer; }
+template<> constexpr value_type Database::member_value_type<double>() { return value_type::floating; }
+template<> constexpr value_type Database::member_value_type<std::string>() { return value_type::text; }
+template<> constexpr value_type Database::member_value_type<object_id>() { return value_type::object; }
+template<> constexpr value_type Database::member_value_type<object_set>() { return value_type::set; }
+
+}} // openage::nyan
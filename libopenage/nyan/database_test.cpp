@@ -0,0 +1,195 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "database.h"
+
+#include <string>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/benchmark.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace nyan {
+namespace tests {
+
+namespace {
+
+/**
+ * Units and resources as they are defined for a game.
+ */
+Database unit_database(size_t extra_units=0) {
+	std::vector<type_definition> types{
+		{"Resource", {}, {
+			{"amount", value_type::integer, "", true, value::from_int(100)},
+		}, {}},
+		{"Object", {}, {
+			{"hit_points", value_type::integer, "", false, {}},
+			{"name", value_type::text, "", true, value::from_text("object")},
+		}, {}},
+		{"Mobile", {"Object"}, {
+			{"speed", value_type::floating, "", true, value::from_float(1.0)},
+		}, {}},
+		{"Gatherer", {"Object"}, {
+			{"gathers", value_type::set, "Resource", true, value::from_set({})},
+			{"carry", value_type::integer, "", true, value::from_int(10)},
+		}, {}},
+		{"Villager", {"Mobile", "Gatherer"}, {
+			{"female", value_type::boolean, "", true, value::from_bool(false)},
+			{"builds", value_type::object, "Object", false, {}},
+		}, {
+			{"speed", value::from_float(0.8)},
+			{"hit_points", value::from_int(25)},
+		}},
+	};
+
+	std::vector<object_definition> objects{
+		{"Wood", "Resource", {}},
+		{"Gold", "Resource", {{"amount", value::from_int(800)}}},
+		{"House", "Object", {{"hit_points", value::from_int(550)}}},
+		{"Villager", "Villager", {
+			{"name", value::from_text("villager")},
+			{"gathers", value::from_set({"Wood", "Gold"})},
+			{"builds", value::from_object("House")},
+			{"carry", value::from_int(15)},
+		}},
+	};
+
+	for (size_t i = 0; i < extra_units; i++) {
+		objects.push_back({"Unit" + std::to_string(i), "Villager", {
+			{"hit_points", value::from_int(static_cast<int64_t>(i))},
+			{"builds", value::from_object("House")},
+			{"speed", value::from_int(2)},
+		}});
+	}
+
+	return Database::compile(types, objects);
+}
+
+
+/**
+ * Checks that compiling the definitions fails.
+ */
+void compile_fails(const std::vector<type_definition> &types,
+                   const std::vector<object_definition> &objects) {
+	try {
+		Database::compile(types, objects);
+	}
+	catch (Error &) {
+		return;
+	}
+	TESTFAIL;
+}
+
+} // anonymous namespace
+
+
+// exported test
+void database() {
+	Database db = unit_database();
+
+	type_id villager_type = db.get_type("Villager");
+	type_id object_type = db.get_type("Object");
+	db.is_a(villager_type, object_type) or TESTFAIL;
+	db.is_a(villager_type, db.get_type("Gatherer")) or TESTFAIL;
+	db.is_a(object_type, villager_type) and TESTFAIL;
+
+	object_id villager = db.get_object("Villager");
+	db.type_of(villager) == villager_type or TESTFAIL;
+	db.object_name(villager) == "Villager" or TESTFAIL;
+	db.get_objects().size() == 4 or TESTFAIL;
+
+	// inherited and own members, with the defaults of the most derived type
+	auto hit_points = db.member<int64_t>(villager_type, "hit_points");
+	auto speed = db.member<double>(villager_type, "speed");
+	auto carry = db.member<int64_t>(villager_type, "carry");
+	auto female = db.member<bool>(villager_type, "female");
+	auto name = db.member<std::string>(villager_type, "name");
+	auto builds = db.member<object_id>(villager_type, "builds");
+	auto gathers = db.member<object_set>(villager_type, "gathers");
+
+	db.get(villager, hit_points) == 25 or TESTFAIL;
+	TESTEQUALS_FLOAT(db.get(villager, speed), 0.8, 1e-9);
+	db.get(villager, carry) == 15 or TESTFAIL;
+	db.get(villager, female) and TESTFAIL;
+	db.get(villager, name) == "villager" or TESTFAIL;
+	db.get(villager, builds) == db.get_object("House") or TESTFAIL;
+
+	const object_set &resources = db.get(villager, gathers);
+	resources.size() == 2 or TESTFAIL;
+	resources[0] == db.get_object("Wood") or TESTFAIL;
+	resources[1] == db.get_object("Gold") or TESTFAIL;
+
+	// the layout of a type doesn't depend on its objects
+	object_id gold = db.get_object("Gold");
+	auto amount = db.member<int64_t>(db.type_of(gold), "amount");
+	db.get(gold, amount) == 800 or TESTFAIL;
+	db.get(db.get_object("Wood"), amount) == 100 or TESTFAIL;
+
+	db.get<std::string>(db.get_object("House"), "name") == "object" or TESTFAIL;
+	db.get<int64_t>(db.get_object("House"), "hit_points") == 550 or TESTFAIL;
+
+	db.has_member(object_type, "speed") and TESTFAIL;
+	TESTTHROWS(db.member<double>(villager_type, "hit_points"));
+	TESTTHROWS(db.member<int64_t>(object_type, "carry"));
+	TESTTHROWS(db.get_object("Stone"));
+
+	// ints are valid floats
+	Database many = unit_database(2);
+	object_id unit = many.get_object("Unit1");
+	TESTEQUALS_FLOAT(many.get(unit, many.member<double>(many.get_type("Villager"), "speed")), 2, 1e-9);
+	many.get(unit, many.member<int64_t>(many.get_type("Villager"), "hit_points")) == 1 or TESTFAIL;
+
+	// invalid definitions
+	compile_fails({{"A", {"B"}, {}, {}}, {"B", {"A"}, {}, {}}}, {});
+	compile_fails({{"A", {"C"}, {}, {}}}, {});
+	compile_fails({
+		{"A", {}, {{"x", value_type::integer, "", true, value::from_int(1)}}, {}},
+		{"B", {}, {{"x", value_type::integer, "", true, value::from_int(1)}}, {}},
+		{"C", {"A", "B"}, {}, {}},
+	}, {});
+	compile_fails({{"A", {}, {{"x", value_type::integer, "", false, {}}}, {}}},
+	              {{"a", "A", {}}});
+	compile_fails({{"A", {}, {{"x", value_type::integer, "", false, {}}}, {}}},
+	              {{"a", "A", {{"x", value::from_float(1.5)}}}});
+	compile_fails({{"A", {}, {}, {}}},
+	              {{"a", "A", {{"y", value::from_int(1)}}}});
+	compile_fails({
+		{"A", {}, {{"other", value_type::object, "B", false, {}}}, {}},
+		{"B", {}, {}, {}},
+	}, {{"a", "A", {{"other", value::from_object("a")}}}});
+}
+
+
+// exported benchmark
+void database_benchmark(testing::Benchmark &bench) {
+	// the units of a large game
+	constexpr size_t count = 4096;
+
+	Database db = unit_database(count);
+	type_id villager_type = db.get_type("Villager");
+	const std::vector<object_id> &units = db.get_objects();
+
+	auto hit_points = db.member<int64_t>(villager_type, "hit_points");
+	bench.measure("member offset", [&] {
+		int64_t sum = 0;
+		for (object_id unit : units) {
+			if (db.type_of(unit) == villager_type) {
+				sum += db.get(unit, hit_points);
+			}
+		}
+		testing::use_result(&sum);
+	});
+
+	bench.measure("member name", [&] {
+		int64_t sum = 0;
+		for (object_id unit : units) {
+			if (db.type_of(unit) == villager_type) {
+				sum += db.get<int64_t>(unit, "hit_points");
+			}
+		}
+		testing::use_result(&sum);
+	});
+}
+
+}}} // openage::nyan::tests
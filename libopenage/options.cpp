@@ -1,10 +1,28 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "options.h"
 
+#include "util/perfect_hash.h"
+
 namespace openage {
 namespace options {
 
+namespace {
+
+/**
+ * words that parse as bools, the even ones are true
+ */
+constexpr const char *bool_words[] = {
+	"true", "false",
+	"1", "0",
+	"yes", "no",
+	"on", "off",
+};
+
+constexpr auto bool_word_index = util::make_perfect_hash(bool_words);
+
+} // anonymous namespace
+
 
 OptionValue::OptionValue(bool b)
 	:
@@ -199,8 +217,11 @@ std::string OptionValue::str_value() const {
 
 OptionValue parse(option_type t, std::string s) {
 	switch(t) {
-	case options::option_type::bool_type:
-		return options::OptionValue(s == "true");
+	case options::option_type::bool_type: {
+		// unknown words are false
+		size_t word = bool_word_index.find(s);
+		return options::OptionValue(word != bool_word_index.not_found and word % 2 == 0);
+	}
 	case option_type::int_type:
 		return options::OptionValue(stoi(s));
 	case option_type::double_type:
@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 /** @file
  *
@@ -8,35 +8,308 @@
  * Hart, Peter E., Nils J. Nilsson, and Bertram Raphael. "A formal basis for
  * the heuristic determination of minimum cost paths."  Systems Science and
  * Cybernetics, IEEE Transactions on 4, no. 2 (1968): 100-107.
+ *
+ * Harabor, Daniel, and Alban Grastien. "Online graph pruning for
+ * pathfinding on grid maps." AAAI Conference on Artificial Intelligence
+ * (2011): 1114-1119.
  */
 
 #include "a_star.h"
 
 #include <cmath>
 
-#include "../datastructure/pairing_heap.h"
+#include "../config.h"
+#include "../job/cancellation_token.h"
 #include "../log/log.h"
 #include "../terrain/terrain.h"
 #include "../terrain/terrain_object.h"
 #include "../util/strings.h"
 #include "path.h"
 #include "heuristics.h"
+#include "search_context.h"
 
 
 namespace openage {
 namespace path {
 
 
+namespace {
+
+/**
+ * Grid cells a jump follows at most before it stops at a jump point anyway.
+ * Lines usually end earlier at the search bound, but without a heuristic
+ * there is none.
+ */
+constexpr int max_jump = 64;
+
+
+/**
+ * Result of following a line over the grid.
+ */
+enum class jump_result {
+	blocked,    //!< ran into an impassable cell or out of the search bound
+	found,      //!< reached a jump point
+	limit,      //!< went max_jump cells without finding one
+};
+
+
+/**
+ * The cells of one jump point search.
+ */
+class JumpGrid {
+public:
+	JumpGrid(const std::function<bool(const coord::phys3 &)> &valid_end,
+	         const std::function<cost_t(const coord::phys3 &)> &heuristic,
+	         const std::function<bool(const coord::phys3 &)> &passable)
+		:
+		max_heuristic{0},
+		valid_end{valid_end},
+		heuristic{heuristic},
+		passable{passable} {}
+
+	/**
+	 * is the cell dne, dse cells away from pos passable?
+	 */
+	bool open(const coord::phys3 &pos, int dne, int dse) const {
+		return this->passable(pos + coord::phys3_delta{dne * path_grid_size, dse * path_grid_size, 0});
+	}
+
+	/**
+	 * Follows the direction from pos until a jump point, which is
+	 * returned in pos. Straight lines stop at cells with forced
+	 * neighbors, diagonal ones where a straight line from them does.
+	 */
+	jump_result jump(coord::phys3 &pos, int dne, int dse) const {
+		if (dne != 0 and dse != 0) {
+			return this->jump_diagonal(pos, dne, dse);
+		}
+		return this->jump_straight(pos, dne, dse);
+	}
+
+	/**
+	 * Directions to jump to from a node that was reached in direction
+	 * dne, dse, or all of them for 0, 0. Returns their number.
+	 */
+	int successors(const coord::phys3 &pos, int dne, int dse, int (&dirs)[8][2]) const {
+		int count = 0;
+		auto add = [&](int ne, int se) {
+			dirs[count][0] = ne;
+			dirs[count][1] = se;
+			count++;
+		};
+
+		if (dne == 0 and dse == 0) {
+			for (auto &delta : neigh_phys) {
+				add(delta.ne / path_grid_size, delta.se / path_grid_size);
+			}
+		}
+		else if (dne != 0 and dse != 0) {
+			add(dne, 0);
+			add(0, dse);
+			add(dne, dse);
+		}
+		else {
+			// the sides of the straight direction
+			int side_ne = dse, side_se = dne;
+			bool side_a = this->open(pos, side_ne, side_se);
+			bool side_b = this->open(pos, -side_ne, -side_se);
+			if (this->open(pos, dne, dse)) {
+				add(dne, dse);
+				if (side_a) { add(dne + side_ne, dse + side_se); }
+				if (side_b) { add(dne - side_ne, dse - side_se); }
+			}
+			if (side_a) { add(side_ne, side_se); }
+			if (side_b) { add(-side_ne, -side_se); }
+		}
+		return count;
+	}
+
+	/**
+	 * lines stop at cells with a larger heuristic cost,
+	 * as the search would drop them anyway.
+	 */
+	cost_t max_heuristic;
+
+private:
+	/**
+	 * checks the cell a line moved to, returns whether the line ends there.
+	 */
+	bool stops_at(const coord::phys3 &pos, jump_result &result) const {
+		if (not this->passable(pos) or this->heuristic(pos) > this->max_heuristic) {
+			result = jump_result::blocked;
+			return true;
+		}
+		if (this->valid_end(pos)) {
+			result = jump_result::found;
+			return true;
+		}
+		return false;
+	}
+
+	jump_result jump_straight(coord::phys3 &pos, int dne, int dse) const {
+		const coord::phys3_delta step{dne * path_grid_size, dse * path_grid_size, 0};
+		int side_ne = dse, side_se = dne;
+
+		// the sides of the previous cell are behind the current ones
+		bool behind_a = this->open(pos, side_ne, side_se);
+		bool behind_b = this->open(pos, -side_ne, -side_se);
+
+		jump_result result;
+		for (int i = 0; i < max_jump; i++) {
+			pos += step;
+			if (this->stops_at(pos, result)) {
+				return result;
+			}
+
+			// a side cell is a forced neighbor if the one behind it is blocked
+			bool side_a = this->open(pos, side_ne, side_se);
+			bool side_b = this->open(pos, -side_ne, -side_se);
+			if ((side_a and not behind_a) or (side_b and not behind_b)) {
+				return jump_result::found;
+			}
+			behind_a = side_a;
+			behind_b = side_b;
+		}
+		return jump_result::limit;
+	}
+
+	jump_result jump_diagonal(coord::phys3 &pos, int dne, int dse) const {
+		const coord::phys3_delta step{dne * path_grid_size, dse * path_grid_size, 0};
+
+		jump_result result;
+		for (int i = 0; i < max_jump; i++) {
+			// diagonal moves must not cut corners
+			if (not (this->open(pos, dne, 0) and this->open(pos, 0, dse))) {
+				return jump_result::blocked;
+			}
+
+			pos += step;
+			if (this->stops_at(pos, result)) {
+				return result;
+			}
+
+			// a line that had to stop counts as reaching a jump point,
+			// otherwise the cells after its end could be missed.
+			coord::phys3 ne_pos = pos;
+			coord::phys3 se_pos = pos;
+			if (this->jump_straight(ne_pos, dne, 0) != jump_result::blocked or
+			    this->jump_straight(se_pos, 0, dse) != jump_result::blocked) {
+				return jump_result::found;
+			}
+		}
+		return jump_result::limit;
+	}
+
+	const std::function<bool(const coord::phys3 &)> &valid_end;
+	const std::function<cost_t(const coord::phys3 &)> &heuristic;
+	const std::function<bool(const coord::phys3 &)> &passable;
+};
+
+
+int sign(coord::phys_t value) {
+	return (value > 0) - (value < 0);
+}
+
+
+/**
+ * Updates the node at n_pos, or creates it, if it's cheaper
+ * to reach from best_candidate than before.
+ * neighbor is the node at n_pos, or no_node.
+ * Without turn_cost, the movement cost is just the distance.
+ */
+void relax(SearchContext &search,
+           node_id best_candidate,
+           const coord::phys3 &n_pos,
+           node_id neighbor,
+           const std::function<cost_t(const coord::phys3 &)> &heuristic,
+           node_id closest_node,
+           bool turn_cost) {
+
+	bool not_visited = (neighbor == no_node);
+
+	// nodes keep the direction they were first reached from
+	search_node candidate = not_visited ? search.make_node(n_pos, best_candidate) : search.get(neighbor);
+
+	const search_node &best = search.get(best_candidate);
+	cost_t move_cost;
+	if (turn_cost) {
+		move_cost = best.cost_to(candidate);
+	}
+	else {
+		move_cost = std::hypot(n_pos.ne - best.position.ne, n_pos.se - best.position.se);
+	}
+	cost_t new_past_cost = best.past_cost + move_cost;
+
+	// if new cost is better than the previous path
+	if (not_visited or new_past_cost < candidate.past_cost) {
+		if (not_visited) {
+			// calculate heuristic only once per node
+			candidate.heuristic_cost = heuristic(n_pos);
+		}
+		if (candidate.heuristic_cost > search.get(closest_node).heuristic_cost * 3) {
+			return; // dont search forever...
+		}
+
+		// update new cost knowledge
+		candidate.past_cost   = new_past_cost;
+		candidate.future_cost = candidate.past_cost + candidate.heuristic_cost;
+		candidate.predecessor = best_candidate;
+
+		if (not_visited) {
+			search.open_push(search.insert(candidate));
+		}
+		else {
+			search.get(neighbor) = candidate;
+			search.open_decrease(neighbor);
+		}
+	}
+}
+
+} // anonymous namespace
+
+
 Path to_point(coord::phys3 start,
               coord::phys3 end,
-              std::function<bool(const coord::phys3 &)> passable) {
+              std::function<bool(const coord::phys3 &)> passable,
+              search_mode mode) {
 	auto valid_end = [&](const coord::phys3 &point) -> bool {
 		coord::phys_t dx = point.ne - end.ne;
 		coord::phys_t dy = point.se - end.se;
 		return std::hypot(dx, dy) < path_grid_size;
 	};
 	auto h = [&](const coord::phys3 &point) -> cost_t { return euclidean_cost(point, end); };
-	return a_star(start, valid_end, h, passable);
+	Path path = a_star(start, valid_end, h, passable, mode);
+	path.smooth(start, passable);
+	return path;
+}
+
+
+Path detour(coord::phys3 start,
+            coord::phys3 end,
+            std::function<bool(const coord::phys3 &)> passable,
+            coord::phys_t margin) {
+	auto distance = [](const coord::phys3 &a, const coord::phys3 &b) {
+		return std::hypot(a.ne - b.ne, a.se - b.se);
+	};
+	auto valid_end = [&](const coord::phys3 &point) -> bool {
+		return distance(point, end) < path_grid_size;
+	};
+	auto h = [&](const coord::phys3 &point) -> cost_t { return euclidean_cost(point, end); };
+
+	// the positions whose distances to start and end sum up
+	// to at most the bound form an ellipse around the line.
+	double bound = distance(start, end) + 2.0 * margin;
+	auto bounded = [&](const coord::phys3 &point) -> bool {
+		return distance(point, start) + distance(point, end) <= bound and passable(point);
+	};
+
+	Path path = a_star(start, valid_end, h, bounded);
+	if (path.waypoints.empty() or not valid_end(path.waypoints.front().position)) {
+		return Path{};
+	}
+
+	path.smooth(start, bounded);
+	return path;
 }
 
 
@@ -50,7 +323,9 @@ Path to_object(openage::TerrainObject *to_move,
 	auto heuristic = [&](const coord::phys3 &pos) -> cost_t {
 		return end->from_edge(pos) - to_move->min_axis() / 2;
 	};
-	return a_star(start, valid_end, heuristic, to_move->passable);
+	Path path = a_star(start, valid_end, heuristic, to_move->passable);
+	path.smooth(start, to_move->passable);
+	return path;
 }
 
 
@@ -59,93 +334,127 @@ Path find_nearest(coord::phys3 start,
                   std::function<bool(const coord::phys3 &)> passable) {
 	// Use Dijkstra (hueristic = 0)
 	auto zero = [](const coord::phys3 &) -> cost_t { return .0f; };
-	return a_star(start, valid_end, zero, passable);
+	Path path = a_star(start, valid_end, zero, passable);
+	path.smooth(start, passable);
+	return path;
 }
 
 Path a_star(coord::phys3 start,
             std::function<bool(const coord::phys3 &)> valid_end,
             std::function<cost_t(const coord::phys3 &)> heuristic,
-            std::function<bool(const coord::phys3 &)> passable) {
+            std::function<bool(const coord::phys3 &)> passable,
+            search_mode mode) {
+
+	// node pool, position lookup and open list.
+	// reused between searches to avoid allocations.
+	#if HAVE_THREAD_LOCAL_STORAGE
+	static thread_local SearchContext search;
+	#else
+	SearchContext search;
+	#endif
+
+	return a_star(search, start, valid_end, heuristic, passable, mode);
+}
+
+
+Path a_star(SearchContext &search,
+            coord::phys3 start,
+            std::function<bool(const coord::phys3 &)> valid_end,
+            std::function<cost_t(const coord::phys3 &)> heuristic,
+            std::function<bool(const coord::phys3 &)> passable,
+            search_mode mode) {
 
-	// path node storage, always provides cheapest next node.
-	heap_t node_candidates;
+	JumpGrid grid{valid_end, heuristic, passable};
 
-	// list of known tiles and corresponding node.
-	nodemap_t visited_tiles;
+	search.reset(start);
 
 	// add starting node
-	node_pt start_node = std::make_shared<Node>(start, nullptr, .0f, heuristic(start));
-	visited_tiles[start_node->position] = start_node;
-	node_candidates.push(start_node);
+	search_node start_data = search.make_node(start, no_node);
+	start_data.heuristic_cost = heuristic(start);
+	start_data.future_cost    = start_data.heuristic_cost;
 
-	start_node->heap_node = node_candidates.push(start_node);
+	node_id start_node = search.insert(start_data);
+	search.open_push(start_node);
 
 	// track the closest we can get to the end position
 	// used when no path is found
-	node_pt closest_node = start_node;
+	node_id closest_node = start_node;
 
 	// while there are candidates to visit
-	while (not node_candidates.empty()) {
-		node_pt best_candidate = node_candidates.pop();
+	while (not search.open_empty()) {
+		// the unit may not need the path anymore
+		job::CancellationToken::current().check();
 
-		best_candidate->was_best = true;
+		node_id best_candidate = search.open_pop();
+		search.get(best_candidate).closed = true;
 
 		// node to terminate the search was found
-		if (valid_end(best_candidate->position)) {
+		if (valid_end(search.get(best_candidate).position)) {
 			log::log(MSG(dbg) <<
 				"path cost is " <<
-				util::FloatFixed<3, 8>{closest_node->future_cost / coord::settings::phys_per_tile});
+				util::FloatFixed<3, 8>{search.get(closest_node).future_cost / coord::settings::phys_per_tile});
 
-			return best_candidate->generate_backtrace();
+			return search.backtrace(best_candidate);
 		}
 
 		// closest node for cases when target cannot be reached
-		if (best_candidate->heuristic_cost < closest_node->heuristic_cost) {
+		if (search.get(best_candidate).heuristic_cost < search.get(closest_node).heuristic_cost) {
 			closest_node = best_candidate;
 		}
 
-		// evaluate all neighbors of the current candidate for further progress
-		for (node_pt neighbor : best_candidate->get_neighbors(visited_tiles)) {
-			if (neighbor->was_best) {
-				continue;
-			}
-			if (not passable_line(best_candidate, neighbor, passable)) {
-				continue;
+		if (mode == search_mode::jump_points) {
+			const search_node &best = search.get(best_candidate);
+			coord::phys3 best_pos = best.position;
+
+			int dir_ne = 0, dir_se = 0;
+			if (best.predecessor != no_node) {
+				const coord::phys3 &prev_pos = search.get(best.predecessor).position;
+				dir_ne = sign(best_pos.ne - prev_pos.ne);
+				dir_se = sign(best_pos.se - prev_pos.se);
 			}
 
-			bool not_visited = (visited_tiles.count(neighbor->position) == 0);
-			cost_t new_past_cost = best_candidate->past_cost + best_candidate->cost_to(*neighbor);
+			grid.max_heuristic = search.get(closest_node).heuristic_cost * 3;
 
-			// if new cost is better than the previous path
-			if (not_visited or new_past_cost < neighbor->past_cost) {
-				if (not_visited) {
-					// calculate heuristic only once per node
-					neighbor->heuristic_cost = heuristic(neighbor->position);
+			int dirs[8][2];
+			int count = grid.successors(best_pos, dir_ne, dir_se, dirs);
+			for (int d = 0; d < count; ++d) {
+				coord::phys3 n_pos = best_pos;
+				if (grid.jump(n_pos, dirs[d][0], dirs[d][1]) == jump_result::blocked) {
+					continue;
 				}
-				if (neighbor->heuristic_cost > closest_node->heuristic_cost * 3) {
-					continue; // dont search forever...
+
+				node_id neighbor = search.find(n_pos);
+				if (neighbor != no_node and search.get(neighbor).closed) {
+					continue;
 				}
+				relax(search, best_candidate, n_pos, neighbor, heuristic, closest_node, false);
+			}
+			continue;
+		}
 
-				// update new cost knowledge
-				neighbor->past_cost        = new_past_cost;
-				neighbor->future_cost      = neighbor->past_cost + neighbor->heuristic_cost;
-				neighbor->path_predecessor = best_candidate;
+		// evaluate all neighbors of the current candidate for further progress
+		for (int n = 0; n < 8; ++n) {
+			// the pool may grow below, so don't hold references across insert().
+			const coord::phys3 best_pos = search.get(best_candidate).position;
+			coord::phys3 n_pos = best_pos + neigh_phys[n];
 
-				if (not_visited) {
-					neighbor->heap_node = node_candidates.push(neighbor);
-					visited_tiles[neighbor->position] = neighbor;
-				} else {
-					node_candidates.update(neighbor->heap_node);
-				}
+			node_id neighbor = search.find(n_pos);
+			if (neighbor != no_node and search.get(neighbor).closed) {
+				continue;
 			}
+			if (not passable_line(best_pos, n_pos, passable)) {
+				continue;
+			}
+
+			relax(search, best_candidate, n_pos, neighbor, heuristic, closest_node, true);
 		}
 	}
 
 	log::log(MSG(dbg) <<
 		"incomplete path cost is " <<
-		util::FloatFixed<3, 8>{closest_node->future_cost / coord::settings::phys_per_tile});
+		util::FloatFixed<3, 8>{search.get(closest_node).future_cost / coord::settings::phys_per_tile});
 
-	return closest_node->generate_backtrace();
+	return search.backtrace(closest_node);
 }
 
 
@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -13,12 +13,53 @@ class TerrainObject;
 
 namespace path {
 
+class SearchContext;
+
+/**
+ * How a search finds the successors of a node.
+ */
+enum class search_mode {
+	/**
+	 * all 8 neighbors of each node, works with any movement cost.
+	 */
+	neighbors,
+
+	/**
+	 * Jump Point Search: follows straight and diagonal lines over the
+	 * grid until a node where the path may have to turn, so symmetric
+	 * paths on open ground aren't expanded node by node.
+	 *
+	 * Treats the grid positions as cells which are either passable
+	 * or not, and only moves diagonally if both adjacent cells are
+	 * passable. Moves cost their length, turns are not penalized.
+	 * The path only contains the jump points.
+	 *
+	 * Each line tests many cells, so this pays off where the passable
+	 * function is cheap compared to expanding nodes.
+	 */
+	jump_points,
+};
+
 /**
  * path between two static points
  */
 Path to_point(coord::phys3 start,
               coord::phys3 end,
-              std::function<bool(const coord::phys3 &)> passable);
+              std::function<bool(const coord::phys3 &)> passable,
+              search_mode mode=search_mode::neighbors);
+
+/**
+ * path between two points which doesn't go further than margin
+ * beyond the straight line between them, e.g. to repair a path
+ * around a new obstruction without searching the whole map.
+ *
+ * @return the path, or an empty path if end can't be reached
+ *         within the margin.
+ */
+Path detour(coord::phys3 start,
+            coord::phys3 end,
+            std::function<bool(const coord::phys3 &)> passable,
+            coord::phys_t margin);
 
 /**
  * path between 2 objects, with how close to come to end point
@@ -40,12 +81,25 @@ Path find_nearest(coord::phys3 start,
  * @param end the ending tile coords
  * @param heuristic the heuristic for evaluating cost
  * @param passable lambda to decide which terrain is passable
+ * @param mode how the successors of the nodes are found
  * @return path between the given tiles
  */
 Path a_star(coord::phys3 start,
             std::function<bool(const coord::phys3 &)> valid_end,
             std::function<cost_t(const coord::phys3 &)> heuristic,
-            std::function<bool(const coord::phys3 &)> passable);
+            std::function<bool(const coord::phys3 &)> passable,
+            search_mode mode=search_mode::neighbors);
+
+/**
+ * A* search using the given context for the node storage.
+ * Same as above, but lets the caller own the search buffers.
+ */
+Path a_star(SearchContext &search,
+            coord::phys3 start,
+            std::function<bool(const coord::phys3 &)> valid_end,
+            std::function<cost_t(const coord::phys3 &)> heuristic,
+            std::function<bool(const coord::phys3 &)> passable,
+            search_mode mode=search_mode::neighbors);
 
 } // namespace path
 } // namespace openage
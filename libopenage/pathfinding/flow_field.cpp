@@ -0,0 +1,228 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "flow_field.h"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include "../coord/tile3.h"
+#include "../log/log.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../util/misc.h"
+#include "hierarchical.h"
+
+namespace openage {
+namespace path {
+
+namespace {
+
+constexpr cost_t infinite_cost = std::numeric_limits<cost_t>::infinity();
+
+/**
+ * The eight tile neighbors, straight ones first.
+ */
+constexpr coord::tile_delta const neigh_tiles[] = {
+	{ 1,  0},
+	{ 0,  1},
+	{-1,  0},
+	{ 0, -1},
+	{ 1,  1},
+	{-1,  1},
+	{-1, -1},
+	{ 1, -1}
+};
+
+} // anonymous namespace
+
+
+FlowField::FlowField(coord::tile goal,
+                     int radius,
+                     const std::function<bool(const coord::tile &)> &passable)
+	:
+	goal{goal},
+	origin{goal.ne - radius, goal.se - radius},
+	size{2 * radius + 1},
+	integration(size * size, infinite_cost),
+	directions(size * size, -1) {
+
+	// passability of all covered tiles, evaluated once
+	std::vector<bool> open(this->size * this->size);
+	for (int se = 0; se < this->size; se++) {
+		for (int ne = 0; ne < this->size; ne++) {
+			open[se * this->size + ne] = passable(this->origin + coord::tile_delta{ne, se});
+		}
+	}
+
+	// integration field: dijkstra from the goal, 8-connected
+	// without cutting the corners of obstacles.
+	using entry = std::pair<cost_t, int>;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry>> candidates;
+
+	int goal_idx = this->index(goal);
+	this->integration[goal_idx] = 0;
+	candidates.push({0, goal_idx});
+
+	const cost_t straight = coord::settings::phys_per_tile;
+	const cost_t diagonal = straight * std::sqrt(2.0f);
+
+	while (not candidates.empty()) {
+		entry current = candidates.top();
+		candidates.pop();
+
+		if (current.first > this->integration[current.second]) {
+			continue;
+		}
+
+		int ne = current.second % this->size;
+		int se = current.second / this->size;
+
+		for (int n = 0; n < 8; n++) {
+			const coord::tile_delta &d = neigh_tiles[n];
+			int nne = ne + d.ne;
+			int nse = se + d.se;
+			if (nne < 0 or nne >= this->size or nse < 0 or nse >= this->size) {
+				continue;
+			}
+
+			int idx = nse * this->size + nne;
+			if (not open[idx]) {
+				continue;
+			}
+
+			cost_t step = straight;
+			if (d.ne != 0 and d.se != 0) {
+				if (not open[se * this->size + nne] or not open[nse * this->size + ne]) {
+					continue;
+				}
+				step = diagonal;
+			}
+
+			cost_t cost = current.first + step;
+			if (cost < this->integration[idx]) {
+				this->integration[idx] = cost;
+
+				// the way back leads to the tile we came from
+				this->directions[idx] = (n + 2) % 4 + (n / 4) * 4;
+				candidates.push({cost, idx});
+			}
+		}
+	}
+}
+
+
+coord::tile FlowField::get_goal() const {
+	return this->goal;
+}
+
+
+int FlowField::index(const coord::tile &position) const {
+	coord::tile_delta offset = position - this->origin;
+	if (offset.ne < 0 or offset.ne >= this->size or
+	    offset.se < 0 or offset.se >= this->size) {
+		return -1;
+	}
+	return offset.se * this->size + offset.ne;
+}
+
+
+bool FlowField::direction(const coord::tile &position, coord::tile_delta &dir) const {
+	int idx = this->index(position);
+	if (idx < 0 or this->directions[idx] < 0) {
+		return false;
+	}
+	dir = neigh_tiles[this->directions[idx]];
+	return true;
+}
+
+
+cost_t FlowField::cost(const coord::tile &position) const {
+	int idx = this->index(position);
+	if (idx < 0) {
+		return infinite_cost;
+	}
+	return this->integration[idx];
+}
+
+
+bool FlowFieldCache::field_key::operator ==(const field_key &other) const {
+	return this->mover == other.mover and this->goal == other.goal;
+}
+
+
+size_t FlowFieldCache::field_key_hash::operator ()(const field_key &key) const {
+	size_t hash = std::hash<const void *>{}(key.mover);
+	return util::rol<size_t, 1>(hash) ^ std::hash<coord::tile>{}(key.goal);
+}
+
+
+FlowFieldCache::FlowFieldCache(Terrain *terrain, size_t capacity)
+	:
+	terrain{terrain},
+	capacity{capacity} {}
+
+
+bool FlowFieldCache::tile_passable(const coord::tile &tile,
+                                   const std::function<bool(const coord::phys3 &)> &passable) {
+	ChunkGraph &graph = this->terrain->get_path_graph();
+	if (not graph.tile_passable(tile)) {
+		return false;
+	}
+
+	if (passable(tile.to_tile3().to_phys3())) {
+		return true;
+	}
+
+	// the tile may only be blocked by a unit which moves away
+	TileContent *tc = this->terrain->get_data(tile);
+	for (auto obj : tc->obj) {
+		if (obj->check_collisions()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+std::shared_ptr<const FlowField> FlowFieldCache::get(const void *mover,
+                                                     coord::tile goal,
+                                                     const std::function<bool(const coord::phys3 &)> &passable) {
+	field_key key{mover, goal};
+	size_t revision = this->terrain->get_path_graph().get_revision();
+
+	auto it = this->lookup.find(key);
+	if (it != std::end(this->lookup)) {
+		if (it->second->revision == revision) {
+			// move to the front as most recently used
+			this->entries.splice(std::begin(this->entries), this->entries, it->second);
+			return it->second->field;
+		}
+
+		// obstacles changed, the field has to be rebuilt
+		this->entries.erase(it->second);
+		this->lookup.erase(it);
+	}
+
+	auto field = std::make_shared<const FlowField>(
+		goal, flow_field_radius,
+		[this, &passable](const coord::tile &tile) {
+			return this->tile_passable(tile, passable);
+		}
+	);
+
+	log::log(MSG(dbg) << "calculated flow field to (" << goal.ne << ", " << goal.se << ")");
+
+	this->entries.push_front({key, revision, field});
+	this->lookup[key] = std::begin(this->entries);
+
+	if (this->entries.size() > this->capacity) {
+		this->lookup.erase(this->entries.back().key);
+		this->entries.pop_back();
+	}
+
+	return field;
+}
+
+}} // namespace openage::path
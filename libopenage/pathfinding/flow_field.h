@@ -0,0 +1,167 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "path.h"
+
+namespace openage {
+
+class Terrain;
+
+namespace path {
+
+/**
+ * Size of move orders from which on the units
+ * share one flow field instead of searching paths.
+ */
+constexpr size_t flow_field_group_size = 32;
+
+/**
+ * Maximum distance in tiles from the goal covered by a flow field.
+ */
+constexpr int flow_field_radius = 64;
+
+/**
+ * Number of tiles a unit plans ahead when following a flow field.
+ */
+constexpr int flow_field_lookahead = 2;
+
+/**
+ * Movement directions for a whole area towards one goal tile.
+ *
+ * The integration field stores the movement cost from each tile
+ * to the goal, the direction field the neighbor tile to move to
+ * next. Units moving to the goal just look up their direction.
+ */
+class FlowField {
+public:
+	/**
+	 * Calculate the field for the tiles around the goal.
+	 *
+	 * @param goal the tile to move to
+	 * @param radius max distance from the goal in tiles
+	 * @param passable whether a tile can be entered
+	 */
+	FlowField(coord::tile goal,
+	          int radius,
+	          const std::function<bool(const coord::tile &)> &passable);
+
+	/**
+	 * The tile the field leads to.
+	 */
+	coord::tile get_goal() const;
+
+	/**
+	 * Find the neighbor tile to move to from the given tile.
+	 *
+	 * @returns false if the goal can't be reached from the tile,
+	 *          or the tile is not covered by the field.
+	 */
+	bool direction(const coord::tile &position, coord::tile_delta &dir) const;
+
+	/**
+	 * Movement cost from the tile to the goal.
+	 * Infinite if the goal can't be reached.
+	 */
+	cost_t cost(const coord::tile &position) const;
+
+private:
+	/**
+	 * Index of the tile in the field, -1 if not covered.
+	 */
+	int index(const coord::tile &position) const;
+
+	coord::tile goal;
+
+	/**
+	 * Tile with the lowest coordinates covered by the field.
+	 */
+	coord::tile origin;
+
+	/**
+	 * Edge length of the covered square.
+	 */
+	int size;
+
+	/**
+	 * Movement cost to the goal for each tile.
+	 */
+	std::vector<cost_t> integration;
+
+	/**
+	 * Index into the neighbor directions for each tile,
+	 * -1 if there is no way to the goal.
+	 */
+	std::vector<int8_t> directions;
+};
+
+
+/**
+ * Keeps the recently used flow fields of a terrain.
+ *
+ * Fields are rebuilt if static obstacles changed since they were
+ * calculated. The least recently used field is dropped when the
+ * cache is full.
+ */
+class FlowFieldCache {
+public:
+	FlowFieldCache(Terrain *terrain, size_t capacity=16);
+
+	/**
+	 * Get the field leading to the goal tile for a kind of mover,
+	 * calculating it if necessary.
+	 *
+	 * @param mover all units sharing the mover have the same movement rules
+	 * @param passable passability test of one of the units, see TerrainObject::passable
+	 */
+	std::shared_ptr<const FlowField> get(const void *mover,
+	                                     coord::tile goal,
+	                                     const std::function<bool(const coord::phys3 &)> &passable);
+
+private:
+	struct field_key {
+		const void *mover;
+		coord::tile goal;
+
+		bool operator ==(const field_key &other) const;
+	};
+
+	struct field_key_hash {
+		size_t operator ()(const field_key &key) const;
+	};
+
+	struct cache_entry {
+		field_key key;
+		size_t revision;
+		std::shared_ptr<const FlowField> field;
+	};
+
+	/**
+	 * Can the mover enter the tile? Other moving units are ignored,
+	 * they would mostly be the ones moving in the same group.
+	 */
+	bool tile_passable(const coord::tile &tile,
+	                   const std::function<bool(const coord::phys3 &)> &passable);
+
+	Terrain *terrain;
+	size_t capacity;
+
+	/**
+	 * Cached fields, the most recently used first.
+	 */
+	std::list<cache_entry> entries;
+
+	std::unordered_map<field_key, std::list<cache_entry>::iterator, field_key_hash> lookup;
+};
+
+} // namespace path
+} // namespace openage
@@ -0,0 +1,752 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+/** @file
+ *
+ * Hierarchical pathfinding over terrain chunks.
+ *
+ * Literature:
+ * Botea, Adi, Martin Müller, and Jonathan Schaeffer. "Near optimal
+ * hierarchical path-finding." Journal of Game Development 1, no. 1
+ * (2004): 7-28.
+ */
+
+#include "hierarchical.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include "../coord/tile3.h"
+#include "../job/cancellation_token.h"
+#include "../log/log.h"
+#include "../terrain/terrain_chunk.h"
+#include "../terrain/terrain_object.h"
+#include "a_star.h"
+
+namespace openage {
+namespace path {
+
+namespace {
+
+constexpr cost_t infinite_cost = std::numeric_limits<cost_t>::infinity();
+
+/**
+ * Border sections longer than this get a portal at each end,
+ * shorter ones a single portal in the middle.
+ */
+constexpr int max_single_portal = 6;
+
+/**
+ * The four directions to neighboring chunks.
+ */
+constexpr coord::tile_delta const border_dirs[] = {
+	{ 1,  0},
+	{-1,  0},
+	{ 0,  1},
+	{ 0, -1}
+};
+
+/**
+ * The chunk offset for one of the border directions.
+ */
+inline coord::chunk_delta chunk_dir(coord::tile_delta dir) {
+	return {static_cast<coord::chunk_t>(dir.ne), static_cast<coord::chunk_t>(dir.se)};
+}
+
+/**
+ * Index of a tile in the per-chunk tile vectors.
+ */
+inline int tile_index(coord::tile position) {
+	coord::tile_delta offset = position.get_pos_on_chunk();
+	return offset.se * chunk_size + offset.ne;
+}
+
+/**
+ * Identifies a portal in the abstract search.
+ * The portal index -1 denotes the search goal.
+ */
+struct abstract_node {
+	coord::chunk chunk;
+	int portal;
+
+	bool operator ==(const abstract_node &other) const {
+		return this->chunk == other.chunk and this->portal == other.portal;
+	}
+};
+
+/**
+ * Bookkeeping for a visited portal.
+ */
+struct abstract_visit {
+	cost_t cost;
+	abstract_node predecessor;
+	bool closed;
+};
+
+/**
+ * Open list entry of the abstract search.
+ */
+struct abstract_candidate {
+	cost_t future_cost;
+	cost_t past_cost;
+	abstract_node node;
+
+	bool operator >(const abstract_candidate &other) const {
+		return this->future_cost > other.future_cost;
+	}
+};
+
+/**
+ * Estimated movement cost between two tiles.
+ */
+cost_t tile_distance(coord::tile a, coord::tile b) {
+	return std::hypot(a.ne - b.ne, a.se - b.se) * coord::settings::phys_per_tile;
+}
+
+/**
+ * Chebyshev distance between two chunks.
+ */
+int chunk_distance(coord::chunk a, coord::chunk b) {
+	return std::max(std::abs(a.ne - b.ne), std::abs(a.se - b.se));
+}
+
+/**
+ * Root of an element in a union-find forest, halving the path to it.
+ */
+size_t find_root(std::vector<size_t> &parents, size_t element) {
+	while (parents[element] != element) {
+		parents[element] = parents[parents[element]];
+		element = parents[element];
+	}
+	return element;
+}
+
+} // anonymous namespace
+
+
+ChunkGraph::ChunkGraph(Terrain *terrain)
+	:
+	terrain{terrain},
+	revision{0} {}
+
+
+void ChunkGraph::invalidate(coord::tile position) {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+	this->revision += 1;
+
+	coord::chunk chunk = position.to_chunk();
+	this->dirty.insert(chunk);
+	this->chunk_revisions[chunk] = this->revision;
+	for (auto &layer : this->areas) {
+		layer.second.dirty.insert(chunk);
+	}
+
+	// the portals on a border are shared with the chunk behind it
+	for (auto &dir : border_dirs) {
+		coord::chunk other = (position + dir).to_chunk();
+		if (not (other == chunk)) {
+			this->dirty.insert(other);
+			this->chunk_revisions[other] = this->revision;
+		}
+	}
+}
+
+
+void ChunkGraph::invalidate_chunk(coord::chunk position) {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+	this->revision += 1;
+
+	this->dirty.insert(position);
+	this->chunk_revisions[position] = this->revision;
+	for (auto &dir : border_dirs) {
+		this->dirty.insert(position + chunk_dir(dir));
+		this->chunk_revisions[position + chunk_dir(dir)] = this->revision;
+	}
+	for (auto &layer : this->areas) {
+		layer.second.dirty.insert(position);
+	}
+}
+
+
+bool ChunkGraph::tile_passable(coord::tile position) {
+	TerrainChunk *chunk = this->terrain->get_chunk(position);
+	if (chunk == nullptr) {
+		return false;
+	}
+	return not test_tile(chunk->obstacles, TerrainChunk::tile_index(position));
+}
+
+
+bool ChunkGraph::reachable(coord::tile start, coord::tile end, size_t layer) {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+	const layer_areas &areas = this->get_areas(layer);
+
+	size_t start_component = this->component(areas, start);
+	if (start_component == no_component) {
+		return true;
+	}
+	return this->component(areas, end) == start_component;
+}
+
+
+bool ChunkGraph::nearest_reachable(coord::tile start, coord::tile target, size_t layer,
+                                   coord::tile &result) {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+	const layer_areas &areas = this->get_areas(layer);
+
+	size_t start_component = this->component(areas, start);
+	if (start_component == no_component) {
+		return false;
+	}
+
+	// search rings of growing distance around the target. a tile of
+	// ring r is at least r tiles away, so the search ends at the ring
+	// beyond the closest tile found so far.
+	int best_distance = -1;
+	for (int r = 0; r <= max_snap_distance; r++) {
+		if (best_distance >= 0 and r * r >= best_distance) {
+			break;
+		}
+
+		for (int dse = -r; dse <= r; dse++) {
+			// only the border of the ring
+			int step = (dse == -r or dse == r) ? 1 : 2 * r;
+			for (int dne = -r; dne <= r; dne += step) {
+				coord::tile position = target + coord::tile_delta{dne, dse};
+				int distance = dne * dne + dse * dse;
+				if ((best_distance < 0 or distance < best_distance) and
+				    this->component(areas, position) == start_component) {
+					best_distance = distance;
+					result = position;
+				}
+			}
+		}
+	}
+
+	return best_distance >= 0;
+}
+
+
+size_t ChunkGraph::get_revision() {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+	return this->revision;
+}
+
+
+size_t ChunkGraph::get_chunk_revision(coord::chunk position) {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+	auto it = this->chunk_revisions.find(position);
+	if (it == this->chunk_revisions.end()) {
+		return 0;
+	}
+	return it->second;
+}
+
+
+const chunk_portals *ChunkGraph::get_portals(coord::chunk position) {
+	if (this->terrain->get_chunk(position) == nullptr) {
+		return nullptr;
+	}
+
+	auto it = this->chunks.find(position);
+	if (it == this->chunks.end()) {
+		it = this->chunks.emplace(position, chunk_portals{}).first;
+		this->build_chunk(position, it->second);
+		this->dirty.erase(position);
+	}
+	else if (this->dirty.erase(position) > 0) {
+		this->build_chunk(position, it->second);
+	}
+
+	return &it->second;
+}
+
+
+std::vector<bool> ChunkGraph::passable_tiles(coord::chunk position) {
+	std::vector<bool> passable(chunk_size * chunk_size);
+
+	for (size_t se = 0; se < chunk_size; se++) {
+		for (size_t ne = 0; ne < chunk_size; ne++) {
+			coord::tile_delta offset{(coord::tile_t) ne, (coord::tile_t) se};
+			passable[se * chunk_size + ne] = this->tile_passable(position.to_tile(offset));
+		}
+	}
+	return passable;
+}
+
+
+std::vector<cost_t> ChunkGraph::chunk_costs(coord::tile start,
+                                            const std::vector<bool> &passable) {
+	std::vector<cost_t> costs(chunk_size * chunk_size, infinite_cost);
+
+	int start_idx = tile_index(start);
+	if (not passable[start_idx]) {
+		return costs;
+	}
+
+	// dijkstra on the tiles of the chunk, 8-connected
+	// without cutting the corners of obstacles.
+	using entry = std::pair<cost_t, int>;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+
+	costs[start_idx] = 0;
+	open.push({0, start_idx});
+
+	const cost_t straight = coord::settings::phys_per_tile;
+	const cost_t diagonal = straight * std::sqrt(2.0f);
+	const int size = chunk_size;
+
+	while (not open.empty()) {
+		entry current = open.top();
+		open.pop();
+
+		if (current.first > costs[current.second]) {
+			continue;
+		}
+
+		int ne = current.second % size;
+		int se = current.second / size;
+
+		for (int dse = -1; dse <= 1; dse++) {
+			for (int dne = -1; dne <= 1; dne++) {
+				int nne = ne + dne;
+				int nse = se + dse;
+
+				if ((dne == 0 and dse == 0) or
+				    nne < 0 or nne >= size or nse < 0 or nse >= size) {
+					continue;
+				}
+
+				int idx = nse * size + nne;
+				if (not passable[idx]) {
+					continue;
+				}
+
+				cost_t step = straight;
+				if (dne != 0 and dse != 0) {
+					if (not passable[se * size + nne] or not passable[nse * size + ne]) {
+						continue;
+					}
+					step = diagonal;
+				}
+
+				cost_t cost = current.first + step;
+				if (cost < costs[idx]) {
+					costs[idx] = cost;
+					open.push({cost, idx});
+				}
+			}
+		}
+	}
+
+	return costs;
+}
+
+
+void ChunkGraph::build_chunk(coord::chunk position, chunk_portals &data) {
+	data.portals.clear();
+	data.costs.clear();
+
+	coord::tile origin = position.to_tile({0, 0});
+	const int size = chunk_size;
+
+	// place portals on the passable sections of each border.
+	// the neighbor chunk scans the same tiles in the same order,
+	// so both sides agree on the portal positions.
+	for (auto &dir : border_dirs) {
+		if (this->terrain->get_chunk(position + chunk_dir(dir)) == nullptr) {
+			continue;
+		}
+
+		auto border_tile = [&](int i) -> coord::tile {
+			coord::tile result = origin;
+			if (dir.ne != 0) {
+				result.ne += (dir.ne > 0) ? size - 1 : 0;
+				result.se += i;
+			}
+			else {
+				result.ne += i;
+				result.se += (dir.se > 0) ? size - 1 : 0;
+			}
+			return result;
+		};
+
+		int section_start = -1;
+		for (int i = 0; i <= size; i++) {
+			bool open = false;
+			if (i < size) {
+				coord::tile inside = border_tile(i);
+				open = this->tile_passable(inside) and this->tile_passable(inside + dir);
+			}
+
+			if (open and section_start < 0) {
+				section_start = i;
+			}
+			else if (not open and section_start >= 0) {
+				int length = i - section_start;
+				if (length <= max_single_portal) {
+					data.portals.push_back({border_tile(section_start + length / 2), dir});
+				}
+				else {
+					data.portals.push_back({border_tile(section_start), dir});
+					data.portals.push_back({border_tile(i - 1), dir});
+				}
+				section_start = -1;
+			}
+		}
+	}
+
+	// movement costs between all portals of the chunk
+	std::vector<bool> passable = this->passable_tiles(position);
+	size_t count = data.portals.size();
+	data.costs.resize(count * count, infinite_cost);
+
+	for (size_t from = 0; from < count; from++) {
+		std::vector<cost_t> costs = this->chunk_costs(data.portals[from].position, passable);
+		for (size_t to = 0; to < count; to++) {
+			data.costs[from * count + to] = costs[tile_index(data.portals[to].position)];
+		}
+	}
+
+	log::log(MSG(spam) << "built path graph for chunk (" << position.ne << ", " << position.se << ") with "
+	         << count << " portals");
+}
+
+
+layer_areas &ChunkGraph::get_areas(size_t layer) {
+	auto it = this->areas.find(layer);
+	if (it == this->areas.end()) {
+		it = this->areas.emplace(layer, layer_areas{}).first;
+		it->second.revision = this->revision - 1;
+	}
+
+	layer_areas &result = it->second;
+	if (result.revision == this->revision) {
+		return result;
+	}
+
+	// only the changed chunks are labeled again,
+	// the labels of the others are still valid.
+	size_t area_count = 0;
+	std::vector<coord::chunk> used = this->terrain->used_chunks();
+	for (auto &position : used) {
+		auto chunk = result.chunks.find(position);
+		if (chunk == result.chunks.end()) {
+			chunk = result.chunks.emplace(position, chunk_areas{}).first;
+			this->build_areas(position, layer, chunk->second);
+		}
+		else if (result.dirty.count(position) > 0) {
+			this->build_areas(position, layer, chunk->second);
+		}
+
+		chunk->second.first = area_count;
+		area_count += chunk->second.count;
+	}
+	result.dirty.clear();
+
+	// join the areas which touch on the borders to the
+	// chunks along ne and se, the other two directions
+	// are covered by the chunks on the other side.
+	std::vector<size_t> &parents = result.components;
+	parents.resize(area_count);
+	for (size_t i = 0; i < area_count; i++) {
+		parents[i] = i;
+	}
+
+	const int size = chunk_size;
+	for (auto &position : used) {
+		const chunk_areas &here = result.chunks.at(position);
+
+		for (int d = 0; d < 2; d++) {
+			coord::tile_delta dir = border_dirs[d * 2];
+			auto other_it = result.chunks.find(position + chunk_dir(dir));
+			if (other_it == result.chunks.end() or
+			    this->terrain->get_chunk(other_it->first) == nullptr) {
+				continue;
+			}
+			const chunk_areas &other = other_it->second;
+
+			for (int i = 0; i < size; i++) {
+				int inside, outside;
+				if (dir.ne != 0) {
+					inside = i * size + size - 1;
+					outside = i * size;
+				}
+				else {
+					inside = (size - 1) * size + i;
+					outside = i;
+				}
+
+				if (here.tiles[inside] < 0 or other.tiles[outside] < 0) {
+					continue;
+				}
+				size_t a = find_root(parents, here.first + here.tiles[inside]);
+				size_t b = find_root(parents, other.first + other.tiles[outside]);
+				parents[std::max(a, b)] = std::min(a, b);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < area_count; i++) {
+		parents[i] = find_root(parents, i);
+	}
+
+	result.revision = this->revision;
+	log::log(MSG(spam) << "joined " << area_count << " areas of path graph layer " << layer);
+
+	return result;
+}
+
+
+void ChunkGraph::build_areas(coord::chunk position, size_t layer, chunk_areas &data) {
+	const int size = chunk_size;
+	TerrainChunk *chunk = this->terrain->get_chunk(position);
+
+	std::vector<bool> passable = this->passable_tiles(position);
+	if (layer != Terrain::no_passability_layer) {
+		for (int se = 0; se < size; se++) {
+			for (int ne = 0; ne < size; ne++) {
+				coord::tile tile = position.to_tile({(coord::tile_t) ne, (coord::tile_t) se});
+				if (not test_tile(chunk->allowed[layer], TerrainChunk::tile_index(tile))) {
+					passable[se * size + ne] = false;
+				}
+			}
+		}
+	}
+
+	// flood fill along the 4 directions. moving diagonally without
+	// cutting corners requires both tiles beside the move to be
+	// passable, so it connects no further tiles.
+	data.tiles.assign(size * size, -1);
+	data.count = 0;
+
+	std::vector<int> open;
+	for (int start = 0; start < size * size; start++) {
+		if (not passable[start] or data.tiles[start] >= 0) {
+			continue;
+		}
+
+		int area = data.count++;
+		data.tiles[start] = area;
+		open.push_back(start);
+
+		while (not open.empty()) {
+			int current = open.back();
+			open.pop_back();
+
+			int ne = current % size;
+			int se = current / size;
+			int neighbors[] = {
+				(ne > 0) ? current - 1 : -1,
+				(ne < size - 1) ? current + 1 : -1,
+				(se > 0) ? current - size : -1,
+				(se < size - 1) ? current + size : -1,
+			};
+
+			for (int next : neighbors) {
+				if (next >= 0 and passable[next] and data.tiles[next] < 0) {
+					data.tiles[next] = area;
+					open.push_back(next);
+				}
+			}
+		}
+	}
+}
+
+
+size_t ChunkGraph::component(const layer_areas &areas, coord::tile position) {
+	auto chunk = areas.chunks.find(position.to_chunk());
+	if (chunk == areas.chunks.end() or this->terrain->get_chunk(position) == nullptr) {
+		return no_component;
+	}
+
+	int area = chunk->second.tiles[tile_index(position)];
+	if (area < 0) {
+		return no_component;
+	}
+	return areas.components[chunk->second.first + area];
+}
+
+
+std::vector<coord::tile> ChunkGraph::find_route(coord::tile start, coord::tile end) {
+	std::lock_guard<std::mutex> lock{this->graph_mutex};
+
+	coord::chunk start_chunk = start.to_chunk();
+	coord::chunk end_chunk = end.to_chunk();
+
+	const chunk_portals *start_portals = this->get_portals(start_chunk);
+	const chunk_portals *end_portals = this->get_portals(end_chunk);
+	if (start_portals == nullptr or end_portals == nullptr) {
+		return {};
+	}
+
+	// connect start and end to the portals of their chunk
+	std::vector<cost_t> start_costs = this->chunk_costs(start, this->passable_tiles(start_chunk));
+	std::vector<cost_t> end_costs = this->chunk_costs(end, this->passable_tiles(end_chunk));
+
+	std::unordered_map<coord::chunk, std::vector<abstract_visit>, coord_chunk_hash> visits;
+	std::priority_queue<abstract_candidate,
+	                    std::vector<abstract_candidate>,
+	                    std::greater<abstract_candidate>> open;
+
+	const abstract_node no_predecessor{start_chunk, -1};
+	const abstract_node goal{end_chunk, -1};
+
+	abstract_node goal_predecessor = no_predecessor;
+	cost_t goal_cost = infinite_cost;
+
+	auto visit = [&](const abstract_node &node) -> abstract_visit & {
+		auto &chunk_visits = visits[node.chunk];
+		if (chunk_visits.empty()) {
+			chunk_visits.resize(this->get_portals(node.chunk)->portals.size(),
+			                    {infinite_cost, no_predecessor, false});
+		}
+		return chunk_visits[node.portal];
+	};
+
+	auto relax = [&](const abstract_node &node, const abstract_node &from, cost_t cost) {
+		coord::tile position = this->get_portals(node.chunk)->portals[node.portal].position;
+		abstract_visit &v = visit(node);
+		if (not v.closed and cost < v.cost) {
+			v.cost = cost;
+			v.predecessor = from;
+			open.push({cost + tile_distance(position, end), cost, node});
+		}
+	};
+
+	auto reach_goal = [&](const abstract_node &from, cost_t cost) {
+		if (cost < goal_cost) {
+			goal_cost = cost;
+			goal_predecessor = from;
+			open.push({cost, cost, goal});
+		}
+	};
+
+	// start and end in the same chunk may be connected directly
+	if (start_chunk == end_chunk) {
+		reach_goal(no_predecessor, start_costs[tile_index(end)]);
+	}
+
+	for (size_t i = 0; i < start_portals->portals.size(); i++) {
+		cost_t cost = start_costs[tile_index(start_portals->portals[i].position)];
+		if (cost < infinite_cost) {
+			relax({start_chunk, (int) i}, no_predecessor, cost);
+		}
+	}
+
+	bool found = false;
+	while (not open.empty()) {
+		job::CancellationToken::current().check();
+
+		abstract_candidate current = open.top();
+		open.pop();
+
+		if (current.node == goal) {
+			found = true;
+			break;
+		}
+
+		abstract_visit &v = visit(current.node);
+		if (v.closed or current.past_cost > v.cost) {
+			continue;
+		}
+		v.closed = true;
+
+		const chunk_portals *portals = this->get_portals(current.node.chunk);
+		const portal &here = portals->portals[current.node.portal];
+		size_t count = portals->portals.size();
+
+		if (current.node.chunk == end_chunk) {
+			cost_t cost = end_costs[tile_index(here.position)];
+			if (cost < infinite_cost) {
+				reach_goal(current.node, current.past_cost + cost);
+			}
+		}
+
+		// other portals of the same chunk
+		for (size_t j = 0; j < count; j++) {
+			cost_t cost = portals->costs[current.node.portal * count + j];
+			if ((int) j != current.node.portal and cost < infinite_cost) {
+				relax({current.node.chunk, (int) j}, current.node, current.past_cost + cost);
+			}
+		}
+
+		// matching portal across the border
+		coord::tile across = here.position + here.exit;
+		coord::chunk across_chunk = across.to_chunk();
+		const chunk_portals *other = this->get_portals(across_chunk);
+		if (other != nullptr) {
+			for (size_t j = 0; j < other->portals.size(); j++) {
+				if (other->portals[j].position == across) {
+					relax({across_chunk, (int) j}, current.node,
+					      current.past_cost + coord::settings::phys_per_tile);
+					break;
+				}
+			}
+		}
+	}
+
+	if (not found) {
+		return {};
+	}
+
+	std::vector<coord::tile> route{end};
+	for (abstract_node node = goal_predecessor; node.portal >= 0; node = visit(node).predecessor) {
+		route.push_back(this->get_portals(node.chunk)->portals[node.portal].position);
+	}
+	std::reverse(std::begin(route), std::end(route));
+
+	return route;
+}
+
+
+Path to_point(coord::phys3 start,
+              coord::phys3 end,
+              std::function<bool(const coord::phys3 &)> passable,
+              ChunkGraph &graph,
+              size_t layer) {
+
+	coord::tile start_tile = start.to_tile3().to_tile();
+	coord::tile end_tile = end.to_tile3().to_tile();
+
+	// a search for an unreachable target would visit everything
+	// reachable, so go to the closest tile which can be reached.
+	if (not graph.reachable(start_tile, end_tile, layer)) {
+		coord::tile closest;
+		if (not graph.nearest_reachable(start_tile, end_tile, layer, closest)) {
+			log::log(MSG(dbg) << "target can't be reached");
+			return Path{};
+		}
+		end_tile = closest;
+		end = closest.to_tile3().to_phys3();
+	}
+
+	// nearby targets are searched directly
+	if (chunk_distance(start_tile.to_chunk(), end_tile.to_chunk()) <= refine_chunks) {
+		return to_point(start, end, passable);
+	}
+
+	std::vector<coord::tile> route = graph.find_route(start_tile, end_tile);
+	if (route.empty()) {
+		log::log(MSG(dbg) << "no abstract route found, using direct search");
+		return to_point(start, end, passable);
+	}
+
+	// refine the route up to the first waypoint
+	// which leaves the refinement range
+	for (size_t i = 0; i + 1 < route.size(); i++) {
+		if (chunk_distance(start_tile.to_chunk(), route[i].to_chunk()) >= refine_chunks) {
+			Path result = to_point(start, route[i].to_tile3().to_phys3(), passable);
+
+			// without progress, continuing the path would loop forever
+			result.partial = not result.waypoints.empty();
+			return result;
+		}
+	}
+
+	return to_point(start, end, passable);
+}
+
+}} // namespace openage::path
@@ -0,0 +1,277 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../terrain/terrain.h"
+#include "path.h"
+
+namespace openage {
+namespace path {
+
+/**
+ * Number of chunks of an abstract route that are
+ * refined with the low-level search at once.
+ */
+constexpr int refine_chunks = 2;
+
+/**
+ * Unreachable targets are moved to the closest reachable
+ * tile at most this many tiles away from them.
+ */
+constexpr int max_snap_distance = 32;
+
+/**
+ * Transition point between two neighboring chunks.
+ *
+ * A portal is the tile on this side of a chunk border,
+ * the matching portal of the neighbor chunk is the adjacent
+ * tile on the other side.
+ */
+struct portal {
+	coord::tile position;
+	coord::tile_delta exit;   //!< direction to the matching portal in the neighbor chunk
+};
+
+/**
+ * Abstract graph data of one chunk.
+ */
+struct chunk_portals {
+	std::vector<portal> portals;
+
+	/**
+	 * Movement cost between each pair of portals inside the chunk,
+	 * row-major. Unconnected pairs have infinite cost.
+	 */
+	std::vector<cost_t> costs;
+};
+
+/**
+ * Connected areas of passable tiles within one chunk.
+ */
+struct chunk_areas {
+	/**
+	 * Area of each tile, indexed like the tiles of
+	 * ChunkGraph::passable_tiles(). -1 for blocked tiles.
+	 */
+	std::vector<int> tiles;
+
+	/**
+	 * Number of areas in the chunk.
+	 */
+	int count;
+
+	/**
+	 * Index of the first area of the chunk in the components.
+	 */
+	size_t first;
+};
+
+/**
+ * Connected areas of all chunks for one passability layer.
+ */
+struct layer_areas {
+	std::unordered_map<coord::chunk, chunk_areas, coord_chunk_hash> chunks;
+
+	/**
+	 * Chunks whose areas have to be recalculated.
+	 */
+	std::unordered_set<coord::chunk, coord_chunk_hash> dirty;
+
+	/**
+	 * Component of each area of all chunks. Tiles are
+	 * reachable from each other on the same component.
+	 */
+	std::vector<size_t> components;
+
+	/**
+	 * Graph revision the components were joined for.
+	 */
+	size_t revision;
+};
+
+/**
+ * Abstract graph for hierarchical pathfinding (HPA*).
+ *
+ * Each terrain chunk is a cluster. Portals are placed on the
+ * passable sections of the borders between neighboring chunks,
+ * and the movement costs between the portals of one chunk are
+ * precomputed. A long route is then first planned on the portals,
+ * and only its beginning is refined with the tile-exact search.
+ *
+ * Only static obstacles are considered, moving units and
+ * terrain restrictions are left to the low-level search.
+ * Chunks are rebuilt lazily after they were invalidated.
+ *
+ * For each passability layer of the terrain, the graph also labels
+ * the connected areas of the tiles which are passable on the layer,
+ * so unreachable targets are detected without searching.
+ *
+ * Routes may be searched from multiple threads at once.
+ */
+class ChunkGraph {
+public:
+	ChunkGraph(Terrain *terrain);
+
+	/**
+	 * Mark the chunk containing the tile as outdated.
+	 * On a chunk border, the chunk on the other side
+	 * shares the portals and is outdated too.
+	 */
+	void invalidate(coord::tile position);
+
+	/**
+	 * Mark the chunk and its direct neighbors as outdated.
+	 */
+	void invalidate_chunk(coord::chunk position);
+
+	/**
+	 * Plan an abstract route between two tiles.
+	 *
+	 * @returns the portal tiles to pass in order, followed by the
+	 *          end tile. Empty if no route was found.
+	 */
+	std::vector<coord::tile> find_route(coord::tile start, coord::tile end);
+
+	/**
+	 * Can the tile be passed, regarding static obstacles?
+	 */
+	bool tile_passable(coord::tile position);
+
+	/**
+	 * Can end be reached from start on the passability layer,
+	 * regarding static obstacles and the terrain?
+	 *
+	 * A start on a blocked tile can't be judged, as objects may
+	 * overlap the tiles around them, and counts as connected.
+	 */
+	bool reachable(coord::tile start, coord::tile end,
+	               size_t layer=Terrain::no_passability_layer);
+
+	/**
+	 * Find the tile closest to target which can be reached from start
+	 * on the passability layer, up to max_snap_distance tiles away.
+	 *
+	 * @returns false if there is no such tile.
+	 */
+	bool nearest_reachable(coord::tile start, coord::tile target, size_t layer,
+	                       coord::tile &result);
+
+	/**
+	 * Counter which changes whenever static obstacles change.
+	 */
+	size_t get_revision();
+
+	/**
+	 * Revision at which the static obstacles of the chunk or
+	 * on its borders changed last, 0 if they never did.
+	 */
+	size_t get_chunk_revision(coord::chunk position);
+
+private:
+	/**
+	 * Portal data for the given chunk, rebuilt if outdated.
+	 * @returns nullptr if the chunk does not exist.
+	 */
+	const chunk_portals *get_portals(coord::chunk position);
+
+	/**
+	 * Recalculate portals and costs of a chunk.
+	 */
+	void build_chunk(coord::chunk position, chunk_portals &data);
+
+	/**
+	 * Passability of all tiles of a chunk.
+	 * Tiles are indexed row-major relative to the chunk origin.
+	 */
+	std::vector<bool> passable_tiles(coord::chunk position);
+
+	/**
+	 * Movement costs from a tile to all tiles of its chunk,
+	 * indexed like passable_tiles().
+	 */
+	std::vector<cost_t> chunk_costs(coord::tile start, const std::vector<bool> &passable);
+
+	/**
+	 * Areas of a passability layer, with the components
+	 * joined for the current revision.
+	 */
+	layer_areas &get_areas(size_t layer);
+
+	/**
+	 * Label the connected tiles of a chunk which are passable on the layer.
+	 */
+	void build_areas(coord::chunk position, size_t layer, chunk_areas &data);
+
+	/**
+	 * Component of the area of a tile, no_component if it is blocked.
+	 */
+	size_t component(const layer_areas &areas, coord::tile position);
+
+	static constexpr size_t no_component = SIZE_MAX;
+
+	/**
+	 * The terrain the graph is built for.
+	 */
+	Terrain *terrain;
+
+	/**
+	 * Portal data of all chunks built so far.
+	 */
+	std::unordered_map<coord::chunk, chunk_portals, coord_chunk_hash> chunks;
+
+	/**
+	 * Chunks to rebuild before their next use.
+	 */
+	std::unordered_set<coord::chunk, coord_chunk_hash> dirty;
+
+	/**
+	 * Areas of the passability layers used so far.
+	 */
+	std::unordered_map<size_t, layer_areas> areas;
+
+	/**
+	 * Incremented on each invalidation.
+	 */
+	size_t revision;
+
+	/**
+	 * Revision of the last invalidation of each chunk.
+	 */
+	std::unordered_map<coord::chunk, size_t, coord_chunk_hash> chunk_revisions;
+
+	/**
+	 * Guards the chunk data against concurrent route searches.
+	 */
+	std::mutex graph_mutex;
+};
+
+
+/**
+ * path between two static points, planned with the chunk graph.
+ *
+ * distant targets are approached by an abstract route over chunk
+ * portals, of which only the first refine_chunks chunks are refined
+ * by a_star. the returned path is partial in that case and has
+ * to be continued once its waypoints are reached.
+ *
+ * targets which can't be reached on the passability layer are moved
+ * to the closest reachable tile, or rejected with an empty path.
+ */
+Path to_point(coord::phys3 start,
+              coord::phys3 end,
+              std::function<bool(const coord::phys3 &)> passable,
+              ChunkGraph &graph,
+              size_t layer=Terrain::no_passability_layer);
+
+} // namespace path
+} // namespace openage
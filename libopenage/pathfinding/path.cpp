@@ -1,8 +1,10 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
+#include <algorithm>
 #include <cmath>
 
 #include "path.h"
+#include "../shape_batch.h"
 #include "../terrain/terrain.h"
 
 namespace openage {
@@ -86,8 +88,9 @@ std::vector<node_pt> Node::get_neighbors(const nodemap_t &nodes, float scale) {
 	for (int n = 0; n < 8; ++n) {
 		coord::phys3 n_pos = this->position + (neigh_phys[n] * scale);
 
-		if (nodes.count(n_pos) > 0) {
-			neighbors.push_back( nodes.at(n_pos) );
+		auto known = nodes.find(n_pos);
+		if (known != std::end(nodes)) {
+			neighbors.push_back(known->second);
 		}
 		else {
 			neighbors.push_back( std::make_shared<Node>(n_pos, this->shared_from_this()) );
@@ -97,20 +100,90 @@ std::vector<node_pt> Node::get_neighbors(const nodemap_t &nodes, float scale) {
 }
 
 
-bool passable_line(node_pt start, node_pt end, std::function<bool(const coord::phys3 &)> passable, float samples) {
-	// interpolate between points and make passablity checks
-	// (dont check starting position)
-	for (int i = 1; i <= samples; ++i) {
-		double percent = (double) i / samples;
-		coord::phys_t ne = (1.0 - percent) * start->position.ne + percent * end->position.ne;
-		coord::phys_t se = (1.0 - percent) * start->position.se + percent * end->position.se;
-		coord::phys_t up = (1.0 - percent) * start->position.up + percent * end->position.up;
+bool passable_line(node_pt start, node_pt end, std::function<bool(const coord::phys3 &)> passable) {
+	return passable_line(start->position, end->position, passable);
+}
+
+
+namespace {
+
+/**
+ * index of the path grid cell containing the coordinate, rounded down
+ */
+coord::phys_t grid_cell(coord::phys_t value) {
+	coord::phys_t cell = value / path_grid_size;
+	if (value % path_grid_size < 0) {
+		cell -= 1;
+	}
+	return cell;
+}
+
+} // anonymous namespace
+
+
+bool passable_line(const coord::phys3 &start, const coord::phys3 &end, const std::function<bool(const coord::phys3 &)> &passable) {
+	const coord::phys_t dne = end.ne - start.ne;
+	const coord::phys_t dse = end.se - start.se;
+	const coord::phys_t dup = end.up - start.up;
+	const int step_ne = (dne > 0) - (dne < 0);
+	const int step_se = (dse > 0) - (dse < 0);
+
+	coord::phys_t cell_ne = grid_cell(start.ne);
+	coord::phys_t cell_se = grid_cell(start.se);
+	const coord::phys_t end_ne = grid_cell(end.ne);
+	const coord::phys_t end_se = grid_cell(end.se);
+
+	// the next cell borders the line crosses
+	coord::phys_t border_ne = (cell_ne + (step_ne > 0)) * path_grid_size;
+	coord::phys_t border_se = (cell_se + (step_se > 0)) * path_grid_size;
+
+	coord::phys3 point = start;
+	while (cell_ne != end_ne or cell_se != end_se) {
+		// compare the line fractions at which the borders are reached:
+		// |border_ne - start.ne| / |dne| against |border_se - start.se| / |dse|
+		coord::phys_t reach_ne = std::abs(border_ne - start.ne) * std::abs(dse);
+		coord::phys_t reach_se = std::abs(border_se - start.se) * std::abs(dne);
+
+		bool cross_ne = cell_ne != end_ne and (cell_se == end_se or reach_ne <= reach_se);
+		bool cross_se = cell_se != end_se and (cell_ne == end_ne or reach_se <= reach_ne);
+
+		// the point of the line where it enters the next cell,
+		// borders belong to the cell with the larger coordinates
+		if (cross_ne) {
+			point.ne = border_ne - (step_ne < 0);
+			point.se = start.se + (point.ne - start.ne) * dse / dne;
+			point.up = start.up + (point.ne - start.ne) * dup / dne;
+			if (cross_se) {
+				point.se = border_se - (step_se < 0);
+			}
+		}
+		else {
+			point.se = border_se - (step_se < 0);
+			point.ne = start.ne + (point.se - start.se) * dne / dse;
+			point.up = start.up + (point.se - start.se) * dup / dse;
+		}
 
-		if (!passable(coord::phys3{ne, se, up})) {
+		// through a corner, both borders are crossed at once
+		if (cross_ne) {
+			cell_ne += step_ne;
+			border_ne += step_ne * path_grid_size;
+		}
+		if (cross_se) {
+			cell_se += step_se;
+			border_se += step_se * path_grid_size;
+		}
+
+		// the cell of the end is tested at the end
+		if (cell_ne == end_ne and cell_se == end_se) {
+			break;
+		}
+
+		if (not passable(point)) {
 			return false;
 		}
 	}
-	return true;
+
+	return passable(end);
 }
 
 
@@ -119,16 +192,87 @@ Path::Path(const std::vector<Node> &nodes)
 	waypoints{nodes} {}
 
 
-void Path::draw_path() {
-	glLineWidth(1);
-	glColor3f(0.3, 1.0, 0.3);
-	glBegin(GL_LINES); {
-		for (Node &n : waypoints) {
-			coord::camgame draw_pos = n.position.to_camgame();
-			glVertex3f(draw_pos.x, draw_pos.y, 0);
+namespace {
+
+/**
+ * Smoothed lines are at most this long, so the line of sight
+ * tests for one waypoint stay bounded on long straight paths.
+ */
+constexpr coord::phys_t max_smooth_length = 4 * coord::settings::phys_per_tile;
+
+} // anonymous namespace
+
+
+void Path::compress(const coord::phys3 &start) {
+	if (this->waypoints.size() < 2) {
+		return;
+	}
+
+	// walked from the start, like smooth(). a waypoint is dropped if the
+	// path continues in the same direction after it.
+	size_t out = this->waypoints.size() - 1;
+	coord::phys3 prev = start;
+	for (size_t i = this->waypoints.size() - 1; i > 0; i--) {
+		const coord::phys3 &pos = this->waypoints[i].position;
+		const coord::phys3 &next = this->waypoints[i - 1].position;
+
+		coord::phys_t in_ne = pos.ne - prev.ne, in_se = pos.se - prev.se;
+		coord::phys_t out_ne = next.ne - pos.ne, out_se = next.se - pos.se;
+		bool straight = (in_ne * out_se == in_se * out_ne) and (in_ne * out_ne + in_se * out_se > 0);
+
+		if (not straight) {
+			this->waypoints[out--] = this->waypoints[i];
+			prev = pos;
 		}
 	}
-	glEnd();
+	this->waypoints[out] = this->waypoints.front();
+
+	this->waypoints.erase(std::begin(this->waypoints), std::begin(this->waypoints) + out);
+	this->waypoints.shrink_to_fit();
+}
+
+
+void Path::smooth(const coord::phys3 &start, const std::function<bool(const coord::phys3 &)> &passable) {
+	// fewer waypoints for the line of sight tests
+	this->compress(start);
+
+	if (this->waypoints.size() < 2) {
+		return;
+	}
+
+	// the waypoints are stored from the end to the start,
+	// so they are walked backwards. each one is kept if the next
+	// can't be seen from the last kept one.
+	std::vector<Node> kept;
+	coord::phys3 from = start;
+	for (size_t i = this->waypoints.size() - 1; i > 0; i--) {
+		const coord::phys3 &next = this->waypoints[i - 1].position;
+		coord::phys_t dne = next.ne - from.ne, dse = next.se - from.se;
+		bool too_long = std::hypot(dne, dse) > max_smooth_length;
+
+		if (too_long or not passable_line(from, next, passable)) {
+			kept.push_back(this->waypoints[i]);
+			from = this->waypoints[i].position;
+		}
+	}
+	kept.push_back(this->waypoints.front());
+
+	std::reverse(std::begin(kept), std::end(kept));
+	kept.shrink_to_fit();
+	this->waypoints = std::move(kept);
+}
+
+
+void Path::draw_path() {
+	// the camera may move until the line is drawn
+	ShapeBatch lines;
+	shape_color color{0.3, 1.0, 0.3, 1.0};
+	for (size_t i = 1; i < this->waypoints.size(); i += 2) {
+		coord::camgame from = this->waypoints[i - 1].position.to_camgame();
+		coord::camgame to = this->waypoints[i].position.to_camgame();
+		lines.line(from.x, from.y, to.x, to.y, color);
+	}
+	lines.submit();
 }
 
 
@@ -4,12 +4,12 @@
 
 #include <functional>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
 #include "../coord/decl.h"
 #include "../coord/phys3.h"
 #include "../coord/tile.h"
+#include "../datastructure/flat_hash_map.h"
 #include "../datastructure/pairing_heap.h"
 #include "../util/misc.h"
 
@@ -33,7 +33,7 @@ using node_pt = std::shared_ptr<Node>;
 /**
  * Type for mapping tiles to nodes.
  */
-using nodemap_t = std::unordered_map<coord::phys3, node_pt>;
+using nodemap_t = datastructure::FlatHashMap<coord::phys3, node_pt, datastructure::coord_hash>;
 
 
 /**
@@ -72,9 +72,20 @@ constexpr coord::phys3_delta const neigh_phys[] = {
 };
 
 /**
+ * Check whether the straight line between two nodes can be passed.
  *
+ * The line is traversed over the cells of the path grid, aligned to the
+ * phys origin: passable is tested once where the line enters each cell
+ * it touches, and at the end. Stops at the first impassable point.
+ * The start position itself is not checked.
  */
-bool passable_line(node_pt start, node_pt end, std::function<bool(const coord::phys3 &)>passable, float samples=5.0f);
+bool passable_line(node_pt start, node_pt end, std::function<bool(const coord::phys3 &)> passable);
+
+/**
+ * Check whether the straight line between two positions can be passed.
+ * Same as above, without requiring the positions to be nodes.
+ */
+bool passable_line(const coord::phys3 &start, const coord::phys3 &end, const std::function<bool(const coord::phys3 &)> &passable);
 
 /**
  * One navigation waypoint in a path.
@@ -182,11 +193,31 @@ public:
 
 	void draw_path();
 
+	/**
+	 * Removes the waypoints in the middle of straight lines,
+	 * seen from the start position. Needs no passability tests.
+	 */
+	void compress(const coord::phys3 &start);
+
+	/**
+	 * Removes the waypoints that can be skipped by a passable straight
+	 * line from the waypoint or start position before them,
+	 * so the path no longer follows the grid.
+	 * The lines are at most a few tiles long.
+	 */
+	void smooth(const coord::phys3 &start, const std::function<bool(const coord::phys3 &)> &passable);
+
 	/**
 	 * These are the waypoints to navigate in order.
 	 * Includes the start and end node.
 	 */
 	std::vector<Node> waypoints;
+
+	/**
+	 * The path ends before the actual target, and has to be
+	 * planned further once its waypoints are reached.
+	 */
+	bool partial = false;
 };
 
 } // namespace path
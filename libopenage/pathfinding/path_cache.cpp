@@ -0,0 +1,190 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "path_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../coord/tile3.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../util/misc.h"
+#include "a_star.h"
+#include "hierarchical.h"
+
+namespace openage {
+namespace path {
+
+namespace {
+
+/**
+ * Units starting in the same square of 2^bits tiles share their paths.
+ */
+constexpr int start_region_bits = 2;
+
+} // anonymous namespace
+
+
+bool PathCache::path_key::operator ==(const path_key &other) const {
+	return (this->mover == other.mover and
+	        this->start_region == other.start_region and
+	        this->goal == other.goal and
+	        this->goal_tile == other.goal_tile and
+	        this->range == other.range);
+}
+
+
+size_t PathCache::path_key_hash::operator ()(const path_key &key) const {
+	size_t hash = std::hash<const void *>{}(key.mover);
+	hash = util::rol<size_t, 1>(hash) ^ std::hash<const void *>{}(key.goal);
+	hash = util::rol<size_t, 1>(hash) ^ std::hash<coord::tile>{}(key.start_region);
+	hash = util::rol<size_t, 1>(hash) ^ std::hash<coord::tile>{}(key.goal_tile);
+	return util::rol<size_t, 1>(hash) ^ std::hash<coord::phys_t>{}(key.range);
+}
+
+
+PathCache::PathCache(Terrain *terrain, size_t capacity)
+	:
+	terrain{terrain},
+	capacity{capacity},
+	hits{0},
+	misses{0} {}
+
+
+Path PathCache::to_point(const void *mover,
+                         coord::phys3 start,
+                         coord::phys3 end,
+                         const std::function<bool(const coord::phys3 &)> &passable,
+                         size_t layer) {
+	path_key key{mover, this->start_region(start), nullptr, end.to_tile3().to_tile(), 0};
+	return this->find(key, start, passable, [&]() {
+		return path::to_point(start, end, passable, this->terrain->get_path_graph(), layer);
+	});
+}
+
+
+Path PathCache::to_object(const void *mover,
+                          TerrainObject *to_move,
+                          TerrainObject *end,
+                          coord::phys_t rad) {
+	coord::phys3 start = to_move->pos.draw;
+	path_key key{mover, this->start_region(start), end, end->pos.draw.to_tile3().to_tile(), rad};
+	return this->find(key, start, to_move->passable, [&]() {
+		return path::to_object(to_move, end, rad);
+	});
+}
+
+
+size_t PathCache::get_hits() const {
+	return this->hits;
+}
+
+
+size_t PathCache::get_misses() const {
+	return this->misses;
+}
+
+
+Path PathCache::find(const path_key &key,
+                     coord::phys3 start,
+                     const std::function<bool(const coord::phys3 &)> &passable,
+                     const std::function<Path()> &search) {
+	Path result;
+	if (this->lookup(key, start, passable, result)) {
+		this->hits += 1;
+		return result;
+	}
+
+	this->misses += 1;
+	result = search();
+
+	// partial paths are continued from their end, not reused
+	if (not result.waypoints.empty() and not result.partial) {
+		this->store(key, start, result);
+	}
+	return result;
+}
+
+
+bool PathCache::lookup(const path_key &key,
+                       coord::phys3 start,
+                       const std::function<bool(const coord::phys3 &)> &passable,
+                       Path &result) {
+	auto it = this->lookup_table.find(key);
+	if (it == std::end(this->lookup_table)) {
+		return false;
+	}
+
+	// obstacles changed somewhere along the path
+	ChunkGraph &graph = this->terrain->get_path_graph();
+	const cache_entry &entry = *it->second;
+	for (auto &chunk : entry.chunks) {
+		if (graph.get_chunk_revision(chunk) > entry.revision) {
+			this->entries.erase(it->second);
+			this->lookup_table.erase(it);
+			return false;
+		}
+	}
+
+	// the path was searched from elsewhere in the start region,
+	// so cut the waypoints which the unit doesn't need to go back to
+	result = entry.path;
+	result.smooth(start, passable);
+	if (result.waypoints.empty() or
+	    not passable_line(start, result.waypoints.back().position, passable)) {
+		return false;
+	}
+
+	// move to the front as most recently used
+	this->entries.splice(std::begin(this->entries), this->entries, it->second);
+	return true;
+}
+
+
+void PathCache::store(const path_key &key, coord::phys3 start, const Path &path) {
+	auto it = this->lookup_table.find(key);
+	if (it != std::end(this->lookup_table)) {
+		this->entries.erase(it->second);
+		this->lookup_table.erase(it);
+	}
+
+	cache_entry entry{key, this->terrain->get_path_graph().get_revision(), {}, path};
+
+	// the chunks along the path, sampled every half tile.
+	// the waypoints are stored nearest last.
+	coord::phys3 from = start;
+	for (auto node = path.waypoints.rbegin(); node != path.waypoints.rend(); ++node) {
+		coord::phys3 to = node->position;
+		double length = std::hypot(to.ne - from.ne, to.se - from.se);
+		int samples = 1 + static_cast<int>(length / (coord::settings::phys_per_tile / 2));
+
+		for (int i = 0; i <= samples; i++) {
+			coord::phys3 sample{
+				from.ne + (to.ne - from.ne) * i / samples,
+				from.se + (to.se - from.se) * i / samples,
+				from.up
+			};
+			coord::chunk chunk = sample.to_tile3().to_tile().to_chunk();
+			if (std::find(std::begin(entry.chunks), std::end(entry.chunks), chunk) == std::end(entry.chunks)) {
+				entry.chunks.push_back(chunk);
+			}
+		}
+		from = to;
+	}
+
+	this->entries.push_front(std::move(entry));
+	this->lookup_table[key] = std::begin(this->entries);
+
+	if (this->entries.size() > this->capacity) {
+		this->lookup_table.erase(this->entries.back().key);
+		this->entries.pop_back();
+	}
+}
+
+
+coord::tile PathCache::start_region(coord::phys3 start) const {
+	coord::tile tile = start.to_tile3().to_tile();
+	return {tile.ne >> start_region_bits, tile.se >> start_region_bits};
+}
+
+}} // namespace openage::path
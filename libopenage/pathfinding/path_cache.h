@@ -0,0 +1,128 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "path.h"
+
+namespace openage {
+
+class Terrain;
+class TerrainObject;
+
+namespace path {
+
+/**
+ * Paths which were searched recently, to be reused by units which
+ * start nearby and move to the same target, like villagers going
+ * back and forth between a resource and a dropsite.
+ *
+ * A path stays valid until the static obstacles change in one of the
+ * chunks it passes. Moving units are not part of the cached paths,
+ * the units go around them while they move.
+ *
+ * Only used by the thread which updates the game.
+ */
+class PathCache {
+public:
+	PathCache(Terrain *terrain, size_t capacity=256);
+
+	/**
+	 * path between two static points, see the hierarchical to_point.
+	 *
+	 * @param mover all units sharing the mover have the same movement rules
+	 */
+	Path to_point(const void *mover,
+	              coord::phys3 start,
+	              coord::phys3 end,
+	              const std::function<bool(const coord::phys3 &)> &passable,
+	              size_t layer);
+
+	/**
+	 * path to within rad of an object, see path::to_object.
+	 * the path is searched anew when the object moves to another tile.
+	 */
+	Path to_object(const void *mover,
+	               TerrainObject *to_move,
+	               TerrainObject *end,
+	               coord::phys_t rad);
+
+	/**
+	 * number of paths which were reused and searched.
+	 */
+	size_t get_hits() const;
+	size_t get_misses() const;
+
+private:
+	struct path_key {
+		const void *mover;
+		coord::tile start_region;
+		const void *goal;          //!< target object, nullptr for points
+		coord::tile goal_tile;
+		coord::phys_t range;
+
+		bool operator ==(const path_key &other) const;
+	};
+
+	struct path_key_hash {
+		size_t operator ()(const path_key &key) const;
+	};
+
+	struct cache_entry {
+		path_key key;
+
+		/** graph revision when the path was searched */
+		size_t revision;
+
+		/** the chunks the path passes */
+		std::vector<coord::chunk> chunks;
+
+		Path path;
+	};
+
+	/**
+	 * the cached path for the key continued from start, or the
+	 * one found by search, which is then cached.
+	 */
+	Path find(const path_key &key,
+	          coord::phys3 start,
+	          const std::function<bool(const coord::phys3 &)> &passable,
+	          const std::function<Path()> &search);
+
+	/**
+	 * the cached path for the key if it's still valid
+	 * and can be reached from start.
+	 */
+	bool lookup(const path_key &key,
+	            coord::phys3 start,
+	            const std::function<bool(const coord::phys3 &)> &passable,
+	            Path &result);
+
+	void store(const path_key &key, coord::phys3 start, const Path &path);
+
+	coord::tile start_region(coord::phys3 start) const;
+
+	Terrain *terrain;
+	size_t capacity;
+
+	size_t hits;
+	size_t misses;
+
+	/**
+	 * Cached paths, the most recently used first.
+	 */
+	std::list<cache_entry> entries;
+
+	std::unordered_map<path_key, std::list<cache_entry>::iterator, path_key_hash> lookup_table;
+};
+
+} // namespace path
+} // namespace openage
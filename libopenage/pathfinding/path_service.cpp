@@ -0,0 +1,239 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "path_service.h"
+
+#include <chrono>
+
+#include "../coord/tile3.h"
+#include "../error/error.h"
+#include "../log/log.h"
+#include "../util/metrics.h"
+#include "../util/misc.h"
+#include "../util/timing.h"
+#include "hierarchical.h"
+
+namespace openage {
+namespace path {
+
+namespace {
+
+/**
+ * Requests from the same square of 2^n tiles can share a path.
+ */
+constexpr int start_region_bits = 2;
+
+/**
+ * How often waiting searches check whether they should abort.
+ */
+constexpr std::chrono::milliseconds search_poll_interval{5};
+
+
+/**
+ * Searches the path and records how long it took.
+ */
+Path timed_search(coord::phys3 start,
+                  coord::phys3 end,
+                  const std::function<bool(const coord::phys3 &)> &passable,
+                  ChunkGraph &graph,
+                  size_t layer) {
+
+	static util::MetricHistogram &search_us = util::metrics().histogram("path.search_us");
+
+	time_nsec_t search_start = timing::get_monotonic_time();
+	Path result = to_point(start, end, passable, graph, layer);
+	search_us.add((timing::get_monotonic_time() - search_start) / 1000);
+	return result;
+}
+
+} // anonymous namespace
+
+
+path_request::~path_request() {
+	this->cancellation.cancel();
+}
+
+
+PathHandle::PathHandle(std::shared_ptr<path_request> request)
+	:
+	request{request} {}
+
+
+bool PathHandle::is_valid() const {
+	return this->request != nullptr;
+}
+
+
+bool PathHandle::is_ready() const {
+	return this->request and this->request->ready;
+}
+
+
+Path PathHandle::get() {
+	ENSURE(this->is_ready(), "path of an unfinished request was requested");
+
+	if (this->request->error != nullptr) {
+		std::rethrow_exception(this->request->error);
+	}
+	return this->request->result;
+}
+
+
+bool PathService::request_key::operator ==(const request_key &other) const {
+	return this->mover == other.mover and
+	       this->start_region == other.start_region and
+	       this->goal == other.goal;
+}
+
+
+size_t PathService::request_key_hash::operator ()(const request_key &key) const {
+	size_t hash = std::hash<const void *>{}(key.mover);
+	hash = util::rol<size_t, 1>(hash) ^ std::hash<coord::tile>{}(key.start_region);
+	hash = util::rol<size_t, 1>(hash) ^ std::hash<coord::tile>{}(key.goal);
+	return hash;
+}
+
+
+PathService::PathService(job::JobManager *job_manager, ChunkGraph *graph)
+	:
+	job_manager{job_manager},
+	graph{graph},
+	state{std::make_shared<search_state>()},
+	blocked{true},
+	searches{job_manager} {
+
+	this->state->closed = false;
+	this->state->terrain_lock.lock();
+}
+
+
+PathService::~PathService() {
+	if (not this->blocked) {
+		this->block_searches();
+	}
+
+	// jobs which did not start yet will not search anymore
+	this->state->closed = true;
+	this->state->terrain_lock.unlock();
+}
+
+
+PathHandle PathService::request(const void *mover,
+                                coord::phys3 start,
+                                coord::phys3 end,
+                                std::function<bool(const coord::phys3 &)> passable,
+                                size_t layer) {
+
+	coord::tile start_tile = start.to_tile3().to_tile();
+	request_key key{
+		mover,
+		{start_tile.ne >> start_region_bits, start_tile.se >> start_region_bits},
+		end.to_tile3().to_tile()
+	};
+
+	static util::MetricCounter &requests = util::metrics().counter("path.requests");
+	static util::MetricCounter &shared = util::metrics().counter("path.shared");
+	requests.add();
+
+	auto it = this->tick_requests.find(key);
+	if (it != std::end(this->tick_requests)) {
+		shared.add();
+		return {it->second};
+	}
+
+	auto request = std::make_shared<path_request>();
+
+	// the units of the request may get other orders before
+	// the search is done, it stops when their handles are gone
+	request->cancellation = job::CancellationToken::create();
+
+	// the handles keep the request, the search must not
+	std::weak_ptr<path_request> requester = request;
+	job::callback_function_t<Path> commit = [requester](job::result_function_t<Path> get_result) {
+		auto request = requester.lock();
+		if (not request) {
+			return;
+		}
+
+		try {
+			request->result = get_result();
+		}
+		catch (...) {
+			request->error = std::current_exception();
+		}
+		request->ready = true;
+	};
+
+	ChunkGraph *graph = this->graph;
+
+	if (this->job_manager == nullptr) {
+		// searched right away, without other threads
+		this->searches.submit<Path>(
+			job::job_function_t<Path>{[graph, start, end, passable, layer]() {
+				return timed_search(start, end, passable, *graph, layer);
+			}},
+			commit,
+			request->cancellation
+		);
+	}
+	else {
+		std::shared_ptr<search_state> state = this->state;
+
+		this->searches.submit<Path>(
+			job::abortable_function_t<Path>{
+				[state, graph, start, end, passable, layer](job::should_abort_t should_abort,
+				                                            job::abort_t abort) -> Path {
+
+					// wait until the terrain may be read,
+					// but don't prevent the job manager from stopping.
+					std::shared_lock<std::shared_timed_mutex> lock{state->terrain_lock, std::defer_lock};
+					while (not lock.try_lock_for(search_poll_interval)) {
+						if (should_abort()) {
+							abort();
+						}
+					}
+
+					if (state->closed) {
+						return {};
+					}
+					return timed_search(start, end, passable, *graph, layer);
+				}
+			},
+			commit,
+			request->cancellation
+		);
+	}
+
+	this->tick_requests.emplace(key, request);
+	return {request};
+}
+
+
+void PathService::next_tick() {
+	this->tick_requests.clear();
+
+	// the searches which did not run yet are done on this thread
+	if (this->blocked) {
+		this->allow_searches();
+		this->searches.commit();
+		this->block_searches();
+	}
+	else {
+		this->searches.commit();
+	}
+}
+
+
+void PathService::allow_searches() {
+	ENSURE(this->blocked, "path searches are already allowed");
+	this->blocked = false;
+	this->state->terrain_lock.unlock();
+}
+
+
+void PathService::block_searches() {
+	ENSURE(not this->blocked, "path searches are already blocked");
+	this->state->terrain_lock.lock();
+	this->blocked = true;
+}
+
+}} // namespace openage::path
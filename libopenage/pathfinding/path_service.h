@@ -0,0 +1,199 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../job/cancellation_token.h"
+#include "../job/ordered_jobs.h"
+#include "path.h"
+
+namespace openage {
+
+namespace job {
+class JobManager;
+} // namespace job
+
+namespace path {
+
+class ChunkGraph;
+
+/**
+ * Shared state of one path request.
+ * Only accessed by the thread which issued the request.
+ */
+struct path_request {
+	/**
+	 * cancels the search, nobody waits for its path anymore.
+	 */
+	~path_request();
+
+	job::CancellationToken cancellation;
+	Path result;
+
+	/** The exception of a failed search. */
+	std::exception_ptr error;
+
+	/** The search result was committed. */
+	bool ready = false;
+};
+
+/**
+ * Handle to a path which is searched in the background.
+ * Copies refer to the same request.
+ */
+class PathHandle {
+public:
+	PathHandle() = default;
+	PathHandle(std::shared_ptr<path_request> request);
+
+	/**
+	 * Does this handle refer to a request?
+	 */
+	bool is_valid() const;
+
+	/**
+	 * Was the search result committed by next_tick()?
+	 * Invalid handles are never ready.
+	 */
+	bool is_ready() const;
+
+	/**
+	 * The found path. Must only be called if is_ready().
+	 * If the search failed, its exception is rethrown.
+	 */
+	Path get();
+
+private:
+	std::shared_ptr<path_request> request;
+};
+
+/**
+ * Runs path searches as jobs of the job manager.
+ *
+ * The searches read the terrain, which is modified by the game
+ * simulation and input handling. They are therefore only executed
+ * while the main thread allows it with allow_searches(), which it
+ * does while the game is drawn. block_searches() waits for running
+ * searches to finish.
+ *
+ * Identical requests of the same tick are only searched once:
+ * units of the same type which start in the same region
+ * and move to the same tile share one path.
+ *
+ * The paths requested in a tick become ready in the next one, in the
+ * order they were requested, no matter how many workers searched them
+ * or whether there is a job manager. Thus all peers of a game and its
+ * replay see the same paths in the same ticks.
+ */
+class PathService {
+public:
+	/**
+	 * Create the service. Without a job manager,
+	 * all searches are performed immediately.
+	 * Searches are blocked initially.
+	 */
+	PathService(job::JobManager *job_manager, ChunkGraph *graph);
+	~PathService();
+
+	PathService(const PathService &) = delete;
+	PathService &operator =(const PathService &) = delete;
+
+	/**
+	 * Request a path between two static points.
+	 *
+	 * @param mover identifies the movement rules of the unit, like its
+	 *              type. Requests are only shared between equal movers.
+	 * @param layer passability layer of the unit, to reject unreachable
+	 *              targets early. Terrain::no_passability_layer for none.
+	 */
+	PathHandle request(const void *mover,
+	                   coord::phys3 start,
+	                   coord::phys3 end,
+	                   std::function<bool(const coord::phys3 &)> passable,
+	                   size_t layer=SIZE_MAX);
+
+	/**
+	 * Begin a new tick: the paths requested in the last one become
+	 * ready, searching the ones which did not run yet right here.
+	 * Requests are no longer shared with the ones of earlier ticks.
+	 * Must be called before the terrain is modified in the tick.
+	 */
+	void next_tick();
+
+	/**
+	 * Let queued searches run. The terrain
+	 * must not be modified until block_searches().
+	 */
+	void allow_searches();
+
+	/**
+	 * Wait for running searches and hold back further ones,
+	 * so the terrain can be modified again.
+	 */
+	void block_searches();
+
+private:
+	/**
+	 * State shared with the search jobs, which may outlive the service.
+	 */
+	struct search_state {
+		/**
+		 * Held exclusively by the main thread while searches are blocked,
+		 * shared by the searches while they run.
+		 */
+		std::shared_timed_mutex terrain_lock;
+
+		/**
+		 * The service was destroyed, remaining jobs must not search.
+		 */
+		std::atomic_bool closed;
+	};
+
+	/**
+	 * Key to detect identical requests.
+	 */
+	struct request_key {
+		const void *mover;
+		coord::tile start_region;
+		coord::tile goal;
+
+		bool operator ==(const request_key &other) const;
+	};
+
+	struct request_key_hash {
+		size_t operator ()(const request_key &key) const;
+	};
+
+	job::JobManager *job_manager;
+	ChunkGraph *graph;
+
+	std::shared_ptr<search_state> state;
+
+	/**
+	 * Are searches blocked by the main thread right now?
+	 */
+	bool blocked;
+
+	/**
+	 * The requests of the current tick.
+	 */
+	std::unordered_map<request_key, std::shared_ptr<path_request>, request_key_hash> tick_requests;
+
+	/**
+	 * The searches of the current tick, committed by the next one.
+	 * Destroyed first, it waits for running searches.
+	 */
+	job::OrderedJobs searches;
+};
+
+} // namespace path
+} // namespace openage
@@ -0,0 +1,250 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "search_context.h"
+
+#include <cmath>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace path {
+
+namespace {
+
+/**
+ * Initial number of position table slots, must be a power of two.
+ */
+constexpr size_t initial_table_size = 1024;
+
+/**
+ * Spread the cell key over the table slots (fibonacci hashing).
+ */
+inline size_t slot_hash(uint64_t key, size_t mask) {
+	return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+} // anonymous namespace
+
+
+cost_t search_node::cost_to(const search_node &other) const {
+	cost_t dx = this->position.ne - other.position.ne;
+	cost_t dy = this->position.se - other.position.se;
+	return std::hypot(dx, dy) * other.factor * this->factor;
+}
+
+
+SearchContext::SearchContext()
+	:
+	table(initial_table_size, slot{0, no_node, 0}),
+	generation{0} {}
+
+
+void SearchContext::reset(const coord::phys3 &origin) {
+	this->origin = origin;
+	this->nodes.clear();
+	this->open.clear();
+
+	this->generation += 1;
+	if (this->generation == 0) {
+		// the counter wrapped, old entries could become valid again.
+		for (auto &entry : this->table) {
+			entry.generation = 0;
+		}
+		this->generation = 1;
+	}
+}
+
+
+uint64_t SearchContext::cell_key(const coord::phys3 &pos) const {
+	// all nodes of a search lie on the grid through the origin.
+	uint32_t ne = static_cast<uint32_t>((pos.ne - this->origin.ne) / path_grid_size);
+	uint32_t se = static_cast<uint32_t>((pos.se - this->origin.se) / path_grid_size);
+	return (static_cast<uint64_t>(ne) << 32) | se;
+}
+
+
+node_id SearchContext::find(const coord::phys3 &pos) const {
+	uint64_t key = this->cell_key(pos);
+	size_t mask = this->table.size() - 1;
+
+	for (size_t idx = slot_hash(key, mask);; idx = (idx + 1) & mask) {
+		const slot &entry = this->table[idx];
+		if (entry.generation != this->generation) {
+			return no_node;
+		}
+		if (entry.key == key) {
+			return entry.node;
+		}
+	}
+}
+
+
+search_node SearchContext::make_node(const coord::phys3 &pos, node_id prev) const {
+	search_node node;
+	node.position       = pos;
+	node.dir_ne         = 0.0f;
+	node.dir_se         = 0.0f;
+	node.factor         = 1.0f;
+	node.past_cost      = 0.0f;
+	node.heuristic_cost = 0.0f;
+	node.future_cost    = 0.0f;
+	node.predecessor    = prev;
+	node.heap_index     = no_node;
+	node.closed         = false;
+
+	if (prev != no_node) {
+		const search_node &p = this->nodes[prev];
+		cost_t dx = pos.ne - p.position.ne;
+		cost_t dy = pos.se - p.position.se;
+		cost_t hyp = std::hypot(dx, dy);
+		node.dir_ne = dx / hyp;
+		node.dir_se = dy / hyp;
+		cost_t similarity = node.dir_ne * p.dir_ne + node.dir_se * p.dir_se;
+		node.factor += (1 - similarity);
+	}
+
+	return node;
+}
+
+
+node_id SearchContext::insert(const search_node &node) {
+	ENSURE(this->nodes.size() < no_node, "search node pool exhausted");
+
+	// keep the load factor below 0.5
+	if ((this->nodes.size() + 1) * 2 > this->table.size()) {
+		this->grow_table();
+	}
+
+	node_id id = this->nodes.size();
+	this->nodes.push_back(node);
+
+	uint64_t key = this->cell_key(node.position);
+	size_t mask = this->table.size() - 1;
+	size_t idx = slot_hash(key, mask);
+	while (this->table[idx].generation == this->generation) {
+		idx = (idx + 1) & mask;
+	}
+	this->table[idx] = {key, id, this->generation};
+
+	return id;
+}
+
+
+void SearchContext::grow_table() {
+	std::vector<slot> old_table(this->table.size() * 2, slot{0, no_node, 0});
+	std::swap(this->table, old_table);
+
+	// the new table starts out empty, so one fixed generation suffices.
+	this->generation = 1;
+
+	size_t mask = this->table.size() - 1;
+	for (node_id id = 0; id < this->nodes.size(); id++) {
+		uint64_t key = this->cell_key(this->nodes[id].position);
+		size_t idx = slot_hash(key, mask);
+		while (this->table[idx].generation == this->generation) {
+			idx = (idx + 1) & mask;
+		}
+		this->table[idx] = {key, id, this->generation};
+	}
+}
+
+
+void SearchContext::open_push(node_id id) {
+	this->nodes[id].heap_index = this->open.size();
+	this->open.push_back(id);
+	this->sift_up(this->open.size() - 1);
+}
+
+
+void SearchContext::open_decrease(node_id id) {
+	this->sift_up(this->nodes[id].heap_index);
+}
+
+
+node_id SearchContext::open_pop() {
+	node_id top = this->open.front();
+	this->nodes[top].heap_index = no_node;
+
+	node_id last = this->open.back();
+	this->open.pop_back();
+
+	if (not this->open.empty()) {
+		this->open[0] = last;
+		this->nodes[last].heap_index = 0;
+		this->sift_down(0);
+	}
+
+	return top;
+}
+
+
+void SearchContext::sift_up(uint32_t idx) {
+	node_id id = this->open[idx];
+	cost_t cost = this->nodes[id].future_cost;
+
+	while (idx > 0) {
+		uint32_t parent = (idx - 1) / 2;
+		node_id parent_id = this->open[parent];
+		if (not (cost < this->nodes[parent_id].future_cost)) {
+			break;
+		}
+		this->open[idx] = parent_id;
+		this->nodes[parent_id].heap_index = idx;
+		idx = parent;
+	}
+
+	this->open[idx] = id;
+	this->nodes[id].heap_index = idx;
+}
+
+
+void SearchContext::sift_down(uint32_t idx) {
+	node_id id = this->open[idx];
+	cost_t cost = this->nodes[id].future_cost;
+	uint32_t count = this->open.size();
+
+	while (true) {
+		uint32_t child = 2 * idx + 1;
+		if (child >= count) {
+			break;
+		}
+		if (child + 1 < count and
+		    this->nodes[this->open[child + 1]].future_cost < this->nodes[this->open[child]].future_cost) {
+			child += 1;
+		}
+
+		node_id child_id = this->open[child];
+		if (not (this->nodes[child_id].future_cost < cost)) {
+			break;
+		}
+		this->open[idx] = child_id;
+		this->nodes[child_id].heap_index = idx;
+		idx = child;
+	}
+
+	this->open[idx] = id;
+	this->nodes[id].heap_index = idx;
+}
+
+
+Path SearchContext::backtrace(node_id id) const {
+	std::vector<Node> waypoints;
+
+	// the start node has no predecessor and is not included
+	while (id != no_node and this->nodes[id].predecessor != no_node) {
+		const search_node &current = this->nodes[id];
+
+		Node waypoint{current.position, nullptr, current.past_cost, current.heuristic_cost};
+		waypoint.dir_ne = current.dir_ne;
+		waypoint.dir_se = current.dir_se;
+		waypoint.factor = current.factor;
+		waypoints.push_back(waypoint);
+
+		id = current.predecessor;
+	}
+
+	return {waypoints};
+}
+
+
+}} // namespace openage::path
@@ -0,0 +1,186 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "path.h"
+
+namespace openage {
+namespace path {
+
+/**
+ * Index of a node in the SearchContext node pool.
+ */
+using node_id = uint32_t;
+
+/**
+ * Marker for "no node".
+ */
+constexpr node_id no_node = UINT32_MAX;
+
+/**
+ * Compact navigation node as used during a search.
+ *
+ * Unlike Node, this is plain data without ownership:
+ * predecessors are referenced by their pool index.
+ */
+struct search_node {
+	coord::phys3 position;
+	cost_t dir_ne, dir_se;  //!< movement direction when reached, for path smoothing
+	cost_t factor;          //!< movement cost factor, see Node::factor
+	cost_t past_cost;
+	cost_t heuristic_cost;
+	cost_t future_cost;
+	node_id predecessor;
+	uint32_t heap_index;    //!< position in the open list, no_node if not contained
+	bool closed;            //!< was selected as best candidate once
+
+	/**
+	 * Movement cost to another node, equal to Node::cost_to.
+	 */
+	cost_t cost_to(const search_node &other) const;
+};
+
+/**
+ * Reusable storage for A* searches.
+ *
+ * All nodes live in one contiguous pool and are addressed by index.
+ * Positions are mapped to nodes by an open addressing table
+ * keyed by the grid cell relative to the search start.
+ * Entries of previous searches are invalidated by a generation
+ * counter, so resetting the context does not touch the memory
+ * and no allocations happen once the buffers have grown.
+ *
+ * A context must only be used by one search at a time,
+ * a_star() keeps one per thread.
+ */
+class SearchContext {
+public:
+	SearchContext();
+
+	/**
+	 * Prepare a new search beginning at the given position.
+	 * Nodes from previous searches become invalid.
+	 */
+	void reset(const coord::phys3 &origin);
+
+	/**
+	 * Find the node at the given position.
+	 * @returns no_node if no node was created there yet.
+	 */
+	node_id find(const coord::phys3 &pos) const;
+
+	/**
+	 * Prepare a node at the given position, reached from prev.
+	 * Its movement direction and cost factor are derived from prev.
+	 * The node is not added to the search before insert() is called.
+	 */
+	search_node make_node(const coord::phys3 &pos, node_id prev) const;
+
+	/**
+	 * Add a node to the pool and register its position.
+	 * The position must not have a node yet.
+	 */
+	node_id insert(const search_node &node);
+
+	/**
+	 * Access a node by its index.
+	 */
+	search_node &get(node_id id) {
+		return this->nodes[id];
+	}
+
+	const search_node &get(node_id id) const {
+		return this->nodes[id];
+	}
+
+	/**
+	 * Number of nodes created in the current search.
+	 */
+	size_t size() const {
+		return this->nodes.size();
+	}
+
+	/**
+	 * Add a node to the open list.
+	 */
+	void open_push(node_id id);
+
+	/**
+	 * Restore the open list order after the future cost of a
+	 * contained node decreased.
+	 */
+	void open_decrease(node_id id);
+
+	/**
+	 * Remove and return the cheapest node of the open list.
+	 */
+	node_id open_pop();
+
+	/**
+	 * Is the open list empty?
+	 */
+	bool open_empty() const {
+		return this->open.empty();
+	}
+
+	/**
+	 * Create the waypoint list by walking the predecessors from the
+	 * given node back to the start. The start is not included.
+	 */
+	Path backtrace(node_id id) const;
+
+private:
+	/**
+	 * Hash table key of the grid cell containing the position.
+	 */
+	uint64_t cell_key(const coord::phys3 &pos) const;
+
+	/**
+	 * Grow the position table and reinsert all current nodes.
+	 */
+	void grow_table();
+
+	void sift_up(uint32_t idx);
+	void sift_down(uint32_t idx);
+
+	/**
+	 * One position table entry.
+	 */
+	struct slot {
+		uint64_t key;
+		node_id node;
+		uint32_t generation;
+	};
+
+	/**
+	 * Origin of the search grid.
+	 */
+	coord::phys3 origin;
+
+	/**
+	 * Node pool for the current search.
+	 */
+	std::vector<search_node> nodes;
+
+	/**
+	 * Position table, its size is always a power of two.
+	 */
+	std::vector<slot> table;
+
+	/**
+	 * Entries with another generation are free.
+	 */
+	uint32_t generation;
+
+	/**
+	 * Open list, implemented as binary heap on future_cost.
+	 */
+	std::vector<node_id> open;
+};
+
+} // namespace path
+} // namespace openage
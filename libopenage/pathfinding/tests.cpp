@@ -1,10 +1,23 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "../log/log.h"
 #include "../testing/testing.h"
+#include "../util/timing.h"
 
+#include "a_star.h"
+#include "flow_field.h"
 #include "heuristics.h"
 #include "path.h"
+#include "search_context.h"
 
 namespace openage {
 namespace path {
@@ -295,20 +308,9 @@ bool not_passable(const coord::phys3 &) {
 }
 
 /**
- * This is a helper passable function that only returns true when
- * pos.ne == 20.
- */
-bool sometimes_passable(const coord::phys3 &pos) {
-	if (pos.ne == 20) {
-		return false;
-	} else {
-		return true;
-	}
-}
-
-/**
- * This function tests passable_line. Tests with always false, always true,
- * and position dependant functions being passed in as args.
+ * This function tests passable_line. Tests with always false and always
+ * true functions, and checks that the line tests each grid cell it
+ * touches exactly once.
  */
 void node_passable_line_0() {
 	coord::phys3 p0{0, 0, 0};
@@ -320,10 +322,335 @@ void node_passable_line_0() {
 	(path::passable_line(n0, n1, path::tests::always_passable) == true) or TESTFAIL;
 	(path::passable_line(n0, n1, path::tests::not_passable) == false) or TESTFAIL;
 
-	// The next 2 cases show that a different sample can change the results
-	// for the same path
-	(path::passable_line(n0, n1, path::tests::sometimes_passable, 10) == true) or TESTFAIL;
-	(path::passable_line(n0, n1, path::tests::sometimes_passable, 50) == false) or TESTFAIL;
+	auto cell_of = [](const coord::phys3 &pos) {
+		return std::make_pair(
+			static_cast<int>(std::floor(static_cast<double>(pos.ne) / path_grid_size)),
+			static_cast<int>(std::floor(static_cast<double>(pos.se) / path_grid_size))
+		);
+	};
+
+	auto check_line = [&](const coord::phys3 &from, const coord::phys3 &to) {
+		// the cells the line touches, by sampling it densely
+		std::set<std::pair<int, int>> expected;
+		constexpr int samples = 100000;
+		for (int i = 1; i <= samples; i++) {
+			double t = static_cast<double>(i) / samples;
+			expected.insert(cell_of(coord::phys3{
+				static_cast<coord::phys_t>(from.ne + t * (to.ne - from.ne)),
+				static_cast<coord::phys_t>(from.se + t * (to.se - from.se)),
+				0
+			}));
+		}
+		expected.erase(cell_of(from));
+
+		std::vector<std::pair<int, int>> tested;
+		auto record = [&](const coord::phys3 &pos) {
+			tested.push_back(cell_of(pos));
+			return true;
+		};
+		path::passable_line(from, to, record) or TESTFAIL;
+
+		(tested.size() == expected.size()) or TESTFAIL;
+		(std::set<std::pair<int, int>>(tested.begin(), tested.end()) == expected) or TESTFAIL;
+	};
+
+	check_line(coord::phys3{path_grid_size / 2, path_grid_size / 3, 0},
+	           coord::phys3{20 * path_grid_size + 100, 7 * path_grid_size + 3000, 0});
+	check_line(coord::phys3{5 * path_grid_size + 300, 2 * path_grid_size + 100, 0},
+	           coord::phys3{-13 * path_grid_size + 700, -4 * path_grid_size - 900, 0});
+	check_line(coord::phys3{-path_grid_size / 2, 3 * path_grid_size, 0},
+	           coord::phys3{-path_grid_size / 2, -9 * path_grid_size - 1, 0});
+
+	// a wall of single cells, thinner than the old sample spacing
+	auto wall = [&](const coord::phys3 &pos) {
+		return cell_of(pos).first != 7;
+	};
+	coord::phys3 far{20 * path_grid_size, 2 * path_grid_size, 0};
+	(path::passable_line(p0, far, wall) == false) or TESTFAIL;
+	(path::passable_line(p0, coord::phys3{7 * path_grid_size - 1, 0, 0}, wall) == true) or TESTFAIL;
+}
+
+/**
+ * This function tests that compressing a path removes the waypoints
+ * in the middle of straight lines and keeps the turns.
+ */
+void path_compress_0() {
+	coord::phys3 start{0, 0, 0};
+	const int cells[][2] = {{5, 4}, {4, 3}, {3, 2}, {3, 1}, {3, 0}, {2, 0}, {1, 0}};
+
+	std::vector<Node> nodes;
+	for (auto &cell : cells) {
+		nodes.emplace_back(coord::phys3{cell[0] * path_grid_size, cell[1] * path_grid_size, 0}, nullptr);
+	}
+
+	Path path{nodes};
+	path.compress(start);
+
+	(path.waypoints.size() == 3) or TESTFAIL;
+	(path.waypoints[0].position == nodes[0].position) or TESTFAIL;
+	(path.waypoints[1].position == nodes[2].position) or TESTFAIL;
+	(path.waypoints[2].position == nodes[4].position) or TESTFAIL;
+
+	// turning back is kept as well
+	Path back{{Node{coord::phys3{0, 0, 0}, nullptr}, Node{coord::phys3{path_grid_size, 0, 0}, nullptr}}};
+	back.compress(start);
+	(back.waypoints.size() == 2) or TESTFAIL;
+}
+
+/**
+ * This function tests that smoothing a path only removes the
+ * waypoints that can be skipped by a passable straight line.
+ */
+void path_smooth_0() {
+	coord::phys3 start{0, 0, 0};
+	std::vector<Node> nodes;
+	for (int i = 10; i > 0; i--) {
+		nodes.emplace_back(coord::phys3{i * path_grid_size, 0, 0}, nullptr);
+	}
+
+	Path straight{nodes};
+	straight.smooth(start, always_passable);
+	(straight.waypoints.size() == 1) or TESTFAIL;
+	(straight.waypoints.front().position == nodes.front().position) or TESTFAIL;
+
+	// around a corner, the corner stays
+	nodes.clear();
+	for (int i = 5; i > 0; i--) {
+		nodes.emplace_back(coord::phys3{5 * path_grid_size, i * path_grid_size, 0}, nullptr);
+	}
+	for (int i = 5; i > 0; i--) {
+		nodes.emplace_back(coord::phys3{i * path_grid_size, 0, 0}, nullptr);
+	}
+	auto corner = [](const coord::phys3 &pos) {
+		return pos.ne >= 5 * path_grid_size or pos.se <= 0;
+	};
+
+	Path around{nodes};
+	around.smooth(start, corner);
+	(around.waypoints.size() == 2) or TESTFAIL;
+	(around.waypoints.back().position == coord::phys3{5 * path_grid_size, 0, 0}) or TESTFAIL;
+	(around.waypoints.front().position == nodes.front().position) or TESTFAIL;
+
+	// long lines are split
+	nodes.clear();
+	for (int i = 100; i > 0; i--) {
+		coord::phys_t wiggle = (i % 2) * path_grid_size;
+		nodes.emplace_back(coord::phys3{i * path_grid_size, wiggle, 0}, nullptr);
+	}
+	Path wiggly{nodes};
+	wiggly.smooth(start, always_passable);
+	(wiggly.waypoints.size() > 1) or TESTFAIL;
+	(wiggly.waypoints.size() < 10) or TESTFAIL;
+	(wiggly.waypoints.front().position == nodes.front().position) or TESTFAIL;
+}
+
+/**
+ * This function tests the index based search context.
+ * Nodes are found again by position, the open list returns
+ * the cheapest node and a reset forgets all nodes.
+ */
+void search_context_0() {
+	SearchContext search;
+	coord::phys3 p0{0, 0, 0};
+	search.reset(p0);
+
+	node_id ids[8];
+	for (int n = 0; n < 8; ++n) {
+		search_node node = search.make_node(p0 + neigh_phys[n], no_node);
+		node.future_cost = 8 - n;
+		ids[n] = search.insert(node);
+		search.open_push(ids[n]);
+	}
+
+	for (int n = 0; n < 8; ++n) {
+		(search.find(p0 + neigh_phys[n]) == ids[n]) or TESTFAIL;
+	}
+	(search.find(p0) == no_node) or TESTFAIL;
+
+	// make the first node the cheapest one
+	search.get(ids[0]).future_cost = 0;
+	search.open_decrease(ids[0]);
+
+	(search.open_pop() == ids[0]) or TESTFAIL;
+	(search.open_pop() == ids[7]) or TESTFAIL;
+
+	search.reset(p0);
+	(search.size() == 0) or TESTFAIL;
+	(search.open_empty()) or TESTFAIL;
+	(search.find(p0 + neigh_phys[0]) == no_node) or TESTFAIL;
+}
+
+/**
+ * This function tests a_star on an open field and around a wall,
+ * reusing one search context for both searches.
+ */
+void a_star_0() {
+	SearchContext search;
+	coord::phys3 start{0, 0, 0};
+	coord::phys3 end{10 * path_grid_size, 0, 0};
+
+	auto valid_end = [&](const coord::phys3 &pos) -> bool {
+		return pos == end;
+	};
+	auto heuristic = [&](const coord::phys3 &pos) -> cost_t {
+		return euclidean_cost(pos, end);
+	};
+
+	Path direct = a_star(search, start, valid_end, heuristic, always_passable);
+	(direct.waypoints.size() == 10) or TESTFAIL;
+	(direct.waypoints.front().position == end) or TESTFAIL;
+
+	// wall between start and end, with a gap far off the straight line
+	auto wall = [&](const coord::phys3 &pos) -> bool {
+		return pos.ne != 5 * path_grid_size or pos.se > 3 * path_grid_size;
+	};
+
+	Path detour = a_star(search, start, valid_end, heuristic, wall);
+	(detour.waypoints.size() > 10) or TESTFAIL;
+	(detour.waypoints.front().position == end) or TESTFAIL;
+	for (auto &waypoint : detour.waypoints) {
+		wall(waypoint.position) or TESTFAIL;
+	}
+}
+
+/**
+ * This function tests that a detour is only searched
+ * within the margin around the way it replaces.
+ */
+void detour_0() {
+	coord::phys3 start{0, 0, 0};
+	coord::phys3 end{10 * path_grid_size, 0, 0};
+
+	// wall across the straight line, 8 cells long
+	auto wall = [](const coord::phys3 &pos) -> bool {
+		return pos.ne < 5 * path_grid_size or pos.ne >= 6 * path_grid_size or
+		       pos.se <= -4 * path_grid_size or pos.se >= 4 * path_grid_size;
+	};
+
+	Path around = detour(start, end, wall, 6 * path_grid_size);
+	(not around.waypoints.empty()) or TESTFAIL;
+	(std::hypot(around.waypoints.front().position.ne - end.ne,
+	            around.waypoints.front().position.se - end.se) < path_grid_size) or TESTFAIL;
+	for (auto &waypoint : around.waypoints) {
+		wall(waypoint.position) or TESTFAIL;
+	}
+
+	// the ends of the wall are outside a narrow margin
+	Path narrow = detour(start, end, wall, path_grid_size);
+	narrow.waypoints.empty() or TESTFAIL;
+}
+
+/**
+ * Are all cells on the straight or diagonal grid line
+ * from one position to another passable?
+ */
+bool passable_grid_line(coord::phys3 from, const coord::phys3 &to,
+                        const std::function<bool(const coord::phys3 &)> &passable) {
+	coord::phys_t dne = to.ne - from.ne;
+	coord::phys_t dse = to.se - from.se;
+	if (dne != 0 and dse != 0 and std::llabs(dne) != std::llabs(dse)) {
+		return false;
+	}
+
+	coord::phys3_delta step{
+		((dne > 0) - (dne < 0)) * path_grid_size,
+		((dse > 0) - (dse < 0)) * path_grid_size,
+		0
+	};
+	while (not (from == to)) {
+		from += step;
+		if (not passable(from)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * This function tests the jump point search mode of a_star:
+ * it finds the same targets with fewer nodes, and the lines
+ * between its waypoints are passable.
+ */
+void jump_point_0() {
+	SearchContext search;
+	coord::phys3 start{0, 0, 0};
+	coord::phys3 end{10 * path_grid_size, 3 * path_grid_size, 0};
+
+	auto valid_end = [&](const coord::phys3 &pos) -> bool {
+		return pos == end;
+	};
+	auto heuristic = [&](const coord::phys3 &pos) -> cost_t {
+		return euclidean_cost(pos, end);
+	};
+
+	a_star(search, start, valid_end, heuristic, always_passable);
+	size_t a_star_nodes = search.size();
+
+	Path direct = a_star(search, start, valid_end, heuristic, always_passable, search_mode::jump_points);
+	(direct.waypoints.front().position == end) or TESTFAIL;
+	(direct.waypoints.size() == 2) or TESTFAIL;
+	(search.size() < a_star_nodes) or TESTFAIL;
+
+	// wall between start and end, with a gap far off the straight line
+	auto wall = [&](const coord::phys3 &pos) -> bool {
+		return pos.ne != 5 * path_grid_size or pos.se > 6 * path_grid_size;
+	};
+
+	Path detour = a_star(search, start, valid_end, heuristic, wall, search_mode::jump_points);
+	(detour.waypoints.front().position == end) or TESTFAIL;
+
+	coord::phys3 from = start;
+	for (auto it = detour.waypoints.rbegin(); it != detour.waypoints.rend(); ++it) {
+		passable_grid_line(from, it->position, wall) or TESTFAIL;
+		from = it->position;
+	}
+
+	// no way around the wall
+	auto closed = [&](const coord::phys3 &pos) -> bool {
+		return pos.ne != 5 * path_grid_size;
+	};
+	Path blocked = a_star(search, start, valid_end, heuristic, closed, search_mode::jump_points);
+	for (auto &waypoint : blocked.waypoints) {
+		(waypoint.position.ne < 5 * path_grid_size) or TESTFAIL;
+	}
+}
+
+/**
+ * This function tests the flow field directions and costs
+ * on an open field and around a wall.
+ */
+void flow_field_0() {
+	coord::tile goal{0, 0};
+	const cost_t tile_cost = coord::settings::phys_per_tile;
+
+	FlowField open{goal, 8, [](const coord::tile &) { return true; }};
+	coord::tile_delta dir;
+
+	(open.cost(goal) == 0) or TESTFAIL;
+	(open.cost(coord::tile{3, 0}) == 3 * tile_cost) or TESTFAIL;
+	open.direction(coord::tile{3, 0}, dir) or TESTFAIL;
+	(dir == coord::tile_delta{-1, 0}) or TESTFAIL;
+	open.direction(coord::tile{-2, -2}, dir) or TESTFAIL;
+	(dir == coord::tile_delta{1, 1}) or TESTFAIL;
+
+	// not covered by the field
+	(not open.direction(coord::tile{9, 0}, dir)) or TESTFAIL;
+
+	// wall with a gap at se = 6
+	auto wall = [](const coord::tile &tile) {
+		return tile.ne != 2 or tile.se == 6;
+	};
+	FlowField blocked{goal, 8, wall};
+	(blocked.cost(coord::tile{3, 0}) > 3 * tile_cost) or TESTFAIL;
+
+	// following the directions leads to the goal
+	coord::tile pos{4, 0};
+	for (int steps = 0; not (pos == goal); steps++) {
+		(steps < 32) or TESTFAIL;
+		blocked.direction(pos, dir) or TESTFAIL;
+		pos += dir;
+		wall(pos) or TESTFAIL;
+	}
 }
 
 /**
@@ -336,6 +663,94 @@ void path_node() {
 	node_generate_backtrace_0();
 	node_get_neighbors_0();
 	node_passable_line_0();
+	path_compress_0();
+	path_smooth_0();
+	search_context_0();
+	a_star_0();
+	detour_0();
+	jump_point_0();
+	flow_field_0();
+}
+
+
+// exported demo
+void jump_point_benchmark() {
+	constexpr int width = 256;
+	constexpr int blocks = 300;
+	constexpr int searches = 20;
+
+	// a map with blocks of impassable cells, like forests
+	std::vector<bool> blocked(width * width, false);
+	uint32_t state = 1;
+	auto random = [&](int range) {
+		state = state * 1664525 + 1013904223;
+		return static_cast<int>((state >> 8) % range);
+	};
+	for (int i = 0; i < blocks; i++) {
+		int ne = random(width), se = random(width);
+		int size_ne = 1 + random(16), size_se = 1 + random(16);
+		for (int x = ne; x < std::min(ne + size_ne, width); x++) {
+			for (int y = se; y < std::min(se + size_se, width); y++) {
+				blocked[y * width + x] = true;
+			}
+		}
+	}
+
+	auto cell_passable = [&](int ne, int se) {
+		return ne >= 0 and se >= 0 and ne < width and se < width and not blocked[se * width + ne];
+	};
+	std::function<bool(const coord::phys3 &)> passable = [&](const coord::phys3 &pos) {
+		return cell_passable(pos.ne / path_grid_size, pos.se / path_grid_size);
+	};
+
+	auto random_cell = [&]() {
+		while (true) {
+			int ne = random(width), se = random(width);
+			if (cell_passable(ne, se)) {
+				return coord::phys3{ne * path_grid_size, se * path_grid_size, 0};
+			}
+		}
+	};
+
+	std::vector<std::pair<coord::phys3, coord::phys3>> queries;
+	for (int i = 0; i < searches; i++) {
+		queries.emplace_back(random_cell(), random_cell());
+	}
+
+	SearchContext search;
+	auto run = [&](const char *name, search_mode mode) {
+		size_t nodes = 0;
+		int reached = 0;
+		double length = 0;
+
+		time_nsec_t begin = timing::get_monotonic_time();
+		for (auto &query : queries) {
+			const coord::phys3 &end = query.second;
+			auto valid_end = [&](const coord::phys3 &pos) { return pos == end; };
+			auto heuristic = [&](const coord::phys3 &pos) { return euclidean_cost(pos, end); };
+
+			Path path = a_star(search, query.first, valid_end, heuristic, passable, mode);
+			nodes += search.size();
+			if (not path.waypoints.empty() and path.waypoints.front().position == end) {
+				reached += 1;
+
+				coord::phys3 from = query.first;
+				for (auto it = path.waypoints.rbegin(); it != path.waypoints.rend(); ++it) {
+					length += std::hypot(it->position.ne - from.ne, it->position.se - from.se);
+					from = it->position;
+				}
+			}
+		}
+		double ms = (timing::get_monotonic_time() - begin) / 1e6 / searches;
+
+		log::log(MSG(info) << name << ": " << ms << " ms and "
+		         << nodes / searches << " nodes per search, "
+		         << reached << "/" << searches << " reached, "
+		         << "length " << length / coord::settings::phys_per_tile << " tiles");
+	};
+
+	run("a*", search_mode::neighbors);
+	run("jump point search", search_mode::jump_points);
 }
 
 } // namespace tests
@@ -0,0 +1,101 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "batch.h"
+
+#include "../testing/testing.h"
+#include "pyobject.h"
+
+namespace openage {
+namespace pyinterface {
+
+
+CallBatch::CallBatch() {}
+
+
+void CallBatch::add(std::function<void ()> call) {
+	this->calls.push_back(std::move(call));
+}
+
+
+size_t CallBatch::size() const {
+	return this->calls.size();
+}
+
+
+bool CallBatch::empty() const {
+	return this->calls.empty();
+}
+
+
+void CallBatch::run() {
+	if (this->calls.empty()) {
+		return;
+	}
+
+	// cleared before running, so a throwing call doesn't leave it filled
+	std::vector<std::function<void ()>> queued;
+	queued.swap(this->calls);
+
+	Func<void> run_all = [&queued]() {
+		for (auto &call : queued) {
+			call();
+		}
+	};
+
+	py_with_gil.call(&run_all);
+}
+
+
+PyIfFunc<void, Func<void> *> py_with_gil;
+
+
+namespace tests {
+
+
+void batch() {
+	PyObjectRef x = py::builtin("list").call();
+	PyObjectRef append = x.getattr("append");
+
+	CallBatch calls;
+	TESTEQUALS(calls.empty(), true);
+
+	for (int i = 0; i < 3; i++) {
+		calls.add([&append, i]() {
+			append.call(py::integer(i));
+		});
+	}
+	TESTEQUALS(calls.size(), 3u);
+
+	// nothing runs before run()
+	TESTEQUALS(x.repr(), "[]");
+	calls.run();
+	TESTEQUALS(x.repr(), "[0, 1, 2]");
+	TESTEQUALS(calls.empty(), true);
+
+	// the remaining calls are dropped after an exception
+	calls.add([&x]() {
+		x.getattr("nonexisting");
+	});
+	calls.add([&append]() {
+		append.call(py::integer(3));
+	});
+	TESTTHROWS(calls.run());
+	TESTEQUALS(calls.empty(), true);
+	TESTEQUALS(x.repr(), "[0, 1, 2]");
+
+	// the getattr calls were counted
+	bool found = false;
+	for (auto &timing : func_timings()) {
+		if (timing.name.find("py_getattr") != std::string::npos) {
+			TESTEQUALS(timing.calls > 0, true);
+			found = true;
+		}
+	}
+	TESTEQUALS(found, true);
+}
+
+
+} // tests
+
+
+}} // openage::pyinterface
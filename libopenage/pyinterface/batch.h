@@ -0,0 +1,71 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// pxd: from libopenage.pyinterface.functional cimport Func0, PyIfFunc1
+#include "functional.h"
+
+
+namespace openage {
+namespace pyinterface {
+
+
+/**
+ * Queues calls into Python, and runs all of them while holding the GIL once.
+ *
+ * Each PyIfFunc call acquires the GIL on its own, which costs more than
+ * most of the calls themselves. Code that calls into Python often per
+ * frame (e.g. hooks, asset lookups) adds its calls to a batch instead
+ * and runs the batch once.
+ *
+ * The arguments are copied into the batch, so pointer arguments must stay
+ * valid until run() has returned.
+ */
+class CallBatch {
+public:
+	CallBatch();
+
+	/**
+	 * queues func(args...).
+	 */
+	template<typename ... ArgTypes>
+	void add(const PyIfFunc<void, ArgTypes ...> &func, ArgTypes ... args) {
+		this->calls.push_back([&func, args...]() {
+			func.call(args...);
+		});
+	}
+
+	/**
+	 * queues any other call, e.g. a lambda that uses PyObjectRefs.
+	 */
+	void add(std::function<void ()> call);
+
+	/**
+	 * number of queued calls.
+	 */
+	size_t size() const;
+	bool empty() const;
+
+	/**
+	 * runs the queued calls in order, in one GIL acquisition, and clears
+	 * the batch. if a call throws, the remaining calls are dropped and
+	 * the exception is passed on.
+	 */
+	void run();
+
+private:
+	std::vector<std::function<void ()>> calls;
+};
+
+
+/**
+ * calls func while holding the GIL.
+ */
+// pxd: PyIfFunc1[void, Func0[void] *] py_with_gil
+extern PyIfFunc<void, Func<void> *> py_with_gil;
+
+
+}} // openage::pyinterface
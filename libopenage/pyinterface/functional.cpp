@@ -1,9 +1,65 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "functional.h"
 
+#include <map>
+
+#include "../util/compiler.h"
+
 namespace openage {
 namespace pyinterface {
 
 
+namespace {
+
+struct counter_registry {
+	std::mutex lock;
+	std::map<const void *, const func_counters *> counters;
+
+	// initialized on first use, the PyIfFuncs are global objects, too
+	static counter_registry &get() {
+		static counter_registry val;
+		return val;
+	}
+};
+
+} // anonymous namespace
+
+
+void add_func_counters(const void *thisptr, const func_counters *counters) {
+	counter_registry &registry = counter_registry::get();
+	std::unique_lock<std::mutex> lock{registry.lock};
+	registry.counters[thisptr] = counters;
+}
+
+
+void remove_func_counters(const void *thisptr) {
+	counter_registry &registry = counter_registry::get();
+	std::unique_lock<std::mutex> lock{registry.lock};
+	registry.counters.erase(thisptr);
+}
+
+
+std::vector<func_timing> func_timings() {
+	counter_registry &registry = counter_registry::get();
+	std::unique_lock<std::mutex> lock{registry.lock};
+
+	std::vector<func_timing> result;
+	for (auto &entry : registry.counters) {
+		uint64_t calls = entry.second->calls.load(std::memory_order_relaxed);
+		if (calls == 0) {
+			continue;
+		}
+
+		result.push_back(func_timing{
+			util::symbol_name(entry.first),
+			calls,
+			entry.second->nsec.load(std::memory_order_relaxed)
+		});
+	}
+
+	return result;
+}
+
+
 }} // openage::pyinterface
@@ -1,9 +1,14 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "../util/compiler.h"
 #include "../util/language.h"
@@ -385,6 +390,63 @@ template<typename RT, typename AT0, typename AT1, typename AT2, typename AT3, ty
 using Func5 = Func<RT, AT0, AT1, AT2, AT3, AT4>;
 
 
+/**
+ * Number of calls of a PyIfFunc, and the time spent in them.
+ */
+struct func_counters {
+	std::atomic<uint64_t> calls{0};
+	std::atomic<uint64_t> nsec{0};
+};
+
+
+/**
+ * Adds the time of a call to the counters when it goes out of scope.
+ */
+class func_call_timer {
+public:
+	explicit func_call_timer(func_counters &counters)
+		:
+		counters{counters},
+		start{std::chrono::steady_clock::now()} {}
+
+	~func_call_timer() {
+		auto duration = std::chrono::steady_clock::now() - this->start;
+		this->counters.calls.fetch_add(1, std::memory_order_relaxed);
+		this->counters.nsec.fetch_add(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+			std::memory_order_relaxed
+		);
+	}
+
+private:
+	func_counters &counters;
+	std::chrono::steady_clock::time_point start;
+};
+
+
+/**
+ * Registers the counters of a PyIfFunc for func_timings().
+ */
+void add_func_counters(const void *thisptr, const func_counters *counters);
+void remove_func_counters(const void *thisptr);
+
+
+/**
+ * The counters of one PyIfFunc, at the time of func_timings().
+ */
+struct func_timing {
+	std::string name;
+	uint64_t calls;
+	uint64_t nsec;
+};
+
+
+/**
+ * The counters of all PyIfFuncs that have been called, by name.
+ */
+std::vector<func_timing> func_timings();
+
+
 /**
  * For usage by "Py Interface Functions", i.e. empty global function pointers
  * in libopenage that get filled by Cython at initialization time.
@@ -402,6 +464,8 @@ using Func5 = Func<RT, AT0, AT1, AT2, AT3, AT4>;
  * ctypedef Func3 PyIfFunc3
  * ctypedef Func4 PyIfFunc4
  * ctypedef Func5 PyIfFunc5
+ *
+ * Calls via call() are counted and timed, see func_timings().
  */
 template<typename ReturnType, typename ... ArgTypes>
 class PyIfFunc : public Func<ReturnType, ArgTypes ...> {
@@ -415,12 +479,19 @@ public:
 				return false;
 			}
 		});
+		add_func_counters(this, &this->counters);
 	}
 
 	~PyIfFunc() {
+		remove_func_counters(this);
 		destroy_py_if_component(this);
 	}
 
+	ReturnType call(ArgTypes ...args) const {
+		func_call_timer timer{this->counters};
+		return Func<ReturnType, ArgTypes ...>::call(args...);
+	}
+
 	// no copy construction!
 	PyIfFunc<ReturnType, ArgTypes ...>(const PyIfFunc<ReturnType, ArgTypes ...> &other) = delete;
 	PyIfFunc<ReturnType, ArgTypes ...>(PyIfFunc<ReturnType, ArgTypes ...> &&other) = delete;
@@ -431,6 +502,9 @@ public:
 	operator Func<ReturnType, ArgTypes ...> &() const {
 		return static_cast<Func<ReturnType, ArgTypes ...>>(this->fptr);
 	}
+
+private:
+	mutable func_counters counters;
 };
 
 
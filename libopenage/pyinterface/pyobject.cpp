@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "pyobject.h"
 
@@ -104,6 +104,11 @@ std::string PyObjectRef::repr() const {
 }
 
 
+std::string PyObjectRef::bytes() const {
+	return py_bytes.call(this->ref);
+}
+
+
 int PyObjectRef::len() const {
 	return py_len.call(this->ref);
 }
@@ -121,6 +126,13 @@ PyObjectRef PyObjectRef::call() const {
 }
 
 
+PyObjectRef PyObjectRef::call(const PyObjectRef &arg) const {
+	PyObjectRef result;
+	py_call1.call(&result, this->ref, arg.get_ref());
+	return result;
+}
+
+
 bool PyObjectRef::hasattr(const std::string &name) const {
 	return py_hasattr.call(this->ref, name);
 }
@@ -257,6 +269,13 @@ PyObjectRef bytes(const char *value) {
 }
 
 
+PyObjectRef bytes(const std::string &value) {
+	PyObjectRef result;
+	py_createbytes_string.call(&result, value);
+	return result;
+}
+
+
 PyObjectRef integer(int value) {
 	PyObjectRef result;
 	py_createint.call(&result, value);
@@ -350,6 +369,17 @@ void pyobject() {
 	TESTEQUALS(pop.callable(), true);
 	TESTEQUALS(pop.call().repr(), "1");
 
+	PyObjectRef append;
+	TESTNOEXCEPT(append = x.getattr("append"));
+	TESTNOEXCEPT(append.call(py::integer(2)));
+	TESTEQUALS(x.repr(), "[2]");
+	TESTEQUALS(py::builtin("len").call(x).repr(), "1");
+
+	TESTEQUALS(py::bytes("foo").bytes(), "foo");
+	TESTEQUALS(dict.eval("b'a\\x00b'").bytes(), std::string("a\0b", 3));
+	TESTTHROWS(py::str("foo").bytes());
+	TESTEQUALS(py::bytes(std::string("a\0b", 3)).bytes(), std::string("a\0b", 3));
+
 	TESTEQUALS(py::builtin("True").to_bool(), true);
 	TESTEQUALS(py::builtin("False").to_bool(), false);
 	TESTEQUALS(x.to_bool(), false);
@@ -408,9 +438,11 @@ PyIfFunc<void, void *> py_xdecref;
 
 PyIfFunc<std::string, void *> py_str;
 PyIfFunc<std::string, void *> py_repr;
+PyIfFunc<std::string, void *> py_bytes;
 PyIfFunc<int, void *> py_len;
 PyIfFunc<bool, void *> py_callable;
 PyIfFunc<void, PyObjectRef *, void *> py_call;
+PyIfFunc<void, PyObjectRef *, void *, void *> py_call1;
 PyIfFunc<bool, void *, std::string> py_hasattr;
 PyIfFunc<void, PyObjectRef *, void *, std::string> py_getattr;
 PyIfFunc<void, void *, std::string, void *> py_setattr;
@@ -431,6 +463,7 @@ PyIfFunc<void, PyObjectRef *, std::string> py_builtin;
 PyIfFunc<void, PyObjectRef *, std::string> py_import;
 PyIfFunc<void, PyObjectRef *, std::string> py_createstr;
 PyIfFunc<void, PyObjectRef *, const char *> py_createbytes;
+PyIfFunc<void, PyObjectRef *, std::string> py_createbytes_string;
 PyIfFunc<void, PyObjectRef *, int> py_createint;
 PyIfFunc<void, PyObjectRef *> py_createdict;
 PyIfFunc<void, PyObjectRef *> py_getnone;
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -86,6 +86,11 @@ public:
 	 */
 	std::string repr() const;
 
+	/**
+	 * bytes(obj), for bytes-like objects
+	 */
+	std::string bytes() const;
+
 	/**
 	 * len(obj)
 	 */
@@ -103,6 +108,11 @@ public:
 	 */
 	PyObjectRef call() const;
 
+	/**
+	 * obj(arg)
+	 */
+	PyObjectRef call(const PyObjectRef &arg) const;
+
 	/**
 	 * getattr(obj, name)
 	 */
@@ -252,6 +262,12 @@ PyObjectRef str(const std::string &value);
 PyObjectRef bytes(const char *value);
 
 
+/**
+ * bytes(value), keeps null bytes in the value.
+ */
+PyObjectRef bytes(const std::string &value);
+
+
 /**
  * int(value)
  */
@@ -290,12 +306,16 @@ extern PyIfFunc<void, void *> py_xdecref;
 extern PyIfFunc<std::string, void *> py_str;
 // pxd: PyIfFunc1[string, void *] py_repr
 extern PyIfFunc<std::string, void *> py_repr;
+// pxd: PyIfFunc1[string, void *] py_bytes
+extern PyIfFunc<std::string, void *> py_bytes;
 // pxd: PyIfFunc1[int, void *] py_len
 extern PyIfFunc<int, void *> py_len;
 // pxd: PyIfFunc1[cppbool, void *] py_callable
 extern PyIfFunc<bool, void *> py_callable;
 // pxd: PyIfFunc2[void, PyObjectRefPtr, void *] py_call
 extern PyIfFunc<void, PyObjectRef *, void *> py_call;
+// pxd: PyIfFunc3[void, PyObjectRefPtr, void *, void *] py_call1
+extern PyIfFunc<void, PyObjectRef *, void *, void *> py_call1;
 // pxd: PyIfFunc2[cppbool, void *, string] py_hasattr
 extern PyIfFunc<bool, void *, std::string> py_hasattr;
 // pxd: PyIfFunc3[void, PyObjectRefPtr, void *, string] py_getattr
@@ -334,6 +354,8 @@ extern PyIfFunc<void, PyObjectRef *, std::string> py_import;
 extern PyIfFunc<void, PyObjectRef *, std::string> py_createstr;
 // pxd: PyIfFunc2[void, PyObjectRefPtr, const char *] py_createbytes
 extern PyIfFunc<void, PyObjectRef *, const char *> py_createbytes;
+// pxd: PyIfFunc2[void, PyObjectRefPtr, string] py_createbytes_string
+extern PyIfFunc<void, PyObjectRef *, std::string> py_createbytes_string;
 // pxd: PyIfFunc2[void, PyObjectRefPtr, int] py_createint
 extern PyIfFunc<void, PyObjectRef *, int> py_createint;
 // pxd: PyIfFunc1[void, PyObjectRefPtr] py_createdict
@@ -0,0 +1,155 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "render_benchmark.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "engine.h"
+#include "error/error.h"
+#include "gamestate/game_main.h"
+#include "gamestate/game_spec.h"
+#include "gamestate/generator.h"
+#include "log/log.h"
+#include "util/math_constants.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * frames drawn before the measurement, mostly loading textures.
+ */
+constexpr int warmup_frames = 60;
+
+/**
+ * the path is a figure eight of this size in camgame pixels,
+ * which repeats after this many frames.
+ */
+constexpr double path_width = 3000;
+constexpr double path_height = 1500;
+constexpr int path_period = 1200;
+
+} // anonymous namespace
+
+
+RenderBenchmark::RenderBenchmark(Engine *engine, const std::string &savefile, int frames)
+	:
+	engine{engine},
+	savefile{savefile},
+	frames{frames},
+	frame{0},
+	assets{nullptr} {
+
+	ENSURE(frames > 0, "the render benchmark needs at least one frame");
+
+	this->assets.set_engine(engine);
+	this->assets.set_data_dir_string(engine->get_data_dir()->basedir);
+
+	// all gl calls are on the engine thread, and frames aren't held back
+	engine->threaded_rendering.value = false;
+	engine->drawing_debug_overlay.value = false;
+	engine->set_vsync(false);
+
+	engine->register_tick_action(this);
+}
+
+
+RenderBenchmark::~RenderBenchmark() {
+	// the game uses the textures of this asset manager
+	this->engine->end_game();
+}
+
+
+void RenderBenchmark::load_game() {
+	this->spec = std::make_shared<GameSpec>(&this->assets);
+	if (not this->spec->initialize()) {
+		throw Error(MSG(err) << "could not load the game data for the render benchmark");
+	}
+
+	Generator generator{nullptr};
+	generator.setv("from_file", true);
+	generator.setv("load_filename", this->savefile);
+
+	this->engine->start_game(generator.create(this->spec));
+
+	// the generated maps are centered around the origin
+	Engine::get_coord_data()->camgame_phys = coord::phys3{0, 0, 0};
+	coord::camgame_delta start = path_position(0);
+	this->engine->move_phys_camera(start.x, -start.y);
+
+	log::log(MSG(info) << "Render benchmark: loaded " << this->savefile
+	         << ", measuring " << this->frames << " frames");
+}
+
+
+coord::camgame_delta RenderBenchmark::path_position(int frame) {
+	double angle = 2 * math::PI * frame / path_period;
+	return coord::camgame_delta{
+		static_cast<coord::pixel_t>(std::lround(path_width / 2 * std::sin(angle))),
+		static_cast<coord::pixel_t>(std::lround(path_height / 2 * std::sin(2 * angle)))
+	};
+}
+
+
+bool RenderBenchmark::on_tick() {
+	if (this->frame == 0) {
+		this->load_game();
+	}
+
+	int measured = this->frame - warmup_frames;
+	if (measured == 0) {
+		this->engine->get_profiler().record_histograms(true);
+	}
+	else if (measured > 0) {
+		// the frame that ended before this tick
+		this->frame_times.add(this->engine->lastframe_duration_nsec());
+	}
+
+	if (measured == this->frames) {
+		this->engine->get_profiler().record_histograms(false);
+		this->engine->stop();
+	}
+
+	// the same way through the map in each run
+	coord::camgame_delta move = path_position(this->frame + 1) - path_position(this->frame);
+	this->engine->move_phys_camera(move.x, -move.y);
+
+	this->frame++;
+	return true;
+}
+
+
+void RenderBenchmark::report(const std::string &filename) const {
+	std::ostringstream summary;
+	this->frame_times.write_summary(summary);
+	log::log(MSG(info) << "Render benchmark frame times: " << summary.str());
+
+	std::ostringstream stages;
+	this->engine->get_profiler().write_histograms(stages, false);
+	std::istringstream lines{stages.str()};
+	for (std::string line; std::getline(lines, line);) {
+		log::log(MSG(info) << "Render benchmark stage " << line);
+	}
+
+	if (filename.empty()) {
+		return;
+	}
+
+	std::ofstream file{filename};
+	file << "frame: ";
+	this->frame_times.write_summary(file);
+	file << std::endl;
+	this->frame_times.write_buckets(file);
+	this->engine->get_profiler().write_histograms(file);
+
+	file.close();
+	if (not file) {
+		throw Error(MSG(err) << "Could not write the render benchmark results to " << filename);
+	}
+
+	log::log(MSG(info) << "Render benchmark histograms written to " << filename);
+}
+
+} // openage
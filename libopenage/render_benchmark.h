@@ -0,0 +1,76 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "assetmanager.h"
+#include "handlers.h"
+#include "util/duration_histogram.h"
+
+namespace openage {
+
+class Engine;
+class GameSpec;
+
+/**
+ * Flies the camera over a saved game along a fixed path, to measure
+ * the rendering reproducibly.
+ *
+ * The path advances by the same distance each frame, regardless of the
+ * frame time. Vsync and the fps limit are off, so frames are drawn as
+ * fast as possible. After some frames to load the textures, the
+ * profiler records the durations of the engine's stages and the frame
+ * times into histograms, until the engine is stopped after the given
+ * number of frames.
+ */
+class RenderBenchmark : public TickHandler {
+public:
+	/**
+	 * @param savefile: the game to load, see gameio::load
+	 * @param frames: the number of measured frames
+	 */
+	RenderBenchmark(Engine *engine, const std::string &savefile, int frames);
+	~RenderBenchmark();
+
+	bool on_tick() override;
+
+	/**
+	 * logs a summary of the histograms, and writes them to the
+	 * given file unless it's empty.
+	 */
+	void report(const std::string &filename) const;
+
+private:
+	/**
+	 * loads the saved game, the job manager only runs
+	 * once the engine does.
+	 */
+	void load_game();
+
+	/**
+	 * the camera position of a frame, in camgame pixels relative
+	 * to the start of the path.
+	 */
+	static coord::camgame_delta path_position(int frame);
+
+	Engine *engine;
+	std::string savefile;
+	int frames;
+
+	/**
+	 * frames drawn so far, including the unmeasured ones.
+	 */
+	int frame;
+
+	AssetManager assets;
+	std::shared_ptr<GameSpec> spec;
+
+	/**
+	 * the durations of the measured frames, from the engine's frame counter.
+	 */
+	util::DurationHistogram frame_times;
+};
+
+} // openage
@@ -0,0 +1,96 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "render_command_list.h"
+
+#include "error/error.h"
+#include "util/trace.h"
+
+namespace openage {
+
+thread_local RenderCommandList *RenderCommandList::recording = nullptr;
+
+
+RenderCommandList::RenderCommandList()
+	:
+	deferred{false} {}
+
+
+RenderCommandList::~RenderCommandList() {
+	if (RenderCommandList::recording == this) {
+		RenderCommandList::recording = nullptr;
+	}
+}
+
+
+void RenderCommandList::begin() {
+	ENSURE(RenderCommandList::recording == nullptr or RenderCommandList::recording == this,
+	       "another render command list is already recording");
+
+	RenderCommandList::recording = this;
+}
+
+
+void RenderCommandList::end() {
+	if (RenderCommandList::recording == this) {
+		RenderCommandList::recording = nullptr;
+	}
+}
+
+
+void RenderCommandList::record(command_t command) {
+	this->commands.push_back(std::move(command));
+}
+
+
+void RenderCommandList::execute() {
+	TRACE_SCOPE("render commands");
+
+	try {
+		for (auto &command : this->commands) {
+			command();
+		}
+	}
+	catch (...) {
+		this->commands.clear();
+		throw;
+	}
+
+	this->commands.clear();
+}
+
+
+void RenderCommandList::clear() {
+	this->commands.clear();
+}
+
+
+size_t RenderCommandList::size() const {
+	return this->commands.size();
+}
+
+
+bool RenderCommandList::is_deferred() const {
+	return this->deferred;
+}
+
+
+void RenderCommandList::set_deferred(bool deferred) {
+	this->deferred = deferred;
+}
+
+
+RenderCommandList *RenderCommandList::get_recording() {
+	return RenderCommandList::recording;
+}
+
+
+void RenderCommandList::submit(command_t command) {
+	if (RenderCommandList::recording != nullptr) {
+		RenderCommandList::recording->record(std::move(command));
+	}
+	else {
+		command();
+	}
+}
+
+} // namespace openage
@@ -0,0 +1,79 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace openage {
+
+/**
+ * The opengl commands of a frame, recorded while the draw handlers run
+ * and executed when they are done, possibly on the render thread.
+ *
+ * A command captures the values it draws instead of reading them
+ * when it's executed, so the simulation may go on meanwhile.
+ * Code that issues gl calls passes them to submit(): they are recorded
+ * into the list of the current thread, or run directly if there is none.
+ */
+class RenderCommandList {
+public:
+	using command_t = std::function<void()>;
+
+	RenderCommandList();
+	~RenderCommandList();
+
+	RenderCommandList(const RenderCommandList &) = delete;
+	RenderCommandList &operator =(const RenderCommandList &) = delete;
+
+	/**
+	 * record the commands submitted on this thread into this list.
+	 */
+	void begin();
+
+	/**
+	 * stop recording, submitted commands are run directly again.
+	 */
+	void end();
+
+	void record(command_t command);
+
+	/**
+	 * run the recorded commands in order and clear the list.
+	 * the list is cleared as well if a command throws.
+	 */
+	void execute();
+
+	void clear();
+
+	size_t size() const;
+
+	/**
+	 * whether the list is executed by another thread than the one
+	 * recording it. results of gl calls made outside the list are
+	 * only visible to the commands once they finished, then.
+	 */
+	bool is_deferred() const;
+
+	void set_deferred(bool deferred);
+
+	/**
+	 * the list recording on this thread, or nullptr.
+	 */
+	static RenderCommandList *get_recording();
+
+	/**
+	 * record a command into the recording list, or run it now.
+	 */
+	static void submit(command_t command);
+
+private:
+	std::vector<command_t> commands;
+
+	bool deferred;
+
+	static thread_local RenderCommandList *recording;
+};
+
+} // namespace openage
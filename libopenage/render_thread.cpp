@@ -0,0 +1,160 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "render_thread.h"
+
+#include "error/error.h"
+#include "log/log.h"
+#include "util/alloc_tracking.h"
+#include "util/trace.h"
+
+namespace openage {
+
+RenderThread::RenderThread(SDL_Window *window, std::function<void()> init)
+	:
+	window{window},
+	context{nullptr},
+	init{std::move(init)},
+	recording{0},
+	pending{nullptr},
+	running{true} {
+
+	SDL_GLContext engine_context = SDL_GL_GetCurrentContext();
+
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+	this->context = SDL_GL_CreateContext(this->window);
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+
+	if (this->context == nullptr) {
+		throw Error(MSG(err) << "Failed creating the render thread's OpenGL context: " << SDL_GetError());
+	}
+
+	// creating the context made it current,
+	// the engine thread keeps its own for the gui.
+	SDL_GL_MakeCurrent(this->window, engine_context);
+
+	for (auto &list : this->lists) {
+		list.set_deferred(true);
+	}
+
+	this->thread = std::thread{&RenderThread::run, this};
+}
+
+
+RenderThread::~RenderThread() {
+	{
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->running = false;
+	}
+	this->changed.notify_all();
+	this->thread.join();
+
+	if (this->error) {
+		try {
+			std::rethrow_exception(this->error);
+		}
+		catch (Error &exc) {
+			log::log(MSG(err) << "Render thread failed: " << exc.what());
+		}
+		catch (...) {
+			log::log(MSG(err) << "Render thread failed with an unknown exception");
+		}
+	}
+
+	SDL_GL_DeleteContext(this->context);
+}
+
+
+RenderCommandList *RenderThread::get_list() {
+	return &this->lists[this->recording];
+}
+
+
+void RenderThread::wait_idle(std::unique_lock<std::mutex> &lock) {
+	this->changed.wait(lock, [this] {
+		return this->pending == nullptr;
+	});
+
+	if (this->error) {
+		std::exception_ptr error = this->error;
+		this->error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+
+void RenderThread::submit() {
+	RenderCommandList *list = this->get_list();
+	list->end();
+
+	{
+		std::unique_lock<std::mutex> lock{this->mutex};
+		this->wait_idle(lock);
+		this->pending = list;
+	}
+	this->changed.notify_all();
+
+	// the thread finished the other list before it took this one
+	this->recording = 1 - this->recording;
+}
+
+
+void RenderThread::finish() {
+	std::unique_lock<std::mutex> lock{this->mutex};
+	this->wait_idle(lock);
+}
+
+
+void RenderThread::run() {
+	util::set_trace_thread_name("render");
+	util::set_thread_alloc_tag(util::alloc_tag::rendering);
+	SDL_GL_MakeCurrent(this->window, this->context);
+
+	try {
+		this->init();
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->error = std::current_exception();
+	}
+
+	while (true) {
+		RenderCommandList *list;
+		{
+			std::unique_lock<std::mutex> lock{this->mutex};
+			this->changed.wait(lock, [this] {
+				return this->pending != nullptr or not this->running;
+			});
+
+			// a submitted frame is still drawn when stopping
+			if (this->pending == nullptr) {
+				break;
+			}
+			list = this->pending;
+		}
+
+		std::exception_ptr error;
+		try {
+			list->execute();
+
+			// the rendering is done, show the frame
+			TRACE_SCOPE("swap");
+			SDL_GL_SwapWindow(this->window);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{this->mutex};
+			if (error and not this->error) {
+				this->error = error;
+			}
+			this->pending = nullptr;
+		}
+		this->changed.notify_all();
+	}
+
+	SDL_GL_MakeCurrent(this->window, nullptr);
+}
+
+} // namespace openage
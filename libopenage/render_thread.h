@@ -0,0 +1,105 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "render_command_list.h"
+
+namespace openage {
+
+/**
+ * Executes the recorded frames on a dedicated thread, so the engine
+ * thread simulates and records the next frame while the previous one
+ * is drawn.
+ *
+ * There are two command lists: one is recorded while the thread
+ * executes the other. The thread draws with its own opengl context,
+ * which shares the textures, buffers and shaders of the engine's one.
+ * The engine's context stays current on the engine thread for the gui.
+ */
+class RenderThread {
+public:
+	/**
+	 * Create the opengl context of the render thread and start it.
+	 * Call on the thread whose context is current.
+	 *
+	 * @param window: drawn into, its buffers are swapped after each frame.
+	 * @param init: is run on the thread first, to set up the gl state.
+	 */
+	RenderThread(SDL_Window *window, std::function<void()> init);
+
+	/**
+	 * Draws the submitted frame and stops the thread.
+	 */
+	~RenderThread();
+
+	RenderThread(const RenderThread &) = delete;
+	RenderThread &operator =(const RenderThread &) = delete;
+
+	/**
+	 * The list to record the next frame into.
+	 */
+	RenderCommandList *get_list();
+
+	/**
+	 * Hand the recorded list to the thread, which executes it and
+	 * shows the frame. Waits until the previous frame was drawn,
+	 * errors of a drawn frame are rethrown here.
+	 */
+	void submit();
+
+	/**
+	 * Wait until the submitted frame was drawn.
+	 * Called before objects used by the recorded commands are destroyed.
+	 */
+	void finish();
+
+private:
+	void run();
+
+	/**
+	 * Wait until the thread took no list, rethrow its errors.
+	 * Called with the mutex locked.
+	 */
+	void wait_idle(std::unique_lock<std::mutex> &lock);
+
+	SDL_Window *window;
+	SDL_GLContext context;
+
+	std::function<void()> init;
+
+	RenderCommandList lists[2];
+
+	/**
+	 * Index of the list recorded by the engine thread.
+	 */
+	size_t recording;
+
+	/**
+	 * Guards the members below.
+	 */
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	/**
+	 * List to be executed by the thread, nullptr when it's idle.
+	 */
+	RenderCommandList *pending;
+
+	bool running;
+
+	/**
+	 * Set to the first exception thrown while drawing.
+	 */
+	std::exception_ptr error;
+
+	std::thread thread;
+};
+
+} // namespace openage
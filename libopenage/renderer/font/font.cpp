@@ -1,7 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "font.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <harfbuzz/hb.h>
@@ -158,6 +161,33 @@ float Font::get_horizontal_kerning(codepoint_t left_glyph, codepoint_t right_gly
 }
 
 float Font::get_advance_width(const std::string &text) const {
+	return this->get_layout(text)->advance_width;
+}
+
+std::shared_ptr<const text_layout> Font::get_layout(const std::string &text) const {
+	std::lock_guard<std::mutex> lock{this->layout_mutex};
+
+	auto it = this->layout_lookup.find(text);
+	if (it != std::end(this->layout_lookup)) {
+		// move to the front as most recently used
+		this->layouts.splice(std::begin(this->layouts), this->layouts, it->second);
+		return it->second->layout;
+	}
+
+	auto layout = std::make_shared<const text_layout>(this->shape(text));
+
+	this->layouts.push_front({text, layout});
+	this->layout_lookup[text] = std::begin(this->layouts);
+
+	if (this->layouts.size() > layout_cache_size) {
+		this->layout_lookup.erase(this->layouts.back().text);
+		this->layouts.pop_back();
+	}
+
+	return layout;
+}
+
+text_layout Font::shape(const std::string &text) const {
 	hb_buffer_t *buffer = hb_buffer_create();
 	hb_buffer_set_direction(buffer, get_hb_font_direction(this->description));
 	hb_buffer_set_script(buffer, get_hb_font_script(this->description));
@@ -165,24 +195,34 @@ float Font::get_advance_width(const std::string &text) const {
 	hb_buffer_add_utf8(buffer, text.c_str(), text.length(), 0, text.length());
 	hb_shape(this->hb_font, buffer, nullptr, 0);
 
-	float advance_width = 0.0f;
-
 	unsigned int glyph_count = 0;
 	hb_glyph_info_t *glyph_info = hb_buffer_get_glyph_infos(buffer, &glyph_count);
 	hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buffer, nullptr);
+
+	text_layout layout;
+	layout.glyphs.reserve(glyph_count);
+
+	float x = 0.0f;
+	float y = 0.0f;
 	for (unsigned int i = 0; i < glyph_count; i++) {
-		advance_width += static_cast<float>(glyph_pos[i].x_advance)/FREETYPE_UNIT;
+		codepoint_t glyph = glyph_info[i].codepoint;
 
 		if (i > 0) {
-			codepoint_t glyph = glyph_info[i].codepoint;
 			codepoint_t previous_glyph = glyph_info[i - 1].codepoint;
-			advance_width += this->get_horizontal_kerning(previous_glyph, glyph);
+			x += this->get_horizontal_kerning(previous_glyph, glyph);
 		}
+
+		layout.glyphs.push_back({glyph, x, y});
+
+		// Advance the pen position
+		x += static_cast<float>(glyph_pos[i].x_advance)/FREETYPE_UNIT;
+		y += static_cast<float>(glyph_pos[i].y_advance)/FREETYPE_UNIT;
 	}
+	layout.advance_width = x;
 
 	hb_buffer_destroy(buffer);
 
-	return advance_width;
+	return layout;
 }
 
 std::vector<codepoint_t> Font::get_glyphs(const std::string &text) const {
@@ -230,4 +270,66 @@ std::unique_ptr<unsigned char> Font::load_glyph(codepoint_t codepoint, Glyph &gl
 	return glyph_data;
 }
 
+std::unique_ptr<unsigned char> Font::load_distance_field(codepoint_t codepoint, Glyph &glyph, unsigned int spread) const {
+	Glyph bitmap_glyph;
+	std::unique_ptr<unsigned char> bitmap = this->load_glyph(codepoint, bitmap_glyph);
+	if (not bitmap) {
+		return nullptr;
+	}
+
+	glyph = bitmap_glyph;
+	glyph.x_offset -= spread;
+	glyph.y_offset += spread;
+	glyph.width += 2 * spread;
+	glyph.height += 2 * spread;
+
+	// the bitmap with the empty border around it
+	std::unique_ptr<unsigned char[]> padded{new unsigned char[glyph.width * glyph.height]};
+	memset(padded.get(), 0, glyph.width * glyph.height);
+	for (unsigned int i = 0; i < bitmap_glyph.height; i++) {
+		memcpy(padded.get() + ((i + spread) * glyph.width + spread),
+			bitmap.get() + (i * bitmap_glyph.width),
+			bitmap_glyph.width * sizeof(unsigned char));
+	}
+
+	return distance_field(padded.get(), glyph.width, glyph.height, spread);
+}
+
+std::unique_ptr<unsigned char> distance_field(const unsigned char *image,
+                                              unsigned int width, unsigned int height,
+                                              unsigned int spread) {
+	std::unique_ptr<unsigned char> field{new unsigned char[width * height]};
+	int range = spread;
+
+	for (int y = 0; y < static_cast<int>(height); y++) {
+		for (int x = 0; x < static_cast<int>(width); x++) {
+			bool inside = image[y * width + x] >= 128;
+
+			// search the nearest pixel on the other side within the spread
+			int nearest = (range + 1) * (range + 1);
+			for (int dy = -range; dy <= range; dy++) {
+				for (int dx = -range; dx <= range; dx++) {
+					int sx = x + dx;
+					int sy = y + dy;
+					bool other_inside = false;
+					if (sx >= 0 and sy >= 0 and sx < static_cast<int>(width) and sy < static_cast<int>(height)) {
+						other_inside = image[sy * width + sx] >= 128;
+					}
+
+					if (other_inside != inside) {
+						nearest = std::min(nearest, dx * dx + dy * dy);
+					}
+				}
+			}
+
+			float distance = std::min(std::sqrt(static_cast<float>(nearest)), static_cast<float>(range));
+			float value = 0.5f + (inside ? distance : -distance) / (2 * range);
+			field.get()[y * width + x] = static_cast<unsigned char>(
+				std::max(0.0f, std::min(255.0f, std::round(value * 255.0f))));
+		}
+	}
+
+	return field;
+}
+
 }} // openage::renderer
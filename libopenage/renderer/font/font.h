@@ -1,10 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <typeindex>
+#include <unordered_map>
 #include <vector>
 
 #include "../../util/hash.h"
@@ -34,6 +37,20 @@ public:
 	float y_advance;       //!< Advance height of the glyph.
 };
 
+/**
+ * The shaped glyphs of a text, positioned relative to the start of the pen.
+ */
+struct text_layout {
+	struct positioned_glyph {
+		codepoint_t codepoint; //!< Glyph's codepoint.
+		float x;               //!< Pen position of the glyph.
+		float y;
+	};
+
+	std::vector<positioned_glyph> glyphs;
+	float advance_width;
+};
+
 /**
  * Enumeration of the possible font directions.
  */
@@ -92,6 +109,24 @@ struct font_description {
 
 };
 
+/**
+ * Computes the signed distance field of a coverage bitmap.
+ *
+ * Pixels with a coverage of at least half are inside. Each value of the
+ * field is the distance to the nearest pixel on the other side,
+ * mapped so that 128 is the outline and the spread in pixels
+ * reaches 0 outside and 255 inside.
+ *
+ * @param image: The bitmap, one byte per pixel.
+ * @param width: The width of the bitmap.
+ * @param height: The height of the bitmap.
+ * @param spread: The distance in pixels that is covered by the field.
+ * @returns The field, with the size of the bitmap.
+ */
+std::unique_ptr<unsigned char> distance_field(const unsigned char *image,
+                                              unsigned int width, unsigned int height,
+                                              unsigned int spread);
+
 class Font {
 
 public:
@@ -151,6 +186,23 @@ public:
 	 */
 	float get_advance_width(const std::string &text) const;
 
+	/**
+	 * Get the shaped and positioned glyphs of a string.
+	 *
+	 * The layouts of the recently used strings are cached in the font,
+	 * so labels that are drawn every frame are only shaped once.
+	 * Thread safe.
+	 *
+	 * @param text: The string to lay out.
+	 * @returns The layout, which stays valid while it's held.
+	 */
+	std::shared_ptr<const text_layout> get_layout(const std::string &text) const;
+
+	/**
+	 * Number of layouts a font keeps.
+	 */
+	static constexpr size_t layout_cache_size = 256;
+
 	/**
 	 * Get the list of glyphs for a particular string.
 	 *
@@ -168,7 +220,24 @@ public:
 	 */
 	std::unique_ptr<unsigned char> load_glyph(codepoint_t codepoint, Glyph &glyph) const;
 
+	/**
+	 * Load a particular glyph's info and computes a distance field of its bitmap.
+	 * The glyph is grown by the spread on each side, so the field fades out
+	 * within the image.
+	 *
+	 * @param codepoint: The glyph.
+	 * @param glyph: The info of the grown glyph is loaded in to this object.
+	 * @param spread: The distance in pixels that is covered by the field.
+	 * @returns The glyph's distance field.
+	 */
+	std::unique_ptr<unsigned char> load_distance_field(codepoint_t codepoint, Glyph &glyph, unsigned int spread) const;
+
 private:
+	/**
+	 * Shapes a string with harfbuzz and positions its glyphs.
+	 */
+	text_layout shape(const std::string &text) const;
+
 	/**
 	 * Initializes the font's face and creates a harfbuzz font instance.
 	 *
@@ -190,6 +259,20 @@ private:
 	// The HarfBuzz font instance that drives the operations of this font
 	hb_font_t *hb_font;
 
+	struct layout_entry {
+		std::string text;
+		std::shared_ptr<const text_layout> layout;
+	};
+
+	mutable std::mutex layout_mutex;
+
+	/**
+	 * Cached layouts, the most recently used first.
+	 */
+	mutable std::list<layout_entry> layouts;
+
+	mutable std::unordered_map<std::string, std::list<layout_entry>::iterator> layout_lookup;
+
 };
 
 }} // openage::renderer
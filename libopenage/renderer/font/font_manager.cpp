@@ -2,7 +2,12 @@
 
 #include "font_manager.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <fontconfig/fontconfig.h>
+#include <fstream>
+#include <mutex>
+#include <sys/stat.h>
 
 #include "../../log/log.h"
 #include "font.h"
@@ -11,7 +16,103 @@
 namespace openage {
 namespace renderer {
 
-std::string FontManager::get_font_filename(const char *family, const char *style) {
+namespace {
+
+/**
+ * a font file found by fontconfig, and when it was modified then.
+ */
+struct resolved_font {
+	std::string filename;
+	int64_t mtime;
+};
+
+/**
+ * the font resolution cache, shared by all font managers,
+ * as font_descriptions are resolved without one.
+ */
+std::mutex resolution_mutex;
+std::string resolution_cache_file;
+bool resolution_cache_loaded = false;
+std::unordered_map<std::string, resolved_font> resolved_fonts;
+
+/**
+ * the modification time of a file, false if it doesn't exist.
+ */
+bool get_mtime(const std::string &filename, int64_t *mtime) {
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return false;
+	}
+	*mtime = info.st_mtime;
+	return true;
+}
+
+/**
+ * the cache file has a line "family<tab>style<tab>mtime<tab>filename"
+ * for each resolved font.
+ */
+void load_resolution_cache() {
+	resolution_cache_loaded = true;
+	if (resolution_cache_file.empty()) {
+		return;
+	}
+
+	std::ifstream file{resolution_cache_file};
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t family_end = line.find('\t');
+		size_t style_end = line.find('\t', family_end + 1);
+		size_t mtime_end = line.find('\t', style_end + 1);
+		if (family_end == std::string::npos or
+		    style_end == std::string::npos or
+		    mtime_end == std::string::npos) {
+			continue;
+		}
+
+		try {
+			int64_t mtime = std::stoll(line.substr(style_end + 1, mtime_end - style_end - 1));
+			resolved_fonts[line.substr(0, style_end)] = {line.substr(mtime_end + 1), mtime};
+		}
+		catch (std::logic_error &) {
+			// damaged line, the font is resolved again
+		}
+	}
+}
+
+void save_resolution_cache() {
+	if (resolution_cache_file.empty()) {
+		return;
+	}
+
+	// a partially written file is never seen under the final name
+	std::string tmp_filename = resolution_cache_file + ".tmp";
+	{
+		std::ofstream file{tmp_filename};
+		for (auto &entry : resolved_fonts) {
+			// names that don't fit into a line are only kept in memory
+			if (std::count(std::begin(entry.first), std::end(entry.first), '\t') != 1 or
+			    entry.first.find('\n') != std::string::npos or
+			    entry.second.filename.find('\n') != std::string::npos) {
+				continue;
+			}
+
+			file << entry.first << '\t' << entry.second.mtime << '\t' << entry.second.filename << '\n';
+		}
+		if (not file) {
+			log::log(MSG(warn) << "Could not write font cache " << tmp_filename);
+			return;
+		}
+	}
+
+	if (std::rename(tmp_filename.c_str(), resolution_cache_file.c_str()) != 0) {
+		log::log(MSG(warn) << "Could not write font cache " << resolution_cache_file);
+	}
+}
+
+/**
+ * ask fontconfig for the file of a font.
+ */
+std::string query_font_filename(const char *family, const char *style) {
 	// Initialize fontconfig
 	if (!FcInit()) {
 		throw Error{ERR << "Failed to initialize fontconfig."};
@@ -46,6 +147,41 @@ std::string FontManager::get_font_filename(const char *family, const char *style
 	return font_filename;
 }
 
+} // anonymous namespace
+
+
+std::string FontManager::get_font_filename(const char *family, const char *style) {
+	std::lock_guard<std::mutex> lock{resolution_mutex};
+	if (not resolution_cache_loaded) {
+		load_resolution_cache();
+	}
+
+	std::string key = std::string{family} + '\t' + style;
+	auto it = resolved_fonts.find(key);
+	int64_t mtime;
+	if (it != std::end(resolved_fonts) and
+	    get_mtime(it->second.filename, &mtime) and
+	    mtime == it->second.mtime) {
+		return it->second.filename;
+	}
+
+	std::string font_filename = query_font_filename(family, style);
+
+	if (get_mtime(font_filename, &mtime)) {
+		resolved_fonts[key] = {font_filename, mtime};
+		save_resolution_cache();
+	}
+
+	return font_filename;
+}
+
+void FontManager::set_resolution_cache_file(const std::string &filename) {
+	std::lock_guard<std::mutex> lock{resolution_mutex};
+	resolution_cache_file = filename;
+	resolution_cache_loaded = false;
+	resolved_fonts.clear();
+}
+
 FontManager::FontManager() {
 	// Empty
 }
@@ -78,4 +214,8 @@ Font *FontManager::get_font(const char *font_file, unsigned int size) {
 	return inserted.first->second.get();
 }
 
+Font *FontManager::get_distance_field_font(const Font *font) {
+	return this->get_font(font->description.font_file.c_str(), distance_field_size);
+}
+
 }} // openage::renderer
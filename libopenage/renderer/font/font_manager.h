@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -47,12 +47,22 @@ public:
 	/**
 	 * Gets the filepath of a particular font family and style.
 	 *
+	 * The files found by fontconfig are remembered in the resolution
+	 * cache, fontconfig is only initialized when a font isn't in it,
+	 * or when its file was modified since.
+	 *
 	 * @param family: The font family.
 	 * @param style: The font style.
 	 * @returns The path to font's file.
 	 */
 	static std::string get_font_filename(const char *family, const char *style);
 
+	/**
+	 * Sets the file that keeps the font resolutions between runs,
+	 * an empty name keeps them in memory only.
+	 */
+	static void set_resolution_cache_file(const std::string &filename);
+
 public:
 	FontManager();
 
@@ -82,6 +92,20 @@ public:
 	 */
 	Font *get_font(const char* font_file, unsigned int size);
 
+	/**
+	 * Retrieves the font that the distance fields of a font are rasterized from:
+	 * the same font file, at distance_field_size.
+	 *
+	 * @param font: The font in any size.
+	 * @returns The pointer to font instance.
+	 */
+	Font *get_distance_field_font(const Font *font);
+
+	/**
+	 * The size in points of the glyphs distance fields are made of.
+	 */
+	static constexpr unsigned int distance_field_size = 48;
+
 private:
 	// The freetype library instance
 	FreeTypeLibrary library;
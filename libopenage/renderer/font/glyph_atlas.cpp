@@ -1,14 +1,18 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "glyph_atlas.h"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
 #include <typeindex>
 #include <cstring>
+#include <utility>
 #include <epoxy/gl.h>
 
 #include "../../error/error.h"
 #include "../../util/hash.h"
+#include "font_manager.h"
 
 namespace openage {
 namespace renderer {
@@ -35,58 +39,134 @@ int GlyphAtlas::Shelf::reserve(int required_width, int/* required_height*/) {
 	return x_position;
 }
 
-GlyphAtlas::GlyphAtlas(int width, int height)
+GlyphAtlas::GlyphAtlas(int width, int height, unsigned int max_pages,
+                       glyph_atlas_mode mode, FontManager *font_manager)
 	:
 	width{width},
 	height{height},
-	is_dirty{false},
-	dirty_area{width, height, 0, 0},
-	texture_id{0} {
+	max_pages{std::max(max_pages, 1u)},
+	mode{mode},
+	font_manager{font_manager},
+	frame{0},
+	generation{0} {
 
-	this->buffer = std::unique_ptr<unsigned char>(new unsigned char[this->width * this->height]);
-	memset(this->buffer.get(), 0, this->width * this->height);
+	ENSURE(mode != glyph_atlas_mode::distance_field or font_manager != nullptr,
+	       "distance field glyphs need a font manager");
 
-	glGenTextures(1, &this->texture_id);
-	glBindTexture(GL_TEXTURE_2D, this->texture_id);
+	this->add_page();
+}
+
+GlyphAtlas::~GlyphAtlas() {
+	for (auto &page : this->pages) {
+		if (page.texture_id) {
+			glDeleteTextures(1, &page.texture_id);
+		}
+	}
+}
+
+void GlyphAtlas::add_page() {
+	Page page;
+	page.is_dirty = false;
+	page.dirty_area = {this->width, this->height, 0, 0};
+	page.buffer.reset(new unsigned char[this->width * this->height]);
+	memset(page.buffer.get(), 0, this->width * this->height);
+	page.texture_id = 0;
+
+	glGenTextures(1, &page.texture_id);
+	glBindTexture(GL_TEXTURE_2D, page.texture_id);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, this->width, this->height, 0, GL_RED, GL_UNSIGNED_BYTE, this->buffer.get());
-}
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, this->width, this->height, 0, GL_RED, GL_UNSIGNED_BYTE, page.buffer.get());
 
-GlyphAtlas::~GlyphAtlas() {
-	if (this->texture_id) {
-		glDeleteTextures(1, &this->texture_id);
-	}
+	this->pages.push_back(std::move(page));
 }
 
 void GlyphAtlas::bind(int unit) {
+	this->bind_page(0, unit);
+}
+
+void GlyphAtlas::bind_page(unsigned int page_index, int unit) {
+	Page &page = this->pages.at(page_index);
+
 	glActiveTexture(GL_TEXTURE0 + unit);
-	glBindTexture(GL_TEXTURE_2D, this->texture_id);
+	glBindTexture(GL_TEXTURE_2D, page.texture_id);
 
-	if (this->is_dirty) {
-		// We update the entire width of the atlas because of our buffer memory alignment
+	if (page.is_dirty) {
+		// We update the entire width of the page because of our buffer memory alignment
 		glTexSubImage2D(GL_TEXTURE_2D, 0,
-		                0, this->dirty_area.y1, this->width, this->dirty_area.y2 - this->dirty_area.y1,
-		                GL_RED, GL_UNSIGNED_BYTE, this->buffer.get() + this->width * this->dirty_area.y1);
+		                0, page.dirty_area.y1, this->width, page.dirty_area.y2 - page.dirty_area.y1,
+		                GL_RED, GL_UNSIGNED_BYTE, page.buffer.get() + this->width * page.dirty_area.y1);
 
-		this->is_dirty = false;
-		this->dirty_area = {this->width, this->height, 0, 0};
+		page.is_dirty = false;
+		page.dirty_area = {this->width, this->height, 0, 0};
 	}
 }
 
 GlyphAtlas::Entry GlyphAtlas::get(Font *font, codepoint_t codepoint) {
-	size_t key = this->get_cache_key(font, codepoint);
+	// distance fields of all sizes are made from the same font
+	Font *source = font;
+	if (this->mode == glyph_atlas_mode::distance_field) {
+		source = this->font_manager->get_distance_field_font(font);
+	}
+
+	size_t key = this->get_cache_key(source, codepoint);
 	auto it = this->glyphs.find(key);
+
+	Record *record;
 	if (it != this->glyphs.end()) {
-		return it->second;
+		record = &it->second;
 	}
+	else {
+		Glyph glyph;
+		std::unique_ptr<unsigned char> image;
+		if (this->mode == glyph_atlas_mode::distance_field) {
+			image = source->load_distance_field(codepoint, glyph, distance_field_spread);
+		} else {
+			image = source->load_glyph(codepoint, glyph);
+		}
 
-	Glyph glyph;
-	std::unique_ptr<unsigned char> image = font->load_glyph(codepoint, glyph);
-	return this->set(key, glyph, image.get());
+		if (not image) {
+			// the glyph couldn't be loaded, it's drawn as nothing
+			glyph = Glyph{codepoint, 0, 0, 0, 0, 0, 0};
+		}
+
+		record = &this->set(key, glyph, image.get());
+	}
+
+	record->last_used = this->frame;
+
+	Entry entry = record->entry;
+	if (source != font) {
+		float scale = static_cast<float>(font->description.size) / source->description.size;
+		Glyph &glyph = entry.glyph;
+		glyph.x_offset = std::lround(glyph.x_offset * scale);
+		glyph.y_offset = std::lround(glyph.y_offset * scale);
+		glyph.width = std::lround(glyph.width * scale);
+		glyph.height = std::lround(glyph.height * scale);
+		glyph.x_advance *= scale;
+		glyph.y_advance *= scale;
+	}
+
+	return entry;
+}
+
+void GlyphAtlas::next_frame() {
+	this->frame++;
+}
+
+unsigned int GlyphAtlas::get_generation() const {
+	return this->generation;
+}
+
+unsigned int GlyphAtlas::get_page_count() const {
+	return this->pages.size();
+}
+
+glyph_atlas_mode GlyphAtlas::get_mode() const {
+	return this->mode;
 }
 
 size_t GlyphAtlas::get_cache_key(Font *font, codepoint_t codepoint) const {
@@ -96,60 +176,155 @@ size_t GlyphAtlas::get_cache_key(Font *font, codepoint_t codepoint) const {
 	return hash;
 }
 
-GlyphAtlas::Entry GlyphAtlas::set(size_t key, const Glyph &glyph, const unsigned char *image) {
+GlyphAtlas::Record &GlyphAtlas::set(size_t key, const Glyph &glyph, const unsigned char *image) {
 	// Give the glyphs a 1px padding in the atlas
 	int required_width = glyph.width + 1;
 	int required_height = glyph.height + 1;
 
-	if (this->shelves.empty()) {
-		this->shelves.emplace_back(0, this->width, required_height);
+	if (required_width > this->width or required_height > this->height) {
+		throw Error(MSG(err) << "Glyph of " << glyph.width << "x" << glyph.height
+		            << " pixels is larger than the atlas pages");
 	}
 
-	for (auto &shelf : this->shelves) {
-		if (shelf.check_fits(required_width, required_height)) {
-			int x_pos = shelf.reserve(required_width, required_height);
-			int y_pos = shelf.y_position;
-
-			// Create a new entry and insert it
-			GlyphAtlas::Entry entry;
-			entry.glyph = glyph;
-			entry.u0 = static_cast<float>(x_pos)/this->width;
-			entry.v0 = static_cast<float>(y_pos)/this->height;
-			entry.u1 = static_cast<float>(x_pos + glyph.width)/this->width;
-			entry.v1 = static_cast<float>(y_pos + glyph.height)/this->height;
-
-			for (unsigned int i = 0; i < glyph.height; i++) {
-				memcpy(
-					this->buffer.get() + ((y_pos + i) * this->width + x_pos),
-					image + (i * glyph.width),
-					glyph.width * sizeof(unsigned char)
-				);
+	Record record;
+	record.entry.glyph = glyph;
+	record.last_used = this->frame;
+
+	bool evicted = false;
+	unsigned int page = 0;
+	while (true) {
+		for (page = 0; page < this->pages.size(); page++) {
+			if (this->allocate(this->pages[page], required_width, required_height, record.x, record.y)) {
+				break;
 			}
-			this->update_dirty_area(x_pos, y_pos, glyph.width, glyph.height);
+		}
+
+		if (page < this->pages.size()) {
+			break;
+		}
+		else if (this->pages.size() < this->max_pages) {
+			this->add_page();
+		}
+		else if (not evicted) {
+			this->evict();
+			evicted = true;
+		}
+		else {
+			throw Error(MSG(err) << "Not enough space in the atlas");
+		}
+	}
+
+	auto it = this->glyphs.emplace(key, record).first;
+	this->store(it->second, page, image, glyph.width);
+	return it->second;
+}
+
+bool GlyphAtlas::allocate(Page &page, int required_width, int required_height, int &x, int &y) {
+	for (auto &shelf : page.shelves) {
+		if (shelf.check_fits(required_width, required_height)) {
+			x = shelf.reserve(required_width, required_height);
+			y = shelf.y_position;
+			return true;
+		}
+	}
+
+	int top = 0;
+	if (not page.shelves.empty()) {
+		const Shelf &last_shelf = page.shelves.back();
+		top = last_shelf.y_position + last_shelf.height;
+	}
+
+	if (this->height >= top + required_height) {
+		page.shelves.emplace_back(top, this->width, required_height);
+		x = page.shelves.back().reserve(required_width, required_height);
+		y = top;
+		return true;
+	}
 
-			this->glyphs.emplace(key, entry);
-			return entry;
+	return false;
+}
+
+void GlyphAtlas::store(Record &record, unsigned int page_index, const unsigned char *image, int image_stride) {
+	Page &page = this->pages[page_index];
+	Entry &entry = record.entry;
+	const Glyph &glyph = entry.glyph;
+
+	entry.page = page_index;
+	entry.u0 = static_cast<float>(record.x)/this->width;
+	entry.v0 = static_cast<float>(record.y)/this->height;
+	entry.u1 = static_cast<float>(record.x + glyph.width)/this->width;
+	entry.v1 = static_cast<float>(record.y + glyph.height)/this->height;
+
+	if (image == nullptr) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < glyph.height; i++) {
+		memcpy(
+			page.buffer.get() + ((record.y + i) * this->width + record.x),
+			image + (i * image_stride),
+			glyph.width * sizeof(unsigned char)
+		);
+	}
+	this->update_dirty_area(page, record.x, record.y, glyph.width, glyph.height);
+}
+
+void GlyphAtlas::evict() {
+	// the glyphs that stay, by page
+	std::vector<std::vector<std::pair<size_t, Record *>>> kept(this->pages.size());
+
+	for (auto it = this->glyphs.begin(); it != this->glyphs.end();) {
+		if (it->second.last_used != this->frame) {
+			it = this->glyphs.erase(it);
+		} else {
+			kept[it->second.entry.page].emplace_back(it->first, &it->second);
+			++it;
 		}
 	}
 
-	GlyphAtlas::Shelf last_shelf = this->shelves.back();
-	if (this->height > (last_shelf.y_position + last_shelf.height + required_height)) {
-		this->shelves.emplace_back(last_shelf.y_position + last_shelf.height, this->width, required_height);
+	for (unsigned int page_index = 0; page_index < this->pages.size(); page_index++) {
+		Page &page = this->pages[page_index];
+		std::unique_ptr<unsigned char[]> old_buffer = std::move(page.buffer);
+
+		page.buffer.reset(new unsigned char[this->width * this->height]);
+		memset(page.buffer.get(), 0, this->width * this->height);
+		page.shelves.clear();
+
+		// tall glyphs first, so the shelves are filled well
+		auto &records = kept[page_index];
+		std::sort(records.begin(), records.end(), [](const std::pair<size_t, Record *> &a,
+		                                             const std::pair<size_t, Record *> &b) {
+			return a.second->entry.glyph.height > b.second->entry.glyph.height;
+		});
+
+		for (auto &kept_record : records) {
+			Record &record = *kept_record.second;
+			const Glyph &glyph = record.entry.glyph;
+			int old_x = record.x;
+			int old_y = record.y;
+
+			if (not this->allocate(page, glyph.width + 1, glyph.height + 1, record.x, record.y)) {
+				// the glyph is rasterized again when it's needed
+				this->glyphs.erase(kept_record.first);
+				continue;
+			}
+
+			this->store(record, page_index, old_buffer.get() + old_y * this->width + old_x, this->width);
+		}
 
-		return this->set(key, glyph, image);
+		this->update_dirty_area(page, 0, 0, this->width, this->height);
 	}
 
-	// TODO: figure out a clean way to resize the atlas
-	throw Error(MSG(err) << "Not enough space in the atlas");
+	this->generation++;
 }
 
-void GlyphAtlas::update_dirty_area(int x, int y, int width, int height) {
-	this->is_dirty = true;
-	this->dirty_area = {
-		std::min(this->dirty_area.x1, x),
-		std::min(this->dirty_area.y1, y),
-		std::max(this->dirty_area.x2, x + width),
-		std::max(this->dirty_area.y2, y + height)};
+void GlyphAtlas::update_dirty_area(Page &page, int x, int y, int width, int height) {
+	page.is_dirty = true;
+	page.dirty_area = {
+		std::min(page.dirty_area.x1, x),
+		std::min(page.dirty_area.y1, y),
+		std::max(page.dirty_area.x2, x + width),
+		std::max(page.dirty_area.y2, y + height)};
 }
 
 }} // openage::renderer
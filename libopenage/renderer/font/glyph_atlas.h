@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -11,17 +11,37 @@
 namespace openage {
 namespace renderer {
 
+class FontManager;
+
 /**
- * A glyph atlas is used to pack and manage several font glyphs in to a single OpenGL texture.
+ * How the glyphs are stored in the atlas.
+ */
+enum class glyph_atlas_mode {
+	/**
+	 * the coverage of each pixel, rasterized for each font size.
+	 */
+	bitmap,
+
+	/**
+	 * the signed distance to the glyph's outline, rasterized once for
+	 * all sizes of a font at FontManager::distance_field_size.
+	 * 0.5 is the outline, the spread in pixels maps to 0..1.
+	 */
+	distance_field,
+};
+
+/**
+ * A glyph atlas is used to pack and manage several font glyphs in to OpenGL textures, called pages.
  *
  * A single glyph atlas can be used to stored glyphs from multiple fonts.
  *
  * Currently, the glyph atlas uses a naive "Shelf First-Fit" algorithm based on the article
  * "A Thousand Ways to Pack the Bin - A Practical Approach to Two-Dimensional Rectangle Bin Packing"
- * by Jukka Jylänki. The article can be found at http://clb.demon.fi/files/RectangleBinPack.pdf
+ * by Jukka Jylänki. The article can be found at http://clb.demon.fi/files/RectangleBinPack.pdf
  *
- * This is a very basic algorithm. If there is a need for a more complex packing requirement, the
- * glyph atlas can be easily modified.
+ * When all pages are full, the glyphs that weren't used during the current frame are evicted
+ * and the remaining ones are packed again. That moves glyphs, so users that keep texture
+ * coordinates have to get their glyphs again when the generation of the atlas changes.
  */
 class GlyphAtlas {
 
@@ -31,34 +51,49 @@ public:
 	 */
 	class Entry {
 	public:
-		Glyph glyph; //!< The Glyph.
-		float u0;    //!< The bottom-left texture coordinate in u-axis.
-		float v0;    //!< The bottom-left texture coordinate in v-axis.
-		float u1;    //!< The top-right texture coordinate in u-axis.
-		float v1;    //!< The top-right texture coordinate in v-axis.
+		Glyph glyph;       //!< The Glyph, in the size of the requested font.
+		unsigned int page; //!< The page that contains the glyph.
+		float u0;          //!< The bottom-left texture coordinate in u-axis.
+		float v0;          //!< The bottom-left texture coordinate in v-axis.
+		float u1;          //!< The top-right texture coordinate in u-axis.
+		float v1;          //!< The top-right texture coordinate in v-axis.
 	};
 
 public:
 	/**
-	 * Creates a glyph atlas with the specified width and height.
+	 * Creates a glyph atlas whose pages have the specified width and height.
 	 *
-	 * Also, creates a OpenGL texture of the same width and height. The contents of this
-	 * glyph atlas is automatically synchronized to the texture (when you bind the texture).
+	 * The first page and its OpenGL texture are created right away. The contents
+	 * of each page are automatically synchronized to its texture (when you bind the page).
 	 *
-	 * @param width: The width of glyph atlas
-	 * @param height: The height of glyph atlas
+	 * @param width: The width of each page
+	 * @param height: The height of each page
+	 * @param max_pages: The number of pages after which glyphs are evicted
+	 * @param mode: How the glyphs are stored
+	 * @param font_manager: Provides the fonts that the distance fields are rasterized from,
+	 *                      required for glyph_atlas_mode::distance_field
 	 */
-	GlyphAtlas(int width = 1024, int height = 1024);
+	GlyphAtlas(int width = 1024, int height = 1024, unsigned int max_pages = 4,
+	           glyph_atlas_mode mode = glyph_atlas_mode::bitmap,
+	           FontManager *font_manager = nullptr);
 
 	virtual ~GlyphAtlas();
 
 	/**
-	 * Binds the OpenGL texture of this glyph atlas at the specified unit.
+	 * Binds the OpenGL texture of the first page at the specified unit.
 	 *
 	 * @param unit: the texture unit.
 	 */
 	void bind(int unit = 0);
 
+	/**
+	 * Binds the OpenGL texture of a page at the specified unit.
+	 *
+	 * @param page: the page
+	 * @param unit: the texture unit.
+	 */
+	void bind_page(unsigned int page, int unit = 0);
+
 	/**
 	 * Retrieves the atlas entry for a specified font and glyph.
 	 *
@@ -66,18 +101,37 @@ public:
 	 * the glyph info. The provided info along with the glyph's bitmap data is used to create a new
 	 * cached entry. This entry is then returned.
 	 *
+	 * The glyph is marked as used in the current frame.
+	 *
 	 * @param font: The font
 	 * @param codepoint: The glyph whose atlas entry must be retrieved
 	 * @returns The atlas entry.
 	 */
 	GlyphAtlas::Entry get(Font *font, codepoint_t codepoint);
 
-private:
-	size_t get_cache_key(Font *font, codepoint_t codepoint) const;
+	/**
+	 * Starts a new frame: glyphs that aren't retrieved after this
+	 * may be evicted.
+	 */
+	void next_frame();
+
+	/**
+	 * The number of times glyphs were evicted or moved.
+	 * Entries retrieved in an older generation are no longer valid.
+	 */
+	unsigned int get_generation() const;
 
-	GlyphAtlas::Entry set(size_t key, const Glyph &glyph, const unsigned char *image);
+	/**
+	 * The number of pages in use.
+	 */
+	unsigned int get_page_count() const;
 
-	void update_dirty_area(int x, int y, int width, int height);
+	glyph_atlas_mode get_mode() const;
+
+	/**
+	 * The number of pixels around the outline that the distance fields cover.
+	 */
+	static constexpr unsigned int distance_field_spread = 4;
 
 private:
 	class Shelf {
@@ -104,32 +158,81 @@ private:
 		int y2; // Top-right y-coord
 	};
 
-	// The width of the glyph atlas
-	int width;
+	/**
+	 * A texture of the atlas and the glyphs packed into it.
+	 */
+	struct Page {
+		// Flag indicating if any part of the page was updated after previous flush to OpenGL texture
+		bool is_dirty;
 
-	// The height of the glyph atlas
-	int height;
+		// The area in the page that was updated after the previous flush to OpenGL texture
+		// This is used in optimizing the amount of data pushed to the texture
+		dirty_rect dirty_area;
+
+		// The bitmap image data of all glyphs
+		std::unique_ptr<unsigned char[]> buffer;
 
-	// Flag indicating if any part of the glyph atlas was updated after previous flush to OpenGL texture
-	bool is_dirty;
+		// The OpenGL texture handle
+		unsigned int texture_id;
 
-	// The area in the glyph atlas that was updated after the previous flush to OpenGL texture
-	// This is used in optimizing the amount of data pushed to the texture
-	dirty_rect dirty_area;
+		// List of shelves currently used in the page
+		std::vector<GlyphAtlas::Shelf> shelves;
+	};
 
-	// The bitmap image data of all glyphs
-	std::unique_ptr<unsigned char> buffer;
+	/**
+	 * A glyph in the atlas, as rasterized.
+	 */
+	struct Record {
+		Entry entry;
+		int x;
+		int y;
+		unsigned int last_used;
+	};
 
-	// The OpenGL texture handle
-	unsigned int texture_id;
+	size_t get_cache_key(Font *font, codepoint_t codepoint) const;
+
+	/**
+	 * Stores the glyph in a page, evicting unused glyphs if all pages are full.
+	 */
+	GlyphAtlas::Record &set(size_t key, const Glyph &glyph, const unsigned char *image);
+
+	/**
+	 * Reserves a place for a glyph in the page, returns false if it doesn't fit.
+	 */
+	bool allocate(Page &page, int required_width, int required_height, int &x, int &y);
+
+	/**
+	 * Copies the image of a glyph into a page, at the place of the record.
+	 */
+	void store(Record &record, unsigned int page, const unsigned char *image, int image_stride);
+
+	void add_page();
+
+	/**
+	 * Removes the glyphs that weren't used in the current frame,
+	 * and packs the remaining ones of each page again.
+	 */
+	void evict();
+
+	void update_dirty_area(Page &page, int x, int y, int width, int height);
+
+	// The width of each page
+	int width;
+	// The height of each page
+	int height;
+
+	unsigned int max_pages;
+	glyph_atlas_mode mode;
+	FontManager *font_manager;
+
+	std::vector<Page> pages;
 
 	// Cache of all entries stored in this glyph atlas.
 	// A combination of font and the glyph's codepoint is used as the cache key.
-	std::unordered_map<size_t, GlyphAtlas::Entry> glyphs;
-
-	// List of shelves currently used in the atlas
-	std::vector<GlyphAtlas::Shelf> shelves;
+	std::unordered_map<size_t, GlyphAtlas::Record> glyphs;
 
+	unsigned int frame;
+	unsigned int generation;
 };
 
 }} // openage::renderer
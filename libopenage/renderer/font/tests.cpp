@@ -1,4 +1,9 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
+
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "../../testing/testing.h"
 
@@ -22,8 +27,78 @@ void font_manager_test_get_font() {
 	(font3 == font1) or TESTFAIL;
 }
 
+void font_manager_test_layout_cache() {
+	FontManager font_manager;
+	Font *font = font_manager.get_font("DejaVu Serif", "Book", 12);
+
+	// repeated strings get the cached layout
+	std::shared_ptr<const text_layout> layout1 = font->get_layout("openage");
+	std::shared_ptr<const text_layout> layout2 = font->get_layout("openage");
+	(layout1 == layout2) or TESTFAIL;
+	(layout1->glyphs.size() == 7) or TESTFAIL;
+	(layout1->advance_width == font->get_advance_width("openage")) or TESTFAIL;
+
+	// the pen moves to the right
+	for (size_t i = 1; i < layout1->glyphs.size(); i++) {
+		(layout1->glyphs[i].x > layout1->glyphs[i - 1].x) or TESTFAIL;
+	}
+
+	// other sizes have their own layouts
+	Font *larger_font = font_manager.get_font("DejaVu Serif", "Book", 20);
+	std::shared_ptr<const text_layout> layout3 = larger_font->get_layout("openage");
+	(layout3 != layout1) or TESTFAIL;
+	(layout3->advance_width > layout1->advance_width) or TESTFAIL;
+
+	// held layouts stay valid when they're dropped from the cache
+	for (size_t i = 0; i <= Font::layout_cache_size; i++) {
+		font->get_layout(std::to_string(i));
+	}
+	(layout1->glyphs.size() == 7) or TESTFAIL;
+	(font->get_layout("openage") != layout1) or TESTFAIL;
+}
+
+void font_manager_test_resolution_cache() {
+	char filename[] = "/tmp/openage-font-cache-XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0) {
+		TESTFAILMSG("could not create a temporary file");
+	}
+	close(fd);
+
+	// resolved fonts are written to the cache
+	FontManager::set_resolution_cache_file(filename);
+	std::string resolved = FontManager::get_font_filename("DejaVu Serif", "Book");
+	{
+		std::ifstream file{filename};
+		std::string content{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+		(content.find(resolved) != std::string::npos) or TESTFAIL;
+	}
+
+	struct stat font_info, cache_info;
+	(stat(resolved.c_str(), &font_info) == 0) or TESTFAIL;
+	(stat(filename, &cache_info) == 0) or TESTFAIL;
+
+	{
+		std::ofstream file{filename};
+
+		// fontconfig doesn't know this family, it has to come from the cache
+		file << "openage test\tBook\t" << font_info.st_mtime << "\t" << resolved << "\n";
+
+		// the file was modified since, it's resolved again
+		file << "DejaVu Serif\tBook\t" << cache_info.st_mtime - 1 << "\t" << filename << "\n";
+	}
+	FontManager::set_resolution_cache_file(filename);
+	(FontManager::get_font_filename("openage test", "Book") == resolved) or TESTFAIL;
+	(FontManager::get_font_filename("DejaVu Serif", "Book") == resolved) or TESTFAIL;
+
+	FontManager::set_resolution_cache_file("");
+	unlink(filename);
+}
+
 void font_manager() {
 	font_manager_test_get_font();
+	font_manager_test_layout_cache();
+	font_manager_test_resolution_cache();
 }
 
 void font_test_font_description() {
@@ -56,8 +131,32 @@ void font_test_font_description() {
 	(fd5 != fd1) or TESTFAIL;
 }
 
+void font_test_distance_field() {
+	// a 4x4 block in the middle of an 8x8 bitmap
+	unsigned char image[8 * 8] = {};
+	for (int y = 2; y < 6; y++) {
+		for (int x = 2; x < 6; x++) {
+			image[y * 8 + x] = 255;
+		}
+	}
+
+	std::unique_ptr<unsigned char> field = distance_field(image, 8, 8, 2);
+	auto at = [&field](int x, int y) { return field.get()[y * 8 + x]; };
+
+	// inside is above the outline, outside below
+	(at(3, 3) > 128) or TESTFAIL;
+	(at(0, 0) < 128) or TESTFAIL;
+
+	// the values grow towards the middle, and saturate beyond the spread
+	(at(2, 3) < at(3, 3)) or TESTFAIL;
+	(at(1, 3) < at(2, 3)) or TESTFAIL;
+	(at(0, 3) < at(1, 3)) or TESTFAIL;
+	(at(0, 0) == 0) or TESTFAIL;
+}
+
 void font() {
 	font_test_font_description();
+	font_test_distance_field();
 }
 
 }}} // openage::renderer::tests
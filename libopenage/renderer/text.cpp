@@ -1,11 +1,14 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "text.h"
 
 #include <algorithm>
+#include <memory>
 
 #include <harfbuzz/hb.h>
 
+#include "../render_command_list.h"
+#include "../util/hash.h"
 #include "../util/strings.h"
 #include "font/font.h"
 
@@ -13,7 +16,7 @@ namespace openage {
 
 namespace texturefont_shader {
 shader::Program *program;
-GLint texture, color, tex_coord;
+GLint texture, color, tex_coord, vertex_color, distance_field;
 } // namespace texture_shader
 
 namespace renderer {
@@ -23,35 +26,22 @@ struct text_render_vertex {
 	float y;
 	float u;
 	float v;
-
-	text_render_vertex()
-		:
-		text_render_vertex{0.0f, 0.0f, 0.0f, 0.0f} {
-	}
-
-	text_render_vertex(float x, float y, float u, float v)
-		:
-		x{x},
-		y{y},
-		u{u},
-		v{v} {
-	}
+	uint8_t r, g, b, a;
 };
 
-struct text_render_task {
-	GLenum mode;
-	Color color;
-	unsigned int num_elements;
-	unsigned int offset;
-};
-
-TextRenderer::TextRenderer()
+TextRenderer::TextRenderer(FontManager *distance_field_fonts)
 	:
 	current_font{nullptr},
 	current_color{255, 255, 255, 255},
 	is_dirty{true},
+	glyph_atlas{1024, 1024, 4,
+	            distance_field_fonts ? glyph_atlas_mode::distance_field : glyph_atlas_mode::bitmap,
+	            distance_field_fonts},
 	vbo{0},
-	ibo{0} {
+	ibo{0},
+	glyph_count{0},
+	index_capacity{0},
+	frame{0} {
 
 	glGenBuffers(1, &this->vbo);
 	glGenBuffers(1, &this->ibo);
@@ -108,129 +98,196 @@ void TextRenderer::draw(int x, int y, const std::string &text) {
 }
 
 void TextRenderer::render() {
-	// Sort the batches by font
-	std::sort(std::begin(this->render_batches), std::end(this->render_batches),
-	          [](const text_render_batch &a, const text_render_batch &b) -> bool {
-	              return a.font < b.font;
-	          });
-
-	// Merge consecutive batches if font and color values are same
-	for (auto current_batch = std::begin(this->render_batches); current_batch != std::end(this->render_batches); ) {
-		auto next_batch = current_batch;
-		next_batch++;
-		if (next_batch != std::end(this->render_batches) &&
-		    current_batch->font == next_batch->font &&
-		    current_batch->color == next_batch->color) {
-			// Merge the render passes of current and next batches and remove the next batch
-			std::move(std::begin(next_batch->passes),
-			          std::end(next_batch->passes),
-			          std::back_inserter(current_batch->passes));
-			this->render_batches.erase(next_batch);
-		} else {
-			current_batch++;
+	// the batches are drawn when the frame's commands are executed,
+	// the next texts are collected meanwhile.
+	auto batches = std::make_shared<std::vector<text_render_batch>>();
+	std::swap(*batches, this->render_batches);
+
+	RenderCommandList::submit([this, batches] {
+		this->draw_batches(*batches);
+	});
+}
+
+size_t TextRenderer::run_key_hash::operator ()(const run_key &key) const {
+	return util::hash_combine(std::hash<Font *>{}(key.first), std::hash<std::string>{}(key.second));
+}
+
+const TextRenderer::glyph_run &TextRenderer::get_run(Font *font, const std::string &text) {
+	auto it = this->runs.find(run_key{font, text});
+	if (it == this->runs.end()) {
+		glyph_run run;
+
+		// the shaping is cached by the font, the runs add the atlas places
+		std::shared_ptr<const text_layout> layout = font->get_layout(text);
+		run.quads.reserve(layout->glyphs.size());
+
+		for (auto &glyph : layout->glyphs) {
+			GlyphAtlas::Entry entry = this->glyph_atlas.get(font, glyph.codepoint);
+
+			float x0 = glyph.x + entry.glyph.x_offset;
+			float y0 = glyph.y + entry.glyph.y_offset - entry.glyph.height;
+			float x1 = x0 + entry.glyph.width;
+			float y1 = y0 + entry.glyph.height;
+
+			run.quads.push_back({x0, y0, x1, y1, entry.u0, entry.v0, entry.u1, entry.v1, entry.page});
 		}
+
+		it = this->runs.emplace(run_key{font, text}, std::move(run)).first;
 	}
 
-	size_t index = 0;
-	std::vector<text_render_vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<text_render_task> render_tasks;
-	render_tasks.reserve(this->render_batches.size());
-	unsigned int offset = 0;
-
-	// Compute vertices and indices
-	for (auto &batch : this->render_batches) {
-		Font *font = batch.font;
-
-		unsigned int num_elements = 0;
-
-		for (auto &pass : batch.passes) {
-			float x = static_cast<float>(pass.x);
-			float y = static_cast<float>(pass.y);
-
-			std::vector<codepoint_t> glyphs = font->get_glyphs(pass.text);
-
-			// We will create 4 vertices & 6 indices for each glyph (GL_TRIANGLES)
-			vertices.resize(vertices.size() + glyphs.size() * 4);
-			indices.resize(indices.size() + glyphs.size() * 6);
-
-			codepoint_t previous_glyph = 0;
-			for (codepoint_t glyph : glyphs) {
-				GlyphAtlas::Entry entry = this->glyph_atlas.get(font, glyph);
-
-				float x0 = x + entry.glyph.x_offset;
-				float y0 = y + entry.glyph.y_offset - entry.glyph.height;
-				float x1 = x0 + entry.glyph.width;
-				float y1 = y0 + entry.glyph.height;
-
-				vertices[index*4 + 0] = {x0, y0, entry.u0, entry.v0};
-				vertices[index*4 + 1] = {x0, y1, entry.u0, entry.v1};
-				vertices[index*4 + 2] = {x1, y1, entry.u1, entry.v1};
-				vertices[index*4 + 3] = {x1, y0, entry.u1, entry.v0};
-
-				indices[index*6 + 0] = index*4 + 0;
-				indices[index*6 + 1] = index*4 + 1;
-				indices[index*6 + 2] = index*4 + 2;
-				indices[index*6 + 3] = index*4 + 2;
-				indices[index*6 + 4] = index*4 + 3;
-				indices[index*6 + 5] = index*4 + 0;
-
-				// Advance the pen position
-				x += entry.glyph.x_advance;
-				y += entry.glyph.y_advance;
-
-				// Handle font kerning
-				if (previous_glyph != 0) {
-					x += font->get_horizontal_kerning(previous_glyph, glyph);
-				}
+	it->second.last_used = this->frame;
+	return it->second;
+}
+
+void TextRenderer::build_vertices(const std::vector<text_render_batch> &render_batches) {
+	std::vector<std::vector<text_render_vertex>> pages;
+
+	// getting glyphs may evict unused ones and move the others in the atlas,
+	// all runs are laid out again then. the glyphs of this frame are kept,
+	// so that settles quickly.
+	for (int attempt = 0; attempt < 3; attempt++) {
+		unsigned int generation = this->glyph_atlas.get_generation();
+		pages.clear();
 
-				index++;
-				num_elements += 6;
-				previous_glyph = glyph;
+		for (auto &batch : render_batches) {
+			const Color &color = batch.color;
+
+			for (auto &pass : batch.passes) {
+				float x = static_cast<float>(pass.x);
+				float y = static_cast<float>(pass.y);
+
+				for (auto &quad : this->get_run(batch.font, pass.text).quads) {
+					float x0 = x + quad.x0, x1 = x + quad.x1;
+					float y0 = y + quad.y0, y1 = y + quad.y1;
+
+					if (quad.page >= pages.size()) {
+						pages.resize(quad.page + 1);
+					}
+					std::vector<text_render_vertex> &vertices = pages[quad.page];
+
+					vertices.push_back({x0, y0, quad.u0, quad.v0, color.r, color.g, color.b, color.a});
+					vertices.push_back({x0, y1, quad.u0, quad.v1, color.r, color.g, color.b, color.a});
+					vertices.push_back({x1, y1, quad.u1, quad.v1, color.r, color.g, color.b, color.a});
+					vertices.push_back({x1, y0, quad.u1, quad.v0, color.r, color.g, color.b, color.a});
+				}
 			}
 		}
 
-		text_render_task render_task{GL_TRIANGLES, batch.color, num_elements, offset};
-		render_tasks.push_back(render_task);
+		if (generation == this->glyph_atlas.get_generation()) {
+			break;
+		}
+		this->runs.clear();
+	}
+
+	std::vector<text_render_vertex> vertices;
+	this->page_glyph_counts.clear();
+	for (unsigned int page = 0; page < pages.size(); page++) {
+		if (pages[page].empty()) {
+			continue;
+		}
+		this->page_glyph_counts.emplace_back(page, pages[page].size() / 4);
+		vertices.insert(vertices.end(), pages[page].begin(), pages[page].end());
+	}
 
-		offset += num_elements;
+	// drop the runs of texts that weren't drawn for a while
+	for (auto it = this->runs.begin(); it != this->runs.end();) {
+		if (this->frame - it->second.last_used > run_cache_frames) {
+			it = this->runs.erase(it);
+		} else {
+			++it;
+		}
 	}
 
-	// Upload vertices and indices
+	this->glyph_count = vertices.size() / 4;
+	this->reserve_indices(this->glyph_count);
+
+	// orphan the old storage, so the upload doesn't wait for draws that still use it
 	glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(text_render_vertex), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(text_render_vertex), vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TextRenderer::reserve_indices(size_t glyph_count) {
+	if (glyph_count <= this->index_capacity) {
+		return;
+	}
+
+	// grow in steps, the glyph count changes from frame to frame
+	size_t capacity = std::max(glyph_count, 2 * this->index_capacity);
+	capacity = std::max<size_t>(capacity, 256);
+
+	// We use 4 vertices & 6 indices for each glyph (GL_TRIANGLES)
+	std::vector<unsigned int> indices(capacity * 6);
+	for (size_t i = 0; i < capacity; i++) {
+		unsigned int first = i * 4;
+		indices[i*6 + 0] = first + 0;
+		indices[i*6 + 1] = first + 1;
+		indices[i*6 + 2] = first + 2;
+		indices[i*6 + 3] = first + 2;
+		indices[i*6 + 4] = first + 3;
+		indices[i*6 + 5] = first + 0;
+	}
+
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	this->index_capacity = capacity;
+}
+
+void TextRenderer::draw_batches(std::vector<text_render_batch> &render_batches) {
+	this->frame++;
+	this->glyph_atlas.next_frame();
+
+	// most texts stay the same from frame to frame
+	if (render_batches != this->drawn_batches) {
+		this->build_vertices(render_batches);
+		std::swap(this->drawn_batches, render_batches);
+	}
 
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(text_render_vertex), &vertices[0], GL_STATIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	if (this->glyph_count == 0) {
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ibo);
 
 	texturefont_shader::program->use();
 
-	this->glyph_atlas.bind(0);
+	// the colors are given per vertex
+	glUniform4f(texturefont_shader::color, 1.0, 1.0, 1.0, 1.0);
+	glUniform1i(texturefont_shader::distance_field,
+	            this->glyph_atlas.get_mode() == glyph_atlas_mode::distance_field);
 
 	glEnableVertexAttribArray(texturefont_shader::program->pos_id);
 	glEnableVertexAttribArray(texturefont_shader::tex_coord);
+	glEnableVertexAttribArray(texturefont_shader::vertex_color);
 
 	glVertexAttribPointer(texturefont_shader::program->pos_id, 2, GL_FLOAT, GL_FALSE,
 		sizeof(text_render_vertex), (GLvoid *) offsetof(text_render_vertex, x));
 	glVertexAttribPointer(texturefont_shader::tex_coord, 2, GL_FLOAT, GL_FALSE,
 		sizeof(text_render_vertex), (GLvoid *) offsetof(text_render_vertex, u));
-
-	for (auto &task : render_tasks) {
-		glUniform4f(texturefont_shader::color,
-			task.color.r/255.f, task.color.g/255.f, task.color.b/255.f, task.color.a/255.f);
-		glDrawElements(task.mode, task.num_elements, GL_UNSIGNED_INT, (GLvoid *) (task.offset * sizeof(unsigned int)));
+	glVertexAttribPointer(texturefont_shader::vertex_color, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+		sizeof(text_render_vertex), (GLvoid *) offsetof(text_render_vertex, r));
+
+	size_t first_glyph = 0;
+	for (auto &page_glyphs : this->page_glyph_counts) {
+		this->glyph_atlas.bind_page(page_glyphs.first, 0);
+		glDrawElements(GL_TRIANGLES, page_glyphs.second * 6, GL_UNSIGNED_INT,
+		               (GLvoid *) (first_glyph * 6 * sizeof(unsigned int)));
+		first_glyph += page_glyphs.second;
 	}
 
 	glDisableVertexAttribArray(texturefont_shader::program->pos_id);
 	glDisableVertexAttribArray(texturefont_shader::tex_coord);
+	glDisableVertexAttribArray(texturefont_shader::vertex_color);
 
+	glUniform1i(texturefont_shader::distance_field, 0);
 	texturefont_shader::program->stopusing();
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	// Clear the render batches for next frame
-	this->render_batches.clear();
 }
 
 }} // openage::renderer
@@ -1,9 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
-#include <vector>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <epoxy/gl.h>
 
 #include "../coord/window.h"
@@ -15,7 +19,7 @@ namespace openage {
 
 namespace texturefont_shader {
 extern shader::Program *program;
-extern GLint texture, color, tex_coord;
+extern GLint texture, color, tex_coord, vertex_color, distance_field;
 } // openage::texturefont_shader
 
 namespace renderer {
@@ -25,8 +29,11 @@ class TextRenderer {
 public:
 	/**
 	 * Requires a working OpenGL context to create buffer objects.
+	 *
+	 * @param distance_field_fonts: if given, glyphs are stored as distance fields
+	 *                              made of its fonts, so all sizes share them.
 	 */
-	TextRenderer();
+	TextRenderer(FontManager *distance_field_fonts = nullptr);
 
 	virtual ~TextRenderer();
 
@@ -71,9 +78,19 @@ public:
 
 	/**
 	 * Render all the text draw requests made during the frame.
+	 * The drawing is submitted to the frame's render commands.
+	 *
+	 * All texts are drawn with a draw call per glyph atlas page. The vertices are
+	 * only rebuilt if the texts differ from the previous frame, and
+	 * the glyphs of each text are kept while it's drawn.
 	 */
 	void render();
 
+	/**
+	 * Frames a text is kept in the glyph run cache without being drawn.
+	 */
+	static constexpr unsigned int run_cache_frames = 60;
+
 private:
 	/**
 	 * A single text draw request containing the text and position.
@@ -89,6 +106,10 @@ private:
 			y{y},
 			text{text} {
 		}
+
+		bool operator ==(const text_render_batch_pass &other) const {
+			return this->x == other.x and this->y == other.y and this->text == other.text;
+		}
 	};
 
 	/**
@@ -104,8 +125,56 @@ private:
 			font{font},
 			color{color} {
 		}
+
+		bool operator ==(const text_render_batch &other) const {
+			return (this->font == other.font and this->color == other.color
+			        and this->passes == other.passes);
+		}
+	};
+
+	/**
+	 * The laid out glyphs of a text, relative to its position.
+	 */
+	struct glyph_run {
+		struct glyph_quad {
+			float x0, y0, x1, y1;
+			float u0, v0, u1, v1;
+			unsigned int page;
+		};
+
+		std::vector<glyph_quad> quads;
+		unsigned int last_used;
 	};
 
+	using run_key = std::pair<Font *, std::string>;
+
+	struct run_key_hash {
+		size_t operator ()(const run_key &key) const;
+	};
+
+	/**
+	 * Build the glyph vertices of the batches and draw them.
+	 * Runs where the frame's render commands are executed.
+	 */
+	void draw_batches(std::vector<text_render_batch> &render_batches);
+
+	/**
+	 * Return the cached glyph run of a text, laying it out if needed.
+	 */
+	const glyph_run &get_run(Font *font, const std::string &text);
+
+	/**
+	 * Fill the vertex buffer with the glyphs of the batches, grouped by atlas page.
+	 */
+	void build_vertices(const std::vector<text_render_batch> &render_batches);
+
+	/**
+	 * Make the index buffer hold the indices of at least the given number of glyphs.
+	 * The indices of all glyph quads follow the same pattern, so they're only
+	 * written when the buffer grows.
+	 */
+	void reserve_indices(size_t glyph_count);
+
 	Font *current_font;
 	Color current_color;
 	bool is_dirty;
@@ -115,6 +184,23 @@ private:
 
 	GLuint vbo;
 	GLuint ibo;
+
+	// state of the render commands
+
+	/**
+	 * The batches whose vertices are in the vertex buffer.
+	 */
+	std::vector<text_render_batch> drawn_batches;
+	size_t glyph_count;
+	size_t index_capacity;
+
+	/**
+	 * The atlas pages of the glyphs in the vertex buffer, and their glyph counts.
+	 */
+	std::vector<std::pair<unsigned int, size_t>> page_glyph_counts;
+
+	std::unordered_map<run_key, glyph_run, run_key_hash> runs;
+	unsigned int frame;
 };
 
 }} // openage::renderer
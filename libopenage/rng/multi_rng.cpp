@@ -0,0 +1,120 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "multi_rng.h"
+
+
+namespace openage {
+namespace rng {
+
+
+constexpr size_t MultiRNG::lanes;
+
+
+MultiRNG::MultiRNG(const RNG &base)
+	:
+	buffered{0} {
+
+	RNG lane{base};
+	for (size_t i = 0; i < lanes; i++) {
+		this->state0[i] = lane.state[0];
+		this->state1[i] = lane.state[1];
+		lane.jump();
+	}
+}
+
+
+MultiRNG::MultiRNG(uint64_t seed)
+	:
+	MultiRNG{RNG{seed}} {}
+
+
+/*
+ * the same update as RNG::random, for all lanes at once
+ */
+void MultiRNG::step(uint64_t *out) {
+	for (size_t i = 0; i < lanes; i++) {
+		uint64_t s0 = this->state1[i];
+		uint64_t s1 = this->state0[i];
+		s1 ^= s1 << 23;
+		s1 = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+		this->state0[i] = s0;
+		this->state1[i] = s1;
+		out[i] = s1 + s0;
+	}
+}
+
+
+uint64_t MultiRNG::random() {
+	if (this->buffered == 0) {
+		this->step(this->buffer);
+		this->buffered = lanes;
+	}
+	return this->buffer[lanes - this->buffered--];
+}
+
+
+template<class T, class Lambda>
+void MultiRNG::act_fill(T *data, size_t len, const Lambda &op) {
+	size_t i = 0;
+
+	// the rest of the last step first
+	for (; i < len and this->buffered > 0; i++) {
+		op(this->buffer[lanes - this->buffered--], data, i);
+	}
+
+	// then whole steps
+	uint64_t values[lanes];
+	for (; i + lanes <= len; i += lanes) {
+		this->step(values);
+		for (size_t j = 0; j < lanes; j++) {
+			op(values[j], data, i + j);
+		}
+	}
+
+	// and keep what's left of the last one
+	if (i < len) {
+		this->step(this->buffer);
+		this->buffered = lanes;
+		for (; i < len; i++) {
+			op(this->buffer[lanes - this->buffered--], data, i);
+		}
+	}
+}
+
+
+void MultiRNG::fill(uint64_t *data, size_t len) {
+	this->act_fill(
+		data, len,
+		[](uint64_t v, uint64_t *d, size_t i) {
+			d[i] = v;
+		}
+	);
+}
+
+
+void MultiRNG::fill_real(double *data, size_t len) {
+	this->act_fill(
+		data, len,
+		[](uint64_t v, double *d, size_t i) {
+			d[i] = static_cast<double>(v) / RNG::max();
+		}
+	);
+}
+
+
+void MultiRNG::jump(size_t times) {
+	RNG lane{0};
+	for (size_t i = 0; i < lanes; i++) {
+		lane.state[0] = this->state0[i];
+		lane.state[1] = this->state1[i];
+		for (size_t j = 0; j < times; j++) {
+			lane.jump();
+		}
+		this->state0[i] = lane.state[0];
+		this->state1[i] = lane.state[1];
+	}
+	this->buffered = 0;
+}
+
+
+}} // namespace openage::rng
@@ -0,0 +1,92 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "rng.h"
+
+namespace openage {
+namespace rng {
+
+
+/** \class MultiRNG
+ * Runs several xorshift128+ streams side by side, for generating
+ * many random numbers at once.
+ *
+ * Lane i continues a copy of the base rng that jumped i times, so the
+ * lanes don't overlap. The numbers are interleaved: the n-th number
+ * of lane i is number n * lanes + i of the output. Each step updates
+ * all lanes in a plain loop over arrays, which the compiler vectorizes.
+ */
+class MultiRNG {
+public:
+	static constexpr size_t lanes = 4;
+
+	/**
+	 * Creates the lanes from the state of the base rng.
+	 * The base rng is not changed.
+	 */
+	MultiRNG(const RNG &base);
+
+
+	/**
+	 * Creates the lanes from a rng seeded with the 64 bit seed
+	 */
+	MultiRNG(uint64_t seed);
+
+
+	/**
+	 * Retrieves the next random value of the interleaved output
+	 */
+	uint64_t random();
+
+
+	/**
+	 * Fills a chunk of 64 bit integers.
+	 * Gives identical result to calling random() len times
+	 */
+	void fill(uint64_t *data, size_t len);
+
+
+	/**
+	 * Fills an array of doubles with values in [0, 1)
+	 * Gives the same values as fill, divided by RNG::max()
+	 */
+	void fill_real(double *data, size_t len);
+
+
+	/**
+	 * Advances every lane by times * 2^64 numbers.
+	 * With the default, the lanes continue past the last lane of
+	 * before, so consecutive jumps give blocks of non-overlapping
+	 * streams.
+	 */
+	void jump(size_t times=lanes);
+
+private:
+	/**
+	 * generates the next value of all lanes
+	 */
+	inline void step(uint64_t *out);
+
+	template<class T, class Lambda>
+	inline void act_fill(T *data, size_t len, const Lambda &op);
+
+	/**
+	 * the two state words of each lane
+	 */
+	uint64_t state0[lanes];
+	uint64_t state1[lanes];
+
+	/**
+	 * numbers of the last step that were not handed out yet,
+	 * from buffer[lanes - buffered] on
+	 */
+	uint64_t buffer[lanes];
+	size_t buffered;
+};
+
+
+}} // namespace openage::rng
@@ -191,6 +191,61 @@ void RNG::discard(size_t len) {
 }
 
 
+/*
+ * the state update is linear over GF(2), so 2^64 steps are one
+ * multiplication with a 128x128 bit matrix. its columns are
+ * stored as pairs of words, column i is the image of bit i.
+ */
+struct jump_matrix {
+	uint64_t columns[128][2];
+
+	void apply(uint64_t *state) const {
+		uint64_t result[2] = {0, 0};
+		for (size_t i = 0; i < 128; i++) {
+			if ((state[i / 64] >> (i % 64)) & 1) {
+				result[0] ^= this->columns[i][0];
+				result[1] ^= this->columns[i][1];
+			}
+		}
+		state[0] = result[0];
+		state[1] = result[1];
+	}
+};
+
+
+/*
+ * squares the single step matrix 64 times
+ */
+static jump_matrix make_jump_matrix() {
+	jump_matrix m;
+	for (size_t i = 0; i < 128; i++) {
+		uint64_t s[2] = {0, 0};
+		s[i / 64] = uint64_t{1} << (i % 64);
+		std::swap(s[0], s[1]);
+		do_rng(s[0], s[1]);
+		m.columns[i][0] = s[0];
+		m.columns[i][1] = s[1];
+	}
+
+	for (size_t k = 0; k < 64; k++) {
+		jump_matrix squared;
+		for (size_t i = 0; i < 128; i++) {
+			squared.columns[i][0] = m.columns[i][0];
+			squared.columns[i][1] = m.columns[i][1];
+			m.apply(squared.columns[i]);
+		}
+		m = squared;
+	}
+	return m;
+}
+
+
+void RNG::jump() {
+	static const jump_matrix matrix = make_jump_matrix();
+	matrix.apply(this->state);
+}
+
+
 void RNG::fill_real(double *dat, size_t len) {
 	act_fill(
 		dat, this->state, len,
@@ -232,6 +287,12 @@ void RNG::from_string(const std::string &instr) {
 }
 
 
+uint64_t RNG::fingerprint() const {
+	// the state is random already, only the order matters
+	return this->state[0] ^ (this->state[1] * 0x9e3779b97f4a7c15ull);
+}
+
+
 std::ostream &operator <<(std::ostream &ostream, const RNG &inrng) {
 	inrng.to_stream(ostream);
 	return ostream;
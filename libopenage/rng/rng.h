@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -135,6 +135,14 @@ public:
 	void discard(size_t num_discard);
 
 
+	/**
+	 * Advances the generator by 2^64 numbers.
+	 * Jumping copies of one rng a different number of times gives
+	 * streams that don't overlap, e.g. for parallel workers.
+	 */
+	void jump();
+
+
 	/**
 	 * Outputs the rng state to a stream
 	 * @throws Error if writing data fails
@@ -162,6 +170,13 @@ public:
 	void from_string(const std::string &instr);
 
 
+	/**
+	 * A hash of the rng state, to compare it cheaply
+	 * with the one of another rng.
+	 */
+	uint64_t fingerprint() const;
+
+
 	static constexpr uint64_t max() {
 		return UINT64_MAX;
 	}
@@ -173,6 +188,8 @@ public:
 
 
 private:
+	friend class MultiRNG;
+
 	/**
 	 * The internal state array
 	 */
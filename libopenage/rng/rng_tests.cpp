@@ -1,6 +1,7 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "rng.h"
+#include "multi_rng.h"
 
 #include "../log/log.h"
 #include "../error/error.h"
@@ -230,6 +231,76 @@ void fill_real() {
 }
 
 
+/**
+ * Tests jumping ahead.
+ *
+ * The jump is linear like the state update, so jumping
+ * and generating can be swapped.
+ */
+void jump() {
+	RNG test0{random_seed()};
+	RNG test1{test0};
+
+	test0.jump();
+	test0.to_string() != test1.to_string() or TESTFAIL;
+	test0.discard(1);
+
+	test1.discard(1);
+	test1.jump();
+	test0.to_string() == test1.to_string() or TESTFAIL;
+	for (size_t i = 0; i < num_rand; i++) {
+		test0() == test1() or TESTFAIL;
+	}
+}
+
+
+/**
+ * Tests the interleaved lanes of the multi lane rng.
+ */
+void multi_lanes() {
+	constexpr size_t lanes = MultiRNG::lanes;
+	constexpr size_t n = 1 << 7;
+
+	RNG base{random_seed()};
+	RNG single[lanes] = {base, base, base, base};
+	static_assert(lanes == 4, "the lanes are initialized by hand");
+	for (size_t i = 0; i < lanes; i++) {
+		for (size_t j = 0; j < i; j++) {
+			single[i].jump();
+		}
+	}
+
+	MultiRNG test0{base};
+	MultiRNG test1{base};
+	MultiRNG test2{base};
+
+	// consumed in parts that don't line up with the lanes
+	uint64_t data[n];
+	double real[n];
+	test0.fill(data, 3);
+	test0.fill(data + 3, n - 3);
+	test2.fill_real(real, n);
+
+	for (size_t i = 0; i < n; i++) {
+		uint64_t expected = single[i % lanes]();
+		data[i] == expected or TESTFAIL;
+		test1.random() == expected or TESTFAIL;
+		real[i] == static_cast<double>(expected) / RNG::max() or TESTFAIL;
+	}
+
+	// the next block of lanes continues without overlap
+	test0.jump();
+	for (size_t i = 0; i < lanes; i++) {
+		RNG next{base};
+		for (size_t j = 0; j < i + lanes; j++) {
+			next.jump();
+		}
+		next.discard(n / lanes);
+		test0.random() == next() or TESTFAIL;
+	}
+}
+
+
 void run() {
 	freq_dist();
 	bool_dist();
@@ -237,6 +308,8 @@ void run() {
 	reproduce();
 	fill();
 	fill_real();
+	jump();
+	multi_lanes();
 }
 
 
@@ -4,22 +4,96 @@
 #include "util/strings.h"
 
 #include <math.h>
+#include <memory>
 #include <stdlib.h>
+#include <cstring>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
 #include <epoxy/gl.h>
 
 #include "coord/window.h"
+#include "job/job_manager.h"
 #include "log/log.h"
+#include "render_command_list.h"
 #include <ctime>
 
 namespace openage {
 
+namespace {
 
-ScreenshotManager::ScreenshotManager()
+/**
+ * whether the gl context has fences, otherwise the readbacks are
+ * copied out after readback_frames.
+ */
+bool have_sync_objects() {
+	static bool result = (epoxy_gl_version() >= 32 or
+	                      epoxy_has_gl_extension("GL_ARB_sync"));
+	return result;
+}
+
+
+std::string timestamp(std::time_t t) {
+	// these two values (32) *must* be the same for safety reasons
+	char result[32];
+	std::strftime(result, 32, "%Y-%m-%d_%H-%M-%S", std::localtime(&t));
+	return result;
+}
+
+
+/**
+ * flips the rows of the gl framebuffer pixels and saves them as png.
+ */
+void save_png(const std::string &filename, coord::window size, const std::vector<uint32_t> &pixels) {
+	int32_t rmask, gmask, bmask, amask;
+	rmask = 0x000000FF;
+	gmask = 0x0000FF00;
+	bmask = 0x00FF0000;
+	amask = 0xFF000000;
+
+	SDL_Surface *screen = SDL_CreateRGBSurface(
+	SDL_SWSURFACE,
+	size.x,
+	size.y,
+	32,
+	rmask, gmask, bmask, amask);
+
+	if (screen == nullptr) {
+		log::log(MSG(err) << "Could not create the surface for " << filename);
+		return;
+	}
+
+	// we need to invert all pixel rows, but leave column order the same.
+	for (ssize_t row = 0; row < screen->h; row++) {
+		ssize_t irow = screen->h - 1 - row;
+		const uint32_t *src = &pixels[irow * screen->w];
+		uint32_t *dst = reinterpret_cast<uint32_t *>(
+			static_cast<uint8_t *>(screen->pixels) + row * screen->pitch);
+
+		for (ssize_t col = 0; col < screen->w; col++) {
+			// TODO: store the alpha channels in the screenshot, is buggy at the moment..
+			dst[col] = src[col] | 0xFF000000;
+		}
+	}
+
+	// call sdl_image for saving the screenshot to png
+	if (IMG_SavePNG(screen, filename.c_str()) != 0) {
+		log::log(MSG(err) << "Could not save screenshot " << filename << ": " << IMG_GetError());
+	}
+	SDL_FreeSurface(screen);
+}
+
+} // anonymous namespace
+
+
+ScreenshotManager::ScreenshotManager(job::JobManager *job_manager)
 	:
-	count{0} {
+	count{0},
+	last_time{0},
+	job_manager{job_manager},
+	recording{false},
+	recorded_frames{0},
+	dropped_frames{0} {
 }
 
 
@@ -37,11 +111,7 @@ std::string ScreenshotManager::gen_next_filename() {
 		this->last_time = t;
 	}
 
-	// these two values (32) *must* be the same for safety reasons
-	char timestamp[32];
-	std::strftime(timestamp, 32, "%Y-%m-%d_%H-%M-%S", std::localtime(&t));
-
-	return util::sformat("/tmp/openage_%s_%02d.png", timestamp, this->count);
+	return util::sformat("/tmp/openage_%s_%02d.png", timestamp(t).c_str(), this->count);
 }
 
 
@@ -50,43 +120,159 @@ void ScreenshotManager::save_screenshot() {
 
 	log::log(MSG(info) << "Saving screenshot to " << filename);
 
-	int32_t rmask, gmask, bmask, amask;
-	rmask = 0x000000FF;
-	gmask = 0x0000FF00;
-	bmask = 0x00FF0000;
-	amask = 0xFF000000;
+	this->capture(filename);
+}
 
-	SDL_Surface *screen = SDL_CreateRGBSurface(
-	SDL_SWSURFACE,
-	this->window_size.x,
-	this->window_size.y,
-	32,
-	rmask, gmask, bmask, amask);
 
-	size_t pxcount = screen->w * screen->h;
+void ScreenshotManager::toggle_recording() {
+	this->recording = not this->recording;
 
-	auto pxdata = std::make_unique<uint32_t[]>(pxcount);
+	if (this->recording) {
+		this->recording_prefix = util::sformat("/tmp/openage_%s_rec", timestamp(std::time(NULL)).c_str());
+		this->recorded_frames = 0;
+		log::log(MSG(info) << "Recording frames to " << this->recording_prefix << "_*.png");
+	}
+	else {
+		unsigned int frames = this->recorded_frames;
+		RenderCommandList::submit([this, frames] {
+			log::log(MSG(info) << "Stopped recording after " << frames << " frames, "
+			         << this->dropped_frames << " of them were dropped");
+			this->dropped_frames = 0;
+		});
+	}
+}
 
-	glReadPixels(0, 0,
-	             this->window_size.x, this->window_size.y,
-	             GL_RGBA, GL_UNSIGNED_BYTE, pxdata.get());
 
-	uint32_t *surface_pxls = (uint32_t *)screen->pixels;
+bool ScreenshotManager::is_recording() const {
+	return this->recording;
+}
 
-	// we need to invert all pixel rows, but leave column order the same.
-	for (ssize_t row = 0; row < screen->h; row++) {
-		ssize_t irow = screen->h - 1 - row;
-		for (ssize_t col = 0; col < screen->w; col++) {
-			uint32_t pxl = pxdata[irow * screen->w + col];
 
-			// TODO: store the alpha channels in the screenshot, is buggy at the moment..
-			surface_pxls[row * screen->w + col] = pxl | 0xFF000000;
+void ScreenshotManager::frame_done() {
+	if (this->recording) {
+		this->capture(util::sformat("%s_%05u.png", this->recording_prefix.c_str(), this->recorded_frames));
+		this->recorded_frames += 1;
+	}
+
+	RenderCommandList::submit([this] {
+		this->collect_readbacks(false);
+	});
+}
+
+
+void ScreenshotManager::finish() {
+	RenderCommandList::submit([this] {
+		this->collect_readbacks(true);
+
+		if (not this->free_buffers.empty()) {
+			glDeleteBuffers(this->free_buffers.size(), this->free_buffers.data());
+			this->free_buffers.clear();
 		}
+	});
+}
+
+
+void ScreenshotManager::capture(const std::string &filename) {
+	// the pixels are read where the frame is drawn
+	coord::window window_size = this->window_size;
+	RenderCommandList::submit([this, filename, window_size] {
+		this->start_readback(filename, window_size);
+	});
+}
+
+
+void ScreenshotManager::start_readback(const std::string &filename, coord::window size) {
+	if (size.x <= 0 or size.y <= 0) {
+		return;
 	}
 
-	// call sdl_image for saving the screenshot to png
-	IMG_SavePNG(screen, filename.c_str());
-	SDL_FreeSurface(screen);
+	if (this->pending.size() >= max_pending) {
+		this->dropped_frames += 1;
+		return;
+	}
+
+	readback frame;
+	if (this->free_buffers.empty()) {
+		glGenBuffers(1, &frame.buffer);
+	}
+	else {
+		frame.buffer = this->free_buffers.back();
+		this->free_buffers.pop_back();
+	}
+
+	// glReadPixels into a pack buffer returns without waiting for the frame
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	frame.fence = have_sync_objects() ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : nullptr;
+	frame.filename = filename;
+	frame.size = size;
+	frame.age = 0;
+
+	this->pending.push_back(std::move(frame));
+}
+
+
+void ScreenshotManager::collect_readbacks(bool wait) {
+	for (auto &frame : this->pending) {
+		frame.age += 1;
+	}
+
+	// the readbacks finish in the order they were started
+	while (not this->pending.empty()) {
+		readback &frame = this->pending.front();
+
+		bool ready = wait or frame.age > readback_frames;
+		if (not ready and frame.fence != nullptr) {
+			GLenum status = glClientWaitSync(frame.fence, 0, 0);
+			ready = (status == GL_ALREADY_SIGNALED or status == GL_CONDITION_SATISFIED);
+		}
+		if (not ready) {
+			break;
+		}
+
+		std::vector<uint32_t> pixels(static_cast<size_t>(frame.size.x) * frame.size.y);
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffer);
+		const void *data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (data != nullptr) {
+			std::memcpy(pixels.data(), data, pixels.size() * sizeof(uint32_t));
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		if (frame.fence != nullptr) {
+			glDeleteSync(frame.fence);
+		}
+		this->free_buffers.push_back(frame.buffer);
+
+		if (data != nullptr) {
+			this->encode(frame.filename, frame.size, std::move(pixels));
+		}
+		else {
+			log::log(MSG(err) << "Could not map the pixels of screenshot " << frame.filename);
+		}
+
+		this->pending.pop_front();
+	}
+}
+
+
+void ScreenshotManager::encode(const std::string &filename, coord::window size,
+                               std::vector<uint32_t> &&pixels) {
+	if (this->job_manager == nullptr) {
+		save_png(filename, size, pixels);
+		return;
+	}
+
+	// shared, as the job function must be copyable
+	auto data = std::make_shared<std::vector<uint32_t>>(std::move(pixels));
+	this->job_manager->enqueue<bool>([filename, size, data]() {
+		save_png(filename, size, *data);
+		return true;
+	});
 }
 
 
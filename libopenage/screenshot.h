@@ -1,38 +1,146 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
+#include <deque>
+#include <string>
+#include <vector>
 
+#include <epoxy/gl.h>
 #include <SDL2/SDL.h>
 #include "coord/window.h"
 
 namespace openage {
 
+namespace job {
+class JobManager;
+} // job
+
+/**
+ * Saves the drawn frames as png files.
+ *
+ * The pixels are read into a pixel buffer object without waiting for the
+ * gpu, and copied out some frames later when the readback has finished.
+ * Flipping the rows and encoding the png is done by a job.
+ *
+ * The readback state is only used by the gl commands, so on the thread
+ * which draws the frames.
+ */
 class ScreenshotManager {
 public:
-	ScreenshotManager();
+	/**
+	 * the encoding jobs are run by job_manager, or right away if it's nullptr.
+	 */
+	ScreenshotManager(job::JobManager *job_manager);
 	~ScreenshotManager();
 
 	/** to be called to save a screenshot */
 	void save_screenshot();
 
+	/**
+	 * start or stop saving every frame, e.g. to make a video of them.
+	 */
+	void toggle_recording();
+
+	bool is_recording() const;
+
+	/**
+	 * to be called after each frame is drawn, while its commands
+	 * are recorded. captures the frame when recording, and saves
+	 * the readbacks that have finished.
+	 */
+	void frame_done();
+
+	/**
+	 * saves the readbacks that are still in flight and frees the buffers.
+	 * to be called before the gl context is destroyed.
+	 */
+	void finish();
+
 	/** size of the game window, in coord_sdl */
 	coord::window window_size;
 
+	/**
+	 * readbacks that may be in flight at once, further frames
+	 * are dropped while recording.
+	 */
+	static constexpr size_t max_pending = 4;
+
+	/**
+	 * frames after which a readback is copied out
+	 * even though the gpu didn't signal that it's done.
+	 */
+	static constexpr unsigned int readback_frames = 3;
 
 private:
+	/**
+	 * one frame that is read into a pixel buffer.
+	 */
+	struct readback {
+		GLuint buffer;
+
+		/** signaled when the pixels were written, or nullptr without sync objects */
+		GLsync fence;
+
+		std::string filename;
+		coord::window size;
+
+		/** frames since the readback was started */
+		unsigned int age;
+	};
 
 	/** to be called to get the next screenshot filename into the array */
 	std::string gen_next_filename();
 
+	/**
+	 * submits the readback of the current frame, saved to filename.
+	 */
+	void capture(const std::string &filename);
+
+	/**
+	 * starts reading the framebuffer, on the gl thread.
+	 */
+	void start_readback(const std::string &filename, coord::window size);
+
+	/**
+	 * copies the pixels of the finished readbacks and encodes them,
+	 * on the gl thread. wait = true takes all of them.
+	 */
+	void collect_readbacks(bool wait);
+
+	/**
+	 * flips and saves the pixels of a readback, on a job.
+	 */
+	void encode(const std::string &filename, coord::window size,
+	            std::vector<uint32_t> &&pixels);
+
 	/** contains the number to be in the next screenshot filename */
 	unsigned count;
 
 	/** contains the last time when a screenshot was taken */
 	std::time_t last_time;
 
+	job::JobManager *job_manager;
+
+	/** whether every frame is saved */
+	bool recording;
+
+	/** filename start and number of the next frame of the recording */
+	std::string recording_prefix;
+	unsigned int recorded_frames;
+
+	// the following are only used on the gl thread
+
+	std::deque<readback> pending;
+
+	/** pixel buffers of finished readbacks, to be reused */
+	std::vector<GLuint> free_buffers;
+
+	/** frames of the recording that were dropped as too many readbacks were in flight */
+	size_t dropped_frames;
 };
 
 } // openage
@@ -1,7 +1,13 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "program.h"
 
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -18,6 +24,39 @@
 namespace openage {
 namespace shader {
 
+namespace {
+
+constexpr uint32_t program_binary_version = 1;
+
+/**
+ * file header of a cached program binary, followed by the binary.
+ */
+struct program_binary_header {
+	char magic[4];           //!< "OPRG"
+	uint32_t version;
+	uint64_t key;            //!< Program::binary_key of the program
+	uint32_t format;         //!< the binary format reported by the driver
+	uint32_t length;         //!< bytes of the binary after the header
+};
+
+void hash_fnv1a(uint64_t &hash, const char *data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ull;
+	}
+}
+
+void hash_fnv1a(uint64_t &hash, const std::string &str) {
+	// the terminator separates the strings
+	hash_fnv1a(hash, str.c_str(), str.size() + 1);
+}
+
+} // anonymous namespace
+
+
+std::string Program::binary_cache_dir;
+
+
 Program::Program() : is_linked(false), vert(nullptr), frag(nullptr), geom(nullptr) {
 	this->id = glCreateProgram();
 }
@@ -32,6 +71,7 @@ Program::~Program() {
 }
 
 void Program::attach_shader(Shader *s) {
+	// the shaders are compiled and attached when linking
 	switch (s->type) {
 	case GL_VERTEX_SHADER:
 		this->vert = s;
@@ -43,10 +83,37 @@ void Program::attach_shader(Shader *s) {
 		this->geom = s;
 		break;
 	}
-	glAttachShader(this->id, s->id);
 }
 
 void Program::link() {
+	bool use_cache = not Program::binary_cache_dir.empty() and Program::binaries_supported();
+	uint64_t key = 0;
+	std::string cache_file;
+
+	if (use_cache) {
+		key = this->binary_key();
+
+		std::ostringstream path;
+		path << Program::binary_cache_dir << "/" << std::hex << key << ".bin";
+		cache_file = path.str();
+
+		if (this->load_binary(cache_file, key)) {
+			this->is_linked = true;
+			this->post_link_hook();
+			return;
+		}
+
+		glProgramParameteri(this->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	Shader *shaders[] = {this->vert, this->frag, this->geom};
+	for (Shader *s : shaders) {
+		if (s != nullptr) {
+			s->compile();
+			glAttachShader(this->id, s->id);
+		}
+	}
+
 	glLinkProgram(this->id);
 	this->check(GL_LINK_STATUS);
 	glValidateProgram(this->id);
@@ -54,14 +121,139 @@ void Program::link() {
 	this->is_linked = true;
 	this->post_link_hook();
 
-	if (this->vert != nullptr) {
-		glDetachShader(this->id, this->vert->id);
+	for (Shader *s : shaders) {
+		if (s != nullptr) {
+			glDetachShader(this->id, s->id);
+		}
+	}
+
+	if (use_cache) {
+		this->store_binary(cache_file, key);
+	}
+}
+
+void Program::set_binary_cache_dir(const std::string &dir) {
+	Program::binary_cache_dir = dir;
+}
+
+bool Program::binaries_supported() {
+	static bool checked = false;
+	static bool supported = false;
+
+	if (not checked) {
+		checked = true;
+		if (epoxy_gl_version() >= 41 or epoxy_has_gl_extension("GL_ARB_get_program_binary")) {
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			supported = formats > 0;
+		}
+	}
+
+	return supported;
+}
+
+uint64_t Program::binary_key() const {
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	// a binary is only valid for the driver that created it
+	for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+		const GLubyte *value = glGetString(name);
+		hash_fnv1a(hash, (value == nullptr) ? "" : reinterpret_cast<const char *>(value));
 	}
-	if (this->frag != nullptr) {
-		glDetachShader(this->id, this->frag->id);
+
+	for (const Shader *s : {this->vert, this->frag, this->geom}) {
+		if (s != nullptr) {
+			hash_fnv1a(hash, type_to_string(s->type));
+			hash_fnv1a(hash, s->source);
+		}
 	}
-	if (this->geom != nullptr) {
-		glDetachShader(this->id, this->geom->id);
+
+	for (auto &binding : this->attribute_bindings) {
+		hash_fnv1a(hash, binding.first);
+		hash_fnv1a(hash, std::to_string(binding.second));
+	}
+
+	return hash;
+}
+
+bool Program::load_binary(const std::string &filename, uint64_t key) {
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	program_binary_header header;
+	std::unique_ptr<char[]> binary;
+
+	bool valid = (fread(&header, sizeof(header), 1, file) == 1 and
+	              memcmp(header.magic, "OPRG", 4) == 0 and
+	              header.version == program_binary_version and
+	              header.key == key);
+
+	if (valid) {
+		binary = std::make_unique<char[]>(header.length);
+		valid = (fread(binary.get(), 1, header.length, file) == header.length);
+	}
+	fclose(file);
+
+	if (not valid) {
+		log::log(MSG(info) << "Ignoring outdated program binary " << filename);
+		return false;
+	}
+
+	glProgramBinary(this->id, header.format, binary.get(), header.length);
+
+	// the driver may reject binaries, e.g. after an update
+	GLint status;
+	glGetProgramiv(this->id, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		log::log(MSG(info) << "Driver rejected program binary " << filename);
+		return false;
+	}
+
+	return true;
+}
+
+void Program::store_binary(const std::string &filename, uint64_t key) {
+	if (mkdir(Program::binary_cache_dir.c_str(), 0755) < 0 and errno != EEXIST) {
+		log::log(MSG(warn) << "Could not create program binary directory " << Program::binary_cache_dir);
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(this->id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	auto binary = std::make_unique<char[]>(length);
+	GLenum format;
+	GLsizei written_length;
+	glGetProgramBinary(this->id, length, &written_length, &format, binary.get());
+
+	program_binary_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "OPRG", 4);
+	header.version = program_binary_version;
+	header.key = key;
+	header.format = format;
+	header.length = written_length;
+
+	// a partially written file is never seen under the final name
+	std::string tmp_filename = filename + ".tmp";
+	FILE *file = fopen(tmp_filename.c_str(), "wb");
+	if (file == nullptr) {
+		log::log(MSG(warn) << "Could not write program binary " << tmp_filename);
+		return;
+	}
+
+	bool written = (fwrite(&header, sizeof(header), 1, file) == 1 and
+	                fwrite(binary.get(), 1, written_length, file) == static_cast<size_t>(written_length));
+	written = (fclose(file) == 0) and written;
+
+	if (not written or rename(tmp_filename.c_str(), filename.c_str()) < 0) {
+		unlink(tmp_filename.c_str());
+		log::log(MSG(warn) << "Could not write program binary " << filename);
 	}
 }
 
@@ -113,7 +305,14 @@ void Program::stopusing() {
 }
 
 GLint Program::get_uniform_id(const char *name) {
-	return glGetUniformLocation(this->id, name);
+	auto it = this->uniform_ids.find(name);
+	if (it != this->uniform_ids.end()) {
+		return it->second;
+	}
+
+	GLint uid = glGetUniformLocation(this->id, name);
+	this->uniform_ids.emplace(name, uid);
+	return uid;
 }
 
 GLint Program::get_attribute_id(const char *name) {
@@ -123,6 +322,11 @@ GLint Program::get_attribute_id(const char *name) {
 			" was queried before program was linked!");
 	}
 
+	auto it = this->attribute_ids.find(name);
+	if (it != this->attribute_ids.end()) {
+		return it->second;
+	}
+
 	GLint aid = glGetAttribLocation(this->id, name);
 
 	if (unlikely(aid == -1)) {
@@ -132,12 +336,14 @@ GLint Program::get_attribute_id(const char *name) {
 			" (pwnt by the compiler).");
 	}
 
+	this->attribute_ids.emplace(name, aid);
 	return aid;
 }
 
 void Program::set_attribute_id(const char *name, GLuint id) {
 	if (!this->is_linked) {
 		glBindAttribLocation(this->id, id, name);
+		this->attribute_bindings.emplace_back(name, id);
 	}
 	else {
 		//TODO: maybe enable overwriting, but after that relink the program
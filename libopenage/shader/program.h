@@ -1,14 +1,29 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <epoxy/gl.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace openage {
 namespace shader {
 
 class Shader;
 
+/**
+ * A linked shader program.
+ *
+ * If a binary cache directory is set and the driver supports program
+ * binaries, linked programs are stored there. They are loaded instead of
+ * compiling their shaders on the next start, as long as the sources, the
+ * attribute bindings and the driver stay the same.
+ *
+ * Uniform and attribute locations are only queried once per name.
+ */
 class Program {
 public:
 	GLuint id;
@@ -32,14 +47,52 @@ public:
 
 	void dump_active_attributes();
 
+	/**
+	 * the directory for program binaries, an empty one
+	 * disables the cache.
+	 */
+	static void set_binary_cache_dir(const std::string &dir);
+
 private:
 	bool is_linked;
 	Shader *vert, *frag, *geom;
 
+	/**
+	 * attribute locations assigned before linking.
+	 */
+	std::vector<std::pair<std::string, GLuint>> attribute_bindings;
+
+	std::unordered_map<std::string, GLint> uniform_ids;
+	std::unordered_map<std::string, GLint> attribute_ids;
+
 	void check(GLenum what_to_check);
 	GLint get_info(GLenum pname);
 	char *get_log();
 	void post_link_hook();
+
+	/**
+	 * hash of the sources, the attribute bindings and the driver.
+	 */
+	uint64_t binary_key() const;
+
+	/**
+	 * link from the binary in the cache file, false if there is
+	 * no matching one or the driver rejects it.
+	 */
+	bool load_binary(const std::string &filename, uint64_t key);
+
+	/**
+	 * write the binary of the linked program to the cache file.
+	 * failures are only logged.
+	 */
+	void store_binary(const std::string &filename, uint64_t key);
+
+	/**
+	 * whether the context can get and load program binaries.
+	 */
+	static bool binaries_supported();
+
+	static std::string binary_cache_dir;
 };
 
 
@@ -1,4 +1,4 @@
-// Copyright 2013-2015 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "shader.h"
 
@@ -27,16 +27,33 @@ const char *type_to_string(GLenum type) {
 	}
 }
 
-Shader::Shader(GLenum type, std::initializer_list<const char *> sources) {
-	//create shader
-	this->id = glCreateShader(type);
+Shader::Shader(GLenum type, std::initializer_list<const char *> sources)
+	:
+	id{0},
+	type{type} {
+
+	for (const char *source : sources) {
+		this->source += source;
+	}
+}
 
-	//store type
-	this->type = type;
+Shader::~Shader() {
+	if (this->id != 0) {
+		glDeleteShader(this->id);
+	}
+}
+
+void Shader::compile() {
+	if (this->id != 0) {
+		return;
+	}
+
+	//create shader
+	this->id = glCreateShader(this->type);
 
 	//load shader source
-	std::vector<const char*> x = std::vector<const char*>(sources);
-	glShaderSource(this->id, x.size(), x.data(), NULL);
+	const char *source = this->source.c_str();
+	glShaderSource(this->id, 1, &source, NULL);
 
 	//compile shader source
 	glCompileShader(this->id);
@@ -53,16 +70,13 @@ Shader::Shader(GLenum type, std::initializer_list<const char *> sources) {
 		glGetShaderInfoLog(this->id, loglen, NULL, infolog.get());
 
 		auto errmsg = MSG(err);
-		errmsg << "Failed to compile " << type_to_string(type) << " shader\n" << infolog;
+		errmsg << "Failed to compile " << type_to_string(this->type) << " shader\n" << infolog;
 
 		glDeleteShader(this->id);
+		this->id = 0;
 
 		throw Error(errmsg);
 	}
 }
 
-Shader::~Shader() {
-	glDeleteShader(this->id);
-}
-
 }} // openage::shader
@@ -1,8 +1,9 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <initializer_list>
+#include <string>
 
 #include <epoxy/gl.h>
 
@@ -11,13 +12,29 @@ namespace shader {
 
 const char *type_to_string(GLenum type);
 
+/**
+ * The sources of a shader, compiled when a program that uses it
+ * is linked from them. Programs loaded from their binary cache
+ * don't compile their shaders.
+ */
 class Shader {
 public:
 	Shader(GLenum type, std::initializer_list<const char *> sources);
 	~Shader();
 
+	/**
+	 * compile the shader, if it wasn't yet.
+	 * throws an Error if it fails.
+	 */
+	void compile();
+
 	GLuint id;
 	GLenum type;
+
+	/**
+	 * the sources, concatenated.
+	 */
+	std::string source;
 };
 
 }} // openage::shader
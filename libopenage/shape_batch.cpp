@@ -0,0 +1,128 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "shape_batch.h"
+
+#include <cstddef>
+#include <memory>
+
+#include "render_command_list.h"
+
+namespace openage {
+
+namespace shape_shader {
+shader::Program *program;
+GLint color;
+} // namespace shape_shader
+
+
+GLuint ShapeBatch::vertbuf = 0;
+
+
+void ShapeBatch::line(GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1, shape_color color) {
+	this->lines.push_back({x0, y0, color});
+	this->lines.push_back({x1, y1, color});
+}
+
+
+void ShapeBatch::rect_outline(GLfloat left, GLfloat bottom, GLfloat right, GLfloat top, shape_color color) {
+	this->line(left,  top,    right, top,    color);
+	this->line(right, top,    right, bottom, color);
+	this->line(right, bottom, left,  bottom, color);
+	this->line(left,  bottom, left,  top,    color);
+}
+
+
+void ShapeBatch::rect(GLfloat left, GLfloat bottom, GLfloat right, GLfloat top, shape_color color) {
+	// two triangles:
+	// top left, bottom left, bottom right
+	// top left, bottom right, top right
+	this->triangles.push_back({left,  top,    color});
+	this->triangles.push_back({left,  bottom, color});
+	this->triangles.push_back({right, bottom, color});
+	this->triangles.push_back({left,  top,    color});
+	this->triangles.push_back({right, bottom, color});
+	this->triangles.push_back({right, top,    color});
+}
+
+
+void ShapeBatch::quad(const GLfloat (&x)[4], const GLfloat (&y)[4], shape_color color) {
+	// two triangles, split along the first and third corner
+	this->triangles.push_back({x[0], y[0], color});
+	this->triangles.push_back({x[1], y[1], color});
+	this->triangles.push_back({x[2], y[2], color});
+	this->triangles.push_back({x[0], y[0], color});
+	this->triangles.push_back({x[2], y[2], color});
+	this->triangles.push_back({x[3], y[3], color});
+}
+
+
+bool ShapeBatch::empty() const {
+	return this->triangles.empty() and this->lines.empty();
+}
+
+
+void ShapeBatch::submit() {
+	if (this->empty()) {
+		return;
+	}
+
+	auto triangles = std::make_shared<std::vector<shape_vertex>>();
+	auto lines = std::make_shared<std::vector<shape_vertex>>();
+	triangles->swap(this->triangles);
+	lines->swap(this->lines);
+
+	RenderCommandList::submit([triangles, lines] {
+		ShapeBatch::draw(*triangles, *lines);
+	});
+}
+
+
+void ShapeBatch::release() {
+	if (ShapeBatch::vertbuf != 0) {
+		glDeleteBuffers(1, &ShapeBatch::vertbuf);
+		ShapeBatch::vertbuf = 0;
+	}
+}
+
+
+void ShapeBatch::draw(const std::vector<shape_vertex> &triangles,
+                      const std::vector<shape_vertex> &lines) {
+	if (ShapeBatch::vertbuf == 0) {
+		glGenBuffers(1, &ShapeBatch::vertbuf);
+	}
+
+	// the lines are stored behind the triangles
+	size_t triangle_size = triangles.size() * sizeof(shape_vertex);
+	size_t line_size = lines.size() * sizeof(shape_vertex);
+
+	glBindBuffer(GL_ARRAY_BUFFER, ShapeBatch::vertbuf);
+	glBufferData(GL_ARRAY_BUFFER, triangle_size + line_size, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, triangle_size, triangles.data());
+	glBufferSubData(GL_ARRAY_BUFFER, triangle_size, line_size, lines.data());
+
+	shape_shader::program->use();
+
+	GLint pos_id = shape_shader::program->pos_id;
+	glEnableVertexAttribArray(pos_id);
+	glEnableVertexAttribArray(shape_shader::color);
+	glVertexAttribPointer(pos_id, 2, GL_FLOAT, GL_FALSE, sizeof(shape_vertex),
+	                      (void *)offsetof(shape_vertex, x));
+	glVertexAttribPointer(shape_shader::color, 4, GL_FLOAT, GL_FALSE, sizeof(shape_vertex),
+	                      (void *)offsetof(shape_vertex, color));
+
+	if (not triangles.empty()) {
+		glDrawArrays(GL_TRIANGLES, 0, triangles.size());
+	}
+	if (not lines.empty()) {
+		glLineWidth(1);
+		glDrawArrays(GL_LINES, triangles.size(), lines.size());
+	}
+
+	glDisableVertexAttribArray(pos_id);
+	glDisableVertexAttribArray(shape_shader::color);
+
+	shape_shader::program->stopusing();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+} // namespace openage
@@ -0,0 +1,86 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <vector>
+
+#include "shader/program.h"
+
+namespace openage {
+
+namespace shape_shader {
+extern shader::Program *program;
+extern GLint color;
+} // namespace shape_shader
+
+struct shape_color {
+	GLfloat r, g, b, a;
+};
+
+/**
+ * one vertex of a line or a filled triangle.
+ */
+struct shape_vertex {
+	GLfloat x, y;
+	shape_color color;
+};
+
+/**
+ * collects colored lines, rectangles and quads, to draw them from a vertex buffer.
+ *
+ * the shapes are recorded by the draw handlers and drawn with the commands
+ * of the frame by submit(). the filled shapes are drawn first, with one
+ * draw call, followed by one for all lines. all batches share one stream
+ * buffer, as they are only drawn by the thread drawing the frame.
+ *
+ * lines are one pixel wide, wider ones are drawn as rectangles.
+ */
+class ShapeBatch {
+public:
+	void line(GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1, shape_color color);
+
+	/**
+	 * the outline of a rectangle, as a loop of four lines.
+	 */
+	void rect_outline(GLfloat left, GLfloat bottom, GLfloat right, GLfloat top, shape_color color);
+
+	/**
+	 * a filled rectangle.
+	 */
+	void rect(GLfloat left, GLfloat bottom, GLfloat right, GLfloat top, shape_color color);
+
+	/**
+	 * a filled convex quadrilateral, the corners given in order around it.
+	 * used for the isometric tiles.
+	 */
+	void quad(const GLfloat (&x)[4], const GLfloat (&y)[4], shape_color color);
+
+	bool empty() const;
+
+	/**
+	 * submit the recorded shapes as one render command, the batch
+	 * is empty afterwards.
+	 */
+	void submit();
+
+	/**
+	 * delete the shared vertex buffer. has to be called by the
+	 * thread that drew the batches, while its context is current.
+	 */
+	static void release();
+
+private:
+	/**
+	 * issue the gl calls for the shapes.
+	 */
+	static void draw(const std::vector<shape_vertex> &triangles,
+	                 const std::vector<shape_vertex> &lines);
+
+	std::vector<shape_vertex> triangles;
+	std::vector<shape_vertex> lines;
+
+	static GLuint vertbuf;
+};
+
+} // namespace openage
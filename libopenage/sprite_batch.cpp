@@ -0,0 +1,359 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "sprite_batch.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "error/error.h"
+#include "render_command_list.h"
+#include "texture.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * how many groups a sprite may be moved back to join a group
+ * of its texture. limits the cost of the overlap checks.
+ */
+constexpr size_t max_group_lookback = 16;
+
+/**
+ * screen rectangle of a sprite, same geometry as Texture::draw.
+ * left may be greater than right for mirrored sprites.
+ */
+void sprite_quad(const sprite_record &rec, const gamedata::subtexture *tx,
+                 GLfloat *left, GLfloat *right, GLfloat *bottom, GLfloat *top) {
+	*bottom = rec.y - (tx->h - tx->cy);
+	*top    = *bottom + tx->h;
+
+	if (not rec.mirrored) {
+		*left  = rec.x - tx->cx;
+		*right = *left + tx->w;
+	} else {
+		*left  = rec.x + tx->cx;
+		*right = *left - tx->w;
+	}
+}
+
+} // anonymous namespace
+
+
+SpriteBatch *SpriteBatch::active = nullptr;
+
+
+SpriteBatch::SpriteBatch()
+	:
+	vertbuf{0},
+	index_buffer{0},
+	index_capacity{0},
+	draw_calls{0} {}
+
+
+SpriteBatch::~SpriteBatch() {
+	if (SpriteBatch::active == this) {
+		SpriteBatch::active = nullptr;
+	}
+
+	if (this->vertbuf != 0) {
+		glDeleteBuffers(1, &this->vertbuf);
+	}
+	if (this->index_buffer != 0) {
+		glDeleteBuffers(1, &this->index_buffer);
+	}
+}
+
+
+void SpriteBatch::begin() {
+	ENSURE(SpriteBatch::active == nullptr or SpriteBatch::active == this,
+	       "another sprite batch is already active");
+
+	SpriteBatch::active = this;
+}
+
+
+void SpriteBatch::end() {
+	this->flush();
+
+	if (SpriteBatch::active == this) {
+		SpriteBatch::active = nullptr;
+	}
+}
+
+
+SpriteBatch *SpriteBatch::get_active() {
+	return SpriteBatch::active;
+}
+
+
+void SpriteBatch::flush_active() {
+	if (SpriteBatch::active != nullptr) {
+		SpriteBatch::active->flush();
+	}
+}
+
+
+size_t SpriteBatch::get_draw_calls() const {
+	return this->draw_calls;
+}
+
+
+void SpriteBatch::add(const Texture *tex, coord::pixel_t x, coord::pixel_t y,
+                      unsigned int mode, bool mirrored, int subid, unsigned player) {
+	this->records.push_back({tex, subid, x, y, player, mirrored, (mode & PLAYERCOLORED) != 0});
+}
+
+
+void SpriteBatch::build_groups(const std::vector<sprite_record> &records) {
+	this->groups.clear();
+	this->record_group.resize(records.size());
+
+	// assign each sprite to a group,
+	// while keeping overlapping sprites in order.
+	for (size_t i = 0; i < records.size(); i++) {
+		const sprite_record &rec = records[i];
+
+		// grouped by opengl texture, as atlas pages are shared by textures.
+		// this uploads the texture if needed.
+		GLuint palette_id;
+		GLuint texture_id = rec.tex->get_draw_texture_id(&palette_id);
+
+		// the palette shader gets the player of all sprites
+		bool playercolored = rec.playercolored and palette_id == 0;
+
+		GLfloat left, right, bottom, top;
+		sprite_quad(rec, rec.tex->get_subtexture(rec.subid), &left, &right, &bottom, &top);
+		if (left > right) {
+			std::swap(left, right);
+		}
+
+		size_t target = this->groups.size();
+		size_t lookback = std::min(this->groups.size(), max_group_lookback);
+
+		for (size_t back = 1; back <= lookback; back++) {
+			const group &candidate = this->groups[this->groups.size() - back];
+
+			if (candidate.texture_id == texture_id and candidate.palette_id == palette_id and
+			    candidate.playercolored == playercolored) {
+				target = this->groups.size() - back;
+				break;
+			}
+
+			// the sprite would be drawn below this group
+			if (left < candidate.right and right > candidate.left and
+			    bottom < candidate.top and top > candidate.bottom) {
+				break;
+			}
+		}
+
+		if (target == this->groups.size()) {
+			this->groups.push_back({texture_id, palette_id, playercolored, left, right, bottom, top, 0, 0});
+		}
+		else {
+			group &g = this->groups[target];
+			g.left   = std::min(g.left, left);
+			g.right  = std::max(g.right, right);
+			g.bottom = std::min(g.bottom, bottom);
+			g.top    = std::max(g.top, top);
+		}
+
+		this->groups[target].quad_count += 1;
+		this->record_group[i] = target;
+	}
+
+	// place the groups after each other in the vertex buffer,
+	// quad_count is counted again while filling in the quads.
+	size_t first_quad = 0;
+	for (auto &g : this->groups) {
+		g.first_quad = first_quad;
+		first_quad += g.quad_count;
+		g.quad_count = 0;
+	}
+
+	this->vertices.resize(first_quad * 4);
+
+	for (size_t i = 0; i < records.size(); i++) {
+		const sprite_record &rec = records[i];
+		group &g = this->groups[this->record_group[i]];
+
+		const gamedata::subtexture *tx = rec.tex->get_subtexture(rec.subid);
+
+		GLfloat left, right, bottom, top;
+		sprite_quad(rec, tx, &left, &right, &bottom, &top);
+
+		float txl, txr, txt, txb;
+		rec.tex->get_subtexture_coordinates(tx, &txl, &txr, &txt, &txb);
+
+		// player 1 keeps the colors of the texture
+		GLfloat player = rec.playercolored ? rec.player : 1;
+
+		sprite_vertex *quad = &this->vertices[(g.first_quad + g.quad_count) * 4];
+		quad[0] = {left,  top,    txl, txt, player};
+		quad[1] = {left,  bottom, txl, txb, player};
+		quad[2] = {right, bottom, txr, txb, player};
+		quad[3] = {right, top,    txr, txt, player};
+
+		g.quad_count += 1;
+	}
+}
+
+
+void SpriteBatch::reserve_indices(size_t quad_count) {
+	if (quad_count <= this->index_capacity) {
+		return;
+	}
+
+	// grow in steps to avoid reuploads every frame
+	size_t capacity = std::max<size_t>(this->index_capacity * 2, 1024);
+	capacity = std::max(capacity, quad_count);
+
+	std::vector<GLuint> indices;
+	indices.reserve(capacity * 6);
+	for (size_t q = 0; q < capacity; q++) {
+		GLuint base = q * 4;
+
+		// two triangles per quad, like the terrain renderer
+		indices.push_back(base);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+	}
+
+	if (this->index_buffer == 0) {
+		glGenBuffers(1, &this->index_buffer);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+	             indices.size() * sizeof(GLuint),
+	             indices.data(),
+	             GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	this->index_capacity = capacity;
+}
+
+
+void SpriteBatch::flush() {
+	if (this->records.empty()) {
+		return;
+	}
+
+	// drawn with the commands of the frame,
+	// the batch records the next sprites meanwhile.
+	auto records = std::make_shared<std::vector<sprite_record>>();
+	records->swap(this->records);
+
+	RenderCommandList::submit([this, records] {
+		this->draw(*records);
+	});
+}
+
+
+void SpriteBatch::draw(const std::vector<sprite_record> &records) {
+	this->build_groups(records);
+	this->reserve_indices(this->vertices.size() / 4);
+
+	if (this->vertbuf == 0) {
+		glGenBuffers(1, &this->vertbuf);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vertbuf);
+	glBufferData(GL_ARRAY_BUFFER,
+	             this->vertices.size() * sizeof(sprite_vertex),
+	             this->vertices.data(),
+	             GL_STREAM_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+
+	glColor4f(1, 1, 1, 1);
+	glActiveTexture(GL_TEXTURE0);
+	glEnable(GL_TEXTURE_2D);
+
+	// the program is only switched when the shader mode changes
+	shader::Program *program = nullptr;
+	GLint pos_id = -1, texcoord_id = -1, player_id = -1;
+
+	auto stop_program = [&]() {
+		if (program == nullptr) {
+			return;
+		}
+
+		glDisableVertexAttribArray(pos_id);
+		glDisableVertexAttribArray(texcoord_id);
+		if (player_id >= 0) {
+			glDisableVertexAttribArray(player_id);
+		}
+		program->stopusing();
+	};
+
+	for (auto &g : this->groups) {
+		shader::Program *wanted;
+		if (g.palette_id != 0) {
+			wanted = palette_shader::program;
+		} else if (g.playercolored) {
+			wanted = teamcolor_shader::program;
+		} else {
+			wanted = texture_shader::program;
+		}
+
+		if (wanted != program) {
+			stop_program();
+
+			program = wanted;
+			program->use();
+
+			pos_id = program->pos_id;
+			if (g.palette_id != 0) {
+				texcoord_id = palette_shader::tex_coord;
+				player_id   = palette_shader::player_id_var;
+			} else if (g.playercolored) {
+				texcoord_id = teamcolor_shader::tex_coord;
+				player_id   = teamcolor_shader::player_id_var;
+			} else {
+				texcoord_id = texture_shader::tex_coord;
+				player_id   = -1;
+			}
+
+			glEnableVertexAttribArray(pos_id);
+			glEnableVertexAttribArray(texcoord_id);
+			glVertexAttribPointer(pos_id, 2, GL_FLOAT, GL_FALSE, sizeof(sprite_vertex),
+			                      (void *)offsetof(sprite_vertex, x));
+			glVertexAttribPointer(texcoord_id, 2, GL_FLOAT, GL_FALSE, sizeof(sprite_vertex),
+			                      (void *)offsetof(sprite_vertex, tex_u));
+			if (player_id >= 0) {
+				glEnableVertexAttribArray(player_id);
+				glVertexAttribPointer(player_id, 1, GL_FLOAT, GL_FALSE, sizeof(sprite_vertex),
+				                      (void *)offsetof(sprite_vertex, player));
+			}
+		}
+
+		if (g.palette_id != 0) {
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, g.palette_id);
+			glActiveTexture(GL_TEXTURE0);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, g.texture_id);
+		glDrawElements(GL_TRIANGLES,
+		               g.quad_count * 6,
+		               GL_UNSIGNED_INT,
+		               (void *)(g.first_quad * 6 * sizeof(GLuint)));
+	}
+
+	stop_program();
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	this->draw_calls = this->groups.size();
+}
+
+} // namespace openage
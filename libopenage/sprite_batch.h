@@ -0,0 +1,153 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "coord/decl.h"
+
+namespace openage {
+
+class Texture;
+
+/**
+ * a sprite requested to be drawn by Texture::draw.
+ */
+struct sprite_record {
+	const Texture *tex;
+	int subid;
+	coord::pixel_t x, y;
+	unsigned player;
+	bool mirrored;
+	bool playercolored;
+};
+
+/**
+ * one vertex of a sprite quad, in camgame coordinates.
+ */
+struct sprite_vertex {
+	GLfloat x, y;
+	GLfloat tex_u, tex_v;
+	GLfloat player;
+};
+
+/**
+ * collects the sprites drawn during a pass and draws
+ * them with few draw calls.
+ *
+ * while a batch is active, Texture::draw records sprites instead of
+ * drawing them. flushing groups the records by opengl texture and shader,
+ * uploads all quads to one vertex buffer and draws each group with
+ * one indexed draw call. the player color is passed per vertex,
+ * so units of all players share their groups, and textures packed
+ * into the same TextureAtlas page do as well. textures stored with a
+ * palette are drawn with their palette, whether playercolored or not.
+ *
+ * sprites overlap, so the drawing order matters: a sprite is only
+ * moved into an earlier group of its texture if it doesn't overlap any
+ * sprite drawn in between. within a group, sprites keep their order.
+ */
+class SpriteBatch {
+public:
+	SpriteBatch();
+	~SpriteBatch();
+
+	SpriteBatch(const SpriteBatch &) = delete;
+	SpriteBatch &operator =(const SpriteBatch &) = delete;
+
+	/**
+	 * make this the active batch, Texture::draw records into it.
+	 */
+	void begin();
+
+	/**
+	 * draw all recorded sprites and deactivate the batch.
+	 */
+	void end();
+
+	/**
+	 * record a sprite, drawn at the next flush.
+	 */
+	void add(const Texture *tex, coord::pixel_t x, coord::pixel_t y,
+	         unsigned int mode, bool mirrored, int subid, unsigned player);
+
+	/**
+	 * submit all recorded sprites as one render command. has to be
+	 * called before anything else is drawn while the batch is active,
+	 * to keep the drawing order.
+	 */
+	void flush();
+
+	/**
+	 * number of draw calls the last drawn flush needed.
+	 */
+	size_t get_draw_calls() const;
+
+	/**
+	 * the batch between begin and end, or nullptr.
+	 */
+	static SpriteBatch *get_active();
+
+	/**
+	 * flush the active batch, if any.
+	 * for code that draws without textures during a batch.
+	 */
+	static void flush_active();
+
+private:
+	/**
+	 * a run of quads drawn with one call.
+	 */
+	struct group {
+		GLuint texture_id;
+
+		// 0 if the texture has colors
+		GLuint palette_id;
+		bool playercolored;
+
+		// bounding box of the group's sprites
+		GLfloat left, right, bottom, top;
+
+		size_t first_quad;
+		size_t quad_count;
+	};
+
+	/**
+	 * issue the gl calls for the recorded sprites.
+	 * run with the commands of the frame, by the thread drawing it.
+	 */
+	void draw(const std::vector<sprite_record> &records);
+
+	/**
+	 * sort the records into groups, fill the vertex data.
+	 */
+	void build_groups(const std::vector<sprite_record> &records);
+
+	/**
+	 * make sure the index buffer addresses at least quad_count quads.
+	 */
+	void reserve_indices(size_t quad_count);
+
+	std::vector<sprite_record> records;
+
+	/**
+	 * group index of each record.
+	 */
+	std::vector<size_t> record_group;
+
+	std::vector<group> groups;
+	std::vector<sprite_vertex> vertices;
+
+	GLuint vertbuf;
+	GLuint index_buffer;
+	size_t index_capacity;
+
+	std::atomic<size_t> draw_calls;
+
+	static SpriteBatch *active;
+};
+
+} // namespace openage
@@ -0,0 +1,283 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "chunk_streamer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "../error/error.h"
+#include "../job/job_manager.h"
+#include "../log/log.h"
+#include "terrain_chunk.h"
+
+namespace openage {
+
+namespace {
+
+void write_varint(uint64_t value, std::string &out) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+uint64_t read_varint(const std::string &data, size_t &pos) {
+	uint64_t value = 0;
+	for (unsigned int shift = 0; shift < 64; shift += 7) {
+		if (pos >= data.size()) {
+			throw Error(MSG(err) << "Stored chunk ends within a number.");
+		}
+		uint8_t byte = static_cast<uint8_t>(data[pos++]);
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+	throw Error(MSG(err) << "Stored chunk has a number that is too long.");
+}
+
+} // anonymous namespace
+
+
+std::string encode_chunk_ids(const std::vector<terrain_t> &ids) {
+	std::vector<terrain_t> palette;
+	std::vector<std::pair<size_t, size_t>> runs;
+
+	for (terrain_t id : ids) {
+		if (not runs.empty() and palette[runs.back().first] == id) {
+			runs.back().second += 1;
+			continue;
+		}
+
+		auto it = std::find(std::begin(palette), std::end(palette), id);
+		runs.emplace_back(it - std::begin(palette), 1);
+		if (it == std::end(palette)) {
+			palette.push_back(id);
+		}
+	}
+
+	std::string out;
+	write_varint(palette.size(), out);
+	for (terrain_t id : palette) {
+		// ids are small, but may be -1
+		write_varint(static_cast<uint64_t>(static_cast<int64_t>(id) + 1), out);
+	}
+	write_varint(runs.size(), out);
+	for (auto &run : runs) {
+		write_varint(run.first, out);
+		write_varint(run.second, out);
+	}
+	return out;
+}
+
+
+std::vector<terrain_t> decode_chunk_ids(const std::string &data) {
+	size_t pos = 0;
+
+	std::vector<terrain_t> palette(read_varint(data, pos));
+	for (auto &id : palette) {
+		id = static_cast<terrain_t>(static_cast<int64_t>(read_varint(data, pos)) - 1);
+	}
+
+	std::vector<terrain_t> ids;
+	uint64_t run_count = read_varint(data, pos);
+	for (uint64_t i = 0; i < run_count; i++) {
+		uint64_t index = read_varint(data, pos);
+		uint64_t length = read_varint(data, pos);
+		if (index >= palette.size() or ids.size() + length > chunk_size * chunk_size) {
+			throw Error(MSG(err) << "Stored chunk has an invalid run.");
+		}
+		ids.insert(std::end(ids), length, palette[index]);
+	}
+
+	if (ids.size() != chunk_size * chunk_size) {
+		throw Error(MSG(err) << "Stored chunk has " << ids.size() << " tiles.");
+	}
+	return ids;
+}
+
+
+ChunkStreamer::ChunkStreamer(Terrain *terrain)
+	:
+	terrain{terrain},
+	job_manager{nullptr},
+	keep_radius{12},
+	load_radius{10},
+	has_view{false},
+	view{0, 0} {}
+
+
+ChunkStreamer::~ChunkStreamer() {
+	// the jobs only use their copy of the stored data
+	for (auto &load : this->loading) {
+		if (not load.second.is_finished()) {
+			log::log(MSG(dbg) << "Chunk (" << load.first.ne << ", " << load.first.se << ") "
+			         "is still loading");
+		}
+	}
+}
+
+
+void ChunkStreamer::set_job_manager(job::JobManager *job_manager) {
+	this->job_manager = job_manager;
+}
+
+
+void ChunkStreamer::set_radius(int keep_radius, int load_radius) {
+	ENSURE(keep_radius >= load_radius, "chunks would be stored right after loading");
+	this->keep_radius = keep_radius;
+	this->load_radius = load_radius;
+}
+
+
+void ChunkStreamer::set_view(coord::chunk position) {
+	this->has_view = true;
+	this->view = position;
+}
+
+
+size_t ChunkStreamer::update(const std::vector<coord::chunk> &focus) {
+	// the chunks that finished loading
+	for (auto it = std::begin(this->loading); it != std::end(this->loading);) {
+		if (not it->second.is_finished()) {
+			++it;
+			continue;
+		}
+
+		coord::chunk position = it->first;
+		std::vector<terrain_t> ids = it->second.get_result();
+		it = this->loading.erase(it);
+
+		// it may have been restored meanwhile
+		if (this->stored.erase(position) > 0) {
+			this->attach(position, ids);
+		}
+	}
+
+	// the chunks that are far away
+	size_t count = 0;
+	for (coord::chunk &position : this->terrain->used_chunks()) {
+		if (this->in_range(position, focus, this->keep_radius)) {
+			continue;
+		}
+
+		TerrainChunk *chunk = this->terrain->get_chunk(position);
+
+		// chunks of others, or chunks that are in use
+		if (chunk->manually_created or not chunk->get_drawables().empty() or
+		    std::any_of(std::begin(chunk->occupied), std::end(chunk->occupied),
+		                [](uint64_t bits) { return bits != 0; })) {
+			continue;
+		}
+
+		std::vector<terrain_t> ids(chunk->tile_count);
+		for (size_t p = 0; p < chunk->tile_count; p++) {
+			ids[p] = chunk->get_terrain_id(p);
+		}
+		this->stored[position] = encode_chunk_ids(ids);
+
+		this->terrain->detach_chunk(position);
+		delete chunk;
+		count += 1;
+	}
+
+	// the stored chunks that came near
+	std::vector<coord::chunk> near;
+	for (auto &entry : this->stored) {
+		if (this->loading.count(entry.first) == 0 and
+		    this->in_range(entry.first, focus, this->load_radius)) {
+			near.push_back(entry.first);
+		}
+	}
+
+	for (coord::chunk &position : near) {
+		if (this->job_manager == nullptr) {
+			this->restore(position);
+			continue;
+		}
+
+		std::string data = this->stored[position];
+		this->loading.emplace(position, this->job_manager->enqueue<std::vector<terrain_t>>(
+			[data]() -> std::vector<terrain_t> {
+				return decode_chunk_ids(data);
+			}
+		));
+	}
+
+	return count;
+}
+
+
+TerrainChunk *ChunkStreamer::restore(coord::chunk position) {
+	auto it = this->stored.find(position);
+	if (it == std::end(this->stored)) {
+		return nullptr;
+	}
+
+	std::vector<terrain_t> ids = decode_chunk_ids(it->second);
+	this->stored.erase(it);
+
+	// a job that loads it is ignored when it finishes
+	return this->attach(position, ids);
+}
+
+
+bool ChunkStreamer::is_stored(coord::chunk position) const {
+	return this->stored.count(position) > 0;
+}
+
+
+std::vector<coord::chunk> ChunkStreamer::stored_chunks() const {
+	std::vector<coord::chunk> result;
+	result.reserve(this->stored.size());
+	for (auto &entry : this->stored) {
+		result.push_back(entry.first);
+	}
+	return result;
+}
+
+
+std::vector<terrain_t> ChunkStreamer::get_stored_ids(coord::chunk position) const {
+	auto it = this->stored.find(position);
+	if (it == std::end(this->stored)) {
+		throw Error(MSG(err) << "Chunk (" << position.ne << ", " << position.se << ") is not stored.");
+	}
+	return decode_chunk_ids(it->second);
+}
+
+
+size_t ChunkStreamer::memory_used() const {
+	size_t bytes = 0;
+	for (auto &entry : this->stored) {
+		bytes += sizeof(entry) + entry.second.capacity();
+	}
+	return bytes;
+}
+
+
+bool ChunkStreamer::in_range(coord::chunk position, const std::vector<coord::chunk> &focus, int radius) const {
+	auto near = [&](coord::chunk center) {
+		return std::abs(position.ne - center.ne) <= radius and
+		       std::abs(position.se - center.se) <= radius;
+	};
+
+	if (this->has_view and near(this->view)) {
+		return true;
+	}
+	return std::any_of(std::begin(focus), std::end(focus), near);
+}
+
+
+TerrainChunk *ChunkStreamer::attach(coord::chunk position, const std::vector<terrain_t> &ids) {
+	TerrainChunk *chunk = new TerrainChunk();
+	for (size_t p = 0; p < chunk->tile_count; p++) {
+		chunk->get_data(p)->terrain_id = ids[p];
+	}
+
+	// the terrain deletes it, like the chunks it creates
+	this->terrain->attach_chunk(chunk, position, false);
+	return chunk;
+}
+
+} // openage
@@ -0,0 +1,138 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../job/job.h"
+#include "terrain.h"
+
+namespace openage {
+
+namespace job {
+class JobManager;
+} // namespace job
+
+class TerrainChunk;
+
+
+/**
+ * the terrain ids of a chunk as palette and runs of equal ids.
+ * chunks are mostly made of a few large areas, so this is small.
+ */
+std::string encode_chunk_ids(const std::vector<terrain_t> &ids);
+
+/**
+ * the terrain ids of an encoded chunk, throws if the data is invalid.
+ */
+std::vector<terrain_t> decode_chunk_ids(const std::string &data);
+
+
+/**
+ * Keeps only the chunks of an infinite terrain loaded that are near the
+ * view or near units.
+ *
+ * Chunks without objects that are further than keep_radius chunks away
+ * from all of them are encoded to a store and removed from the terrain.
+ * Stored chunks that come within load_radius are decoded by a job and
+ * attached again. Referencing a stored chunk with get_create_chunk
+ * restores it at once.
+ *
+ * The terrain then only has the chunks around the view and the units,
+ * the rest takes a few bytes per chunk. Stored chunks are missing for
+ * path searches, so far away units may not find paths through them.
+ */
+class ChunkStreamer {
+public:
+	explicit ChunkStreamer(Terrain *terrain);
+	~ChunkStreamer();
+
+	ChunkStreamer(const ChunkStreamer &) = delete;
+	ChunkStreamer &operator =(const ChunkStreamer &) = delete;
+
+	/**
+	 * the workers that decode the chunks, nullptr decodes them
+	 * in update().
+	 */
+	void set_job_manager(job::JobManager *job_manager);
+
+	/**
+	 * chunks within keep_radius of the view or a unit are not stored,
+	 * stored chunks within load_radius are loaded.
+	 * keep_radius must not be smaller than load_radius.
+	 */
+	void set_radius(int keep_radius, int load_radius);
+
+	/**
+	 * the chunk the view is centered on.
+	 */
+	void set_view(coord::chunk position);
+
+	/**
+	 * attaches the chunks that finished loading, stores the chunks that
+	 * are far from the view and all units, and starts loading the stored
+	 * chunks that came near. must run between ticks.
+	 *
+	 * @param focus: the chunks of the units
+	 * @returns the number of chunks that were stored
+	 */
+	size_t update(const std::vector<coord::chunk> &focus);
+
+	/**
+	 * loads a stored chunk at once.
+	 * @returns the chunk, nullptr if it is not stored
+	 */
+	TerrainChunk *restore(coord::chunk position);
+
+	bool is_stored(coord::chunk position) const;
+
+	/**
+	 * the positions of the stored chunks.
+	 */
+	std::vector<coord::chunk> stored_chunks() const;
+
+	/**
+	 * the terrain ids of a stored chunk, in storage order.
+	 */
+	std::vector<terrain_t> get_stored_ids(coord::chunk position) const;
+
+	/**
+	 * the bytes used by the stored chunks.
+	 */
+	size_t memory_used() const;
+
+private:
+	/**
+	 * whether the position is within the radius of the view or a focus.
+	 */
+	bool in_range(coord::chunk position, const std::vector<coord::chunk> &focus, int radius) const;
+
+	/**
+	 * attaches a chunk with the given ids to the terrain.
+	 */
+	TerrainChunk *attach(coord::chunk position, const std::vector<terrain_t> &ids);
+
+	Terrain *terrain;
+	job::JobManager *job_manager;
+
+	int keep_radius;
+	int load_radius;
+
+	bool has_view;
+	coord::chunk view;
+
+	/**
+	 * the encoded terrain ids of the stored chunks.
+	 */
+	std::unordered_map<coord::chunk, std::string, coord_chunk_hash> stored;
+
+	/**
+	 * the chunks that are decoded by jobs.
+	 */
+	std::unordered_map<coord::chunk, job::Job<std::vector<terrain_t>>, coord_chunk_hash> loading;
+};
+
+} // openage
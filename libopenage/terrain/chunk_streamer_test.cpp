@@ -0,0 +1,40 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "chunk_streamer.h"
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+#include "terrain_chunk.h"
+
+namespace openage {
+namespace terrain {
+namespace tests {
+
+
+// exported test
+void chunk_encoding() {
+	std::vector<terrain_t> ids(chunk_size * chunk_size, 2);
+
+	// a lake and a missing corner
+	for (size_t row = 4; row < 8; row++) {
+		for (size_t col = 3; col < 9; col++) {
+			ids[row * chunk_size + col] = 7;
+		}
+	}
+	ids[0] = -1;
+
+	std::string data = encode_chunk_ids(ids);
+	(decode_chunk_ids(data) == ids) or TESTFAIL;
+
+	// one byte per run and palette entry
+	data.size() < 40 or TESTFAILMSG("chunk was encoded to " << data.size() << " bytes");
+
+	std::vector<terrain_t> same(chunk_size * chunk_size, 0);
+	encode_chunk_ids(same).size() < 8 or TESTFAIL;
+
+	TESTTHROWS(decode_chunk_ids(data.substr(0, data.size() - 1)));
+	TESTTHROWS(decode_chunk_ids(encode_chunk_ids({1, 2, 3})));
+}
+
+
+}}} // openage::terrain::tests
@@ -0,0 +1,197 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "placement_grid.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "../error/error.h"
+
+namespace openage {
+
+PlacementGrid::PlacementGrid(coord::tile_t radius, free_func is_free)
+	:
+	radius{radius},
+	is_free{std::move(is_free)},
+	foundation{1, 1},
+	center{0, 0},
+	valid{false},
+	width{0},
+	height{0},
+	sums_dirty{true},
+	tests{0} {
+
+	ENSURE(radius >= 0, "placement grid radius must not be negative");
+}
+
+
+void PlacementGrid::set_foundation(coord::tile_delta size) {
+	size.ne = std::max<coord::tile_t>(size.ne, 1);
+	size.se = std::max<coord::tile_t>(size.se, 1);
+
+	if (size.ne != this->foundation.ne or size.se != this->foundation.se) {
+		this->foundation = size;
+		this->valid = false;
+	}
+}
+
+
+void PlacementGrid::set_center(coord::tile center) {
+	if (center == this->center) {
+		return;
+	}
+
+	coord::tile old_start = this->region_start();
+	this->center = center;
+
+	if (not this->valid) {
+		return;
+	}
+
+	// keep the tiles that are in both areas
+	std::vector<uint8_t> old_blocked;
+	old_blocked.swap(this->blocked);
+	this->blocked.resize(old_blocked.size());
+
+	coord::tile start = this->region_start();
+	for (coord::tile_t se = 0; se < this->height; se++) {
+		for (coord::tile_t ne = 0; ne < this->width; ne++) {
+			coord::tile_t old_ne = start.ne + ne - old_start.ne;
+			coord::tile_t old_se = start.se + se - old_start.se;
+
+			if (old_ne >= 0 and old_ne < this->width and
+			    old_se >= 0 and old_se < this->height) {
+				this->blocked[se * this->width + ne] = old_blocked[old_se * this->width + old_ne];
+			}
+			else {
+				this->test(ne, se);
+			}
+		}
+	}
+
+	this->sums_dirty = true;
+}
+
+
+void PlacementGrid::refresh_tile(coord::tile position) {
+	if (not this->valid) {
+		return;
+	}
+
+	coord::tile start = this->region_start();
+	coord::tile_t ne = position.ne - start.ne;
+	coord::tile_t se = position.se - start.se;
+	if (ne < 0 or ne >= this->width or se < 0 or se >= this->height) {
+		return;
+	}
+
+	uint8_t previous = this->blocked[se * this->width + ne];
+	this->test(ne, se);
+	if (this->blocked[se * this->width + ne] != previous) {
+		this->sums_dirty = true;
+	}
+}
+
+
+void PlacementGrid::refresh() {
+	coord::tile_t side = this->region_side();
+	this->width = side + this->foundation.ne - 1;
+	this->height = side + this->foundation.se - 1;
+	this->blocked.assign(this->width * this->height, 0);
+
+	for (coord::tile_t se = 0; se < this->height; se++) {
+		for (coord::tile_t ne = 0; ne < this->width; ne++) {
+			this->test(ne, se);
+		}
+	}
+
+	this->valid = true;
+	this->sums_dirty = true;
+}
+
+
+bool PlacementGrid::fits(coord::tile start) {
+	if (not this->in_region(start)) {
+		for (coord::tile_t se = 0; se < this->foundation.se; se++) {
+			for (coord::tile_t ne = 0; ne < this->foundation.ne; ne++) {
+				this->tests += 1;
+				if (not this->is_free(start + coord::tile_delta{ne, se})) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	if (not this->valid) {
+		this->refresh();
+	}
+	this->update_sums();
+
+	coord::tile region = this->region_start();
+	size_t row = this->width + 1;
+	size_t ne0 = start.ne - region.ne;
+	size_t se0 = start.se - region.se;
+	size_t ne1 = ne0 + this->foundation.ne;
+	size_t se1 = se0 + this->foundation.se;
+
+	uint32_t count = this->sums[se1 * row + ne1] - this->sums[se0 * row + ne1] -
+	                 this->sums[se1 * row + ne0] + this->sums[se0 * row + ne0];
+	return count == 0;
+}
+
+
+bool PlacementGrid::in_region(coord::tile start) const {
+	coord::tile region = this->region_start();
+	coord::tile_t side = this->region_side();
+	return start.ne >= region.ne and start.ne < region.ne + side and
+	       start.se >= region.se and start.se < region.se + side;
+}
+
+
+coord::tile PlacementGrid::region_start() const {
+	return coord::tile{this->center.ne - this->radius, this->center.se - this->radius};
+}
+
+
+coord::tile_t PlacementGrid::region_side() const {
+	return 2 * this->radius + 1;
+}
+
+
+coord::tile_delta PlacementGrid::get_foundation() const {
+	return this->foundation;
+}
+
+
+size_t PlacementGrid::get_tests() const {
+	return this->tests;
+}
+
+
+void PlacementGrid::test(coord::tile_t ne, coord::tile_t se) {
+	this->tests += 1;
+	coord::tile position = this->region_start() + coord::tile_delta{ne, se};
+	this->blocked[se * this->width + ne] = this->is_free(position) ? 0 : 1;
+}
+
+
+void PlacementGrid::update_sums() {
+	if (not this->sums_dirty) {
+		return;
+	}
+
+	size_t row = this->width + 1;
+	this->sums.assign(row * (this->height + 1), 0);
+	for (coord::tile_t se = 0; se < this->height; se++) {
+		uint32_t row_sum = 0;
+		for (coord::tile_t ne = 0; ne < this->width; ne++) {
+			row_sum += this->blocked[se * this->width + ne];
+			this->sums[(se + 1) * row + ne + 1] = this->sums[se * row + ne + 1] + row_sum;
+		}
+	}
+
+	this->sums_dirty = false;
+}
+
+} // namespace openage
@@ -0,0 +1,129 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../coord/tile.h"
+
+namespace openage {
+
+/**
+ * Caches where a building foundation fits in a square region of tiles,
+ * for showing the valid positions while a building is placed.
+ *
+ * Each tile of the region is tested once, and again only when it
+ * changes, e.g. reported by the tile changes of the terrain.
+ * Moving the region tests only the tiles that entered it.
+ * Whether a foundation fits is answered from a table of the blocked
+ * tiles summed up to each tile, so it doesn't depend on the foundation
+ * size. The table is rebuilt when tiles changed.
+ *
+ * The foundation starts at its tile with the lowest ne and se
+ * coordinates, like the tile_range of buildings.
+ */
+class PlacementGrid {
+public:
+	using free_func = std::function<bool(coord::tile)>;
+
+	/**
+	 * @param radius: the foundation start tiles up to this many tiles
+	 *                from the center are cached.
+	 * @param is_free: whether a foundation may cover a tile.
+	 */
+	PlacementGrid(coord::tile_t radius, free_func is_free);
+
+	/**
+	 * the size of the foundation that is placed.
+	 * a different size tests the tiles again.
+	 */
+	void set_foundation(coord::tile_delta size);
+
+	/**
+	 * move the region, the tiles that remain in it keep their state.
+	 */
+	void set_center(coord::tile center);
+
+	/**
+	 * test a tile again, tiles outside the region are ignored.
+	 */
+	void refresh_tile(coord::tile position);
+
+	/**
+	 * test all tiles again.
+	 */
+	void refresh();
+
+	/**
+	 * whether the foundation fits when it starts at the tile.
+	 * starts outside the region are tested directly.
+	 */
+	bool fits(coord::tile start);
+
+	/**
+	 * whether the tile is within the cached foundation starts.
+	 */
+	bool in_region(coord::tile start) const;
+
+	/**
+	 * the cached foundation start with the lowest coordinates.
+	 */
+	coord::tile region_start() const;
+
+	/**
+	 * the number of cached starts along each axis.
+	 */
+	coord::tile_t region_side() const;
+
+	coord::tile_delta get_foundation() const;
+
+	/**
+	 * the number of tile tests since construction.
+	 */
+	size_t get_tests() const;
+
+private:
+	/**
+	 * test the tile at the index of the tested area.
+	 */
+	void test(coord::tile_t ne, coord::tile_t se);
+
+	/**
+	 * sum up the blocked tiles again if tiles changed.
+	 */
+	void update_sums();
+
+	coord::tile_t radius;
+	free_func is_free;
+
+	coord::tile_delta foundation;
+	coord::tile center;
+
+	/**
+	 * whether the tiles were tested for the current foundation.
+	 */
+	bool valid;
+
+	/**
+	 * the tested tiles, the starts and the tiles covered by
+	 * foundations starting at the region border.
+	 * starts at the region start, rows of equal se.
+	 */
+	coord::tile_t width;
+	coord::tile_t height;
+	std::vector<uint8_t> blocked;
+
+	/**
+	 * the blocked tiles with lower or equal ne and se, one row and
+	 * column larger than the tested area, with zeros in front.
+	 */
+	std::vector<uint32_t> sums;
+	bool sums_dirty;
+
+	size_t tests;
+};
+
+} // namespace openage
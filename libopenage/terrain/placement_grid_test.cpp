@@ -0,0 +1,96 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "placement_grid.h"
+
+#include <unordered_set>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace terrain {
+namespace tests {
+
+
+// exported test
+void placement_grid() {
+	std::unordered_set<coord::tile> blocked{{2, 2}, {5, 0}, {-3, 4}};
+	auto is_free = [&blocked](coord::tile position) {
+		return blocked.count(position) == 0;
+	};
+
+	// whether a foundation fits, tested tile by tile
+	auto fits = [&is_free](coord::tile start, coord::tile_delta size) {
+		for (coord::tile_t se = 0; se < size.se; se++) {
+			for (coord::tile_t ne = 0; ne < size.ne; ne++) {
+				if (not is_free(start + coord::tile_delta{ne, se})) {
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	auto check = [&fits](PlacementGrid &grid) {
+		coord::tile start = grid.region_start();
+		coord::tile_t side = grid.region_side();
+		for (coord::tile_t se = -2; se < side + 2; se++) {
+			for (coord::tile_t ne = -2; ne < side + 2; ne++) {
+				coord::tile position = start + coord::tile_delta{ne, se};
+				grid.fits(position) == fits(position, grid.get_foundation()) or TESTFAIL;
+			}
+		}
+	};
+
+	PlacementGrid grid{3, is_free};
+	grid.region_side() == 7 or TESTFAIL;
+	grid.set_foundation(coord::tile_delta{3, 2});
+	grid.set_center(coord::tile{1, 1});
+	grid.region_start() == coord::tile{-2, -2} or TESTFAIL;
+	grid.in_region(coord::tile{4, 4}) or TESTFAIL;
+	grid.in_region(coord::tile{5, 4}) and TESTFAIL;
+	check(grid);
+
+	// the tested area covers the foundations at the border
+	grid.fits(coord::tile{0, 0}) or TESTFAIL;
+	grid.fits(coord::tile{0, 1}) and TESTFAIL;
+	grid.fits(coord::tile{3, 0}) and TESTFAIL;
+
+	// moving the region tests only the new tiles
+	size_t tests = grid.get_tests();
+	grid.set_center(coord::tile{2, 1});
+	grid.get_tests() - tests == 8 or TESTFAIL;
+	check(grid);
+
+	// moving the cursor within a tile tests nothing
+	tests = grid.get_tests();
+	grid.set_center(coord::tile{2, 1});
+	grid.fits(coord::tile{2, 1});
+	grid.get_tests() == tests or TESTFAIL;
+
+	// changed tiles are only seen when refreshed
+	blocked.insert(coord::tile{1, 0});
+	grid.fits(coord::tile{0, 0}) or TESTFAIL;
+	grid.refresh_tile(coord::tile{1, 0});
+	grid.get_tests() - tests == 1 or TESTFAIL;
+	check(grid);
+
+	blocked.erase(coord::tile{2, 2});
+	grid.refresh_tile(coord::tile{2, 2});
+	grid.refresh_tile(coord::tile{100, 100});
+	check(grid);
+
+	// jumping far away keeps nothing
+	grid.set_center(coord::tile{-20, 40});
+	check(grid);
+
+	// another foundation size tests the tiles again
+	grid.set_foundation(coord::tile_delta{1, 4});
+	grid.get_foundation() == coord::tile_delta{1, 4} or TESTFAIL;
+	grid.set_center(coord::tile{-1, 3});
+	check(grid);
+}
+
+
+} // namespace tests
+} // namespace terrain
+} // namespace openage
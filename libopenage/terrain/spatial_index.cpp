@@ -0,0 +1,324 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "../coord/tile3.h"
+#include "../error/error.h"
+#include "../util/misc.h"
+#include "terrain_object.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * how far the edge of an object may be from its center.
+ */
+coord::phys_t object_extent(const TerrainObject &obj) {
+	coord::tile_t ne = std::max<coord::tile_t>(obj.pos.end.ne - obj.pos.start.ne, 1);
+	coord::tile_t se = std::max<coord::tile_t>(obj.pos.end.se - obj.pos.start.se, 1);
+	return static_cast<coord::phys_t>(std::hypot(ne, se) * coord::settings::phys_per_tile / 2);
+}
+
+} // anonymous namespace
+
+
+SpatialIndex::SpatialIndex()
+	:
+	min_cell{0, 0},
+	max_cell{0, 0},
+	max_extent{0},
+	object_count{0},
+	revision{0} {}
+
+
+coord::tile SpatialIndex::cell_of(const coord::phys3 &point) {
+	coord::tile tile = point.to_tile3().to_tile();
+	return {
+		util::div(tile.ne, spatial_cell_size),
+		util::div(tile.se, spatial_cell_size)
+	};
+}
+
+
+void SpatialIndex::insert(TerrainObject *obj) {
+	if (obj->spatial_indexed) {
+		throw Error{MSG(err) << "Object is already in the spatial index."};
+	}
+
+	coord::tile cell = cell_of(obj->pos.draw);
+	cell_content &entry = this->cells[cell];
+	std::vector<TerrainObject *> &content = entry.objects;
+
+	obj->spatial_indexed = true;
+	obj->spatial_cell = cell;
+	obj->spatial_slot = content.size();
+	content.push_back(obj);
+	entry.revision = ++this->revision;
+
+	// grow the covered range of cells
+	if (this->object_count == 0 and this->cells.size() == 1) {
+		this->min_cell = cell;
+		this->max_cell = cell;
+	}
+	else {
+		this->min_cell.ne = std::min(this->min_cell.ne, cell.ne);
+		this->min_cell.se = std::min(this->min_cell.se, cell.se);
+		this->max_cell.ne = std::max(this->max_cell.ne, cell.ne);
+		this->max_cell.se = std::max(this->max_cell.se, cell.se);
+	}
+
+	this->max_extent = std::max(this->max_extent, object_extent(*obj));
+	this->object_count += 1;
+}
+
+
+void SpatialIndex::remove(TerrainObject *obj) {
+	if (not obj->spatial_indexed) {
+		return;
+	}
+
+	auto it = this->cells.find(obj->spatial_cell);
+	if (it == std::end(this->cells) or
+	    obj->spatial_slot >= it->second.objects.size() or
+	    it->second.objects[obj->spatial_slot] != obj) {
+		throw Error{MSG(err) << "Spatial index entry of an object is inconsistent."};
+	}
+
+	// move the last object of the cell into the gap
+	std::vector<TerrainObject *> &content = it->second.objects;
+	TerrainObject *last = content.back();
+	content[obj->spatial_slot] = last;
+	last->spatial_slot = obj->spatial_slot;
+	content.pop_back();
+	it->second.revision = ++this->revision;
+
+	// the empty cell is kept to reuse its storage
+	obj->spatial_indexed = false;
+	this->object_count -= 1;
+}
+
+
+size_t SpatialIndex::size() const {
+	return this->object_count;
+}
+
+
+const std::vector<TerrainObject *> &SpatialIndex::get_objects(const coord::tile &cell) const {
+	static const std::vector<TerrainObject *> no_objects;
+
+	auto it = this->cells.find(cell);
+	if (it == std::end(this->cells)) {
+		return no_objects;
+	}
+	return it->second.objects;
+}
+
+
+uint64_t SpatialIndex::get_revision(const coord::tile &cell) const {
+	auto it = this->cells.find(cell);
+	if (it == std::end(this->cells)) {
+		return 0;
+	}
+	return it->second.revision;
+}
+
+
+template<class V, class B>
+void SpatialIndex::visit_rings(const coord::phys3 &center, V &&visit, B &&bound) const {
+	if (this->object_count == 0) {
+		return;
+	}
+
+	const coord::tile c = cell_of(center);
+	const coord::phys_t cell_length = spatial_cell_size * coord::settings::phys_per_tile;
+
+	// beyond this ring there are no objects
+	coord::tile_t last_ring = std::max({
+		std::abs(c.ne - this->min_cell.ne), std::abs(this->max_cell.ne - c.ne),
+		std::abs(c.se - this->min_cell.se), std::abs(this->max_cell.se - c.se)
+	});
+
+	for (coord::tile_t ring = 0; ring <= last_ring; ring++) {
+
+		// the center may lie at the border of its cell and
+		// objects reach out of their cells by up to max_extent
+		coord::phys_t ring_distance = (ring - 1) * cell_length - this->max_extent;
+		if (ring > 0 and ring_distance > bound()) {
+			return;
+		}
+
+		coord::tile_t se_begin = std::max(c.se - ring, this->min_cell.se);
+		coord::tile_t se_end = std::min(c.se + ring, this->max_cell.se);
+
+		for (coord::tile_t se = se_begin; se <= se_end; se++) {
+
+			// the inner rows of the ring only have their first and last cell
+			bool full_row = (se == c.se - ring or se == c.se + ring);
+			coord::tile_t step = full_row ? 1 : 2 * ring;
+
+			for (coord::tile_t ne = c.ne - ring; ne <= c.ne + ring; ne += step) {
+				if (ne < this->min_cell.ne or ne > this->max_cell.ne) {
+					continue;
+				}
+
+				auto it = this->cells.find(coord::tile{ne, se});
+				if (it == std::end(this->cells)) {
+					continue;
+				}
+
+				for (TerrainObject *obj : it->second.objects) {
+					visit(obj);
+				}
+			}
+		}
+	}
+}
+
+
+TerrainObject *SpatialIndex::find_nearest(const coord::phys3 &center,
+                                          coord::phys_t max_distance,
+                                          const predicate_t &predicate) const {
+	TerrainObject *best = nullptr;
+	coord::phys_t best_distance = max_distance;
+
+	this->visit_rings(
+		center,
+		[&](TerrainObject *obj) {
+			coord::phys_t distance = obj->from_edge(center);
+			if (distance > best_distance or
+			    (best and distance == best_distance)) {
+				return;
+			}
+
+			if (predicate(*obj)) {
+				best = obj;
+				best_distance = distance;
+			}
+		},
+		[&]() {
+			return best_distance;
+		}
+	);
+
+	return best;
+}
+
+
+void SpatialIndex::find_nearest(const coord::phys3 &center,
+                                coord::phys_t max_distance,
+                                const predicate_t &predicate,
+                                size_t count,
+                                std::vector<TerrainObject *> &result) const {
+	result.clear();
+	if (count == 0) {
+		return;
+	}
+
+	// the distance an object must beat to be added
+	auto bound = [&]() {
+		if (result.size() < count) {
+			return max_distance;
+		}
+		return result.back()->from_edge(center);
+	};
+
+	this->visit_rings(
+		center,
+		[&](TerrainObject *obj) {
+			coord::phys_t distance = obj->from_edge(center);
+			if (distance > max_distance or
+			    (result.size() == count and distance >= bound())) {
+				return;
+			}
+
+			if (not predicate(*obj)) {
+				return;
+			}
+
+			if (result.size() == count) {
+				result.pop_back();
+			}
+
+			// keep the result sorted by distance
+			result.push_back(obj);
+			for (size_t i = result.size() - 1; i > 0; i--) {
+				if (result[i - 1]->from_edge(center) <= distance) {
+					break;
+				}
+				std::swap(result[i - 1], result[i]);
+			}
+		},
+		bound
+	);
+}
+
+
+TerrainObject *SpatialIndex::find_overlapping(const tile_range &range,
+                                              const predicate_t &predicate,
+                                              size_t &tested) const {
+	if (this->object_count == 0) {
+		return nullptr;
+	}
+
+	// the centers of the overlapping objects are at most max_extent
+	// outside of the range, plus the rounding of their tiles
+	coord::phys_t max_reach = this->max_extent + coord::settings::phys_per_tile;
+	coord::phys3_delta reach{max_reach, max_reach, 0};
+	coord::tile first = cell_of(range.start.to_tile3().to_phys3({0, 0, 0}) - reach);
+	coord::tile last = cell_of(range.end.to_tile3().to_phys3({0, 0, 0}) + reach);
+
+	first.ne = std::max(first.ne, this->min_cell.ne);
+	first.se = std::max(first.se, this->min_cell.se);
+	last.ne = std::min(last.ne, this->max_cell.ne);
+	last.se = std::min(last.se, this->max_cell.se);
+
+	for (coord::tile_t se = first.se; se <= last.se; se++) {
+		for (coord::tile_t ne = first.ne; ne <= last.ne; ne++) {
+			auto it = this->cells.find(coord::tile{ne, se});
+			if (it == std::end(this->cells)) {
+				continue;
+			}
+
+			for (TerrainObject *obj : it->second.objects) {
+				const tile_range &other = obj->pos;
+				if (other.end.ne <= range.start.ne or range.end.ne <= other.start.ne or
+				    other.end.se <= range.start.se or range.end.se <= other.start.se) {
+					continue;
+				}
+
+				tested += 1;
+				if (predicate(*obj)) {
+					return obj;
+				}
+			}
+		}
+	}
+	return nullptr;
+}
+
+
+void SpatialIndex::find_in_radius(const coord::phys3 &center,
+                                  coord::phys_t radius,
+                                  const predicate_t &predicate,
+                                  std::vector<TerrainObject *> &result) const {
+	result.clear();
+
+	this->visit_rings(
+		center,
+		[&](TerrainObject *obj) {
+			if (obj->from_edge(center) <= radius and predicate(*obj)) {
+				result.push_back(obj);
+			}
+		},
+		[radius]() {
+			return radius;
+		}
+	);
+}
+
+} // namespace openage
@@ -0,0 +1,159 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+
+namespace openage {
+
+class TerrainObject;
+struct tile_range;
+
+/**
+ * edge length of the cells of the spatial index, in tiles.
+ */
+constexpr coord::tile_t spatial_cell_size = 4;
+
+/**
+ * A uniform grid of all objects placed on a terrain.
+ *
+ * Each object is stored in the cell containing its center. Queries visit
+ * the cells in rings around the query point and stop once no cell can
+ * hold a closer object. Distances are measured to the edge of an object,
+ * like TerrainObject::from_edge does.
+ *
+ * The cells keep their storage, so queries and updates of objects
+ * staying in their cell don't allocate memory.
+ */
+class SpatialIndex {
+public:
+	using predicate_t = std::function<bool(const TerrainObject &)>;
+
+	SpatialIndex();
+
+	SpatialIndex(const SpatialIndex &) = delete;
+	SpatialIndex &operator =(const SpatialIndex &) = delete;
+
+	/**
+	 * add an object at its current position,
+	 * called when it is placed on the terrain.
+	 */
+	void insert(TerrainObject *obj);
+
+	/**
+	 * remove an object, called when it is removed from the terrain.
+	 * objects that are not in the index are ignored.
+	 */
+	void remove(TerrainObject *obj);
+
+	/**
+	 * the number of indexed objects.
+	 */
+	size_t size() const;
+
+	/**
+	 * the nearest object which fulfills the predicate.
+	 *
+	 * @param max_distance only objects within this distance are found
+	 * @returns nullptr if there is no such object
+	 */
+	TerrainObject *find_nearest(const coord::phys3 &center,
+	                            coord::phys_t max_distance,
+	                            const predicate_t &predicate) const;
+
+	/**
+	 * the nearest count objects which fulfill the predicate,
+	 * ordered by distance. result is cleared first, reserve its
+	 * capacity to avoid allocations.
+	 *
+	 * @param max_distance only objects within this distance are found
+	 */
+	void find_nearest(const coord::phys3 &center,
+	                  coord::phys_t max_distance,
+	                  const predicate_t &predicate,
+	                  size_t count,
+	                  std::vector<TerrainObject *> &result) const;
+
+	/**
+	 * all objects within the radius which fulfill the predicate,
+	 * in no particular order. result is cleared first.
+	 */
+	void find_in_radius(const coord::phys3 &center,
+	                    coord::phys_t radius,
+	                    const predicate_t &predicate,
+	                    std::vector<TerrainObject *> &result) const;
+
+	/**
+	 * the first object covering a tile of the range which fulfills
+	 * the predicate, or nullptr. visits only the cells that can hold
+	 * such objects, the broad phase of collision tests.
+	 *
+	 * @param tested incremented for each object given to the predicate
+	 */
+	TerrainObject *find_overlapping(const tile_range &range,
+	                                const predicate_t &predicate,
+	                                size_t &tested) const;
+
+	/**
+	 * the cell containing a point.
+	 */
+	static coord::tile cell_of(const coord::phys3 &point);
+
+	/**
+	 * the objects whose center is in the cell, in no particular order.
+	 */
+	const std::vector<TerrainObject *> &get_objects(const coord::tile &cell) const;
+
+	/**
+	 * changes each time an object enters or leaves the cell,
+	 * 0 for cells that never had objects. users that copy the objects
+	 * of a cell can check it to see whether their copy is still valid.
+	 */
+	uint64_t get_revision(const coord::tile &cell) const;
+
+private:
+	/**
+	 * the objects of a cell.
+	 */
+	struct cell_content {
+		std::vector<TerrainObject *> objects;
+		uint64_t revision;
+	};
+
+	/**
+	 * calls visit for all objects in the cells that may contain objects
+	 * within bound() of the center. bound is checked before each ring
+	 * of cells, so it may shrink while visiting.
+	 */
+	template<class V, class B>
+	void visit_rings(const coord::phys3 &center, V &&visit, B &&bound) const;
+
+	std::unordered_map<coord::tile, cell_content> cells;
+
+	/**
+	 * the range of cells that ever contained objects.
+	 */
+	coord::tile min_cell, max_cell;
+
+	/**
+	 * the largest distance of any object's edge to its center,
+	 * objects can reach this far into the neighbor cells.
+	 */
+	coord::phys_t max_extent;
+
+	size_t object_count;
+
+	/**
+	 * the last revision given to a cell.
+	 */
+	uint64_t revision;
+};
+
+} // namespace openage
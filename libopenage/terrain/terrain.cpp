@@ -1,28 +1,52 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "terrain.h"
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "../log/log.h"
 #include "../error/error.h"
 #include "../engine.h"
+#include "../job/parallel.h"
 #include "../game_renderer.h"
+#include "../sprite_batch.h"
 #include "../coord/camgame.h"
 #include "../coord/chunk.h"
 #include "../coord/tile.h"
 #include "../coord/tile3.h"
+#include "../pathfinding/flow_field.h"
+#include "../pathfinding/hierarchical.h"
+#include "../pathfinding/path_cache.h"
+#include "../render_command_list.h"
+#include "../shape_batch.h"
 #include "../util/dir.h"
 #include "../util/misc.h"
+#include "../util/string_id.h"
 #include "../util/strings.h"
 
+#include "chunk_streamer.h"
 #include "terrain_chunk.h"
+#include "spatial_index.h"
 #include "terrain_object.h"
+#include "terrain_renderer.h"
 
 namespace openage {
 
+namespace {
+
+constexpr util::StringId stage_terrain{"terrain"};
+constexpr util::StringId stage_units{"units"};
+constexpr util::StringId gpu_terrain{"terrain gpu"};
+constexpr util::StringId gpu_units{"units gpu"};
+
+} // anonymous namespace
+
+
 TileContent::TileContent() :
 	terrain_id{0} {
 }
@@ -32,15 +56,48 @@ TileContent::~TileContent() {}
 Terrain::Terrain(terrain_meta *meta, bool is_infinite)
 	:
 	infinite{is_infinite},
-	meta{meta} {
-
-	// TODO:
-	//this->limit_positive =
-	//this->limit_negative =
-
-	// maps chunk position to chunks
-	this->chunks = std::unordered_map<coord::chunk, TerrainChunk *, coord_chunk_hash>{};
-
+	limit_positive{0, 0},
+	limit_negative{0, 0},
+	meta{meta},
+	grid_start{0, 0},
+	grid_origin{0, 0},
+	grid_size_ne{0},
+	grid_size_se{0},
+	renderer{std::make_unique<TerrainRenderer>(this)},
+	sprites{std::make_unique<SpriteBatch>()},
+	decorations{std::make_unique<ShapeBatch>()},
+	drawing_objects{false},
+	path_graph{std::make_unique<path::ChunkGraph>(this)},
+	flow_fields{std::make_unique<path::FlowFieldCache>(this)},
+	path_cache{std::make_unique<path::PathCache>(this)},
+	spatial_index{std::make_unique<SpatialIndex>()},
+	path_service{nullptr},
+	streamer{is_infinite ? std::make_unique<ChunkStreamer>(this) : nullptr},
+	tick{0},
+	tick_fraction{1.0f},
+	collision_queries{0},
+	collision_pair_tests{0},
+	collisions{0} {}
+
+Terrain::Terrain(terrain_meta *meta, coord::tile limit_negative, coord::tile limit_positive)
+	:
+	Terrain{meta, false} {
+
+	ENSURE(limit_negative.ne <= limit_positive.ne and limit_negative.se <= limit_positive.se,
+	       "the limits of a finite terrain are empty");
+
+	this->limit_negative = limit_negative;
+	this->limit_positive = limit_positive;
+
+	// the grid covers all chunks the limits touch
+	coord::chunk first = limit_negative.to_chunk();
+	coord::chunk last = limit_positive.to_chunk();
+	this->grid_start = first;
+	this->grid_origin = first.to_tile(coord::tile_delta{0, 0});
+	this->grid_size_ne = last.ne - first.ne + 1;
+	this->grid_size_se = last.se - first.se + 1;
+	this->grid_chunks.resize(this->grid_size_ne * this->grid_size_se, nullptr);
+	this->grid_data.resize(this->grid_chunks.size(), nullptr);
 }
 
 Terrain::~Terrain() {
@@ -52,6 +109,12 @@ Terrain::~Terrain() {
 			delete chunk.second;
 		}
 	}
+
+	for (TerrainChunk *chunk : this->grid_chunks) {
+		if (chunk != nullptr and chunk->manually_created == false) {
+			delete chunk;
+		}
+	}
 }
 
 std::vector<coord::chunk> Terrain::used_chunks() const {
@@ -59,34 +122,145 @@ std::vector<coord::chunk> Terrain::used_chunks() const {
 	for (auto &c : chunks) {
 		result.push_back(c.first);
 	}
+	for (size_t i = 0; i < this->grid_chunks.size(); i++) {
+		if (this->grid_chunks[i] != nullptr) {
+			result.push_back(coord::chunk{
+				static_cast<coord::chunk_t>(this->grid_start.ne + i % this->grid_size_ne),
+				static_cast<coord::chunk_t>(this->grid_start.se + i / this->grid_size_ne)
+			});
+		}
+	}
 	return result;
 }
 
 bool Terrain::fill(const int *data, coord::tile_delta size) {
-	bool was_cut = false;
+	return this->fill(data, coord::tile{0, 0}, size);
+}
 
-	coord::tile pos = {0, 0};
-	for (; pos.ne < size.ne; pos.ne++) {
-		for (pos.se = 0; pos.se < size.se; pos.se++) {
-			if (this->check_tile(pos) == tile_state::invalid) {
-				was_cut = true;
-				continue;
+bool Terrain::fill(const int *data, coord::tile start, coord::tile_delta size) {
+	if (size.ne <= 0 or size.se <= 0) {
+		return false;
+	}
+
+	// the filled tiles, cut to the terrain limits
+	coord::tile first = start;
+	coord::tile last{start.ne + size.ne - 1, start.se + size.se - 1};
+	if (not this->infinite) {
+		first.ne = std::max(first.ne, this->limit_negative.ne);
+		first.se = std::max(first.se, this->limit_negative.se);
+		last.ne = std::min(last.ne, this->limit_positive.ne);
+		last.se = std::min(last.se, this->limit_positive.se);
+	}
+	bool was_cut = (first.ne != start.ne or first.se != start.se or
+	                last.ne != start.ne + size.ne - 1 or last.se != start.se + size.se - 1);
+	if (first.ne > last.ne or first.se > last.se) {
+		return was_cut;
+	}
+
+	coord::chunk first_chunk = first.to_chunk();
+	coord::chunk last_chunk = last.to_chunk();
+	this->create_chunks(first_chunk, coord::chunk_delta{
+		last_chunk.ne - first_chunk.ne + 1,
+		last_chunk.se - first_chunk.se + 1
+	});
+
+	coord::chunk chunk_pos;
+	for (chunk_pos.se = first_chunk.se; chunk_pos.se <= last_chunk.se; chunk_pos.se++) {
+		for (chunk_pos.ne = first_chunk.ne; chunk_pos.ne <= last_chunk.ne; chunk_pos.ne++) {
+			TerrainChunk *chunk = this->get_chunk(chunk_pos);
+			coord::tile origin = chunk_pos.to_tile(coord::tile_delta{0, 0});
+
+			// the part of the chunk within the filled tiles
+			coord::tile_t ne_begin = std::max(first.ne, origin.ne);
+			coord::tile_t ne_end = std::min<coord::tile_t>(last.ne + 1, origin.ne + chunk_size);
+			coord::tile_t se_begin = std::max(first.se, origin.se);
+			coord::tile_t se_end = std::min<coord::tile_t>(last.se + 1, origin.se + chunk_size);
+
+			// chunks store their tiles in rows along ne
+			for (coord::tile_t se = se_begin; se < se_end; se++) {
+				TileContent *row = chunk->get_data((se - origin.se) * chunk_size);
+				const int *column = data + (se - start.se);
+				for (coord::tile_t ne = ne_begin; ne < ne_end; ne++) {
+					row[ne - origin.ne].terrain_id = column[(ne - start.ne) * size.se];
+				}
 			}
-			int terrain_id = data[pos.ne * size.ne + pos.se];
-			TerrainChunk *chunk = this->get_create_chunk(pos);
-			chunk->get_data(pos)->terrain_id = terrain_id;
 		}
 	}
+
+	for (chunk_pos.se = first_chunk.se; chunk_pos.se <= last_chunk.se; chunk_pos.se++) {
+		for (chunk_pos.ne = first_chunk.ne; chunk_pos.ne <= last_chunk.ne; chunk_pos.ne++) {
+			this->invalidate_chunk(chunk_pos);
+			this->path_graph->invalidate_chunk(chunk_pos);
+		}
+	}
+
 	return was_cut;
 }
 
+void Terrain::create_chunks(coord::chunk start, coord::chunk_delta size) {
+	if (size.ne <= 0 or size.se <= 0) {
+		return;
+	}
+
+	std::vector<coord::chunk> missing;
+	coord::chunk pos;
+	for (pos.se = start.se; pos.se < start.se + size.se; pos.se++) {
+		for (pos.ne = start.ne; pos.ne < start.ne + size.ne; pos.ne++) {
+			if (this->get_chunk(pos) == nullptr and this->store_chunk(pos, nullptr)) {
+				missing.push_back(pos);
+			}
+		}
+	}
+	if (missing.empty()) {
+		return;
+	}
+
+	log::log(MSG(dbg) << "Inserting " << missing.size() << " new chunks at once");
+
+	std::unique_ptr<TerrainChunk[]> block{new TerrainChunk[missing.size()]};
+	if (this->infinite) {
+		this->chunks.reserve(this->chunks.size() + missing.size());
+	}
+	for (size_t i = 0; i < missing.size(); i++) {
+		TerrainChunk *chunk = &block[i];
+		chunk->terrain = this;
+
+		// the block frees the chunks, not the terrain destructor
+		chunk->manually_created = true;
+		this->store_chunk(missing[i], chunk);
+	}
+
+	// link all neighbors once every new chunk is known
+	for (size_t i = 0; i < missing.size(); i++) {
+		TerrainChunk *chunk = &block[i];
+		chunk->neighbors = this->get_chunk_neighbors(missing[i]);
+		for (int n = 0; n < 8; n++) {
+			TerrainChunk *neighbor = chunk->neighbors.neighbor[n];
+			if (neighbor != nullptr) {
+				neighbor->neighbors.neighbor[(n+4) % 8] = chunk;
+
+				// old neighbors now blend with the tiles of the new chunk,
+				// new chunks are completely outdated anyway
+				neighbor->invalidate_draw_data();
+			}
+		}
+		this->update_passability(chunk);
+		this->path_graph->invalidate_chunk(missing[i]);
+	}
+
+	this->chunk_blocks.push_back(std::move(block));
+}
+
 void Terrain::attach_chunk(TerrainChunk *new_chunk,
                            coord::chunk position,
                            bool manually_created) {
+	if (not this->store_chunk(position, new_chunk)) {
+		throw Error(MSG(err) << "Chunk (" << position.ne << ", " << position.se << ") "
+		            "is outside of the finite terrain.");
+	}
 	new_chunk->set_terrain(this);
 	new_chunk->manually_created = manually_created;
 	log::log(MSG(dbg) << "Inserting new chunk at (" << position.ne << "," << position.se << ")");
-	this->chunks[position] = new_chunk;
 
 	struct chunk_neighbors neigh = this->get_chunk_neighbors(position);
 	for (int i = 0; i < 8; i++) {
@@ -105,9 +279,43 @@ void Terrain::attach_chunk(TerrainChunk *new_chunk,
 			log::log(MSG(dbg) << "Neighbor " << i << " not found.");
 		}
 	}
+
+	// the neighbors now blend with the tiles of the new chunk
+	this->invalidate_chunk(position);
+	this->path_graph->invalidate_chunk(position);
 }
 
-TerrainChunk *Terrain::get_chunk(coord::chunk position) {
+void Terrain::detach_chunk(coord::chunk position) {
+	ENSURE(this->infinite, "only chunks of infinite terrains can be detached");
+
+	auto it = this->chunks.find(position);
+	if (it == std::end(this->chunks)) {
+		throw Error(MSG(err) << "Chunk (" << position.ne << ", " << position.se << ") "
+		            "is not attached.");
+	}
+	TerrainChunk *chunk = it->second;
+	this->chunks.erase(it);
+
+	for (int i = 0; i < 8; i++) {
+		TerrainChunk *neighbor = chunk->neighbors.neighbor[i];
+		if (neighbor != nullptr) {
+			neighbor->neighbors.neighbor[(i+4) % 8] = nullptr;
+
+			// the border tiles don't blend with the chunk anymore
+			neighbor->invalidate_draw_data();
+		}
+		chunk->neighbors.neighbor[i] = nullptr;
+	}
+	chunk->set_terrain(nullptr);
+
+	this->path_graph->invalidate_chunk(position);
+}
+
+ChunkStreamer *Terrain::get_streamer() {
+	return this->streamer.get();
+}
+
+TerrainChunk *Terrain::find_chunk(coord::chunk position) {
 	auto iter = this->chunks.find(position);
 
 	if (iter == this->chunks.end()) {
@@ -122,9 +330,36 @@ TerrainChunk *Terrain::get_chunk(coord::tile position) {
 	return this->get_chunk(position.to_chunk());
 }
 
+bool Terrain::store_chunk(coord::chunk position, TerrainChunk *chunk) {
+	if (this->infinite) {
+		if (chunk != nullptr) {
+			this->chunks[position] = chunk;
+		}
+		return true;
+	}
+
+	uint64_t ne = static_cast<uint64_t>(static_cast<int64_t>(position.ne) - this->grid_start.ne);
+	uint64_t se = static_cast<uint64_t>(static_cast<int64_t>(position.se) - this->grid_start.se);
+	if (ne >= this->grid_size_ne or se >= this->grid_size_se) {
+		return false;
+	}
+	if (chunk != nullptr) {
+		size_t index = se * this->grid_size_ne + ne;
+		this->grid_chunks[index] = chunk;
+		this->grid_data[index] = chunk->get_loaded_data();
+	}
+	return true;
+}
+
 TerrainChunk *Terrain::get_create_chunk(coord::chunk position) {
 	TerrainChunk *res = this->get_chunk(position);
+	if (res == nullptr and this->streamer) {
+		res = this->streamer->restore(position);
+	}
 	if (res == nullptr) {
+		if (not this->store_chunk(position, nullptr)) {
+			return nullptr;
+		}
 		res = new TerrainChunk();
 		this->attach_chunk(res, position, false);
 	}
@@ -135,8 +370,8 @@ TerrainChunk *Terrain::get_create_chunk(coord::tile position) {
 	return this->get_create_chunk(position.to_chunk());
 }
 
-TileContent *Terrain::get_data(coord::tile position) {
-	TerrainChunk *c = this->get_chunk(position.to_chunk());
+TileContent *Terrain::find_data(coord::tile position) {
+	TerrainChunk *c = this->find_chunk(position.to_chunk());
 	if (c == nullptr) {
 		return nullptr;
 	} else {
@@ -144,6 +379,251 @@ TileContent *Terrain::get_data(coord::tile position) {
 	}
 }
 
+TileContent *Terrain::get_compressed_data(size_t chunk_index, size_t tile_index) {
+	TerrainChunk *chunk = this->grid_chunks[chunk_index];
+	if (chunk == nullptr) {
+		return nullptr;
+	}
+	return chunk->get_data(tile_index);
+}
+
+terrain_t Terrain::get_terrain_id(coord::tile position) {
+	TerrainChunk *chunk = this->get_chunk(position);
+	if (chunk == nullptr) {
+		return -1;
+	}
+	return chunk->get_terrain_id(TerrainChunk::tile_index(position));
+}
+
+size_t Terrain::compress_idle_chunks(uint64_t idle_ticks) {
+	auto is_idle = [&](TerrainChunk *chunk) {
+		if (chunk->is_compressed()) {
+			return false;
+		}
+		if (chunk->get_last_used_tick() + idle_ticks > this->tick) {
+			return false;
+		}
+
+		// units may walk over from the neighbors soon
+		for (TerrainChunk *neighbor : chunk->neighbors.neighbor) {
+			if (neighbor == nullptr) {
+				continue;
+			}
+			for (auto &bits : neighbor->occupied) {
+				if (bits != 0) {
+					return false;
+				}
+			}
+		}
+		return chunk->compress();
+	};
+
+	size_t count = 0;
+	for (auto &chunk : this->chunks) {
+		if (is_idle(chunk.second)) {
+			count += 1;
+		}
+	}
+
+	for (size_t index = 0; index < this->grid_chunks.size(); index++) {
+		TerrainChunk *chunk = this->grid_chunks[index];
+		if (chunk == nullptr) {
+			continue;
+		}
+		if (is_idle(chunk)) {
+			count += 1;
+		}
+
+		// chunks expanded since the last time are cached again
+		this->grid_data[index] = chunk->get_loaded_data();
+	}
+
+	return count;
+}
+
+size_t Terrain::memory_used() const {
+	size_t bytes = 0;
+	for (auto &chunk : this->chunks) {
+		bytes += chunk.second->memory_used();
+	}
+	for (TerrainChunk *chunk : this->grid_chunks) {
+		if (chunk != nullptr) {
+			bytes += chunk->memory_used();
+		}
+	}
+	return bytes;
+}
+
+void Terrain::set_terrain_id(coord::tile position, terrain_t terrain_id) {
+	TileContent *tc = this->get_data(position);
+	if (tc == nullptr or tc->terrain_id == terrain_id) {
+		return;
+	}
+
+	tc->terrain_id = terrain_id;
+	this->invalidate_tile(position);
+	this->mark_changed(position, tile_change::terrain);
+
+	// the tile may now be passable on other layers
+	this->path_graph->invalidate(position);
+}
+
+void Terrain::invalidate_tile(coord::tile position) {
+	TerrainChunk *chunk = this->get_chunk(position);
+	if (chunk != nullptr) {
+		chunk->invalidate_draw_data(position.get_pos_on_chunk().to_tile());
+
+		size_t pos = TerrainChunk::tile_index(position);
+		terrain_t terrain_id = chunk->get_data(pos)->terrain_id;
+		for (size_t layer = 0; layer < this->passability_layers.size(); layer++) {
+			set_tile(chunk->allowed[layer], pos, this->passability_layers[layer].count(terrain_id) > 0);
+		}
+	}
+
+	// the neighbors blend with this tile,
+	// they may be located on other chunks.
+	for (int i = 0; i < 8; i++) {
+		coord::tile neigh_pos = position + neigh_offsets[i];
+		TerrainChunk *neigh_chunk = this->get_chunk(neigh_pos);
+		if (neigh_chunk != nullptr) {
+			neigh_chunk->invalidate_draw_data(neigh_pos.get_pos_on_chunk().to_tile());
+		}
+	}
+}
+
+void Terrain::invalidate_chunk(coord::chunk position) {
+	TerrainChunk *chunk = this->get_chunk(position);
+	if (chunk != nullptr) {
+		chunk->invalidate_draw_data();
+		this->update_passability(chunk);
+	}
+	this->changes.mark_chunk(position, tile_change::terrain);
+
+	struct chunk_neighbors neigh = this->get_chunk_neighbors(position);
+	for (int i = 0; i < 8; i++) {
+		if (neigh.neighbor[i] != nullptr) {
+			neigh.neighbor[i]->invalidate_draw_data();
+		}
+	}
+}
+
+size_t Terrain::get_passability_layer(const std::unordered_set<terrain_t> &terrains) {
+	for (size_t layer = 0; layer < this->passability_layers.size(); layer++) {
+		if (this->passability_layers[layer] == terrains) {
+			return layer;
+		}
+	}
+
+	if (this->passability_layers.size() >= max_passability_layers) {
+		return no_passability_layer;
+	}
+
+	size_t layer = this->passability_layers.size();
+	this->passability_layers.push_back(terrains);
+
+	auto fill_layer = [&](TerrainChunk *chunk) {
+		for (size_t pos = 0; pos < chunk->tile_count; pos++) {
+			set_tile(chunk->allowed[layer], pos, terrains.count(chunk->get_data(pos)->terrain_id) > 0);
+		}
+	};
+	for (auto &chunk : this->chunks) {
+		fill_layer(chunk.second);
+	}
+	for (TerrainChunk *chunk : this->grid_chunks) {
+		if (chunk != nullptr) {
+			fill_layer(chunk);
+		}
+	}
+	return layer;
+}
+
+void Terrain::update_tile_objects(coord::tile position) {
+	TerrainChunk *chunk = this->get_chunk(position);
+	if (chunk != nullptr) {
+		chunk->update_objects(TerrainChunk::tile_index(position));
+	}
+}
+
+TileChangeLog &Terrain::get_changes() {
+	return this->changes;
+}
+
+void Terrain::update_passability(TerrainChunk *chunk) {
+	for (size_t pos = 0; pos < chunk->tile_count; pos++) {
+		terrain_t terrain_id = chunk->get_data(pos)->terrain_id;
+		for (size_t layer = 0; layer < this->passability_layers.size(); layer++) {
+			set_tile(chunk->allowed[layer], pos, this->passability_layers[layer].count(terrain_id) > 0);
+		}
+		chunk->update_objects(pos);
+	}
+}
+
+path::ChunkGraph &Terrain::get_path_graph() {
+	return *this->path_graph;
+}
+
+path::FlowFieldCache &Terrain::get_flow_fields() {
+	return *this->flow_fields;
+}
+
+path::PathCache &Terrain::get_path_cache() {
+	return *this->path_cache;
+}
+
+SpatialIndex &Terrain::get_spatial_index() {
+	return *this->spatial_index;
+}
+
+ShapeBatch *Terrain::get_decorations() {
+	return this->drawing_objects ? this->decorations.get() : nullptr;
+}
+
+path::PathService *Terrain::get_path_service() {
+	return this->path_service;
+}
+
+void Terrain::set_path_service(path::PathService *service) {
+	this->path_service = service;
+}
+
+void Terrain::next_tick() {
+	this->changes.next_tick(this->tick + 1);
+	this->tick += 1;
+
+	this->collision_queries = 0;
+	this->collision_pair_tests = 0;
+	this->collisions = 0;
+}
+
+uint64_t Terrain::get_tick() const {
+	return this->tick;
+}
+
+void Terrain::set_tick_fraction(float fraction) {
+	this->tick_fraction = fraction;
+}
+
+float Terrain::get_tick_fraction() const {
+	return this->tick_fraction;
+}
+
+void Terrain::count_collision_query(size_t pair_tests, bool collided) {
+	// only totals are read, so the order doesn't matter
+	this->collision_queries.fetch_add(1, std::memory_order_relaxed);
+	this->collision_pair_tests.fetch_add(pair_tests, std::memory_order_relaxed);
+	if (collided) {
+		this->collisions.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+collision_stats Terrain::get_collision_stats() const {
+	return collision_stats{
+		this->collision_queries.load(std::memory_order_relaxed),
+		this->collision_pair_tests.load(std::memory_order_relaxed),
+		this->collisions.load(std::memory_order_relaxed)
+	};
+}
+
 TerrainObject *Terrain::obj_at_point(const coord::phys3 &point) {
 	coord::tile t = point.to_tile3().to_tile();
 	TileContent *tc = this->get_data(t);
@@ -181,6 +661,10 @@ bool Terrain::validate_mask(ssize_t mask_id) {
 	}
 }
 
+size_t Terrain::get_terrain_count() const {
+	return this->meta->terrain_id_count;
+}
+
 int Terrain::priority(terrain_t terrain_id) {
 	this->validate_terrain(terrain_id);
 	return this->meta->terrain_id_priority_map[terrain_id];
@@ -196,11 +680,27 @@ Texture *Terrain::texture(terrain_t terrain_id) {
 	return this->meta->textures[terrain_id];
 }
 
+uint32_t Terrain::map_color(terrain_t terrain_id) {
+	this->validate_terrain(terrain_id);
+	if (static_cast<size_t>(terrain_id) >= this->meta->map_colors.size()) {
+		return 0xff000000;
+	}
+	return this->meta->map_colors[terrain_id];
+}
+
 Texture *Terrain::blending_mask(ssize_t mask_id) {
 	this->validate_mask(mask_id);
 	return this->meta->blending_masks[mask_id];
 }
 
+TextureArray *Terrain::texture_array() {
+	return this->meta->texture_array.get();
+}
+
+TextureArray *Terrain::blending_mask_array() {
+	return this->meta->blending_mask_array.get();
+}
+
 unsigned Terrain::get_subtexture_id(coord::tile pos, unsigned atlas_size) {
 	unsigned result = 0;
 
@@ -287,9 +787,6 @@ bool Terrain::check_tile_position(coord::tile pos) {
 }
 
 void Terrain::draw(Engine *engine, RenderOptions *settings) {
-	// TODO: move this draw invokation to a render manager.
-	//       it can reorder the draw instructions and minimize texture switching.
-
 	// top left, bottom right tile coordinates
 	// that are currently visible in the window
 	coord::tile tl, tr, bl, br;
@@ -308,44 +805,159 @@ void Terrain::draw(Engine *engine, RenderOptions *settings) {
 	bl = wbl.to_camgame().to_phys3(0).to_phys2().to_tile();
 	br = wbr.to_camgame().to_phys3(0).to_phys2().to_tile();
 
-	// main terrain calculation call: get the `terrain_render_data`
-	auto draw_data = this->create_draw_advice(tl, tr, br, bl, settings->terrain_blending.value);
-
-	// TODO: the following loop is totally inefficient and shit.
-	//       it reloads the drawing texture to the gpu FOR EACH TILE!
-	//       nevertheless, currently it works.
+	util::Profiler &profiler = engine->get_profiler();
+	profiler.start_measure(stage_terrain, {0.0, 1.0, 0.0});
 
-	// draw the terrain ground
-	for (auto &tile : draw_data.tiles) {
+	// main terrain calculation call: get the `terrain_render_data`
+	// the changed tiles of the chunks are recalculated on the simulation workers
+	auto draw_data = this->create_draw_advice(tl, tr, br, bl, settings->terrain_blending.value,
+	                                          engine->get_job_manager());
+
+	// draw the terrain ground, batched by texture and chunk.
+	// the renderer runs with the commands of the frame, which keep its data.
+	TerrainRenderer *renderer = this->renderer.get();
+	auto ground = std::make_shared<terrain_render_data>();
+	ground->chunks = std::move(draw_data.chunks);
+	ground->blending = draw_data.blending;
+	ground->prerender_limit = std::max(settings->terrain_chunk_textures.value, 0);
+	profiler.start_gpu_measure(gpu_terrain, {0.0, 0.5, 0.0});
+	RenderCommandList::submit([renderer, ground] {
+		renderer->draw(*ground);
+	});
+	profiler.end_gpu_measure(gpu_terrain);
+
+	profiler.end_measure(stage_terrain);
+	profiler.start_measure(stage_units, {0.0, 1.0, 1.0});
+
+	// the objects are taken from the chunks around the window,
+	// each chunk keeps the objects that stand on it.
+	// their draw keys are taken once, so sorting doesn't visit the objects.
+	object_draw_buffers &buffers = this->draw_buffers;
+	buffers.sorted.clear();
+	for (TerrainChunk *chunk : this->get_visible_chunks(engine->get_coord_data()->window_size)) {
+		for (TerrainObject *object : chunk->get_drawables()) {
+			buffers.sorted.emplace_back(object->get_draw_key(), object);
+		}
+	}
 
-		// iterate over all layers to be drawn
-		for (int i = 0; i < tile.count; i++) {
-			struct tile_data *layer = &tile.data[i];
+	// ordered by the visibility layers
+	auto by_key = [](const auto &a, const auto &b) {
+		return a.first < b.first;
+	};
+	std::sort(std::begin(buffers.sorted), std::end(buffers.sorted), by_key);
 
-			// position, where the tile is drawn
-			coord::tile tile_pos = layer->pos;
+	std::vector<TerrainObject *> &objects = buffers.objects;
+	objects.clear();
+	for (auto &entry : buffers.sorted) {
+		objects.push_back(entry.second);
+	}
 
-			int      mask_id       = layer->mask_id;
-			Texture *texture       = layer->tex;
-			int      subtexture_id = layer->subtexture_id;
-			Texture *mask_texture  = layer->mask_tex;
+	// the positions of all objects and of the ground below them
+	// are converted to camgame at once
+	size_t count = objects.size();
+	for (auto *positions : {&buffers.pos_ne, &buffers.pos_se, &buffers.pos_up}) {
+		positions->resize(count);
+	}
+	buffers.ground_up.assign(count, 0);
+	for (auto *pixels : {&buffers.pos_x, &buffers.pos_y, &buffers.ground_x, &buffers.ground_y}) {
+		pixels->resize(count);
+	}
 
-			texture->draw(tile_pos, ALPHAMASKED, subtexture_id, mask_texture, mask_id);
-		}
+	for (size_t i = 0; i < count; i++) {
+		coord::phys3 pos = objects[i]->get_draw_position();
+		buffers.pos_ne[i] = pos.ne;
+		buffers.pos_se[i] = pos.se;
+		buffers.pos_up[i] = pos.up;
+	}
+	coord::to_camgame(count, buffers.pos_ne.data(), buffers.pos_se.data(), buffers.pos_up.data(),
+	                  buffers.pos_x.data(), buffers.pos_y.data());
+	coord::to_camgame(count, buffers.pos_ne.data(), buffers.pos_se.data(), buffers.ground_up.data(),
+	                  buffers.ground_x.data(), buffers.ground_y.data());
+	for (size_t i = 0; i < count; i++) {
+		objects[i]->set_draw_camgame(coord::camgame{buffers.pos_x[i], buffers.pos_y[i]},
+		                             coord::camgame{buffers.ground_x[i], buffers.ground_y[i]});
 	}
 
 	// TODO: drawing buildings can't be the job of the terrain..
-	// draw the buildings
-	for (auto &object : draw_data.objects) {
+	// draw the buildings, their sprites are batched by texture.
+	profiler.start_gpu_measure(gpu_units, {0.0, 0.5, 0.5});
+	this->sprites->begin();
+	this->drawing_objects = true;
+	for (auto &object : objects) {
 		object->draw();
 	}
+	this->drawing_objects = false;
+
+	// the outlines of all selected objects, with one draw call
+	// and without interrupting the sprite batch for each of them.
+	this->decorations->submit();
+	this->sprites->end();
+	profiler.end_gpu_measure(gpu_units);
+
+	for (auto &object : objects) {
+		object->clear_draw_camgame();
+	}
+
+	profiler.end_measure(stage_units);
+}
+
+util::frame_vector<TerrainChunk *> Terrain::get_visible_chunks(coord::window window_size) {
+	// the window, grown by the reach of the sprites
+	coord::pixel_t left = -object_sprite_reach_side;
+	coord::pixel_t right = window_size.x + object_sprite_reach_side;
+	coord::pixel_t top = -object_sprite_reach_down;
+	coord::pixel_t bottom = window_size.y + object_sprite_reach_up;
+
+	// the tiles at the corners of the grown window
+	coord::tile ab = coord::window{left, top}.to_camgame().to_phys3(0).to_phys2().to_tile();
+	coord::tile cd = coord::window{right, top}.to_camgame().to_phys3(0).to_phys2().to_tile();
+	coord::tile ef = coord::window{right, bottom}.to_camgame().to_phys3(0).to_phys2().to_tile();
+	coord::tile gh = coord::window{left, bottom}.to_camgame().to_phys3(0).to_phys2().to_tile();
+
+	// the chunks of the rhombus around it, as for the ground
+	coord::chunk chunk_min = coord::tile{gh.ne, ab.se}.to_chunk();
+	coord::chunk chunk_max = coord::tile{cd.ne, ef.se}.to_chunk();
+
+	util::frame_vector<TerrainChunk *> result;
+
+	for (coord::chunk chunkpos = chunk_min; chunkpos.ne <= chunk_max.ne; chunkpos.ne++) {
+		for (chunkpos.se = chunk_min.se; chunkpos.se <= chunk_max.se; chunkpos.se++) {
+			TerrainChunk *chunk = this->get_chunk(chunkpos);
+			if (chunk == nullptr or chunk->get_drawables().empty()) {
+				continue;
+			}
+
+			// the rhombus has chunks in its corners that are far from the window
+			coord::pixel_t chunk_left = right, chunk_right = left;
+			coord::pixel_t chunk_top = bottom, chunk_bottom = top;
+			for (coord::tile_delta corner : {coord::tile_delta{0, 0},
+			                                 coord::tile_delta{chunk_size, 0},
+			                                 coord::tile_delta{0, chunk_size},
+			                                 coord::tile_delta{chunk_size, chunk_size}}) {
+				coord::window w = chunkpos.to_tile(corner).to_tile3().to_phys3().to_camgame().to_window();
+				chunk_left = std::min(chunk_left, w.x);
+				chunk_right = std::max(chunk_right, w.x);
+				chunk_top = std::min(chunk_top, w.y);
+				chunk_bottom = std::max(chunk_bottom, w.y);
+			}
+
+			if (chunk_right < left or chunk_left > right or chunk_bottom < top or chunk_top > bottom) {
+				continue;
+			}
+
+			result.push_back(chunk);
+		}
+	}
+
+	return result;
 }
 
 struct terrain_render_data Terrain::create_draw_advice(coord::tile ab,
                                                        coord::tile cd,
                                                        coord::tile ef,
                                                        coord::tile gh,
-                                                       bool blending_enabled) {
+                                                       bool blending_enabled,
+                                                       job::JobManager *jobs) {
 
 	/*
 	 * The passed parameters define the screen corners.
@@ -376,375 +988,88 @@ struct terrain_render_data Terrain::create_draw_advice(coord::tile ab,
 	// procedure: find all the tiles to be drawn
 	// and store them to a tile drawing instruction structure
 	struct terrain_render_data data;
-
-	// vector of tiles to be drawn
-	std::vector<struct tile_draw_data> *tiles = &data.tiles;
-
-	// ordered set of objects on the terrain (buildings.)
-	// it's ordered by the visibility layers.
-	auto objects = &data.objects;
+	data.blending = blending_enabled;
+	data.prerender_limit = 0;
 
 	coord::tile gb = {gh.ne, ab.se};
 	coord::tile cf = {cd.ne, ef.se};
 
-	// hint the vector about the number of tiles it will contain
-	size_t tiles_count = std::abs(cf.ne - gb.ne) * std::abs(cf.se - gb.se);
-	tiles->reserve(tiles_count);
+	// the chunks that intersect the rhombus are drawn completely,
+	// so their render buffers can be kept while the camera moves.
+	coord::chunk chunk_min = gb.to_chunk();
+	coord::chunk chunk_max = cf.to_chunk();
 
-	// sweep the whole rhombus area
-	for (coord::tile tilepos = gb; tilepos.ne <= (ssize_t) cf.ne; tilepos.ne++) {
-		for (tilepos.se = gb.se; tilepos.se <= (ssize_t) cf.se; tilepos.se++) {
+	// hint the vector about the number of chunks it will contain
+	size_t chunks_count = (std::abs(chunk_max.ne - chunk_min.ne) + 1) * (std::abs(chunk_max.se - chunk_min.se) + 1);
+	data.chunks.reserve(chunks_count);
 
-			// get the terrain tile drawing data
-			auto tile = this->create_tile_advice(tilepos, blending_enabled);
-			tiles->push_back(tile);
+	util::frame_vector<TerrainChunk *> chunks;
+	size_t outdated = 0;
 
-			// get the object standing on the tile
-			// TODO: make the terrain independent of objects standing on it.
-			TileContent *tile_content = this->get_data(tilepos);
-			if (tile_content != nullptr) {
-				for (auto obj_item : tile_content->obj) {
-					objects->insert(obj_item);
-				}
+	for (coord::chunk chunkpos = chunk_min; chunkpos.ne <= chunk_max.ne; chunkpos.ne++) {
+		for (chunkpos.se = chunk_min.se; chunkpos.se <= chunk_max.se; chunkpos.se++) {
+			TerrainChunk *chunk = this->get_chunk(chunkpos);
+			if (chunk == nullptr) {
+				continue;
 			}
-		}
-	}
-
-	return data;
-}
-
-
-struct tile_draw_data Terrain::create_tile_advice(coord::tile position, bool blending_enabled) {
-	// this struct will be filled with all tiles and overlays to draw.
-	struct tile_draw_data tile;
-	tile.count = 0;
-
-	TileContent *base_tile_content = this->get_data(position);
-
-	// chunk of this tile does not exist
-	if (base_tile_content == nullptr) {
-		return tile;
-	}
-
-	struct tile_data base_tile_data;
-
-	// the base terrain id of the tile
-	base_tile_data.terrain_id = base_tile_content->terrain_id;
-
-	// the base terrain is not existant.
-	if (base_tile_data.terrain_id < 0) {
-		return tile;
-	}
-
-	this->validate_terrain(base_tile_data.terrain_id);
-
-	base_tile_data.state         = tile_state::existing;
-	base_tile_data.pos           = position;
-	base_tile_data.priority      = this->priority(base_tile_data.terrain_id);
-	base_tile_data.tex           = this->texture(base_tile_data.terrain_id);
-	base_tile_data.subtexture_id = this->get_subtexture_id(position, base_tile_data.tex->atlas_dimensions);
-	base_tile_data.blend_mode    = -1;
-	base_tile_data.mask_tex      = nullptr;
-	base_tile_data.mask_id       = -1;
-
-	tile.data[tile.count] = base_tile_data;
-	tile.count += 1;
-
-	// blendomatic!!111
-	//  see doc/media/blendomatic for the idea behind this.
-	if (blending_enabled) {
 
-		// the neighbors of the base tile
-		struct neighbor_tile neigh_data[8];
+			// the position on screen is taken now, as the camera
+			// may move until the chunk is drawn.
+			data.chunks.emplace_back();
+			data.chunks.back().position = chunkpos;
+			data.chunks.back().origin = chunkpos.to_tile({0, 0}).to_tile3().to_phys3().to_camgame();
+			chunks.push_back(chunk);
 
-		// get all neighbor tiles around position, reset the influence directions.
-		this->get_neighbors(position, neigh_data, this->meta->influences_buf.get());
-
-		// create influence list (direction, priority)
-		// strip and order influences, get the final influence data structure
-		struct influence_group influence_group = this->calculate_influences(
-			&base_tile_data, neigh_data,
-			this->meta->influences_buf.get());
-
-		// create the draw_masks from the calculated influences
-		this->calculate_masks(position, &tile, &influence_group);
-	}
-
-	return tile;
-}
-
-void Terrain::get_neighbors(coord::tile basepos,
-                            neighbor_tile *neigh_data,
-                            influence *influences_by_terrain_id) {
-	// walk over all given neighbor tiles and store them to the influence list,
-	// group them by terrain id.
-
-	for (int neigh_id = 0; neigh_id < 8; neigh_id++) {
-
-		// the current neighbor
-		auto neighbor = &neigh_data[neigh_id];
-
-		// calculate the pos of the neighbor tile
-		coord::tile neigh_pos = basepos + neigh_offsets[neigh_id];
-
-		// get the neighbor data
-		TileContent *neigh_content = this->get_data(neigh_pos);
-
-		// chunk for neighbor or single tile is not existant
-		if (neigh_content == nullptr || neigh_content->terrain_id < 0) {
-			neighbor->state = tile_state::missing;
-		}
-		else {
-			neighbor->terrain_id = neigh_content->terrain_id;
-			neighbor->state      = tile_state::existing;
-			neighbor->priority   = this->priority(neighbor->terrain_id);
-
-			// reset influence directions for this tile
-			influences_by_terrain_id[neighbor->terrain_id].direction = 0;
-		}
-	}
-}
-
-struct influence_group Terrain::calculate_influences(struct tile_data *base_tile,
-                                                     struct neighbor_tile *neigh_data,
-                                                     struct influence *influences_by_terrain_id) {
-	// influences to actually draw (-> maximum 8)
-	struct influence_group influences;
-	influences.count = 0;
-
-	// process adjacent neighbors first,
-	// then add diagonal influences, if no adjacent influence was found
-	constexpr int neigh_id_lookup[] = {1, 3, 5, 7, 0, 2, 4, 6};
-
-	for (int i = 0; i < 8; i++) {
-		// diagonal neighbors: (neigh_id % 2) == 0
-		// adjacent neighbors: (neigh_id % 2) == 1
-
-		int neigh_id = neigh_id_lookup[i];
-		bool is_adjacent_neighbor = neigh_id % 2 == 1;
-		bool is_diagonal_neighbor = not is_adjacent_neighbor;
-
-		// the current neighbor_tile.
-		auto neighbor = &neigh_data[neigh_id];
-
-		// neighbor is nonexistant
-		if (neighbor->state == tile_state::missing) {
-			continue;
-		}
-
-		// neighbor only interesting if it's a different terrain than the base.
-		// if it is the same id, the priorities are equal.
-		// neighbor draws over the base if it's priority is greater.
-		if (neighbor->priority > base_tile->priority) {
-
-			// get influence storage for the neighbor terrain id
-			// to group influences by id
-			auto influence = &influences_by_terrain_id[neighbor->terrain_id];
-
-			// check if diagonal influence is valid
-			if (is_diagonal_neighbor) {
-				// get the adjacent neighbors to the current diagonal
-				// influence
-				//  (a & 0x07) == (a % 8)
-				uint8_t adj_neigh_0 = (neigh_id - 1) & 0x07;
-				uint8_t adj_neigh_1 = (neigh_id + 1) & 0x07;
-
-				uint8_t neigh_mask = (1 << adj_neigh_0) | (1 << adj_neigh_1);
-
-				// the adjacent neigbors are already influencing
-				// the current tile, therefore don't apply the diagonal mask
-				if ((influence->direction & neigh_mask) != 0) {
-					continue;
-				}
-			}
-
-			// this terrain id hasn't had influence so far:
-			// add it to the list of influences.
-			if (influence->direction == 0) {
-				influences.terrain_ids[influences.count] = neighbor->terrain_id;
-				influences.count += 1;
+			if (chunk->is_draw_data_outdated()) {
+				outdated += 1;
 			}
-
-			// as tile i has influence for this priority
-			//  => bit i is set to 1 by 2^i
-			influence->direction |= 1 << neigh_id;
-			influence->priority = neighbor->priority;
-			influence->terrain_id = neighbor->terrain_id;
 		}
 	}
 
-	// influences_by_terrain_id will be merged in the following,
-	// unused terrain ids will be dropped now.
-
-	// shrink the big influence buffer that had entries for all terrains
-	// by copying the possible (max 8) influences to a separate buffer.
-	for (int k = 0; k < influences.count; k++) {
-		int relevant_id    = influences.terrain_ids[k];
-		influences.data[k] = influences_by_terrain_id[relevant_id];
-	}
-
-	// order the influences by their priority
-	for (int k = 1; k < influences.count; k++) {
-		struct influence tmp_influence = influences.data[k];
-
-		int l = k - 1;
-		while (l >= 0 && influences.data[l].priority > tmp_influence.priority) {
-			influences.data[l + 1] = influences.data[l];
-			l -= 1;
+	// get the terrain tile drawing data, only changed tiles are
+	// recalculated. each chunk writes to its own cache, so the chunks
+	// are distributed over the workers when several of them changed,
+	// e.g. when the camera moved to where it wasn't before.
+	job::parallel_for(
+		outdated > 1 ? jobs : nullptr,
+		0, chunks.size(), 1,
+		[&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				struct chunk_draw_data &chunk_data = data.chunks[i];
+				chunk_data.tiles = chunks[i]->get_draw_data(chunk_data.position);
+				chunk_data.terrain_ids = chunks[i]->get_terrain_ids();
+				chunk_data.revision = chunks[i]->get_draw_revision();
+			}
 		}
+	);
 
-		influences.data[l + 1] = tmp_influence;
-	}
-
-	return influences;
+	return data;
 }
 
 
-void Terrain::calculate_masks(coord::tile position,
-                              struct tile_draw_data *tile_data,
-                              struct influence_group *influences) {
-
-	// influences are grouped by terrain id.
-	// the direction member has each bit set to 1 that is an influence from that direction.
-	// create a mask for this direction combination.
+struct tile_data Terrain::create_tile_advice(coord::tile position) {
+	struct tile_data tile;
+	tile.state = tile_state::missing;
 
-	// the base tile is stored at position 0 of the draw_mask
-	terrain_t base_terrain_id = tile_data->data[0].terrain_id;
+	// drawing doesn't expand compressed chunks
+	terrain_t terrain_id = this->get_terrain_id(position);
 
-	// iterate over all neighbors (with different terrain_ids) that have influence
-	for (ssize_t i = 0; i < influences->count; i++) {
+	// chunk of this tile does not exist,
+	// or the terrain is not existant.
+	if (terrain_id < 0) {
+		return tile;
+	}
 
-		// neighbor id of the current influence
-		char direction_bits = influences->data[i].direction;
+	tile.terrain_id = terrain_id;
+	this->validate_terrain(tile.terrain_id);
 
-		// all bits are 0 -> no influence directions stored.
-		//  => no influence can be ignored.
-		if (direction_bits == 0) {
-			continue;
-		}
+	tile.state         = tile_state::existing;
+	tile.pos           = position;
+	tile.priority      = this->priority(tile.terrain_id);
+	tile.tex           = this->texture(tile.terrain_id);
+	tile.subtexture_id = this->get_subtexture_id(position, tile.tex->atlas_dimensions);
 
-		terrain_t neighbor_terrain_id = influences->data[i].terrain_id;
-		int adjacent_mask_id = -1;
-
-		/* neighbor ids:
-		     0
-		   7   1      => 8 neighbors that can have influence on
-		 6   @   2         the mask id selection.
-		   5   3
-		     4
-		*/
-
-		// filter adjacent and diagonal influences    neighbor_id: 76543210
-		uint8_t direction_bits_adjacent = direction_bits & 0xAA; //0b10101010
-		uint8_t direction_bits_diagonal = direction_bits & 0x55; //0b01010101
-
-		switch (direction_bits_adjacent) {
-		case 0x08:  //0b00001000
-			adjacent_mask_id = 0;  //0..3
-			break;
-		case 0x02:  //0b00000010
-			adjacent_mask_id = 4;  //4..7
-			break;
-		case 0x20:  //0b00100000
-			adjacent_mask_id = 8;  //8..11
-			break;
-		case 0x80:  //0b10000000
-			adjacent_mask_id = 12; //12..15
-			break;
-		case 0x22:  //0b00100010
-			adjacent_mask_id = 20;
-			break;
-		case 0x88:  //0b10001000
-			adjacent_mask_id = 21;
-			break;
-		case 0xA0:  //0b10100000
-			adjacent_mask_id = 22;
-			break;
-		case 0x82:  //0b10000010
-			adjacent_mask_id = 23;
-			break;
-		case 0x28:  //0b00101000
-			adjacent_mask_id = 24;
-			break;
-		case 0x0A:  //0b00001010
-			adjacent_mask_id = 25;
-			break;
-		case 0x2A:  //0b00101010
-			adjacent_mask_id = 26;
-			break;
-		case 0xA8:  //0b10101000
-			adjacent_mask_id = 27;
-			break;
-		case 0xA2:  //0b10100010
-			adjacent_mask_id = 28;
-			break;
-		case 0x8A:  //0b10001010
-			adjacent_mask_id = 29;
-			break;
-		case 0xAA:  //0b10101010
-			adjacent_mask_id = 30;
-			break;
-		}
-
-		// if it's the linear adjacent mask, cycle the 4 possible masks.
-		// e.g. long shorelines don't look the same then.
-		//  maskid == 0x08 0x02 0x80 0x20 for that.
-		if (adjacent_mask_id <= 12 && adjacent_mask_id % 4 == 0) {
-			//we have 4 = 2^2 anti redundancy masks, so keep the last 2 bits
-			uint8_t anti_redundancy_offset = (position.ne + position.se) & 0x03;
-			adjacent_mask_id += anti_redundancy_offset;
-		}
-
-		// get the blending mode (the mask selection) for this transition
-		// the mode is dependent on the two meeting terrain types
-		int blend_mode = this->get_blending_mode(base_terrain_id, neighbor_terrain_id);
-
-		// append the mask for the adjacent blending
-		if (adjacent_mask_id >= 0) {
-			struct tile_data *overlay = &tile_data->data[tile_data->count];
-			overlay->pos        = position;
-			overlay->mask_id    = adjacent_mask_id;
-			overlay->blend_mode = blend_mode;
-			overlay->terrain_id = neighbor_terrain_id;
-			overlay->tex        = this->texture(neighbor_terrain_id);
-			overlay->subtexture_id = this->get_subtexture_id(position, overlay->tex->atlas_dimensions);
-			overlay->mask_tex   = this->blending_mask(blend_mode);
-			overlay->state      = tile_state::existing;
-
-			tile_data->count += 1;
-		}
-
-		// append the mask for the diagonal blending
-		if (direction_bits_diagonal > 0) {
-			for (int l = 0; l < 4; l++) {
-				// generate one mask for each influencing diagonal neighbor id.
-				// even if they all have the same terrain_id,
-				// because we don't have combined diagonal influence masks.
-
-				// l == 0: pos = 0b000000001, mask = 18
-				// l == 1: pos = 0b000000100, mask = 16
-				// l == 2: pos = 0b000010000, mask = 17
-				// l == 3: pos = 0b001000000, mask = 19
-
-				int current_direction_bit = 1 << (l*2);
-				constexpr int diag_mask_id_map[4] = {18, 16, 17, 19};
-
-				if (direction_bits_diagonal & current_direction_bit) {
-					struct tile_data *overlay = &tile_data->data[tile_data->count];
-					overlay->pos        = position;
-					overlay->mask_id    = diag_mask_id_map[l];
-					overlay->blend_mode = blend_mode;
-					overlay->terrain_id = neighbor_terrain_id;
-					overlay->tex        = this->texture(neighbor_terrain_id);
-					overlay->subtexture_id = this->get_subtexture_id(position, overlay->tex->atlas_dimensions);
-					overlay->mask_tex   = this->blending_mask(blend_mode);
-					overlay->state      = tile_state::existing;
-
-					tile_data->count += 1;
-				}
-			}
-		}
-	}
+	return tile;
 }
 
 } // namespace openage
@@ -1,27 +1,53 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <stddef.h>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "../assetmanager.h"
 #include "../texture.h"
+#include "../texture_array.h"
 #include "../coord/camgame.h"
 #include "../coord/chunk.h"
+#include "../coord/tile.h"
+#include "../datastructure/flat_hash_map.h"
 #include "../util/dir.h"
+#include "../util/frame_arena.h"
 #include "../util/misc.h"
+#include "tile_changes.h"
+#include "tile_objects.h"
 
 namespace openage {
 
+class ChunkStreamer;
 class Engine;
 class RenderOptions;
+class ShapeBatch;
+class SpatialIndex;
+class SpriteBatch;
 class TerrainChunk;
 class TerrainObject;
+class TerrainRenderer;
+
+namespace job {
+class JobManager;
+} // job
+
+namespace path {
+class ChunkGraph;
+class FlowFieldCache;
+class PathCache;
+class PathService;
+} // namespace path
 
 /**
  * type that for terrain ids.
@@ -52,11 +78,27 @@ class TileContent {
 public:
 	TileContent();
 	~TileContent();
+
+	TileContent(TileContent &&) = default;
+	TileContent &operator =(TileContent &&) = default;
+
 	terrain_t terrain_id;
-	std::vector<TerrainObject *> obj;
+
+	/**
+	 * objects on the tile, one fits without allocating.
+	 */
+	TileObjects obj;
 };
 
 
+/**
+ * how far the sprites of objects reach beyond their draw position, in window pixels.
+ * objects standing up to that far outside of the window are drawn.
+ */
+constexpr coord::pixel_t object_sprite_reach_up = 512;
+constexpr coord::pixel_t object_sprite_reach_down = 64;
+constexpr coord::pixel_t object_sprite_reach_side = 256;
+
 /**
  * coordinate offsets for getting tile neighbors by their id.
  */
@@ -83,37 +125,9 @@ enum class tile_state {
 };
 
 
-/**
- * storage for influences by neighbor tiles.
- */
-struct influence {
-	uint8_t direction;    //!< bitmask for influence directions, bit 0 = neighbor 0, etc.
-	int priority;         //!< the blending priority for this influence
-	terrain_t terrain_id; //!< the terrain id of the influence
-};
-
-/**
- * influences for one tile.
- * as a tile has 8 adjacent and diagonal neighbors,
- * the maximum number of influences is 8.
- */
-struct influence_group {
-	int count;
-	terrain_t terrain_ids[8];
-	struct influence data[8];
-};
-
-/**
- * one influence on another tile.
- */
-struct neighbor_tile {
-	terrain_t terrain_id;
-	tile_state state;
-	int priority;
-};
-
 /**
  * storage data for a single terrain tile.
+ * tiles that aren't drawn have the state tile_state::missing.
  */
 struct tile_data {
 	terrain_t terrain_id;
@@ -121,20 +135,25 @@ struct tile_data {
 	int subtexture_id;
 	Texture *tex;
 	int priority;
-	int mask_id;
-	int blend_mode;
-	Texture *mask_tex;
 	tile_state state;
 };
 
 /**
- * collection of drawing data for a single tile.
- * because of influences, a maximum of 8+1 draws
- * could be requested.
+ * drawing data of one chunk, cached by the chunk itself.
  */
-struct tile_draw_data {
-	ssize_t count;
-	struct tile_data data[9];
+struct chunk_draw_data {
+	coord::chunk position;
+	std::shared_ptr<const tile_data> tiles;  //!< chunk_size * chunk_size tiles, in chunk storage order
+
+	/**
+	 * terrain ids of the tiles of the chunk and the tiles around it,
+	 * chunk_id_grid_size per row, -1 for missing tiles.
+	 * the blending is done from them.
+	 */
+	std::shared_ptr<const std::vector<terrain_t>> terrain_ids;
+
+	size_t revision;                         //!< changes whenever the tiles change
+	coord::camgame origin;                   //!< where the chunk is drawn in this frame
 };
 
 /**
@@ -142,8 +161,14 @@ struct tile_draw_data {
  * this is passed to the renderer and will be drawn on screen.
  */
 struct terrain_render_data {
-	std::vector<struct tile_draw_data> tiles;
-	std::set<TerrainObject *, util::less<TerrainObject *>> objects;
+	std::vector<struct chunk_draw_data> chunks;
+	bool blending;
+
+	/**
+	 * how many chunks the renderer may keep as prerendered textures,
+	 * 0 draws all chunks from their tiles.
+	 */
+	size_t prerender_limit;
 };
 
 /**
@@ -160,7 +185,18 @@ struct terrain_meta {
 	std::unique_ptr<int[]> terrain_id_priority_map;
 	std::unique_ptr<int[]> terrain_id_blendmode_map;
 
-	std::unique_ptr<influence[]> influences_buf;
+	/**
+	 * minimap color of each terrain id, rgba8 as in the texture atlas.
+	 */
+	std::vector<uint32_t> map_colors;
+
+	/**
+	 * the textures and the blending masks packed into texture arrays,
+	 * so the terrain is drawn without binding a texture per terrain type.
+	 * nullptr if not all of them could be packed.
+	 */
+	std::unique_ptr<TextureArray> texture_array;
+	std::unique_ptr<TextureArray> blending_mask_array;
 };
 
 /**
@@ -169,9 +205,35 @@ struct terrain_meta {
  *
  * actually this is just the entrypoint and container for the terrain chunks.
  */
+/**
+ * the collision tests of objects during a simulation tick.
+ */
+struct collision_stats {
+	/**
+	 * searches for an object intersecting a position
+	 */
+	size_t queries;
+
+	/**
+	 * pairs of objects tested for intersection
+	 */
+	size_t pair_tests;
+
+	/**
+	 * searches that found an intersecting object
+	 */
+	size_t collisions;
+};
+
 class Terrain {
 public:
 	Terrain(terrain_meta *meta, bool is_infinite);
+
+	/**
+	 * a finite terrain, whose tiles range from limit_negative to
+	 * limit_positive. its chunks are kept in a dense grid.
+	 */
+	Terrain(terrain_meta *meta, coord::tile limit_negative, coord::tile limit_positive);
 	~Terrain();
 
 	bool infinite; //!< chunks are automagically created as soon as they are referenced
@@ -191,6 +253,26 @@ public:
 	 */
 	bool fill(const int *data, coord::tile_delta size);
 
+	/**
+	 * fill the rectangle of tiles from start to start + size with the
+	 * given terrain_id values, data[ne * size.se + se] for the tile
+	 * start + {ne, se}.
+	 *
+	 * the missing chunks of the rectangle are created at once,
+	 * and each chunk is filled row by row.
+	 *
+	 * @returns whether the data filled on the terrain was cut because of
+	 * the terrains size limit.
+	 */
+	bool fill(const int *data, coord::tile start, coord::tile_delta size);
+
+	/**
+	 * create all missing chunks of the rectangle of chunks from start
+	 * to start + size. they are allocated in one block owned by the
+	 * terrain, and linked with their neighbors in one pass.
+	 */
+	void create_chunks(coord::chunk start, coord::chunk_delta size);
+
 	/**
 	 * Attach a chunk to the terrain, to a given position.
 	 *
@@ -200,12 +282,36 @@ public:
 	 */
 	void attach_chunk(TerrainChunk *new_chunk, coord::chunk position, bool manual=true);
 
+	/**
+	 * remove a chunk from an infinite terrain, without deleting it.
+	 * its neighbors don't link to it anymore.
+	 */
+	void detach_chunk(coord::chunk position);
+
+	/**
+	 * stores the chunks of an infinite terrain that are far away,
+	 * nullptr for finite terrains.
+	 */
+	ChunkStreamer *get_streamer();
+
 	/**
 	 * get a terrain chunk by a given chunk position.
 	 *
 	 * @return the chunk if exists, nullptr else
 	 */
-	TerrainChunk *get_chunk(coord::chunk position);
+	TerrainChunk *get_chunk(coord::chunk position) {
+		if (this->infinite) {
+			return this->find_chunk(position);
+		}
+
+		// unsigned, so positions before the grid are out of range as well
+		uint64_t ne = static_cast<uint64_t>(static_cast<int64_t>(position.ne) - this->grid_start.ne);
+		uint64_t se = static_cast<uint64_t>(static_cast<int64_t>(position.se) - this->grid_start.se);
+		if (ne >= this->grid_size_ne or se >= this->grid_size_se) {
+			return nullptr;
+		}
+		return this->grid_chunks[se * this->grid_size_ne + ne];
+	}
 
 	/**
 	 * get a terrain chunk by a given tile position.
@@ -216,8 +322,10 @@ public:
 
 	/**
 	 * get or create a terrain chunk for a given chunk position.
+	 * stored chunks are restored.
 	 *
-	 * @return the (maybe newly created) chunk
+	 * @return the (maybe newly created) chunk, nullptr if the
+	 * position is outside of a finite terrain
 	 */
 	TerrainChunk *get_create_chunk(coord::chunk position);
 
@@ -233,7 +341,173 @@ public:
 	 *
 	 * the only reason the chunks exist, is because of this data.
 	 */
-	TileContent *get_data(coord::tile position);
+	TileContent *get_data(coord::tile position) {
+		if (this->infinite) {
+			return this->find_data(position);
+		}
+
+		uint64_t ne = static_cast<uint64_t>(position.ne - this->grid_origin.ne);
+		uint64_t se = static_cast<uint64_t>(position.se - this->grid_origin.se);
+		if (ne >= (this->grid_size_ne << coord::settings::tiles_per_chunk_bits) or
+		    se >= (this->grid_size_se << coord::settings::tiles_per_chunk_bits)) {
+			return nullptr;
+		}
+
+		constexpr uint64_t mask = coord::settings::tiles_per_chunk - 1;
+		size_t chunk_index = (se >> coord::settings::tiles_per_chunk_bits) * this->grid_size_ne +
+		                     (ne >> coord::settings::tiles_per_chunk_bits);
+		size_t tile_index = ((se & mask) << coord::settings::tiles_per_chunk_bits) + (ne & mask);
+		TileContent *data = this->grid_data[chunk_index];
+		if (data == nullptr) {
+			return this->get_compressed_data(chunk_index, tile_index);
+		}
+		return &data[tile_index];
+	}
+
+	/**
+	 * the terrain id of a tile, -1 if it doesn't exist.
+	 * unlike get_data, this doesn't expand compressed chunks.
+	 */
+	terrain_t get_terrain_id(coord::tile position);
+
+	/**
+	 * compress the chunks that are far from any activity: chunks without
+	 * objects on them or their neighbors, which were neither drawn nor
+	 * accessed for the given number of ticks. see TerrainChunk::compress.
+	 *
+	 * must run while nothing else accesses the terrain, e.g. between ticks.
+	 *
+	 * @returns the number of chunks that were compressed
+	 */
+	size_t compress_idle_chunks(uint64_t idle_ticks);
+
+	/**
+	 * the memory used by the tiles of all chunks.
+	 */
+	size_t memory_used() const;
+
+	/**
+	 * change the terrain id of an existing tile.
+	 * this keeps the cached drawing data of the tile
+	 * and its neighbors up to date.
+	 */
+	void set_terrain_id(coord::tile position, terrain_t terrain_id);
+
+	/**
+	 * mark the drawing data of a tile and its neighbors as outdated.
+	 * call this when the tile content was modified directly.
+	 */
+	void invalidate_tile(coord::tile position);
+
+	/**
+	 * the tiles whose terrain or objects changed, per tick.
+	 * the minimap recolors only these tiles.
+	 */
+	TileChangeLog &get_changes();
+
+	/**
+	 * note that the terrain or the objects of a tile changed,
+	 * see tile_change for the kinds.
+	 */
+	void mark_changed(coord::tile position, uint8_t kinds) {
+		this->changes.mark(position, kinds);
+	}
+
+	/**
+	 * mark the drawing data of a whole chunk and its neighbors as outdated.
+	 * the passability bits of the chunk are recalculated as well,
+	 * and the chunk is noted as changed.
+	 */
+	void invalidate_chunk(coord::chunk position);
+
+	/**
+	 * the passability layer for objects that may stand on the given
+	 * terrains. each layer stores one bit per tile whether its terrain
+	 * is allowed, so passability checks don't need to look into the set.
+	 * the layer is created on first use and kept up to date afterwards.
+	 *
+	 * @returns the index into TerrainChunk::allowed, or
+	 *          no_passability_layer if all layers are used already.
+	 */
+	size_t get_passability_layer(const std::unordered_set<terrain_t> &terrains);
+
+	static constexpr size_t no_passability_layer = SIZE_MAX;
+
+	/**
+	 * recalculate the object bits of a tile, after objects
+	 * were added to or removed from it, or their state changed.
+	 */
+	void update_tile_objects(coord::tile position);
+
+	/**
+	 * the chunk graph for long distance pathfinding on this terrain.
+	 */
+	path::ChunkGraph &get_path_graph();
+
+	/**
+	 * the flow fields used by large groups of moving units.
+	 */
+	path::FlowFieldCache &get_flow_fields();
+
+	/**
+	 * the paths recently searched by single units.
+	 */
+	path::PathCache &get_path_cache();
+
+	/**
+	 * index to find the objects placed near a point.
+	 */
+	SpatialIndex &get_spatial_index();
+
+	/**
+	 * collects the selection outlines of the objects while they are
+	 * drawn, they are drawn together beneath the sprites.
+	 * nullptr if no objects are drawn at the moment.
+	 */
+	ShapeBatch *get_decorations();
+
+	/**
+	 * the service to run path searches in the background,
+	 * nullptr if searches have to be performed directly.
+	 */
+	path::PathService *get_path_service();
+
+	/**
+	 * set the background path search service, not owned by the terrain.
+	 */
+	void set_path_service(path::PathService *service);
+
+	/**
+	 * called before each simulation tick of the game.
+	 */
+	void next_tick();
+
+	/**
+	 * the number of the current simulation tick.
+	 * objects moved in this tick are drawn between their positions.
+	 */
+	uint64_t get_tick() const;
+
+	/**
+	 * set how far the drawn frame is into the next tick, from 0 to 1.
+	 */
+	void set_tick_fraction(float fraction);
+
+	/**
+	 * the fraction used to interpolate the drawn object positions.
+	 */
+	float get_tick_fraction() const;
+
+	/**
+	 * record a search for intersecting objects, which may run
+	 * in parallel to others.
+	 */
+	void count_collision_query(size_t pair_tests, bool collided);
+
+	/**
+	 * the collision tests since the current tick began.
+	 */
+	collision_stats get_collision_stats() const;
 
 	/**
 	 * an object which contains the given point, null otherwise
@@ -273,7 +547,7 @@ public:
 	 * of the same terrain (like grass-grass) are matching (without blendomatic).
 	 * -> e.g. grass only map.
 	 */
-	unsigned get_subtexture_id(coord::tile pos, unsigned atlas_size);
+	static unsigned get_subtexture_id(coord::tile pos, unsigned atlas_size);
 
 	/**
 	 * checks the creation state and premissions of a given tile position.
@@ -295,6 +569,11 @@ public:
 	 */
 	bool validate_mask(ssize_t mask_id);
 
+	/**
+	 * the number of available terrain ids.
+	 */
+	size_t get_terrain_count() const;
+
 	/**
 	 * return the blending priority for a given terrain id.
 	 */
@@ -310,11 +589,23 @@ public:
 	 */
 	Texture *texture(terrain_t terrain_id);
 
+	/**
+	 * the minimap color of a terrain id.
+	 */
+	uint32_t map_color(terrain_t terrain_id);
+
 	/**
 	 * get the blendomatic mask with the given mask id.
 	 */
 	Texture *blending_mask(ssize_t mask_id);
 
+	/**
+	 * the terrain textures and the blending masks as texture arrays,
+	 * nullptr if they weren't packed.
+	 */
+	TextureArray *texture_array();
+	TextureArray *blending_mask_array();
+
 	/**
 	 * return the blending mode id for two given neighbor ids.
 	 */
@@ -326,76 +617,181 @@ public:
 	 */
 	void draw(Engine *engine, RenderOptions *settings);
 
+	/**
+	 * the chunks from which objects may be visible in the window:
+	 * the chunks that are within the window grown by the largest
+	 * reach of object sprites, see object_sprite_reach_up.
+	 * the list is kept on the frame arena.
+	 */
+	util::frame_vector<TerrainChunk *> get_visible_chunks(coord::window window_size);
+
 	/**
 	 * create the drawing instruction data.
 	 *
 	 * created draw data according to the given tile boundaries.
+	 * all chunks that intersect the area are included completely,
+	 * the tile data is taken from the chunk caches and is only
+	 * recalculated for tiles that changed, for several chunks
+	 * in parallel on the given job manager.
 	 *
 	 *
 	 * @param ab: upper left tile
 	 * @param cd: upper right tile
 	 * @param ef: lower right tile
 	 * @param gh: lower left tile
+	 * @param jobs: the workers, nullptr recalculates on this thread
 	 *
 	 * @returns a drawing instruction struct that contains all information for rendering
 	 */
 	struct terrain_render_data create_draw_advice(coord::tile ab, coord::tile cd,
 	                                              coord::tile ef, coord::tile gh,
-	                                              bool blending_enabled);
+	                                              bool blending_enabled,
+	                                              job::JobManager *jobs=nullptr);
 
 	/**
-	 * create rendering and blending information for a single tile on the terrain.
+	 * create the rendering information for a single tile on the terrain.
+	 * the blending with the neighbors is done by the renderer.
+	 * only reads the terrain, so it may run for several chunks at once.
 	 */
-	struct tile_draw_data create_tile_advice(coord::tile position, bool blending_enabled);
+	struct tile_data create_tile_advice(coord::tile position);
+
+private:
 
 	/**
-	 * gather neighbors of a given base tile.
-	 *
-	 * @param basepos: the base position, around which the neighbors will be fetched
-	 * @param neigh_tiles: the destination buffer where the neighbors will be stored
-	 * @param influences_by_terrain_id: influence buffer that is reset in the same step
+	 * terrain meta data
 	 */
-	void get_neighbors(coord::tile basepos,
-	                   struct neighbor_tile *neigh_tiles,
-	                   struct influence *influences_by_terrain_id);
+	terrain_meta *meta;
 
 	/**
-	 * look at neighbor tiles around the base_tile, and store the influence bits.
-	 *
-	 * @param base_tile: the base tile for which influences are calculated
-	 * @param neigh_tiles: the neigbors of base_tile
-	 * @param influences_by_terrain_id: influences will be stored to this buffer, as bitmasks
-	 * @returns an influence group that describes the maximum 8 possible influences on the base_tile
+	 * maps chunk coordinates to chunks.
 	 */
-	struct influence_group calculate_influences(struct tile_data *base_tile,
-	                                            struct neighbor_tile *neigh_tiles,
-	                                            struct influence *influences_by_terrain_id);
+	datastructure::FlatHashMap<coord::chunk, TerrainChunk *, datastructure::coord_hash> chunks;
 
 	/**
-	 * calculate blending masks for a given tile position.
-	 *
-	 * @param position: the base tile position, for which the masks are calculated
-	 * @param tile_data: the buffer where the created drawing layers will be stored in
-	 * @param influences: the buffer where calculated influences were stored to
+	 * chunks allocated by create_chunks, one block per call.
+	 */
+	std::vector<std::unique_ptr<TerrainChunk[]>> chunk_blocks;
+
+	/**
+	 * the chunks of a finite terrain, which covers whole chunks from
+	 * grid_start, row by row along ne. the tile data of each chunk is
+	 * kept as well, so get_data needs no hash lookup.
 	 *
-	 * @see calculate_influences
+	 * infinite terrains keep their chunks in the map instead.
+	 * the data of compressed chunks is nullptr, and only taken again
+	 * by compress_idle_chunks once they were expanded.
 	 */
-	void calculate_masks(coord::tile position,
-	                     struct tile_draw_data *tile_data,
-	                     struct influence_group *influences);
+	coord::chunk grid_start;
+	coord::tile grid_origin;
+	uint64_t grid_size_ne, grid_size_se;
+	std::vector<TerrainChunk *> grid_chunks;
+	std::vector<TileContent *> grid_data;
 
-private:
+	/**
+	 * the changes of the tiles, recorded while they have subscribers.
+	 */
+	TileChangeLog changes;
 
 	/**
-	 * terrain meta data
+	 * the chunk at the position in the map of an infinite terrain.
 	 */
-	terrain_meta *meta;
+	TerrainChunk *find_chunk(coord::chunk position);
 
 	/**
-	 * maps chunk coordinates to chunks.
+	 * the tile data at the position in the map of an infinite terrain.
+	 */
+	TileContent *find_data(coord::tile position);
+
+	/**
+	 * the tile data of a grid chunk whose data isn't cached
+	 * because it is compressed or missing.
+	 */
+	TileContent *get_compressed_data(size_t chunk_index, size_t tile_index);
+
+	/**
+	 * the allowed terrains of each passability layer.
+	 */
+	std::vector<std::unordered_set<terrain_t>> passability_layers;
+
+	/**
+	 * recalculate all passability bits of a chunk.
+	 */
+	void update_passability(TerrainChunk *chunk);
+
+	/**
+	 * remembers the chunk at the position, a null chunk only
+	 * checks the position.
+	 * @returns false if the position is outside of a finite terrain.
+	 */
+	bool store_chunk(coord::chunk position, TerrainChunk *chunk);
+
+	/**
+	 * batch renderer that keeps the gpu buffers of drawn chunks.
+	 */
+	std::unique_ptr<TerrainRenderer> renderer;
+
+	/**
+	 * collects the sprites of the drawn objects.
 	 */
-	std::unordered_map<coord::chunk, TerrainChunk *, coord_chunk_hash> chunks;
+	std::unique_ptr<SpriteBatch> sprites;
 
+	/**
+	 * the outlines of the drawn objects, see get_decorations.
+	 */
+	std::unique_ptr<ShapeBatch> decorations;
+	bool drawing_objects;
+
+	/**
+	 * the drawn objects and their positions, reused
+	 * by each frame so drawing them doesn't allocate.
+	 */
+	struct object_draw_buffers {
+		/** draw key (see TerrainObject::get_draw_key) and object */
+		std::vector<std::pair<std::pair<coord::phys_t, coord::phys_t>, TerrainObject *>> sorted;
+		std::vector<TerrainObject *> objects;
+		std::vector<coord::phys_t> pos_ne, pos_se, pos_up, ground_up;
+		std::vector<coord::pixel_t> pos_x, pos_y, ground_x, ground_y;
+	} draw_buffers;
+
+	/**
+	 * portal graph of the chunks, updated when obstacles change.
+	 */
+	std::unique_ptr<path::ChunkGraph> path_graph;
+
+	/**
+	 * recently used flow fields for group movement.
+	 */
+	std::unique_ptr<path::FlowFieldCache> flow_fields;
+
+	/**
+	 * recently searched paths, reused by units going the same way.
+	 */
+	std::unique_ptr<path::PathCache> path_cache;
+
+	/**
+	 * all placed objects by position, maintained by the objects.
+	 */
+	std::unique_ptr<SpatialIndex> spatial_index;
+
+	/**
+	 * background path searches, owned by the game.
+	 */
+	path::PathService *path_service;
+
+	/**
+	 * the chunks that were removed because they are far away.
+	 */
+	std::unique_ptr<ChunkStreamer> streamer;
+
+	uint64_t tick;
+	float tick_fraction;
+
+	/**
+	 * counters of the collision tests in the current tick
+	 */
+	std::atomic<size_t> collision_queries;
+	std::atomic<size_t> collision_pair_tests;
+	std::atomic<size_t> collisions;
 };
 
 } // namespace openage
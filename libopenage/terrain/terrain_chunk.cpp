@@ -1,7 +1,9 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "terrain_chunk.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 
 #include "../error/error.h"
@@ -19,21 +21,51 @@
 
 namespace openage {
 
+namespace {
+
+/**
+ * source of draw revisions.
+ * shared by all chunks so a replaced chunk never reuses a revision,
+ * the draw data of several chunks is recalculated in parallel.
+ */
+std::atomic<size_t> next_draw_revision{0};
+
+} // anonymous namespace
+
 
 TerrainChunk::TerrainChunk()
 	:
-	manually_created{true} {
+	terrain{nullptr},
+	manually_created{true},
+	last_used_tick{0},
+	draw_dirty_count{0},
+	draw_revision{0} {
 	this->tile_count = std::pow(chunk_size, 2);
 
 	// the data array for this chunk.
 	// each element describes the tile data.
 	this->data = new TileContent[this->tile_count];
 
+	// the drawing data is calculated on first use.
+	this->draw_data = std::shared_ptr<tile_data>{
+		new tile_data[this->tile_count],
+		std::default_delete<tile_data[]>{}
+	};
+	this->draw_dirty.resize(this->tile_count);
+	this->invalidate_draw_data();
+
 	// initialize all neighbors as nonexistant
 	for (int i = 0; i < 8; i++) {
 		this->neighbors.neighbor[i] = nullptr;
 	}
 
+	// the terrain sets the allowed tiles when the chunk is attached
+	for (auto &mask : this->allowed) {
+		mask.fill(0);
+	}
+	this->occupied.fill(0);
+	this->obstacles.fill(0);
+
 	log::log(MSG(dbg) << "Terrain chunk created: " <<
 		"size=" << chunk_size << ", " <<
 		"tiles=" << this->tile_count);
@@ -41,7 +73,7 @@ TerrainChunk::TerrainChunk()
 
 
 TerrainChunk::~TerrainChunk() {
-	delete[] this->data;
+	delete[] this->data.load();
 }
 
 TileContent *TerrainChunk::get_data(coord::tile pos) {
@@ -49,7 +81,142 @@ TileContent *TerrainChunk::get_data(coord::tile pos) {
 }
 
 TileContent *TerrainChunk::get_data(size_t pos) {
-	return &this->data[pos];
+	TileContent *data = this->data.load(std::memory_order_acquire);
+	if (data == nullptr) {
+		data = this->expand();
+	}
+	return &data[pos];
+}
+
+terrain_t TerrainChunk::get_terrain_id(size_t pos) const {
+	TileContent *data = this->data.load(std::memory_order_acquire);
+	if (data != nullptr) {
+		return data[pos].terrain_id;
+	}
+
+	size_t start = 0;
+	for (auto &run : this->compressed->runs) {
+		start += run[1] + 1;
+		if (pos < start) {
+			return this->compressed->palette[run[0]];
+		}
+	}
+	throw Error(MSG(err) << "Tile " << pos << " is missing in the compressed chunk.");
+}
+
+TileContent *TerrainChunk::get_loaded_data() const {
+	return this->data.load(std::memory_order_acquire);
+}
+
+bool TerrainChunk::compress() {
+	TileContent *data = this->data.load(std::memory_order_acquire);
+	if (data == nullptr) {
+		return true;
+	}
+
+	for (auto &bits : this->occupied) {
+		if (bits != 0) {
+			return false;
+		}
+	}
+	if (not this->drawables.empty()) {
+		return false;
+	}
+
+	auto tiles = std::make_unique<compressed_tiles>();
+	for (size_t pos = 0; pos < this->tile_count; pos++) {
+		terrain_t terrain_id = data[pos].terrain_id;
+
+		auto &runs = tiles->runs;
+		if (not runs.empty() and
+		    tiles->palette[runs.back()[0]] == terrain_id and
+		    runs.back()[1] < UINT8_MAX) {
+			runs.back()[1] += 1;
+			continue;
+		}
+
+		// chunks have at most 256 tiles, so 256 terrain ids
+		auto it = std::find(std::begin(tiles->palette), std::end(tiles->palette), terrain_id);
+		size_t index = it - std::begin(tiles->palette);
+		if (it == std::end(tiles->palette)) {
+			tiles->palette.push_back(terrain_id);
+		}
+		runs.push_back({{static_cast<uint8_t>(index), 0}});
+	}
+	tiles->palette.shrink_to_fit();
+	tiles->runs.shrink_to_fit();
+
+	this->compressed = std::move(tiles);
+	this->data.store(nullptr, std::memory_order_release);
+	delete[] data;
+
+	// drawn again, the chunk is expanded anyway
+	this->draw_data.reset();
+	this->terrain_ids.reset();
+	this->invalidate_draw_data();
+	return true;
+}
+
+bool TerrainChunk::is_compressed() const {
+	return this->data.load(std::memory_order_acquire) == nullptr;
+}
+
+uint64_t TerrainChunk::get_last_used_tick() const {
+	return this->last_used_tick.load(std::memory_order_relaxed);
+}
+
+size_t TerrainChunk::memory_used() const {
+	size_t bytes = 0;
+
+	TileContent *data = this->data.load(std::memory_order_acquire);
+	if (data != nullptr) {
+		bytes += this->tile_count * sizeof(TileContent);
+		for (size_t pos = 0; pos < this->tile_count; pos++) {
+			size_t objects = data[pos].obj.size();
+			if (objects > 1) {
+				bytes += sizeof(std::vector<TerrainObject *>) + objects * sizeof(TerrainObject *);
+			}
+		}
+	}
+
+	if (this->compressed) {
+		bytes += sizeof(compressed_tiles) +
+		         this->compressed->palette.capacity() * sizeof(terrain_t) +
+		         this->compressed->runs.capacity() * sizeof(this->compressed->runs[0]);
+	}
+
+	if (this->draw_data) {
+		bytes += this->tile_count * sizeof(tile_data);
+	}
+	if (this->terrain_ids) {
+		bytes += this->terrain_ids->size() * sizeof(terrain_t);
+	}
+	return bytes;
+}
+
+TileContent *TerrainChunk::expand() {
+	std::lock_guard<std::mutex> lock{this->expand_lock};
+
+	// another thread may have expanded it meanwhile
+	TileContent *data = this->data.load(std::memory_order_acquire);
+	if (data != nullptr) {
+		return data;
+	}
+
+	data = new TileContent[this->tile_count];
+	size_t pos = 0;
+	for (auto &run : this->compressed->runs) {
+		terrain_t terrain_id = this->compressed->palette[run[0]];
+		for (size_t i = 0; i <= run[1]; i++) {
+			data[pos++].terrain_id = terrain_id;
+		}
+	}
+
+	if (this->terrain != nullptr) {
+		this->last_used_tick.store(this->terrain->get_tick(), std::memory_order_relaxed);
+	}
+	this->data.store(data, std::memory_order_release);
+	return data;
 }
 
 TileContent *TerrainChunk::get_data_neigh(coord::tile pos) {
@@ -180,8 +347,121 @@ size_t TerrainChunk::get_size() {
 	return chunk_size;
 }
 
+void TerrainChunk::update_objects(size_t pos) {
+	const auto &objects = this->get_data(pos)->obj;
+
+	bool obstacle = false;
+	for (auto obj : objects) {
+		if (obj->is_static_obstacle()) {
+			obstacle = true;
+			break;
+		}
+	}
+
+	set_tile(this->occupied, pos, not objects.empty());
+	set_tile(this->obstacles, pos, obstacle);
+}
+
 void TerrainChunk::set_terrain(Terrain *parent) {
 	this->terrain = parent;
+	this->invalidate_draw_data();
+}
+
+void TerrainChunk::invalidate_draw_data() {
+	std::fill(std::begin(this->draw_dirty), std::end(this->draw_dirty), true);
+	this->draw_dirty_count = this->tile_count;
+}
+
+void TerrainChunk::invalidate_draw_data(coord::tile pos) {
+	size_t idx = this->tile_position(pos);
+	if (not this->draw_dirty[idx]) {
+		this->draw_dirty[idx] = true;
+		this->draw_dirty_count += 1;
+	}
+}
+
+std::shared_ptr<const tile_data> TerrainChunk::get_draw_data(coord::chunk chunk_pos) {
+	this->last_used_tick.store(this->terrain->get_tick(), std::memory_order_relaxed);
+
+	if (this->draw_dirty_count > 0) {
+		// a recorded frame that was not drawn yet holds the data,
+		// compressed chunks have none
+		if (not this->draw_data) {
+			this->draw_data = std::shared_ptr<tile_data>{
+				new tile_data[this->tile_count],
+				std::default_delete<tile_data[]>{}
+			};
+		}
+		else if (this->draw_data.use_count() > 1) {
+			std::shared_ptr<tile_data> copy{
+				new tile_data[this->tile_count],
+				std::default_delete<tile_data[]>{}
+			};
+			std::copy_n(this->draw_data.get(), this->tile_count, copy.get());
+			this->draw_data = std::move(copy);
+		}
+
+		coord::tile_delta pos_on_chunk;
+		for (pos_on_chunk.se = 0; pos_on_chunk.se < (ssize_t) chunk_size; pos_on_chunk.se++) {
+			for (pos_on_chunk.ne = 0; pos_on_chunk.ne < (ssize_t) chunk_size; pos_on_chunk.ne++) {
+				size_t idx = pos_on_chunk.se * chunk_size + pos_on_chunk.ne;
+				if (this->draw_dirty[idx]) {
+					this->draw_data.get()[idx] = this->terrain->create_tile_advice(
+						chunk_pos.to_tile(pos_on_chunk)
+					);
+					this->draw_dirty[idx] = false;
+				}
+			}
+		}
+
+		// the tiles around the chunk are taken from the neighbors,
+		// their changes invalidate the tiles at the border.
+		auto ids = std::make_shared<std::vector<terrain_t>>(chunk_id_grid_size * chunk_id_grid_size);
+		for (pos_on_chunk.se = -1; pos_on_chunk.se <= (ssize_t) chunk_size; pos_on_chunk.se++) {
+			for (pos_on_chunk.ne = -1; pos_on_chunk.ne <= (ssize_t) chunk_size; pos_on_chunk.ne++) {
+				size_t idx = (pos_on_chunk.se + 1) * chunk_id_grid_size + (pos_on_chunk.ne + 1);
+				(*ids)[idx] = this->terrain->get_terrain_id(chunk_pos.to_tile(pos_on_chunk));
+			}
+		}
+		this->terrain_ids = std::move(ids);
+
+		this->draw_dirty_count = 0;
+		this->draw_revision = ++next_draw_revision;
+	}
+
+	return this->draw_data;
+}
+
+bool TerrainChunk::is_draw_data_outdated() const {
+	return this->draw_dirty_count > 0;
+}
+
+std::shared_ptr<const std::vector<terrain_t>> TerrainChunk::get_terrain_ids() const {
+	return this->terrain_ids;
+}
+
+void TerrainChunk::add_drawable(TerrainObject *obj) {
+	obj->drawn_slot = this->drawables.size();
+	this->drawables.push_back(obj);
+}
+
+void TerrainChunk::remove_drawable(TerrainObject *obj) {
+	ENSURE(obj->drawn_slot < this->drawables.size() and this->drawables[obj->drawn_slot] == obj,
+	       "object is not drawn from this chunk");
+
+	// move the last object into the slot
+	TerrainObject *last = this->drawables.back();
+	this->drawables[obj->drawn_slot] = last;
+	last->drawn_slot = obj->drawn_slot;
+	this->drawables.pop_back();
+}
+
+const std::vector<TerrainObject *> &TerrainChunk::get_drawables() const {
+	return this->drawables;
+}
+
+size_t TerrainChunk::get_draw_revision() const {
+	return this->draw_revision;
 }
 
 } // namespace openage
@@ -1,7 +1,12 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <stddef.h>
 #include <vector>
 
@@ -9,6 +14,7 @@
 #include "../coord/tile.h"
 #include "../texture.h"
 #include "../util/file.h"
+#include "terrain.h"
 
 namespace openage {
 
@@ -23,6 +29,37 @@ the number of tiles per direction on a chunk
 */
 constexpr size_t chunk_size = 16;
 
+/**
+the number of tiles per direction in the terrain id grid of a chunk,
+which includes the tiles around it.
+*/
+constexpr size_t chunk_id_grid_size = chunk_size + 2;
+
+/**
+one bit for each tile of a chunk, in storage order.
+*/
+using tile_mask = std::array<uint64_t, (chunk_size * chunk_size + 63) / 64>;
+
+inline bool test_tile(const tile_mask &mask, size_t pos) {
+	return (mask[pos / 64] >> (pos % 64)) & 1;
+}
+
+inline void set_tile(tile_mask &mask, size_t pos, bool value) {
+	uint64_t bit = uint64_t{1} << (pos % 64);
+	if (value) {
+		mask[pos / 64] |= bit;
+	}
+	else {
+		mask[pos / 64] &= ~bit;
+	}
+}
+
+/**
+the number of passability layers a terrain can have,
+see Terrain::get_passability_layer.
+*/
+constexpr size_t max_passability_layers = 32;
+
 /**
 adjacent neighbors of a chunk.
 
@@ -55,11 +92,6 @@ public:
 	*/
 	size_t tile_count;
 
-	/**
-	 * stores the chunk data, one tile_content struct for each tile.
-	 */
-	TileContent *data;
-
 	/**
 	 * the terrain to which this chunk belongs to.
 	 */
@@ -87,6 +119,42 @@ public:
 	 */
 	TileContent *get_data(size_t pos);
 
+	/**
+	 * the terrain id of a tile by memory position, read from the
+	 * compressed tiles if the chunk is compressed.
+	 */
+	terrain_t get_terrain_id(size_t pos) const;
+
+	/**
+	 * the tile data, nullptr while the chunk is compressed.
+	 */
+	TileContent *get_loaded_data() const;
+
+	/**
+	 * replace the tile data by the compressed terrain ids, and drop the
+	 * drawing data. only chunks without objects can be compressed.
+	 *
+	 * the tiles are expanded again when their data is requested, which
+	 * may happen from several threads. compressing must not overlap
+	 * with any other access to the chunk.
+	 *
+	 * @returns whether the chunk was compressed
+	 */
+	bool compress();
+
+	bool is_compressed() const;
+
+	/**
+	 * the last tick the chunk was drawn or expanded in.
+	 */
+	uint64_t get_last_used_tick() const;
+
+	/**
+	 * the memory used by the tiles of the chunk, including the
+	 * compressed tiles, the object lists and the drawing data.
+	 */
+	size_t memory_used() const;
+
 	/**
 	 * get the tile data a given tile position relative to this chunk.
 	 *
@@ -98,6 +166,14 @@ public:
 
 	size_t tile_position(coord::tile pos);
 	size_t tile_position_neigh(coord::tile pos);
+
+	/**
+	 * storage position of a tile on the chunk that contains it.
+	 */
+	static size_t tile_index(coord::tile pos) {
+		constexpr coord::tile_t mask = chunk_size - 1;
+		return (pos.se & mask) * chunk_size + (pos.ne & mask);
+	}
 	size_t get_tile_count();
 
 	size_t tiles_in_row(unsigned int row);
@@ -105,7 +181,147 @@ public:
 
 	void set_terrain(Terrain *parent);
 
+	/**
+	 * mark the drawing data of all tiles on this chunk as outdated.
+	 */
+	void invalidate_draw_data();
+
+	/**
+	 * mark the drawing data of one tile on this chunk as outdated.
+	 */
+	void invalidate_draw_data(coord::tile pos);
+
+	/**
+	 * return the cached drawing data of all tiles, in storage order.
+	 * outdated tiles are recalculated first, and the terrain id grid
+	 * is taken again.
+	 *
+	 * recorded frames keep the returned data, it is copied
+	 * instead of changed while they hold it.
+	 */
+	std::shared_ptr<const tile_data> get_draw_data(coord::chunk chunk_pos);
+
+	/**
+	 * whether get_draw_data has tiles to recalculate.
+	 */
+	bool is_draw_data_outdated() const;
+
+	/**
+	 * the terrain ids of this chunk and the tiles around it,
+	 * as of the last get_draw_data.
+	 */
+	std::shared_ptr<const std::vector<terrain_t>> get_terrain_ids() const;
+
+	/**
+	 * incremented each time the drawing data changes.
+	 * renderers can compare it to know when to reupload.
+	 */
+	size_t get_draw_revision() const;
+
+	/**
+	 * add an object that stands on a tile of this chunk to the objects drawn from it.
+	 */
+	void add_drawable(TerrainObject *obj);
+
+	/**
+	 * remove an object that was added with add_drawable.
+	 */
+	void remove_drawable(TerrainObject *obj);
+
+	/**
+	 * the objects whose draw position is on this chunk, unordered.
+	 */
+	const std::vector<TerrainObject *> &get_drawables() const;
+
 	bool manually_created;
+
+	/**
+	 * for each passability layer of the terrain,
+	 * the tiles whose terrain the layer allows.
+	 */
+	std::array<tile_mask, max_passability_layers> allowed;
+
+	/**
+	 * the tiles with any objects on them.
+	 */
+	tile_mask occupied;
+
+	/**
+	 * the tiles with static obstacles on them.
+	 */
+	tile_mask obstacles;
+
+	/**
+	 * recalculate the occupied and obstacle bits of a tile
+	 * from its objects.
+	 */
+	void update_objects(size_t pos);
+
+private:
+	/**
+	 * terrain ids of a compressed chunk: the distinct ids, and runs of
+	 * tiles in storage order with the same id, each as palette index
+	 * and run length - 1.
+	 */
+	struct compressed_tiles {
+		std::vector<terrain_t> palette;
+		std::vector<std::array<uint8_t, 2>> runs;
+	};
+
+	/**
+	 * restore the tile data of a compressed chunk.
+	 */
+	TileContent *expand();
+
+	/**
+	 * the chunk data, one tile_content struct for each tile,
+	 * nullptr while the chunk is compressed.
+	 */
+	std::atomic<TileContent *> data;
+
+	/**
+	 * the terrain ids while the chunk is compressed. they are kept after
+	 * expanding, as other threads may still read them, until the chunk
+	 * is compressed again or freed.
+	 */
+	std::unique_ptr<compressed_tiles> compressed;
+
+	/**
+	 * serializes the expansion by several threads.
+	 */
+	std::mutex expand_lock;
+
+	std::atomic<uint64_t> last_used_tick;
+
+	/**
+	 * cached drawing data, one entry for each tile.
+	 */
+	std::shared_ptr<tile_data> draw_data;
+
+	/**
+	 * terrain ids of the id grid, taken with the drawing data.
+	 */
+	std::shared_ptr<const std::vector<terrain_t>> terrain_ids;
+
+	/**
+	 * which entries of draw_data have to be recalculated.
+	 */
+	std::vector<bool> draw_dirty;
+
+	/**
+	 * number of set entries in draw_dirty.
+	 */
+	size_t draw_dirty_count;
+
+	/**
+	 * revision of the current draw_data.
+	 */
+	size_t draw_revision;
+
+	/**
+	 * objects drawn from this chunk, each one stores its slot.
+	 */
+	std::vector<TerrainObject *> drawables;
 };
 
 } // namespace openage
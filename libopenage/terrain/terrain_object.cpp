@@ -1,32 +1,55 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "terrain_object.h"
 
 #include <algorithm>
-#include <cmath>
 
 #include "../engine.h"
 #include "../error/error.h"
-#include "../texture.h"
+#include "../gamestate/player.h"
+#include "../gamestate/visibility_grid.h"
 #include "../coord/tile.h"
 #include "../coord/tile3.h"
 #include "../coord/phys3.h"
 #include "../coord/camgame.h"
+#include "../datastructure/small_vector.h"
+#include "../pathfinding/hierarchical.h"
+#include "../shape_batch.h"
 #include "../unit/unit.h"
+#include "../unit/unit_type.h"
 
+#include "spatial_index.h"
 #include "terrain.h"
 #include "terrain_chunk.h"
 #include "terrain_outline.h"
 
 namespace openage {
 
-TerrainObject::TerrainObject(Unit &u)
+TerrainObject::TerrainObject(Unit &u, object_shape shape)
 	:
 	unit(u),
+	shape{shape},
 	passable{[](const coord::phys3 &) -> bool {return true;}},
+	passability_layer{Terrain::no_passability_layer},
 	draw{[]() {}},
 	state{object_state::removed},
 	occupied_chunk_count{0},
+	spatial_indexed{false},
+	spatial_cell{0, 0},
+	spatial_slot{0},
+	sight_grid{nullptr},
+	sight_tile{0, 0},
+	sight_radius{0},
+	drawn{false},
+	drawn_chunk{0, 0},
+	drawn_slot{0},
+	tick_start_pos{0, 0, 0},
+	moved_tick{0},
+	position_hashed{false},
+	hashed_position{0},
+	draw_camgame_set{false},
+	draw_camgame{0, 0},
+	ground_camgame{0, 0},
 	parent{nullptr} {
 }
 
@@ -65,8 +88,126 @@ bool TerrainObject::check_collisions() const {
 	return this->state == object_state::placed;
 }
 
+bool TerrainObject::is_static_obstacle() const {
+	return this->check_collisions() &&
+	       !this->unit.has_attribute(attr_type::speed);
+}
+
+void TerrainObject::invalidate_path_graph() const {
+	auto terrain = this->get_terrain();
+	if (!terrain) {
+		return;
+	}
+
+	path::ChunkGraph &graph = terrain->get_path_graph();
+	for (coord::tile temp_pos : frame_tile_list(this->pos)) {
+		// the obstacle bits of the tiles change as well
+		terrain->update_tile_objects(temp_pos);
+		graph.invalidate(temp_pos);
+	}
+}
+
+void TerrainObject::mark_changed(const tile_range &range, uint8_t kinds) const {
+	auto terrain = this->get_terrain();
+	if (not terrain or not terrain->get_changes().is_recording()) {
+		return;
+	}
+
+	for (coord::tile temp_pos : frame_tile_list(range)) {
+		terrain->mark_changed(temp_pos, kinds);
+	}
+}
+
+void TerrainObject::hash_position(bool placed) {
+	// annexes are placed relative to their building
+	UnitContainer *container = this->unit.get_container();
+	if (this->parent != nullptr or container == nullptr) {
+		return;
+	}
+
+	StateHash &hash = container->get_state_hash();
+	if (this->position_hashed) {
+		hash.remove(state_part::positions, this->unit.id, this->hashed_position);
+	}
+
+	this->position_hashed = placed;
+	if (placed) {
+		const coord::phys3 &position = this->pos.draw;
+		this->hashed_position = ((static_cast<uint64_t>(position.ne) * 0x9e3779b97f4a7c15ull)
+		                         ^ static_cast<uint64_t>(position.se)) * 0xc2b2ae3d27d4eb4full
+		                        + static_cast<uint64_t>(position.up);
+		hash.add(state_part::positions, this->unit.id, this->hashed_position);
+	}
+}
+
 void TerrainObject::draw_outline() const {
-	this->outline_texture->draw(this->pos.draw.to_camgame());
+	// collected with the other outlines while the terrain draws its objects
+	auto terrain = this->get_terrain();
+	ShapeBatch *decorations = terrain ? terrain->get_decorations() : nullptr;
+	if (decorations != nullptr) {
+		this->add_outline(*decorations, this->get_draw_camgame());
+		return;
+	}
+
+	ShapeBatch shapes;
+	this->add_outline(shapes, this->get_draw_camgame());
+	shapes.submit();
+}
+
+coord::phys3 TerrainObject::get_draw_position() const {
+	auto terrain = this->get_terrain();
+	if (not terrain or this->moved_tick != terrain->get_tick()) {
+		return this->pos.draw;
+	}
+
+	// fixed point interpolation between the tick positions
+	coord::phys3_delta moved = this->pos.draw - this->tick_start_pos;
+	coord::phys_t weight = terrain->get_tick_fraction() * coord::settings::phys_t_scaling_factor;
+	return this->tick_start_pos + (moved * weight) / coord::settings::phys_t_scaling_factor;
+}
+
+coord::camgame TerrainObject::get_draw_camgame() const {
+	if (this->draw_camgame_set) {
+		return this->draw_camgame;
+	}
+	return this->get_draw_position().to_camgame();
+}
+
+coord::camgame TerrainObject::get_ground_camgame() const {
+	if (this->draw_camgame_set) {
+		return this->ground_camgame;
+	}
+
+	// TODO: terrain elevation
+	coord::phys3 ground_pos = this->get_draw_position();
+	ground_pos.up = 0;
+	return ground_pos.to_camgame();
+}
+
+void TerrainObject::set_draw_camgame(coord::camgame draw_pos, coord::camgame ground_pos) {
+	this->draw_camgame_set = true;
+	this->draw_camgame = draw_pos;
+	this->ground_camgame = ground_pos;
+}
+
+void TerrainObject::clear_draw_camgame() {
+	this->draw_camgame_set = false;
+}
+
+TerrainObject *TerrainObject::find_intersecting(Terrain &terrain, const coord::phys3 &position) const {
+	size_t tested = 0;
+	TerrainObject *found = terrain.get_spatial_index().find_overlapping(
+		this->get_range(position),
+		[this, &position](const TerrainObject &other) {
+			return &other != this and
+			       other.check_collisions() and
+			       this->intersects(other, position);
+		},
+		tested
+	);
+
+	terrain.count_collision_query(tested, found != nullptr);
+	return found;
 }
 
 bool TerrainObject::place(object_state init_state) {
@@ -78,8 +219,8 @@ bool TerrainObject::place(object_state init_state) {
 	// which intersect with the new placement
 	// if non-floating objects are on the foundation
 	// then this placement will fail
-	for (coord::tile temp_pos : tile_list(this->pos)) {
-		std::vector<TerrainObject *> to_remove;
+	for (coord::tile temp_pos : frame_tile_list(this->pos)) {
+		datastructure::SmallVector<TerrainObject *, 8> to_remove;
 		TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
 
 		if (chunk == nullptr) {
@@ -112,7 +253,14 @@ bool TerrainObject::place(object_state init_state) {
 	}
 
 	// set new state
+	bool was_obstacle = this->is_static_obstacle();
 	this->state = init_state;
+
+	if (was_obstacle != this->is_static_obstacle()) {
+		this->invalidate_path_graph();
+	}
+	this->update_sight();
+	this->mark_changed(this->pos, tile_change::object_added);
 	return true;
 }
 
@@ -132,8 +280,18 @@ bool TerrainObject::place(std::shared_ptr<Terrain> t, coord::phys3 &position, ob
 	// place on terrain
 	this->place_unchecked(t, position);
 
+	// placed objects are not interpolated from an older position
+	this->tick_start_pos = this->pos.draw;
+	this->moved_tick = t->get_tick();
+
 	// set state
 	this->state = init_state;
+
+	if (this->is_static_obstacle()) {
+		this->invalidate_path_graph();
+	}
+	this->update_sight();
+	this->mark_changed(this->pos, tile_change::object_added);
 	return true;
 }
 
@@ -146,26 +304,111 @@ bool TerrainObject::move(coord::phys3 &position) {
 	// todo should do outside of this function
 	bool can_move = this->passable(position);
 	if (can_move) {
-		this->remove();
-		this->place_unchecked(this->get_terrain(), position);
+		coord::phys3 previous = this->pos.draw;
+		tile_range previous_tiles = this->pos;
+		auto terrain = this->get_terrain();
+
+		this->remove_unchecked();
+		this->place_unchecked(terrain, position);
 		this->state = old_state;
+		this->update_sight();
+
+		// most moves stay on the same tiles
+		if (not (previous_tiles.start == this->pos.start)) {
+			this->mark_changed(previous_tiles, tile_change::object_moved);
+			this->mark_changed(this->pos, tile_change::object_moved);
+		}
+
+		// remember where the object started this tick, for drawing
+		if (terrain and this->moved_tick != terrain->get_tick()) {
+			this->tick_start_pos = previous;
+			this->moved_tick = terrain->get_tick();
+		}
 	}
 	return can_move;
 }
 
 void TerrainObject::remove() {
+	if (this->state != object_state::removed) {
+		this->mark_changed(this->pos, tile_change::object_removed);
+	}
+	this->remove_unchecked();
+
+	// the unit's attributes may be gone already,
+	// the stamp is removed with the stored values
+	if (this->sight_grid != nullptr) {
+		this->sight_grid->remove_sight(this->sight_tile, this->sight_radius);
+		this->sight_grid = nullptr;
+	}
+}
+
+void TerrainObject::update_sight() {
+	VisibilityGrid *grid = nullptr;
+	int radius = 0;
+	coord::tile center = this->pos.draw.to_tile3().to_tile();
+
+	// annexes see nothing on their own
+	if (this->parent == nullptr and this->is_placed() and
+	    this->unit.unit_type != nullptr and this->unit.unit_type->line_of_sight > 0 and
+	    this->unit.has_attribute(attr_type::owner)) {
+		grid = &this->unit.get_attribute<attr_type::owner>().player.visibility;
+		radius = this->unit.unit_type->line_of_sight;
+	}
+
+	if (grid == this->sight_grid and radius == this->sight_radius and
+	    (grid == nullptr or center == this->sight_tile)) {
+		return;
+	}
+
+	if (grid != nullptr and grid == this->sight_grid and radius == this->sight_radius) {
+		grid->move_sight(this->sight_tile, center, radius);
+	}
+	else {
+		if (this->sight_grid != nullptr) {
+			this->sight_grid->remove_sight(this->sight_tile, this->sight_radius);
+		}
+		if (grid != nullptr) {
+			grid->add_sight(center, radius);
+		}
+	}
+
+	this->sight_grid = grid;
+	this->sight_tile = center;
+	this->sight_radius = radius;
+}
+
+void TerrainObject::remove_unchecked() {
 	// remove all children first
 	for (auto &c : this->children) {
 		c->remove();
 	}
 	this->children.clear();
 
+	this->hash_position(false);
+
+	if (this->spatial_indexed) {
+		auto terrain = this->get_terrain();
+		if (terrain) {
+			terrain->get_spatial_index().remove(this);
+		}
+	}
+
+	if (this->drawn) {
+		auto terrain = this->get_terrain();
+		if (terrain) {
+			terrain->get_chunk(this->drawn_chunk)->remove_drawable(this);
+		}
+		this->drawn = false;
+	}
+
 	if (this->occupied_chunk_count == 0 ||
 	    this->state == object_state::removed) {
 		return;
 	}
 
-	for (coord::tile temp_pos : tile_list(this->pos)) {
+	bool was_obstacle = this->is_static_obstacle();
+
+	for (coord::tile temp_pos : frame_tile_list(this->pos)) {
 		TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
 
 		if (chunk == nullptr) {
@@ -181,10 +424,15 @@ void TerrainObject::remove() {
 				return this == obj;
 			});
 		v.erase(position_it, std::end(v));
+		chunk->update_objects(tile_pos);
 	}
 
 	this->occupied_chunk_count = 0;
 	this->state = object_state::removed;
+
+	if (was_obstacle) {
+		this->invalidate_path_graph();
+	}
 }
 
 void TerrainObject::set_ground(int id, int additional) {
@@ -197,14 +445,8 @@ void TerrainObject::set_ground(int id, int additional) {
 	temp_pos.se -= additional;
 	while (temp_pos.ne < this->pos.end.ne + additional) {
 		while (temp_pos.se < this->pos.end.se + additional) {
-			TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
-
-			if (chunk == nullptr) {
-				continue;
-			}
-
-			size_t tile_pos = chunk->tile_position_neigh(temp_pos);
-			chunk->get_data(tile_pos)->terrain_id = id;
+			// tiles without chunk are skipped
+			this->get_terrain()->set_terrain_id(temp_pos, id);
 			temp_pos.se++;
 		}
 		temp_pos.se = this->pos.start.se - additional;
@@ -234,27 +476,14 @@ bool TerrainObject::operator <(const TerrainObject &other) {
 		return false;
 	}
 
-	auto this_ne    = this->pos.draw.ne;
-	auto this_se    = this->pos.draw.se;
-	auto other_ne   = other.pos.draw.ne;
-	auto other_se   = other.pos.draw.se;
-
-	auto this_ypos  = this_ne  - this_se;
-	auto other_ypos = other_ne - other_se;
-
-	if (this_ypos < other_ypos) {
-		return false;
-	}
-	else if (this_ypos == other_ypos) {
-		if (this_ne > other_ne) {
-			return false;
-		}
-		else if (this_ne == other_ne) {
-			return this_se > other_se;
-		}
-	}
+	return this->get_draw_key() < other.get_draw_key();
+}
 
-	return true;
+TerrainObject::draw_key_t TerrainObject::get_draw_key() const {
+	// objects further up in the window, with a larger ne - se,
+	// are drawn first, then those with a smaller ne.
+	coord::phys_t ypos = this->pos.draw.ne - this->pos.draw.se;
+	return draw_key_t{-ypos, this->pos.draw.ne};
 }
 
 void TerrainObject::place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &position) {
@@ -268,7 +497,7 @@ void TerrainObject::place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &po
 
 	// set pointers to this object on each terrain tile
 	// where the building will stand and block the ground
-	for (coord::tile temp_pos : tile_list(this->pos)) {
+	for (coord::tile temp_pos : frame_tile_list(this->pos)) {
 		TerrainChunk *chunk = this->get_terrain()->get_chunk(temp_pos);
 
 		if (chunk == nullptr) {
@@ -290,19 +519,30 @@ void TerrainObject::place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &po
 
 		int tile_pos = chunk->tile_position_neigh(temp_pos);
 		chunk->get_data(tile_pos)->obj.push_back(this);
+		chunk->update_objects(tile_pos);
 	}
-}
 
-SquareObject::SquareObject(Unit &u, coord::tile_delta foundation_size)
-	:
-	SquareObject(u, foundation_size, square_outline(foundation_size)) {
+	// objects outside of the known chunks can't be found by a search
+	if (this->occupied_chunk_count > 0) {
+		t->get_spatial_index().insert(this);
+	}
+
+	this->hash_position(true);
+
+	// the object is drawn with the chunk its position is on
+	coord::chunk draw_chunk = this->pos.draw.to_tile3().to_tile().to_chunk();
+	TerrainChunk *chunk = t->get_chunk(draw_chunk);
+	if (chunk != nullptr) {
+		chunk->add_drawable(this);
+		this->drawn = true;
+		this->drawn_chunk = draw_chunk;
+	}
 }
 
-SquareObject::SquareObject(Unit &u, coord::tile_delta foundation_size, std::shared_ptr<Texture> out_tex)
+SquareObject::SquareObject(Unit &u, coord::tile_delta foundation_size)
 	:
-	TerrainObject(u),
+	TerrainObject(u, object_shape::square),
 	size(foundation_size) {
-	this->outline_texture = out_tex;
 }
 
 SquareObject::~SquareObject() {}
@@ -321,7 +561,7 @@ coord::phys_t SquareObject::from_edge(const coord::phys3 &point) const {
 	// distance to clamped point
 	coord::phys_t dx = point.ne - cx;
 	coord::phys_t dy = point.se - cy;
-	return std::hypot(dx, dy);
+	return coord::length(dx, dy);
 }
 
 coord::phys3 SquareObject::on_edge(const coord::phys3 &angle, coord::phys_t) const {
@@ -338,7 +578,7 @@ coord::phys3 SquareObject::on_edge(const coord::phys3 &angle, coord::phys_t) con
 bool SquareObject::contains(const coord::phys3 &other) const {
 	coord::tile other_tile = other.to_tile3().to_tile();
 
-	for (coord::tile check_pos : tile_list(this->pos)) {
+	for (coord::tile check_pos : frame_tile_list(this->pos)) {
 		if (check_pos == other_tile) {
 			return true;
 		}
@@ -346,44 +586,81 @@ bool SquareObject::contains(const coord::phys3 &other) const {
 	return false;
 }
 
-bool SquareObject::intersects(const TerrainObject &other, const coord::phys3 &position) const {
-	if (const SquareObject *sq = dynamic_cast<const SquareObject *>(&other)) {
-		tile_range rng = this->get_range(position);
-		return this->pos.end.ne < rng.start.ne
-		       || rng.end.ne < sq->pos.start.ne
-		       || rng.end.se < sq->pos.start.se
-		       || rng.end.se < sq->pos.start.se;
-	}
-	else if (const RadialObject *rad = dynamic_cast<const RadialObject *>(&other)) {
-		// clamp between start and end
-		tile_range rng = this->get_range(position);
-		coord::phys3 start_phys = rng.start.to_phys2().to_phys3() - phys_half_tile;
-		coord::phys3 end_phys = rng.end.to_phys2().to_phys3() - phys_half_tile;
-		coord::phys_t cx = std::max(start_phys.ne, std::min(end_phys.ne, rad->pos.draw.ne));
-		coord::phys_t cy = std::max(start_phys.se, std::min(end_phys.se, rad->pos.draw.se));
-
-		// distance to square object base
-		coord::phys_t dx = rad->pos.draw.ne - cx;
-		coord::phys_t dy = rad->pos.draw.se - cy;
-		return std::hypot(dx, dy) < rad->phys_radius;
+namespace {
+
+/**
+ * intersection test of an object at a position with another one,
+ * specialized for each pair of shapes.
+ */
+template<class A, class B>
+bool shapes_intersect(const A &obj, const coord::phys3 &position, const B &other);
+
+template<>
+bool shapes_intersect(const SquareObject &obj, const coord::phys3 &position, const SquareObject &other) {
+	tile_range rng = obj.get_range(position);
+	return obj.pos.end.ne < rng.start.ne
+	       || rng.end.ne < other.pos.start.ne
+	       || rng.end.se < other.pos.start.se
+	       || rng.end.se < other.pos.start.se;
+}
+
+template<>
+bool shapes_intersect(const SquareObject &obj, const coord::phys3 &position, const RadialObject &other) {
+	// clamp between start and end
+	tile_range rng = obj.get_range(position);
+	coord::phys3 start_phys = rng.start.to_phys2().to_phys3() - phys_half_tile;
+	coord::phys3 end_phys = rng.end.to_phys2().to_phys3() - phys_half_tile;
+	coord::phys_t cx = std::max(start_phys.ne, std::min(end_phys.ne, other.pos.draw.ne));
+	coord::phys_t cy = std::max(start_phys.se, std::min(end_phys.se, other.pos.draw.se));
+
+	// distance to square object base
+	coord::phys_t dx = other.pos.draw.ne - cx;
+	coord::phys_t dy = other.pos.draw.se - cy;
+	return coord::length_squared(dx, dy) < other.phys_radius * other.phys_radius;
+}
+
+template<>
+bool shapes_intersect(const RadialObject &obj, const coord::phys3 &position, const SquareObject &other) {
+	return other.from_edge(position) < obj.phys_radius;
+}
+
+template<>
+bool shapes_intersect(const RadialObject &obj, const coord::phys3 &position, const RadialObject &other) {
+	return coord::in_range(position, other.pos.draw, obj.phys_radius + other.phys_radius);
+}
+
+/**
+ * selects the test for the shape of the other object
+ */
+template<class A>
+bool intersect_with(const A &obj, const coord::phys3 &position, const TerrainObject &other) {
+	switch (other.shape) {
+	case object_shape::square:
+		return shapes_intersect(obj, position, static_cast<const SquareObject &>(other));
+	case object_shape::radial:
+		return shapes_intersect(obj, position, static_cast<const RadialObject &>(other));
 	}
 	return false;
 }
 
+} // anonymous namespace
+
+bool SquareObject::intersects(const TerrainObject &other, const coord::phys3 &position) const {
+	return intersect_with(*this, position, other);
+}
+
 coord::phys_t SquareObject::min_axis() const {
 	return std::min( this->size.ne, this->size.se ) * coord::settings::phys_per_tile;
 }
 
-RadialObject::RadialObject(Unit &u, float rad)
-	:
-	RadialObject(u, rad, radial_outline(rad)) {
+void SquareObject::add_outline(ShapeBatch &shapes, coord::camgame center) const {
+	square_outline(shapes, center, this->size);
 }
 
-RadialObject::RadialObject(Unit &u, float rad, std::shared_ptr<Texture> out_tex)
+RadialObject::RadialObject(Unit &u, float rad)
 	:
-	TerrainObject(u),
+	TerrainObject(u, object_shape::radial),
 	phys_radius(coord::settings::phys_per_tile * rad) {
-	this->outline_texture = out_tex;
 }
 
 RadialObject::~RadialObject() {}
@@ -419,22 +696,21 @@ bool RadialObject::contains(const coord::phys3 &other) const {
 }
 
 bool RadialObject::intersects(const TerrainObject &other, const coord::phys3 &position) const {
-	if (const SquareObject *sq = dynamic_cast<const SquareObject *>(&other)) {
-		return sq->from_edge(position) < this->phys_radius;
-	}
-	else if (const RadialObject *rad = dynamic_cast<const RadialObject *>(&other)) {
-		return distance(position, rad->pos.draw) < this->phys_radius + rad->phys_radius;
-	}
-	return false;
+	return intersect_with(*this, position, other);
 }
 
 coord::phys_t RadialObject::min_axis() const {
 	return this->phys_radius * 2;
 }
 
-std::vector<coord::tile> tile_list(const tile_range &rng) {
-	std::vector<coord::tile> tiles;
+void RadialObject::add_outline(ShapeBatch &shapes, coord::camgame center) const {
+	radial_outline(shapes, center, static_cast<float>(this->phys_radius) / coord::settings::phys_per_tile);
+}
 
+namespace {
+
+template<typename vector_t>
+void fill_tile_list(const tile_range &rng, vector_t &tiles) {
 	coord::tile check_pos = rng.start;
 	while (check_pos.ne < rng.end.ne) {
 		while (check_pos.se < rng.end.se) {
@@ -449,6 +725,21 @@ std::vector<coord::tile> tile_list(const tile_range &rng) {
 	if (tiles.empty()) {
 		tiles.push_back(rng.start);
 	}
+}
+
+} // anonymous namespace
+
+std::vector<coord::tile> tile_list(const tile_range &rng) {
+	std::vector<coord::tile> tiles;
+	fill_tile_list(rng, tiles);
+	return tiles;
+}
+
+util::frame_vector<coord::tile> frame_tile_list(const tile_range &rng) {
+	util::frame_vector<coord::tile> tiles;
+	tiles.reserve(std::max<coord::tile_t>(rng.end.ne - rng.start.ne, 1) *
+	              std::max<coord::tile_t>(rng.end.se - rng.start.se, 1));
+	fill_tile_list(rng, tiles);
 	return tiles;
 }
 
@@ -467,6 +758,21 @@ tile_range building_center(coord::phys3 west, coord::tile_delta size) {
 	return result;
 }
 
+bool foundation_tile_free(Terrain &terrain, coord::tile position) {
+	TerrainChunk *chunk = terrain.get_chunk(position);
+	if (chunk == nullptr) {
+		return false;
+	}
+	size_t tile = TerrainChunk::tile_index(position);
+	if (not test_tile(chunk->occupied, tile)) {
+		return true;
+	}
+	for (auto tobj : chunk->get_data(tile)->obj) {
+		if (tobj->check_collisions()) return false;
+	}
+	return true;
+}
+
 bool complete_building(Unit &u) {
 	if (u.has_attribute(attr_type::building)) {
 		auto &build = u.get_attribute<attr_type::building>();
@@ -477,6 +783,10 @@ bool complete_building(Unit &u) {
 		bool placed_ok = target_location->place(build.completion_state);
 		if (placed_ok) {
 			target_location->set_ground(build.foundation_terrain, 0);
+
+			if (u.has_attribute(attr_type::owner)) {
+				u.get_attribute<attr_type::owner>().player.dropsites.add(u);
+			}
 		}
 		return placed_ok;
 	}
@@ -1,20 +1,26 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <stddef.h>
+#include <utility>
 
 #include "../pathfinding/path.h"
+#include "../coord/camgame.h"
+#include "../coord/chunk.h"
 #include "../coord/tile.h"
 #include "../coord/phys3.h"
+#include "../util/frame_arena.h"
 
 namespace openage {
 
+class ShapeBatch;
 class Terrain;
 class TerrainChunk;
-class Texture;
 class Unit;
+class VisibilityGrid;
 
 /**
  * only placed will enable collision checks
@@ -26,6 +32,15 @@ enum class object_state {
 	placed_no_collision
 };
 
+/**
+ * the shape of a terrain object, selects the intersection test
+ * for each pair of shapes without casting
+ */
+enum class object_shape {
+	square,
+	radial
+};
+
 /**
  * A rectangle or square of tiles which is the minimim
  * space to fit the units foundation or radius
@@ -45,6 +60,12 @@ struct tile_range {
  */
 std::vector<coord::tile> tile_list(const tile_range &rng);
 
+/**
+ * tile_list on the frame arena of the calling thread,
+ * for iterating the tiles during a frame or tick.
+ */
+util::frame_vector<coord::tile> frame_tile_list(const tile_range &rng);
+
 /**
  * given the west most point of a building foundation and the tile_delta
  * size of the foundation, this will return the tile range covered by the base,
@@ -52,6 +73,12 @@ std::vector<coord::tile> tile_list(const tile_range &rng);
  */
 tile_range building_center(coord::phys3 west, coord::tile_delta size);
 
+/**
+ * whether a building foundation may cover the tile: its chunk exists
+ * and none of its objects collide.
+ */
+bool foundation_tile_free(Terrain &terrain, coord::tile position);
+
 /**
  * sets a building to a fully completed state
  */
@@ -83,7 +110,7 @@ constexpr coord::phys3_delta phys_half_tile = coord::phys3_delta{
  */
 class TerrainObject : public std::enable_shared_from_this<TerrainObject> {
 public:
-	TerrainObject(Unit &u);
+	TerrainObject(Unit &u, object_shape shape);
 	TerrainObject(const TerrainObject &) = delete;	// disable copy constructor
 	TerrainObject(TerrainObject &&) = delete;	// disable move constructor
 	virtual ~TerrainObject();
@@ -101,6 +128,11 @@ public:
 	 */
 	Unit &unit;
 
+	/**
+	 * whether this is a SquareObject or a RadialObject
+	 */
+	const object_shape shape;
+
 	/**
 	 * is the object a floating outline -- it is only an indicator
 	 * of where a building will be built, but not yet started building
@@ -121,22 +153,59 @@ public:
 	 */
 	bool check_collisions() const;
 
+	/**
+	 * is this object an obstacle which does not move by itself,
+	 * like buildings, trees or cliffs. such obstacles are part of
+	 * the chunk graph used for long distance pathfinding.
+	 */
+	bool is_static_obstacle() const;
+
 	/**
 	 * decide which terrains this object can be on
 	 * this function should be true if given a valid position for the object
 	 */
 	std::function<bool(const coord::phys3 &)> passable;
 
+	/**
+	 * the passability layer of the terrains this object can be on,
+	 * Terrain::no_passability_layer if there is none.
+	 * the chunk graph keeps the reachable areas of each layer.
+	 */
+	size_t passability_layer;
+
 	/**
 	 * specifies content to be drawn
 	 */
 	std::function<void()> draw;
 
 	/**
-	 * draws outline of this terrain space in current position
+	 * draws outline of this terrain space in current position.
+	 * while the terrain draws its objects, the outline is added
+	 * to its decorations, see Terrain::get_decorations.
 	 */
 	void draw_outline() const;
 
+	/**
+	 * the position to draw the object at. objects moved in the last
+	 * simulation tick are drawn between their previous and current
+	 * position, as given by the tick fraction of the terrain.
+	 */
+	coord::phys3 get_draw_position() const;
+
+	/**
+	 * the camgame positions of the draw position and of the ground below
+	 * it. while the terrain draws, they were converted for all drawn
+	 * objects at once, otherwise they are converted on their own.
+	 */
+	coord::camgame get_draw_camgame() const;
+	coord::camgame get_ground_camgame() const;
+
+	/**
+	 * keeps the converted camgame positions until clear_draw_camgame.
+	 */
+	void set_draw_camgame(coord::camgame draw_pos, coord::camgame ground_pos);
+	void clear_draw_camgame();
+
 	/**
 	 * changes the placement state of this object keeping the existing
 	 * position. this is useful for upgrading a floating building to a placed state
@@ -163,6 +232,14 @@ public:
 	 */
 	void remove();
 
+	/**
+	 * adds or moves the line of sight of the unit in the visibility
+	 * grid of its owner, after it was placed, moved or initialised
+	 * with a type. only changes the grid if the unit is on another
+	 * tile, has another owner or another line of sight.
+	 */
+	void update_sight();
+
 	/**
 	 * sets all the ground below the object to a terrain id.
 	 *
@@ -220,6 +297,14 @@ public:
 	 */
 	bool operator <(const TerrainObject &other);
 
+	/**
+	 * sort key of the draw order, the objects are drawn in order of
+	 * increasing keys. the same order as operator <, but the keys can be
+	 * computed once and sorted without going through the objects.
+	 */
+	using draw_key_t = std::pair<coord::phys_t, coord::phys_t>;
+	draw_key_t get_draw_key() const;
+
 	/**
 	 * returns the range of tiles covered if the object was in the given pos
 	 * @param pos the position to find a range for
@@ -246,11 +331,24 @@ public:
 	 */
 	virtual bool intersects(const TerrainObject &other, const coord::phys3 &position) const = 0;
 
+	/**
+	 * an object of the terrain which collides with this one if it were
+	 * positioned at the given point, or nullptr. the spatial index finds
+	 * the objects sharing tiles with the position, which are then tested
+	 * for intersection. the tests are counted by the terrain.
+	 */
+	TerrainObject *find_intersecting(Terrain &terrain, const coord::phys3 &position) const;
+
 	/**
 	 * the shortest line that can be placed across the objects center
 	 */
 	virtual coord::phys_t min_axis() const = 0;
 
+	/**
+	 * add the outline of the object's ground shape around the given position.
+	 */
+	virtual void add_outline(ShapeBatch &shapes, coord::camgame center) const = 0;
+
 protected:
 	object_state state;
 
@@ -258,16 +356,52 @@ protected:
 	int occupied_chunk_count;
 	TerrainChunk *occupied_chunk[4];
 
+	/**
+	 * location of this object in the spatial index of the terrain
+	 */
+	bool spatial_indexed;
+	coord::tile spatial_cell;
+	size_t spatial_slot;
+
+	/**
+	 * the line of sight added to a visibility grid, nullptr if none
+	 */
+	VisibilityGrid *sight_grid;
+	coord::tile sight_tile;
+	int sight_radius;
+
+	/**
+	 * the chunk this object is drawn from, and its slot there
+	 */
+	bool drawn;
+	coord::chunk drawn_chunk;
+	size_t drawn_slot;
+
+	/**
+	 * position before the last move, and the tick it was moved in
+	 */
+	coord::phys3 tick_start_pos;
+	uint64_t moved_tick;
+
+	/**
+	 * the position value added to the state hash, if any
+	 */
+	bool position_hashed;
+	uint64_t hashed_position;
+
+	/**
+	 * positions converted by the terrain for the current frame
+	 */
+	bool draw_camgame_set;
+	coord::camgame draw_camgame;
+	coord::camgame ground_camgame;
+
 	/**
 	 * annexes and grouped units
 	 */
 	TerrainObject *parent;
 	std::vector<std::unique_ptr<TerrainObject>> children;
 
-	/**
-	 * texture for drawing outline
-	 */
-	std::shared_ptr<Texture> outline_texture;
 
 	/**
 	 * placement function which does not check passibility
@@ -276,6 +410,42 @@ protected:
 	 * this does not modify the units placement state
 	 */
 	void place_unchecked(std::shared_ptr<Terrain> t, coord::phys3 &position);
+
+	/**
+	 * removes the object from the terrain chunks, but keeps
+	 * its line of sight, as it's placed again right after.
+	 */
+	void remove_unchecked();
+
+	/**
+	 * notify the terrain pathfinding graph that the obstruction
+	 * of the tiles covered by this object has changed
+	 */
+	void invalidate_path_graph() const;
+
+	/**
+	 * report the tiles of the range as changed to the terrain,
+	 * if its changes have subscribers. see tile_change for the kinds.
+	 */
+	void mark_changed(const tile_range &range, uint8_t kinds) const;
+
+	/**
+	 * replaces the position of the object in the state hash
+	 * of the unit's container by the current one, or removes
+	 * it if the object is no longer placed.
+	 */
+	void hash_position(bool placed);
+
+	/**
+	 * the spatial index stores the location of its
+	 * entry in the object
+	 */
+	friend class SpatialIndex;
+
+	/**
+	 * as does the chunk that draws it
+	 */
+	friend class TerrainChunk;
 };
 
 /**
@@ -317,10 +487,10 @@ public:
 	bool contains(const coord::phys3 &other) const override;
 	bool intersects(const TerrainObject &other, const coord::phys3 &position) const override;
 	coord::phys_t min_axis() const override;
+	void add_outline(ShapeBatch &shapes, coord::camgame center) const override;
 
 private:
 	SquareObject(Unit &u, coord::tile_delta foundation_size);
-	SquareObject(Unit &u, coord::tile_delta foundation_size, std::shared_ptr<Texture> out_tex);
 
 
 	friend class TerrainObject;
@@ -350,10 +520,10 @@ public:
 	bool contains(const coord::phys3 &other) const override;
 	bool intersects(const TerrainObject &other, const coord::phys3 &position) const override;
 	coord::phys_t min_axis() const override;
+	void add_outline(ShapeBatch &shapes, coord::camgame center) const override;
 
 private:
 	RadialObject(Unit &u, float rad);
-	RadialObject(Unit &u, float rad, std::shared_ptr<Texture> out_tex);
 
 	friend class TerrainObject;
 	friend class Unit;
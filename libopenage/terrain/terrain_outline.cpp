@@ -1,61 +1,68 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
+
+#include "terrain_outline.h"
 
 #include <cmath>
-#include <math.h>
-#include <memory>
 
-#include "../texture.h"
-#include "terrain_outline.h"
+#include "../coord/phys3.h"
+#include "../shape_batch.h"
+#include "../util/math_constants.h"
 
 namespace openage {
 
-std::shared_ptr<Texture> square_outline(coord::tile_delta foundation_size) {
-	int width = (foundation_size.ne + foundation_size.se) * 48;
-	int height = (foundation_size.ne + foundation_size.se) * 24;
-
-	auto image_data = std::make_unique<uint32_t[]>(width * height);
-	for (int i = 0; i < width; ++i) {
-		for (int j = 0; j < height; ++j) {
-			float w_percent = (float) abs(i - (width / 2)) / (float) (width / 2);
-			float h_percent = (float) abs(j - (height / 2)) / (float) (height / 2);
-
-			// draw line where (w_percent + h_percent) == 1
-			// line variable is in range 0.0 to 1.0
-			float line = 1.0f - fabs(1.0f - fabs(h_percent + w_percent));
-			unsigned char inten = 255 * pow(line, 16 * width/96);
-			image_data[i + j * width] = (inten << 24) | (inten << 16) | (inten << 8) | inten;
-		}
-	}
+namespace {
+
+constexpr shape_color outline_color{1.0, 1.0, 1.0, 1.0};
+
+/**
+ * the circle outline is approximated by this many lines.
+ */
+constexpr int radial_segments = 32;
+
+} // anonymous namespace
 
-	return std::make_shared<Texture>(width, height, std::move(image_data));
-}
 
-std::shared_ptr<Texture> radial_outline(float radius) {
-	// additional pixels around the edge
-	int border = 4;
-
-	// image size
-	int width = border + radius * 96 * 2;
-	int height = border + radius * 48 * 2;
-	int half_width = width / 2;
-	int half_height = height / 2;
-
-	auto image_data = std::make_unique<uint32_t[]>(width * height);
-
-	for (int i = 0; i < width; ++i) {
-		for (int j = 0; j < height; ++j) {
-			float w_percent = (float) (border+i-half_width) / (float) (half_width-border);
-			float h_percent = (float) (border/2+j-half_height) / (float) (half_height-border/2);
-
-			// line drawn where distance to image center == 1
-			// line variable is in range 0.0 to 1.0
-			float line = 1.0f - fabs(1.0f - std::hypot(w_percent, h_percent));
-			unsigned char inten = 255 * pow(line, 32 * width/96);
-			image_data[i + j * width] = (inten << 24) | (inten << 16) | (inten << 8) | inten;
-		}
+void square_outline(ShapeBatch &shapes, coord::camgame center, coord::tile_delta foundation_size) {
+	coord::phys_t half_ne = foundation_size.ne * coord::settings::phys_per_tile / 2;
+	coord::phys_t half_se = foundation_size.se * coord::settings::phys_per_tile / 2;
+
+	// the corners of the foundation around the center, in drawing order
+	coord::camgame_delta corners[] = {
+		coord::phys3_delta{ half_ne,  half_se, 0}.to_camgame(),
+		coord::phys3_delta{ half_ne, -half_se, 0}.to_camgame(),
+		coord::phys3_delta{-half_ne, -half_se, 0}.to_camgame(),
+		coord::phys3_delta{-half_ne,  half_se, 0}.to_camgame(),
+	};
+
+	for (int i = 0; i < 4; i++) {
+		const coord::camgame_delta &from = corners[i];
+		const coord::camgame_delta &to = corners[(i + 1) % 4];
+		shapes.line(center.x + from.x, center.y + from.y,
+		            center.x + to.x, center.y + to.y,
+		            outline_color);
 	}
+}
+
 
-	return std::make_shared<Texture>(width, height, std::move(image_data));
+void radial_outline(ShapeBatch &shapes, coord::camgame center, float radius) {
+	// the axes of the ellipse, one tile along the screen axes
+	coord::phys_t tile = coord::settings::phys_per_tile;
+	coord::camgame_delta across = coord::phys3_delta{tile, tile, 0}.to_camgame();
+	coord::camgame_delta up = coord::phys3_delta{tile, -tile, 0}.to_camgame();
+
+	float prev_x = center.x + across.x * radius;
+	float prev_y = center.y + across.y * radius;
+	for (int i = 1; i <= radial_segments; i++) {
+		float angle = 2 * math::PI * i / radial_segments;
+		float c = std::cos(angle) * radius;
+		float s = std::sin(angle) * radius;
+		float x = center.x + across.x * c + up.x * s;
+		float y = center.y + across.y * c + up.y * s;
+
+		shapes.line(prev_x, prev_y, x, y, outline_color);
+		prev_x = x;
+		prev_y = y;
+	}
 }
 
 } // namespace openage
@@ -1,23 +1,25 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
-#include <memory>
-
+#include "../coord/camgame.h"
 #include "../coord/tile.h"
 
 namespace openage {
 
-class Texture;
+class ShapeBatch;
 
 /**
- * Generate a isometric square outline texture
+ * Add an isometric square outline around a ground position.
+ *
+ * The outlines are drawn as lines with the shape shader,
+ * so no texture is rasterized for each foundation size.
  */
-std::shared_ptr<Texture> square_outline(coord::tile_delta foundation_size);
+void square_outline(ShapeBatch &shapes, coord::camgame center, coord::tile_delta foundation_size);
 
 /**
- * Generate a isometric circle outline texture
+ * Add an isometric circle outline around a ground position.
  */
-std::shared_ptr<Texture> radial_outline(float radius);
+void radial_outline(ShapeBatch &shapes, coord::camgame center, float radius);
 
 } // namespace openage
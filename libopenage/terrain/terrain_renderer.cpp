@@ -0,0 +1,998 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "terrain_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <set>
+#include <tuple>
+
+#include "../coord/camgame.h"
+#include "../coord/phys3.h"
+#include "../coord/tile.h"
+#include "../coord/tile3.h"
+#include "../error/error.h"
+#include "../log/log.h"
+#include "../texture.h"
+#include "../texture_array.h"
+
+#include "terrain_chunk.h"
+
+namespace openage {
+
+namespace terrainblend_shader {
+terrainblend_program textures;
+terrainblend_program arrays;
+} // namespace terrainblend_shader
+
+namespace terrainarray_shader {
+shader::Program *program;
+GLint texture, tex_coord;
+} // namespace terrainarray_shader
+
+
+void terrainblend_program::setup(shader::Program *program, bool texture_arrays) {
+	this->program = program;
+	program->link();
+	this->tex_coord = program->get_attribute_id("tex_coordinates");
+	this->mask_corner = program->get_attribute_id("mask_corner");
+	this->tile_coord = program->get_attribute_id("tile_coordinates");
+	if (texture_arrays) {
+		this->layers = program->get_attribute_id("texture_layers");
+	}
+	this->base_texture = program->get_uniform_id("base_texture");
+	this->mask_texture = program->get_uniform_id("mask_texture");
+	this->tile_ids = program->get_uniform_id("tile_ids");
+	this->terrain_priorities = program->get_uniform_id("terrain_priorities");
+	this->terrain_blendmodes = program->get_uniform_id("terrain_blendmodes");
+	this->grid_size = program->get_uniform_id("grid_size");
+	this->terrain_count = program->get_uniform_id("terrain_count");
+	this->terrain = program->get_uniform_id("terrain");
+	this->blend_mode = program->get_uniform_id("blend_mode");
+	this->mask_rects = program->get_uniform_id("mask_rects");
+	this->adjacent_masks = program->get_uniform_id("adjacent_masks");
+
+	program->use();
+	glUniform1i(this->base_texture, 0);
+	glUniform1i(this->mask_texture, 1);
+	glUniform1i(this->tile_ids, 2);
+	glUniform1i(this->terrain_priorities, 3);
+	glUniform1i(this->terrain_blendmodes, 4);
+	program->stopusing();
+}
+
+namespace {
+
+/**
+ * the number of masks in each blendomatic mode.
+ */
+constexpr int blending_mask_count = 31;
+
+/**
+ * the most chunks rendered into their texture in one frame.
+ */
+constexpr size_t max_prerenders_per_frame = 4;
+
+/**
+ * the mask for each combination of adjacent neighbors that have the
+ * blended terrain, indexed by the bits of neighbors 1, 3, 5 and 7.
+ * the straight masks 0, 4, 8 and 12 have 4 variants each.
+ */
+constexpr GLfloat adjacent_mask_ids[16] = {
+	-1,  4,  0, 25,
+	 8, 20, 24, 26,
+	12, 23, 21, 29,
+	22, 28, 27, 30,
+};
+
+/**
+ * the texture coordinates of a tile quad, in the same geometry as Texture::draw.
+ */
+struct tile_quad {
+	GLfloat left, right, top, bottom;
+	float txl, txr, txt, txb;
+};
+
+/**
+ * the quad of a subtexture. with a texture array, the texture
+ * coordinates are the ones in the layer of the texture.
+ */
+tile_quad make_quad(const Texture *tex, int subtexture_id, coord::camgame_delta draw_pos,
+                    const TextureArray *array) {
+	const gamedata::subtexture *tx = tex->get_subtexture(subtexture_id);
+
+	tile_quad quad;
+	quad.bottom = draw_pos.y - (tx->h - tx->cy);
+	quad.top    = quad.bottom + tx->h;
+	quad.left   = draw_pos.x - tx->cx;
+	quad.right  = quad.left + tx->w;
+	if (array != nullptr) {
+		array->get_subtexture_coordinates(tex, subtexture_id, &quad.txl, &quad.txr, &quad.txt, &quad.txb);
+	}
+	else {
+		tex->get_subtexture_coordinates(tx, &quad.txl, &quad.txr, &quad.txt, &quad.txb);
+	}
+	return quad;
+}
+
+/**
+ * grow the bounds of a chunk buffer to contain the quad.
+ */
+void extend_bounds(terrain_chunk_buffer &buffer, const tile_quad &q) {
+	buffer.left   = std::min(buffer.left, q.left);
+	buffer.right  = std::max(buffer.right, q.right);
+	buffer.bottom = std::min(buffer.bottom, q.bottom);
+	buffer.top    = std::max(buffer.top, q.top);
+}
+
+} // anonymous namespace
+
+
+TerrainRenderer::TerrainRenderer(Terrain *terrain)
+	:
+	terrain{terrain},
+	index_buffer{0},
+	index_capacity{0},
+	priority_texture{0},
+	blendmode_texture{0},
+	framebuffer{0},
+	quad_buffer{0},
+	prerendered_count{0},
+	frame{0},
+	arrays_checked{false},
+	use_arrays{false} {}
+
+
+TerrainRenderer::~TerrainRenderer() {
+	this->clear();
+
+	if (this->index_buffer != 0) {
+		glDeleteBuffers(1, &this->index_buffer);
+	}
+	if (this->priority_texture != 0) {
+		glDeleteTextures(1, &this->priority_texture);
+		glDeleteTextures(1, &this->blendmode_texture);
+	}
+	if (this->framebuffer != 0) {
+		glDeleteFramebuffers(1, &this->framebuffer);
+	}
+	if (this->quad_buffer != 0) {
+		glDeleteBuffers(1, &this->quad_buffer);
+	}
+}
+
+
+void TerrainRenderer::clear() {
+	for (auto &entry : this->buffers) {
+		glDeleteBuffers(1, &entry.second.vertbuf);
+		glDeleteBuffers(1, &entry.second.blendbuf);
+		glDeleteTextures(1, &entry.second.tile_ids);
+		this->release_prerendered(entry.second);
+	}
+	this->buffers.clear();
+	this->mask_rects.clear();
+}
+
+
+void TerrainRenderer::reserve_indices(size_t quad_count) {
+	if (quad_count <= this->index_capacity) {
+		return;
+	}
+
+	// the indices have to be addressable by GLushort.
+	ENSURE(quad_count * 4 <= 0xFFFF, "too many terrain quads in one chunk: " << quad_count);
+
+	std::vector<GLushort> indices;
+	indices.reserve(quad_count * 6);
+	for (size_t q = 0; q < quad_count; q++) {
+		GLushort base = q * 4;
+
+		// two triangles per quad:
+		// top left, bottom left, bottom right
+		// top left, bottom right, top right
+		indices.push_back(base);
+		indices.push_back(base + 1);
+		indices.push_back(base + 2);
+		indices.push_back(base);
+		indices.push_back(base + 2);
+		indices.push_back(base + 3);
+	}
+
+	if (this->index_buffer == 0) {
+		glGenBuffers(1, &this->index_buffer);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+	             indices.size() * sizeof(GLushort),
+	             indices.data(),
+	             GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	this->index_capacity = quad_count;
+}
+
+
+void TerrainRenderer::prepare_blending() {
+	size_t count = this->terrain->get_terrain_count();
+
+	// the ids are stored as id + 1 in a byte, 0 is a missing tile.
+	ENSURE(count < 0xFF, "too many terrain types for blending: " << count);
+
+	// the priorities are replaced by their rank, which compares the same
+	// and fits into a byte.
+	std::vector<int> priorities;
+	for (size_t id = 0; id < count; id++) {
+		priorities.push_back(this->terrain->priority(id));
+	}
+	std::vector<int> ranks = priorities;
+	std::sort(std::begin(ranks), std::end(ranks));
+	ranks.erase(std::unique(std::begin(ranks), std::end(ranks)), std::end(ranks));
+
+	std::vector<GLubyte> priority_data;
+	std::vector<GLubyte> blendmode_data;
+	for (size_t id = 0; id < count; id++) {
+		auto rank = std::lower_bound(std::begin(ranks), std::end(ranks), priorities[id]);
+		priority_data.push_back(rank - std::begin(ranks));
+
+		int mode = this->terrain->blendmode(id);
+		ENSURE(mode >= 0 and mode < 0xFF, "blending mode out of range: " << mode);
+		blendmode_data.push_back(mode);
+	}
+
+	auto create_table = [count](GLuint *texture, const std::vector<GLubyte> &data) {
+		glGenTextures(1, texture);
+		glBindTexture(GL_TEXTURE_2D, *texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, count, 1, 0,
+		             GL_LUMINANCE, GL_UNSIGNED_BYTE, data.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	};
+
+	create_table(&this->priority_texture, priority_data);
+	create_table(&this->blendmode_texture, blendmode_data);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	const terrainblend_program &blend = this->blend_shader();
+	blend.program->use();
+	glUniform1f(blend.terrain_count, count);
+	glUniform1f(blend.grid_size, chunk_id_grid_size);
+	glUniform1fv(blend.adjacent_masks, 16, adjacent_mask_ids);
+	blend.program->stopusing();
+}
+
+
+bool TerrainRenderer::uses_arrays() {
+	if (not this->arrays_checked) {
+		this->arrays_checked = true;
+		this->use_arrays = (terrainarray_shader::program != nullptr and
+		                    terrainblend_shader::arrays.program != nullptr and
+		                    this->terrain->texture_array() != nullptr and
+		                    this->terrain->blending_mask_array() != nullptr);
+
+		log::log(MSG(dbg) << "terrain is drawn "
+		         << (this->use_arrays ? "from texture arrays" : "with a texture per terrain"));
+	}
+	return this->use_arrays;
+}
+
+
+const terrainblend_program &TerrainRenderer::blend_shader() const {
+	if (this->use_arrays) {
+		return terrainblend_shader::arrays;
+	}
+	return terrainblend_shader::textures;
+}
+
+
+const std::vector<GLfloat> &TerrainRenderer::get_mask_rects(int blend_mode) {
+	auto it = this->mask_rects.find(blend_mode);
+	if (it != this->mask_rects.end()) {
+		return it->second;
+	}
+
+	// left, top, right, bottom of each mask
+	std::vector<GLfloat> rects(blending_mask_count * 4, 0);
+
+	Texture *mask_tex = this->terrain->blending_mask(blend_mode);
+	TextureArray *mask_array = this->use_arrays ? this->terrain->blending_mask_array() : nullptr;
+	int count = std::min(mask_tex->get_subtexture_count(), blending_mask_count);
+	for (int mask_id = 0; mask_id < count; mask_id++) {
+		GLfloat *rect = &rects[mask_id * 4];
+		if (mask_array != nullptr) {
+			mask_array->get_subtexture_coordinates(mask_tex, mask_id, &rect[0], &rect[2], &rect[1], &rect[3]);
+		}
+		else {
+			mask_tex->get_subtexture_coordinates(mask_id, &rect[0], &rect[2], &rect[1], &rect[3]);
+		}
+	}
+
+	return this->mask_rects.emplace(blend_mode, std::move(rects)).first->second;
+}
+
+
+terrain_chunk_buffer &TerrainRenderer::update_chunk(const chunk_draw_data &chunk) {
+	auto it = this->buffers.find(chunk.position);
+
+	if (it == this->buffers.end()) {
+		terrain_chunk_buffer buffer;
+		buffer.prerendered = 0;
+		buffer.prerendered_revision = 0;
+		buffer.prerendered_blending = false;
+		buffer.prerendered_incomplete = false;
+		buffer.last_drawn = 0;
+		glGenBuffers(1, &buffer.vertbuf);
+		glGenBuffers(1, &buffer.blendbuf);
+		glGenTextures(1, &buffer.tile_ids);
+
+		glBindTexture(GL_TEXTURE_2D, buffer.tile_ids);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		it = this->buffers.emplace(chunk.position, std::move(buffer)).first;
+		this->upload_chunk(chunk, it->second);
+	}
+	else if (it->second.revision != chunk.revision) {
+		this->upload_chunk(chunk, it->second);
+	}
+
+	return it->second;
+}
+
+
+void TerrainRenderer::upload_chunk(const chunk_draw_data &chunk,
+                                   terrain_chunk_buffer &buffer) {
+
+	// gather all tiles and order them by texture.
+	std::vector<const tile_data *> tiles;
+
+	for (size_t t = 0; t < chunk_size * chunk_size; t++) {
+		const tile_data &tile = chunk.tiles.get()[t];
+		if (tile.state == tile_state::existing) {
+			tiles.push_back(&tile);
+		}
+	}
+
+	std::stable_sort(std::begin(tiles), std::end(tiles),
+		[](const tile_data *a, const tile_data *b) {
+			return std::less<Texture *>{}(a->tex, b->tex);
+		}
+	);
+
+	this->reserve_indices(tiles.size());
+
+	std::vector<terrain_vertex> vertices;
+	vertices.reserve(tiles.size() * 4);
+
+	// all positions are relative to the chunk origin
+	coord::chunk position = chunk.position;
+	coord::phys3 origin = position.to_tile({0, 0}).to_tile3().to_phys3();
+
+	TextureArray *array = this->use_arrays ? this->terrain->texture_array() : nullptr;
+	GLfloat layer = 0;
+
+	buffer.base.clear();
+	buffer.left = buffer.bottom = 0;
+	buffer.right = buffer.top = 0;
+	for (auto tile : tiles) {
+		// begin a new batch if the texture differs
+		if (buffer.base.empty() or buffer.base.back().tex != tile->tex) {
+			buffer.base.push_back({tile->tex, vertices.size() / 4, 0});
+
+			if (array != nullptr) {
+				int tex_layer = array->get_layer(tile->tex);
+				ENSURE(tex_layer >= 0, "terrain texture is not in the texture array: " << tile->tex->get_filename());
+				layer = tex_layer;
+			}
+		}
+		buffer.base.back().quad_count += 1;
+
+		coord::camgame_delta draw_pos = (tile->pos.to_tile3().to_phys3() - origin).to_camgame();
+		tile_quad q = make_quad(tile->tex, tile->subtexture_id, draw_pos, array);
+		extend_bounds(buffer, q);
+
+		vertices.push_back({q.left,  q.top,    q.txl, q.txt, layer});
+		vertices.push_back({q.left,  q.bottom, q.txl, q.txb, layer});
+		vertices.push_back({q.right, q.bottom, q.txr, q.txb, layer});
+		vertices.push_back({q.right, q.top,    q.txr, q.txt, layer});
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.vertbuf);
+	glBufferData(GL_ARRAY_BUFFER,
+	             vertices.size() * sizeof(terrain_vertex),
+	             vertices.data(),
+	             GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	this->upload_blending(chunk, buffer);
+
+	buffer.revision = chunk.revision;
+
+	log::log(MSG(spam) << "uploaded terrain chunk (" << position.ne << ", " << position.se << ") with "
+	         << tiles.size() << " tiles in " << buffer.base.size() << " batches, "
+	         << buffer.blends.size() << " blending batches");
+}
+
+
+void TerrainRenderer::upload_blending(const chunk_draw_data &chunk,
+                                      terrain_chunk_buffer &buffer) {
+	const std::vector<terrain_t> &ids = *chunk.terrain_ids;
+
+	std::vector<GLubyte> pixels;
+	pixels.reserve(ids.size());
+	for (terrain_t id : ids) {
+		pixels.push_back(id + 1);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, buffer.tile_ids);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, chunk_id_grid_size, chunk_id_grid_size, 0,
+	             GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// a terrain of the grid is blended over the tiles of the chunk
+	// that have a lower priority, in one batch for each blending mode.
+	// whether it is a neighbor of the tile is up to the shader.
+	std::set<terrain_t> terrains{std::begin(ids), std::end(ids)};
+	terrains.erase(-1);
+
+	std::set<terrain_t> bases;
+	for (size_t t = 0; t < chunk_size * chunk_size; t++) {
+		const tile_data &tile = chunk.tiles.get()[t];
+		if (tile.state == tile_state::existing) {
+			bases.insert(tile.terrain_id);
+		}
+	}
+
+	// ordered by priority, so the terrains of higher priority are drawn over the others
+	std::set<std::tuple<int, terrain_t, int>> passes;
+	for (terrain_t overlay : terrains) {
+		int priority = this->terrain->priority(overlay);
+		for (terrain_t base : bases) {
+			if (this->terrain->priority(base) < priority) {
+				passes.emplace(priority, overlay, this->terrain->get_blending_mode(base, overlay));
+			}
+		}
+	}
+
+	std::vector<terrain_blend_vertex> vertices;
+
+	coord::chunk position = chunk.position;
+	coord::phys3 origin = position.to_tile({0, 0}).to_tile3().to_phys3();
+
+	TextureArray *array = this->use_arrays ? this->terrain->texture_array() : nullptr;
+
+	buffer.blends.clear();
+	for (auto &pass : passes) {
+		int priority = std::get<0>(pass);
+		terrain_t overlay = std::get<1>(pass);
+		int blend_mode = std::get<2>(pass);
+
+		Texture *tex = this->terrain->texture(overlay);
+		Texture *mask_tex = this->terrain->blending_mask(blend_mode);
+		buffer.blends.push_back({
+			overlay, blend_mode, tex, mask_tex,
+			vertices.size() / 4, 0
+		});
+
+		GLfloat tex_layer = 0;
+		GLfloat mask_layer = 0;
+		if (array != nullptr) {
+			tex_layer = array->get_layer(tex);
+			mask_layer = this->terrain->blending_mask_array()->get_layer(mask_tex);
+		}
+
+		coord::tile_delta pos_on_chunk;
+		for (pos_on_chunk.se = 0; pos_on_chunk.se < (ssize_t) chunk_size; pos_on_chunk.se++) {
+			for (pos_on_chunk.ne = 0; pos_on_chunk.ne < (ssize_t) chunk_size; pos_on_chunk.ne++) {
+				const tile_data &tile = chunk.tiles.get()[pos_on_chunk.se * chunk_size + pos_on_chunk.ne];
+				if (tile.state != tile_state::existing or
+				    tile.priority >= priority or
+				    this->terrain->get_blending_mode(tile.terrain_id, overlay) != blend_mode) {
+					continue;
+				}
+				buffer.blends.back().quad_count += 1;
+
+				coord::camgame_delta draw_pos = (tile.pos.to_tile3().to_phys3() - origin).to_camgame();
+				tile_quad q = make_quad(tex, Terrain::get_subtexture_id(tile.pos, tex->atlas_dimensions), draw_pos, array);
+				extend_bounds(buffer, q);
+
+				// the position in the id grid, which starts one tile before the chunk
+				GLfloat grid_ne = pos_on_chunk.ne + 1;
+				GLfloat grid_se = pos_on_chunk.se + 1;
+				GLfloat variant = (tile.pos.ne + tile.pos.se) & 0x03;
+
+				vertices.push_back({q.left,  q.top,    q.txl, q.txt, 0, 0, grid_ne, grid_se, variant, tex_layer, mask_layer});
+				vertices.push_back({q.left,  q.bottom, q.txl, q.txb, 0, 1, grid_ne, grid_se, variant, tex_layer, mask_layer});
+				vertices.push_back({q.right, q.bottom, q.txr, q.txb, 1, 1, grid_ne, grid_se, variant, tex_layer, mask_layer});
+				vertices.push_back({q.right, q.top,    q.txr, q.txt, 1, 0, grid_ne, grid_se, variant, tex_layer, mask_layer});
+			}
+		}
+	}
+
+	this->reserve_indices(vertices.size() / 4);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.blendbuf);
+	glBufferData(GL_ARRAY_BUFFER,
+	             vertices.size() * sizeof(terrain_blend_vertex),
+	             vertices.data(),
+	             GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void TerrainRenderer::draw_batches(const terrain_chunk_buffer &buffer) {
+	if (buffer.base.empty()) {
+		return;
+	}
+
+	GLint pos_id = texture_shader::program->pos_id;
+	GLint texcoord_id = texture_shader::tex_coord;
+	if (this->use_arrays) {
+		pos_id = terrainarray_shader::program->pos_id;
+		texcoord_id = terrainarray_shader::tex_coord;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.vertbuf);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+
+	// with the texture array, the layer is the third texture coordinate
+	glEnableVertexAttribArray(pos_id);
+	glEnableVertexAttribArray(texcoord_id);
+	glVertexAttribPointer(pos_id, 2, GL_FLOAT, GL_FALSE, sizeof(terrain_vertex),
+	                      (void *)offsetof(terrain_vertex, x));
+	glVertexAttribPointer(texcoord_id, this->use_arrays ? 3 : 2, GL_FLOAT, GL_FALSE, sizeof(terrain_vertex),
+	                      (void *)offsetof(terrain_vertex, tex_u));
+
+	if (this->use_arrays) {
+		// the batches are consecutive, so all of them are drawn at once
+		const terrain_batch &last = buffer.base.back();
+		glDrawElements(GL_TRIANGLES,
+		               (last.first_quad + last.quad_count) * 6,
+		               GL_UNSIGNED_SHORT,
+		               nullptr);
+	}
+	else {
+		for (auto &batch : buffer.base) {
+			glBindTexture(GL_TEXTURE_2D, batch.tex->get_texture_id());
+
+			glDrawElements(GL_TRIANGLES,
+			               batch.quad_count * 6,
+			               GL_UNSIGNED_SHORT,
+			               (void *)(batch.first_quad * 6 * sizeof(GLushort)));
+		}
+	}
+
+	glDisableVertexAttribArray(pos_id);
+	glDisableVertexAttribArray(texcoord_id);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void TerrainRenderer::draw_blends(const terrain_chunk_buffer &buffer) {
+	if (buffer.blends.empty()) {
+		return;
+	}
+
+	const terrainblend_program &blend = this->blend_shader();
+
+	// the layers are only used by the texture array variant
+	GLint attributes[] = {
+		blend.program->pos_id,
+		blend.tex_coord,
+		blend.mask_corner,
+		blend.tile_coord,
+		blend.layers,
+	};
+	size_t attribute_count = this->use_arrays ? 5 : 4;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.blendbuf);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+
+	for (size_t i = 0; i < attribute_count; i++) {
+		glEnableVertexAttribArray(attributes[i]);
+	}
+	glVertexAttribPointer(attributes[0], 2, GL_FLOAT, GL_FALSE, sizeof(terrain_blend_vertex),
+	                      (void *)offsetof(terrain_blend_vertex, x));
+	glVertexAttribPointer(attributes[1], 2, GL_FLOAT, GL_FALSE, sizeof(terrain_blend_vertex),
+	                      (void *)offsetof(terrain_blend_vertex, tex_u));
+	glVertexAttribPointer(attributes[2], 2, GL_FLOAT, GL_FALSE, sizeof(terrain_blend_vertex),
+	                      (void *)offsetof(terrain_blend_vertex, corner_u));
+	glVertexAttribPointer(attributes[3], 3, GL_FLOAT, GL_FALSE, sizeof(terrain_blend_vertex),
+	                      (void *)offsetof(terrain_blend_vertex, tile_ne));
+	if (this->use_arrays) {
+		glVertexAttribPointer(attributes[4], 2, GL_FLOAT, GL_FALSE, sizeof(terrain_blend_vertex),
+		                      (void *)offsetof(terrain_blend_vertex, tex_layer));
+	}
+
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, buffer.tile_ids);
+
+	for (auto &batch : buffer.blends) {
+		glUniform1f(blend.terrain, batch.terrain_id);
+		glUniform1f(blend.blend_mode, batch.blend_mode);
+
+		const std::vector<GLfloat> &rects = this->get_mask_rects(batch.blend_mode);
+		glUniform4fv(blend.mask_rects, blending_mask_count, rects.data());
+
+		// the texture arrays are bound for all batches
+		if (not this->use_arrays) {
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, batch.mask_tex->get_texture_id());
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, batch.tex->get_texture_id());
+		}
+
+		glDrawElements(GL_TRIANGLES,
+		               batch.quad_count * 6,
+		               GL_UNSIGNED_SHORT,
+		               (void *)(batch.first_quad * 6 * sizeof(GLushort)));
+	}
+
+	for (size_t i = 0; i < attribute_count; i++) {
+		glDisableVertexAttribArray(attributes[i]);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void TerrainRenderer::draw(const terrain_render_data &data) {
+	this->frame += 1;
+	this->uses_arrays();
+
+	// update buffers of changed chunks, remember where to draw them.
+	std::vector<visible_chunk> visible;
+	visible.reserve(data.chunks.size());
+
+	for (auto &chunk : data.chunks) {
+		terrain_chunk_buffer &buffer = this->update_chunk(chunk);
+		buffer.last_drawn = this->frame;
+		visible.push_back({chunk.origin, &buffer});
+	}
+
+	if (data.blending and this->priority_texture == 0) {
+		this->prepare_blending();
+	}
+
+	this->update_prerendered(visible, data.blending, data.prerender_limit);
+
+	std::vector<visible_chunk> batched;
+	std::vector<visible_chunk> prerendered;
+	for (auto &chunk : visible) {
+		// outdated textures are not drawn, the chunk may not
+		// have been rendered again in this frame
+		const terrain_chunk_buffer &buffer = *chunk.second;
+		if (buffer.prerendered != 0 and
+		    buffer.prerendered_revision == buffer.revision and
+		    buffer.prerendered_blending == data.blending) {
+			prerendered.push_back(chunk);
+		}
+		else {
+			batched.push_back(chunk);
+		}
+	}
+
+	this->draw_chunks(batched, data.blending);
+	this->draw_prerendered(prerendered);
+}
+
+
+void TerrainRenderer::draw_chunks(const std::vector<visible_chunk> &chunks, bool blending) {
+	if (chunks.empty()) {
+		return;
+	}
+
+	glColor4f(1, 1, 1, 1);
+
+	// first pass: plain base tiles
+	shader::Program *base_program = texture_shader::program;
+	if (this->use_arrays) {
+		base_program = terrainarray_shader::program;
+	}
+	base_program->use();
+	glActiveTexture(GL_TEXTURE0);
+	glEnable(GL_TEXTURE_2D);
+
+	// the textures of all terrains, for both passes
+	if (this->use_arrays) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->terrain->texture_array()->get_texture_id());
+		if (blending) {
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, this->terrain->blending_mask_array()->get_texture_id());
+			glActiveTexture(GL_TEXTURE0);
+		}
+	}
+
+	for (auto &chunk : chunks) {
+		glPushMatrix(); {
+			glTranslatef(chunk.first.x, chunk.first.y, 0);
+			this->draw_batches(*chunk.second);
+		}
+		glPopMatrix();
+	}
+
+	base_program->stopusing();
+
+	// second pass: the terrains blended over their neighbors
+	if (blending) {
+		const terrainblend_program &blend = this->blend_shader();
+		blend.program->use();
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, this->priority_texture);
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_2D, this->blendmode_texture);
+		glActiveTexture(GL_TEXTURE0);
+
+		for (auto &chunk : chunks) {
+			glPushMatrix(); {
+				glTranslatef(chunk.first.x, chunk.first.y, 0);
+				this->draw_blends(*chunk.second);
+			}
+			glPopMatrix();
+		}
+
+		blend.program->stopusing();
+
+		for (GLenum unit : {GL_TEXTURE4, GL_TEXTURE3, GL_TEXTURE2, GL_TEXTURE1}) {
+			glActiveTexture(unit);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	if (this->use_arrays) {
+		for (GLenum unit : {GL_TEXTURE1, GL_TEXTURE0}) {
+			glActiveTexture(unit);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		}
+	}
+
+	glDisable(GL_TEXTURE_2D);
+}
+
+
+void TerrainRenderer::update_prerendered(const std::vector<visible_chunk> &chunks, bool blending, size_t limit) {
+	// free the textures of the chunks that were not drawn for the longest
+	// time, the visible ones keep theirs so they are not rendered each frame.
+	if (this->prerendered_count > limit) {
+		std::vector<terrain_chunk_buffer *> held;
+		for (auto &entry : this->buffers) {
+			if (entry.second.prerendered != 0) {
+				held.push_back(&entry.second);
+			}
+		}
+		std::sort(std::begin(held), std::end(held),
+			[](const terrain_chunk_buffer *a, const terrain_chunk_buffer *b) {
+				return a->last_drawn < b->last_drawn;
+			}
+		);
+		for (terrain_chunk_buffer *buffer : held) {
+			if (this->prerendered_count <= limit) {
+				break;
+			}
+			this->release_prerendered(*buffer);
+		}
+	}
+
+	// the rendering is spread over some frames,
+	// the remaining chunks are drawn from their batches meanwhile.
+	size_t rendered = 0;
+
+	for (auto &chunk : chunks) {
+		if (rendered >= max_prerenders_per_frame) {
+			break;
+		}
+		terrain_chunk_buffer &buffer = *chunk.second;
+
+		if (buffer.prerendered == 0) {
+			if (this->prerendered_count >= limit) {
+				// take over the texture of the chunk that
+				// was not drawn for the longest time
+				terrain_chunk_buffer *oldest = nullptr;
+				for (auto &entry : this->buffers) {
+					terrain_chunk_buffer &other = entry.second;
+					if (other.prerendered != 0 and other.last_drawn != this->frame and
+					    (oldest == nullptr or other.last_drawn < oldest->last_drawn)) {
+						oldest = &other;
+					}
+				}
+				if (oldest == nullptr) {
+					continue;
+				}
+				this->release_prerendered(*oldest);
+			}
+		}
+		else if (buffer.prerendered_revision == buffer.revision and
+		         buffer.prerendered_blending == blending and
+		         not buffer.prerendered_incomplete) {
+			continue;
+		}
+
+		this->prerender(buffer, blending);
+		rendered += 1;
+	}
+}
+
+
+void TerrainRenderer::prerender(terrain_chunk_buffer &buffer, bool blending) {
+	// whole pixels, so the texture is drawn without filtering
+	GLint left = std::floor(buffer.left);
+	GLint bottom = std::floor(buffer.bottom);
+	GLsizei width = std::max<GLint>(1, std::ceil(buffer.right) - left);
+	GLsizei height = std::max<GLint>(1, std::ceil(buffer.top) - bottom);
+
+	if (buffer.prerendered == 0) {
+		glGenTextures(1, &buffer.prerendered);
+		this->prerendered_count += 1;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, buffer.prerendered);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+	             GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (this->framebuffer == 0) {
+		glGenFramebuffers(1, &this->framebuffer);
+	}
+
+	GLint previous_framebuffer;
+	GLint viewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.prerendered, 0);
+	glViewport(0, 0, width, height);
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// the chunk origin is at (-left, -bottom) in the texture
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(left, left + width, bottom, bottom + height, 9001, -1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	// the alpha is accumulated instead of blended, otherwise the
+	// blending masks would leave translucent pixels in the texture
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	this->draw_chunks({{coord::camgame{0, 0}, &buffer}}, blending);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glBindTexture(GL_TEXTURE_2D, buffer.prerendered);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	buffer.prerendered_revision = buffer.revision;
+	buffer.prerendered_blending = blending;
+	buffer.prerendered_incomplete = not this->textures_loaded(buffer);
+}
+
+
+void TerrainRenderer::draw_prerendered(const std::vector<visible_chunk> &chunks) {
+	if (chunks.empty()) {
+		return;
+	}
+
+	std::vector<terrain_vertex> vertices;
+	vertices.reserve(chunks.size() * 4);
+	for (auto &chunk : chunks) {
+		const terrain_chunk_buffer &buffer = *chunk.second;
+		GLfloat left = chunk.first.x + std::floor(buffer.left);
+		GLfloat bottom = chunk.first.y + std::floor(buffer.bottom);
+		GLfloat right = chunk.first.x + std::ceil(buffer.right);
+		GLfloat top = chunk.first.y + std::ceil(buffer.top);
+		right = std::max(right, left + 1);
+		top = std::max(top, bottom + 1);
+
+		vertices.push_back({left,  top,    0, 1, 0});
+		vertices.push_back({left,  bottom, 0, 0, 0});
+		vertices.push_back({right, bottom, 1, 0, 0});
+		vertices.push_back({right, top,    1, 1, 0});
+	}
+
+	this->reserve_indices(chunks.size());
+
+	if (this->quad_buffer == 0) {
+		glGenBuffers(1, &this->quad_buffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, this->quad_buffer);
+	glBufferData(GL_ARRAY_BUFFER,
+	             vertices.size() * sizeof(terrain_vertex),
+	             vertices.data(),
+	             GL_STREAM_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer);
+
+	glColor4f(1, 1, 1, 1);
+	texture_shader::program->use();
+	glActiveTexture(GL_TEXTURE0);
+	glEnable(GL_TEXTURE_2D);
+
+	GLint pos_id = texture_shader::program->pos_id;
+	GLint texcoord_id = texture_shader::tex_coord;
+	glEnableVertexAttribArray(pos_id);
+	glEnableVertexAttribArray(texcoord_id);
+	glVertexAttribPointer(pos_id, 2, GL_FLOAT, GL_FALSE, sizeof(terrain_vertex),
+	                      (void *)offsetof(terrain_vertex, x));
+	glVertexAttribPointer(texcoord_id, 2, GL_FLOAT, GL_FALSE, sizeof(terrain_vertex),
+	                      (void *)offsetof(terrain_vertex, tex_u));
+
+	for (size_t i = 0; i < chunks.size(); i++) {
+		glBindTexture(GL_TEXTURE_2D, chunks[i].second->prerendered);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT,
+		               (void *)(i * 6 * sizeof(GLushort)));
+	}
+
+	glDisableVertexAttribArray(pos_id);
+	glDisableVertexAttribArray(texcoord_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	texture_shader::program->stopusing();
+	glDisable(GL_TEXTURE_2D);
+}
+
+
+void TerrainRenderer::release_prerendered(terrain_chunk_buffer &buffer) {
+	if (buffer.prerendered == 0) {
+		return;
+	}
+
+	glDeleteTextures(1, &buffer.prerendered);
+	buffer.prerendered = 0;
+	this->prerendered_count -= 1;
+}
+
+
+bool TerrainRenderer::textures_loaded(const terrain_chunk_buffer &buffer) const {
+	// the arrays are uploaded with all their layers
+	if (this->use_arrays) {
+		return true;
+	}
+
+	auto loaded = [](const Texture *tex) {
+		return tex->is_in_atlas() or tex->is_resident();
+	};
+
+	for (auto &batch : buffer.base) {
+		if (not loaded(batch.tex)) {
+			return false;
+		}
+	}
+	for (auto &batch : buffer.blends) {
+		if (not loaded(batch.tex) or not loaded(batch.mask_tex)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace openage
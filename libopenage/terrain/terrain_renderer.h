@@ -0,0 +1,372 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../shader/program.h"
+#include "terrain.h"
+
+namespace openage {
+
+class Texture;
+class TextureArray;
+
+/**
+ * a variant of the terrain blending shader and its locations.
+ */
+struct terrainblend_program {
+	shader::Program *program = nullptr;
+	GLint base_texture, mask_texture, tile_ids, terrain_priorities, terrain_blendmodes;
+	GLint grid_size, terrain_count, terrain, blend_mode, mask_rects, adjacent_masks;
+	GLint tex_coord, mask_corner, tile_coord;
+
+	/**
+	 * the layers of the terrain and the mask,
+	 * only used by the texture array variant.
+	 */
+	GLint layers = -1;
+
+	/**
+	 * link the program, look up the locations and assign the texture units.
+	 */
+	void setup(shader::Program *program, bool texture_arrays);
+};
+
+namespace terrainblend_shader {
+/**
+ * blends the textures bound for each batch.
+ */
+extern terrainblend_program textures;
+
+/**
+ * blends from the terrain texture arrays,
+ * without program if they aren't supported.
+ */
+extern terrainblend_program arrays;
+} // namespace terrainblend_shader
+
+namespace terrainarray_shader {
+/**
+ * draws the base tiles from the terrain texture array,
+ * nullptr if it isn't supported.
+ */
+extern shader::Program *program;
+extern GLint texture, tex_coord;
+} // namespace terrainarray_shader
+
+/**
+ * one vertex of a terrain quad.
+ *
+ * the position is relative to the origin of the chunk,
+ * so the buffer stays valid when the camera moves.
+ */
+struct terrain_vertex {
+	GLfloat x, y;
+	GLfloat tex_u, tex_v;
+
+	/** layer of the texture in the terrain texture array */
+	GLfloat layer;
+};
+
+/**
+ * one vertex of a quad that blends a terrain over a tile.
+ * the masks are chosen by the shader.
+ */
+struct terrain_blend_vertex {
+	GLfloat x, y;
+	GLfloat tex_u, tex_v;
+
+	/** 0..1 over the quad, mapped onto the chosen mask */
+	GLfloat corner_u, corner_v;
+
+	/** position of the tile in the id grid of the chunk */
+	GLfloat tile_ne, tile_se;
+
+	/** which of the 4 variants of the straight masks is used */
+	GLfloat mask_variant;
+
+	/** layers of the terrain and the mask in the texture arrays */
+	GLfloat tex_layer, mask_layer;
+};
+
+/**
+ * a range of quads in a chunk buffer that can be drawn
+ * with one draw call: all of them use the same terrain texture.
+ */
+struct terrain_batch {
+	Texture *tex;
+	size_t first_quad;   //!< offset of the first quad in the vertex buffer
+	size_t quad_count;
+};
+
+/**
+ * quads of a chunk over which one terrain is blended with one blending mode.
+ */
+struct terrain_blend_batch {
+	terrain_t terrain_id;
+	int blend_mode;
+	Texture *tex;
+	Texture *mask_tex;
+	size_t first_quad;
+	size_t quad_count;
+};
+
+/**
+ * gpu-side storage for one terrain chunk.
+ */
+struct terrain_chunk_buffer {
+	GLuint vertbuf;
+	GLuint blendbuf;
+
+	/**
+	 * texture of the terrain id of each tile in the chunk's id grid.
+	 */
+	GLuint tile_ids;
+
+	/**
+	 * base tile batches, drawn first.
+	 */
+	std::vector<terrain_batch> base;
+
+	/**
+	 * blending batches, ordered by the priority of their terrain.
+	 */
+	std::vector<terrain_blend_batch> blends;
+
+	/**
+	 * revision of the chunk drawing data this buffer was created from.
+	 * used to detect whether a reupload is necessary.
+	 */
+	size_t revision;
+
+	/**
+	 * bounds of all quads, relative to the chunk origin.
+	 */
+	GLfloat left, right, bottom, top;
+
+	/**
+	 * the chunk's blended terrain rendered into a texture with mipmaps,
+	 * or 0 if the chunk is drawn from its batches.
+	 */
+	GLuint prerendered;
+
+	/**
+	 * the revision and blending setting the texture was rendered with.
+	 */
+	size_t prerendered_revision;
+	bool prerendered_blending;
+
+	/**
+	 * the textures were not loaded yet when it was rendered,
+	 * so it's rendered again.
+	 */
+	bool prerendered_incomplete;
+
+	/**
+	 * frame of the renderer in which the chunk was drawn last.
+	 */
+	uint64_t last_drawn;
+};
+
+/**
+ * draws the terrain chunk-wise in batches.
+ *
+ * instead of issuing one draw call per tile layer, which switches
+ * textures and uploads four vertices each time, the tiles of a chunk
+ * are stored in one vertex buffer. the base tiles are grouped by
+ * terrain texture, so each group is drawn with one indexed draw call.
+ *
+ * the blending is done by the terrainblend shader: the terrain ids of a
+ * chunk and its border are uploaded as a texture, and each terrain is drawn
+ * over the tiles of lower priority. the shader looks at the neighbors of the
+ * tile to select the blendomatic masks, see doc/media/blendomatic.
+ *
+ * chunk buffers are only rebuilt if the draw revision of the chunk changed.
+ *
+ * if the driver supports texture arrays and the game data packed the
+ * terrain textures and blending masks into them, each vertex carries the
+ * layer of its texture instead. the arrays are bound once per frame, and
+ * the base tiles of a chunk are drawn with a single draw call, no matter
+ * how many terrain types are visible.
+ *
+ * when many chunks are visible, drawing all their batches each frame
+ * costs more than the tiles are worth. a limited number of chunks
+ * is therefore rendered into a texture once, and drawn as one quad
+ * until their terrain changes. the textures have mipmaps, so they
+ * are drawn smaller without aliasing. the textures of the chunks that
+ * were not drawn for the longest time are reused first.
+ */
+class TerrainRenderer {
+public:
+	TerrainRenderer(Terrain *terrain);
+	~TerrainRenderer();
+
+	/**
+	 * draw the given render data,
+	 * as created by Terrain::create_draw_advice.
+	 */
+	void draw(const terrain_render_data &data);
+
+	/**
+	 * drop all gpu buffers, they will be recreated when needed.
+	 */
+	void clear();
+
+private:
+	using visible_chunk = std::pair<coord::camgame, terrain_chunk_buffer *>;
+
+	/**
+	 * draw the batches of the chunks in both passes.
+	 */
+	void draw_chunks(const std::vector<visible_chunk> &chunks, bool blending);
+
+	/**
+	 * pick the visible chunks that are drawn from textures within the
+	 * limit, free the textures beyond it, and render the outdated ones.
+	 */
+	void update_prerendered(const std::vector<visible_chunk> &chunks, bool blending, size_t limit);
+
+	/**
+	 * render the batches of a chunk into its texture.
+	 */
+	void prerender(terrain_chunk_buffer &buffer, bool blending);
+
+	/**
+	 * draw the textures of prerendered chunks, one quad each.
+	 */
+	void draw_prerendered(const std::vector<visible_chunk> &chunks);
+
+	/**
+	 * free the texture of a prerendered chunk.
+	 */
+	void release_prerendered(terrain_chunk_buffer &buffer);
+
+	/**
+	 * whether the terrain is drawn from the texture arrays.
+	 * decided at the first draw, as it needs the gl context.
+	 */
+	bool uses_arrays();
+
+	/**
+	 * whether the textures of all batches were loaded,
+	 * instead of being drawn as placeholder.
+	 */
+	bool textures_loaded(const terrain_chunk_buffer &buffer) const;
+
+	/**
+	 * create or update the buffer for a chunk if the tile data changed.
+	 */
+	terrain_chunk_buffer &update_chunk(const chunk_draw_data &chunk);
+
+	/**
+	 * fill the vertex buffer of a chunk from its tiles.
+	 */
+	void upload_chunk(const chunk_draw_data &chunk,
+	                  terrain_chunk_buffer &buffer);
+
+	/**
+	 * fill the blending vertex buffer and the id texture of a chunk
+	 * from its terrain id grid.
+	 */
+	void upload_blending(const chunk_draw_data &chunk,
+	                     terrain_chunk_buffer &buffer);
+
+	/**
+	 * draw the base batches of the buffer.
+	 */
+	void draw_batches(const terrain_chunk_buffer &buffer);
+
+	/**
+	 * draw the blending batches of the buffer.
+	 */
+	void draw_blends(const terrain_chunk_buffer &buffer);
+
+	/**
+	 * create the priority and blending mode lookup textures,
+	 * and fill the uniforms that stay the same for all chunks.
+	 */
+	void prepare_blending();
+
+	/**
+	 * the variant of the blending shader that is used.
+	 */
+	const terrainblend_program &blend_shader() const;
+
+	/**
+	 * the texture coordinates of the masks in a blending mask texture,
+	 * or in its layer of the mask array, as uploaded to the mask_rects uniform.
+	 */
+	const std::vector<GLfloat> &get_mask_rects(int blend_mode);
+
+	/**
+	 * make sure the shared quad index buffer contains
+	 * indices for at least the given number of quads.
+	 */
+	void reserve_indices(size_t quad_count);
+
+	/**
+	 * the terrain whose textures and blending data are used.
+	 */
+	Terrain *terrain;
+
+	/**
+	 * index buffer with the two triangles for each quad.
+	 * shared by all chunk buffers.
+	 */
+	GLuint index_buffer;
+
+	/**
+	 * number of quads the index buffer can address.
+	 */
+	size_t index_capacity;
+
+	/**
+	 * lookup textures: priority rank and blending mode by terrain id.
+	 */
+	GLuint priority_texture;
+	GLuint blendmode_texture;
+
+	/**
+	 * mask texture coordinates for each blending mode.
+	 */
+	std::unordered_map<int, std::vector<GLfloat>> mask_rects;
+
+	/**
+	 * gpu buffers for all chunks drawn so far.
+	 */
+	std::unordered_map<coord::chunk, terrain_chunk_buffer, coord_chunk_hash> buffers;
+
+	/**
+	 * render target for the prerendered chunks.
+	 */
+	GLuint framebuffer;
+
+	/**
+	 * vertices of the quads of prerendered chunks, refilled each frame.
+	 */
+	GLuint quad_buffer;
+
+	/**
+	 * number of chunks with a prerendered texture.
+	 */
+	size_t prerendered_count;
+
+	/**
+	 * number of draw calls, to find the chunks not drawn for the longest time.
+	 */
+	uint64_t frame;
+
+	/**
+	 * whether uses_arrays decided already, and its result.
+	 */
+	bool arrays_checked;
+	bool use_arrays;
+};
+
+} // namespace openage
@@ -1,7 +1,8 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include <cmath>
 
+#include "spatial_index.h"
 #include "terrain.h"
 #include "terrain_object.h"
 #include "terrain_search.h"
@@ -10,47 +11,20 @@ namespace openage {
 
 TerrainObject *find_near(const TerrainObject &start,
                          std::function<bool(const TerrainObject &)> found,
-                         unsigned int search_limit) {
-
-	auto terrain = start.get_terrain();
-	auto tile = start.pos.draw.to_tile3().to_tile();
-	TerrainSearch search(terrain, tile);
-
-	for (unsigned int i = 0; i < search_limit; ++i) {
-		for (auto o : terrain->get_data(tile)->obj) {
-
-			// invalid pointers are removed when the object is deleted
-			if (found(*o)) {
-				return o;
-			}
-		}
-		tile = search.next_tile();
-	}
-
-	return nullptr;
+                         float search_radius) {
+	return find_in_radius(start, found, search_radius);
 }
 
 TerrainObject *find_in_radius(const TerrainObject &start,
                               std::function<bool(const TerrainObject &)> found,
                               float radius) {
 	auto terrain = start.get_terrain();
-	coord::tile start_tile = start.pos.draw.to_tile3().to_tile();
-	TerrainSearch search(terrain, start_tile, radius);
-
-	// next_tile will first return the starting tile, so we need to run it once. We also
-	// shouldn't discard this tile - if it isn't useful, ignore it in found
-	coord::tile tile = search.next_tile();
-	do {
-		for (auto o : terrain->get_data(tile)->obj) {
-			if (found(*o)) {
-				return o;
-			}
-		}
-		tile = search.next_tile();
-		// coord::tile doesn't have a != operator, so we need to use !(a==b)
-	} while (!(tile == start_tile));
+	if (!terrain) {
+		return nullptr;
+	}
 
-	return nullptr;
+	auto max_distance = static_cast<coord::phys_t>(radius * coord::settings::phys_per_tile);
+	return terrain->get_spatial_index().find_nearest(start.pos.draw, max_distance, found);
 }
 
 TerrainSearch::TerrainSearch(std::shared_ptr<Terrain> t, coord::tile s)
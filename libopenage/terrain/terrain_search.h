@@ -1,23 +1,33 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <functional>
 #include <memory>
 #include <queue>
-#include <unordered_set>
 #include <vector>
 
 #include "../coord/tile.h"
+#include "../datastructure/flat_hash_map.h"
 
 namespace openage {
 
 class Terrain;
 class TerrainObject;
 
+/**
+ * the nearest object to the start object which matches the predicate,
+ * looked up in the spatial index of the terrain.
+ *
+ * @param search_radius maximum distance in tiles
+ */
 TerrainObject *find_near(const TerrainObject &start,
                          std::function<bool(const TerrainObject &)> found,
-                         unsigned int search_limit=500);
+                         float search_radius=16.0f);
+
+/**
+ * like find_near, but with a mandatory radius in tiles.
+ */
 TerrainObject *find_in_radius(const TerrainObject &start,
                               std::function<bool(const TerrainObject &)> found,
                               float radius);
@@ -66,7 +76,7 @@ private:
 	const std::shared_ptr<Terrain> terrain;
 	const coord::tile start;
 	std::queue<coord::tile> tiles;
-	std::unordered_set<coord::tile> visited;
+	datastructure::FlatHashSet<coord::tile, datastructure::coord_hash> visited;
 	float previous_radius, max_radius;
 
 };
@@ -0,0 +1,169 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "tile_changes.h"
+
+#include <algorithm>
+
+#include "../error/error.h"
+
+namespace openage {
+
+namespace {
+
+uint64_t chunk_key(coord::chunk position) {
+	return (static_cast<uint64_t>(static_cast<uint32_t>(position.ne)) << 32) |
+	       static_cast<uint32_t>(position.se);
+}
+
+} // anonymous namespace
+
+
+TileChangeLog::TileChangeLog()
+	:
+	current{std::make_unique<tile_changes>()},
+	first_sequence{0},
+	subscriber_count{0} {
+
+	this->current->tick = 0;
+}
+
+
+TileChangeLog::~TileChangeLog() = default;
+
+
+TileChangeLog::subscription_t TileChangeLog::subscribe() {
+	// the subscriber gets no changes from before
+	this->publish();
+	uint64_t next = this->first_sequence + this->published.size();
+
+	subscription_t subscription = this->subscribers.size();
+	for (size_t i = 0; i < this->subscribed.size(); i++) {
+		if (not this->subscribed[i]) {
+			subscription = i;
+			break;
+		}
+	}
+
+	if (subscription == this->subscribers.size()) {
+		this->subscribers.push_back(next);
+		this->subscribed.push_back(true);
+	}
+	else {
+		this->subscribers[subscription] = next;
+		this->subscribed[subscription] = true;
+	}
+
+	this->subscriber_count += 1;
+	this->trim();
+	return subscription;
+}
+
+
+void TileChangeLog::unsubscribe(subscription_t subscription) {
+	if (subscription >= this->subscribed.size() or not this->subscribed[subscription]) {
+		throw Error(MSG(err) << "Tile change subscription " << subscription << " is not subscribed.");
+	}
+
+	this->subscribed[subscription] = false;
+	this->subscriber_count -= 1;
+	this->trim();
+
+	if (this->subscriber_count == 0) {
+		this->current->tiles.clear();
+		this->current->chunks.clear();
+		this->tile_index.clear();
+		this->chunk_index.clear();
+	}
+}
+
+
+void TileChangeLog::mark_chunk(coord::chunk position, uint8_t kinds) {
+	if (this->is_recording()) {
+		this->add_chunk(position, kinds, true);
+	}
+}
+
+
+void TileChangeLog::next_tick(uint64_t tick) {
+	this->publish();
+	this->current->tick = tick;
+}
+
+
+std::vector<std::shared_ptr<const tile_changes>> TileChangeLog::take(subscription_t subscription) {
+	if (subscription >= this->subscribed.size() or not this->subscribed[subscription]) {
+		throw Error(MSG(err) << "Tile change subscription " << subscription << " is not subscribed.");
+	}
+
+	this->publish();
+
+	uint64_t &next = this->subscribers[subscription];
+	std::vector<std::shared_ptr<const tile_changes>> result{
+		std::begin(this->published) + (next - this->first_sequence),
+		std::end(this->published)
+	};
+	next = this->first_sequence + this->published.size();
+
+	this->trim();
+	return result;
+}
+
+
+void TileChangeLog::add(coord::tile position, uint8_t kinds) {
+	auto it = this->tile_index.find(position);
+	if (it != std::end(this->tile_index)) {
+		this->current->tiles[it->second].kinds |= kinds;
+	}
+	else {
+		this->tile_index.emplace(position, this->current->tiles.size());
+		this->current->tiles.push_back(changed_tile{position, kinds});
+	}
+
+	this->add_chunk(position.to_chunk(), kinds, false);
+}
+
+
+void TileChangeLog::add_chunk(coord::chunk position, uint8_t kinds, bool all_tiles) {
+	uint64_t key = chunk_key(position);
+	auto it = this->chunk_index.find(key);
+	if (it != std::end(this->chunk_index)) {
+		changed_chunk &chunk = this->current->chunks[it->second];
+		chunk.kinds |= kinds;
+		chunk.all_tiles = chunk.all_tiles or all_tiles;
+	}
+	else {
+		this->chunk_index.emplace(key, this->current->chunks.size());
+		this->current->chunks.push_back(changed_chunk{position, kinds, all_tiles});
+	}
+}
+
+
+void TileChangeLog::publish() {
+	if (this->current->empty()) {
+		return;
+	}
+
+	uint64_t tick = this->current->tick;
+	this->published.push_back(std::move(this->current));
+	this->current = std::make_unique<tile_changes>();
+	this->current->tick = tick;
+	this->tile_index.clear();
+	this->chunk_index.clear();
+}
+
+
+void TileChangeLog::trim() {
+	uint64_t taken = this->first_sequence + this->published.size();
+	for (size_t i = 0; i < this->subscribers.size(); i++) {
+		if (this->subscribed[i]) {
+			taken = std::min(taken, this->subscribers[i]);
+		}
+	}
+
+	while (this->first_sequence < taken) {
+		this->published.pop_front();
+		this->first_sequence += 1;
+	}
+}
+
+} // openage
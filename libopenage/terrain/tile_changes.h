@@ -0,0 +1,168 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../coord/chunk.h"
+#include "../coord/tile.h"
+
+namespace openage {
+
+/**
+ * the kinds of changes of a tile, combined as bits.
+ */
+namespace tile_change {
+constexpr uint8_t terrain = 1 << 0;         //!< the terrain id changed
+constexpr uint8_t object_added = 1 << 1;    //!< an object was placed on it
+constexpr uint8_t object_removed = 1 << 2;  //!< an object was removed from it
+constexpr uint8_t object_moved = 1 << 3;    //!< an object moved onto or off it
+} // tile_change
+
+
+struct changed_tile {
+	coord::tile position;
+	uint8_t kinds;
+};
+
+
+struct changed_chunk {
+	coord::chunk position;
+
+	/**
+	 * the kinds of the changed tiles on the chunk.
+	 */
+	uint8_t kinds;
+
+	/**
+	 * the whole chunk changed, e.g. because it was loaded.
+	 * its tiles are not listed one by one then.
+	 */
+	bool all_tiles;
+};
+
+
+/**
+ * the changes of one tick, each tile and chunk listed once.
+ */
+struct tile_changes {
+	uint64_t tick;
+
+	std::vector<changed_tile> tiles;
+
+	/**
+	 * the chunks of the changed tiles, and the chunks that
+	 * changed as a whole.
+	 */
+	std::vector<changed_chunk> chunks;
+
+	bool empty() const {
+		return this->tiles.empty() and this->chunks.empty();
+	}
+};
+
+
+/**
+ * Collects which tiles of a terrain change, so caches and views that
+ * are derived from the terrain update only these tiles instead of
+ * scanning the map.
+ *
+ * The changes are gathered per tick. Each subscriber takes the changes
+ * of the ticks since it took them last, the lists of one tick are shared
+ * by all of them. Nothing is recorded while there are no subscribers.
+ */
+class TileChangeLog {
+public:
+	using subscription_t = size_t;
+
+	TileChangeLog();
+	~TileChangeLog();
+
+	TileChangeLog(const TileChangeLog &) = delete;
+	TileChangeLog &operator =(const TileChangeLog &) = delete;
+
+	/**
+	 * the changes from now on are kept for a new subscriber.
+	 */
+	subscription_t subscribe();
+
+	void unsubscribe(subscription_t subscription);
+
+	/**
+	 * whether changes are recorded, so callers can skip
+	 * collecting the tiles otherwise.
+	 */
+	bool is_recording() const {
+		return this->subscriber_count > 0;
+	}
+
+	/**
+	 * note a change of a tile.
+	 */
+	void mark(coord::tile position, uint8_t kinds) {
+		if (this->is_recording()) {
+			this->add(position, kinds);
+		}
+	}
+
+	/**
+	 * note that a whole chunk changed.
+	 */
+	void mark_chunk(coord::chunk position, uint8_t kinds);
+
+	/**
+	 * completes the changes of the current tick, called
+	 * before the next one is simulated.
+	 */
+	void next_tick(uint64_t tick);
+
+	/**
+	 * the changes since the last call for the subscriber, oldest first.
+	 * the changes of the current tick are completed early for this,
+	 * so later changes of it come in another list of the same tick.
+	 */
+	std::vector<std::shared_ptr<const tile_changes>> take(subscription_t subscription);
+
+private:
+	void add(coord::tile position, uint8_t kinds);
+	void add_chunk(coord::chunk position, uint8_t kinds, bool all_tiles);
+
+	/**
+	 * moves the changes of the current tick to the published ones.
+	 */
+	void publish();
+
+	/**
+	 * drops the published changes that all subscribers took.
+	 */
+	void trim();
+
+	/**
+	 * the changes of the current tick, and the indices
+	 * of the tiles and chunks in them.
+	 */
+	std::unique_ptr<tile_changes> current;
+	std::unordered_map<coord::tile, size_t> tile_index;
+	std::unordered_map<uint64_t, size_t> chunk_index;
+
+	/**
+	 * the published changes, the first one has the sequence number
+	 * first_sequence.
+	 */
+	std::deque<std::shared_ptr<const tile_changes>> published;
+	uint64_t first_sequence;
+
+	/**
+	 * the sequence number of the next changes each subscriber takes,
+	 * by subscription. unsubscribed entries are unused.
+	 */
+	std::vector<uint64_t> subscribers;
+	std::vector<bool> subscribed;
+	size_t subscriber_count;
+};
+
+} // openage
@@ -0,0 +1,75 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "tile_changes.h"
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace terrain {
+namespace tests {
+
+
+// exported test
+void tile_changes() {
+	TileChangeLog log;
+
+	// nothing is recorded without subscribers
+	log.mark(coord::tile{1, 1}, tile_change::terrain);
+	log.is_recording() and TESTFAIL;
+
+	auto minimap = log.subscribe();
+	log.take(minimap).empty() or TESTFAIL;
+
+	// the tiles of a tick are listed once, with all their kinds
+	log.mark(coord::tile{1, 2}, tile_change::object_added);
+	log.mark(coord::tile{3, 4}, tile_change::terrain);
+	log.mark(coord::tile{1, 2}, tile_change::object_moved);
+	log.next_tick(1);
+
+	auto paths = log.subscribe();
+
+	log.mark(coord::tile{1, 2}, tile_change::object_removed);
+	log.mark_chunk(coord::chunk{5, 5}, tile_change::terrain);
+	log.next_tick(2);
+
+	auto changed = log.take(minimap);
+	changed.size() == 2 or TESTFAIL;
+
+	const openage::tile_changes &first = *changed[0];
+	first.tick == 0 or TESTFAIL;
+	first.tiles.size() == 2 or TESTFAIL;
+	(first.tiles[0].position == coord::tile{1, 2}) or TESTFAIL;
+	first.tiles[0].kinds == (tile_change::object_added | tile_change::object_moved) or TESTFAIL;
+	first.tiles[1].kinds == tile_change::terrain or TESTFAIL;
+
+	// both tiles are on the first chunk
+	first.chunks.size() == 1 or TESTFAIL;
+	(first.chunks[0].position == coord::chunk{0, 0}) or TESTFAIL;
+	first.chunks[0].all_tiles and TESTFAIL;
+
+	const openage::tile_changes &second = *changed[1];
+	second.tick == 1 or TESTFAIL;
+	second.tiles.size() == 1 or TESTFAIL;
+	second.chunks.size() == 2 or TESTFAIL;
+	second.chunks[1].all_tiles or TESTFAIL;
+
+	// the later subscriber shares the second list only
+	auto later = log.take(paths);
+	later.size() == 1 or TESTFAIL;
+	later[0] == changed[1] or TESTFAIL;
+
+	log.take(minimap).empty() or TESTFAIL;
+
+	// the changes of the current tick are taken early
+	log.mark(coord::tile{7, 7}, tile_change::terrain);
+	log.take(paths).size() == 1 or TESTFAIL;
+	log.unsubscribe(paths);
+	log.take(minimap).size() == 1 or TESTFAIL;
+
+	log.unsubscribe(minimap);
+	log.is_recording() and TESTFAIL;
+	TESTTHROWS(log.take(minimap));
+}
+
+
+}}} // openage::terrain::tests
@@ -0,0 +1,74 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "tile_objects.h"
+
+#include <utility>
+
+namespace openage {
+
+
+TileObjects::TileObjects()
+	:
+	first{nullptr} {}
+
+
+TileObjects::~TileObjects() {
+	if (this->is_list()) {
+		delete this->get_list();
+	}
+}
+
+
+TileObjects::TileObjects(TileObjects &&other) noexcept
+	:
+	first{other.first} {
+
+	other.first = nullptr;
+}
+
+
+TileObjects &TileObjects::operator =(TileObjects &&other) noexcept {
+	std::swap(this->first, other.first);
+	return *this;
+}
+
+
+void TileObjects::push_back(TerrainObject *obj) {
+	if (this->first == nullptr) {
+		this->first = obj;
+	}
+	else if (this->is_list()) {
+		this->get_list()->push_back(obj);
+	}
+	else {
+		list_t *list = new list_t{this->first, obj};
+		this->first = reinterpret_cast<TerrainObject *>(reinterpret_cast<uintptr_t>(list) | 1);
+	}
+}
+
+
+TileObjects::iterator TileObjects::erase(iterator from, iterator to) {
+	if (from == to) {
+		return from;
+	}
+
+	if (not this->is_list()) {
+		this->first = nullptr;
+		return &this->first;
+	}
+
+	list_t *list = this->get_list();
+	size_t index = from - list->data();
+	list->erase(std::begin(*list) + index, std::begin(*list) + (to - list->data()));
+
+	// a single object is stored without the list again
+	if (list->size() <= 1) {
+		TerrainObject *remaining = list->empty() ? nullptr : list->front();
+		delete list;
+		this->first = remaining;
+	}
+
+	return this->begin() + index;
+}
+
+} // openage
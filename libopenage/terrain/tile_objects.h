@@ -0,0 +1,93 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace openage {
+
+class TerrainObject;
+
+
+/**
+ * The objects on one tile, in one pointer.
+ *
+ * Most tiles have no objects, and most of the others have one, so the
+ * pointer is either null, the only object, or points to a list for
+ * several objects, marked by its lowest bit. Only tiles with several
+ * objects allocate.
+ *
+ * Iterators are pointers, they are invalidated by adding and erasing.
+ */
+class TileObjects {
+public:
+	using iterator = TerrainObject **;
+	using const_iterator = TerrainObject *const *;
+
+	TileObjects();
+	~TileObjects();
+
+	TileObjects(const TileObjects &) = delete;
+	TileObjects &operator =(const TileObjects &) = delete;
+
+	TileObjects(TileObjects &&other) noexcept;
+	TileObjects &operator =(TileObjects &&other) noexcept;
+
+	iterator begin() {
+		return this->is_list() ? this->get_list()->data() : &this->first;
+	}
+
+	iterator end() {
+		return this->begin() + this->size();
+	}
+
+	const_iterator begin() const {
+		return this->is_list() ? this->get_list()->data() : &this->first;
+	}
+
+	const_iterator end() const {
+		return this->begin() + this->size();
+	}
+
+	size_t size() const {
+		if (this->is_list()) {
+			return this->get_list()->size();
+		}
+		return this->first == nullptr ? 0 : 1;
+	}
+
+	bool empty() const {
+		return this->first == nullptr;
+	}
+
+	TerrainObject *operator [](size_t index) const {
+		return this->begin()[index];
+	}
+
+	void push_back(TerrainObject *obj);
+
+	/**
+	 * removes the objects from first to last.
+	 */
+	iterator erase(iterator from, iterator to);
+
+private:
+	using list_t = std::vector<TerrainObject *>;
+
+	bool is_list() const {
+		return reinterpret_cast<uintptr_t>(this->first) & 1;
+	}
+
+	list_t *get_list() const {
+		return reinterpret_cast<list_t *>(reinterpret_cast<uintptr_t>(this->first) & ~uintptr_t{1});
+	}
+
+	/**
+	 * the only object, or the tagged list of objects.
+	 */
+	TerrainObject *first;
+};
+
+} // openage
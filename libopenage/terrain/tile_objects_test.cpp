@@ -0,0 +1,65 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "tile_objects.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace terrain {
+namespace tests {
+
+
+// exported test
+void tile_objects() {
+	// the objects are only compared, never used
+	alignas(8) char storage[3][8];
+	TerrainObject *a = reinterpret_cast<TerrainObject *>(storage[0]);
+	TerrainObject *b = reinterpret_cast<TerrainObject *>(storage[1]);
+	TerrainObject *c = reinterpret_cast<TerrainObject *>(storage[2]);
+
+	sizeof(TileObjects) == sizeof(TerrainObject *) or TESTFAIL;
+
+	TileObjects objects;
+	objects.empty() or TESTFAIL;
+	(objects.begin() == objects.end()) or TESTFAIL;
+
+	objects.push_back(a);
+	objects.size() == 1 or TESTFAIL;
+	objects[0] == a or TESTFAIL;
+
+	objects.push_back(b);
+	objects.push_back(c);
+	objects.size() == 3 or TESTFAIL;
+	(objects[0] == a and objects[1] == b and objects[2] == c) or TESTFAIL;
+
+	// removed the way objects leave a tile
+	auto remove = [&](TerrainObject *obj) {
+		objects.erase(std::remove(std::begin(objects), std::end(objects), obj),
+		              std::end(objects));
+	};
+
+	remove(b);
+	objects.size() == 2 or TESTFAIL;
+	(objects[0] == a and objects[1] == c) or TESTFAIL;
+
+	// the last one is stored alone again
+	remove(a);
+	objects.size() == 1 or TESTFAIL;
+	objects[0] == c or TESTFAIL;
+
+	remove(c);
+	objects.empty() or TESTFAIL;
+
+	// moving takes the list
+	objects.push_back(a);
+	objects.push_back(b);
+	TileObjects moved{std::move(objects)};
+	objects.empty() or TESTFAIL;
+	moved.size() == 2 or TESTFAIL;
+}
+
+
+}}} // openage::terrain::tests
@@ -0,0 +1,89 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../error/error.h"
+#include "../util/timing.h"
+
+namespace openage {
+namespace testing {
+
+
+Benchmark::Benchmark(size_t warmup, size_t iterations)
+	:
+	warmup{warmup},
+	iterations{iterations} {
+
+	if (iterations == 0) {
+		throw Error(MSG(err) << "A benchmark needs at least one iteration");
+	}
+}
+
+
+void Benchmark::measure(const std::string &name, const std::function<void()> &fn) {
+	for (size_t i = 0; i < this->warmup; i++) {
+		fn();
+	}
+
+	std::vector<double> times(this->iterations);
+	for (auto &time : times) {
+		time_nsec_t start = timing::get_monotonic_time();
+		fn();
+		time = timing::get_monotonic_time() - start;
+	}
+
+	std::sort(times.begin(), times.end());
+
+	size_t count = times.size();
+	double sum = 0;
+	for (double time : times) {
+		sum += time;
+	}
+	double mean = sum / count;
+
+	double variance = 0;
+	for (double time : times) {
+		variance += (time - mean) * (time - mean);
+	}
+	if (count > 1) {
+		variance /= count - 1;
+	}
+
+	double median = times[count / 2];
+	if (count % 2 == 0) {
+		median = (times[count / 2 - 1] + median) / 2;
+	}
+
+	this->results.push_back(benchmark_result{
+		name,
+		count,
+		times.front(),
+		median,
+		mean,
+		std::sqrt(variance),
+		times.back()
+	});
+}
+
+
+const std::vector<benchmark_result> &Benchmark::get_results() const {
+	return this->results;
+}
+
+
+void use_result(const void *ptr) {
+	// the compiler has to assume that the memory behind ptr is read,
+	// even when this is inlined by link time optimization
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(ptr) : "memory");
+#else
+	static const void *volatile sink;
+	sink = ptr;
+#endif
+}
+
+
+}} // openage::testing
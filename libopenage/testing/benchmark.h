@@ -0,0 +1,90 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// pxd: from libc.stddef cimport size_t
+// pxd: from libcpp.string cimport string
+
+
+namespace openage {
+namespace testing {
+
+
+/**
+ * The timing statistics of one case of a benchmark,
+ * in nanoseconds per iteration.
+ *
+ * pxd:
+ *
+ * cppclass benchmark_result:
+ *     string name
+ *     size_t iterations
+ *     double min
+ *     double median
+ *     double mean
+ *     double stddev
+ *     double max
+ */
+struct benchmark_result {
+	std::string name;
+	size_t iterations;
+	double min;
+	double median;
+	double mean;
+	double stddev;
+	double max;
+};
+
+
+/**
+ * Passed to each benchmark to run and time its cases.
+ *
+ * A benchmark is registered in benchmarks_cpp() of testlist.py, and is a
+ * function void name(Benchmark &) which calls measure() once per case.
+ * The case names identify the results in the stored baselines, so they
+ * should stay the same even if the code they time changes.
+ */
+class Benchmark {
+public:
+	/**
+	 * @param warmup untimed runs of each case, to fill the caches
+	 * @param iterations timed runs of each case
+	 */
+	Benchmark(size_t warmup, size_t iterations);
+
+	/**
+	 * Runs one case of the benchmark, first warmup times
+	 * without measuring, then iterations times one by one.
+	 *
+	 * One run should take well over a microsecond,
+	 * shorter work is repeated inside of fn.
+	 */
+	void measure(const std::string &name, const std::function<void()> &fn);
+
+	/**
+	 * The statistics of the cases measured so far, in their order.
+	 */
+	const std::vector<benchmark_result> &get_results() const;
+
+private:
+	size_t warmup;
+	size_t iterations;
+
+	std::vector<benchmark_result> results;
+};
+
+
+/**
+ * Hides the value behind ptr from the optimizer,
+ * so the computation of a result that is not used otherwise
+ * is not removed from the benchmark.
+ */
+void use_result(const void *ptr);
+
+
+}} // openage::testing
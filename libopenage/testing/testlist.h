@@ -1,11 +1,16 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <vector>
+
+#include "benchmark.h"
 #include "testing.h"
 
+// pxd: from libc.stddef cimport size_t
 // pxd: from libcpp.string cimport string
 // pxd: from libcpp.vector cimport vector
+// pxd: from libopenage.testing.benchmark cimport benchmark_result
 
 
 namespace openage {
@@ -20,4 +25,13 @@ namespace testing {
 void run_method(const std::string &name);
 
 
+/**
+ * Runs the benchmark with the given name, and returns the timing
+ * statistics of its cases.
+ *
+ * pxd: vector[benchmark_result] run_benchmark(string name, size_t warmup, size_t iterations) except +
+ */
+std::vector<benchmark_result> run_benchmark(const std::string &name, size_t warmup, size_t iterations);
+
+
 }} // openage::testing
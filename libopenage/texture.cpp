@@ -1,4 +1,4 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "texture.h"
 
@@ -10,7 +10,17 @@
 
 #include "log/log.h"
 #include "error/error.h"
+#include "render_command_list.h"
+#include "sprite_batch.h"
+#include "texture_atlas.h"
+#include "texture_container.h"
+#include "texture_palette.h"
+#include "texture_png.h"
+#include "texture_residency.h"
+#include "util/asset_pack.h"
 #include "util/file.h"
+#include "util/metrics.h"
+#include "util/timing.h"
 
 namespace openage {
 
@@ -28,38 +38,198 @@ GLint texture, tex_coord;
 GLint player_id_var, alpha_marker_var, player_color_var;
 }
 
+namespace palette_shader {
+shader::Program *program;
+GLint texture, palette, tex_coord;
+GLint player_id_var, alpha_marker_var, player_color_var;
+}
+
 namespace alphamask_shader {
 shader::Program *program;
 GLint base_texture, mask_texture, base_coord, mask_coord, show_mask;
 }
 
+namespace {
+
+/**
+ * bytes of gpu memory the pixels of the buffer take when uploaded,
+ * 0 if it has none.
+ */
+size_t pending_upload_size(const gl_texture_buffer &buffer, int w, int h) {
+	if (buffer.container) {
+		size_t size = 0;
+		for (auto &level : buffer.container->get_levels()) {
+			size += level.size;
+		}
+		return size;
+	}
+	else if (buffer.data) {
+		return w * h * 4;
+	}
+	else if (buffer.indices) {
+		return w * h + texture_palette_size * 4;
+	}
+	return 0;
+}
+
+} // anonymous namespace
+
 Texture::Texture(int width, int height, std::unique_ptr<uint32_t[]> data)
 	:
-	use_metafile{false} {
+	use_metafile{false},
+	palette_allowed{false},
+	residency{nullptr},
+	last_used{0},
+	atlas{nullptr},
+	atlas_page{0} {
 	ENSURE(glGenBuffers != nullptr, "gl not initialized properly");
 
 	this->w = width;
 	this->h = height;
 	this->buffer = std::make_unique<gl_texture_buffer>();
-	this->buffer->transferred = false;
 	this->buffer->texture_format_in = GL_RGBA8;
 	this->buffer->texture_format_out = GL_RGBA;
 	this->buffer->data = std::move(data);
 	this->subtextures.push_back({0, 0, this->w, this->h, this->w/2, this->h/2});
 }
 
-Texture::Texture(const std::string &filename, bool use_metafile)
+Texture::Texture(const std::string &filename, bool use_metafile, bool with_pixels)
 	:
 	use_metafile{use_metafile},
-	filename{filename} {
-
-	// load the texture upon creation
-	this->load();
+	filename{filename},
+	palette_allowed{false},
+	residency{nullptr},
+	last_used{0},
+	atlas{nullptr},
+	atlas_page{0} {
+
+	if (with_pixels) {
+		// load the texture upon creation
+		this->load();
+	}
+	else {
+		this->use_pixels(std::make_unique<gl_texture_buffer>(), 0, 0);
+	}
 }
 
 void Texture::load() {
+	int w, h;
+	auto pixels = Texture::read_pixels(this->filename, &w, &h);
+	this->use_pixels(std::move(pixels), w, h);
+}
+
+void Texture::use_pixels(std::unique_ptr<gl_texture_buffer> pixels, int w, int h) {
+	{
+		std::lock_guard<std::mutex> lock{this->buffer_mutex};
+		this->buffer = std::move(pixels);
+	}
+	this->w = w;
+	this->h = h;
+
+	if (use_metafile) {
+		// change the suffix to .docx (lol)
+		size_t m_len = filename.length() + 2;
+		char *meta_filename = new char[m_len];
+		strncpy(meta_filename, filename.c_str(), m_len - 5);
+		strncpy(meta_filename + m_len - 5, "docx", 5);
+
+		// get subtexture information by meta file exported by script
+		util::read_csv_file(meta_filename, this->subtextures);
+
+		// TODO: use information from empires.dat for that, also use x and y sizes:
+		this->atlas_dimensions = sqrt(this->subtextures.size());
+		delete[] meta_filename;
+	}
+	else {
+		// we don't have a texture description file.
+		// use the whole image as one texture then.
+		gamedata::subtexture s{0, 0, this->w, this->h, this->w/2, this->h/2};
+
+		this->subtextures.push_back(s);
+	}
+}
+
+std::unique_ptr<gl_texture_buffer> Texture::read_pixels(const std::string &filename, int *w, int *h,
+                                                     bool palette) {
+	// the converter may have stored the texture ready for uploading
+	if (TextureContainer::usable_for(filename)) {
+		return Texture::read_container(filename, w, h);
+	}
+
+	auto buffer = Texture::read_image(filename, w, h);
+	if (palette) {
+		Texture::use_palette(buffer.get(), *w, *h);
+	}
+	return buffer;
+}
+
+void Texture::use_palette(gl_texture_buffer *buffer, int w, int h) {
+	if (not buffer->data or buffer->texture_format_in != GL_RGBA8) {
+		return;
+	}
+
+	size_t count = w * h;
+	auto indices = std::make_unique<uint8_t[]>(count);
+	auto palette = std::make_unique<uint32_t[]>(texture_palette_size);
+	if (not make_texture_palette(buffer->data.get(), count, indices.get(), palette.get())) {
+		return;
+	}
+
+	buffer->indices = std::move(indices);
+	buffer->palette = std::move(palette);
+	buffer->data = nullptr;
+	buffer->texture_format_in = GL_LUMINANCE8;
+	buffer->texture_format_out = GL_LUMINANCE;
+}
+
+void Texture::allow_palette() {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+	this->palette_allowed = true;
+
+	// the atlas took the pixels already
+	if (this->atlas == nullptr and not this->buffer->transferred) {
+		Texture::use_palette(this->buffer.get(), this->w, this->h);
+	}
+}
+
+bool Texture::is_palette_allowed() const {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+
+	// atlas pages are assembled from colors
+	return this->palette_allowed and this->atlas == nullptr;
+}
+
+std::unique_ptr<gl_texture_buffer> Texture::read_image(const std::string &filename, int *w, int *h) {
+	// converted textures may be in an asset pack
+	util::packed_file packed = util::find_packed_file(filename);
+
+	// pngs are decoded straight into the pixels that are uploaded
+	std::unique_ptr<uint32_t[]> png_pixels;
+	if (packed) {
+		png_pixels = read_png(reinterpret_cast<const uint8_t *>(packed.data), packed.size, filename, w, h);
+	}
+	else {
+		png_pixels = read_png(filename, w, h);
+	}
+
+	if (png_pixels) {
+		log::log(MSG(dbg) << "Texture has been loaded from " << filename);
+
+		auto buffer = std::make_unique<gl_texture_buffer>();
+		buffer->texture_format_in  = GL_RGBA8;
+		buffer->texture_format_out = GL_RGBA;
+		buffer->data = std::move(png_pixels);
+		return buffer;
+	}
+
+	// other images are loaded by sdl_image
 	SDL_Surface *surface;
-	surface = IMG_Load(this->filename.c_str());
+	if (packed) {
+		surface = IMG_Load_RW(SDL_RWFromConstMem(packed.data, packed.size), 1);
+	}
+	else {
+		surface = IMG_Load(filename.c_str());
+	}
 
 	if (!surface) {
 		throw Error(MSG(err) <<
@@ -69,17 +239,17 @@ void Texture::load() {
 		log::log(MSG(dbg) << "Texture has been loaded from " << filename);
 	}
 
-	this->buffer = std::make_unique<gl_texture_buffer>();
+	auto buffer = std::make_unique<gl_texture_buffer>();
 
 	// glTexImage2D format determination
 	switch (surface->format->BytesPerPixel) {
 	case 3: // RGB 24 bit
-		this->buffer->texture_format_in  = GL_RGB8;
-		this->buffer->texture_format_out = GL_RGB;
+		buffer->texture_format_in  = GL_RGB8;
+		buffer->texture_format_out = GL_RGB;
 		break;
 	case 4: // RGBA 32 bit
-		this->buffer->texture_format_in  = GL_RGBA8;
-		this->buffer->texture_format_out = GL_RGBA;
+		buffer->texture_format_in  = GL_RGBA8;
+		buffer->texture_format_out = GL_RGBA;
 		break;
 	default:
 		throw Error(MSG(err) <<
@@ -88,41 +258,33 @@ void Texture::load() {
 
 		break;
 	}
-	this->w = surface->w;
-	this->h = surface->h;
+	*w = surface->w;
+	*h = surface->h;
 
 	// temporary buffer for pixel data
-	this->buffer->transferred = false;
-	this->buffer->data = std::make_unique<uint32_t[]>(this->w * this->h);
+	buffer->data = std::make_unique<uint32_t[]>(surface->w * surface->h);
 	memcpy(
-		this->buffer->data.get(),
+		buffer->data.get(),
 		surface->pixels,
-		this->w * this->h *
+		surface->w * surface->h *
 		surface->format->BytesPerPixel
 	);
 	SDL_FreeSurface(surface);
 
-	if (use_metafile) {
-		// change the suffix to .docx (lol)
-		size_t m_len = filename.length() + 2;
-		char *meta_filename = new char[m_len];
-		strncpy(meta_filename, filename.c_str(), m_len - 5);
-		strncpy(meta_filename + m_len - 5, "docx", 5);
+	return buffer;
+}
 
-		// get subtexture information by meta file exported by script
-		util::read_csv_file(meta_filename, this->subtextures);
+std::unique_ptr<gl_texture_buffer> Texture::read_container(const std::string &filename, int *w, int *h) {
+	std::string container_filename = TextureContainer::path_for(filename);
 
-		// TODO: use information from empires.dat for that, also use x and y sizes:
-		this->atlas_dimensions = sqrt(this->subtextures.size());
-		delete[] meta_filename;
-	}
-	else {
-		// we don't have a texture description file.
-		// use the whole image as one texture then.
-		gamedata::subtexture s{0, 0, this->w, this->h, this->w/2, this->h/2};
+	auto buffer = std::make_unique<gl_texture_buffer>();
+	buffer->container = std::make_unique<TextureContainer>(container_filename);
+	log::log(MSG(dbg) << "Texture has been loaded from " << container_filename);
 
-		this->subtextures.push_back(s);
-	}
+	*w = buffer->container->get_width();
+	*h = buffer->container->get_height();
+
+	return buffer;
 }
 
 GLuint Texture::make_gl_texture(int iformat, int oformat, int w, int h, void *data) const {
@@ -145,8 +307,131 @@ GLuint Texture::make_gl_texture(int iformat, int oformat, int w, int h, void *da
 	return textureid;
 }
 
-void Texture::main_thread_load() const {
-	if (!this->buffer->transferred) {
+GLuint Texture::make_gl_texture(const TextureContainer &container) const {
+	GLenum compressed_format = 0;
+	switch (container.get_format()) {
+	case texture_pixel_format::rgba8:
+		break;
+	case texture_pixel_format::bc1:
+		compressed_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		break;
+	case texture_pixel_format::bc3:
+		compressed_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		break;
+	}
+
+	if (compressed_format != 0 and not epoxy_has_gl_extension("GL_EXT_texture_compression_s3tc")) {
+		throw Error(MSG(err) <<
+			"Texture " << this->filename << " is s3tc compressed, "
+			"which is not supported by the opengl driver");
+	}
+
+	GLuint textureid;
+	glGenTextures(1, &textureid);
+	glBindTexture(GL_TEXTURE_2D, textureid);
+
+	// the mapped levels are uploaded as they are
+	const std::vector<texture_container_level> &levels = container.get_levels();
+	for (size_t i = 0; i < levels.size(); i++) {
+		const texture_container_level &level = levels[i];
+		if (compressed_format != 0) {
+			glCompressedTexImage2D(
+				GL_TEXTURE_2D, i, compressed_format,
+				level.width, level.height, 0,
+				level.size, container.get_level_data(i)
+			);
+		}
+		else {
+			glTexImage2D(
+				GL_TEXTURE_2D, i,
+				GL_RGBA8, level.width, level.height, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, container.get_level_data(i)
+			);
+		}
+	}
+
+	// only the stored levels are complete
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels.size() - 1);
+
+	// same drawing settings as for images,
+	// smaller levels are used by minified textures.
+	if (levels.size() > 1) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	} else {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return textureid;
+}
+
+void Texture::make_gl_palette_texture(gl_texture_buffer *buffer) const {
+	// rows of indices are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	buffer->id = this->make_gl_texture(GL_LUMINANCE8, GL_LUMINANCE, this->w, this->h, buffer->indices.get());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// neighbouring indices have unrelated colors, they can't be interpolated
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	buffer->palette_id = this->make_gl_texture(GL_RGBA8, GL_RGBA, texture_palette_size, 1, buffer->palette.get());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+}
+
+void Texture::main_thread_load(bool budgeted) const {
+	if (this->residency != nullptr) {
+		this->last_used = this->residency->get_frame();
+	}
+
+	if (this->upload(budgeted) != upload_result::missing) {
+		return;
+	}
+
+	// the texture was evicted, the placeholder is drawn until it's back.
+	// requested without the lock, the pixels may be set right away.
+	ENSURE(this->residency != nullptr, "no pixel data to upload for texture " << this->filename);
+	this->residency->request(this);
+}
+
+Texture::upload_result Texture::upload(bool budgeted) const {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+
+	if (this->buffer->transferred) {
+		return upload_result::ready;
+	}
+
+	// the vertex buffer is used for drawing the placeholder as well
+	if (this->buffer->vertbuf == 0) {
+		glGenBuffers(1, &this->buffer->vertbuf);
+	}
+
+	// the pixels are uploaded with the atlas page
+	if (this->atlas != nullptr) {
+		return upload_result::ready;
+	}
+
+	size_t size = pending_upload_size(*this->buffer, this->w, this->h);
+	if (size == 0) {
+		return upload_result::missing;
+	}
+
+	if (budgeted and this->residency != nullptr and
+	    not this->residency->reserve_upload(size)) {
+		return upload_result::deferred;
+	}
+
+	static util::MetricHistogram &upload_us = util::metrics().histogram("textures.upload_us");
+	static util::MetricCounter &uploaded_bytes = util::metrics().counter("textures.uploaded_bytes");
+	time_nsec_t upload_start = timing::get_monotonic_time();
+
+	if (this->buffer->container) {
+		this->buffer->id = this->make_gl_texture(*this->buffer->container);
+
+		// unmap the file
+		this->buffer->container = nullptr;
+	}
+	else if (this->buffer->data) {
 		this->buffer->id = this->make_gl_texture(
 			this->buffer->texture_format_in,
 			this->buffer->texture_format_out,
@@ -155,24 +440,152 @@ void Texture::main_thread_load() const {
 			this->buffer->data.get()
 		);
 		this->buffer->data = nullptr;
-		glGenBuffers(1, &this->buffer->vertbuf);
-		this->buffer->transferred = true;
 	}
+	else {
+		this->make_gl_palette_texture(this->buffer.get());
+		this->buffer->indices = nullptr;
+		this->buffer->palette = nullptr;
+	}
+
+	this->buffer->gpu_size = size;
+	this->buffer->transferred = true;
+
+	upload_us.add((timing::get_monotonic_time() - upload_start) / 1000);
+	uploaded_bytes.add(size);
+
+	return upload_result::ready;
+}
+
+size_t Texture::get_pending_upload_size() const {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+
+	if (this->buffer->transferred or this->atlas != nullptr) {
+		return 0;
+	}
+	return pending_upload_size(*this->buffer, this->w, this->h);
+}
+
+void Texture::prefetch() const {
+	this->upload(true);
 }
 
 void Texture::unload() {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+
+	// never uploaded textures don't need opengl, e.g. when headless
+	if (this->buffer->id != 0) {
+		glDeleteTextures(1, &this->buffer->id);
+	}
+	if (this->buffer->palette_id != 0) {
+		glDeleteTextures(1, &this->buffer->palette_id);
+	}
+	if (this->buffer->color_id != 0) {
+		glDeleteTextures(1, &this->buffer->color_id);
+	}
+	if (this->buffer->vertbuf != 0) {
+		glDeleteBuffers(1, &this->buffer->vertbuf);
+	}
+	this->buffer->id = 0;
+	this->buffer->palette_id = 0;
+	this->buffer->color_id = 0;
+	this->buffer->vertbuf = 0;
+	this->buffer->transferred = false;
+	this->buffer->gpu_size = 0;
+}
+
+
+void Texture::evict() {
+	ENSURE(not this->filename.empty(), "textures without file can't be reloaded");
+
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+
+	if (not this->buffer->transferred or this->atlas != nullptr) {
+		return;
+	}
+
+	// the vertex buffer is kept, it's tiny
 	glDeleteTextures(1, &this->buffer->id);
-	glDeleteBuffers(1, &this->buffer->vertbuf);
+	if (this->buffer->palette_id != 0) {
+		glDeleteTextures(1, &this->buffer->palette_id);
+	}
+	if (this->buffer->color_id != 0) {
+		glDeleteTextures(1, &this->buffer->color_id);
+	}
+	this->buffer->id = 0;
+	this->buffer->palette_id = 0;
+	this->buffer->color_id = 0;
+	this->buffer->transferred = false;
+	this->buffer->gpu_size = 0;
+}
+
+
+void Texture::set_pixels(std::unique_ptr<gl_texture_buffer> pixels) {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+
+	if (this->buffer->transferred) {
+		return;
+	}
+
+	pixels->vertbuf = this->buffer->vertbuf;
+	this->buffer = std::move(pixels);
+}
+
+
+void Texture::set_residency(TextureResidency *residency) {
+	this->residency = residency;
+}
+
+
+bool Texture::is_in_atlas() const {
+	return this->atlas != nullptr;
+}
+
+
+bool Texture::is_resident() const {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+	return this->buffer->transferred;
+}
+
+
+size_t Texture::get_gpu_size() const {
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+	return this->buffer->gpu_size;
+}
+
+
+uint64_t Texture::get_last_used() const {
+	return this->last_used;
+}
+
+
+const std::string &Texture::get_filename() const {
+	return this->filename;
 }
 
 
 void Texture::reload() {
+	int w, h;
+	auto pixels = Texture::read_pixels(this->filename, &w, &h, this->is_palette_allowed());
+	this->reload(std::move(pixels), w, h);
+}
+
+
+void Texture::reload(std::unique_ptr<gl_texture_buffer> pixels, int w, int h) {
 	this->unload();
-	this->load();
+
+	// the reloaded pixels get their own opengl texture,
+	// their area in the atlas page stays unused.
+	this->atlas = nullptr;
+	this->subtextures.clear();
+
+	this->use_pixels(std::move(pixels), w, h);
 }
 
 
 Texture::~Texture() {
+	if (this->residency != nullptr) {
+		this->residency->remove(this);
+	}
 	this->unload();
 }
 
@@ -205,7 +618,41 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
                    unsigned int mode, bool mirrored,
                    int subid, unsigned player,
                    Texture *alpha_texture, int alpha_subid) const {
-	this->main_thread_load();
+
+	bool alpha_masked = (mode & ALPHAMASKED) && alpha_subid >= 0 && alpha_texture != nullptr;
+
+	// record the sprite if a batch is active, it is drawn when the batch is flushed.
+	SpriteBatch *batch = SpriteBatch::get_active();
+	if (batch != nullptr) {
+		if (not alpha_masked) {
+			batch->add(this, x, y, mode, mirrored, subid, player);
+			return;
+		}
+
+		// masked textures are not batched, draw the recorded sprites first
+		batch->flush();
+	}
+
+	// unknown subtextures are reported to the caller
+	this->get_subtexture(subid);
+	if (alpha_masked) {
+		alpha_texture->get_subtexture(alpha_subid);
+	}
+
+	// the gl calls are issued when the frame's commands are executed
+	RenderCommandList::submit([=] {
+		this->draw_now(x, y, mode, mirrored, subid, player, alpha_texture, alpha_subid);
+	});
+}
+
+
+void Texture::draw_now(coord::pixel_t x, coord::pixel_t y,
+                       unsigned int mode, bool mirrored,
+                       int subid, unsigned player,
+                       Texture *alpha_texture, int alpha_subid) const {
+
+	bool alpha_masked = (mode & ALPHAMASKED) && alpha_subid >= 0 && alpha_texture != nullptr;
+
 	glColor4f(1, 1, 1, 1);
 
 	bool use_playercolors = false;
@@ -214,8 +661,17 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
 
 	int *pos_id, *texcoord_id, *masktexcoord_id;
 
+	GLuint palette_id;
+	GLuint texture_id = this->get_draw_texture_id(&palette_id);
+
+	// the alpha mask shader only reads colors
+	if (alpha_masked and palette_id != 0) {
+		texture_id = this->get_texture_id();
+		palette_id = 0;
+	}
+
 	// is this texture drawn with an alpha mask?
-	if ((mode & ALPHAMASKED) && alpha_subid >= 0 && alpha_texture != nullptr) {
+	if (alpha_masked) {
 		alphamask_shader::program->use();
 
 		// bind the alpha mask texture to slot 1
@@ -230,12 +686,25 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
 		masktexcoord_id = &alphamask_shader::mask_coord;
 		use_alphashader = true;
 	}
+	// are the colors looked up from the palette?
+	// player 1 has the colors of the texture, so it isn't tinted.
+	else if (palette_id != 0) {
+		palette_shader::program->use();
+
+		glVertexAttrib1f(palette_shader::player_id_var, (mode & PLAYERCOLORED) ? player : 1);
+		pos_id = &palette_shader::program->pos_id;
+		texcoord_id = &palette_shader::tex_coord;
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, palette_id);
+	}
 	// is this texure drawn with replaced pixels for team coloring?
 	else if (mode & PLAYERCOLORED) {
 		teamcolor_shader::program->use();
 
-		//set the desired player id in the shader
-		glUniform1i(teamcolor_shader::player_id_var, player);
+		//set the desired player id in the shader,
+		//the attribute is constant for this draw call
+		glVertexAttrib1f(teamcolor_shader::player_id_var, player);
 		pos_id = &teamcolor_shader::program->pos_id;
 		texcoord_id = &teamcolor_shader::tex_coord;
 		use_playercolors = true;
@@ -249,7 +718,7 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
 
 	glActiveTexture(GL_TEXTURE0);
 	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, this->buffer->id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
 
 	const gamedata::subtexture *tx = this->get_subtexture(subid);
 
@@ -304,8 +773,14 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
 	};
 
 
+	GLuint vertbuf;
+	{
+		std::lock_guard<std::mutex> lock{this->buffer_mutex};
+		vertbuf = this->buffer->vertbuf;
+	}
+
 	// store vertex buffer data, TODO: prepare this sometime earlier.
-	glBindBuffer(GL_ARRAY_BUFFER, this->buffer->vertbuf);
+	glBindBuffer(GL_ARRAY_BUFFER, vertbuf);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vdata), vdata, GL_STREAM_DRAW);
 
 	// enable vertex buffer and bind it to the vertex attribute
@@ -322,8 +797,8 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
 		glVertexAttribPointer(*masktexcoord_id, 2, GL_FLOAT, GL_FALSE, 0, (void *)(sizeof(float) * 8 * 2));
 	}
 
-	// draw the vertex array
-	glDrawArrays(GL_QUADS, 0, 4);
+	// draw the vertex array, the corners are in order around the quad
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
 	// unbind the current buffer
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -335,7 +810,11 @@ void Texture::draw(coord::pixel_t x, coord::pixel_t y,
 	}
 
 	// disable the shaders.
-	if (use_playercolors) {
+	if (palette_id != 0) {
+		palette_shader::program->stopusing();
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	} else if (use_playercolors) {
 		teamcolor_shader::program->stopusing();
 	} else if (use_alphashader) {
 		alphamask_shader::program->stopusing();
@@ -370,10 +849,16 @@ void Texture::get_subtexture_coordinates(int subid, float *txl, float *txr, floa
 
 void Texture::get_subtexture_coordinates(const gamedata::subtexture *tx,
                                          float *txl, float *txr, float *txt, float *txb) const {
-	*txl = ((float)tx->x)           /this->w;
-	*txr = ((float)(tx->x + tx->w)) /this->w;
-	*txt = ((float)tx->y)           /this->h;
-	*txb = ((float)(tx->y + tx->h)) /this->h;
+	int w = this->w;
+	int h = this->h;
+	if (this->atlas != nullptr) {
+		w = h = this->atlas->get_page_size();
+	}
+
+	*txl = ((float)tx->x)           /w;
+	*txr = ((float)(tx->x + tx->w)) /w;
+	*txt = ((float)tx->y)           /h;
+	*txb = ((float)(tx->y + tx->h)) /h;
 }
 
 
@@ -390,8 +875,51 @@ void Texture::get_subtexture_size(int subid, int *w, int *h) const {
 
 
 GLuint Texture::get_texture_id() const {
-	this->main_thread_load();
-	return this->buffer->id;
+	// the gui keeps the returned texture, so it's uploaded right away
+	GLuint palette_id;
+	GLuint texture_id = this->lookup_texture_id(&palette_id, false);
+	if (palette_id == 0) {
+		return texture_id;
+	}
+
+	std::lock_guard<std::mutex> lock{this->buffer_mutex};
+	if (this->buffer->color_id == 0) {
+		// only few textures are shown by the gui, the colors
+		// are expanded from the kept palette on request.
+		int w, h;
+		auto colors = Texture::read_image(this->filename, &w, &h);
+		if (w != this->w or h != this->h) {
+			throw Error(MSG(err) << "Texture " << this->filename << " changed its size");
+		}
+		this->buffer->color_id = this->make_gl_texture(
+			colors->texture_format_in, colors->texture_format_out,
+			w, h, colors->data.get()
+		);
+		this->buffer->gpu_size += w * h * 4;
+	}
+	return this->buffer->color_id;
+}
+
+GLuint Texture::get_draw_texture_id(GLuint *palette_id) const {
+	return this->lookup_texture_id(palette_id, true);
+}
+
+GLuint Texture::lookup_texture_id(GLuint *palette_id, bool budgeted) const {
+	this->main_thread_load(budgeted);
+	*palette_id = 0;
+
+	if (this->atlas != nullptr) {
+		return this->atlas->get_texture_id(this->atlas_page);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{this->buffer_mutex};
+		if (this->buffer->transferred) {
+			*palette_id = this->buffer->palette_id;
+			return this->buffer->id;
+		}
+	}
+	return this->residency->get_placeholder_id();
 }
 
 } // openage
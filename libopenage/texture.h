@@ -1,10 +1,11 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <epoxy/gl.h>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "gamedata/texture.gen.h"
 #include "coord/camgame.h"
@@ -13,10 +14,15 @@
 #include "coord/tile3.h"
 #include "shader/program.h"
 #include "shader/shader.h"
+#include "texture_container.h"
 #include "util/file.h"
 
 namespace openage {
 
+class TextureArray;
+class TextureAtlas;
+class TextureResidency;
+
 namespace texture_shader {
 extern shader::Program *program;
 extern GLint texture, tex_coord;
@@ -28,6 +34,16 @@ extern GLint texture, tex_coord;
 extern GLint player_id_var, alpha_marker_var, player_color_var;
 } // namespace teamcolor_shader
 
+/**
+ * the team color shader for textures stored with a palette,
+ * the colors are looked up from the palette texture first.
+ */
+namespace palette_shader {
+extern shader::Program *program;
+extern GLint texture, palette, tex_coord;
+extern GLint player_id_var, alpha_marker_var, player_color_var;
+} // namespace palette_shader
+
 namespace alphamask_shader {
 extern shader::Program *program;
 extern GLint base_texture, mask_texture, base_coord, mask_coord, show_mask;
@@ -41,13 +57,43 @@ constexpr int ALPHAMASKED   = 1 << 1;
  * enables transfer of data to opengl
  */
 struct gl_texture_buffer {
-	GLuint id, vertbuf;
+	GLuint id = 0, vertbuf = 0;
 
 	// this requires loading on the main thread
-	bool transferred;
-	int texture_format_in;
-	int texture_format_out;
+	bool transferred = false;
+	int texture_format_in = 0;
+	int texture_format_out = 0;
 	std::unique_ptr<uint32_t[]> data;
+
+	/**
+	 * bytes of gpu memory used while transferred.
+	 */
+	size_t gpu_size = 0;
+
+	/**
+	 * mapped texture container, used instead of data if the
+	 * texture was converted into one.
+	 */
+	std::unique_ptr<TextureContainer> container;
+
+	/**
+	 * palette indices of the pixels, used instead of data if the
+	 * texture is stored with a palette, see Texture::allow_palette.
+	 * texture_format_in is GL_LUMINANCE8 then.
+	 */
+	std::unique_ptr<uint8_t[]> indices;
+	std::unique_ptr<uint32_t[]> palette;
+
+	/**
+	 * the opengl texture of the palette, id has the indices.
+	 */
+	GLuint palette_id = 0;
+
+	/**
+	 * the colors of a texture stored with a palette,
+	 * uploaded when they are requested, e.g. by the gui.
+	 */
+	GLuint color_id = 0;
 };
 
 
@@ -80,8 +126,13 @@ public:
 	/**
 	 * Create a texture from a existing image file.
 	 * For supported image file types, see the SDL_Image initialization in the engine.
+	 * If the converter stored the texture as container (.otex suffix),
+	 * that one is mapped instead of decoding the image.
+	 *
+	 * Without pixels, only the subtextures are read from the metafile,
+	 * for simulating without drawing. Such textures can't be drawn.
 	 */
-	Texture(const std::string &filename, bool use_metafile=false);
+	Texture(const std::string &filename, bool use_metafile=false, bool with_pixels=true);
 	~Texture();
 
 	void draw(coord::camhud pos, unsigned int mode=0, bool mirrored=false, int subid=0, unsigned player=0) const;
@@ -94,6 +145,90 @@ public:
 	 */
 	void reload();
 
+	/**
+	 * Replace the image with pixels read by read_pixels, e.g. on a job.
+	 * Only the gl upload remains, on the thread drawing the texture.
+	 */
+	void reload(std::unique_ptr<gl_texture_buffer> pixels, int w, int h);
+
+	/**
+	 * Read the pixels of an image file, or of its texture container.
+	 * Doesn't use opengl, so it may run on any thread.
+	 */
+	static std::unique_ptr<gl_texture_buffer> read_pixels(const std::string &filename, int *w, int *h,
+	                                                      bool palette=false);
+
+	/**
+	 * Store the pixels with a palette from now on, if they have at most
+	 * 256 colors. Only for textures drawn by Texture::draw and the
+	 * SpriteBatch, e.g. unit sprites, as only their shaders decode them.
+	 *
+	 * This quarters the memory and upload size of the pixels. Textures
+	 * in a TextureAtlas and texture containers keep their colors.
+	 */
+	void allow_palette();
+
+	/**
+	 * Whether the pixels are read with a palette when they are loaded again.
+	 */
+	bool is_palette_allowed() const;
+
+	/**
+	 * Free the gpu memory of the texture. It is requested from the
+	 * residency manager again when it's drawn the next time.
+	 */
+	void evict();
+
+	/**
+	 * Use pixels read by read_pixels, they are uploaded when
+	 * the texture is drawn the next time.
+	 * Ignored if the texture is still resident.
+	 */
+	void set_pixels(std::unique_ptr<gl_texture_buffer> pixels);
+
+	/**
+	 * Set the manager that tracks the use of this texture.
+	 * Evicted textures are reloaded by it, and drawn with its
+	 * placeholder meanwhile.
+	 */
+	void set_residency(TextureResidency *residency);
+
+	/**
+	 * Whether the texture was packed into a page of a TextureAtlas.
+	 * Packed textures are drawn from the page and never evicted.
+	 */
+	bool is_in_atlas() const;
+
+	/**
+	 * Whether the texture is in gpu memory.
+	 */
+	bool is_resident() const;
+
+	/**
+	 * Bytes of gpu memory used by the texture, 0 if not resident.
+	 */
+	size_t get_gpu_size() const;
+
+	/**
+	 * Bytes of pixels waiting to be uploaded, 0 if there are none
+	 * or the texture is resident.
+	 */
+	size_t get_pending_upload_size() const;
+
+	/**
+	 * Upload the waiting pixels within the upload budget of the
+	 * residency manager, before the texture is drawn the first time.
+	 * Doesn't count as a use of the texture.
+	 */
+	void prefetch() const;
+
+	/**
+	 * Frame of the residency manager in which the texture was used last.
+	 */
+	uint64_t get_last_used() const;
+
+	const std::string &get_filename() const;
+
 	/**
 	 * Get the subtexture coordinates by its idea.
 	 */
@@ -116,7 +251,8 @@ public:
 	 * get atlas subtexture coordinates.
 	 *
 	 * left, right, top and bottom bounds as coordinates
-	 * these pick the requested area out of the big texture.
+	 * these pick the requested area out of the big texture,
+	 * or out of the atlas page the texture was packed into.
 	 * returned as floats in range 0.0 to 1.0
 	 */
 	void get_subtexture_coordinates(int subid, float *txl, float *txr, float *txt, float *txb) const;
@@ -140,24 +276,114 @@ public:
 	void disable_alphamask();
 
 	/**
-	 * returns the opengl texture id of this texture.
+	 * returns the opengl texture id of this texture,
+	 * or of its atlas page. it has the colors of the pixels, for
+	 * textures stored with a palette they are uploaded once more.
 	 */
 	GLuint get_texture_id() const;
 
+	/**
+	 * the opengl texture to draw this texture from, uploaded if needed.
+	 * while the upload waits for the upload budget of the residency
+	 * manager, the placeholder texture is returned.
+	 * if the texture is stored with a palette, the returned texture has
+	 * the indices and palette_id is set to the palette texture,
+	 * otherwise palette_id is set to 0.
+	 */
+	GLuint get_draw_texture_id(GLuint *palette_id) const;
+
 private:
+	friend class TextureArray;
+	friend class TextureAtlas;
+
 	std::unique_ptr<gl_texture_buffer> buffer;
+
+	/**
+	 * guards the gl state of the buffer. the recorded frames are drawn
+	 * on the render thread, while the gui uses textures on the engine thread.
+	 */
+	mutable std::mutex buffer_mutex;
+
 	std::vector<gamedata::subtexture> subtextures;
 	bool use_metafile;
 
 	std::string filename;
 
+	/**
+	 * whether the pixels are stored with a palette if they fit.
+	 */
+	bool palette_allowed;
+
+	TextureResidency *residency;
+	mutable uint64_t last_used;
+
+	/**
+	 * the atlas the pixels were packed into, nullptr if the
+	 * texture has its own opengl texture.
+	 * the subtextures are positioned in the page then.
+	 */
+	TextureAtlas *atlas;
+	size_t atlas_page;
+
 	void load();
 
 	/**
-	 * the gl loading which must occur on the main thread
+	 * take the pixels of the image and set up its subtextures.
 	 */
-	void main_thread_load() const;
+	void use_pixels(std::unique_ptr<gl_texture_buffer> pixels, int w, int h);
+
+	/**
+	 * decode an image file.
+	 */
+	static std::unique_ptr<gl_texture_buffer> read_image(const std::string &filename, int *w, int *h);
+
+	/**
+	 * replace the rgba8 pixels of the buffer by palette indices,
+	 * if they fit into a palette.
+	 */
+	static void use_palette(gl_texture_buffer *buffer, int w, int h);
+
+	/**
+	 * map the texture container of an image.
+	 */
+	static std::unique_ptr<gl_texture_buffer> read_container(const std::string &filename, int *w, int *h);
+
+	/**
+	 * the gl loading which must occur on the thread drawing the texture.
+	 * requests the pixels from the residency manager if there are none.
+	 *
+	 * budgeted uploads are moved to a later frame when the upload budget
+	 * of the residency manager is used up, the placeholder is drawn then.
+	 */
+	void main_thread_load(bool budgeted=true) const;
+
+	enum class upload_result {
+		ready,     //!< the texture can be drawn
+		deferred,  //!< the upload budget of this frame is used up
+		missing,   //!< there are no pixels to upload
+	};
+
+	/**
+	 * upload the pixels of the buffer, if there are any.
+	 */
+	upload_result upload(bool budgeted) const;
+
+	/**
+	 * the opengl texture to draw from, see get_draw_texture_id.
+	 */
+	GLuint lookup_texture_id(GLuint *palette_id, bool budgeted) const;
+
+	/**
+	 * issue the gl calls of a draw, recorded by draw().
+	 */
+	void draw_now(coord::pixel_t x, coord::pixel_t y, unsigned int mode, bool mirrored, int subid, unsigned player, Texture *alpha_texture, int alpha_subid) const;
 	GLuint make_gl_texture(int iformat, int oformat, int w, int h, void *) const;
+	GLuint make_gl_texture(const TextureContainer &container) const;
+
+	/**
+	 * upload the indices and the palette of the buffer.
+	 */
+	void make_gl_palette_texture(gl_texture_buffer *buffer) const;
 	void unload();
 
 };
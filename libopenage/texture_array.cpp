@@ -0,0 +1,159 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "texture_array.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "error/error.h"
+#include "texture.h"
+
+namespace openage {
+
+TextureArray::TextureArray()
+	:
+	width{0},
+	height{0},
+	texture_id{0} {}
+
+
+TextureArray::~TextureArray() {
+	if (this->texture_id != 0) {
+		glDeleteTextures(1, &this->texture_id);
+	}
+}
+
+
+bool TextureArray::is_supported() {
+	// the shaders are glsl 1.20, which samples arrays with the extension
+	static bool result = epoxy_has_gl_extension("GL_EXT_texture_array");
+	return result;
+}
+
+
+int TextureArray::insert(Texture *texture) {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	ENSURE(this->texture_id == 0, "texture array was uploaded already");
+
+	for (size_t i = 0; i < this->layers.size(); i++) {
+		if (this->layers[i].texture == texture) {
+			return i;
+		}
+	}
+
+	std::unique_ptr<uint32_t[]> pixels;
+	{
+		std::lock_guard<std::mutex> texture_lock{texture->buffer_mutex};
+		gl_texture_buffer *buffer = texture->buffer.get();
+
+		if (texture->atlas != nullptr or
+		    buffer == nullptr or
+		    buffer->transferred or
+		    not buffer->data or
+		    buffer->texture_format_in != GL_RGBA8) {
+			return -1;
+		}
+
+		if (texture->residency != nullptr) {
+			pixels = std::move(buffer->data);
+		}
+		else {
+			size_t count = texture->w * texture->h;
+			pixels = std::make_unique<uint32_t[]>(count);
+			memcpy(pixels.get(), buffer->data.get(), count * sizeof(uint32_t));
+		}
+	}
+
+	this->width = std::max(this->width, texture->w);
+	this->height = std::max(this->height, texture->h);
+	this->layers.push_back({texture, texture->w, texture->h, std::move(pixels)});
+
+	return this->layers.size() - 1;
+}
+
+
+int TextureArray::get_layer(const Texture *texture) const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	for (size_t i = 0; i < this->layers.size(); i++) {
+		if (this->layers[i].texture == texture) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+size_t TextureArray::get_layer_count() const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+	return this->layers.size();
+}
+
+
+void TextureArray::get_subtexture_coordinates(const Texture *texture, int subid,
+                                              float *txl, float *txr, float *txt, float *txb) const {
+	const gamedata::subtexture *tx = texture->get_subtexture(subid);
+
+	std::lock_guard<std::mutex> lock{this->mutex};
+	*txl = ((float)tx->x)           / this->width;
+	*txr = ((float)(tx->x + tx->w)) / this->width;
+	*txt = ((float)tx->y)           / this->height;
+	*txb = ((float)(tx->y + tx->h)) / this->height;
+}
+
+
+GLuint TextureArray::get_texture_id() {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	if (this->texture_id != 0) {
+		return this->texture_id;
+	}
+
+	ENSURE(not this->layers.empty(), "texture array has no layers");
+
+	glGenTextures(1, &this->texture_id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, this->texture_id);
+
+	// same drawing settings as the standalone textures
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexImage3D(
+		GL_TEXTURE_2D_ARRAY, 0,
+		GL_RGBA8, this->width, this->height, this->layers.size(), 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, nullptr
+	);
+
+	// each layer is uploaded as a whole, the space around
+	// smaller textures stays transparent for the linear filter.
+	std::vector<uint32_t> layer_pixels(this->width * this->height);
+	for (size_t i = 0; i < this->layers.size(); i++) {
+		layer &entry = this->layers[i];
+
+		std::fill(std::begin(layer_pixels), std::end(layer_pixels), 0);
+		for (int row = 0; row < entry.height; row++) {
+			memcpy(
+				layer_pixels.data() + row * this->width,
+				entry.pixels.get() + row * entry.width,
+				entry.width * sizeof(uint32_t)
+			);
+		}
+
+		glTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY, 0,
+			0, 0, i, this->width, this->height, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, layer_pixels.data()
+		);
+
+		entry.pixels = nullptr;
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return this->texture_id;
+}
+
+} // namespace openage
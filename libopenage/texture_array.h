@@ -0,0 +1,104 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace openage {
+
+class Texture;
+
+/**
+ * Stores textures as the layers of one opengl texture array,
+ * so a draw call can use all of them without binding textures in between.
+ *
+ * All layers have the size of the largest texture, smaller textures are
+ * placed at the top left corner of their layer. The subtexture coordinates
+ * of a texture in the array are therefore relative to the layer size, see
+ * get_subtexture_coordinates.
+ *
+ * Textures are inserted while the game data is loaded, the array is
+ * uploaded on the main thread when it's used the first time.
+ * Changes of the textures afterwards, e.g. by inotify reloading,
+ * are not seen by the array.
+ */
+class TextureArray {
+public:
+	TextureArray();
+	~TextureArray();
+
+	TextureArray(const TextureArray &) = delete;
+	TextureArray &operator =(const TextureArray &) = delete;
+
+	/**
+	 * Whether the opengl driver supports texture arrays.
+	 * Call with a gl context.
+	 */
+	static bool is_supported();
+
+	/**
+	 * Copy the pixels of a texture into a new layer.
+	 * A texture that is in the array already keeps its layer.
+	 *
+	 * Only rgba8 images which were not uploaded yet can be inserted.
+	 * The pixels are taken from textures with a residency manager,
+	 * which reads them again when the texture itself is drawn.
+	 *
+	 * @returns the layer of the texture, -1 if it can't be inserted.
+	 */
+	int insert(Texture *texture);
+
+	/**
+	 * The layer of a texture, -1 if it isn't in the array.
+	 */
+	int get_layer(const Texture *texture) const;
+
+	size_t get_layer_count() const;
+
+	/**
+	 * The coordinates of a subtexture in the layer of its texture,
+	 * as Texture::get_subtexture_coordinates.
+	 * The texture must be in the array.
+	 */
+	void get_subtexture_coordinates(const Texture *texture, int subid,
+	                                float *txl, float *txr, float *txt, float *txb) const;
+
+	/**
+	 * The opengl texture of the array, uploaded at the first call.
+	 * No textures can be inserted afterwards. Call on the main thread.
+	 */
+	GLuint get_texture_id();
+
+private:
+	struct layer {
+		const Texture *texture;
+		int width;
+		int height;
+
+		/**
+		 * rgba8 pixels, freed when the array is uploaded.
+		 */
+		std::unique_ptr<uint32_t[]> pixels;
+	};
+
+	/**
+	 * Guards the layers, textures are inserted by the loading threads.
+	 */
+	mutable std::mutex mutex;
+
+	std::vector<layer> layers;
+
+	/**
+	 * Size of all layers, the size of the largest texture.
+	 */
+	int width;
+	int height;
+
+	GLuint texture_id;
+};
+
+} // namespace openage
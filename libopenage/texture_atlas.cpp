@@ -0,0 +1,177 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "error/error.h"
+#include "texture.h"
+
+namespace openage {
+
+TextureAtlas::TextureAtlas(int page_size, int max_texture_size)
+	:
+	page_size{page_size},
+	max_texture_size{std::min(max_texture_size, page_size - 1)} {}
+
+
+TextureAtlas::~TextureAtlas() {
+	this->clear();
+}
+
+
+bool TextureAtlas::reserve(page *target, int width, int height, int *x, int *y) {
+	for (auto &shelf : target->shelves) {
+		if (height <= shelf.height and shelf.used_width + width <= this->page_size) {
+			*x = shelf.used_width;
+			*y = shelf.y_position;
+			shelf.used_width += width;
+			return true;
+		}
+	}
+
+	int shelf_top = 0;
+	if (not target->shelves.empty()) {
+		const shelf &last = target->shelves.back();
+		shelf_top = last.y_position + last.height;
+	}
+
+	if (shelf_top + height > this->page_size) {
+		return false;
+	}
+
+	// the new shelf gets the height of its first texture
+	target->shelves.push_back({shelf_top, height, width});
+	*x = 0;
+	*y = shelf_top;
+	return true;
+}
+
+
+bool TextureAtlas::insert(Texture *texture) {
+	gl_texture_buffer *buffer = texture->buffer.get();
+
+	if (texture->atlas != nullptr or
+	    buffer == nullptr or
+	    buffer->transferred or
+	    not buffer->data or
+	    buffer->texture_format_in != GL_RGBA8 or
+	    texture->w > this->max_texture_size or
+	    texture->h > this->max_texture_size) {
+		return false;
+	}
+
+	// keep a transparent pixel between the textures,
+	// the linear magnification filter samples the neighbours otherwise.
+	int width = texture->w + 1;
+	int height = texture->h + 1;
+
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	size_t page_id = 0;
+	int x = 0, y = 0;
+	while (page_id < this->pages.size() and
+	       not this->reserve(this->pages[page_id].get(), width, height, &x, &y)) {
+		page_id += 1;
+	}
+
+	if (page_id == this->pages.size()) {
+		auto new_page = std::make_unique<page>();
+		new_page->pixels = std::make_unique<uint32_t[]>(this->page_size * this->page_size);
+		new_page->dirty_top = this->page_size;
+		new_page->dirty_bottom = 0;
+
+		bool reserved = this->reserve(new_page.get(), width, height, &x, &y);
+		ENSURE(reserved, "texture doesn't fit into an empty atlas page");
+
+		this->pages.push_back(std::move(new_page));
+	}
+
+	page &target = *this->pages[page_id];
+
+	for (int row = 0; row < texture->h; row++) {
+		memcpy(
+			target.pixels.get() + (y + row) * this->page_size + x,
+			buffer->data.get() + row * texture->w,
+			texture->w * sizeof(uint32_t)
+		);
+	}
+
+	target.dirty_top = std::min(target.dirty_top, y);
+	target.dirty_bottom = std::max(target.dirty_bottom, y + texture->h);
+
+	for (auto &subtexture : texture->subtextures) {
+		subtexture.x += x;
+		subtexture.y += y;
+	}
+
+	texture->atlas = this;
+	texture->atlas_page = page_id;
+	buffer->data = nullptr;
+
+	return true;
+}
+
+
+GLuint TextureAtlas::get_texture_id(size_t page_id) {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	ENSURE(page_id < this->pages.size(), "unknown atlas page " << page_id);
+	page &target = *this->pages[page_id];
+
+	if (target.texture_id == 0) {
+		glGenTextures(1, &target.texture_id);
+		glBindTexture(GL_TEXTURE_2D, target.texture_id);
+
+		// same drawing settings as the standalone textures
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glTexImage2D(
+			GL_TEXTURE_2D, 0,
+			GL_RGBA8, this->page_size, this->page_size, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, target.pixels.get()
+		);
+	}
+	else if (target.dirty_top < target.dirty_bottom) {
+		// only the changed rows are uploaded, over the full width
+		// as the pixels are stored row by row.
+		glBindTexture(GL_TEXTURE_2D, target.texture_id);
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0,
+			0, target.dirty_top, this->page_size, target.dirty_bottom - target.dirty_top,
+			GL_RGBA, GL_UNSIGNED_BYTE, target.pixels.get() + target.dirty_top * this->page_size
+		);
+	}
+
+	target.dirty_top = this->page_size;
+	target.dirty_bottom = 0;
+
+	return target.texture_id;
+}
+
+
+int TextureAtlas::get_page_size() const {
+	return this->page_size;
+}
+
+
+size_t TextureAtlas::get_page_count() {
+	std::lock_guard<std::mutex> lock{this->mutex};
+	return this->pages.size();
+}
+
+
+void TextureAtlas::clear() {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	for (auto &page : this->pages) {
+		if (page->texture_id != 0) {
+			glDeleteTextures(1, &page->texture_id);
+		}
+	}
+	this->pages.clear();
+}
+
+} // namespace openage
@@ -0,0 +1,111 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace openage {
+
+class Texture;
+
+/**
+ * Packs small textures into shared atlas pages, so sprites of
+ * different textures are drawn from the same opengl texture.
+ *
+ * Like the GlyphAtlas, the pages are filled with the
+ * "Shelf First-Fit" algorithm. The subtextures of a packed texture
+ * are moved to its position in the page, the texture then returns the
+ * page for drawing. The sprite batch groups sprites by opengl texture,
+ * so the sprites of all textures in a page share their draw calls.
+ *
+ * Textures are inserted while they are loaded, possibly on several
+ * threads. The pages are uploaded on the main thread when drawn.
+ */
+class TextureAtlas {
+public:
+	/**
+	 * @param page_size: width and height of each page.
+	 * @param max_texture_size: larger textures keep their own opengl texture.
+	 */
+	TextureAtlas(int page_size=1024, int max_texture_size=128);
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas &) = delete;
+	TextureAtlas &operator =(const TextureAtlas &) = delete;
+
+	/**
+	 * Copy the pixels of a texture into a page and rewrite its
+	 * subtexture coordinates. The texture's own pixels are freed.
+	 *
+	 * Only rgba8 images which were not uploaded yet are packed,
+	 * texture containers are uploaded as they are.
+	 *
+	 * @returns whether the texture was packed.
+	 */
+	bool insert(Texture *texture);
+
+	/**
+	 * The opengl texture of a page, pending changes are uploaded.
+	 * Call on the main thread.
+	 */
+	GLuint get_texture_id(size_t page);
+
+	int get_page_size() const;
+
+	size_t get_page_count();
+
+	/**
+	 * Remove all pages. The packed textures must be destroyed already.
+	 */
+	void clear();
+
+private:
+	/**
+	 * A row of textures with the height of the first one.
+	 */
+	struct shelf {
+		int y_position;
+		int height;
+		int used_width;
+	};
+
+	struct page {
+		/**
+		 * rgba8 pixels of the page, kept to add textures later on.
+		 */
+		std::unique_ptr<uint32_t[]> pixels;
+
+		std::vector<shelf> shelves;
+
+		GLuint texture_id = 0;
+
+		/**
+		 * Rows changed since the last upload, empty if top >= bottom.
+		 */
+		int dirty_top;
+		int dirty_bottom;
+	};
+
+	/**
+	 * Find space for a rectangle in the page.
+	 * Called with the mutex locked.
+	 */
+	bool reserve(page *target, int width, int height, int *x, int *y);
+
+	int page_size;
+	int max_texture_size;
+
+	/**
+	 * Guards the pages, textures are inserted by the loading threads.
+	 */
+	std::mutex mutex;
+
+	std::vector<std::unique_ptr<page>> pages;
+};
+
+} // namespace openage
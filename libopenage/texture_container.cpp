@@ -0,0 +1,193 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "texture_container.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "error/error.h"
+#include "util/asset_pack.h"
+
+namespace openage {
+
+namespace {
+
+constexpr uint32_t texture_container_version = 1;
+
+/**
+ * bytes of pixel data a level of the given size must have.
+ */
+uint64_t level_bytes(texture_pixel_format format, uint64_t w, uint64_t h) {
+	switch (format) {
+	case texture_pixel_format::rgba8:
+		return w * h * 4;
+	case texture_pixel_format::bc1:
+		return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+	case texture_pixel_format::bc3:
+		return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+	}
+	return 0;
+}
+
+} // anonymous namespace
+
+
+TextureContainer::TextureContainer(const std::string &filename)
+	:
+	filename{filename},
+	mapping{nullptr},
+	mapping_size{0},
+	data{nullptr} {
+
+	// the levels are aligned in the asset pack as well,
+	// so they're uploaded from it directly
+	this->packed = util::find_packed_file(filename);
+	if (this->packed) {
+		if (this->packed.size < sizeof(texture_container_header)) {
+			throw Error(MSG(err) << "Texture container is too small: " << filename);
+		}
+		this->data = this->packed.data;
+		this->mapping_size = this->packed.size;
+	}
+	else {
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw Error(MSG(err) << "Could not open texture container " << filename);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) < 0 or st.st_size < static_cast<off_t>(sizeof(texture_container_header))) {
+			close(fd);
+			throw Error(MSG(err) << "Texture container is too small: " << filename);
+		}
+
+		this->mapping_size = st.st_size;
+		this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		// the mapping stays valid without the descriptor
+		close(fd);
+
+		if (this->mapping == MAP_FAILED) {
+			this->mapping = nullptr;
+			throw Error(MSG(err) << "Could not map texture container " << filename);
+		}
+
+		this->data = static_cast<const char *>(this->mapping);
+	}
+
+	// copy the header and level table, the mapping may be unaligned for them
+	memcpy(&this->header, this->data, sizeof(this->header));
+
+	if (memcmp(this->header.magic, "OTEX", 4) != 0 or
+	    this->header.version != texture_container_version) {
+		this->unmap();
+		throw Error(MSG(err) << "Unknown texture container format in " << filename);
+	}
+
+	if (this->header.format > static_cast<uint32_t>(texture_pixel_format::bc3) or
+	    this->header.level_count == 0 or
+	    this->header.level_count > 32) {
+		this->unmap();
+		throw Error(MSG(err) << "Invalid texture container header in " << filename);
+	}
+
+	size_t table_end = sizeof(this->header) + this->header.level_count * sizeof(texture_container_level);
+	if (table_end > this->mapping_size) {
+		this->unmap();
+		throw Error(MSG(err) << "Truncated texture container " << filename);
+	}
+
+	this->levels.resize(this->header.level_count);
+	memcpy(this->levels.data(), this->data + sizeof(this->header),
+	       this->levels.size() * sizeof(texture_container_level));
+
+	for (auto &level : this->levels) {
+		uint64_t expected = level_bytes(this->get_format(), level.width, level.height);
+
+		if (level.size != expected or
+		    static_cast<uint64_t>(level.offset) + level.size > this->mapping_size) {
+			this->unmap();
+			throw Error(MSG(err) << "Invalid mip level in texture container " << filename);
+		}
+	}
+
+	if (this->levels[0].width != this->header.width or
+	    this->levels[0].height != this->header.height) {
+		this->unmap();
+		throw Error(MSG(err) << "The first level of texture container " << filename << " has the wrong size");
+	}
+}
+
+
+TextureContainer::~TextureContainer() {
+	this->unmap();
+}
+
+
+void TextureContainer::unmap() {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+		this->mapping = nullptr;
+	}
+}
+
+
+std::string TextureContainer::path_for(const std::string &image_filename) {
+	// replace the image suffix, like the .docx metafile
+	size_t suffix = image_filename.rfind('.');
+	size_t dir = image_filename.rfind('/');
+	if (suffix == std::string::npos or (dir != std::string::npos and suffix < dir)) {
+		return image_filename + ".otex";
+	}
+	return image_filename.substr(0, suffix) + ".otex";
+}
+
+
+bool TextureContainer::usable_for(const std::string &image_filename) {
+	if (util::find_packed_file(path_for(image_filename))) {
+		return true;
+	}
+
+	struct stat container_st;
+	if (stat(path_for(image_filename).c_str(), &container_st) < 0) {
+		return false;
+	}
+
+	// an image edited after the conversion takes precedence
+	struct stat image_st;
+	if (stat(image_filename.c_str(), &image_st) < 0) {
+		return true;
+	}
+	return container_st.st_mtime >= image_st.st_mtime;
+}
+
+
+texture_pixel_format TextureContainer::get_format() const {
+	return static_cast<texture_pixel_format>(this->header.format);
+}
+
+
+uint32_t TextureContainer::get_width() const {
+	return this->header.width;
+}
+
+
+uint32_t TextureContainer::get_height() const {
+	return this->header.height;
+}
+
+
+const std::vector<texture_container_level> &TextureContainer::get_levels() const {
+	return this->levels;
+}
+
+
+const void *TextureContainer::get_level_data(size_t level) const {
+	return this->data + this->levels.at(level).offset;
+}
+
+} // namespace openage
@@ -0,0 +1,111 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util/asset_pack.h"
+
+namespace openage {
+
+/**
+ * pixel formats of texture containers.
+ * the values are stored in the file, keep them stable.
+ */
+enum class texture_pixel_format : uint32_t {
+	rgba8 = 0,   //!< uncompressed, exact colors for the team color shader
+	bc1   = 1,   //!< s3tc dxt1
+	bc3   = 2,   //!< s3tc dxt5
+};
+
+/**
+ * file header of a texture container,
+ * written by openage/convert/texture.py. all values are little endian.
+ */
+struct texture_container_header {
+	char magic[4];           //!< "OTEX"
+	uint32_t version;
+	uint32_t format;         //!< a texture_pixel_format
+	uint32_t width;
+	uint32_t height;
+	uint32_t level_count;    //!< number of mip levels, followed by their table
+};
+
+/**
+ * one mip level in the table after the header.
+ */
+struct texture_container_level {
+	uint32_t width;
+	uint32_t height;
+	uint32_t offset;         //!< position of the pixel data in the file
+	uint32_t size;           //!< bytes of pixel data
+};
+
+/**
+ * A texture stored ready for uploading: the converter decodes the
+ * image once, the engine maps the file and hands the levels to opengl.
+ *
+ * The container lives next to the image and the .docx metafile,
+ * with the .otex suffix.
+ */
+class TextureContainer {
+public:
+	/**
+	 * map the container file into memory and validate it,
+	 * or use it from a mounted asset pack.
+	 * throws an Error if the file is invalid.
+	 */
+	TextureContainer(const std::string &filename);
+	~TextureContainer();
+
+	TextureContainer(const TextureContainer &) = delete;
+	TextureContainer &operator =(const TextureContainer &) = delete;
+
+	/**
+	 * the container file name for an image file name.
+	 */
+	static std::string path_for(const std::string &image_filename);
+
+	/**
+	 * whether there is a container for the image which is not
+	 * older than the image itself.
+	 */
+	static bool usable_for(const std::string &image_filename);
+
+	texture_pixel_format get_format() const;
+	uint32_t get_width() const;
+	uint32_t get_height() const;
+
+	const std::vector<texture_container_level> &get_levels() const;
+
+	/**
+	 * the pixel data of a mip level, valid while the container exists.
+	 */
+	const void *get_level_data(size_t level) const;
+
+private:
+	void unmap();
+
+	std::string filename;
+
+	void *mapping;
+	size_t mapping_size;
+
+	/**
+	 * keeps the asset pack mapped if the container is read from one.
+	 */
+	util::packed_file packed;
+
+	/**
+	 * the container contents, in the mapping or the pack.
+	 */
+	const char *data;
+
+	texture_container_header header;
+	std::vector<texture_container_level> levels;
+};
+
+} // namespace openage
@@ -0,0 +1,64 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "texture_palette.h"
+
+#include <cstring>
+
+namespace openage {
+
+namespace {
+
+/**
+ * slots of the color lookup table, twice the palette size
+ * keeps the probe sequences short.
+ */
+constexpr size_t lookup_size = texture_palette_size * 2;
+
+} // anonymous namespace
+
+
+bool make_texture_palette(const uint32_t *pixels, size_t count,
+                          uint8_t *indices, uint32_t *palette) {
+	memset(palette, 0, texture_palette_size * sizeof(uint32_t));
+
+	// open addressing table of the colors seen so far,
+	// slot value 0 is empty, otherwise the palette index + 1.
+	uint16_t lookup[lookup_size] = {};
+	size_t colors = 0;
+
+	// sprites have long runs of the same color, mostly transparency
+	uint32_t previous = 0;
+	uint8_t previous_index = 0;
+	bool has_previous = false;
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t color = pixels[i];
+		if (has_previous and color == previous) {
+			indices[i] = previous_index;
+			continue;
+		}
+
+		size_t slot = (color * 2654435761u) % lookup_size;
+		while (lookup[slot] != 0 and palette[lookup[slot] - 1] != color) {
+			slot = (slot + 1) % lookup_size;
+		}
+
+		if (lookup[slot] == 0) {
+			if (colors == texture_palette_size) {
+				return false;
+			}
+			palette[colors] = color;
+			colors += 1;
+			lookup[slot] = colors;
+		}
+
+		previous = color;
+		previous_index = lookup[slot] - 1;
+		has_previous = true;
+		indices[i] = previous_index;
+	}
+
+	return true;
+}
+
+} // namespace openage
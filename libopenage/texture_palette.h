@@ -0,0 +1,31 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace openage {
+
+/**
+ * number of colors of a texture palette, the pixels index it with a byte.
+ */
+constexpr size_t texture_palette_size = 256;
+
+/**
+ * Store rgba8 pixels as indices into a palette of their colors.
+ *
+ * Sprites converted from slp files use one 256 color palette, plus the
+ * player color markers and the shadow, so they mostly fit. The colors
+ * are kept exactly, the team color shader still finds the markers.
+ *
+ * @param pixels: count rgba8 pixels
+ * @param indices: count bytes, the palette index of each pixel
+ * @param palette: texture_palette_size colors, unused ones are zero
+ * @returns false if the pixels have more colors than fit into the
+ *          palette, indices and palette are undefined then.
+ */
+bool make_texture_palette(const uint32_t *pixels, size_t count,
+                          uint8_t *indices, uint32_t *palette);
+
+} // namespace openage
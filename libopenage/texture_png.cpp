@@ -0,0 +1,209 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "texture_png.h"
+
+#include <png.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "error/error.h"
+#include "job/cancellation_token.h"
+
+namespace openage {
+
+namespace {
+
+constexpr size_t png_signature_size = 8;
+
+/**
+ * the message of a libpng error. no destructor, libpng jumps
+ * out of the failed function with longjmp.
+ */
+struct png_error_state {
+	char message[256];
+};
+
+void on_png_error(png_structp png, png_const_charp message) {
+	auto *errors = static_cast<png_error_state *>(png_get_error_ptr(png));
+	std::snprintf(errors->message, sizeof(errors->message), "%s", message);
+	png_longjmp(png, 1);
+}
+
+void on_png_warning(png_structp, png_const_charp) {}
+
+void read_from_file(png_structp png, png_bytep out, png_size_t count) {
+	auto *file = static_cast<FILE *>(png_get_io_ptr(png));
+	if (fread(out, 1, count, file) != count) {
+		png_error(png, "unexpected end of file");
+	}
+}
+
+struct memory_source {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+};
+
+void read_from_memory(png_structp png, png_bytep out, png_size_t count) {
+	auto *source = static_cast<memory_source *>(png_get_io_ptr(png));
+	if (count > source->size - source->pos) {
+		png_error(png, "unexpected end of data");
+	}
+	memcpy(out, source->data + source->pos, count);
+	source->pos += count;
+}
+
+
+/**
+ * the libpng state of one image, destroyed when the decoding ends.
+ */
+class png_reader {
+public:
+	png_reader(const std::string &name)
+		:
+		name{name},
+		errors{},
+		png{nullptr},
+		info{nullptr} {
+
+		this->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &this->errors,
+		                                   on_png_error, on_png_warning);
+		if (this->png != nullptr) {
+			this->info = png_create_info_struct(this->png);
+		}
+		if (this->info == nullptr) {
+			png_destroy_read_struct(&this->png, nullptr, nullptr);
+			throw Error(MSG(err) << "Could not load texture from " << name << ": libpng is out of memory");
+		}
+	}
+
+	~png_reader() {
+		png_destroy_read_struct(&this->png, &this->info, nullptr);
+	}
+
+	png_reader(const png_reader &) = delete;
+	png_reader &operator =(const png_reader &) = delete;
+
+	/**
+	 * the function reading the png data from the source.
+	 */
+	void read_from(void *source, png_rw_ptr read) {
+		png_set_read_fn(this->png, source, read);
+	}
+
+	/**
+	 * decodes the image after the signature, which was read already.
+	 */
+	std::unique_ptr<uint32_t[]> decode(int *w, int *h) {
+		png_uint_32 width, height;
+		int passes;
+		if (not this->read_header(&width, &height, &passes)) {
+			this->fail();
+		}
+
+		auto pixels = std::make_unique<uint32_t[]>(static_cast<size_t>(width) * height);
+		if (not this->read_rows(pixels.get(), width, height, passes)) {
+			this->fail();
+		}
+
+		*w = width;
+		*h = height;
+		return pixels;
+	}
+
+private:
+	/**
+	 * reads the size and sets up the conversion to rgba8.
+	 * false if libpng failed.
+	 */
+	bool read_header(png_uint_32 *width, png_uint_32 *height, int *passes) {
+		if (setjmp(png_jmpbuf(this->png))) {
+			return false;
+		}
+
+		png_set_sig_bytes(this->png, png_signature_size);
+		png_read_info(this->png, this->info);
+
+		png_set_expand(this->png);
+		png_set_strip_16(this->png);
+		png_set_gray_to_rgb(this->png);
+		png_set_add_alpha(this->png, 0xff, PNG_FILLER_AFTER);
+		*passes = png_set_interlace_handling(this->png);
+		png_read_update_info(this->png, this->info);
+
+		*width = png_get_image_width(this->png, this->info);
+		*height = png_get_image_height(this->png, this->info);
+		if (png_get_rowbytes(this->png, this->info) != *width * 4) {
+			png_error(this->png, "not convertible to rgba8");
+		}
+		return true;
+	}
+
+	/**
+	 * decodes the rows straight into the pixels. false if libpng
+	 * failed, stops the job when it was cancelled.
+	 */
+	bool read_rows(uint32_t *pixels, png_uint_32 width, png_uint_32 height, int passes) {
+		const job::CancellationToken &cancellation = job::CancellationToken::current();
+
+		if (setjmp(png_jmpbuf(this->png))) {
+			return false;
+		}
+
+		// interlaced images are refined in each pass
+		for (int pass = 0; pass < passes; pass++) {
+			for (png_uint_32 y = 0; y < height; y++) {
+				cancellation.check();
+				png_read_row(this->png, reinterpret_cast<png_bytep>(pixels + static_cast<size_t>(y) * width), nullptr);
+			}
+		}
+		png_read_end(this->png, nullptr);
+		return true;
+	}
+
+	[[noreturn]] void fail() const {
+		throw Error(MSG(err) << "Could not load texture from " << this->name << ": " << this->errors.message);
+	}
+
+	const std::string &name;
+	png_error_state errors;
+	png_structp png;
+	png_infop info;
+};
+
+} // anonymous namespace
+
+
+std::unique_ptr<uint32_t[]> read_png(const std::string &filename, int *w, int *h) {
+	std::unique_ptr<FILE, int (*)(FILE *)> file{fopen(filename.c_str(), "rb"), fclose};
+	if (not file) {
+		throw Error(MSG(err) << "Could not load texture from " << filename << ": " << strerror(errno));
+	}
+
+	png_byte signature[png_signature_size];
+	if (fread(signature, 1, png_signature_size, file.get()) != png_signature_size or
+	    png_sig_cmp(signature, 0, png_signature_size) != 0) {
+		return nullptr;
+	}
+
+	png_reader reader{filename};
+	reader.read_from(file.get(), read_from_file);
+	return reader.decode(w, h);
+}
+
+
+std::unique_ptr<uint32_t[]> read_png(const uint8_t *data, size_t size,
+                                     const std::string &name, int *w, int *h) {
+	if (size < png_signature_size or png_sig_cmp(data, 0, png_signature_size) != 0) {
+		return nullptr;
+	}
+
+	memory_source source{data, size, png_signature_size};
+	png_reader reader{name};
+	reader.read_from(&source, read_from_memory);
+	return reader.decode(w, h);
+}
+
+} // namespace openage
@@ -0,0 +1,35 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace openage {
+
+/**
+ * Decode a png image to rgba8 pixels.
+ *
+ * The rows are decoded by libpng straight into the returned pixels,
+ * which are uploaded as they are. Images without alpha get an opaque
+ * one, palette and gray images are expanded. Decoding on a job stops
+ * between the rows when the job is cancelled.
+ *
+ * @param filename: the file to read, it is streamed from the disk
+ * @param w, h: the size of the image
+ * @returns w * h rgba8 pixels, or nullptr if the file is no png
+ * @throws Error if the file can't be read or the png is broken
+ */
+std::unique_ptr<uint32_t[]> read_png(const std::string &filename, int *w, int *h);
+
+/**
+ * Decode a png image in memory, like the one of a file.
+ *
+ * @param name: the name of the image for errors
+ */
+std::unique_ptr<uint32_t[]> read_png(const uint8_t *data, size_t size,
+                                     const std::string &name, int *w, int *h);
+
+} // namespace openage
@@ -0,0 +1,298 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "texture_residency.h"
+
+#include <algorithm>
+
+#include "error/error.h"
+#include "job/job_manager.h"
+#include "log/log.h"
+#include "render_command_list.h"
+#include "texture.h"
+#include "util/metrics.h"
+
+namespace openage {
+
+namespace {
+
+/**
+ * textures used within this many frames are never evicted,
+ * so the textures of the visible scene don't thrash.
+ */
+constexpr uint64_t min_eviction_age = 60;
+
+/**
+ * bytes of pixels uploaded per frame if no other budget is set.
+ */
+constexpr size_t default_upload_budget = size_t{16} * 1024 * 1024;
+
+} // anonymous namespace
+
+
+TextureResidency::TextureResidency(size_t budget)
+	:
+	state{std::make_shared<reload_state>()},
+	job_manager{nullptr},
+	placeholder{nullptr},
+	frame{0},
+	uploaded_bytes{0} {
+
+	this->state->stats = texture_residency_stats{budget, 0, 0, 0, 0, 0, 0, 0,
+	                                             default_upload_budget, 0, 0};
+}
+
+
+TextureResidency::~TextureResidency() {
+	for (Texture *texture : this->textures) {
+		texture->set_residency(nullptr);
+	}
+
+	// pending reloads are dropped by their callbacks
+	this->state->loading.clear();
+	this->state->failed.clear();
+}
+
+
+void TextureResidency::set_job_manager(job::JobManager *job_manager) {
+	this->job_manager = job_manager;
+}
+
+
+void TextureResidency::set_placeholder(Texture *placeholder) {
+	this->placeholder = placeholder;
+}
+
+
+void TextureResidency::set_budget(size_t budget) {
+	this->state->stats.budget = budget;
+}
+
+
+void TextureResidency::set_upload_budget(size_t bytes) {
+	this->state->stats.upload_budget = bytes;
+}
+
+
+bool TextureResidency::reserve_upload(size_t bytes) {
+	texture_residency_stats &stats = this->state->stats;
+
+	// larger textures than the budget are uploaded alone
+	if (this->uploaded_bytes > 0 and this->uploaded_bytes + bytes > stats.upload_budget) {
+		stats.deferred += 1;
+		return false;
+	}
+
+	this->uploaded_bytes += bytes;
+	return true;
+}
+
+
+void TextureResidency::add(Texture *texture) {
+	ENSURE(texture != this->placeholder, "the placeholder texture can't be evicted");
+
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+	this->textures.insert(texture);
+	texture->set_residency(this);
+}
+
+
+void TextureResidency::remove(Texture *texture) {
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+	this->textures.erase(texture);
+	this->state->loading.erase(texture);
+	this->state->failed.erase(texture);
+	texture->set_residency(nullptr);
+}
+
+
+uint64_t TextureResidency::get_frame() const {
+	return this->frame;
+}
+
+
+const texture_residency_stats &TextureResidency::get_stats() const {
+	return this->state->stats;
+}
+
+
+GLuint TextureResidency::get_placeholder_id() const {
+	ENSURE(this->placeholder != nullptr, "no placeholder texture for evicted textures");
+	return this->placeholder->get_texture_id();
+}
+
+
+void TextureResidency::next_frame() {
+	texture_residency_stats &stats = this->state->stats;
+
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+
+	size_t resident_bytes = 0;
+	size_t resident_count = 0;
+	for (Texture *texture : this->textures) {
+		if (texture->is_resident()) {
+			resident_bytes += texture->get_gpu_size();
+			resident_count += 1;
+		}
+	}
+
+	stats.resident_bytes = resident_bytes;
+	stats.resident_count = resident_count;
+	stats.texture_count = this->textures.size();
+	stats.loading_count = this->state->loading.size();
+
+	if (resident_bytes > stats.budget) {
+		this->evict(resident_bytes);
+	}
+	else {
+		this->prefetch(resident_bytes);
+	}
+
+	static util::MetricGauge &metric_bytes = util::metrics().gauge("textures.resident_bytes");
+	static util::MetricGauge &metric_loading = util::metrics().gauge("textures.loading");
+	static util::MetricGauge &metric_evictions = util::metrics().gauge("textures.evictions");
+	static util::MetricGauge &metric_deferred = util::metrics().gauge("textures.deferred_uploads");
+	metric_bytes.set(stats.resident_bytes);
+	metric_loading.set(stats.loading_count);
+	metric_evictions.set(stats.evictions);
+	metric_deferred.set(stats.deferred);
+
+	this->frame += 1;
+	this->uploaded_bytes = 0;
+}
+
+
+void TextureResidency::evict(size_t resident_bytes) {
+	texture_residency_stats &stats = this->state->stats;
+
+	this->candidates.clear();
+	for (Texture *texture : this->textures) {
+		if (texture->is_resident() and
+		    texture->get_last_used() + min_eviction_age <= this->frame) {
+			this->candidates.push_back(texture);
+		}
+	}
+
+	std::sort(std::begin(this->candidates), std::end(this->candidates),
+		[](const Texture *a, const Texture *b) {
+			return a->get_last_used() < b->get_last_used();
+		}
+	);
+
+	size_t evicted = 0;
+	for (Texture *texture : this->candidates) {
+		if (resident_bytes <= stats.budget) {
+			break;
+		}
+
+		resident_bytes -= texture->get_gpu_size();
+		stats.resident_count -= 1;
+		texture->evict();
+		evicted += 1;
+	}
+
+	stats.resident_bytes = resident_bytes;
+	stats.evictions += evicted;
+
+	if (resident_bytes > stats.budget) {
+		stats.over_budget += 1;
+	}
+
+	if (evicted > 0) {
+		log::log(MSG(dbg) << "Evicted " << evicted << " textures, "
+		         << resident_bytes / (1024 * 1024) << " MiB of textures remain resident");
+	}
+}
+
+
+void TextureResidency::prefetch(size_t resident_bytes) {
+	texture_residency_stats &stats = this->state->stats;
+
+	for (Texture *texture : this->textures) {
+		if (this->uploaded_bytes >= stats.upload_budget) {
+			break;
+		}
+
+		size_t size = texture->get_pending_upload_size();
+		if (size == 0 or
+		    this->uploaded_bytes + size > stats.upload_budget or
+		    resident_bytes + size > stats.budget) {
+			continue;
+		}
+
+		texture->prefetch();
+		resident_bytes += size;
+		stats.resident_bytes = resident_bytes;
+		stats.resident_count += 1;
+		stats.prefetched += 1;
+	}
+}
+
+
+void TextureResidency::request(const Texture *used) {
+	std::lock_guard<std::mutex> lock{this->textures_mutex};
+
+	// textures are drawn as const, but the tracked ones may be modified
+	auto it = this->textures.find(const_cast<Texture *>(used));
+	ENSURE(it != std::end(this->textures), "texture " << used->get_filename() << " is not tracked");
+	Texture *texture = *it;
+
+	if (this->state->loading.count(texture) > 0 or
+	    this->state->failed.count(texture) > 0) {
+		return;
+	}
+
+	texture_residency_stats &stats = this->state->stats;
+	std::string filename = texture->get_filename();
+	bool palette = texture->is_palette_allowed();
+
+	if (this->job_manager == nullptr) {
+		int w, h;
+		texture->set_pixels(Texture::read_pixels(filename, &w, &h, palette));
+		stats.reloads += 1;
+		return;
+	}
+
+	this->state->loading.insert(texture);
+	stats.loading_count = this->state->loading.size();
+
+	std::shared_ptr<reload_state> state = this->state;
+
+	this->job_manager->enqueue<std::shared_ptr<gl_texture_buffer>>(
+		[filename, palette]() {
+			int w, h;
+			return std::shared_ptr<gl_texture_buffer>{Texture::read_pixels(filename, &w, &h, palette)};
+		},
+		[state, texture, filename](job::result_function_t<std::shared_ptr<gl_texture_buffer>> get_result) {
+			std::shared_ptr<gl_texture_buffer> pixels;
+			std::string error;
+			try {
+				pixels = get_result();
+			}
+			catch (Error &exc) {
+				error = exc.what();
+			}
+
+			// the textures are requested and evicted where the
+			// frame is drawn, so the result is handed over there as well.
+			RenderCommandList::submit([state, texture, filename, pixels, error] {
+				// the texture or the residency were destroyed meanwhile
+				if (state->loading.erase(texture) == 0) {
+					return;
+				}
+				state->stats.loading_count = state->loading.size();
+
+				if (not pixels) {
+					// keep drawing the placeholder instead of retrying every frame
+					log::log(MSG(err) << "Failed to reload texture " << filename << ": " << error);
+					state->failed.insert(texture);
+					return;
+				}
+
+				texture->set_pixels(std::make_unique<gl_texture_buffer>(std::move(*pixels)));
+				state->stats.reloads += 1;
+			});
+		}
+	);
+}
+
+} // namespace openage
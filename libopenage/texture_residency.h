@@ -0,0 +1,184 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <epoxy/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace openage {
+
+namespace job {
+class JobManager;
+} // namespace job
+
+class Texture;
+
+/**
+ * counters of the texture residency, for monitoring.
+ */
+struct texture_residency_stats {
+	size_t budget;           //!< gpu memory budget in bytes
+	size_t resident_bytes;   //!< gpu memory used by tracked textures
+	size_t resident_count;   //!< tracked textures in gpu memory
+	size_t texture_count;    //!< all tracked textures
+	size_t loading_count;    //!< textures being reloaded right now
+	uint64_t evictions;      //!< textures evicted so far
+	uint64_t reloads;        //!< textures reloaded so far
+	uint64_t over_budget;    //!< frames in which the budget couldn't be kept
+	size_t upload_budget;    //!< bytes uploaded per frame
+	uint64_t deferred;       //!< uploads moved to a later frame
+	uint64_t prefetched;     //!< textures uploaded before they were drawn
+};
+
+/**
+ * Keeps the gpu memory used by textures within a budget.
+ *
+ * Textures record the frame in which they were used last. When the
+ * budget is exceeded at the end of a frame, the least recently used
+ * textures are evicted. Textures used in the last few frames
+ * are kept, even if that exceeds the budget.
+ *
+ * When an evicted texture is used again, its file is read on the job
+ * manager, and the texture is drawn with the placeholder texture
+ * until the pixels are back.
+ *
+ * The uploads of pixels are limited per frame, so a frame in which
+ * many new textures appear doesn't hitch. The textures beyond the
+ * upload budget are drawn with the placeholder until a later frame.
+ * Textures whose pixels were read but which weren't drawn yet are
+ * uploaded ahead with the budget left at the end of a frame.
+ *
+ * Textures may be added and removed from any thread, the other
+ * methods are called where the frame's render commands are executed.
+ */
+class TextureResidency {
+public:
+	TextureResidency(size_t budget);
+	~TextureResidency();
+
+	TextureResidency(const TextureResidency &) = delete;
+	TextureResidency &operator =(const TextureResidency &) = delete;
+
+	/**
+	 * the job manager that reloads textures.
+	 * without one, they are reloaded on the main thread.
+	 */
+	void set_job_manager(job::JobManager *job_manager);
+
+	/**
+	 * texture drawn while the used one is reloaded.
+	 * it is never evicted.
+	 */
+	void set_placeholder(Texture *placeholder);
+
+	void set_budget(size_t budget);
+
+	/**
+	 * bytes of pixels uploaded per frame.
+	 * the first upload of a frame is allowed even beyond it.
+	 */
+	void set_upload_budget(size_t bytes);
+
+	/**
+	 * start tracking a texture.
+	 */
+	void add(Texture *texture);
+
+	/**
+	 * stop tracking a texture, called by its destructor.
+	 */
+	void remove(Texture *texture);
+
+	/**
+	 * called when all textures of a frame were used.
+	 * evicts textures if the budget is exceeded.
+	 */
+	void next_frame();
+
+	/**
+	 * account for an upload in this frame.
+	 *
+	 * @returns false if the upload budget is used up,
+	 *          the texture is uploaded in a later frame then.
+	 */
+	bool reserve_upload(size_t bytes);
+
+	/**
+	 * the current frame number.
+	 */
+	uint64_t get_frame() const;
+
+	/**
+	 * reload an evicted texture, called when it is used.
+	 * repeated requests are ignored until the texture is loaded.
+	 */
+	void request(const Texture *texture);
+
+	/**
+	 * opengl id of the placeholder texture.
+	 */
+	GLuint get_placeholder_id() const;
+
+	const texture_residency_stats &get_stats() const;
+
+private:
+	/**
+	 * state shared with the reload jobs, as their callbacks may
+	 * run after a texture or the residency was destroyed.
+	 */
+	struct reload_state {
+		std::unordered_set<Texture *> loading;
+
+		/**
+		 * textures whose reload failed, they keep the placeholder.
+		 */
+		std::unordered_set<Texture *> failed;
+
+		texture_residency_stats stats;
+	};
+
+	/**
+	 * evict least recently used textures until the budget is kept.
+	 * called with the textures_mutex locked.
+	 */
+	void evict(size_t resident_bytes);
+
+	/**
+	 * upload textures that weren't drawn yet with the
+	 * upload budget left in this frame.
+	 * called with the textures_mutex locked.
+	 */
+	void prefetch(size_t resident_bytes);
+
+	std::shared_ptr<reload_state> state;
+
+	/**
+	 * guards the tracked textures, they are added while
+	 * the game specification is loaded in the background.
+	 */
+	std::mutex textures_mutex;
+
+	std::unordered_set<Texture *> textures;
+
+	/**
+	 * eviction candidates, kept to avoid allocations.
+	 */
+	std::vector<Texture *> candidates;
+
+	job::JobManager *job_manager;
+	Texture *placeholder;
+
+	uint64_t frame;
+
+	/**
+	 * bytes uploaded in this frame.
+	 */
+	size_t uploaded_bytes;
+};
+
+} // namespace openage
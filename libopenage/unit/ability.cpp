@@ -1,9 +1,10 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include <memory>
 
 #include "../terrain/terrain_object.h"
 #include "../gamestate/player.h"
+#include "../util/perfect_hash.h"
 #include "ability.h"
 #include "action.h"
 #include "command.h"
@@ -11,6 +12,38 @@
 
 namespace openage {
 
+namespace {
+
+/**
+ * names of the ability types, in the order of the enum
+ */
+constexpr const char *ability_names[] = {
+	"move",
+	"patrol",
+	"set_point",
+	"garrison",
+	"ungarrison",
+	"train",
+	"build",
+	"research",
+	"gather",
+	"attack",
+	"convert",
+	"repair",
+	"heal",
+};
+
+static_assert(sizeof(ability_names) / sizeof(ability_names[0]) == ability_type_size,
+              "each ability type needs a name");
+
+constexpr auto ability_name_index = util::make_perfect_hash(ability_names);
+
+} // anonymous namespace
+
+ability_type ability_from_name(const std::string &name) {
+	return static_cast<ability_type>(ability_name_index.find(name));
+}
+
 bool UnitAbility::has_hitpoints(Unit &target) {
 	return target.has_attribute(attr_type::hitpoints) &&
 	       target.get_attribute<attr_type::hitpoints>().current > 0;
@@ -82,7 +115,8 @@ void MoveAbility::invoke(Unit &to_modify, const Command &cmd, bool play_sound) {
 
 	if (cmd.has_position()) {
 		auto target = cmd.position();
-		to_modify.push_action(std::make_unique<MoveAction>(&to_modify, target));
+		bool group_move = cmd.has_flag(command_flag::group_move);
+		to_modify.push_action(std::make_unique<MoveAction>(&to_modify, target, true, group_move));
 	}
 	else if (cmd.has_unit()) {
 		auto target = cmd.unit();
@@ -407,34 +441,11 @@ ability_set UnitAbility::set_from_list(const std::vector<ability_type> &items) {
 namespace std {
 
 string to_string(const openage::ability_type &at) {
-	switch (at) {
-	case openage::ability_type::move:
-		return "move";
-	case openage::ability_type::garrison:
-		return "garrison";
-	case openage::ability_type::ungarrison:
-		return "ungarrison";
-	case openage::ability_type::patrol:
-		return "patrol";
-	case openage::ability_type::train:
-		return "train";
-	case openage::ability_type::build:
-		return "build";
-	case openage::ability_type::research:
-		return "research";
-	case openage::ability_type::gather:
-		return "gather";
-	case openage::ability_type::attack:
-		return "attack";
-	case openage::ability_type::convert:
-		return "convert";
-	case openage::ability_type::repair:
-		return "repair";
-	case openage::ability_type::heal:
-		return "heal";
-	default:
+	size_t index = static_cast<size_t>(at);
+	if (index >= openage::ability_name_index.size()) {
 		return "unknown";
 	}
+	return openage::ability_name_index.key(index);
 }
 
 } // namespace std
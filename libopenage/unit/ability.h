@@ -1,9 +1,11 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <array>
 #include <bitset>
 #include <memory>
+#include <string>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -47,6 +49,19 @@ constexpr int ability_type_size = static_cast<int>(ability_type::MAX);
 using ability_set = std::bitset<ability_type_size>;
 using ability_id_t = unsigned int;
 
+/**
+ * the ability type of the name given by std::to_string,
+ * or ability_type::MAX for unknown names.
+ */
+ability_type ability_from_name(const std::string &name);
+
+class UnitAbility;
+
+/**
+ * the abilities of a unit, indexed by their type
+ */
+using ability_table = std::array<std::shared_ptr<UnitAbility>, ability_type_size>;
+
 /**
  * all bits set to 1
  */
@@ -1,19 +1,62 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include <algorithm>
 #include <cmath>
 
 #include "../pathfinding/a_star.h"
+#include "../pathfinding/flow_field.h"
 #include "../pathfinding/heuristics.h"
+#include "../pathfinding/hierarchical.h"
+#include "../pathfinding/path_cache.h"
+#include "../sprite_batch.h"
 #include "../terrain/terrain.h"
 #include "../terrain/terrain_search.h"
 #include "action.h"
 #include "command.h"
+#include "damage_table.h"
 #include "producer.h"
+#include "projectile_system.h"
+#include "target_acquisition.h"
 #include "unit_texture.h"
 
 namespace openage {
 
+namespace {
+
+/**
+ * idle units look for targets within this distance.
+ */
+constexpr coord::phys_t idle_search_radius = 5 * coord::settings::phys_per_tile;
+
+/**
+ * milliseconds between the target searches of an idle unit.
+ */
+constexpr unsigned int idle_search_interval = 500;
+
+/**
+ * units retasking after their target is gone look this far.
+ */
+constexpr coord::phys_t retask_search_radius = 16 * coord::settings::phys_per_tile;
+
+/**
+ * whether the unit looks for targets to attack or heal by itself.
+ */
+bool seeks_targets(Unit *unit) {
+	return unit->location &&
+	       unit->has_attribute(attr_type::owner) &&
+	       unit->has_attribute(attr_type::attack) &&
+	       unit->get_attribute<attr_type::attack>().stance != attack_stance::do_nothing;
+}
+
+/**
+ * the abilities units use on the targets they find by themselves.
+ */
+ability_set auto_task_abilities() {
+	return UnitAbility::set_from_list({ability_type::attack, ability_type::heal});
+}
+
+} // anonymous namespace
+
 bool UnitAction::show_debug = false;
 
 coord::phys_t UnitAction::adjacent_range(Unit *u) {
@@ -42,8 +85,8 @@ UnitAction::UnitAction(Unit *u, graphic_type initial_gt)
 	:
 	entity{u},
 	graphic{initial_gt},
-	frame{.0f},
-	frame_rate{.0f} {
+	frame_rate{.0f},
+	animation{0} {
 
 	auto &g_set = this->current_graphics();
 	if (g_set.count(initial_gt) > 0) {
@@ -59,13 +102,19 @@ UnitAction::UnitAction(Unit *u, graphic_type initial_gt)
 		this->entity->log(MSG(dbg) << "Broken graphic (not available)");
 	}
 
+	float start_frame = 0;
 	if (this->frame_rate == 0) {
 
 		// a random starting point for static graphics
 		// this creates variations in trees / houses etc
 		// this value is also deterministic to match across clients
-		this->frame = (u->id * u->id * 19249) & 0xff;
+		start_frame = (u->id * u->id * 19249) & 0xff;
 	}
+	this->entity->get_container()->get_animations().add(this, start_frame);
+}
+
+UnitAction::~UnitAction() {
+	this->entity->get_container()->get_animations().remove(this->animation);
 }
 
 graphic_type UnitAction::type() const {
@@ -73,7 +122,11 @@ graphic_type UnitAction::type() const {
 }
 
 float UnitAction::current_frame() const {
-	return this->frame;
+	return this->entity->get_container()->get_animations().get_frame(this->animation);
+}
+
+void UnitAction::animate(float rate) {
+	this->entity->get_container()->get_animations().play(this->animation, rate);
 }
 
 const graphic_set &UnitAction::current_graphics() const {
@@ -85,6 +138,8 @@ const graphic_set &UnitAction::current_graphics() const {
 void UnitAction::draw_debug() {
 	// draw debug content if available
 	if(show_debug && this->debug_draw_action) {
+		// the debug drawing is not batched, keep it above the sprites
+		SpriteBatch::flush_active();
 		this->debug_draw_action();
 	}
 }
@@ -100,12 +155,8 @@ void UnitAction::face_towards(const coord::phys3 pos) {
 void UnitAction::damage_object(Unit &target, unsigned dmg) {
 	if (target.has_attribute(attr_type::hitpoints)) {
 		auto &hp = target.get_attribute<attr_type::hitpoints>();
-		if (hp.current > dmg) {
-			hp.current -= dmg;
-		}
-		else {
-			hp.current = 0;
-		}
+		target.set_hitpoints(hp.current > dmg ? hp.current - dmg : 0);
+		target.wake();
 	}
 }
 
@@ -114,29 +165,18 @@ void UnitAction::damage_object(Unit &target) {
 		auto &hp = target.get_attribute<attr_type::hitpoints>();
 
 		if (target.has_attribute(attr_type::armor) && this->entity->has_attribute(attr_type::attack)) {
-			auto &armor = target.get_attribute<attr_type::armor>().armor;
-			auto &damage = this->entity->get_attribute<attr_type::attack>().damage;
-
-			unsigned int actual_damage = 0;
-			for (const auto &pair : armor) {
-				auto search = damage.find(pair.first);
-				if (search != damage.end()) {
-					if (pair.second < search->second) {
-						actual_damage += search->second - pair.second;
-					}
-				}
-			}
-			// TODO add elevation modifier here
-			if (actual_damage < 1) {
-				actual_damage = 1;
-			}
-
-			if (hp.current > actual_damage) {
-				hp.current -= actual_damage;
+			unsigned int actual_damage;
+			if (this->entity->unit_type && target.unit_type &&
+			    this->entity->has_attribute(attr_type::owner)) {
+				auto &player = this->entity->get_attribute<attr_type::owner>().player;
+				actual_damage = player.damage_table.get(*this->entity, target);
 			}
 			else {
-				hp.current = 0;
+				actual_damage = DamageTable::compute(*this->entity, target);
 			}
+
+			target.set_hitpoints(hp.current > actual_damage ? hp.current - actual_damage : 0);
+			target.wake();
 		}
 		else {
 			// TODO remove (keep for testing)
@@ -196,7 +236,9 @@ void TargetAction::update(unsigned int time) {
 	if (this->dist_to_target <= this->radius) {
 
 		// the derived class controls what to
-		// do when in range of the target
+		// do when in range of the target,
+		// which may change the target's state
+		target_ptr->wake();
 		this->update_in_range(time, target_ptr);
 		this->repath_attempts = 10;
 	}
@@ -223,22 +265,25 @@ void TargetAction::on_completion() {
 	// such as gathers targeting a new resource
 	// when the current target expires
 
-	// find a different target with same type
-	TerrainObject *new_target = nullptr;
+	// find a different target with same type,
+	// searched by the container in one of the next ticks
+	TargetAcquisition &acquisition = this->entity->get_container()->get_acquisition();
 	if (this->name() == "gather") {
-		new_target = find_near(*this->entity->location,
-			[this](const TerrainObject &obj) {
-				return obj.unit.unit_type->id() == this->target_type_id &&
+		int type_id = this->target_type_id;
+		acquisition.request(
+			*this->entity, retask_search_radius,
+			[type_id](const TerrainObject &obj) {
+				return obj.unit.unit_type->id() == type_id &&
 				       obj.unit.has_attribute(attr_type::resource) &&
 				       obj.unit.get_attribute<attr_type::resource>().amount > 0.0f;
-			});
+			},
+			ability_set{}.set(), nullptr, false
+		);
 	}
-
-	if (new_target) {
-		this->entity->log(MSG(dbg) << "auto retasking");
-		auto &pl_attr = this->entity->get_attribute<attr_type::owner>();
-		Command cmd(pl_attr.player, &new_target->unit);
-		this->entity->queue_cmd(cmd);
+	else if (this->name() == "attack" && seeks_targets(this->entity)) {
+		// the fight goes on, these are searched first
+		acquisition.request(*this->entity, retask_search_radius, nullptr,
+		                    auto_task_abilities(), nullptr, true);
 	}
 }
 
@@ -286,6 +331,7 @@ void TargetAction::set_target(UnitReference new_target) {
 DecayAction::DecayAction(Unit *e)
 	:
 	UnitAction(e, graphic_type::standing),
+	frame{.0f},
 	end_frame{.0f} {
 
 	auto &g_set = this->current_graphics();
@@ -304,9 +350,24 @@ bool DecayAction::completed() const {
 	return this->frame > this->end_frame;
 }
 
+float DecayAction::current_frame() const {
+	return this->frame;
+}
+
+unsigned int DecayAction::sleep_time() const {
+	if (this->frame_rate <= 0) {
+		return sleep_forever;
+	}
+
+	// sleep until the next frame is shown, or the decay completes
+	float next_frame = std::min(std::floor(this->frame) + 1, this->end_frame + 1);
+	return static_cast<unsigned int>(std::ceil((next_frame - this->frame) * 10000.0 / this->frame_rate));
+}
+
 DeadAction::DeadAction(Unit *e, std::function<void()> on_complete)
 	:
 	UnitAction(e, graphic_type::dying),
+	frame{.0f},
 	end_frame{.0f},
 	on_complete_func{on_complete} {
 
@@ -318,8 +379,7 @@ DeadAction::DeadAction(Unit *e, std::function<void()> on_complete)
 
 void DeadAction::update(unsigned int time) {
 	if (this->entity->has_attribute(attr_type::hitpoints)) {
-		auto &h_attr = this->entity->get_attribute<attr_type::hitpoints>();
-		h_attr.current = 0;
+		this->entity->set_hitpoints(0);
 	}
 
 	// inc frame but do not pass the end frame
@@ -346,6 +406,20 @@ bool DeadAction::completed() const {
 	return this->frame > this->end_frame;
 }
 
+float DeadAction::current_frame() const {
+	return this->frame;
+}
+
+unsigned int DeadAction::sleep_time() const {
+	// remains with resources stay until they are gathered,
+	// which wakes them
+	if (this->frame >= this->end_frame &&
+	    this->entity->has_attribute(attr_type::resource)) {
+		return sleep_forever;
+	}
+	return 0;
+}
+
 FoundationAction::FoundationAction(Unit *e, bool add_destruction)
 	:
 	UnitAction(e, graphic_type::construct),
@@ -381,67 +455,60 @@ bool FoundationAction::completed() const {
 
 IdleAction::IdleAction(Unit *e)
 	:
-	UnitAction(e, graphic_type::standing) {
-	auto terrain = this->entity->location->get_terrain();
-	auto current_tile = this->entity->location->pos.draw.to_tile3().to_tile();
-	this->search = std::make_shared<TerrainSearch>(terrain, current_tile, 5.0f);
+	UnitAction(e, graphic_type::standing),
+	search_wait{0} {
 
 	// currently allow attack and heal automatically
-	this->auto_abilities = UnitAbility::set_from_list({ability_type::attack, ability_type::heal});
+	this->auto_abilities = auto_task_abilities();
 }
 
-void IdleAction::update(unsigned int time) {
-
-	// auto task searching
-	if (this->entity->location &&
-	    this->entity->has_attribute(attr_type::owner) &&
-	    this->entity->has_attribute(attr_type::attack) &&
-	    this->entity->get_attribute<attr_type::attack>().stance != attack_stance::do_nothing) {
-
-		// restart search from new tile when moved
-		auto terrain = this->entity->location->get_terrain();
-		auto current_tile = this->entity->location->pos.draw.to_tile3().to_tile();
-		if (!(current_tile == this->search->start_tile())) {
-			this->search = std::make_shared<TerrainSearch>(terrain, current_tile, 5.0f);
-		}
+bool IdleAction::auto_search() const {
+	return seeks_targets(this->entity);
+}
 
-		// search one tile per update
-		// next tile will always be valid
-		coord::tile tile = this->search->next_tile();
-		auto tile_data = terrain->get_data(tile);
-		auto &player = this->entity->get_attribute<attr_type::owner>().player;
+void IdleAction::update(unsigned int time) {
 
-		// find and actions which can be invoked
-		for (auto object_location : tile_data->obj) {
-			Command to_object(player, &object_location->unit);
+	// auto task searching, spread over the ticks by the container
+	if (this->auto_search()) {
+		this->search_wait -= std::min(time, this->search_wait);
 
-			// only allow abilities in the set of auto ability types
-			to_object.set_ability_set(auto_abilities);
-			if (this->entity->queue_cmd(to_object)) {
-				break;
-			}
+		TargetAcquisition &acquisition = this->entity->get_container()->get_acquisition();
+		if (this->search_wait == 0 && !acquisition.is_pending(*this->entity)) {
+			acquisition.request(*this->entity, idle_search_radius, nullptr,
+			                    this->auto_abilities, this, false);
+			this->search_wait = idle_search_interval;
 		}
 	}
 
 	// unit carrying ressources take the carrying sprite when idle
-	// we're not updating frames because the carying sprite is walking
+	// we're not animating because the carying sprite is walking
 	if (entity->has_attribute(attr_type::gatherer)) {
 		auto gatherer_attrib = entity->get_attribute<attr_type::gatherer>();
 		if (gatherer_attrib.amount > 0) {
 			this->graphic = graphic_type::carrying;
+			this->animate(0);
 		} else {
 			this->graphic = graphic_type::standing;
-			this->frame += time * this->frame_rate / 20.0f;
+			this->animate(this->frame_rate / 20.0f);
 		}
 	}
 	else {
-		// inc frame
-		this->frame += time * this->frame_rate / 20.0f;
+		this->animate(this->frame_rate / 20.0f);
 	}
 }
 
 void IdleAction::on_completion() {}
 
+unsigned int IdleAction::sleep_time() const {
+	// the animation continues while the unit sleeps,
+	// units looking for targets wake for their next search,
+	// or earlier by the command for a target found
+	if (this->auto_search()) {
+		return std::max(this->search_wait, 1u);
+	}
+	return sleep_forever;
+}
+
 bool IdleAction::completed() const {
 	if (this->entity->has_attribute(attr_type::hitpoints)) {
 		auto &hp = this->entity->get_attribute<attr_type::hitpoints>();
@@ -454,14 +521,18 @@ bool IdleAction::completed() const {
 	return false;
 }
 
-MoveAction::MoveAction(Unit *e, coord::phys3 tar, bool repath)
+MoveAction::MoveAction(Unit *e, coord::phys3 tar, bool repath, bool group_move)
 	:
 	UnitAction{e, graphic_type::walking},
 	unit_target{},
 	target(tar),
 	radius{path::path_grid_size},
 	allow_repath{repath},
-	end_action{false} {
+	end_action{false},
+	use_flow_field{group_move},
+	blocked_updates{0},
+	step_planned{false},
+	planned_reached{0} {
 	this->initialise();
 }
 
@@ -472,10 +543,32 @@ MoveAction::MoveAction(Unit *e, UnitReference tar, coord::phys_t within_range)
 	target(tar.get()->location->pos.draw),
 	radius{within_range},
 	allow_repath{false},
-	end_action{false} {
+	end_action{false},
+	use_flow_field{false},
+	blocked_updates{0},
+	step_planned{false},
+	planned_reached{0} {
 	this->initialise();
 }
 
+std::atomic<size_t> MoveAction::blocked_count{0};
+std::atomic<size_t> MoveAction::avoided_count{0};
+std::atomic<size_t> MoveAction::waited_count{0};
+std::atomic<size_t> MoveAction::repair_count{0};
+std::atomic<size_t> MoveAction::failed_repair_count{0};
+std::atomic<size_t> MoveAction::repath_count{0};
+
+MoveAction::stats MoveAction::get_stats() {
+	return stats{
+		blocked_count.load(std::memory_order_relaxed),
+		avoided_count.load(std::memory_order_relaxed),
+		waited_count.load(std::memory_order_relaxed),
+		repair_count.load(std::memory_order_relaxed),
+		failed_repair_count.load(std::memory_order_relaxed),
+		repath_count.load(std::memory_order_relaxed)
+	};
+}
+
 void MoveAction::initialise() {
 	// switch workers to the carrying graphic
 	if (this->entity->has_attribute(attr_type::gatherer)) {
@@ -497,6 +590,31 @@ void MoveAction::initialise() {
 
 MoveAction::~MoveAction() {}
 
+void MoveAction::plan(unsigned int time) {
+	this->step_planned = false;
+
+	// these may search a new path in the update first
+	if (this->unit_target.is_valid() || this->pending_path.is_valid()) {
+		return;
+	}
+
+	const std::vector<path::Node> *waypoints = &this->path.waypoints;
+	if (this->flow_field) {
+		if (!this->flow_field_waypoints(this->planned_waypoints)) {
+			return;
+		}
+		waypoints = &this->planned_waypoints;
+	}
+	else if (this->path.waypoints.empty()) {
+		return;
+	}
+
+	this->planned_position = this->entity->location->pos.draw;
+	this->planned_direction = this->entity->get_attribute<attr_type::direction>().unit_dir;
+	this->planned_reached = this->step(time, *waypoints, this->planned_position, this->planned_direction);
+	this->step_planned = true;
+}
+
 void MoveAction::update(unsigned int time) {
 	if (this->unit_target.is_valid()) {
 		// a unit is targeted, which may move
@@ -517,11 +635,35 @@ void MoveAction::update(unsigned int time) {
 		coord::phys_t tdy = target_pos.se - this->target.se;
 		coord::phys_t udx = unit_pos.ne - this->target.ne;
 		coord::phys_t udy = unit_pos.se - this->target.se;
-		if (this->path.waypoints.empty() || std::hypot(tdx, tdy) > std::hypot(udx, udy)) {
+		if (this->path.waypoints.empty() || coord::length_squared(tdx, tdy) > coord::length_squared(udx, udy)) {
 			this->target = target_pos;
 			this->set_path();
 		}
 	}
+	else if (this->path.waypoints.empty() && this->path.partial &&
+	         !this->pending_path.is_valid()) {
+		// continue a long distance path which was planned partially
+		this->set_path();
+	}
+
+	// wait in the current state until the path search is done
+	if (this->pending_path.is_valid()) {
+		if (!this->pending_path.is_ready()) {
+			return;
+		}
+		this->path = this->pending_path.get();
+		this->pending_path = path::PathHandle{};
+	}
+
+	// units of large groups look up their direction
+	if (this->flow_field) {
+		if (this->step_planned) {
+			this->path = path::Path{this->planned_waypoints};
+		}
+		else {
+			this->follow_flow_field();
+		}
+	}
 
 	// path not found
 	if (this->path.waypoints.empty()) {
@@ -532,59 +674,76 @@ void MoveAction::update(unsigned int time) {
 		return;
 	}
 
-	// find distance to move in this update
-	auto &sp_attr = this->entity->get_attribute<attr_type::speed>();
-	coord::phys_t distance_to_move = sp_attr.unit_speed * time;
-
 	// current position and direction
-	coord::phys3 new_position = this->entity->location->pos.draw;
 	auto &d_attr = this->entity->get_attribute<attr_type::direction>();
-	coord::phys3_delta new_direction = d_attr.unit_dir;
-
-	while (distance_to_move > 0) {
-		if (this->path.waypoints.empty()) {
-			break;
-		}
+	coord::phys3 new_position;
+	coord::phys3_delta new_direction;
+	size_t reached;
 
-		// find a point to move directly towards
-		coord::phys3 waypoint = this->next_waypoint();
-		coord::phys3_delta move_dir = waypoint - new_position;
-
-		// normalise dir
-		coord::phys_t distance_to_waypoint = (coord::phys_t) std::hypot(move_dir.ne, move_dir.se);
-
-		if (distance_to_waypoint <= distance_to_move) {
-			distance_to_move -= distance_to_waypoint;
-
-			// change entity position and direction
-			new_position = waypoint;
-			new_direction = move_dir;
-
-			// remove the waypoint
-			this->path.waypoints.pop_back();
-		}
-		else {
-			// distance_to_waypoint is larger so need to divide
-			move_dir = (move_dir * distance_to_move) / distance_to_waypoint;
-
-			// change entity position and direction
-			new_position += move_dir;
-			new_direction = move_dir;
-			break;
-		}
+	if (this->step_planned) {
+		new_position = this->planned_position;
+		new_direction = this->planned_direction;
+		reached = this->planned_reached;
+		this->step_planned = false;
+	}
+	else {
+		new_position = this->entity->location->pos.draw;
+		new_direction = d_attr.unit_dir;
+		reached = this->step(time, this->path.waypoints, new_position, new_direction);
 	}
 
 	// check move collisions
 	bool move_completed = this->entity->location->move(new_position);
 	if (move_completed) {
+		// remove the reached waypoints
+		this->path.waypoints.erase(std::end(this->path.waypoints) - reached,
+		                           std::end(this->path.waypoints));
+
 		d_attr.unit_dir = new_direction;
 		this->set_distance();
+		this->blocked_updates = 0;
 	}
 	else {
+		blocked_count.fetch_add(1, std::memory_order_relaxed);
+
 		// cases for modifying path when blocked
 		if (this->allow_repath) {
-			this->entity->log(MSG(dbg) << "Path blocked -- finding new path");
-			this->set_path();
+			TerrainObject &location = *this->entity->location;
+			auto terrain = location.get_terrain();
+			const TerrainObject *blocker = nullptr;
+			if (terrain) {
+				blocker = location.find_intersecting(*terrain, new_position);
+			}
+
+			// other moving units usually clear the way soon,
+			// so the unit steps around them or waits a few updates
+			bool moving_blocker = blocker and not blocker->is_static_obstacle();
+			if (moving_blocker and this->blocked_updates < max_blocked_updates) {
+				this->blocked_updates += 1;
+
+				if (this->avoid(new_position, *blocker)) {
+					avoided_count.fetch_add(1, std::memory_order_relaxed);
+					this->set_distance();
+				}
+				else {
+					waited_count.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			else if (not this->flow_field and this->repair_path()) {
+				this->entity->log(MSG(dbg) << "Path blocked -- found detour");
+				this->blocked_updates = 0;
+				this->set_distance();
+			}
+			else {
+				this->entity->log(MSG(dbg) << "Path blocked -- finding new path");
+				repath_count.fetch_add(1, std::memory_order_relaxed);
+				this->blocked_updates = 0;
+
+				// the flow field ignores other units, so search a way around them
+				this->use_flow_field = false;
+				this->flow_field = nullptr;
+				this->set_path();
+			}
 		}
 		else {
 			this->entity->log(MSG(dbg) << "Path blocked -- drop action");
@@ -592,8 +751,7 @@ void MoveAction::update(unsigned int time) {
 		}
 	}
 
-	// inc frame
-	this->frame += time * this->frame_rate / 5.0f;
+	this->animate(this->frame_rate / 5.0f);
 }
 
 void MoveAction::on_completion() {}
@@ -603,7 +761,10 @@ bool MoveAction::completed() const {
 	// no more waypoints to a static location
 	if (this->end_action ||
 	    (!this->unit_target.is_valid() &&
-	    this->path.waypoints.empty())) {
+	    this->path.waypoints.empty() &&
+	    !this->path.partial &&
+	    !this->pending_path.is_valid() &&
+	    !this->flow_field)) {
 		return true;
 	}
 
@@ -615,6 +776,35 @@ bool MoveAction::completed() const {
 }
 
 
+bool MoveAction::repair_path() {
+	std::vector<path::Node> &waypoints = this->path.waypoints;
+	if (waypoints.empty()) {
+		return false;
+	}
+	repair_count.fetch_add(1, std::memory_order_relaxed);
+
+	// the waypoints are stored nearest last
+	size_t skip = std::min(repair_waypoints, waypoints.size() - 1);
+	size_t rejoin = waypoints.size() - 1 - skip;
+
+	path::Path detour = path::detour(this->entity->location->pos.draw,
+	                                 waypoints[rejoin].position,
+	                                 this->entity->location->passable,
+	                                 repair_margin);
+	if (detour.waypoints.empty()) {
+		failed_repair_count.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// the detour ends next to the rejoined waypoint,
+	// which is kept instead of the detour's last one
+	waypoints.erase(std::begin(waypoints) + rejoin + 1, std::end(waypoints));
+	waypoints.insert(std::end(waypoints),
+	                 std::begin(detour.waypoints) + 1, std::end(detour.waypoints));
+	return true;
+}
+
+
 coord::phys3 MoveAction::next_waypoint() const {
 	if (this->path.waypoints.size() > 0) {
 		return this->path.waypoints.back().position;
@@ -626,13 +816,170 @@ coord::phys3 MoveAction::next_waypoint() const {
 
 void MoveAction::set_path() {
 	if (this->unit_target.is_valid()) {
-		this->path = path::to_object(this->entity->location.get(), this->unit_target.get()->location.get(), this->radius);
+		// units going back and forth between the same objects,
+		// like gathering villagers, reuse their paths
+		auto terrain = this->entity->location->get_terrain();
+		this->path = terrain->get_path_cache().to_object(this->entity->unit_type,
+		                                                  this->entity->location.get(),
+		                                                  this->unit_target.get()->location.get(),
+		                                                  this->radius);
 	}
 	else {
 		coord::phys3 start = this->entity->location->pos.draw;
 		coord::phys3 end = this->target;
-		this->path = path::to_point(start, end, this->entity->location->passable);
+		auto terrain = this->entity->location->get_terrain();
+		path::PathService *service = terrain->get_path_service();
+
+		if (this->use_flow_field) {
+			this->flow_field = terrain->get_flow_fields().get(this->entity->unit_type,
+			                                                   end.to_tile3().to_tile(),
+			                                                   this->entity->location->passable);
+
+			coord::tile_delta dir;
+			coord::tile tile = start.to_tile3().to_tile();
+			if (tile == this->flow_field->get_goal() ||
+			    this->flow_field->direction(tile, dir)) {
+				this->path = path::Path{};
+				return;
+			}
+
+			// the goal can't be reached from here with the field
+			this->use_flow_field = false;
+			this->flow_field = nullptr;
+		}
+
+		if (service) {
+			// search in the background, units of the same type
+			// ordered to the same point share the search
+			this->pending_path = service->request(this->entity->unit_type, start, end,
+			                                      this->entity->location->passable,
+			                                      this->entity->location->passability_layer);
+			this->path = path::Path{};
+		}
+		else {
+			this->path = terrain->get_path_cache().to_point(this->entity->unit_type, start, end,
+			                                                 this->entity->location->passable,
+			                                                 this->entity->location->passability_layer);
+		}
+	}
+}
+
+void MoveAction::follow_flow_field() {
+	std::vector<path::Node> waypoints;
+	if (!this->flow_field_waypoints(waypoints)) {
+		// the unit left the field, search a path on its own
+		this->use_flow_field = false;
+		this->flow_field = nullptr;
+		this->set_path();
+		return;
+	}
+
+	this->path = path::Path{waypoints};
+}
+
+bool MoveAction::flow_field_waypoints(std::vector<path::Node> &waypoints) const {
+	coord::tile tile = this->entity->location->pos.draw.to_tile3().to_tile();
+
+	// waypoints for the next tiles, the nearest last
+	waypoints.clear();
+	for (int i = 0; i < path::flow_field_lookahead; i++) {
+		if (tile == this->flow_field->get_goal()) {
+			waypoints.emplace_back(this->target, nullptr);
+			break;
+		}
+
+		coord::tile_delta dir;
+		if (!this->flow_field->direction(tile, dir)) {
+			break;
+		}
+		tile += dir;
+		waypoints.emplace_back(tile.to_tile3().to_phys3(), nullptr);
+	}
+
+	std::reverse(std::begin(waypoints), std::end(waypoints));
+	return !waypoints.empty();
+}
+
+size_t MoveAction::step(unsigned int time,
+                        const std::vector<path::Node> &waypoints,
+                        coord::phys3 &position,
+                        coord::phys3_delta &direction) const {
+
+	// find distance to move in this update
+	auto &sp_attr = this->entity->get_attribute<attr_type::speed>();
+	coord::phys_t distance_to_move = sp_attr.unit_speed * time;
+
+	size_t reached = 0;
+	while (distance_to_move > 0 && reached < waypoints.size()) {
+
+		// find a point to move directly towards,
+		// the waypoints are stored in reverse order
+		coord::phys3 waypoint = waypoints[waypoints.size() - 1 - reached].position;
+		coord::phys3_delta move_dir = waypoint - position;
+
+		// normalise dir
+		coord::phys_t distance_to_waypoint = coord::length(move_dir.ne, move_dir.se);
+
+		if (distance_to_waypoint <= distance_to_move) {
+			distance_to_move -= distance_to_waypoint;
+
+			// change entity position and direction
+			position = waypoint;
+			direction = move_dir;
+			reached += 1;
+		}
+		else {
+			// distance_to_waypoint is larger so need to divide
+			move_dir = (move_dir * distance_to_move) / distance_to_waypoint;
+
+			// change entity position and direction
+			position += move_dir;
+			direction = move_dir;
+			break;
+		}
 	}
+	return reached;
+}
+
+bool MoveAction::avoid(const coord::phys3 &blocked_position, const TerrainObject &blocker) {
+	TerrainObject &location = *this->entity->location;
+	coord::phys3 position = location.pos.draw;
+	coord::phys3_delta dir = blocked_position - position;
+	dir.up = 0;
+	if (dir.ne == 0 and dir.se == 0) {
+		return false;
+	}
+
+	// turn to the side facing away from the blocker first
+	coord::phys3_delta to_blocker = blocker.pos.draw - position;
+	coord::phys_t side = dir.ne * to_blocker.se - dir.se * to_blocker.ne;
+	coord::phys_t away = side > 0 ? -1 : 1;
+
+	// integer rotations, so all players step the same way
+	constexpr coord::phys_t cos45 = 46341; // 2^16 / sqrt(2)
+	auto turn_45 = [&dir](coord::phys_t sign) {
+		return coord::phys3_delta{
+			(dir.ne - sign * dir.se) * cos45 / coord::settings::phys_t_scaling_factor,
+			(dir.se + sign * dir.ne) * cos45 / coord::settings::phys_t_scaling_factor,
+			0
+		};
+	};
+	auto turn_90 = [&dir](coord::phys_t sign) {
+		return coord::phys3_delta{-sign * dir.se, sign * dir.ne, 0};
+	};
+
+	coord::phys3_delta steps[] = {
+		turn_45(away), turn_90(away), turn_45(-away), turn_90(-away)
+	};
+
+	for (auto &step : steps) {
+		coord::phys3 candidate = position + step;
+		if (location.move(candidate)) {
+			this->entity->get_attribute<attr_type::direction>().unit_dir = step;
+			return true;
+		}
+	}
+	return false;
 }
 
 void MoveAction::set_distance() {
@@ -643,7 +990,7 @@ void MoveAction::set_distance() {
 	}
 	else {
 		coord::phys3_delta move_dir = this->target - this->entity->location->pos.draw;
-		this->distance_to_target = static_cast<coord::phys_t>(std::hypot(move_dir.ne, move_dir.se));
+		this->distance_to_target = coord::length(move_dir.ne, move_dir.se);
 	}
 }
 
@@ -674,32 +1021,30 @@ UngarrisonAction::UngarrisonAction(Unit *e, const coord::phys3 &pos)
 void UngarrisonAction::update(unsigned int) {
 	auto &garrison_attr = this->entity->get_attribute<attr_type::garrison>();
 
-	// try unload all objects currently garrisoned
-	auto position_it = std::remove_if(
-		std::begin(garrison_attr.content),
-		std::end(garrison_attr.content),
-		[this](UnitReference &u) {
-			if (u.is_valid()) {
-
-				// ptr to unit being ungarrisoned
-				Unit *unit_ptr = u.get();
-
-				// make sure it was placed outside
-				if (unit_ptr->unit_type->place_beside(unit_ptr, this->entity->location.get())) {
-
-					// task unit to move to position
-					auto &player = this->entity->get_attribute<attr_type::owner>().player;
-					Command cmd(player, this->position);
-					cmd.set_ability(ability_type::move);
-					unit_ptr->queue_cmd(cmd);
-					return true;
-				}
-			}
-			return false;
-		});
+	// try unload all objects currently garrisoned,
+	// the tiles around the building are searched once for all of them
+	std::vector<Unit *> units;
+	units.reserve(garrison_attr.content.size());
+	for (UnitReference &u : garrison_attr.content) {
+		units.push_back(u.is_valid() ? u.get() : nullptr);
+	}
+	std::vector<TerrainObject *> placed = UnitType::place_beside(units, this->entity->location.get());
 
-	// remove elements which were ungarrisoned
-	garrison_attr.content.erase(position_it, std::end(garrison_attr.content));
+	// keep the units which could not be placed outside
+	std::vector<UnitReference> remaining;
+	auto &player = this->entity->get_attribute<attr_type::owner>().player;
+	for (size_t i = 0; i < units.size(); i++) {
+		if (placed[i] == nullptr) {
+			remaining.push_back(garrison_attr.content[i]);
+			continue;
+		}
+
+		// task unit to move to position
+		Command cmd(player, this->position);
+		cmd.set_ability(ability_type::move);
+		units[i]->queue_cmd(cmd);
+	}
+	garrison_attr.content = std::move(remaining);
 
 	// completed when no units are remaining
 	this->complete = garrison_attr.content.empty();
@@ -746,6 +1091,16 @@ void TrainAction::update(unsigned int time) {
 
 void TrainAction::on_completion() {}
 
+unsigned int TrainAction::sleep_time() const {
+	// placing the unit is tried in each update
+	if (this->train_percent > 1.0f) {
+		return 0;
+	}
+
+	// until the training is past complete
+	return static_cast<unsigned int>((1.0f - this->train_percent) / 0.001f) + 1;
+}
+
 BuildAction::BuildAction(Unit *e, UnitReference foundation)
 	:
 	TargetAction{e, graphic_type::work, foundation},
@@ -793,14 +1148,17 @@ void BuildAction::update_in_range(unsigned int time, Unit *target_unit) {
 		if (this->complete >= 1.0f) {
 			this->complete = build.completed = 1.0f;
 			target_location->place(build.completion_state);
+
+			if (target_unit->has_attribute(attr_type::owner)) {
+				target_unit->get_attribute<attr_type::owner>().player.dropsites.add(*target_unit);
+			}
 		}
 	}
 	else {
 		this->complete = 1.0f;
 	}
 
-	// inc frame
-	this->frame += time * this->frame_rate / 2.5f;
+	this->animate(this->frame_rate / 2.5f);
 }
 
 void BuildAction::on_completion() {
@@ -890,7 +1248,7 @@ void RepairAction::update_in_range(unsigned int time, Unit *target_unit) {
 		this->time_left -= time;
 
 		if (this->time_left <= 0) {
-			hp.current += 1;
+			target_unit->set_hitpoints(hp.current + 1);
 
 			if (hp.current >= hp.max) {
 				this->complete = true;
@@ -908,8 +1266,7 @@ void RepairAction::update_in_range(unsigned int time, Unit *target_unit) {
 		}
 	}
 
-	// inc frame
-	this->frame += time * this->frame_rate / 2.5f;
+	this->animate(this->frame_rate / 2.5f);
 }
 
 GatherAction::GatherAction(Unit *e, UnitReference tar)
@@ -1022,34 +1379,19 @@ void GatherAction::update_in_range(unsigned int time, Unit *targeted_resource) {
 		}
 	}
 
-	// inc frame
-	this->frame += time * this->frame_rate / 3.0f;
+	this->animate(this->frame_rate / 3.0f);
 }
 
 UnitReference GatherAction::nearest_dropsite(game_resource res_type) {
 
 	// find nearest dropsite from the targeted resource
-	auto ds = find_near(*this->target.get()->location,
-		[=](const TerrainObject &obj) {
-
-			if (not obj.unit.has_attribute(attr_type::building) or &obj.unit == this->entity or &obj.unit == this->target.get()) {
-				return false;
-			}
-
-			return obj.unit.get_attribute<attr_type::building>().completed >= 1.0f &&
-			       obj.unit.has_attribute(attr_type::owner) &&
-			       obj.unit.get_attribute<attr_type::owner>().player.owns(*this->entity) &&
-			       obj.unit.has_attribute(attr_type::dropsite) &&
-			       obj.unit.get_attribute<attr_type::dropsite>().accepting_resource(res_type);
-	});
+	auto &player = this->entity->get_attribute<attr_type::owner>().player;
+	UnitReference ds = player.dropsites.nearest(res_type, this->target.get()->location->pos.draw);
 
-	if (ds) {
-		return ds->unit.get_ref();
-	}
-	else {
+	if (not ds.is_valid()) {
 		this->entity->log(MSG(dbg) << "no dropsite found");
-		return UnitReference();
 	}
+	return ds;
 }
 
 const graphic_set &GatherAction::current_graphics() const {
@@ -1082,8 +1424,7 @@ void AttackAction::update_in_range(unsigned int time, Unit *target_ptr) {
 		this->attack(*target_ptr);
 	}
 
-	// inc frame
-	this->frame += time * this->current_graphics().at(graphic)->frame_count * this->rate_of_fire;
+	this->animate(this->current_graphics().at(graphic)->frame_count * this->rate_of_fire);
 }
 
 bool AttackAction::completed_in_range(Unit *target_ptr) const {
@@ -1148,8 +1489,7 @@ void HealAction::update_in_range(unsigned int time, Unit *target_ptr) {
 		this->heal(*target_ptr);
 	}
 
-	// inc frame
-	this->frame += time * this->current_graphics().at(graphic)->frame_count * heal.rate;
+	this->animate(this->current_graphics().at(graphic)->frame_count * heal.rate);
 }
 
 bool HealAction::completed_in_range(Unit *target_ptr) const {
@@ -1164,12 +1504,7 @@ void HealAction::heal(Unit &target) {
 	// heal object
 	if (target.has_attribute(attr_type::hitpoints)) {
 		auto &hp = target.get_attribute<attr_type::hitpoints>();
-		if ((hp.current + heal.life) < hp.max) {
-			hp.current += heal.life;
-		}
-		else {
-			hp.current = hp.max;
-		}
+		target.set_hitpoints(std::min(hp.current + heal.life, hp.max));
 	}
 
 }
@@ -1186,70 +1521,30 @@ void ConvertAction::update_in_range(unsigned int, Unit *) {}
 ProjectileAction::ProjectileAction(Unit *e, coord::phys3 target)
 	:
 	UnitAction{e, graphic_type::standing},
-	has_hit{false} {
-
-	// find speed to move
-	auto &sp_attr = this->entity->get_attribute<attr_type::speed>();
-	coord::phys_t projectile_speed = sp_attr.unit_speed;
-
-	// arc of projectile
-	auto &pr_attr = this->entity->get_attribute<attr_type::projectile>();
-	float projectile_arc = pr_attr.projectile_arc;
-
-	// distance and time to target
-	coord::phys3_delta d = target - this->entity->location->pos.draw;
-	coord::phys_t distance_to_target = (coord::phys_t) std::hypot(d.ne, d.se);
-	int flight_time = distance_to_target / projectile_speed;
+	has_hit{false},
+	flying{false},
+	index{0} {
 
+	// the flight is simulated with all other projectiles
+	this->entity->get_container()->get_projectiles().launch(this, target);
+}
 
-	if (projectile_arc < 0) {
-		// TODO negative values probably indicate something
-		projectile_arc += 0.2;
+ProjectileAction::~ProjectileAction() {
+	if (this->flying) {
+		this->entity->get_container()->get_projectiles().remove(this->index);
 	}
-
-	// now figure gravity from arc parameter
-	// TODO projectile arc is the ratio between horizontal and
-	// vertical components of the initial direction
-	this->grav = 0.01f * (exp(pow(projectile_arc, 0.5f)) - 1) * projectile_speed;
-
-	// inital launch direction
-	auto &d_attr = this->entity->get_attribute<attr_type::direction>();
-	d_attr.unit_dir = (projectile_speed * d) / distance_to_target;
-
-	// account for initial height
-	coord::phys_t initial_height = this->entity->location->pos.draw.up;
-	d_attr.unit_dir.up = (grav * flight_time) / 2 - (initial_height / flight_time);
 }
 
-ProjectileAction::~ProjectileAction() {}
-
-void ProjectileAction::update(unsigned int time) {
-	auto &d_attr = this->entity->get_attribute<attr_type::direction>();
-
-	// apply gravity
-	d_attr.unit_dir.up -= this->grav * time;
-
-	coord::phys3 new_position = this->entity->location->pos.draw + d_attr.unit_dir * time;
-	if (!this->entity->location->move(new_position)) {
-
-		// find object which was hit
-		auto terrain = this->entity->location->get_terrain();
-		TileContent *tc = terrain->get_data(new_position.to_tile3().to_tile());
-		if (tc && !tc->obj.empty()) {
-			for (auto obj_location : tc->obj) {
-				if (this->entity->location.get() != obj_location &&
-				    obj_location->check_collisions()) {
-					this->damage_object(obj_location->unit, 1);
-					break;
-				}
-			}
-		}
+void ProjectileAction::update(unsigned int) {
+	// the projectile system moved the projectile already
+	this->animate(this->frame_rate);
+}
 
-		has_hit = true;
+void ProjectileAction::hit(Unit *target) {
+	if (target) {
+		this->damage_object(*target, 1);
 	}
-
-	// inc frame
-	this->frame += time * this->frame_rate;
+	this->has_hit = true;
 }
 
 void ProjectileAction::on_completion() {}
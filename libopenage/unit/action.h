@@ -1,19 +1,26 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <vector>
 
 #include "../pathfinding/path.h"
+#include "../pathfinding/path_service.h"
 #include "../gamestate/resource.h"
+#include "action_pool.h"
 #include "attribute.h"
 #include "unit.h"
 #include "unit_container.h"
 
 namespace openage {
 
-class TerrainSearch;
+namespace path {
+class FlowField;
+} // namespace path
+
 
 /**
  * Actions can be pushed onto any units action stack
@@ -29,7 +36,19 @@ public:
 	 */
 	UnitAction(Unit *u, graphic_type initial_gt);
 
-	virtual ~UnitAction() {}
+	virtual ~UnitAction();
+
+	/**
+	 * actions are allocated from the action pool,
+	 * the sized delete gets the size of the destroyed action.
+	 */
+	static void *operator new(size_t size) {
+		return ActionPool::allocate(size);
+	}
+
+	static void operator delete(void *ptr, size_t size) {
+		ActionPool::deallocate(ptr, size);
+	}
 
 	/**
 	 * type of graphic this action should use
@@ -39,7 +58,17 @@ public:
 	/**
 	 * frame number to use on the current graphic
 	 */
-	float current_frame() const;
+	virtual float current_frame() const;
+
+	/**
+	 * prepares the next update of the active action, called for
+	 * all units before any of them is updated.
+	 *
+	 * runs in parallel with the planning of other units, so it may
+	 * only read the game state and modify this action itself.
+	 * the update has to produce the same result without a plan.
+	 */
+	virtual void plan(unsigned int) {}
 
 	/**
 	 * each action has its own update functionality which gets called when this
@@ -80,6 +109,21 @@ public:
 	 */
 	virtual std::string name() const = 0;
 
+	/**
+	 * the game time in milliseconds the unit may skip after this update,
+	 * when updating it would change nothing until then, e.g. the time
+	 * until the action completes. the container wakes the unit with a timer
+	 * when the time is over, or earlier when an event like damage or a new
+	 * command wakes it, see Unit::wake. the next update gets all the time
+	 * that passed while sleeping.
+	 */
+	virtual unsigned int sleep_time() const { return 0; }
+
+	/**
+	 * sleep until woken
+	 */
+	static constexpr unsigned int sleep_forever = std::numeric_limits<unsigned int>::max();
+
 	/**
 	 * determines which graphic should be used for drawing this unit
 	 * finds the defualt graphic using the units type, used by most actions
@@ -123,6 +167,12 @@ public:
 	static coord::phys_t get_heal_range(Unit *u);
 
 protected:
+	/**
+	 * plays the current graphic at the frames per millisecond,
+	 * the animation system of the container advances the frame.
+	 */
+	void animate(float rate);
+
 	/**
 	 * the entity being updated
 	 */
@@ -132,13 +182,20 @@ protected:
 	 * common graphic controls
 	 */
 	graphic_type graphic;
-	float frame;
 	float frame_rate;
 
+	/**
+	 * index of the animation of this action in the animation system
+	 */
+	size_t animation;
+
 	/**
 	 * additional drawing for debug purposes
 	 */
 	std::function<void(void)> debug_draw_action;
+
+private:
+	friend class AnimationSystem;
 };
 
 /**
@@ -209,8 +266,15 @@ public:
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return false; }
 	std::string name() const override { return "decay"; }
+	unsigned int sleep_time() const override;
+	float current_frame() const override;
 
 private:
+	/**
+	 * the decay completes with the animation, so the
+	 * action counts the frames itself
+	 */
+	float frame;
 	float end_frame;
 
 };
@@ -229,8 +293,15 @@ public:
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return false; }
 	std::string name() const override { return "dead"; }
+	unsigned int sleep_time() const override;
+	float current_frame() const override;
 
 private:
+	/**
+	 * the unit is removed after the animation, so the
+	 * action counts the frames itself
+	 */
+	float frame;
 	float end_frame;
 	std::function<void()> on_complete_func;
 
@@ -250,6 +321,7 @@ public:
 	bool allow_interupt() const override { return true; }
 	bool allow_control() const override { return false; }
 	std::string name() const override { return "foundation"; }
+	unsigned int sleep_time() const override { return sleep_forever; }
 
 private:
 	bool add_destruct_effect, cancel;
@@ -270,12 +342,23 @@ public:
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return true; }
 	std::string name() const override { return "idle"; }
+	unsigned int sleep_time() const override;
 
 private:
 	// look for auto task actions
-	std::shared_ptr<TerrainSearch> search;
 	ability_set auto_abilities;
 
+	/**
+	 * milliseconds until the next target search is requested,
+	 * the searches are done by the TargetAcquisition of the container.
+	 */
+	unsigned int search_wait;
+
+	/**
+	 * should the unit look for targets by itself
+	 */
+	bool auto_search() const;
+
 };
 
 /**
@@ -285,8 +368,11 @@ class MoveAction: public UnitAction {
 public:
 	/**
 	 * moves unit to a given fixed location
+	 *
+	 * units moving in a large group follow the shared flow field
+	 * of the target instead of searching their own path.
 	 */
-	MoveAction(Unit *e, coord::phys3 tar, bool repath=true);
+	MoveAction(Unit *e, coord::phys3 tar, bool repath=true, bool group_move=false);
 
 	/**
 	 * moves a unit to within a distance to another unit
@@ -294,6 +380,7 @@ public:
 	MoveAction(Unit *e, UnitReference tar, coord::phys_t within_range);
 	virtual ~MoveAction();
 
+	void plan(unsigned int) override;
 	void update(unsigned int) override;
 	void on_completion() override;
 	bool completed() const override;
@@ -303,6 +390,61 @@ public:
 
 	coord::phys3 next_waypoint() const;
 
+	/**
+	 * counters of all move actions, how often they were blocked
+	 * and how the blocking was resolved.
+	 */
+	struct stats {
+		/**
+		 * moves which were blocked
+		 */
+		size_t blocked;
+
+		/**
+		 * blocked moves which stepped around another unit
+		 */
+		size_t avoided;
+
+		/**
+		 * blocked moves which waited for another unit to pass
+		 */
+		size_t waited;
+
+		/**
+		 * blocked moves which searched a detour back to their path
+		 */
+		size_t repairs;
+
+		/**
+		 * of those, detours which were not found
+		 */
+		size_t failed_repairs;
+
+		/**
+		 * blocked moves which searched a new path
+		 */
+		size_t repaths;
+	};
+
+	static stats get_stats();
+
+	/**
+	 * updates a unit waits for a moving unit in its way
+	 * before it searches a path around it
+	 */
+	static constexpr unsigned int max_blocked_updates = 8;
+
+	/**
+	 * waypoints after the next one which a blocked unit skips
+	 * when it searches a detour back to its path
+	 */
+	static constexpr size_t repair_waypoints = 2;
+
+	/**
+	 * how far a detour may go beside the way it replaces
+	 */
+	static constexpr coord::phys_t repair_margin = 3 * coord::settings::phys_per_tile;
+
 private:
 	UnitReference unit_target;
 	coord::phys3 target;
@@ -312,9 +454,26 @@ private:
 
 	path::Path path;
 
+	// path which is still being searched, the unit waits for it
+	path::PathHandle pending_path;
+
 	// should a new path be found if unit gets blocked
 	bool allow_repath, end_action;
 
+	// directions to the target shared by a moving group
+	bool use_flow_field;
+	std::shared_ptr<const path::FlowField> flow_field;
+
+	// updates the unit was blocked by moving units in a row
+	unsigned int blocked_updates;
+
+	// movement of the next update, calculated in advance
+	bool step_planned;
+	std::vector<path::Node> planned_waypoints;
+	coord::phys3 planned_position;
+	coord::phys3_delta planned_direction;
+	size_t planned_reached;
+
 	void initialise();
 
 	/**
@@ -326,6 +485,54 @@ private:
 	 * updates the distance_to_target value
 	 */
 	void set_distance();
+
+	/**
+	 * set the next waypoints from the flow field
+	 */
+	void follow_flow_field();
+
+	/**
+	 * the waypoints for the next tiles on the flow field,
+	 * the nearest last. false if the unit is not on the field.
+	 */
+	bool flow_field_waypoints(std::vector<path::Node> &waypoints) const;
+
+	/**
+	 * the move to the blocked position collided with the blocker, which
+	 * moves as well. tries to step by the same distance in directions
+	 * turned away from the blocker.
+	 *
+	 * @return whether the unit was moved
+	 */
+	bool avoid(const coord::phys3 &blocked_position, const TerrainObject &blocker);
+
+	/**
+	 * replaces the next waypoints by a detour from the current
+	 * position to a later waypoint, searched only near the way
+	 * between them. cheaper than a new path when something
+	 * blocks the way.
+	 *
+	 * @return whether a detour was found
+	 */
+	bool repair_path();
+
+	/**
+	 * moves position and direction along the waypoints
+	 * as far as the unit gets in the given time.
+	 *
+	 * @return the number of waypoints which were reached
+	 */
+	size_t step(unsigned int time,
+	            const std::vector<path::Node> &waypoints,
+	            coord::phys3 &position,
+	            coord::phys3_delta &direction) const;
+
+	static std::atomic<size_t> blocked_count;
+	static std::atomic<size_t> avoided_count;
+	static std::atomic<size_t> waited_count;
+	static std::atomic<size_t> repair_count;
+	static std::atomic<size_t> failed_repair_count;
+	static std::atomic<size_t> repath_count;
 };
 
 /**
@@ -378,6 +585,7 @@ public:
 	bool allow_interupt() const override { return false; }
 	bool allow_control() const override { return true; }
 	std::string name() const override { return "train"; }
+	unsigned int sleep_time() const override;
 
 private:
 	UnitType *trained;
@@ -529,9 +737,23 @@ public:
 	bool allow_control() const override { return false; }
 	std::string name() const override { return "projectile"; }
 
+	/**
+	 * ends the flight, called by the projectile system when the projectile
+	 * hits the target object, or lands if target is nullptr.
+	 */
+	void hit(Unit *target);
+
 private:
-	coord::phys_t grav;
+	friend class ProjectileSystem;
+
 	bool has_hit;
+
+	/**
+	 * whether the projectile is moved by the projectile system,
+	 * at the index
+	 */
+	bool flying;
+	size_t index;
 };
 
 } // namespace openage
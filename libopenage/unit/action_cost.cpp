@@ -0,0 +1,151 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "action_cost.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+
+#include "../config.h"
+#include "../util/strings.h"
+
+namespace openage {
+
+
+std::atomic<bool> action_costs_active{false};
+
+
+namespace {
+
+struct cost_sum {
+	uint64_t calls = 0;
+	time_nsec_t duration = 0;
+};
+
+
+/**
+ * The costs measured by one thread.
+ * Written by the thread, read when the costs are summed up.
+ */
+struct thread_costs {
+	void add(const std::type_info &type, time_nsec_t duration) {
+		std::lock_guard<std::mutex> lock{this->mutex};
+		cost_sum &sum = this->costs[std::type_index{type}];
+		sum.calls += 1;
+		sum.duration += duration;
+	}
+
+	std::mutex mutex;
+	std::unordered_map<std::type_index, cost_sum> costs;
+};
+
+
+std::mutex threads_mutex;
+
+std::vector<std::shared_ptr<thread_costs>> &threads() {
+	static std::vector<std::shared_ptr<thread_costs>> value;
+	return value;
+}
+
+
+/**
+ * the table of the calling thread, or the one shared
+ * by all threads without thread-local storage.
+ */
+thread_costs *own_costs() {
+#if HAVE_THREAD_LOCAL_STORAGE
+	thread_local std::shared_ptr<thread_costs> own;
+#else
+	static std::shared_ptr<thread_costs> own;
+	std::lock_guard<std::mutex> lock{threads_mutex};
+#endif
+
+	if (unlikely(not own)) {
+		own = std::make_shared<thread_costs>();
+
+#if HAVE_THREAD_LOCAL_STORAGE
+		std::lock_guard<std::mutex> lock{threads_mutex};
+#endif
+		threads().push_back(own);
+	}
+
+	return own.get();
+}
+
+
+/**
+ * the class name of the type, e.g. MoveAction.
+ */
+std::string type_name(const std::type_index &type) {
+	std::string name = util::demangle(type.name());
+	size_t scope = name.rfind("::");
+	if (scope != std::string::npos) {
+		name.erase(0, scope + 2);
+	}
+	return name;
+}
+
+} // anonymous namespace
+
+
+void ActionCostScope::end() {
+	own_costs()->add(*this->type, timing::get_monotonic_time() - this->start);
+}
+
+
+void action_costs_start() {
+	{
+		std::lock_guard<std::mutex> lock{threads_mutex};
+		for (auto &thread : threads()) {
+			std::lock_guard<std::mutex> thread_lock{thread->mutex};
+			thread->costs.clear();
+		}
+	}
+	action_costs_active = true;
+}
+
+
+void action_costs_stop() {
+	action_costs_active = false;
+}
+
+
+std::vector<action_cost> action_costs() {
+	std::unordered_map<std::type_index, cost_sum> sums;
+	{
+		std::lock_guard<std::mutex> lock{threads_mutex};
+		for (auto &thread : threads()) {
+			std::lock_guard<std::mutex> thread_lock{thread->mutex};
+			for (auto &entry : thread->costs) {
+				cost_sum &sum = sums[entry.first];
+				sum.calls += entry.second.calls;
+				sum.duration += entry.second.duration;
+			}
+		}
+	}
+
+	std::vector<action_cost> result;
+	for (auto &entry : sums) {
+		result.push_back(action_cost{type_name(entry.first), entry.second.calls, entry.second.duration});
+	}
+
+	std::sort(result.begin(), result.end(), [](const action_cost &a, const action_cost &b) {
+		return a.duration > b.duration;
+	});
+	return result;
+}
+
+
+void write_action_costs(std::ostream &out) {
+	for (auto &cost : action_costs()) {
+		out << util::sformat("%-20s %10lu calls %10.3f ms %8.3f us/call",
+		                     cost.name.c_str(),
+		                     static_cast<unsigned long>(cost.calls),
+		                     cost.duration / 1e6,
+		                     cost.duration / 1e3 / cost.calls) << std::endl;
+	}
+}
+
+} // openage
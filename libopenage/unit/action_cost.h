@@ -0,0 +1,98 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "../util/compiler.h"
+#include "../util/timing.h"
+
+namespace openage {
+
+
+/**
+ * Whether the costs of the actions and abilities are measured,
+ * see action_costs_start().
+ */
+extern std::atomic<bool> action_costs_active;
+
+
+/**
+ * Adds the time from its construction to its destruction and one call
+ * to the cost of a type, e.g. typeid(*action) around action->update().
+ *
+ * Each thread sums up its own costs, so the scopes can be used in the
+ * parallel planning as well.
+ *
+ * Costs a relaxed atomic load while nothing is measured.
+ */
+class ActionCostScope {
+public:
+	explicit ActionCostScope(const std::type_info &type)
+		:
+		type{&type},
+		start{0} {
+
+		if (unlikely(action_costs_active.load(std::memory_order_relaxed))) {
+			this->start = timing::get_monotonic_time();
+		}
+	}
+
+	~ActionCostScope() {
+		if (unlikely(this->start != 0)) {
+			this->end();
+		}
+	}
+
+	ActionCostScope(const ActionCostScope &) = delete;
+	ActionCostScope &operator =(const ActionCostScope &) = delete;
+
+private:
+	void end();
+
+	const std::type_info *type;
+	time_nsec_t start;
+};
+
+
+/**
+ * The summed up cost of an action or ability type.
+ */
+struct action_cost {
+	/**
+	 * the class name, without the namespace
+	 */
+	std::string name;
+
+	uint64_t calls;
+	time_nsec_t duration;
+};
+
+
+/**
+ * Start measuring, drops the costs measured before.
+ */
+void action_costs_start();
+
+/**
+ * Stop measuring, the costs can still be read.
+ */
+void action_costs_stop();
+
+/**
+ * The costs of all threads, the most expensive type first.
+ */
+std::vector<action_cost> action_costs();
+
+/**
+ * Writes a line for each type: its calls, its time
+ * and the average time of a call.
+ */
+void write_action_costs(std::ostream &out);
+
+} // openage
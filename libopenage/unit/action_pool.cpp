@@ -0,0 +1,92 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "action_pool.h"
+
+#include <new>
+
+namespace openage {
+
+ActionPool::ActionPool()
+	:
+	counters{0, 0, 0, 0} {}
+
+
+ActionPool::~ActionPool() {}
+
+
+ActionPool &ActionPool::get() {
+	static ActionPool pool;
+	return pool;
+}
+
+
+void *ActionPool::allocate(size_t size) {
+	ActionPool &pool = ActionPool::get();
+	std::lock_guard<std::mutex> lock{pool.mutex};
+
+	pool.counters.allocations += 1;
+	pool.counters.live += 1;
+
+	if (size > max_size) {
+		pool.counters.heap_allocations += 1;
+		return ::operator new(size);
+	}
+
+	size_t size_class = (size + align - 1) / align - 1;
+	std::vector<void *> &free_list = pool.free_lists[size_class];
+
+	if (free_list.empty()) {
+		pool.grow(size_class);
+	}
+	else {
+		pool.counters.reused += 1;
+	}
+
+	void *ptr = free_list.back();
+	free_list.pop_back();
+	return ptr;
+}
+
+
+void ActionPool::deallocate(void *ptr, size_t size) {
+	if (ptr == nullptr) {
+		return;
+	}
+
+	ActionPool &pool = ActionPool::get();
+	std::lock_guard<std::mutex> lock{pool.mutex};
+
+	pool.counters.live -= 1;
+
+	if (size > max_size) {
+		::operator delete(ptr);
+		return;
+	}
+
+	size_t size_class = (size + align - 1) / align - 1;
+	pool.free_lists[size_class].push_back(ptr);
+}
+
+
+ActionPool::stats ActionPool::get_stats() {
+	ActionPool &pool = ActionPool::get();
+	std::lock_guard<std::mutex> lock{pool.mutex};
+	return pool.counters;
+}
+
+
+void ActionPool::grow(size_t size_class) {
+	size_t slot_size = (size_class + 1) * align;
+
+	// operator new[] of char returns memory aligned for any type
+	this->chunks.emplace_back(new char[slot_size * chunk_slots]);
+	this->counters.heap_allocations += 1;
+
+	char *chunk = this->chunks.back().get();
+	std::vector<void *> &free_list = this->free_lists[size_class];
+	for (size_t i = chunk_slots; i > 0; i--) {
+		free_list.push_back(chunk + (i - 1) * slot_size);
+	}
+}
+
+} // namespace openage
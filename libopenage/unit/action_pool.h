@@ -0,0 +1,90 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace openage {
+
+/**
+ * recycles the memory of unit actions.
+ *
+ * units push and drop actions on every retask, so the freed
+ * actions are kept in free lists, one per size class.
+ * the memory is taken from the heap in chunks of several actions.
+ *
+ * used by the allocation functions of UnitAction, so all actions
+ * created by std::make_unique go through it.
+ */
+class ActionPool {
+public:
+	/**
+	 * counters of the pool, to compare with the heap allocations.
+	 */
+	struct stats {
+		/**
+		 * number of actions allocated
+		 */
+		size_t allocations;
+
+		/**
+		 * allocations served from a free list
+		 */
+		size_t reused;
+
+		/**
+		 * requests to the heap, for chunks or oversized actions
+		 */
+		size_t heap_allocations;
+
+		/**
+		 * number of actions currently allocated
+		 */
+		size_t live;
+	};
+
+	static void *allocate(size_t size);
+	static void deallocate(void *ptr, size_t size);
+
+	static stats get_stats();
+
+private:
+	ActionPool();
+	~ActionPool();
+
+	static ActionPool &get();
+
+	/**
+	 * take memory for a new chunk of the size class
+	 * and put its slots into the free list.
+	 */
+	void grow(size_t size_class);
+
+	/**
+	 * granularity of the size classes.
+	 */
+	static constexpr size_t align = alignof(std::max_align_t);
+
+	/**
+	 * larger actions are allocated on the heap directly.
+	 */
+	static constexpr size_t max_size = 512;
+
+	static constexpr size_t chunk_slots = 64;
+
+	std::mutex mutex;
+
+	/**
+	 * free slots of each size class
+	 */
+	std::vector<void *> free_lists[max_size / align];
+
+	std::vector<std::unique_ptr<char[]>> chunks;
+
+	stats counters;
+};
+
+} // namespace openage
@@ -0,0 +1,57 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "animation_system.h"
+
+#include "action.h"
+
+
+namespace openage {
+
+AnimationSystem::AnimationSystem() {}
+
+
+void AnimationSystem::add(UnitAction *action, float frame) {
+	action->animation = this->actions.size();
+
+	this->actions.push_back(action);
+	this->frames.push_back(frame);
+	this->rates.push_back(0);
+}
+
+
+void AnimationSystem::remove(size_t index) {
+	size_t last = this->actions.size() - 1;
+
+	if (index != last) {
+		this->actions[index] = this->actions[last];
+		this->actions[index]->animation = index;
+
+		this->frames[index] = this->frames[last];
+		this->rates[index] = this->rates[last];
+	}
+
+	this->actions.pop_back();
+	this->frames.pop_back();
+	this->rates.pop_back();
+}
+
+
+size_t AnimationSystem::size() const {
+	return this->actions.size();
+}
+
+
+void AnimationSystem::update(time_nsec_t lastframe_duration) {
+	// milliseconds, like the unit actions
+	float time = lastframe_duration / 1e6;
+	size_t count = this->frames.size();
+
+	// a plain loop without branches, so it can be vectorized
+	float *frames = this->frames.data();
+	const float *rates = this->rates.data();
+	for (size_t i = 0; i < count; i++) {
+		frames[i] += rates[i] * time;
+	}
+}
+
+} // namespace openage
@@ -0,0 +1,81 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "../util/timing.h"
+
+namespace openage {
+
+class UnitAction;
+
+/**
+ * advances the animation frames of all unit actions of a unit
+ * container in one pass.
+ *
+ * the frame and the frame rate of each action are stored in one
+ * array each, so advancing all of them is a tight loop the compiler
+ * can vectorize. the actions only set the rate of the graphic they
+ * show, and read their frame when the unit is drawn. the unit
+ * textures wrap the frame, so all animations loop.
+ *
+ * animations also advance while their unit sleeps.
+ */
+class AnimationSystem {
+public:
+	AnimationSystem();
+
+	AnimationSystem(const AnimationSystem &) = delete;
+	AnimationSystem &operator =(const AnimationSystem &) = delete;
+
+	/**
+	 * adds a stopped animation for the action, starting at the frame.
+	 *
+	 * the action keeps the index of its animation, which is
+	 * updated when other animations are removed.
+	 */
+	void add(UnitAction *action, float frame);
+
+	/**
+	 * removes an animation. the last animation
+	 * takes the index of the removed one.
+	 */
+	void remove(size_t index);
+
+	/**
+	 * sets the frames per millisecond the animation advances,
+	 * 0 stops it at its current frame.
+	 */
+	void play(size_t index, float rate) {
+		this->rates[index] = rate;
+	}
+
+	/**
+	 * the current frame of an animation.
+	 */
+	float get_frame(size_t index) const {
+		return this->frames[index];
+	}
+
+	/**
+	 * the number of animations.
+	 */
+	size_t size() const;
+
+	/**
+	 * advances all animations by the duration of the last tick.
+	 */
+	void update(time_nsec_t lastframe_duration);
+
+private:
+	std::vector<UnitAction *> actions;
+
+	std::vector<float> frames;
+
+	// frames per millisecond
+	std::vector<float> rates;
+};
+
+} // namespace openage
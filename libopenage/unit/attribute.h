@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -7,6 +7,7 @@
 #include <algorithm>
 
 #include "../coord/tile.h"
+#include "../error/error.h"
 #include "../gamedata/unit.gen.h"
 #include "../terrain/terrain_object.h"
 #include "../gamestate/resource.h"
@@ -111,6 +112,16 @@ public:
 	 * shared attributes will return themselves
 	 */
 	virtual std::shared_ptr<AttributeContainer> copy() const = 0;
+
+	/**
+	 * sets this attribute to the values of other, which has the same type.
+	 * shared attributes are upgraded this way, as the units of a type
+	 * keep referencing them.
+	 */
+	virtual void assign(const AttributeContainer &) {
+		throw Error(MSG(err) << "attribute " << static_cast<int>(this->type)
+		            << " can't be changed in place");
+	}
 };
 
 using attr_map_t = std::map<attr_type, std::shared_ptr<AttributeContainer>>;
@@ -188,6 +199,10 @@ public:
 		return std::make_shared<Attribute<attr_type::armor>>(*this);
 	}
 
+	void assign(const AttributeContainer &other) override {
+		*this = static_cast<const Attribute<attr_type::armor> &>(other);
+	}
+
 	typeamount_map armor;
 };
 
@@ -249,6 +264,10 @@ public:
 		return std::make_shared<Attribute<attr_type::heal>>(*this);
 	}
 
+	void assign(const AttributeContainer &other) override {
+		*this = static_cast<const Attribute<attr_type::heal> &>(other);
+	}
+
 	coord::phys_t range;
 	coord::phys_t init_height; // TODO remove?
 	unsigned int life;
@@ -271,6 +290,10 @@ public:
 		return std::make_shared<Attribute<attr_type::speed>>(*this);
 	}
 
+	void assign(const AttributeContainer &other) override {
+		*this = static_cast<const Attribute<attr_type::speed> &>(other);
+	}
+
 	coord::phys_t unit_speed; // possibly use a pointer to account for tech upgrades
 };
 
@@ -362,6 +385,10 @@ public:
 		return std::make_shared<Attribute<attr_type::dropsite>>(*this);
 	}
 
+	void assign(const AttributeContainer &other) override {
+		*this = static_cast<const Attribute<attr_type::dropsite> &>(other);
+	}
+
 	bool accepting_resource(game_resource res) {
 		if (std::find(resource_types.begin(), resource_types.end(), res) != resource_types.end()) {
 			return true;
@@ -0,0 +1,123 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "attribute_storage.h"
+
+#include "../error/error.h"
+#include "../gamestate/state_hash.h"
+#include "unit.h"
+
+namespace openage {
+
+AttributeStorage::AttributeStorage(StateHash *state_hash)
+	:
+	state_hash{state_hash} {}
+
+
+AttributeStorage::~AttributeStorage() {}
+
+
+size_t AttributeStorage::acquire(Unit *unit) {
+	if (not this->free_slots.empty()) {
+		size_t slot = this->free_slots.back();
+		this->free_slots.pop_back();
+		this->units[slot] = unit;
+		return slot;
+	}
+
+	this->units.push_back(unit);
+	return this->units.size() - 1;
+}
+
+
+void AttributeStorage::release(size_t slot) {
+	ENSURE(slot < this->units.size() and this->units[slot] != nullptr,
+	       "attribute slot " << slot << " is not in use");
+
+	auto &hitpoints = this->column<attr_type::hitpoints>();
+	if (this->state_hash and hitpoints.has(slot)) {
+		this->state_hash->remove(state_part::hitpoints, this->units[slot]->id, hitpoints.get(slot).current);
+	}
+
+	this->column<attr_type::owner>().erase(slot);
+	hitpoints.erase(slot);
+	this->column<attr_type::speed>().erase(slot);
+	this->column<attr_type::attack>().erase(slot);
+	this->column<attr_type::resource>().erase(slot);
+	this->column<attr_type::gatherer>().erase(slot);
+
+	this->units[slot] = nullptr;
+	this->free_slots.push_back(slot);
+}
+
+
+Unit *AttributeStorage::get_unit(size_t slot) const {
+	if (slot >= this->units.size()) {
+		return nullptr;
+	}
+	return this->units[slot];
+}
+
+
+bool AttributeStorage::add(size_t slot, const AttributeContainer &attr) {
+	switch (attr.type) {
+	case attr_type::owner:
+		this->column<attr_type::owner>().add(slot, static_cast<const Attribute<attr_type::owner> &>(attr));
+		return true;
+	case attr_type::hitpoints: {
+		auto &hitpoints = this->column<attr_type::hitpoints>();
+		if (not hitpoints.has(slot)) {
+			hitpoints.add(slot, static_cast<const Attribute<attr_type::hitpoints> &>(attr));
+			if (this->state_hash) {
+				this->state_hash->add(state_part::hitpoints, this->units[slot]->id, hitpoints.get(slot).current);
+			}
+		}
+		return true;
+	}
+	case attr_type::speed:
+		this->column<attr_type::speed>().add(slot, static_cast<const Attribute<attr_type::speed> &>(attr));
+		return true;
+	case attr_type::attack:
+		this->column<attr_type::attack>().add(slot, static_cast<const Attribute<attr_type::attack> &>(attr));
+		return true;
+	case attr_type::resource:
+		this->column<attr_type::resource>().add(slot, static_cast<const Attribute<attr_type::resource> &>(attr));
+		return true;
+	case attr_type::gatherer:
+		this->column<attr_type::gatherer>().add(slot, static_cast<const Attribute<attr_type::gatherer> &>(attr));
+		return true;
+	default:
+		ENSURE(not is_column_attribute(attr.type), "column attribute is not stored");
+		return false;
+	}
+}
+
+
+void AttributeStorage::set_hitpoints(size_t slot, unsigned int value) {
+	auto &hp = this->column<attr_type::hitpoints>().get(slot);
+	if (this->state_hash) {
+		this->state_hash->change(state_part::hitpoints, this->units[slot]->id, hp.current, value);
+	}
+	hp.current = value;
+}
+
+
+bool AttributeStorage::has(size_t slot, attr_type type) const {
+	switch (type) {
+	case attr_type::owner:
+		return this->column<attr_type::owner>().has(slot);
+	case attr_type::hitpoints:
+		return this->column<attr_type::hitpoints>().has(slot);
+	case attr_type::speed:
+		return this->column<attr_type::speed>().has(slot);
+	case attr_type::attack:
+		return this->column<attr_type::attack>().has(slot);
+	case attr_type::resource:
+		return this->column<attr_type::resource>().has(slot);
+	case attr_type::gatherer:
+		return this->column<attr_type::gatherer>().has(slot);
+	default:
+		return false;
+	}
+}
+
+} // namespace openage
@@ -0,0 +1,214 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "attribute.h"
+
+namespace openage {
+
+class StateHash;
+class Unit;
+
+/**
+ * attributes which are read by the actions of most units each tick.
+ * they are stored in the columns of the unit container,
+ * the other attributes stay in the attribute map of the unit.
+ */
+constexpr bool is_column_attribute(attr_type type) {
+	return type == attr_type::owner or
+	       type == attr_type::hitpoints or
+	       type == attr_type::speed or
+	       type == attr_type::attack or
+	       type == attr_type::resource or
+	       type == attr_type::gatherer;
+}
+
+
+/**
+ * dense storage of one attribute type, indexed by the attribute slot
+ * of the units. the values are kept in fixed size blocks, so
+ * references to them stay valid while other units are added.
+ */
+template<class T>
+class AttributeColumn {
+public:
+	AttributeColumn() = default;
+
+	~AttributeColumn() {
+		for (size_t slot = 0; slot < this->present.size(); slot++) {
+			this->erase(slot);
+		}
+	}
+
+	AttributeColumn(const AttributeColumn &) = delete;
+	AttributeColumn &operator =(const AttributeColumn &) = delete;
+
+	bool has(size_t slot) const {
+		return slot < this->present.size() and this->present[slot];
+	}
+
+	/**
+	 * the value of a slot, which must have one.
+	 */
+	T &get(size_t slot) {
+		return *reinterpret_cast<T *>(&this->blocks[slot / block_size]->values[slot % block_size]);
+	}
+
+	/**
+	 * store a copy of the value, unless the slot has one already.
+	 */
+	void add(size_t slot, const T &value) {
+		if (this->has(slot)) {
+			return;
+		}
+
+		while (this->blocks.size() <= slot / block_size) {
+			this->blocks.push_back(std::make_unique<block>());
+		}
+		if (this->present.size() <= slot) {
+			this->present.resize(slot + 1, false);
+		}
+
+		new (&this->blocks[slot / block_size]->values[slot % block_size]) T(value);
+		this->present[slot] = true;
+	}
+
+	void erase(size_t slot) {
+		if (not this->has(slot)) {
+			return;
+		}
+
+		this->get(slot).~T();
+		this->present[slot] = false;
+	}
+
+	/**
+	 * call func(slot, value) for each stored value, in slot order.
+	 */
+	template<class F>
+	void for_each(F func) {
+		for (size_t slot = 0; slot < this->present.size(); slot++) {
+			if (this->present[slot]) {
+				func(slot, this->get(slot));
+			}
+		}
+	}
+
+private:
+	static constexpr size_t block_size = 256;
+
+	struct block {
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type values[block_size];
+	};
+
+	std::vector<std::unique_ptr<block>> blocks;
+
+	/**
+	 * which slots hold a value
+	 */
+	std::vector<bool> present;
+};
+
+
+/**
+ * the attribute columns of all units of a container.
+ *
+ * each unit gets a slot when it's created, its column attributes
+ * are stored at that index. slots of removed units are reused,
+ * so the columns stay dense.
+ */
+class AttributeStorage {
+public:
+	/**
+	 * @param state_hash: gets the hitpoints of the units, may be null
+	 */
+	explicit AttributeStorage(StateHash *state_hash=nullptr);
+	~AttributeStorage();
+
+	AttributeStorage(const AttributeStorage &) = delete;
+	AttributeStorage &operator =(const AttributeStorage &) = delete;
+
+	/**
+	 * give a slot to a new unit.
+	 */
+	size_t acquire(Unit *unit);
+
+	/**
+	 * remove the attributes of a slot and free it.
+	 */
+	void release(size_t slot);
+
+	/**
+	 * the unit owning a slot, nullptr when it is free.
+	 */
+	Unit *get_unit(size_t slot) const;
+
+	/**
+	 * copy an attribute into the column of its type.
+	 *
+	 * @returns false if the type is not stored in a column.
+	 */
+	bool add(size_t slot, const AttributeContainer &attr);
+
+	/**
+	 * whether the slot has a column attribute of the type.
+	 */
+	bool has(size_t slot, attr_type type) const;
+
+	/**
+	 * change the current hitpoints of the slot, which must have them.
+	 * the hitpoints are hashed, so they must not be changed otherwise.
+	 */
+	void set_hitpoints(size_t slot, unsigned int value);
+
+	template<attr_type T>
+	AttributeColumn<Attribute<T>> &column() {
+		static_assert(is_column_attribute(T), "attribute type is not stored in a column");
+		return std::get<AttributeColumn<Attribute<T>>>(this->columns);
+	}
+
+	template<attr_type T>
+	const AttributeColumn<Attribute<T>> &column() const {
+		static_assert(is_column_attribute(T), "attribute type is not stored in a column");
+		return std::get<AttributeColumn<Attribute<T>>>(this->columns);
+	}
+
+	/**
+	 * call func(unit, attribute) for each unit with the attribute,
+	 * iterating its column linearly.
+	 */
+	template<attr_type T, class F>
+	void for_each(F func) {
+		this->column<T>().for_each([this, &func](size_t slot, Attribute<T> &attr) {
+			func(*this->units[slot], attr);
+		});
+	}
+
+private:
+	std::tuple<
+		AttributeColumn<Attribute<attr_type::owner>>,
+		AttributeColumn<Attribute<attr_type::hitpoints>>,
+		AttributeColumn<Attribute<attr_type::speed>>,
+		AttributeColumn<Attribute<attr_type::attack>>,
+		AttributeColumn<Attribute<attr_type::resource>>,
+		AttributeColumn<Attribute<attr_type::gatherer>>
+	> columns;
+
+	/**
+	 * owner of each slot
+	 */
+	std::vector<Unit *> units;
+
+	std::vector<size_t> free_slots;
+
+	StateHash *state_hash;
+};
+
+} // namespace openage
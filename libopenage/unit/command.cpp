@@ -1,7 +1,9 @@
-// Copyright 2014-2015 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include "command.h"
 
+#include "../error/error.h"
+
 namespace openage {
 
 Command::Command(const Player &p, Unit *unit, bool haspos, UnitType *t)
@@ -65,6 +67,11 @@ UnitType *Command::type() const {
 	return this->unit_type;
 }
 
+void Command::set_position(coord::phys3 position) {
+	ENSURE(this->has_pos, "only the position of a positional command can be moved");
+	this->pos = position;
+}
+
 void Command::set_ability(ability_type t) {
 	this->modifiers = 0;
 	this->modifiers[static_cast<int>(t)] = true;
@@ -79,11 +86,11 @@ const ability_set &Command::ability() const {
 }
 
 void Command::add_flag(command_flag flag) {
-	this->flags.insert(flag);
+	this->flags[static_cast<size_t>(flag)] = true;
 }
 
 bool Command::has_flag(command_flag flag) const {
-	return 0 < this->flags.count(flag);
+	return this->flags[static_cast<size_t>(flag)];
 }
 
 } // namespace openage
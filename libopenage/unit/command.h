@@ -1,11 +1,13 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
-#include <unordered_set>
+#include <bitset>
+#include <vector>
 
 #include "../coord/phys3.h"
 #include "ability.h"
+#include "unit_container.h"
 
 namespace openage {
 
@@ -15,29 +17,15 @@ namespace openage {
 enum class command_flag {
 	direct, // the user directly issued this command
 	use_range, // move command account for units range
-	attack_res // allow attack on a resource object
+	attack_res, // allow attack on a resource object
+	group_move // move as part of a large group, which shares a flow field
+	// update command_flag_count when adding flags
 };
 
-} // namespace openage
-
-namespace std {
-
 /**
- * hasher for game command flags
+ * number of command flags
  */
-template<>
-struct hash<openage::command_flag> {
-	typedef underlying_type<openage::command_flag>::type underlying_type;
-	typedef hash<underlying_type>::result_type result_type;
-	result_type operator()(const openage::command_flag &arg) const {
-		hash<underlying_type> hasher;
-		return hasher(static_cast<underlying_type>(arg));
-	}
-};
-
-} // namespace std
-
-namespace openage {
+constexpr size_t command_flag_count = 4;
 
 class Player;
 class Unit;
@@ -82,6 +70,12 @@ public:
 	coord::phys3 position() const;
 	UnitType *type() const;
 
+	/**
+	 * moves the target position, e.g. to the place of
+	 * a unit in a formation. the command must have a position.
+	 */
+	void set_position(coord::phys3 position);
+
 	/**
 	 * sets invoked ability type, no other type may be used if
 	 * this gets set
@@ -129,9 +123,9 @@ private:
 	UnitType *unit_type;
 
 	/**
-	 * additional options
+	 * additional options, indexed by the command_flag
 	 */
-	std::unordered_set<command_flag> flags;
+	std::bitset<command_flag_count> flags;
 
 	/**
 	 * select actions to use when targeting
@@ -140,4 +134,17 @@ private:
 
 };
 
+/**
+ * A command given to several units at once, e.g. to a selection.
+ * See UnitContainer::dispatch_group_command.
+ */
+struct GroupCommand {
+	GroupCommand(const Command &command)
+		:
+		command{command} {}
+
+	Command command;
+	std::vector<UnitReference> units;
+};
+
 } // namespace openage
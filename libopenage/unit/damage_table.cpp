@@ -0,0 +1,57 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "damage_table.h"
+
+#include "attribute.h"
+#include "unit.h"
+#include "unit_type.h"
+
+
+namespace openage {
+
+DamageTable::DamageTable() {}
+
+
+unsigned int DamageTable::get(Unit &attacker, Unit &target) {
+	const UnitType *attacker_type = attacker.unit_type;
+	const UnitType *target_type = target.unit_type;
+
+	if (this->rows.size() <= attacker_type->table_index) {
+		this->rows.resize(attacker_type->table_index + 1);
+	}
+	std::vector<entry> &row = this->rows[attacker_type->table_index];
+	if (row.size() <= target_type->table_index) {
+		row.resize(target_type->table_index + 1, entry{0, 0});
+	}
+
+	entry &cached = row[target_type->table_index];
+	uint32_t revision = attacker_type->get_revision() + target_type->get_revision() + 1;
+	if (cached.revision != revision) {
+		cached.damage = DamageTable::compute(attacker, target);
+		cached.revision = revision;
+	}
+	return cached.damage;
+}
+
+
+unsigned int DamageTable::compute(Unit &attacker, Unit &target) {
+	auto &armor = target.get_attribute<attr_type::armor>().armor;
+	auto &damage = attacker.get_attribute<attr_type::attack>().damage;
+
+	unsigned int actual_damage = 0;
+	for (const auto &pair : armor) {
+		auto search = damage.find(pair.first);
+		if (search != damage.end()) {
+			if (pair.second < search->second) {
+				actual_damage += search->second - pair.second;
+			}
+		}
+	}
+	// TODO add elevation modifier here
+	if (actual_damage < 1) {
+		actual_damage = 1;
+	}
+	return actual_damage;
+}
+
+} // namespace openage
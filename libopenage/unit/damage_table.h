@@ -0,0 +1,55 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace openage {
+
+class Unit;
+
+/**
+ * the damage of the attacks between unit types, kept for the units of
+ * one player, so each hit is a lookup instead of matching the attack
+ * against the armor classes.
+ *
+ * an entry is computed from the attack of the first attacker and the
+ * armor of the first target of the types, like all units of a type share
+ * the attributes of the type. entries are computed again after one
+ * of the types was upgraded.
+ */
+class DamageTable {
+public:
+	DamageTable();
+
+	/**
+	 * the damage one attack of the attacker does to the target.
+	 * both units must have a type, the attacker an attack
+	 * and the target armor.
+	 */
+	unsigned int get(Unit &attacker, Unit &target);
+
+	/**
+	 * the damage of the attack against the armor, without the table.
+	 */
+	static unsigned int compute(Unit &attacker, Unit &target);
+
+private:
+	struct entry {
+		unsigned int damage;
+
+		/**
+		 * sum of the revisions of both types plus one, 0 for empty entries
+		 */
+		uint32_t revision;
+	};
+
+	/**
+	 * indexed by the table index of the attacker type,
+	 * then by the one of the target type
+	 */
+	std::vector<std::vector<entry>> rows;
+};
+
+} // namespace openage
@@ -0,0 +1,184 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "dropsite_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../gamestate/player.h"
+#include "../terrain/terrain_object.h"
+#include "attribute.h"
+#include "unit.h"
+
+
+namespace openage {
+
+namespace {
+
+/**
+ * the largest distance of a building's edge to its center
+ */
+coord::phys_t building_extent(const TerrainObject &obj) {
+	coord::tile_t ne = std::max<coord::tile_t>(obj.pos.end.ne - obj.pos.start.ne, 1);
+	coord::tile_t se = std::max<coord::tile_t>(obj.pos.end.se - obj.pos.start.se, 1);
+	return static_cast<coord::phys_t>(std::hypot(ne, se) * coord::settings::phys_per_tile / 2);
+}
+
+} // anonymous namespace
+
+
+DropsiteIndex::DropsiteIndex(const Player &owner)
+	:
+	owner(owner) {
+
+	for (auto &index : this->trees) {
+		index.max_extent = 0;
+		index.dirty = false;
+	}
+}
+
+
+void DropsiteIndex::add(Unit &building) {
+	if (not building.has_attribute(attr_type::dropsite) or not building.location) {
+		return;
+	}
+
+	site entry{building.get_ref(), building.location->pos.draw};
+	coord::phys_t extent = building_extent(*building.location);
+
+	auto &dropsite = building.get_attribute<attr_type::dropsite>();
+	for (size_t i = 0; i < this->trees.size(); i++) {
+		if (not dropsite.accepting_resource(static_cast<game_resource>(i))) {
+			continue;
+		}
+
+		// a building is completed again by each of its builders
+		tree &index = this->trees[i];
+		bool known = std::any_of(
+			std::begin(index.sites), std::end(index.sites),
+			[&building](const site &other) {
+				return other.unit.is_valid() and other.unit.get() == &building;
+			}
+		);
+		if (known) {
+			continue;
+		}
+
+		index.sites.push_back(entry);
+		index.max_extent = std::max(index.max_extent, extent);
+		index.dirty = true;
+	}
+}
+
+
+UnitReference DropsiteIndex::nearest(game_resource resource, const coord::phys3 &position) {
+	tree &index = this->trees[static_cast<size_t>(resource)];
+	if (index.dirty) {
+		this->build(index);
+	}
+
+	const site *best = nullptr;
+	coord::phys_t best_distance = std::numeric_limits<coord::phys_t>::max();
+	this->search(index, 0, index.sites.size(), true, position, best, best_distance);
+
+	UnitReference result;
+	if (best) {
+		result = best->unit;
+	}
+
+	// drop the invalid sites the search met, for the next one
+	if (index.dirty) {
+		this->build(index);
+	}
+	return result;
+}
+
+
+bool DropsiteIndex::is_valid(const site &entry) const {
+	if (not entry.unit.is_valid()) {
+		return false;
+	}
+
+	Unit *unit = entry.unit.get();
+	return unit->location and
+	       unit->has_attribute(attr_type::building) and
+	       unit->get_attribute<attr_type::building>().completed >= 1.0f and
+	       this->owner.owns(*unit);
+}
+
+
+void DropsiteIndex::build(tree &index) {
+	index.sites.erase(
+		std::remove_if(
+			std::begin(index.sites), std::end(index.sites),
+			[this](const site &entry) {
+				return not this->is_valid(entry);
+			}
+		),
+		std::end(index.sites)
+	);
+
+	this->build(index.sites, 0, index.sites.size(), true);
+	index.dirty = false;
+}
+
+
+void DropsiteIndex::build(std::vector<site> &sites, size_t begin, size_t end, bool split_ne) {
+	if (end - begin < 2) {
+		return;
+	}
+
+	size_t mid = begin + (end - begin) / 2;
+	std::nth_element(
+		std::begin(sites) + begin, std::begin(sites) + mid, std::begin(sites) + end,
+		[split_ne](const site &a, const site &b) {
+			return split_ne ? a.position.ne < b.position.ne : a.position.se < b.position.se;
+		}
+	);
+
+	this->build(sites, begin, mid, not split_ne);
+	this->build(sites, mid + 1, end, not split_ne);
+}
+
+
+void DropsiteIndex::search(tree &index, size_t begin, size_t end, bool split_ne,
+                           const coord::phys3 &position,
+                           const site *&best, coord::phys_t &best_distance) const {
+	if (begin >= end) {
+		return;
+	}
+
+	size_t mid = begin + (end - begin) / 2;
+	const site &root = index.sites[mid];
+
+	if (this->is_valid(root)) {
+		coord::phys_t distance = root.unit.get()->location->from_edge(position);
+		if (distance < best_distance) {
+			best = &root;
+			best_distance = distance;
+		}
+	}
+	else {
+		index.dirty = true;
+	}
+
+	coord::phys_t offset = split_ne ? position.ne - root.position.ne : position.se - root.position.se;
+
+	// the side of the position first, the other one if a site
+	// there may be nearer than the best one
+	if (offset < 0) {
+		this->search(index, begin, mid, not split_ne, position, best, best_distance);
+		if (-offset - index.max_extent < best_distance) {
+			this->search(index, mid + 1, end, not split_ne, position, best, best_distance);
+		}
+	}
+	else {
+		this->search(index, mid + 1, end, not split_ne, position, best, best_distance);
+		if (offset - index.max_extent < best_distance) {
+			this->search(index, begin, mid, not split_ne, position, best, best_distance);
+		}
+	}
+}
+
+} // namespace openage
@@ -0,0 +1,94 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "../gamestate/resource.h"
+#include "unit_container.h"
+
+namespace openage {
+
+class Player;
+class Unit;
+
+/**
+ * the completed dropsites of one player, by the resources they accept.
+ *
+ * the dropsites of each resource are kept in a 2d tree, so the
+ * nearest one is found without searching the terrain. dropsites are
+ * added when their building is completed. those that were destroyed,
+ * converted or lost their location are dropped when a search meets
+ * them, and the tree is built again.
+ */
+class DropsiteIndex {
+public:
+	DropsiteIndex(const Player &owner);
+
+	/**
+	 * adds a completed building, if it is a dropsite.
+	 */
+	void add(Unit &building);
+
+	/**
+	 * the dropsite accepting the resource with the
+	 * edge nearest to the position.
+	 *
+	 * @returns an invalid reference if there is none.
+	 */
+	UnitReference nearest(game_resource resource, const coord::phys3 &position);
+
+private:
+	struct site {
+		UnitReference unit;
+		coord::phys3 position;
+	};
+
+	struct tree {
+		/**
+		 * the sites in the order of the tree: the median of a range
+		 * is its root, the halves before and after it its subtrees,
+		 * split by ne and se on alternating levels.
+		 */
+		std::vector<site> sites;
+
+		/**
+		 * the largest distance of a site's edge to its position
+		 */
+		coord::phys_t max_extent;
+
+		/**
+		 * whether sites were added or became invalid
+		 * since the tree was built
+		 */
+		bool dirty;
+	};
+
+	/**
+	 * whether the site is still a dropsite of the owner.
+	 */
+	bool is_valid(const site &entry) const;
+
+	/**
+	 * removes invalid sites and sorts the rest into a tree.
+	 */
+	void build(tree &index);
+
+	void build(std::vector<site> &sites, size_t begin, size_t end, bool split_ne);
+
+	/**
+	 * searches the subtree of the range for a site nearer than best.
+	 */
+	void search(tree &index, size_t begin, size_t end, bool split_ne,
+	            const coord::phys3 &position,
+	            const site *&best, coord::phys_t &best_distance) const;
+
+	const Player &owner;
+
+	std::array<tree, static_cast<size_t>(game_resource::RESOURCE_TYPE_COUNT)> trees;
+};
+
+} // namespace openage
@@ -4,8 +4,8 @@
 
 #include "../gamedata/unit.gen.h"
 #include "../terrain/terrain.h"
+#include "../terrain/terrain_chunk.h"
 #include "../terrain/terrain_object.h"
-#include "../terrain/terrain_outline.h"
 #include "../util/strings.h"
 #include "../log/log.h"
 #include "ability.h"
@@ -53,7 +53,6 @@ ObjectProducer::ObjectProducer(const Player &owner, const GameSpec &spec, const
 	UnitType(owner),
 	dataspec(spec),
 	unit_data(*ud),
-	terrain_outline{nullptr},
 	default_tex{spec.get_unit_texture(ud->graphic_standing0)},
 	dead_unit_id{ud->dead_unit_id} {
 
@@ -61,7 +60,8 @@ ObjectProducer::ObjectProducer(const Player &owner, const GameSpec &spec, const
 	this->unit_class = this->unit_data.unit_class;
 
 	// for now just look for type names ending with "_D"
-	this->decay = unit_data.name.substr(unit_data.name.length() - 2) == "_D";
+	std::string type_name = unit_data.name.to_string();
+	this->decay = type_name.size() >= 2 and type_name.substr(type_name.size() - 2) == "_D";
 
 	// find suitable sounds
 	int creation_sound = this->unit_data.sound_creation0;
@@ -84,13 +84,8 @@ ObjectProducer::ObjectProducer(const Player &owner, const GameSpec &spec, const
 		static_cast<int>(this->unit_data.radius_y * 2),
 	};
 
-	// shape of the outline
-	if (this->unit_data.selection_shape > 1) {
-		this->terrain_outline = radial_outline(this->unit_data.radius_x);
-	}
-	else {
-		this->terrain_outline = square_outline(this->foundation_size);
-	}
+	// the sight is measured in tiles
+	this->line_of_sight = static_cast<int>(this->unit_data.line_of_sight);
 
 	// graphic set
 	auto standing = spec.get_unit_texture(this->unit_data.graphic_standing0);
@@ -111,7 +106,7 @@ ObjectProducer::ObjectProducer(const Player &owner, const GameSpec &spec, const
 	this->graphics[graphic_type::work] = this->graphics[graphic_type::standing];
 
 	// pull extra graphics from unit commands
-	auto cmds = spec.get_command_data(this->unit_data.id0);
+	const auto &cmds = spec.get_command_data(this->unit_data.id0);
 	for (auto cmd : cmds) {
 
 		// same attack / work graphic
@@ -168,7 +163,7 @@ int ObjectProducer::parent_id() const {
 }
 
 std::string ObjectProducer::name() const {
-	return this->unit_data.name;
+	return this->unit_data.name.to_string();
 }
 
 void ObjectProducer::initialise(Unit *unit, Player &player) {
@@ -186,34 +181,34 @@ void ObjectProducer::initialise(Unit *unit, Player &player) {
 	unit->unit_type = this;
 
 	// colour
-	unit->add_attribute(std::make_shared<Attribute<attr_type::owner>>(player));
+	unit->copy_attribute(Attribute<attr_type::owner>(player));
 
 	// hitpoints if available
 	if (this->unit_data.hit_points > 0) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::hitpoints>>(this->unit_data.hit_points));
+		unit->copy_attribute(Attribute<attr_type::hitpoints>(this->unit_data.hit_points));
 	}
 
 	// collectable resources
 	if (this->unit_data.unit_class == gamedata::unit_classes::TREES) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::wood, 125));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::wood, 125));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::BERRY_BUSH) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 100));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::food, 100));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::SEA_FISH) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 200));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::food, 200));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::PREY_ANIMAL) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 140));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::food, 140));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::SHEEP) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::food, 100));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::food, 100));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::GOLD_MINE) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::gold, 800));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::gold, 800));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::STONE_MINE) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::resource>>(game_resource::stone, 350));
+		unit->copy_attribute(Attribute<attr_type::resource>(game_resource::stone, 350));
 	}
 
 	// decaying units have a timed lifespan
@@ -255,10 +250,10 @@ TerrainObject *ObjectProducer::place(Unit *u, std::shared_ptr<Terrain> terrain,
 
 	// create new object with correct base shape
 	if (this->unit_data.selection_shape > 1) {
-		u->make_location<RadialObject>(this->unit_data.radius_x, this->terrain_outline);
+		u->make_location<RadialObject>(this->unit_data.radius_x);
 	}
 	else {
-		u->make_location<SquareObject>(this->foundation_size, this->terrain_outline);
+		u->make_location<SquareObject>(this->foundation_size);
 	}
 
 	// find set of allowed terrains
@@ -271,33 +266,42 @@ TerrainObject *ObjectProducer::place(Unit *u, std::shared_ptr<Terrain> terrain,
 	 */
 	TerrainObject *obj_ptr = u->location.get();
 	std::weak_ptr<Terrain> terrain_ptr = terrain;
-	u->location->passable = [obj_ptr, terrain_ptr, terrains](const coord::phys3 &pos) -> bool {
+	size_t layer = terrain->get_passability_layer(terrains);
+	u->location->passable = [obj_ptr, terrain_ptr, terrains, layer](const coord::phys3 &pos) -> bool {
 
 		// if location is deleted, then so is this lambda (deleting terrain implies location is deleted)
 		// so locking objects here will not return null
 		auto terrain = terrain_ptr.lock();
 
-		// look at all tiles in the bases range
-		for (coord::tile check_pos : tile_list(obj_ptr->get_range(pos))) {
-			TileContent *tc = terrain->get_data(check_pos);
+		// objects can only intersect on occupied tiles
+		bool occupied = false;
 
-			// invalid tile types
-			if (!tc || terrains.count(tc->terrain_id) == 0) {
+		// look at all tiles in the bases range
+		for (coord::tile check_pos : frame_tile_list(obj_ptr->get_range(pos))) {
+			TerrainChunk *chunk = terrain->get_chunk(check_pos);
+			if (chunk == nullptr) {
 				return false;
 			}
+			size_t tile = TerrainChunk::tile_index(check_pos);
+			TileContent *tc = chunk->get_data(tile);
 
-			// compare with objects intersecting the units tile
-			// ensure no intersections with other objects
-			for (auto obj_cmp : tc->obj) {
-				if (obj_ptr != obj_cmp &&
-				    obj_cmp->check_collisions() &&
-				    obj_ptr->intersects(*obj_cmp, pos)) {
+			// invalid tile types
+			if (layer != Terrain::no_passability_layer) {
+				if (not test_tile(chunk->allowed[layer], tile)) {
 					return false;
 				}
 			}
+			else if (terrains.count(tc->terrain_id) == 0) {
+				return false;
+			}
+
+			occupied = occupied or test_tile(chunk->occupied, tile);
 		}
-		return true;
+
+		// ensure no intersections with other objects
+		return not occupied or obj_ptr->find_intersecting(*terrain, pos) == nullptr;
 	};
+	u->location->passability_layer = layer;
 
 	u->location->draw = [u, obj_ptr]() {
 		if (u->selected) {
@@ -375,7 +379,7 @@ void MovableProducer::initialise(Unit *unit, Player &player) {
 	 * where 1.5 in game seconds pass in 1 real second
 	 */
 	coord::phys_t sp = this->unit_data.speed * coord::settings::phys_per_tile / 666;
-	unit->add_attribute(std::make_shared<Attribute<attr_type::speed>>(sp));
+	unit->copy_attribute(Attribute<attr_type::speed>(sp));
 
 	// projectile of melee attacks
 	UnitType *proj_type = this->owner.get_type(this->projectile);
@@ -384,10 +388,10 @@ void MovableProducer::initialise(Unit *unit, Player &player) {
 
 		// calculate requirements for ranged attacks
 		coord::phys_t range_phys = coord::settings::phys_per_tile * this->unit_data.max_range;
-		unit->add_attribute(std::make_shared<Attribute<attr_type::attack>>(proj_type, range_phys, 48000, 1, reset_type));
+		unit->copy_attribute(Attribute<attr_type::attack>(proj_type, range_phys, 48000, 1, reset_type));
 	}
 	else {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::attack>>(nullptr, 0, 0, 1, reset_type));
+		unit->copy_attribute(Attribute<attr_type::attack>(nullptr, 0, 0, 1, reset_type));
 	}
 }
 
@@ -415,7 +419,7 @@ void LivingProducer::initialise(Unit *unit, Player &player) {
 
 	// add worker attributes
 	if (this->unit_data.unit_class == gamedata::unit_classes::CIVILIAN) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::gatherer>>());
+		unit->copy_attribute(Attribute<attr_type::gatherer>());
 
 		// add graphic ids for resource actions
 		auto &gather_attr = unit->get_attribute<attr_type::gatherer>();
@@ -451,7 +455,7 @@ void LivingProducer::initialise(Unit *unit, Player &player) {
 		unit->give_ability(std::make_shared<RepairAbility>(this->on_attack));
 	}
 	else if (this->unit_data.unit_class == gamedata::unit_classes::FISHING_BOAT) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::gatherer>>());
+		unit->copy_attribute(Attribute<attr_type::gatherer>());
 
 		// add fishing abilites
 		auto &gather_attr = unit->get_attribute<attr_type::gatherer>();
@@ -504,6 +508,9 @@ BuildingProducer::BuildingProducer(const Player &owner, const GameSpec &spec, co
 		static_cast<int>(this->unit_data.radius_y * 2),
 	};
 
+	// the sight is measured in tiles
+	this->line_of_sight = static_cast<int>(this->unit_data.line_of_sight);
+
 	// graphic set
 	this->graphics[graphic_type::construct] = spec.get_unit_texture(ud->construction_graphic_id);
 	this->graphics[graphic_type::standing] = spec.get_unit_texture(ud->graphic_standing0);
@@ -513,7 +520,11 @@ BuildingProducer::BuildingProducer(const Player &owner, const GameSpec &spec, co
 		this->graphics[graphic_type::dying] = dying_tex;
 	}
 
-	this->terrain_outline = square_outline(this->foundation_size);
+	// the accepted resources are the same for all buildings of the type
+	std::vector<game_resource> accepted_resources = this->get_accepted_resources();
+	if (accepted_resources.size() != 0) {
+		this->default_attributes[attr_type::dropsite] = std::make_shared<Attribute<attr_type::dropsite>>(accepted_resources);
+	}
 }
 
 BuildingProducer::~BuildingProducer() {}
@@ -527,7 +538,7 @@ int BuildingProducer::parent_id() const {
 }
 
 std::string BuildingProducer::name() const {
-	return this->unit_data.name;
+	return this->unit_data.name.to_string();
 }
 
 void BuildingProducer::initialise(Unit *unit, Player &player) {
@@ -541,8 +552,7 @@ void BuildingProducer::initialise(Unit *unit, Player &player) {
 	// initialize graphic set
 	unit->unit_type = this;
 
-	auto player_attr = std::make_shared<Attribute<attr_type::owner>>(player);
-	unit->add_attribute(player_attr);
+	unit->copy_attribute(Attribute<attr_type::owner>(player));
 
 	// building specific attribute
 	auto build_attr = std::make_shared<Attribute<attr_type::building>>();
@@ -554,7 +564,7 @@ void BuildingProducer::initialise(Unit *unit, Player &player) {
 
 	// garrison and hp for all buildings
 	unit->add_attribute(std::make_shared<Attribute<attr_type::garrison>>());
-	unit->add_attribute(std::make_shared<Attribute<attr_type::hitpoints>>(this->unit_data.hit_points));
+	unit->copy_attribute(Attribute<attr_type::hitpoints>(this->unit_data.hit_points));
 
 	bool has_destruct_graphic = this->destroyed != nullptr;
 	unit->push_action(std::make_unique<FoundationAction>(unit, has_destruct_graphic), true);
@@ -562,15 +572,12 @@ void BuildingProducer::initialise(Unit *unit, Player &player) {
 	UnitType *proj_type = this->owner.get_type(this->projectile);
 	if (this->unit_data.projectile_unit_id > 0 && proj_type) {
 		coord::phys_t range_phys = coord::settings::phys_per_tile * this->unit_data.max_range;
-		unit->add_attribute(std::make_shared<Attribute<attr_type::attack>>(proj_type, range_phys, 350000, 1, this));
+		unit->copy_attribute(Attribute<attr_type::attack>(proj_type, range_phys, 350000, 1, this));
 		unit->give_ability(std::make_shared<AttackAbility>());
 	}
 
-	// dropsite attribute
-	std::vector<game_resource> accepted_resources = this->get_accepted_resources();
-	if (accepted_resources.size() != 0) {
-		unit->add_attribute(std::make_shared<Attribute<attr_type::dropsite>>(accepted_resources));
-	}
+	// dropsite attribute, shared with the type
+	this->copy_attributes(unit);
 
 	// building can train new units and ungarrison
 	unit->give_ability(std::make_shared<SetPointAbility>());
@@ -605,7 +612,7 @@ std::vector<game_resource> BuildingProducer::get_accepted_resources() {
 TerrainObject *BuildingProducer::place(Unit *u, std::shared_ptr<Terrain> terrain, coord::phys3 init_pos) const {
 
 	// buildings have a square base
-	u->make_location<SquareObject>(this->foundation_size, this->terrain_outline);
+	u->make_location<SquareObject>(this->foundation_size);
 
 	/*
 	 * decide what terrain is passable using this lambda
@@ -618,14 +625,10 @@ TerrainObject *BuildingProducer::place(Unit *u, std::shared_ptr<Terrain> terrain
 		auto terrain = terrain_ptr.lock();
 
 		// look at all tiles in the bases range
-		for (coord::tile check_pos : tile_list(obj_ptr->get_range(pos))) {
-			TileContent *tc = terrain->get_data(check_pos);
-			if (!tc) {
+		for (coord::tile check_pos : frame_tile_list(obj_ptr->get_range(pos))) {
+			if (not foundation_tile_free(*terrain, check_pos)) {
 				return false;
 			}
-			for (auto tobj : tc->obj) {
-				if (tobj->check_collisions()) return false;
-			}
 		}
 		return true;
 	};
@@ -722,9 +725,6 @@ ProjectileProducer::ProjectileProducer(const Player &owner, const GameSpec &spec
 	if (destroyed) {
 		this->graphics[graphic_type::dying] = destroyed;
 	}
-
-	// outline
-	terrain_outline = radial_outline(pd->radius_y);
 }
 
 ProjectileProducer::~ProjectileProducer() {}
@@ -738,7 +738,7 @@ int ProjectileProducer::parent_id() const {
 }
 
 std::string ProjectileProducer::name() const {
-	return this->unit_data.name;
+	return this->unit_data.name.to_string();
 }
 
 void ProjectileProducer::initialise(Unit *unit, Player &player) {
@@ -749,7 +749,7 @@ void ProjectileProducer::initialise(Unit *unit, Player &player) {
 
 	// projectile speed
 	coord::phys_t sp = this->unit_data.speed * coord::settings::phys_per_tile / 666;
-	unit->add_attribute(std::make_shared<Attribute<attr_type::speed>>(sp));
+	unit->copy_attribute(Attribute<attr_type::speed>(sp));
 	unit->add_attribute(std::make_shared<Attribute<attr_type::projectile>>(this->unit_data.projectile_arc));
 	unit->add_attribute(std::make_shared<Attribute<attr_type::direction>>(coord::phys3_delta{ 1, 0, 0 }));
 
@@ -763,47 +763,14 @@ TerrainObject *ProjectileProducer::place(Unit *u, std::shared_ptr<Terrain> terra
 	/*
 	 * radial base shape without collision checking
 	 */
-	u->make_location<RadialObject>(this->unit_data.radius_y, this->terrain_outline);
+	u->make_location<RadialObject>(this->unit_data.radius_y);
 
-	TerrainObject *obj_ptr = u->location.get();
 	std::weak_ptr<Terrain> terrain_ptr = terrain;
-	u->location->passable = [obj_ptr, u, terrain_ptr](const coord::phys3 &pos) -> bool {
-		if (pos.up > 64000) {
-			return true;
-		}
-
-		// avoid intersections with launcher
-		Unit *launcher = nullptr;
+	u->location->passable = [terrain_ptr](const coord::phys3 &pos) -> bool {
+		// hits are found by the ProjectileSystem,
+		// the projectile only has to stay on the terrain
 		auto terrain = terrain_ptr.lock();
-		if (u->has_attribute(attr_type::projectile)) {
-			auto &pr_attr = u->get_attribute<attr_type::projectile>();
-			if (pr_attr.launched && pr_attr.launcher.is_valid()) {
-				launcher = pr_attr.launcher.get();
-			}
-			else {
-				return true;
-			}
-		}
-		else {
-			return true;
-		}
-
-		// look at all tiles in the bases range
-		for (coord::tile check_pos : tile_list(obj_ptr->get_range(pos))) {
-			TileContent *tc = terrain->get_data(check_pos);
-			if (!tc) return false;
-
-			// ensure no intersections with other objects
-			for (auto obj_cmp : tc->obj) {
-				if (obj_ptr != obj_cmp &&
-				    &obj_cmp->unit != launcher &&
-				    obj_cmp->check_collisions() &&
-				    obj_ptr->intersects(*obj_cmp, pos)) {
-					return false;
-				}
-			}
-		}
-		return true;
+		return terrain and terrain->get_data(pos.to_tile3().to_tile()) != nullptr;
 	};
 
 	u->location->draw = [u]() {
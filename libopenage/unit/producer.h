@@ -1,9 +1,10 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "../coord/tile.h"
@@ -57,7 +58,6 @@ protected:
 	 */
 	const Sound *on_create;
 	const Sound *on_destroy;
-	std::shared_ptr<Texture> terrain_outline;
 	std::shared_ptr<UnitTexture> default_tex;
 	int dead_unit_id;
 
@@ -127,7 +127,6 @@ private:
 	 */
 	const Sound *on_create;
 	const Sound *on_destroy;
-	std::shared_ptr<Texture> terrain_outline;
 	std::shared_ptr<UnitTexture> texture;
 	std::shared_ptr<UnitTexture> destroyed;
 	int trainable1;
@@ -162,7 +161,6 @@ public:
 
 private:
 	const gamedata::unit_projectile unit_data;
-	std::shared_ptr<Texture> terrain_outline;
 	std::shared_ptr<UnitTexture> tex;
 	std::shared_ptr<UnitTexture> sh; // shadow texture
 	std::shared_ptr<UnitTexture> destroyed;
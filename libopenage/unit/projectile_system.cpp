@@ -0,0 +1,213 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "projectile_system.h"
+
+#include <cmath>
+
+#include "../terrain/spatial_index.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "action.h"
+#include "unit.h"
+
+
+namespace openage {
+
+namespace {
+
+/**
+ * projectiles above this height fly over all objects
+ */
+constexpr coord::phys_t flight_ceiling = 64000;
+
+} // anonymous namespace
+
+
+ProjectileSystem::ProjectileSystem() {}
+
+
+void ProjectileSystem::launch(ProjectileAction *action, coord::phys3 target) {
+	Unit *unit = action->entity;
+	coord::phys3 position = unit->location->pos.draw;
+
+	// find speed to move
+	auto &sp_attr = unit->get_attribute<attr_type::speed>();
+	coord::phys_t projectile_speed = sp_attr.unit_speed;
+
+	// arc of projectile
+	auto &pr_attr = unit->get_attribute<attr_type::projectile>();
+	float projectile_arc = pr_attr.projectile_arc;
+
+	// distance and time to target
+	coord::phys3_delta d = target - position;
+	coord::phys_t distance_to_target = coord::length(d.ne, d.se);
+	int flight_time = distance_to_target / projectile_speed;
+
+	if (projectile_arc < 0) {
+		// TODO negative values probably indicate something
+		projectile_arc += 0.2;
+	}
+
+	// now figure gravity from arc parameter
+	// TODO projectile arc is the ratio between horizontal and
+	// vertical components of the initial direction
+	coord::phys_t grav = 0.01f * (exp(pow(projectile_arc, 0.5f)) - 1) * projectile_speed;
+
+	// inital launch direction
+	auto &d_attr = unit->get_attribute<attr_type::direction>();
+	d_attr.unit_dir = (projectile_speed * d) / distance_to_target;
+
+	// account for initial height
+	coord::phys_t initial_height = position.up;
+	d_attr.unit_dir.up = (grav * flight_time) / 2 - (initial_height / flight_time);
+
+	action->flying = true;
+	action->index = this->actions.size();
+
+	this->actions.push_back(action);
+	this->pos_ne.push_back(position.ne);
+	this->pos_se.push_back(position.se);
+	this->pos_up.push_back(position.up);
+	this->vel_ne.push_back(d_attr.unit_dir.ne);
+	this->vel_se.push_back(d_attr.unit_dir.se);
+	this->vel_up.push_back(d_attr.unit_dir.up);
+	this->gravity.push_back(grav);
+}
+
+
+void ProjectileSystem::remove(size_t index) {
+	size_t last = this->actions.size() - 1;
+
+	this->actions[index]->flying = false;
+	if (index != last) {
+		this->actions[index] = this->actions[last];
+		this->actions[index]->index = index;
+
+		this->pos_ne[index] = this->pos_ne[last];
+		this->pos_se[index] = this->pos_se[last];
+		this->pos_up[index] = this->pos_up[last];
+		this->vel_ne[index] = this->vel_ne[last];
+		this->vel_se[index] = this->vel_se[last];
+		this->vel_up[index] = this->vel_up[last];
+		this->gravity[index] = this->gravity[last];
+	}
+
+	this->actions.pop_back();
+	this->pos_ne.pop_back();
+	this->pos_se.pop_back();
+	this->pos_up.pop_back();
+	this->vel_ne.pop_back();
+	this->vel_se.pop_back();
+	this->vel_up.pop_back();
+	this->gravity.pop_back();
+}
+
+
+size_t ProjectileSystem::size() const {
+	return this->actions.size();
+}
+
+
+void ProjectileSystem::update(time_nsec_t lastframe_duration) {
+	// milliseconds, like the unit actions
+	coord::phys_t time = lastframe_duration / 1000000;
+	if (time == 0 or this->actions.empty()) {
+		return;
+	}
+
+	this->integrate(time);
+
+	// backwards, so removing a projectile doesn't skip the one
+	// that takes its index
+	for (size_t i = this->actions.size(); i-- > 0;) {
+		ProjectileAction *action = this->actions[i];
+		Unit *unit = action->entity;
+		coord::phys3 position{this->pos_ne[i], this->pos_se[i], this->pos_up[i]};
+
+		TerrainObject *target = this->find_hit(i, position);
+		if (target) {
+			this->remove(i);
+			action->hit(&target->unit);
+			continue;
+		}
+
+		// fails when leaving the terrain
+		if (not unit->location->move(position)) {
+			this->remove(i);
+			action->hit(nullptr);
+			continue;
+		}
+
+		// the direction is used for drawing
+		auto &d_attr = unit->get_attribute<attr_type::direction>();
+		d_attr.unit_dir = coord::phys3_delta{this->vel_ne[i], this->vel_se[i], this->vel_up[i]};
+
+		if (position.up <= 0) {
+			this->remove(i);
+			action->hit(nullptr);
+		}
+	}
+}
+
+
+void ProjectileSystem::integrate(coord::phys_t time) {
+	size_t count = this->actions.size();
+
+	// separate loops over plain arrays without branches,
+	// so each of them can be vectorized
+	coord::phys_t *vel_up = this->vel_up.data();
+	const coord::phys_t *gravity = this->gravity.data();
+	for (size_t i = 0; i < count; i++) {
+		vel_up[i] -= gravity[i] * time;
+	}
+
+	coord::phys_t *pos_ne = this->pos_ne.data();
+	const coord::phys_t *vel_ne = this->vel_ne.data();
+	for (size_t i = 0; i < count; i++) {
+		pos_ne[i] += vel_ne[i] * time;
+	}
+
+	coord::phys_t *pos_se = this->pos_se.data();
+	const coord::phys_t *vel_se = this->vel_se.data();
+	for (size_t i = 0; i < count; i++) {
+		pos_se[i] += vel_se[i] * time;
+	}
+
+	coord::phys_t *pos_up = this->pos_up.data();
+	for (size_t i = 0; i < count; i++) {
+		pos_up[i] += vel_up[i] * time;
+	}
+}
+
+
+TerrainObject *ProjectileSystem::find_hit(size_t index, const coord::phys3 &position) const {
+	if (position.up > flight_ceiling) {
+		return nullptr;
+	}
+
+	Unit *unit = this->actions[index]->entity;
+	TerrainObject *self = unit->location.get();
+	auto terrain = self->get_terrain();
+	if (not terrain) {
+		return nullptr;
+	}
+
+	// projectiles which were not launched by a unit hit nothing
+	auto &pr_attr = unit->get_attribute<attr_type::projectile>();
+	if (not pr_attr.launched or not pr_attr.launcher.is_valid()) {
+		return nullptr;
+	}
+	Unit *launcher = pr_attr.launcher.get();
+
+	return terrain->get_spatial_index().find_nearest(
+		position,
+		self->min_axis() / 2,
+		[self, launcher](const TerrainObject &obj) {
+			return &obj != self and
+			       &obj.unit != launcher and
+			       obj.check_collisions();
+		}
+	);
+}
+
+} // namespace openage
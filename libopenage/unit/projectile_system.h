@@ -0,0 +1,82 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "../coord/phys3.h"
+#include "../util/timing.h"
+
+namespace openage {
+
+class ProjectileAction;
+class TerrainObject;
+
+/**
+ * moves all flying projectiles of a unit container in one pass.
+ *
+ * the flight state is stored in one array per component, so
+ * integrating the flight of all projectiles is a few tight loops the
+ * compiler can vectorize. the hits are then tested against the spatial
+ * index of the terrain, and reported to the action of the projectile.
+ *
+ * projectiles are still units, so they are drawn like all others.
+ */
+class ProjectileSystem {
+public:
+	ProjectileSystem();
+
+	ProjectileSystem(const ProjectileSystem &) = delete;
+	ProjectileSystem &operator =(const ProjectileSystem &) = delete;
+
+	/**
+	 * starts the flight of the projectile unit of the action,
+	 * towards the target position.
+	 *
+	 * the action keeps the index of its projectile, which is
+	 * updated when other projectiles are removed.
+	 */
+	void launch(ProjectileAction *action, coord::phys3 target);
+
+	/**
+	 * stops the flight of a projectile. the last projectile
+	 * takes the index of the removed one.
+	 */
+	void remove(size_t index);
+
+	/**
+	 * the number of flying projectiles.
+	 */
+	size_t size() const;
+
+	/**
+	 * moves all projectiles and tests them for hits.
+	 * called once per tick before the units are updated.
+	 */
+	void update(time_nsec_t lastframe_duration);
+
+private:
+	/**
+	 * applies velocity and gravity to all projectiles.
+	 */
+	void integrate(coord::phys_t time);
+
+	/**
+	 * the object a projectile at the position hits, if any.
+	 */
+	TerrainObject *find_hit(size_t index, const coord::phys3 &position) const;
+
+	std::vector<ProjectileAction *> actions;
+
+	// positions
+	std::vector<coord::phys_t> pos_ne, pos_se, pos_up;
+
+	// velocities, per millisecond
+	std::vector<coord::phys_t> vel_ne, vel_se, vel_up;
+
+	// decrease of the upward velocity per millisecond
+	std::vector<coord::phys_t> gravity;
+};
+
+} // namespace openage
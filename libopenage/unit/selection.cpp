@@ -8,7 +8,11 @@
 #include "../coord/tile3.h"
 #include "../engine.h"
 #include "../log/log.h"
+#include "../shape_batch.h"
+#include "../terrain/spatial_index.h"
 #include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../util/misc.h"
 #include "action.h"
 #include "command.h"
 #include "producer.h"
@@ -17,8 +21,41 @@
 
 namespace openage {
 
+namespace {
+
+/**
+ * the range of spatial index cells a selection box covers. objects are
+ * indexed by their position at the end of the tick and may be drawn a
+ * bit before it, so one more cell is taken around the box.
+ */
+void box_cell_range(coord::camgame p1, coord::camgame p2, coord::tile &min, coord::tile &max) {
+	// the remaining corners
+	coord::camgame p3 = coord::camgame{p1.x, p2.y};
+	coord::camgame p4 = coord::camgame{p2.x, p1.y};
+	coord::camgame pts[4] {p1, p2, p3, p4};
+
+	min = SpatialIndex::cell_of(pts[0].to_phys3());
+	max = min;
+	for (unsigned i = 1; i < 4; ++i) {
+		coord::tile cell = SpatialIndex::cell_of(pts[i].to_phys3());
+		min.ne = std::min(min.ne, cell.ne);
+		min.se = std::min(min.se, cell.se);
+		max.ne = std::max(max.ne, cell.ne);
+		max.se = std::max(max.se, cell.se);
+	}
+
+	min.ne -= 1;
+	min.se -= 1;
+	max.ne += 1;
+	max.se += 1;
+}
+
+} // anonymous namespace
+
+
 UnitSelection::UnitSelection(Engine *engine)
 	:
+	box_terrain{nullptr},
 	selection_type{selection_type_t::nothing},
 	drag_active{false},
 	font_size{12},
@@ -26,25 +63,18 @@ UnitSelection::UnitSelection(Engine *engine)
 }
 
 bool UnitSelection::on_drawhud() {
+	ShapeBatch shapes;
 
 	// the drag selection box
 	if (drag_active) {
 		coord::camhud s = start.to_window().to_camhud();
 		coord::camhud e = end.to_window().to_camhud();
-		glLineWidth(1);
-		glColor3f(1.0, 1.0, 1.0);
-		glBegin(GL_LINE_LOOP); {
-			glVertex3f(s.x, s.y, 0);
-			glVertex3f(e.x, s.y, 0);
-			glVertex3f(e.x, e.y, 0);
-			glVertex3f(s.x, e.y, 0);
-		}
-		glEnd();
+		shapes.rect_outline(s.x, e.y, e.x, s.y, shape_color{1.0, 1.0, 1.0, 1.0});
 	}
 
-	// draw hp bars for each selected unit
-	glLineWidth(3);
-	for (auto u : this->units) {
+	// hp bars for each selected unit, 3 pixels high,
+	// drawn with the drag box in one batch.
+	for (auto &u : this->units) {
 		if (u.second.is_valid()) {
 			Unit *unit_ptr = u.second.get();
 			if (unit_ptr->location && unit_ptr->has_attribute(attr_type::hitpoints)) {
@@ -52,24 +82,17 @@ bool UnitSelection::on_drawhud() {
 				float percent = static_cast<float>(hp.current) / static_cast<float>(hp.max);
 				int mid = percent * 28.0f - 14.0f;
 
-				coord::phys3 &pos_phys3 = unit_ptr->location->pos.draw;
+				coord::phys3 pos_phys3 = unit_ptr->location->get_draw_position();
 				coord::camhud pos = pos_phys3.to_camgame().to_window().to_camhud();
-				glColor3f(0.0, 1.0, 0.0);
-				glBegin(GL_LINES); {
-					glVertex3f(pos.x - 14, pos.y + 60, 0);
-					glVertex3f(pos.x + mid, pos.y + 60, 0);
-				}
-				glEnd();
-				glColor3f(1.0, 0.0, 0.0);
-				glBegin(GL_LINES); {
-					glVertex3f(pos.x + mid, pos.y + 60, 0);
-					glVertex3f(pos.x + 14, pos.y + 60, 0);
-				}
-				glEnd();
+				GLfloat bottom = pos.y + 58.5f;
+				GLfloat top = pos.y + 61.5f;
+				shapes.rect(pos.x - 14, bottom, pos.x + mid, top, shape_color{0.0, 1.0, 0.0, 1.0});
+				shapes.rect(pos.x + mid, bottom, pos.x + 14, top, shape_color{1.0, 0.0, 0.0, 1.0});
 			}
 		}
 	}
-	glColor3f(1.0, 1.0, 1.0); // reset
+
+	shapes.submit();
 
 	// display details of single selected unit
 	if (this->units.size() == 1) {
@@ -89,11 +112,15 @@ void UnitSelection::drag_begin(coord::camgame pos) {
 	this->drag_active = true;
 }
 
-void UnitSelection::drag_update(coord::camgame pos) {
+void UnitSelection::drag_update(coord::camgame pos, Terrain *terrain) {
 	if (!this->drag_active) {
 		this->drag_begin(pos);
 	}
 	this->end = pos;
+
+	if (terrain and not (this->start == this->end)) {
+		this->scan_box(terrain, this->start, this->end);
+	}
 }
 
 void UnitSelection::drag_release(const Player &player, Terrain *terrain, bool append) {
@@ -104,6 +131,10 @@ void UnitSelection::drag_release(const Player &player, Terrain *terrain, bool ap
 		this->select_space(player, terrain, this->start, this->end, append);
 	}
 	this->drag_active = false;
+
+	// only kept while dragging
+	this->box_cells.clear();
+	this->box_terrain = nullptr;
 }
 
 void UnitSelection::clear() {
@@ -245,31 +276,81 @@ void UnitSelection::select_space(const Player &player, Terrain *terrain, coord::
 	max.x = std::max(p1.x, p2.x);
 	max.y = std::max(p1.y, p2.y);
 
-	// look at each tile in the range and find all units
-	for (coord::tile check_pos : tiles_in_range(p1, p2)) {
-		TileContent *tc = terrain->get_data(check_pos);
-		if (tc) {
-			// find objects within selection box
-			for (auto unit_location : tc->obj) {
-				coord::camgame pos = unit_location->pos.draw.to_camgame();
-				if ((min.x < pos.x && pos.x < max.x) &&
-				     (min.y < pos.y && pos.y < max.y)) {
-					this->add_unit(player, &unit_location->unit, append);
-				}
+	if (!terrain) {
+		log::log(MSG(warn) << "selection terrain not specified");
+		return;
+	}
+
+	// the objects of the cells the box covers are current after the scan
+	this->scan_box(terrain, p1, p2);
+
+	// find objects within selection box
+	for (auto &cell : this->box_cells) {
+		for (TerrainObject *unit_location : cell.second.objects) {
+			coord::camgame pos = unit_location->get_draw_position().to_camgame();
+			if ((min.x < pos.x && pos.x < max.x) &&
+			     (min.y < pos.y && pos.y < max.y)) {
+				this->add_unit(player, &unit_location->unit, append);
+			}
+		}
+	}
+}
+
+void UnitSelection::scan_box(Terrain *terrain, coord::camgame p1, coord::camgame p2) {
+	if (terrain != this->box_terrain) {
+		this->box_cells.clear();
+		this->box_terrain = terrain;
+	}
+
+	coord::tile min, max;
+	box_cell_range(p1, p2, min, max);
+
+	// forget the cells the box left
+	for (auto it = std::begin(this->box_cells); it != std::end(this->box_cells);) {
+		const coord::tile &cell = it->first;
+		if (cell.ne < min.ne or cell.ne > max.ne or
+		    cell.se < min.se or cell.se > max.se) {
+			it = this->box_cells.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	// copy the cells that are new or changed,
+	// the pointers of unchanged cells are still valid
+	SpatialIndex &index = terrain->get_spatial_index();
+	for (coord::tile cell{min.ne, min.se}; cell.ne <= max.ne; cell.ne++) {
+		for (cell.se = min.se; cell.se <= max.se; cell.se++) {
+			uint64_t revision = index.get_revision(cell);
+			if (revision == 0) {
+				continue;
+			}
+
+			box_cell &cached = this->box_cells[cell];
+			if (cached.revision != revision) {
+				cached.revision = revision;
+				cached.objects = index.get_objects(cell);
 			}
 		}
 	}
 }
 
 void UnitSelection::all_invoke(Command &cmd) {
+	GroupCommand group{cmd};
 	for (auto u : this->units) {
 		if (u.second.is_valid() && u.second.get()->is_own_unit(cmd.player)) {
-
-			// allow unit to find best use of the command
-			// TODO: queue_cmd returns ability which allows playing of sound
-			u.second.get()->queue_cmd(cmd);
+			group.units.push_back(u.second);
 		}
 	}
+
+	if (group.units.empty()) {
+		return;
+	}
+
+	// allow each unit to find best use of the command
+	// TODO: report the abilities which allows playing of sound
+	group.units.front().get()->get_container()->issue_group_command(group);
 }
 
 void UnitSelection::show_attributes(Unit *u) {
@@ -318,36 +399,4 @@ selection_type_t UnitSelection::get_unit_selection_type(const Player &player, Un
 	}
 }
 
-std::vector<coord::tile> tiles_in_range(coord::camgame p1, coord::camgame p2) {
-	// the remaining corners
-	coord::camgame p3 = coord::camgame{p1.x, p2.y};
-	coord::camgame p4 = coord::camgame{p2.x, p1.y};
-	coord::camgame pts[4] {p1, p2, p3, p4};
-
-	// find the range of tiles covered
-	coord::tile t1 = pts[0].to_phys3().to_tile3().to_tile();
-	coord::tile min = t1;
-	coord::tile max = t1;
-	for (unsigned i = 1; i < 4; ++i) {
-		coord::tile t = pts[i].to_phys3().to_tile3().to_tile();
-		min.ne = std::min(min.ne, t.ne);
-		min.se = std::min(min.se, t.se);
-		max.ne = std::max(max.ne, t.ne);
-		max.se = std::max(max.se, t.se);
-	}
-
-	// find all units in the boxed region
-	std::vector<coord::tile> tiles;
-	coord::tile check_pos = min;
-	while (check_pos.ne <= max.ne) {
-		while (check_pos.se <= max.se) {
-			tiles.push_back(check_pos);
-			check_pos.se += 1;
-		}
-		check_pos.se = min.se;
-		check_pos.ne += 1;
-	}
-	return tiles;
-}
-
 } /* namespace openage */
@@ -1,10 +1,13 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include "../coord/camgame.h"
+#include "../coord/tile.h"
 #include "../handlers.h"
 #include "ability.h"
 #include "unit_container.h"
@@ -13,8 +16,7 @@ namespace openage {
 
 class Engine;
 class Terrain;
-
-std::vector<coord::tile> tiles_in_range(coord::camgame p1, coord::camgame p2);
+class TerrainObject;
 
 /**
  * A selection of units always has a type
@@ -41,7 +43,14 @@ public:
 
 	bool on_drawhud() override;
 	void drag_begin(coord::camgame pos);
-	void drag_update(coord::camgame pos);
+
+	/**
+	 * moves the end of the drag box. with a terrain, the objects that
+	 * may be in the box are collected already, so the release only
+	 * has to look at the cells that changed since.
+	 */
+	void drag_update(coord::camgame pos, Terrain *terrain=nullptr);
+
 	void drag_release(const Player &player, Terrain *terrain, bool append=false);
 
 	void clear();
@@ -99,6 +108,28 @@ private:
 	 */
 	selection_type_t get_unit_selection_type(const Player &player, Unit *);
 
+	/**
+	 * the objects of a cell of the terrain's spatial index,
+	 * as seen by the last scan.
+	 */
+	struct box_cell {
+		uint64_t revision;
+		std::vector<TerrainObject *> objects;
+	};
+
+	/**
+	 * updates box_cells to the cells that the box covers.
+	 * only the cells that are new, or changed since they were
+	 * copied, are copied again.
+	 */
+	void scan_box(Terrain *terrain, coord::camgame p1, coord::camgame p2);
+
+	/**
+	 * the cells copied by scan_box, valid for box_terrain.
+	 */
+	std::unordered_map<coord::tile, box_cell> box_cells;
+	Terrain *box_terrain;
+
 	std::unordered_map<id_t, UnitReference> units;
 	selection_type_t selection_type;
 
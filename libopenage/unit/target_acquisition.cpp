@@ -0,0 +1,129 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "target_acquisition.h"
+
+#include <utility>
+
+#include "../terrain/spatial_index.h"
+#include "../terrain/terrain.h"
+#include "../terrain/terrain_object.h"
+#include "../util/metrics.h"
+#include "action.h"
+#include "command.h"
+#include "unit.h"
+
+namespace openage {
+
+TargetAcquisition::TargetAcquisition()
+	:
+	budget{default_budget},
+	next_number{0} {}
+
+
+void TargetAcquisition::request(const Unit &unit, coord::phys_t radius, predicate_t found,
+                                const ability_set &abilities, const UnitAction *action, bool combat) {
+	uint64_t number = this->next_number++;
+	this->pending[unit.id] = number;
+
+	search_request entry{unit.id, number, radius, std::move(found), abilities, action};
+	if (combat) {
+		this->combat.push_back(std::move(entry));
+	}
+	else {
+		this->others.push_back(std::move(entry));
+	}
+}
+
+
+bool TargetAcquisition::is_pending(const Unit &unit) const {
+	return this->pending.count(unit.id) > 0;
+}
+
+
+void TargetAcquisition::cancel(const Unit &unit) {
+	// the queued entry is skipped when its turn comes
+	this->pending.erase(unit.id);
+}
+
+
+size_t TargetAcquisition::size() const {
+	return this->pending.size();
+}
+
+
+void TargetAcquisition::set_budget(size_t searches) {
+	this->budget = searches;
+}
+
+
+size_t TargetAcquisition::update(UnitContainer &container) {
+	size_t searches = 0;
+
+	for (auto *queue : {&this->combat, &this->others}) {
+		while (searches < this->budget and not queue->empty()) {
+			search_request entry = std::move(queue->front());
+			queue->pop_front();
+
+			// replaced or cancelled requests
+			auto it = this->pending.find(entry.unit);
+			if (it == std::end(this->pending) or it->second != entry.number) {
+				continue;
+			}
+			this->pending.erase(it);
+
+			if (not container.valid_id(entry.unit)) {
+				continue;
+			}
+
+			Unit *unit = container.get_unit(entry.unit).get();
+			if (not unit->location or not unit->has_attribute(attr_type::owner)) {
+				continue;
+			}
+
+			// the unit got busy with something else meanwhile
+			if (entry.action != nullptr and
+			    (not unit->has_action() or unit->top() != entry.action)) {
+				continue;
+			}
+
+			this->search(*unit, entry);
+			searches += 1;
+		}
+	}
+
+	static util::MetricGauge &pending_searches = util::metrics().gauge("units.target_searches_pending");
+	pending_searches.set(this->pending.size());
+
+	return searches;
+}
+
+
+void TargetAcquisition::search(Unit &unit, const search_request &request) const {
+	const Player &player = unit.get_attribute<attr_type::owner>().player;
+	TerrainObject *own = unit.location.get();
+	auto terrain = own->get_terrain();
+	if (not terrain) {
+		return;
+	}
+
+	auto command = [&](const TerrainObject &obj) {
+		Command cmd(player, &obj.unit);
+		cmd.set_ability_set(request.abilities);
+		return cmd;
+	};
+
+	TerrainObject *target = terrain->get_spatial_index().find_nearest(
+		own->pos.draw, request.radius,
+		[&](const TerrainObject &obj) {
+			return &obj != own and
+			       (not request.found or request.found(obj)) and
+			       unit.find_ability(command(obj), ability_priority) != nullptr;
+		}
+	);
+
+	if (target != nullptr) {
+		unit.queue_cmd(command(*target));
+	}
+}
+
+} // namespace openage
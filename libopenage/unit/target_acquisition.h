@@ -0,0 +1,126 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+#include "../coord/phys3.h"
+#include "ability.h"
+#include "unit_container.h"
+
+namespace openage {
+
+class TerrainObject;
+class Unit;
+class UnitAction;
+
+/**
+ * searches the targets units find by themselves, spread over the ticks.
+ *
+ * idle units looking for enemies and units retasking after their target
+ * is gone request a search instead of searching in their update.
+ * each tick at most budget requests are searched, the remaining ones
+ * wait for the next ticks. when a fight ends, the searches of all units
+ * that lost their target are therefore spread over several ticks
+ * instead of making one tick take long.
+ *
+ * requests of units in combat are searched first, the others in the
+ * order they were made. the searches look up the spatial index of the
+ * terrain, and the unit gets a command for the nearest object found.
+ */
+class TargetAcquisition {
+public:
+	using predicate_t = std::function<bool(const TerrainObject &)>;
+
+	/**
+	 * the number of searches per tick if no other budget is set.
+	 */
+	static constexpr size_t default_budget = 32;
+
+	TargetAcquisition();
+
+	TargetAcquisition(const TargetAcquisition &) = delete;
+	TargetAcquisition &operator =(const TargetAcquisition &) = delete;
+
+	/**
+	 * searches a target for the unit in a later update. the unit is then
+	 * commanded to use one of the abilities on the nearest object within
+	 * the radius which fulfills the predicate and which one of them can
+	 * be used on. nothing happens if there is no such object.
+	 *
+	 * a unit has at most one pending request, a new one replaces it.
+	 *
+	 * @param found: an empty predicate accepts all objects
+	 * @param action: if set, the search is dropped when another action
+	 *                of the unit is active by then
+	 * @param combat: the request is searched before the others
+	 */
+	void request(const Unit &unit, coord::phys_t radius, predicate_t found,
+	             const ability_set &abilities, const UnitAction *action, bool combat);
+
+	/**
+	 * whether the unit has a request which wasn't searched yet.
+	 */
+	bool is_pending(const Unit &unit) const;
+
+	/**
+	 * drops the pending request of the unit.
+	 */
+	void cancel(const Unit &unit);
+
+	/**
+	 * the number of pending requests.
+	 */
+	size_t size() const;
+
+	/**
+	 * the number of searches per tick.
+	 */
+	void set_budget(size_t searches);
+
+	/**
+	 * searches the targets of up to budget requests.
+	 * called once per tick before the units are updated.
+	 *
+	 * @returns the number of searches
+	 */
+	size_t update(UnitContainer &container);
+
+private:
+	struct search_request {
+		id_t unit;
+
+		/**
+		 * the number of the request, a request of the unit
+		 * with another number replaced it.
+		 */
+		uint64_t number;
+
+		coord::phys_t radius;
+		predicate_t found;
+		ability_set abilities;
+		const UnitAction *action;
+	};
+
+	/**
+	 * searches the target of a request and commands the unit.
+	 */
+	void search(Unit &unit, const search_request &request) const;
+
+	size_t budget;
+
+	std::deque<search_request> combat;
+	std::deque<search_request> others;
+
+	/**
+	 * the number of the pending request of each unit.
+	 */
+	std::unordered_map<id_t, uint64_t> pending;
+	uint64_t next_number;
+};
+
+} // namespace openage
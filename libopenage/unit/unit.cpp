@@ -1,4 +1,4 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #include <algorithm>
 #include <cmath>
@@ -9,6 +9,7 @@
 
 #include "ability.h"
 #include "action.h"
+#include "action_cost.h"
 #include "command.h"
 #include "producer.h"
 #include "unit.h"
@@ -21,8 +22,11 @@ Unit::Unit(UnitContainer *c, id_t id)
 	id{id},
 	unit_type{nullptr},
 	selected{false},
+	asleep{false},
 	pop_destructables{false},
-	container(c) {
+	planned_action{nullptr},
+	container(c),
+	attribute_slot{c->get_attribute_storage().acquire(this)} {
 
 }
 
@@ -32,12 +36,16 @@ Unit::~Unit() {
 	if (this->location) {
 		this->location->remove();
 	}
+
+	this->container->get_attribute_storage().release(this->attribute_slot);
 }
 
 void Unit::reset() {
-	this->ability_available.clear();
+	this->ability_available.fill(nullptr);
+	this->ability_mask.reset();
 	this->action_stack.clear();
 	this->pop_destructables = false;
+	this->planned_action = nullptr;
 }
 
 bool Unit::has_action() const {
@@ -74,6 +82,23 @@ UnitAction *Unit::before(const UnitAction *action) const {
 	return nullptr;
 }
 
+void Unit::plan(time_nsec_t lastframe_duration) {
+	this->planned_action = nullptr;
+
+	// the update of units which are not on the map does nothing
+	if (!this->location || !this->has_action()) {
+		return;
+	}
+
+	// same time value as in the update
+	auto time_elapsed = lastframe_duration / 1e6;
+
+	this->planned_action = this->top();
+
+	ActionCostScope cost{typeid(*this->planned_action)};
+	this->planned_action->plan(time_elapsed);
+}
+
 bool Unit::update(time_nsec_t lastframe_duration) {
 
 	// if unit is not on the map then do nothing
@@ -98,7 +123,17 @@ bool Unit::update(time_nsec_t lastframe_duration) {
 		// time as float, in milliseconds.
 		auto time_elapsed = lastframe_duration / 1e6;
 
-		this->top()->update(time_elapsed);
+		UnitAction *action = this->top();
+		{
+			ActionCostScope cost{typeid(*action)};
+
+			// the stack has changed since planning
+			if (action != this->planned_action) {
+				action->plan(time_elapsed);
+			}
+			action->update(time_elapsed);
+		}
+		this->planned_action = nullptr;
 
 		// the top primary action specifies whether
 		// secondary actions are updated
@@ -120,13 +155,37 @@ bool Unit::update(time_nsec_t lastframe_duration) {
 	return true;
 }
 
+unsigned int Unit::sleep_time() const {
+	// units off the map may be placed by others at any time, and
+	// removals, secondary actions and commands are handled by updates
+	if (!this->location ||
+	    !this->has_action() ||
+	    this->pop_destructables ||
+	    !this->action_secondary.empty() ||
+	    !this->command_queue.empty()) {
+		return 0;
+	}
+	return this->top()->sleep_time();
+}
+
+void Unit::wake() {
+	// only the first wake after falling asleep is sent to the container
+	if (this->asleep.load(std::memory_order_relaxed) &&
+	    this->asleep.exchange(false)) {
+		this->container->request_wake(this->id);
+	}
+}
+
 void Unit::update_secondary(int64_t time_elapsed) {
 	// update secondary actions and remove when completed
 	auto position_it = std::remove_if(
 		std::begin(this->action_secondary),
 		std::end(this->action_secondary),
 		[time_elapsed](std::unique_ptr<UnitAction> &action) {
-			action->update(time_elapsed);
+			{
+				ActionCostScope cost{typeid(*action)};
+				action->update(time_elapsed);
+			}
 			return action->completed();
 		});
 	this->action_secondary.erase(position_it, std::end(this->action_secondary));
@@ -134,12 +193,9 @@ void Unit::update_secondary(int64_t time_elapsed) {
 
 
 void Unit::apply_all_cmds() {
-	std::lock_guard<std::mutex> lock(this->command_queue_lock);
-	while (!this->command_queue.empty()) {
-		auto &action = this->command_queue.front();
-		this->apply_cmd(action.first, action.second);
-		this->command_queue.pop();
-	}
+	this->command_queue.drain([this](std::pair<std::shared_ptr<UnitAbility>, Command> &&cmd) {
+		this->apply_cmd(cmd.first, cmd.second);
+	});
 }
 
 
@@ -150,6 +206,7 @@ void Unit::apply_cmd(std::shared_ptr<UnitAbility> ability, const Command &cmd) {
 		// drop other actions if a new action is found
 		this->stop_actions();
 	}
+	ActionCostScope cost{typeid(*ability)};
 	ability->invoke(*this, cmd, is_direct);
 }
 
@@ -179,7 +236,7 @@ void Unit::draw(TerrainObject *loc, const graphic_set &grpc) {
 
 	// frame specified by the current action
 	auto draw_frame = top_action->current_frame();
-	this->draw(loc->pos.draw, draw_texture, draw_frame);
+	this->draw(loc->get_draw_camgame(), draw_texture, draw_frame);
 
 	// draw a shadow if the graphic is available
 	if (grpc.count(graphic_type::shadow) > 0) {
@@ -187,10 +244,7 @@ void Unit::draw(TerrainObject *loc, const graphic_set &grpc) {
 		if (draw_shadow) {
 
 			// position without height component
-			// TODO: terrain elevation
-			coord::phys3 shadow_pos = loc->pos.draw;
-			shadow_pos.up = 0;
-			this->draw(shadow_pos, draw_shadow, draw_frame);
+			this->draw(loc->get_ground_camgame(), draw_shadow, draw_frame);
 		}
 	}
 
@@ -198,7 +252,7 @@ void Unit::draw(TerrainObject *loc, const graphic_set &grpc) {
 	top_action->draw_debug();
 }
 
-void Unit::draw(coord::phys3 draw_pos, std::shared_ptr<UnitTexture> graphic, unsigned int frame) {
+void Unit::draw(coord::camgame draw_pos, std::shared_ptr<UnitTexture> graphic, unsigned int frame) {
 
 	// players color if available
 	unsigned color = 0;
@@ -213,28 +267,35 @@ void Unit::draw(coord::phys3 draw_pos, std::shared_ptr<UnitTexture> graphic, uns
 		// directional textures
 		auto &d_attr = this->get_attribute<attr_type::direction>();
 		coord::phys3_delta draw_dir = d_attr.unit_dir;
-		graphic->draw(draw_pos.to_camgame(), draw_dir, frame, color);
+		graphic->draw(draw_pos, draw_dir, frame, color);
 	}
 	else {
-		graphic->draw(draw_pos.to_camgame(), frame, color);
+		graphic->draw(draw_pos, frame, color);
 	}
 }
 
 void Unit::give_ability(std::shared_ptr<UnitAbility> ability) {
-	this->ability_available.emplace(std::make_pair(ability->type(), ability));
+	// the first ability of a type is kept
+	int index = static_cast<int>(ability->type());
+	if (not this->ability_mask[index]) {
+		this->ability_available[index] = std::move(ability);
+		this->ability_mask.set(index);
+	}
 }
 
 UnitAbility *Unit::get_ability(ability_type type) {
-	if (this->ability_available.count(type) > 0) {
-		return this->ability_available[type].get();
-	}
-	return nullptr;
+	return this->ability_available[static_cast<int>(type)].get();
+}
+
+const ability_set &Unit::get_ability_set() const {
+	return this->ability_mask;
 }
 
 void Unit::push_action(std::unique_ptr<UnitAction> action, bool force) {
 	// unit not being deleted -- can control unit
 	if (force || this->accept_commands()) {
 	    this->action_stack.push_back(std::move(action));
+	    this->wake();
 	}
 }
 
@@ -243,24 +304,59 @@ void Unit::secondary_action(std::unique_ptr<UnitAction> action) {
 }
 
 void Unit::add_attribute(std::shared_ptr<AttributeContainer> attr) {
+	// frequently used attributes are copied into the columns
+	if (this->container->get_attribute_storage().add(this->attribute_slot, *attr)) {
+		return;
+	}
 	this->attribute_map.emplace(attr_map_t::value_type(attr->type, attr));
 }
 
+void Unit::copy_attribute(const AttributeContainer &attr) {
+	if (this->container->get_attribute_storage().add(this->attribute_slot, attr)) {
+		return;
+	}
+	this->attribute_map.emplace(attr_map_t::value_type(attr.type, attr.copy()));
+}
+
+void Unit::set_hitpoints(unsigned int value) {
+	this->container->get_attribute_storage().set_hitpoints(this->attribute_slot, value);
+}
+
 bool Unit::has_attribute(attr_type type) const {
+	if (is_column_attribute(type)) {
+		return this->container->get_attribute_storage().has(this->attribute_slot, type);
+	}
 	return (this->attribute_map.count(type) > 0);
 }
 
 std::shared_ptr<UnitAbility> Unit::queue_cmd(const Command &cmd) {
-	std::lock_guard<std::mutex> lock(this->command_queue_lock);
-
 	// following the specified ability priority
 	// find suitable ability for this target if available
-	for (auto &ability : ability_priority) {
-		auto pair = this->ability_available.find(ability);
-		if (pair != this->ability_available.end() &&
-		    cmd.ability()[static_cast<int>(pair->first)] && pair->second->can_invoke(*this, cmd)) {
-			command_queue.push(std::make_pair(pair->second, cmd));
-			return pair->second;
+	auto ability = this->find_ability(cmd, ability_priority);
+	if (ability) {
+		this->queue_cmd(ability, cmd);
+	}
+	return ability;
+}
+
+void Unit::queue_cmd(const std::shared_ptr<UnitAbility> &ability, const Command &cmd) {
+	this->command_queue.push(std::make_pair(ability, cmd));
+
+	// after the push, see UnitContainer::update_all
+	this->wake();
+}
+
+std::shared_ptr<UnitAbility> Unit::find_ability(const Command &cmd, const std::vector<ability_type> &types) {
+	ability_set usable = cmd.ability() & this->ability_mask;
+	if (usable.none()) {
+		return nullptr;
+	}
+
+	for (auto &type : types) {
+		int index = static_cast<int>(type);
+		if (usable[index] and
+		    this->ability_available[index]->can_invoke(*this, cmd)) {
+			return this->ability_available[index];
 		}
 	}
 	return nullptr;
@@ -268,6 +364,7 @@ std::shared_ptr<UnitAbility> Unit::queue_cmd(const Command &cmd) {
 
 void Unit::delete_unit() {
 	this->pop_destructables = true;
+	this->wake();
 }
 
 void Unit::stop_gather() {
@@ -2,19 +2,22 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
-#include <mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
-#include <queue>
+#include <type_traits>
 
 #include "../coord/phys3.h"
+#include "../datastructure/lockfree_queue.h"
 #include "../handlers.h"
 #include "../log/logsource.h"
 #include "../terrain/terrain_object.h"
 #include "../util/timing.h"
 #include "ability.h"
 #include "attribute.h"
+#include "attribute_storage.h"
 #include "command.h"
 #include "unit_container.h"
 
@@ -119,11 +122,35 @@ public:
 	 */
 	UnitAction *before(const UnitAction *action) const;
 
+	/**
+	 * prepare the next update of the action on top of the stack,
+	 * see UnitAction::plan. can run concurrently for different units.
+	 */
+	void plan(time_nsec_t lastframe_duration);
+
 	/**
 	 * update this object using the action currently on top of the stack
 	 */
 	bool update(time_nsec_t lastframe_duration);
 
+	/**
+	 * the game time in milliseconds this unit may sleep after its update,
+	 * see UnitAction::sleep_time.
+	 */
+	unsigned int sleep_time() const;
+
+	/**
+	 * makes the container update a sleeping unit again in the next tick.
+	 * called by anything that changes the unit from outside, like
+	 * commands and damage. can be called from any thread.
+	 */
+	void wake();
+
+	/**
+	 * set by the container while the unit sleeps.
+	 */
+	std::atomic<bool> asleep;
+
 	/**
 	 * draws this action by taking the graphic type of the top action
 	 * the graphic is found from the current graphic set
@@ -140,7 +167,7 @@ public:
 	/**
 	 * draws with a specific graphic and frame
 	 */
-	void draw(coord::phys3 draw_pos, std::shared_ptr<UnitTexture> graphic, unsigned int frame);
+	void draw(coord::camgame draw_pos, std::shared_ptr<UnitTexture> graphic, unsigned int frame);
 
 	/**
 	 * adds an available ability to this unit
@@ -156,6 +183,11 @@ public:
 	 */
 	UnitAbility *get_ability(ability_type type);
 
+	/**
+	 * the types of the abilities this unit has
+	 */
+	const ability_set &get_ability_set() const;
+
 	/**
 	 * adds a new action on top of the action stack
 	 * will be performed immediately
@@ -170,9 +202,18 @@ public:
 	/**
 	 * give a new attribute this this unit
 	 * this is used to set things like color, hitpoints and speed
+	 *
+	 * the unit keeps the given attribute unless it's stored in a column,
+	 * shared attributes of the unit type are referenced this way.
 	 */
 	void add_attribute(std::shared_ptr<AttributeContainer> attr);
 
+	/**
+	 * give a copy of the attribute to this unit.
+	 * column attributes are copied in place without allocating.
+	 */
+	void copy_attribute(const AttributeContainer &attr);
+
 	/**
 	 * returns whether attribute is available
 	 */
@@ -180,12 +221,19 @@ public:
 
 	/**
 	 * returns attribute based on templated value
+	 * the frequently used ones are read from the container's columns.
 	 */
 	template<attr_type T>
 	Attribute<T> &get_attribute() {
-		return *reinterpret_cast<Attribute<T> *>(attribute_map[T].get());
+		return this->get_attribute<T>(std::integral_constant<bool, is_column_attribute(T)>{});
 	}
 
+	/**
+	 * changes the current hitpoints, the unit must have them.
+	 * they are part of the state hash, so only change them this way.
+	 */
+	void set_hitpoints(unsigned int value);
+
 	/**
 	 * queues a command to be applied to this unit on the next update
 	 *
@@ -194,6 +242,18 @@ public:
 	 */
 	std::shared_ptr<UnitAbility> queue_cmd(const Command &cmd);
 
+	/**
+	 * queues a command to be applied by an ability of this unit,
+	 * which was found with find_ability.
+	 */
+	void queue_cmd(const std::shared_ptr<UnitAbility> &ability, const Command &cmd);
+
+	/**
+	 * the ability of the first type in the list which the command allows,
+	 * the unit has and which can invoke the command, or nullptr.
+	 */
+	std::shared_ptr<UnitAbility> find_ability(const Command &cmd, const std::vector<ability_type> &types);
+
 	/**
 	 * removes all gather actions without calling their on_complete actions
 	 * this cancels the gathering action completely
@@ -236,7 +296,13 @@ private:
 	 * ability available -- actions that this entity
 	 * can perform when controlled
 	 */
-	std::unordered_map<ability_type, std::shared_ptr<UnitAbility>> ability_available;
+	ability_table ability_available;
+
+	/**
+	 * bit of each ability in ability_available,
+	 * to skip the types a command allows but the unit doesn't have
+	 */
+	ability_set ability_mask;
 
 
 	/**
@@ -252,14 +318,10 @@ private:
 
 
 	/**
-	 * queue commands to be applied on the next update
+	 * queue commands to be applied on the next update,
+	 * any thread may push to it without locking
 	 */
-	std::queue<std::pair<std::shared_ptr<UnitAbility>, const Command>> command_queue;
-
-	/**
-	 * mutex controlling updates to the command queue
-	 */
-	std::mutex command_queue_lock;
+	datastructure::MPSCQueue<std::pair<std::shared_ptr<UnitAbility>, Command>> command_queue;
 
 
 	/**
@@ -275,11 +337,22 @@ private:
 	 */
 	bool pop_destructables;
 
+	/**
+	 * the action which was on top of the stack when planning,
+	 * a different top action has to be planned before its update
+	 */
+	UnitAction *planned_action;
+
 	/**
 	 * the container that updates this unit
 	 */
 	UnitContainer *container;
 
+	/**
+	 * index of this unit in the attribute columns of the container
+	 */
+	size_t attribute_slot;
+
 	/**
 	 * applies new commands as part of the units update process
 	 */
@@ -287,7 +360,6 @@ private:
 
 	/**
 	 * applies one command using a chosen ability
-	 * locks the command queue mutex while operating
 	 */
 	void apply_cmd(std::shared_ptr<UnitAbility> ability, const Command &cmd);
 
@@ -305,6 +377,22 @@ private:
 	 */
 	void erase_after(std::function<bool(std::unique_ptr<UnitAction> &)> func, bool run_completed=true);
 
+	/**
+	 * attribute stored in a column of the container
+	 */
+	template<attr_type T>
+	Attribute<T> &get_attribute(std::true_type) {
+		return this->container->get_attribute_storage().column<T>().get(this->attribute_slot);
+	}
+
+	/**
+	 * attribute stored in the attribute map
+	 */
+	template<attr_type T>
+	Attribute<T> &get_attribute(std::false_type) {
+		return *reinterpret_cast<Attribute<T> *>(attribute_map[T].get());
+	}
+
 };
 
 } // namespace openage
@@ -2,40 +2,159 @@
 
 #include "unit_container.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
 #include <memory>
-
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "../job/job_manager.h"
 #include "../log/log.h"
+#include "../pathfinding/flow_field.h"
+#include "../pathfinding/path.h"
 #include "../terrain/terrain_object.h"
+#include "../util/metrics.h"
+#include "ability.h"
+#include "action.h"
+#include "attribute_storage.h"
+#include "command.h"
 #include "producer.h"
+#include "target_acquisition.h"
 #include "unit.h"
 
 
 namespace openage {
 
-reference_data::reference_data(const UnitContainer *c, id_t id, Unit *u)
-	:
-	container{c},
-	unit_id{id},
-	unit_ptr{u} {
-	if (!u) {
-		throw Error{MSG(err) << "Cannot reference null unit pointer"};
+namespace {
+
+/**
+ * number of units one job plans at once
+ */
+constexpr size_t plan_batch_size = 64;
+
+/**
+ * progress of planning the units of one update,
+ * shared with the jobs which may outlive the update
+ */
+struct plan_state {
+	std::vector<Unit *> *units;
+	std::vector<time_nsec_t> *durations;
+	size_t batch_count;
+
+	std::atomic<size_t> next_batch;
+	std::atomic<size_t> finished_batches;
+
+	// first exception thrown while planning
+	std::mutex error_mutex;
+	std::exception_ptr error;
+};
+
+/**
+ * plans batches of units until all are taken
+ */
+void plan_batches(plan_state &state) {
+	while (true) {
+		size_t batch = state.next_batch++;
+		if (batch >= state.batch_count) {
+			return;
+		}
+
+		size_t begin = batch * plan_batch_size;
+		size_t end = std::min(begin + plan_batch_size, state.units->size());
+		try {
+			for (size_t i = begin; i < end; i++) {
+				(*state.units)[i]->plan((*state.durations)[i]);
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock{state.error_mutex};
+			if (!state.error) {
+				state.error = std::current_exception();
+			}
+		}
+		state.finished_batches++;
 	}
 }
 
+/**
+ * number of units in one block of the storage
+ */
+constexpr size_t units_per_block = 64;
+
+
+/**
+ * places for the units of a small group around a target,
+ * in rows along the south east axis. the units are put into
+ * the rows and columns in the order they are in now, so they
+ * keep their layout and don't cross each other's paths.
+ */
+std::vector<coord::phys3> formation_targets(coord::phys3 target, std::vector<Unit *> &units) {
+	coord::phys_t spacing = 0;
+	for (Unit *unit : units) {
+		spacing = std::max(spacing, unit->location->min_axis());
+	}
+	spacing += path::path_grid_size;
+
+	size_t columns = static_cast<size_t>(std::ceil(std::sqrt(units.size())));
+	size_t rows = (units.size() + columns - 1) / columns;
+
+	std::sort(std::begin(units), std::end(units), [](Unit *a, Unit *b) {
+		return a->location->pos.draw.se < b->location->pos.draw.se;
+	});
+	for (size_t row = 0; row < rows; row++) {
+		auto begin = std::begin(units) + row * columns;
+		auto end = std::begin(units) + std::min((row + 1) * columns, units.size());
+		std::sort(begin, end, [](Unit *a, Unit *b) {
+			return a->location->pos.draw.ne < b->location->pos.draw.ne;
+		});
+	}
+
+	std::vector<coord::phys3> targets;
+	targets.reserve(units.size());
+	for (size_t i = 0; i < units.size(); i++) {
+		// offsets from the center of the grid, in half places
+		coord::phys_t ne = 2 * static_cast<coord::phys_t>(i % columns) - (columns - 1);
+		coord::phys_t se = 2 * static_cast<coord::phys_t>(i / columns) - (rows - 1);
+
+		targets.push_back(target + coord::phys3_delta{ne * spacing / 2, se * spacing / 2, 0});
+	}
+	return targets;
+}
+
+} // anonymous namespace
+
+
+struct UnitContainer::unit_block {
+	typename std::aligned_storage<sizeof(Unit), alignof(Unit)>::type cells[units_per_block];
+};
 
 UnitReference::UnitReference()
 	:
-	data{nullptr} {}
+	container{nullptr},
+	unit_id{0},
+	unit_ptr{nullptr} {}
 
 
 UnitReference::UnitReference(const UnitContainer *c, id_t id, Unit *u)
 	:
-	data{std::make_shared<reference_data>(c, id, u)} {}
+	container{c},
+	unit_id{id},
+	unit_ptr{u} {
+	if (!u) {
+		throw Error{MSG(err) << "Cannot reference null unit pointer"};
+	}
+}
 
 
 bool UnitReference::is_valid() const {
-	return this->data &&
-	       this->data->container->valid_id(this->data->unit_id);
+	return this->container &&
+	       this->container->valid_id(this->unit_id);
 }
 
 
@@ -43,27 +162,43 @@ Unit *UnitReference::get() const {
 	if (!this->is_valid()) {
 		throw Error{MSG(err) << "Unit reference is no longer valid"};
 	}
-	return this->data->unit_ptr;
+	return this->unit_ptr;
 }
 
 
 UnitContainer::UnitContainer()
 	:
-	next_new_id{1} {}
+	attribute_storage{std::make_unique<AttributeStorage>(&this->state_hash)},
+	acquisition{std::make_unique<TargetAcquisition>()},
+	job_manager{nullptr},
+	game_time{0} {}
 
 
 UnitContainer::~UnitContainer() {
 	log::log(MSG(warn) << "Cleanup container");
+
+	// the blocks only hold memory, the units are destroyed here
+	// while the attribute storage still exists
+	this->reset();
 }
 
 void UnitContainer::reset() {
-	this->live_units.clear();
+	// the slots stay, so references to the removed units stay invalid
+	for (uint32_t slot = 0; slot < this->handles.size(); slot++) {
+		if (this->handles[slot].used) {
+			this->remove(static_cast<Unit *>(this->cell(slot)));
+		}
+	}
 }
 
 void UnitContainer::set_terrain(std::shared_ptr<Terrain> &t) {
 	this->terrain = t;
 }
 
+void UnitContainer::set_job_manager(job::JobManager *job_manager) {
+	this->job_manager = job_manager;
+}
+
 std::shared_ptr<Terrain> UnitContainer::get_terrain() const {
 	if (this->terrain.expired()) {
 		throw Error{MSG(err) << "Terrain has expired"};
@@ -73,65 +208,137 @@ std::shared_ptr<Terrain> UnitContainer::get_terrain() const {
 
 
 bool UnitContainer::valid_id(id_t id) const {
-	return (this->live_units.count(id) > 0);
+	uint32_t slot = static_cast<uint32_t>(id);
+	uint32_t generation = static_cast<uint32_t>(id >> 32);
+
+	return (slot < this->handles.size() and
+	        this->handles[slot].generation == generation and
+	        this->handles[slot].used);
 }
 
 
 UnitReference UnitContainer::get_unit(id_t id) {
 	if (this->valid_id(id)) {
-		return UnitReference(this, id, this->live_units[id].get());
+		Unit *unit = static_cast<Unit *>(this->cell(static_cast<uint32_t>(id)));
+		return UnitReference(this, id, unit);
 	}
 	else {
-		return UnitReference(this, id, nullptr);
+		return UnitReference(); // is not valid
 	}
 }
 
 UnitReference UnitContainer::new_unit() {
-	auto id = next_new_id;
-	next_new_id += 1;
-
-	this->live_units.emplace(id, std::make_unique<Unit>(this, id));
-	return this->live_units[id]->get_ref();
+	return this->create()->get_ref();
 }
 
 UnitReference UnitContainer::new_unit(UnitType &type,
                                       Player &owner,
                                       coord::phys3 position) {
 
-	auto new_id = next_new_id;
-	next_new_id += 1;
-
-	auto newobj = std::make_unique<Unit>(this, new_id);
+	Unit *newobj = this->create();
 
-	// try placing unit at this location
-	auto terrain_shared = this->get_terrain();
-	auto placed = type.place(newobj.get(), terrain_shared, position);
-	if (placed) {
-		type.initialise(newobj.get(), owner);
-		auto id = newobj->id;
-		this->live_units.emplace(id, std::move(newobj));
-		return this->live_units[id]->get_ref();
+	try {
+		// try placing unit at this location
+		auto terrain_shared = this->get_terrain();
+		auto placed = type.place(newobj, terrain_shared, position);
+		if (placed) {
+			type.initialise(newobj, owner);
+			placed->update_sight();
+			return newobj->get_ref();
+		}
+	}
+	catch (...) {
+		this->remove(newobj);
+		throw;
 	}
+
+	this->remove(newobj);
 	return UnitReference(); // is not valid
 }
 
 UnitReference UnitContainer::new_unit(UnitType &type,
                                       Player &owner,
                                       TerrainObject *other) {
-	auto new_id = next_new_id;
-	next_new_id += 1;
+	Unit *newobj = this->create();
+
+	try {
+		// try placing unit
+		TerrainObject *placed = type.place_beside(newobj, other);
+		if (placed) {
+			type.initialise(newobj, owner);
+			placed->update_sight();
+			return newobj->get_ref();
+		}
+	}
+	catch (...) {
+		this->remove(newobj);
+		throw;
+	}
+
+	this->remove(newobj);
+	return UnitReference(); // is not valid
+}
 
-	auto newobj = std::make_unique<Unit>(this, new_id);
 
-	// try placing unit
-	TerrainObject *placed = type.place_beside(newobj.get(), other);
-	if (placed) {
-		type.initialise(newobj.get(), owner);
-		auto id = newobj->id;
-		this->live_units.emplace(id, std::move(newobj));
-		return this->live_units[id]->get_ref();
+id_t UnitContainer::reserve_id() {
+	uint32_t slot;
+	if (not this->free_slots.empty()) {
+		slot = this->free_slots.back();
+		this->free_slots.pop_back();
 	}
-	return UnitReference(); // is not valid
+	else {
+		ENSURE(this->handles.size() < UINT32_MAX, "too many unit slots");
+		slot = static_cast<uint32_t>(this->handles.size());
+
+		// generation 0 is never used, so id 0 is never valid
+		this->handles.push_back(unit_slot{1, false, false, 0, 0});
+		if (slot / units_per_block >= this->blocks.size()) {
+			this->blocks.push_back(std::make_unique<unit_block>());
+		}
+	}
+
+	unit_slot &entry = this->handles[slot];
+	entry.used = true;
+	entry.sleeping = false;
+	entry.wake_time = 0;
+	entry.last_update = this->game_time;
+	return (static_cast<id_t>(this->handles[slot].generation) << 32) | slot;
+}
+
+
+void UnitContainer::release_id(id_t id) {
+	unit_slot &entry = this->handles[static_cast<uint32_t>(id)];
+
+	entry.used = false;
+	entry.generation += 1;
+	if (entry.generation == 0) {
+		entry.generation = 1;
+	}
+	this->free_slots.push_back(static_cast<uint32_t>(id));
+}
+
+
+void *UnitContainer::cell(uint32_t slot) const {
+	return &this->blocks[slot / units_per_block]->cells[slot % units_per_block];
+}
+
+
+Unit *UnitContainer::create() {
+	id_t id = this->reserve_id();
+	try {
+		return new (this->cell(static_cast<uint32_t>(id))) Unit(this, id);
+	}
+	catch (...) {
+		this->release_id(id);
+		throw;
+	}
+}
+
+
+void UnitContainer::remove(Unit *unit) {
+	id_t id = unit->id;
+	unit->~Unit();
+	this->release_id(id);
 }
 
 
@@ -139,33 +346,252 @@ bool dispatch_command(id_t, const Command &) {
 	return true;
 }
 
+size_t UnitContainer::dispatch_group_command(const GroupCommand &group) {
+	const Command &cmd = group.command;
+
+	std::vector<std::pair<Unit *, std::shared_ptr<UnitAbility>>> accepted;
+	std::vector<Unit *> movers;
+
+	for (auto &ref : group.units) {
+		if (not ref.is_valid()) {
+			continue;
+		}
+		Unit *unit = ref.get();
+
+		// the ability masks of the unit and the command skip
+		// the types which can't take it, without lookups
+		auto ability = unit->find_ability(cmd, ability_priority);
+		if (not ability) {
+			continue;
+		}
+
+		accepted.emplace_back(unit, ability);
+		if (ability->type() == ability_type::move and not cmd.has_unit()) {
+			movers.push_back(unit);
+		}
+	}
+
+	Command group_cmd = cmd;
+	std::unordered_map<Unit *, coord::phys3> targets;
+
+	if (movers.size() >= path::flow_field_group_size) {
+		// large groups share a flow field instead of searching paths
+		group_cmd.add_flag(command_flag::group_move);
+	}
+	else if (movers.size() > 1) {
+		std::vector<coord::phys3> places = formation_targets(cmd.position(), movers);
+		for (size_t i = 0; i < movers.size(); i++) {
+			targets.emplace(movers[i], places[i]);
+		}
+	}
+
+	for (auto &entry : accepted) {
+		auto target = targets.find(entry.first);
+		if (target == std::end(targets)) {
+			entry.first->queue_cmd(entry.second, group_cmd);
+		}
+		else {
+			Command unit_cmd = group_cmd;
+			unit_cmd.set_position(target->second);
+			entry.first->queue_cmd(entry.second, unit_cmd);
+		}
+	}
+
+	return accepted.size();
+}
+
+void UnitContainer::set_command_stream(std::function<void(const GroupCommand &)> stream) {
+	this->command_stream = std::move(stream);
+}
+
+void UnitContainer::issue_group_command(const GroupCommand &group) {
+	if (this->command_stream) {
+		this->command_stream(group);
+	}
+	else {
+		this->dispatch_group_command(group);
+	}
+}
+
 bool UnitContainer::update_all(time_nsec_t lastframe_duration) {
-	// update everything and find objects with no actions
-	std::vector<id_t> to_remove;
+	this->game_time += lastframe_duration;
+
+	this->wake_units();
+
+	// projectiles move before the units see their hits
+	this->projectiles.update(lastframe_duration);
+
+	// the actions only set the rates, sleeping units animate as well
+	this->animations.update(lastframe_duration);
 
-	for (auto &obj : this->live_units) {
-		obj.second->update(lastframe_duration);
+	// the targets found are commanded before the updates
+	this->acquisition->update(*this);
 
-		if (not obj.second->has_action()) {
-			to_remove.push_back(obj.first);
+	// units created during the update are updated in the next tick
+	this->update_order.clear();
+	this->update_durations.clear();
+	// in slot order, which is the order in memory
+	for (uint32_t slot = 0; slot < this->handles.size(); slot++) {
+		unit_slot &entry = this->handles[slot];
+		if (entry.used and not entry.sleeping) {
+			this->update_order.push_back(static_cast<Unit *>(this->cell(slot)));
+			this->update_durations.push_back(this->game_time - entry.last_update);
+			entry.last_update = this->game_time;
 		}
 	}
 
-	// cleanup and removal of objects
-	for (auto &obj : to_remove) {
+	static util::MetricGauge &awake_units = util::metrics().gauge("units.awake");
+	awake_units.set(this->update_order.size());
+
+	// read phase: plan the updates in parallel
+	this->plan_all();
+
+	// commit phase: update everything in order and find objects with no actions
+	std::vector<Unit *> to_remove;
+
+	for (size_t i = 0; i < this->update_order.size(); i++) {
+		Unit *unit = this->update_order[i];
+		unit->update(this->update_durations[i]);
 
-		// unique pointer triggers cleanup
-		this->live_units.erase(obj);
+		if (not unit->has_action()) {
+			to_remove.push_back(unit);
+		}
+		else {
+			this->try_sleep(unit, static_cast<uint32_t>(unit->id));
+		}
+	}
+
+	// cleanup and removal of objects
+	for (auto unit : to_remove) {
+		this->remove(unit);
 	}
 	return true;
 }
 
+void UnitContainer::request_wake(id_t id) {
+	this->wake_requests.push(id);
+}
+
+void UnitContainer::wake_units() {
+	// ids may be of removed units, or units woken before
+	this->wake_requests.drain([this](id_t id) {
+		if (this->valid_id(id)) {
+			this->handles[static_cast<uint32_t>(id)].sleeping = false;
+		}
+	});
+
+	this->wake_timers.advance(this->game_time / 1000000, [this](uint64_t wake_time, id_t &&id) {
+		if (not this->valid_id(id)) {
+			return;
+		}
+
+		unit_slot &entry = this->handles[static_cast<uint32_t>(id)];
+		if (entry.sleeping and entry.wake_time == wake_time) {
+			static_cast<Unit *>(this->cell(static_cast<uint32_t>(id)))->asleep = false;
+			entry.sleeping = false;
+		}
+	});
+}
+
+void UnitContainer::try_sleep(Unit *unit, uint32_t slot) {
+	unsigned int duration = unit->sleep_time();
+	if (duration == 0) {
+		return;
+	}
+
+	// a command queued from another thread either sees the flag and
+	// requests a wake, or it is seen in the queue here
+	unit->asleep = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (unit->sleep_time() == 0) {
+		unit->asleep = false;
+		return;
+	}
+
+	unit_slot &entry = this->handles[slot];
+	entry.sleeping = true;
+	if (duration == UnitAction::sleep_forever) {
+		entry.wake_time = 0;
+	}
+	else {
+		// the first tick at least the duration after this one
+		entry.wake_time = (this->game_time + 999999) / 1000000 + duration;
+		this->wake_timers.schedule(entry.wake_time, unit->id);
+	}
+}
+
+void UnitContainer::plan_all() {
+	size_t batch_count = (this->update_order.size() + plan_batch_size - 1) / plan_batch_size;
+
+	if (this->job_manager == nullptr or batch_count < 2) {
+		for (size_t i = 0; i < this->update_order.size(); i++) {
+			this->update_order[i]->plan(this->update_durations[i]);
+		}
+		return;
+	}
+
+	auto state = std::make_shared<plan_state>();
+	state->units = &this->update_order;
+	state->durations = &this->update_durations;
+	state->batch_count = batch_count;
+	state->next_batch = 0;
+	state->finished_batches = 0;
+
+	// jobs which start after all batches were taken return immediately
+	size_t helpers = std::min(batch_count - 1,
+	                          static_cast<size_t>(this->job_manager->get_number_of_workers()));
+	for (size_t i = 0; i < helpers; i++) {
+		this->job_manager->enqueue<int>(
+			[state]() -> int {
+				plan_batches(*state);
+				return 0;
+			},
+			{},
+			job::job_priority::high
+		);
+	}
+
+	// this thread plans as well, so the update never
+	// waits for workers which are busy with other jobs
+	plan_batches(*state);
+	while (state->finished_batches.load() < batch_count) {
+		std::this_thread::yield();
+	}
+
+	if (state->error) {
+		std::rethrow_exception(state->error);
+	}
+}
+
 std::vector<Unit *> UnitContainer::all_units() {
 	std::vector<Unit *> result;
-	for (auto &u : this->live_units) {
-		result.push_back(u.second.get());
+	result.reserve(this->handles.size() - this->free_slots.size());
+	for (uint32_t slot = 0; slot < this->handles.size(); slot++) {
+		if (this->handles[slot].used) {
+			result.push_back(static_cast<Unit *>(this->cell(slot)));
+		}
 	}
 	return result;
 }
 
+AttributeStorage &UnitContainer::get_attribute_storage() {
+	return *this->attribute_storage;
+}
+
+ProjectileSystem &UnitContainer::get_projectiles() {
+	return this->projectiles;
+}
+
+AnimationSystem &UnitContainer::get_animations() {
+	return this->animations;
+}
+
+TargetAcquisition &UnitContainer::get_acquisition() {
+	return *this->acquisition;
+}
+
+StateHash &UnitContainer::get_state_hash() {
+	return this->state_hash;
+}
+
 } // namespace openage
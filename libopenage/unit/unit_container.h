@@ -2,19 +2,32 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
 #include "../coord/tile.h"
+#include "../datastructure/lockfree_queue.h"
+#include "../datastructure/timer_wheel.h"
+#include "../gamestate/state_hash.h"
 #include "../handlers.h"
 #include "../util/timing.h"
+#include "animation_system.h"
+#include "projectile_system.h"
 
 
 namespace openage {
 
+namespace job {
+class JobManager;
+} // namespace job
+
+class AttributeStorage;
 class Command;
+struct GroupCommand;
 class Player;
+class TargetAcquisition;
 class Terrain;
 class TerrainObject;
 class Unit;
@@ -24,24 +37,20 @@ class UnitType;
 
 /**
  * Type used to identify each single unit in the game.
+ *
+ * The low 32 bits are the slot of the unit in its container,
+ * the high bits the generation of the slot, which changes each time
+ * a unit is removed from it. So ids are not reused.
  */
-using id_t = unsigned long int;
+using id_t = uint64_t;
 
 
-/**
- * immutable reference data
- */
-struct reference_data {
-	reference_data(const UnitContainer *c, id_t id, Unit *);
-
-	const UnitContainer *const container;
-	const id_t unit_id;
-	Unit *const unit_ptr;
-};
-
 /**
  * Reference to a single unit, which may have been removed
  * from the game, check is_valid() before calling get()
+ *
+ * References are plain values, checking them is a lookup
+ * of the generation of the unit's slot.
  */
 class UnitReference {
 public:
@@ -60,12 +69,9 @@ public:
 	Unit *get() const;
 
 private:
-
-	/**
-	 * The default copy constructor and assignment
-	 * will just copy the shared pointer
-	 */
-	std::shared_ptr<reference_data> data;
+	const UnitContainer *container;
+	id_t unit_id;
+	Unit *unit_ptr;
 };
 
 /**
@@ -89,6 +95,12 @@ public:
 	 */
 	std::shared_ptr<Terrain> get_terrain() const;
 
+	/**
+	 * sets the job manager to plan the unit updates in parallel,
+	 * nullptr to plan them on the calling thread
+	 */
+	void set_job_manager(job::JobManager *job_manager);
+
 	/**
 	 * checks the id is valid
 	 */
@@ -120,29 +132,244 @@ public:
 	 */
 	bool dispatch_command(id_t to_id, const Command &cmd);
 
+	/**
+	 * give a command to a group of units, e.g. a selection.
+	 *
+	 * the abilities are looked up once per unit type. groups moving
+	 * to a position share a flow field if they are large, small ones
+	 * get their targets spread in a formation around it.
+	 *
+	 * @returns the number of units which accepted the command
+	 */
+	size_t dispatch_group_command(const GroupCommand &group);
+
+	/**
+	 * receives the commands players give, instead of dispatching them.
+	 * nullptr dispatches them right away.
+	 */
+	void set_command_stream(std::function<void(const GroupCommand &)> stream);
+
+	/**
+	 * a command a player gives to a group of units, e.g. the selection.
+	 * passed to the command stream if there is one, which dispatches it
+	 * later in the same tick on all peers, else dispatched right away.
+	 */
+	void issue_group_command(const GroupCommand &group);
+
 	/**
 	 * update dispatched by the game engine on each physics tick.
 	 * this will update all game objects.
+	 *
+	 * first all units plan their update in parallel, then they are
+	 * updated one after another in a fixed order. the result does
+	 * not depend on the number of threads.
 	 */
 	bool update_all(time_nsec_t lastframe_duration);
 
+	/**
+	 * makes a sleeping unit be updated again in the next tick.
+	 * can be called from any thread, use Unit::wake.
+	 */
+	void request_wake(id_t id);
+
 	/**
 	 * gets a list of all units in the container
 	 */
 	std::vector<openage::Unit *> all_units();
 
+	/**
+	 * the frequently used attributes of the units, stored by type.
+	 */
+	AttributeStorage &get_attribute_storage();
+
+	/**
+	 * moves the flying projectiles of the units.
+	 */
+	ProjectileSystem &get_projectiles();
+
+	/**
+	 * advances the animations of the unit actions.
+	 */
+	AnimationSystem &get_animations();
+
+	/**
+	 * spreads the target searches of the units over the ticks.
+	 */
+	TargetAcquisition &get_acquisition();
+
+	/**
+	 * checksum of the unit positions and hitpoints, and
+	 * of the state the game adds, to detect desyncs.
+	 */
+	StateHash &get_state_hash();
+
 private:
-	id_t next_new_id;
+	/**
+	 * an entry of the handle table, the slot part of a unit id indexes it.
+	 */
+	struct unit_slot {
+		/**
+		 * generation of the unit in the slot,
+		 * or of the next one if the slot is free.
+		 */
+		uint32_t generation;
+
+		/**
+		 * whether the slot holds a unit.
+		 */
+		bool used;
+
+		/**
+		 * whether the unit is skipped by the updates until it is woken.
+		 */
+		bool sleeping;
+
+		/**
+		 * the game time in milliseconds to wake the sleeping unit at,
+		 * 0 if it sleeps until woken.
+		 */
+		uint64_t wake_time;
+
+		/**
+		 * the game time of the last update of the unit.
+		 */
+		time_nsec_t last_update;
+	};
+
+	/**
+	 * storage of the units of consecutive slots, see unit_container.cpp.
+	 */
+	struct unit_block;
+
+	/**
+	 * takes a free slot for a new unit and returns its id.
+	 */
+	id_t reserve_id();
+
+	/**
+	 * frees the slot of the id, so references to it become invalid.
+	 */
+	void release_id(id_t id);
+
+	/**
+	 * the memory of the unit in a slot.
+	 */
+	void *cell(uint32_t slot) const;
+
+	/**
+	 * constructs a unit in the cell of a new slot.
+	 * the unit is live from then on.
+	 */
+	Unit *create();
+
+	/**
+	 * destroys a live unit and frees its slot.
+	 */
+	void remove(Unit *unit);
+
+	/**
+	 * declared first, the units remove their entries when destroyed.
+	 */
+	StateHash state_hash;
+
+	/**
+	 * attribute columns of the units,
+	 * declared before them so it is destroyed last.
+	 */
+	std::unique_ptr<AttributeStorage> attribute_storage;
+
+	/**
+	 * flight state of the projectiles, declared before
+	 * the units whose actions remove themselves from it.
+	 */
+	ProjectileSystem projectiles;
+
+	/**
+	 * animation frames of the unit actions, declared before
+	 * the units whose actions remove themselves from it.
+	 */
+	AnimationSystem animations;
+
+	/**
+	 * the pending target searches, only refers to units by id.
+	 */
+	std::unique_ptr<TargetAcquisition> acquisition;
+
+	/**
+	 * handle table, indexed by the slot part of the unit ids
+	 */
+	std::vector<unit_slot> handles;
+
+	/**
+	 * slots without a unit, reused before new ones are appended
+	 */
+	std::vector<uint32_t> free_slots;
 
 	/**
-	 * mapping unit ids to unit objects
+	 * the units, stored in the cell of their slot, so iterating
+	 * the slots walks them in memory order. blocks are never
+	 * moved or freed before the container, units keep their address.
 	 */
-	std::unordered_map<id_t, std::unique_ptr<Unit>> live_units;
+	std::vector<std::unique_ptr<unit_block>> blocks;
 
 	/**
 	 * Terrain for initialising new units
 	 */
 	std::weak_ptr<Terrain> terrain;
+
+	/**
+	 * runs the planning of unit updates, may be null
+	 */
+	job::JobManager *job_manager;
+
+	/**
+	 * receives the commands of the players, may be empty
+	 */
+	std::function<void(const GroupCommand &)> command_stream;
+
+	/**
+	 * units in the order of the current update,
+	 * kept to avoid reallocating it each tick
+	 */
+	std::vector<Unit *> update_order;
+
+	/**
+	 * the time each unit of the update order is updated with,
+	 * which is longer for units that slept.
+	 */
+	std::vector<time_nsec_t> update_durations;
+
+	/**
+	 * game time up to the current tick
+	 */
+	time_nsec_t game_time;
+
+	/**
+	 * ids of units woken since the last tick
+	 */
+	datastructure::MPSCQueue<id_t> wake_requests;
+
+	/**
+	 * the wake times of sleeping units, in milliseconds of game time.
+	 * timers of units that were woken earlier or removed are skipped.
+	 */
+	datastructure::TimerWheel<id_t> wake_timers;
+
+	/**
+	 * wakes the units that were requested, and those whose
+	 * sleep ends before the current game time.
+	 */
+	void wake_units();
+
+	/**
+	 * lets the unit of the slot sleep after its update, if its action allows.
+	 */
+	void try_sleep(Unit *unit, uint32_t slot);
+
+	/**
+	 * plans the update of all units in the update order
+	 */
+	void plan_all();
 };
 
 } // namespace openage
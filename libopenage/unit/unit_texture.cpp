@@ -2,7 +2,9 @@
 
 #include "unit_texture.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 
 #include "../coord/phys3.h"
@@ -15,11 +17,11 @@
 
 namespace openage {
 
-UnitTexture::UnitTexture(GameSpec &spec, uint16_t graphic_id, bool delta)
+UnitTexture::UnitTexture(const GameSpec &spec, uint16_t graphic_id, bool delta)
 	:
 	UnitTexture{spec, spec.get_graphic_data(graphic_id), delta} {}
 
-UnitTexture::UnitTexture(GameSpec &spec, const gamedata::graphic *graphic, bool delta)
+UnitTexture::UnitTexture(const GameSpec &spec, const gamedata::graphic *graphic, bool delta)
 	:
 	id{graphic->id},
 	sound_id{graphic->sound_id},
@@ -45,88 +47,56 @@ coord::window UnitTexture::size() const {
 }
 
 void UnitTexture::sample(const coord::camhud &draw_pos, unsigned color) const {
-
-	// draw delta list first
-	for (auto &d : this->deltas) {
-		coord::camhud_delta dlt = coord::camhud_delta{d.second.x, d.second.y};
-		d.first->sample(draw_pos + dlt, color);
-	}
-
-	// draw texture
-	if (this->draw_this) {
-		this->texture->draw(draw_pos, PLAYERCOLORED, false, 0, color);
+	for (auto &l : this->layers) {
+		coord::camhud_delta dlt = coord::camhud_delta{l.offset.x, l.offset.y};
+		l.texture->draw(draw_pos + dlt, PLAYERCOLORED, false, 0, color);
 	}
 }
 
 void UnitTexture::draw(const coord::camgame &draw_pos, unsigned int frame, unsigned color) const {
-
-	// draw delta list first
-	for (auto &d : this->deltas) {
-		d.first->draw(draw_pos + d.second, frame, color);
-	}
-
-	// draw texture
-	if (this->draw_this) {
-		unsigned int to_draw = frame % this->texture->get_subtexture_count();
-		this->texture->draw(draw_pos, PLAYERCOLORED, false, to_draw, color);
+	for (auto &l : this->layers) {
+		unsigned int to_draw = frame % l.subtexture_count;
+		l.texture->draw(draw_pos + l.offset, PLAYERCOLORED, false, to_draw, color);
 	}
 }
 
 void UnitTexture::draw(const coord::camgame &draw_pos, coord::phys3_delta &dir, unsigned int frame, unsigned color) const {
-	unsigned int frame_to_use = frame;
-	if (this->use_up_angles) {
-		// up  1 => tilt 0
-		// up -1 => tilt 1
-		// up has a scale 5 times smaller
-		double len = sqrt(dir.ne*dir.ne + dir.se*dir.se + dir.up*dir.up/25);
-		double up = static_cast<double>(dir.up/5.0) / len;
-		frame_to_use = (0.5 - (0.5 * up)) * this->frame_count;
-	}
-	else if (this->sound && frame == 0.0) {
-		this->sound->play();
-	}
-
-	// the index for the current direction
-	unsigned int angle = dir_group(dir, this->angle_count);
-
-	/*
-	 * mirroring is used to make additional image sets
-	 */
-	bool mirror = false;
-	if (this->angles_included <= angle) {
-		// this->angles_included <= angle < this->angle_count
-		angle = this->top_frame - angle;
-		mirror = true;
-	}
+	// the angle for the most common number of directions
+	unsigned int angle_count = this->angle_count;
+	unsigned int angle = dir_group(dir, angle_count);
+
+	for (auto &l : this->layers) {
+		unsigned int frame_to_use = frame;
+		if (l.use_up_angles) {
+			// up  1 => tilt 0
+			// up -1 => tilt 1
+			// up has a scale 5 times smaller
+			double len = sqrt(dir.ne*dir.ne + dir.se*dir.se + dir.up*dir.up/25);
+			double up = static_cast<double>(dir.up/5.0) / len;
+			frame_to_use = (0.5 - (0.5 * up)) * l.frame_count;
+		}
+		else if (l.sound && frame == 0.0) {
+			// sounds of units far from the camera center are dropped first
+			l.sound->play(-(std::abs(draw_pos.x) + std::abs(draw_pos.y)));
+		}
 
-	// draw delta list first
-	for (auto &d : this->deltas) {
-		 d.first->draw(draw_pos + d.second, dir, frame, color);
-	}
+		if (l.angle_count != angle_count) {
+			angle_count = l.angle_count;
+			angle = dir_group(dir, angle_count);
+		}
 
-	if (this->draw_this) {
-		unsigned int to_draw = this->subtexture(this->texture, angle, frame_to_use);
-		this->texture->draw(draw_pos, PLAYERCOLORED, mirror, to_draw, color);
+		const frame_entry &entry = l.frames[angle * l.frames_per_angle + frame_to_use % l.frames_per_angle];
+		l.texture->draw(draw_pos + l.offset, PLAYERCOLORED, entry.mirrored, entry.subid, color);
 	}
 }
 
-void UnitTexture::initialise(GameSpec &spec) {
+void UnitTexture::initialise(const GameSpec &spec) {
 	this->texture = spec.get_texture(this->id);
 	this->sound = spec.get_sound(this->sound_id);
 	if (not is_valid()) {
 		this->draw_this = false;
 	}
 
-	// find deltas
-	if (this->use_deltas) for (auto d : this->delta_id) {
-		if (spec.get_graphic_data(d.graphic_id)) {
-			auto ut = std::make_unique<UnitTexture>(spec, d.graphic_id, false);
-			if (ut->is_valid()) {
-				this->deltas.push_back({std::move(ut), coord::camgame_delta{d.direction_x, d.direction_y}});
-			}
-		}
-	}
-
 	if (this->draw_this) {
 
 		// the graphic frame count includes deltas
@@ -147,17 +117,66 @@ void UnitTexture::initialise(GameSpec &spec) {
 		// find the top direction for mirroring over
 		this->top_frame = this->angle_count - (1 - (this->angles_included - this->angles_mirrored) / 2);
 	}
+
+	// the deltas are drawn first, their tables are taken over
+	// and the delta textures themselves are not kept
+	this->layers.clear();
+	if (this->use_deltas) for (auto d : this->delta_id) {
+		if (spec.get_graphic_data(d.graphic_id)) {
+			UnitTexture ut(spec, d.graphic_id, false);
+			if (ut.is_valid()) {
+				this->layers.push_back(ut.make_layer(coord::camgame_delta{d.direction_x, d.direction_y}));
+			}
+		}
+	}
+
+	if (this->draw_this) {
+		this->layers.push_back(this->make_layer(coord::camgame_delta{0, 0}));
+	}
 }
 
-unsigned int UnitTexture::subtexture(const Texture *t, unsigned int angle, unsigned int frame) const {
-	unsigned int tex_frames = t->get_subtexture_count();
-	unsigned int count = tex_frames / this->angles_included;
-	unsigned int to_draw = angle * count + (frame % count);
-	if (tex_frames <= to_draw) {
-		log::log(MSG(err) << "Subtexture out of range (" << angle << ", " << frame << ")");
-		return 0;
+UnitTexture::layer UnitTexture::make_layer(coord::camgame_delta offset) const {
+	layer l;
+	l.texture = this->texture;
+	l.sound = this->sound;
+	l.offset = offset;
+	l.angle_count = std::max(this->angle_count, 1u);
+	l.frame_count = this->frame_count;
+	l.use_up_angles = this->use_up_angles;
+	l.subtexture_count = std::max(this->texture->get_subtexture_count(), 1);
+
+	unsigned int tex_frames = this->texture->get_subtexture_count();
+	l.frames_per_angle = std::max(tex_frames / this->angles_included, 1u);
+	l.frames.resize(l.angle_count * l.frames_per_angle);
+
+	for (unsigned int angle = 0; angle < l.angle_count; angle++) {
+		/*
+		 * mirroring is used to make additional image sets
+		 */
+		unsigned int image_angle = angle;
+		bool mirror = false;
+		if (this->angles_included <= angle) {
+			// this->angles_included <= angle < this->angle_count
+			image_angle = this->top_frame - angle;
+			mirror = true;
+		}
+
+		bool reported = false;
+		for (unsigned int frame = 0; frame < l.frames_per_angle; frame++) {
+			unsigned int to_draw = image_angle * l.frames_per_angle + frame;
+			if (tex_frames <= to_draw) {
+				if (not reported) {
+					log::log(MSG(err) << "Subtexture out of range (" << image_angle << ", " << frame
+					         << ") in graphic " << this->id);
+					reported = true;
+				}
+				to_draw = 0;
+			}
+			l.frames[angle * l.frames_per_angle + frame] = frame_entry{static_cast<int>(to_draw), mirror};
+		}
 	}
-	return to_draw;
+
+	return l;
 }
 
 unsigned int dir_group(coord::phys3_delta dir, unsigned int angles) {
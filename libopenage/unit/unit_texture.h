@@ -1,10 +1,11 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <cstdint>
 #include <vector>
 
+#include "../coord/camgame.h"
 #include "../coord/phys3.h"
 #include "../gamedata/graphic.gen.h"
 
@@ -21,6 +22,10 @@ class Sound;
  * These objects handle the drawing of regular textures to use a
  * unit's direction and include delta graphics.
  *
+ * The subtextures for each direction and frame are looked up in tables
+ * that are built when the graphic is initialised, one for the graphic
+ * and each of its deltas.
+ *
  * This type can also deals with playing position based game sounds.
  */
 class UnitTexture {
@@ -31,8 +36,8 @@ public:
 	 * Note that the game data contains loops in delta links
 	 * which mean recursive loading should be avoided
 	 */
-	UnitTexture(GameSpec &spec, uint16_t graphic_id, bool delta=true);
-	UnitTexture(GameSpec &spec, const gamedata::graphic *graphic, bool delta=true);
+	UnitTexture(const GameSpec &spec, uint16_t graphic_id, bool delta=true);
+	UnitTexture(const GameSpec &spec, const gamedata::graphic *graphic, bool delta=true);
 
 	/**
 	 * const attributes of the graphic
@@ -83,9 +88,40 @@ public:
 	/**
 	 * initialise graphic data
 	 */
-	void initialise(GameSpec &spec);
+	void initialise(const GameSpec &spec);
 
 private:
+	/**
+	 * the subtexture drawn for an angle and frame
+	 */
+	struct frame_entry {
+		int subid;
+		bool mirrored;
+	};
+
+	/**
+	 * a texture drawn for the graphic: the graphic's own one, or one of
+	 * its deltas. the frame table of a layer has a row for each angle.
+	 */
+	struct layer {
+		const Texture *texture;
+		const Sound *sound;
+		coord::camgame_delta offset;
+
+		unsigned int angle_count;
+		unsigned int frame_count;
+		bool use_up_angles;
+
+		int subtexture_count;
+		unsigned int frames_per_angle;
+		std::vector<frame_entry> frames;
+	};
+
+	/**
+	 * build the layer of this graphic's texture, drawn at the offset
+	 */
+	layer make_layer(coord::camgame_delta offset) const;
+
 	/**
 	 * use a regular texture for drawing
 	 */
@@ -107,13 +143,10 @@ private:
 	// delta graphic ids
 	std::vector<gamedata::graphic_delta> delta_id;
 
-	// delta graphics
-	std::vector<std::pair<std::unique_ptr<UnitTexture>, coord::camgame_delta>> deltas;
-
 	/**
-	 * find which subtexture should be used for drawing this texture
+	 * the deltas first, then the graphic itself, in drawing order
 	 */
-	unsigned int subtexture(const Texture *t, unsigned int angle, unsigned int frame) const;
+	std::vector<layer> layers;
 };
 
 /**
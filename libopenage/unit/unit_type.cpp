@@ -1,4 +1,6 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
+
+#include <atomic>
 
 #include "../gamestate/player.h"
 #include "../terrain/terrain_object.h"
@@ -9,6 +11,34 @@
 
 namespace openage {
 
+namespace {
+
+/**
+ * the table index of the next unit type
+ */
+std::atomic<uint32_t> next_table_index{0};
+
+/**
+ * the tiles adjacent to an object on which units may be placed,
+ * the ones on missing chunks are left out.
+ */
+std::vector<coord::tile> tiles_beside(TerrainObject const *other, Terrain *terrain) {
+	tile_range outline{other->pos.start - coord::tile_delta{1, 1},
+	                   other->pos.end   + coord::tile_delta{1, 1},
+	                   other->pos.draw};
+
+	std::vector<coord::tile> result;
+	for (coord::tile pos : frame_tile_list(outline)) {
+		if (terrain->get_chunk(pos) != nullptr) {
+			result.push_back(pos);
+		}
+	}
+	return result;
+}
+
+} // anonymous namespace
+
+
 UnitTypeMeta::UnitTypeMeta(const std::string &name, int id, init_func f)
  	:
 	init{f},
@@ -26,7 +56,10 @@ int UnitTypeMeta::id() const {
 
 UnitType::UnitType(const Player &owner)
 	:
-	owner{owner} {
+	owner{owner},
+	table_index{next_table_index++},
+	line_of_sight{0},
+	revision{0} {
 }
 
 bool UnitType::operator==(const UnitType &other) const {
@@ -46,20 +79,9 @@ TerrainObject *UnitType::place_beside(Unit *u, TerrainObject const *other) const
 		return nullptr;
 	}
 
-	// find the range of possible tiles
-	tile_range outline{other->pos.start - coord::tile_delta{1, 1},
-	                   other->pos.end   + coord::tile_delta{1, 1},
-	                   other->pos.draw};
-
 	// find a free position adjacent to the object
 	auto terrain = other->get_terrain();
-	for (coord::tile temp_pos : tile_list(outline)) {
-		TerrainChunk *chunk = terrain->get_chunk(temp_pos);
-
-		if (chunk == nullptr) {
-			continue;
-		}
-
+	for (coord::tile temp_pos : tiles_beside(other, terrain.get())) {
 		auto placed = this->place(u, terrain, temp_pos.to_phys2().to_phys3());
 		if (placed) {
 			return placed;
@@ -68,24 +90,100 @@ TerrainObject *UnitType::place_beside(Unit *u, TerrainObject const *other) const
 	return nullptr;
 }
 
+std::vector<TerrainObject *> UnitType::place_beside(const std::vector<Unit *> &units,
+                                                    TerrainObject const *other) {
+	std::vector<TerrainObject *> placed(units.size(), nullptr);
+	if (!other) {
+		return placed;
+	}
+
+	auto terrain = other->get_terrain();
+	std::vector<coord::tile> tiles = tiles_beside(other, terrain.get());
+
+	// the tiles units were placed on
+	std::vector<bool> taken(tiles.size(), false);
+
+	// for each type, the first tile it didn't try yet.
+	// types differ in size and allowed terrain, so a tile
+	// that failed for one type may fit another.
+	std::unordered_map<const UnitType *, size_t> next_tile;
+
+	for (size_t i = 0; i < units.size(); i++) {
+		Unit *u = units[i];
+		if (!u) {
+			continue;
+		}
+
+		const UnitType *type = u->unit_type;
+		size_t &tile = next_tile[type];
+		for (; tile < tiles.size(); tile++) {
+			if (taken[tile]) {
+				continue;
+			}
+
+			placed[i] = type->place(u, terrain, tiles[tile].to_phys2().to_phys3());
+			if (placed[i]) {
+				taken[tile] = true;
+				tile += 1;
+				break;
+			}
+		}
+	}
+
+	return placed;
+}
+
 void UnitType::copy_attributes(Unit *unit) const {
 	for (auto &attr : this->default_attributes) {
-		unit->add_attribute(attr.second->copy());
+		if (attr.second->shared()) {
+			unit->add_attribute(attr.second);
+		}
+		else {
+			unit->copy_attribute(*attr.second);
+		}
 	}
 }
 
 void UnitType::upgrade(const AttributeContainer &attr) {
-	*this->default_attributes[attr.type] = attr;
+	std::shared_ptr<AttributeContainer> &current = this->default_attributes[attr.type];
+	if (current and current->shared()) {
+		// changed in place, so the units referencing it are upgraded too
+		current->assign(attr);
+	}
+	else {
+		// only new units get it
+		current = attr.copy();
+	}
+	this->revision += 1;
+}
+
+uint32_t UnitType::get_revision() const {
+	return this->revision;
 }
 
 UnitType *UnitType::parent_type() const {
 	return this->owner.get_type(this->parent_id());
 }
 
-NyanType::NyanType(const Player &owner)
+NyanType::NyanType(const Player &owner, std::shared_ptr<const nyan::Database> database, nyan::object_id object)
 	:
-	UnitType(owner) {
-	// TODO: the type should be given attributes and abilities
+	UnitType(owner),
+	database{std::move(database)},
+	object{object},
+	has_hit_points{false},
+	hit_points{} {
+
+	nyan::type_id type = this->database->type_of(object);
+
+	if (this->database->has_member(type, "hit_points")) {
+		this->has_hit_points = true;
+		this->hit_points = this->database->member<int64_t>(type, "hit_points");
+	}
+
+	if (this->database->has_member(type, "line_of_sight")) {
+		auto sight = this->database->member<int64_t>(type, "line_of_sight");
+		this->line_of_sight = static_cast<int>(this->database->get(object, sight));
+	}
 }
 
 NyanType::~NyanType() {}
@@ -99,7 +197,7 @@ int NyanType::parent_id() const {
 }
 
 std::string NyanType::name() const {
-	return "Nyan";
+	return this->database->object_name(this->object);
 }
 
 void NyanType::initialise(Unit *unit, Player &) {
@@ -118,6 +216,11 @@ void NyanType::initialise(Unit *unit, Player &) {
 	// copy all attributes
 	this->copy_attributes(unit);
 
+	if (this->has_hit_points) {
+		int64_t hp = this->database->get(this->object, this->hit_points);
+		unit->copy_attribute(Attribute<attr_type::hitpoints>(static_cast<unsigned int>(hp)));
+	}
+
 	// give idle action
 	unit->push_action(std::make_unique<IdleAction>(unit), true);
 }
@@ -1,13 +1,15 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "../coord/phys3.h"
+#include "../nyan/database.h"
 #include "attribute.h"
 
 namespace openage {
@@ -112,15 +114,38 @@ public:
 	TerrainObject *place_beside(Unit *, TerrainObject const *) const;
 
 	/**
-	 * copy attributes of this unit type to a new unit instance
+	 * places many units adjacent to an existing object, each with its type,
+	 * e.g. when ungarrisoning a building.
+	 *
+	 * the tiles around the object are listed once. a tile where a unit
+	 * was placed is skipped for the following units, a tile where placing
+	 * failed is skipped for the following units of the same type.
+	 *
+	 * @returns the location of each unit, nullptr for the units
+	 *          that couldn't be placed or are nullptr.
+	 */
+	static std::vector<TerrainObject *> place_beside(const std::vector<Unit *> &units,
+	                                                 TerrainObject const *other);
+
+	/**
+	 * copy attributes of this unit type to a new unit instance.
+	 * the shared attributes aren't copied, the unit references them.
 	 */
 	void copy_attributes(Unit *unit) const;
 
 	/**
-	 * upgrades one attribute of this unit type
+	 * upgrades one attribute of this unit type.
+	 * units keeping a shared attribute of the type see the upgrade,
+	 * copied ones (including all column attributes) keep their value.
 	 */
 	void upgrade(const AttributeContainer &attr);
 
+	/**
+	 * the number of upgrades of this type, so values computed
+	 * from its attributes can be checked.
+	 */
+	uint32_t get_revision() const;
+
 	/**
 	 * returns type matching parent_id()
 	 */
@@ -131,6 +156,11 @@ public:
 	 */
 	const Player &owner;
 
+	/**
+	 * unique among all unit types, for tables by type, see DamageTable
+	 */
+	const uint32_t table_index;
+
 	/**
 	 * all instances of units made from this unit type
 	 * this could allow all units of a type to be upgraded
@@ -143,7 +173,8 @@ public:
 	std::vector<std::shared_ptr<UnitAbility>> type_abilities;
 
 	/**
-	 * default attributes which get copied to new units
+	 * default attributes which get copied to new units,
+	 * or which they share, see copy_attributes
 	 */
 	attr_map_t default_attributes;
 
@@ -157,22 +188,34 @@ public:
 	 */
 	coord::tile_delta foundation_size;
 
+	/**
+	 * radius in tiles of the area the units of this type
+	 * reveal to their owner, 0 if they see nothing
+	 */
+	int line_of_sight;
+
 	/**
 	 * raw game data class of this unit instance
 	 */
 	gamedata::unit_classes unit_class;
+
+private:
+	uint32_t revision;
 };
 
 /**
- * An example of how nyan can work with the type system
+ * A unit type defined by an object of the nyan database.
+ *
+ * The members the type reads are resolved once, so creating
+ * units reads their values without looking up names.
  */
 class NyanType: public UnitType {
 public:
 	/**
-	 * TODO: give the parsed nyan attributes
-	 * to the constructor
+	 * The type of units made from the object. It has the optional
+	 * int members hit_points and line_of_sight.
 	 */
-	NyanType(const Player &owner);
+	NyanType(const Player &owner, std::shared_ptr<const nyan::Database> database, nyan::object_id object);
 	virtual ~NyanType();
 
 	int id() const override;
@@ -181,6 +224,12 @@ public:
 	void initialise(Unit *, Player &) override;
 	TerrainObject *place(Unit *, std::shared_ptr<Terrain>, coord::phys3) const override;
 
+private:
+	std::shared_ptr<const nyan::Database> database;
+	nyan::object_id object;
+
+	bool has_hit_points;
+	nyan::Member<int64_t> hit_points;
 };
 
 } // namespace openage
@@ -0,0 +1,88 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "unit_view.h"
+
+#include "../gamestate/player.h"
+#include "../terrain/terrain_object.h"
+#include "unit.h"
+#include "unit_container.h"
+#include "unit_type.h"
+
+namespace openage {
+
+
+UnitView::UnitView()
+	:
+	current{std::make_shared<unit_columns>()},
+	used{false} {}
+
+
+void UnitView::refresh(UnitContainer &container, uint64_t tick) {
+	std::shared_ptr<unit_columns> target;
+	{
+		std::lock_guard<std::mutex> guard{this->lock};
+		if (not this->used) {
+			return;
+		}
+
+		// the view and the refresh are the only owners if no reader has it
+		if (this->spare and this->spare.use_count() == 1) {
+			target = std::move(this->spare);
+		}
+	}
+
+	if (not target) {
+		target = std::make_shared<unit_columns>();
+	}
+
+	std::vector<Unit *> units = container.all_units();
+	size_t count = units.size();
+
+	// the vectors keep their capacity, so refills don't allocate
+	target->tick = tick;
+	target->count = count;
+	target->ids.resize(count);
+	target->type_ids.resize(count);
+	target->owners.resize(count);
+	target->positions.resize(3 * count);
+	target->hitpoints.resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		Unit *unit = units[i];
+
+		target->ids[i] = unit->id;
+		target->type_ids[i] = unit->unit_type ? unit->unit_type->id() : -1;
+		target->owners[i] = unit->has_attribute(attr_type::owner) ?
+		                    unit->get_attribute<attr_type::owner>().player.player_number : 0;
+
+		coord::phys3 position{0, 0, 0};
+		if (unit->location) {
+			position = unit->location->pos.draw;
+		}
+		target->positions[3 * i] = position.ne;
+		target->positions[3 * i + 1] = position.se;
+		target->positions[3 * i + 2] = position.up;
+
+		target->hitpoints[i] = unit->has_attribute(attr_type::hitpoints) ?
+		                       unit->get_attribute<attr_type::hitpoints>().current : 0;
+	}
+
+	std::lock_guard<std::mutex> guard{this->lock};
+	this->spare = std::move(this->current);
+	this->current = std::move(target);
+}
+
+
+std::shared_ptr<unit_columns> UnitView::get() {
+	std::lock_guard<std::mutex> guard{this->lock};
+	this->used = true;
+	return this->current;
+}
+
+
+bool UnitView::is_used() const {
+	std::lock_guard<std::mutex> guard{this->lock};
+	return this->used;
+}
+
+} // openage
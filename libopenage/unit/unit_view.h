@@ -0,0 +1,94 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+// pxd: from libc.stdint cimport int32_t, int64_t, uint32_t, uint64_t
+#include <cstdint>
+// pxd: from libcpp.memory cimport shared_ptr
+#include <memory>
+#include <mutex>
+// pxd: from libcpp.vector cimport vector
+#include <vector>
+
+namespace openage {
+
+class UnitContainer;
+
+
+/**
+ * The state of all units after one tick, one array per attribute,
+ * so it can be read as a whole, e.g. by numpy. The units are in the
+ * order of their slots. Garrisoned units are at position 0.
+ *
+ * Once published by a UnitView, the columns are not changed anymore.
+ *
+ * pxd:
+ *
+ * cppclass unit_columns:
+ *     uint64_t tick
+ *     size_t count
+ *     vector[uint64_t] ids
+ *     vector[int32_t] type_ids
+ *     vector[uint32_t] owners
+ *     vector[int64_t] positions
+ *     vector[uint32_t] hitpoints
+ */
+struct unit_columns {
+	uint64_t tick = 0;                //!< the number of ticks simulated before
+	size_t count = 0;
+
+	std::vector<uint64_t> ids;
+	std::vector<int32_t> type_ids;
+	std::vector<uint32_t> owners;     //!< player numbers
+	std::vector<int64_t> positions;   //!< ne, se and up of each unit
+	std::vector<uint32_t> hitpoints;  //!< 0 for units without
+};
+
+
+/**
+ * Publishes the state of the units of a game once per tick, to be read
+ * without calls per unit, e.g. from Python.
+ *
+ * Readers keep the columns of a tick as long as they need them. The
+ * columns are refilled in place when no reader holds them anymore,
+ * otherwise the refresh uses other ones, so a tick that is read is
+ * never changed.
+ */
+class UnitView {
+public:
+	UnitView();
+
+	UnitView(const UnitView &) = delete;
+	UnitView &operator =(const UnitView &) = delete;
+
+	/**
+	 * publishes the state of the units, called after each tick.
+	 * does nothing until the view was used.
+	 */
+	void refresh(UnitContainer &container, uint64_t tick);
+
+	/**
+	 * the units of the last refreshed tick, thread safe.
+	 * the view is refreshed from then on.
+	 */
+	std::shared_ptr<unit_columns> get();
+
+	/**
+	 * whether get() was called, so the refresh is needed.
+	 */
+	bool is_used() const;
+
+private:
+	mutable std::mutex lock;
+
+	std::shared_ptr<unit_columns> current;
+
+	/**
+	 * the columns of the tick before, refilled if no reader has them.
+	 */
+	std::shared_ptr<unit_columns> spare;
+
+	bool used;
+};
+
+} // openage
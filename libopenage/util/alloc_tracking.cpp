@@ -0,0 +1,203 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "alloc_tracking.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if WITH_ALLOC_TRACKING
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#endif
+
+namespace openage {
+namespace util {
+
+
+const char *alloc_tag_name(alloc_tag tag) {
+	switch (tag) {
+	case alloc_tag::other:
+		return "other";
+	case alloc_tag::simulation:
+		return "simulation";
+	case alloc_tag::rendering:
+		return "rendering";
+	case alloc_tag::assets:
+		return "assets";
+	case alloc_tag::logging:
+		return "logging";
+	case alloc_tag::gui:
+		return "gui";
+	}
+	return "unknown";
+}
+
+
+#if WITH_ALLOC_TRACKING
+
+namespace {
+
+/**
+ * The counters of a tag. Updated by all threads, so each tag has its
+ * own cache line at least.
+ *
+ * Constant-initialized, the allocations of the static constructors
+ * are counted as well.
+ */
+struct alignas(64) tag_counters {
+	std::atomic<uint64_t> allocations;
+	std::atomic<uint64_t> frees;
+	std::atomic<uint64_t> allocated_bytes;
+	std::atomic<uint64_t> freed_bytes;
+};
+
+tag_counters counters[alloc_tag_count];
+
+
+#if HAVE_THREAD_LOCAL_STORAGE
+thread_local alloc_tag current_tag = alloc_tag::other;
+#else
+// the tags of all threads mix, but the totals are still right
+alloc_tag current_tag = alloc_tag::other;
+#endif
+
+
+/**
+ * the usable size of a block returned by malloc.
+ *
+ * the size isn't stored with the block, so memory allocated by any
+ * other operator new can be released here and the other way round.
+ */
+size_t block_size(void *block) {
+#if defined(__APPLE__)
+	return malloc_size(block);
+#elif defined(_WIN32)
+	return _msize(block);
+#else
+	return malloc_usable_size(block);
+#endif
+}
+
+
+void *tracked_alloc(size_t size) noexcept {
+	void *block = std::malloc(size == 0 ? 1 : size);
+	if (block != nullptr) {
+		tag_counters &tag = counters[static_cast<size_t>(current_tag)];
+		tag.allocations.fetch_add(1, std::memory_order_relaxed);
+		tag.allocated_bytes.fetch_add(block_size(block), std::memory_order_relaxed);
+	}
+	return block;
+}
+
+
+void *tracked_alloc_or_throw(size_t size) {
+	while (true) {
+		void *block = tracked_alloc(size);
+		if (block != nullptr) {
+			return block;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr) {
+			throw std::bad_alloc{};
+		}
+		handler();
+	}
+}
+
+
+void tracked_free(void *block) noexcept {
+	if (block == nullptr) {
+		return;
+	}
+
+	tag_counters &tag = counters[static_cast<size_t>(current_tag)];
+	tag.frees.fetch_add(1, std::memory_order_relaxed);
+	tag.freed_bytes.fetch_add(block_size(block), std::memory_order_relaxed);
+	std::free(block);
+}
+
+} // anonymous namespace
+
+
+alloc_tag get_thread_alloc_tag() {
+	return current_tag;
+}
+
+
+void set_thread_alloc_tag(alloc_tag tag) {
+	current_tag = tag;
+}
+
+
+alloc_stats get_alloc_stats(alloc_tag tag) {
+	const tag_counters &tag_counter = counters[static_cast<size_t>(tag)];
+	return {
+		tag_counter.allocations.load(std::memory_order_relaxed),
+		tag_counter.frees.load(std::memory_order_relaxed),
+		tag_counter.allocated_bytes.load(std::memory_order_relaxed),
+		tag_counter.freed_bytes.load(std::memory_order_relaxed),
+	};
+}
+
+#else
+
+alloc_stats get_alloc_stats(alloc_tag) {
+	return {0, 0, 0, 0};
+}
+
+#endif
+
+
+}} // openage::util
+
+
+#if WITH_ALLOC_TRACKING
+
+// the replacements of the global allocation functions
+
+void *operator new(size_t size) {
+	return openage::util::tracked_alloc_or_throw(size);
+}
+
+void *operator new[](size_t size) {
+	return openage::util::tracked_alloc_or_throw(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	return openage::util::tracked_alloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return openage::util::tracked_alloc(size);
+}
+
+void operator delete(void *block) noexcept {
+	openage::util::tracked_free(block);
+}
+
+void operator delete[](void *block) noexcept {
+	openage::util::tracked_free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+	openage::util::tracked_free(block);
+}
+
+void operator delete[](void *block, size_t) noexcept {
+	openage::util::tracked_free(block);
+}
+
+void operator delete(void *block, const std::nothrow_t &) noexcept {
+	openage::util::tracked_free(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept {
+	openage::util::tracked_free(block);
+}
+
+#endif
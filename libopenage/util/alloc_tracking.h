@@ -0,0 +1,119 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../config.h"
+
+namespace openage {
+namespace util {
+
+
+/**
+ * The parts of the engine whose heap allocations are counted apart.
+ */
+enum class alloc_tag : uint8_t {
+	other,
+	simulation,
+	rendering,
+	assets,
+	logging,
+	gui,
+};
+
+constexpr size_t alloc_tag_count = 6;
+
+
+/**
+ * Whether the global operator new and delete count the allocations,
+ * enabled by configuring with --with-alloc-tracking.
+ */
+constexpr bool alloc_tracking_enabled = WITH_ALLOC_TRACKING;
+
+
+/**
+ * e.g. "simulation"
+ */
+const char *alloc_tag_name(alloc_tag tag);
+
+
+/**
+ * The allocations since the start of the program.
+ *
+ * A free is counted for the tag that is active when the memory is
+ * released, which is not always the one that allocated it. The bytes
+ * are those usable in the blocks, including the allocator's slack.
+ */
+struct alloc_stats {
+	uint64_t allocations;
+	uint64_t frees;
+	uint64_t allocated_bytes;
+	uint64_t freed_bytes;
+};
+
+
+/**
+ * The allocations of a tag, all zero without alloc tracking.
+ */
+alloc_stats get_alloc_stats(alloc_tag tag);
+
+
+#if WITH_ALLOC_TRACKING
+
+/**
+ * The tag the allocations of the calling thread are counted for.
+ */
+alloc_tag get_thread_alloc_tag();
+
+/**
+ * Sets the tag of the calling thread, e.g. once when a worker starts.
+ */
+void set_thread_alloc_tag(alloc_tag tag);
+
+
+/**
+ * Counts the allocations of the calling thread for a tag, from its
+ * construction to its destruction. Scopes can be nested.
+ */
+class AllocScope {
+public:
+	explicit AllocScope(alloc_tag tag)
+		:
+		previous{get_thread_alloc_tag()} {
+
+		set_thread_alloc_tag(tag);
+	}
+
+	~AllocScope() {
+		set_thread_alloc_tag(this->previous);
+	}
+
+	AllocScope(const AllocScope &) = delete;
+	AllocScope &operator =(const AllocScope &) = delete;
+
+private:
+	alloc_tag previous;
+};
+
+#else
+
+inline alloc_tag get_thread_alloc_tag() {
+	return alloc_tag::other;
+}
+
+inline void set_thread_alloc_tag(alloc_tag) {}
+
+class AllocScope {
+public:
+	explicit AllocScope(alloc_tag) {}
+
+	AllocScope(const AllocScope &) = delete;
+	AllocScope &operator =(const AllocScope &) = delete;
+};
+
+#endif
+
+
+}} // openage::util
@@ -0,0 +1,237 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "asset_pack.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace util {
+
+namespace {
+
+constexpr uint32_t asset_pack_version = 1;
+
+
+/**
+ * the mounted packs and the directories they're mounted at,
+ * each directory ending with a slash.
+ */
+struct mounted_packs {
+	std::mutex mutex;
+	std::vector<std::pair<std::string, std::shared_ptr<const AssetPack>>> packs;
+};
+
+
+mounted_packs &get_mounted_packs() {
+	static mounted_packs mounted;
+	return mounted;
+}
+
+
+std::string mount_prefix(const std::string &dir) {
+	if (not dir.empty() and dir.back() == '/') {
+		return dir;
+	}
+	return dir + "/";
+}
+
+
+/**
+ * compare a path of the pack index with the one looked up, bytewise
+ * like the converter sorted them.
+ */
+int compare_path(const char *a, size_t a_length, const char *b, size_t b_length) {
+	int result = memcmp(a, b, std::min(a_length, b_length));
+	if (result != 0) {
+		return result;
+	}
+	if (a_length == b_length) {
+		return 0;
+	}
+	return a_length < b_length ? -1 : 1;
+}
+
+} // anonymous namespace
+
+
+AssetPack::AssetPack(const std::string &filename)
+	:
+	filename{filename},
+	mapping{nullptr},
+	mapping_size{0} {
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw Error(MSG(err) << "Could not open asset pack " << filename);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 or st.st_size < static_cast<off_t>(sizeof(asset_pack_header))) {
+		close(fd);
+		throw Error(MSG(err) << "Asset pack is too small: " << filename);
+	}
+
+	this->mapping_size = st.st_size;
+	this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// the mapping stays valid without the descriptor
+	close(fd);
+
+	if (this->mapping == MAP_FAILED) {
+		this->mapping = nullptr;
+		throw Error(MSG(err) << "Could not map asset pack " << filename);
+	}
+
+	const char *data = static_cast<const char *>(this->mapping);
+
+	asset_pack_header header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, "OGAP", 4) != 0 or
+	    header.version != asset_pack_version) {
+		this->unmap();
+		throw Error(MSG(err) << "Unknown asset pack format in " << filename);
+	}
+
+	uint64_t index_end = sizeof(header) + uint64_t{header.file_count} * sizeof(asset_pack_entry);
+	if (index_end > this->mapping_size) {
+		this->unmap();
+		throw Error(MSG(err) << "Truncated asset pack " << filename);
+	}
+
+	this->entries.resize(header.file_count);
+	memcpy(this->entries.data(), data + sizeof(header),
+	       this->entries.size() * sizeof(asset_pack_entry));
+
+	for (auto &entry : this->entries) {
+		if (entry.offset > this->mapping_size or
+		    entry.size > this->mapping_size - entry.offset or
+		    uint64_t{entry.path_offset} + entry.path_length > this->mapping_size) {
+			this->unmap();
+			throw Error(MSG(err) << "Invalid file entry in asset pack " << filename);
+		}
+	}
+}
+
+
+AssetPack::~AssetPack() {
+	this->unmap();
+}
+
+
+void AssetPack::unmap() {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+		this->mapping = nullptr;
+	}
+}
+
+
+const char *AssetPack::find(const char *path, size_t path_length, size_t *size) const {
+	const char *data = static_cast<const char *>(this->mapping);
+
+	auto it = std::lower_bound(
+		std::begin(this->entries), std::end(this->entries), path,
+		[&](const asset_pack_entry &entry, const char *) {
+			return compare_path(data + entry.path_offset, entry.path_length,
+			                    path, path_length) < 0;
+		}
+	);
+
+	if (it == std::end(this->entries) or
+	    compare_path(data + it->path_offset, it->path_length, path, path_length) != 0) {
+		return nullptr;
+	}
+
+	*size = it->size;
+	return data + it->offset;
+}
+
+
+size_t AssetPack::get_file_count() const {
+	return this->entries.size();
+}
+
+
+const std::string &AssetPack::get_filename() const {
+	return this->filename;
+}
+
+
+void mount_asset_pack(const std::string &dir, std::shared_ptr<const AssetPack> pack) {
+	std::string prefix = mount_prefix(dir);
+
+	mounted_packs &mounted = get_mounted_packs();
+	std::lock_guard<std::mutex> lock{mounted.mutex};
+
+	for (auto &entry : mounted.packs) {
+		if (entry.first == prefix) {
+			entry.second = std::move(pack);
+			return;
+		}
+	}
+	mounted.packs.emplace_back(prefix, std::move(pack));
+}
+
+
+void unmount_asset_pack(const std::string &dir) {
+	std::string prefix = mount_prefix(dir);
+
+	mounted_packs &mounted = get_mounted_packs();
+	std::lock_guard<std::mutex> lock{mounted.mutex};
+
+	mounted.packs.erase(
+		std::remove_if(
+			std::begin(mounted.packs), std::end(mounted.packs),
+			[&](const std::pair<std::string, std::shared_ptr<const AssetPack>> &entry) {
+				return entry.first == prefix;
+			}
+		),
+		std::end(mounted.packs)
+	);
+}
+
+
+packed_file find_packed_file(const std::string &filename) {
+	packed_file result;
+
+	mounted_packs &mounted = get_mounted_packs();
+	std::lock_guard<std::mutex> lock{mounted.mutex};
+
+	for (auto &entry : mounted.packs) {
+		const std::string &prefix = entry.first;
+		if (filename.compare(0, prefix.size(), prefix) != 0) {
+			continue;
+		}
+
+		// the paths are joined from directories that may end
+		// with a slash already, e.g. "converted/sounds/"
+		std::string path;
+		path.reserve(filename.size() - prefix.size());
+		for (size_t i = prefix.size(); i < filename.size(); i++) {
+			if (filename[i] != '/' or (not path.empty() and path.back() != '/')) {
+				path.push_back(filename[i]);
+			}
+		}
+
+		result.data = entry.second->find(path.data(), path.size(), &result.size);
+		if (result.data != nullptr) {
+			result.pack = entry.second;
+			return result;
+		}
+	}
+
+	return result;
+}
+
+}} // openage::util
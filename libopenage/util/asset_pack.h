@@ -0,0 +1,124 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openage {
+namespace util {
+
+/**
+ * name of the asset pack in the converted asset directory,
+ * see openage/convert/asset_pack.py.
+ */
+constexpr const char *asset_pack_filename = "assets.pack";
+
+
+/**
+ * header of an asset pack, all values are little endian.
+ */
+struct asset_pack_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t file_count;
+	uint32_t alignment;
+};
+
+
+/**
+ * index entry of a packed file, sorted by path.
+ * offsets are relative to the start of the pack.
+ */
+struct asset_pack_entry {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t path_offset;
+	uint32_t path_length;
+};
+
+
+/**
+ * The converted assets packed into one file by the converter,
+ * which is mapped into memory, so loading them needs no open and
+ * stat calls for each file.
+ *
+ * The contents of each file start at a multiple of the pack's
+ * alignment, so texture levels and pcm data can be used in place.
+ */
+class AssetPack {
+public:
+	/**
+	 * map the pack into memory and validate its index.
+	 * throws an Error if the file is invalid.
+	 */
+	AssetPack(const std::string &filename);
+	~AssetPack();
+
+	AssetPack(const AssetPack &) = delete;
+	AssetPack &operator =(const AssetPack &) = delete;
+
+	/**
+	 * the contents of the file at the given path relative to the
+	 * directory of the pack, nullptr if it was not packed.
+	 */
+	const char *find(const char *path, size_t path_length, size_t *size) const;
+
+	size_t get_file_count() const;
+
+	const std::string &get_filename() const;
+
+private:
+	void unmap();
+
+	std::string filename;
+
+	void *mapping;
+	size_t mapping_size;
+
+	/**
+	 * the index, copied out of the mapping for alignment.
+	 */
+	std::vector<asset_pack_entry> entries;
+};
+
+
+/**
+ * A file found in a mounted asset pack.
+ * Holds a reference to the pack, so the data stays mapped
+ * while it is used, even if the pack is unmounted.
+ */
+struct packed_file {
+	std::shared_ptr<const AssetPack> pack;
+	const char *data = nullptr;
+	size_t size = 0;
+
+	explicit operator bool() const {
+		return this->data != nullptr;
+	}
+};
+
+
+/**
+ * make the files of the pack available below the given directory.
+ * the file functions of util/file.h, the textures and the sounds
+ * look there before they access the disk.
+ * replaces the pack that was mounted at that directory before.
+ */
+void mount_asset_pack(const std::string &dir, std::shared_ptr<const AssetPack> pack);
+
+/**
+ * remove the pack mounted at the given directory, if any.
+ */
+void unmount_asset_pack(const std::string &dir);
+
+/**
+ * look up a file in the mounted asset packs by its full path.
+ * evaluates to false if no pack contains it.
+ */
+packed_file find_packed_file(const std::string &filename);
+
+}} // openage::util
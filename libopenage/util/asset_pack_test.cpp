@@ -0,0 +1,144 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "asset_pack.h"
+
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+#include "file.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+namespace {
+
+constexpr uint32_t alignment = 64;
+
+
+template<typename T>
+void append(std::string &out, const T &value) {
+	out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+
+/**
+ * an asset pack of the given files, as written by the converter.
+ * the files have to be sorted by their path.
+ */
+std::string make_asset_pack(const std::vector<std::pair<std::string, std::string>> &files) {
+	std::string paths;
+	std::string contents;
+	std::vector<asset_pack_entry> entries;
+
+	size_t paths_offset = sizeof(asset_pack_header) + files.size() * sizeof(asset_pack_entry);
+	for (auto &file : files) {
+		paths += file.first;
+	}
+
+	size_t data_offset = paths_offset + paths.size();
+	data_offset += (alignment - data_offset % alignment) % alignment;
+
+	size_t path_offset = paths_offset;
+	for (auto &file : files) {
+		contents.resize(contents.size() + (alignment - contents.size() % alignment) % alignment, '\0');
+		entries.push_back(asset_pack_entry{
+			data_offset + contents.size(), file.second.size(),
+			static_cast<uint32_t>(path_offset), static_cast<uint32_t>(file.first.size())
+		});
+		contents += file.second;
+		path_offset += file.first.size();
+	}
+
+	std::string out = "OGAP";
+	append<uint32_t>(out, 1);
+	append<uint32_t>(out, files.size());
+	append<uint32_t>(out, alignment);
+	for (auto &entry : entries) {
+		append(out, entry);
+	}
+	out += paths;
+	out.resize(data_offset, '\0');
+
+	return out + contents;
+}
+
+
+std::string write_temp_file(const std::string &content) {
+	char filename[] = "/tmp/openage-asset-pack-XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0) {
+		TESTFAILMSG("could not create a temporary file");
+	}
+
+	if (write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())) {
+		close(fd);
+		TESTFAILMSG("could not write the temporary file");
+	}
+	close(fd);
+
+	return filename;
+}
+
+} // anonymous namespace
+
+
+void asset_pack() {
+	std::string filename = write_temp_file(make_asset_pack({
+		{"gamedata/terrain.docx", "1,2,3\n4,5,6\n"},
+		{"graphics/1.png", "not really a png"},
+		{"sounds/1.opus", ""},
+	}));
+
+	auto pack = std::make_shared<AssetPack>(filename);
+	unlink(filename.c_str());
+
+	TESTEQUALS(pack->get_file_count(), 3);
+
+	// the contents are found in place, and aligned
+	size_t size;
+	const char *data = pack->find("graphics/1.png", 14, &size);
+	(data != nullptr) or TESTFAIL;
+	TESTEQUALS(std::string(data, size), "not really a png");
+	TESTEQUALS(reinterpret_cast<uintptr_t>(data) % alignment, 0);
+	(pack->find("graphics/2.png", 14, &size) == nullptr) or TESTFAIL;
+	(pack->find("graphics", 8, &size) == nullptr) or TESTFAIL;
+
+	// the file functions find the files below the mounted directory
+	mount_asset_pack("/packtest/converted", pack);
+	pack = nullptr;
+
+	TESTEQUALS(file_size("/packtest/converted/gamedata/terrain.docx"), 12);
+	TESTEQUALS(file_size("/packtest/converted/sounds//1.opus"), 0);
+	TESTEQUALS(file_size("/packtest/converted/sounds/2.opus"), -1);
+	TESTEQUALS(file_get_lines("/packtest/converted/gamedata/terrain.docx").size(), 2);
+
+	packed_file packed = find_packed_file("/packtest/converted/graphics/1.png");
+	packed or TESTFAIL;
+
+	// the data stays valid while it is used
+	unmount_asset_pack("/packtest/converted/");
+	(not find_packed_file("/packtest/converted/graphics/1.png")) or TESTFAIL;
+	TESTEQUALS(std::string(packed.data, packed.size), "not really a png");
+
+	// invalid packs are rejected
+	std::string truncated = make_asset_pack({{"a", "b"}});
+	truncated.resize(sizeof(asset_pack_header) + 4);
+	filename = write_temp_file(truncated);
+	bool rejected = false;
+	try {
+		AssetPack invalid{filename};
+	}
+	catch (Error &) {
+		rejected = true;
+	}
+	unlink(filename.c_str());
+	rejected or TESTFAIL;
+}
+
+}}} // openage::util::tests
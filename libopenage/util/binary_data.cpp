@@ -0,0 +1,213 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "binary_data.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "../error/error.h"
+#include "asset_pack.h"
+
+namespace openage {
+namespace util {
+
+namespace {
+
+constexpr uint32_t binary_data_version = 1;
+
+} // anonymous namespace
+
+
+BinaryRow::BinaryRow(const char *data, const BinaryDataFile *file)
+	:
+	data{data},
+	file{file} {}
+
+
+std::string BinaryRow::get_string(size_t offset) const {
+	uint32_t pool_offset, length;
+	this->get(offset, pool_offset);
+	this->get(offset + sizeof(uint32_t), length);
+	return this->file->get_string(pool_offset, length);
+}
+
+
+void BinaryRow::get_string(size_t offset, std::string &out) const {
+	uint32_t pool_offset, length;
+	this->get(offset, pool_offset);
+	this->get(offset + sizeof(uint32_t), length);
+	out.assign(this->file->get_chars(pool_offset, length), length);
+}
+
+
+void BinaryRow::get_chars(size_t offset, char *out, size_t size) const {
+	uint32_t pool_offset, length;
+	this->get(offset, pool_offset);
+	this->get(offset + sizeof(uint32_t), length);
+
+	size_t copied = std::min<size_t>(length, size - 1);
+	memcpy(out, this->file->get_chars(pool_offset, length), copied);
+	out[copied] = '\0';
+}
+
+
+void BinaryRow::get_string_id(size_t offset, StringId &out) const {
+	uint32_t pool_offset, length;
+	this->get(offset, pool_offset);
+	this->get(offset + sizeof(uint32_t), length);
+	out = StringId::intern(this->file->get_chars(pool_offset, length), length);
+}
+
+
+BinaryDataFile::BinaryDataFile(const Dir &basedir, const std::string &filename)
+	:
+	filename{filename},
+	mapping{nullptr},
+	mapping_size{0},
+	pool{nullptr},
+	pool_size{0} {
+
+	const char *data;
+
+	// the converted gamedata may be in an asset pack
+	this->packed = find_packed_file(filename);
+	if (this->packed) {
+		if (this->packed.size < sizeof(binary_data_header)) {
+			throw Error(MSG(err) << "Binary data file is too small: " << filename);
+		}
+		data = this->packed.data;
+		this->mapping_size = this->packed.size;
+	}
+	else {
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw Error(MSG(err) << "Could not open binary data file " << filename);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) < 0 or st.st_size < static_cast<off_t>(sizeof(binary_data_header))) {
+			close(fd);
+			throw Error(MSG(err) << "Binary data file is too small: " << filename);
+		}
+
+		this->mapping_size = st.st_size;
+		this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		// the mapping stays valid without the descriptor
+		close(fd);
+
+		if (this->mapping == MAP_FAILED) {
+			this->mapping = nullptr;
+			throw Error(MSG(err) << "Could not map binary data file " << filename);
+		}
+
+		data = static_cast<const char *>(this->mapping);
+	}
+
+	binary_data_header header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, "OGDB", 4) != 0 or
+	    header.version != binary_data_version) {
+		this->unmap();
+		throw Error(MSG(err) << "Unknown binary data format in " << filename);
+	}
+
+	uint64_t table_end = sizeof(header) + uint64_t{header.file_count} * sizeof(binary_data_entry);
+	if (table_end > header.pool_offset or header.pool_offset > this->mapping_size) {
+		this->unmap();
+		throw Error(MSG(err) << "Truncated binary data file " << filename);
+	}
+
+	this->pool = data + header.pool_offset;
+	this->pool_size = this->mapping_size - header.pool_offset;
+
+	for (uint32_t i = 0; i < header.file_count; i++) {
+		binary_data_entry entry;
+		memcpy(&entry, data + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+		uint64_t rows_end = entry.rows_offset + uint64_t{entry.row_count} * entry.row_size;
+		if (rows_end > header.pool_offset or
+		    uint64_t{entry.name_offset} + entry.name_length > this->pool_size) {
+			this->unmap();
+			throw Error(MSG(err) << "Invalid table in binary data file " << filename);
+		}
+
+		std::string name{this->pool + entry.name_offset, entry.name_length};
+
+		// keyed like the files of a multi csv file
+		this->tables[basedir.join(name) + ".docx"] = table{
+			entry.row_count,
+			entry.row_size,
+			entry.member_count,
+			data + entry.rows_offset
+		};
+	}
+}
+
+
+BinaryDataFile::~BinaryDataFile() {
+	this->unmap();
+}
+
+
+void BinaryDataFile::unmap() {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+		this->mapping = nullptr;
+	}
+}
+
+
+bool BinaryDataFile::usable_for(const std::string &filename, const std::string &csv_filename) {
+	// the pack is written after the conversion, like the binary file
+	if (find_packed_file(filename)) {
+		return true;
+	}
+
+	struct stat binary_st;
+	if (stat(filename.c_str(), &binary_st) < 0) {
+		return false;
+	}
+
+	// csv files edited after the conversion take precedence
+	struct stat csv_st;
+	if (stat(csv_filename.c_str(), &csv_st) < 0) {
+		return true;
+	}
+	return binary_st.st_mtime >= csv_st.st_mtime;
+}
+
+
+const BinaryDataFile::table *BinaryDataFile::find(const std::string &filename) const {
+	auto it = this->tables.find(filename);
+	if (it == std::end(this->tables)) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+
+std::string BinaryDataFile::get_string(uint32_t offset, uint32_t length) const {
+	return std::string{this->get_chars(offset, length), length};
+}
+
+
+const char *BinaryDataFile::get_chars(uint32_t offset, uint32_t length) const {
+	if (uint64_t{offset} + length > this->pool_size) {
+		throw Error(MSG(err) << "String out of bounds in binary data file " << this->filename);
+	}
+	return this->pool + offset;
+}
+
+
+const std::string &BinaryDataFile::get_filename() const {
+	return this->filename;
+}
+
+}} // openage::util
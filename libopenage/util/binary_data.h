@@ -0,0 +1,205 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "../error/error.h"
+#include "asset_pack.h"
+#include "dir.h"
+#include "string_id.h"
+
+namespace openage {
+namespace util {
+
+class BinaryDataFile;
+
+
+/**
+ * file header of a binary data file,
+ * written by openage/convert/dataformat/binary_data.py.
+ * all values are little endian.
+ */
+struct binary_data_header {
+	char magic[4];           //!< "OGDB"
+	uint32_t version;
+	uint32_t file_count;     //!< number of tables, followed by their entries
+	uint32_t pool_offset;    //!< position of the string pool in the file
+};
+
+/**
+ * one packed data file in the table after the header.
+ */
+struct binary_data_entry {
+	uint32_t name_offset;    //!< data file name in the string pool
+	uint32_t name_length;
+	uint32_t row_count;
+	uint32_t row_size;       //!< bytes per row, all rows have the same layout
+	uint32_t member_count;   //!< number of struct members stored per row
+	uint32_t rows_offset;    //!< position of the first row in the file
+};
+
+
+/**
+ * One struct stored in a binary data file.
+ *
+ * The generated gamedata structs fill themselves from it, the member
+ * offsets are known when the structs are generated.
+ */
+class BinaryRow {
+public:
+	BinaryRow(const char *data, const BinaryDataFile *file);
+
+	/**
+	 * copy a number member from the given row offset.
+	 */
+	template<typename T>
+	void get(size_t offset, T &value) const {
+		memcpy(&value, this->data + offset, sizeof(T));
+	}
+
+	/**
+	 * read a string member, stored as its position in the string pool.
+	 */
+	std::string get_string(size_t offset) const;
+
+	/**
+	 * read a string member into the given string,
+	 * which keeps its memory if the text fits.
+	 */
+	void get_string(size_t offset, std::string &out) const;
+
+	/**
+	 * read a string member into a char array member of the given size,
+	 * truncated and null terminated.
+	 */
+	void get_chars(size_t offset, char *out, size_t size) const;
+
+	/**
+	 * read a string member and intern it. names are stored once
+	 * for all tables, and compare like integers afterwards.
+	 */
+	void get_string_id(size_t offset, StringId &out) const;
+
+private:
+	const char *data;
+	const BinaryDataFile *file;
+};
+
+
+/**
+ * Gamedata structs stored with the layout of the generated C++ structs,
+ * packed into one file by the converter next to the multi csv file.
+ *
+ * The file is mapped into memory. Reading a struct copies its members
+ * instead of parsing text, the strings are kept in a shared pool.
+ */
+class BinaryDataFile {
+public:
+	/**
+	 * one data file of the tree, as read by read_csv_file.
+	 */
+	struct table {
+		size_t row_count;
+		size_t row_size;
+		size_t member_count;
+		const char *rows;
+	};
+
+	/**
+	 * map the binary data file into memory and validate it,
+	 * or use it from a mounted asset pack.
+	 * the tables are looked up like the csv files
+	 * relative to basedir, with the .docx suffix.
+	 * throws an Error if the file is invalid.
+	 */
+	BinaryDataFile(const Dir &basedir, const std::string &filename);
+	~BinaryDataFile();
+
+	BinaryDataFile(const BinaryDataFile &) = delete;
+	BinaryDataFile &operator =(const BinaryDataFile &) = delete;
+
+	/**
+	 * whether the binary data file exists and
+	 * is not older than the multi csv file.
+	 */
+	static bool usable_for(const std::string &filename, const std::string &csv_filename);
+
+	/**
+	 * the table for a data file name, nullptr if it was not packed.
+	 */
+	const table *find(const std::string &filename) const;
+
+	/**
+	 * a string from the pool, throws an Error if it's out of bounds.
+	 */
+	std::string get_string(uint32_t offset, uint32_t length) const;
+
+	/**
+	 * the characters of a string in the pool, not null terminated.
+	 * throws an Error if they're out of bounds.
+	 */
+	const char *get_chars(uint32_t offset, uint32_t length) const;
+
+	const std::string &get_filename() const;
+
+private:
+	void unmap();
+
+	std::string filename;
+
+	void *mapping;
+	size_t mapping_size;
+
+	/**
+	 * keeps the asset pack mapped if the file is read from one.
+	 */
+	packed_file packed;
+
+	const char *pool;
+	size_t pool_size;
+
+	std::unordered_map<std::string, table> tables;
+};
+
+/**
+ * One number member of all rows of a binary data table, read from
+ * the mapped file without filling the structs, e.g.
+ * BinaryColumn<int32_t>{table, gamedata::graphic::binary_offsets::graphic_id}.
+ */
+template<typename T>
+class BinaryColumn {
+public:
+	BinaryColumn(const BinaryDataFile::table &table, size_t offset)
+		:
+		data{table.rows + offset},
+		stride{table.row_size},
+		count{table.row_count} {
+
+		if (offset + sizeof(T) > table.row_size) {
+			throw Error(MSG(err) << "Binary data column at " << offset
+			            << " exceeds rows of " << table.row_size << " bytes");
+		}
+	}
+
+	size_t size() const {
+		return this->count;
+	}
+
+	T operator [](size_t row) const {
+		T value;
+		memcpy(&value, this->data + row * this->stride, sizeof(T));
+		return value;
+	}
+
+private:
+	const char *data;
+	size_t stride;
+	size_t count;
+};
+
+}} // openage::util
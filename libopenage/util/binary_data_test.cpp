@@ -0,0 +1,166 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "binary_data.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+#include "file.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+namespace {
+
+/**
+ * struct like the generated gamedata ones, with a number and a string.
+ */
+struct test_line {
+	int32_t number;
+	std::string text;
+
+	static constexpr size_t member_count = 2;
+	static constexpr size_t binary_row_size = 12;
+	struct binary_offsets {
+		static constexpr size_t number = 0;
+		static constexpr size_t text = 4;
+	};
+
+	int fill(char * /*by_line*/) {
+		return 0;
+	}
+
+	int fill(const BinaryRow &row) {
+		row.get(binary_offsets::number, this->number);
+		row.get_string(binary_offsets::text, this->text);
+		return -1;
+	}
+};
+
+constexpr size_t test_line::member_count;
+constexpr size_t test_line::binary_row_size;
+constexpr size_t test_line::binary_offsets::number;
+constexpr size_t test_line::binary_offsets::text;
+
+
+template<typename T>
+void append(std::string &out, const T &value) {
+	out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+
+/**
+ * a binary data file with one table of two rows,
+ * as written by the converter.
+ */
+std::string make_binary_data(uint32_t member_count) {
+	std::string pool = "tablehelloworld";
+	uint32_t pool_offset = sizeof(binary_data_header) + sizeof(binary_data_entry) + 2 * 12;
+
+	std::string out = "OGDB";
+	append<uint32_t>(out, 1);
+	append<uint32_t>(out, 1);
+	append<uint32_t>(out, pool_offset);
+
+	binary_data_entry entry{0, 5, 2, 12, member_count, sizeof(binary_data_header) + sizeof(binary_data_entry)};
+	append(out, entry);
+
+	// rows: number, text offset, text length
+	for (auto &row : std::vector<std::vector<uint32_t>>{{42, 5, 5}, {1337, 10, 5}}) {
+		for (uint32_t value : row) {
+			append(out, value);
+		}
+	}
+
+	return out + pool;
+}
+
+
+std::string write_temp_file(const std::string &content) {
+	char filename[] = "/tmp/openage-binary-data-XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd < 0) {
+		TESTFAILMSG("could not create a temporary file");
+	}
+
+	if (write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())) {
+		close(fd);
+		TESTFAILMSG("could not write the temporary file");
+	}
+	close(fd);
+
+	return filename;
+}
+
+} // anonymous namespace
+
+
+void binary_data() {
+	Dir basedir{"/data"};
+
+	std::string filename = write_temp_file(make_binary_data(2));
+
+	data_file_map map;
+	map.binary = std::make_unique<BinaryDataFile>(basedir, filename);
+	unlink(filename.c_str());
+
+	// the tables are found like the files of a multi csv file
+	(map.binary->find("/data/table.docx") != nullptr) or TESTFAIL;
+	(map.binary->find("/data/other.docx") == nullptr) or TESTFAIL;
+
+	std::vector<test_line> lines;
+	read_csv_file("/data/table.docx", lines, &map);
+
+	TESTEQUALS(lines.size(), 2);
+	TESTEQUALS(lines[0].number, 42);
+	TESTEQUALS(lines[0].text, "hello");
+	TESTEQUALS(lines[1].number, 1337);
+	TESTEQUALS(lines[1].text, "world");
+
+	// one member of all rows, without the structs
+	const BinaryDataFile::table *table = map.binary->find("/data/table.docx");
+	BinaryColumn<int32_t> numbers{*table, test_line::binary_offsets::number};
+	TESTEQUALS(numbers.size(), 2);
+	TESTEQUALS(numbers[1], 1337);
+
+	// char array members are truncated
+	char chars[4];
+	BinaryRow{table->rows, map.binary.get()}.get_chars(test_line::binary_offsets::text, chars, sizeof(chars));
+	TESTEQUALS(std::string{chars}, "hel");
+
+	// a table with a different struct layout is rejected
+	filename = write_temp_file(make_binary_data(3));
+	data_file_map outdated;
+	outdated.binary = std::make_unique<BinaryDataFile>(basedir, filename);
+	unlink(filename.c_str());
+
+	lines.clear();
+	bool rejected = false;
+	try {
+		read_csv_file("/data/table.docx", lines, &outdated);
+	}
+	catch (Error &) {
+		rejected = true;
+	}
+	rejected or TESTFAIL;
+
+	// so is a file that isn't a binary data file
+	filename = write_temp_file("not a binary data file");
+	bool invalid = false;
+	try {
+		BinaryDataFile file{basedir, filename};
+	}
+	catch (Error &) {
+		invalid = true;
+	}
+	unlink(filename.c_str());
+	invalid or TESTFAIL;
+}
+
+}}} // openage::util::tests
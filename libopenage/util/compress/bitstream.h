@@ -1,7 +1,8 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 
 #include <functional>
@@ -64,6 +65,15 @@ using read_callback_t = std::function<size_t (unsigned char *buf, size_t size)>;
  * the appropriate amount of nullbits/nullbytes.
  * Calling the modeswitch methods while already in the respective mode does
  * nothing.
+ *
+ * Refilling
+ * ---------
+ *
+ * The bit buffer holds up to 64 bits. When it runs low, it is refilled
+ * with as many 16-bit values as fit from the bytes that are already in
+ * the input buffer, so most symbols are decoded without a refill.
+ * The read callback is still only invoked when the requested bits are not
+ * available otherwise.
  */
 template<unsigned int inbuf_size>
 class BitStream {
@@ -79,11 +89,19 @@ private:
 	 */
 	read_callback_t read_callback;
 
+	/**
+	 * The last bytes of the previous read are kept in front of the input
+	 * buffer, so the bytes that were read ahead into the bit buffer
+	 * can be handed back when switching to bytestream mode.
+	 */
+	static constexpr unsigned int inbuf_keep = sizeof(uint64_t);
+
 	/**
 	 * Input byte buffer.
 	 * Used by both modes (via ensure_bits and read_bytes).
+	 * The callback reads to inbuf + inbuf_keep.
 	 */
-	unsigned char inbuf[inbuf_size];
+	unsigned char inbuf[inbuf_keep + inbuf_size];
 
 	/**
 	 * Pointer to current position in inbuf.
@@ -97,11 +115,11 @@ private:
 
 	/**
 	 * Bit buffer; used in bitstream mode.
-	 * Filled by via get_next_byte() via ensure_bits(),
+	 * Filled by via load_next_16_bits() via ensure_bits(),
 	 * read by peak_bits(),
 	 * cleared by remove_bits().
 	 */
-	unsigned int bit_buffer;
+	uint64_t bit_buffer;
 
 	/**
 	 * The number of valid bits in bit_buffer.
@@ -140,8 +158,12 @@ private:
 	void ensure_input_bytes() {
 		// check if we need to actually read some bytes.
 		if (this->input_bytes_available() == 0) {
+			// keep the tail of the consumed bytes, see inbuf_keep.
+			memmove(this->inbuf, this->i_end - inbuf_keep, inbuf_keep);
+			unsigned char *buf = &this->inbuf[inbuf_keep];
+
 			// fill the entire input buffer.
-			size_t read_bytes = this->read_callback(this->inbuf, inbuf_size);
+			size_t read_bytes = this->read_callback(buf, inbuf_size);
 
 			// we might overrun the input stream by asking for bits we don't use,
 			// so fake 2 more bytes at the end of input
@@ -150,8 +172,8 @@ private:
 					throw Error(MSG(err) << "Unexpected EOF in the middle of a block");
 				} else {
 					read_bytes = 2;
-					this->inbuf[0] = 0;
-					this->inbuf[1] = 0;
+					buf[0] = 0;
+					buf[1] = 0;
 					this->eof = true;
 				}
 			}
@@ -161,8 +183,8 @@ private:
 			}
 
 			// update i_ptr and i_end
-			this->i_ptr = this->inbuf;
-			this->i_end = &this->inbuf[read_bytes];
+			this->i_ptr = buf;
+			this->i_end = &buf[read_bytes];
 		}
 
 		// check if the reading was successful.
@@ -186,36 +208,63 @@ private:
 		// example: input stream contains bytes A, B. previous byte was J.
 		//
 		// 5 bits are left
-		// bit buffer is:                     jjjjj000 00000000 00000000 00000000
+		// bit buffer is:                     jjjjj000 00000000 00000000 ...
 		//
 		// ensure_bits(9) is called.
 		// b0 = aaaaaaaa
 		// b1 = bbbbbbbb
-		// bit_buffer |= bbbbbbbb aaaaaaaa << (32 - 16 - 5) == 11
+		// bit_buffer |= bbbbbbbb aaaaaaaa << (64 - 16 - 5) == 43
 		//
-		// new bit buffer:                    jjjjjbbb bbbbbaaa aaaaa000 00000000
+		// new bit buffer:                    jjjjjbbb bbbbbaaa aaaaa000 ...
 
 		// read two bytes to b0, b1
-		this->ensure_input_bytes();
-		unsigned char b0 = *i_ptr++;
-		this->ensure_input_bytes();
-		unsigned char b1 = *i_ptr++;
+		unsigned char b0, b1;
+		if (likely(this->i_end - this->i_ptr >= 2)) {
+			b0 = i_ptr[0];
+			b1 = i_ptr[1];
+			i_ptr += 2;
+		} else {
+			this->ensure_input_bytes();
+			b0 = *i_ptr++;
+			this->ensure_input_bytes();
+			b1 = *i_ptr++;
+		}
 
 		// inject bits into bit_buffer
-		bit_buffer |= ((b1 << 8) | b0) << (sizeof(bit_buffer) * 8 - 16 - bits_left);
+		bit_buffer |= static_cast<uint64_t>((b1 << 8) | b0) << (sizeof(bit_buffer) * 8 - 16 - bits_left);
 		bits_left += 16;
 	}
 
+	/**
+	 * for use in bitstream mode.
+	 *
+	 * loads as many 16-bit values from the input buffer as fit into the
+	 * bit buffer, without invoking the read callback.
+	 */
+	void refill_bits() {
+		while (bits_left <= sizeof(bit_buffer) * 8 - 16 and this->i_end - this->i_ptr >= 2) {
+			bit_buffer |= static_cast<uint64_t>((i_ptr[1] << 8) | i_ptr[0]) << (sizeof(bit_buffer) * 8 - 16 - bits_left);
+			bits_left += 16;
+			i_ptr += 2;
+		}
+	}
+
 	/**
 	 * for use in bitstream mode.
 	 *
 	 * ensures there are at least nbits bits in the bit buffer.
 	 */
 	inline void ensure_bits(unsigned int nbits) {
+		// in bytestream mode, the bit buffer is empty.
+		if (likely(bits_left >= nbits)) {
+			return;
+		}
+
 		if (unlikely(!this->bitstream_mode)) {
 			throw Error(MSG(err) << "instream: attempted to ensure bits while in bytestream mode");
 		}
 
+		this->refill_bits();
 		while (bits_left < nbits) {
 			this->load_next_16_bits();
 		}
@@ -227,11 +276,11 @@ private:
 	 * returns nbits bits from the bit buffer, without removing them.
 	 */
 	unsigned peek_bits(unsigned int nbits) {
-		// example: bit buffer is:   abcdefgh ijkl0000 00000000 00000000
+		// example: bit buffer is:   abcdefgh ijkl0000 00000000 ...
 		//
 		// peek_bits(3) is called.
 		//
-		// return (bit_buffer >> (32 - 3) == 29
+		// return (bit_buffer >> (64 - 3) == 61
 		//
 		// returned value is:        abc
 		this->ensure_bits(nbits);
@@ -245,13 +294,13 @@ private:
 	 * removes nbits bits from the bit buffer.
 	 */
 	void remove_bits(unsigned int nbits) {
-		// example: bit buffer is:  abcdefgh ijkl0000 00000000 00000000
+		// example: bit buffer is:  abcdefgh ijkl0000 00000000 ...
 		//
 		// remove_bits(3) is called.
 		//
 		// bit_buffer <<= 3
 		//
-		// resulting bit buffer is: defghijk l0000000 00000000 00000000
+		// resulting bit buffer is: defghijk l0000000 00000000 ...
 		this->ensure_bits(nbits);
 
 		bit_buffer <<= nbits;
@@ -296,8 +345,8 @@ public:
 		:
 		eof{false},
 		read_callback{read_callback},
-		i_ptr{inbuf},
-		i_end{inbuf},
+		i_ptr{&inbuf[inbuf_keep]},
+		i_end{&inbuf[inbuf_keep]},
 		bit_buffer{0},
 		bits_left{0},
 		stream_position{0},
@@ -305,6 +354,8 @@ public:
 
 		static_assert(inbuf_size >= 2, "inbuf size must be at least 2");
 		static_assert(inbuf_size % 2 == 0, "inbuf size must be even");
+
+		memset(this->inbuf, 0, inbuf_keep);
 	}
 
 	/**
@@ -412,12 +463,18 @@ public:
 		// thus, discard an additional bit.
 		this->align_bitstream(1);
 
-		this->bitstream_mode = false;
-		this->stream_position = 0;
-
-		if (this->bits_left) {
+		if (unlikely(this->bits_left % 16 != 0)) {
 			throw Error(MSG(err) << "bits left after switching to bytestream mode: " << this->bits_left);
 		}
+
+		// hand back the bytes that were read ahead into the bit buffer.
+		// they are still in the input buffer, see inbuf_keep.
+		this->i_ptr -= this->bits_left / 8;
+		this->bit_buffer = 0;
+		this->bits_left = 0;
+
+		this->bitstream_mode = false;
+		this->stream_position = 0;
 	}
 
 	/**
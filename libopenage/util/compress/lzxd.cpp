@@ -1,7 +1,7 @@
 // This file was adapted from cabextract/libmspack <http://www.cabextract.org.uk/>,
 // Copyright 2003-2013 the cabextract contributors.
 // It's licensed under the terms of the GNU Library General Public License version 2.
-// Modifications Copyright 2014-2015 the openage authors.
+// Modifications Copyright 2014-2017 the openage authors.
 // See copying.md for further legal info.
 
 /*
@@ -12,6 +12,8 @@
 
 #include "lzxd.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <cerrno>
 #include <cstdarg>
@@ -20,11 +22,16 @@
 #include <cstdlib>
 #include <cstring>
 #include <climits>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <unistd.h>
 
 #include "../../error/error.h"
 #include "../compiler.h"
+#include "../timing.h"
 
 #include "bitstream.h"
 
@@ -244,16 +251,21 @@ public:
 
 template<unsigned int maxsymbols_p, unsigned int tablebits_p, bool allow_empty>
 int HuffmanTable<maxsymbols_p, tablebits_p, allow_empty>::read_sym() {
+	// one refill provides the bits of the longest code,
+	// the table lookup and the walk read them from the bit buffer directly.
 	lzx->bits.ensure_bits(HUFF_MAXBITS);
-	uint16_t sym = table[lzx->bits.peek_bits(tablebits)];
-
-	unsigned i = 1 << (sizeof(lzx->bits.bit_buffer) * 8 - tablebits);
-	while (sym >= maxsymbols) {
-		// huff_traverse
-		if (unlikely((i >>= 1) == 0)) {
-			throw Error(MSG(err) << "huff_error in huff_traverse");
-		}
-		sym = table[(sym << 1) | ((lzx->bits.bit_buffer & i) ? 1 : 0)];
+	uint64_t bits = lzx->bits.bit_buffer;
+	uint16_t sym = table[bits >> (sizeof(bits) * 8 - tablebits)];
+
+	if (unlikely(sym >= maxsymbols)) {
+		uint64_t i = static_cast<uint64_t>(1) << (sizeof(bits) * 8 - tablebits);
+		do {
+			// huff_traverse
+			if (unlikely((i >>= 1) == 0)) {
+				throw Error(MSG(err) << "huff_error in huff_traverse");
+			}
+			sym = table[(sym << 1) | ((bits & i) ? 1 : 0)];
+		} while (sym >= maxsymbols);
 	}
 
 	lzx->bits.remove_bits(len[sym]);
@@ -935,4 +947,150 @@ unsigned LZXDecompressor::decompress_next_frame(unsigned char *output_buf) {
 }
 
 
+namespace {
+
+/**
+ * Decodes the output from start_frame on, until output_size bytes are written
+ * or the stream ends. The input must begin at a reset of the stream, or at
+ * its start.
+ */
+size_t decompress_segment(const unsigned char *input, size_t input_size,
+                          unsigned char *output, size_t output_size,
+                          unsigned int window_bits, unsigned int reset_interval,
+                          unsigned int start_frame) {
+
+	size_t input_pos = 0;
+	auto read_callback = [input, input_size, &input_pos](unsigned char *buf, size_t size) -> size_t {
+		size_t count = std::min(size, input_size - input_pos);
+		memcpy(buf, input + input_pos, count);
+		input_pos += count;
+		return count;
+	};
+
+	LZXDStream stream{read_callback, window_bits, reset_interval};
+
+	// the e8 translation and the reset check use the position in the whole stream
+	stream.frame = start_frame;
+	stream.output_pos = static_cast<ssize_t>(start_frame) * LZX_FRAME_SIZE;
+
+	unsigned char last_frame[LZX_FRAME_SIZE];
+	size_t written = 0;
+	while (written < output_size) {
+		size_t remaining = output_size - written;
+
+		// the frames are decoded in place, except the truncated last one
+		unsigned char *target = (remaining >= LZX_FRAME_SIZE) ? output + written : last_frame;
+		unsigned int frame_size = stream.decompress_next_frame(target);
+		if (frame_size == 0) {
+			break;
+		}
+
+		size_t used = std::min<size_t>(frame_size, remaining);
+		if (target == last_frame) {
+			memcpy(output + written, last_frame, used);
+		}
+		written += used;
+	}
+
+	return written;
+}
+
+} // anonymous namespace
+
+
+size_t lzx_decompress_buffer(const unsigned char *input, size_t input_size,
+                             unsigned char *output, size_t output_size,
+                             unsigned int window_bits, unsigned int reset_interval,
+                             const size_t *reset_offsets, size_t reset_count,
+                             unsigned int threads, lzx_decompress_stats *stats) {
+
+	time_nsec_t start = timing::get_monotonic_time();
+
+	// without the reset positions, the stream can only be decoded in one go
+	if (reset_interval == 0 or reset_offsets == nullptr or reset_count < 2) {
+		reset_count = 1;
+	}
+
+	for (size_t i = 0; i < reset_count and reset_count > 1; i++) {
+		if (reset_offsets[i] > input_size or (i > 0 and reset_offsets[i] < reset_offsets[i - 1])) {
+			throw Error(MSG(err) << "invalid lzx reset offset " << reset_offsets[i] << " for segment " << i);
+		}
+	}
+
+	size_t segment_size = static_cast<size_t>(reset_interval) * LZX_FRAME_SIZE;
+	size_t segments = reset_count;
+	if (segments > 1) {
+		// only the resets that produce output are decoded
+		segments = std::min(segments, (output_size + segment_size - 1) / segment_size);
+	}
+
+	if (threads == 0) {
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	threads = static_cast<unsigned int>(std::min<size_t>(threads, std::max<size_t>(segments, 1)));
+
+	std::atomic<size_t> next_segment{0};
+	std::atomic<size_t> total_written{0};
+	std::atomic<bool> failed{false};
+	std::mutex error_mutex;
+	std::exception_ptr error;
+
+	auto worker = [&]() {
+		size_t segment;
+		while (not failed and (segment = next_segment++) < segments) {
+			try {
+				size_t input_offset = (segments > 1) ? reset_offsets[segment] : 0;
+				size_t output_offset = (segments > 1) ? segment * segment_size : 0;
+				size_t length = (segments > 1) ? std::min(segment_size, output_size - output_offset) : output_size;
+
+				size_t written = decompress_segment(
+					input + input_offset, input_size - input_offset,
+					output + output_offset, length,
+					window_bits, reset_interval,
+					(segments > 1) ? segment * reset_interval : 0
+				);
+
+				// all but the last segment fill their share of the output
+				if (written < length and segment + 1 < segments) {
+					throw Error(MSG(err) << "lzx segment " << segment << " ended after " << written << " bytes");
+				}
+
+				total_written += written;
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock{error_mutex};
+				if (not error) {
+					error = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	// the calling thread decodes too
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : workers) {
+		thread.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	if (stats != nullptr) {
+		stats->input_bytes = input_size;
+		stats->output_bytes = total_written;
+		stats->segments = segments;
+		stats->threads = threads;
+		stats->seconds = (timing::get_monotonic_time() - start) / 1e9;
+	}
+
+	return total_written;
+}
+
+
 }}} // openage::util::compress
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -87,4 +87,64 @@ private:
 	LZXDecompressor &operator =(LZXDecompressor &&other) = delete;
 };
 
+
+/**
+ * Throughput of lzx_decompress_buffer.
+ *
+ * pxd:
+ *
+ * cppclass lzx_decompress_stats:
+ *     size_t input_bytes
+ *     size_t output_bytes
+ *     size_t segments
+ *     unsigned threads
+ *     double seconds
+ */
+struct lzx_decompress_stats {
+	size_t input_bytes;     // compressed bytes of the stream
+	size_t output_bytes;    // decompressed bytes written to the output
+	size_t segments;        // independently decoded reset intervals
+	unsigned threads;       // threads that decoded the segments
+	double seconds;         // wall clock time of the decompression
+};
+
+
+/**
+ * Decompresses a whole LZX stream from memory into the output buffer,
+ * which may be a mapped file.
+ *
+ * If the stream resets (reset_interval > 0) and the compressed offsets of
+ * the resets are known, e.g. from a CHM reset table, the reset intervals
+ * are decoded in parallel. Otherwise the stream is decoded serially.
+ *
+ * @param input              the compressed stream.
+ * @param output             receives output_size decompressed bytes.
+ * @param window_bits        see LZXDecompressor.
+ * @param reset_interval     see LZXDecompressor.
+ * @param reset_offsets      position of each reset interval in the input,
+ *                           starting with 0, or nullptr.
+ * @param reset_count        number of reset_offsets.
+ * @param threads            number of decoding threads, 0 uses all cores.
+ * @param stats              receives the throughput, may be nullptr.
+ *
+ * Returns the number of bytes written to the output.
+ * On error, an exception is thrown.
+ *
+ * pxd:
+ *
+ * size_t lzx_decompress_buffer(
+ *     const unsigned char *input, size_t input_size,
+ *     unsigned char *output, size_t output_size,
+ *     unsigned int window_bits, unsigned int reset_interval,
+ *     const size_t *reset_offsets, size_t reset_count,
+ *     unsigned int threads, lzx_decompress_stats *stats
+ * ) except +
+ */
+size_t lzx_decompress_buffer(const unsigned char *input, size_t input_size,
+                             unsigned char *output, size_t output_size,
+                             unsigned int window_bits, unsigned int reset_interval,
+                             const size_t *reset_offsets, size_t reset_count,
+                             unsigned int threads, lzx_decompress_stats *stats);
+
+
 }}} // openage::util::compress
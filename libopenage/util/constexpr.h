@@ -1,7 +1,8 @@
-// Copyright 2014-2016 the openage authors. See copying.md for legal info.
+// Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 
 
@@ -57,6 +58,24 @@ constexpr size_t strlen(const char *str, size_t len = 0) {
 		strlen(str + 1, len + 1);
 }
 
+/**
+ * returns the 64-bit FNV-1a hash of the string literal.
+ *
+ * @param hash  the hash of the preceding characters (used internally for recursing)
+ */
+constexpr uint64_t hash_fnv1a(const char *str, uint64_t hash = 14695981039346656037ull) {
+	// if only c++14 had arrived a little bit earlier...
+
+	return
+
+	*str == '\0' ?
+		// if str is over:
+		hash
+	:
+		// else:
+		hash_fnv1a(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 1099511628211ull);
+}
+
 /**
  * stores a string literal plus a "length specifier".
  *
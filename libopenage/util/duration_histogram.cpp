@@ -0,0 +1,110 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "duration_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../error/error.h"
+#include "strings.h"
+
+namespace openage {
+namespace util {
+
+
+DurationHistogram::DurationHistogram(time_nsec_t bucket_width, size_t bucket_count)
+	:
+	bucket_width{bucket_width},
+	buckets(bucket_count + 1, 0),
+	total_count{0},
+	total_duration{0},
+	max_duration{0} {
+
+	ENSURE(bucket_width > 0, "histogram buckets need a width");
+}
+
+
+void DurationHistogram::add(time_nsec_t duration) {
+	size_t bucket = std::min(static_cast<size_t>(duration / this->bucket_width),
+	                         this->buckets.size() - 1);
+	this->buckets[bucket]++;
+
+	this->total_count++;
+	this->total_duration += duration;
+	this->max_duration = std::max(this->max_duration, duration);
+}
+
+
+void DurationHistogram::clear() {
+	std::fill(this->buckets.begin(), this->buckets.end(), 0);
+	this->total_count = 0;
+	this->total_duration = 0;
+	this->max_duration = 0;
+}
+
+
+uint64_t DurationHistogram::count() const {
+	return this->total_count;
+}
+
+
+time_nsec_t DurationHistogram::mean() const {
+	return this->total_count ? this->total_duration / this->total_count : 0;
+}
+
+
+time_nsec_t DurationHistogram::max() const {
+	return this->max_duration;
+}
+
+
+time_nsec_t DurationHistogram::percentile(double fraction) const {
+	if (this->total_count == 0) {
+		return 0;
+	}
+
+	// the rank of the duration, counted from 1
+	uint64_t rank = std::max<uint64_t>(1, std::ceil(fraction * this->total_count));
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < this->buckets.size() - 1; i++) {
+		seen += this->buckets[i];
+		if (seen >= rank) {
+			return std::min((i + 1) * this->bucket_width, this->max_duration);
+		}
+	}
+
+	return this->max_duration;
+}
+
+
+void DurationHistogram::write_summary(std::ostream &out) const {
+	auto ms = [] (time_nsec_t duration) {
+		return duration / 1e6;
+	};
+
+	out << sformat("%8llu frames, mean %7.3f ms, p50 %7.3f ms, p90 %7.3f ms, "
+	               "p99 %7.3f ms, max %7.3f ms",
+	               static_cast<unsigned long long>(this->total_count),
+	               ms(this->mean()), ms(this->percentile(0.5)),
+	               ms(this->percentile(0.9)), ms(this->percentile(0.99)),
+	               ms(this->max()));
+}
+
+
+void DurationHistogram::write_buckets(std::ostream &out) const {
+	for (size_t i = 0; i < this->buckets.size(); i++) {
+		if (this->buckets[i] == 0) {
+			continue;
+		}
+
+		bool overflow = i == this->buckets.size() - 1;
+		out << sformat("%s%8.3f ms: %llu\n",
+		               overflow ? ">=" : "  ",
+		               i * this->bucket_width / 1e6,
+		               static_cast<unsigned long long>(this->buckets[i]));
+	}
+}
+
+
+}} // openage::util
@@ -0,0 +1,72 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "timing.h"
+
+namespace openage {
+namespace util {
+
+
+/**
+ * Counts durations in buckets of equal width, to report their
+ * distribution after many frames without storing each of them.
+ *
+ * Durations beyond the last bucket are counted in an overflow bucket,
+ * the largest one is kept exactly.
+ */
+class DurationHistogram {
+public:
+	/**
+	 * @param bucket_width: the resolution of the histogram
+	 * @param bucket_count: the durations up to bucket_width * bucket_count are resolved
+	 */
+	DurationHistogram(time_nsec_t bucket_width=50000, size_t bucket_count=1000);
+
+	void add(time_nsec_t duration);
+
+	/**
+	 * forget all added durations.
+	 */
+	void clear();
+
+	uint64_t count() const;
+	time_nsec_t mean() const;
+	time_nsec_t max() const;
+
+	/**
+	 * the upper bound of the bucket that contains the given fraction
+	 * of the durations, e.g. 0.99 for the 99th percentile.
+	 * the exact maximum when it lies in the overflow bucket.
+	 */
+	time_nsec_t percentile(double fraction) const;
+
+	/**
+	 * one line with count, mean, percentiles and max, in milliseconds.
+	 */
+	void write_summary(std::ostream &out) const;
+
+	/**
+	 * the non-empty buckets, one per line: start in milliseconds and count.
+	 */
+	void write_buckets(std::ostream &out) const;
+
+private:
+	time_nsec_t bucket_width;
+
+	/**
+	 * the last one is the overflow bucket.
+	 */
+	std::vector<uint64_t> buckets;
+
+	uint64_t total_count;
+	time_nsec_t total_duration;
+	time_nsec_t max_duration;
+};
+
+
+}} // openage::util
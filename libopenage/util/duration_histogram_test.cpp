@@ -0,0 +1,51 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "duration_histogram.h"
+
+#include <sstream>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+// exported test
+void duration_histogram() {
+	// buckets of 0.1 ms up to 1 ms
+	constexpr time_nsec_t step = 10000;
+	DurationHistogram histogram{10 * step, 10};
+
+	histogram.percentile(0.5) == 0 or TESTFAIL;
+	histogram.mean() == 0 or TESTFAIL;
+
+	for (time_nsec_t i = 0; i < 100; i++) {
+		histogram.add(i * step);
+	}
+	histogram.add(1000 * step);
+
+	histogram.count() == 101 or TESTFAIL;
+	histogram.max() == 1000 * step or TESTFAIL;
+	histogram.mean() == (99 * 100 / 2 + 1000) * step / 101 or TESTFAIL;
+
+	// upper bounds of the buckets
+	histogram.percentile(0) == 10 * step or TESTFAIL;
+	histogram.percentile(0.5) == 60 * step or TESTFAIL;
+	histogram.percentile(0.99) == 100 * step or TESTFAIL;
+
+	// the overflow bucket
+	histogram.percentile(1) == 1000 * step or TESTFAIL;
+
+	std::ostringstream buckets;
+	histogram.write_buckets(buckets);
+	buckets.str().find("     0.000 ms: 10\n     0.100 ms: 10\n") == 0 or TESTFAIL;
+	buckets.str().find(">=   1.000 ms: 1\n") != std::string::npos or TESTFAIL;
+
+	histogram.clear();
+	histogram.count() == 0 or TESTFAIL;
+	histogram.max() == 0 or TESTFAIL;
+}
+
+
+}}} // openage::util::tests
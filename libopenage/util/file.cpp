@@ -11,12 +11,18 @@
 
 #include "../error/error.h"
 #include "../log/log.h"
+#include "asset_pack.h"
 
 
 namespace openage {
 namespace util {
 
 ssize_t file_size(const std::string &filename) {
+	packed_file packed = find_packed_file(filename);
+	if (packed) {
+		return packed.size;
+	}
+
 	struct stat st;
 
 	if (stat(filename.c_str(), &st) < 0) {
@@ -37,6 +43,15 @@ ssize_t read_whole_file(char **result, const std::string &filename) {
 
 ssize_t read_whole_file(char **result, const char *filename) {
 
+	// converted files may be in an asset pack
+	packed_file packed = find_packed_file(filename);
+	if (packed) {
+		*result = new char[packed.size + 1];
+		memcpy(*result, packed.data, packed.size);
+		(*result)[packed.size] = '\0';
+		return packed.size;
+	}
+
 	//get the file size
 	ssize_t content_length = file_size(filename);
 
@@ -94,31 +109,49 @@ std::vector<std::string> file_get_lines(const std::string &file_name) {
 	return result;
 }
 
-csv_file_map_t *csv_file_map = nullptr;
-
-csv_file_map_t *load_multi_csv_file(Dir basedir, const std::string &fname) {
+std::unique_ptr<data_file_map> load_multi_csv_file(Dir basedir, const std::string &fname) {
 	std::string path = basedir.join(fname);
 
 	log::log(MSG(info) << "Loading multi csv file: " << fname);
 	std::vector<std::string> lines = file_get_lines(path);
 
-	csv_file_map_t *map = new csv_file_map_t();
+	auto map = std::make_unique<data_file_map>();
 
 	std::string current_file = "";
 	for (auto& line : lines) {
 		if (line[0] == '#' && line[1] == '#' && line[2] == ' ') {
 			current_file = basedir.join(line.erase(0, 3)) + ".docx";
-			map->emplace(current_file, std::vector<std::string>());
+			map->csv.emplace(current_file, std::vector<std::string>());
 		}
 		else {
 			if (line.empty() || line[0] == '#') {
 				continue;
 			}
-			map->at(current_file).push_back(line);
+			map->csv.at(current_file).push_back(line);
 		}
 	}
-	log::log(MSG(info) << "Loaded csv files: " << map->size());
+	log::log(MSG(info) << "Loaded csv files: " << map->csv.size());
 	return map;
 }
 
+std::unique_ptr<data_file_map> load_data_files(Dir basedir, const std::string &name) {
+	std::string binary_path = basedir.join(name + ".bin");
+	std::string csv_path = basedir.join(name + ".docx");
+
+	if (BinaryDataFile::usable_for(binary_path, csv_path)) {
+		try {
+			auto map = std::make_unique<data_file_map>();
+			map->binary = std::make_unique<BinaryDataFile>(basedir, binary_path);
+
+			log::log(MSG(info) << "Loaded binary data file: " << name << ".bin");
+			return map;
+		}
+		catch (Error &exc) {
+			log::log(MSG(warn) << exc.what() << ", using the csv files instead");
+		}
+	}
+
+	return load_multi_csv_file(basedir, name + ".docx");
+}
+
 }} // openage::util
@@ -5,12 +5,16 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "../error/error.h"
 
+#include "asset_pack.h"
+#include "binary_data.h"
 #include "compiler.h"
 #include "dir.h"
 
@@ -33,22 +37,77 @@ std::vector<std::string> file_get_lines(const std::string &file_name);
 using csv_file_map_t = std::unordered_map<std::string, std::vector<std::string>>;
 
 /**
- * Load a multi csv file into a csv_file_map_t
+ * The data files of a gamedata tree, loaded at once
+ * from a binary data file or a multi csv file.
  */
-csv_file_map_t *load_multi_csv_file(Dir basedir, const std::string &fname);
+struct data_file_map {
+	csv_file_map_t csv;
+	std::unique_ptr<BinaryDataFile> binary;
+};
+
+/**
+ * Load a multi csv file into a data_file_map
+ */
+std::unique_ptr<data_file_map> load_multi_csv_file(Dir basedir, const std::string &fname);
+
+/**
+ * Load the packed data files with the given name, without suffix.
+ * The binary data file is preferred, the multi csv file is used
+ * if it's missing, outdated or invalid.
+ */
+std::unique_ptr<data_file_map> load_data_files(Dir basedir, const std::string &name);
+
+/**
+ * fill structs from a table of a binary data file.
+ * call the destination struct .fill() method for each row.
+ */
+template<typename lineformat>
+void read_binary_table(const std::string &fname, const BinaryDataFile &file,
+                       const BinaryDataFile::table &table, std::vector<lineformat> &out) {
+
+	if (table.row_size != lineformat::binary_row_size or
+	    table.member_count != lineformat::member_count) {
+		throw Error(MSG(err) <<
+			"Failed to read binary data " << fname << " from " << file.get_filename() << ": "
+			"the struct layout differs, try re-converting the media");
+	}
+
+	out.reserve(out.size() + table.row_count);
+
+	for (size_t i = 0; i < table.row_count; i++) {
+		BinaryRow row{table.rows + i * table.row_size, &file};
+
+		// filled in place, so the strings are only allocated once
+		out.emplace_back();
+		int error_column = out.back().fill(row);
+		if (error_column != -1) {
+			out.pop_back();
+			throw Error(MSG(err) <<
+				"Failed to read binary data " << fname << ":" << i << ":" << error_column);
+		}
+	}
+}
 
 /**
  * read a single csv file.
  * call the destination struct .fill() method for actually storing line data
  */
 template<typename lineformat>
-void read_csv_file(const std::string &fname, std::vector<lineformat> &out, csv_file_map_t *file_map = nullptr) {
+void read_csv_file(const std::string &fname, std::vector<lineformat> &out, data_file_map *file_map = nullptr) {
 	size_t line_count = 0;
 	lineformat current_line_data;
 	std::vector<char> strbuf;
 
-	if (file_map && file_map->count(fname)) {
-		std::vector<std::string> lines = file_map->at(fname);
+	if (file_map && file_map->binary) {
+		const BinaryDataFile::table *table = file_map->binary->find(fname);
+		if (table != nullptr) {
+			read_binary_table(fname, *file_map->binary, *table, out);
+			return;
+		}
+	}
+
+	if (file_map && file_map->csv.count(fname)) {
+		const std::vector<std::string> &lines = file_map->csv.at(fname);
 
 		for (auto &line : lines) {
 			line_count += 1;
@@ -74,9 +133,21 @@ void read_csv_file(const std::string &fname, std::vector<lineformat> &out, csv_f
 	else {
 		std::string line;
 
-		std::ifstream csvfile{fname};
+		// metafiles of converted textures may be in an asset pack
+		std::ifstream diskfile;
+		std::istringstream packedfile;
+		std::istream *csvfile = &diskfile;
+
+		packed_file packed = find_packed_file(fname);
+		if (packed) {
+			packedfile.str(std::string{packed.data, packed.size});
+			csvfile = &packedfile;
+		}
+		else {
+			diskfile.open(fname);
+		}
 
-		while (std::getline(csvfile, line)) {
+		while (std::getline(*csvfile, line)) {
 			line_count += 1;
 
 			// ignore comments and empty lines
@@ -116,7 +187,7 @@ void read_csv_file(const std::string &fname, std::vector<lineformat> &out, csv_f
  * should be called from the .recurse() method of the struct.
  */
 template<class lineformat>
-std::vector<lineformat> recurse_data_files(Dir basedir, const std::string &fname, csv_file_map_t *file_map = nullptr) {
+std::vector<lineformat> recurse_data_files(Dir basedir, const std::string &fname, data_file_map *file_map = nullptr) {
 	std::vector<lineformat> result;
 	std::string merged_filename = basedir.join(fname);
 
@@ -151,7 +222,7 @@ struct subdata {
 	std::string filename;
 	std::vector<cls> data;
 
-	bool read(Dir basedir, csv_file_map_t *file_map = nullptr) {
+	bool read(Dir basedir, data_file_map *file_map = nullptr) {
 		this->data = recurse_data_files<cls>(basedir, this->filename, file_map);
 		return true;
 	}
@@ -0,0 +1,150 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "../config.h"
+#include "thread_id.h"
+
+namespace openage {
+namespace util {
+
+
+FrameArena::FrameArena(size_t block_size)
+	:
+	current{0},
+	offset{0},
+	used_before{0},
+	live{0},
+	block_size{block_size} {}
+
+
+FrameArena::~FrameArena() = default;
+
+
+void *FrameArena::allocate(size_t size, size_t alignment) {
+	while (true) {
+		if (this->current == this->blocks.size()) {
+			this->add_block(size + alignment);
+		}
+
+		block &filled = this->blocks[this->current];
+		uintptr_t base = reinterpret_cast<uintptr_t>(filled.memory.get());
+		size_t start = ((base + this->offset + alignment - 1) & ~(alignment - 1)) - base;
+
+		if (start <= filled.size and size <= filled.size - start) {
+			this->offset = start + size;
+			this->live += 1;
+			return filled.memory.get() + start;
+		}
+
+		// continue in the next block, the rest of this one stays unused
+		this->used_before += this->offset;
+		this->current += 1;
+		this->offset = 0;
+	}
+}
+
+
+void FrameArena::deallocate(void *, size_t) noexcept {
+	// the arena may have been reset since
+	if (this->live == 0) {
+		return;
+	}
+
+	this->live -= 1;
+	if (this->live == 0) {
+		this->current = 0;
+		this->offset = 0;
+		this->used_before = 0;
+	}
+}
+
+
+void FrameArena::reset() {
+	// the next frames fit into one block
+	if (this->blocks.size() > 1) {
+		size_t total = this->capacity();
+		this->blocks.clear();
+		this->add_block(total);
+	}
+
+	this->current = 0;
+	this->offset = 0;
+	this->used_before = 0;
+	this->live = 0;
+}
+
+
+size_t FrameArena::used() const {
+	return this->used_before + this->offset;
+}
+
+
+size_t FrameArena::capacity() const {
+	size_t total = 0;
+	for (auto &entry : this->blocks) {
+		total += entry.size;
+	}
+	return total;
+}
+
+
+void FrameArena::add_block(size_t min_size) {
+	size_t size = std::max(this->block_size, min_size);
+	this->blocks.push_back({std::unique_ptr<char[]>{new char[size]}, size});
+}
+
+
+namespace {
+
+/**
+ * incremented for each frame, the arenas
+ * reset when they see a new value.
+ */
+std::atomic<uint64_t> arena_frame{0};
+
+
+struct thread_arena {
+	FrameArena arena;
+	uint64_t frame = 0;
+};
+
+} // anonymous namespace
+
+
+FrameArena &frame_arena() {
+#if HAVE_THREAD_LOCAL_STORAGE
+	thread_local thread_arena own;
+#else
+	static std::mutex arenas_mutex;
+	static std::unordered_map<size_t, std::unique_ptr<thread_arena>> arenas;
+
+	std::lock_guard<std::mutex> lock{arenas_mutex};
+	std::unique_ptr<thread_arena> &entry = arenas[get_current_thread_id()];
+	if (not entry) {
+		entry = std::make_unique<thread_arena>();
+	}
+	thread_arena &own = *entry;
+#endif
+
+	uint64_t frame = arena_frame.load(std::memory_order_relaxed);
+	if (own.frame != frame) {
+		own.arena.reset();
+		own.frame = frame;
+	}
+	return own.arena;
+}
+
+
+void next_arena_frame() {
+	arena_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+}} // openage::util
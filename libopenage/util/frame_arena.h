@@ -0,0 +1,173 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace openage {
+namespace util {
+
+
+/**
+ * Bump allocator for data that lives no longer than a frame,
+ * e.g. the tiles below an object while it's placed.
+ *
+ * Allocating moves an offset in the current block, deallocating only
+ * counts. When nothing is allocated anymore, or the arena is reset,
+ * the memory is used again from the start. The blocks that were needed
+ * in a frame are merged to one on reset, so after a few frames an
+ * arena allocates nothing from the heap anymore.
+ *
+ * An arena is used by one thread only, see frame_arena().
+ */
+class FrameArena {
+public:
+	/**
+	 * @param block_size: bytes of the first block
+	 */
+	explicit FrameArena(size_t block_size=64 * 1024);
+	~FrameArena();
+
+	FrameArena(const FrameArena &) = delete;
+	FrameArena &operator =(const FrameArena &) = delete;
+
+	/**
+	 * memory for size bytes at the given power of two alignment.
+	 */
+	void *allocate(size_t size, size_t alignment);
+
+	/**
+	 * returns memory, which is used again
+	 * once all of the arena's memory was returned.
+	 */
+	void deallocate(void *memory, size_t size) noexcept;
+
+	/**
+	 * use all memory again, allocations that were not
+	 * returned yet must not be used anymore.
+	 */
+	void reset();
+
+	/**
+	 * bytes in use, including the alignment padding.
+	 */
+	size_t used() const;
+
+	/**
+	 * bytes of all blocks.
+	 */
+	size_t capacity() const;
+
+private:
+	struct block {
+		std::unique_ptr<char[]> memory;
+		size_t size;
+	};
+
+	void add_block(size_t min_size);
+
+	std::vector<block> blocks;
+
+	/**
+	 * index of the block that is filled.
+	 */
+	size_t current;
+
+	/**
+	 * bytes used in the current block.
+	 */
+	size_t offset;
+
+	/**
+	 * bytes used in the filled blocks before the current one.
+	 */
+	size_t used_before;
+
+	/**
+	 * allocations that were not returned yet.
+	 */
+	size_t live;
+
+	size_t block_size;
+};
+
+
+/**
+ * The frame arena of the calling thread.
+ *
+ * All threads' arenas are reset when the next frame starts, so memory
+ * of a frame arena must not be kept beyond the frame or tick it was
+ * allocated in, nor be handed to another thread.
+ */
+FrameArena &frame_arena();
+
+/**
+ * Starts a new frame: each thread's arena is reset the next time it is used.
+ * Called by the engine between frames.
+ */
+void next_arena_frame();
+
+
+/**
+ * Standard allocator on a frame arena, the one of the
+ * constructing thread by default.
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	ArenaAllocator()
+		:
+		arena{&frame_arena()} {}
+
+	explicit ArenaAllocator(FrameArena &arena) noexcept
+		:
+		arena{&arena} {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+		:
+		arena{other.arena} {}
+
+	T *allocate(size_t count) {
+		if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_alloc{};
+		}
+		return static_cast<T *>(this->arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *memory, size_t count) noexcept {
+		this->arena->deallocate(memory, count * sizeof(T));
+	}
+
+	template<typename U>
+	bool operator ==(const ArenaAllocator<U> &other) const noexcept {
+		return this->arena == other.arena;
+	}
+
+	template<typename U>
+	bool operator !=(const ArenaAllocator<U> &other) const noexcept {
+		return this->arena != other.arena;
+	}
+
+private:
+	template<typename U>
+	friend class ArenaAllocator;
+
+	FrameArena *arena;
+};
+
+
+/**
+ * A vector on the frame arena of the current thread.
+ */
+template<typename T>
+using frame_vector = std::vector<T, ArenaAllocator<T>>;
+
+
+}} // openage::util
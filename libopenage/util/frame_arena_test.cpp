@@ -0,0 +1,62 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "frame_arena.h"
+
+#include <cstdint>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+// exported test
+void frame_arena() {
+	FrameArena arena{256};
+
+	// alignment, also beyond the one of new
+	void *a = arena.allocate(3, 1);
+	void *b = arena.allocate(8, 8);
+	void *c = arena.allocate(16, 128);
+	reinterpret_cast<uintptr_t>(b) % 8 == 0 or TESTFAIL;
+	reinterpret_cast<uintptr_t>(c) % 128 == 0 or TESTFAIL;
+	(a != b and b != c) or TESTFAIL;
+
+	// too large for the first block
+	arena.allocate(1000, 8);
+	arena.capacity() >= 1256 or TESTFAIL;
+
+	// the blocks are merged, the next frame fits into one
+	arena.reset();
+	arena.used() == 0 or TESTFAIL;
+	size_t capacity = arena.capacity();
+	void *first = arena.allocate(1000, 8);
+	arena.capacity() == capacity or TESTFAIL;
+
+	// the memory is used again once everything was returned
+	arena.deallocate(first, 1000);
+	arena.used() == 0 or TESTFAIL;
+	arena.allocate(1000, 8) == first or TESTFAIL;
+	arena.reset();
+
+	{
+		frame_vector<int> numbers{ArenaAllocator<int>{arena}};
+		for (int i = 0; i < 1000; i++) {
+			numbers.push_back(i);
+		}
+		numbers[999] == 999 or TESTFAIL;
+		arena.used() > 0 or TESTFAIL;
+	}
+	arena.used() == 0 or TESTFAIL;
+
+	// the thread's arena is reset in the next frame
+	FrameArena &own = util::frame_arena();
+	own.allocate(64, 8);
+	own.used() > 0 or TESTFAIL;
+	next_arena_frame();
+	util::frame_arena().used() == 0 or TESTFAIL;
+}
+
+
+}}} // openage::util::tests
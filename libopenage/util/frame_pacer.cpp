@@ -0,0 +1,79 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "frame_pacer.h"
+
+#include <cmath>
+
+namespace openage {
+namespace util {
+
+namespace {
+
+/** weight of a new frame in the smoothed cost */
+constexpr double cost_gain = 1.0 / 8;
+
+/** weight of a new frame in the smoothed deviation */
+constexpr double deviation_gain = 1.0 / 4;
+
+/** deviations added to the smoothed cost */
+constexpr double deviation_factor = 4;
+
+/**
+ * added to the prediction, the sleep of the operating
+ * system may take this much longer than requested.
+ */
+constexpr time_nsec_t sleep_slack = 1000 * 1000;
+
+} // anonymous namespace
+
+
+FramePacer::FramePacer() {
+	this->reset();
+}
+
+
+void FramePacer::add_frame_cost(time_nsec_t frame_cost) {
+	double value = frame_cost;
+
+	if (not this->measured) {
+		this->cost = value;
+		this->deviation = value / 2;
+		this->measured = true;
+		return;
+	}
+
+	this->deviation += deviation_gain * (std::abs(value - this->cost) - this->deviation);
+	this->cost += cost_gain * (value - this->cost);
+}
+
+
+time_nsec_t FramePacer::get_predicted_cost() const {
+	if (not this->measured) {
+		return 0;
+	}
+
+	return static_cast<time_nsec_t>(this->cost + deviation_factor * this->deviation) + sleep_slack;
+}
+
+
+time_nsec_t FramePacer::get_wait_time(time_nsec_t since_last_frame, time_nsec_t interval) const {
+	// without a measurement, the frame is started right away
+	if (not this->measured) {
+		return 0;
+	}
+
+	time_nsec_t busy = since_last_frame + this->get_predicted_cost();
+	if (busy >= interval) {
+		return 0;
+	}
+	return interval - busy;
+}
+
+
+void FramePacer::reset() {
+	this->measured = false;
+	this->cost = 0;
+	this->deviation = 0;
+}
+
+}} // openage::util
@@ -0,0 +1,61 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include "timing.h"
+
+namespace openage {
+namespace util {
+
+/**
+ * Predicts how long the work of the next frame takes, so the main loop
+ * can sleep before it samples the input instead of after it drew the
+ * frame. The input is then read just in time to finish the frame at
+ * the end of its interval, which removes the sleep from the latency.
+ *
+ * The prediction is the smoothed frame cost plus a multiple of its
+ * smoothed deviation, like the retransmission timeout of TCP, so
+ * irregular frames make it more careful.
+ */
+class FramePacer {
+public:
+	FramePacer();
+
+	/**
+	 * record the time spent on a frame, from sampling the
+	 * input until the frame was handed to the display.
+	 */
+	void add_frame_cost(time_nsec_t cost);
+
+	/**
+	 * the time the next frame is expected to take at most.
+	 */
+	time_nsec_t get_predicted_cost() const;
+
+	/**
+	 * how long to sleep before the next frame is started,
+	 * so it is done at the end of its interval.
+	 *
+	 * @param since_last_frame time since the last frame was handed
+	 *                         to the display
+	 * @param interval time between two frames
+	 */
+	time_nsec_t get_wait_time(time_nsec_t since_last_frame, time_nsec_t interval) const;
+
+	/**
+	 * forget the measured frames, e.g. after the interval changed.
+	 */
+	void reset();
+
+private:
+	/** whether a frame was measured yet */
+	bool measured;
+
+	/** the smoothed frame cost in nanoseconds */
+	double cost;
+
+	/** the smoothed absolute deviation of the frame cost */
+	double deviation;
+};
+
+}} // openage::util
@@ -0,0 +1,48 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "frame_pacer.h"
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+namespace {
+
+constexpr time_nsec_t ms = 1000 * 1000;
+
+} // anonymous namespace
+
+
+// exported test
+void frame_pacer() {
+	FramePacer pacer;
+
+	// nothing is known about the frames yet
+	TESTEQUALS(pacer.get_wait_time(0, 16 * ms), 0);
+
+	// steady frames of 4 ms leave most of a 60 fps interval for sleeping
+	for (int i = 0; i < 100; i++) {
+		pacer.add_frame_cost(4 * ms);
+	}
+	time_nsec_t steady = pacer.get_predicted_cost();
+	(steady >= 4 * ms and steady < 6 * ms) or TESTFAIL;
+	TESTEQUALS(pacer.get_wait_time(0, 16 * ms), 16 * ms - steady);
+	TESTEQUALS(pacer.get_wait_time(2 * ms, 16 * ms), 14 * ms - steady);
+
+	// a frame that is late already is started right away
+	TESTEQUALS(pacer.get_wait_time(15 * ms, 16 * ms), 0);
+	TESTEQUALS(pacer.get_wait_time(0, 3 * ms), 0);
+
+	// irregular frames make the prediction more careful
+	for (int i = 0; i < 20; i++) {
+		pacer.add_frame_cost((i % 2) ? 2 * ms : 8 * ms);
+	}
+	(pacer.get_predicted_cost() > 8 * ms) or TESTFAIL;
+
+	pacer.reset();
+	TESTEQUALS(pacer.get_predicted_cost(), 0);
+}
+
+}}} // openage::util::tests
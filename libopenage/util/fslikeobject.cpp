@@ -1,10 +1,271 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "fslikeobject.h"
 
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../error/error.h"
+
 
 namespace openage {
 namespace util {
 
+using pyinterface::PyObjectRef;
+namespace py = pyinterface::py;
+
+namespace {
+
+/**
+ * bytes per read or write call on a Python file object
+ */
+constexpr size_t chunk_size = 1 << 16;
+
+
+/**
+ * Reads a whole native file from a memory mapping.
+ */
+class MappedBuf : public std::streambuf {
+public:
+	explicit MappedBuf(const std::string &filename)
+		:
+		mapping{nullptr},
+		size{0} {
+
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw Error(MSG(err) << "Could not open " << filename);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) < 0) {
+			close(fd);
+			throw Error(MSG(err) << "Could not stat " << filename);
+		}
+
+		this->size = st.st_size;
+		if (this->size > 0) {
+			this->mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+
+		// the mapping stays valid without the descriptor
+		close(fd);
+
+		if (this->mapping == MAP_FAILED) {
+			this->mapping = nullptr;
+			throw Error(MSG(err) << "Could not map " << filename);
+		}
+
+		if (this->mapping != nullptr) {
+			madvise(this->mapping, this->size, MADV_SEQUENTIAL);
+		}
+		char *data = static_cast<char *>(this->mapping);
+		this->setg(data, data, data + this->size);
+	}
+
+	~MappedBuf() {
+		if (this->mapping != nullptr) {
+			munmap(this->mapping, this->size);
+		}
+	}
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+	                 std::ios_base::openmode which) override {
+		off_type base = 0;
+		if (dir == std::ios_base::cur) {
+			base = this->gptr() - this->eback();
+		}
+		else if (dir == std::ios_base::end) {
+			base = this->size;
+		}
+		return this->seekpos(base + off, which);
+	}
+
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+		off_type offset = pos;
+		if (not (which & std::ios_base::in) or
+		    offset < 0 or offset > static_cast<off_type>(this->size)) {
+			return pos_type(off_type(-1));
+		}
+		this->setg(this->eback(), this->eback() + offset, this->egptr());
+		return pos;
+	}
+
+private:
+	void *mapping;
+	size_t size;
+};
+
+
+/**
+ * Reads a Python file-like object in chunks.
+ */
+class PyReadBuf : public std::streambuf {
+public:
+	explicit PyReadBuf(const PyObjectRef &file)
+		:
+		read{file.getattr("read")} {}
+
+protected:
+	int_type underflow() override {
+		this->chunk = this->read.call(py::integer(static_cast<int>(chunk_size))).bytes();
+		if (this->chunk.empty()) {
+			return traits_type::eof();
+		}
+
+		char *data = &this->chunk[0];
+		this->setg(data, data, data + this->chunk.size());
+		return traits_type::to_int_type(*data);
+	}
+
+private:
+	PyObjectRef read;
+	std::string chunk;
+};
+
+
+/**
+ * Writes to a Python file-like object in chunks.
+ */
+class PyWriteBuf : public std::streambuf {
+public:
+	explicit PyWriteBuf(const PyObjectRef &file)
+		:
+		write{file.getattr("write")},
+		buffer(chunk_size) {
+
+		this->setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+	}
+
+protected:
+	int_type overflow(int_type ch) override {
+		this->write_buffer();
+		if (not traits_type::eq_int_type(ch, traits_type::eof())) {
+			*this->pptr() = traits_type::to_char_type(ch);
+			this->pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	int sync() override {
+		this->write_buffer();
+		return 0;
+	}
+
+private:
+	void write_buffer() {
+		size_t count = this->pptr() - this->pbase();
+		if (count > 0) {
+			this->write.call(py::bytes(std::string(this->pbase(), count)));
+		}
+		this->setp(this->buffer.data(), this->buffer.data() + this->buffer.size());
+	}
+
+	PyObjectRef write;
+	std::vector<char> buffer;
+};
+
+} // anonymous namespace
+
+
+Path::Path(PyObjectRef fs, std::vector<std::string> parts)
+	:
+	fs{std::make_shared<PyObjectRef>(std::move(fs))},
+	parts{std::move(parts)} {}
+
+
+PyObjectRef Path::call(const std::string &method) const {
+	PyObjectRef parts = py::builtin("list").call();
+	PyObjectRef append = parts.getattr("append");
+	for (auto &part : this->parts) {
+		append.call(py::bytes(part));
+	}
+
+	return this->fs->getattr(method).call(py::builtin("tuple").call(parts));
+}
+
+
+std::string Path::resolve_native() const {
+	PyObjectRef result = this->call("resolve_native");
+	if (result.is(py::none())) {
+		return "";
+	}
+	return result.bytes();
+}
+
+
+RFile::RFile(Path &path, bool allow_native)
+	:
+	std::istream{nullptr},
+	native{false} {
+
+	std::string filename;
+	if (allow_native) {
+		filename = path.resolve_native();
+	}
+
+	struct stat st;
+	if (not filename.empty() and stat(filename.c_str(), &st) == 0 and S_ISREG(st.st_mode)) {
+		this->native = true;
+
+		if (static_cast<size_t>(st.st_size) >= mmap_threshold) {
+			this->buf = std::make_unique<MappedBuf>(filename);
+		}
+		else {
+			auto file = std::make_unique<std::filebuf>();
+			if (not file->open(filename, std::ios_base::in | std::ios_base::binary)) {
+				throw Error(MSG(err) << "Could not open " << filename);
+			}
+			this->buf = std::move(file);
+		}
+	}
+	else {
+		this->buf = std::make_unique<PyReadBuf>(path.call("open_r"));
+	}
+
+	this->rdbuf(this->buf.get());
+}
+
+
+bool RFile::is_native() const {
+	return this->native;
+}
+
+
+WFile::WFile(Path &path)
+	:
+	std::ostream{nullptr},
+	buf{std::make_unique<PyWriteBuf>(path.call("open_w"))} {
+
+	this->rdbuf(this->buf.get());
+}
+
+
+WFile::~WFile() {
+	this->flush();
+}
+
+
+size_t read_all(Path &path, bool allow_native) {
+	RFile file{path, allow_native};
+
+	size_t total = 0;
+	std::vector<char> chunk(chunk_size);
+	while (file.read(chunk.data(), chunk.size()) or file.gcount() > 0) {
+		total += file.gcount();
+	}
+
+	if (file.bad()) {
+		throw Error(MSG(err) << "Could not read file");
+	}
+
+	return total;
+}
+
 
 }} // openage::util
@@ -1,12 +1,17 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+// pxd: from libcpp cimport bool as cppbool
+#include <cstddef>
 #include <iostream>
+#include <memory>
+// pxd: from libcpp.string cimport string
+#include <string>
+// pxd: from libcpp.vector cimport vector
+#include <vector>
 
-// pxd: from libopenage.pyinterface.functional cimport PyIfFunc1
-#include "../pyinterface/functional.h"
-
+// pxd: from libopenage.pyinterface.pyobject cimport PyObjectRef
 #include "../pyinterface/pyobject.h"
 
 /*
@@ -20,38 +25,85 @@ namespace util {
 /**
  * Analogous to util.fslike.path.Path.
  * For use as constructor argument by RFile and WFile.
+ *
+ * pxd:
+ *
+ * cppclass Path:
+ *     Path(PyObjectRef fs, vector[string] parts) except +
  */
 class Path {
 public:
-    Path(pyinterface::PyObjectRef fs, std::vector<std::string> parts);
+	Path(pyinterface::PyObjectRef fs, std::vector<std::string> parts);
+
+	/**
+	 * fs.resolve_native(parts): the path of the file in the native
+	 * file system, or "" if it can only be opened through the fs object.
+	 */
+	std::string resolve_native() const;
+
+	/**
+	 * fs.<method>(parts)
+	 */
+	pyinterface::PyObjectRef call(const std::string &method) const;
 
-    std::shared_ptr<pyinterface::PyObjectRef> fs;
-    std::vector<std::string> parts;
+	std::shared_ptr<pyinterface::PyObjectRef> fs;
+	std::vector<std::string> parts;
 };
 
 
 /**
- * Wraps a Python file-like object ('rb').
+ * Reads a file of a Python fs-like object ('rb').
+ *
+ * Files which exist in the native file system are read without calling
+ * into Python, large ones are mapped into memory.
+ * All others are read through the Python file-like object in chunks.
  */
 class RFile : public std::istream {
 public:
-    RFile(Path &path);
+	/**
+	 * native files of this size or larger are mapped into memory.
+	 */
+	static constexpr size_t mmap_threshold = 1 << 20;
+
+	/**
+	 * allow_native = false always reads through Python.
+	 */
+	RFile(Path &path, bool allow_native=true);
+
+	/**
+	 * whether the file is read without Python.
+	 */
+	bool is_native() const;
 
 private:
-    pyinterface::PyObjectRef obj;
+	std::unique_ptr<std::streambuf> buf;
+	bool native;
 };
 
 
 /**
  * Wraps a Python file-like object ('wb').
+ *
+ * Writes always go through the fs object, so its checks
+ * (e.g. by a WriteBlocker) apply. Data is buffered and written in chunks.
  */
 class WFile : public std::ostream {
 public:
-    WFile(Path &path);
+	WFile(Path &path);
+	~WFile();
 
 private:
-    pyinterface::PyObjectRef obj;
+	std::unique_ptr<std::streambuf> buf;
 };
 
 
+/**
+ * Reads the whole file, returns the number of bytes.
+ * Used to compare the native and the Python read paths.
+ *
+ * pxd: size_t read_all(Path &path, cppbool allow_native) except +
+ */
+size_t read_all(Path &path, bool allow_native=true);
+
+
 }} // openage::util
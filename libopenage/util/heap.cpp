@@ -0,0 +1,21 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "heap.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace openage {
+namespace util {
+
+int64_t heap_in_use() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 info = mallinfo2();
+	return static_cast<int64_t>(info.uordblks + info.hblkhd);
+#else
+	return -1;
+#endif
+}
+
+}} // openage::util
@@ -0,0 +1,16 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+
+namespace openage {
+namespace util {
+
+/**
+ * bytes allocated with malloc and still in use, -1 when unknown.
+ * only known with glibc 2.33 or newer.
+ */
+int64_t heap_in_use();
+
+}} // openage::util
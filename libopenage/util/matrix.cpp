@@ -1,10 +1,16 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "matrix.h"
 
 namespace openage {
 namespace util {
 
-// Matrix is all templated, so there's nothing to implement.
+static_assert(sizeof(Vector4) == 4 * sizeof(float), "the kernels need the vectors one after the other");
+
+
+void transform(const Matrix4 &matrix, const Vector4 *src, Vector4 *dst, size_t count) {
+	transform4(reinterpret_cast<float *>(dst), matrix.values(),
+	           reinterpret_cast<const float *>(src), count);
+}
 
 }} // openage::util
@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -7,11 +7,48 @@
 #include <array>
 #include <type_traits>
 
+#include "matrix_kernels.h"
 #include "vector.h"
 
 namespace openage {
 namespace util {
 
+namespace detail {
+
+/**
+ * Multiplication of the values of a MxN and a NxP matrix,
+ * row by row, with the kernels for the 4x4 cases.
+ */
+template<size_t M, size_t N, size_t P>
+struct matrix_multiply {
+	static void run(float *dst, const float *a, const float *b) {
+		for (size_t i = 0; i < M; i++) {
+			for (size_t j = 0; j < P; j++) {
+				dst[i * P + j] = 0;
+				for (size_t k = 0; k < N; k++) {
+					dst[i * P + j] += a[i * N + k] * b[k * P + j];
+				}
+			}
+		}
+	}
+};
+
+template<>
+struct matrix_multiply<4, 4, 4> {
+	static void run(float *dst, const float *a, const float *b) {
+		multiply4x4(dst, a, b);
+	}
+};
+
+template<>
+struct matrix_multiply<4, 4, 1> {
+	static void run(float *dst, const float *a, const float *b) {
+		transform4(dst, a, b, 1);
+	}
+};
+
+} // namespace detail
+
 /**
  * Matrix class with arithmetic. M rows, N columns.
  */
@@ -19,6 +56,8 @@ template<size_t M, size_t N>
 class Matrix : public std::array<std::array<float, N>, M> {
 public:
 	static_assert(M > 0 and N > 0, "0-dimensional matrix not allowed");
+	static_assert(sizeof(std::array<std::array<float, N>, M>) == M * N * sizeof(float),
+	              "the kernels need the rows one after the other");
 
 	static constexpr size_t rows = M;
 	static constexpr size_t cols = N;
@@ -54,7 +93,7 @@ public:
 	Matrix(T ... args) {
 		std::array<float, N*M> temp{{static_cast<float>(args)...}};
 		for (size_t i = 0; i < N*M; i++) {
-			(*this)[i / (N*M)][i % (N*M)] = temp[i];
+			(*this)[i / N][i % N] = temp[i];
 		}
 	}
 
@@ -64,22 +103,15 @@ public:
 	template<size_t P>
 	Matrix<M, P> operator*(const Matrix<N, P> &other) const {
 		Matrix<M, P> res;
-		for (size_t i = 0; i < M; i++) {
-			for (size_t j = 0; j < P; j++) {
-				res[i][j] = 0;
-				for (size_t k = 0; k < N; k++) {
-					res[i][j] += (*this)[i][k] * other[k][j];
-				}
-			}
-		}
+		detail::matrix_multiply<M, N, P>::run(res.values(), this->values(), other.values());
 		return res;
 	}
 
 	/**
 	 * Matrix-Vector multiplication
 	 */
-	Matrix <M, 1> operator*(const Vector<M> &vec) const {
-		return (*this) * static_cast<Matrix<M, 1>>(vec);
+	Matrix<M, 1> operator*(const Vector<N> &vec) const {
+		return (*this) * static_cast<Matrix<N, 1>>(vec);
 	}
 
 	/**
@@ -112,11 +144,15 @@ public:
 	 * Scalar multiplication with assignment
 	 */
 	void operator*=(float other) {
-		for (size_t i = 0; i < M; i++) {
-			for (size_t j = 0; j < N; j++) {
-				(*this)[i][j] *= other;
+		// the kernel call is not worth it for fewer values
+		if (M * N < 4) {
+			for (size_t i = 0; i < M * N; i++) {
+				this->values()[i] *= other;
 			}
 		}
+		else {
+			scale_floats(this->values(), M * N, other);
+		}
 	}
 
 	/**
@@ -174,6 +210,16 @@ public:
 		return res;
 	}
 
+	/**
+	 * The values row by row.
+	 */
+	float *values() {
+		return (*this)[0].data();
+	}
+
+	const float *values() const {
+		return (*this)[0].data();
+	}
 };
 
 /**
@@ -210,4 +256,10 @@ using Matrix2 = Matrix<2, 2>;
 using Matrix3 = Matrix<3, 3>;
 using Matrix4 = Matrix<4, 4>;
 
+/**
+ * Batch multiplication of count vectors by the matrix:
+ * dst[i] = matrix * src[i]. dst may be src.
+ */
+void transform(const Matrix4 &matrix, const Vector4 *src, Vector4 *dst, size_t count);
+
 }} // openage::util
@@ -0,0 +1,181 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "matrix_kernels.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define OPENAGE_MATRIX_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OPENAGE_MATRIX_NEON 1
+#endif
+
+namespace openage {
+namespace util {
+
+void multiply4x4_scalar(float *dst, const float *a, const float *b) {
+	for (size_t i = 0; i < 4; i++) {
+		for (size_t j = 0; j < 4; j++) {
+			float sum = a[i * 4] * b[j];
+			for (size_t k = 1; k < 4; k++) {
+				sum += a[i * 4 + k] * b[k * 4 + j];
+			}
+			dst[i * 4 + j] = sum;
+		}
+	}
+}
+
+
+void transform4_scalar(float *dst, const float *matrix, const float *src, size_t count) {
+	for (size_t v = 0; v < count; v++) {
+		float vec[4] = {src[v * 4], src[v * 4 + 1], src[v * 4 + 2], src[v * 4 + 3]};
+
+		for (size_t i = 0; i < 4; i++) {
+			float sum = matrix[i * 4] * vec[0];
+			for (size_t k = 1; k < 4; k++) {
+				sum += matrix[i * 4 + k] * vec[k];
+			}
+			dst[v * 4 + i] = sum;
+		}
+	}
+}
+
+
+void scale_floats_scalar(float *dst, size_t count, float factor) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i] *= factor;
+	}
+}
+
+
+#if OPENAGE_MATRIX_SSE
+
+void multiply4x4(float *dst, const float *a, const float *b) {
+	__m128 b0 = _mm_loadu_ps(b);
+	__m128 b1 = _mm_loadu_ps(b + 4);
+	__m128 b2 = _mm_loadu_ps(b + 8);
+	__m128 b3 = _mm_loadu_ps(b + 12);
+
+	// each row of the result is the rows of b, weighted by the row of a
+	for (size_t i = 0; i < 4; i++) {
+		const float *row = a + i * 4;
+		__m128 sum = _mm_mul_ps(_mm_set1_ps(row[0]), b0);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[1]), b1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[2]), b2));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[3]), b3));
+		_mm_storeu_ps(dst + i * 4, sum);
+	}
+}
+
+
+void transform4(float *dst, const float *matrix, const float *src, size_t count) {
+	__m128 c0 = _mm_loadu_ps(matrix);
+	__m128 c1 = _mm_loadu_ps(matrix + 4);
+	__m128 c2 = _mm_loadu_ps(matrix + 8);
+	__m128 c3 = _mm_loadu_ps(matrix + 12);
+
+	// the result is the columns of the matrix, weighted by the vector
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	for (size_t v = 0; v < count; v++) {
+		const float *vec = src + v * 4;
+		__m128 sum = _mm_mul_ps(c0, _mm_set1_ps(vec[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(vec[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(vec[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(vec[3])));
+		_mm_storeu_ps(dst + v * 4, sum);
+	}
+}
+
+
+void scale_floats(float *dst, size_t count, float factor) {
+	__m128 scale = _mm_set1_ps(factor);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), scale));
+	}
+
+	scale_floats_scalar(dst + i, count - i, factor);
+}
+
+
+const char *matrix_kernel_name() {
+	return "sse";
+}
+
+#elif OPENAGE_MATRIX_NEON
+
+// multiplications and additions are kept separate, the fused
+// instructions would round differently than the scalar versions
+
+void multiply4x4(float *dst, const float *a, const float *b) {
+	float32x4_t b0 = vld1q_f32(b);
+	float32x4_t b1 = vld1q_f32(b + 4);
+	float32x4_t b2 = vld1q_f32(b + 8);
+	float32x4_t b3 = vld1q_f32(b + 12);
+
+	for (size_t i = 0; i < 4; i++) {
+		const float *row = a + i * 4;
+		float32x4_t sum = vmulq_n_f32(b0, row[0]);
+		sum = vaddq_f32(sum, vmulq_n_f32(b1, row[1]));
+		sum = vaddq_f32(sum, vmulq_n_f32(b2, row[2]));
+		sum = vaddq_f32(sum, vmulq_n_f32(b3, row[3]));
+		vst1q_f32(dst + i * 4, sum);
+	}
+}
+
+
+void transform4(float *dst, const float *matrix, const float *src, size_t count) {
+	// deinterleaving the rows loads the columns
+	float32x4x4_t columns = vld4q_f32(matrix);
+
+	for (size_t v = 0; v < count; v++) {
+		const float *vec = src + v * 4;
+		float32x4_t sum = vmulq_n_f32(columns.val[0], vec[0]);
+		sum = vaddq_f32(sum, vmulq_n_f32(columns.val[1], vec[1]));
+		sum = vaddq_f32(sum, vmulq_n_f32(columns.val[2], vec[2]));
+		sum = vaddq_f32(sum, vmulq_n_f32(columns.val[3], vec[3]));
+		vst1q_f32(dst + v * 4, sum);
+	}
+}
+
+
+void scale_floats(float *dst, size_t count, float factor) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(dst + i), factor));
+	}
+
+	scale_floats_scalar(dst + i, count - i, factor);
+}
+
+
+const char *matrix_kernel_name() {
+	return "neon";
+}
+
+#else
+
+void multiply4x4(float *dst, const float *a, const float *b) {
+	multiply4x4_scalar(dst, a, b);
+}
+
+
+void transform4(float *dst, const float *matrix, const float *src, size_t count) {
+	transform4_scalar(dst, matrix, src, count);
+}
+
+
+void scale_floats(float *dst, size_t count, float factor) {
+	scale_floats_scalar(dst, count, factor);
+}
+
+
+const char *matrix_kernel_name() {
+	return "scalar";
+}
+
+#endif
+
+}} // namespace openage::util
@@ -0,0 +1,48 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+
+namespace openage {
+namespace util {
+
+/**
+ * The float kernels of Matrix and Vector for the 4x4 and 4-vector cases
+ * of camera and projection work. They use the vector instructions the
+ * library is compiled for (SSE or NEON) and produce the same values as
+ * the scalar versions, as they add up the products in the same order.
+ *
+ * Matrices are stored row by row.
+ */
+
+/**
+ * Multiply two 4x4 matrices: dst = a * b.
+ * dst must not overlap a or b.
+ */
+void multiply4x4(float *dst, const float *a, const float *b);
+
+/**
+ * Multiply count 4-vectors, stored one after the other, by the 4x4
+ * matrix: dst[i] = matrix * src[i]. dst may be src.
+ */
+void transform4(float *dst, const float *matrix, const float *src, size_t count);
+
+/**
+ * Multiply count floats by the factor: dst[i] *= factor.
+ */
+void scale_floats(float *dst, size_t count, float factor);
+
+/**
+ * Reference versions of the kernels, without vector instructions.
+ */
+void multiply4x4_scalar(float *dst, const float *a, const float *b);
+void transform4_scalar(float *dst, const float *matrix, const float *src, size_t count);
+void scale_floats_scalar(float *dst, size_t count, float factor);
+
+/**
+ * Name of the instruction set used by the kernels.
+ */
+const char *matrix_kernel_name();
+
+}} // namespace openage::util
@@ -1,14 +1,35 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "matrix.h"
 #include "vector.h"
 
+#include <vector>
+
+#include "../log/log.h"
+#include "../rng/rng.h"
+#include "../testing/benchmark.h"
 #include "../testing/testing.h"
 
 namespace openage {
 namespace util {
 namespace tests {
 
+namespace {
+
+/**
+ * floats in [-100, 100), as in projection and camera matrices.
+ */
+std::vector<float> random_floats(rng::RNG &rng, size_t count) {
+	std::vector<float> values(count);
+	for (auto &value : values) {
+		value = static_cast<float>(rng.real_range(-100, 100));
+	}
+	return values;
+}
+
+} // anonymous namespace
+
+
 void matrix() {
 	{ // matrix multiplication
 		const Matrix<5, 3> a(0.0, 0.5, 1.0,
@@ -98,6 +119,106 @@ void matrix() {
 		TESTEQUALS_FLOAT(u[1], 4, 1e-7);
 		TESTEQUALS_FLOAT(u[2], 6, 1e-7);
 	}
+
+	{ // 4x4 kernels
+		const Matrix4 a(1, 2, 3, 4,
+		                5, 6, 7, 8,
+		                9, 10, 11, 12,
+		                13, 14, 15, 16);
+		const Matrix4 b = a.transpose() * 0.5;
+		Matrix4 c = a * b;
+		TESTEQUALS_FLOAT(c[0][0], 15, 1e-7);
+		TESTEQUALS_FLOAT(c[0][3], 75, 1e-7);
+		TESTEQUALS_FLOAT(c[3][0], 75, 1e-7);
+		TESTEQUALS_FLOAT(c[3][3], 423, 1e-7);
+
+		const Vector4 v(1, 0, -1, 2);
+		auto u = (a * v).to_vector();
+		TESTEQUALS_FLOAT(u[0], 6, 1e-7);
+		TESTEQUALS_FLOAT(u[1], 14, 1e-7);
+		TESTEQUALS_FLOAT(u[2], 22, 1e-7);
+		TESTEQUALS_FLOAT(u[3], 30, 1e-7);
+
+		// batches transform in place
+		std::vector<Vector4> batch{v, Vector4(0, 0, 0, 1), v};
+		transform(a, batch.data(), batch.data(), batch.size());
+		TESTEQUALS_FLOAT(batch[0][3], 30, 1e-7);
+		TESTEQUALS_FLOAT(batch[1][0], 4, 1e-7);
+		TESTEQUALS_FLOAT(batch[1][3], 16, 1e-7);
+		TESTEQUALS_FLOAT(batch[2][2], 22, 1e-7);
+	}
+
+	{ // the kernels compute the same values as the scalar versions
+		rng::RNG rng{0};
+		std::vector<float> a = random_floats(rng, 16);
+		std::vector<float> b = random_floats(rng, 16);
+		std::vector<float> expected(16);
+		std::vector<float> result(16);
+		multiply4x4_scalar(expected.data(), a.data(), b.data());
+		multiply4x4(result.data(), a.data(), b.data());
+		(result == expected) or TESTFAIL;
+
+		std::vector<float> vectors = random_floats(rng, 4 * 33);
+		expected.resize(vectors.size());
+		result.resize(vectors.size());
+		transform4_scalar(expected.data(), a.data(), vectors.data(), 33);
+		transform4(result.data(), a.data(), vectors.data(), 33);
+		(result == expected) or TESTFAIL;
+
+		// with a remainder after the vectors
+		expected = vectors;
+		result = vectors;
+		scale_floats_scalar(expected.data(), 31, 0.3f);
+		scale_floats(result.data(), 31, 0.3f);
+		(result == expected) or TESTFAIL;
+	}
+}
+
+
+// exported benchmark
+void matrix_benchmark(testing::Benchmark &bench) {
+	// the vertices of the terrain and units on a screen
+	constexpr size_t count = 16384;
+
+	rng::RNG rng{0};
+	std::vector<float> matrix = random_floats(rng, 16);
+	std::vector<float> vectors = random_floats(rng, 4 * count);
+	std::vector<float> transformed(4 * count);
+
+	bench.measure("transform scalar", [&] {
+		transform4_scalar(transformed.data(), matrix.data(), vectors.data(), count);
+		testing::use_result(transformed.data());
+	});
+	bench.measure("transform kernel", [&] {
+		transform4(transformed.data(), matrix.data(), vectors.data(), count);
+		testing::use_result(transformed.data());
+	});
+
+	// chained camera and projection matrices
+	std::vector<float> product(16);
+	bench.measure("multiply scalar", [&] {
+		for (size_t i = 0; i + 16 <= vectors.size(); i += 16) {
+			multiply4x4_scalar(product.data(), matrix.data(), vectors.data() + i);
+		}
+		testing::use_result(product.data());
+	});
+	bench.measure("multiply kernel", [&] {
+		for (size_t i = 0; i + 16 <= vectors.size(); i += 16) {
+			multiply4x4(product.data(), matrix.data(), vectors.data() + i);
+		}
+		testing::use_result(product.data());
+	});
+
+	bench.measure("scale scalar", [&] {
+		scale_floats_scalar(vectors.data(), vectors.size(), 1.0f);
+		testing::use_result(vectors.data());
+	});
+	bench.measure("scale kernel", [&] {
+		scale_floats(vectors.data(), vectors.size(), 1.0f);
+		testing::use_result(vectors.data());
+	});
+
+	log::log(MSG(info) << count << " vectors, kernel: " << matrix_kernel_name());
 }
 
 }}} // openage::util::tests
@@ -0,0 +1,186 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "metrics.h"
+
+#include <algorithm>
+
+#include "../error/error.h"
+#include "strings.h"
+
+namespace openage {
+namespace util {
+
+
+uint64_t MetricCounter::value() const {
+	uint64_t sum = 0;
+	for (auto &slot : this->slots) {
+		sum += slot.value.load(std::memory_order_relaxed);
+	}
+	return sum;
+}
+
+
+void MetricHistogram::add(uint64_t value) {
+	size_t bits = 0;
+	for (uint64_t rest = value; rest != 0; rest >>= 1) {
+		bits++;
+	}
+	this->buckets[std::min(bits, bucket_count - 1)].fetch_add(1, std::memory_order_relaxed);
+	this->total.fetch_add(value, std::memory_order_relaxed);
+
+	uint64_t largest = this->largest.load(std::memory_order_relaxed);
+	while (value > largest and
+	       not this->largest.compare_exchange_weak(largest, value, std::memory_order_relaxed)) {}
+}
+
+
+uint64_t MetricHistogram::count() const {
+	uint64_t count = 0;
+	for (auto &bucket : this->buckets) {
+		count += bucket.load(std::memory_order_relaxed);
+	}
+	return count;
+}
+
+
+uint64_t MetricHistogram::sum() const {
+	return this->total.load(std::memory_order_relaxed);
+}
+
+
+uint64_t MetricHistogram::max() const {
+	return this->largest.load(std::memory_order_relaxed);
+}
+
+
+uint64_t MetricHistogram::percentile(double fraction) const {
+	uint64_t count = this->count();
+	if (count == 0) {
+		return 0;
+	}
+
+	uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count + 0.5));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < bucket_count; i++) {
+		seen += this->buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			// values of i bits are below 2^i
+			return (i == 0) ? 0 : std::min(this->max(), (uint64_t{1} << i) - 1);
+		}
+	}
+	return this->max();
+}
+
+
+MetricCounter &Metrics::counter(const std::string &name) {
+	return *this->get(name, metric_kind::counter).counter;
+}
+
+
+MetricGauge &Metrics::gauge(const std::string &name) {
+	return *this->get(name, metric_kind::gauge).gauge;
+}
+
+
+MetricHistogram &Metrics::histogram(const std::string &name) {
+	return *this->get(name, metric_kind::histogram).histogram;
+}
+
+
+Metrics::entry &Metrics::get(const std::string &name, metric_kind kind) {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	auto it = this->entries.find(name);
+	if (it != this->entries.end()) {
+		if (it->second.kind != kind) {
+			throw Error(MSG(err) << "Metric " << name << " is already used by another kind of metric");
+		}
+		return it->second;
+	}
+
+	entry &created = this->entries[name];
+	created.kind = kind;
+	switch (kind) {
+	case metric_kind::counter:
+		created.counter = std::make_unique<MetricCounter>();
+		break;
+	case metric_kind::gauge:
+		created.gauge = std::make_unique<MetricGauge>();
+		break;
+	case metric_kind::histogram:
+		created.histogram = std::make_unique<MetricHistogram>();
+		break;
+	}
+	return created;
+}
+
+
+void Metrics::write_json(std::ostream &out, double time) const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	out << "{\"time\": " << sformat("%.3f", time);
+	for (auto &pair : this->entries) {
+		// the names are dotted identifiers, they need no escaping
+		out << ", \"" << pair.first << "\": ";
+
+		const entry &metric = pair.second;
+		switch (metric.kind) {
+		case metric_kind::counter:
+			out << metric.counter->value();
+			break;
+		case metric_kind::gauge:
+			out << metric.gauge->value();
+			break;
+		case metric_kind::histogram: {
+			const MetricHistogram &histogram = *metric.histogram;
+			out << "{\"count\": " << histogram.count()
+			    << ", \"sum\": " << histogram.sum()
+			    << ", \"p50\": " << histogram.percentile(0.5)
+			    << ", \"p99\": " << histogram.percentile(0.99)
+			    << ", \"max\": " << histogram.max() << "}";
+			break;
+		}
+		}
+	}
+	out << "}" << std::endl;
+}
+
+
+void Metrics::write_text(std::ostream &out, const std::string &prefix) const {
+	std::lock_guard<std::mutex> lock{this->mutex};
+
+	for (auto it = this->entries.lower_bound(prefix);
+	     it != this->entries.end() and it->first.compare(0, prefix.size(), prefix) == 0;
+	     ++it) {
+
+		const entry &metric = it->second;
+		out << it->first << ": ";
+		switch (metric.kind) {
+		case metric_kind::counter:
+			out << metric.counter->value();
+			break;
+		case metric_kind::gauge:
+			out << metric.gauge->value();
+			break;
+		case metric_kind::histogram: {
+			const MetricHistogram &histogram = *metric.histogram;
+			out << histogram.count() << " values, "
+			    << "p50 " << histogram.percentile(0.5) << ", "
+			    << "p99 " << histogram.percentile(0.99) << ", "
+			    << "max " << histogram.max();
+			break;
+		}
+		}
+		out << std::endl;
+	}
+}
+
+
+Metrics &metrics() {
+	// constructed on first use, subsystems may register during static init
+	static Metrics registry;
+	return registry;
+}
+
+
+}} // openage::util
@@ -0,0 +1,168 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "thread_id.h"
+
+namespace openage {
+namespace util {
+
+
+/**
+ * Number of slots a counter is split into.
+ */
+constexpr size_t metric_slots = 16;
+
+
+/**
+ * A value that only grows, e.g. the number of path requests.
+ *
+ * Each thread adds to one of the slots, picked by its thread id, so
+ * threads rarely write to the same cache line. Adding is a relaxed
+ * atomic addition, reading sums up the slots.
+ */
+class MetricCounter {
+public:
+	void add(uint64_t amount=1) {
+		this->slots[get_current_thread_id() % metric_slots].value.fetch_add(
+			amount, std::memory_order_relaxed
+		);
+	}
+
+	uint64_t value() const;
+
+private:
+	struct alignas(64) slot {
+		std::atomic<uint64_t> value{0};
+	};
+
+	std::array<slot, metric_slots> slots;
+};
+
+
+/**
+ * A value that is set or goes up and down, e.g. the number of units.
+ */
+class MetricGauge {
+public:
+	void set(int64_t value) {
+		this->current.store(value, std::memory_order_relaxed);
+	}
+
+	void add(int64_t amount) {
+		this->current.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	int64_t value() const {
+		return this->current.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int64_t> current{0};
+};
+
+
+/**
+ * The distribution of values, e.g. the durations of path searches.
+ *
+ * The values are counted in buckets of powers of two, so percentiles
+ * are accurate to a factor of two.
+ */
+class MetricHistogram {
+public:
+	static constexpr size_t bucket_count = 64;
+
+	void add(uint64_t value);
+
+	uint64_t count() const;
+	uint64_t sum() const;
+	uint64_t max() const;
+
+	/**
+	 * the upper bound of the bucket containing the
+	 * given fraction of the values, 0 without values.
+	 */
+	uint64_t percentile(double fraction) const;
+
+private:
+	/**
+	 * bucket i counts the values which need i bits.
+	 */
+	std::array<std::atomic<uint64_t>, bucket_count> buckets{};
+	std::atomic<uint64_t> total{0};
+	std::atomic<uint64_t> largest{0};
+};
+
+
+/**
+ * The metrics of all subsystems, by name.
+ *
+ * A subsystem looks its metrics up once, e.g. when it's created, and
+ * updates them directly afterwards. The metrics are never removed,
+ * the references stay valid until the program exits.
+ *
+ * The names are dotted paths like "path.requests".
+ */
+class Metrics {
+public:
+	/**
+	 * the metric of the name, created if it doesn't exist yet.
+	 * throws if the name is used by a metric of another kind.
+	 */
+	MetricCounter &counter(const std::string &name);
+	MetricGauge &gauge(const std::string &name);
+	MetricHistogram &histogram(const std::string &name);
+
+	/**
+	 * writes all metrics as a json object on one line,
+	 * with the given time in seconds.
+	 */
+	void write_json(std::ostream &out, double time) const;
+
+	/**
+	 * writes a line for each metric whose name starts with the prefix.
+	 */
+	void write_text(std::ostream &out, const std::string &prefix="") const;
+
+private:
+	enum class metric_kind {
+		counter,
+		gauge,
+		histogram,
+	};
+
+	struct entry {
+		metric_kind kind;
+		std::unique_ptr<MetricCounter> counter;
+		std::unique_ptr<MetricGauge> gauge;
+		std::unique_ptr<MetricHistogram> histogram;
+	};
+
+	entry &get(const std::string &name, metric_kind kind);
+
+	mutable std::mutex mutex;
+
+	/**
+	 * sorted by name, so related metrics are listed together
+	 */
+	std::map<std::string, entry> entries;
+};
+
+
+/**
+ * The metrics registry of the process.
+ */
+Metrics &metrics();
+
+
+}} // openage::util
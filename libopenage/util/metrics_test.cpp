@@ -0,0 +1,70 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "metrics.h"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../error/error.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+// exported test
+void metrics() {
+	Metrics registry;
+
+	MetricCounter &counter = registry.counter("test.counter");
+	&registry.counter("test.counter") == &counter or TESTFAIL;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.emplace_back([&counter]() {
+			for (int j = 0; j < 1000; j++) {
+				counter.add();
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	counter.value() == 4000 or TESTFAIL;
+
+	MetricGauge &gauge = registry.gauge("test.gauge");
+	gauge.set(10);
+	gauge.add(-3);
+	gauge.value() == 7 or TESTFAIL;
+
+	MetricHistogram &histogram = registry.histogram("test.histogram");
+	histogram.percentile(0.5) == 0 or TESTFAIL;
+	for (uint64_t value = 1; value <= 100; value++) {
+		histogram.add(value);
+	}
+	histogram.count() == 100 or TESTFAIL;
+	histogram.sum() == 5050 or TESTFAIL;
+	histogram.max() == 100 or TESTFAIL;
+	// 50 is in the bucket of 32 to 63
+	histogram.percentile(0.5) == 63 or TESTFAIL;
+	histogram.percentile(1.0) == 100 or TESTFAIL;
+
+	// a name has one kind
+	TESTTHROWS(registry.gauge("test.counter"));
+
+	std::ostringstream json;
+	registry.write_json(json, 1.5);
+	json.str() ==
+		"{\"time\": 1.500, \"test.counter\": 4000, \"test.gauge\": 7, "
+		"\"test.histogram\": {\"count\": 100, \"sum\": 5050, \"p50\": 63, \"p99\": 100, \"max\": 100}}\n"
+		or TESTFAIL;
+
+	std::ostringstream text;
+	registry.write_text(text, "test.g");
+	text.str() == "test.gauge: 7\n" or TESTFAIL;
+}
+
+
+}}} // openage::util::tests
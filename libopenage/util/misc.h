@@ -1,7 +1,9 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
+#include <cstdint>
+
 namespace openage {
 namespace util {
 
@@ -53,6 +55,34 @@ inline T div(T x, T m) {
 	return (x - mod<T>(x, m)) / m;
 }
 
+/**
+ * integer square root, rounded down.
+ *
+ * computed digit by digit without floating point,
+ * so the result is the same on all platforms.
+ */
+constexpr uint64_t isqrt(uint64_t x) {
+	uint64_t result = 0;
+	uint64_t bit = uint64_t{1} << 62;
+
+	// highest power of four not above x
+	while (bit > x) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (x >= result + bit) {
+			x -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return result;
+}
+
 /**
  * generic callable, that compares any types for creating a total order.
  *
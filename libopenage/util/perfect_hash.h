@@ -0,0 +1,192 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace openage {
+namespace util {
+
+namespace perfect_hash_detail {
+
+constexpr size_t round_up_pow2(size_t value) {
+	size_t result = 1;
+	while (result < value) {
+		result *= 2;
+	}
+	return result;
+}
+
+} // perfect_hash_detail
+
+
+/**
+ * Maps a fixed set of strings to their index in the set, e.g. names of
+ * enum values to the values, without collisions.
+ *
+ * The table is built by the compiler when the object is constexpr, so a
+ * lookup hashes the string once, compares it with one key and never
+ * allocates. Lookups are usable before any static initialization.
+ *
+ *   constexpr const char *names[] = {"move", "patrol"};
+ *   constexpr auto name_index = make_perfect_hash(names);
+ *   name_index.find("patrol") == 1
+ *
+ * The keys have to be unique and to outlive the table.
+ */
+template<size_t N>
+class PerfectHash {
+public:
+	/**
+	 * returned by find for strings that are not in the set.
+	 */
+	static constexpr size_t not_found = N;
+
+	/**
+	 * slots of the table, a power of two with at most a quarter in use.
+	 */
+	static constexpr size_t table_size = perfect_hash_detail::round_up_pow2(4 * N);
+
+	constexpr PerfectHash(const char *const (&keys)[N])
+		:
+		keys{},
+		seed{0},
+		table{} {
+
+		for (size_t i = 0; i < N; i++) {
+			this->keys[i] = keys[i];
+			for (size_t j = 0; j < i; j++) {
+				if (equal(keys[i], length(keys[i]), keys[j])) {
+					throw "duplicate key in perfect hash";
+				}
+			}
+		}
+
+		this->seed = find_seed(keys);
+
+		for (size_t i = 0; i < N; i++) {
+			this->table[slot_of(this->seed, keys[i], length(keys[i]))] = i + 1;
+		}
+	}
+
+	/**
+	 * index of the key that is equal to the len chars at str,
+	 * or not_found.
+	 */
+	constexpr size_t find(const char *str, size_t len) const {
+		size_t entry = this->table[slot_of(this->seed, str, len)];
+		if (entry == 0 or not equal(str, len, this->keys[entry - 1])) {
+			return not_found;
+		}
+		return entry - 1;
+	}
+
+	constexpr size_t find(const char *str) const {
+		return this->find(str, length(str));
+	}
+
+	size_t find(const std::string &str) const {
+		return this->find(str.data(), str.size());
+	}
+
+	constexpr bool contains(const char *str, size_t len) const {
+		return this->find(str, len) != not_found;
+	}
+
+	bool contains(const std::string &str) const {
+		return this->find(str) != not_found;
+	}
+
+	/**
+	 * the key at an index, e.g. to map enum values back to their names.
+	 */
+	constexpr const char *key(size_t index) const {
+		return this->keys[index];
+	}
+
+	constexpr size_t size() const {
+		return N;
+	}
+
+private:
+	static constexpr size_t length(const char *str) {
+		size_t len = 0;
+		while (str[len] != '\0') {
+			len++;
+		}
+		return len;
+	}
+
+	/**
+	 * whether the len chars at str are the whole of key.
+	 */
+	static constexpr bool equal(const char *str, size_t len, const char *key) {
+		for (size_t i = 0; i < len; i++) {
+			if (key[i] != str[i] or key[i] == '\0') {
+				return false;
+			}
+		}
+		return key[len] == '\0';
+	}
+
+	/**
+	 * FNV-1a of the chars, started at a seeded basis and mixed at the end
+	 * so the low bits, which select the slot, depend on the seed.
+	 */
+	static constexpr size_t slot_of(uint64_t seed, const char *str, size_t len) {
+		uint64_t hash = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+		for (size_t i = 0; i < len; i++) {
+			hash = (hash ^ static_cast<unsigned char>(str[i])) * 1099511628211ull;
+		}
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		return static_cast<size_t>(hash & (table_size - 1));
+	}
+
+	/**
+	 * the first seed for which all keys end up in different slots.
+	 */
+	static constexpr uint64_t find_seed(const char *const (&keys)[N]) {
+		for (uint64_t seed = 0; seed < max_seed; seed++) {
+			bool used[table_size] = {};
+			bool collision = false;
+
+			for (size_t i = 0; i < N and not collision; i++) {
+				size_t slot = slot_of(seed, keys[i], length(keys[i]));
+				collision = used[slot];
+				used[slot] = true;
+			}
+
+			if (not collision) {
+				return seed;
+			}
+		}
+		throw "no perfect hash seed found";
+	}
+
+	/**
+	 * seeds that are tried; with a quarter of the slots in use,
+	 * one of the first few works for any sensible set.
+	 */
+	static constexpr uint64_t max_seed = 1 << 16;
+
+	const char *keys[N];
+	uint64_t seed;
+
+	/** index + 1 of the key in each slot, 0 for empty ones */
+	size_t table[table_size];
+};
+
+
+/**
+ * builds the perfect hash of an array of keys, usually as constexpr.
+ */
+template<size_t N>
+constexpr PerfectHash<N> make_perfect_hash(const char *const (&keys)[N]) {
+	return PerfectHash<N>{keys};
+}
+
+}} // openage::util
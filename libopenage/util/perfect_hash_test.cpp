@@ -0,0 +1,49 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "perfect_hash.h"
+
+#include <string>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+namespace {
+
+constexpr const char *words[] = {
+	"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta",
+	"iota", "kappa", "lambda", "mu", "nu", "xi", "omicron", "pi", "",
+};
+
+constexpr auto word_index = make_perfect_hash(words);
+
+// the table is built and usable at compile time
+static_assert(word_index.find("alpha") == 0, "perfect hash lookup");
+static_assert(word_index.find("pi") == 15, "perfect hash lookup");
+static_assert(word_index.find("") == 16, "perfect hash lookup");
+static_assert(word_index.find("rho") == word_index.not_found, "perfect hash miss");
+
+} // anonymous namespace
+
+
+// exported test
+void perfect_hash() {
+	for (size_t i = 0; i < word_index.size(); i++) {
+		word_index.find(std::string{words[i]}) == i or TESTFAIL;
+		word_index.key(i) == words[i] or TESTFAIL;
+	}
+
+	// prefixes, extensions and other strings are not found
+	word_index.find(std::string{"alph"}) == word_index.not_found or TESTFAIL;
+	word_index.find(std::string{"alphabet"}) == word_index.not_found or TESTFAIL;
+	word_index.find(std::string{"Alpha"}) == word_index.not_found or TESTFAIL;
+	word_index.contains(std::string{"beta\0", 5}) and TESTFAIL;
+	word_index.contains("gamma", 3) and TESTFAIL;
+	word_index.contains("gamma", 5) or TESTFAIL;
+}
+
+
+}}} // openage::util::tests
@@ -1,16 +1,133 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "profiler.h"
 #include "../engine.h"
+#include "../render_command_list.h"
+#include "../shape_batch.h"
 #include "misc.h"
+#include "timing.h"
+#include "trace.h"
 
-#include <chrono>
 #include <epoxy/gl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <mutex>
 
 namespace openage {
 namespace util {
 
+
+/**
+ * The timer queries of a gpu component, used in turns.
+ *
+ * A query is read before it's used again, if its result is available,
+ * otherwise that frame is not measured. With three of them, the gpu
+ * may be two frames behind before this happens, as it is with the
+ * render thread.
+ */
+struct gpu_timer {
+	static constexpr size_t query_count = 3;
+
+	explicit gpu_timer(const trace_zone *zone)
+		:
+		zone{zone} {}
+
+	/**
+	 * called on the gl thread when the measured commands begin.
+	 */
+	void begin() {
+		if (this->supported < 0) {
+			this->supported = (epoxy_gl_version() >= 33 or
+			                   epoxy_has_gl_extension("GL_ARB_timer_query")) ? 1 : 0;
+		}
+		if (not this->supported) {
+			return;
+		}
+
+		size_t slot = this->next;
+		if (this->pending[slot]) {
+			GLint available = 0;
+			glGetQueryObjectiv(this->queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (not available) {
+				return;
+			}
+			this->collect(slot);
+		}
+
+		if (this->queries[slot] == 0) {
+			glGenQueries(1, &this->queries[slot]);
+		}
+
+		this->cpu_start[slot] = timing::get_monotonic_time();
+		glBeginQuery(GL_TIME_ELAPSED, this->queries[slot]);
+		this->active = true;
+	}
+
+	/**
+	 * called on the gl thread when the measured commands are done.
+	 */
+	void end() {
+		if (not this->active) {
+			return;
+		}
+
+		glEndQuery(GL_TIME_ELAPSED);
+		this->pending[this->next] = true;
+		this->next = (this->next + 1) % query_count;
+		this->active = false;
+	}
+
+	/**
+	 * reads the result of an available query.
+	 */
+	void collect(size_t slot) {
+		GLuint64 duration = 0;
+		glGetQueryObjectui64v(this->queries[slot], GL_QUERY_RESULT, &duration);
+		this->pending[slot] = false;
+		this->elapsed = duration;
+
+		// the gpu runs the commands some time after they were issued,
+		// the event is placed at the issue time.
+		trace_record(*this->zone, "gpu", this->cpu_start[slot], duration);
+	}
+
+	// only used on the gl thread.
+	// the queries are deleted along with the gl context.
+	int supported = -1;
+	std::array<GLuint, query_count> queries{};
+	std::array<bool, query_count> pending{};
+	std::array<time_nsec_t, query_count> cpu_start{};
+	size_t next = 0;
+	bool active = false;
+
+	/**
+	 * the duration of the latest finished measurement, in ns.
+	 */
+	std::atomic<uint64_t> elapsed{0};
+
+	const trace_zone *zone;
+};
+
+
+namespace {
+
+/**
+ * the trace zone of a gpu component. the events refer to the zones,
+ * so they are kept until the program exits.
+ */
+const trace_zone *gpu_zone(const StringId &com) {
+	static std::mutex zones_mutex;
+	static std::unordered_map<StringId, trace_zone> zones;
+
+	std::lock_guard<std::mutex> lock{zones_mutex};
+	return &zones.emplace(com, trace_zone{StringId::intern(com).c_str()}).first->second;
+}
+
+} // anonymous namespace
+
+
 Profiler::Profiler(Engine *engine)
 	:
 	engine{engine} {}
@@ -20,13 +137,16 @@ Profiler::~Profiler() {
 	this->unregister_all();
 }
 
-void Profiler::register_component(std::string com, color component_color) {
+void Profiler::register_component(const StringId &com, color component_color) {
 	if (this->registered(com)) {
 		return;
 	}
 
+	// detects components whose ids collide
+	StringId::intern(com);
+
 	component_time_data cdt;
-	cdt.display_name = com;
+	cdt.display_name = com.to_string();
 	cdt.drawing_color = component_color;
 
 	for (auto &val : cdt.history) {
@@ -36,75 +156,123 @@ void Profiler::register_component(std::string com, color component_color) {
 	this->components[com] = cdt;
 }
 
-void Profiler::unregister_component(std::string com) {
-	if (not this->registered(com)) {
-		return;
-	}
-
+void Profiler::unregister_component(const StringId &com) {
 	this->components.erase(com);
 }
 
 void Profiler::unregister_all() {
-	std::vector<std::string> registered_components = this->registered_components();
-
-	for (auto com : registered_components) {
-		this->unregister_component(com);
-	}
+	this->components.clear();
 }
 
 std::vector<std::string> Profiler::registered_components() {
 	std::vector<std::string> registered_components;
 	for (auto &pair : this->components) {
-		registered_components.push_back(pair.first);
+		registered_components.push_back(pair.second.display_name);
 	}
 
 	return registered_components;
 }
 
-void Profiler::start_measure(std::string com, color component_color) {
-	if (not this->engine_in_debug_mode()) {
+void Profiler::start_measure(const StringId &com, color component_color) {
+	if (not this->measuring()) {
 		return;
 	}
 
-	if (not this->registered(com)) {
+	auto it = this->components.find(com);
+	if (it == this->components.end()) {
 		this->register_component(com, component_color);
+		it = this->components.find(com);
 	}
 
-	this->components[com].start = std::chrono::high_resolution_clock::now();
+	it->second.start = std::chrono::high_resolution_clock::now();
 }
 
-void Profiler::end_measure(std::string com) {
-	if (not this->engine_in_debug_mode()) {
+void Profiler::end_measure(const StringId &com) {
+	if (not this->measuring()) {
 		return;
 	}
 
-	if (this->registered(com)) {
+	auto it = this->components.find(com);
+	if (it != this->components.end()) {
 		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-		this->components[com].duration = end - this->components[com].start;
+		it->second.duration = end - it->second.start;
+	}
+}
+
+void Profiler::start_gpu_measure(const StringId &com, color component_color) {
+	if (not this->measuring()) {
+		return;
+	}
+
+	if (not this->registered(com)) {
+		this->register_component(com, component_color);
+	}
+
+	std::shared_ptr<gpu_timer> &timer = this->gpu_timers[com];
+	if (not timer) {
+		timer = std::make_shared<gpu_timer>(gpu_zone(com));
+	}
+
+	std::shared_ptr<gpu_timer> command_timer = timer;
+	RenderCommandList::submit([command_timer] {
+		command_timer->begin();
+	});
+}
+
+void Profiler::end_gpu_measure(const StringId &com) {
+	if (not this->measuring()) {
+		return;
+	}
+
+	auto it = this->gpu_timers.find(com);
+	if (it == this->gpu_timers.end()) {
+		return;
 	}
+
+	std::shared_ptr<gpu_timer> timer = it->second;
+	RenderCommandList::submit([timer] {
+		timer->end();
+	});
 }
 
-void Profiler::draw_component_performance(std::string com) {
-	color rgb = this->components[com].drawing_color;
-	glColor4f(rgb.r, rgb.g, rgb.b, 1.0);
+void Profiler::set_counter(const StringId &name, size_t value) {
+	for (auto &counter : this->counters) {
+		if (counter.first == name) {
+			counter.second = value;
+			return;
+		}
+	}
+
+	// detects counters whose ids collide
+	StringId::intern(name);
+	this->counters.emplace_back(name, value);
+}
+
+void Profiler::draw_component_performance(ShapeBatch &shapes, const component_time_data &data) {
+	color rgb = data.drawing_color;
+	shape_color line_color{rgb.r, rgb.g, rgb.b, 1.0};
 
-	glLineWidth(1.0);
-	glBegin(GL_LINE_STRIP);
 	float x_offset = 0.0;
 	float offset_factor = (float)PROFILER_CANVAS_WIDTH / (float)MAX_DURATION_HISTORY;
 	float percentage_factor = (float)PROFILER_CANVAS_HEIGHT / 100.0;
 
+	// the plot starts at the oldest entry of the history
+	float last_x = 0, last_y = 0;
+	bool first = true;
 	for (auto i = this->insert_pos; mod(i, MAX_DURATION_HISTORY) != mod(this->insert_pos-1, MAX_DURATION_HISTORY); ++i) {
 		i = mod(i, MAX_DURATION_HISTORY);
 
-		auto percentage = this->components[com].history.at(i);
-		glVertex3f(PROFILER_CANVAS_POSITION_X + x_offset, PROFILER_CANVAS_POSITION_Y + percentage * percentage_factor, 0.0);
+		float x = PROFILER_CANVAS_POSITION_X + x_offset;
+		float y = PROFILER_CANVAS_POSITION_Y + data.history.at(i) * percentage_factor;
+		if (not first) {
+			shapes.line(last_x, last_y, x, y, line_color);
+		}
+
+		last_x = x;
+		last_y = y;
+		first = false;
 		x_offset += offset_factor;
 	}
-	glEnd();
-
-	// reset color
-	glColor4f(1.0, 1.0, 1.0, 1.0);
 }
 
 void Profiler::show(bool debug_mode) {
@@ -114,16 +282,19 @@ void Profiler::show(bool debug_mode) {
 }
 
 void Profiler::show() {
+	ShapeBatch shapes;
 
-	this->draw_canvas();
-	this->draw_legend();
+	this->draw_canvas(shapes);
 
-	for (auto com : this->components) {
-		this->draw_component_performance(com.first);
+	for (auto &com : this->components) {
+		this->draw_component_performance(shapes, com.second);
 	}
+
+	this->draw_legend(shapes);
+	this->draw_counters();
 }
 
-bool Profiler::registered(std::string com) const {
+bool Profiler::registered(const StringId &com) const {
 	return this->components.find(com) != this->components.end();
 }
 
@@ -132,53 +303,123 @@ unsigned Profiler::size() const {
 }
 
 void Profiler::start_frame_measure() {
-	if (this->engine_in_debug_mode()) {
+	if (this->measuring()) {
 		this->frame_start = std::chrono::high_resolution_clock::now();
 	}
 }
 
 void Profiler::end_frame_measure() {
-	if (not this->engine_in_debug_mode()) {
+	if (not this->measuring()) {
 		return;
 	}
 
 	auto frame_end = std::chrono::high_resolution_clock::now();
 	this->frame_duration = frame_end - this->frame_start;
 
-	for (auto com : this->registered_components()) {
-		double percentage = this->duration_to_percentage(this->components[com].duration);
-		this->append_to_history(com, percentage);
+	// the latest gpu times are shown, they are some frames old
+	for (auto &pair : this->gpu_timers) {
+		auto it = this->components.find(pair.first);
+		if (it != this->components.end()) {
+			it->second.duration = std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+				std::chrono::nanoseconds{pair.second->elapsed.load()});
+		}
+	}
+
+	for (auto &pair : this->components) {
+		component_time_data &data = pair.second;
+
+		double percentage = this->duration_to_percentage(data.duration);
+		this->append_to_history(data, percentage);
+
+		if (this->recording_histograms) {
+			data.histogram.add(std::chrono::duration_cast<std::chrono::nanoseconds>(data.duration).count());
+		}
+
+		// components that are not measured in the next frame took no time
+		data.duration = std::chrono::high_resolution_clock::duration::zero();
 	}
 
 	this->insert_pos++;
 }
 
-void Profiler::draw_canvas() {
-	glColor4f(0.2, 0.2, 0.2, PROFILER_CANVAS_ALPHA);
-	glRecti(PROFILER_CANVAS_POSITION_X,
-	        PROFILER_CANVAS_POSITION_Y,
-	        PROFILER_CANVAS_POSITION_X + PROFILER_CANVAS_WIDTH,
-	        PROFILER_CANVAS_POSITION_Y + PROFILER_CANVAS_HEIGHT);
+void Profiler::record_histograms(bool enabled) {
+	if (enabled and not this->recording_histograms) {
+		for (auto &pair : this->components) {
+			pair.second.histogram.clear();
+		}
+	}
+	this->recording_histograms = enabled;
 }
 
-void Profiler::draw_legend() {
+void Profiler::write_histograms(std::ostream &out, bool buckets) const {
+	std::vector<const component_time_data *> sorted;
+	for (auto &pair : this->components) {
+		sorted.push_back(&pair.second);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const component_time_data *a, const component_time_data *b) {
+		return a->display_name < b->display_name;
+	});
+
+	for (auto data : sorted) {
+		const DurationHistogram &histogram = data->histogram;
+		out << data->display_name << ": ";
+		histogram.write_summary(out);
+		out << std::endl;
+		if (buckets) {
+			histogram.write_buckets(out);
+		}
+	}
+}
+
+void Profiler::draw_canvas(ShapeBatch &shapes) {
+	shapes.rect(PROFILER_CANVAS_POSITION_X,
+	            PROFILER_CANVAS_POSITION_Y,
+	            PROFILER_CANVAS_POSITION_X + PROFILER_CANVAS_WIDTH,
+	            PROFILER_CANVAS_POSITION_Y + PROFILER_CANVAS_HEIGHT,
+	            shape_color{0.2, 0.2, 0.2, PROFILER_CANVAS_ALPHA});
+}
+
+void Profiler::draw_legend(ShapeBatch &shapes) {
 	int offset = 0;
-	for (auto com : this->components) {
-		glColor4f(com.second.drawing_color.r, com.second.drawing_color.g, com.second.drawing_color.b, 1.0);
+	for (auto &com : this->components) {
+		color rgb = com.second.drawing_color;
 		int box_x = PROFILER_CANVAS_POSITION_X + 2;
 		int box_y = PROFILER_CANVAS_POSITION_Y - PROFILER_COM_BOX_HEIGHT - 2 - offset;
-		glRecti(box_x, box_y, box_x + PROFILER_COM_BOX_WIDTH, box_y + PROFILER_COM_BOX_HEIGHT);
 
-		glColor4f(0.2, 0.2, 0.2, 1);
+		shapes.rect(box_x, box_y, box_x + PROFILER_COM_BOX_WIDTH, box_y + PROFILER_COM_BOX_HEIGHT,
+		            shape_color{rgb.r, rgb.g, rgb.b, 1.0});
+
+		offset += PROFILER_COM_BOX_HEIGHT + 2;
+	}
+
+	// the shapes are drawn below the names
+	shapes.submit();
+
+	offset = 0;
+	for (auto &com : this->components) {
 		coord::window position = coord::window();
-		position.x = box_x + PROFILER_COM_BOX_WIDTH + 2;
-		position.y = box_y + 2;
+		position.x = PROFILER_CANVAS_POSITION_X + 2 + PROFILER_COM_BOX_WIDTH + 2;
+		position.y = PROFILER_CANVAS_POSITION_Y - PROFILER_COM_BOX_HEIGHT - 2 - offset + 2;
 		this->engine->render_text(position, 12, "%s", com.second.display_name.c_str());
 
 		offset += PROFILER_COM_BOX_HEIGHT + 2;
 	}
 }
 
+void Profiler::draw_counters() {
+	int offset = 0;
+	for (auto &counter : this->counters) {
+		coord::window position = coord::window();
+		position.x = PROFILER_CANVAS_POSITION_X + 2;
+		position.y = PROFILER_CANVAS_POSITION_Y - PROFILER_COM_BOX_HEIGHT - 2
+		             - (this->components.size() + 1) * (PROFILER_COM_BOX_HEIGHT + 2) - offset + 2;
+		this->engine->render_text(position, 12, "%s: %zu",
+		                          counter.first.to_string().c_str(), counter.second);
+
+		offset += PROFILER_COM_BOX_HEIGHT + 2;
+	}
+}
+
 double Profiler::duration_to_percentage(std::chrono::high_resolution_clock::duration duration) {
 	double dur = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
 	double ref = std::chrono::duration_cast<std::chrono::microseconds>(this->frame_duration).count();
@@ -186,11 +427,15 @@ double Profiler::duration_to_percentage(std::chrono::high_resolution_clock::dura
 	return percentage;
 }
 
-void Profiler::append_to_history(std::string com, double percentage) {
+void Profiler::append_to_history(component_time_data &data, double percentage) {
 	if (this->insert_pos == MAX_DURATION_HISTORY) {
 		this->insert_pos = 0;
 	}
-	this->components[com].history[this->insert_pos] = percentage;
+	data.history[this->insert_pos] = percentage;
+}
+
+bool Profiler::measuring() {
+	return this->recording_histograms or this->engine_in_debug_mode();
 }
 
 bool Profiler::engine_in_debug_mode() {
@@ -1,13 +1,17 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <array>
 #include <chrono>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
+#include "duration_histogram.h"
+#include "string_id.h"
+
 constexpr int MAX_DURATION_HISTORY = 100;
 constexpr int PROFILER_CANVAS_WIDTH = 250;
 constexpr int PROFILER_CANVAS_HEIGHT = 120;
@@ -20,6 +24,7 @@ constexpr int PROFILER_COM_BOX_HEIGHT = 15;
 namespace openage {
 
 class Engine;
+class ShapeBatch;
 
 
 namespace util {
@@ -28,12 +33,15 @@ struct color {
 	float r, g, b;
 };
 
+struct gpu_timer;
+
 struct component_time_data {
 	std::string display_name;
 	color drawing_color;
 	std::chrono::high_resolution_clock::time_point start;
 	std::chrono::high_resolution_clock::duration duration;
 	std::array<double, MAX_DURATION_HISTORY> history;
+	DurationHistogram histogram;
 };
 
 class Profiler {
@@ -43,16 +51,16 @@ public:
 
 	/**
 	 * registers a component
-	 * @param com the identifier to distinguish the components
+	 * @param com the identifier to distinguish the components, its string is displayed
 	 * @param component_color color of the plotted line
 	 */
-	void register_component(std::string com, color component_color);
+	void register_component(const StringId &com, color component_color);
 
 	/**
 	 * unregisters an individual component
 	 * @param com component name which should be unregistered
 	 */
-	void unregister_component(std::string com);
+	void unregister_component(const StringId &com);
 
 	/**
 	 * unregisters all remaining components
@@ -69,13 +77,30 @@ public:
 	 * registered, its getting registered and the profiler uses the color
 	 * information given by component_color. The default value is white.
 	 */
-	void start_measure(std::string com, color component_color={1.0, 1.0, 1.0});
+	void start_measure(const StringId &com, color component_color={1.0, 1.0, 1.0});
 
 	/*
 	 * stops the measurement for the component com. If com is not yet
 	 * registered it does nothing.
 	 */
-	void end_measure(std::string com);
+	void end_measure(const StringId &com);
+
+	/**
+	 * starts measuring the gpu time of the gl commands submitted until
+	 * end_gpu_measure, with a timer query. the component is shown like
+	 * the cpu ones, so its id should tell them apart, e.g. "terrain gpu".
+	 *
+	 * the queries are read some frames later, when their results are
+	 * available, so the cpu never waits for the gpu. the measurements
+	 * are also recorded to the "gpu" timeline of the trace.
+	 * measurements can't be nested.
+	 */
+	void start_gpu_measure(const StringId &com, color component_color={1.0, 1.0, 1.0});
+
+	/**
+	 * ends the gpu measurement of the component com.
+	 */
+	void end_gpu_measure(const StringId &com);
 
 	/*
 	 * draws the profiler gui if debug_mode is set
@@ -90,13 +115,19 @@ public:
 	/*
 	 * true if the component com is already registered, otherwise false
 	 */
-	bool registered(std::string com) const;
+	bool registered(const StringId &com) const;
 
 	/*
 	 * returns the number of registered components
 	 */
 	unsigned size() const;
 
+	/**
+	 * sets a value that is shown next to the measurements,
+	 * e.g. the length of a queue.
+	 */
+	void set_counter(const StringId &name, size_t value);
+
 	/**
 	 * sets the start point for the actual frame which is used as a reference
 	 * value for the registered components
@@ -110,18 +141,60 @@ public:
 	 */
 	void end_frame_measure();
 
+	/**
+	 * when enabled, the components are measured even without the debug
+	 * overlay, and each frame's durations are added to their histograms.
+	 * enabling it clears the histograms.
+	 */
+	void record_histograms(bool enabled);
+
+	/**
+	 * writes the summary of each component's histogram,
+	 * followed by its buckets if requested.
+	 */
+	void write_histograms(std::ostream &out, bool buckets=true) const;
+
 private:
-	void draw_canvas();
-	void draw_legend();
-	void draw_component_performance(std::string com);
+	void draw_canvas(ShapeBatch &shapes);
+
+	/**
+	 * adds the color boxes of the components, submits the shapes
+	 * and draws the component names.
+	 */
+	void draw_legend(ShapeBatch &shapes);
+
+	void draw_component_performance(ShapeBatch &shapes, const component_time_data &data);
+
+	/**
+	 * draws the names and values of the counters below the canvas.
+	 */
+	void draw_counters();
 	double duration_to_percentage(std::chrono::high_resolution_clock::duration duration);
-	void append_to_history(std::string com, double percentage);
+	void append_to_history(component_time_data &data, double percentage);
 	bool engine_in_debug_mode();
 
+	/**
+	 * true if the debug overlay shows the measurements
+	 * or if the histograms are recorded.
+	 */
+	bool measuring();
+
 	std::chrono::high_resolution_clock::time_point frame_start;
 	std::chrono::high_resolution_clock::duration frame_duration;
-	std::unordered_map<std::string, component_time_data> components;
+	std::unordered_map<StringId, component_time_data> components;
+
+	/**
+	 * the timer queries of the gpu components, shared with
+	 * the gl commands, which may run on the render thread.
+	 */
+	std::unordered_map<StringId, std::shared_ptr<gpu_timer>> gpu_timers;
+
+	/**
+	 * the counters by name, in the order they were first set
+	 */
+	std::vector<std::pair<StringId, size_t>> counters;
 	int insert_pos = 0;
+	bool recording_histograms = false;
 
 	Engine *engine;
 };
@@ -0,0 +1,83 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "string_id.h"
+
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+#include "../error/error.h"
+
+namespace openage {
+namespace util {
+
+namespace {
+
+/**
+ * the interned strings, by their hash.
+ * the nodes of the map don't move, so the strings keep their address.
+ */
+struct intern_table {
+	std::mutex mutex;
+	std::unordered_map<uint64_t, std::string> strings;
+};
+
+
+intern_table &get_intern_table() {
+	static intern_table table;
+	return table;
+}
+
+
+/**
+ * the same hash as constexpr_::hash_fnv1a, for strings of known length.
+ */
+uint64_t hash_fnv1a(const char *data, size_t length) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+	}
+	return hash;
+}
+
+} // anonymous namespace
+
+
+StringId StringId::intern(const std::string &str) {
+	return StringId::intern(str.data(), str.size());
+}
+
+
+StringId StringId::intern(const char *data, size_t length) {
+	StringId id;
+	id.hash = hash_fnv1a(data, length);
+
+	intern_table &table = get_intern_table();
+	std::lock_guard<std::mutex> lock{table.mutex};
+
+	auto it = table.strings.find(id.hash);
+	if (it == table.strings.end()) {
+		it = table.strings.emplace(id.hash, std::string{data, length}).first;
+	}
+	else if (it->second.size() != length or
+	         memcmp(it->second.data(), data, length) != 0) {
+		throw Error(MSG(err) << "the string ids of '" << std::string{data, length}
+		            << "' and '" << it->second << "' collide");
+	}
+
+	id.str = it->second.c_str();
+	return id;
+}
+
+
+StringId StringId::intern(const StringId &id) {
+	return StringId::intern(id.str, strlen(id.str));
+}
+
+
+std::ostream &operator <<(std::ostream &os, const StringId &id) {
+	return os << id.c_str();
+}
+
+}} // openage::util
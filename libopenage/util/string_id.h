@@ -0,0 +1,109 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+#include "constexpr.h"
+
+namespace openage {
+namespace util {
+
+/**
+ * Identifies a string by the hash of its content.
+ *
+ * The id of a string literal is computed at compile time, other strings
+ * get theirs by being interned. Ids compare and hash like integers, and
+ * stay the same over all runs, so they're cheap keys for lookup tables
+ * that are filled with names.
+ *
+ * Two different strings with the same hash can't be interned both,
+ * the second one throws.
+ */
+class StringId {
+public:
+	/**
+	 * the id of the empty string.
+	 */
+	constexpr StringId()
+		:
+		StringId{""} {}
+
+	/**
+	 * the id of a string literal, which has to outlive the id.
+	 * the string is not interned.
+	 */
+	constexpr StringId(const char *literal)
+		:
+		hash{constexpr_::hash_fnv1a(literal)},
+		str{literal} {}
+
+	/**
+	 * returns the id of the string, and copies the string into
+	 * the table of interned strings, if it's not there yet.
+	 * the copy is never freed. thread safe.
+	 */
+	static StringId intern(const std::string &str);
+
+	/**
+	 * interns the given characters, which don't need to be null terminated.
+	 * used for names read from gamedata files.
+	 */
+	static StringId intern(const char *data, size_t length);
+
+	/**
+	 * interns the string of the id, e.g. to check it against collisions
+	 * before the id is stored.
+	 */
+	static StringId intern(const StringId &id);
+
+	constexpr uint64_t value() const {
+		return this->hash;
+	}
+
+	constexpr const char *c_str() const {
+		return this->str;
+	}
+
+	std::string to_string() const {
+		return this->str;
+	}
+
+	constexpr bool operator ==(const StringId &other) const {
+		return this->hash == other.hash;
+	}
+
+	constexpr bool operator !=(const StringId &other) const {
+		return this->hash != other.hash;
+	}
+
+	constexpr bool operator <(const StringId &other) const {
+		return this->hash < other.hash;
+	}
+
+	constexpr bool empty() const {
+		return this->str[0] == '\0';
+	}
+
+private:
+	uint64_t hash;
+	const char *str;
+};
+
+
+std::ostream &operator <<(std::ostream &os, const StringId &id);
+
+}} // openage::util
+
+namespace std {
+template<>
+struct hash<openage::util::StringId> {
+	size_t operator ()(const openage::util::StringId &id) const {
+		// the id is a hash already
+		return static_cast<size_t>(id.value());
+	}
+};
+} // namespace std
@@ -0,0 +1,52 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "string_id.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+// exported test
+void string_id() {
+	// the ids of literals are known at compile time
+	constexpr StringId empty{""};
+	constexpr StringId a{"a"};
+	static_assert(empty.value() == 0xcbf29ce484222325ull, "fnv-1a of the empty string");
+	static_assert(a.value() == 0xaf63dc4c8601ec8cull, "fnv-1a of 'a'");
+
+	std::string name = "a";
+	StringId interned = StringId::intern(name);
+	interned == a or TESTFAIL;
+	interned != empty or TESTFAIL;
+
+	// the interned copy stays, and is shared by all interned ids
+	name = "b";
+	TESTEQUALS(interned.to_string(), "a");
+	StringId::intern(std::string{"a"}).c_str() == interned.c_str() or TESTFAIL;
+	StringId::intern(a).c_str() == interned.c_str() or TESTFAIL;
+
+	// characters without a terminator, as in the gamedata string pool
+	const char pool[] = "abc";
+	StringId::intern(pool, 1).c_str() == interned.c_str() or TESTFAIL;
+	StringId::intern(pool + 1, 2) == StringId{"bc"} or TESTFAIL;
+	StringId{} == empty or TESTFAIL;
+	StringId{}.empty() or TESTFAIL;
+
+	std::unordered_map<StringId, int> values;
+	values[StringId::intern(std::string{"one"})] = 1;
+	values["two"] = 2;
+	TESTEQUALS(values.at("one"), 1);
+	TESTEQUALS(values.at(StringId::intern(std::string{"two"})), 2);
+	values.find("three") == values.end() or TESTFAIL;
+	std::strcmp(values.find("one")->first.c_str(), "one") == 0 or TESTFAIL;
+}
+
+
+}}} // openage::util::tests
@@ -2,7 +2,10 @@
 
 #include "stringformatter.h"
 
+#include <algorithm>
 #include <array>
+#include <clocale>
+#include <cstdio>
 
 namespace openage {
 namespace util {
@@ -61,4 +64,100 @@ void CachableOSStream::release(CachableOSStream *cs) {
 }
 
 
+namespace {
+
+/**
+ * the two digits of each number below 100, to convert two digits at once.
+ */
+constexpr char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+
+/**
+ * writes the digits in front of end, returns a pointer to the first one.
+ */
+char *write_digits(char *end, unsigned long long value) {
+	while (value >= 100) {
+		unsigned int pair = (value % 100) * 2;
+		value /= 100;
+		*--end = digit_pairs[pair + 1];
+		*--end = digit_pairs[pair];
+	}
+
+	if (value >= 10) {
+		unsigned int pair = value * 2;
+		*--end = digit_pairs[pair + 1];
+		*--end = digit_pairs[pair];
+	} else {
+		*--end = static_cast<char>('0' + value);
+	}
+	return end;
+}
+
+
+/**
+ * printf uses the decimal point of the C locale, which the gui
+ * sets to the user's one. the streams always use '.'.
+ */
+void fix_decimal_point(char *begin, char *end) {
+	char point = *std::localeconv()->decimal_point;
+	if (likely(point == '.')) {
+		return;
+	}
+
+	char *found = std::find(begin, end, point);
+	if (found != end) {
+		*found = '.';
+	}
+}
+
+} // anonymous namespace
+
+
+void append_integer(std::string &output, long long value) {
+	// the magnitude of the minimum can't be negated as long long
+	unsigned long long magnitude = value < 0 ? 0ull - static_cast<unsigned long long>(value) : value;
+
+	char buf[24];
+	char *end = buf + sizeof(buf);
+	char *begin = write_digits(end, magnitude);
+	if (value < 0) {
+		*--begin = '-';
+	}
+	output.append(begin, end);
+}
+
+
+void append_integer(std::string &output, unsigned long long value) {
+	char buf[24];
+	char *end = buf + sizeof(buf);
+	output.append(write_digits(end, value), end);
+}
+
+
+void append_float(std::string &output, double value) {
+	char buf[32];
+	int len = std::snprintf(buf, sizeof(buf), "%g", value);
+	fix_decimal_point(buf, buf + len);
+	output.append(buf, len);
+}
+
+
+void append_float(std::string &output, long double value) {
+	char buf[48];
+	int len = std::snprintf(buf, sizeof(buf), "%Lg", value);
+	fix_decimal_point(buf, buf + len);
+	output.append(buf, len);
+}
+
+
 }} // namespace openage::util
@@ -4,6 +4,7 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
 #include <type_traits>
 
 #include "../util/compiler.h"
@@ -75,6 +76,21 @@ private:
 };
 
 
+/**
+ * Append the decimal digits of an integer to output,
+ * as std::ostream does with its default flags.
+ */
+void append_integer(std::string &output, long long value);
+void append_integer(std::string &output, unsigned long long value);
+
+/**
+ * Append a floating-point number to output, as std::ostream does with
+ * its default flags: 6 significant digits, a '.' as decimal point.
+ */
+void append_float(std::string &output, double value);
+void append_float(std::string &output, long double value);
+
+
 /**
  * Wraps an output string stream, and provides all sorts of overloads
  * for operator <<, plus some other formatting methods.
@@ -85,6 +101,8 @@ private:
  *
  * If possible, input data is written directly to the buffer,
  * but if needed, a CachableOSStream is acquired (and later released).
+ * Strings, integers and floats are written directly unless the stream
+ * was given other formatting flags (e.g. std::hex or std::setw).
  * As an optimization, instead of creating a new ExternalOStringStream object,
  * CachableOSStream.acquire() is used internally.
  */
@@ -167,6 +185,22 @@ public:
 	}
 
 
+	// Numbers are converted without the locale-aware stream machinery.
+	// char types are not among them, the stream prints them as characters.
+	ChildType &operator <<(short value)              { return this->put_integer(value); }
+	ChildType &operator <<(unsigned short value)     { return this->put_integer(value); }
+	ChildType &operator <<(int value)                { return this->put_integer(value); }
+	ChildType &operator <<(unsigned int value)       { return this->put_integer(value); }
+	ChildType &operator <<(long value)               { return this->put_integer(value); }
+	ChildType &operator <<(unsigned long value)      { return this->put_integer(value); }
+	ChildType &operator <<(long long value)          { return this->put_integer(value); }
+	ChildType &operator <<(unsigned long long value) { return this->put_integer(value); }
+
+	ChildType &operator <<(float value)              { return this->put_float(static_cast<double>(value)); }
+	ChildType &operator <<(double value)             { return this->put_float(value); }
+	ChildType &operator <<(long double value)        { return this->put_float(value); }
+
+
 	// Printf-style formatting
 	ChildType &fmt(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
 		va_list ap;
@@ -205,6 +239,43 @@ public:
 
 
 private:
+	/**
+	 * True if numbers may be written directly: there is no stream yet,
+	 * or its flags, width and precision are the initial ones.
+	 */
+	inline bool default_format() const {
+		if (likely(this->stream_ptr == nullptr)) {
+			return true;
+		}
+
+		const std::ostream &stream = this->stream_ptr->stream;
+		return (stream.flags() == (std::ios_base::skipws | std::ios_base::dec) and
+		        stream.width() == 0 and
+		        stream.precision() == 6);
+	}
+
+	template<typename T>
+	ChildType &put_integer(T value) {
+		if (likely(this->default_format())) {
+			using wide_t = typename std::conditional<std::is_signed<T>::value,
+			                                         long long, unsigned long long>::type;
+			append_integer(*this->output, static_cast<wide_t>(value));
+		} else {
+			this->stream_ptr->stream << value;
+		}
+		return this->child_type_ref();
+	}
+
+	template<typename T>
+	ChildType &put_float(T value) {
+		if (likely(this->default_format())) {
+			append_float(*this->output, value);
+		} else {
+			this->stream_ptr->stream << value;
+		}
+		return this->child_type_ref();
+	}
+
 	/**
 	 * Ensures that we have a valid CachableOSStream object in stream_ptr.
 	 */
@@ -0,0 +1,105 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "stringformatter.h"
+
+#include <climits>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include "../testing/benchmark.h"
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+namespace {
+
+/**
+ * the output of FString and std::ostringstream for a value.
+ */
+template<typename T>
+bool same_as_stream(const T &value) {
+	FString fstring;
+	fstring << value;
+
+	std::ostringstream stream;
+	stream << value;
+
+	return fstring.buffer == stream.str();
+}
+
+} // anonymous namespace
+
+
+// exported test
+void string_formatter() {
+	same_as_stream(0) or TESTFAIL;
+	same_as_stream(7) or TESTFAIL;
+	same_as_stream(-42) or TESTFAIL;
+	same_as_stream(100) or TESTFAIL;
+	same_as_stream(INT_MIN) or TESTFAIL;
+	same_as_stream(LLONG_MIN) or TESTFAIL;
+	same_as_stream(LLONG_MAX) or TESTFAIL;
+	same_as_stream(ULLONG_MAX) or TESTFAIL;
+	same_as_stream(static_cast<short>(-5)) or TESTFAIL;
+	same_as_stream(static_cast<size_t>(123456789)) or TESTFAIL;
+
+	same_as_stream(0.0) or TESTFAIL;
+	same_as_stream(-0.0) or TESTFAIL;
+	same_as_stream(1.5f) or TESTFAIL;
+	same_as_stream(0.1) or TESTFAIL;
+	same_as_stream(-123456.789) or TESTFAIL;
+	same_as_stream(1e100) or TESTFAIL;
+	same_as_stream(2.5e-12) or TESTFAIL;
+	same_as_stream(1.25L) or TESTFAIL;
+	same_as_stream(std::numeric_limits<double>::infinity()) or TESTFAIL;
+
+	// chars and bools go through the stream
+	same_as_stream('x') or TESTFAIL;
+	same_as_stream(true) or TESTFAIL;
+
+	// the stream flags apply to the numbers after them
+	FString hex;
+	hex << 10 << " " << std::hex << 255 << " " << std::dec << 255;
+	hex.buffer == "10 ff 255" or TESTFAIL;
+
+	FString fixed;
+	fixed << std::fixed << std::setprecision(2) << 1.0 << " " << std::setw(4) << 7;
+	fixed.buffer == "1.00    7" or TESTFAIL;
+}
+
+
+// exported benchmark
+void string_formatter_benchmark(testing::Benchmark &bench) {
+	constexpr int count = 10000;
+
+	std::string output;
+
+	// the stream all numbers went through before
+	ExternalOStringStream stream;
+	stream.use_with(output);
+
+	bench.measure("ostream", [&] {
+		for (int i = 0; i < count; i++) {
+			output.clear();
+			stream << i << " " << (i * 0.25) << " " << -i;
+		}
+		testing::use_result(output.data());
+	});
+
+	FString formatted;
+
+	bench.measure("formatter", [&] {
+		for (int i = 0; i < count; i++) {
+			formatted.reset();
+			formatted << i << " " << (i * 0.25) << " " << -i;
+		}
+		testing::use_result(formatted.buffer.data());
+	});
+}
+
+
+}}} // openage::util::tests
@@ -1,8 +1,16 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #include "thread_id.h"
 
+#include <cstdlib>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "../config.h"
+#include "../error/error.h"
 
 #if HAVE_THREAD_LOCAL_STORAGE
 #include <atomic>
@@ -50,4 +58,73 @@ size_t get_current_thread_id() {
 	#endif
 }
 
+
+void set_current_thread_name(const std::string &name) {
+	#ifdef __linux__
+	// longer names are rejected instead of cut
+	pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+	#else
+	(void) name;
+	#endif
+}
+
+
+bool set_current_thread_affinity(const std::vector<int> &cpus) {
+	#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu : cpus) {
+		if (cpu >= 0 and cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &set);
+		}
+	}
+
+	if (CPU_COUNT(&set) == 0) {
+		return false;
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	#else
+	(void) cpus;
+	return false;
+	#endif
+}
+
+
+std::vector<int> parse_cpu_list(const std::string &list) {
+	std::vector<int> cpus;
+
+	const char *pos = list.c_str();
+	while (*pos != '\0') {
+		char *end;
+		long first = std::strtol(pos, &end, 10);
+		long last = first;
+		if (end == pos or first < 0) {
+			throw Error(MSG(err) << "invalid cpu list: " << list);
+		}
+		pos = end;
+
+		if (*pos == '-') {
+			pos++;
+			last = std::strtol(pos, &end, 10);
+			if (end == pos or last < first) {
+				throw Error(MSG(err) << "invalid cpu range in list: " << list);
+			}
+			pos = end;
+		}
+
+		for (long cpu = first; cpu <= last; cpu++) {
+			cpus.push_back(static_cast<int>(cpu));
+		}
+
+		if (*pos == ',') {
+			pos++;
+		}
+		else if (*pos != '\0') {
+			throw Error(MSG(err) << "invalid cpu list: " << list);
+		}
+	}
+
+	return cpus;
+}
+
 }} // namespace openage::util
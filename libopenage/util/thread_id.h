@@ -1,8 +1,10 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <stddef.h>
+#include <string>
+#include <vector>
 
 namespace openage {
 namespace util {
@@ -15,4 +17,24 @@ namespace util {
  */
 size_t get_current_thread_id();
 
+/**
+ * Names the current thread for debuggers, top and the like.
+ * The system may cut the name, linux keeps 15 characters.
+ */
+void set_current_thread_name(const std::string &name);
+
+/**
+ * Restricts the current thread to run on the given cpus only.
+ *
+ * Returns false if the system doesn't support it or none of the cpus
+ * can be used, the thread may run anywhere then.
+ */
+bool set_current_thread_affinity(const std::vector<int> &cpus);
+
+/**
+ * Parses a list of cpus like "0-3,8,10-11".
+ * Throws if the list is malformed, the empty string gives no cpus.
+ */
+std::vector<int> parse_cpu_list(const std::string &list);
+
 }} // namespace openage::util
@@ -0,0 +1,398 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../config.h"
+#include "../error/error.h"
+#include "strings.h"
+#include "thread_id.h"
+
+namespace openage {
+namespace util {
+
+
+std::atomic<bool> tracing_active{false};
+
+
+namespace {
+
+/**
+ * events a thread keeps, the oldest ones are overwritten.
+ */
+constexpr size_t events_per_thread = 1 << 15;
+
+
+struct trace_event {
+	const trace_zone *zone;
+	time_nsec_t start;
+	time_nsec_t end;
+	uint32_t frame;
+	uint32_t depth;
+};
+
+
+/**
+ * The timeline of one thread.
+ * Written by the thread, read when the trace is written.
+ */
+struct thread_trace {
+	explicit thread_trace(size_t thread_id)
+		:
+		thread_id{thread_id},
+		written{0},
+		depth{0},
+		exited{false} {}
+
+	void record(const trace_event &event) {
+		std::lock_guard<std::mutex> lock{this->mutex};
+		if (this->events.size() < events_per_thread) {
+			this->events.push_back(event);
+		}
+		else {
+			this->events[this->written % events_per_thread] = event;
+		}
+		this->written++;
+	}
+
+	const size_t thread_id;
+
+	// protected by mutex
+	std::mutex mutex;
+	std::string name;
+	std::vector<trace_event> events;
+	size_t written;
+
+	// only used by the thread
+	uint32_t depth;
+
+	std::atomic<bool> exited;
+};
+
+
+std::mutex threads_mutex;
+
+std::vector<std::shared_ptr<thread_trace>> &threads() {
+	static std::vector<std::shared_ptr<thread_trace>> value;
+	return value;
+}
+
+
+/**
+ * the ids of the timelines not belonging to a thread start here.
+ */
+constexpr size_t timeline_ids = 1 << 20;
+
+// protected by threads_mutex
+size_t timeline_count = 0;
+
+
+std::atomic<uint32_t> current_frame{0};
+
+// protected by threads_mutex
+time_nsec_t trace_begin = 0;
+time_nsec_t frame_begin = 0;
+
+// protected by threads_mutex, the trace was started by startup_trace_begin()
+bool tracing_startup = false;
+
+const trace_zone frame_zone{"frame"};
+
+
+/**
+ * the timeline of the calling thread, nullptr without thread-local storage.
+ */
+thread_trace *own_trace() {
+#if HAVE_THREAD_LOCAL_STORAGE
+	struct holder {
+		~holder() {
+			if (this->trace) {
+				this->trace->exited = true;
+			}
+		}
+		std::shared_ptr<thread_trace> trace;
+	};
+	thread_local holder own;
+
+	if (unlikely(not own.trace)) {
+		own.trace = std::make_shared<thread_trace>(get_current_thread_id());
+
+		std::lock_guard<std::mutex> lock{threads_mutex};
+		threads().push_back(own.trace);
+	}
+
+	return own.trace.get();
+#else
+	return nullptr;
+#endif
+}
+
+
+void write_json_string(std::ostream &out, const char *str) {
+	out << '"';
+	for (const char *c = str; *c != '\0'; c++) {
+		switch (*c) {
+		case '"': out << "\\\""; break;
+		case '\\': out << "\\\\"; break;
+		default:
+			if (static_cast<unsigned char>(*c) < 0x20) {
+				out << sformat("\\u%04x", *c);
+			}
+			else {
+				out << *c;
+			}
+		}
+	}
+	out << '"';
+}
+
+
+/**
+ * nanoseconds as microseconds, the unit of the trace format.
+ */
+std::string microseconds(time_nsec_t time) {
+	return sformat("%llu.%03llu",
+	               static_cast<unsigned long long>(time / 1000),
+	               static_cast<unsigned long long>(time % 1000));
+}
+
+} // anonymous namespace
+
+
+void TraceScope::begin() {
+	thread_trace *trace = own_trace();
+	if (trace == nullptr) {
+		return;
+	}
+
+	trace->depth++;
+	this->start = timing::get_monotonic_time();
+}
+
+
+void TraceScope::end() {
+	time_nsec_t end = timing::get_monotonic_time();
+	thread_trace *trace = own_trace();
+
+	trace->depth--;
+	trace->record({
+		this->zone, this->start, end,
+		current_frame.load(std::memory_order_relaxed), trace->depth
+	});
+}
+
+
+namespace {
+
+/**
+ * Drops the recorded events and starts recording, with threads_mutex held.
+ */
+void start_locked() {
+	auto &all = threads();
+	for (auto it = all.begin(); it != all.end();) {
+		// the timelines of exited threads are kept until now
+		if ((*it)->exited) {
+			it = all.erase(it);
+			continue;
+		}
+
+		std::lock_guard<std::mutex> trace_lock{(*it)->mutex};
+		(*it)->events.clear();
+		(*it)->written = 0;
+		++it;
+	}
+
+	trace_begin = timing::get_monotonic_time();
+	frame_begin = 0;
+	current_frame = 0;
+	tracing_active = true;
+}
+
+} // anonymous namespace
+
+
+void trace_start() {
+	std::lock_guard<std::mutex> lock{threads_mutex};
+	tracing_startup = false;
+	start_locked();
+}
+
+
+void startup_trace_begin() {
+	std::lock_guard<std::mutex> lock{threads_mutex};
+	tracing_startup = true;
+	start_locked();
+}
+
+
+time_nsec_t startup_trace_end() {
+	std::lock_guard<std::mutex> lock{threads_mutex};
+	if (not tracing_startup) {
+		return 0;
+	}
+
+	tracing_startup = false;
+	tracing_active = false;
+	return timing::get_monotonic_time() - trace_begin;
+}
+
+
+void trace_stop() {
+	std::lock_guard<std::mutex> lock{threads_mutex};
+	tracing_startup = false;
+	tracing_active = false;
+}
+
+
+void trace_frame() {
+	time_nsec_t now = timing::get_monotonic_time();
+	uint32_t frame = current_frame++;
+
+	time_nsec_t previous;
+	{
+		std::lock_guard<std::mutex> lock{threads_mutex};
+		previous = frame_begin;
+		frame_begin = now;
+	}
+
+	if (not tracing_active or previous == 0) {
+		return;
+	}
+
+	thread_trace *trace = own_trace();
+	if (trace != nullptr) {
+		trace->record({&frame_zone, previous, now, frame, trace->depth});
+	}
+}
+
+
+void set_trace_thread_name(const std::string &name) {
+	thread_trace *trace = own_trace();
+	if (trace != nullptr) {
+		std::lock_guard<std::mutex> lock{trace->mutex};
+		trace->name = name;
+	}
+}
+
+
+void trace_record(const trace_zone &zone, const std::string &timeline,
+                  time_nsec_t start, time_nsec_t duration) {
+	if (not tracing_active) {
+		return;
+	}
+
+	std::shared_ptr<thread_trace> trace;
+	{
+		std::lock_guard<std::mutex> lock{threads_mutex};
+		for (auto &candidate : threads()) {
+			if (candidate->thread_id >= timeline_ids and candidate->name == timeline) {
+				trace = candidate;
+				break;
+			}
+		}
+
+		if (not trace) {
+			trace = std::make_shared<thread_trace>(timeline_ids + timeline_count++);
+			trace->name = timeline;
+			threads().push_back(trace);
+		}
+	}
+
+	trace->record({
+		&zone, start, start + duration,
+		current_frame.load(std::memory_order_relaxed), 0
+	});
+}
+
+
+std::vector<trace_zone_total> trace_totals() {
+	std::vector<trace_zone_total> totals;
+
+	std::lock_guard<std::mutex> lock{threads_mutex};
+	for (auto &trace : threads()) {
+		std::lock_guard<std::mutex> trace_lock{trace->mutex};
+
+		for (auto &event : trace->events) {
+			// zones of the same name are defined in each translation unit
+			auto total = std::find_if(std::begin(totals), std::end(totals), [&](const trace_zone_total &zone) {
+				return std::strcmp(zone.name, event.zone->name) == 0;
+			});
+			if (total == std::end(totals)) {
+				totals.push_back({event.zone->name, 0, 0, 0});
+				total = std::end(totals) - 1;
+			}
+
+			time_nsec_t duration = event.end - event.start;
+			total->count++;
+			total->total += duration;
+			total->longest = std::max(total->longest, duration);
+		}
+	}
+
+	std::sort(std::begin(totals), std::end(totals), [](const trace_zone_total &a, const trace_zone_total &b) {
+		return a.total > b.total;
+	});
+	return totals;
+}
+
+
+void write_trace(std::ostream &out) {
+	std::lock_guard<std::mutex> lock{threads_mutex};
+
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	const char *separator = "\n";
+
+	for (auto &trace : threads()) {
+		std::lock_guard<std::mutex> trace_lock{trace->mutex};
+
+		if (not trace->name.empty()) {
+			out << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+			    << "\"tid\": " << trace->thread_id << ", \"args\": {\"name\": ";
+			write_json_string(out, trace->name.c_str());
+			out << "}}";
+			separator = ",\n";
+		}
+
+		// oldest first
+		size_t count = trace->events.size();
+		size_t first = trace->written - count;
+		for (size_t i = 0; i < count; i++) {
+			const trace_event &event = trace->events[(first + i) % events_per_thread];
+
+			out << separator << "{\"name\": ";
+			write_json_string(out, event.zone->name);
+			out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << trace->thread_id
+			    << ", \"ts\": " << microseconds(event.start > trace_begin ? event.start - trace_begin : 0)
+			    << ", \"dur\": " << microseconds(event.end - event.start)
+			    << ", \"args\": {\"frame\": " << event.frame
+			    << ", \"depth\": " << event.depth << "}}";
+			separator = ",\n";
+		}
+	}
+
+	out << "\n]}\n";
+}
+
+
+void write_trace(const std::string &filename) {
+	std::ofstream file{filename};
+	if (not file) {
+		throw Error(MSG(err) << "Could not open trace file " << filename);
+	}
+
+	write_trace(file);
+
+	file.close();
+	if (not file) {
+		throw Error(MSG(err) << "Could not write trace file " << filename);
+	}
+}
+
+
+}} // openage::util
@@ -0,0 +1,159 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compiler.h"
+#include "timing.h"
+
+namespace openage {
+namespace util {
+
+
+/**
+ * A named code region, as it appears in a trace.
+ *
+ * Defined as a static object by TRACE_SCOPE, the events refer to
+ * it by its address, so recording them needs no string handling.
+ */
+struct trace_zone {
+	const char *name;
+};
+
+
+/**
+ * Whether events are recorded, see trace_start().
+ */
+extern std::atomic<bool> tracing_active;
+
+
+/**
+ * Records the time from its construction to its destruction as an
+ * event of the zone, in the calling thread's timeline.
+ * Scopes nest, and can be used in any thread.
+ *
+ * Costs a relaxed atomic load while no trace is recorded.
+ */
+class TraceScope {
+public:
+	explicit TraceScope(const trace_zone &zone)
+		:
+		zone{&zone},
+		start{0} {
+
+		if (unlikely(tracing_active.load(std::memory_order_relaxed))) {
+			this->begin();
+		}
+	}
+
+	~TraceScope() {
+		if (unlikely(this->start != 0)) {
+			this->end();
+		}
+	}
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator =(const TraceScope &) = delete;
+
+private:
+	void begin();
+	void end();
+
+	const trace_zone *zone;
+	time_nsec_t start;
+};
+
+
+/**
+ * Start recording events.
+ * Drops the events of the previous trace.
+ */
+void trace_start();
+
+/**
+ * Stop recording events, the recorded ones can be written now.
+ */
+void trace_stop();
+
+/**
+ * Marks the begin of a new frame: the previous one is recorded as a
+ * "frame" event of the calling thread, the events are tagged with
+ * the frame number.
+ */
+void trace_frame();
+
+/**
+ * Names the calling thread in the trace.
+ */
+void set_trace_thread_name(const std::string &name);
+
+/**
+ * Records an event that was measured elsewhere, e.g. on the gpu, into
+ * a timeline of the given name, which is shown like a thread.
+ * start is a monotonic time like the ones of the other events.
+ * Does nothing while no trace is recorded.
+ */
+void trace_record(const trace_zone &zone, const std::string &timeline,
+                  time_nsec_t start, time_nsec_t duration);
+
+/**
+ * Starts recording the startup of the program, like trace_start().
+ * Called first thing in main, so every startup phase is recorded.
+ */
+void startup_trace_begin();
+
+/**
+ * Stops recording the startup, once the first frame is presented.
+ * Returns the time since startup_trace_begin(), or 0 if the startup
+ * was not recorded, or a trace was started since.
+ */
+time_nsec_t startup_trace_end();
+
+/**
+ * The time spent in one zone, over all threads.
+ */
+struct trace_zone_total {
+	const char *name;
+	size_t count;
+	time_nsec_t total;
+	time_nsec_t longest;
+};
+
+/**
+ * Sums up the recorded events by zone name,
+ * the zones with the most time first.
+ */
+std::vector<trace_zone_total> trace_totals();
+
+/**
+ * Writes the recorded events in the Chrome trace event JSON format,
+ * which chrome://tracing and Perfetto display.
+ *
+ * Each thread keeps its most recent events only.
+ */
+void write_trace(std::ostream &out);
+
+/**
+ * Writes the trace to a file, throws if that fails.
+ */
+void write_trace(const std::string &filename);
+
+
+}} // openage::util
+
+
+#define TRACE_SCOPE_NAME_(PREFIX, LINE) PREFIX ## LINE
+#define TRACE_SCOPE_NAME(PREFIX, LINE) TRACE_SCOPE_NAME_(PREFIX, LINE)
+
+/**
+ * Traces the rest of the enclosing scope as the zone NAME,
+ * which must be a string literal.
+ */
+#define TRACE_SCOPE(NAME) \
+	static const ::openage::util::trace_zone TRACE_SCOPE_NAME(trace_zone_, __LINE__){NAME}; \
+	::openage::util::TraceScope TRACE_SCOPE_NAME(trace_scope_, __LINE__){TRACE_SCOPE_NAME(trace_zone_, __LINE__)}
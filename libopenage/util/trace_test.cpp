@@ -0,0 +1,102 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "trace.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+namespace {
+
+size_t count_of(const std::string &text, const std::string &part) {
+	size_t count = 0;
+	for (size_t pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1)) {
+		count++;
+	}
+	return count;
+}
+
+
+void traced_work() {
+	TRACE_SCOPE("outer");
+	for (int i = 0; i < 2; i++) {
+		TRACE_SCOPE("inner");
+	}
+}
+
+} // anonymous namespace
+
+
+// exported test
+void trace() {
+	// nothing is recorded without a trace
+	traced_work();
+
+	trace_start();
+	set_trace_thread_name("trace \"test\"");
+	trace_frame();
+	traced_work();
+
+	std::thread worker{[] {
+		set_trace_thread_name("trace worker");
+		traced_work();
+	}};
+	worker.join();
+
+	trace_frame();
+	trace_stop();
+	traced_work();
+
+	std::ostringstream out;
+	write_trace(out);
+	std::string json = out.str();
+
+	count_of(json, "\"name\": \"outer\"") == 2 or TESTFAIL;
+	count_of(json, "\"name\": \"inner\"") == 4 or TESTFAIL;
+	count_of(json, "\"name\": \"frame\"") == 1 or TESTFAIL;
+	count_of(json, "\"depth\": 1") == 4 or TESTFAIL;
+	count_of(json, "\"args\": {\"frame\": 1,") == 7 or TESTFAIL;
+
+	json.find("\"args\": {\"name\": \"trace \\\"test\\\"\"}") != std::string::npos or TESTFAIL;
+	json.find("\"args\": {\"name\": \"trace worker\"}") != std::string::npos or TESTFAIL;
+
+	// a new trace drops the old events
+	trace_start();
+	trace_stop();
+	std::ostringstream empty;
+	write_trace(empty);
+	empty.str().find("\"ph\": \"X\"") == std::string::npos or TESTFAIL;
+
+	// the startup is summed up per zone
+	startup_trace_begin();
+	traced_work();
+	traced_work();
+	startup_trace_end() > 0 or TESTFAIL;
+	startup_trace_end() == 0 or TESTFAIL;
+	traced_work();
+
+	std::vector<trace_zone_total> totals = trace_totals();
+	totals.size() == 2 or TESTFAIL;
+	std::string{totals[0].name} == "outer" or TESTFAIL;
+	totals[0].count == 2 or TESTFAIL;
+	totals[0].total >= totals[0].longest or TESTFAIL;
+	totals[0].total >= totals[1].total or TESTFAIL;
+	std::string{totals[1].name} == "inner" or TESTFAIL;
+	totals[1].count == 4 or TESTFAIL;
+
+	// a trace started in between ends it
+	startup_trace_begin();
+	trace_start();
+	startup_trace_end() == 0 or TESTFAIL;
+	trace_stop();
+}
+
+
+}}} // openage::util::tests
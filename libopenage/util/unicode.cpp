@@ -1,9 +1,14 @@
-// Copyright 2013-2015 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #include "unicode.h"
 
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPENAGE_UTF8_SSE2 1
+#endif
+
 namespace openage {
 namespace util {
 
@@ -69,6 +74,68 @@ bool utf8_decoder::feed(char c) {
 	return result;
 }
 
+size_t utf8_ascii_prefix(const unsigned char *s, size_t len) {
+	size_t pos = 0;
+
+#if OPENAGE_UTF8_SSE2
+	for (; pos + 16 <= len; pos += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + pos));
+
+		// one bit for each byte with the high bit set
+		int mask = _mm_movemask_epi8(chunk);
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	constexpr uint64_t high = 0x8080808080808080ull;
+	for (; pos + sizeof(uint64_t) <= len; pos += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, s + pos, sizeof(word));
+		if ((word & high) != 0) {
+			break;
+		}
+	}
+
+	for (; pos < len; pos++) {
+		if (s[pos] >= 0x80) {
+			break;
+		}
+	}
+	return pos;
+}
+
+namespace {
+
+/**
+ * widens count ASCII characters to codepoints.
+ */
+void widen_ascii(const unsigned char *s, size_t count, int32_t *outbuf) {
+	size_t pos = 0;
+
+#if OPENAGE_UTF8_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; pos + 16 <= count; pos += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + pos));
+		__m128i low = _mm_unpacklo_epi8(chunk, zero);
+		__m128i high = _mm_unpackhi_epi8(chunk, zero);
+
+		__m128i *out = reinterpret_cast<__m128i *>(outbuf + pos);
+		_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+	}
+#endif
+
+	for (; pos < count; pos++) {
+		outbuf[pos] = s[pos];
+	}
+}
+
+} // anonymous namespace
+
 size_t utf8_decode(const unsigned char *s, size_t len, int32_t *outbuf) {
 	size_t advance;
 	wchar_t w;
@@ -76,9 +143,15 @@ size_t utf8_decode(const unsigned char *s, size_t len, int32_t *outbuf) {
 
 	while(len > 0) {
 		if (s[0] < 0x80) {
-			// 1-byte (ASCII) character
-			w = *s;
-			advance = 1;
+			// run of 1-byte (ASCII) characters, copied at once
+			advance = utf8_ascii_prefix(s, len);
+			widen_ascii(s, advance, outbuf);
+
+			len -= advance;
+			s += advance;
+			outbuf += advance;
+			result += advance;
+			continue;
 		} else if (len >= 2 && s[0] >= 0xc2 && s[0] <= 0xdf && (s[1] & 0xc0) == 0x80) {
 			// 2-byte character
 			w = ((s[0] & 0x1f) << 6) | (s[1] & 0x3f);
@@ -117,6 +190,14 @@ size_t utf8_decode(const unsigned char *s, size_t len, int32_t *outbuf) {
 	return result;
 }
 
+std::vector<codepoint_t> utf8_decode(const std::string &text) {
+	// at most one codepoint per byte
+	std::vector<codepoint_t> result(text.size());
+	size_t count = utf8_decode(reinterpret_cast<const unsigned char *>(text.data()), text.size(), result.data());
+	result.resize(count);
+	return result;
+}
+
 size_t utf8_encode(int cp, char *outbuf) {
 	if (cp < 0) {
 		// illegal codepoint (negative)
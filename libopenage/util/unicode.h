@@ -1,10 +1,11 @@
-// Copyright 2013-2016 the openage authors. See copying.md for legal info.
+// Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 
 namespace openage {
 namespace util {
@@ -76,6 +77,20 @@ public:
  */
 size_t utf8_decode(const unsigned char *s, size_t len, codepoint_t *outbuf);
 
+/**
+ * decodes a whole UTF-8 string, see utf8_decode.
+ */
+std::vector<codepoint_t> utf8_decode(const std::string &text);
+
+/**
+ * returns the number of leading ASCII characters (< 0x80) of s.
+ *
+ * checks 16 bytes at a time with SSE2, or 8 bytes with
+ * word operations, so runs of ASCII are found at memory speed.
+ * utf8_decode copies these runs without decoding each character.
+ */
+size_t utf8_ascii_prefix(const unsigned char *s, size_t len);
+
 /**
  * encodes one Unicode codepoint to a null-terminated UTF-8 character string.
  * due to the nature of UTF-8, the result string is at most 4 bytes long.
@@ -0,0 +1,47 @@
+// Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+#include "unicode.h"
+
+#include <string>
+#include <vector>
+
+#include "../testing/testing.h"
+
+namespace openage {
+namespace util {
+namespace tests {
+
+
+// exported test
+void unicode() {
+	// runs of ASCII longer than one SSE2 block, around multibyte characters
+	std::string ascii(37, 'a');
+	std::string text = ascii + "\xc3\xa4" + ascii + "\xe2\x82\xac" "b" "\xf0\x9f\x98\x80";
+
+	utf8_ascii_prefix(reinterpret_cast<const unsigned char *>(text.data()), text.size()) == 37 or TESTFAIL;
+	utf8_ascii_prefix(reinterpret_cast<const unsigned char *>(ascii.data()), ascii.size()) == 37 or TESTFAIL;
+	utf8_ascii_prefix(nullptr, 0) == 0 or TESTFAIL;
+
+	std::vector<codepoint_t> expected;
+	expected.insert(expected.end(), 37, 'a');
+	expected.push_back(0xe4);
+	expected.insert(expected.end(), 37, 'a');
+	expected.push_back(0x20ac);
+	expected.push_back('b');
+	expected.push_back(0x1f600);
+
+	utf8_decode(text) == expected or TESTFAIL;
+
+	// invalid sequences decode to the replacement character
+	std::vector<codepoint_t> invalid = utf8_decode("x\xff" "y\xc3");
+	invalid.size() == 4 or TESTFAIL;
+	invalid[0] == 'x' or TESTFAIL;
+	invalid[1] == 0xfffd or TESTFAIL;
+	invalid[2] == 'y' or TESTFAIL;
+	invalid[3] == 0xfffd or TESTFAIL;
+
+	utf8_decode(std::string{}).empty() or TESTFAIL;
+}
+
+
+}}} // openage::util::tests
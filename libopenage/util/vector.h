@@ -1,4 +1,4 @@
-// Copyright 2015-2016 the openage authors. See copying.md for legal info.
+// Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 #pragma once
 
@@ -7,6 +7,8 @@
 #include <array>
 #include <type_traits>
 
+#include "matrix_kernels.h"
+
 namespace openage {
 namespace util {
 
@@ -78,8 +80,14 @@ public:
 	 * Scalar multiplication with assignment
 	 */
 	Vector<N> &operator *=(float a) {
-		for (size_t i = 0; i < N; i++) {
-			(*this)[i] *= a;
+		// the kernel call is not worth it for shorter vectors
+		if (N < 4) {
+			for (size_t i = 0; i < N; i++) {
+				(*this)[i] *= a;
+			}
+		}
+		else {
+			scale_floats(this->data(), N, a);
 		}
 		return *this;
 	}
@@ -134,7 +142,7 @@ public:
 	 * Scales the Vector so that its norm is 1
 	 */
 	Vector<N> &normalize() {
-		*this /= this->norm();
+		*this *= 1 / this->norm();
 		return *this;
 	}
 
@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Behold: The central entry point for all of openage.
@@ -60,6 +60,16 @@ def main(argv=None):
         parents=[global_cli, datadir_cli])
     init_subparser(game_cli)
 
+    from .game.benchmark import init_subparser
+    init_subparser(subparsers.add_parser(
+        "benchmark",
+        parents=[global_cli, datadir_cli]))
+
+    from .game.headless import init_subparser
+    init_subparser(subparsers.add_parser(
+        "simulate",
+        parents=[global_cli, datadir_cli]))
+
     from .testing.main import init_subparser
     init_subparser(subparsers.add_parser(
         "test",
@@ -80,6 +90,11 @@ def main(argv=None):
         "codegen",
         parents=[global_cli]))
 
+    from .log.binlog import init_subparser
+    init_subparser(subparsers.add_parser(
+        "decode-log",
+        parents=[global_cli]))
+
     args = cli.parse_args(argv)
 
     if not args.subcommand:
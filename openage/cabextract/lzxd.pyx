@@ -1,14 +1,17 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 from libc.string cimport memcpy
 from libcpp cimport bool
+from libcpp.vector cimport vector
 
 from cpython.ref cimport PyObject
 from cpython.bytes cimport PyBytes_FromStringAndSize
 
 from libopenage.util.compress.lzxd cimport (
     LZXDecompressor as c_LZXDecompressor,
-    LZX_FRAME_SIZE
+    LZX_FRAME_SIZE,
+    lzx_decompress_buffer as c_lzx_decompress_buffer,
+    lzx_decompress_stats
 )
 
 from libopenage.pyinterface.functional cimport Func2
@@ -137,3 +140,57 @@ cdef class LZXDecompressor:
         # the last frame will have some non-zero size.
         # EOF is indicated by a zero return value (so we'll return b"").
         return result[:frame_size]
+
+
+def decompress_buffer(bytes data, size_t output_size,
+                      unsigned int window_bits=21,
+                      unsigned int reset_interval=0,
+                      reset_offsets=None,
+                      unsigned int threads=0):
+    """
+    Decompresses a whole LZX stream that is held in memory.
+
+    If the stream resets, and reset_offsets lists the position of each
+    reset interval in data, the intervals are decoded in parallel.
+
+    @param output_size
+        The size of the decompressed data.
+    @param threads
+        The number of decoding threads; 0 uses all cores.
+
+    @returns
+        the decompressed data, and a dict with the throughput counters
+        (input_bytes, output_bytes, segments, threads, seconds).
+    """
+    cdef vector[size_t] offsets
+    if reset_offsets is not None:
+        for offset in reset_offsets:
+            offsets.push_back(offset)
+
+    cdef bytes result = PyBytes_FromStringAndSize(NULL, output_size)
+    cdef unsigned char *result_buf = result
+    cdef const unsigned char *input_buf = data
+    cdef size_t input_size = len(data)
+    cdef const size_t *offsets_ptr = offsets.data() if offsets.size() else NULL
+    cdef size_t offsets_count = offsets.size()
+    cdef lzx_decompress_stats stats
+    cdef size_t written
+
+    with nogil:
+        written = c_lzx_decompress_buffer(
+            input_buf, input_size,
+            result_buf, output_size,
+            window_bits, reset_interval,
+            offsets_ptr, offsets_count,
+            threads, &stats)
+
+    if written != output_size:
+        result = result[:written]
+
+    return result, {
+        "input_bytes": stats.input_bytes,
+        "output_bytes": stats.output_bytes,
+        "segments": stats.segments,
+        "threads": stats.threads,
+        "seconds": stats.seconds,
+    }
@@ -1,9 +1,11 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 """
 Downloads the SFT test cab archive and uses it to test the cabextract code.
 """
 
+import argparse
 import os
+import time
 from tempfile import gettempdir
 from hashlib import md5
 from urllib.request import urlopen
@@ -132,3 +134,41 @@ def test():
 
         assert_value(md5(path.open('rb').read()).hexdigest(), md5sum)
         assert_value(path.filesize, size)
+
+
+def benchmark(args):
+    """
+    Decompresses all files of a CAB archive and reports the LZX throughput.
+    Uses the test archive if no archive is given, e.g. a game CD's data.cab.
+    """
+    cli = argparse.ArgumentParser()
+    cli.add_argument("archive", nargs="?", help="CAB archive to decompress")
+    cli.add_argument("--repeat", type=int, default=3,
+                     help="number of decompression runs")
+    args = cli.parse_args(args)
+
+    if args.archive:
+        archive = open(args.archive, 'rb')
+    else:
+        archive = open_test_archive()
+
+    cab = CABFile(archive).root
+
+    def files(path):
+        """ all files below path """
+        for entry in path.iterdir():
+            if entry.is_dir():
+                yield from files(entry)
+            else:
+                yield entry
+
+    for run in range(args.repeat):
+        size = 0
+        start = time.perf_counter()
+        for path in files(cab):
+            with path.open('rb') as fileobj:
+                size += len(fileobj.read())
+        seconds = time.perf_counter() - start
+
+        print("run %d: %d bytes in %.3f s: %.1f MB/s" % (
+            run, size, seconds, size / seconds / 1e6))
@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Generates code for C++ testing, mostly the table to look up symbols from test
@@ -14,6 +14,10 @@ class Namespace:
 
     gen_prototypes() generates the code for the namespace.
     """
+
+    # the prototype of the functions, formatted with their name
+    prototype = "void %s();\n"
+
     def __init__(self):
         self.namespaces = collections.defaultdict(self.__class__)
         self.functions = []
@@ -39,7 +43,7 @@ class Namespace:
         including all sub-namespaces and function prototypes.
         """
         for name in self.functions:
-            yield "void %s();\n" % name
+            yield self.prototype % name
 
         for namespacename, namespace in sorted(self.namespaces.items()):
             yield "namespace %s {\n" % namespacename
@@ -60,30 +64,50 @@ class Namespace:
                 yield namespacename + "::" + name
 
 
+class BenchmarkNamespace(Namespace):
+    """
+    A namespace whose functions are benchmarks, which take
+    the openage::testing::Benchmark that runs their cases.
+    """
+
+    prototype = "void %s(::openage::testing::Benchmark &);\n"
+
+
 def generate_testlist(projectdir):
     """
-    Generates the test/demo method symbol lookup file from tests_cpp.
+    Generates the test/demo/benchmark method symbol lookup file
+    from tests_cpp, demos_cpp and benchmarks_cpp.
 
     projectdir is a util.fslike.path.Path.
     """
     root_namespace = Namespace()
+    benchmark_namespace = BenchmarkNamespace()
 
     from ..testing.list_processor import tests_and_demos_cpp
-    for testname, _, _ in tests_and_demos_cpp():
-        root_namespace.add_functionname(testname.split('::'))
+    for testname, type_, _ in tests_and_demos_cpp():
+        if type_ == 'benchmark':
+            benchmark_namespace.add_functionname(testname.split('::'))
+        else:
+            root_namespace.add_functionname(testname.split('::'))
 
-    func_prototypes = list(root_namespace.gen_prototypes())
+    func_prototypes = (list(root_namespace.gen_prototypes()) +
+                       list(benchmark_namespace.gen_prototypes()))
 
     method_mappings = [
         "{\"%s\", ::%s}" % (functionname, functionname)
         for functionname in root_namespace.get_functionnames()]
 
+    benchmark_mappings = [
+        "{\"%s\", ::%s}" % (functionname, functionname)
+        for functionname in benchmark_namespace.get_functionnames()]
+
     tmpl_path = projectdir.joinpath("libopenage/testing/testlist.cpp.template")
     with tmpl_path.open() as tmpl:
         content = tmpl.read()
 
     content = content.replace('FUNCTION_PROTOTYPES', "".join(func_prototypes))
     content = content.replace('METHOD_MAPPINGS', ",\n\t".join(method_mappings))
+    content = content.replace('BENCHMARK_MAPPINGS', ",\n\t".join(benchmark_mappings))
 
     gen_path = projectdir.joinpath("libopenage/testing/testlist.gen.cpp")
     with gen_path.open("w") as gen:
@@ -0,0 +1,127 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Asset pack: the converted files packed into one indexed file, which the
+engine maps into memory instead of opening and checking each file.
+
+Read by libopenage/util/asset_pack.h. All values are little endian:
+
+    header: "OGAP", uint32 version, uint32 file_count, uint32 alignment
+    file_count entries, sorted by path:
+        uint64 offset, uint64 size, uint32 path_offset, uint32 path_length
+    the paths, relative to the converted asset directory
+    the file contents, each one starting at a multiple of the alignment
+"""
+
+import struct
+
+from ..log import info
+
+
+ASSET_PACK_FILENAME = "assets.pack"
+
+ASSET_PACK_MAGIC = b"OGAP"
+ASSET_PACK_VERSION = 1
+
+# texture levels and pcm data are used in place by the engine
+ASSET_PACK_ALIGNMENT = 64
+
+HEADER = struct.Struct("<4sIII")
+ENTRY = struct.Struct("<QQII")
+
+# size of the blocks copied into the pack
+COPY_BLOCK_SIZE = 1024 * 1024
+
+
+def aligned(offset):
+    """
+    the next offset where the contents of a file may start.
+    """
+    return -(-offset // ASSET_PACK_ALIGNMENT) * ASSET_PACK_ALIGNMENT
+
+
+def packed_files(directory):
+    """
+    yields all files below the directory that belong into the pack.
+    """
+    for entry in directory.iterdir():
+        if entry.is_dir():
+            yield from packed_files(entry)
+
+        elif entry.is_file():
+            if entry.name.endswith(".tmp") or entry.name == ASSET_PACK_FILENAME:
+                continue
+
+            yield entry
+
+
+def write_asset_pack(targetdir):
+    """
+    pack all files of the converted asset directory.
+
+    the loose files are kept, the next conversion checks them
+    against the manifest to skip the unchanged sources.
+    """
+    files = sorted(
+        (b"/".join(path.parts[len(targetdir.parts):]), path)
+        for path in packed_files(targetdir)
+    )
+
+    paths_offset = HEADER.size + len(files) * ENTRY.size
+    offset = aligned(paths_offset + sum(len(name) for name, _ in files))
+
+    entries = list()
+    path_offset = paths_offset
+    for name, path in files:
+        size = path.filesize
+        entries.append((offset, size, path_offset, len(name)))
+
+        offset = aligned(offset + size)
+        path_offset += len(name)
+
+    # write a new file first, an interrupted write keeps the old one
+    tmpname = ASSET_PACK_FILENAME + ".tmp"
+    with targetdir[tmpname].open('wb') as outfile:
+        outfile.write(HEADER.pack(
+            ASSET_PACK_MAGIC,
+            ASSET_PACK_VERSION,
+            len(files),
+            ASSET_PACK_ALIGNMENT,
+        ))
+
+        for entry in entries:
+            outfile.write(ENTRY.pack(*entry))
+
+        for name, _ in files:
+            outfile.write(name)
+
+        position = path_offset
+        for (name, path), (offset, size, _, _) in zip(files, entries):
+            outfile.write(bytes(offset - position))
+
+            with path.open('rb') as infile:
+                written = 0
+                while True:
+                    block = infile.read(COPY_BLOCK_SIZE)
+                    if not block:
+                        break
+                    outfile.write(block)
+                    written += len(block)
+
+            if written != size:
+                raise Exception("%s changed while it was packed" % name.decode())
+
+            position = offset + size
+
+    targetdir[tmpname].rename(targetdir[ASSET_PACK_FILENAME])
+
+    info("packed %d converted files into %s" % (len(files), ASSET_PACK_FILENAME))
+
+
+def remove_asset_pack(targetdir):
+    """
+    remove the pack of a previous conversion,
+    the engine would read its outdated files instead of the new ones.
+    """
+    if targetdir[ASSET_PACK_FILENAME].is_file():
+        targetdir[ASSET_PACK_FILENAME].unlink()
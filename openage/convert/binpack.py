@@ -1,6 +1,13 @@
-# Copyright 2016-2016 the openage authors. See copying.md for legal info.
+# Copyright 2016-2017 the openage authors. See copying.md for legal info.
 
-""" Routines for 2D binpacking """
+"""
+Routines for 2D binpacking.
+
+The converter packs its textures with libopenage's SpriteSheet
+(libopenage/convert/sprite_sheet.h), which creates the same layouts
+as the BestPacker of these packers in merge_frames.
+Changes here must be made there too.
+"""
 
 # TODO pylint: disable=C,R
 
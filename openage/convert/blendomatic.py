@@ -1,4 +1,4 @@
-# Copyright 2013-2015 the openage authors. See copying.md for legal info.
+# Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 # TODO pylint: disable=C,R
 
@@ -243,11 +243,11 @@ class Blendomatic(Exportable):
     def structs(cls):
         return [StructDefinition(cls)]
 
-    def save(self, fslikeobj, path, save_format):
+    def save(self, fslikeobj, path, save_format, container=False):
         for idx, texture in enumerate(self.get_textures()):
             name = "mode%02d" % idx
             dbg("saving blending mode %02d texture -> %s" % (idx, name))
-            texture.save(fslikeobj, path + '/' + name, save_format)
+            texture.save(fslikeobj, path + '/' + name, save_format, container)
 
         info("blending masks successfully exported")
 
@@ -0,0 +1,94 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Binary data files: the data sets packed into one file with the layout
+of the generated C++ structs, so the engine copies the struct members
+instead of parsing csv text.
+
+Read by libopenage/util/binary_data.h. All values are little endian:
+
+    header: "OGDB", uint32 version, uint32 file_count, uint32 pool_offset
+    file_count entries: uint32 name_offset, uint32 name_length,
+                        uint32 row_count, uint32 row_size,
+                        uint32 member_count, uint32 rows_offset
+    rows of all data sets
+    string pool, referenced by (uint32 offset, uint32 length)
+"""
+
+import struct
+
+BINARY_DATA_MAGIC = b"OGDB"
+BINARY_DATA_VERSION = 1
+
+HEADER = struct.Struct("<4sIII")
+ENTRY = struct.Struct("<IIIIII")
+
+
+class StringPool:
+    """
+    collects the strings of a binary data file, each one stored once.
+    """
+
+    def __init__(self):
+        self.data = bytearray()
+        self.offsets = dict()
+
+    def add(self, text):
+        """
+        returns the offset and length of the encoded text in the pool.
+        """
+        encoded = text.encode('utf-8')
+
+        offset = self.offsets.get(encoded)
+        if offset is None:
+            offset = len(self.data)
+            self.offsets[encoded] = offset
+            self.data.extend(encoded)
+
+        return offset, len(encoded)
+
+    def encode(self, text):
+        """
+        returns the reference to the text for a binary data row.
+        """
+        return struct.pack("<II", *self.add(text))
+
+
+def write_binary_data(outfile, data_sets):
+    """
+    write the given DataDefinitions as one binary data file.
+    """
+
+    strings = StringPool()
+    entries = list()
+    tables = list()
+
+    rows_offset = HEADER.size + len(data_sets) * ENTRY.size
+
+    for data_set in data_sets:
+        row_count, row_size, rows = data_set.generate_binary(strings)
+        name_offset, name_length = strings.add(data_set.name_data_file)
+
+        entries.append(ENTRY.pack(
+            name_offset, name_length,
+            row_count, row_size,
+            len(data_set.members),
+            rows_offset,
+        ))
+        tables.append(rows)
+        rows_offset += len(rows)
+
+    outfile.write(HEADER.pack(
+        BINARY_DATA_MAGIC,
+        BINARY_DATA_VERSION,
+        len(data_sets),
+        rows_offset,
+    ))
+
+    for entry in entries:
+        outfile.write(entry)
+
+    for rows in tables:
+        outfile.write(rows)
+
+    outfile.write(strings.data)
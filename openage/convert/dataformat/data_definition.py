@@ -52,44 +52,11 @@ class DataDefinition(StructDefinition):
             "# ", genfile.DELIMITER.join(self.members.keys()), "\n",
         ])
 
-        from .multisubtype_base import MultisubtypeBaseFile
-
         # create csv data lines:
         for idx, data_line in enumerate(self.data):
             row_entries = list()
             for member_name, member_type in self.members.items():
-                entry = data_line[member_name]
-
-                make_relpath = False
-
-                # check if enum data value is valid
-                if isinstance(member_type, EnumMember):
-                    if not member_type.validate_value(entry):
-                        raise Exception("data entry %d '%s'"
-                                        " not a valid %s value" %
-                                        (idx, entry, repr(member_type)))
-
-                # insert filename to read this field
-                if isinstance(member_type, MultisubtypeMember):
-                    # subdata member stores the follow-up filename
-                    entry += GeneratedFile.output_preferences["csv"]["file_suffix"]
-                    make_relpath = True
-
-                if self.target == MultisubtypeBaseFile:
-                    # if the struct definition target is the multisubtype
-                    # base file, it already created the filename entry.
-                    # it needs to be made relative as well.
-                    if member_name == MultisubtypeBaseFile.data_format[1][1]:
-                        # only make the filename entry relative
-                        make_relpath = True
-
-                if make_relpath:
-                    # filename to reference to, make it relative to the
-                    # current file name
-                    entry = os.path.relpath(
-                        entry,
-                        os.path.dirname(self.name_data_file)
-                    )
+                entry = self.get_export_entry(idx, data_line, member_name, member_type)
 
                 # encode each data field, to escape newlines and commas
                 row_entries.append(encode_value(entry))
@@ -113,6 +80,64 @@ class DataDefinition(StructDefinition):
             reprtxt="csv for %s" % self.name_struct,
         )]
 
+    def generate_binary(self, strings):
+        """
+        create the rows of a binary data file from the data,
+        with the member layout of the generated structs.
+
+        returns the row count, the row size and the packed rows.
+        """
+
+        rows = list()
+        for idx, data_line in enumerate(self.data):
+            for member_name, member_type in self.members.items():
+                entry = self.get_export_entry(idx, data_line, member_name, member_type)
+                rows.append(member_type.encode_binary(entry, strings))
+
+        return len(self.data), self.get_binary_row_size(), b"".join(rows)
+
+    def get_export_entry(self, idx, data_line, member_name, member_type):
+        """
+        return the value of a member to be stored in the data file.
+        """
+
+        from .multisubtype_base import MultisubtypeBaseFile
+
+        entry = data_line[member_name]
+
+        make_relpath = False
+
+        # check if enum data value is valid
+        if isinstance(member_type, EnumMember):
+            if not member_type.validate_value(entry):
+                raise Exception("data entry %d '%s'"
+                                " not a valid %s value" %
+                                (idx, entry, repr(member_type)))
+
+        # insert filename to read this field
+        if isinstance(member_type, MultisubtypeMember):
+            # subdata member stores the follow-up filename
+            entry += GeneratedFile.output_preferences["csv"]["file_suffix"]
+            make_relpath = True
+
+        if self.target == MultisubtypeBaseFile:
+            # if the struct definition target is the multisubtype
+            # base file, it already created the filename entry.
+            # it needs to be made relative as well.
+            if member_name == MultisubtypeBaseFile.data_format[1][1]:
+                # only make the filename entry relative
+                make_relpath = True
+
+        if make_relpath:
+            # filename to reference to, make it relative to the
+            # current file name
+            entry = os.path.relpath(
+                entry,
+                os.path.dirname(self.name_data_file)
+            )
+
+        return entry
+
     def __str__(self):
         ret = [
             "\n\tdata file name: ", str(self.name_data_file),
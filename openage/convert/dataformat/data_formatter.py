@@ -2,8 +2,11 @@
 
 # TODO pylint: disable=C,R
 
+from collections import OrderedDict
+
 from . import entry_parser
 from . import util
+from .binary_data import write_binary_data
 from .generated_file import GeneratedFile
 from .members import RefMember
 
@@ -54,17 +57,34 @@ $parsers
                 ),
             }
         ),
+        "fill_binary": entry_parser.ParserMemberFunction(
+            func_name = "fill_binary",
+            templates = {
+                0: entry_parser.ParserTemplate(
+                    signature    = "int %sfill(const openage::util::BinaryRow & /*row*/)",
+                    headers      = util.determine_header("binary_data"),
+                    impl_headers = set(),
+                    template     = "$signature {\n\treturn -1;\n}"
+                ),
+                None: entry_parser.ParserTemplate(
+                    signature    = "int %sfill(const openage::util::BinaryRow &row)",
+                    headers      = util.determine_header("binary_data"),
+                    impl_headers = set(),
+                    template     = "$signature {\n$parsers\n\n\treturn -1;\n}\n"
+                ),
+            }
+        ),
         "recurse": entry_parser.ParserMemberFunction(
             func_name = "recurse",
             templates = {
                 0: entry_parser.ParserTemplate(
-                    signature    = "int %srecurse(openage::util::Dir /*basedir*/, openage::util::csv_file_map_t */*file_map*/)",
+                    signature    = "int %srecurse(openage::util::Dir /*basedir*/, openage::util::data_file_map */*file_map*/)",
                     headers      = util.determine_header("engine_dir"),
                     impl_headers = set(),
                     template     = "$signature {\n\treturn -1;\n}\n"
                 ),
                 None: entry_parser.ParserTemplate(
-                    signature = "int %srecurse(openage::util::Dir basedir, openage::util::csv_file_map_t *file_map)",
+                    signature = "int %srecurse(openage::util::Dir basedir, openage::util::data_file_map *file_map)",
                     headers   = util.determine_header("engine_dir"),
                     impl_headers = set(),
                     template  = "$signature {\n$parsers\n\n\treturn -1;\n}\n"
@@ -133,6 +153,10 @@ $parsers
         generate_files = list()
 
         for format_ in requested_formats:
+            if format_ == "binary":
+                self.export_binary(projectdir)
+                continue
+
             files = dict()
 
             snippets = list()
@@ -189,3 +213,29 @@ $parsers
             file_name, content = gen_file.generate()
             with projectdir[file_name].open('wb') as outfile:
                 outfile.write(content.encode('utf-8'))
+
+    def export_binary(self, projectdir):
+        """
+        Writes the data sets packed into a single csv file
+        as a binary data file next to it, with the .bin suffix.
+
+        The engine prefers it over the csv file, which it still reads
+        if the binary file is missing.
+        """
+
+        packs = OrderedDict()
+        for data_set in self.data:
+            if not data_set.single_output:
+                continue
+
+            data_set.dynamic_ref_update(self.typedefs)
+
+            file_name = data_set.single_output
+            if data_set.prefix:
+                file_name = data_set.prefix + file_name
+
+            packs.setdefault(file_name, []).append(data_set)
+
+        for file_name, data_sets in packs.items():
+            with projectdir[file_name + ".bin"].open('wb') as outfile:
+                write_binary_data(outfile, data_sets)
@@ -2,6 +2,7 @@
 
 # TODO pylint: disable=C,R,abstract-method
 
+import struct
 import types
 from enum import Enum
 
@@ -9,7 +10,7 @@ from .content_snippet import ContentSnippet, SectionType
 from .entry_parser import EntryParser
 from .generated_file import GeneratedFile
 from .struct_snippet import StructSnippet
-from .util import determine_headers, determine_header
+from .util import determine_headers, determine_header, struct_type_lookup
 
 
 class DataMember:
@@ -29,6 +30,27 @@ class DataMember:
     def get_parsers(self, idx, member):
         raise NotImplementedError("implement the parser generation for the member type %s" % type(self))
 
+    def get_binary_parsers(self, offset, member):
+        """
+        return the parsers that fill the struct member from a binary data
+        row, where the member is stored at the given byte offset.
+        the offset is the C++ expression of the offset.
+        """
+        raise NotImplementedError("implement the binary parser generation for the member type %s" % type(self))
+
+    def get_binary_size(self):
+        """
+        bytes this member occupies in a binary data row.
+        """
+        raise NotImplementedError("return the binary size of the member type %s" % type(self))
+
+    def encode_binary(self, value, strings):
+        """
+        encode the value for a binary data row,
+        strings are stored in the given binary_data.StringPool.
+        """
+        raise NotImplementedError("implement the binary encoding for the member type %s" % type(self))
+
     def get_headers(self, output_target):
         raise NotImplementedError("return needed headers for %s for a given output target" % type(self))
 
@@ -290,6 +312,23 @@ class NumberMember(DataMember):
             )
         ]
 
+    def get_binary_parsers(self, offset, member):
+        return [
+            EntryParser(
+                ["row.get(%s, this->%s);" % (offset, member)],
+                headers     = set(),
+                typerefs    = set(),
+                destination = "fill_binary",
+            )
+        ]
+
+    def get_binary_size(self):
+        return struct.calcsize("<" + struct_type_lookup[self.number_type])
+
+    def encode_binary(self, value, strings):
+        del strings  # unused
+        return struct.pack("<" + struct_type_lookup[self.number_type], value)
+
     def get_headers(self, output_target):
         if "struct" == output_target:
             return determine_header(self.number_type)
@@ -373,6 +412,13 @@ class ContinueReadMember(NumberMember):
             )
         ]
 
+    def encode_binary(self, value, strings):
+        # stored as the number the csv parser creates
+        return super().encode_binary(
+            1 if str(value) == self.Result.CONTINUE.value else 0,
+            strings
+        )
+
 
 class EnumMember(RefMember):
     """
@@ -411,6 +457,36 @@ class EnumMember(RefMember):
             )
         ]
 
+    def get_binary_parsers(self, offset, member):
+        # the enum class values are numbered in the order of self.values
+        enum_parser = (
+            "// read enum %s" % (self.type_name),
+            "{",
+            "	uint32_t value;",
+            "	row.get(%s, value);" % (offset),
+            "	if (value >= %d) {" % (len(self.values)),
+            "		throw openage::error::Error(MSG(err) << \"unknown enum value \" << value << \" encountered for %s\");" % (self.type_name),
+            "	}",
+            "	this->%s = static_cast<%s>(value);" % (member, self.type_name),
+            "}",
+        )
+
+        return [
+            EntryParser(
+                enum_parser,
+                headers     = determine_headers(("uint32_t", "engine_error")),
+                typerefs    = set(),
+                destination = "fill_binary",
+            )
+        ]
+
+    def get_binary_size(self):
+        return struct.calcsize("<I")
+
+    def encode_binary(self, value, strings):
+        del strings  # unused
+        return struct.pack("<I", self.values.index(value))
+
     def get_headers(self, output_target):
         return set()
 
@@ -500,6 +576,9 @@ class EnumLookupMember(EnumMember):
 class CharArrayMember(DynLengthMember):
     """
     struct member/column type that allows to store equal-length char[n].
+
+    the names stored in the gamedata files are interned,
+    as they're only used to identify and compare records.
     """
 
     def __init__(self, length):
@@ -510,7 +589,12 @@ class CharArrayMember(DynLengthMember):
         headers = set()
 
         if self.is_dynamic_length():
-            lines = ["this->%s = buf[%d];" % (member, idx)]
+            lines = [
+                "this->%s = openage::util::StringId::intern(buf[%d], strlen(buf[%d]));" % (
+                    member, idx, idx
+                )
+            ]
+            headers |= determine_header("strlen")
         else:
             data_length = self.get_length()
             lines = [
@@ -529,18 +613,39 @@ class CharArrayMember(DynLengthMember):
             )
         ]
 
+    def get_binary_parsers(self, offset, member):
+        if self.is_dynamic_length():
+            lines = ["row.get_string_id(%s, this->%s);" % (offset, member)]
+        else:
+            lines = ["row.get_chars(%s, this->%s, %d);" % (offset, member, self.get_length())]
+
+        return [
+            EntryParser(
+                lines,
+                headers     = set(),
+                typerefs    = set(),
+                destination = "fill_binary",
+            )
+        ]
+
+    def get_binary_size(self):
+        return struct.calcsize("<II")
+
+    def encode_binary(self, value, strings):
+        return strings.encode(str(value))
+
     def get_headers(self, output_target):
         ret = set()
 
         if "struct" == output_target:
             if self.is_dynamic_length():
-                ret |= determine_header("std::string")
+                ret |= determine_header("string_id")
 
         return ret
 
     def get_effective_type(self):
         if self.is_dynamic_length():
-            return "std::string"
+            return "openage::util::StringId"
         else:
             return "char"
 
@@ -554,11 +659,42 @@ class CharArrayMember(DynLengthMember):
 class StringMember(CharArrayMember):
     """
     member with unspecified string length, aka std::string
+
+    used for text and file names, which are not interned.
     """
 
     def __init__(self):
         super().__init__(DynLengthMember.any_length)
 
+    def get_parsers(self, idx, member):
+        return [
+            EntryParser(
+                ["this->%s = buf[%d];" % (member, idx)],
+                headers     = set(),
+                typerefs    = set(),
+                destination = "fill",
+            )
+        ]
+
+    def get_binary_parsers(self, offset, member):
+        return [
+            EntryParser(
+                ["row.get_string(%s, this->%s);" % (offset, member)],
+                headers     = set(),
+                typerefs    = set(),
+                destination = "fill_binary",
+            )
+        ]
+
+    def get_headers(self, output_target):
+        if "struct" == output_target:
+            return determine_header("std::string")
+
+        return set()
+
+    def get_effective_type(self):
+        return "std::string"
+
 
 class MultisubtypeMember(RefMember, DynLengthMember):
     """
@@ -617,6 +753,23 @@ class MultisubtypeMember(RefMember, DynLengthMember):
 
         ]
 
+    def get_binary_parsers(self, offset, member):
+        return [
+            EntryParser(
+                ["row.get_string(%s, this->%s.index_file.filename);" % (offset, member)],
+                headers     = set(),
+                typerefs    = set(),
+                destination = "fill_binary",
+            ),
+        ]
+
+    def get_binary_size(self):
+        return struct.calcsize("<II")
+
+    def encode_binary(self, value, strings):
+        # the follow-up file name
+        return strings.encode(str(value))
+
     def get_typerefs(self):
         return {self.type_name}
 
@@ -641,7 +794,7 @@ class MultisubtypeMember(RefMember, DynLengthMember):
                 )
                 snippet.typerefs |= {entry_type}
 
-            snippet.includes |= determine_header("subdata")
+            snippet.includes |= determine_headers(("subdata", "binary_data"))
             snippet.typerefs |= {MultisubtypeBaseFile.name_struct}
             snippet.add_member("struct openage::util::subdata<%s> index_file;\n" % (MultisubtypeBaseFile.name_struct))
 
@@ -661,11 +814,14 @@ class MultisubtypeMember(RefMember, DynLengthMember):
                 "int %s::fill(char * /*line*/) {\n" % (self.type_name),
                 "\treturn -1;\n",
                 "}\n",
+                "int %s::fill(const openage::util::BinaryRow & /*row*/) {\n" % (self.type_name),
+                "\treturn -1;\n",
+                "}\n",
             ))
 
             # function to recursively read the referenced files
             txt.extend((
-                "int %s::recurse(openage::util::Dir basedir, openage::util::csv_file_map_t *file_map) {\n" % (self.type_name),
+                "int %s::recurse(openage::util::Dir basedir, openage::util::data_file_map *file_map) {\n" % (self.type_name),
                 "\tthis->index_file.read(basedir, file_map); //read ref-file entries\n",
                 "\tint subtype_count = this->index_file.data.size();\n"
                 "\tif (subtype_count != %s) {\n" % len(self.class_lookup),
@@ -769,6 +925,16 @@ class SubdataMember(MultisubtypeMember):
             ),
         ]
 
+    def get_binary_parsers(self, offset, member):
+        return [
+            EntryParser(
+                ["row.get_string(%s, this->%s.filename);" % (offset, member)],
+                headers     = set(),
+                typerefs    = set(),
+                destination = "fill_binary",
+            ),
+        ]
+
     def get_snippets(self, file_name, format_):
         del file_name, format_  # unused
         return list()
@@ -139,6 +139,16 @@ class StructDefinition:
         snippet.add_member("static constexpr size_t member_count = %d;" % len(self.members))
         snippet.includes |= determine_header("size_t")
 
+        # bytes of one struct in a binary data file
+        snippet.add_member("static constexpr size_t binary_row_size = %d;" % self.get_binary_row_size())
+
+        # where the members are stored in a binary data row,
+        # e.g. for reading one member of all rows with util::BinaryColumn
+        snippet.add_member("struct binary_offsets {")
+        for member_name, offset in self.get_binary_offsets():
+            snippet.add_member("\tstatic constexpr size_t %s = %d;" % (member_name, offset))
+        snippet.add_member("};")
+
         # add filling function prototypes
         for _, member in sorted(genfile.member_methods.items()):
             snippet.add_member("%s;" % member.get_signature())
@@ -156,8 +166,15 @@ class StructDefinition:
         ret = list()
 
         # constexpr member count definition
+        definitions = [
+            "constexpr size_t %s::member_count;" % self.name_struct,
+            "constexpr size_t %s::binary_row_size;" % self.name_struct,
+        ]
+        for member_name, _ in self.get_binary_offsets():
+            definitions.append("constexpr size_t %s::binary_offsets::%s;" % (self.name_struct, member_name))
+
         ret.append(ContentSnippet(
-            data="constexpr size_t %s::member_count;" % self.name_struct,
+            data="\n".join(definitions),
             file_name=self.name_struct_file,
             section=SectionType.section_body,
             orderby=self.name_struct,
@@ -179,6 +196,12 @@ class StructDefinition:
             for parser in member_type.get_parsers(idx, member_name):
                 parsers[parser.destination].append(parser)
 
+        # the members are packed in a binary data row in the same order
+        for member_name, member_type in self.members.items():
+            offset = "binary_offsets::%s" % member_name
+            for parser in member_type.get_binary_parsers(offset, member_name):
+                parsers[parser.destination].append(parser)
+
         # create parser snippets and return them
         for parser_type, parser_list in parsers.items():
             ret.append(
@@ -192,6 +215,24 @@ class StructDefinition:
 
         return ret
 
+    def get_binary_offsets(self):
+        """
+        the members with their byte offset in a binary data row,
+        they are packed in the order of the members.
+        """
+        offsets = list()
+        offset = 0
+        for member_name, member_type in self.members.items():
+            offsets.append((member_name, offset))
+            offset += member_type.get_binary_size()
+        return offsets
+
+    def get_binary_row_size(self):
+        """
+        bytes of one struct instance in a binary data file.
+        """
+        return sum(member_type.get_binary_size() for member_type in self.members.values())
+
     def __str__(self):
         ret = [
             repr(self),
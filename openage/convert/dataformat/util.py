@@ -19,6 +19,7 @@ struct_type_lookup = {
     "uint16_t":           "H",
     "int":                "i",
     "unsigned int":       "I",
+    "uint":               "I",
     "int32_t":            "i",
     "uint32_t":           "I",
     "long":               "l",
@@ -82,6 +83,8 @@ def determine_header(for_type):
     util_strings_h        = HeaderSnippet("../util/strings.h", is_global=False)
     util_file_h           = HeaderSnippet("../util/file.h", is_global=False)
     util_dir_h            = HeaderSnippet("../util/dir.h", is_global=False)
+    util_binary_data_h    = HeaderSnippet("../util/binary_data.h", is_global=False)
+    util_string_id_h      = HeaderSnippet("../util/string_id.h", is_global=False)
     error_error_h         = HeaderSnippet("../error/error.h", is_global=False)
     log_h                 = HeaderSnippet("../log.h", is_global=False)
 
@@ -99,6 +102,7 @@ def determine_header(for_type):
         "std::vector":     {vectorh},
         "strcmp":          {cstringh},
         "strncpy":         {cstringh},
+        "strlen":          {cstringh},
         "strtok_custom":   {util_strings_h},
         "sscanf":          {cstdioh},
         "size_t":          {cstddefh},
@@ -107,6 +111,8 @@ def determine_header(for_type):
         "read_csv_file":   {util_file_h},
         "subdata":         {util_file_h},
         "engine_dir":      {util_dir_h, util_file_h},
+        "binary_data":     {util_binary_data_h},
+        "string_id":       {util_string_id_h},
         "engine_error":    {error_error_h},
         "engine_log":      {log_h},
     }
@@ -7,10 +7,12 @@ actual conversion process.
 
 import os
 import re
-from subprocess import Popen, PIPE
+from io import BytesIO
 from tempfile import gettempdir
 
 from ..log import info, dbg
+from ..util.fslike.wrapper import WriteRecorder
+from .asset_pack import write_asset_pack, remove_asset_pack
 from .game_versions import GameVersion
 from .blendomatic import Blendomatic
 from .changelog import (ASSET_VERSION, ASSET_VERSION_FILENAME,
@@ -20,6 +22,7 @@ from .dataformat.data_formatter import DataFormatter
 from .gamedata.empiresdat import load_gamespec, EmpiresDat
 from .hardcoded.termcolors import URXVTCOLS
 from .hardcoded.terrain_tile_size import TILE_HALFSIZE
+from .manifest import AssetManifest, content_hash
 from .slp_converter_pool import SLPConverterPool
 from .interface.interfacecutter import InterfaceCutter
 from .interface.interfacerename import interface_rename
@@ -110,7 +113,7 @@ def get_string_resources(args):
 
 
 def get_blendomatic_data(srcdir):
-    """ reads blendomatic.dat """
+    """ reads blendomatic.dat, returns it and its content hash """
     # in HD edition, blendomatic.dat has been renamed to
     # blendomatic_x1.dat; their new blendomatic.dat has a new, unsupported
     # format.
@@ -120,7 +123,9 @@ def get_blendomatic_data(srcdir):
         blendomatic_dat = srcdir["data/blendomatic.dat"].open('rb')
 
     with blendomatic_dat:
-        return Blendomatic(blendomatic_dat)
+        data = blendomatic_dat.read()
+
+    return Blendomatic(BytesIO(data)), content_hash(data)
 
 
 def get_gamespec(srcdir, game_versions, dont_pickle):
@@ -151,6 +156,11 @@ def convert(args):
         strings (filenames) that indicate the currently-converted object
         ints that predict the amount of objects remaining
     """
+    # sources that didn't change since the last conversion are skipped
+    args.manifest = AssetManifest(
+        "texture_containers=%d" % args.flag("texture_containers"))
+    args.manifest.load(args.targetdir)
+
     # data conversion
     yield from convert_metadata(args)
     with args.targetdir[GAMESPEC_VERSION_FILENAME].open('w') as fil:
@@ -163,8 +173,17 @@ def convert(args):
         with args.targetdir[ASSET_VERSION_FILENAME].open('w') as fil:
             fil.write(str(ASSET_VERSION))
 
+    args.manifest.save(args.targetdir)
+
+    # one file for the engine to map instead of thousands to open
+    if args.flag('asset_pack'):
+        write_asset_pack(args.targetdir)
+    else:
+        remove_asset_pack(args.targetdir)
+
     # clean args (set by convert_metadata for convert_media)
     del args.palette
+    del args.manifest
 
     info("asset conversion complete; asset version: " + str(ASSET_VERSION))
 
@@ -201,10 +220,18 @@ def convert_metadata(args):
     data_formatter.add_data(data_dump[0], prefix="gamedata/", single_output="gamedata")
 
     yield "blendomatic.dat"
-    blend_data = get_blendomatic_data(args.srcdir)
-    blend_data.save(args.targetdir, "blendomatic", ("csv",))
+    blend_data, blend_hash = get_blendomatic_data(args.srcdir)
+    if not args.manifest.is_current("blendomatic.dat", blend_hash, args.targetdir):
+        recorder = WriteRecorder(args.targetdir)
+        blend_data.save(recorder.root, "blendomatic", ("csv",),
+                        args.flag("texture_containers"))
+        args.manifest.record("blendomatic.dat", blend_hash, recorder.written,
+                             args.targetdir)
     data_formatter.add_data(blend_data.dump("blending_modes"))
 
+    yield "color palette"
+    data_formatter.add_data(palette.dump("palette"))
+
     yield "player color palette"
     player_palette = PlayerColorTable(palette)
     data_formatter.add_data(player_palette.dump("player_palette"))
@@ -218,7 +245,7 @@ def convert_metadata(args):
     data_formatter.add_data(stringres.dump("string_resources"))
 
     yield "writing gamespec csv files"
-    data_formatter.export(args.targetdir, ("csv",))
+    data_formatter.export(args.targetdir, ("csv", "binary"))
 
     if args.flag('gen_extra_files'):
         dbg("generating extra files for visualization")
@@ -315,7 +342,7 @@ def convert_mediafile(filepath, names_map, args):
 
     May write multiple output files (e.g. in the case of textures: csv, png).
 
-    Args shall contain srcdir, targetdir, and slp_converter.
+    Args shall contain srcdir, targetdir, manifest and slp_converter.
     """
     # progress message
     filename = b'/'.join(filepath.parts).decode()
@@ -324,6 +351,15 @@ def convert_mediafile(filepath, names_map, args):
     with filepath.open_r() as infile:
         indata = infile.read()
 
+    digest = content_hash(indata)
+    if args.manifest.is_current(filename, digest, args.targetdir):
+        dbg("%s is unchanged, skipping it" % filename)
+        return
+
+    # the written files are stored in the manifest
+    recorder = WriteRecorder(args.targetdir)
+    targetdir = recorder.root
+
     if filename.endswith('.slp'):
         # some user interface textures must be cut using hardcoded values
         if filename.startswith('interface/'):
@@ -341,23 +377,24 @@ def convert_mediafile(filepath, names_map, args):
                 entry["cy"] = TILE_HALFSIZE["y"]
 
         # save atlas to targetdir
-        texture.save(args.targetdir,
+        texture.save(targetdir,
                      interface_rename(slp_rename(filename, names_map)),
-                     ("csv",))
+                     ("csv",),
+                     args.flag("texture_containers"))
 
     elif filename.endswith('.wav'):
-        # convert the WAV file to an opus file
-        # TODO use libav or something to avoid this utility dependency
-        invocation = ('opusenc', '--quiet', '-', '-')
-        opusenc = Popen(invocation, stdin=PIPE, stdout=PIPE)
-        outdata = opusenc.communicate(input=indata)[0]
-        if opusenc.returncode != 0:
-            raise Exception("opusenc failed")
-
-        with args.targetdir[filename].with_suffix('.opus').open_w() as outfile:
+        # convert the WAV file to an opus file.
+        # libopus runs without the GIL, so the threads of
+        # concurrent_chain encode several sounds at once.
+        from .opus import encode
+        outdata = encode(indata)
+
+        with targetdir[filename].with_suffix('.opus').open_w() as outfile:
             outfile.write(outdata)
 
     else:
         # simply copy the file over.
-        with args.targetdir[filename].open_w() as outfile:
+        with targetdir[filename].open_w() as outfile:
             outfile.write(indata)
+
+    args.manifest.record(filename, digest, recorder.written, args.targetdir)
@@ -1,17 +1,23 @@
-# Copyright 2013-2015 the openage authors. See copying.md for legal info.
+# Copyright 2013-2017 the openage authors. See copying.md for legal info.
 
 """
 Code for reading Genie .DRS archives.
 
 Note that .DRS archives can't store file names; they just store the file
 extension, and a file number.
+
+Archives on the disk are read by libopenage (see drsarchive.pyx), which
+maps them into memory; other archives are read from their file object.
 """
 
+from io import BufferedReader
+
 from ..log import spam, dbg
 from ..util.strings import decode_until_null
 from ..util.struct import NamedStruct
 from ..util.fslike.filecollection import FileCollection
-from ..util.filelike import StreamFragment
+from ..util.filelike import BufferReader, StreamFragment
+from .drsarchive import DRSArchive
 
 # version of the drs files, hardcoded for now
 FILE_VERSION = 57
@@ -67,6 +73,18 @@ class DRSFileInfo(NamedStruct):
     file_size        = "i"
 
 
+def native_path(fileobj):
+    """
+    the path of a file that was opened from the file system,
+    None for other file objects.
+    """
+    if isinstance(fileobj, BufferedReader) and \
+       isinstance(fileobj.name, (str, bytes)):
+        return fileobj.name
+
+    return None
+
+
 class DRS(FileCollection):
     """
     represents a file archive in DRS format.
@@ -77,6 +95,14 @@ class DRS(FileCollection):
         # queried from the outside
         self.fileobj = fileobj
 
+        # the libopenage reader of a mapped archive
+        self.archive = None
+
+        path = native_path(fileobj)
+        if path is not None:
+            self.read_mapped(path)
+            return
+
         # read header
         header = DRSHeader.read(fileobj)
         header.copyright = decode_until_null(header.copyright).strip()
@@ -109,6 +135,30 @@ class DRS(FileCollection):
                 (open_r, None, lambda size=size: size, None)
             )
 
+    def read_mapped(self, path):
+        """
+        Adds the members of the archive at path, read by libopenage.
+        Their file objects read from the mapped archive, without
+        sharing the seek position of self.fileobj.
+        """
+        self.archive = DRSArchive(path)
+
+        dbg("DRS archive %s: %s, version %s, type %s" % (
+            path, self.archive.copyright,
+            self.archive.version, self.archive.ftype))
+
+        for index, filename, offset, size in self.archive.members():
+            def open_r(index=index):
+                """ Returns a opened ('rb') file-like object for the member. """
+                return BufferReader(self.archive.member(index))
+
+            spam("%s: offset %d, size %d" % (filename, offset, size))
+
+            self.add_fileentry(
+                [filename.encode()],
+                (open_r, None, lambda size=size: size, None)
+            )
+
     def read_tables(self):
         """
         Reads the tables from self.tables, and yields tuples of
@@ -0,0 +1,90 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Access to DRS archives through libopenage's reader,
+which maps the archive and hands out its members without copying them.
+"""
+
+import os
+
+from cpython.buffer cimport PyBuffer_FillInfo
+from libc.stdint cimport uint8_t
+from libcpp.string cimport string
+
+from libopenage.convert.drs cimport (
+    DRSFile as c_DRSFile,
+    drs_member
+)
+
+
+cdef class DRSArchive:
+    """
+    A DRS archive file, mapped into memory.
+    """
+
+    cdef c_DRSFile *thisptr
+
+    def __cinit__(self, path):
+        cdef string filename = os.fsencode(path)
+
+        with nogil:
+            self.thisptr = new c_DRSFile(filename)
+
+    def __dealloc__(self):
+        del self.thisptr
+
+    @property
+    def copyright(self):
+        return self.thisptr.get_copyright().decode('latin-1').strip()
+
+    @property
+    def version(self):
+        return self.thisptr.get_version().decode('latin-1')
+
+    @property
+    def ftype(self):
+        return self.thisptr.get_type().decode('latin-1')
+
+    def members(self):
+        """
+        yields index, name, offset, size for all members.
+        """
+        cdef drs_member member
+        cdef size_t index
+
+        for index in range(self.thisptr.get_member_count()):
+            member = self.thisptr.get_member(index)
+            yield index, member.name.decode(), member.offset, member.size
+
+    def member(self, size_t index):
+        """
+        the data of a member, as a read-only buffer into the mapping.
+        """
+        return DRSMember(self, index)
+
+
+cdef class DRSMember:
+    """
+    Read-only buffer of a member's bytes, use it with memoryview().
+    Keeps the archive mapped while it is alive.
+    """
+
+    cdef DRSArchive archive
+    cdef const uint8_t *data
+    cdef size_t size
+
+    def __cinit__(self, DRSArchive archive, size_t index):
+        cdef drs_member member = archive.thisptr.get_member(index)
+
+        self.archive = archive
+        self.data = archive.thisptr.get_data(member)
+        self.size = member.size
+
+    def __len__(self):
+        return self.size
+
+    def __getbuffer__(self, Py_buffer *buffer, int flags):
+        PyBuffer_FillInfo(buffer, self, <void *> self.data, self.size, 1, flags)
+
+    def __releasebuffer__(self, Py_buffer *buffer):
+        pass
@@ -447,6 +447,16 @@ def init_subparser(cli):
         "--no-interface", action='store_true',
         help="do not convert interface graphics")
 
+    cli.add_argument(
+        "--texture-containers", action='store_true',
+        help=("additionally store textures as .otex containers, "
+              "which the engine loads without decoding the png"))
+
+    cli.add_argument(
+        "--asset-pack", action='store_true',
+        help=("additionally pack the converted files into one file, "
+              "which the engine maps instead of opening each file"))
+
     cli.add_argument(
         "--no-pickle-cache", action='store_true',
         help="don't use a pickle file to skip the dat file reading.")
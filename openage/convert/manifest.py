@@ -0,0 +1,164 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Manifest of the converted assets.
+
+Stores the content hash of each converted source file and the files that
+were produced from it, so a reconversion can skip unchanged sources.
+The engine's AssetManager reads it to look up the converted files
+instead of checking each one on the disk.
+
+The file consists of tab-separated lines:
+
+    openage-asset-manifest  <format version>
+    asset_version           <ASSET_VERSION>
+    options                 <conversion options>
+    source                  <sha1 of the source>  <source name>
+    output                  <size in bytes>       <output path>
+
+Output lines belong to the source line above them,
+the output paths are relative to the converted asset directory.
+"""
+
+from hashlib import sha1
+from threading import Lock
+
+from ..log import dbg, info, warn
+from .changelog import ASSET_VERSION
+
+
+# filename of the manifest in the converted asset directory
+MANIFEST_FILENAME = "asset_manifest"
+
+# increase when the line format changes. the engine checks it too.
+MANIFEST_FORMAT_VERSION = 1
+
+
+def content_hash(data):
+    """
+    the hash the manifest stores for a source file's content.
+    """
+    return sha1(data).hexdigest()
+
+
+class AssetManifest:
+    """
+    Source hashes and their outputs, of the previous and of the
+    running conversion. May be used from several threads.
+    """
+
+    def __init__(self, options=""):
+        # conversion options change the outputs of all sources
+        self.options = options
+
+        # source name -> (hash, [(output path, size), ...])
+        self.previous = {}
+        self.current = {}
+
+        self.lock = Lock()
+
+    def load(self, targetdir):
+        """
+        read the manifest of the previous conversion.
+        it is ignored if the asset version or the options differ.
+        """
+        try:
+            with targetdir[MANIFEST_FILENAME].open('r') as manifest:
+                lines = manifest.read().splitlines()
+        except FileNotFoundError:
+            return
+
+        header = dict()
+        sources = dict()
+        source = None
+
+        for lineno, line in enumerate(lines):
+            fields = line.split('\t')
+            if fields[0] in ("source", "output") and len(fields) == 3:
+                if fields[0] == "source":
+                    source = sources[fields[2]] = (fields[1], [])
+                elif source is not None:
+                    source[1].append((fields[2], int(fields[1])))
+            elif len(fields) == 2:
+                header[fields[0]] = fields[1]
+            else:
+                warn("ignoring malformed asset manifest line %d" % (lineno + 1))
+                return
+
+        if header.get("openage-asset-manifest") != str(MANIFEST_FORMAT_VERSION):
+            warn("ignoring asset manifest of unknown format")
+            return
+
+        if header.get("asset_version") != str(ASSET_VERSION):
+            info("asset version changed, reconverting all sources")
+            return
+
+        if header.get("options") != self.options:
+            info("conversion options changed, reconverting all sources")
+            return
+
+        self.previous = sources
+        dbg("asset manifest lists %d converted sources" % len(sources))
+
+    def is_current(self, name, digest, targetdir):
+        """
+        whether the source was converted from the same content, and all of
+        its outputs still exist. if so, they are kept for the new manifest.
+        """
+        with self.lock:
+            entry = self.previous.get(name)
+
+            # the outputs of a changed source are rewritten
+            if entry is not None and entry[0] != digest:
+                del self.previous[name]
+                entry = None
+
+        if entry is None:
+            return False
+
+        for path, size in entry[1]:
+            target = targetdir[path]
+            if not target.is_file() or target.filesize != size:
+                return False
+
+        with self.lock:
+            self.current[name] = entry
+
+        return True
+
+    def record(self, name, digest, outputs, targetdir):
+        """
+        store the outputs that were just produced from a source.
+        """
+        entry = (digest, [(path, targetdir[path].filesize) for path in outputs])
+
+        with self.lock:
+            self.current[name] = entry
+
+    def save(self, targetdir):
+        """
+        write the manifest of this conversion.
+        sources that were not looked at in this conversion,
+        e.g. as their component was disabled, keep their previous entry.
+        """
+        lines = [
+            "openage-asset-manifest\t%d" % MANIFEST_FORMAT_VERSION,
+            "asset_version\t%d" % ASSET_VERSION,
+            "options\t%s" % self.options,
+        ]
+
+        with self.lock:
+            entries = dict(self.previous)
+            entries.update(self.current)
+
+            for name, (digest, outputs) in sorted(entries.items()):
+                lines.append("source\t%s\t%s" % (digest, name))
+                for path, size in outputs:
+                    lines.append("output\t%d\t%s" % (size, path))
+
+        # write a new file first, an interrupted write keeps the old one
+        tmpname = MANIFEST_FILENAME + ".tmp"
+        with targetdir[tmpname].open('w') as manifest:
+            manifest.write("\n".join(lines) + "\n")
+
+        targetdir[tmpname].rename(targetdir[MANIFEST_FILENAME])
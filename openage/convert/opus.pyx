@@ -0,0 +1,28 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Encodes the WAV sounds of the original game to opus files with libopenage.
+"""
+
+from libc.stdint cimport uint8_t
+from libcpp.string cimport string
+
+from libopenage.convert.opus_encode cimport encode_opus
+
+
+def encode(bytes data, int bitrate=0):
+    """
+    Encodes the WAV file data to an Ogg Opus file, resampled to 48 kHz.
+
+    The GIL is released while encoding, so converter threads
+    encode several sounds at once.
+    bitrate 0 lets libopus choose the bitrate.
+    """
+    cdef const uint8_t *wav = <const uint8_t *> data
+    cdef size_t size = len(data)
+    cdef string result
+
+    with nogil:
+        result = encode_opus(wav, size, bitrate)
+
+    return result
@@ -0,0 +1,71 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Packs texture frames into a sprite sheet with libopenage.
+"""
+
+import numpy
+cimport numpy
+
+from libc.stdint cimport uint8_t, int32_t
+from libc.string cimport memcpy
+
+from libopenage.convert.sprite_sheet cimport (
+    SpriteSheet as c_SpriteSheet,
+    sprite_sheet_entry
+)
+
+
+def pack_frames(frames, int32_t margin, double aspect_ratio,
+                int32_t max_dimension, unsigned threads=0):
+    """
+    Lays out the TextureImages like the packers in binpack.py would, and
+    draws them, in parallel by up to the given number of threads
+    (0: all cores).
+
+    returns the (height, width, 4) sheet, and the subtexture metadata
+    of x, y, w, h, cx, cy for each frame.
+    """
+    cdef c_SpriteSheet *sheet = new c_SpriteSheet(margin, aspect_ratio,
+                                                  max_dimension)
+
+    cdef numpy.ndarray[numpy.uint8_t, ndim=3] frame_data
+    cdef numpy.ndarray[numpy.uint8_t, ndim=3] result
+    cdef sprite_sheet_entry entry
+    cdef size_t index
+
+    # the sheet reads the frames when it draws them
+    frame_arrays = []
+
+    try:
+        for frame in frames:
+            frame_data = numpy.ascontiguousarray(frame.data, dtype=numpy.uint8)
+            frame_arrays.append(frame_data)
+
+            sheet.add_frame(<const uint8_t *> frame_data.data,
+                            frame.width, frame.height,
+                            frame.hotspot[0], frame.hotspot[1])
+
+        with nogil:
+            sheet.pack(threads)
+
+        result = numpy.empty((sheet.get_height(), sheet.get_width(), 4),
+                             dtype=numpy.uint8)
+        memcpy(result.data, sheet.get_data(), result.nbytes)
+
+        metadata = []
+        for index in range(sheet.get_entry_count()):
+            entry = sheet.get_entry(index)
+            metadata.append({
+                "x": entry.x,
+                "y": entry.y,
+                "w": entry.w,
+                "h": entry.h,
+                "cx": entry.cx,
+                "cy": entry.cy,
+            })
+
+    finally:
+        del sheet
+
+    return result, metadata
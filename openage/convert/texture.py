@@ -1,11 +1,10 @@
-# Copyright 2014-2016 the openage authors. See copying.md for legal info.
+# Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 """ Routines for texture generation etc """
 
 # TODO pylint: disable=C,R
 
 
-from .binpack import RowPacker, ColumnPacker, BinaryTreePacker, BestPacker
 from .blendomatic import BlendingMode
 from .dataformat import (exportable, data_definition,
                          struct_definition, data_formatter)
@@ -16,6 +15,13 @@ from ..log import spam
 from ..util.fslike.path import Path
 
 
+# texture container layout, must match libopenage/texture_container.h
+TEXTURE_CONTAINER_MAGIC = b"OTEX"
+TEXTURE_CONTAINER_VERSION = 1
+TEXTURE_CONTAINER_RGBA8 = 0
+TEXTURE_CONTAINER_ALIGNMENT = 16
+
+
 def subtexture_meta(tx, ty, hx, hy, cx, cy):
     """
     generate a dict that contains the meta information for
@@ -125,10 +131,8 @@ class Texture(exportable.Exportable):
         """
         convert slp to subtexture or subtextures, use a palette.
         """
-        # TODO this needs some _serious_ performance work
-        # (at least a 10x improvement, 50x would be better).
-        # ideas: remove PIL and use libpng via CPPInterface,
-        #        cythonize parts of SLP.py
+        # the frame is decoded by libopenage already.
+        # TODO: remove PIL and use libpng via CPPInterface
         subtex = TextureImage(frame.get_picture_data(palette, self.player_id), hotspot=frame.info.hotspot)
 
         if custom_cutter:
@@ -136,9 +140,12 @@ class Texture(exportable.Exportable):
         else:
             return [subtex]
 
-    def save(self, targetdir, filename, meta_formats=None):
+    def save(self, targetdir, filename, meta_formats=None, container=False):
         """
         save the texture png and csv to the given path in obj.
+
+        if container is set, the texture is stored as texture container
+        as well, which the engine can upload without decoding the png.
         """
         if not isinstance(targetdir, Path):
             raise ValueError("util.fslike Path expected as targetdir")
@@ -147,6 +154,10 @@ class Texture(exportable.Exportable):
         with targetdir[filename + ".png"].open("wb") as imagefile:
             self.image_data.get_pil_image().save(imagefile, 'png')
 
+        if container:
+            with targetdir[filename + ".otex"].open("wb") as containerfile:
+                save_texture_container(containerfile, self.image_data)
+
         if meta_formats:
             # generate formatted texture metadata
             formatter = data_formatter.DataFormatter()
@@ -167,58 +178,92 @@ def merge_frames(frames):
     """
     merge all given frames of this slp to a single image file.
 
+    the frames are packed and drawn by libopenage, with the layout
+    the packers in binpack.py would create.
+
     frames = [TextureImage, ...]
 
     returns = TextureImage, (width, height), [drawn_frames_meta]
     """
 
-    import numpy
+    from .sprite_sheet import pack_frames
 
     if len(frames) == 0:
         raise Exception("cannot create texture with empty input frame list")
 
-    packer = BestPacker([BinaryTreePacker(margin=MARGIN, aspect_ratio=1),
-                         BinaryTreePacker(margin=MARGIN,
-                                          aspect_ratio=TERRAIN_ASPECT_RATIO),
-                         RowPacker(margin=MARGIN),
-                         ColumnPacker(margin=MARGIN)])
+    atlas_data, drawn_frames_meta = pack_frames(frames, MARGIN,
+                                                TERRAIN_ASPECT_RATIO,
+                                                MAX_TEXTURE_DIMENSION)
 
-    packer.pack(frames)
-
-    width, height = packer.width(), packer.height()
-    assert width <= MAX_TEXTURE_DIMENSION, "Texture width limit exceeded"
-    assert height <= MAX_TEXTURE_DIMENSION, "Texture height limit exceeded"
+    height, width = atlas_data.shape[0], atlas_data.shape[1]
 
     area = sum(block.width * block.height for block in frames)
     used_area = width * height
     efficiency = area / used_area
 
-    spam("merging %d frames to %dx%d atlas, efficiency %.3f." %
+    spam("merged %d frames to %dx%d atlas, efficiency %.3f." %
          (len(frames), width, height, efficiency))
 
-    atlas_data = numpy.zeros((height, width, 4), dtype=numpy.uint8)
-    drawn_frames_meta = []
-
-    for sub_frame in frames:
-        sub_w = sub_frame.width
-        sub_h = sub_frame.height
-
-        pos_x, pos_y = packer.pos(sub_frame)
+    atlas = TextureImage(atlas_data)
 
-        spam("drawing frame %03d on atlas at %d x %d..." % (
-            len(drawn_frames_meta), pos_x, pos_y))
+    return atlas, (width, height), drawn_frames_meta
 
-        # draw the subtexture on atlas_data
-        atlas_data[pos_y:pos_y + sub_h, pos_x:pos_x + sub_w] = sub_frame.data
 
-        # generate subtexture meta information object
-        hotspot_x, hotspot_y = sub_frame.hotspot
-        drawn_frames_meta.append(subtexture_meta(pos_x, pos_y,
-                                                 sub_w, sub_h,
-                                                 hotspot_x, hotspot_y))
+def save_texture_container(outfile, image, levels=1):
+    """
+    write the TextureImage as texture container to the opened file.
 
-    atlas = TextureImage(atlas_data)
+    the pixels are stored as uncompressed rgba8: the team color shader
+    requires the exact colors and alpha markers, which block compression
+    would not preserve.
 
-    spam("successfully merged %d frames to atlas." % len(frames))
+    levels is the number of mip levels to store, each one is
+    half the size of the previous one.
+    """
 
-    return atlas, (width, height), drawn_frames_meta
+    import numpy
+    import struct
+
+    mip_levels = [numpy.ascontiguousarray(image.data, dtype=numpy.uint8)]
+    while len(mip_levels) < levels:
+        prev = mip_levels[-1]
+        height, width = prev.shape[0], prev.shape[1]
+        if width == 1 and height == 1:
+            break
+
+        # average blocks of 2x2 pixels, odd edges are repeated
+        padded = numpy.pad(prev, ((0, height % 2), (0, width % 2), (0, 0)),
+                           mode='edge').astype(numpy.uint16)
+        smaller = (padded[0::2, 0::2] + padded[1::2, 0::2] +
+                   padded[0::2, 1::2] + padded[1::2, 1::2] + 2) // 4
+        mip_levels.append(smaller.astype(numpy.uint8))
+
+    header = struct.pack("<4sIIIII",
+                         TEXTURE_CONTAINER_MAGIC,
+                         TEXTURE_CONTAINER_VERSION,
+                         TEXTURE_CONTAINER_RGBA8,
+                         image.width, image.height,
+                         len(mip_levels))
+
+    def align(pos):
+        """ start position of the next level data """
+        return -(-pos // TEXTURE_CONTAINER_ALIGNMENT) * TEXTURE_CONTAINER_ALIGNMENT
+
+    # level table: width, height, offset, size
+    table = []
+    offset = align(len(header) + len(mip_levels) * struct.calcsize("<IIII"))
+    for level in mip_levels:
+        size = level.nbytes
+        table.append(struct.pack("<IIII", level.shape[1], level.shape[0],
+                                 offset, size))
+        offset = align(offset + size)
+
+    outfile.write(header)
+    outfile.write(b"".join(table))
+
+    pos = len(header) + sum(len(entry) for entry in table)
+    for level in mip_levels:
+        padding = align(pos) - pos
+        outfile.write(b"\0" * padding)
+        outfile.write(level.tobytes())
+        pos += padding + level.nbytes
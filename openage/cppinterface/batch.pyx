@@ -0,0 +1,17 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Provides the GIL acquisition for batched calls from C++;
+see libopenage/pyinterface/batch.h.
+"""
+
+from libopenage.pyinterface.functional cimport Func0
+from libopenage.pyinterface.batch cimport py_with_gil
+
+
+cdef void with_gil_impl(Func0[void] *func) except * with gil:
+    func.call()
+
+
+def setup():
+    py_with_gil.bind0(with_gil_impl)
@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 from libcpp.string cimport string
 from libcpp cimport bool as cppbool
@@ -15,9 +15,11 @@ from libopenage.pyinterface.pyobject cimport (
 
     py_str,
     py_repr,
+    py_bytes,
     py_len,
     py_callable,
     py_call,
+    py_call1,
     py_hasattr,
     py_getattr,
     py_setattr,
@@ -37,6 +39,7 @@ from libopenage.pyinterface.pyobject cimport (
     py_import,
     py_createstr,
     py_createbytes,
+    py_createbytes_string,
     py_createint,
     py_createdict,
     py_getnone
@@ -63,6 +66,10 @@ cdef string repr_impl(void *ptr) except * with gil:
     return repr(<object> <PyObject *> ptr).encode()
 
 
+cdef string bytes_impl(void *ptr) except * with gil:
+    return bytes(<object> <PyObject *> ptr)
+
+
 cdef int len_impl(void *ptr) except * with gil:
     return len(<object> <PyObject *> ptr)
 
@@ -76,6 +83,11 @@ cdef void call_impl(PyObjectRef *result_ref, void *ptr) except * with gil:
     result_ref.set_ref(<void *> <PyObject *> result_obj)
 
 
+cdef void call1_impl(PyObjectRef *result_ref, void *ptr, void *arg) except * with gil:
+    cdef object result_obj = (<object> <PyObject *> ptr)(<object> <PyObject *> arg)
+    result_ref.set_ref(<void *> <PyObject *> result_obj)
+
+
 cdef cppbool hasattr_impl(void *ptr, string name) except * with gil:
     return hasattr(<object> <PyObject *> ptr, name.decode())
 
@@ -160,6 +172,11 @@ cdef void createbytes_impl(PyObjectRef *result_ref, const char *value) except *
     result_ref.set_ref(<void *> <PyObject *> result_obj)
 
 
+cdef void createbytes_string_impl(PyObjectRef *result_ref, string value) except * with gil:
+    cdef object result_obj = <bytes> value
+    result_ref.set_ref(<void *> <PyObject *> result_obj)
+
+
 cdef void createint_impl(PyObjectRef *result_ref, int value) except * with gil:
     cdef object result_obj = value
     result_ref.set_ref(<void *> <PyObject *> result_obj)
@@ -181,9 +198,11 @@ def setup():
 
     py_str.bind0(str_impl)
     py_repr.bind0(repr_impl)
+    py_bytes.bind0(bytes_impl)
     py_len.bind0(len_impl)
     py_callable.bind0(callable_impl)
     py_call.bind0(call_impl)
+    py_call1.bind0(call1_impl)
     py_hasattr.bind0(hasattr_impl)
     py_getattr.bind0(getattr_impl)
     py_setattr.bind0(setattr_impl)
@@ -203,6 +222,7 @@ def setup():
     py_import.bind0(import_impl)
     py_createstr.bind0(createstr_impl)
     py_createbytes.bind0(createbytes_impl)
+    py_createbytes_string.bind0(createbytes_string_impl)
     py_createint.bind0(createint_impl)
     py_createdict.bind0(createdict_impl)
     py_getnone.bind0(getnone_impl)
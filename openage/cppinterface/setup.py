@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Contains the function that initializes the C++ interface.
@@ -38,6 +38,9 @@ def setup():
     from .pyobject import setup as pyobject_setup
     pyobject_setup()
 
+    from .batch import setup as batch_setup
+    batch_setup()
+
     from ..util.fslike.cpp import setup as fslike_setup
     fslike_setup()
 
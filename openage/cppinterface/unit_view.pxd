@@ -0,0 +1,12 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+from libcpp.memory cimport shared_ptr
+
+from libopenage.unit.unit_view cimport unit_columns
+
+
+cdef class UnitArrays:
+    cdef shared_ptr[unit_columns] columns
+
+
+cdef UnitArrays wrap_unit_columns(shared_ptr[unit_columns] columns)
@@ -0,0 +1,120 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Read-only views of the unit state that libopenage publishes after each
+tick, see libopenage/unit/unit_view.h.
+
+The arrays support the buffer protocol, so numpy.asarray() reads them
+without copying, e.g. the positions of all units as (count, 3) array.
+"""
+
+from cpython.buffer cimport PyBUF_FORMAT, PyBUF_WRITABLE
+from libc.stdint cimport int32_t, int64_t, uint32_t, uint64_t
+from libcpp.memory cimport shared_ptr
+
+from libopenage.unit.unit_view cimport unit_columns
+
+
+cdef class UnitColumn:
+    """
+    One attribute of all units, as buffer into the published columns,
+    which stay alive as long as the buffer is used.
+    """
+
+    cdef shared_ptr[unit_columns] owner
+    cdef void *data
+    cdef bytes format
+    cdef int ndim
+    cdef Py_ssize_t itemsize
+    cdef Py_ssize_t shape[2]
+    cdef Py_ssize_t strides[2]
+
+    def __getbuffer__(self, Py_buffer *buffer, int flags):
+        if flags & PyBUF_WRITABLE:
+            raise BufferError("the unit state is read-only")
+
+        buffer.buf = self.data
+        buffer.obj = self
+        buffer.len = self.shape[0] * self.strides[0]
+        buffer.readonly = 1
+        buffer.itemsize = self.itemsize
+        buffer.format = self.format if flags & PyBUF_FORMAT else NULL
+        buffer.ndim = self.ndim
+        buffer.shape = self.shape
+        buffer.strides = self.strides
+        buffer.suboffsets = NULL
+        buffer.internal = NULL
+
+    def __releasebuffer__(self, Py_buffer *buffer):
+        pass
+
+    def __len__(self):
+        return self.shape[0]
+
+
+cdef UnitColumn make_column(shared_ptr[unit_columns] owner, void *data,
+                            bytes format, Py_ssize_t itemsize,
+                            Py_ssize_t width):
+    cdef UnitColumn column = UnitColumn()
+    column.owner = owner
+    column.data = data
+    column.format = format
+    column.itemsize = itemsize
+    column.ndim = 2 if width > 1 else 1
+    column.shape[0] = owner.get().count
+    column.shape[1] = width
+    column.strides[0] = itemsize * width
+    column.strides[1] = itemsize
+    return column
+
+
+cdef class UnitArrays:
+    """
+    The state of the units after one tick, one array per attribute,
+    in the same unit order. Keeping it doesn't block the simulation,
+    the next ticks are published to other arrays.
+    """
+
+    @property
+    def tick(self):
+        """ the number of ticks simulated before """
+        return self.columns.get().tick
+
+    def __len__(self):
+        return self.columns.get().count
+
+    @property
+    def ids(self):
+        """ uint64 unit ids """
+        return make_column(self.columns, self.columns.get().ids.data(),
+                           b"Q", sizeof(uint64_t), 1)
+
+    @property
+    def type_ids(self):
+        """ int32 unit type ids """
+        return make_column(self.columns, self.columns.get().type_ids.data(),
+                           b"i", sizeof(int32_t), 1)
+
+    @property
+    def owners(self):
+        """ uint32 player numbers """
+        return make_column(self.columns, self.columns.get().owners.data(),
+                           b"I", sizeof(uint32_t), 1)
+
+    @property
+    def positions(self):
+        """ int64 ne, se and up in phys units, one row per unit """
+        return make_column(self.columns, self.columns.get().positions.data(),
+                           b"q", sizeof(int64_t), 3)
+
+    @property
+    def hitpoints(self):
+        """ uint32 current hitpoints, 0 for units without """
+        return make_column(self.columns, self.columns.get().hitpoints.data(),
+                           b"I", sizeof(uint32_t), 1)
+
+
+cdef UnitArrays wrap_unit_columns(shared_ptr[unit_columns] columns):
+    cdef UnitArrays result = UnitArrays()
+    result.columns = columns
+    return result
@@ -0,0 +1,248 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Simulates a generated game without window and reports the tick times,
+to compare the simulation performance of changes.
+
+With --pathfinding, searches paths on generated maps instead.
+"""
+
+import argparse
+import json
+
+from ..log import err
+
+
+# total unit counts of the --scale runs
+SCALE_UNITS = (1000, 10000, 50000)
+
+# map sizes and obstacle densities of the --pathfinding runs
+PATHFINDING_SIZES = (2, 4, 8)
+PATHFINDING_DENSITIES = (0.1, 0.3)
+
+# relative growth of a --pathfinding measurement that counts as regression
+REGRESSION_TOLERANCE = 0.1
+
+
+def add_scenario_arguments(cli):
+    """ The arguments describing the benchmark scenario. """
+    cli.add_argument("--players", type=int, default=2,
+                     help="number of players")
+    cli.add_argument("--units", type=int, default=50,
+                     help="units spawned for each player")
+    cli.add_argument("--ticks", type=int, default=600,
+                     help="number of simulated ticks")
+    cli.add_argument("--seed", type=int, default=4321,
+                     help="seed of the map generator")
+    cli.add_argument("--scale", action="store_true",
+                     help=("run with %s units in total instead of --units, "
+                           "to compare the update cost per unit" %
+                           "/".join(str(count) for count in SCALE_UNITS)))
+    cli.add_argument("--output", metavar="FILE",
+                     help="also write the results to this JSON file")
+    cli.add_argument("--pathfinding", action="store_true",
+                     help=("search paths on generated maps of the sizes %s "
+                           "and obstacle densities %s instead, "
+                           "needs no game assets" % (
+                               "/".join(str(size) for size in PATHFINDING_SIZES),
+                               "/".join(str(density) for density
+                                        in PATHFINDING_DENSITIES))))
+    cli.add_argument("--queries", type=int, default=100,
+                     help="path searches on each map of --pathfinding")
+    cli.add_argument("--baseline", metavar="FILE",
+                     help=("compare the --pathfinding results to this "
+                           "--output file of an earlier run, "
+                           "and fail if they got worse"))
+
+
+def init_subparser(cli):
+    """ Initializes the parser for the benchmark args. """
+    cli.set_defaults(entrypoint=main)
+    add_scenario_arguments(cli)
+
+
+def print_result(result):
+    """ Prints the measurements of one benchmark run. """
+    print("%d units, %d ticks: %.1f ticks/s" % (
+        result["units"], result["ticks"], result["ticks_per_second"]))
+    print("tick time: p50 %.3f ms, p99 %.3f ms, max %.3f ms" % (
+        result["tick_p50_ms"], result["tick_p99_ms"], result["tick_max_ms"]))
+    print("update cost: %.3f us per unit" % result["unit_update_us"])
+    print("unit actions: %d allocated, %d heap allocations" % (
+        result["action_allocations"], result["action_heap_allocations"]))
+    print("collision tests: %.1f object pairs per tick" % (
+        result["collision_pair_tests"] / max(result["ticks"], 1)))
+    print("blocked moves: %d, %d detours found of %d searched, %d new paths" % (
+        result["moves_blocked"],
+        result["move_repairs"] - result["move_failed_repairs"],
+        result["move_repairs"], result["move_repaths"]))
+    if result["heap_growth"] is not None:
+        print("heap growth: %d bytes" % result["heap_growth"])
+    print("snapshot: %.3f ms for %d bytes, fork: %.3f ms" % (
+        result["snapshot_ms"], result["snapshot_bytes"], result["fork_ms"]))
+
+
+def print_pathfinding_result(result):
+    """ Prints the measurements of one pathfinding benchmark run. """
+    print("size %d, %d tiles, %.0f%% blocked, %s queries, %s:" % (
+        result["terrain_size"], result["map_tiles"],
+        100 * result["obstacle_density"],
+        "worst case" if result["worst_case"] else "random",
+        "jump point search" if result["jump_points"] else "a*"))
+    print("  %d/%d reached, %d reachable missed" % (
+        result["reached"], result["queries"], result["missed"]))
+    print("  query time: p50 %.3f ms, p99 %.3f ms, max %.3f ms" % (
+        result["query_p50_ms"], result["query_p99_ms"], result["query_max_ms"]))
+    print("  expansions: %.0f mean, %d max, %.0f nodes" % (
+        result["expansions_mean"], result["expansions_max"],
+        result["nodes_mean"]))
+    print("  length to shortest tile path: %.3f mean, %.3f max" % (
+        result["length_ratio_mean"], result["length_ratio_max"]))
+    if result["heap_growth"] is not None:
+        print("  heap growth: %d bytes" % result["heap_growth"])
+
+
+def pathfinding_key(result):
+    """ Identifies the scenario of a pathfinding result. """
+    return (result["terrain_size"], result["density"],
+            result["worst_case"], result["jump_points"])
+
+
+def pathfinding_regressions(results, baseline):
+    """
+    Compares the pathfinding results to the ones of an earlier run.
+    Returns the descriptions of the measurements that got worse.
+    """
+    earlier = {pathfinding_key(result): result for result in baseline}
+    regressions = []
+
+    for result in results:
+        before = earlier.get(pathfinding_key(result))
+        if before is None:
+            continue
+
+        name = "size %d, density %.2f, %s, %s" % (
+            result["terrain_size"], result["density"],
+            "worst case" if result["worst_case"] else "random",
+            "jps" if result["jump_points"] else "a*")
+
+        if result["missed"] > before["missed"]:
+            regressions.append("%s: %d reachable targets missed, were %d" % (
+                name, result["missed"], before["missed"]))
+
+        for field in ("query_p50_ms", "query_p99_ms",
+                      "expansions_mean", "length_ratio_mean"):
+            if result[field] > before[field] * (1 + REGRESSION_TOLERANCE):
+                regressions.append("%s: %s %.3f, was %.3f" % (
+                    name, field, result[field], before[field]))
+
+    return regressions
+
+
+def run_pathfinding(args):
+    """
+    Runs the pathfinding benchmark on all map sizes and densities,
+    prints the results and compares them to the baseline.
+    Returns the results and whether they got worse.
+    """
+    from ..cppinterface.setup import setup
+    setup()
+
+    from .benchmark_cpp import run_pathfinding_benchmark
+
+    result = []
+    for size in PATHFINDING_SIZES:
+        for density in PATHFINDING_DENSITIES:
+            for worst_case in (False, True):
+                for jump_points in (False, True):
+                    run_result = run_pathfinding_benchmark(
+                        size, density, args.queries, args.seed,
+                        worst_case, jump_points)
+                    run_result["density"] = density
+                    result.append(run_result)
+                    print_pathfinding_result(run_result)
+                    print()
+
+    regressions = []
+    if args.baseline:
+        with open(args.baseline) as infile:
+            regressions = pathfinding_regressions(result, json.load(infile))
+        for regression in regressions:
+            err("regression: %s" % regression)
+
+    if args.output:
+        with open(args.output, "w") as outfile:
+            json.dump(result, outfile, indent=4)
+
+    return result, bool(regressions)
+
+
+def run(asset_dir, args):
+    """ Runs the benchmark in the converted assets and prints the results. """
+    from ..cppinterface.setup import setup
+    setup()
+
+    from .benchmark_cpp import run_simulation_benchmark
+
+    if args.scale:
+        result = []
+        for total in SCALE_UNITS:
+            result.append(run_simulation_benchmark(
+                asset_dir, args.players, total // args.players,
+                args.ticks, args.seed))
+            print_result(result[-1])
+            print()
+    else:
+        result = run_simulation_benchmark(asset_dir, args.players, args.units,
+                                          args.ticks, args.seed)
+        print_result(result)
+
+    if args.output:
+        with open(args.output, "w") as outfile:
+            json.dump(result, outfile, indent=4)
+
+    return result
+
+
+def main(args, error):
+    """ Makes sure that the assets have been converted, and benchmarks. """
+    del error  # unused
+
+    if args.pathfinding:
+        _, regressed = run_pathfinding(args)
+        return 1 if regressed else 0
+
+    from ..assets import get_assets
+    assets = get_assets(args)
+
+    from ..convert.main import conversion_required, convert_assets
+    if conversion_required(assets, args):
+        if not convert_assets(assets, args):
+            err("game asset conversion failed")
+            return 1
+
+    run(args.asset_dir, args)
+    return 0
+
+
+def demo(argv):
+    """
+    Runs the benchmark in an asset directory that was converted before.
+    """
+    cli = argparse.ArgumentParser()
+    cli.add_argument("asset_dir", help="directory of the converted assets")
+    add_scenario_arguments(cli)
+    args = cli.parse_args(argv)
+
+    run(args.asset_dir, args)
+
+
+def pathfinding_demo(argv):
+    """
+    Runs the pathfinding benchmark, which needs no assets.
+    """
+    cli = argparse.ArgumentParser()
+    add_scenario_arguments(cli)
+    args = cli.parse_args(argv)
+
+    run_pathfinding(args)
@@ -0,0 +1,97 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Runs the headless simulation and pathfinding benchmarks of libopenage.
+"""
+
+from libopenage.gamestate.pathfinding_benchmark cimport (
+    pathfinding_benchmark_settings,
+    pathfinding_benchmark_result,
+    run_pathfinding_benchmark as run_pathfinding_benchmark_cpp
+)
+from libopenage.gamestate.simulation_benchmark cimport (
+    simulation_benchmark_settings,
+    simulation_benchmark_result,
+    run_simulation_benchmark as run_simulation_benchmark_cpp
+)
+
+
+def run_simulation_benchmark(asset_dir, players, units_per_player, ticks, seed):
+    """
+    Translates the settings and calls run_simulation_benchmark_cpp.
+    Returns the measurements as a dict.
+    """
+    cdef simulation_benchmark_settings settings
+
+    settings.data_directory = asset_dir.encode()
+    settings.players = players
+    settings.units_per_player = units_per_player
+    settings.ticks = ticks
+    settings.seed = seed
+
+    cdef simulation_benchmark_result result
+
+    with nogil:
+        result = run_simulation_benchmark_cpp(settings)
+
+    return {
+        "units": result.units,
+        "ticks": result.ticks,
+        "ticks_per_second": result.ticks_per_second,
+        "tick_p50_ms": result.tick_p50_ms,
+        "tick_p99_ms": result.tick_p99_ms,
+        "tick_max_ms": result.tick_max_ms,
+        "unit_update_us": result.unit_update_us,
+        "action_allocations": result.action_allocations,
+        "action_heap_allocations": result.action_heap_allocations,
+        "collision_pair_tests": result.collision_pair_tests,
+        "moves_blocked": result.moves_blocked,
+        "move_repairs": result.move_repairs,
+        "move_failed_repairs": result.move_failed_repairs,
+        "move_repaths": result.move_repaths,
+        "heap_growth": result.heap_growth if result.heap_measured else None,
+        "snapshot_ms": result.snapshot_ms,
+        "fork_ms": result.fork_ms,
+        "snapshot_bytes": result.snapshot_bytes,
+    }
+
+
+def run_pathfinding_benchmark(terrain_size, obstacle_density, queries, seed,
+                              worst_case, jump_points):
+    """
+    Translates the settings and calls run_pathfinding_benchmark_cpp.
+    Returns the measurements as a dict.
+    """
+    cdef pathfinding_benchmark_settings settings
+
+    settings.terrain_size = terrain_size
+    settings.obstacle_density = obstacle_density
+    settings.queries = queries
+    settings.seed = seed
+    settings.worst_case = worst_case
+    settings.jump_points = jump_points
+
+    cdef pathfinding_benchmark_result result
+
+    with nogil:
+        result = run_pathfinding_benchmark_cpp(settings)
+
+    return {
+        "terrain_size": terrain_size,
+        "worst_case": worst_case,
+        "jump_points": jump_points,
+        "map_tiles": result.map_tiles,
+        "obstacle_density": result.obstacle_density,
+        "queries": result.queries,
+        "reached": result.reached,
+        "missed": result.missed,
+        "query_p50_ms": result.query_p50_ms,
+        "query_p99_ms": result.query_p99_ms,
+        "query_max_ms": result.query_max_ms,
+        "expansions_mean": result.expansions_mean,
+        "expansions_max": result.expansions_max,
+        "nodes_mean": result.nodes_mean,
+        "length_ratio_mean": result.length_ratio_mean,
+        "length_ratio_max": result.length_ratio_max,
+        "heap_growth": result.heap_growth if result.heap_measured else None,
+    }
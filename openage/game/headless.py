@@ -0,0 +1,64 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Simulates a game without window, gui or audio,
+for match servers and long running tests.
+"""
+
+from ..log import err, info
+
+
+def init_subparser(cli):
+    """ Initializes the parser for the headless simulation args. """
+    cli.set_defaults(entrypoint=main)
+
+    cli.add_argument("--load", metavar="SAVEFILE",
+                     help="simulate this saved game instead of a generated one")
+    cli.add_argument("--players", type=int, default=2,
+                     help="number of players of the generated game")
+    cli.add_argument("--seed", type=int, default=4321,
+                     help="seed of the map generator")
+    cli.add_argument("--terrain-size", type=int, default=2,
+                     help="size of the generated map")
+    cli.add_argument("--workers", type=int, default=0,
+                     help=("threads that update the units, "
+                           "0 updates them on the main thread"))
+    cli.add_argument("--ticks", type=int, default=600,
+                     help="number of simulated ticks")
+    cli.add_argument("--record", metavar="REPLAYFILE",
+                     help="record the simulated game to this replay file")
+    cli.add_argument("--replay", metavar="REPLAYFILE",
+                     help=("play back this replay as fast as possible, "
+                           "instead of simulating a new game"))
+
+
+def main(args, error):
+    """ Makes sure that the assets have been converted, and simulates. """
+    del error  # unused
+
+    from ..cppinterface.setup import setup
+    setup()
+
+    from ..assets import get_assets
+    assets = get_assets(args)
+
+    from ..convert.main import conversion_required, convert_assets
+    if conversion_required(assets, args):
+        if not convert_assets(assets, args):
+            err("game asset conversion failed")
+            return 1
+
+    from .main_cpp import run_headless_game
+    result = run_headless_game(args)
+
+    info("%d ticks of %d units: %.2f s to load, %.2f s to simulate" % (
+        result["ticks"], result["units"],
+        result["load_seconds"], result["tick_seconds"]))
+    info("state hash: %016x" % result["state_hash"])
+
+    if not result["in_sync"]:
+        err("the replay diverged from the recorded game in tick %d" % (
+            result["desync_tick"]))
+        return 1
+
+    return 0
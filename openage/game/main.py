@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Holds openage's main main method, used for launching the game.
@@ -19,6 +19,19 @@ def init_subparser(cli):
         "--gl-debug", action='store_true',
         help="throw exceptions directly from the OpenGL calls")
 
+    cli.add_argument(
+        "--benchmark", metavar="SAVEFILE",
+        help="fly the camera over this saved game without vsync and fps "
+             "limit, and report the frame time histograms at exit")
+
+    cli.add_argument(
+        "--benchmark-frames", type=int, default=1800,
+        help="number of frames measured by --benchmark")
+
+    cli.add_argument(
+        "--benchmark-output", metavar="FILE",
+        help="write the histograms of --benchmark to this file")
+
 
 def main(args, error):
     """
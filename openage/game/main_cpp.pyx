@@ -1,7 +1,14 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 
 from libopenage.main cimport main_arguments, run_game as run_game_cpp
+from libopenage.gamestate.headless cimport (
+    HeadlessGame,
+    headless_settings,
+    headless_result,
+    run_headless_game as run_headless_game_cpp
+)
+from ..cppinterface.unit_view cimport wrap_unit_columns
 
 
 def run_game(args, assets):
@@ -20,9 +27,90 @@ def run_game(args, assets):
 
     args_cpp.gl_debug = args.gl_debug
 
+    if args.benchmark is not None:
+        args_cpp.benchmark_save = args.benchmark.encode()
+    args_cpp.benchmark_frames = args.benchmark_frames
+    if args.benchmark_output is not None:
+        args_cpp.benchmark_output = args.benchmark_output.encode()
+
     cdef int result
 
     with nogil:
         result = run_game_cpp(args_cpp)
 
     return result
+
+
+def run_headless_game(args):
+    """
+    Translates args and calls run_headless_game_cpp.
+    Returns the result as a dict.
+    """
+    cdef headless_settings settings = translate_headless_args(args)
+    cdef headless_result result
+
+    with nogil:
+        result = run_headless_game_cpp(settings)
+
+    return {
+        "units": result.units,
+        "ticks": result.ticks,
+        "load_seconds": result.load_seconds,
+        "tick_seconds": result.tick_seconds,
+        "state_hash": result.state_hash,
+        "in_sync": result.in_sync,
+        "desync_tick": result.desync_tick,
+    }
+
+
+cdef class HeadlessSimulation:
+    """
+    A headless game that is advanced tick by tick from Python,
+    e.g. by bot tooling that reads the unit state in between:
+
+        sim = HeadlessSimulation(args)
+        sim.tick(20)
+        positions = numpy.asarray(sim.units().positions)
+
+    The unit arrays are views of the game state, without copies.
+    """
+
+    cdef HeadlessGame *game
+
+    def __cinit__(self, args):
+        cdef headless_settings settings = translate_headless_args(args)
+
+        with nogil:
+            self.game = new HeadlessGame(settings)
+
+    def __dealloc__(self):
+        del self.game
+
+    def tick(self, int count=1):
+        """ simulates count ticks """
+        with nogil:
+            self.game.tick(count)
+
+    def units(self):
+        """ the unit state after the last tick, as UnitArrays """
+        return wrap_unit_columns(self.game.get_units())
+
+
+cdef headless_settings translate_headless_args(args):
+    """ The headless settings of the command line args. """
+    cdef headless_settings settings
+
+    settings.data_directory = args.asset_dir.encode()
+    if args.load is not None:
+        settings.save_file = args.load.encode()
+    settings.players = args.players
+    settings.seed = args.seed
+    settings.terrain_size = args.terrain_size
+    settings.simulation_workers = args.workers
+    settings.ticks = args.ticks
+    if args.record is not None:
+        settings.record_file = args.record.encode()
+    if args.replay is not None:
+        settings.replay_file = args.replay.encode()
+
+    return settings
@@ -0,0 +1,132 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Reads the binary log files written by libopenage/log/binary_logsink.h,
+and prints their messages like the FileSink would.
+"""
+
+from collections import namedtuple
+from struct import Struct
+import re
+
+MAGIC = b"OALB"
+FORMAT_VERSION = 1
+
+KIND_STRING = 0
+KIND_MESSAGE = 1
+
+HEADER = Struct("<4sI")
+STRING = Struct("<II")
+MESSAGE = Struct("<iIIIIIQqI")
+
+# priorities of libopenage/log/level.cpp, for filtering
+LEVEL_PRIORITIES = {
+    "spam": -100,
+    "dbg": -20,
+    "info": 0,
+    "warn": 100,
+    "err": 200,
+    "crit": 500,
+}
+
+
+LogRecord = namedtuple("LogRecord", (
+    "level", "priority", "source", "filename", "lineno",
+    "function", "thread_id", "timestamp", "text"))
+
+
+def format_record(record):
+    """ the record in the FileSink's text format. """
+    return "{}|{}|{}:{}|{}|{}|{:.7f}|{}".format(
+        record.level, record.source, record.filename, record.lineno,
+        record.function, record.thread_id, record.timestamp / 1e9,
+        record.text)
+
+
+def read_exactly(fileobj, size):
+    """ reads size bytes, raises if the file ends before. """
+    data = fileobj.read(size)
+    if len(data) != size:
+        raise EOFError("binary log ended within a record")
+    return data
+
+
+def read_records(fileobj):
+    """
+    Yields the LogRecords of the binary log file object.
+    Appended logs, which start with their own header, are read as well.
+    """
+    strings = None
+
+    while True:
+        kind = fileobj.read(1)
+        if not kind:
+            return
+
+        # a header starts the log, or an appended one
+        if kind == MAGIC[:1]:
+            magic, version = HEADER.unpack(kind + read_exactly(fileobj, HEADER.size - 1))
+            if magic != MAGIC:
+                raise ValueError("not a binary log file")
+            if version != FORMAT_VERSION:
+                raise ValueError("unsupported binary log version %d" % version)
+            strings = {}
+            continue
+
+        if strings is None:
+            raise ValueError("not a binary log file")
+
+        kind = kind[0]
+        if kind == KIND_STRING:
+            string_id, size = STRING.unpack(read_exactly(fileobj, STRING.size))
+            strings[string_id] = read_exactly(fileobj, size).decode(errors="replace")
+
+        elif kind == KIND_MESSAGE:
+            (priority, level, source, filename, lineno, function,
+             thread_id, timestamp, size) = MESSAGE.unpack(
+                 read_exactly(fileobj, MESSAGE.size))
+            text = read_exactly(fileobj, size).decode(errors="replace")
+
+            yield LogRecord(strings[level], priority, strings[source],
+                            strings[filename], lineno, strings[function],
+                            thread_id, timestamp, text)
+
+        else:
+            raise ValueError("unknown binary log record kind %d" % kind)
+
+
+def init_subparser(cli):
+    """ Initializes the parser for the log decoder. """
+    cli.set_defaults(entrypoint=main)
+
+    cli.add_argument("logfile", help="binary log file to decode")
+    cli.add_argument("--level", choices=sorted(LEVEL_PRIORITIES,
+                                                key=LEVEL_PRIORITIES.get),
+                     help="only show messages of this level and above")
+    cli.add_argument("--source",
+                     help="only show messages of this log source")
+    cli.add_argument("--thread", type=int,
+                     help="only show messages of this thread id")
+    cli.add_argument("--grep", metavar="REGEX",
+                     help="only show messages whose text matches")
+
+
+def main(args, error):
+    """ Prints the matching messages of the binary log. """
+    del error  # unused
+
+    min_priority = LEVEL_PRIORITIES.get(args.level)
+    pattern = re.compile(args.grep) if args.grep else None
+
+    with open(args.logfile, "rb") as logfile:
+        for record in read_records(logfile):
+            if min_priority is not None and record.priority < min_priority:
+                continue
+            if args.source is not None and record.source != args.source:
+                continue
+            if args.thread is not None and record.thread_id != args.thread:
+                continue
+            if pattern is not None and not pattern.search(record.text):
+                continue
+
+            print(format_record(record))
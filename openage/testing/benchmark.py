@@ -0,0 +1,82 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Stores the results of benchmarks, and compares them with a baseline.
+
+The results are a dict of {benchmark name: {case name: statistics}},
+where the statistics are a dict of the timings of one iteration in
+nanoseconds ("min", "median", "mean", "stddev", "max") and the number
+of "iterations". They are stored as JSON, so the output of one run
+is the baseline of later ones.
+"""
+
+import json
+
+
+FORMAT_VERSION = 1
+
+
+def write_results(path, results):
+    """
+    Writes the results of benchmarks to the JSON file at path.
+    """
+    with open(path, "w") as outfile:
+        json.dump({"version": FORMAT_VERSION, "benchmarks": results},
+                  outfile, indent=4, sort_keys=True)
+        outfile.write("\n")
+
+
+def read_results(path):
+    """
+    Reads the results of benchmarks stored by write_results.
+    """
+    with open(path) as infile:
+        content = json.load(infile)
+
+    if content.get("version") != FORMAT_VERSION:
+        raise ValueError("unsupported benchmark results version in " + path)
+
+    return content["benchmarks"]
+
+
+def compare(results, baseline, tolerance):
+    """
+    Yields (benchmark, case, ratio) for each case whose median took
+    more than (1 + tolerance) times the median in the baseline.
+
+    Cases without a baseline are not compared.
+
+    >>> baseline = {"b": {"fast": {"median": 100}, "slow": {"median": 100}}}
+    >>> results = {"b": {"fast": {"median": 105}, "slow": {"median": 150},
+    ...                  "new": {"median": 1}}}
+    >>> list(compare(results, baseline, 0.1))
+    [('b', 'slow', 1.5)]
+    """
+    for benchmark, cases in sorted(results.items()):
+        for case, stats in sorted(cases.items()):
+            try:
+                expected = baseline[benchmark][case]["median"]
+            except KeyError:
+                continue
+
+            if expected <= 0:
+                continue
+
+            ratio = stats["median"] / expected
+            if ratio > 1 + tolerance:
+                yield benchmark, case, ratio
+
+
+def format_stats(stats):
+    """
+    Formats the timing statistics of a case for the terminal.
+
+    >>> format_stats({"median": 1500, "stddev": 20.0, "min": 1400,
+    ...               "iterations": 10})
+    '1.500 us +- 0.020 us (min 1.400 us, 10 iterations)'
+    """
+    return "%.3f us +- %.3f us (min %.3f us, %d iterations)" % (
+        stats["median"] / 1000,
+        stats["stddev"] / 1000,
+        stats["min"] / 1000,
+        stats["iterations"])
@@ -1,12 +1,42 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
-Provides a wrapper for openage::testing::run_method.
+Provides wrappers for openage::testing::run_method and run_benchmark.
 """
 
-from libopenage.testing.testlist cimport run_method as run_method
+from libcpp.vector cimport vector
+
+from libopenage.testing.benchmark cimport benchmark_result
+from libopenage.testing.testlist cimport (
+    run_method as run_method,
+    run_benchmark as run_benchmark
+)
 
 
 def run_cpp_method(str methodname):
     """ Runs the given C++ void () method, by its name. """
     run_method(methodname.encode())
+
+
+def run_cpp_benchmark(str name, size_t warmup, size_t iterations):
+    """
+    Runs the given C++ benchmark, by its name.
+
+    Returns a list of dicts with the name and timing statistics of each case,
+    in nanoseconds per iteration.
+    """
+    cdef vector[benchmark_result] results = run_benchmark(
+        name.encode(), warmup, iterations)
+
+    return [
+        {
+            "name": result.name.decode(),
+            "iterations": result.iterations,
+            "min": result.min,
+            "median": result.median,
+            "mean": result.mean,
+            "stddev": result.stddev,
+            "max": result.max,
+        }
+        for result in results
+    ]
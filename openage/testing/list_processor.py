@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """ Processes the raw test lists from the testlist module. """
 
@@ -9,10 +9,10 @@ from importlib import import_module
 from ..util.strings import lstrip_once
 
 
-def tests_and_demos(test_lister, demo_lister):
+def tests_and_demos(test_lister, demo_lister, benchmark_lister=None):
     """
-    Yields tuples of testname, type, description for given test and demo
-    listers.
+    Yields tuples of testname, type, description for given test, demo
+    and benchmark listers.
 
     A processing step between the raw lists in testlist, and get_all_tests().
     """
@@ -28,6 +28,11 @@ def tests_and_demos(test_lister, demo_lister):
         name, desc = demo
         yield name, 'demo', desc
 
+    if benchmark_lister is not None:
+        for benchmark in benchmark_lister():
+            name, desc = benchmark
+            yield name, 'benchmark', desc
+
 
 def tests_and_demos_py():
     """ Invokes tests_and_demos() with the py-specific listers. """
@@ -38,8 +43,8 @@ def tests_and_demos_py():
 
 def tests_and_demos_cpp():
     """ Invokes tests_and_demos() with the C++-specific listers. """
-    from .testlist import tests_cpp, demos_cpp
-    for val in tests_and_demos(tests_cpp, demos_cpp):
+    from .testlist import tests_cpp, demos_cpp, benchmarks_cpp
+    for val in tests_and_demos(tests_cpp, demos_cpp, benchmarks_cpp):
         yield val
 
 
@@ -49,12 +54,13 @@ def get_all_tests_and_demos():
 
     {(testname, type): lang, description, testfun}.
 
-    type is in {'demo', 'test'},
+    type is in {'demo', 'test', 'benchmark'},
     lang is in {'cpp', 'py'},
     description is a str, and
-    testfun is callable and takes 0 args for tests / list(str) for demos.
+    testfun is callable and takes 0 args for tests / list(str) for demos /
+    warmup and iterations for benchmarks, which return their results.
     """
-    from .cpp_testing import run_cpp_method
+    from .cpp_testing import run_cpp_method, run_cpp_benchmark
 
     result = OrderedDict()
 
@@ -81,6 +87,10 @@ def get_all_tests_and_demos():
                 if args:
                     raise ValueError("C++ demos can't take arguments")
                 run_cpp_method(name)
+        elif type_ == 'benchmark':
+            def runner(warmup, iterations, name=name):
+                """ runs the benchmark, returns the results of its cases. """
+                return run_cpp_benchmark(name, warmup, iterations)
         else:
             def runner(name=name):
                 """ simply runs the demo func. """
@@ -89,7 +99,7 @@ def get_all_tests_and_demos():
         try:
             name = lstrip_once(name, 'openage::')
         except ValueError as exc:
-            raise ValueError("Unexpected C++ test/demo name") from exc
+            raise ValueError("Unexpected C++ test/demo/benchmark name") from exc
 
         result[name, type_] = 'cpp', description, runner
 
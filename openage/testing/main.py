@@ -1,4 +1,4 @@
-# Copyright 2014-2015 the openage authors. See copying.md for legal info.
+# Copyright 2014-2017 the openage authors. See copying.md for legal info.
 
 """ CLI module for running all tests. """
 
@@ -6,17 +6,18 @@ import argparse
 
 from ..util.strings import format_progress
 
+from .benchmark import compare, format_stats, read_results, write_results
 from .testing import TestError
 from .list_processor import get_all_tests_and_demos
 
 
 def print_test_list(test_list):
     """
-    Prints a list of all tests and demos in test_list.
+    Prints a list of all tests, demos and benchmarks in test_list.
     """
     namelen = max(len(name) for name, _ in test_list)
 
-    for current_type in ['test', 'demo']:
+    for current_type in ['test', 'demo', 'benchmark']:
         for (name, type_), (lang, desc, _) in test_list.items():
             if type_ == current_type:
                 print("[%s %3s] %-*s  %s" % (type_, lang, namelen, name, desc))
@@ -33,12 +34,29 @@ def init_subparser(cli):
     cli.add_argument("--demo", "-d", nargs=argparse.REMAINDER,
                      help=("run the given demo; the remaining arguments "
                            "are passed to the demo."))
+    cli.add_argument("--benchmark", "-b", nargs='+', default=[],
+                     metavar="NAME", help="run the given benchmarks")
+    cli.add_argument("--run-all-benchmarks", "-B", action='store_true',
+                     help="run all benchmarks")
+    cli.add_argument("--warmup", type=int, default=3,
+                     help="untimed runs of each benchmark case")
+    cli.add_argument("--iterations", type=int, default=20,
+                     help="timed runs of each benchmark case")
+    cli.add_argument("--output", "-o",
+                     help="write the benchmark results to this JSON file")
+    cli.add_argument("--baseline",
+                     help=("fail if a benchmark case is slower than "
+                           "in the results stored in this JSON file"))
+    cli.add_argument("--tolerance", type=float, default=0.1,
+                     help=("allowed slowdown of the median of a case "
+                           "compared to the baseline, as fraction"))
     cli.add_argument("test", nargs='*', help="run this test")
 
 
 def process_args(args, error):
     """ Processes the given args, detecting errors. """
-    if not args.run_all_tests and not args.demo and not args.test:
+    if not (args.run_all_tests or args.demo or args.test or
+            args.run_all_benchmarks or args.benchmark):
         args.list = True
 
     if args.run_all_tests:
@@ -48,6 +66,15 @@ def process_args(args, error):
     if args.test and args.demo:
         error("can't run a demo _and_ tests")
 
+    if args.run_all_benchmarks and args.benchmark:
+        error("can't run individual benchmarks when running all benchmarks")
+
+    if args.demo and (args.benchmark or args.run_all_benchmarks):
+        error("can't run a demo _and_ benchmarks")
+
+    if args.iterations < 1 or args.warmup < 0:
+        error("benchmarks need at least one iteration")
+
     from openage.cppinterface.setup import setup
     setup()
 
@@ -60,6 +87,14 @@ def process_args(args, error):
         if (test, 'test') not in test_list:
             error("no such test: " + test)
 
+    if args.run_all_benchmarks:
+        args.benchmark = [name for name, type_ in test_list
+                          if type_ == 'benchmark']
+
+    for benchmark in args.benchmark:
+        if (benchmark, 'benchmark') not in test_list:
+            error("no such benchmark: " + benchmark)
+
     if args.demo:
         if (args.demo[0], 'demo') not in test_list:
             error("no such demo: " + args.demo[0])
@@ -67,6 +102,46 @@ def process_args(args, error):
     return test_list
 
 
+def run_benchmarks(args, test_list):
+    """
+    Runs the benchmarks given in args, stores their results and compares
+    them with the baseline.
+
+    Returns False if a benchmark has regressed.
+    """
+    results = {}
+
+    for idx, name in enumerate(args.benchmark):
+        lang, _, benchmarkfun = test_list[name, 'benchmark']
+
+        print("\x1b[32m[%s]\x1b[m %3s %s" % (
+            format_progress(idx, len(args.benchmark)),
+            lang,
+            name))
+
+        cases = benchmarkfun(args.warmup, args.iterations)
+        results[name] = {}
+        for case in cases:
+            stats = {key: value for key, value in case.items() if key != "name"}
+            results[name][case["name"]] = stats
+            print("    %-24s %s" % (case["name"], format_stats(stats)))
+
+    if args.output:
+        write_results(args.output, results)
+
+    if not args.baseline:
+        return True
+
+    regressions = list(compare(results, read_results(args.baseline),
+                               args.tolerance))
+
+    for benchmark, case, ratio in regressions:
+        print("\x1b[31;1m%s %s is %.1f%% slower than the baseline\x1b[m" % (
+            benchmark, case, (ratio - 1) * 100))
+
+    return not regressions
+
+
 def main(args, error):
     """ CLI main method. """
     test_list = process_args(args, error)
@@ -102,6 +177,10 @@ def main(args, error):
 
             exit(1)
 
+    if args.benchmark:
+        if not run_benchmarks(args, test_list):
+            exit(1)
+
     if args.demo:
         _, _, demofun = test_list[args.demo[0], 'demo']
         exit(demofun(args.demo[1:]))
@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """ Lists of all possible tests; enter your tests here. """
 
@@ -8,6 +8,7 @@ def doctest_modules():
     Yields the names of all Python modules that shall be tested during doctest.
     """
 
+    yield "openage.testing.benchmark"
     yield "openage.util.math"
     yield "openage.util.strings"
     yield "openage.util.system"
@@ -38,10 +39,18 @@ def demos_py():
     Yields tuples of (name, description) for all Python demo methods.
     """
 
+    yield ("openage.cabextract.test.benchmark",
+           "decompresses a CAB archive and reports the throughput")
     yield ("openage.cppinterface.exctranslate_tests.cpp_to_py_demo",
            "translates a C++ exception and its causes to python")
+    yield ("openage.game.benchmark.demo",
+           "simulates a generated game headlessly and reports tick times")
+    yield ("openage.game.benchmark.pathfinding_demo",
+           "searches paths on generated maps and reports their cost")
     yield ("openage.log.tests.demo",
            "demonstrates the translation of Python log messages")
+    yield ("openage.util.fslike.test.benchmark",
+           "reads a directory from C++, natively and through Python")
 
 
 def tests_cpp():
@@ -51,20 +60,62 @@ def tests_cpp():
     If no description is required, just the name may be yielded.
     """
 
+    yield "openage::audio::tests::mix", "audio mixing kernels"
+    yield "openage::audio::tests::resampler", "audio sample rate conversion"
+    yield "openage::convert::tests::drs", "drs archive reading"
+    yield "openage::convert::tests::opus_encode", "opus sound encoding"
+    yield "openage::convert::tests::slp", "slp frame decoding"
+    yield "openage::convert::tests::sprite_sheet", "sprite sheet packing"
+    yield "openage::console::tests::dirty_lines", "console buffer change tracking"
+    yield "openage::console::tests::bulk_write", "console buffer bulk writes"
+    yield "openage::console::tests::scrollback", "console scrollback compression"
     yield "openage::coord::tests::coord"
+    yield "openage::cvar::tests::config_file", "native config file loading"
+    yield "openage::cvar::tests::typed_cvars", "typed config variables"
+    yield "openage::datastructure::tests::dary_heap", "d-ary heap with decrease_key"
     yield "openage::datastructure::tests::doubly_linked_list"
+    yield "openage::datastructure::tests::flat_hash_map", "open addressing hash tables"
+    yield "openage::datastructure::tests::intrusive_list", "intrusive list hooks"
+    yield "openage::datastructure::tests::lockfree_queue"
     yield "openage::datastructure::tests::pairing_heap"
+    yield "openage::datastructure::tests::small_vector", "vector with inline storage"
+    yield "openage::datastructure::tests::timer_wheel"
+    yield "openage::gamestate::tests::influence_map", "parallel influence maps"
+    yield "openage::gamestate::tests::lockstep", "lockstep command batches"
+    yield "openage::gamestate::tests::replay", "replay recording"
+    yield "openage::gamestate::tests::state_hash", "incremental game state hash"
+    yield "openage::gamestate::tests::visibility_grid", "line of sight stamps"
     yield "openage::job::tests::test_job_manager"
+    yield "openage::log::tests::binary_sink", "binary log file writing"
+    yield "openage::log::tests::level_filter", "log level filtering"
+    yield "openage::log::tests::queue", "log record queue"
+    yield "openage::nyan::tests::database", "compiled nyan type database"
     yield "openage::path::tests::path_node", "pathfinding"
     yield "openage::pyinterface::tests::pyobject"
+    yield "openage::pyinterface::tests::batch", "batched calls into python"
     yield "openage::pyinterface::tests::err_py_to_cpp"
     yield "openage::renderer::tests::font"
     yield "openage::renderer::tests::font_manager"
     yield "openage::rng::tests::run"
+    yield "openage::terrain::tests::chunk_encoding", "stored terrain chunks"
+    yield "openage::terrain::tests::placement_grid", "cached building placement"
+    yield "openage::terrain::tests::tile_changes", "per tick tile change lists"
+    yield "openage::terrain::tests::tile_objects", "object lists of tiles"
+    yield "openage::util::tests::asset_pack", "memory mapped asset packs"
+    yield "openage::util::tests::binary_data"
     yield "openage::util::tests::constinit_vector"
+    yield "openage::util::tests::duration_histogram", "duration histogram buckets"
     yield "openage::util::tests::enum_"
+    yield "openage::util::tests::frame_arena", "bump allocation and reset of frame arenas"
+    yield "openage::util::tests::frame_pacer", "frame cost prediction"
     yield "openage::util::tests::init"
     yield "openage::util::tests::matrix"
+    yield "openage::util::tests::metrics", "metrics registry and export"
+    yield "openage::util::tests::perfect_hash", "compile time perfect hashing"
+    yield "openage::util::tests::string_formatter", "number formatting without streams"
+    yield "openage::util::tests::string_id", "compile time string ids"
+    yield "openage::util::tests::trace", "scoped trace recording"
+    yield "openage::util::tests::unicode", "utf-8 decoding"
     yield "openage::util::tests::vector"
     yield "openage::input::tests::parse_event_string", "keybinds parsing"
 
@@ -78,11 +129,36 @@ def demos_cpp():
            "prints a few test lines to a buffer, and renders it to stdout")
     yield ("openage::console::tests::interactive",
            "showcases console as an interactive terminal on your current tty")
+    yield ("openage::datastructure::tests::hash_benchmark",
+           "compares the flat hash set with std::unordered_set on tiles")
+    yield ("openage::datastructure::tests::heap_benchmark",
+           "compares the priority queues on a path search workload")
+    yield ("openage::datastructure::tests::queue_benchmark",
+           "compares the lock-free queues with the mutex queue")
+    yield ("openage::job::tests::parallel_benchmark",
+           "times parallel_reduce on 1 to 16 threads")
     yield ("openage::error::demo",
            "showcases the openage exceptions, including backtraces")
     yield ("openage::log::tests::demo",
            "showcases the logging system")
+    yield ("openage::path::tests::jump_point_benchmark",
+           "compares jump point search with a* on a generated map")
     yield ("openage::pyinterface::tests::err_py_to_cpp_demo",
            "translates a Python exception to C++")
     yield ("openage::pyinterface::tests::pyobject_demo",
            "a tiny interactive interpreter using PyObjectRef")
+
+
+def benchmarks_cpp():
+    """
+    Yields tuples of (name, description) for all C++ benchmark methods.
+    """
+
+    yield ("openage::audio::tests::mix_benchmark",
+           "the audio mixing kernels and the scalar code")
+    yield ("openage::nyan::tests::database_benchmark",
+           "nyan member reads by offset and by name")
+    yield ("openage::util::tests::matrix_benchmark",
+           "the 4x4 matrix kernels and the scalar code")
+    yield ("openage::util::tests::string_formatter_benchmark",
+           "number formatting and std::ostream")
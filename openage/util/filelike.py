@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Provides the FileLikeObject abstract base class, which specifies a file-like
@@ -348,6 +348,44 @@ class StreamFragment(PosSavingReadOnlyFileLikeObject):
         del self.stream
 
 
+class BufferReader(PosSavingReadOnlyFileLikeObject):
+    """
+    Reads from an object that supports the buffer protocol,
+    e.g. a member of a memory-mapped archive.
+
+    Unlike StreamFragment, the readers of one archive don't share a
+    stream cursor, and getbuffer() gives access without copying.
+    """
+
+    def __init__(self, buf):
+        super().__init__()
+
+        self.view = memoryview(buf).cast('B')
+
+    def read(self, size=-1):
+        if size < 0:
+            size = INF
+
+        size = clamp(size, 0, len(self.view) - self.pos)
+
+        data = self.view[self.pos:self.pos + size].tobytes()
+        self.pos += size
+        return data
+
+    def getbuffer(self):
+        """
+        read-only memoryview of the whole data.
+        """
+        return self.view
+
+    def get_size(self):
+        return len(self.view)
+
+    def close(self):
+        self.closed = True
+        del self.view
+
+
 class FIFO(FileLikeObject):
     """
     File-like wrapper around ByteQueue.
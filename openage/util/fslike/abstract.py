@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Provides filesystem-like interfaces:
@@ -133,6 +133,15 @@ class FSLikeObject(ABC):
         """
         pass
 
+    def resolve_native(self, parts):
+        """
+        Returns the path of the file in the native file system, as bytes,
+        or None if the file can only be opened through this object.
+        Allows C++ code to read the file without calling into Python.
+        """
+        del parts  # unused
+        return None
+
 
 class ReadOnlyFSLikeObject(FSLikeObject):
     """
@@ -1,4 +1,42 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
+
+"""
+Lets C++ code read files of Python fs-like objects; see
+libopenage/util/fslikeobject.h.
+"""
+
+from cpython.ref cimport PyObject
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+
+from libopenage.pyinterface.pyobject cimport PyObjectRef
+from libopenage.util.fslikeobject cimport (
+    Path as CppPath,
+    read_all as cpp_read_all
+)
+
+
+def read_all(path, native=True):
+    """
+    Reads the file at the given fslike.path.Path from C++ and returns its
+    size in bytes. native=False always reads through the Python file object.
+    """
+    cdef PyObjectRef fsobj
+    fsobj.set_ref(<void *> <PyObject *> path.fsobj)
+
+    cdef vector[string] parts
+    for part in path.parts:
+        parts.push_back(part)
+
+    cdef CppPath *cpp_path = new CppPath(fsobj, parts)
+    cdef size_t result
+    cdef bint allow_native = native
+    try:
+        result = cpp_read_all(cpp_path[0], allow_native)
+    finally:
+        del cpp_path
+
+    return result
 
 
 def setup():
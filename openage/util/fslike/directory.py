@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 FSLikeObjects that represent actual file system paths:
@@ -38,6 +38,9 @@ class Directory(FSLikeObject):
         """ resolves parts to an actual path name. """
         return os.path.join(self.path, *parts)
 
+    def resolve_native(self, parts):
+        return self.resolve(parts)
+
     def open_r(self, parts):
         return open(self.resolve(parts), 'rb')
 
@@ -156,6 +156,13 @@ class Path:
         """ Returns the file size. """
         return self.fsobj.filesize(self.parts)
 
+    def resolve_native(self):
+        """
+        Returns the path of the file in the native file system,
+        or None if it can't be opened without the FSLikeObject.
+        """
+        return self.fsobj.resolve_native(self.parts)
+
     def watch(self, callback):
         """
         Installs 'callback' as callback that gets invoked whenever the file at
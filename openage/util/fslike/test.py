@@ -0,0 +1,49 @@
+# Copyright 2017-2017 the openage authors. See copying.md for legal info.
+
+"""
+Compares reading files from C++ through Python with the native read path.
+"""
+
+import argparse
+import time
+
+from .directory import Directory
+
+
+def benchmark(args):
+    """
+    Reads all files of a directory from C++, natively and through the
+    Python file objects, and reports the throughput of both.
+    """
+    from .cpp import read_all
+
+    cli = argparse.ArgumentParser()
+    cli.add_argument("directory", nargs="?", default=".",
+                     help="directory with the files to read, e.g. the assets")
+    cli.add_argument("--repeat", type=int, default=3,
+                     help="number of runs for each read path")
+    args = cli.parse_args(args)
+
+    root = Directory(args.directory).root
+
+    def files(path):
+        """ all files below path """
+        for entry in path.iterdir():
+            if entry.is_dir():
+                yield from files(entry)
+            elif entry.is_file():
+                yield entry
+
+    paths = list(files(root))
+
+    for native in (True, False):
+        for run in range(args.repeat):
+            size = 0
+            start = time.perf_counter()
+            for path in paths:
+                size += read_all(path, native)
+            seconds = time.perf_counter() - start
+
+            print("%s run %d: %d files, %d bytes in %.3f s: %.1f MB/s" % (
+                "native" if native else "python", run, len(paths), size,
+                seconds, size / max(seconds, 1e-9) / 1e6))
@@ -1,4 +1,4 @@
-# Copyright 2015-2016 the openage authors. See copying.md for legal info.
+# Copyright 2015-2017 the openage authors. See copying.md for legal info.
 
 """
 Provides Union, a utility class for combining multiple FSLikeObjects to a
@@ -183,6 +183,14 @@ class Union(FSLikeObject):
 
         return False
 
+    def resolve_native(self, parts):
+        # the mount that open_r would read from
+        for path in self.candidate_paths(parts):
+            if path.is_file():
+                return path.resolve_native()
+
+        return None
+
     def is_dir(self, parts):
         try:
             dirstructure = self.dirstructure
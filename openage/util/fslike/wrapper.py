@@ -6,6 +6,7 @@ Provides
  - Wrapper, a utility class for implementing wrappers around FSLikeObject.
  - WriteBlocker, a wrapper that blocks all writing.
  - Synchronizer, which adds thread-safety to a FSLikeObject.
+ - WriteRecorder, which remembers the files that were written.
 """
 
 import os
@@ -109,6 +110,10 @@ class Wrapper(FSLikeObject):
         with self.contextguard:
             return self.obj.poll_watches()
 
+    def resolve_native(self, parts):
+        with self.contextguard:
+            return self.obj.joinpath(parts).resolve_native()
+
 
 class WriteBlocker(ReadOnlyFSLikeObject, Wrapper):
     """
@@ -133,6 +138,26 @@ class Synchronizer(Wrapper):
             return "Synchronizer({})".format(repr(self.obj))
 
 
+class WriteRecorder(Wrapper):
+    """
+    Wraps a FSLikeObject, recording the paths of all files opened for writing.
+    The paths are available as slash-separated strings, in write order.
+    """
+    def __init__(self, obj):
+        super().__init__(obj)
+        self.written = []
+
+    def open_w(self, parts):
+        name = b"/".join(parts).decode()
+        if name not in self.written:
+            self.written.append(name)
+
+        return super().open_w(parts)
+
+    def __repr__(self):
+        return "WriteRecorder({})".format(repr(self.obj))
+
+
 class GuardedFile(FileLikeObject):
     """
     Wraps file-like objects, protecting calls to their members with the given